@@ -26,6 +26,9 @@
  * |[
  * gst-launch-1.0 videotestsrc num-buffers=50 ! av1enc ! webmmux ! filesink location=av1.webm
  * ]|
+ * |[
+ * gst-launch-1.0 videotestsrc is-live=true ! video/x-raw,width=1280,height=720 ! av1enc usage-profile=realtime end-usage=cbr target-bitrate=1500 cpu-used=8 tile-columns=2 ! fakesink
+ * ]| Low latency encoding using all the cores.
  * </refsect2>
  */
 
@@ -57,10 +60,67 @@ enum
 enum
 {
   PROP_0,
-  PROP_CPU_USED
+  PROP_CPU_USED,
+  PROP_THREADS,
+  PROP_ROW_MT,
+  PROP_TILE_COLUMNS,
+  PROP_TILE_ROWS,
+  PROP_LAG_IN_FRAMES,
+  PROP_END_USAGE,
+  PROP_TARGET_BITRATE,
+  PROP_USAGE_PROFILE
 };
 
 #define PROP_CPU_USED_DEFAULT 0
+#define PROP_THREADS_DEFAULT 0
+#define PROP_ROW_MT_DEFAULT TRUE
+#define PROP_TILE_COLUMNS_DEFAULT 0
+#define PROP_TILE_ROWS_DEFAULT 0
+#define PROP_LAG_IN_FRAMES_DEFAULT -1
+#define PROP_END_USAGE_DEFAULT AOM_VBR
+#define PROP_TARGET_BITRATE_DEFAULT 3000
+#define PROP_USAGE_PROFILE_DEFAULT GST_AV1_ENC_USAGE_GOOD_QUALITY
+
+#define GST_TYPE_AV1_ENC_END_USAGE (gst_av1_enc_end_usage_get_type ())
+static GType
+gst_av1_enc_end_usage_get_type (void)
+{
+  static volatile gsize end_usage_type = 0;
+  static const GEnumValue end_usage[] = {
+    {AOM_VBR, "Variable Bit Rate (VBR) mode", "vbr"},
+    {AOM_CBR, "Constant Bit Rate (CBR) mode", "cbr"},
+    {AOM_CQ, "Constrained Quality (CQ) mode", "cq"},
+    {AOM_Q, "Constant Quality (Q) mode", "q"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&end_usage_type)) {
+    GType type = g_enum_register_static ("GstAV1EncEndUsage", end_usage);
+    g_once_init_leave (&end_usage_type, type);
+  }
+
+  return (GType) end_usage_type;
+}
+
+#define GST_TYPE_AV1_ENC_USAGE_PROFILE (gst_av1_enc_usage_profile_get_type ())
+static GType
+gst_av1_enc_usage_profile_get_type (void)
+{
+  static volatile gsize usage_profile_type = 0;
+  static const GEnumValue usage_profile[] = {
+    {GST_AV1_ENC_USAGE_GOOD_QUALITY, "Good quality", "good"},
+    {GST_AV1_ENC_USAGE_REALTIME, "Realtime, no lookahead", "realtime"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&usage_profile_type)) {
+    GType type =
+        g_enum_register_static ("GstAV1EncUsageProfile", usage_profile);
+    g_once_init_leave (&usage_profile_type, type);
+  }
+
+  return (GType) usage_profile_type;
+}
 
 static void gst_av1_enc_finalize (GObject * object);
 static void gst_av1_enc_set_property (GObject * object, guint prop_id,
@@ -141,6 +201,51 @@ gst_av1_enc_class_init (GstAV1EncClass * klass)
           "CPU Used. A Value greater than 0 will increase encoder speed at the expense of quality.",
           0, 8, PROP_CPU_USED_DEFAULT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Maximum number of encoding threads (0 = number of CPUs)",
+          0, G_MAXUINT, PROP_THREADS_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ROW_MT,
+      g_param_spec_boolean ("row-mt", "Row based multithreading",
+          "Encode the superblock rows of a tile in parallel",
+          PROP_ROW_MT_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_COLUMNS,
+      g_param_spec_uint ("tile-columns", "Tile columns",
+          "Number of tile columns, log2", 0, 6, PROP_TILE_COLUMNS_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TILE_ROWS,
+      g_param_spec_uint ("tile-rows", "Tile rows",
+          "Number of tile rows, log2", 0, 6, PROP_TILE_ROWS_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_LAG_IN_FRAMES,
+      g_param_spec_int ("lag-in-frames", "Lag in frames",
+          "Maximum number of frames to look ahead "
+          "(-1 = default of the usage profile)",
+          -1, G_MAXINT, PROP_LAG_IN_FRAMES_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_END_USAGE,
+      g_param_spec_enum ("end-usage", "Rate control mode",
+          "Rate control algorithm to use", GST_TYPE_AV1_ENC_END_USAGE,
+          PROP_END_USAGE_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_TARGET_BITRATE,
+      g_param_spec_uint ("target-bitrate", "Target bitrate",
+          "Target bitrate in kbit/sec", 1, G_MAXUINT,
+          PROP_TARGET_BITRATE_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_USAGE_PROFILE,
+      g_param_spec_enum ("usage-profile", "Usage profile",
+          "Encoder usage, realtime disables the lookahead by default",
+          GST_TYPE_AV1_ENC_USAGE_PROFILE, PROP_USAGE_PROFILE_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -160,6 +265,14 @@ gst_av1_enc_init (GstAV1Enc * av1enc)
 
   av1enc->keyframe_dist = 30;
   av1enc->cpu_used = PROP_CPU_USED_DEFAULT;
+  av1enc->threads = PROP_THREADS_DEFAULT;
+  av1enc->row_mt = PROP_ROW_MT_DEFAULT;
+  av1enc->tile_columns = PROP_TILE_COLUMNS_DEFAULT;
+  av1enc->tile_rows = PROP_TILE_ROWS_DEFAULT;
+  av1enc->lag_in_frames = PROP_LAG_IN_FRAMES_DEFAULT;
+  av1enc->end_usage = PROP_END_USAGE_DEFAULT;
+  av1enc->target_bitrate = PROP_TARGET_BITRATE_DEFAULT;
+  av1enc->usage_profile = PROP_USAGE_PROFILE_DEFAULT;
 
   g_mutex_init (&av1enc->encoder_lock);
 }
@@ -183,12 +296,23 @@ gst_av1_enc_finalize (GObject * object)
 static void
 gst_av1_enc_set_latency (GstAV1Enc * av1enc)
 {
-  GstClockTime latency =
-      gst_util_uint64_scale (av1enc->aom_cfg.g_lag_in_frames, 1 * GST_SECOND,
-      30);
+  GstClockTime latency;
+  gint fps_n, fps_d;
+
+  fps_n = GST_VIDEO_INFO_FPS_N (&av1enc->input_state->info);
+  fps_d = GST_VIDEO_INFO_FPS_D (&av1enc->input_state->info);
+  if (fps_n <= 0 || fps_d <= 0) {
+    fps_n = 30;
+    fps_d = 1;
+  }
+
+  latency =
+      gst_util_uint64_scale (av1enc->aom_cfg.g_lag_in_frames,
+      fps_d * GST_SECOND, fps_n);
   gst_video_encoder_set_latency (GST_VIDEO_ENCODER (av1enc), latency, latency);
 
-  GST_WARNING_OBJECT (av1enc, "Latency unimplemented");
+  GST_DEBUG_OBJECT (av1enc, "Latency set to %" GST_TIME_FORMAT
+      " (%u frames)", GST_TIME_ARGS (latency), av1enc->aom_cfg.g_lag_in_frames);
 }
 
 static const gchar *
@@ -261,6 +385,12 @@ gst_av1_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
   GstVideoCodecState *output_state;
   GstAV1Enc *av1enc = GST_AV1_ENC_CAST (encoder);
   GstAV1EncClass *av1enc_class = GST_AV1_ENC_GET_CLASS (av1enc);
+  unsigned int usage = 0;
+
+#ifdef AOM_USAGE_REALTIME
+  if (av1enc->usage_profile == GST_AV1_ENC_USAGE_REALTIME)
+    usage = AOM_USAGE_REALTIME;
+#endif
 
   output_state =
       gst_video_encoder_set_output_state (encoder,
@@ -273,13 +403,14 @@ gst_av1_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
   }
   av1enc->input_state = gst_video_codec_state_ref (state);
 
-  gst_av1_enc_set_latency (av1enc);
-
+  GST_OBJECT_LOCK (av1enc);
   g_mutex_lock (&av1enc->encoder_lock);
   if (aom_codec_enc_config_default (av1enc_class->codec_algo, &av1enc->aom_cfg,
-          0)) {
+          usage)) {
     gst_av1_codec_error (&av1enc->encoder,
         "Failed to get default codec config.");
+    g_mutex_unlock (&av1enc->encoder_lock);
+    GST_OBJECT_UNLOCK (av1enc);
     return FALSE;
   }
   GST_DEBUG_OBJECT (av1enc, "Got default encoder config");
@@ -290,9 +421,17 @@ gst_av1_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
   av1enc->aom_cfg.g_h = av1enc->input_state->info.height;
   av1enc->aom_cfg.g_timebase.num = av1enc->input_state->info.fps_d;
   av1enc->aom_cfg.g_timebase.den = av1enc->input_state->info.fps_n;
-  /* FIXME : Make configuration properties */
-  av1enc->aom_cfg.rc_target_bitrate = 3000;
+  av1enc->aom_cfg.rc_target_bitrate = av1enc->target_bitrate;
+  av1enc->aom_cfg.rc_end_usage = av1enc->end_usage;
   av1enc->aom_cfg.g_error_resilient = AOM_ERROR_RESILIENT_DEFAULT;
+  if (av1enc->threads > 0)
+    av1enc->aom_cfg.g_threads = av1enc->threads;
+  else
+    av1enc->aom_cfg.g_threads = g_get_num_processors ();
+  if (av1enc->lag_in_frames >= 0)
+    av1enc->aom_cfg.g_lag_in_frames = av1enc->lag_in_frames;
+  else if (av1enc->usage_profile == GST_AV1_ENC_USAGE_REALTIME)
+    av1enc->aom_cfg.g_lag_in_frames = 0;
 
   GST_DEBUG_OBJECT (av1enc, "Calling encoder init with config:");
   gst_av1_enc_debug_encoder_cfg (&av1enc->aom_cfg);
@@ -300,12 +439,25 @@ gst_av1_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
   if (aom_codec_enc_init (&av1enc->encoder, av1enc_class->codec_algo,
           &av1enc->aom_cfg, 0)) {
     gst_av1_codec_error (&av1enc->encoder, "Failed to initialize encoder");
+    g_mutex_unlock (&av1enc->encoder_lock);
+    GST_OBJECT_UNLOCK (av1enc);
     return FALSE;
   }
   av1enc->encoder_inited = TRUE;
 
   GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AOME_SET_CPUUSED, av1enc->cpu_used);
+  GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AV1E_SET_TILE_COLUMNS,
+      av1enc->tile_columns);
+  GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AV1E_SET_TILE_ROWS,
+      av1enc->tile_rows);
+#ifdef AOM_CTRL_AV1E_SET_ROW_MT
+  GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AV1E_SET_ROW_MT,
+      av1enc->row_mt ? 1 : 0);
+#endif
   g_mutex_unlock (&av1enc->encoder_lock);
+  GST_OBJECT_UNLOCK (av1enc);
+
+  gst_av1_enc_set_latency (av1enc);
 
   return TRUE;
 }
@@ -437,6 +589,46 @@ gst_av1_enc_set_property (GObject * object, guint prop_id,
       GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AOME_SET_CPUUSED,
           av1enc->cpu_used);
       break;
+    case PROP_THREADS:
+      av1enc->threads = g_value_get_uint (value);
+      break;
+    case PROP_ROW_MT:
+      av1enc->row_mt = g_value_get_boolean (value);
+#ifdef AOM_CTRL_AV1E_SET_ROW_MT
+      GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AV1E_SET_ROW_MT,
+          av1enc->row_mt ? 1 : 0);
+#endif
+      break;
+    case PROP_TILE_COLUMNS:
+      av1enc->tile_columns = g_value_get_uint (value);
+      GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AV1E_SET_TILE_COLUMNS,
+          av1enc->tile_columns);
+      break;
+    case PROP_TILE_ROWS:
+      av1enc->tile_rows = g_value_get_uint (value);
+      GST_AV1_ENC_APPLY_CODEC_CONTROL (av1enc, AV1E_SET_TILE_ROWS,
+          av1enc->tile_rows);
+      break;
+    case PROP_LAG_IN_FRAMES:
+      av1enc->lag_in_frames = g_value_get_int (value);
+      break;
+    case PROP_END_USAGE:
+      av1enc->end_usage = (enum aom_rc_mode) g_value_get_enum (value);
+      break;
+    case PROP_TARGET_BITRATE:
+      av1enc->target_bitrate = g_value_get_uint (value);
+      /* the bitrate can be changed while encoding */
+      if (av1enc->encoder_inited) {
+        av1enc->aom_cfg.rc_target_bitrate = av1enc->target_bitrate;
+        if (aom_codec_enc_config_set (&av1enc->encoder,
+                &av1enc->aom_cfg) != AOM_CODEC_OK)
+          gst_av1_codec_error (&av1enc->encoder,
+              "Failed to set target bitrate");
+      }
+      break;
+    case PROP_USAGE_PROFILE:
+      av1enc->usage_profile = (GstAV1EncUsageProfile) g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -458,6 +650,30 @@ gst_av1_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_CPU_USED:
       g_value_set_int (value, av1enc->cpu_used);
       break;
+    case PROP_THREADS:
+      g_value_set_uint (value, av1enc->threads);
+      break;
+    case PROP_ROW_MT:
+      g_value_set_boolean (value, av1enc->row_mt);
+      break;
+    case PROP_TILE_COLUMNS:
+      g_value_set_uint (value, av1enc->tile_columns);
+      break;
+    case PROP_TILE_ROWS:
+      g_value_set_uint (value, av1enc->tile_rows);
+      break;
+    case PROP_LAG_IN_FRAMES:
+      g_value_set_int (value, av1enc->lag_in_frames);
+      break;
+    case PROP_END_USAGE:
+      g_value_set_enum (value, av1enc->end_usage);
+      break;
+    case PROP_TARGET_BITRATE:
+      g_value_set_uint (value, av1enc->target_bitrate);
+      break;
+    case PROP_USAGE_PROFILE:
+      g_value_set_enum (value, av1enc->usage_profile);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -49,6 +49,12 @@ G_BEGIN_DECLS
 typedef struct _GstAV1Enc GstAV1Enc;
 typedef struct _GstAV1EncClass GstAV1EncClass;
 
+typedef enum
+{
+  GST_AV1_ENC_USAGE_GOOD_QUALITY = 0,
+  GST_AV1_ENC_USAGE_REALTIME = 1
+} GstAV1EncUsageProfile;
+
 struct _GstAV1Enc
 {
   GstVideoEncoder base_video_encoder;
@@ -56,6 +62,14 @@ struct _GstAV1Enc
   /* properties */
   guint keyframe_dist;
   gint cpu_used;
+  guint threads;
+  gboolean row_mt;
+  guint tile_columns;
+  guint tile_rows;
+  gint lag_in_frames;
+  enum aom_rc_mode end_usage;
+  guint target_bitrate;
+  GstAV1EncUsageProfile usage_profile;
 
   /* state */
   gboolean encoder_inited;
@@ -56,9 +56,19 @@ enum
   PROP_0,
   PROP_ENABLE,
   PROP_EMBEDDEDFONTS,
-  PROP_WAIT_TEXT
+  PROP_WAIT_TEXT,
+  PROP_RENDER_AHEAD
 };
 
+#define DEFAULT_RENDER_AHEAD 0
+
+/* a subtitle image list rendered ahead of time by the worker */
+typedef struct
+{
+  GstClockTime running_time;
+  GstVideoOverlayComposition *composition;
+} GstAssRenderAhead;
+
 /* FIXME: video-blend.c doesn't support formats with more than 8 bit per
  * component (which get unpacked into ARGB64 or AYUV64) yet, such as:
  *  v210, v216, UYVP, GRAY16_LE, GRAY16_BE */
@@ -111,6 +121,9 @@ static void gst_ass_render_finalize (GObject * object);
 static GstStateChangeReturn gst_ass_render_change_state (GstElement * element,
     GstStateChange transition);
 
+static gboolean gst_ass_render_ahead_start (GstAssRender * render);
+static void gst_ass_render_ahead_stop (GstAssRender * render);
+
 #define gst_ass_render_parent_class parent_class
 G_DEFINE_TYPE (GstAssRender, gst_ass_render, GST_TYPE_ELEMENT);
 
@@ -167,6 +180,22 @@ gst_ass_render_class_init (GstAssRenderClass * klass)
           "Whether to wait for subtitles", TRUE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAssRender:render-ahead:
+   *
+   * Number of upcoming video frames to render the subtitles for in a
+   * background thread, so that heavy typesetting doesn't stall the video
+   * streaming thread. 0 renders every frame synchronously. Changes take
+   * effect on the next READY to PAUSED state change.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_RENDER_AHEAD,
+      g_param_spec_uint ("render-ahead", "Render Ahead",
+          "Number of frames to render subtitles ahead for in a background "
+          "thread (0 = disabled)", 0, 64, DEFAULT_RENDER_AHEAD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_ass_render_change_state);
 
@@ -247,6 +276,13 @@ gst_ass_render_init (GstAssRender * render)
   render->enable = TRUE;
   render->embeddedfonts = TRUE;
   render->wait_text = FALSE;
+  render->render_ahead = DEFAULT_RENDER_AHEAD;
+
+  g_mutex_init (&render->ahead_lock);
+  g_cond_init (&render->ahead_cond);
+  g_queue_init (&render->ahead_cache);
+  render->ahead_next = GST_CLOCK_TIME_NONE;
+  render->ahead_step = GST_CLOCK_TIME_NONE;
 
   gst_segment_init (&render->video_segment, GST_FORMAT_TIME);
   gst_segment_init (&render->subtitle_segment, GST_FORMAT_TIME);
@@ -274,6 +310,8 @@ gst_ass_render_finalize (GObject * object)
 
   g_mutex_clear (&render->lock);
   g_cond_clear (&render->cond);
+  g_mutex_clear (&render->ahead_lock);
+  g_cond_clear (&render->ahead_cond);
 
   if (render->ass_track) {
     ass_free_track (render->ass_track);
@@ -301,6 +339,47 @@ gst_ass_render_reset_composition (GstAssRender * render)
   }
 }
 
+static void
+gst_ass_render_ahead_free (GstAssRenderAhead * ahead)
+{
+  if (ahead->composition)
+    gst_video_overlay_composition_unref (ahead->composition);
+  g_slice_free (GstAssRenderAhead, ahead);
+}
+
+/* Drops what was rendered ahead for @running_time and later, the subtitle
+ * events or the timeline changed. Called with the ahead_lock held */
+static void
+gst_ass_render_ahead_invalidate_unlocked (GstAssRender * render,
+    GstClockTime running_time)
+{
+  GstAssRenderAhead *ahead;
+
+  /* anything being rendered right now is thrown away */
+  render->ahead_generation++;
+
+  while ((ahead = g_queue_peek_tail (&render->ahead_cache)) &&
+      ahead->running_time >= running_time) {
+    g_queue_pop_tail (&render->ahead_cache);
+    render->ahead_next = ahead->running_time;
+    gst_ass_render_ahead_free (ahead);
+  }
+
+  if (running_time == 0)
+    render->ahead_next = GST_CLOCK_TIME_NONE;
+
+  g_cond_signal (&render->ahead_cond);
+}
+
+static void
+gst_ass_render_ahead_invalidate (GstAssRender * render,
+    GstClockTime running_time)
+{
+  g_mutex_lock (&render->ahead_lock);
+  gst_ass_render_ahead_invalidate_unlocked (render, running_time);
+  g_mutex_unlock (&render->ahead_lock);
+}
+
 static void
 gst_ass_render_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -321,6 +400,9 @@ gst_ass_render_set_property (GObject * object, guint prop_id,
     case PROP_WAIT_TEXT:
       render->wait_text = g_value_get_boolean (value);
       break;
+    case PROP_RENDER_AHEAD:
+      render->render_ahead = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -345,6 +427,9 @@ gst_ass_render_get_property (GObject * object, guint prop_id,
     case PROP_WAIT_TEXT:
       g_value_set_boolean (value, render->wait_text);
       break;
+    case PROP_RENDER_AHEAD:
+      g_value_set_uint (value, render->render_ahead);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -380,6 +465,7 @@ gst_ass_render_change_state (GstElement * element, GstStateChange transition)
       render->video_flushing = TRUE;
       gst_ass_render_pop_text (render);
       GST_ASS_RENDER_UNLOCK (render);
+      gst_ass_render_ahead_stop (render);
       break;
     default:
       break;
@@ -398,6 +484,9 @@ gst_ass_render_change_state (GstElement * element, GstStateChange transition)
       render->track_init_ok = FALSE;
       render->renderer_init_ok = FALSE;
       gst_ass_render_reset_composition (render);
+      if (render->last_rendered)
+        gst_video_overlay_composition_unref (render->last_rendered);
+      render->last_rendered = NULL;
       g_mutex_unlock (&render->ass_mutex);
       break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
@@ -409,6 +498,8 @@ gst_ass_render_change_state (GstElement * element, GstStateChange transition)
       gst_segment_init (&render->video_segment, GST_FORMAT_TIME);
       gst_segment_init (&render->subtitle_segment, GST_FORMAT_TIME);
       GST_ASS_RENDER_UNLOCK (render);
+      if (!gst_ass_render_ahead_start (render))
+        return GST_STATE_CHANGE_FAILURE;
       break;
     default:
       break;
@@ -920,8 +1011,13 @@ gst_ass_render_negotiate (GstAssRender * render, GstCaps * caps)
     ass_set_fonts (render->ass_renderer, NULL, "Sans", 1, NULL, 1);
     ass_set_margins (render->ass_renderer, 0, 0, 0, 0);
     ass_set_use_margins (render->ass_renderer, 0);
+    if (render->last_rendered)
+      gst_video_overlay_composition_unref (render->last_rendered);
+    render->last_rendered = NULL;
     g_mutex_unlock (&render->ass_mutex);
 
+    gst_ass_render_ahead_invalidate (render, 0);
+
     render->renderer_init_ok = TRUE;
 
     GST_DEBUG_OBJECT (render, "ass renderer setup complete");
@@ -1049,6 +1145,9 @@ gst_ass_render_process_text (GstAssRender * render, GstBuffer * buffer,
       pts_start, pts_end);
   g_mutex_unlock (&render->ass_mutex);
 
+  /* the new events only show from their start on */
+  gst_ass_render_ahead_invalidate (render, running_time);
+
   gst_buffer_unmap (buffer, &map);
 }
 
@@ -1125,6 +1224,175 @@ gst_ass_render_composite_overlay (GstAssRender * render, ASS_Image * images)
   return composition;
 }
 
+/* Must be called with the ass_mutex held. libass only tells whether the
+ * images changed since its previous call, so the composition made from
+ * that call is kept and handed out again while nothing changes */
+static GstVideoOverlayComposition *
+gst_ass_render_render_frame (GstAssRender * render, GstClockTime running_time)
+{
+  ASS_Image *ass_image;
+  gint changed = 0;
+
+  /* libass needs timestamps in ms */
+  ass_image = ass_render_frame (render->ass_renderer, render->ass_track,
+      running_time / GST_MSECOND, &changed);
+
+  if ((!ass_image || changed) && render->last_rendered) {
+    GST_DEBUG_OBJECT (render, "release overlay (changed %d)", changed);
+    gst_video_overlay_composition_unref (render->last_rendered);
+    render->last_rendered = NULL;
+  }
+
+  if (!ass_image)
+    return NULL;
+
+  if (!render->last_rendered)
+    render->last_rendered = gst_ass_render_composite_overlay (render,
+        ass_image);
+
+  return render->last_rendered ?
+      gst_video_overlay_composition_ref (render->last_rendered) : NULL;
+}
+
+static gpointer
+gst_ass_render_ahead_thread (GstAssRender * render)
+{
+  g_mutex_lock (&render->ahead_lock);
+  while (!render->ahead_stop) {
+    GstVideoOverlayComposition *composition = NULL;
+    GstAssRenderAhead *ahead;
+    GstClockTime running_time;
+    guint generation;
+
+    if (!GST_CLOCK_TIME_IS_VALID (render->ahead_next) ||
+        g_queue_get_length (&render->ahead_cache) >= render->render_ahead) {
+      g_cond_wait (&render->ahead_cond, &render->ahead_lock);
+      continue;
+    }
+
+    running_time = render->ahead_next;
+    generation = render->ahead_generation;
+    g_mutex_unlock (&render->ahead_lock);
+
+    g_mutex_lock (&render->ass_mutex);
+    if (render->ass_track && render->renderer_init_ok)
+      composition = gst_ass_render_render_frame (render, running_time);
+    g_mutex_unlock (&render->ass_mutex);
+
+    g_mutex_lock (&render->ahead_lock);
+    if (generation != render->ahead_generation) {
+      /* invalidated while rendering */
+      if (composition)
+        gst_video_overlay_composition_unref (composition);
+      continue;
+    }
+
+    GST_LOG_OBJECT (render, "rendered ahead for %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (running_time));
+
+    ahead = g_slice_new (GstAssRenderAhead);
+    ahead->running_time = running_time;
+    ahead->composition = composition;
+    g_queue_push_tail (&render->ahead_cache, ahead);
+    render->ahead_next = running_time + render->ahead_step;
+  }
+  g_mutex_unlock (&render->ahead_lock);
+
+  return NULL;
+}
+
+static gboolean
+gst_ass_render_ahead_start (GstAssRender * render)
+{
+  GError *error = NULL;
+
+  if (render->render_ahead == 0)
+    return TRUE;
+
+  render->ahead_stop = FALSE;
+  render->ahead_next = GST_CLOCK_TIME_NONE;
+  render->ahead_step = GST_CLOCK_TIME_NONE;
+  render->ahead_thread = g_thread_try_new ("assrender-ahead",
+      (GThreadFunc) gst_ass_render_ahead_thread, render, &error);
+  if (!render->ahead_thread) {
+    GST_ELEMENT_ERROR (render, RESOURCE, FAILED,
+        ("Could not start the render-ahead thread"), ("%s", error->message));
+    g_clear_error (&error);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_ass_render_ahead_stop (GstAssRender * render)
+{
+  if (!render->ahead_thread)
+    return;
+
+  g_mutex_lock (&render->ahead_lock);
+  render->ahead_stop = TRUE;
+  gst_ass_render_ahead_invalidate_unlocked (render, 0);
+  g_mutex_unlock (&render->ahead_lock);
+
+  g_thread_join (render->ahead_thread);
+  render->ahead_thread = NULL;
+}
+
+/* Takes what was rendered ahead for @running_time, if anything. libass only
+ * has millisecond precision, so anything within one is as good */
+static gboolean
+gst_ass_render_ahead_take (GstAssRender * render, GstClockTime running_time,
+    GstVideoOverlayComposition ** composition)
+{
+  GstAssRenderAhead *ahead;
+  gboolean ret = FALSE;
+
+  g_mutex_lock (&render->ahead_lock);
+  while ((ahead = g_queue_peek_head (&render->ahead_cache))) {
+    if (ahead->running_time + GST_MSECOND <= running_time) {
+      /* too old */
+      g_queue_pop_head (&render->ahead_cache);
+      gst_ass_render_ahead_free (ahead);
+      continue;
+    }
+
+    if (ahead->running_time < running_time + GST_MSECOND) {
+      g_queue_pop_head (&render->ahead_cache);
+      *composition = ahead->composition;
+      ahead->composition = NULL;
+      gst_ass_render_ahead_free (ahead);
+      ret = TRUE;
+    }
+    break;
+  }
+  g_cond_signal (&render->ahead_cond);
+  g_mutex_unlock (&render->ahead_lock);
+
+  return ret;
+}
+
+/* Tells the worker the next frame is expected at @next_running_time, one
+ * @step after the previous one */
+static void
+gst_ass_render_ahead_schedule (GstAssRender * render,
+    GstClockTime next_running_time, GstClockTime step)
+{
+  g_mutex_lock (&render->ahead_lock);
+  render->ahead_step = step;
+  /* restart from the actual frame when the predictions went off, after
+   * a framerate change or a dropped frame */
+  if (g_queue_is_empty (&render->ahead_cache) &&
+      (!GST_CLOCK_TIME_IS_VALID (render->ahead_next) ||
+          ABS (GST_CLOCK_DIFF (render->ahead_next,
+                  next_running_time)) >= step)) {
+    render->ahead_generation++;
+    render->ahead_next = next_running_time;
+  }
+  g_cond_signal (&render->ahead_cond);
+  g_mutex_unlock (&render->ahead_lock);
+}
+
 static gboolean
 gst_ass_render_push_frame (GstAssRender * render, GstBuffer * video_frame)
 {
@@ -1162,7 +1430,6 @@ gst_ass_render_chain_video (GstPad * pad, GstObject * parent,
   GstFlowReturn ret = GST_FLOW_OK;
   gboolean in_seg = FALSE;
   guint64 start, stop, clip_start = 0, clip_stop = 0;
-  ASS_Image *ass_image;
 
   if (gst_pad_check_reconfigure (render->srcpad)) {
     if (!gst_ass_render_negotiate (render, NULL)) {
@@ -1240,8 +1507,7 @@ wait_for_text_buf:
       GstClockTime text_running_time = GST_CLOCK_TIME_NONE;
       GstClockTime text_running_time_end = GST_CLOCK_TIME_NONE;
       GstClockTime vid_running_time, vid_running_time_end;
-      gdouble timestamp;
-      gint changed = 0;
+      GstVideoOverlayComposition *composition = NULL;
 
       /* if the text buffer isn't stamped right, pop it off the
        * queue and display it for the current video frame only */
@@ -1296,26 +1562,23 @@ wait_for_text_buf:
 
       GST_ASS_RENDER_UNLOCK (render);
 
-      /* libass needs timestamps in ms */
-      timestamp = vid_running_time / GST_MSECOND;
-
-      g_mutex_lock (&render->ass_mutex);
-      ass_image = ass_render_frame (render->ass_renderer, render->ass_track,
-          timestamp, &changed);
-      g_mutex_unlock (&render->ass_mutex);
-
-      if ((!ass_image || changed) && render->composition) {
-        GST_DEBUG_OBJECT (render, "release overlay (changed %d)", changed);
-        gst_ass_render_reset_composition (render);
+      if (!render->ahead_thread ||
+          !gst_ass_render_ahead_take (render, vid_running_time, &composition)) {
+        g_mutex_lock (&render->ass_mutex);
+        composition = gst_ass_render_render_frame (render, vid_running_time);
+        g_mutex_unlock (&render->ass_mutex);
       }
 
-      if (ass_image != NULL) {
-        if (!render->composition)
-          render->composition = gst_ass_render_composite_overlay (render,
-              ass_image);
-      } else {
+      gst_ass_render_reset_composition (render);
+      render->composition = composition;
+      if (!composition)
         GST_DEBUG_OBJECT (render, "nothing to render right now");
-      }
+
+      /* libass can't tell apart frames less than a millisecond apart */
+      if (render->ahead_thread &&
+          vid_running_time_end - vid_running_time >= GST_MSECOND)
+        gst_ass_render_ahead_schedule (render, vid_running_time_end,
+            vid_running_time_end - vid_running_time);
 
       /* Push the video frame */
       ret = gst_ass_render_push_frame (render, buffer);
@@ -1627,6 +1890,7 @@ gst_ass_render_event_video (GstPad * pad, GstObject * parent, GstEvent * event)
             &render->video_segment);
 
         render->video_segment = segment;
+        gst_ass_render_ahead_invalidate (render, 0);
 
         GST_DEBUG_OBJECT (render, "VIDEO SEGMENT after: %" GST_SEGMENT_FORMAT,
             &render->video_segment);
@@ -1807,6 +2071,7 @@ gst_ass_render_event_text (GstPad * pad, GstObject * parent, GstEvent * event)
         GST_DEBUG_OBJECT (render, "done flushing");
       }
       g_mutex_unlock (&render->ass_mutex);
+      gst_ass_render_ahead_invalidate (render, 0);
       GST_ASS_RENDER_LOCK (render);
       render->subtitle_flushing = TRUE;
       GST_ASS_RENDER_BROADCAST (render);
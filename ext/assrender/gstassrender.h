@@ -56,6 +56,7 @@ struct _GstAssRender
   /* properties */
   gboolean enable, embeddedfonts;
   gboolean wait_text;
+  guint render_ahead;
 
   /* <private> */
   GMutex lock;
@@ -81,6 +82,19 @@ struct _GstAssRender
   gboolean renderer_init_ok, track_init_ok;
   gboolean need_process;
 
+  /* the composition made from the last ass_render_frame() call, protected by
+   * the ass_mutex */
+  GstVideoOverlayComposition *last_rendered;
+
+  /* render-ahead worker, protected by the ahead_lock */
+  GThread *ahead_thread;
+  GMutex ahead_lock;
+  GCond ahead_cond;
+  GQueue ahead_cache;
+  GstClockTime ahead_next, ahead_step;
+  guint ahead_generation;
+  gboolean ahead_stop;
+
   /* overlay stuff */
   GstVideoOverlayComposition *composition;
   guint window_width, window_height;
@@ -74,6 +74,27 @@
 #define DSCP_MIN                       0
 #define DSCP_MAX                       63
 
+/* How long the shared transfer thread waits for socket activity before
+ * picking up new, resumed or cancelled transfers */
+#define SHARED_MULTI_WAIT_MS           10
+
+/* The multi handle shared by all sinks with use_shared_multi set, driven by
+ * a single thread so the transfers can share connections, and multiplex
+ * them with HTTP/2 */
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  GCond done_cond;
+  guint refcount;
+  GThread *thread;
+  CURLM *multi_handle;
+  GList *pending;               /* Sinks whose handle is to be added */
+  gboolean running;
+} GstCurlSharedMulti;
+
+static GstCurlSharedMulti shared_multi;
+
 
 /* Plugin specific settings */
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -145,6 +166,8 @@ static void gst_curl_base_sink_wait_for_response (GstCurlBaseSink * sink);
 static void gst_curl_base_sink_got_response_notify (GstCurlBaseSink * sink);
 
 static void handle_transfer (GstCurlBaseSink * sink);
+static void gst_curl_base_sink_shared_transfer (GstCurlBaseSink * sink);
+static void gst_curl_base_sink_shared_multi_unref (void);
 static size_t transfer_data_buffer (void *curl_ptr, TransferBuffer * buf,
     size_t max_bytes_to_send, guint * last_chunk);
 
@@ -255,6 +278,8 @@ gst_curl_base_sink_init (GstCurlBaseSink * sink)
   sink->error = NULL;
   sink->flow_ret = GST_FLOW_OK;
   sink->is_live = FALSE;
+  sink->use_shared_multi = FALSE;
+  sink->shared_multi_ref = FALSE;
 }
 
 static void
@@ -292,6 +317,7 @@ gst_curl_base_sink_transfer_thread_notify_unlocked (GstCurlBaseSink * sink)
   sink->transfer_cond->data_sent = FALSE;
   sink->transfer_cond->wait_for_response = TRUE;
   g_cond_signal (&sink->transfer_cond->cond);
+  g_atomic_int_set (&sink->shared_resume, 1);
 }
 
 void
@@ -301,6 +327,7 @@ gst_curl_base_sink_transfer_thread_close (GstCurlBaseSink * sink)
   GST_LOG_OBJECT (sink, "setting transfer thread close flag");
   sink->transfer_thread_close = TRUE;
   g_cond_signal (&sink->transfer_cond->cond);
+  g_atomic_int_set (&sink->shared_resume, 1);
   GST_OBJECT_UNLOCK (sink);
 
   if (sink->transfer_thread != NULL) {
@@ -446,6 +473,7 @@ gst_curl_base_sink_start (GstBaseSink * bsink)
   sink->transfer_thread_close = FALSE;
   sink->new_file = TRUE;
   sink->flow_ret = GST_FLOW_OK;
+  g_atomic_int_set (&sink->shared_cancel, 0);
 
   if ((sink->fdset = gst_poll_new (TRUE)) == NULL) {
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_READ_WRITE,
@@ -469,6 +497,11 @@ gst_curl_base_sink_stop (GstBaseSink * bsink)
     sink->fdset = NULL;
   }
 
+  if (sink->shared_multi_ref) {
+    gst_curl_base_sink_shared_multi_unref ();
+    sink->shared_multi_ref = FALSE;
+  }
+
   return TRUE;
 }
 
@@ -481,6 +514,7 @@ gst_curl_base_sink_unlock (GstBaseSink * bsink)
 
   GST_LOG_OBJECT (sink, "Flushing");
   gst_poll_set_flushing (sink->fdset, TRUE);
+  g_atomic_int_set (&sink->shared_cancel, 1);
 
   return TRUE;
 }
@@ -494,6 +528,7 @@ gst_curl_base_sink_unlock_stop (GstBaseSink * bsink)
 
   GST_LOG_OBJECT (sink, "No longer flushing");
   gst_poll_set_flushing (sink->fdset, FALSE);
+  g_atomic_int_set (&sink->shared_cancel, 0);
 
   return TRUE;
 }
@@ -819,6 +854,18 @@ gst_curl_base_sink_transfer_read_cb (void *curl_ptr, size_t size, size_t nmemb,
   /* wait for data to come available, if new file or thread close is set
    * then zero will be returned to indicate end of current transfer */
   GST_OBJECT_LOCK (sink);
+
+  /* the shared transfer thread drives the other sinks' transfers as well,
+   * so pause this one instead of waiting until the notify functions ask for
+   * it to be resumed */
+  if (sink->use_shared_multi && !sink->is_live &&
+      !sink->transfer_cond->data_available &&
+      !sink->transfer_thread_close && !sink->new_file) {
+    GST_LOG ("pausing transfer until data is available");
+    sink->shared_paused = TRUE;
+    GST_OBJECT_UNLOCK (sink);
+    return CURL_READFUNC_PAUSE;
+  }
   if (gst_curl_base_sink_wait_for_data_unlocked (sink) == FALSE) {
 
     if (gst_curl_base_sink_has_buffered_data_unlocked (sink) &&
@@ -1194,16 +1241,22 @@ gst_curl_base_sink_transfer_thread_func (gpointer data)
           }
           GST_OBJECT_UNLOCK (sink);
         }
-        GST_LOG ("adding handle");
-        curl_multi_add_handle (sink->multi_handle, sink->curl);
+        if (!sink->use_shared_multi) {
+          GST_LOG ("adding handle");
+          curl_multi_add_handle (sink->multi_handle, sink->curl);
+        }
       }
 
       /* Start driving the transfer. */
-      klass->handle_transfer (sink);
+      if (sink->use_shared_multi && !gst_curl_base_sink_is_live (sink)) {
+        gst_curl_base_sink_shared_transfer (sink);
+      } else {
+        klass->handle_transfer (sink);
+      }
 
       /* easy handle will be possibly re-used for next transfer, thus it needs
        * to be removed from the multi stack and re-added again */
-      if (!gst_curl_base_sink_is_live (sink)) {
+      if (!gst_curl_base_sink_is_live (sink) && !sink->use_shared_multi) {
         GST_LOG ("removing handle");
         curl_multi_remove_handle (sink->multi_handle, sink->curl);
       }
@@ -1242,6 +1295,219 @@ done:
   return NULL;
 }
 
+static void
+gst_curl_base_sink_shared_transfer_done (GstCurlBaseSink * sink,
+    CURLcode code)
+{
+  curl_multi_remove_handle (shared_multi.multi_handle, sink->curl);
+
+  g_mutex_lock (&shared_multi.lock);
+  sink->shared_done = TRUE;
+  sink->shared_result = code;
+  g_cond_broadcast (&shared_multi.done_cond);
+  g_mutex_unlock (&shared_multi.lock);
+}
+
+static gpointer
+gst_curl_base_sink_shared_multi_thread_func (gpointer data)
+{
+  GList *active = NULL, *l, *next;
+  CURLMsg *msg;
+  gint msgs_left, running_handles;
+
+  g_mutex_lock (&shared_multi.lock);
+  while (shared_multi.running) {
+    if (shared_multi.pending == NULL && active == NULL) {
+      g_cond_wait (&shared_multi.cond, &shared_multi.lock);
+      continue;
+    }
+
+    for (l = shared_multi.pending; l != NULL; l = l->next) {
+      GstCurlBaseSink *sink = l->data;
+
+      GST_LOG_OBJECT (sink, "adding handle to the shared multi handle");
+      sink->shared_paused = FALSE;
+      curl_multi_add_handle (shared_multi.multi_handle, sink->curl);
+    }
+    active = g_list_concat (active, shared_multi.pending);
+    shared_multi.pending = NULL;
+    g_mutex_unlock (&shared_multi.lock);
+
+    /* only this thread may touch the easy handles while they are added */
+    for (l = active; l != NULL; l = next) {
+      GstCurlBaseSink *sink = l->data;
+
+      next = l->next;
+      if (g_atomic_int_get (&sink->shared_cancel)) {
+        GST_DEBUG_OBJECT (sink, "transfer cancelled");
+        active = g_list_delete_link (active, l);
+        gst_curl_base_sink_shared_transfer_done (sink,
+            CURLE_ABORTED_BY_CALLBACK);
+      } else if (sink->shared_paused &&
+          g_atomic_int_compare_and_exchange (&sink->shared_resume, 1, 0)) {
+        GST_LOG_OBJECT (sink, "resuming transfer");
+        sink->shared_paused = FALSE;
+        curl_easy_pause (sink->curl, CURLPAUSE_CONT);
+      }
+    }
+
+    curl_multi_perform (shared_multi.multi_handle, &running_handles);
+
+    while ((msg = curl_multi_info_read (shared_multi.multi_handle,
+                &msgs_left))) {
+      GstCurlBaseSink *sink = NULL;
+
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char **) &sink);
+      if (sink == NULL || g_list_find (active, sink) == NULL)
+        continue;
+
+      GST_DEBUG_OBJECT (sink, "transfer done (%s-%d)",
+          curl_easy_strerror (msg->data.result), msg->data.result);
+      active = g_list_remove (active, sink);
+      gst_curl_base_sink_shared_transfer_done (sink, msg->data.result);
+    }
+
+    if (active != NULL) {
+      curl_multi_wait (shared_multi.multi_handle, NULL, 0,
+          SHARED_MULTI_WAIT_MS, NULL);
+    }
+
+    g_mutex_lock (&shared_multi.lock);
+  }
+  g_mutex_unlock (&shared_multi.lock);
+
+  /* all the sinks have stopped, so only their finished transfers are left */
+  g_list_free (active);
+
+  return NULL;
+}
+
+static gboolean
+gst_curl_base_sink_shared_multi_ref (GstCurlBaseSink * sink)
+{
+  gboolean ret = TRUE;
+
+  g_mutex_lock (&shared_multi.lock);
+  if (shared_multi.refcount == 0) {
+    GError *error = NULL;
+
+    if ((shared_multi.multi_handle = curl_multi_init ()) == NULL) {
+      sink->error = g_strdup ("failed to init shared curl multi handle");
+      ret = FALSE;
+      goto done;
+    }
+#ifdef CURLPIPE_MULTIPLEX
+    curl_multi_setopt (shared_multi.multi_handle, CURLMOPT_PIPELINING,
+        CURLPIPE_MULTIPLEX);
+#endif
+
+    shared_multi.running = TRUE;
+    shared_multi.thread = g_thread_try_new ("Curl Shared Transfer Thread",
+        gst_curl_base_sink_shared_multi_thread_func, NULL, &error);
+    if (shared_multi.thread == NULL) {
+      sink->error = g_strdup_printf ("could not create thread %s",
+          error ? error->message : "for unknown reason");
+      g_clear_error (&error);
+      curl_multi_cleanup (shared_multi.multi_handle);
+      shared_multi.multi_handle = NULL;
+      ret = FALSE;
+      goto done;
+    }
+  }
+  shared_multi.refcount++;
+
+done:
+  g_mutex_unlock (&shared_multi.lock);
+
+  return ret;
+}
+
+static void
+gst_curl_base_sink_shared_multi_unref (void)
+{
+  GThread *thread = NULL;
+
+  g_mutex_lock (&shared_multi.lock);
+  if (--shared_multi.refcount == 0) {
+    shared_multi.running = FALSE;
+    thread = shared_multi.thread;
+    shared_multi.thread = NULL;
+    g_cond_signal (&shared_multi.cond);
+  }
+  g_mutex_unlock (&shared_multi.lock);
+
+  if (thread != NULL) {
+    g_thread_join (thread);
+    curl_multi_cleanup (shared_multi.multi_handle);
+    shared_multi.multi_handle = NULL;
+  }
+}
+
+/* Counterpart of handle_transfer() for transfers on the shared multi handle,
+ * hands the easy handle over to the shared thread and waits for the transfer
+ * to complete */
+static void
+gst_curl_base_sink_shared_transfer (GstCurlBaseSink * sink)
+{
+  GstFlowReturn retval;
+  CURLcode e_code;
+
+  if (!sink->shared_multi_ref) {
+    if (!gst_curl_base_sink_shared_multi_ref (sink)) {
+      retval = GST_FLOW_ERROR;
+      goto fail;
+    }
+    sink->shared_multi_ref = TRUE;
+  }
+
+  GST_DEBUG_OBJECT (sink, "handling transfer on the shared multi handle");
+
+  curl_easy_setopt (sink->curl, CURLOPT_PRIVATE, sink);
+
+  g_mutex_lock (&shared_multi.lock);
+  sink->shared_done = FALSE;
+  shared_multi.pending = g_list_append (shared_multi.pending, sink);
+  g_cond_signal (&shared_multi.cond);
+  while (!sink->shared_done) {
+    g_cond_wait (&shared_multi.done_cond, &shared_multi.lock);
+  }
+  e_code = sink->shared_result;
+  g_mutex_unlock (&shared_multi.lock);
+
+  if (e_code == CURLE_ABORTED_BY_CALLBACK &&
+      g_atomic_int_get (&sink->shared_cancel)) {
+    GST_DEBUG_OBJECT (sink, "transfer stopped");
+    retval = GST_FLOW_EOS;
+
+    GST_OBJECT_LOCK (sink);
+    if (gst_curl_base_sink_has_buffered_data_unlocked (sink))
+      GST_WARNING_OBJECT (sink,
+          "discarding render data due to thread close flag");
+    GST_OBJECT_UNLOCK (sink);
+
+    goto fail;
+  } else if (e_code != CURLE_OK) {
+    sink->error = g_strdup_printf ("failed to transfer data: %s",
+        curl_easy_strerror (e_code));
+    retval = GST_FLOW_ERROR;
+    goto fail;
+  }
+
+  gst_curl_base_sink_got_response_notify (sink);
+
+  return;
+
+fail:
+  GST_OBJECT_LOCK (sink);
+  if (sink->flow_ret == GST_FLOW_OK) {
+    sink->flow_ret = retval;
+  }
+  GST_OBJECT_UNLOCK (sink);
+}
+
 static gboolean
 gst_curl_base_sink_transfer_setup_unlocked (GstCurlBaseSink * sink)
 {
@@ -1320,6 +1586,7 @@ gst_curl_base_sink_new_file_notify_unlocked (GstCurlBaseSink * sink)
   GST_LOG ("new file name");
   sink->new_file = TRUE;
   g_cond_signal (&sink->transfer_cond->cond);
+  g_atomic_int_set (&sink->shared_resume, 1);
 }
 
 static void
@@ -83,6 +83,16 @@ struct _GstCurlBaseSink
   gboolean transfer_thread_close;
   gboolean new_file;
   gboolean is_live;
+
+  /* Set by subclasses to run the transfers on the process-wide multi handle
+   * instead of the sink's own one */
+  gboolean use_shared_multi;
+  gboolean shared_multi_ref;
+  gboolean shared_done;
+  CURLcode shared_result;
+  gboolean shared_paused;
+  gint shared_resume;
+  gint shared_cancel;
 };
 
 struct _GstCurlBaseSinkClass
@@ -133,6 +133,15 @@
 #define GSTCURL_DEFAULT_CONNECTIONS_SERVER 5
 #define GSTCURL_DEFAULT_CONNECTIONS_PROXY 30
 #define GSTCURL_DEFAULT_CONNECTIONS_GLOBAL 255
+#define GSTCURL_DEFAULT_READ_AHEAD (4 * 1024 * 1024)
+#define GSTCURL_DEFAULT_BLOCKSIZE CURL_MAX_WRITE_SIZE
+#define GSTCURL_MIN_CONNECTIONS 1
+#define GSTCURL_MAX_CONNECTIONS 16
+#define GSTCURL_DEFAULT_CONNECTIONS 1
+/* Size of each byte range when a transfer is split over several connections */
+#define GSTCURL_RANGE_SIZE (2 * 1024 * 1024)
+/* How often the curl loop checks whether a paused transfer can resume */
+#define GSTCURL_PAUSED_POLL_INTERVAL_USEC 5000
 #define GSTCURL_INFO_RESPONSE(x) ((x >= 100) && (x <= 199))
 #define GSTCURL_SUCCESS_RESPONSE(x) ((x >= 200) && (x <=299))
 #define GSTCURL_REDIRECT_RESPONSE(x) ((x >= 300) && (x <= 399))
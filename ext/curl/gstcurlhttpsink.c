@@ -38,6 +38,15 @@
  *     content-type=image/jpeg  \
  *     use-content-length=false
  * ]|
+ *
+ * Stream segments to an HTTP/2 ingest point with chunked PUT requests, all
+ * the sinks of the process sharing one connection.
+ *
+ * |[
+ * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! mpegtsmux ! \
+ *     curlhttpsink location=https://ingest.example.com/live/segment.ts \
+ *     http-method=put shared-connections=true
+ * ]|
  */
 
 #ifdef HAVE_CONFIG_H
@@ -73,6 +82,8 @@
 #define DEFAULT_TIMEOUT                30
 #define DEFAULT_PROXY_PORT             3128
 #define DEFAULT_USE_CONTENT_LENGTH     FALSE
+#define DEFAULT_METHOD                 GST_CURL_HTTP_SINK_METHOD_POST
+#define DEFAULT_SHARED_CONNECTIONS     FALSE
 
 #define RESPONSE_CONNECT_PROXY         200
 
@@ -88,9 +99,28 @@ enum
   PROP_PROXY_USER_NAME,
   PROP_PROXY_USER_PASSWD,
   PROP_USE_CONTENT_LENGTH,
-  PROP_CONTENT_TYPE
+  PROP_CONTENT_TYPE,
+  PROP_METHOD,
+  PROP_SHARED_CONNECTIONS
 };
 
+#define GST_TYPE_CURL_HTTP_SINK_METHOD (gst_curl_http_sink_method_get_type ())
+static GType
+gst_curl_http_sink_method_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (!gtype) {
+    static const GEnumValue methods[] = {
+      {GST_CURL_HTTP_SINK_METHOD_POST, "POST", "post"},
+      {GST_CURL_HTTP_SINK_METHOD_PUT, "PUT", "put"},
+      {0, NULL, NULL}
+    };
+    gtype = g_enum_register_static ("GstCurlHttpSinkMethod", methods);
+  }
+  return gtype;
+}
+
 
 /* Object class function declarations */
 
@@ -173,6 +203,37 @@ gst_curl_http_sink_class_init (GstCurlHttpSinkClass * klass)
       g_param_spec_string ("content-type", "Content type",
           "The mime type of the body of the request", NULL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCurlHttpSink:http-method:
+   *
+   * The request used to upload the data. Without use-content-length the
+   * body is sent with chunked encoding as it is rendered, so a PUT can
+   * stream a segment while it is being produced.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_METHOD,
+      g_param_spec_enum ("http-method", "HTTP method",
+          "The HTTP method used for the upload",
+          GST_TYPE_CURL_HTTP_SINK_METHOD, DEFAULT_METHOD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCurlHttpSink:shared-connections:
+   *
+   * Run the uploads on a multi handle shared by all the sinks of the
+   * process, so connections to the same server are reused across sinks and
+   * multiplexed over HTTP/2 when the server supports it. Not used through
+   * a proxy.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SHARED_CONNECTIONS,
+      g_param_spec_boolean ("shared-connections", "Shared connections",
+          "Share connections with the other sinks of the process",
+          DEFAULT_SHARED_CONNECTIONS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -188,6 +249,8 @@ gst_curl_http_sink_init (GstCurlHttpSink * sink)
   sink->use_proxy = FALSE;
   sink->proxy_conn_established = FALSE;
   sink->proxy_resp = -1;
+  sink->method = DEFAULT_METHOD;
+  sink->shared_connections = DEFAULT_SHARED_CONNECTIONS;
 }
 
 static void
@@ -253,6 +316,15 @@ gst_curl_http_sink_set_property (GObject * object, guint prop_id,
         sink->content_type = g_value_dup_string (value);
         GST_DEBUG_OBJECT (sink, "content type set to %s", sink->content_type);
         break;
+      case PROP_METHOD:
+        sink->method = g_value_get_enum (value);
+        GST_DEBUG_OBJECT (sink, "method set to %d", sink->method);
+        break;
+      case PROP_SHARED_CONNECTIONS:
+        sink->shared_connections = g_value_get_boolean (value);
+        GST_DEBUG_OBJECT (sink, "shared_connections set to %d",
+            sink->shared_connections);
+        break;
       default:
         GST_DEBUG_OBJECT (sink, "invalid property id %d", prop_id);
         break;
@@ -308,6 +380,12 @@ gst_curl_http_sink_get_property (GObject * object, guint prop_id,
     case PROP_CONTENT_TYPE:
       g_value_set_string (value, sink->content_type);
       break;
+    case PROP_METHOD:
+      g_value_set_enum (value, sink->method);
+      break;
+    case PROP_SHARED_CONNECTIONS:
+      g_value_set_boolean (value, sink->shared_connections);
+      break;
     default:
       GST_DEBUG_OBJECT (sink, "invalid property id");
       break;
@@ -384,11 +462,38 @@ gst_curl_http_sink_set_options_unlocked (GstCurlBaseSink * bcsink)
     }
   }
 
-  res = curl_easy_setopt (bcsink->curl, CURLOPT_POST, 1L);
-  if (res != CURLE_OK) {
-    bcsink->error = g_strdup_printf ("failed to set HTTP POST: %s",
-        curl_easy_strerror (res));
-    return FALSE;
+  if (sink->method == GST_CURL_HTTP_SINK_METHOD_PUT) {
+    res = curl_easy_setopt (bcsink->curl, CURLOPT_UPLOAD, 1L);
+    if (res != CURLE_OK) {
+      bcsink->error = g_strdup_printf ("failed to set HTTP PUT: %s",
+          curl_easy_strerror (res));
+      return FALSE;
+    }
+  } else {
+    res = curl_easy_setopt (bcsink->curl, CURLOPT_POST, 1L);
+    if (res != CURLE_OK) {
+      bcsink->error = g_strdup_printf ("failed to set HTTP POST: %s",
+          curl_easy_strerror (res));
+      return FALSE;
+    }
+  }
+
+  /* the proxy connection setup needs to drive its own transfer */
+  bcsink->use_shared_multi = sink->shared_connections && sink->proxy == NULL;
+  if (bcsink->use_shared_multi) {
+#if LIBCURL_VERSION_NUM >= 0x072f00
+    res = curl_easy_setopt (bcsink->curl, CURLOPT_HTTP_VERSION,
+        (long) CURL_HTTP_VERSION_2TLS);
+    if (res != CURLE_OK) {
+      GST_DEBUG_OBJECT (sink, "HTTP/2 not supported: %s",
+          curl_easy_strerror (res));
+    }
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    /* rather wait for a connection that can be multiplexed than opening
+     * a new one */
+    curl_easy_setopt (bcsink->curl, CURLOPT_PIPEWAIT, 1L);
+#endif
   }
 
   /* FIXME: check user & passwd */
@@ -39,6 +39,12 @@ G_BEGIN_DECLS
 typedef struct _GstCurlHttpSink GstCurlHttpSink;
 typedef struct _GstCurlHttpSinkClass GstCurlHttpSinkClass;
 
+typedef enum
+{
+  GST_CURL_HTTP_SINK_METHOD_POST,
+  GST_CURL_HTTP_SINK_METHOD_PUT
+} GstCurlHttpSinkMethod;
+
 struct _GstCurlHttpSink
 {
   GstCurlTlsSink parent;
@@ -56,6 +62,8 @@ struct _GstCurlHttpSink
   gboolean proxy_auth;
   gboolean proxy_conn_established;
   glong proxy_resp;
+  GstCurlHttpSinkMethod method;
+  gboolean shared_connections;
 };
 
 struct _GstCurlHttpSinkClass
@@ -138,6 +138,24 @@ static size_t gst_curl_http_src_get_header (void *header, size_t size,
 static size_t gst_curl_http_src_get_chunks (void *chunk, size_t size,
     size_t nmemb, void *src);
 static void gst_curl_http_src_request_remove (GstCurlHttpSrc * src);
+static gboolean gst_curl_http_src_resume_paused (GstCurlHttpSrcMultiTaskContext
+    * context);
+static void gst_curl_http_src_body_init (GstCurlHttpSrcBody * body);
+static void gst_curl_http_src_body_flush (GstCurlHttpSrcBody * body);
+static gboolean gst_curl_http_src_body_has_data (GstCurlHttpSrcBody * body);
+static GstBuffer *gst_curl_http_src_body_pop (GstCurlHttpSrcBody * body);
+static gboolean gst_curl_http_src_body_write (GstCurlHttpSrc * src,
+    GstCurlHttpSrcBody * body, const guint8 * data, size_t len);
+static gboolean gst_curl_http_src_ensure_pool (GstCurlHttpSrc * src);
+static void gst_curl_http_src_schedule_ranges (GstCurlHttpSrc * src);
+static GstFlowReturn gst_curl_http_src_read_range (GstCurlHttpSrc * src,
+    GstBuffer ** outbuf);
+static void gst_curl_http_src_clear_ranges (GstCurlHttpSrc * src);
+static void gst_curl_http_src_add_ranges (GstCurlHttpSrcMultiTaskContext *
+    context);
+static void gst_curl_http_src_remove_ranges (GstCurlHttpSrcMultiTaskContext *
+    context, GstCurlHttpSrc * src);
+static void gst_curl_http_src_range_done (CURL * handle, CURLcode result);
 static char *gst_curl_http_src_strcasestr (const char *haystack,
     const char *needle);
 
@@ -382,6 +400,38 @@ gst_curl_http_src_class_init (GstCurlHttpSrcClass * klass)
           GST_TYPE_CURL_HTTP_VERSION, pref_http_ver,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCurlHttpSrc:read-ahead:
+   *
+   * Number of bytes the curl loop may receive ahead of the streaming thread.
+   * Once that much data is waiting to be pushed the transfer is paused
+   * until downstream catches up. 0 means no limit.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_READ_AHEAD,
+      g_param_spec_uint64 ("read-ahead", "Read-Ahead",
+          "Maximum number of bytes received ahead of downstream (0=unlimited)",
+          0, G_MAXUINT64, GSTCURL_DEFAULT_READ_AHEAD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCurlHttpSrc:connections:
+   *
+   * Number of connections a transfer is split over. With more than one the
+   * body is requested as consecutive byte ranges, several of them in
+   * parallel, which are pushed downstream in order. Servers that don't
+   * support ranges are read over a single connection.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_CONNECTIONS,
+      g_param_spec_uint ("connections", "Connections",
+          "Number of parallel byte range requests used for a transfer",
+          GSTCURL_MIN_CONNECTIONS, GSTCURL_MAX_CONNECTIONS,
+          GSTCURL_DEFAULT_CONNECTIONS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* Add a debugging task so it's easier to debug in the Multi worker thread */
   GST_DEBUG_CATEGORY_INIT (gst_curl_loop_debug, "curl_multi_loop", 0,
       "libcURL loop thread debugging");
@@ -489,6 +539,14 @@ gst_curl_http_src_set_property (GObject * object, guint prop_id,
     case PROP_HTTPVERSION:
       source->preferred_http_version = g_value_get_enum (value);
       break;
+    case PROP_READ_AHEAD:
+      g_mutex_lock (&source->buffer_mutex);
+      source->read_ahead = g_value_get_uint64 (value);
+      g_mutex_unlock (&source->buffer_mutex);
+      break;
+    case PROP_CONNECTIONS:
+      source->connections = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -570,6 +628,12 @@ gst_curl_http_src_get_property (GObject * object, guint prop_id,
     case PROP_HTTPVERSION:
       g_value_set_enum (value, source->preferred_http_version);
       break;
+    case PROP_READ_AHEAD:
+      g_value_set_uint64 (value, source->read_ahead);
+      break;
+    case PROP_CONNECTIONS:
+      g_value_set_uint (value, source->connections);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -611,6 +675,7 @@ gst_curl_http_src_init (GstCurlHttpSrc * source)
 
   gst_caps_replace (&source->caps, NULL);
   gst_base_src_set_automatic_eos (GST_BASE_SRC (source), FALSE);
+  gst_base_src_set_blocksize (GST_BASE_SRC (source), GSTCURL_DEFAULT_BLOCKSIZE);
 
   source->proxy_uri = g_strdup (g_getenv ("http_proxy"));
   source->no_proxy_list = g_strdup (g_getenv ("no_proxy"));
@@ -619,8 +684,15 @@ gst_curl_http_src_init (GstCurlHttpSrc * source)
   g_mutex_init (&source->buffer_mutex);
   g_cond_init (&source->signal);
 
-  source->buffer = NULL;
-  source->buffer_len = 0;
+  source->pool = NULL;
+  source->pool_size = 0;
+  gst_curl_http_src_body_init (&source->body);
+  source->read_ahead = GSTCURL_DEFAULT_READ_AHEAD;
+  source->paused = FALSE;
+  source->connections = GSTCURL_DEFAULT_CONNECTIONS;
+  source->range_total = 0;
+  source->range_next = 0;
+  g_queue_init (&source->ranges);
   source->state = GSTCURL_NONE;
   source->pending_state = GSTCURL_NONE;
   source->status_code = 0;
@@ -764,6 +836,16 @@ gst_curl_http_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 retry:
   if (!src->transfer_begun) {
     GST_DEBUG_OBJECT (src, "Starting new request for URI %s", src->uri);
+    gst_curl_http_src_body_flush (&src->body);
+    gst_curl_http_src_clear_ranges (src);
+    src->paused = FALSE;
+    src->range_total = 0;
+    src->range_next = 0;
+    if (!gst_curl_http_src_ensure_pool (src)) {
+      ret = GST_FLOW_ERROR;
+      goto escape;
+    }
+
     /* Create the Easy Handle and set up the session. */
     src->curl_handle = gst_curl_http_src_create_easy_handle (src);
     if (src->curl_handle == NULL) {
@@ -771,6 +853,15 @@ retry:
       goto escape;
     }
 
+    /* Ask for the first range only, if the server supports ranges the rest
+     * is requested in parallel once the total size is known */
+    if (src->connections > 1) {
+      gchar *range = g_strdup_printf ("0-%u", GSTCURL_RANGE_SIZE - 1);
+
+      gst_curl_setopt_str (src, src->curl_handle, CURLOPT_RANGE, range);
+      g_free (range);
+    }
+
     g_mutex_lock (&klass->multi_task_context.mutex);
 
     if (gst_curl_http_src_add_queue_item (&klass->multi_task_context.queue, src)
@@ -801,16 +892,13 @@ retry:
   }
 
   /* Wait for data to become available, then punt it downstream */
-  while ((src->buffer_len == 0) && (src->state == GSTCURL_OK)) {
+  while (!gst_curl_http_src_body_has_data (&src->body) &&
+      (src->state == GSTCURL_OK)) {
     g_cond_wait (&src->signal, &src->buffer_mutex);
   }
 
   if (src->state == GSTCURL_UNLOCK) {
-    if (src->buffer_len > 0) {
-      g_free (src->buffer);
-      src->buffer = NULL;
-      src->buffer_len = 0;
-    }
+    gst_curl_http_src_body_flush (&src->body);
     ret = GST_FLOW_FLUSHING;
     goto escape;
   }
@@ -840,6 +928,7 @@ retry:
         goto escape;
       }
       GST_INFO_OBJECT (src, "Attempting retry for URI %s", src->uri);
+      gst_curl_http_src_body_flush (&src->body);
       src->state = GSTCURL_NONE;
       src->transfer_begun = FALSE;
       src->status_code = 0;
@@ -856,21 +945,37 @@ retry:
       break;
   }
 
+  if (src->range_total > 0) {
+    gst_curl_http_src_schedule_ranges (src);
+    if (src->state == GSTCURL_UNLOCK) {
+      ret = GST_FLOW_FLUSHING;
+      goto escape;
+    }
+
+    /* The first range is complete, carry on with the following ones */
+    if ((src->state == GSTCURL_DONE) &&
+        !gst_curl_http_src_body_has_data (&src->body) &&
+        !g_queue_is_empty (&src->ranges)) {
+      ret = gst_curl_http_src_read_range (src, outbuf);
+      if (ret != GST_FLOW_EOS) {
+        goto escape;
+      }
+      ret = GST_FLOW_OK;
+    }
+  }
+
   if (((src->state == GSTCURL_OK) || (src->state == GSTCURL_DONE)) &&
-      (src->buffer_len > 0)) {
+      gst_curl_http_src_body_has_data (&src->body)) {
 
-    GST_DEBUG_OBJECT (src, "Pushing %u bytes of transfer for URI %s to pad",
-        src->buffer_len, src->uri);
-    *outbuf = gst_buffer_new_allocate (NULL, src->buffer_len, NULL);
-    gst_buffer_fill (*outbuf, 0, src->buffer, src->buffer_len);
+    *outbuf = gst_curl_http_src_body_pop (&src->body);
 
-    g_free (src->buffer);
-    src->buffer = NULL;
-    src->buffer_len = 0;
+    GST_DEBUG_OBJECT (src, "Pushing %" G_GSIZE_FORMAT " bytes of transfer for "
+        "URI %s to pad", gst_buffer_get_size (*outbuf), src->uri);
     src->data_received = TRUE;
 
     /* ret should still be GST_FLOW_OK */
-  } else if ((src->state == GSTCURL_DONE) && (src->buffer_len == 0)) {
+  } else if ((src->state == GSTCURL_DONE) &&
+      !gst_curl_http_src_body_has_data (&src->body)) {
     GST_INFO_OBJECT (src, "Full body received, signalling EOS for URI %s.",
         src->uri);
     src->state = GSTCURL_NONE;
@@ -1145,6 +1250,10 @@ gst_curl_http_src_handle_response (GstCurlHttpSrc * src)
    */
   if (curl_easy_getinfo (src->curl_handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD,
           &curl_info_dbl) == CURLE_OK) {
+    /* The Content-Length of a partial response is the first range's one */
+    if (src->range_total > 0) {
+      curl_info_dbl = src->range_total;
+    }
     if (curl_info_dbl == -1) {
       GST_WARNING_OBJECT (src,
           "No Content-Length was specified in the response.");
@@ -1318,8 +1427,13 @@ gst_curl_http_src_cleanup_instance (GstCurlHttpSrc * src)
 
   g_cond_clear (&src->signal);
 
-  g_free (src->buffer);
-  src->buffer = NULL;
+  gst_curl_http_src_body_flush (&src->body);
+  gst_curl_http_src_clear_ranges (src);
+  if (src->pool != NULL) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_object_unref (src->pool);
+    src->pool = NULL;
+  }
 
   if (src->http_headers != NULL) {
     gst_structure_free (src->http_headers);
@@ -1364,6 +1478,11 @@ gst_curl_http_src_get_content_length (GstBaseSrc * bsrc, guint64 * size)
     return FALSE;
   }
 
+  if (src->range_total > 0) {
+    *size = src->range_total;
+    return TRUE;
+  }
+
   response_headers = gst_structure_get_value (src->http_headers,
       RESPONSE_HEADERS_NAME);
   if (gst_structure_has_field (gst_value_get_structure (response_headers),
@@ -1470,7 +1589,7 @@ gst_curl_http_src_unlock (GstBaseSrc * bsrc)
 
   g_mutex_lock (&src->buffer_mutex);
   if (src->state != GSTCURL_UNLOCK) {
-    if (src->state == GSTCURL_OK) {
+    if ((src->state == GSTCURL_OK) || !g_queue_is_empty (&src->ranges)) {
       /* A transfer is running, cancel it */
       gst_curl_http_src_request_remove (src);
     }
@@ -1529,7 +1648,7 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
 
   if (context->state == GSTCURL_MULTI_LOOP_STATE_QUEUE_EVENT) {
     GSTCURL_DEBUG_PRINT ("Received a new item on the queue!");
-    if (context->queue == NULL) {
+    if ((context->queue == NULL) && (context->pending_ranges == NULL)) {
       GSTCURL_ERROR_PRINT ("Request Queue was empty on a Queue Event!");
       context->state = GSTCURL_MULTI_LOOP_STATE_WAIT;
       return;
@@ -1550,6 +1669,10 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
       }
       qelement = qelement->next;
     }
+    if (context->pending_ranges != NULL) {
+      gst_curl_http_src_add_ranges (context);
+      cond = TRUE;
+    }
 
     if (cond != TRUE) {
       GSTCURL_WARNING_PRINT ("All curl handles already added for QUEUE_EVENT!");
@@ -1564,6 +1687,10 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
     fd_set fdread, fdwrite, fdexcep;
     int maxfd = -1;
     long curl_timeo = -1;
+    gboolean paused;
+
+    /* Transfers can only be resumed from this thread, do it before waiting */
+    paused = gst_curl_http_src_resume_paused (context);
 
     /* Because curl can possibly take some time here, be nice and let go of the
      * mutex so other threads can perform state/queue operations as we don't
@@ -1587,6 +1714,14 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
       }
     }
 
+    /* A paused transfer has nothing to wait for on its socket, come back
+     * soon to check whether downstream has caught up */
+    if (paused && (timeout.tv_sec > 0 ||
+            timeout.tv_usec > GSTCURL_PAUSED_POLL_INTERVAL_USEC)) {
+      timeout.tv_sec = 0;
+      timeout.tv_usec = GSTCURL_PAUSED_POLL_INTERVAL_USEC;
+    }
+
     /* get file descriptors from the transfers */
     curl_multi_fdset (context->multi_handle, &fdread, &fdwrite, &fdexcep,
         &maxfd);
@@ -1623,8 +1758,11 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
         }
         curl_multi_remove_handle (context->multi_handle,
             curl_message->easy_handle);
-        gst_curl_http_src_remove_queue_handle (&context->queue,
-            curl_message->easy_handle, curl_message->data.result);
+        if (!gst_curl_http_src_remove_queue_handle (&context->queue,
+                curl_message->easy_handle, curl_message->data.result)) {
+          gst_curl_http_src_range_done (curl_message->easy_handle,
+              curl_message->data.result);
+        }
         g_mutex_unlock (&context->mutex);
       }
     }
@@ -1670,6 +1808,10 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
       }
       qelement = qelement->next;
     }
+    if (context->request_removal_element != NULL) {
+      gst_curl_http_src_remove_ranges (context,
+          context->request_removal_element);
+    }
     context->request_removal_element = NULL;
     context->state = GSTCURL_MULTI_LOOP_STATE_RUNNING;
     g_mutex_unlock (&context->mutex);
@@ -1776,6 +1918,17 @@ gst_curl_http_src_get_header (void *header, size_t size, size_t nmemb,
       /* We have some special cases - deal with them here */
       if (g_strcmp0 (header_key, "content-type") == 0) {
         gst_curl_http_src_negotiate_caps (src);
+      } else if ((g_strcmp0 (header_key, "content-range") == 0) &&
+          (s->connections > 1) && (s->status_code == 206)) {
+        /* bytes <first>-<last>/<total> */
+        const gchar *total = strchr (header_tpl[1], '/');
+
+        if (total != NULL && g_ascii_isdigit (total[1])) {
+          s->range_total = g_ascii_strtoull (total + 1, NULL, 10);
+          s->range_next = MIN (s->range_total, GSTCURL_RANGE_SIZE);
+          GST_INFO_OBJECT (s, "Splitting %" G_GUINT64_FORMAT " bytes over %u "
+              "connections", s->range_total, s->connections);
+        }
       }
 
       g_free (header_key);
@@ -1841,19 +1994,499 @@ gst_curl_http_src_get_chunks (void *chunk, size_t size, size_t nmemb, void *src)
     g_mutex_unlock (&s->buffer_mutex);
     return chunk_len;
   }
-  s->buffer =
-      g_realloc (s->buffer, (s->buffer_len + chunk_len + 1) * sizeof (char));
-  if (s->buffer == NULL) {
-    GST_ERROR_OBJECT (s, "Realloc for cURL response message failed!\n");
+
+  /* Enough is waiting for downstream already, curl hands the same chunk
+   * again once the transfer is resumed */
+  if ((s->read_ahead > 0) && (s->body.queued_bytes >= s->read_ahead)) {
+    GST_LOG_OBJECT (s, "%" G_GUINT64_FORMAT " bytes queued, pausing transfer",
+        s->body.queued_bytes);
+    s->paused = TRUE;
+    g_mutex_unlock (&s->buffer_mutex);
+    return CURL_WRITEFUNC_PAUSE;
+  }
+
+  if (!gst_curl_http_src_body_write (s, &s->body, chunk, chunk_len)) {
+    g_mutex_unlock (&s->buffer_mutex);
     return 0;
   }
-  memcpy (s->buffer + s->buffer_len, chunk, chunk_len);
-  s->buffer_len += chunk_len;
+
   g_cond_signal (&s->signal);
   g_mutex_unlock (&s->buffer_mutex);
   return chunk_len;
 }
 
+static void
+gst_curl_http_src_body_init (GstCurlHttpSrcBody * body)
+{
+  g_queue_init (&body->buffers);
+  body->queued_bytes = 0;
+  body->fill_buffer = NULL;
+  body->fill_offset = 0;
+}
+
+/*
+ * Drop any received data that hasn't been pushed yet. Must be called with
+ * the buffer_mutex held, as must all the body functions.
+ */
+static void
+gst_curl_http_src_body_flush (GstCurlHttpSrcBody * body)
+{
+  GstBuffer *buffer;
+
+  while ((buffer = g_queue_pop_head (&body->buffers)) != NULL)
+    gst_buffer_unref (buffer);
+  body->queued_bytes = 0;
+
+  if (body->fill_buffer != NULL) {
+    gst_buffer_unmap (body->fill_buffer, &body->fill_map);
+    gst_buffer_unref (body->fill_buffer);
+    body->fill_buffer = NULL;
+  }
+  body->fill_offset = 0;
+}
+
+static gboolean
+gst_curl_http_src_body_has_data (GstCurlHttpSrcBody * body)
+{
+  return !g_queue_is_empty (&body->buffers) || (body->fill_buffer != NULL);
+}
+
+/*
+ * Take the oldest received buffer. Don't wait for the buffer being filled to
+ * be full, whatever arrived so far goes downstream straight away.
+ */
+static GstBuffer *
+gst_curl_http_src_body_pop (GstCurlHttpSrcBody * body)
+{
+  GstBuffer *buffer;
+
+  if (g_queue_is_empty (&body->buffers)) {
+    gst_buffer_unmap (body->fill_buffer, &body->fill_map);
+    gst_buffer_resize (body->fill_buffer, 0, body->fill_offset);
+    buffer = body->fill_buffer;
+    body->fill_buffer = NULL;
+    body->fill_offset = 0;
+  } else {
+    buffer = g_queue_pop_head (&body->buffers);
+    body->queued_bytes -= gst_buffer_get_size (buffer);
+  }
+
+  return buffer;
+}
+
+/*
+ * Copy data received by curl into pooled buffers, queueing them as they
+ * get full.
+ */
+static gboolean
+gst_curl_http_src_body_write (GstCurlHttpSrc * src, GstCurlHttpSrcBody * body,
+    const guint8 * data, size_t len)
+{
+  while (len > 0) {
+    size_t n;
+
+    if (body->fill_buffer == NULL) {
+      if (gst_buffer_pool_acquire_buffer (src->pool, &body->fill_buffer,
+              NULL) != GST_FLOW_OK) {
+        GST_ERROR_OBJECT (src, "Couldn't acquire a buffer for the response");
+        body->fill_buffer = NULL;
+        return FALSE;
+      }
+      gst_buffer_map (body->fill_buffer, &body->fill_map, GST_MAP_WRITE);
+      body->fill_offset = 0;
+    }
+
+    n = MIN (len, body->fill_map.size - body->fill_offset);
+    memcpy (body->fill_map.data + body->fill_offset, data, n);
+    body->fill_offset += n;
+    data += n;
+    len -= n;
+
+    if (body->fill_offset == body->fill_map.size) {
+      gst_buffer_unmap (body->fill_buffer, &body->fill_map);
+      g_queue_push_tail (&body->buffers, body->fill_buffer);
+      body->queued_bytes += body->fill_offset;
+      body->fill_buffer = NULL;
+      body->fill_offset = 0;
+    }
+  }
+
+  return TRUE;
+}
+
+/*
+ * Make sure there is an active pool handing out buffers of the current
+ * blocksize for the curl loop to write the body into. Must be called with
+ * the buffer_mutex held.
+ */
+static gboolean
+gst_curl_http_src_ensure_pool (GstCurlHttpSrc * src)
+{
+  guint blocksize = gst_base_src_get_blocksize (GST_BASE_SRC (src));
+  GstStructure *config;
+
+  if ((src->pool != NULL) && (src->pool_size == blocksize))
+    return TRUE;
+
+  if (src->pool != NULL) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_object_unref (src->pool);
+  }
+
+  src->pool = gst_buffer_pool_new ();
+  src->pool_size = blocksize;
+  config = gst_buffer_pool_get_config (src->pool);
+  gst_buffer_pool_config_set_params (config, NULL, blocksize, 0, 0);
+  if (!gst_buffer_pool_set_config (src->pool, config) ||
+      !gst_buffer_pool_set_active (src->pool, TRUE)) {
+    GST_ERROR_OBJECT (src, "Couldn't set up a buffer pool");
+    gst_object_unref (src->pool);
+    src->pool = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*
+ * Receive data for one of the additional byte ranges
+ */
+static size_t
+gst_curl_http_src_range_get_chunks (void *chunk, size_t size, size_t nmemb,
+    void *data)
+{
+  GstCurlHttpSrcRange *range = data;
+  GstCurlHttpSrc *s = range->src;
+  size_t chunk_len = size * nmemb;
+
+  g_mutex_lock (&s->buffer_mutex);
+  /* Nobody will read this any more, make curl abort the transfer */
+  if (range->orphaned) {
+    g_mutex_unlock (&s->buffer_mutex);
+    return 0;
+  }
+  if ((s->state == GSTCURL_UNLOCK) || (range->status_code != 206)) {
+    g_mutex_unlock (&s->buffer_mutex);
+    return chunk_len;
+  }
+  if (!gst_curl_http_src_body_write (s, &range->body, chunk, chunk_len)) {
+    g_mutex_unlock (&s->buffer_mutex);
+    return 0;
+  }
+  g_cond_signal (&s->signal);
+  g_mutex_unlock (&s->buffer_mutex);
+
+  return chunk_len;
+}
+
+/*
+ * Only the status of the additional byte ranges matters, the headers were
+ * already received with the first one
+ */
+static size_t
+gst_curl_http_src_range_get_header (void *header, size_t size, size_t nmemb,
+    void *data)
+{
+  GstCurlHttpSrcRange *range = data;
+
+  if (g_ascii_strncasecmp (header, "HTTP", 4) == 0) {
+    const gchar *status = strchr (header, ' ');
+
+    if (status != NULL) {
+      g_mutex_lock (&range->src->buffer_mutex);
+      range->status_code = (guint) g_ascii_strtoull (status + 1, NULL, 10);
+      g_mutex_unlock (&range->src->buffer_mutex);
+    }
+  }
+
+  return size * nmemb;
+}
+
+static void
+gst_curl_http_src_range_free (GstCurlHttpSrcRange * range)
+{
+  gst_curl_http_src_body_flush (&range->body);
+  if (range->curl_handle != NULL) {
+    curl_easy_cleanup (range->curl_handle);
+  }
+  g_free (range);
+}
+
+/*
+ * Request the following byte ranges until as many connections as configured
+ * are in use. The ranges are handed to the curl loop without the
+ * buffer_mutex held, as it takes the context mutex first.
+ */
+static void
+gst_curl_http_src_schedule_ranges (GstCurlHttpSrc * src)
+{
+  GstCurlHttpSrcClass *klass = G_TYPE_INSTANCE_GET_CLASS (src,
+      GST_TYPE_CURL_HTTP_SRC, GstCurlHttpSrcClass);
+  GSList *added = NULL, *l;
+  guint limit;
+
+  /* The first range keeps its connection until it is done */
+  limit = src->connections - ((src->state == GSTCURL_OK) ? 1 : 0);
+
+  while ((g_queue_get_length (&src->ranges) < limit) &&
+      (src->range_next < src->range_total)) {
+    GstCurlHttpSrcRange *range;
+    gchar *range_str;
+
+    range = g_new0 (GstCurlHttpSrcRange, 1);
+    range->src = src;
+    range->start = src->range_next;
+    range->end = MIN (range->start + GSTCURL_RANGE_SIZE, src->range_total) - 1;
+    gst_curl_http_src_body_init (&range->body);
+
+    /* Same request, including the headers list owned by the first handle */
+    range->curl_handle = curl_easy_duphandle (src->curl_handle);
+    if (range->curl_handle == NULL) {
+      GST_WARNING_OBJECT (src, "Couldn't create a handle for a byte range");
+      g_free (range);
+      break;
+    }
+
+    range_str = g_strdup_printf ("%" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT,
+        range->start, range->end);
+    gst_curl_setopt_str (src, range->curl_handle, CURLOPT_RANGE, range_str);
+    g_free (range_str);
+    gst_curl_setopt_generic (src, range->curl_handle, CURLOPT_HEADERFUNCTION,
+        gst_curl_http_src_range_get_header);
+    gst_curl_setopt_str (src, range->curl_handle, CURLOPT_HEADERDATA, range);
+    gst_curl_setopt_generic (src, range->curl_handle, CURLOPT_WRITEFUNCTION,
+        gst_curl_http_src_range_get_chunks);
+    gst_curl_setopt_str (src, range->curl_handle, CURLOPT_WRITEDATA, range);
+    gst_curl_setopt_str (src, range->curl_handle, CURLOPT_ERRORBUFFER,
+        range->curl_errbuf);
+    gst_curl_setopt_str (src, range->curl_handle, CURLOPT_PRIVATE, range);
+
+    GST_DEBUG_OBJECT (src, "Requesting bytes %" G_GUINT64_FORMAT "-%"
+        G_GUINT64_FORMAT " of URI %s", range->start, range->end, src->uri);
+
+    src->range_next = range->end + 1;
+    g_queue_push_tail (&src->ranges, range);
+    added = g_slist_append (added, range);
+  }
+
+  if (added == NULL) {
+    return;
+  }
+
+  g_mutex_unlock (&src->buffer_mutex);
+  g_mutex_lock (&klass->multi_task_context.mutex);
+  for (l = added; l != NULL; l = l->next) {
+    klass->multi_task_context.pending_ranges =
+        g_slist_append (klass->multi_task_context.pending_ranges, l->data);
+  }
+  klass->multi_task_context.state = GSTCURL_MULTI_LOOP_STATE_QUEUE_EVENT;
+  g_cond_signal (&klass->multi_task_context.signal);
+  g_mutex_unlock (&klass->multi_task_context.mutex);
+  g_mutex_lock (&src->buffer_mutex);
+
+  g_slist_free (added);
+}
+
+/*
+ * Get the next buffer of the additional byte ranges, in order. Returns
+ * GST_FLOW_EOS once all of them were pushed.
+ */
+static GstFlowReturn
+gst_curl_http_src_read_range (GstCurlHttpSrc * src, GstBuffer ** outbuf)
+{
+  GstCurlHttpSrcRange *range;
+
+  while ((range = g_queue_peek_head (&src->ranges)) != NULL) {
+    while (!gst_curl_http_src_body_has_data (&range->body) && !range->done &&
+        (src->state == GSTCURL_DONE)) {
+      g_cond_wait (&src->signal, &src->buffer_mutex);
+    }
+
+    if (src->state == GSTCURL_UNLOCK) {
+      return GST_FLOW_FLUSHING;
+    }
+
+    if (range->removed) {
+      GST_WARNING_OBJECT (src, "Byte range got removed from the curl queue");
+      return GST_FLOW_EOS;
+    }
+
+    if (range->done && ((range->curl_result != CURLE_OK) ||
+            (range->status_code != 206))) {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+          ("Request for bytes %" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT
+              " of URI %s failed with status %u (%s)", range->start,
+              range->end, src->uri, range->status_code,
+              curl_easy_strerror (range->curl_result)));
+      return GST_FLOW_ERROR;
+    }
+
+    if (gst_curl_http_src_body_has_data (&range->body)) {
+      *outbuf = gst_curl_http_src_body_pop (&range->body);
+      GST_DEBUG_OBJECT (src, "Pushing %" G_GSIZE_FORMAT " bytes of byte range "
+          "%" G_GUINT64_FORMAT " for URI %s to pad",
+          gst_buffer_get_size (*outbuf), range->start, src->uri);
+      return GST_FLOW_OK;
+    }
+
+    /* Fully pushed, make room for the next one */
+    g_queue_pop_head (&src->ranges);
+    gst_curl_http_src_range_free (range);
+    gst_curl_http_src_schedule_ranges (src);
+  }
+
+  if (src->range_next < src->range_total) {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("Couldn't request bytes %" G_GUINT64_FORMAT " onwards of URI %s",
+            src->range_next, src->uri));
+    return GST_FLOW_ERROR;
+  }
+
+  return GST_FLOW_EOS;
+}
+
+/*
+ * Free the byte ranges of the previous transfer. The ones curl still works
+ * on are left to the curl loop to free once done.
+ */
+static void
+gst_curl_http_src_clear_ranges (GstCurlHttpSrc * src)
+{
+  GstCurlHttpSrcRange *range;
+
+  while ((range = g_queue_pop_head (&src->ranges)) != NULL) {
+    if (range->done) {
+      gst_curl_http_src_range_free (range);
+    } else {
+      gst_curl_http_src_body_flush (&range->body);
+      range->orphaned = TRUE;
+    }
+  }
+}
+
+/*
+ * Add the requested byte ranges to the multi handle. Called from the curl
+ * loop with the context mutex held.
+ */
+static void
+gst_curl_http_src_add_ranges (GstCurlHttpSrcMultiTaskContext * context)
+{
+  GSList *l;
+
+  for (l = context->pending_ranges; l != NULL; l = l->next) {
+    GstCurlHttpSrcRange *range = l->data;
+
+    range->added = TRUE;
+    curl_multi_add_handle (context->multi_handle, range->curl_handle);
+  }
+  g_slist_free (context->pending_ranges);
+  context->pending_ranges = NULL;
+}
+
+/*
+ * Cancel the byte ranges of src. Called from the curl loop with the context
+ * mutex held.
+ */
+static void
+gst_curl_http_src_remove_ranges (GstCurlHttpSrcMultiTaskContext * context,
+    GstCurlHttpSrc * src)
+{
+  GList *l;
+
+  g_mutex_lock (&src->buffer_mutex);
+  for (l = src->ranges.head; l != NULL; l = l->next) {
+    GstCurlHttpSrcRange *range = l->data;
+
+    if (range->done) {
+      continue;
+    }
+    if (range->added) {
+      curl_multi_remove_handle (context->multi_handle, range->curl_handle);
+    } else {
+      context->pending_ranges = g_slist_remove (context->pending_ranges,
+          range);
+    }
+    range->done = TRUE;
+    range->removed = TRUE;
+  }
+  g_cond_signal (&src->signal);
+  g_mutex_unlock (&src->buffer_mutex);
+}
+
+/*
+ * A byte range transfer completed. Called from the curl loop with the context
+ * mutex held.
+ */
+static void
+gst_curl_http_src_range_done (CURL * handle, CURLcode result)
+{
+  GstCurlHttpSrcRange *range = NULL;
+  GstCurlHttpSrc *src;
+
+  if ((curl_easy_getinfo (handle, CURLINFO_PRIVATE,
+              (char **) &range) != CURLE_OK) || (range == NULL)) {
+    return;
+  }
+
+  src = range->src;
+  g_mutex_lock (&src->buffer_mutex);
+  if (range->orphaned) {
+    g_mutex_unlock (&src->buffer_mutex);
+    gst_curl_http_src_range_free (range);
+    return;
+  }
+  range->done = TRUE;
+  range->curl_result = result;
+  g_cond_signal (&src->signal);
+  g_mutex_unlock (&src->buffer_mutex);
+}
+
+/*
+ * Resume the paused transfers whose downstream has drained at least half of
+ * the read-ahead. Called from the curl loop, returns TRUE if any transfer is
+ * still paused.
+ */
+static gboolean
+gst_curl_http_src_resume_paused (GstCurlHttpSrcMultiTaskContext * context)
+{
+  GstCurlHttpSrcQueueElement *qelement;
+  gboolean paused = FALSE;
+
+  g_mutex_lock (&context->mutex);
+  for (qelement = context->queue; qelement != NULL;
+      qelement = qelement->next) {
+    GstCurlHttpSrc *s = qelement->p;
+    gboolean resume = FALSE;
+
+    /* ::unlock() holds the buffer_mutex while it takes the context mutex,
+     * don't wait for it here and look again on the next iteration */
+    if (!g_mutex_trylock (&s->buffer_mutex)) {
+      paused = TRUE;
+      continue;
+    }
+    if (s->paused) {
+      if ((s->state == GSTCURL_UNLOCK) || (s->read_ahead == 0) ||
+          (s->body.queued_bytes <= s->read_ahead / 2)) {
+        s->paused = FALSE;
+        resume = TRUE;
+      } else {
+        paused = TRUE;
+      }
+    }
+    g_mutex_unlock (&s->buffer_mutex);
+
+    /* This can call the write callback right away, which takes the
+     * buffer_mutex again */
+    if (resume) {
+      GST_LOG_OBJECT (s, "Resuming transfer for URI %s", s->uri);
+      curl_easy_pause (s->curl_handle, CURLPAUSE_CONT);
+    }
+  }
+  g_mutex_unlock (&context->mutex);
+
+  return paused;
+}
+
 /*
  * Request a cancellation of a currently running curl handle.
  */
@@ -83,6 +83,8 @@ typedef struct _GstCurlHttpSrc GstCurlHttpSrc;
 typedef struct _GstCurlHttpSrcClass GstCurlHttpSrcClass;
 typedef struct _GstCurlHttpSrcMultiTaskContext GstCurlHttpSrcMultiTaskContext;
 typedef struct _GstCurlHttpSrcQueueElement GstCurlHttpSrcQueueElement;
+typedef struct _GstCurlHttpSrcBody GstCurlHttpSrcBody;
+typedef struct _GstCurlHttpSrcRange GstCurlHttpSrcRange;
 
 #define HTTP_HEADERS_NAME       "http-headers"
 #define HTTP_STATUS_CODE        "http-status-code"
@@ -113,6 +115,7 @@ struct _GstCurlHttpSrcMultiTaskContext
   GstCurlHttpSrc  *request_removal_element;
 
   GstCurlHttpSrcQueueElement  *queue;
+  GSList      *pending_ranges;  /* GstCurlHttpSrcRange to add to the handle */
 
   enum
   {
@@ -128,6 +131,39 @@ struct _GstCurlHttpSrcMultiTaskContext
   CURLM *multi_handle;
 };
 
+/*
+ * Body data is written by the curl loop straight into pooled buffers which
+ * are queued for ::create(), fill_buffer is the one currently written.
+ */
+struct _GstCurlHttpSrcBody
+{
+  GQueue buffers;
+  guint64 queued_bytes;
+  GstBuffer *fill_buffer;
+  GstMapInfo fill_map;
+  gsize fill_offset;
+};
+
+/*
+ * One of the additional byte ranges of a transfer split over several
+ * connections, see the connections property.
+ */
+struct _GstCurlHttpSrcRange
+{
+  GstCurlHttpSrc *src;
+  CURL *curl_handle;
+  guint64 start;
+  guint64 end;
+  GstCurlHttpSrcBody body;
+  guint status_code;
+  gboolean added;               /* In the multi handle */
+  gboolean done;
+  gboolean removed;             /* Cancelled by ::unlock() */
+  gboolean orphaned;            /* Freed by the curl loop once done */
+  CURLcode curl_result;
+  char curl_errbuf[CURL_ERROR_SIZE];
+};
+
 struct _GstCurlHttpSrcClass
 {
   GstPushSrcClass parent_class;
@@ -201,8 +237,18 @@ struct _GstCurlHttpSrc
   CURL *curl_handle;
   GMutex buffer_mutex;
   GCond signal;
-  gchar *buffer;
-  guint buffer_len;
+  GstBufferPool *pool;
+  guint pool_size;
+  GstCurlHttpSrcBody body;
+  guint64 read_ahead;           /* Pause the transfer above this, 0=unbounded */
+  gboolean paused;              /* CURL_WRITEFUNC_PAUSE was returned */
+
+  /* Splitting the body into byte ranges, the first one is fetched by
+   * curl_handle and the following ones, in order, are in ranges */
+  guint connections;
+  guint64 range_total;          /* From Content-Range, 0 if not ranged */
+  guint64 range_next;
+  GQueue ranges;
   gboolean transfer_begun;
   gboolean data_received;
 
@@ -245,6 +291,8 @@ enum
   PROP_MAXCONCURRENT_PROXY,
   PROP_MAXCONCURRENT_GLOBAL,
   PROP_HTTPVERSION,
+  PROP_READ_AHEAD,
+  PROP_CONNECTIONS,
   PROP_MAX
 };
 
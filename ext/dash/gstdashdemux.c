@@ -399,6 +399,8 @@ gst_dash_demux_stream_get_fragment_waiting_time (GstAdaptiveDemuxStream *
     stream);
 static void gst_dash_demux_advance_period (GstAdaptiveDemux * demux);
 static gboolean gst_dash_demux_has_next_period (GstAdaptiveDemux * demux);
+static void gst_dash_demux_peek_next_period (GstAdaptiveDemux * demux,
+    GArray * fragments);
 static GstFlowReturn gst_dash_demux_data_received (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream, GstBuffer * buffer);
 static gboolean
@@ -626,6 +628,7 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
 
   gstadaptivedemux_class->has_next_period = gst_dash_demux_has_next_period;
   gstadaptivedemux_class->advance_period = gst_dash_demux_advance_period;
+  gstadaptivedemux_class->peek_next_period = gst_dash_demux_peek_next_period;
   gstadaptivedemux_class->stream_has_next_fragment =
       gst_dash_demux_stream_has_next_fragment;
   gstadaptivedemux_class->stream_advance_fragment =
@@ -1480,9 +1483,7 @@ gst_dash_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
   dashstream->isobmff_parser.current_start_offset = 0;
   dashstream->isobmff_parser.current_size = 0;
 
-  if (dashstream->moof)
-    gst_isoff_moof_box_free (dashstream->moof);
-  dashstream->moof = NULL;
+  dashstream->have_moof = FALSE;
   if (dashstream->moof_sync_samples)
     g_array_free (dashstream->moof_sync_samples, TRUE);
   dashstream->moof_sync_samples = NULL;
@@ -2072,9 +2073,7 @@ gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
   dashstream->isobmff_parser.current_start_offset = 0;
   dashstream->isobmff_parser.current_size = 0;
 
-  if (dashstream->moof)
-    gst_isoff_moof_box_free (dashstream->moof);
-  dashstream->moof = NULL;
+  dashstream->have_moof = FALSE;
   if (dashstream->moof_sync_samples)
     g_array_free (dashstream->moof_sync_samples, TRUE);
   dashstream->moof_sync_samples = NULL;
@@ -2265,9 +2264,7 @@ gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     if (dashstream->adapter)
       gst_adapter_clear (dashstream->adapter);
 
-    if (dashstream->moof)
-      gst_isoff_moof_box_free (dashstream->moof);
-    dashstream->moof = NULL;
+    dashstream->have_moof = FALSE;
     if (dashstream->moof_sync_samples)
       g_array_free (dashstream->moof_sync_samples, TRUE);
     dashstream->moof_sync_samples = NULL;
@@ -2595,6 +2592,82 @@ gst_dash_demux_advance_period (GstAdaptiveDemux * demux)
   gst_mpd_client_seek_to_first_segment (dashdemux->client);
 }
 
+/* The streams of the next period are set up the way advance_period() will
+ * do it, on the side of the current ones */
+static void
+gst_dash_demux_peek_next_period (GstAdaptiveDemux * demux, GArray * fragments)
+{
+  GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (demux);
+  GstMpdClient *client = dashdemux->client;
+  GList *active_streams, *adapt_sets, *iter;
+  guint period_idx, i;
+  gboolean isombff;
+
+  /* the first fragments of the period are only known when playing forward */
+  if (demux->segment.rate < 0)
+    return;
+
+  period_idx = gst_mpd_client_get_period_index (client);
+  if (!gst_mpd_client_set_period_index (client, period_idx + 1))
+    return;
+
+  active_streams = client->active_streams;
+  client->active_streams = NULL;
+
+  adapt_sets = gst_mpd_client_get_adaptation_sets (client);
+  for (iter = adapt_sets; iter; iter = g_list_next (iter))
+    gst_mpd_client_setup_streaming (client, iter->data);
+
+  /* with the on-demand profile the first fragment depends on the sidx */
+  isombff = gst_mpd_client_has_isoff_ondemand_profile (client);
+
+  for (i = 0; i < gst_mpdparser_get_nb_active_stream (client); i++) {
+    GstActiveStream *active_stream;
+    GstAdaptiveDemuxStreamFragment fragment = { 0, };
+    GstMediaFragmentInfo info;
+    gchar *path = NULL;
+
+    active_stream = gst_mpdparser_get_active_stream_by_index (client, i);
+    if (active_stream == NULL)
+      continue;
+
+    if (dashdemux->trickmode_no_audio
+        && active_stream->mimeType == GST_STREAM_AUDIO)
+      continue;
+
+    gst_mpd_client_get_next_header (client, &path, i,
+        &fragment.header_range_start, &fragment.header_range_end);
+    if (path != NULL) {
+      fragment.header_uri =
+          gst_uri_join_strings (gst_mpdparser_get_baseURL (client, i), path);
+      g_free (path);
+      path = NULL;
+    }
+
+    gst_mpd_client_get_next_header_index (client, &path, i,
+        &fragment.index_range_start, &fragment.index_range_end);
+    if (path != NULL) {
+      fragment.index_uri =
+          gst_uri_join_strings (gst_mpdparser_get_baseURL (client, i), path);
+      g_free (path);
+    }
+
+    if (!isombff && gst_mpd_client_get_next_fragment (client, i, &info)) {
+      fragment.uri = info.uri;
+      info.uri = NULL;
+      fragment.range_start = info.range_start;
+      fragment.range_end = info.range_end;
+      gst_media_fragment_info_clear (&info);
+    }
+
+    g_array_append_val (fragments, fragment);
+  }
+
+  gst_active_streams_free (client);
+  client->active_streams = active_streams;
+  gst_mpd_client_set_period_index (client, period_idx);
+}
+
 static GstBuffer *
 _gst_buffer_split (GstBuffer * buffer, gint offset, gsize size)
 {
@@ -2737,7 +2810,7 @@ gst_dash_demux_need_another_chunk (GstAdaptiveDemuxStream * stream)
           stream->fragment.chunk_size = sidx_end_offset - downloaded_end_offset;
         }
       }
-    } else if (dashstream->moof && dashstream->moof_sync_samples) {
+    } else if (dashstream->have_moof && dashstream->moof_sync_samples) {
       /* Have the moof, either we're done now or we want to download the
        * directly following sync sample */
       if (dashstream->first_sync_sample_after_moof
@@ -2780,7 +2853,7 @@ gst_dash_demux_need_another_chunk (GstAdaptiveDemuxStream * stream)
     /* We might've decided that we can't allow key-unit only
      * trickmodes while doing chunked downloading. In that case
      * just download from here to the end now */
-    if (dashstream->moof
+    if (dashstream->have_moof
         && GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (stream->demux)) {
       stream->fragment.chunk_size = -1;
     } else {
@@ -2865,14 +2938,26 @@ gst_dash_demux_parse_isobmff (GstAdaptiveDemux * demux,
 
     if (dash_stream->isobmff_parser.current_fourcc == GST_ISOFF_FOURCC_MOOF) {
       GstByteReader sub_reader;
+      GstMoofIterator moof_iter;
 
       /* Only allow SIDX before the very first moof */
       dash_stream->allow_sidx = FALSE;
 
-      g_assert (dash_stream->moof == NULL);
+      g_assert (!dash_stream->have_moof);
       g_assert (dash_stream->moof_sync_samples == NULL);
       gst_byte_reader_get_sub_reader (&reader, &sub_reader, size - header_size);
-      dash_stream->moof = gst_isoff_moof_box_parse (&sub_reader);
+      /* keep the moof around to look for the sync samples in it once at
+       * the mdat, without parsing it into a tree of arrays */
+      dash_stream->have_moof =
+          gst_isoff_moof_iterator_init (&moof_iter, &sub_reader);
+      if (dash_stream->have_moof) {
+        if (dash_stream->moof == NULL)
+          dash_stream->moof = g_byte_array_new ();
+        g_byte_array_set_size (dash_stream->moof, 0);
+        g_byte_array_append (dash_stream->moof,
+            gst_byte_reader_get_data_unchecked (&sub_reader,
+                size - header_size), size - header_size);
+      }
       dash_stream->moof_offset =
           dash_stream->isobmff_parser.current_start_offset;
       dash_stream->moof_size = size;
@@ -3031,12 +3116,23 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
 {
   GstDashDemux *dashdemux = (GstDashDemux *) stream->demux;
   GstDashDemuxStream *dash_stream = (GstDashDemuxStream *) stream;
+  GstMoofIterator iter;
+  GstByteReader reader;
+  GstTfhdBox tfhd;
+  GstIsoffParserResult res;
   guint i;
   guint32 track_id = 0;
   guint64 prev_traf_end;
   gboolean trex_sample_flags = FALSE;
 
-  if (!dash_stream->moof) {
+  if (!dash_stream->have_moof) {
+    dashdemux->allow_trickmode_key_units = FALSE;
+    return FALSE;
+  }
+
+  gst_byte_reader_init (&reader, dash_stream->moof->data,
+      dash_stream->moof->len);
+  if (!gst_isoff_moof_iterator_init (&iter, &reader)) {
     dashdemux->allow_trickmode_key_units = FALSE;
     return FALSE;
   }
@@ -3047,27 +3143,25 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
 
   prev_traf_end = dash_stream->moof_offset;
 
-  /* generate table of keyframes and offsets */
-  for (i = 0; i < dash_stream->moof->traf->len; i++) {
-    GstTrafBox *traf = &g_array_index (dash_stream->moof->traf, GstTrafBox, i);
+  /* generate table of keyframes and offsets, walking the moof in place */
+  for (i = 0;
+      (res = gst_isoff_moof_iterator_next_traf (&iter, &tfhd,
+              NULL)) == GST_ISOFF_PARSER_OK; i++) {
+    GstTrunBox trun;
     guint64 traf_offset = 0, prev_trun_end;
-    guint j;
 
     if (i == 0) {
-      track_id = traf->tfhd.track_id;
-    } else if (track_id != traf->tfhd.track_id) {
+      track_id = tfhd.track_id;
+    } else if (track_id != tfhd.track_id) {
       GST_ERROR_OBJECT (stream->pad,
           "moof with trafs of different track ids (%u != %u)", track_id,
-          traf->tfhd.track_id);
-      g_array_free (dash_stream->moof_sync_samples, TRUE);
-      dash_stream->moof_sync_samples = NULL;
-      dashdemux->allow_trickmode_key_units = FALSE;
-      return FALSE;
+          tfhd.track_id);
+      goto error;
     }
 
-    if (traf->tfhd.flags & GST_TFHD_FLAGS_BASE_DATA_OFFSET_PRESENT) {
-      traf_offset = traf->tfhd.base_data_offset;
-    } else if (traf->tfhd.flags & GST_TFHD_FLAGS_DEFAULT_BASE_IS_MOOF) {
+    if (tfhd.flags & GST_TFHD_FLAGS_BASE_DATA_OFFSET_PRESENT) {
+      traf_offset = tfhd.base_data_offset;
+    } else if (tfhd.flags & GST_TFHD_FLAGS_DEFAULT_BASE_IS_MOOF) {
       traf_offset = dash_stream->moof_offset;
     } else {
       traf_offset = prev_traf_end;
@@ -3075,69 +3169,47 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
 
     prev_trun_end = traf_offset;
 
-    for (j = 0; j < traf->trun->len; j++) {
-      GstTrunBox *trun = &g_array_index (traf->trun, GstTrunBox, j);
+    while ((res = gst_isoff_moof_iterator_next_trun (&iter,
+                &trun)) == GST_ISOFF_PARSER_OK) {
+      GstTrunSample sample;
       guint64 trun_offset, prev_sample_end;
       guint k;
 
-      if (trun->flags & GST_TRUN_FLAGS_DATA_OFFSET_PRESENT) {
-        trun_offset = traf_offset + trun->data_offset;
+      if (trun.flags & GST_TRUN_FLAGS_DATA_OFFSET_PRESENT) {
+        trun_offset = traf_offset + trun.data_offset;
       } else {
         trun_offset = prev_trun_end;
       }
 
       prev_sample_end = trun_offset;
-      for (k = 0; k < trun->samples->len; k++) {
-        GstTrunSample *sample =
-            &g_array_index (trun->samples, GstTrunSample, k);
+      for (k = 0;
+          (res = gst_isoff_moof_iterator_next_sample (&iter,
+                  &sample)) == GST_ISOFF_PARSER_OK; k++) {
         guint64 sample_offset;
         guint32 sample_flags;
-#if 0
-        guint32 sample_duration;
-#endif
 
         sample_offset = prev_sample_end;
 
-        if (trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT) {
-          sample_flags = sample->sample_flags;
-        } else if ((trun->flags & GST_TRUN_FLAGS_FIRST_SAMPLE_FLAGS_PRESENT)
+        if (trun.flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT) {
+          sample_flags = sample.sample_flags;
+        } else if ((trun.flags & GST_TRUN_FLAGS_FIRST_SAMPLE_FLAGS_PRESENT)
             && k == 0) {
-          sample_flags = trun->first_sample_flags;
-        } else if (traf->
-            tfhd.flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_FLAGS_PRESENT) {
-          sample_flags = traf->tfhd.default_sample_flags;
+          sample_flags = trun.first_sample_flags;
+        } else if (tfhd.flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_FLAGS_PRESENT) {
+          sample_flags = tfhd.default_sample_flags;
         } else {
           trex_sample_flags = TRUE;
           continue;
         }
 
-#if 0
-        if (trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT) {
-          sample_duration = sample->sample_duration;
-        } else if (traf->
-            tfhd.flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_DURATION_PRESENT) {
-          sample_duration = traf->tfhd.default_sample_duration;
-        } else {
-          GST_FIXME_OBJECT (stream->pad,
-              "Sample duration given by trex - can't download only keyframes");
-          g_array_free (dash_stream->moof_sync_samples, TRUE);
-          dash_stream->moof_sync_samples = NULL;
-          return FALSE;
-        }
-#endif
-
-        if (trun->flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT) {
-          prev_sample_end += sample->sample_size;
-        } else if (traf->
-            tfhd.flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_SIZE_PRESENT) {
-          prev_sample_end += traf->tfhd.default_sample_size;
+        if (trun.flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT) {
+          prev_sample_end += sample.sample_size;
+        } else if (tfhd.flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_SIZE_PRESENT) {
+          prev_sample_end += tfhd.default_sample_size;
         } else {
           GST_FIXME_OBJECT (stream->pad,
               "Sample size given by trex - can't download only keyframes");
-          g_array_free (dash_stream->moof_sync_samples, TRUE);
-          dash_stream->moof_sync_samples = NULL;
-          dashdemux->allow_trickmode_key_units = FALSE;
-          return FALSE;
+          goto error;
         }
 
         /* Non-non-sync sample aka sync sample */
@@ -3149,12 +3221,18 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
           g_array_append_val (dash_stream->moof_sync_samples, sync_sample);
         }
       }
+      if (res == GST_ISOFF_PARSER_ERROR)
+        goto parse_error;
 
       prev_trun_end = prev_sample_end;
     }
+    if (res == GST_ISOFF_PARSER_ERROR)
+      goto parse_error;
 
     prev_traf_end = prev_trun_end;
   }
+  if (res == GST_ISOFF_PARSER_ERROR)
+    goto parse_error;
 
   if (trex_sample_flags) {
     if (dash_stream->moof_sync_samples->len > 0) {
@@ -3256,6 +3334,14 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
   }
 
   return TRUE;
+
+parse_error:
+  GST_WARNING_OBJECT (stream->pad, "Invalid moof, can't find keyframes");
+error:
+  g_array_free (dash_stream->moof_sync_samples, TRUE);
+  dash_stream->moof_sync_samples = NULL;
+  dashdemux->allow_trickmode_key_units = FALSE;
+  return FALSE;
 }
 
 
@@ -3547,7 +3633,7 @@ gst_dash_demux_stream_free (GstAdaptiveDemuxStream * stream)
   if (dash_stream->adapter)
     g_object_unref (dash_stream->adapter);
   if (dash_stream->moof)
-    gst_isoff_moof_box_free (dash_stream->moof);
+    g_byte_array_unref (dash_stream->moof);
   if (dash_stream->moof_sync_samples)
     g_array_free (dash_stream->moof_sync_samples, TRUE);
 }
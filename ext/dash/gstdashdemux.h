@@ -89,7 +89,10 @@ struct _GstDashDemuxStream
     guint64 current_size;
   } isobmff_parser;
 
-  GstMoofBox *moof;
+  /* content of the current moof, walked in place when looking for the
+   * sync samples. The array is reused for all the fragments */
+  GByteArray *moof;
+  gboolean have_moof;
   guint64 moof_offset, moof_size;
   GArray *moof_sync_samples;
   guint current_sync_sample;
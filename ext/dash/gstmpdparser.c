@@ -27,6 +27,8 @@
 #include <string.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/SAX2.h>
+#include <libxml/parserInternals.h>
 #include "gstmpdparser.h"
 #include "gstdash_debug.h"
 
@@ -1561,20 +1563,54 @@ gst_mpdparser_clone_s_node (GstSNode * pointer)
   return clone;
 }
 
+/* Appends an S node to the timeline. When @merge is set, an S node
+ * continuing the previous one with the same duration only increases its
+ * repeat count, which keeps the long timelines of live streams small. This
+ * is only done for SegmentTemplate timelines, the S nodes of a SegmentList
+ * map to its SegmentURLs */
 static void
-gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node)
+gst_mpdparser_append_s_node (GQueue * queue, guint64 t, guint64 d, gint r,
+    gboolean merge)
 {
   GstSNode *new_s_node;
 
+  if (merge && r >= 0) {
+    GstSNode *last = g_queue_peek_tail (queue);
+
+    if (last && last->r >= 0 && last->d == d && last->r < G_MAXINT - r - 1
+        && (t == 0 || (last->t > 0 && t == last->t + d * (last->r + 1)))) {
+      last->r += r + 1;
+      return;
+    }
+  }
+
   new_s_node = g_slice_new0 (GstSNode);
+  new_s_node->t = t;
+  new_s_node->d = d;
+  new_s_node->r = r;
   g_queue_push_tail (queue, new_s_node);
+}
+
+static gboolean
+gst_mpdparser_is_template_timeline (xmlNode * a_node)
+{
+  return a_node->parent && a_node->parent->type == XML_ELEMENT_NODE
+      && xmlStrcmp (a_node->parent->name, (xmlChar *) "SegmentTemplate") == 0;
+}
+
+static void
+gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node)
+{
+  guint64 t, d;
+  gint r;
 
   GST_LOG ("attributes of S node:");
-  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "t", 0,
-      &new_s_node->t);
-  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "d", 0,
-      &new_s_node->d);
-  gst_mpdparser_get_xml_prop_signed_integer (a_node, "r", 0, &new_s_node->r);
+  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "t", 0, &t);
+  gst_mpdparser_get_xml_prop_unsigned_integer_64 (a_node, "d", 0, &d);
+  gst_mpdparser_get_xml_prop_signed_integer (a_node, "r", 0, &r);
+
+  gst_mpdparser_append_s_node (queue, t, d, r,
+      gst_mpdparser_is_template_timeline (a_node->parent));
 }
 
 static GstSegmentTimelineNode *
@@ -1616,6 +1652,16 @@ gst_mpdparser_parse_segment_timeline_node (GstSegmentTimelineNode ** pointer,
     return;
   }
 
+  /* the S nodes were already parsed when reading the document */
+  if (a_node->_private) {
+    GQueue *queue = a_node->_private;
+
+    new_seg_timeline->S = *queue;
+    g_free (queue);
+    a_node->_private = NULL;
+    return;
+  }
+
   /* explore children nodes */
   for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
     if (cur_node->type == XML_ELEMENT_NODE) {
@@ -3820,6 +3866,172 @@ gst_mpd_client_fetch_on_load_external_resources (GstMpdClient * client)
   }
 }
 
+/* Tree builder used for the MPD files. The S nodes of the SegmentTimelines,
+ * which are most of the elements of live manifests, don't get added to the
+ * tree but are parsed into GstSNode as they are read and attached to their
+ * SegmentTimeline node, where gst_mpdparser_parse_segment_timeline_node()
+ * picks them up */
+typedef struct
+{
+  GSList *timelines;            /* SegmentTimeline nodes with parsed S nodes */
+  guint skip_depth;
+} GstMpdParserReader;
+
+static guint64
+gst_mpdparser_reader_get_uint64 (const xmlChar * start, const xmlChar * end,
+    const gchar * name)
+{
+  gchar str[32];
+  guint64 value;
+  gchar *endptr;
+  gsize len = end - start;
+
+  if (len == 0 || len >= sizeof (str))
+    goto error;
+
+  memcpy (str, start, len);
+  str[len] = '\0';
+  g_strstrip (str);
+  if (str[0] == '-')
+    goto error;
+
+  value = g_ascii_strtoull (str, &endptr, 10);
+  if (endptr == str || *endptr != '\0')
+    goto error;
+
+  return value;
+
+error:
+  GST_WARNING ("failed to parse unsigned integer property %s from xml string "
+      "%.*s", name, (gint) len, start);
+  return 0;
+}
+
+static void
+gst_mpdparser_reader_start_element (void *ctx, const xmlChar * localname,
+    const xmlChar * prefix, const xmlChar * URI, int nb_namespaces,
+    const xmlChar ** namespaces, int nb_attributes, int nb_defaulted,
+    const xmlChar ** attributes)
+{
+  xmlParserCtxtPtr ctxt = ctx;
+  GstMpdParserReader *reader = ctxt->_private;
+  xmlNode *parent = ctxt->node;
+  GQueue *queue;
+  guint64 t = 0, d = 0;
+  gint r = 0;
+  gint i;
+
+  if (reader->skip_depth) {
+    reader->skip_depth++;
+    return;
+  }
+
+  if (parent == NULL || xmlStrcmp (localname, (xmlChar *) "S") != 0 ||
+      xmlStrcmp (parent->name, (xmlChar *) "SegmentTimeline") != 0) {
+    xmlSAX2StartElementNs (ctx, localname, prefix, URI, nb_namespaces,
+        namespaces, nb_attributes, nb_defaulted, attributes);
+    return;
+  }
+
+  /* attributes are (localname, prefix, URI, value, end) tuples */
+  for (i = 0; i < nb_attributes; i++) {
+    const xmlChar **attr = &attributes[i * 5];
+
+    if (xmlStrcmp (attr[0], (xmlChar *) "t") == 0) {
+      t = gst_mpdparser_reader_get_uint64 (attr[3], attr[4], "t");
+    } else if (xmlStrcmp (attr[0], (xmlChar *) "d") == 0) {
+      d = gst_mpdparser_reader_get_uint64 (attr[3], attr[4], "d");
+    } else if (xmlStrcmp (attr[0], (xmlChar *) "r") == 0) {
+      gchar *str = g_strndup ((const gchar *) attr[3], attr[4] - attr[3]);
+
+      if (sscanf (str, "%d", &r) != 1) {
+        GST_WARNING ("failed to parse signed integer property r from xml "
+            "string %s", str);
+        r = 0;
+      }
+      g_free (str);
+    }
+  }
+
+  queue = parent->_private;
+  if (queue == NULL) {
+    queue = g_new0 (GQueue, 1);
+    parent->_private = queue;
+    reader->timelines = g_slist_prepend (reader->timelines, parent);
+  }
+  gst_mpdparser_append_s_node (queue, t, d, r,
+      gst_mpdparser_is_template_timeline (parent));
+
+  /* the S node and its children are not added to the tree */
+  reader->skip_depth = 1;
+}
+
+static void
+gst_mpdparser_reader_end_element (void *ctx, const xmlChar * localname,
+    const xmlChar * prefix, const xmlChar * URI)
+{
+  xmlParserCtxtPtr ctxt = ctx;
+  GstMpdParserReader *reader = ctxt->_private;
+
+  if (reader->skip_depth) {
+    reader->skip_depth--;
+    return;
+  }
+
+  xmlSAX2EndElementNs (ctx, localname, prefix, URI);
+}
+
+static void
+gst_mpdparser_reader_clear_timelines (GstMpdParserReader * reader)
+{
+  GSList *l;
+
+  for (l = reader->timelines; l; l = l->next) {
+    xmlNode *node = l->data;
+    GQueue *queue = node->_private;
+
+    if (queue) {
+      g_queue_foreach (queue, (GFunc) gst_mpdparser_free_s_node, NULL);
+      g_queue_clear (queue);
+      g_free (queue);
+      node->_private = NULL;
+    }
+  }
+  g_slist_free (reader->timelines);
+  reader->timelines = NULL;
+}
+
+static xmlDocPtr
+gst_mpdparser_read_memory (GstMpdParserReader * reader, const gchar * data,
+    gint size)
+{
+  xmlParserCtxtPtr ctxt;
+  xmlDocPtr doc = NULL;
+
+  ctxt = xmlCreateMemoryParserCtxt (data, size);
+  if (ctxt == NULL)
+    return NULL;
+
+  xmlCtxtUseOptions (ctxt, XML_PARSE_NONET);
+  if (ctxt->sax && ctxt->sax->initialized == XML_SAX2_MAGIC) {
+    ctxt->sax->startElementNs = gst_mpdparser_reader_start_element;
+    ctxt->sax->endElementNs = gst_mpdparser_reader_end_element;
+  }
+  ctxt->_private = reader;
+
+  xmlParseDocument (ctxt);
+  if (ctxt->wellFormed) {
+    doc = ctxt->myDoc;
+  } else if (ctxt->myDoc) {
+    gst_mpdparser_reader_clear_timelines (reader);
+    xmlFreeDoc (ctxt->myDoc);
+  }
+  ctxt->myDoc = NULL;
+  xmlFreeParserCtxt (ctxt);
+
+  return doc;
+}
+
 gboolean
 gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
 {
@@ -3828,6 +4040,7 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
   if (data) {
     xmlDocPtr doc;
     xmlNode *root_element = NULL;
+    GstMpdParserReader reader = { NULL, 0 };
 
     GST_DEBUG ("MPD file fully buffered, start parsing...");
 
@@ -3840,7 +4053,7 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
     LIBXML_TEST_VERSION;
 
     /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
-    doc = xmlReadMemory (data, size, "noname.xml", NULL, XML_PARSE_NONET);
+    doc = gst_mpdparser_read_memory (&reader, data, size);
     if (doc == NULL) {
       GST_ERROR ("failed to parse the MPD file");
       ret = FALSE;
@@ -3857,7 +4070,8 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
         /* now we can parse the MPD root node and all children nodes, recursively */
         ret = gst_mpdparser_parse_root_node (&client->mpd_node, root_element);
       }
-      /* free the document */
+      /* free the S nodes of timelines that weren't used and the document */
+      gst_mpdparser_reader_clear_timelines (&reader);
       xmlFreeDoc (doc);
     }
 
@@ -3904,6 +4118,32 @@ gst_mpdparser_get_segment_end_time (GstMpdClient * client, GPtrArray * segments,
   return end;
 }
 
+/* Returns the index of the first segment ending after @ts, or at @ts if
+ * @inclusive, or the number of segments if there is none. The segments
+ * are sorted and their repeats are not expanded so this is a binary search
+ * on the segment end times */
+static guint
+gst_mpdparser_find_segment (GstMpdClient * client, GPtrArray * segments,
+    GstClockTime ts, gboolean inclusive)
+{
+  guint low = 0, high = segments->len;
+
+  while (low < high) {
+    guint mid = low + (high - low) / 2;
+    const GstMediaSegment *segment = g_ptr_array_index (segments, mid);
+    GstClockTime end_time;
+
+    end_time = gst_mpdparser_get_segment_end_time (client, segments, segment,
+        mid);
+    if (inclusive ? ts <= end_time : ts < end_time)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+
+  return low;
+}
+
 static gboolean
 gst_mpd_client_add_media_segment (GstActiveStream * stream,
     GstSegmentURLNode * url_node, guint number, gint repeat,
@@ -4821,67 +5061,54 @@ gst_mpd_client_stream_seek (GstMpdClient * client, GstActiveStream * stream,
   g_return_val_if_fail (stream != NULL, 0);
 
   if (stream->segments) {
-    for (index = 0; index < stream->segments->len; index++) {
-      gboolean in_segment = FALSE;
-      GstMediaSegment *segment = g_ptr_array_index (stream->segments, index);
-      GstClockTime end_time;
-
-      GST_DEBUG ("Looking at fragment sequence chunk %d / %d", index,
-          stream->segments->len);
-
-      end_time =
-          gst_mpdparser_get_segment_end_time (client, stream->segments,
-          segment, index);
+    /* avoid downloading another fragment just for 1ns in reverse mode */
+    index = gst_mpdparser_find_segment (client, stream->segments, ts,
+        !forward);
+    GST_DEBUG ("Found fragment sequence chunk %d / %d", index,
+        stream->segments->len);
 
-      /* avoid downloading another fragment just for 1ns in reverse mode */
-      if (forward)
-        in_segment = ts < end_time;
-      else
-        in_segment = ts <= end_time;
-
-      if (in_segment) {
-        GstClockTime chunk_time;
+    if (index < stream->segments->len) {
+      GstMediaSegment *segment = g_ptr_array_index (stream->segments, index);
+      GstClockTime chunk_time;
 
-        selectedChunk = segment;
-        repeat_index = (ts - segment->start) / segment->duration;
+      selectedChunk = segment;
+      repeat_index = (ts - segment->start) / segment->duration;
 
-        chunk_time = segment->start + segment->duration * repeat_index;
+      chunk_time = segment->start + segment->duration * repeat_index;
 
-        /* At the end of a segment in reverse mode, start from the previous fragment */
-        if (!forward && repeat_index > 0
-            && ((ts - segment->start) % segment->duration == 0))
-          repeat_index--;
+      /* At the end of a segment in reverse mode, start from the previous fragment */
+      if (!forward && repeat_index > 0
+          && ((ts - segment->start) % segment->duration == 0))
+        repeat_index--;
 
-        if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) == GST_SEEK_FLAG_SNAP_NEAREST) {
-          if (repeat_index + 1 < segment->repeat) {
-            if (ts - chunk_time > chunk_time + segment->duration - ts)
-              repeat_index++;
-          } else if (index + 1 < stream->segments->len) {
-            GstMediaSegment *next_segment =
-                g_ptr_array_index (stream->segments, index + 1);
+      if ((flags & GST_SEEK_FLAG_SNAP_NEAREST) == GST_SEEK_FLAG_SNAP_NEAREST) {
+        if (repeat_index + 1 < segment->repeat) {
+          if (ts - chunk_time > chunk_time + segment->duration - ts)
+            repeat_index++;
+        } else if (index + 1 < stream->segments->len) {
+          GstMediaSegment *next_segment =
+              g_ptr_array_index (stream->segments, index + 1);
 
-            if (ts - chunk_time > next_segment->start - ts) {
-              repeat_index = 0;
-              selectedChunk = next_segment;
-              index++;
-            }
+          if (ts - chunk_time > next_segment->start - ts) {
+            repeat_index = 0;
+            selectedChunk = next_segment;
+            index++;
           }
-        } else if (((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
-                (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) &&
-            ts != chunk_time) {
+        }
+      } else if (((forward && flags & GST_SEEK_FLAG_SNAP_AFTER) ||
+              (!forward && flags & GST_SEEK_FLAG_SNAP_BEFORE)) &&
+          ts != chunk_time) {
 
-          if (repeat_index + 1 < segment->repeat) {
-            repeat_index++;
+        if (repeat_index + 1 < segment->repeat) {
+          repeat_index++;
+        } else {
+          repeat_index = 0;
+          if (index + 1 >= stream->segments->len) {
+            selectedChunk = NULL;
           } else {
-            repeat_index = 0;
-            if (index + 1 >= stream->segments->len) {
-              selectedChunk = NULL;
-            } else {
-              selectedChunk = g_ptr_array_index (stream->segments, ++index);
-            }
+            selectedChunk = g_ptr_array_index (stream->segments, ++index);
           }
         }
-        break;
       }
     }
 
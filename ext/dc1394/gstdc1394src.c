@@ -86,9 +86,26 @@ gst_dc1394_iso_speed_get_type (void)
 }
 
 
+/* Frames are copied instead of being wrapped once fewer than this many
+ * would be left queued in the DMA ring */
+#define MIN_QUEUED_FRAMES 2
+
+/* How long to wait for wrapped frames to be released before stopping the
+ * capture, which unmaps the DMA ring */
+#define RELEASE_TIMEOUT (2 * G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+  GstDC1394Src *src;
+  dc1394video_frame_t *frame;
+} GstDC1394Frame;
+
+
 #define gst_dc1394_src_parent_class parent_class
 G_DEFINE_TYPE (GstDC1394Src, gst_dc1394_src, GST_TYPE_PUSH_SRC);
 
+static void gst_dc1394_src_finalize (GObject * object);
+
 static void gst_dc1394_src_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_dc1394_src_get_property (GObject * object, guint prop_id,
@@ -142,6 +159,7 @@ gst_dc1394_src_class_init (GstDC1394SrcClass * klass)
 
   gobject_class->set_property = gst_dc1394_src_set_property;
   gobject_class->get_property = gst_dc1394_src_get_property;
+  gobject_class->finalize = gst_dc1394_src_finalize;
   g_object_class_install_property (gobject_class, PROP_CAMERA_GUID,
       g_param_spec_string ("guid", "Camera GUID",
           "The hexadecimal representation of the GUID of the camera"
@@ -196,12 +214,29 @@ gst_dc1394_src_init (GstDC1394Src * src)
   src->camera = NULL;
   src->caps = NULL;
 
+  g_mutex_init (&src->frames_lock);
+  g_cond_init (&src->frames_cond);
+  src->frames_outstanding = 0;
+  src->frames_released = NULL;
+
   gst_base_src_set_live (GST_BASE_SRC (src), TRUE);
   gst_base_src_set_format (GST_BASE_SRC (src), GST_FORMAT_TIME);
   gst_base_src_set_do_timestamp (GST_BASE_SRC (src), TRUE);
 }
 
 
+static void
+gst_dc1394_src_finalize (GObject * object)
+{
+  GstDC1394Src *src = GST_DC1394_SRC (object);
+
+  g_mutex_clear (&src->frames_lock);
+  g_cond_clear (&src->frames_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+
 static void
 gst_dc1394_src_get_property (GObject * object, guint prop_id, GValue * value,
     GParamSpec * pspec)
@@ -313,6 +348,49 @@ gst_dc1394_src_set_caps (GstBaseSrc * bsrc, GstCaps * caps)
 }
 
 
+/*
+ * Called when downstream is done with a wrapped frame. The frame is only
+ * handed back to libdc1394 from the streaming thread, in create().
+ */
+static void
+gst_dc1394_src_release_frame (GstDC1394Frame * wrapped)
+{
+  GstDC1394Src *src = wrapped->src;
+
+  g_mutex_lock (&src->frames_lock);
+  src->frames_released =
+      g_slist_prepend (src->frames_released, wrapped->frame);
+  src->frames_outstanding--;
+  g_cond_broadcast (&src->frames_cond);
+  g_mutex_unlock (&src->frames_lock);
+
+  gst_object_unref (src);
+  g_slice_free (GstDC1394Frame, wrapped);
+}
+
+
+static void
+gst_dc1394_src_enqueue_released_frames (GstDC1394Src * src)
+{
+  GSList *frames, *l;
+  dc1394error_t ret;
+
+  g_mutex_lock (&src->frames_lock);
+  frames = src->frames_released;
+  src->frames_released = NULL;
+  g_mutex_unlock (&src->frames_lock);
+
+  for (l = frames; l; l = l->next) {
+    ret = dc1394_capture_enqueue (src->camera, l->data);
+    if (ret != DC1394_SUCCESS) {
+      GST_ELEMENT_WARNING (src, RESOURCE, READ, (NULL),
+          ("Could not enqueue frame: %s.", dc1394_error_get_string (ret)));
+    }
+  }
+  g_slist_free (frames);
+}
+
+
 static GstFlowReturn
 gst_dc1394_src_create (GstPushSrc * psrc, GstBuffer ** obuf)
 {
@@ -322,6 +400,8 @@ gst_dc1394_src_create (GstPushSrc * psrc, GstBuffer ** obuf)
   dc1394error_t ret;
 
   src = GST_DC1394_SRC (psrc);
+  gst_dc1394_src_enqueue_released_frames (src);
+
   ret = dc1394_capture_dequeue (src->camera, DC1394_CAPTURE_POLICY_WAIT,
       &frame);
   if (ret != DC1394_SUCCESS) {
@@ -329,24 +409,41 @@ gst_dc1394_src_create (GstPushSrc * psrc, GstBuffer ** obuf)
         ("Could not dequeue frame: %s.", dc1394_error_get_string (ret)));
     return GST_FLOW_ERROR;
   }
-  /*
-   * TODO: We could create the buffer by wrapping the image bytes in the frame
-   * (enqueing the frame in the notify function) to save the copy operation.
-   * It will only work if all the buffers are disposed before closing the camera
-   * when state changes from PAUSED to READY.
-   */
-  buffer = gst_buffer_new_allocate (NULL, frame->image_bytes, NULL);
-  gst_buffer_fill (buffer, 0, frame->image, frame->image_bytes);
   /*
    * TODO: There is a field timestamp in the frame structure,
    * It is not sure if it could be used as PTS or DTS:
    * we are not sure if it comes from a monotonic clock,
    * and it seems to be left undefined under MS Windows.
    */
-  ret = dc1394_capture_enqueue (src->camera, frame);
-  if (ret != DC1394_SUCCESS) {
-    GST_ELEMENT_WARNING (src, RESOURCE, READ, (NULL),
-        ("Could not enqueue frame: %s.", dc1394_error_get_string (ret)));
+
+  /*
+   * The frame is wrapped and enqueued again once the buffer is released,
+   * unless downstream holds so many frames that the camera would run out
+   * of DMA buffers to capture into.
+   */
+  g_mutex_lock (&src->frames_lock);
+  if (src->frames_outstanding + 1 + MIN_QUEUED_FRAMES <= src->dma_buffer_size) {
+    GstDC1394Frame *wrapped = g_slice_new (GstDC1394Frame);
+
+    wrapped->src = gst_object_ref (src);
+    wrapped->frame = frame;
+    src->frames_outstanding++;
+    g_mutex_unlock (&src->frames_lock);
+
+    buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        frame->image, frame->image_bytes, 0, frame->image_bytes, wrapped,
+        (GDestroyNotify) gst_dc1394_src_release_frame);
+  } else {
+    g_mutex_unlock (&src->frames_lock);
+
+    GST_LOG_OBJECT (src, "DMA ring almost exhausted, copying frame");
+    buffer = gst_buffer_new_allocate (NULL, frame->image_bytes, NULL);
+    gst_buffer_fill (buffer, 0, frame->image, frame->image_bytes);
+    ret = dc1394_capture_enqueue (src->camera, frame);
+    if (ret != DC1394_SUCCESS) {
+      GST_ELEMENT_WARNING (src, RESOURCE, READ, (NULL),
+          ("Could not enqueue frame: %s.", dc1394_error_get_string (ret)));
+    }
   }
   *obuf = buffer;
   return GST_FLOW_OK;
@@ -654,6 +751,7 @@ gst_dc1394_src_stop_cam (GstDC1394Src * src)
   dc1394error_t ret;
   dc1394switch_t status;
   guint trials;
+  gint64 end_time;
 
   /*
    * TODO: dc1394_capture_setup/stop can start/stop the transmission
@@ -684,6 +782,29 @@ gst_dc1394_src_stop_cam (GstDC1394Src * src)
         dc1394_error_get_string (ret));
   }
 
+  /* Stopping the capture unmaps the DMA ring, wrapped frames must be
+   * released before */
+  g_mutex_lock (&src->frames_lock);
+  end_time = g_get_monotonic_time () + RELEASE_TIMEOUT;
+  while (src->frames_outstanding > 0) {
+    GST_DEBUG_OBJECT (src, "Waiting for %u frames to be released.",
+        src->frames_outstanding);
+    if (!g_cond_wait_until (&src->frames_cond, &src->frames_lock, end_time))
+      break;
+  }
+  if (src->frames_outstanding > 0) {
+    guint outstanding = src->frames_outstanding;
+
+    g_mutex_unlock (&src->frames_lock);
+    GST_ELEMENT_ERROR (src, RESOURCE, FAILED, (NULL),
+        ("Could not clear capture: %u frames are still in use.",
+            outstanding));
+    return FALSE;
+  }
+  g_slist_free (src->frames_released);
+  src->frames_released = NULL;
+  g_mutex_unlock (&src->frames_lock);
+
   GST_DEBUG_OBJECT (src, "Clear capture resources.");
   ret = dc1394_capture_stop (src->camera);
   if (ret != DC1394_SUCCESS && ret != DC1394_CAPTURE_IS_NOT_SET) {
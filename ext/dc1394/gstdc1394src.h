@@ -47,6 +47,13 @@ struct _GstDC1394Src {
   uint32_t dma_buffer_size;
   dc1394camera_t * camera;
   dc1394_t * dc1394;
+
+  /* DMA frames wrapped in buffers still in use downstream, and the ones
+   * released already that are waiting to be enqueued again */
+  GMutex frames_lock;
+  GCond frames_cond;
+  guint frames_outstanding;
+  GSList *frames_released;
 };
 
 struct _GstDC1394SrcClass {
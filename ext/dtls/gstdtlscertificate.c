@@ -46,6 +46,9 @@
 #endif
 
 #include <openssl/ssl.h>
+#include <openssl/ec.h>
+
+#include <stdlib.h>
 
 GST_DEBUG_CATEGORY_STATIC (gst_dtls_certificate_debug);
 #define GST_CAT_DEFAULT gst_dtls_certificate_debug
@@ -60,12 +63,17 @@ enum
 {
   PROP_0,
   PROP_PEM,
+  PROP_KEY_TYPE,
   NUM_PROPERTIES
 };
 
 static GParamSpec *properties[NUM_PROPERTIES];
 
 #define DEFAULT_PEM NULL
+#define DEFAULT_KEY_TYPE GST_DTLS_KEY_TYPE_RSA
+
+#define DEFAULT_POOL_SIZE 2
+#define DEFAULT_POOL_REUSE 0
 
 struct _GstDtlsCertificatePrivate
 {
@@ -73,8 +81,10 @@ struct _GstDtlsCertificatePrivate
   EVP_PKEY *private_key;
 
   gchar *pem;
+  GstDtlsKeyType key_type;
 };
 
+static void gst_dtls_certificate_constructed (GObject * gobject);
 static void gst_dtls_certificate_finalize (GObject * gobject);
 static void gst_dtls_certificate_set_property (GObject *, guint prop_id,
     const GValue *, GParamSpec *);
@@ -84,6 +94,27 @@ static void gst_dtls_certificate_get_property (GObject *, guint prop_id,
 static void init_generated (GstDtlsCertificate *);
 static void init_from_pem_string (GstDtlsCertificate *, const gchar * pem);
 
+GType
+gst_dtls_key_type_get_type (void)
+{
+  static volatile gsize id = 0;
+  static const GEnumValue values[] = {
+    {GST_DTLS_KEY_TYPE_RSA, "RSA 2048", "rsa"},
+    {GST_DTLS_KEY_TYPE_ECDSA, "ECDSA P-256", "ecdsa"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter ((gsize *) & id)) {
+    GType _id;
+
+    _id = g_enum_register_static ("GstDtlsKeyType", values);
+
+    g_once_init_leave ((gsize *) & id, _id);
+  }
+
+  return (GType) id;
+}
+
 static void
 gst_dtls_certificate_class_init (GstDtlsCertificateClass * klass)
 {
@@ -101,10 +132,18 @@ gst_dtls_certificate_class_init (GstDtlsCertificateClass * klass)
       DEFAULT_PEM,
       G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_KEY_TYPE] =
+      g_param_spec_enum ("key-type",
+      "Key type",
+      "The type of private key to generate when no pem string is given",
+      GST_TYPE_DTLS_KEY_TYPE, DEFAULT_KEY_TYPE,
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, NUM_PROPERTIES, properties);
 
   _gst_dtls_init_openssl ();
 
+  gobject_class->constructed = gst_dtls_certificate_constructed;
   gobject_class->finalize = gst_dtls_certificate_finalize;
 }
 
@@ -117,6 +156,27 @@ gst_dtls_certificate_init (GstDtlsCertificate * self)
   priv->x509 = NULL;
   priv->private_key = NULL;
   priv->pem = NULL;
+  priv->key_type = DEFAULT_KEY_TYPE;
+}
+
+static void
+gst_dtls_certificate_constructed (GObject * gobject)
+{
+  GstDtlsCertificate *self = GST_DTLS_CERTIFICATE (gobject);
+
+  /* the pem string is only stashed by set_property, so that the key type is
+   * known regardless of the order the construct properties are set in */
+  if (self->priv->pem) {
+    gchar *pem = self->priv->pem;
+
+    self->priv->pem = NULL;
+    init_from_pem_string (self, pem);
+    g_free (pem);
+  } else {
+    init_generated (self);
+  }
+
+  G_OBJECT_CLASS (gst_dtls_certificate_parent_class)->constructed (gobject);
 }
 
 static void
@@ -142,16 +202,14 @@ gst_dtls_certificate_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
   GstDtlsCertificate *self = GST_DTLS_CERTIFICATE (object);
-  const gchar *pem;
 
   switch (prop_id) {
     case PROP_PEM:
-      pem = g_value_get_string (value);
-      if (pem) {
-        init_from_pem_string (self, pem);
-      } else {
-        init_generated (self);
-      }
+      g_free (self->priv->pem);
+      self->priv->pem = g_value_dup_string (value);
+      break;
+    case PROP_KEY_TYPE:
+      self->priv->key_type = g_value_get_enum (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
@@ -169,36 +227,23 @@ gst_dtls_certificate_get_property (GObject * object, guint prop_id,
       g_return_if_fail (self->priv->pem);
       g_value_set_string (value, self->priv->pem);
       break;
+    case PROP_KEY_TYPE:
+      g_value_set_enum (value, self->priv->key_type);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
   }
 }
 
-static void
-init_generated (GstDtlsCertificate * self)
+static EVP_PKEY *
+generate_rsa_key (void)
 {
-  GstDtlsCertificatePrivate *priv = self->priv;
+  EVP_PKEY *private_key;
   RSA *rsa;
-  X509_NAME *name = NULL;
-
-  g_return_if_fail (!priv->x509);
-  g_return_if_fail (!priv->private_key);
-
-  priv->private_key = EVP_PKEY_new ();
-
-  if (!priv->private_key) {
-    GST_WARNING_OBJECT (self, "failed to create private key");
-    return;
-  }
-
-  priv->x509 = X509_new ();
 
-  if (!priv->x509) {
-    GST_WARNING_OBJECT (self, "failed to create certificate");
-    EVP_PKEY_free (priv->private_key);
-    priv->private_key = NULL;
-    return;
-  }
+  private_key = EVP_PKEY_new ();
+  if (!private_key)
+    return NULL;
 
   /* XXX: RSA_generate_key is actually deprecated in 0.9.8 */
 #if OPENSSL_VERSION_NUMBER < 0x10100001L
@@ -218,25 +263,80 @@ init_generated (GstDtlsCertificate * self)
 #endif
 
   if (!rsa) {
-    GST_WARNING_OBJECT (self, "failed to generate RSA");
-    EVP_PKEY_free (priv->private_key);
-    priv->private_key = NULL;
-    X509_free (priv->x509);
-    priv->x509 = NULL;
-    return;
+    GST_WARNING ("failed to generate RSA");
+    EVP_PKEY_free (private_key);
+    return NULL;
   }
 
-  if (!EVP_PKEY_assign_RSA (priv->private_key, rsa)) {
-    GST_WARNING_OBJECT (self, "failed to assign RSA");
+  if (!EVP_PKEY_assign_RSA (private_key, rsa)) {
+    GST_WARNING ("failed to assign RSA");
     RSA_free (rsa);
-    rsa = NULL;
+    EVP_PKEY_free (private_key);
+    return NULL;
+  }
+
+  return private_key;
+}
+
+static EVP_PKEY *
+generate_ecdsa_key (void)
+{
+  EVP_PKEY *private_key;
+  EC_KEY *ec;
+
+  private_key = EVP_PKEY_new ();
+  if (!private_key)
+    return NULL;
+
+  ec = EC_KEY_new_by_curve_name (NID_X9_62_prime256v1);
+  if (!ec || !EC_KEY_generate_key (ec)) {
+    GST_WARNING ("failed to generate ECDSA key");
+    EC_KEY_free (ec);
+    EVP_PKEY_free (private_key);
+    return NULL;
+  }
+
+  /* make the curve show up by name in the certificate, peers reject explicit
+   * curve parameters */
+  EC_KEY_set_asn1_flag (ec, OPENSSL_EC_NAMED_CURVE);
+
+  if (!EVP_PKEY_assign_EC_KEY (private_key, ec)) {
+    GST_WARNING ("failed to assign ECDSA key");
+    EC_KEY_free (ec);
+    EVP_PKEY_free (private_key);
+    return NULL;
+  }
+
+  return private_key;
+}
+
+static void
+init_generated (GstDtlsCertificate * self)
+{
+  GstDtlsCertificatePrivate *priv = self->priv;
+  X509_NAME *name = NULL;
+
+  g_return_if_fail (!priv->x509);
+  g_return_if_fail (!priv->private_key);
+
+  if (priv->key_type == GST_DTLS_KEY_TYPE_ECDSA)
+    priv->private_key = generate_ecdsa_key ();
+  else
+    priv->private_key = generate_rsa_key ();
+
+  if (!priv->private_key) {
+    GST_WARNING_OBJECT (self, "failed to create private key");
+    return;
+  }
+
+  priv->x509 = X509_new ();
+
+  if (!priv->x509) {
+    GST_WARNING_OBJECT (self, "failed to create certificate");
     EVP_PKEY_free (priv->private_key);
     priv->private_key = NULL;
-    X509_free (priv->x509);
-    priv->x509 = NULL;
     return;
   }
-  rsa = NULL;
 
   X509_set_version (priv->x509, 2);
   ASN1_INTEGER_set (X509_get_serialNumber (priv->x509), 0);
@@ -345,3 +445,146 @@ _gst_dtls_certificate_get_internal_key (GstDtlsCertificate * self)
   g_return_val_if_fail (GST_IS_DTLS_CERTIFICATE (self), NULL);
   return self->priv->private_key;
 }
+
+typedef struct
+{
+  GQueue ready;
+  guint uses;                   /* times the head of ready was handed out */
+  guint pending;                /* generations queued on the worker */
+} GstDtlsCertificateQueue;
+
+static struct
+{
+  GMutex lock;
+  GThreadPool *worker;
+  guint size;
+  guint reuse;
+  GstDtlsCertificateQueue queues[GST_DTLS_KEY_TYPE_COUNT];
+} pool;
+
+static guint
+pool_env_uint (const gchar * name, guint default_value)
+{
+  const gchar *value = g_getenv (name);
+
+  if (!value || !*value)
+    return default_value;
+
+  return (guint) strtoul (value, NULL, 10);
+}
+
+static void
+pool_generate (gpointer data, gpointer user_data)
+{
+  GstDtlsKeyType key_type = GPOINTER_TO_INT (data) - 1;
+  GstDtlsCertificate *certificate;
+
+  certificate = g_object_new (GST_TYPE_DTLS_CERTIFICATE, "key-type", key_type,
+      NULL);
+
+  g_mutex_lock (&pool.lock);
+  pool.queues[key_type].pending--;
+  if (certificate->priv->pem) {
+    GST_DEBUG_OBJECT (certificate, "pre-generated certificate");
+    g_queue_push_tail (&pool.queues[key_type].ready, certificate);
+    certificate = NULL;
+  }
+  g_mutex_unlock (&pool.lock);
+
+  if (certificate)
+    g_object_unref (certificate);
+}
+
+static void
+pool_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    GstDtlsKeyType i;
+
+    g_mutex_init (&pool.lock);
+    for (i = 0; i < GST_DTLS_KEY_TYPE_COUNT; i++)
+      g_queue_init (&pool.queues[i].ready);
+
+    pool.size = pool_env_uint ("GST_DTLS_CERTIFICATE_POOL_SIZE",
+        DEFAULT_POOL_SIZE);
+    pool.reuse = pool_env_uint ("GST_DTLS_CERTIFICATE_REUSE",
+        DEFAULT_POOL_REUSE);
+    /* a single shared thread, generating is CPU bound anyway */
+    pool.worker = g_thread_pool_new (pool_generate, NULL, 1, FALSE, NULL);
+
+    GST_DEBUG ("certificate pool of %u, reuse %u", pool.size, pool.reuse);
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/* must be called with the pool lock */
+static void
+pool_refill_unlocked (GstDtlsKeyType key_type)
+{
+  GstDtlsCertificateQueue *queue = &pool.queues[key_type];
+  guint target;
+
+  /* without a reuse limit the head is handed out forever, one is enough */
+  target = pool.reuse > 0 ? pool.size : MIN (pool.size, 1);
+
+  while (g_queue_get_length (&queue->ready) + queue->pending < target) {
+    queue->pending++;
+    g_thread_pool_push (pool.worker, GINT_TO_POINTER (key_type + 1), NULL);
+  }
+}
+
+void
+_gst_dtls_certificate_pool_prepare (GstDtlsKeyType key_type)
+{
+  g_return_if_fail (key_type < GST_DTLS_KEY_TYPE_COUNT);
+
+  pool_init ();
+
+  g_mutex_lock (&pool.lock);
+  pool_refill_unlocked (key_type);
+  g_mutex_unlock (&pool.lock);
+}
+
+GstDtlsCertificate *
+_gst_dtls_certificate_pool_acquire (GstDtlsKeyType key_type)
+{
+  GstDtlsCertificateQueue *queue;
+  GstDtlsCertificate *certificate;
+
+  g_return_val_if_fail (key_type < GST_DTLS_KEY_TYPE_COUNT, NULL);
+
+  pool_init ();
+
+  g_mutex_lock (&pool.lock);
+  queue = &pool.queues[key_type];
+
+  certificate = g_queue_peek_head (&queue->ready);
+  if (!certificate) {
+    /* nothing ready yet, generate one here instead of waiting for the worker
+     * to get through whatever it has queued */
+    g_mutex_unlock (&pool.lock);
+    certificate = g_object_new (GST_TYPE_DTLS_CERTIFICATE, "key-type",
+        key_type, NULL);
+    GST_DEBUG_OBJECT (certificate, "certificate pool empty, generated inline");
+    g_mutex_lock (&pool.lock);
+
+    g_queue_push_head (&queue->ready, certificate);
+    queue->uses = 0;
+  }
+
+  g_object_ref (certificate);
+  queue->uses++;
+
+  if (pool.reuse > 0 && queue->uses >= pool.reuse) {
+    g_object_unref (g_queue_pop_head (&queue->ready));
+    queue->uses = 0;
+  }
+
+  pool_refill_unlocked (key_type);
+  g_mutex_unlock (&pool.lock);
+
+  return certificate;
+}
@@ -37,6 +37,22 @@ G_BEGIN_DECLS
 #define GST_IS_DTLS_CERTIFICATE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_DTLS_CERTIFICATE))
 #define GST_DTLS_CERTIFICATE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS((obj), GST_TYPE_DTLS_CERTIFICATE, GstDtlsCertificateClass))
 
+#define GST_TYPE_DTLS_KEY_TYPE               (gst_dtls_key_type_get_type())
+
+/*
+ * GstDtlsKeyType:
+ * @GST_DTLS_KEY_TYPE_RSA: 2048 bit RSA key
+ * @GST_DTLS_KEY_TYPE_ECDSA: ECDSA key on the NIST P-256 curve
+ *
+ * The type of private key used when generating a self-signed certificate.
+ */
+typedef enum {
+    GST_DTLS_KEY_TYPE_RSA,
+    GST_DTLS_KEY_TYPE_ECDSA,
+} GstDtlsKeyType;
+
+#define GST_DTLS_KEY_TYPE_COUNT (GST_DTLS_KEY_TYPE_ECDSA + 1)
+
 typedef gpointer GstDtlsCertificateInternalCertificate;
 typedef gpointer GstDtlsCertificateInternalKey;
 
@@ -48,7 +64,8 @@ typedef struct _GstDtlsCertificatePrivate GstDtlsCertificatePrivate;
  * GstDtlsCertificate:
  *
  * Handles a X509 certificate and a private key.
- * If a certificate is created without the "pem" property, a self-signed certificate is generated.
+ * If a certificate is created without the "pem" property, a self-signed certificate is generated,
+ * using a private key of the type given by the "key-type" property.
  */
 struct _GstDtlsCertificate {
     GObject parent_instance;
@@ -61,12 +78,23 @@ struct _GstDtlsCertificateClass {
 };
 
 GType gst_dtls_certificate_get_type(void) G_GNUC_CONST;
+GType gst_dtls_key_type_get_type(void);
 
 /* internal */
 GstDtlsCertificateInternalCertificate _gst_dtls_certificate_get_internal_certificate(GstDtlsCertificate *);
 GstDtlsCertificateInternalKey _gst_dtls_certificate_get_internal_key(GstDtlsCertificate *);
 gchar *_gst_dtls_x509_to_pem(gpointer x509);
 
+/*
+ * Returns a self-signed certificate from the shared pool of certificates that
+ * are generated in the background. Each pooled certificate is handed out
+ * up to GST_DTLS_CERTIFICATE_REUSE times (0, the default, means it is reused
+ * forever) and GST_DTLS_CERTIFICATE_POOL_SIZE certificates (default 2) are
+ * kept ready for each key type.
+ */
+GstDtlsCertificate *_gst_dtls_certificate_pool_acquire(GstDtlsKeyType key_type);
+void _gst_dtls_certificate_pool_prepare(GstDtlsKeyType key_type);
+
 G_END_DECLS
 
 #endif /* gstdtlscertificate_h */
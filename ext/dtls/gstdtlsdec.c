@@ -63,6 +63,7 @@ enum
   PROP_CONNECTION_ID,
   PROP_PEM,
   PROP_PEER_PEM,
+  PROP_KEY_TYPE,
 
   PROP_DECODER_KEY,
   PROP_SRTP_CIPHER,
@@ -75,6 +76,7 @@ static GParamSpec *properties[NUM_PROPERTIES];
 #define DEFAULT_CONNECTION_ID NULL
 #define DEFAULT_PEM NULL
 #define DEFAULT_PEER_PEM NULL
+#define DEFAULT_KEY_TYPE GST_DTLS_KEY_TYPE_RSA
 
 #define DEFAULT_DECODER_KEY NULL
 #define DEFAULT_SRTP_CIPHER 0
@@ -102,7 +104,8 @@ static GstFlowReturn sink_chain (GstPad *, GstObject * parent, GstBuffer *);
 static GstFlowReturn sink_chain_list (GstPad *, GstObject * parent,
     GstBufferList *);
 
-static GstDtlsAgent *get_agent_by_pem (const gchar * pem);
+static GstDtlsAgent *get_agent_by_pem (const gchar * pem,
+    GstDtlsKeyType key_type);
 static void agent_weak_ref_notify (gchar * pem, GstDtlsAgent *);
 static void create_connection (GstDtlsDec *, gchar * id);
 static void connection_weak_ref_notify (gchar * id, GstDtlsConnection *);
@@ -149,6 +152,14 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
       "The X509 certificate received in the DTLS handshake, in PEM format",
       DEFAULT_PEER_PEM, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  properties[PROP_KEY_TYPE] =
+      g_param_spec_enum ("key-type",
+      "Key type",
+      "The type of private key of the self-signed certificate used when no "
+      "pem string is set",
+      GST_TYPE_DTLS_KEY_TYPE, DEFAULT_KEY_TYPE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   properties[PROP_DECODER_KEY] =
       g_param_spec_boxed ("decoder-key",
       "Decoder key",
@@ -180,12 +191,17 @@ gst_dtls_dec_class_init (GstDtlsDecClass * klass)
       "DTLS Decoder",
       "Decoder/Network/DTLS",
       "Decodes DTLS packets", "Patrik Oldsberg patrik.oldsberg@ericsson.com");
+
+  /* start generating the default certificate in the background */
+  _gst_dtls_certificate_pool_prepare (DEFAULT_KEY_TYPE);
 }
 
 static void
 gst_dtls_dec_init (GstDtlsDec * self)
 {
-  self->agent = get_agent_by_pem (NULL);
+  self->key_type = DEFAULT_KEY_TYPE;
+  self->custom_pem = FALSE;
+  self->agent = get_agent_by_pem (NULL, self->key_type);
   self->connection_id = NULL;
   self->connection = NULL;
   self->peer_pem = NULL;
@@ -265,7 +281,21 @@ gst_dtls_dec_set_property (GObject * object, guint prop_id,
       if (self->agent) {
         g_object_unref (self->agent);
       }
-      self->agent = get_agent_by_pem (g_value_get_string (value));
+      self->custom_pem = g_value_get_string (value) != NULL;
+      self->agent = get_agent_by_pem (g_value_get_string (value),
+          self->key_type);
+      if (self->connection_id) {
+        create_connection (self, self->connection_id);
+      }
+      break;
+    case PROP_KEY_TYPE:
+      self->key_type = g_value_get_enum (value);
+      if (self->custom_pem)
+        break;
+      if (self->agent) {
+        g_object_unref (self->agent);
+      }
+      self->agent = get_agent_by_pem (NULL, self->key_type);
       if (self->connection_id) {
         create_connection (self, self->connection_id);
       }
@@ -292,6 +322,9 @@ gst_dtls_dec_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PEER_PEM:
       g_value_set_string (value, self->peer_pem);
       break;
+    case PROP_KEY_TYPE:
+      g_value_set_enum (value, self->key_type);
+      break;
     case PROP_DECODER_KEY:
       g_value_set_boxed (value, self->decoder_key);
       break;
@@ -577,59 +610,61 @@ sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 static GHashTable *agent_table = NULL;
 G_LOCK_DEFINE_STATIC (agent_table);
 
-static GstDtlsAgent *generated_cert_agent = NULL;
-
 static GstDtlsAgent *
-get_agent_by_pem (const gchar * pem)
+get_agent_by_pem (const gchar * pem, GstDtlsKeyType key_type)
 {
+  GstDtlsCertificate *certificate = NULL;
   GstDtlsAgent *agent;
+  gchar *generated_pem = NULL;
 
   if (!pem) {
-    if (g_once_init_enter (&generated_cert_agent)) {
-      GstDtlsAgent *new_agent;
-
-      new_agent = g_object_new (GST_TYPE_DTLS_AGENT, "certificate",
-          g_object_new (GST_TYPE_DTLS_CERTIFICATE, NULL), NULL);
-
-      GST_DEBUG_OBJECT (generated_cert_agent,
-          "no agent with generated cert found, creating new");
-      g_once_init_leave (&generated_cert_agent, new_agent);
-    } else {
-      GST_DEBUG_OBJECT (generated_cert_agent,
-          "using agent with generated cert");
+    /* agents are shared by everyone handed the same pooled certificate */
+    certificate = _gst_dtls_certificate_pool_acquire (key_type);
+    g_object_get (certificate, "pem", &generated_pem, NULL);
+    pem = generated_pem;
+
+    if (!pem) {
+      agent = g_object_new (GST_TYPE_DTLS_AGENT, "certificate", certificate,
+          NULL);
+      g_object_unref (certificate);
+      GST_WARNING_OBJECT (agent, "certificate generation failed");
+      return agent;
     }
+  }
 
-    agent = generated_cert_agent;
-    g_object_ref (agent);
-  } else {
-    G_LOCK (agent_table);
+  G_LOCK (agent_table);
 
-    if (!agent_table) {
-      agent_table =
-          g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-    }
+  if (!agent_table) {
+    agent_table =
+        g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  }
 
-    agent = GST_DTLS_AGENT (g_hash_table_lookup (agent_table, pem));
+  agent = GST_DTLS_AGENT (g_hash_table_lookup (agent_table, pem));
 
-    if (!agent) {
-      agent = g_object_new (GST_TYPE_DTLS_AGENT,
-          "certificate", g_object_new (GST_TYPE_DTLS_CERTIFICATE, "pem", pem,
-              NULL), NULL);
+  if (!agent) {
+    if (!certificate) {
+      certificate = g_object_new (GST_TYPE_DTLS_CERTIFICATE, "pem", pem, NULL);
+    }
 
-      g_object_weak_ref (G_OBJECT (agent), (GWeakNotify) agent_weak_ref_notify,
-          (gpointer) g_strdup (pem));
+    agent = g_object_new (GST_TYPE_DTLS_AGENT, "certificate", certificate,
+        NULL);
 
-      g_hash_table_insert (agent_table, g_strdup (pem), agent);
+    g_object_weak_ref (G_OBJECT (agent), (GWeakNotify) agent_weak_ref_notify,
+        (gpointer) g_strdup (pem));
 
-      GST_DEBUG_OBJECT (agent, "no agent found, created new");
-    } else {
-      g_object_ref (agent);
-      GST_DEBUG_OBJECT (agent, "agent found");
-    }
+    g_hash_table_insert (agent_table, g_strdup (pem), agent);
 
-    G_UNLOCK (agent_table);
+    GST_DEBUG_OBJECT (agent, "no agent found, created new");
+  } else {
+    g_object_ref (agent);
+    GST_DEBUG_OBJECT (agent, "agent found");
   }
 
+  G_UNLOCK (agent_table);
+
+  if (certificate)
+    g_object_unref (certificate);
+  g_free (generated_pem);
 
   return agent;
 }
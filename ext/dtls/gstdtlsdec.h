@@ -55,6 +55,8 @@ struct _GstDtlsDec {
     GMutex src_mutex;
 
     GstDtlsAgent *agent;
+    GstDtlsKeyType key_type;
+    gboolean custom_pem;
     GstDtlsConnection *connection;
     GMutex connection_mutex;
     gchar *connection_id;
@@ -44,6 +44,12 @@
 
 #include "gstfaad.h"
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 GST_DEBUG_CATEGORY_STATIC (faad_debug);
 #define GST_CAT_DEFAULT faad_debug
 
@@ -98,6 +104,8 @@ static GstFlowReturn gst_faad_parse (GstAudioDecoder * dec, GstAdapter * adapter
 static GstFlowReturn gst_faad_handle_frame (GstAudioDecoder * dec,
     GstBuffer * buffer);
 static void gst_faad_flush (GstAudioDecoder * dec, gboolean hard);
+static gboolean gst_faad_sink_event (GstAudioDecoder * dec, GstEvent * event);
+static gboolean gst_faad_src_event (GstAudioDecoder * dec, GstEvent * event);
 
 static gboolean gst_faad_open_decoder (GstFaad * faad);
 static void gst_faad_close_decoder (GstFaad * faad);
@@ -105,6 +113,36 @@ static void gst_faad_close_decoder (GstFaad * faad);
 #define gst_faad_parent_class parent_class
 G_DEFINE_TYPE (GstFaad, gst_faad, GST_TYPE_AUDIO_DECODER);
 
+/* one index entry for this many ADTS frames, the decoder gets at least as
+ * many frames to settle before the position sought to */
+#define GST_FAAD_INDEX_INTERVAL 16
+
+typedef struct
+{
+  guint64 offset;
+  GstClockTime time;
+} GstFaadIndexEntry;
+
+static const guint adts_sample_rates[] = {
+  96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000,
+  11025, 8000, 7350
+};
+
+/* Duration of the ADTS frame with the given header, or GST_CLOCK_TIME_NONE
+ * for a reserved sample rate index */
+static GstClockTime
+gst_faad_adts_frame_duration (const guint8 * header)
+{
+  guint rate_idx = (header[2] & 0x3c) >> 2;
+  guint blocks = (header[6] & 0x03) + 1;
+
+  if (rate_idx >= G_N_ELEMENTS (adts_sample_rates))
+    return GST_CLOCK_TIME_NONE;
+
+  return gst_util_uint64_scale_int (blocks * 1024, GST_SECOND,
+      adts_sample_rates[rate_idx]);
+}
+
 static void
 gst_faad_class_init (GstFaadClass * klass)
 {
@@ -125,6 +163,8 @@ gst_faad_class_init (GstFaadClass * klass)
   base_class->parse = GST_DEBUG_FUNCPTR (gst_faad_parse);
   base_class->handle_frame = GST_DEBUG_FUNCPTR (gst_faad_handle_frame);
   base_class->flush = GST_DEBUG_FUNCPTR (gst_faad_flush);
+  base_class->sink_event = GST_DEBUG_FUNCPTR (gst_faad_sink_event);
+  base_class->src_event = GST_DEBUG_FUNCPTR (gst_faad_src_event);
 
   GST_DEBUG_CATEGORY_INIT (faad_debug, "faad", 0, "AAC decoding");
 }
@@ -156,6 +196,20 @@ gst_faad_reset (GstFaad * faad)
   faad->channel_positions = NULL;
   faad->last_header = 0;
 
+  GST_OBJECT_LOCK (faad);
+  if (faad->index)
+    g_array_set_size (faad->index, 0);
+  faad->byte_stream = FALSE;
+  faad->index_next_offset = 0;
+  faad->index_next_time = 0;
+  faad->index_frames = 0;
+  faad->seek_offset = -1;
+  faad->seek_time = GST_CLOCK_TIME_NONE;
+  faad->seek_target = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (faad);
+  faad->clip_pos = GST_CLOCK_TIME_NONE;
+  faad->clip_target = GST_CLOCK_TIME_NONE;
+
   gst_faad_reset_stream_state (faad);
 }
 
@@ -165,6 +219,7 @@ gst_faad_start (GstAudioDecoder * dec)
   GstFaad *faad = GST_FAAD (dec);
 
   GST_DEBUG_OBJECT (dec, "start");
+  faad->index = g_array_new (FALSE, FALSE, sizeof (GstFaadIndexEntry));
   gst_faad_reset (faad);
 
   /* call upon legacy upstream byte support (e.g. seeking) */
@@ -184,6 +239,11 @@ gst_faad_stop (GstAudioDecoder * dec)
   gst_faad_reset (faad);
   gst_faad_close_decoder (faad);
 
+  GST_OBJECT_LOCK (faad);
+  g_array_free (faad->index, TRUE);
+  faad->index = NULL;
+  GST_OBJECT_UNLOCK (faad);
+
   return TRUE;
 }
 
@@ -488,6 +548,49 @@ gst_faad_update_caps (GstFaad * faad, faacDecFrameInfo * info)
   return ret;
 }
 
+/* Returns the offset of the first 0xff or 'A' byte in data[n, end), which
+ * is where an ADTS or ADIF syncpoint could start, or end if there is none */
+static guint
+gst_faad_find_sync_byte (const guint8 * data, guint n, guint end)
+{
+#if defined (__SSE2__)
+  {
+    const __m128i ff = _mm_set1_epi8 ((char) 0xff);
+    const __m128i a = _mm_set1_epi8 ('A');
+
+    for (; n + 16 <= end; n += 16) {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) (data + n));
+      gint mask = _mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8 (v, ff),
+              _mm_cmpeq_epi8 (v, a)));
+
+      if (mask)
+        return n + g_bit_nth_lsf (mask, -1);
+    }
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  {
+    const uint8x16_t ff = vdupq_n_u8 (0xff);
+    const uint8x16_t a = vdupq_n_u8 ('A');
+
+    for (; n + 16 <= end; n += 16) {
+      uint8x16_t v = vld1q_u8 (data + n);
+      uint64x2_t m = vreinterpretq_u64_u8 (vorrq_u8 (vceqq_u8 (v, ff),
+              vceqq_u8 (v, a)));
+
+      if (vgetq_lane_u64 (m, 0) | vgetq_lane_u64 (m, 1))
+        break;
+    }
+  }
+#endif
+
+  for (; n < end; n++) {
+    if (data[n] == 0xff || data[n] == 'A')
+      break;
+  }
+
+  return n;
+}
+
 /*
  * Find syncpoint in ADTS/ADIF stream. Doesn't work for raw,
  * packetized streams. Be careful when calling.
@@ -512,6 +615,11 @@ gst_faad_sync (GstFaad * faad, const guint8 * data, guint size, gboolean next,
     goto exit;
 
   for (n = 0; n < size - 3; n++) {
+    /* skip right to the next byte that can start a syncpoint */
+    n = gst_faad_find_sync_byte (data, n, size - 3);
+    if (n == size - 3)
+      break;
+
     snc = GST_READ_UINT16_BE (&data[n]);
     if ((snc & 0xfff6) == 0xfff0) {
       /* we have an ADTS syncpoint. Parse length and find
@@ -588,6 +696,51 @@ looks_like_valid_header (guint8 * input_data, guint input_size)
   return FALSE;
 }
 
+static guint
+gst_faad_adts_frame_length (const guint8 * header)
+{
+  return ((header[3] & 0x03) << 11) | (header[4] << 3) |
+      ((header[5] & 0xe0) >> 5);
+}
+
+/* Adds the ADTS frame at offset in the adapter to the index if it directly
+ * follows the frames indexed so far */
+static void
+gst_faad_index_frame (GstFaad * faad, GstAdapter * adapter,
+    const guint8 * header, guint offset)
+{
+  guint64 distance, start;
+  GstClockTime duration;
+
+  start = gst_adapter_prev_offset (adapter, &distance);
+  if (start == GST_BUFFER_OFFSET_NONE)
+    return;
+  start += distance;
+
+  /* junk skipped while searching the syncpoint doesn't take any time, but
+   * anything before the scanned data may have */
+  if (start > faad->index_next_offset
+      || start + offset < faad->index_next_offset)
+    return;
+
+  duration = gst_faad_adts_frame_duration (header);
+  if (!GST_CLOCK_TIME_IS_VALID (duration))
+    return;
+
+  GST_OBJECT_LOCK (faad);
+  if (faad->index_frames++ % GST_FAAD_INDEX_INTERVAL == 0) {
+    GstFaadIndexEntry entry;
+
+    entry.offset = start + offset;
+    entry.time = faad->index_next_time;
+    g_array_append_val (faad->index, entry);
+  }
+  faad->index_next_offset = start + offset +
+      gst_faad_adts_frame_length (header);
+  faad->index_next_time += duration;
+  GST_OBJECT_UNLOCK (faad);
+}
+
 static GstFlowReturn
 gst_faad_parse (GstAudioDecoder * dec, GstAdapter * adapter,
     gint * offset, gint * length)
@@ -612,7 +765,19 @@ gst_faad_parse (GstAudioDecoder * dec, GstAdapter * adapter,
     gboolean ret;
 
     data = gst_adapter_map (adapter, size);
-    ret = gst_faad_sync (faad, data, size, !eos, offset, length);
+    if (sync && size >= 7 && (GST_READ_UINT16_BE (data) & 0xfff6) == 0xfff0
+        && gst_faad_adts_frame_length (data) <= size
+        && gst_faad_adts_frame_length (data) >= 7) {
+      /* still in sync, no need to wait for the next syncpoint */
+      *offset = 0;
+      *length = gst_faad_adts_frame_length (data);
+      ret = TRUE;
+    } else {
+      ret = gst_faad_sync (faad, data, size, !eos, offset, length);
+    }
+    if (ret && faad->byte_stream && size - *offset >= 7
+        && (GST_READ_UINT16_BE (data + *offset) & 0xfff6) == 0xfff0)
+      gst_faad_index_frame (faad, adapter, data + *offset, *offset);
     gst_adapter_unmap (adapter);
 
     return (ret ? GST_FLOW_OK : GST_FLOW_EOS);
@@ -630,6 +795,8 @@ gst_faad_handle_frame (GstAudioDecoder * dec, GstBuffer * buffer)
   GstBuffer *outbuf;
   faacDecFrameInfo info;
   void *out;
+  GstClockTime frame_pos = GST_CLOCK_TIME_NONE;
+  GstClockTime frame_duration = GST_CLOCK_TIME_NONE;
 
   faad = GST_FAAD (dec);
 
@@ -641,6 +808,18 @@ gst_faad_handle_frame (GstAudioDecoder * dec, GstBuffer * buffer)
   input_data = map.data;
   input_size = map.size;
 
+  /* track the position while clipping after an indexed seek */
+  if (GST_CLOCK_TIME_IS_VALID (faad->clip_target)) {
+    if (input_size >= 7)
+      frame_duration = gst_faad_adts_frame_duration (input_data);
+    if (GST_CLOCK_TIME_IS_VALID (frame_duration)) {
+      frame_pos = faad->clip_pos;
+      faad->clip_pos += frame_duration;
+    } else {
+      faad->clip_target = GST_CLOCK_TIME_NONE;
+    }
+  }
+
 init:
   /* init if not already done during capsnego */
   if (!faad->init) {
@@ -743,6 +922,24 @@ init:
       }
       gst_buffer_unmap (outbuf, &omap);
 
+      /* after an indexed seek, drop what lies before the requested position
+       * but decode it anyway to get the decoder state right */
+      if (GST_CLOCK_TIME_IS_VALID (faad->clip_target)) {
+        if (frame_pos + frame_duration <= faad->clip_target) {
+          gst_buffer_unref (outbuf);
+          outbuf = NULL;
+        } else {
+          guint skip = 0;
+
+          if (faad->clip_target > frame_pos)
+            skip = gst_util_uint64_scale_round (faad->clip_target - frame_pos,
+                samples, frame_duration);
+          gst_buffer_resize (outbuf, MIN (skip, samples) * channels *
+              faad->bps, -1);
+          faad->clip_target = GST_CLOCK_TIME_NONE;
+        }
+      }
+
       ret = gst_audio_decoder_finish_frame (dec, outbuf, 1);
     }
   } while (FALSE);
@@ -803,6 +1000,135 @@ gst_faad_flush (GstAudioDecoder * dec, gboolean hard)
   gst_faad_reset_stream_state (GST_FAAD (dec));
 }
 
+static gboolean
+gst_faad_sink_event (GstAudioDecoder * dec, GstEvent * event)
+{
+  GstFaad *faad = GST_FAAD (dec);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+    const GstSegment *segment;
+
+    gst_event_parse_segment (event, &segment);
+
+    GST_OBJECT_LOCK (faad);
+    faad->byte_stream = segment->format == GST_FORMAT_BYTES;
+    if (faad->byte_stream && segment->start == faad->seek_offset) {
+      GstSegment seg;
+      GstEvent *tevent;
+
+      /* the result of our own seek to an index entry, decoding starts at
+       * the entry and everything up to the requested position is clipped */
+      gst_segment_init (&seg, GST_FORMAT_TIME);
+      seg.rate = segment->rate;
+      seg.applied_rate = segment->applied_rate;
+      seg.start = seg.time = seg.position = faad->seek_target;
+      faad->clip_pos = faad->seek_time;
+      faad->clip_target = faad->seek_target;
+      faad->seek_offset = -1;
+      GST_OBJECT_UNLOCK (faad);
+
+      GST_DEBUG_OBJECT (faad, "seeked to index entry at %" GST_TIME_FORMAT
+          ", clipping up to %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (faad->clip_pos), GST_TIME_ARGS (faad->clip_target));
+
+      tevent = gst_event_new_segment (&seg);
+      gst_event_set_seqnum (tevent, gst_event_get_seqnum (event));
+      gst_event_unref (event);
+      event = tevent;
+    } else {
+      GST_OBJECT_UNLOCK (faad);
+      faad->clip_target = GST_CLOCK_TIME_NONE;
+    }
+  }
+
+  return GST_AUDIO_DECODER_CLASS (parent_class)->sink_event (dec, event);
+}
+
+/* Seeks upstream to the index entry some frames before position, returns
+ * FALSE if the index doesn't cover it */
+static gboolean
+gst_faad_seek_index (GstFaad * faad, GstEvent * event)
+{
+  GstFaadIndexEntry *entry = NULL;
+  GstSeekType start_type, stop_type;
+  GstSeekFlags flags;
+  GstFormat format;
+  gint64 start, stop;
+  gdouble rate;
+  GstEvent *bevent;
+  gint i, n;
+
+  gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
+      &stop_type, &stop);
+
+  if (format != GST_FORMAT_TIME || rate <= 0.0 || start_type !=
+      GST_SEEK_TYPE_SET || stop_type != GST_SEEK_TYPE_NONE || start < 0)
+    return FALSE;
+
+  GST_OBJECT_LOCK (faad);
+  if (!faad->byte_stream || faad->index == NULL || faad->index->len == 0
+      || start >= faad->index_next_time) {
+    GST_OBJECT_UNLOCK (faad);
+    return FALSE;
+  }
+
+  /* binary search for the last entry before the position, going back one
+   * more if that leaves the decoder too little time to settle */
+  i = 0;
+  n = faad->index->len;
+  while (n > 1) {
+    gint half = n / 2;
+
+    if (g_array_index (faad->index, GstFaadIndexEntry, i + half).time <=
+        (GstClockTime) start)
+      i += half;
+    n -= half;
+  }
+  if (i > 0 && g_array_index (faad->index, GstFaadIndexEntry, i).time +
+      GST_SECOND / 10 > (GstClockTime) start)
+    i--;
+  entry = &g_array_index (faad->index, GstFaadIndexEntry, i);
+
+  faad->seek_offset = entry->offset;
+  faad->seek_time = entry->time;
+  faad->seek_target = start;
+  GST_OBJECT_UNLOCK (faad);
+
+  GST_DEBUG_OBJECT (faad, "seeking to %" GST_TIME_FORMAT " using index entry "
+      "at %" GST_TIME_FORMAT ", offset %" G_GUINT64_FORMAT,
+      GST_TIME_ARGS (start), GST_TIME_ARGS (faad->seek_time),
+      faad->seek_offset);
+
+  bevent = gst_event_new_seek (rate, GST_FORMAT_BYTES, flags,
+      GST_SEEK_TYPE_SET, faad->seek_offset, GST_SEEK_TYPE_NONE, -1);
+  gst_event_set_seqnum (bevent, gst_event_get_seqnum (event));
+
+  if (!gst_pad_push_event (GST_AUDIO_DECODER_SINK_PAD (faad), bevent)) {
+    GST_OBJECT_LOCK (faad);
+    faad->seek_offset = -1;
+    GST_OBJECT_UNLOCK (faad);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+gst_faad_src_event (GstAudioDecoder * dec, GstEvent * event)
+{
+  GstFaad *faad = GST_FAAD (dec);
+
+  /* seeks covered by the index of a raw stream are sample accurate, the
+   * base class estimates the byte offset of any others from the bitrate */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEEK
+      && gst_faad_seek_index (faad, event)) {
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return GST_AUDIO_DECODER_CLASS (parent_class)->src_event (dec, event);
+}
+
 static gboolean
 gst_faad_open_decoder (GstFaad * faad)
 {
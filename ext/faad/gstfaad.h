@@ -58,6 +58,21 @@ typedef struct _GstFaad {
 
   gboolean packetised; /* We must differentiate between raw and packetised streams */
 
+  /* byte offsets of ADTS frames in a raw stream, every few frames; appended
+   * while the stream is parsed and protected by the object lock */
+  GArray    *index;
+  gboolean   byte_stream;
+  guint64    index_next_offset;  /* where the frame after the last one is */
+  GstClockTime index_next_time;
+  guint      index_frames;
+
+  /* sample accurate seek: byte offset and time of the index entry sought
+   * to, the requested position and the position of the next frame */
+  guint64    seek_offset;
+  GstClockTime seek_time;
+  GstClockTime seek_target;
+  GstClockTime clip_pos;
+  GstClockTime clip_target;
 } GstFaad;
 
 typedef struct _GstFaadClass {
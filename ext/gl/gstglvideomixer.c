@@ -43,6 +43,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include <gst/controller/gstproxycontrolbinding.h>
 #include <gst/gl/gstglfuncs.h>
 #include <gst/video/gstvideoaffinetransformationmeta.h>
@@ -491,6 +493,56 @@ static const gchar *video_mixer_f_src =
     "  gl_FragColor = vec4(rgba.rgb, rgba.a * alpha);\n"
     "}                                                   \n";
 
+/* number of pads composited by a single draw call of the batch shader,
+ * this is the minimum number of texture units a GLES2 fragment shader is
+ * guaranteed to have */
+#define BATCH_SIZE 8
+
+/* batch vertex source, a_params holds the pad alpha and texture unit */
+static const gchar *batch_v_src =
+    "attribute vec4 a_position;\n"
+    "attribute vec2 a_texcoord;\n"
+    "attribute vec2 a_params;\n"
+    "varying vec2 v_texcoord;\n"
+    "varying vec2 v_params;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = a_position;\n"
+    "   v_texcoord = a_texcoord;\n"
+    "   v_params = a_params;\n"
+    "}\n";
+
+/* batch fragment source, GLSL ES 1.00 only allows indexing sampler arrays
+ * with constant expressions hence the explicit selection */
+static const gchar *batch_f_src =
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D textures[8];\n"
+    "varying vec2 v_texcoord;\n"
+    "varying vec2 v_params;\n"
+    "void main()\n"
+    "{\n"
+    "  vec4 rgba;\n"
+    "  if (v_params.y < 0.5)\n"
+    "    rgba = texture2D(textures[0], v_texcoord);\n"
+    "  else if (v_params.y < 1.5)\n"
+    "    rgba = texture2D(textures[1], v_texcoord);\n"
+    "  else if (v_params.y < 2.5)\n"
+    "    rgba = texture2D(textures[2], v_texcoord);\n"
+    "  else if (v_params.y < 3.5)\n"
+    "    rgba = texture2D(textures[3], v_texcoord);\n"
+    "  else if (v_params.y < 4.5)\n"
+    "    rgba = texture2D(textures[4], v_texcoord);\n"
+    "  else if (v_params.y < 5.5)\n"
+    "    rgba = texture2D(textures[5], v_texcoord);\n"
+    "  else if (v_params.y < 6.5)\n"
+    "    rgba = texture2D(textures[6], v_texcoord);\n"
+    "  else\n"
+    "    rgba = texture2D(textures[7], v_texcoord);\n"
+    "  gl_FragColor = vec4(rgba.rgb, rgba.a * v_params.x);\n"
+    "}\n";
+
 /* checker vertex source */
 static const gchar *checker_v_src =
     "attribute vec4 a_position;\n"
@@ -564,6 +616,9 @@ struct _GstGLVideoMixerPad
   gdouble blend_constant_color_alpha;
 
   gboolean geometry_change;
+  gboolean have_vertices;
+  gboolean upload_vertices;
+  gfloat vertices[20];
   GLuint vertex_buffer;
 };
 
@@ -1144,6 +1199,16 @@ _reset_gl (GstGLContext * context, GstGLVideoMixer * video_mixer)
     video_mixer->checker_vbo = 0;
   }
 
+  if (video_mixer->batch_vbo) {
+    gl->DeleteBuffers (1, &video_mixer->batch_vbo);
+    video_mixer->batch_vbo = 0;
+  }
+
+  if (video_mixer->batch_indices) {
+    gl->DeleteBuffers (1, &video_mixer->batch_indices);
+    video_mixer->batch_indices = 0;
+  }
+
   gst_element_foreach_sink_pad (GST_ELEMENT (video_mixer), _reset_pad_gl, NULL);
 }
 
@@ -1163,6 +1228,10 @@ gst_gl_video_mixer_reset (GstGLMixer * mixer)
     gst_object_unref (video_mixer->checker);
   video_mixer->checker = NULL;
 
+  if (video_mixer->batch_shader)
+    gst_object_unref (video_mixer->batch_shader);
+  video_mixer->batch_shader = NULL;
+
   if (GST_GL_BASE_MIXER (mixer)->context)
     gst_gl_context_thread_add (context, (GstGLContextThreadFunc) _reset_gl,
         mixer);
@@ -1173,13 +1242,28 @@ gst_gl_video_mixer_init_shader (GstGLMixer * mixer, GstCaps * outcaps)
 {
   GstGLVideoMixer *video_mixer = GST_GL_VIDEO_MIXER (mixer);
 
+  GstGLContext *context = GST_GL_BASE_MIXER (mixer)->context;
+
   if (video_mixer->shader)
     gst_object_unref (video_mixer->shader);
+  video_mixer->shader = NULL;
+
+  if (video_mixer->batch_shader)
+    gst_object_unref (video_mixer->batch_shader);
+  video_mixer->batch_shader = NULL;
 
   /* need reconfigure output geometry */
   video_mixer->output_geo_change = TRUE;
 
-  return gst_gl_context_gen_shader (GST_GL_BASE_MIXER (mixer)->context,
+  /* without the batch shader all pads are drawn one by one */
+  if (!gst_gl_context_gen_shader (context, batch_v_src, batch_f_src,
+          &video_mixer->batch_shader)) {
+    GST_WARNING_OBJECT (mixer, "failed to create the batch shader, drawing "
+        "pads separately");
+    video_mixer->batch_shader = NULL;
+  }
+
+  return gst_gl_context_gen_shader (context,
       gst_gl_shader_string_vertex_mat4_vertex_transform,
       video_mixer_f_src, &video_mixer->shader);
 }
@@ -1420,22 +1504,248 @@ _set_blend_state (GstGLVideoMixer * video_mixer, GstGLVideoMixerPad * mix_pad)
   return TRUE;
 }
 
+static gboolean
+_blend_state_equal (GstGLVideoMixerPad * a, GstGLVideoMixerPad * b)
+{
+  return a->blend_equation_rgb == b->blend_equation_rgb
+      && a->blend_equation_alpha == b->blend_equation_alpha
+      && a->blend_function_src_rgb == b->blend_function_src_rgb
+      && a->blend_function_src_alpha == b->blend_function_src_alpha
+      && a->blend_function_dst_rgb == b->blend_function_dst_rgb
+      && a->blend_function_dst_alpha == b->blend_function_dst_alpha
+      && a->blend_constant_color_red == b->blend_constant_color_red
+      && a->blend_constant_color_green == b->blend_constant_color_green
+      && a->blend_constant_color_blue == b->blend_constant_color_blue
+      && a->blend_constant_color_alpha == b->blend_constant_color_alpha;
+}
+
+/* computes the position (x, y, z) and texture coordinates (s, t) of the
+ * four corners of the pad in the output frame */
+static void
+_update_pad_vertices (GstGLVideoMixer * video_mixer, GstGLVideoMixerPad * pad)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (video_mixer);
+  guint out_width, out_height;
+  gint pad_width, pad_height;
+  gfloat w, h;
+
+  /* *INDENT-OFF* */
+  static const gfloat v_vertices[] = {
+    -1.0,-1.0,-1.0f, 0.0f, 0.0f,
+     1.0,-1.0,-1.0f, 1.0f, 0.0f,
+     1.0, 1.0,-1.0f, 1.0f, 1.0f,
+    -1.0, 1.0,-1.0f, 0.0f, 1.0f,
+  };
+  /* *INDENT-ON* */
+
+  out_width = GST_VIDEO_INFO_WIDTH (&vagg->info);
+  out_height = GST_VIDEO_INFO_HEIGHT (&vagg->info);
+
+  _mixer_pad_get_output_size (video_mixer, pad,
+      GST_VIDEO_INFO_PAR_N (&vagg->info),
+      GST_VIDEO_INFO_PAR_D (&vagg->info), &pad_width, &pad_height);
+
+  w = ((gfloat) pad_width / (gfloat) out_width);
+  h = ((gfloat) pad_height / (gfloat) out_height);
+
+  memcpy (pad->vertices, v_vertices, sizeof (v_vertices));
+
+  /* top-left */
+  pad->vertices[0] = pad->vertices[15] =
+      2.0f * (gfloat) pad->xpos / (gfloat) out_width - 1.0f;
+  /* bottom-left */
+  pad->vertices[1] = pad->vertices[6] =
+      2.0f * (gfloat) pad->ypos / (gfloat) out_height - 1.0f;
+  /* top-right */
+  pad->vertices[5] = pad->vertices[10] = pad->vertices[0] + 2.0f * w;
+  /* bottom-right */
+  pad->vertices[11] = pad->vertices[16] = pad->vertices[1] + 2.0f * h;
+
+  pad->have_vertices = TRUE;
+  pad->upload_vertices = TRUE;
+}
+
+/* draws a single pad with the generic shader, which also handles the affine
+ * transformation meta of the input buffer */
+static void
+_draw_pad (GstGLVideoMixer * video_mixer, GstGLVideoMixerPad * pad,
+    GLint attr_position_loc, GLint attr_texture_loc)
+{
+  const GstGLFuncs *gl = GST_GL_BASE_MIXER (video_mixer)->context->gl_vtable;
+  GstGLMixerPad *mix_pad = GST_GL_MIXER_PAD (pad);
+  GstVideoAggregatorPad *vagg_pad = GST_VIDEO_AGGREGATOR_PAD (pad);
+  GstVideoAffineTransformationMeta *af_meta;
+  gfloat matrix[16];
+
+  if (!_set_blend_state (video_mixer, pad)) {
+    GST_FIXME_OBJECT (pad, "skipping due to incorrect blend parameters");
+    return;
+  }
+
+  GST_TRACE ("processing texture:%u at %f,%f %fx%f with alpha:%f",
+      mix_pad->current_texture, pad->vertices[0], pad->vertices[1],
+      pad->vertices[5], pad->vertices[11], pad->alpha);
+
+  gst_gl_shader_use (video_mixer->shader);
+
+  _init_vbo_indices (video_mixer);
+
+  if (!pad->vertex_buffer || pad->upload_vertices) {
+    if (!pad->vertex_buffer)
+      gl->GenBuffers (1, &pad->vertex_buffer);
+
+    gl->BindBuffer (GL_ARRAY_BUFFER, pad->vertex_buffer);
+    gl->BufferData (GL_ARRAY_BUFFER, 4 * 5 * sizeof (GLfloat), pad->vertices,
+        GL_STATIC_DRAW);
+
+    pad->upload_vertices = FALSE;
+  } else {
+    gl->BindBuffer (GL_ARRAY_BUFFER, pad->vertex_buffer);
+  }
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, video_mixer->vbo_indices);
+
+  gl->ActiveTexture (GL_TEXTURE0);
+  gl->BindTexture (GL_TEXTURE_2D, mix_pad->current_texture);
+  gst_gl_shader_set_uniform_1i (video_mixer->shader, "texture", 0);
+  gst_gl_shader_set_uniform_1f (video_mixer->shader, "alpha", pad->alpha);
+
+  af_meta = gst_buffer_get_video_affine_transformation_meta (vagg_pad->buffer);
+  gst_gl_get_affine_transformation_meta_as_ndc_ext (af_meta, matrix);
+  gst_gl_shader_set_uniform_matrix_4fv (video_mixer->shader,
+      "u_transformation", 1, FALSE, matrix);
+
+  gl->EnableVertexAttribArray (attr_position_loc);
+  gl->EnableVertexAttribArray (attr_texture_loc);
+
+  gl->VertexAttribPointer (attr_position_loc, 3, GL_FLOAT,
+      GL_FALSE, 5 * sizeof (GLfloat), (void *) 0);
+
+  gl->VertexAttribPointer (attr_texture_loc, 2, GL_FLOAT,
+      GL_FALSE, 5 * sizeof (GLfloat), (void *) (3 * sizeof (GLfloat)));
+
+  gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+
+  gl->DisableVertexAttribArray (attr_position_loc);
+  gl->DisableVertexAttribArray (attr_texture_loc);
+}
+
+static void
+_init_batch_indices (GstGLVideoMixer * mixer)
+{
+  const GstGLFuncs *gl = GST_GL_BASE_MIXER (mixer)->context->gl_vtable;
+  GLushort batch_indices[BATCH_SIZE * 6];
+  guint i, j;
+
+  if (mixer->batch_indices)
+    return;
+
+  for (i = 0; i < BATCH_SIZE; i++) {
+    for (j = 0; j < 6; j++)
+      batch_indices[i * 6 + j] = i * 4 + indices[j];
+  }
+
+  gl->GenBuffers (1, &mixer->batch_indices);
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, mixer->batch_indices);
+  gl->BufferData (GL_ELEMENT_ARRAY_BUFFER, sizeof (batch_indices),
+      batch_indices, GL_STATIC_DRAW);
+}
+
+/* draws up to BATCH_SIZE pads sharing the same blend state with a single
+ * draw call, each pad samples its own texture unit. Overlapping pads are
+ * still blended in order as primitives are rasterized in submission order */
+static void
+_draw_batch (GstGLVideoMixer * video_mixer, GstGLVideoMixerPad ** pads,
+    guint n_pads)
+{
+  const GstGLFuncs *gl = GST_GL_BASE_MIXER (video_mixer)->context->gl_vtable;
+  GstGLShader *shader = video_mixer->batch_shader;
+  gfloat vertices[BATCH_SIZE * 4 * 7];
+  static const gint units[BATCH_SIZE] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+  GLint attr_position_loc, attr_texture_loc, attr_params_loc;
+  guint i, j;
+
+  if (n_pads == 0)
+    return;
+
+  if (!_set_blend_state (video_mixer, pads[0])) {
+    GST_FIXME_OBJECT (pads[0], "skipping %u pads due to incorrect blend "
+        "parameters", n_pads);
+    return;
+  }
+
+  for (i = 0; i < n_pads; i++) {
+    GstGLVideoMixerPad *pad = pads[i];
+
+    for (j = 0; j < 4; j++) {
+      gfloat *v = &vertices[(i * 4 + j) * 7];
+
+      memcpy (v, &pad->vertices[j * 5], 5 * sizeof (gfloat));
+      v[5] = pad->alpha;
+      v[6] = i;
+    }
+
+    gl->ActiveTexture (GL_TEXTURE0 + i);
+    gl->BindTexture (GL_TEXTURE_2D, GST_GL_MIXER_PAD (pad)->current_texture);
+  }
+
+  GST_TRACE ("processing %u textures in one batch", n_pads);
+
+  gst_gl_shader_use (shader);
+  gst_gl_shader_set_uniform_1iv (shader, "textures", BATCH_SIZE, units);
+
+  attr_position_loc = gst_gl_shader_get_attribute_location (shader,
+      "a_position");
+  attr_texture_loc = gst_gl_shader_get_attribute_location (shader,
+      "a_texcoord");
+  attr_params_loc = gst_gl_shader_get_attribute_location (shader, "a_params");
+
+  _init_batch_indices (video_mixer);
+
+  /* the vertices are respecified every time, which lets the driver orphan
+   * the storage still in use by the previous batch */
+  if (!video_mixer->batch_vbo)
+    gl->GenBuffers (1, &video_mixer->batch_vbo);
+  gl->BindBuffer (GL_ARRAY_BUFFER, video_mixer->batch_vbo);
+  gl->BufferData (GL_ARRAY_BUFFER, n_pads * 4 * 7 * sizeof (GLfloat),
+      vertices, GL_STREAM_DRAW);
+  gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, video_mixer->batch_indices);
+
+  gl->EnableVertexAttribArray (attr_position_loc);
+  gl->EnableVertexAttribArray (attr_texture_loc);
+  gl->EnableVertexAttribArray (attr_params_loc);
+
+  gl->VertexAttribPointer (attr_position_loc, 3, GL_FLOAT,
+      GL_FALSE, 7 * sizeof (GLfloat), (void *) 0);
+  gl->VertexAttribPointer (attr_texture_loc, 2, GL_FLOAT,
+      GL_FALSE, 7 * sizeof (GLfloat), (void *) (3 * sizeof (GLfloat)));
+  gl->VertexAttribPointer (attr_params_loc, 2, GL_FLOAT,
+      GL_FALSE, 7 * sizeof (GLfloat), (void *) (5 * sizeof (GLfloat)));
+
+  gl->DrawElements (GL_TRIANGLES, n_pads * 6, GL_UNSIGNED_SHORT, 0);
+
+  gl->DisableVertexAttribArray (attr_position_loc);
+  gl->DisableVertexAttribArray (attr_texture_loc);
+  gl->DisableVertexAttribArray (attr_params_loc);
+
+  for (i = n_pads; i > 0; i--) {
+    gl->ActiveTexture (GL_TEXTURE0 + i - 1);
+    gl->BindTexture (GL_TEXTURE_2D, 0);
+  }
+}
+
 /* opengl scene, params: input texture (not the output mixer->texture) */
 static gboolean
 gst_gl_video_mixer_callback (gpointer stuff)
 {
   GstGLVideoMixer *video_mixer = GST_GL_VIDEO_MIXER (stuff);
-  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (stuff);
   GstGLMixer *mixer = GST_GL_MIXER (video_mixer);
   GstGLFuncs *gl = GST_GL_BASE_MIXER (mixer)->context->gl_vtable;
+  GstGLVideoMixerPad *batch[BATCH_SIZE];
+  guint n_batch = 0;
   GLint attr_position_loc = 0;
   GLint attr_texture_loc = 0;
-  guint out_width, out_height;
   GList *walk;
 
-  out_width = GST_VIDEO_INFO_WIDTH (&vagg->info);
-  out_height = GST_VIDEO_INFO_HEIGHT (&vagg->info);
-
   gst_gl_context_clear_shader (GST_GL_BASE_MIXER (mixer)->context);
   gl->BindTexture (GL_TEXTURE_2D, 0);
 
@@ -1451,8 +1761,6 @@ gst_gl_video_mixer_callback (gpointer stuff)
   if (!_draw_background (video_mixer))
     return FALSE;
 
-  gst_gl_shader_use (video_mixer->shader);
-
   attr_position_loc =
       gst_gl_shader_get_attribute_location (video_mixer->shader, "a_position");
   attr_texture_loc =
@@ -1467,18 +1775,8 @@ gst_gl_video_mixer_callback (gpointer stuff)
     GstGLVideoMixerPad *pad = walk->data;
     GstVideoAggregatorPad *vagg_pad = walk->data;
     GstVideoInfo *v_info;
-    guint in_tex;
     guint in_width, in_height;
 
-    /* *INDENT-OFF* */
-    gfloat v_vertices[] = {
-      -1.0,-1.0,-1.0f, 0.0f, 0.0f,
-       1.0,-1.0,-1.0f, 1.0f, 0.0f,
-       1.0, 1.0,-1.0f, 1.0f, 1.0f,
-      -1.0, 1.0,-1.0f, 0.0f, 1.0f,
-    };
-    /* *INDENT-ON* */
-
     v_info = &GST_VIDEO_AGGREGATOR_PAD (pad)->info;
     in_width = GST_VIDEO_INFO_WIDTH (v_info);
     in_height = GST_VIDEO_INFO_HEIGHT (v_info);
@@ -1491,92 +1789,38 @@ gst_gl_video_mixer_callback (gpointer stuff)
       continue;
     }
 
-    if (!_set_blend_state (video_mixer, pad)) {
-      GST_FIXME_OBJECT (pad, "skipping due to incorrect blend parameters");
-      walk = g_list_next (walk);
-      continue;
-    }
-
-    in_tex = mix_pad->current_texture;
-
-    _init_vbo_indices (video_mixer);
-
-    if (video_mixer->output_geo_change
-        || pad->geometry_change || !pad->vertex_buffer) {
-      gint pad_width, pad_height;
-      gfloat w, h;
-
-      _mixer_pad_get_output_size (video_mixer, pad,
-          GST_VIDEO_INFO_PAR_N (&vagg->info),
-          GST_VIDEO_INFO_PAR_D (&vagg->info), &pad_width, &pad_height);
-
-      w = ((gfloat) pad_width / (gfloat) out_width);
-      h = ((gfloat) pad_height / (gfloat) out_height);
-
-      /* top-left */
-      v_vertices[0] = v_vertices[15] =
-          2.0f * (gfloat) pad->xpos / (gfloat) out_width - 1.0f;
-      /* bottom-left */
-      v_vertices[1] = v_vertices[6] =
-          2.0f * (gfloat) pad->ypos / (gfloat) out_height - 1.0f;
-      /* top-right */
-      v_vertices[5] = v_vertices[10] = v_vertices[0] + 2.0f * w;
-      /* bottom-right */
-      v_vertices[11] = v_vertices[16] = v_vertices[1] + 2.0f * h;
-      GST_TRACE ("processing texture:%u dimensions:%ux%u, at %f,%f %fx%f with "
-          "alpha:%f", in_tex, in_width, in_height, v_vertices[0], v_vertices[1],
-          v_vertices[5], v_vertices[11], pad->alpha);
-
-      if (!pad->vertex_buffer)
-        gl->GenBuffers (1, &pad->vertex_buffer);
-
-      gl->BindBuffer (GL_ARRAY_BUFFER, pad->vertex_buffer);
-
-      gl->BufferData (GL_ARRAY_BUFFER, 4 * 5 * sizeof (GLfloat), v_vertices,
-          GL_STATIC_DRAW);
-
+    if (video_mixer->output_geo_change || pad->geometry_change
+        || !pad->have_vertices) {
+      _update_pad_vertices (video_mixer, pad);
       pad->geometry_change = FALSE;
-    } else {
-      gl->BindBuffer (GL_ARRAY_BUFFER, pad->vertex_buffer);
     }
-    gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, video_mixer->vbo_indices);
 
-    gl->ActiveTexture (GL_TEXTURE0);
-    gl->BindTexture (GL_TEXTURE_2D, in_tex);
-    gst_gl_shader_set_uniform_1i (video_mixer->shader, "texture", 0);
-    gst_gl_shader_set_uniform_1f (video_mixer->shader, "alpha", pad->alpha);
+    /* a batch only shares one blend state and cannot apply per pad
+     * transformations */
+    if (n_batch > 0 && (n_batch == BATCH_SIZE
+            || !_blend_state_equal (batch[0], pad))) {
+      _draw_batch (video_mixer, batch, n_batch);
+      n_batch = 0;
+    }
 
+    if (video_mixer->batch_shader
+        && !gst_buffer_get_video_affine_transformation_meta (vagg_pad->buffer))
     {
-      GstVideoAffineTransformationMeta *af_meta;
-      gfloat matrix[16];
-
-      af_meta =
-          gst_buffer_get_video_affine_transformation_meta (vagg_pad->buffer);
-      gst_gl_get_affine_transformation_meta_as_ndc_ext (af_meta, matrix);
-      gst_gl_shader_set_uniform_matrix_4fv (video_mixer->shader,
-          "u_transformation", 1, FALSE, matrix);
+      batch[n_batch++] = pad;
+    } else {
+      _draw_batch (video_mixer, batch, n_batch);
+      n_batch = 0;
+      _draw_pad (video_mixer, pad, attr_position_loc, attr_texture_loc);
     }
 
-    gl->EnableVertexAttribArray (attr_position_loc);
-    gl->EnableVertexAttribArray (attr_texture_loc);
-
-    gl->VertexAttribPointer (attr_position_loc, 3, GL_FLOAT,
-        GL_FALSE, 5 * sizeof (GLfloat), (void *) 0);
-
-    gl->VertexAttribPointer (attr_texture_loc, 2, GL_FLOAT,
-        GL_FALSE, 5 * sizeof (GLfloat), (void *) (3 * sizeof (GLfloat)));
-
-    gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
-
     walk = g_list_next (walk);
   }
 
+  _draw_batch (video_mixer, batch, n_batch);
+
   video_mixer->output_geo_change = FALSE;
   GST_OBJECT_UNLOCK (video_mixer);
 
-  gl->DisableVertexAttribArray (attr_position_loc);
-  gl->DisableVertexAttribArray (attr_texture_loc);
-
   if (gl->GenVertexArrays)
     gl->BindVertexArray (0);
 
@@ -121,10 +121,13 @@ struct _GstGLVideoMixer
 
     GstGLShader *shader;
     GstGLShader *checker;
+    GstGLShader *batch_shader;
 
     GLuint vao;
     GLuint vbo_indices;
     GLuint checker_vbo;
+    GLuint batch_vbo;
+    GLuint batch_indices;
     GstGLMemory *out_tex;
 
     gboolean output_geo_change;
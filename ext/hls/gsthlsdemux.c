@@ -61,6 +61,14 @@ GST_DEBUG_CATEGORY (gst_hls_demux_debug);
 #define GST_M3U8_CLIENT_LOCK(l) /* FIXME */
 #define GST_M3U8_CLIENT_UNLOCK(l)       /* FIXME */
 
+/* Keys are fetched again once they are older than this, in case the server
+ * rotates the key behind the same URI */
+#define KEY_CACHE_TTL (10 * 60 * G_TIME_SPAN_SECOND)
+
+/* Encrypted data is accumulated and decrypted in blocks of at least this
+ * size to amortize the per call overhead of the cipher */
+#define DECRYPT_BLOCK_SIZE (64 * 1024)
+
 /* GObject */
 static void gst_hls_demux_finalize (GObject * obj);
 
@@ -77,6 +85,8 @@ static gboolean gst_hls_demux_change_playlist (GstHLSDemux * demux,
     guint max_bitrate, gboolean * changed);
 static GstBuffer *gst_hls_demux_decrypt_fragment (GstHLSDemux * demux,
     GstHLSDemuxStream * stream, GstBuffer * encrypted_buffer, GError ** err);
+static GstFlowReturn gst_hls_demux_stream_decrypt_pending (GstHLSDemux *
+    demux, GstHLSDemuxStream * stream, gboolean flush, GstBuffer ** buffer);
 static gboolean
 gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
     const guint8 * key_data, const guint8 * iv_data);
@@ -107,6 +117,8 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static gboolean gst_hls_demux_peek_fragment (GstAdaptiveDemuxStream * stream,
+    guint index, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
@@ -174,6 +186,7 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment = gst_hls_demux_peek_fragment;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
@@ -258,7 +271,6 @@ gst_hls_demux_stream_clear_pending_data (GstHLSDemuxStream * hls_stream)
   gst_buffer_replace (&hls_stream->pending_typefind_buffer, NULL);
   gst_buffer_replace (&hls_stream->pending_pcr_buffer, NULL);
   hls_stream->current_offset = -1;
-  gst_hls_demux_stream_decrypt_end (hls_stream);
 }
 
 static void
@@ -450,6 +462,7 @@ gst_hls_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
       (guint) current_sequence);
   hls_stream->reset_pts = TRUE;
   hls_stream->playlist->sequence = current_sequence;
+  hls_stream->playlist->current_part = -1;
   hls_stream->playlist->current_file = walk;
   hls_stream->playlist->sequence_position = current_pos;
   GST_M3U8_CLIENT_UNLOCK (hlsdemux->client);
@@ -572,6 +585,9 @@ gst_hls_demux_set_current_variant (GstHLSDemux * hlsdemux,
     variant->m3u8->sequence_position =
         hlsdemux->current_variant->m3u8->sequence_position;
     variant->m3u8->sequence = hlsdemux->current_variant->m3u8->sequence;
+    /* parts of the different variants are aligned */
+    variant->m3u8->current_part =
+        hlsdemux->current_variant->m3u8->current_part;
 
     GST_DEBUG_OBJECT (hlsdemux,
         "Switching Variant. Copying over sequence %" G_GINT64_FORMAT
@@ -588,6 +604,8 @@ gst_hls_demux_set_current_variant (GstHLSDemux * hlsdemux,
 
         if (new_media) {
           new_media->playlist->sequence = old_media->playlist->sequence;
+          new_media->playlist->current_part =
+              old_media->playlist->current_part;
           new_media->playlist->sequence_position =
               old_media->playlist->sequence_position;
         }
@@ -608,6 +626,7 @@ gst_hls_demux_process_manifest (GstAdaptiveDemux * demux, GstBuffer * buf)
   GstHLSVariantStream *variant;
   GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (demux);
   gchar *playlist = NULL;
+  guint64 startup_bitrate;
 
   GST_INFO_OBJECT (demux, "Initial playlist location: %s (base uri: %s)",
       demux->manifest_uri, demux->manifest_base_uri);
@@ -633,12 +652,13 @@ gst_hls_demux_process_manifest (GstAdaptiveDemux * demux, GstBuffer * buf)
   }
 
   /* select the initial variant stream */
-  if (demux->connection_speed == 0) {
+  startup_bitrate = gst_adaptive_demux_get_startup_bitrate (demux);
+  if (startup_bitrate == 0) {
     variant = hlsdemux->master->default_variant;
   } else {
     variant =
         gst_hls_master_playlist_get_variant_for_bitrate (hlsdemux->master,
-        NULL, demux->connection_speed);
+        NULL, MIN (startup_bitrate, G_MAXUINT));
   }
 
   if (variant) {
@@ -686,24 +706,41 @@ gst_hls_demux_is_live (GstAdaptiveDemux * demux)
   return is_live;
 }
 
-static const GstHLSKey *
+static gboolean
+gst_hls_demux_key_expired (gpointer key_url, gpointer value, gpointer now)
+{
+  GstHLSKey *key = value;
+
+  return *(gint64 *) now - key->fetch_time >= KEY_CACHE_TTL;
+}
+
+/* Copies the key into @key_data as the cache entry can be dropped by another
+ * stream once the lock is released */
+static gboolean
 gst_hls_demux_get_key (GstHLSDemux * demux, const gchar * key_url,
-    const gchar * referer, gboolean allow_cache)
+    const gchar * referer, gboolean allow_cache, guint8 * key_data)
 {
   GstFragment *key_fragment;
   GstBuffer *key_buffer;
   GstHLSKey *key;
   GError *err = NULL;
+  gint64 now;
 
   GST_LOG_OBJECT (demux, "Looking up key for key url %s", key_url);
 
   g_mutex_lock (&demux->keys_lock);
 
+  now = g_get_monotonic_time ();
   key = g_hash_table_lookup (demux->keys, key_url);
 
   if (key != NULL) {
-    GST_LOG_OBJECT (demux, "Found key for key url %s in key cache", key_url);
-    goto out;
+    if (!gst_hls_demux_key_expired (NULL, key, &now)) {
+      GST_LOG_OBJECT (demux, "Found key for key url %s in key cache",
+          key_url);
+      goto out;
+    }
+    GST_DEBUG_OBJECT (demux, "Cached key for key url %s expired", key_url);
+    key = NULL;
   }
 
   GST_INFO_OBJECT (demux, "Fetching key %s", key_url);
@@ -724,7 +761,10 @@ gst_hls_demux_get_key (GstHLSDemux * demux, const gchar * key_url,
   key = g_new0 (GstHLSKey, 1);
   if (gst_buffer_extract (key_buffer, 0, key->data, 16) < 16)
     GST_WARNING_OBJECT (demux, "Download decryption key is too short!");
+  key->fetch_time = g_get_monotonic_time ();
 
+  /* drop the keys nobody asked for in a while before adding the new one */
+  g_hash_table_foreach_remove (demux->keys, gst_hls_demux_key_expired, &now);
   g_hash_table_insert (demux->keys, g_strdup (key_url), key);
 
   gst_buffer_unref (key_buffer);
@@ -732,12 +772,17 @@ gst_hls_demux_get_key (GstHLSDemux * demux, const gchar * key_url,
 
 out:
 
+  if (key != NULL)
+    memcpy (key_data, key->data, 16);
+
   g_mutex_unlock (&demux->keys_lock);
 
-  if (key != NULL)
-    GST_MEMDUMP_OBJECT (demux, "Key", key->data, 16);
+  if (key == NULL)
+    return FALSE;
 
-  return key;
+  GST_MEMDUMP_OBJECT (demux, "Key", key_data, 16);
+
+  return TRUE;
 }
 
 static gboolean
@@ -746,7 +791,7 @@ gst_hls_demux_start_fragment (GstAdaptiveDemux * demux,
 {
   GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
   GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (demux);
-  const GstHLSKey *key;
+  guint8 key[16];
   GstM3U8 *m3u8;
 
   gst_hls_demux_stream_clear_pending_data (hls_stream);
@@ -763,17 +808,22 @@ gst_hls_demux_start_fragment (GstAdaptiveDemux * demux,
 
   m3u8 = gst_hls_demux_stream_get_m3u8 (hls_stream);
 
-  key = gst_hls_demux_get_key (hlsdemux, hls_stream->current_key,
-      m3u8->uri, m3u8->allowcache);
-
-  if (key == NULL)
+  if (!gst_hls_demux_get_key (hlsdemux, hls_stream->current_key,
+          m3u8->uri, m3u8->allowcache, key))
     goto key_failed;
 
-  gst_hls_demux_stream_decrypt_start (hls_stream, key->data,
-      hls_stream->current_iv);
+  if (!gst_hls_demux_stream_decrypt_start (hls_stream, key,
+          hls_stream->current_iv))
+    goto decrypt_failed;
 
   return TRUE;
 
+decrypt_failed:
+  {
+    GST_ELEMENT_ERROR (demux, STREAM, DECRYPT,
+        ("Couldn't set up the decryption"), (NULL));
+    return FALSE;
+  }
 key_failed:
   {
     GST_ELEMENT_ERROR (demux, STREAM, DEMUX,
@@ -900,8 +950,19 @@ gst_hls_demux_finish_fragment (GstAdaptiveDemux * demux,
   GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);   // FIXME: pass HlsStream into function
   GstFlowReturn ret = GST_FLOW_OK;
 
-  if (hls_stream->current_key)
-    gst_hls_demux_stream_decrypt_end (hls_stream);
+  if (stream->last_ret == GST_FLOW_OK && hls_stream->current_key) {
+    GstBuffer *buffer = NULL;
+
+    /* decrypt what is left of the fragment */
+    ret = gst_hls_demux_stream_decrypt_pending (GST_HLS_DEMUX_CAST (demux),
+        hls_stream, TRUE, &buffer);
+    if (ret == GST_FLOW_OK)
+      ret = gst_hls_demux_handle_buffer (demux, stream, buffer, FALSE);
+    if (ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED) {
+      gst_hls_demux_stream_clear_pending_data (hls_stream);
+      return ret;
+    }
+  }
 
   if (stream->last_ret == GST_FLOW_OK) {
     if (hls_stream->pending_decrypted_buffer) {
@@ -967,39 +1028,75 @@ gst_hls_demux_data_received (GstAdaptiveDemux * demux,
 
   /* Is it encrypted? */
   if (hls_stream->current_key) {
-    GError *err = NULL;
-    gsize size;
-    GstBuffer *tmp_buffer;
+    GstFlowReturn ret;
 
     if (hls_stream->pending_encrypted_data == NULL)
       hls_stream->pending_encrypted_data = gst_adapter_new ();
 
     gst_adapter_push (hls_stream->pending_encrypted_data, buffer);
-    size = gst_adapter_available (hls_stream->pending_encrypted_data);
+    buffer = NULL;
 
-    /* must be a multiple of 16 */
-    size &= (~0xF);
+    ret = gst_hls_demux_stream_decrypt_pending (hlsdemux, hls_stream, FALSE,
+        &buffer);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
 
-    if (size == 0) {
-      return GST_FLOW_OK;
-    }
+  return gst_hls_demux_handle_buffer (demux, stream, buffer, FALSE);
+}
 
-    buffer = gst_adapter_take_buffer (hls_stream->pending_encrypted_data, size);
-    buffer =
-        gst_hls_demux_decrypt_fragment (hlsdemux, hls_stream, buffer, &err);
-    if (buffer == NULL) {
-      GST_ELEMENT_ERROR (demux, STREAM, DECODE, ("Failed to decrypt buffer"),
-          ("decryption failed %s", err->message));
-      g_error_free (err);
-      return GST_FLOW_ERROR;
-    }
+/* Decrypts the encrypted data accumulated so far once there is at least
+ * DECRYPT_BLOCK_SIZE of it, or all of it when @flush is set. The newly
+ * decrypted buffer is kept back for the pkcs7 unpadding at the end of the
+ * fragment and the one it replaces, if any, is returned in @buffer */
+static GstFlowReturn
+gst_hls_demux_stream_decrypt_pending (GstHLSDemux * demux,
+    GstHLSDemuxStream * hls_stream, gboolean flush, GstBuffer ** buffer)
+{
+  GstBuffer *decrypted;
+  GError *err = NULL;
+  gsize available, size;
+
+  *buffer = NULL;
+
+  if (hls_stream->pending_encrypted_data == NULL)
+    return GST_FLOW_OK;
+
+  available = gst_adapter_available (hls_stream->pending_encrypted_data);
+  if (!flush && available < DECRYPT_BLOCK_SIZE)
+    return GST_FLOW_OK;
 
-    tmp_buffer = hls_stream->pending_decrypted_buffer;
-    hls_stream->pending_decrypted_buffer = buffer;
-    buffer = tmp_buffer;
+  /* must be a multiple of 16 */
+  size = available & (~0xF);
+
+  if (size == 0)
+    decrypted = NULL;
+  else
+    decrypted = gst_adapter_take_buffer (hls_stream->pending_encrypted_data,
+        size);
+
+  if (flush && size != available) {
+    GST_WARNING_OBJECT (demux, "Dropping %" G_GSIZE_FORMAT " trailing bytes "
+        "of encrypted data", available - size);
+    gst_adapter_clear (hls_stream->pending_encrypted_data);
   }
 
-  return gst_hls_demux_handle_buffer (demux, stream, buffer, FALSE);
+  if (decrypted == NULL)
+    return GST_FLOW_OK;
+
+  decrypted = gst_hls_demux_decrypt_fragment (demux, hls_stream, decrypted,
+      &err);
+  if (decrypted == NULL) {
+    GST_ELEMENT_ERROR (demux, STREAM, DECODE, ("Failed to decrypt buffer"),
+        ("decryption failed %s", err->message));
+    g_error_free (err);
+    return GST_FLOW_ERROR;
+  }
+
+  *buffer = hls_stream->pending_decrypted_buffer;
+  hls_stream->pending_decrypted_buffer = decrypted;
+
+  return GST_FLOW_OK;
 }
 
 static void
@@ -1124,6 +1221,35 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_hls_demux_peek_fragment (GstAdaptiveDemuxStream * stream, guint index,
+    GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstHLSDemuxStream *hlsdemux_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
+  GstM3U8MediaFile *file;
+  GstM3U8 *m3u8;
+
+  m3u8 = gst_hls_demux_stream_get_m3u8 (hlsdemux_stream);
+
+  file = gst_m3u8_peek_fragment (m3u8, stream->demux->segment.rate > 0, index);
+  if (file == NULL)
+    return FALSE;
+
+  /* the key is only fetched once the fragment starts, the data is
+   * decrypted as it is pushed */
+  fragment->uri = g_strdup (file->uri);
+  fragment->range_start = file->offset;
+  if (file->size != -1)
+    fragment->range_end = file->offset + file->size - 1;
+  else
+    fragment->range_end = -1;
+  fragment->duration = file->duration;
+
+  gst_m3u8_media_file_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -1262,6 +1388,7 @@ gst_hls_demux_update_variant_playlist (GstHLSDemux * hlsdemux, gchar * data,
       /* FIXME: Deal with losing position due to missing an update */
       variant->m3u8->sequence_position = old->m3u8->sequence_position;
       variant->m3u8->sequence = old->m3u8->sequence;
+      variant->m3u8->current_part = old->m3u8->current_part;
     }
   }
 
@@ -1316,16 +1443,41 @@ gst_hls_demux_update_rendition_manifest (GstHLSDemux * demux,
   const gchar *main_uri;
   GstM3U8 *m3u8;
   gchar *uri = media->uri;
+  gchar *directives_uri;
+  gboolean directives = FALSE;
 
   main_uri = gst_adaptive_demux_get_manifest_ref_uri (adaptive_demux);
+  m3u8 = media->playlist;
+
+  directives_uri = gst_m3u8_get_reload_uri (m3u8);
+  if (directives_uri) {
+    download =
+        gst_uri_downloader_fetch_uri (adaptive_demux->downloader,
+        directives_uri, main_uri, TRUE, TRUE, TRUE, NULL);
+    g_free (directives_uri);
+
+    if (download) {
+      directives = TRUE;
+      goto have_playlist;
+    }
+    GST_INFO_OBJECT (demux, "Reload of %s with delivery directives failed, "
+        "polling it", uri);
+  }
+
+retry:
   download =
-      gst_uri_downloader_fetch_uri (adaptive_demux->downloader, uri, main_uri,
-      TRUE, TRUE, TRUE, err);
+      gst_uri_downloader_fetch_uri_if_modified (adaptive_demux->downloader,
+      uri, main_uri, TRUE, TRUE, TRUE, m3u8->entity_tag, m3u8->last_modified,
+      err);
 
   if (download == NULL)
     return FALSE;
 
-  m3u8 = media->playlist;
+  if (download->not_modified) {
+    GST_LOG_OBJECT (demux, "Playlist %s not modified", uri);
+    g_object_unref (download);
+    return TRUE;
+  }
 
   /* Set the base URI of the playlist to the redirect target if any */
   if (download->redirect_permanent && download->redirect_uri) {
@@ -1333,7 +1485,10 @@ gst_hls_demux_update_rendition_manifest (GstHLSDemux * demux,
   } else {
     gst_m3u8_set_uri (m3u8, download->uri, download->redirect_uri, media->name);
   }
+  gst_m3u8_set_cache_validators (m3u8, download->entity_tag,
+      download->last_modified);
 
+have_playlist:
   buf = gst_fragment_get_buffer (download);
   playlist = gst_hls_src_buf_to_utf8_playlist (buf);
   gst_buffer_unref (buf);
@@ -1347,6 +1502,13 @@ gst_hls_demux_update_rendition_manifest (GstHLSDemux * demux,
   }
 
   if (!gst_m3u8_update (m3u8, playlist)) {
+    /* The files skipped by a delta update are unknown, get all of them */
+    gst_m3u8_set_cache_validators (m3u8, NULL, NULL);
+    if (directives) {
+      GST_INFO_OBJECT (demux, "Couldn't merge the delta update of %s", uri);
+      directives = FALSE;
+      goto retry;
+    }
     GST_WARNING_OBJECT (demux, "Couldn't update playlist");
     g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_FAILED,
         "Couldn't update playlist");
@@ -1368,17 +1530,42 @@ gst_hls_demux_update_playlist (GstHLSDemux * demux, gboolean update,
   const gchar *main_uri;
   GstM3U8 *m3u8;
   gchar *uri;
+  gboolean directives, directives_failed = FALSE;
   gint i;
 
 retry:
-  uri = gst_m3u8_get_uri (demux->current_variant->m3u8);
+  /* Low latency servers can hold the reload until the playlist lists the
+   * next part, instead of us polling for it, and only send the changes of
+   * the playlist. Otherwise the playlist is only sent again if modified */
+  m3u8 = demux->current_variant->m3u8;
+  uri = NULL;
+  if (update && !main_checked && !directives_failed)
+    uri = gst_m3u8_get_reload_uri (m3u8);
+  directives = (uri != NULL);
   main_uri = gst_adaptive_demux_get_manifest_ref_uri (adaptive_demux);
-  download =
-      gst_uri_downloader_fetch_uri (adaptive_demux->downloader, uri, main_uri,
-      TRUE, TRUE, TRUE, err);
+  if (directives) {
+    download =
+        gst_uri_downloader_fetch_uri (adaptive_demux->downloader, uri,
+        main_uri, TRUE, TRUE, TRUE, err);
+  } else {
+    uri = gst_m3u8_get_uri (m3u8);
+    download =
+        gst_uri_downloader_fetch_uri_if_modified (adaptive_demux->downloader,
+        uri, main_uri, TRUE, TRUE, TRUE, update ? m3u8->entity_tag : NULL,
+        update ? m3u8->last_modified : NULL, err);
+  }
   if (download == NULL) {
     gchar *base_uri;
 
+    if (directives) {
+      GST_INFO_OBJECT (demux, "Reload of %s with delivery directives failed, "
+          "polling it", uri);
+      g_free (uri);
+      g_clear_error (err);
+      directives_failed = TRUE;
+      goto retry;
+    }
+
     if (!update || main_checked || demux->master->is_simple) {
       g_free (uri);
       return FALSE;
@@ -1435,13 +1622,26 @@ retry:
 
   m3u8 = demux->current_variant->m3u8;
 
-  /* Set the base URI of the playlist to the redirect target if any */
-  if (download->redirect_permanent && download->redirect_uri) {
-    gst_m3u8_set_uri (m3u8, download->redirect_uri, NULL,
-        demux->current_variant->name);
-  } else {
-    gst_m3u8_set_uri (m3u8, download->uri, download->redirect_uri,
+  if (download->not_modified) {
+    GST_LOG_OBJECT (demux, "Playlist of %s not modified",
         demux->current_variant->name);
+    g_object_unref (download);
+    goto update_renditions;
+  }
+
+  /* Set the base URI of the playlist to the redirect target if any. The
+   * URI of a reload with delivery directives only differs by its query,
+   * keep the playlist one then */
+  if (!directives) {
+    if (download->redirect_permanent && download->redirect_uri) {
+      gst_m3u8_set_uri (m3u8, download->redirect_uri, NULL,
+          demux->current_variant->name);
+    } else {
+      gst_m3u8_set_uri (m3u8, download->uri, download->redirect_uri,
+          demux->current_variant->name);
+    }
+    gst_m3u8_set_cache_validators (m3u8, download->entity_tag,
+        download->last_modified);
   }
 
   buf = gst_fragment_get_buffer (download);
@@ -1457,12 +1657,21 @@ retry:
   }
 
   if (!gst_m3u8_update (m3u8, playlist)) {
+    /* The files skipped by a delta update are unknown, get all of them */
+    gst_m3u8_set_cache_validators (m3u8, NULL, NULL);
+    if (directives) {
+      GST_INFO_OBJECT (demux, "Couldn't merge the delta update of %s",
+          demux->current_variant->name);
+      directives_failed = TRUE;
+      goto retry;
+    }
     GST_WARNING_OBJECT (demux, "Couldn't update playlist");
     g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_FAILED,
         "Couldn't update playlist");
     return FALSE;
   }
 
+update_renditions:
   for (i = 0; i < GST_HLS_N_MEDIA_TYPES; ++i) {
     GList *mlist = demux->current_variant->media[i];
 
@@ -1501,7 +1710,8 @@ retry:
         "sequence:%" G_GINT64_FORMAT " , first_sequence:%" G_GINT64_FORMAT
         " , last_sequence:%" G_GINT64_FORMAT, m3u8->sequence,
         first_sequence, last_sequence);
-    if (m3u8->sequence > last_sequence - 3) {
+    /* Playing the parts at the live edge is fine */
+    if (m3u8->current_part < 0 && m3u8->sequence > last_sequence - 3) {
       //demux->need_segment = TRUE;
       /* Make sure we never go below the minimum sequence number */
       m3u8->sequence = MAX (first_sequence, last_sequence - 3);
@@ -1657,23 +1867,40 @@ gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
 {
   EVP_CIPHER_CTX *ctx;
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
-  EVP_CIPHER_CTX_init (&stream->aes_ctx);
   ctx = &stream->aes_ctx;
 #else
-  stream->aes_ctx = EVP_CIPHER_CTX_new ();
+  if (stream->aes_ctx == NULL)
+    stream->aes_ctx = EVP_CIPHER_CTX_new ();
   ctx = stream->aes_ctx;
 #endif
-  if (!EVP_DecryptInit_ex (ctx, EVP_aes_128_cbc (), NULL, key_data, iv_data))
-    return FALSE;
+
+  if (stream->aes_key_set && memcmp (stream->aes_key, key_data, 16) == 0) {
+    /* keep the key schedule, only restart the chain with the new IV */
+    if (!EVP_DecryptInit_ex (ctx, NULL, NULL, NULL, iv_data))
+      goto error;
+  } else {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    if (!stream->aes_key_set)
+      EVP_CIPHER_CTX_init (ctx);
+#endif
+    if (!EVP_DecryptInit_ex (ctx, EVP_aes_128_cbc (), NULL, key_data,
+            iv_data))
+      goto error;
+    memcpy (stream->aes_key, key_data, 16);
+    stream->aes_key_set = TRUE;
+  }
   EVP_CIPHER_CTX_set_padding (ctx, 0);
   return TRUE;
+
+error:
+  gst_hls_demux_stream_decrypt_end (stream);
+  return FALSE;
 }
 
 static gboolean
-decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
-    const guint8 * encrypted_data, guint8 * decrypted_data)
+decrypt_fragment (GstHLSDemuxStream * stream, gsize length, guint8 * data)
 {
-  int len, flen = 0;
+  int len;
   EVP_CIPHER_CTX *ctx;
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
@@ -1685,11 +1912,12 @@ decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
   if (G_UNLIKELY (length > G_MAXINT || length % 16 != 0))
     return FALSE;
 
+  /* without padding the whole input is output right away, so the context
+   * can carry on with the next block of the fragment */
   len = (int) length;
-  if (!EVP_DecryptUpdate (ctx, decrypted_data, &len, encrypted_data, len))
+  if (!EVP_DecryptUpdate (ctx, data, &len, data, len))
     return FALSE;
-  EVP_DecryptFinal_ex (ctx, decrypted_data + len, &flen);
-  g_return_val_if_fail (len + flen == length, FALSE);
+  g_return_val_if_fail (len == length, FALSE);
   return TRUE;
 }
 
@@ -1702,6 +1930,7 @@ gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
   EVP_CIPHER_CTX_free (stream->aes_ctx);
   stream->aes_ctx = NULL;
 #endif
+  stream->aes_key_set = FALSE;
 }
 
 #elif defined(HAVE_NETTLE)
@@ -1709,21 +1938,23 @@ static gboolean
 gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
     const guint8 * key_data, const guint8 * iv_data)
 {
-  aes_set_decrypt_key (&stream->aes_ctx.ctx, 16, key_data);
+  if (!stream->aes_key_set || memcmp (stream->aes_key, key_data, 16) != 0) {
+    aes_set_decrypt_key (&stream->aes_ctx.ctx, 16, key_data);
+    memcpy (stream->aes_key, key_data, 16);
+    stream->aes_key_set = TRUE;
+  }
   CBC_SET_IV (&stream->aes_ctx, iv_data);
 
   return TRUE;
 }
 
 static gboolean
-decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
-    const guint8 * encrypted_data, guint8 * decrypted_data)
+decrypt_fragment (GstHLSDemuxStream * stream, gsize length, guint8 * data)
 {
   if (length % 16 != 0)
     return FALSE;
 
-  CBC_DECRYPT (&stream->aes_ctx, aes_decrypt, length, decrypted_data,
-      encrypted_data);
+  CBC_DECRYPT (&stream->aes_ctx, aes_decrypt, length, data, data);
 
   return TRUE;
 }
@@ -1731,7 +1962,7 @@ decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
 static void
 gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
 {
-  /* NOP */
+  stream->aes_key_set = FALSE;
 }
 
 #else
@@ -1742,34 +1973,38 @@ gst_hls_demux_stream_decrypt_start (GstHLSDemuxStream * stream,
   gcry_error_t err = 0;
   gboolean ret = FALSE;
 
-  err =
-      gcry_cipher_open (&stream->aes_ctx, GCRY_CIPHER_AES128,
-      GCRY_CIPHER_MODE_CBC, 0);
-  if (err)
-    goto out;
-  err = gcry_cipher_setkey (stream->aes_ctx, key_data, 16);
-  if (err)
-    goto out;
+  if (stream->aes_ctx == NULL) {
+    err =
+        gcry_cipher_open (&stream->aes_ctx, GCRY_CIPHER_AES128,
+        GCRY_CIPHER_MODE_CBC, 0);
+    if (err)
+      goto out;
+  }
+  if (!stream->aes_key_set || memcmp (stream->aes_key, key_data, 16) != 0) {
+    err = gcry_cipher_setkey (stream->aes_ctx, key_data, 16);
+    if (err)
+      goto out;
+    memcpy (stream->aes_key, key_data, 16);
+    stream->aes_key_set = TRUE;
+  }
   err = gcry_cipher_setiv (stream->aes_ctx, iv_data, 16);
   if (!err)
     ret = TRUE;
 
 out:
   if (!ret)
-    if (stream->aes_ctx)
-      gcry_cipher_close (stream->aes_ctx);
+    gst_hls_demux_stream_decrypt_end (stream);
 
   return ret;
 }
 
 static gboolean
-decrypt_fragment (GstHLSDemuxStream * stream, gsize length,
-    const guint8 * encrypted_data, guint8 * decrypted_data)
+decrypt_fragment (GstHLSDemuxStream * stream, gsize length, guint8 * data)
 {
   gcry_error_t err = 0;
 
-  err = gcry_cipher_decrypt (stream->aes_ctx, decrypted_data, length,
-      encrypted_data, length);
+  /* decrypts in place */
+  err = gcry_cipher_decrypt (stream->aes_ctx, data, length, NULL, 0);
 
   return err == 0;
 }
@@ -1781,45 +2016,39 @@ gst_hls_demux_stream_decrypt_end (GstHLSDemuxStream * stream)
     gcry_cipher_close (stream->aes_ctx);
     stream->aes_ctx = NULL;
   }
+  stream->aes_key_set = FALSE;
 }
 #endif
 
+/* Decrypts in place, the data is only copied when the memory of the buffer
+ * is shared */
 static GstBuffer *
 gst_hls_demux_decrypt_fragment (GstHLSDemux * demux, GstHLSDemuxStream * stream,
     GstBuffer * encrypted_buffer, GError ** err)
 {
-  GstBuffer *decrypted_buffer = NULL;
-  GstMapInfo encrypted_info, decrypted_info;
+  GstBuffer *buffer;
+  GstMapInfo info;
 
-  decrypted_buffer =
-      gst_buffer_new_allocate (NULL, gst_buffer_get_size (encrypted_buffer),
-      NULL);
+  buffer = gst_buffer_make_writable (encrypted_buffer);
 
-  gst_buffer_map (encrypted_buffer, &encrypted_info, GST_MAP_READ);
-  gst_buffer_map (decrypted_buffer, &decrypted_info, GST_MAP_WRITE);
+  if (!gst_buffer_map (buffer, &info, GST_MAP_READWRITE))
+    goto map_error;
 
-  if (!decrypt_fragment (stream, encrypted_info.size,
-          encrypted_info.data, decrypted_info.data))
+  if (!decrypt_fragment (stream, info.size, info.data))
     goto decrypt_error;
 
+  gst_buffer_unmap (buffer, &info);
 
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
-
-  gst_buffer_unref (encrypted_buffer);
-
-  return decrypted_buffer;
+  return buffer;
 
 decrypt_error:
+  gst_buffer_unmap (buffer, &info);
+map_error:
   GST_ERROR_OBJECT (demux, "Failed to decrypt fragment");
   g_set_error (err, GST_STREAM_ERROR, GST_STREAM_ERROR_DECRYPT,
       "Failed to decrypt fragment");
 
-  gst_buffer_unmap (decrypted_buffer, &decrypted_info);
-  gst_buffer_unmap (encrypted_buffer, &encrypted_info);
-
-  gst_buffer_unref (encrypted_buffer);
-  gst_buffer_unref (decrypted_buffer);
+  gst_buffer_unref (buffer);
 
   return NULL;
 }
@@ -1831,8 +2060,18 @@ gst_hls_demux_get_manifest_update_interval (GstAdaptiveDemux * demux)
   GstClockTime target_duration;
 
   if (hlsdemux->current_variant) {
-    target_duration =
-        gst_m3u8_get_target_duration (hlsdemux->current_variant->m3u8);
+    GstM3U8 *m3u8 = hlsdemux->current_variant->m3u8;
+    GstClockTime part_target = gst_m3u8_get_part_target (m3u8);
+
+    target_duration = gst_m3u8_get_target_duration (m3u8);
+
+    /* Low latency playlists list a new part every part target. Blocking
+     * reloads are only answered once it's there, so they can be made
+     * earlier */
+    if (part_target > 0) {
+      target_duration = m3u8->can_block_reload ? part_target / 2 :
+          part_target;
+    }
   } else {
     target_duration = 5 * GST_SECOND;
   }
@@ -111,6 +111,10 @@ struct _GstHLSDemuxStream
 #else
   gcry_cipher_hd_t aes_ctx;
 #endif
+  /* key the cipher context is currently set up with, it is kept across
+   * the fragments and only the IV is reset when the key doesn't change */
+  guint8    aes_key[16];
+  gboolean  aes_key_set;
 
   gchar     *current_key;
   guint8    *current_iv;
@@ -125,6 +129,7 @@ struct _GstHLSDemuxStream
 
 typedef struct {
   guint8 data[16];
+  gint64 fetch_time;            /* monotonic time the key was downloaded at */
 } GstHLSKey;
 
 /**
@@ -0,0 +1,148 @@
+/* GStreamer
+ *
+ * gsthlsplaylistwriter.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Writes the playlists of the sinks from a thread pool shared by all of
+ * them, so slow storage doesn't hold back the streaming threads. Only the
+ * last playlist given to a writer matters, the ones not written yet when a
+ * new one comes are skipped. */
+
+#include "gsthls.h"
+#include "gsthlsplaylistwriter.h"
+
+#define GST_CAT_DEFAULT hls_debug
+
+struct _GstHlsPlaylistWriter
+{
+  GstHlsPlaylistWriteFunc func;
+  gpointer user_data;
+
+  GMutex lock;
+  GCond cond;
+  gchar *location;
+  gchar *content;
+  /* a task of the pool is running for this writer */
+  gboolean scheduled;
+};
+
+static void gst_hls_playlist_writer_func (GstHlsPlaylistWriter * writer,
+    gpointer unused);
+
+static GThreadPool *
+gst_hls_playlist_writer_get_pool (void)
+{
+  static GThreadPool *pool = NULL;
+
+  if (g_once_init_enter (&pool)) {
+    GThreadPool *new_pool =
+        g_thread_pool_new ((GFunc) gst_hls_playlist_writer_func, NULL, -1,
+        FALSE, NULL);
+
+    g_once_init_leave (&pool, new_pool);
+  }
+
+  return pool;
+}
+
+static void
+gst_hls_playlist_writer_func (GstHlsPlaylistWriter * writer, gpointer unused)
+{
+  g_mutex_lock (&writer->lock);
+  while (writer->content) {
+    gchar *location = writer->location;
+    gchar *content = writer->content;
+
+    writer->location = NULL;
+    writer->content = NULL;
+    g_mutex_unlock (&writer->lock);
+
+    writer->func (writer->user_data, location, content);
+    g_free (location);
+    g_free (content);
+
+    g_mutex_lock (&writer->lock);
+  }
+  writer->scheduled = FALSE;
+  g_cond_broadcast (&writer->cond);
+  g_mutex_unlock (&writer->lock);
+}
+
+GstHlsPlaylistWriter *
+gst_hls_playlist_writer_new (GstHlsPlaylistWriteFunc func, gpointer user_data)
+{
+  GstHlsPlaylistWriter *writer;
+
+  g_return_val_if_fail (func != NULL, NULL);
+
+  writer = g_new0 (GstHlsPlaylistWriter, 1);
+  writer->func = func;
+  writer->user_data = user_data;
+  g_mutex_init (&writer->lock);
+  g_cond_init (&writer->cond);
+
+  return writer;
+}
+
+void
+gst_hls_playlist_writer_free (GstHlsPlaylistWriter * writer)
+{
+  g_return_if_fail (writer != NULL);
+
+  gst_hls_playlist_writer_flush (writer);
+
+  g_mutex_clear (&writer->lock);
+  g_cond_clear (&writer->cond);
+  g_free (writer);
+}
+
+/* Takes ownership of @content, which is written to @location from the
+ * writer pool */
+void
+gst_hls_playlist_writer_write (GstHlsPlaylistWriter * writer,
+    const gchar * location, gchar * content)
+{
+  g_return_if_fail (writer != NULL);
+  g_return_if_fail (content != NULL);
+
+  g_mutex_lock (&writer->lock);
+  if (writer->content)
+    GST_LOG ("Skipping the previous update of %s", writer->location);
+  g_free (writer->location);
+  g_free (writer->content);
+  writer->location = g_strdup (location);
+  writer->content = content;
+
+  if (!writer->scheduled) {
+    writer->scheduled = TRUE;
+    g_thread_pool_push (gst_hls_playlist_writer_get_pool (), writer, NULL);
+  }
+  g_mutex_unlock (&writer->lock);
+}
+
+/* Waits until the last playlist is written */
+void
+gst_hls_playlist_writer_flush (GstHlsPlaylistWriter * writer)
+{
+  g_return_if_fail (writer != NULL);
+
+  g_mutex_lock (&writer->lock);
+  while (writer->scheduled)
+    g_cond_wait (&writer->cond, &writer->lock);
+  g_mutex_unlock (&writer->lock);
+}
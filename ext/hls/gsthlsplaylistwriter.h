@@ -0,0 +1,49 @@
+/* GStreamer
+ *
+ * gsthlsplaylistwriter.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_HLS_PLAYLIST_WRITER_H__
+#define __GST_HLS_PLAYLIST_WRITER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstHlsPlaylistWriter GstHlsPlaylistWriter;
+
+/* Called from a thread of the writer pool, never concurrently for the same
+ * writer */
+typedef void (*GstHlsPlaylistWriteFunc) (gpointer user_data,
+                                         const gchar * location,
+                                         const gchar * content);
+
+GstHlsPlaylistWriter * gst_hls_playlist_writer_new   (GstHlsPlaylistWriteFunc func,
+                                                      gpointer user_data);
+
+void                   gst_hls_playlist_writer_free  (GstHlsPlaylistWriter * writer);
+
+void                   gst_hls_playlist_writer_write (GstHlsPlaylistWriter * writer,
+                                                      const gchar * location,
+                                                      gchar * content);
+
+void                   gst_hls_playlist_writer_flush (GstHlsPlaylistWriter * writer);
+
+G_END_DECLS
+
+#endif /* __GST_HLS_PLAYLIST_WRITER_H__ */
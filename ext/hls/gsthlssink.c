@@ -81,6 +81,8 @@ static GstPadProbeReturn gst_hls_sink_ghost_event_probe (GstPad * pad,
 static GstPadProbeReturn gst_hls_sink_ghost_buffer_probe (GstPad * pad,
     GstPadProbeInfo * info, gpointer data);
 static void gst_hls_sink_reset (GstHlsSink * sink);
+static void gst_hls_sink_write_playlist_file (GstHlsSink * sink,
+    const gchar * location, const gchar * playlist_content);
 static GstStateChangeReturn
 gst_hls_sink_change_state (GstElement * element, GstStateChange trans);
 static gboolean schedule_next_key_unit (GstHlsSink * sink);
@@ -105,6 +107,7 @@ gst_hls_sink_finalize (GObject * object)
   g_free (sink->playlist_root);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
+  gst_hls_playlist_writer_free (sink->playlist_writer);
 
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) sink);
 }
@@ -188,6 +191,8 @@ gst_hls_sink_init (GstHlsSink * sink)
   sink->playlist_length = DEFAULT_PLAYLIST_LENGTH;
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
+  sink->playlist_writer = gst_hls_playlist_writer_new
+      ((GstHlsPlaylistWriteFunc) gst_hls_sink_write_playlist_file, sink);
 
   /* haven't added a sink yet, make it is detected as a sink meanwhile */
   GST_OBJECT_FLAG_SET (sink, GST_ELEMENT_FLAG_SINK);
@@ -248,23 +253,28 @@ missing_element:
   return FALSE;
 }
 
+/* called from the playlist writer pool, g_file_set_contents() replaces the
+ * file atomically */
 static void
-gst_hls_sink_write_playlist (GstHlsSink * sink)
+gst_hls_sink_write_playlist_file (GstHlsSink * sink, const gchar * location,
+    const gchar * playlist_content)
 {
-  char *playlist_content;
   GError *error = NULL;
 
-  playlist_content = gst_m3u8_playlist_render (sink->playlist);
-  if (!g_file_set_contents (sink->playlist_location,
-          playlist_content, -1, &error)) {
+  if (!g_file_set_contents (location, playlist_content, -1, &error)) {
     GST_ERROR ("Failed to write playlist: %s", error->message);
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Failed to write playlist '%s'."), error->message), (NULL));
     g_error_free (error);
     error = NULL;
   }
-  g_free (playlist_content);
+}
 
+static void
+gst_hls_sink_write_playlist (GstHlsSink * sink)
+{
+  gst_hls_playlist_writer_write (sink->playlist_writer,
+      sink->playlist_location, gst_m3u8_playlist_render (sink->playlist));
 }
 
 static void
@@ -321,6 +331,8 @@ gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
     case GST_MESSAGE_EOS:{
       sink->playlist->end_list = TRUE;
       gst_hls_sink_write_playlist (sink);
+      /* the final playlist is complete when the EOS is announced */
+      gst_hls_playlist_writer_flush (sink->playlist_writer);
       break;
     }
     default:
@@ -355,6 +367,7 @@ gst_hls_sink_change_state (GstElement * element, GstStateChange trans)
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_hls_playlist_writer_flush (sink->playlist_writer);
       gst_hls_sink_reset (sink);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
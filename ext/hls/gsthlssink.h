@@ -20,6 +20,7 @@
 #define _GST_HLS_SINK_H_
 
 #include "gstm3u8playlist.h"
+#include "gsthlsplaylistwriter.h"
 #include <gst/gst.h>
 
 G_BEGIN_DECLS
@@ -48,6 +49,7 @@ struct _GstHlsSink
   gchar *playlist_root;
   guint playlist_length;
   GstM3U8Playlist *playlist;
+  GstHlsPlaylistWriter *playlist_writer;
   guint index;
   gint max_files;
   gint target_duration;
@@ -29,6 +29,17 @@
  * gst-launch-1.0 videotestsrc is-live=true ! x264enc ! hlssink max-files=5
  * ]|
  *
+ * The fragments and the playlist are written to files by default. An
+ * application can instead provide the #GOutputStream they are written to
+ * with the #GstHlsSink2::get-fragment-stream and
+ * #GstHlsSink2::get-playlist-stream signals, for example to keep them in
+ * memory or to upload them directly, and handle the removal of the old
+ * fragments with #GstHlsSink2::delete-fragment.
+ *
+ * With #GstHlsSink2:muxer-type set to CMAF, fragmented MP4 segments are
+ * written, sharing the init segment at #GstHlsSink2:init-location. Each
+ * movie fragment of #GstHlsSink2:part-duration is listed in the playlist as
+ * a partial segment as soon as it is written, for low latency HLS.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -37,6 +48,7 @@
 #include "gsthlssink2.h"
 #include <gst/pbutils/pbutils.h>
 #include <gst/video/video.h>
+#include <gst/isoff/gstisoff.h>
 #include <glib/gstdio.h>
 #include <memory.h>
 
@@ -50,8 +62,25 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink2_debug);
 #define DEFAULT_MAX_FILES 10
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
+#define DEFAULT_MUXER_TYPE GST_HLS_SINK2_MUXER_TYPE_MPEGTS
+#define DEFAULT_PART_DURATION 0
+#define DEFAULT_INIT_LOCATION "init.mp4"
 
 #define GST_M3U8_PLAYLIST_VERSION 3
+/* for EXT-X-MAP */
+#define GST_M3U8_PLAYLIST_CMAF_VERSION 7
+
+#define GST_ISOFF_FOURCC_MFRA GST_MAKE_FOURCC('m','f','r','a')
+
+enum
+{
+  SIGNAL_GET_PLAYLIST_STREAM,
+  SIGNAL_GET_FRAGMENT_STREAM,
+  SIGNAL_DELETE_FRAGMENT,
+  SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST];
 
 enum
 {
@@ -61,9 +90,28 @@ enum
   PROP_PLAYLIST_ROOT,
   PROP_MAX_FILES,
   PROP_TARGET_DURATION,
-  PROP_PLAYLIST_LENGTH
+  PROP_PLAYLIST_LENGTH,
+  PROP_MUXER_TYPE,
+  PROP_PART_DURATION,
+  PROP_INIT_LOCATION
 };
 
+GType
+gst_hls_sink2_muxer_type_get_type (void)
+{
+  static GType muxer_type = 0;
+  static const GEnumValue muxer_types[] = {
+    {GST_HLS_SINK2_MUXER_TYPE_MPEGTS, "MPEG-TS", "mpegts"},
+    {GST_HLS_SINK2_MUXER_TYPE_CMAF, "Fragmented MP4 (CMAF)", "cmaf"},
+    {0, NULL, NULL}
+  };
+
+  if (!muxer_type) {
+    muxer_type = g_enum_register_static ("GstHlsSink2MuxerType", muxer_types);
+  }
+  return muxer_type;
+}
+
 static GstStaticPadTemplate video_template = GST_STATIC_PAD_TEMPLATE ("video",
     GST_PAD_SINK,
     GST_PAD_REQUEST,
@@ -76,6 +124,16 @@ static GstStaticPadTemplate audio_template = GST_STATIC_PAD_TEMPLATE ("audio",
 #define gst_hls_sink2_parent_class parent_class
 G_DEFINE_TYPE (GstHlsSink2, gst_hls_sink2, GST_TYPE_BIN);
 
+/* decode times of a track are shifted by offset to continue at
+ * next_decode_time once resync is set by a new fragment */
+typedef struct
+{
+  guint32 track_id;
+  gint64 offset;
+  guint64 next_decode_time;
+  gboolean resync;
+} GstHlsSink2Track;
+
 static void gst_hls_sink2_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * spec);
 static void gst_hls_sink2_get_property (GObject * object, guint prop_id,
@@ -87,6 +145,18 @@ gst_hls_sink2_change_state (GstElement * element, GstStateChange trans);
 static GstPad *gst_hls_sink2_request_new_pad (GstElement * element,
     GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
 static void gst_hls_sink2_release_pad (GstElement * element, GstPad * pad);
+static GOutputStream *gst_hls_sink2_get_playlist_stream (GstHlsSink2 * sink,
+    const gchar * location);
+static GOutputStream *gst_hls_sink2_get_fragment_stream (GstHlsSink2 * sink,
+    const gchar * location);
+static void gst_hls_sink2_delete_fragment (GstHlsSink2 * sink,
+    const gchar * location);
+static void gst_hls_sink2_update_muxer (GstHlsSink2 * sink);
+static void gst_hls_sink2_write_playlist_stream (GstHlsSink2 * sink,
+    const gchar * location, const gchar * playlist_content);
+static GstPadProbeReturn gst_hls_sink2_cmaf_probe (GstPad * pad,
+    GstPadProbeInfo * info, GstHlsSink2 * sink);
+static void gst_hls_sink2_cmaf_process (GstHlsSink2 * sink);
 
 static void
 gst_hls_sink2_dispose (GObject * object)
@@ -104,6 +174,14 @@ gst_hls_sink2_finalize (GObject * object)
   g_free (sink->location);
   g_free (sink->playlist_location);
   g_free (sink->playlist_root);
+  g_free (sink->init_location);
+  g_object_unref (sink->cmaf_adapter);
+  g_array_free (sink->tracks, TRUE);
+  gst_buffer_replace (&sink->init_segment, NULL);
+  gst_hls_playlist_writer_free (sink->playlist_writer);
+  g_free (sink->current_location);
+  if (sink->current_stream)
+    g_object_unref (sink->current_stream);
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
 
@@ -176,12 +254,144 @@ gst_hls_sink2_class_init (GstHlsSink2Class * klass)
           "the playlist will be infinite.",
           0, G_MAXUINT, DEFAULT_PLAYLIST_LENGTH,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstHlsSink2:muxer-type:
+   *
+   * The container of the segments. Can only be changed in the NULL state.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MUXER_TYPE,
+      g_param_spec_enum ("muxer-type", "Muxer type",
+          "The container of the segments", GST_TYPE_HLS_SINK2_MUXER_TYPE,
+          DEFAULT_MUXER_TYPE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstHlsSink2:part-duration:
+   *
+   * The target duration in milliseconds of the partial segments, each
+   * written as a fragmented MP4 movie fragment. Only used with the CMAF
+   * muxer type.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PART_DURATION,
+      g_param_spec_uint ("part-duration", "Part duration",
+          "The target duration in milliseconds of a partial segment "
+          "(0 - disabled), CMAF only",
+          0, G_MAXUINT, DEFAULT_PART_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstHlsSink2:init-location:
+   *
+   * Location of the fragmented MP4 initialization segment. Only used with
+   * the CMAF muxer type.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_INIT_LOCATION,
+      g_param_spec_string ("init-location", "Init Location",
+          "Location of the initialization segment to write, CMAF only",
+          DEFAULT_INIT_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstHlsSink2::get-playlist-stream:
+   * @sink: the #GstHlsSink2
+   * @location: Location for the playlist file
+   *
+   * Emitted every time the playlist is updated, from a thread shared by the
+   * sinks for writing their playlists. The default handler opens @location
+   * for writing, the file is replaced once the stream is closed.
+   *
+   * Returns: (transfer full): #GOutputStream for writing the playlist, it is
+   * closed once written
+   *
+   * Since: 1.16
+   */
+  signals[SIGNAL_GET_PLAYLIST_STREAM] =
+      g_signal_new ("get-playlist-stream", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstHlsSink2Class,
+          get_playlist_stream), g_signal_accumulator_first_wins, NULL, NULL,
+      G_TYPE_OUTPUT_STREAM, 1, G_TYPE_STRING);
+
+  /**
+   * GstHlsSink2::get-fragment-stream:
+   * @sink: the #GstHlsSink2
+   * @location: Location for the fragment file
+   *
+   * Emitted when a new fragment starts. The default handler opens @location
+   * for writing.
+   *
+   * Returns: (transfer full): #GOutputStream for writing the fragment, it is
+   * closed once the fragment is complete
+   *
+   * Since: 1.16
+   */
+  signals[SIGNAL_GET_FRAGMENT_STREAM] =
+      g_signal_new ("get-fragment-stream", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstHlsSink2Class,
+          get_fragment_stream), g_signal_accumulator_first_wins, NULL, NULL,
+      G_TYPE_OUTPUT_STREAM, 1, G_TYPE_STRING);
+
+  /**
+   * GstHlsSink2::delete-fragment:
+   * @sink: the #GstHlsSink2
+   * @location: Location of the fragment file to delete
+   *
+   * Emitted when a fragment is not part of the playlist anymore. The default
+   * handler removes the file at @location.
+   *
+   * Since: 1.16
+   */
+  signals[SIGNAL_DELETE_FRAGMENT] =
+      g_signal_new ("delete-fragment", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, G_STRUCT_OFFSET (GstHlsSink2Class, delete_fragment),
+      NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  klass->get_playlist_stream = gst_hls_sink2_get_playlist_stream;
+  klass->get_fragment_stream = gst_hls_sink2_get_fragment_stream;
+  klass->delete_fragment = gst_hls_sink2_delete_fragment;
+}
+
+static gchar *
+on_format_location (GstElement * splitmuxsink, guint fragment_id,
+    GstHlsSink2 * sink)
+{
+  GOutputStream *stream = NULL;
+  gchar *location;
+  guint i;
+
+  /* splitmuxsink only counts the fragments it sets a location for */
+  location = g_strdup_printf (sink->location, sink->fragment_id++);
+  g_signal_emit (sink, signals[SIGNAL_GET_FRAGMENT_STREAM], 0, location,
+      &stream);
+
+  if (!stream) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        (("Got no output stream for fragment '%s'."), location), (NULL));
+  }
+
+  g_free (sink->current_location);
+  sink->current_location = location;
+  if (sink->current_stream)
+    g_object_unref (sink->current_stream);
+  sink->current_stream = stream;
+  g_object_set (sink->giostreamsink, "stream", stream, NULL);
+
+  /* every fragment starts with its own ftyp and moov */
+  sink->fragment_offset = 0;
+  sink->in_part = FALSE;
+  gst_buffer_replace (&sink->init_segment, NULL);
+  for (i = 0; i < sink->tracks->len; i++)
+    g_array_index (sink->tracks, GstHlsSink2Track, i).resync = TRUE;
+
+  /* the location stays unset on the giostreamsink */
+  return NULL;
 }
 
 static void
 gst_hls_sink2_init (GstHlsSink2 * sink)
 {
-  GstElement *mux;
+  GstPad *pad;
 
   sink->location = g_strdup (DEFAULT_LOCATION);
   sink->playlist_location = g_strdup (DEFAULT_PLAYLIST_LOCATION);
@@ -189,53 +399,537 @@ gst_hls_sink2_init (GstHlsSink2 * sink)
   sink->playlist_length = DEFAULT_PLAYLIST_LENGTH;
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
+  sink->muxer_type = DEFAULT_MUXER_TYPE;
+  sink->part_duration = DEFAULT_PART_DURATION;
+  sink->init_location = g_strdup (DEFAULT_INIT_LOCATION);
+  sink->cmaf_adapter = gst_adapter_new ();
+  sink->tracks = g_array_new (FALSE, FALSE, sizeof (GstHlsSink2Track));
+  sink->playlist_writer = gst_hls_playlist_writer_new
+      ((GstHlsPlaylistWriteFunc) gst_hls_sink2_write_playlist_stream, sink);
   g_queue_init (&sink->old_locations);
 
   sink->splitmuxsink = gst_element_factory_make ("splitmuxsink", NULL);
   gst_bin_add (GST_BIN (sink), sink->splitmuxsink);
 
-  mux = gst_element_factory_make ("mpegtsmux", NULL);
-  g_object_set (sink->splitmuxsink, "location", sink->location, "max-size-time",
+  sink->giostreamsink = gst_element_factory_make ("giostreamsink", NULL);
+  g_object_set (sink->splitmuxsink, "location", NULL, "max-size-time",
       ((GstClockTime) sink->target_duration * GST_SECOND),
-      "send-keyframe-requests", TRUE, "muxer", mux, NULL);
+      "send-keyframe-requests", TRUE, "sink", sink->giostreamsink, NULL);
+  g_signal_connect (sink->splitmuxsink, "format-location",
+      (GCallback) on_format_location, sink);
+  gst_hls_sink2_update_muxer (sink);
+
+  if (sink->giostreamsink) {
+    pad = gst_element_get_static_pad (sink->giostreamsink, "sink");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+        (GstPadProbeCallback) gst_hls_sink2_cmaf_probe, sink, NULL);
+    gst_object_unref (pad);
+  }
 
   GST_OBJECT_FLAG_SET (sink, GST_ELEMENT_FLAG_SINK);
 
   gst_hls_sink2_reset (sink);
 }
 
+/* The muxer has to be replaced when the properties it depends on change */
+static void
+gst_hls_sink2_update_muxer (GstHlsSink2 * sink)
+{
+  GstElement *mux;
+
+  if (sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF) {
+    mux = gst_element_factory_make ("mp4mux", NULL);
+    /* one movie fragment per part, or per segment without parts */
+    if (mux)
+      g_object_set (mux, "streamable", TRUE, "fragment-duration",
+          sink->part_duration ? sink->part_duration :
+          sink->target_duration * 1000, NULL);
+  } else {
+    mux = gst_element_factory_make ("mpegtsmux", NULL);
+  }
+
+  g_object_set (sink->splitmuxsink, "muxer", mux, NULL);
+}
+
 static void
 gst_hls_sink2_reset (GstHlsSink2 * sink)
 {
+  gboolean cmaf = sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF;
+
   sink->index = 0;
+  sink->fragment_id = 0;
+  sink->init_written = FALSE;
+  sink->ref_track_id = 0;
+  sink->ref_timescale = 0;
+  sink->ref_is_video = FALSE;
+  sink->fragment_offset = 0;
+  sink->in_part = FALSE;
+  sink->sequence_number = 0;
+  g_array_set_size (sink->tracks, 0);
+  gst_buffer_replace (&sink->init_segment, NULL);
+  gst_adapter_clear (sink->cmaf_adapter);
+
+  g_free (sink->current_location);
+  sink->current_location = NULL;
+  if (sink->current_stream) {
+    g_output_stream_close (sink->current_stream, NULL, NULL);
+    g_object_unref (sink->current_stream);
+    sink->current_stream = NULL;
+  }
 
   if (sink->playlist)
     gst_m3u8_playlist_free (sink->playlist);
   sink->playlist =
-      gst_m3u8_playlist_new (GST_M3U8_PLAYLIST_VERSION, sink->playlist_length,
-      FALSE);
+      gst_m3u8_playlist_new (cmaf ? GST_M3U8_PLAYLIST_CMAF_VERSION :
+      GST_M3U8_PLAYLIST_VERSION, sink->playlist_length, FALSE);
+  if (cmaf)
+    sink->playlist->part_target = sink->part_duration * GST_MSECOND;
 
   g_queue_foreach (&sink->old_locations, (GFunc) g_free, NULL);
   g_queue_clear (&sink->old_locations);
 }
 
+static GOutputStream *
+gst_hls_sink2_open_file (GstHlsSink2 * sink, const gchar * location)
+{
+  GFile *file = g_file_new_for_path (location);
+  GOutputStream *ostream;
+  GError *error = NULL;
+
+  /* replacing the file only happens once the stream is closed */
+  ostream = (GOutputStream *) g_file_replace (file, NULL, FALSE,
+      G_FILE_CREATE_REPLACE_DESTINATION, NULL, &error);
+  if (!ostream) {
+    GST_ERROR_OBJECT (sink, "Failed to open %s: %s", location,
+        error->message);
+    g_error_free (error);
+  }
+  g_object_unref (file);
+
+  return ostream;
+}
+
+static GOutputStream *
+gst_hls_sink2_get_playlist_stream (GstHlsSink2 * sink, const gchar * location)
+{
+  return gst_hls_sink2_open_file (sink, location);
+}
+
+static GOutputStream *
+gst_hls_sink2_get_fragment_stream (GstHlsSink2 * sink, const gchar * location)
+{
+  return gst_hls_sink2_open_file (sink, location);
+}
+
 static void
-gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
+gst_hls_sink2_delete_fragment (GstHlsSink2 * sink, const gchar * location)
+{
+  g_remove (location);
+}
+
+/* called from the playlist writer pool */
+static void
+gst_hls_sink2_write_playlist_stream (GstHlsSink2 * sink,
+    const gchar * location, const gchar * playlist_content)
 {
-  char *playlist_content;
+  GOutputStream *stream = NULL;
   GError *error = NULL;
 
-  playlist_content = gst_m3u8_playlist_render (sink->playlist);
-  if (!g_file_set_contents (sink->playlist_location,
-          playlist_content, -1, &error)) {
+  g_signal_emit (sink, signals[SIGNAL_GET_PLAYLIST_STREAM], 0, location,
+      &stream);
+  if (!stream) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        (("Got no output stream for playlist '%s'."), location), (NULL));
+    return;
+  }
+
+  if (!g_output_stream_write_all (stream, playlist_content,
+          strlen (playlist_content), NULL, NULL, &error) ||
+      !g_output_stream_close (stream, NULL, &error)) {
     GST_ERROR ("Failed to write playlist: %s", error->message);
     GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
         (("Failed to write playlist '%s'."), error->message), (NULL));
     g_error_free (error);
     error = NULL;
   }
-  g_free (playlist_content);
+  g_object_unref (stream);
+}
 
+static void
+gst_hls_sink2_write_playlist (GstHlsSink2 * sink)
+{
+  gst_hls_playlist_writer_write (sink->playlist_writer,
+      sink->playlist_location, gst_m3u8_playlist_render (sink->playlist));
+}
+
+/* The location of a file as listed in the playlist */
+static gchar *
+gst_hls_sink2_entry_location (GstHlsSink2 * sink, const gchar * location)
+{
+  gchar *name, *entry_location;
+
+  name = g_path_get_basename (location);
+  if (sink->playlist_root == NULL)
+    return name;
+
+  entry_location = g_build_filename (sink->playlist_root, name, NULL);
+  g_free (name);
+
+  return entry_location;
+}
+
+static void
+gst_hls_sink2_cmaf_write (GstHlsSink2 * sink, GOutputStream * stream,
+    GstBuffer * buffer)
+{
+  GstMapInfo map;
+  GError *error = NULL;
+
+  if (!stream)
+    return;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  if (!g_output_stream_write_all (stream, map.data, map.size, NULL, NULL,
+          &error)) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (("Failed to write fragment '%s'."), error->message), (NULL));
+    g_error_free (error);
+  }
+  gst_buffer_unmap (buffer, &map);
+}
+
+/* The parts are timed against the video track if there is one */
+static void
+gst_hls_sink2_cmaf_parse_moov (GstHlsSink2 * sink, GstBuffer * buffer,
+    guint header_size)
+{
+  GstMapInfo map;
+  GstByteReader reader;
+  GstMoovBox *moov;
+  guint i;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  gst_byte_reader_init (&reader, map.data + header_size,
+      map.size - header_size);
+  moov = gst_isoff_moov_box_parse (&reader);
+  gst_buffer_unmap (buffer, &map);
+
+  if (!moov) {
+    GST_WARNING_OBJECT (sink, "Failed to parse moov");
+    return;
+  }
+
+  for (i = 0; i < moov->trak->len; i++) {
+    GstTrakBox *trak = &g_array_index (moov->trak, GstTrakBox, i);
+    gboolean is_video = trak->mdia.hdlr.handler_type == GST_ISOFF_FOURCC_VIDE;
+
+    if (i == 0 || (is_video && !sink->ref_is_video)) {
+      sink->ref_track_id = trak->tkhd.track_id;
+      sink->ref_timescale = trak->mdia.mdhd.timescale;
+      sink->ref_is_video = is_video;
+    }
+  }
+  gst_isoff_moov_box_free (moov);
+}
+
+static GstHlsSink2Track *
+gst_hls_sink2_cmaf_get_track (GstHlsSink2 * sink, guint32 track_id)
+{
+  GstHlsSink2Track track = { track_id, 0, 0, FALSE };
+  guint i;
+
+  for (i = 0; i < sink->tracks->len; i++) {
+    if (g_array_index (sink->tracks, GstHlsSink2Track, i).track_id == track_id)
+      return &g_array_index (sink->tracks, GstHlsSink2Track, i);
+  }
+
+  g_array_append_val (sink->tracks, track);
+  return &g_array_index (sink->tracks, GstHlsSink2Track, i);
+}
+
+/* Rewrites the mfhd sequence number and the tfdt decode time of each traf
+ * in place, the box sizes stay the same */
+static void
+gst_hls_sink2_cmaf_patch_boxes (GstHlsSink2 * sink, guint8 * data, gsize size,
+    const guint64 * decode_times, guint n_trafs, guint * traf)
+{
+  GstByteReader reader;
+
+  gst_byte_reader_init (&reader, data, size);
+  while (gst_byte_reader_get_remaining (&reader) >= 8) {
+    guint pos = gst_byte_reader_get_pos (&reader);
+    guint32 type;
+    guint header_size;
+    guint64 box_size;
+    guint8 *body;
+    gsize body_size;
+
+    if (!gst_isoff_parse_box_header (&reader, &type, NULL, &header_size,
+            &box_size) || box_size < header_size || box_size > size - pos)
+      break;
+
+    body = data + pos + header_size;
+    body_size = box_size - header_size;
+
+    switch (type) {
+      case GST_ISOFF_FOURCC_MFHD:
+        if (body_size >= 8)
+          GST_WRITE_UINT32_BE (body + 4, sink->sequence_number);
+        break;
+      case GST_ISOFF_FOURCC_TRAF:
+        gst_hls_sink2_cmaf_patch_boxes (sink, body, body_size, decode_times,
+            n_trafs, traf);
+        (*traf)++;
+        break;
+      case GST_ISOFF_FOURCC_TFDT:
+        if (*traf >= n_trafs || decode_times[*traf] == GST_CLOCK_TIME_NONE)
+          break;
+        if (body_size >= 12 && body[0] == 1) {
+          GST_WRITE_UINT64_BE (body + 4, decode_times[*traf]);
+        } else if (body_size >= 8 && decode_times[*traf] <= G_MAXUINT32) {
+          GST_WRITE_UINT32_BE (body + 4, decode_times[*traf]);
+        } else {
+          GST_WARNING_OBJECT (sink, "Decode time %" G_GUINT64_FORMAT
+              " does not fit the tfdt box", decode_times[*traf]);
+        }
+        break;
+      default:
+        break;
+    }
+
+    gst_byte_reader_set_pos (&reader, pos + box_size);
+  }
+}
+
+/* Works out the duration of the part starting with this moof and if it
+ * starts with a sync sample. The muxer restarts with every fragment, so its
+ * sequence numbers and decode times are shifted to continue the ones of the
+ * previous fragment */
+static void
+gst_hls_sink2_cmaf_parse_moof (GstHlsSink2 * sink, GstBuffer * buffer,
+    guint header_size)
+{
+  GstMapInfo map;
+  GstByteReader reader;
+  GstMoofBox *moof;
+  guint64 *decode_times;
+  guint64 duration = 0;
+  guint32 first_flags = 0;
+  gboolean have_first = FALSE;
+  guint i, j, k, traf_index = 0;
+
+  sink->part_time = 0;
+  sink->part_independent = !sink->ref_is_video;
+
+  gst_buffer_map (buffer, &map, GST_MAP_READWRITE);
+  gst_byte_reader_init (&reader, map.data + header_size,
+      map.size - header_size);
+  moof = gst_isoff_moof_box_parse (&reader);
+
+  if (!moof) {
+    GST_WARNING_OBJECT (sink, "Failed to parse moof");
+    gst_buffer_unmap (buffer, &map);
+    return;
+  }
+
+  decode_times = g_new (guint64, moof->traf->len);
+
+  for (i = 0; i < moof->traf->len; i++) {
+    GstTrafBox *traf = &g_array_index (moof->traf, GstTrafBox, i);
+    GstHlsSink2Track *track =
+        gst_hls_sink2_cmaf_get_track (sink, traf->tfhd.track_id);
+    gboolean is_ref = traf->tfhd.track_id == sink->ref_track_id;
+    guint64 traf_duration = 0;
+
+    for (j = 0; j < traf->trun->len; j++) {
+      GstTrunBox *trun = &g_array_index (traf->trun, GstTrunBox, j);
+
+      for (k = 0; k < trun->samples->len; k++) {
+        GstTrunSample *sample =
+            &g_array_index (trun->samples, GstTrunSample, k);
+
+        if (trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT)
+          traf_duration += sample->sample_duration;
+        else if (traf->tfhd.flags &
+            GST_TFHD_FLAGS_DEFAULT_SAMPLE_DURATION_PRESENT)
+          traf_duration += traf->tfhd.default_sample_duration;
+
+        if (!is_ref || have_first)
+          continue;
+
+        have_first = TRUE;
+        if (trun->flags & GST_TRUN_FLAGS_FIRST_SAMPLE_FLAGS_PRESENT)
+          first_flags = trun->first_sample_flags;
+        else if (trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT)
+          first_flags = sample->sample_flags;
+        else if (traf->tfhd.flags & GST_TFHD_FLAGS_DEFAULT_SAMPLE_FLAGS_PRESENT)
+          first_flags = traf->tfhd.default_sample_flags;
+      }
+    }
+
+    if (is_ref)
+      duration += traf_duration;
+
+    decode_times[i] = traf->tfdt.decode_time;
+    if (decode_times[i] == GST_CLOCK_TIME_NONE)
+      continue;
+
+    if (track->resync) {
+      track->offset = (gint64) track->next_decode_time - decode_times[i];
+      track->resync = FALSE;
+    }
+    decode_times[i] += track->offset;
+    track->next_decode_time = decode_times[i] + traf_duration;
+  }
+
+  sink->sequence_number++;
+  gst_hls_sink2_cmaf_patch_boxes (sink, map.data + header_size,
+      map.size - header_size, decode_times, moof->traf->len, &traf_index);
+  gst_buffer_unmap (buffer, &map);
+
+  g_free (decode_times);
+  gst_isoff_moof_box_free (moof);
+
+  if (sink->ref_timescale)
+    sink->part_time =
+        gst_util_uint64_scale (duration, GST_SECOND, sink->ref_timescale);
+  if (have_first && sink->ref_is_video)
+    sink->part_independent =
+        !GST_ISOFF_SAMPLE_FLAGS_SAMPLE_IS_NON_SYNC_SAMPLE (first_flags);
+}
+
+/* The boxes before the first moof of the first fragment make up the init
+ * segment, the ones of the next fragments are the same and dropped */
+static void
+gst_hls_sink2_cmaf_write_init (GstHlsSink2 * sink)
+{
+  GOutputStream *stream = NULL;
+  GError *error = NULL;
+
+  if (sink->init_written || !sink->init_segment)
+    return;
+
+  g_signal_emit (sink, signals[SIGNAL_GET_FRAGMENT_STREAM], 0,
+      sink->init_location, &stream);
+  if (!stream) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, OPEN_WRITE,
+        (("Got no output stream for init segment '%s'."), sink->init_location),
+        (NULL));
+    return;
+  }
+
+  gst_hls_sink2_cmaf_write (sink, stream, sink->init_segment);
+  if (!g_output_stream_close (stream, NULL, &error)) {
+    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE,
+        (("Failed to write init segment '%s'."), error->message), (NULL));
+    g_error_free (error);
+  }
+  g_object_unref (stream);
+
+  g_free (sink->playlist->map_uri);
+  sink->playlist->map_uri =
+      gst_hls_sink2_entry_location (sink, sink->init_location);
+  sink->init_written = TRUE;
+}
+
+/* Writes the complete boxes collected from the muxer. A part is added to the
+ * playlist once the mdat following its moof is written */
+static void
+gst_hls_sink2_cmaf_process (GstHlsSink2 * sink)
+{
+  gsize available;
+
+  while ((available = gst_adapter_available (sink->cmaf_adapter)) >= 8) {
+    guint8 data[32];
+    GstByteReader reader;
+    GstBuffer *box;
+    guint32 type;
+    guint header_size;
+    guint64 size;
+
+    gst_adapter_copy (sink->cmaf_adapter, data, 0, MIN (available, 32));
+    gst_byte_reader_init (&reader, data, MIN (available, 32));
+    if (!gst_isoff_parse_box_header (&reader, &type, NULL, &header_size,
+            &size))
+      break;
+
+    if (size < header_size) {
+      GST_ELEMENT_ERROR (sink, STREAM, FAILED, (NULL),
+          ("Invalid box of size %" G_GUINT64_FORMAT, size));
+      gst_adapter_clear (sink->cmaf_adapter);
+      break;
+    }
+    if (available < size)
+      break;
+
+    box = gst_adapter_take_buffer (sink->cmaf_adapter, size);
+
+    switch (type) {
+      case GST_ISOFF_FOURCC_MOOF:
+        gst_hls_sink2_cmaf_write_init (sink);
+        gst_buffer_replace (&sink->init_segment, NULL);
+        box = gst_buffer_make_writable (box);
+        gst_hls_sink2_cmaf_parse_moof (sink, box, header_size);
+        sink->part_offset = sink->fragment_offset;
+        sink->in_part = TRUE;
+        break;
+      case GST_ISOFF_FOURCC_MFRA:
+        /* its offsets don't account for the removed init boxes */
+        gst_buffer_unref (box);
+        continue;
+      default:
+        if (sink->fragment_offset == 0) {
+          if (type == GST_ISOFF_FOURCC_MOOV && !sink->init_written)
+            gst_hls_sink2_cmaf_parse_moov (sink, box, header_size);
+          if (sink->init_segment)
+            box = gst_buffer_append (sink->init_segment, box);
+          sink->init_segment = box;
+          continue;
+        }
+        break;
+    }
+
+    gst_hls_sink2_cmaf_write (sink, sink->current_stream, box);
+    sink->fragment_offset += size;
+    gst_buffer_unref (box);
+
+    if (type == GST_ISOFF_FOURCC_MDAT && sink->in_part) {
+      sink->in_part = FALSE;
+      if (sink->playlist->part_target) {
+        gchar *entry_location =
+            gst_hls_sink2_entry_location (sink, sink->current_location);
+
+        gst_m3u8_playlist_add_part (sink->playlist, entry_location,
+            sink->part_time, sink->part_offset,
+            sink->fragment_offset - sink->part_offset,
+            sink->part_independent);
+        g_free (entry_location);
+        gst_hls_sink2_write_playlist (sink);
+      }
+    }
+  }
+}
+
+/* With the CMAF muxer the boxes are written here instead of by the
+ * giostreamsink, which still gets empty buffers to preroll and sync */
+static GstPadProbeReturn
+gst_hls_sink2_cmaf_probe (GstPad * pad, GstPadProbeInfo * info,
+    GstHlsSink2 * sink)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstBuffer *empty;
+
+  if (sink->muxer_type != GST_HLS_SINK2_MUXER_TYPE_CMAF)
+    return GST_PAD_PROBE_OK;
+
+  empty = gst_buffer_new ();
+  gst_buffer_copy_into (empty, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_adapter_push (sink->cmaf_adapter, buffer);
+  GST_PAD_PROBE_INFO_DATA (info) = empty;
+
+  gst_hls_sink2_cmaf_process (sink);
+
+  return GST_PAD_PROBE_OK;
 }
 
 static void
@@ -249,28 +943,32 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
       const GstStructure *s = gst_message_get_structure (message);
       if (message->src == GST_OBJECT_CAST (sink->splitmuxsink)) {
         if (gst_structure_has_name (s, "splitmuxsink-fragment-opened")) {
-          g_free (sink->current_location);
-          sink->current_location =
-              g_strdup (gst_structure_get_string (s, "location"));
           gst_structure_get_clock_time (s, "running-time",
               &sink->current_running_time_start);
         } else if (gst_structure_has_name (s, "splitmuxsink-fragment-closed")) {
           GstClockTime running_time;
           gchar *entry_location;
 
-          g_assert (strcmp (sink->current_location, gst_structure_get_string (s,
-                      "location")) == 0);
+          /* the location was picked by on_format_location() */
+          if (sink->current_location == NULL)
+            break;
+
+          /* complete the fragment before the playlist refers to it */
+          if (sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF) {
+            gst_hls_sink2_cmaf_process (sink);
+            gst_adapter_clear (sink->cmaf_adapter);
+          }
+          if (sink->current_stream) {
+            g_output_stream_close (sink->current_stream, NULL, NULL);
+            g_object_unref (sink->current_stream);
+            sink->current_stream = NULL;
+          }
 
           gst_structure_get_clock_time (s, "running-time", &running_time);
 
           GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-          if (sink->playlist_root == NULL) {
-            entry_location = g_path_get_basename (sink->current_location);
-          } else {
-            gchar *name = g_path_get_basename (sink->current_location);
-            entry_location = g_build_filename (sink->playlist_root, name, NULL);
-            g_free (name);
-          }
+          entry_location =
+              gst_hls_sink2_entry_location (sink, sink->current_location);
 
           gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
               NULL, running_time - sink->current_running_time_start,
@@ -285,7 +983,8 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
           while (g_queue_get_length (&sink->old_locations) >
               g_queue_get_length (sink->playlist->entries)) {
             gchar *old_location = g_queue_pop_head (&sink->old_locations);
-            g_remove (old_location);
+            g_signal_emit (sink, signals[SIGNAL_DELETE_FRAGMENT], 0,
+                old_location);
             g_free (old_location);
           }
         }
@@ -295,6 +994,8 @@ gst_hls_sink2_handle_message (GstBin * bin, GstMessage * message)
     case GST_MESSAGE_EOS:{
       sink->playlist->end_list = TRUE;
       gst_hls_sink2_write_playlist (sink);
+      /* the final playlist is complete when the EOS is announced */
+      gst_hls_playlist_writer_flush (sink->playlist_writer);
       break;
     }
     default:
@@ -373,7 +1074,7 @@ gst_hls_sink2_change_state (GstElement * element, GstStateChange trans)
 
   switch (trans) {
     case GST_STATE_CHANGE_NULL_TO_READY:
-      if (!sink->splitmuxsink) {
+      if (!sink->splitmuxsink || !sink->giostreamsink) {
         return GST_STATE_CHANGE_FAILURE;
       }
       break;
@@ -388,6 +1089,7 @@ gst_hls_sink2_change_state (GstElement * element, GstStateChange trans)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
     case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_hls_playlist_writer_flush (sink->playlist_writer);
       gst_hls_sink2_reset (sink);
       break;
     default:
@@ -407,8 +1109,6 @@ gst_hls_sink2_set_property (GObject * object, guint prop_id,
     case PROP_LOCATION:
       g_free (sink->location);
       sink->location = g_value_dup_string (value);
-      if (sink->splitmuxsink)
-        g_object_set (sink->splitmuxsink, "location", sink->location, NULL);
       break;
     case PROP_PLAYLIST_LOCATION:
       g_free (sink->playlist_location);
@@ -426,12 +1126,32 @@ gst_hls_sink2_set_property (GObject * object, guint prop_id,
       if (sink->splitmuxsink) {
         g_object_set (sink->splitmuxsink, "max-size-time",
             ((GstClockTime) sink->target_duration * GST_SECOND), NULL);
+        if (sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF)
+          gst_hls_sink2_update_muxer (sink);
       }
       break;
     case PROP_PLAYLIST_LENGTH:
       sink->playlist_length = g_value_get_uint (value);
       sink->playlist->window_size = sink->playlist_length;
       break;
+    case PROP_MUXER_TYPE:
+      sink->muxer_type = g_value_get_enum (value);
+      if (sink->splitmuxsink)
+        gst_hls_sink2_update_muxer (sink);
+      gst_hls_sink2_reset (sink);
+      break;
+    case PROP_PART_DURATION:
+      sink->part_duration = g_value_get_uint (value);
+      if (sink->splitmuxsink
+          && sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF)
+        gst_hls_sink2_update_muxer (sink);
+      if (sink->muxer_type == GST_HLS_SINK2_MUXER_TYPE_CMAF)
+        sink->playlist->part_target = sink->part_duration * GST_MSECOND;
+      break;
+    case PROP_INIT_LOCATION:
+      g_free (sink->init_location);
+      sink->init_location = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -463,6 +1183,15 @@ gst_hls_sink2_get_property (GObject * object, guint prop_id,
     case PROP_PLAYLIST_LENGTH:
       g_value_set_uint (value, sink->playlist_length);
       break;
+    case PROP_MUXER_TYPE:
+      g_value_set_enum (value, sink->muxer_type);
+      break;
+    case PROP_PART_DURATION:
+      g_value_set_uint (value, sink->part_duration);
+      break;
+    case PROP_INIT_LOCATION:
+      g_value_set_string (value, sink->init_location);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -20,7 +20,10 @@
 #define _GST_HLS_SINK2_H_
 
 #include "gstm3u8playlist.h"
+#include "gsthlsplaylistwriter.h"
 #include <gst/gst.h>
+#include <gst/base/gstadapter.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -31,6 +34,21 @@ G_BEGIN_DECLS
 #define GST_IS_HLS_SINK2(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_HLS_SINK2))
 #define GST_IS_HLS_SINK2_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_HLS_SINK2))
 
+#define GST_TYPE_HLS_SINK2_MUXER_TYPE (gst_hls_sink2_muxer_type_get_type())
+
+/**
+ * GstHlsSink2MuxerType:
+ * @GST_HLS_SINK2_MUXER_TYPE_MPEGTS: MPEG-TS segments
+ * @GST_HLS_SINK2_MUXER_TYPE_CMAF: fragmented MP4 (CMAF) segments
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_HLS_SINK2_MUXER_TYPE_MPEGTS,
+  GST_HLS_SINK2_MUXER_TYPE_CMAF
+} GstHlsSink2MuxerType;
+
 typedef struct _GstHlsSink2 GstHlsSink2;
 typedef struct _GstHlsSink2Class GstHlsSink2Class;
 
@@ -39,6 +57,7 @@ struct _GstHlsSink2
   GstBin bin;
 
   GstElement *splitmuxsink;
+  GstElement *giostreamsink;
   GstPad *audio_sink, *video_sink;
 
   gchar *location;
@@ -47,21 +66,48 @@ struct _GstHlsSink2
   guint playlist_length;
   gint max_files;
   gint target_duration;
+  GstHlsSink2MuxerType muxer_type;
+  guint part_duration;
+  gchar *init_location;
 
   GstM3U8Playlist *playlist;
+  GstHlsPlaylistWriter *playlist_writer;
   guint index;
 
+  guint fragment_id;
   gchar *current_location;
+  GOutputStream *current_stream;
   GstClockTime current_running_time_start;
   GQueue old_locations;
+
+  /* fragmented MP4 boxes, written one at a time */
+  GstAdapter *cmaf_adapter;
+  GstBuffer *init_segment;
+  gboolean init_written;
+  guint32 ref_track_id;
+  guint32 ref_timescale;
+  gboolean ref_is_video;
+  guint64 fragment_offset;
+  guint64 part_offset;
+  GstClockTime part_time;
+  gboolean part_independent;
+  gboolean in_part;
+  /* keep the fragment numbers and decode times running across segments */
+  guint32 sequence_number;
+  GArray *tracks;
 };
 
 struct _GstHlsSink2Class
 {
   GstBinClass bin_class;
+
+  GOutputStream * (*get_playlist_stream) (GstHlsSink2 * sink, const gchar * location);
+  GOutputStream * (*get_fragment_stream) (GstHlsSink2 * sink, const gchar * location);
+  void (*delete_fragment) (GstHlsSink2 * sink, const gchar * location);
 };
 
 GType gst_hls_sink2_get_type (void);
+GType gst_hls_sink2_muxer_type_get_type (void);
 gboolean gst_hls_sink2_plugin_init (GstPlugin * plugin);
 
 G_END_DECLS
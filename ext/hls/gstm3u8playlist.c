@@ -33,6 +33,7 @@ enum
 };
 
 typedef struct _GstM3U8Entry GstM3U8Entry;
+typedef struct _GstM3U8Part GstM3U8Part;
 
 struct _GstM3U8Entry
 {
@@ -40,8 +41,31 @@ struct _GstM3U8Entry
   gchar *title;
   gchar *url;
   gboolean discontinuous;
+  GList *parts;
+
+  /* formatted once when added */
+  gchar *rendered;
+};
+
+struct _GstM3U8Part
+{
+  gfloat duration;
+  gchar *url;
+  guint64 offset;
+  guint64 size;
+  gboolean independent;
+
+  gchar *rendered;
 };
 
+static void
+gst_m3u8_part_free (GstM3U8Part * part)
+{
+  g_free (part->url);
+  g_free (part->rendered);
+  g_free (part);
+}
+
 static GstM3U8Entry *
 gst_m3u8_entry_new (const gchar * url, const gchar * title,
     gfloat duration, gboolean discontinuous)
@@ -65,6 +89,8 @@ gst_m3u8_entry_free (GstM3U8Entry * entry)
 
   g_free (entry->url);
   g_free (entry->title);
+  g_free (entry->rendered);
+  g_list_free_full (entry->parts, (GDestroyNotify) gst_m3u8_part_free);
   g_free (entry);
 }
 
@@ -80,6 +106,7 @@ gst_m3u8_playlist_new (guint version, guint window_size, gboolean allow_cache)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->parts = g_queue_new ();
 
   return playlist;
 }
@@ -91,6 +118,8 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_queue_free_full (playlist->parts, (GDestroyNotify) gst_m3u8_part_free);
+  g_free (playlist->map_uri);
   g_free (playlist);
 }
 
@@ -109,6 +138,20 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
     return FALSE;
 
   entry = gst_m3u8_entry_new (url, title, duration, discontinuous);
+  if (playlist->version < 3) {
+    entry->rendered = g_strdup_printf ("#EXTINF:%d,%s\n%s\n",
+        (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
+        entry->title ? entry->title : "", entry->url);
+  } else {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+    entry->rendered = g_strdup_printf ("#EXTINF:%s,%s\n%s\n",
+        g_ascii_dtostr (buf, sizeof (buf), entry->duration / GST_SECOND),
+        entry->title ? entry->title : "", entry->url);
+  }
+  /* the parts written so far make up the new entry */
+  entry->parts = playlist->parts->head;
+  g_queue_init (playlist->parts);
 
   if (playlist->window_size > 0) {
     /* Delete old entries from the playlist */
@@ -126,6 +169,49 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   return TRUE;
 }
 
+/* Adds a part of the entry being written, it is listed after the last
+ * entry until that one is added */
+gboolean
+gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist, const gchar * url,
+    gfloat duration, guint64 offset, guint64 size, gboolean independent)
+{
+  GstM3U8Part *part;
+  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+  g_return_val_if_fail (playlist != NULL, FALSE);
+  g_return_val_if_fail (url != NULL, FALSE);
+
+  if (playlist->type == GST_M3U8_PLAYLIST_TYPE_VOD)
+    return FALSE;
+
+  part = g_new0 (GstM3U8Part, 1);
+  part->url = g_strdup (url);
+  part->duration = duration;
+  part->offset = offset;
+  part->size = size;
+  part->independent = independent;
+  part->rendered = g_strdup_printf ("#EXT-X-PART:DURATION=%s,URI=\"%s\","
+      "BYTERANGE=\"%" G_GUINT64_FORMAT "@%" G_GUINT64_FORMAT "\"%s\n",
+      g_ascii_dtostr (buf, sizeof (buf), part->duration / GST_SECOND),
+      part->url, part->size, part->offset,
+      part->independent ? ",INDEPENDENT=YES" : "");
+  g_queue_push_tail (playlist->parts, part);
+
+  return TRUE;
+}
+
+static void
+gst_m3u8_playlist_render_parts (GString * playlist_str, GList * parts)
+{
+  GList *l;
+
+  for (l = parts; l != NULL; l = l->next) {
+    GstM3U8Part *part = l->data;
+
+    g_string_append (playlist_str, part->rendered);
+  }
+}
+
 static guint
 gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 {
@@ -146,11 +232,17 @@ gchar *
 gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
 {
   GString *playlist_str;
-  GList *l;
+  GList *l, *parts_start = NULL;
+  gboolean render_parts = FALSE;
+  guint target_duration;
 
   g_return_val_if_fail (playlist != NULL, NULL);
 
-  playlist_str = g_string_new ("#EXTM3U\n");
+  target_duration = gst_m3u8_playlist_target_duration (playlist);
+
+  /* the last playlist is about the size of the new one */
+  playlist_str = g_string_sized_new (playlist->render_size + 256);
+  g_string_append (playlist_str, "#EXTM3U\n");
 
   g_string_append_printf (playlist_str, "#EXT-X-VERSION:%d\n",
       playlist->version);
@@ -162,32 +254,58 @@ gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
       playlist->sequence_number - playlist->entries->length);
 
   g_string_append_printf (playlist_str, "#EXT-X-TARGETDURATION:%u\n",
-      gst_m3u8_playlist_target_duration (playlist));
+      target_duration);
+
+  if (playlist->part_target) {
+    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+    guint64 total = 0;
+
+    g_string_append_printf (playlist_str,
+        "#EXT-X-SERVER-CONTROL:PART-HOLD-BACK=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf),
+            3.0 * playlist->part_target / GST_SECOND));
+    g_string_append_printf (playlist_str, "#EXT-X-PART-INF:PART-TARGET=%s\n",
+        g_ascii_dtostr (buf, sizeof (buf),
+            (gdouble) playlist->part_target / GST_SECOND));
+
+    /* only the parts of the last three target durations are kept */
+    for (l = playlist->entries->tail; l != NULL; l = l->prev) {
+      GstM3U8Entry *entry = l->data;
+
+      if (total >= 3 * target_duration * GST_SECOND)
+        break;
+      total += entry->duration;
+      parts_start = l;
+    }
+  }
+
+  if (playlist->map_uri)
+    g_string_append_printf (playlist_str, "#EXT-X-MAP:URI=\"%s\"\n",
+        playlist->map_uri);
   g_string_append (playlist_str, "\n");
 
   /* Entries */
   for (l = playlist->entries->head; l != NULL; l = l->next) {
-    gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
     GstM3U8Entry *entry = l->data;
 
     if (entry->discontinuous)
       g_string_append (playlist_str, "#EXT-X-DISCONTINUITY\n");
 
-    if (playlist->version < 3) {
-      g_string_append_printf (playlist_str, "#EXTINF:%d,%s\n",
-          (gint) ((entry->duration + 500 * GST_MSECOND) / GST_SECOND),
-          entry->title ? entry->title : "");
-    } else {
-      g_string_append_printf (playlist_str, "#EXTINF:%s,%s\n",
-          g_ascii_dtostr (buf, sizeof (buf), entry->duration / GST_SECOND),
-          entry->title ? entry->title : "");
-    }
+    if (l == parts_start)
+      render_parts = TRUE;
+    if (render_parts)
+      gst_m3u8_playlist_render_parts (playlist_str, entry->parts);
 
-    g_string_append_printf (playlist_str, "%s\n", entry->url);
+    g_string_append (playlist_str, entry->rendered);
   }
 
+  if (playlist->part_target)
+    gst_m3u8_playlist_render_parts (playlist_str, playlist->parts->head);
+
   if (playlist->end_list)
     g_string_append (playlist_str, "#EXT-X-ENDLIST");
 
+  playlist->render_size = playlist_str->len;
+
   return g_string_free (playlist_str, FALSE);
 }
@@ -37,8 +37,14 @@ struct _GstM3U8Playlist
   gboolean end_list;
   guint sequence_number;
 
+  /* fragmented MP4 init segment and low latency partial segments */
+  gchar *map_uri;
+  guint64 part_target;
+
   /*< Private >*/
   GQueue *entries;
+  GQueue *parts;
+  gsize render_size;
 };
 
 
@@ -55,6 +61,13 @@ gboolean          gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
                                                guint             index,
                                                gboolean          discontinuous);
 
+gboolean          gst_m3u8_playlist_add_part (GstM3U8Playlist * playlist,
+                                              const gchar     * url,
+                                              gfloat            duration,
+                                              guint64           offset,
+                                              guint64           size,
+                                              gboolean          independent);
+
 gchar *           gst_m3u8_playlist_render (GstM3U8Playlist * playlist);
 
 G_END_DECLS
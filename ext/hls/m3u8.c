@@ -34,6 +34,9 @@
 static GstM3U8MediaFile *gst_m3u8_media_file_new (gchar * uri,
     gchar * title, GstClockTime duration, guint sequence);
 static gchar *uri_join (const gchar * uri, const gchar * path);
+static gboolean uri_join_equal (const gchar * uri, const gchar * path,
+    const gchar * joined);
+static void gst_m3u8_partial_segment_free (GstM3U8PartialSegment * part);
 
 GstM3U8 *
 gst_m3u8_new (void)
@@ -45,9 +48,12 @@ gst_m3u8_new (void)
   m3u8->current_file = NULL;
   m3u8->current_file_duration = GST_CLOCK_TIME_NONE;
   m3u8->sequence = -1;
+  m3u8->current_part = -1;
   m3u8->sequence_position = 0;
   m3u8->highest_sequence_number = -1;
   m3u8->duration = GST_CLOCK_TIME_NONE;
+  m3u8->part_hold_back = GST_CLOCK_TIME_NONE;
+  m3u8->skip_boundary = GST_CLOCK_TIME_NONE;
 
   g_mutex_init (&m3u8->lock);
   m3u8->ref_count = 1;
@@ -103,9 +109,15 @@ gst_m3u8_unref (GstM3U8 * self)
     g_free (self->uri);
     g_free (self->base_uri);
     g_free (self->name);
+    g_free (self->entity_tag);
+    g_free (self->last_modified);
 
     g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_unref, NULL);
     g_list_free (self->files);
+    if (self->partial_file)
+      gst_m3u8_media_file_unref (self->partial_file);
+    if (self->preload_hint)
+      gst_m3u8_partial_segment_free (self->preload_hint);
 
     g_free (self->last_data);
     g_mutex_clear (&self->lock);
@@ -147,10 +159,32 @@ gst_m3u8_media_file_unref (GstM3U8MediaFile * self)
     g_free (self->title);
     g_free (self->uri);
     g_free (self->key);
+    if (self->partial_segments)
+      g_ptr_array_unref (self->partial_segments);
     g_free (self);
   }
 }
 
+static GstM3U8PartialSegment *
+gst_m3u8_partial_segment_new (void)
+{
+  GstM3U8PartialSegment *part;
+
+  part = g_new0 (GstM3U8PartialSegment, 1);
+  part->duration = GST_CLOCK_TIME_NONE;
+  part->offset = 0;
+  part->size = -1;
+
+  return part;
+}
+
+static void
+gst_m3u8_partial_segment_free (GstM3U8PartialSegment * part)
+{
+  g_free (part->uri);
+  g_free (part);
+}
+
 static gboolean
 int_from_string (gchar * ptr, gchar ** endptr, gint * val)
 {
@@ -295,6 +329,71 @@ parse_attributes (gchar ** ptr, gchar ** a, gchar ** v)
   return TRUE;
 }
 
+/* Parses the attributes of an EXT-X-PART or EXT-X-PRELOAD-HINT tag, @prev is
+ * the part listed before it, whose byte range is continued when no offset is
+ * given */
+static GstM3U8PartialSegment *
+gst_m3u8_parse_partial_segment (GstM3U8 * self, gchar * data,
+    GstM3U8PartialSegment * prev)
+{
+  GstM3U8PartialSegment *part;
+  gboolean have_offset = FALSE, is_part = TRUE;
+  gchar *a, *v;
+
+  part = gst_m3u8_partial_segment_new ();
+
+  while (data && parse_attributes (&data, &a, &v)) {
+    if (g_str_equal (a, "URI")) {
+      g_free (part->uri);
+      part->uri = uri_join (self->base_uri ? self->base_uri : self->uri, v);
+    } else if (g_str_equal (a, "DURATION")) {
+      gdouble fval;
+
+      if (double_from_string (v, NULL, &fval) && fval >= 0)
+        part->duration = fval * (gdouble) GST_SECOND;
+    } else if (g_str_equal (a, "INDEPENDENT")) {
+      part->independent = g_ascii_strcasecmp (v, "YES") == 0;
+    } else if (g_str_equal (a, "BYTERANGE")) {
+      gint64 size, offset;
+
+      /* <n>[@<o>] */
+      if (int64_from_string (v, &v, &size)) {
+        part->size = size;
+        if (*v == '@' && int64_from_string (v + 1, NULL, &offset)) {
+          part->offset = offset;
+          have_offset = TRUE;
+        }
+      }
+    } else if (g_str_equal (a, "BYTERANGE-START")) {
+      gint64 offset;
+
+      if (int64_from_string (v, NULL, &offset)) {
+        part->offset = offset;
+        have_offset = TRUE;
+      }
+    } else if (g_str_equal (a, "BYTERANGE-LENGTH")) {
+      gint64 size;
+
+      if (int64_from_string (v, NULL, &size))
+        part->size = size;
+    } else if (g_str_equal (a, "TYPE")) {
+      /* preload hints can also announce the next EXT-X-MAP */
+      is_part = g_str_equal (v, "PART");
+    }
+  }
+
+  if (part->uri == NULL || !is_part) {
+    gst_m3u8_partial_segment_free (part);
+    return NULL;
+  }
+
+  if (part->size != -1 && !have_offset && prev && prev->size != -1
+      && g_str_equal (prev->uri, part->uri))
+    part->offset = prev->offset + prev->size;
+
+  return part;
+}
+
 static gint
 gst_hls_variant_stream_compare_by_bitrate (gconstpointer a, gconstpointer b)
 {
@@ -441,6 +540,101 @@ generate_media_seqnums (GstM3U8 * self, GList * previous_files)
   }
 }
 
+/* Adds the @n files of @previous_files from @sequence on to the files being
+ * parsed, in reverse order. call with M3U8_LOCK held */
+static gboolean
+m3u8_take_skipped_files (GstM3U8 * self, GList * previous_files,
+    gint64 sequence, gint n)
+{
+  GList *l;
+
+  for (l = previous_files; l && n > 0; l = l->next) {
+    GstM3U8MediaFile *file = l->data;
+
+    if (file->sequence < sequence)
+      continue;
+    if (file->sequence > sequence)
+      return FALSE;
+
+    self->files = g_list_prepend (self->files, gst_m3u8_media_file_ref (file));
+    sequence++;
+    n--;
+  }
+
+  return n == 0;
+}
+
+/* Parts are only played at the live edge, and not for encrypted streams:
+ * each part would need the CBC state at the end of the previous one.
+ * call with M3U8_LOCK held */
+static gboolean
+m3u8_can_play_parts (GstM3U8 * m3u8)
+{
+  GstM3U8MediaFile *last;
+
+  if (!GST_M3U8_IS_LIVE (m3u8) || m3u8->part_target == 0 || !m3u8->files)
+    return FALSE;
+
+  last = g_list_last (m3u8->files)->data;
+  return last->key == NULL && (m3u8->partial_file == NULL
+      || m3u8->partial_file->key == NULL);
+}
+
+/* Starts a live playlist with parts on the independent part closest to
+ * PART-HOLD-BACK from its end. call with M3U8_LOCK held */
+static gboolean
+m3u8_find_live_partial_start (GstM3U8 * m3u8)
+{
+  GstClockTime hold_back, from_end = 0, end;
+  GstM3U8MediaFile *file;
+  GList *l;
+
+  /* PART-HOLD-BACK must be at least twice the part target, three times is
+   * recommended */
+  hold_back = m3u8->part_hold_back;
+  if (!GST_CLOCK_TIME_IS_VALID (hold_back))
+    hold_back = 3 * m3u8->part_target;
+
+  end = m3u8->last_file_end;
+  if (m3u8->partial_file)
+    end += m3u8->partial_file->duration;
+
+  file = m3u8->partial_file;
+  l = g_list_last (m3u8->files);
+  if (file == NULL && l) {
+    file = l->data;
+    l = l->prev;
+  }
+
+  while (file && file->partial_segments) {
+    gint i;
+
+    for (i = file->partial_segments->len - 1; i >= 0; i--) {
+      GstM3U8PartialSegment *part =
+          g_ptr_array_index (file->partial_segments, i);
+
+      from_end += part->duration;
+      if (from_end >= hold_back && (part->independent || i == 0)) {
+        m3u8->current_file = NULL;
+        m3u8->sequence = file->sequence;
+        m3u8->current_part = i;
+        m3u8->sequence_position = end > from_end ? end - from_end : 0;
+        GST_DEBUG ("first sequence: %u, part %d", (guint) m3u8->sequence, i);
+        return TRUE;
+      }
+    }
+
+    if (l) {
+      file = l->data;
+      l = l->prev;
+    } else {
+      file = NULL;
+    }
+  }
+
+  return FALSE;
+}
+
 /*
  * @data: a m3u8 playlist text data, taking ownership
  */
@@ -457,7 +651,9 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   gint64 size = -1, offset = -1;
   gint64 mediasequence;
   GList *previous_files = NULL;
+  GList *previous_walk;
   gboolean have_mediasequence = FALSE;
+  GPtrArray *parts = NULL;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
@@ -491,7 +687,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   self->last_data = data;
 
   self->current_file = NULL;
-  previous_files = self->files;
+  previous_files = previous_walk = self->files;
   self->files = NULL;
   self->duration = GST_CLOCK_TIME_NONE;
   mediasequence = 0;
@@ -499,6 +695,19 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   /* By default, allow caching */
   self->allowcache = TRUE;
 
+  self->part_target = 0;
+  self->part_hold_back = GST_CLOCK_TIME_NONE;
+  self->can_block_reload = FALSE;
+  self->skip_boundary = GST_CLOCK_TIME_NONE;
+  if (self->partial_file) {
+    gst_m3u8_media_file_unref (self->partial_file);
+    self->partial_file = NULL;
+  }
+  if (self->preload_hint) {
+    gst_m3u8_partial_segment_free (self->preload_hint);
+    self->preload_hint = NULL;
+  }
+
   duration = 0;
   title = NULL;
   data += 7;
@@ -516,9 +725,45 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
     if (data[0] != '#' && data[0] != '\0') {
       if (duration <= 0) {
         GST_LOG ("%s: got line without EXTINF, dropping", data);
+        if (parts) {
+          g_ptr_array_unref (parts);
+          parts = NULL;
+        }
         goto next_line;
       }
 
+      /* Reloads of live playlists mostly append files, reuse the ones we
+       * already have instead of creating them again. Files with the same
+       * sequence number must be the same, check_media_seqnums() makes sure
+       * of that for the others. Files with parts are recreated with the
+       * parts of this playlist */
+      if (have_mediasequence && parts == NULL) {
+        while (previous_walk &&
+            GST_M3U8_MEDIA_FILE (previous_walk->data)->sequence <
+            mediasequence)
+          previous_walk = previous_walk->next;
+
+        if (previous_walk) {
+          GstM3U8MediaFile *file = previous_walk->data;
+
+          if (file->sequence == mediasequence && file->duration == duration
+              && file->partial_segments == NULL
+              && uri_join_equal (self->base_uri ? self->base_uri : self->uri,
+                  data, file->uri)) {
+            self->files = g_list_prepend (self->files,
+                gst_m3u8_media_file_ref (file));
+            mediasequence++;
+
+            duration = 0;
+            g_free (title);
+            title = NULL;
+            discontinuity = FALSE;
+            size = offset = -1;
+            goto next_line;
+          }
+        }
+      }
+
       data = uri_join (self->base_uri ? self->base_uri : self->uri, data);
       if (data != NULL) {
         GstM3U8MediaFile *file;
@@ -555,6 +800,8 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         }
 
         file->discont = discontinuity;
+        file->partial_segments = parts;
+        parts = NULL;
 
         duration = 0;
         title = NULL;
@@ -663,6 +910,73 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
             }
           }
         }
+      } else if (g_str_has_prefix (data_ext_x, "PART-INF:")) {
+        gchar *v, *a;
+
+        data = data + 16;
+        while (data && parse_attributes (&data, &a, &v)) {
+          gdouble fval;
+
+          if (g_str_equal (a, "PART-TARGET")
+              && double_from_string (v, NULL, &fval) && fval > 0)
+            self->part_target = fval * (gdouble) GST_SECOND;
+        }
+      } else if (g_str_has_prefix (data_ext_x, "PART:")) {
+        GstM3U8PartialSegment *part;
+
+        part = gst_m3u8_parse_partial_segment (self, data + 12,
+            parts ? g_ptr_array_index (parts, parts->len - 1) : NULL);
+        if (part == NULL || !GST_CLOCK_TIME_IS_VALID (part->duration)) {
+          GST_WARNING ("Can't read EXT-X-PART");
+          if (part)
+            gst_m3u8_partial_segment_free (part);
+          goto next_line;
+        }
+        if (parts == NULL)
+          parts = g_ptr_array_new_with_free_func ((GDestroyNotify)
+              gst_m3u8_partial_segment_free);
+        g_ptr_array_add (parts, part);
+      } else if (g_str_has_prefix (data_ext_x, "PRELOAD-HINT:")) {
+        if (self->preload_hint)
+          gst_m3u8_partial_segment_free (self->preload_hint);
+        self->preload_hint = gst_m3u8_parse_partial_segment (self, data + 20,
+            parts ? g_ptr_array_index (parts, parts->len - 1) : NULL);
+      } else if (g_str_has_prefix (data_ext_x, "SERVER-CONTROL:")) {
+        gchar *v, *a;
+
+        data = data + 22;
+        while (data && parse_attributes (&data, &a, &v)) {
+          gdouble fval;
+
+          if (g_str_equal (a, "CAN-BLOCK-RELOAD")) {
+            self->can_block_reload = g_ascii_strcasecmp (v, "YES") == 0;
+          } else if (g_str_equal (a, "PART-HOLD-BACK")
+              && double_from_string (v, NULL, &fval) && fval >= 0) {
+            self->part_hold_back = fval * (gdouble) GST_SECOND;
+          } else if (g_str_equal (a, "CAN-SKIP-UNTIL")
+              && double_from_string (v, NULL, &fval) && fval > 0) {
+            self->skip_boundary = fval * (gdouble) GST_SECOND;
+          }
+        }
+      } else if (g_str_has_prefix (data_ext_x, "SKIP:")) {
+        gchar *v, *a;
+        gint skipped = -1;
+
+        /* Delta update, the first SKIPPED-SEGMENTS files are the ones of
+         * the previous version */
+        data = data + 12;
+        while (data && parse_attributes (&data, &a, &v)) {
+          if (g_str_equal (a, "SKIPPED-SEGMENTS"))
+            int_from_string (v, NULL, &skipped);
+        }
+        if (skipped < 0 || !have_mediasequence
+            || !m3u8_take_skipped_files (self, previous_files, mediasequence,
+                skipped)) {
+          GST_WARNING ("Can't find the %d files skipped by the delta update",
+              skipped);
+          goto skip_failed;
+        }
+        mediasequence += skipped;
       } else if (g_str_has_prefix (data_ext_x, "BYTERANGE:")) {
         gchar *v = data + 17;
 
@@ -685,6 +999,24 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
     data = g_utf8_next_char (end);      /* skip \n */
   }
 
+  /* Parts after the last file belong to the segment being produced */
+  if (parts) {
+    GstM3U8MediaFile *file;
+    guint i;
+
+    file = gst_m3u8_media_file_new (NULL, NULL, 0, mediasequence);
+    for (i = 0; i < parts->len; i++) {
+      GstM3U8PartialSegment *part = g_ptr_array_index (parts, i);
+
+      file->duration += part->duration;
+    }
+    file->key = g_strdup (current_key);
+    file->discont = discontinuity;
+    file->partial_segments = parts;
+    parts = NULL;
+    self->partial_file = file;
+  }
+
   g_free (current_key);
   current_key = NULL;
 
@@ -716,6 +1048,11 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
     return FALSE;
   }
 
+  if (self->partial_file) {
+    self->partial_file->sequence =
+        GST_M3U8_MEDIA_FILE (g_list_last (self->files)->data)->sequence + 1;
+  }
+
   /* calculate the start and end times of this media playlist. */
   {
     GList *walk;
@@ -763,6 +1100,9 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   }
 
   /* first-time setup */
+  if (self->sequence == -1 && m3u8_can_play_parts (self))
+    m3u8_find_live_partial_start (self);
+
   if (self->files && self->sequence == -1) {
     GList *file;
 
@@ -795,12 +1135,29 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
     GST_DEBUG ("first sequence: %u", (guint) self->sequence);
   }
 
+  self->update_time = g_get_monotonic_time ();
+
   GST_LOG ("processed media playlist %s, %u fragments", self->name,
       g_list_length (self->files));
 
   GST_M3U8_UNLOCK (self);
 
   return TRUE;
+
+skip_failed:
+  {
+    /* keep the previous version, a full reload is needed */
+    g_free (title);
+    g_free (current_key);
+    if (parts)
+      g_ptr_array_unref (parts);
+    g_list_free_full (self->files, (GDestroyNotify) gst_m3u8_media_file_unref);
+    self->files = previous_files;
+    g_free (self->last_data);
+    self->last_data = NULL;
+    GST_M3U8_UNLOCK (self);
+    return FALSE;
+  }
 }
 
 /* call with M3U8_LOCK held */
@@ -835,6 +1192,95 @@ m3u8_find_next_fragment (GstM3U8 * m3u8, gboolean forward)
   return l;
 }
 
+/* call with M3U8_LOCK held */
+static GstM3U8MediaFile *
+m3u8_find_file (GstM3U8 * m3u8, gint64 sequence)
+{
+  GList *l;
+
+  /* parts are only listed for the last files */
+  for (l = g_list_last (m3u8->files); l; l = l->prev) {
+    GstM3U8MediaFile *file = l->data;
+
+    if (file->sequence == sequence)
+      return file;
+    if (file->sequence < sequence)
+      break;
+  }
+
+  return NULL;
+}
+
+/* Moves on to the next sequence once all the parts of a complete file were
+ * played, and back to whole files when the playlist doesn't list their
+ * parts anymore. call with M3U8_LOCK held */
+static void
+m3u8_sync_partial_position (GstM3U8 * m3u8)
+{
+  while (m3u8->current_part >= 0) {
+    GstM3U8MediaFile *file = m3u8_find_file (m3u8, m3u8->sequence);
+    guint n_parts;
+
+    /* still being produced */
+    if (file == NULL)
+      break;
+
+    n_parts = file->partial_segments ? file->partial_segments->len : 0;
+    if ((guint) m3u8->current_part < n_parts)
+      break;
+
+    if (m3u8->current_part == 0) {
+      m3u8->current_part = -1;
+      break;
+    }
+
+    m3u8->sequence++;
+    m3u8->current_part = 0;
+  }
+
+  if (m3u8->current_part < 0)
+    m3u8->current_file = NULL;
+}
+
+/* Returns a media file for the current part, or %NULL if it is not
+ * available yet. call with M3U8_LOCK held */
+static GstM3U8MediaFile *
+m3u8_get_partial_fragment (GstM3U8 * m3u8)
+{
+  GstM3U8MediaFile *file, *parent;
+  GstM3U8PartialSegment *part = NULL;
+  guint n_parts;
+
+  parent = m3u8_find_file (m3u8, m3u8->sequence);
+  if (parent == NULL && m3u8->partial_file
+      && m3u8->partial_file->sequence == m3u8->sequence)
+    parent = m3u8->partial_file;
+
+  n_parts = parent && parent->partial_segments ?
+      parent->partial_segments->len : 0;
+
+  if ((guint) m3u8->current_part < n_parts) {
+    part = g_ptr_array_index (parent->partial_segments, m3u8->current_part);
+  } else if (m3u8->preload_hint && (guint) m3u8->current_part == n_parts
+      && m3u8->sequence ==
+      GST_M3U8_MEDIA_FILE (g_list_last (m3u8->files)->data)->sequence + 1) {
+    /* the server sends the hinted part while it is produced */
+    part = m3u8->preload_hint;
+  }
+
+  if (part == NULL)
+    return NULL;
+
+  file = gst_m3u8_media_file_new (g_strdup (part->uri), NULL,
+      GST_CLOCK_TIME_IS_VALID (part->duration) ? part->duration :
+      m3u8->part_target, m3u8->sequence);
+  file->offset = part->offset;
+  file->size = part->size;
+  file->discont = parent && parent->discont && m3u8->current_part == 0;
+
+  return file;
+}
+
 GstM3U8MediaFile *
 gst_m3u8_get_next_fragment (GstM3U8 * m3u8, gboolean forward,
     GstClockTime * sequence_position, gboolean * discont)
@@ -850,8 +1296,44 @@ gst_m3u8_get_next_fragment (GstM3U8 * m3u8, gboolean forward,
   if (m3u8->sequence < 0)       /* can't happen really */
     goto out;
 
-  if (m3u8->current_file == NULL)
-    m3u8->current_file = m3u8_find_next_fragment (m3u8, forward);
+  if (m3u8->current_part >= 0) {
+    if (forward)
+      m3u8_sync_partial_position (m3u8);
+    else
+      m3u8->current_part = -1;
+  }
+
+  if (m3u8->current_part < 0) {
+    if (m3u8->current_file == NULL)
+      m3u8->current_file = m3u8_find_next_fragment (m3u8, forward);
+
+    /* caught up with the live edge, carry on with the parts of the segment
+     * being produced */
+    if (m3u8->current_file == NULL && forward && m3u8_can_play_parts (m3u8)
+        && m3u8->sequence ==
+        GST_M3U8_MEDIA_FILE (g_list_last (m3u8->files)->data)->sequence + 1) {
+      GST_DEBUG ("Switching to the parts of sequence %" G_GINT64_FORMAT,
+          m3u8->sequence);
+      m3u8->current_part = 0;
+    }
+  }
+
+  if (m3u8->current_part >= 0) {
+    file = m3u8_get_partial_fragment (m3u8);
+    if (file == NULL)
+      goto out;
+
+    GST_DEBUG ("Got part %d of sequence %u", m3u8->current_part,
+        (guint) m3u8->sequence);
+
+    if (sequence_position)
+      *sequence_position = m3u8->sequence_position;
+    if (discont)
+      *discont = file->discont;
+
+    m3u8->current_file_duration = file->duration;
+    goto out;
+  }
 
   if (m3u8->current_file == NULL)
     goto out;
@@ -889,19 +1371,57 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
   GST_DEBUG ("Checking next fragment %" G_GINT64_FORMAT,
       m3u8->sequence + (forward ? 1 : -1));
 
-  if (m3u8->current_file) {
-    cur = m3u8->current_file;
+  if (m3u8->current_part >= 0 && forward) {
+    /* more parts keep coming until the part mode is left */
+    have_next = GST_M3U8_IS_LIVE (m3u8);
   } else {
-    cur = m3u8_find_next_fragment (m3u8, forward);
-  }
+    if (m3u8->current_file) {
+      cur = m3u8->current_file;
+    } else {
+      cur = m3u8_find_next_fragment (m3u8, forward);
+    }
 
-  have_next = cur && ((forward && cur->next) || (!forward && cur->prev));
+    have_next = cur && ((forward && cur->next) || (!forward && cur->prev));
+  }
 
   GST_M3U8_UNLOCK (m3u8);
 
   return have_next;
 }
 
+/* Returns the fragment @n positions after the current one without advancing
+ * to it, or %NULL if the playlist doesn't contain it (yet) */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, gboolean forward, guint n)
+{
+  GstM3U8MediaFile *file = NULL;
+  GList *l;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  /* parts are only a fraction of a second long, and mostly aren't
+   * available before they're needed */
+  if (m3u8->current_part >= 0)
+    goto out;
+
+  l = m3u8->current_file;
+  if (l == NULL)
+    l = m3u8_find_next_fragment (m3u8, forward);
+
+  for (; l != NULL && n > 0; n--)
+    l = forward ? l->next : l->prev;
+
+  if (l != NULL)
+    file = gst_m3u8_media_file_ref (l->data);
+
+out:
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 /* call with M3U8_LOCK held */
 static void
 m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
@@ -953,6 +1473,16 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
     GST_DEBUG ("Sequence position now %" GST_TIME_FORMAT,
         GST_TIME_ARGS (m3u8->sequence_position));
   }
+  if (m3u8->current_part >= 0) {
+    if (forward) {
+      m3u8->current_part++;
+      m3u8_sync_partial_position (m3u8);
+      GST_DEBUG ("Advanced to sequence %u, part %d", (guint) m3u8->sequence,
+          m3u8->current_part);
+      goto out;
+    }
+    m3u8->current_part = -1;
+  }
   if (!m3u8->current_file) {
     GList *l;
 
@@ -1068,6 +1598,91 @@ gst_m3u8_get_uri (GstM3U8 * m3u8)
   return uri;
 }
 
+/* Returns the URI to reload the playlist with the delivery directives the
+ * server supports, or %NULL if it doesn't support any. Blocking reloads are
+ * answered once the playlist lists the part following the last one of this
+ * version, delta updates skip the files older than the skip boundary */
+gchar *
+gst_m3u8_get_reload_uri (GstM3U8 * m3u8)
+{
+  GString *uri = NULL;
+  gboolean skip;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (!GST_M3U8_IS_LIVE (m3u8) || !m3u8->uri || !m3u8->files)
+    goto out;
+
+  /* Delta updates can only be requested for a version no older than half
+   * the skip boundary */
+  skip = GST_CLOCK_TIME_IS_VALID (m3u8->skip_boundary)
+      && (g_get_monotonic_time () - m3u8->update_time) * GST_USECOND <
+      m3u8->skip_boundary / 2;
+
+  if (!m3u8->can_block_reload && !skip)
+    goto out;
+
+  uri = g_string_new (m3u8->uri);
+  g_string_append_c (uri, strchr (m3u8->uri, '?') ? '&' : '?');
+
+  if (m3u8->can_block_reload) {
+    GstM3U8MediaFile *last = g_list_last (m3u8->files)->data;
+
+    g_string_append_printf (uri, "_HLS_msn=%" G_GINT64_FORMAT "&",
+        last->sequence + 1);
+    if (m3u8->part_target > 0) {
+      guint part = 0;
+
+      if (m3u8->partial_file && m3u8->partial_file->partial_segments)
+        part = m3u8->partial_file->partial_segments->len;
+      g_string_append_printf (uri, "_HLS_part=%u&", part);
+    }
+  }
+  if (skip)
+    g_string_append (uri, "_HLS_skip=YES&");
+
+  /* drop the last separator */
+  g_string_truncate (uri, uri->len - 1);
+
+out:
+  GST_M3U8_UNLOCK (m3u8);
+
+  return uri ? g_string_free (uri, FALSE) : NULL;
+}
+
+void
+gst_m3u8_set_cache_validators (GstM3U8 * m3u8, const gchar * entity_tag,
+    const gchar * last_modified)
+{
+  g_return_if_fail (m3u8 != NULL);
+
+  GST_M3U8_LOCK (m3u8);
+  g_free (m3u8->entity_tag);
+  m3u8->entity_tag = g_strdup (entity_tag);
+  g_free (m3u8->last_modified);
+  m3u8->last_modified = g_strdup (last_modified);
+  GST_M3U8_UNLOCK (m3u8);
+}
+
+/* Returns the EXT-X-PART-INF PART-TARGET of a live playlist whose parts
+ * can be played, 0 otherwise */
+GstClockTime
+gst_m3u8_get_part_target (GstM3U8 * m3u8)
+{
+  GstClockTime part_target = 0;
+
+  g_return_val_if_fail (m3u8 != NULL, 0);
+
+  GST_M3U8_LOCK (m3u8);
+  if (m3u8_can_play_parts (m3u8))
+    part_target = m3u8->part_target;
+  GST_M3U8_UNLOCK (m3u8);
+
+  return part_target;
+}
+
 gboolean
 gst_m3u8_is_live (GstM3U8 * m3u8)
 {
@@ -1138,6 +1753,33 @@ out:
   return ret;
 }
 
+/* Returns whether uri_join (@uri, @path) would give @joined, without
+ * allocating for the relative paths of media playlists */
+static gboolean
+uri_join_equal (const gchar * uri, const gchar * path, const gchar * joined)
+{
+  const gchar *tmp;
+  gsize len;
+
+  if (path[0] == '/' || gst_uri_is_valid (path)) {
+    gchar *ret = uri_join (uri, path);
+    gboolean equal = g_strcmp0 (ret, joined) == 0;
+
+    g_free (ret);
+    return equal;
+  }
+
+  /* same as uri_join(): up to the last / char, ignoring query params */
+  tmp = strchr (uri, '?');
+  len = tmp ? tmp - uri : strlen (uri);
+  tmp = g_strrstr_len (uri, len, "/");
+  if (!tmp)
+    return FALSE;
+  len = tmp - uri + 1;
+
+  return strncmp (joined, uri, len) == 0 && strcmp (joined + len, path) == 0;
+}
+
 gboolean
 gst_m3u8_get_seek_range (GstM3U8 * m3u8, gint64 * start, gint64 * stop)
 {
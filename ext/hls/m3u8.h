@@ -30,6 +30,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstM3U8 GstM3U8;
 typedef struct _GstM3U8MediaFile GstM3U8MediaFile;
+typedef struct _GstM3U8PartialSegment GstM3U8PartialSegment;
 typedef struct _GstHLSMedia GstHLSMedia;
 typedef struct _GstM3U8Client GstM3U8Client;
 typedef struct _GstHLSVariantStream GstHLSVariantStream;
@@ -56,25 +57,37 @@ struct _GstM3U8
                                  * This will be different to uri in case of redirects */
   gchar *name;                  /* This will be the "name" of the playlist, the original
                                  * relative/absolute uri in a variant playlist */
+  gchar *entity_tag;            /* ETag of the last download */
+  gchar *last_modified;         /* Last-Modified date of the last download */
 
   /* parsed info */
   gboolean endlist;             /* if ENDLIST has been reached */
   gint version;                 /* last EXT-X-VERSION */
   GstClockTime targetduration;  /* last EXT-X-TARGETDURATION */
   gboolean allowcache;          /* last EXT-X-ALLOWCACHE */
+  GstClockTime part_target;     /* last EXT-X-PART-INF PART-TARGET */
+  GstClockTime part_hold_back;  /* EXT-X-SERVER-CONTROL PART-HOLD-BACK */
+  gboolean can_block_reload;    /* EXT-X-SERVER-CONTROL CAN-BLOCK-RELOAD */
+  GstClockTime skip_boundary;   /* EXT-X-SERVER-CONTROL CAN-SKIP-UNTIL */
 
   GList *files;
+  GstM3U8MediaFile *partial_file;        /* segment still being produced after
+                                          * the last file, if it has parts */
+  GstM3U8PartialSegment *preload_hint;   /* EXT-X-PRELOAD-HINT of the part
+                                          * following the last listed one */
 
   /* state */
   GList *current_file;
   GstClockTime current_file_duration; /* Duration of current fragment */
   gint64 sequence;                    /* the next sequence for this client */
+  gint current_part;                  /* part of that sequence, -1 when playing whole files */
   GstClockTime sequence_position;     /* position of this sequence */
   gint64 highest_sequence_number;     /* largest seen sequence number */
   GstClockTime first_file_start;      /* timecode of the start of the first fragment in the current media playlist */
   GstClockTime last_file_end;         /* timecode of the end of the last fragment in the current media playlist */
   GstClockTime duration;              /* cached total duration */
   gint discont_sequence;              /* currently expected EXT-X-DISCONTINUITY-SEQUENCE */
+  gint64 update_time;                 /* monotonic time of the last update */
 
   /*< private > */
   gchar *last_data;
@@ -98,9 +111,20 @@ struct _GstM3U8MediaFile
   gchar *key;
   guint8 iv[16];
   gint64 offset, size;
+  GPtrArray *partial_segments;  /* EXT-X-PART of this file, or NULL */
   gint ref_count;               /* ATOMIC */
 };
 
+/* Low latency HLS media playlists also list the parts of the last files as
+ * they are produced, see the EXT-X-PART tag */
+struct _GstM3U8PartialSegment
+{
+  gchar *uri;
+  GstClockTime duration;
+  gboolean independent;         /* the part starts with an independent frame */
+  gint64 offset, size;
+};
+
 GstM3U8MediaFile * gst_m3u8_media_file_ref   (GstM3U8MediaFile * mfile);
 
 void               gst_m3u8_media_file_unref (GstM3U8MediaFile * mfile);
@@ -123,6 +147,10 @@ GstM3U8MediaFile * gst_m3u8_get_next_fragment    (GstM3U8      * m3u8,
 gboolean           gst_m3u8_has_next_fragment    (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
+GstM3U8MediaFile * gst_m3u8_peek_fragment        (GstM3U8 * m3u8,
+                                                  gboolean  forward,
+                                                  guint     n);
+
 void               gst_m3u8_advance_fragment     (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
@@ -132,6 +160,14 @@ GstClockTime       gst_m3u8_get_target_duration  (GstM3U8 * m3u8);
 
 gchar *            gst_m3u8_get_uri              (GstM3U8 * m3u8);
 
+gchar *            gst_m3u8_get_reload_uri       (GstM3U8 * m3u8);
+
+void               gst_m3u8_set_cache_validators (GstM3U8     * m3u8,
+                                                  const gchar * entity_tag,
+                                                  const gchar * last_modified);
+
+GstClockTime       gst_m3u8_get_part_target      (GstM3U8 * m3u8);
+
 gboolean           gst_m3u8_is_live              (GstM3U8 * m3u8);
 
 gboolean           gst_m3u8_get_seek_range       (GstM3U8 * m3u8,
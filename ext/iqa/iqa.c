@@ -33,9 +33,19 @@
  * For each reference frame, IQA will post a message containing
  * a structure named IQA.
  *
- * The only metric supported for now is "dssim", which will be available
- * if https://github.com/pornel/dssim was installed on the system
- * at the time that plugin was compiled.
+ * The supported metrics are:
+ *
+ * * "dssim", which will be available if https://github.com/pornel/dssim was
+ *   installed on the system at the time that plugin was compiled.
+ * * "psnr", the peak signal to noise ratio over the RGB components, in dB.
+ * * "fast-ssim", a structural similarity index computed on the luma of
+ *   non-overlapping 8x8 blocks, much cheaper than dssim but coarser.
+ *
+ * The measurements can be restricted to a region of the frames with the
+ * region-x, region-y, region-width and region-height properties, and done on
+ * one pixel out of "subsampling" in both directions. They are spread over
+ * "n-threads" threads, each compared stream is one dssim job and psnr and
+ * fast-ssim are computed on horizontal stripes of the region.
  *
  * For each metric activated, this structure will contain another
  * structure, named after the metric.
@@ -49,6 +59,9 @@
  * sink_2\=\(double\)0.0082939683976297474\;",
  * time=(guint64)0;
  *
+ * Likewise, psnr and fast-ssim results are stored in structures named "psnr"
+ * and "fast-ssim" with one double field per compared pad.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -m uridecodebin uri=file:///test/file/1 ! iqa name=iqa do-dssim=true \
@@ -61,9 +74,13 @@
 #include "config.h"
 #endif
 
+#include <math.h>
+#include <string.h>
+
 #include "iqa.h"
 
 #ifdef HAVE_DSSIM
+#include <stdlib.h>
 #include "dssim.h"
 #endif
 
@@ -76,6 +93,20 @@ GST_DEBUG_CATEGORY_STATIC (gst_iqa_debug);
 
 #define SRC_FORMAT " { RGBA } "
 
+#define DEFAULT_DO_PSNR FALSE
+#define DEFAULT_DO_FAST_SSIM FALSE
+#define DEFAULT_REGION_X 0
+#define DEFAULT_REGION_Y 0
+#define DEFAULT_REGION_WIDTH 0
+#define DEFAULT_REGION_HEIGHT 0
+#define DEFAULT_SUBSAMPLING 1
+#define DEFAULT_N_THREADS 1
+
+/* side of the blocks the fast SSIM is computed on, in measured pixels */
+#define SSIM_BLOCK_SIZE 8
+#define SSIM_C1 (0.01 * 255 * 0.01 * 255)
+#define SSIM_C2 (0.03 * 255 * 0.03 * 255)
+
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -86,6 +117,14 @@ enum
 {
   PROP_0,
   PROP_DO_SSIM,
+  PROP_DO_PSNR,
+  PROP_DO_FAST_SSIM,
+  PROP_REGION_X,
+  PROP_REGION_Y,
+  PROP_REGION_WIDTH,
+  PROP_REGION_HEIGHT,
+  PROP_SUBSAMPLING,
+  PROP_N_THREADS,
   PROP_LAST,
 };
 
@@ -95,12 +134,54 @@ static GstStaticPadTemplate sink_factory = GST_STATIC_PAD_TEMPLATE ("sink_%u",
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (SINK_FORMATS))
     );
 
+typedef enum
+{
+  GST_IQA_JOB_DSSIM,
+  GST_IQA_JOB_STATS,
+} GstIqaJobType;
+
+/* One unit of work for the thread pool. The frames are RGBA and only the
+ * pixels at rect.x + i * subsampling, rect.y + j * subsampling are
+ * measured, j going from first_row to first_row + n_rows - 1 */
+typedef struct
+{
+  GstIqaJobType type;
+  GstVideoFrame *ref;
+  GstVideoFrame *cmp;
+  GstVideoRectangle rect;
+  guint subsampling;
+  gint first_row;
+  gint n_rows;
+  guint pair;
+
+  /* GST_IQA_JOB_STATS */
+  gboolean do_psnr;
+  gboolean do_fast_ssim;
+  guint64 sse;
+  guint64 n_samples;
+  gdouble ssim_sum;
+  guint64 n_blocks;
+
+#ifdef HAVE_DSSIM
+  /* GST_IQA_JOB_DSSIM */
+  gboolean dssim_valid;
+  gdouble dssim;
+  dssim_ssim_map map;
+#endif
+} GstIqaJob;
 
 /* GstIqa */
 
 #define gst_iqa_parent_class parent_class
 G_DEFINE_TYPE (GstIqa, gst_iqa, GST_TYPE_VIDEO_AGGREGATOR);
 
+/* number of measured pixels along a region side */
+static inline gint
+get_n_samples (gint size, guint subsampling)
+{
+  return (size + subsampling - 1) / subsampling;
+}
+
 #ifdef HAVE_DSSIM
 inline static unsigned char
 to_byte (float in)
@@ -112,116 +193,383 @@ to_byte (float in)
   return in * 256.f;
 }
 
-static gboolean
-do_dssim (GstIqa * self, GstVideoFrame * ref, GstVideoFrame * cmp,
-    GstBuffer * outbuf, GstStructure * msg_structure, gchar * padname)
+static void
+do_dssim (GstIqaJob * job)
 {
   dssim_attr *attr = dssim_create_attr ();
-  gint y;
+  gint width, height, x, y;
+  guint sub = job->subsampling;
   unsigned char **ptrs, **ptrs2;
-  GstMapInfo ref_info;
-  GstMapInfo cmp_info;
-  GstMapInfo out_info;
+  guint8 *copy = NULL;
   dssim_image *ref_image;
   dssim_image *cmp_image;
-  double dssim;
-  dssim_ssim_map map_meta;
-  float *map;
-  gint i;
-  dssim_rgba *out;
-  GstStructure *dssim_structure;
 
-  gst_structure_get (msg_structure, "dssim", GST_TYPE_STRUCTURE,
-      &dssim_structure, NULL);
+  width = get_n_samples (job->rect.w, sub);
+  height = job->n_rows;
 
   dssim_set_save_ssim_maps (attr, 1, 1);
-  if (ref->info.width != cmp->info.width ||
-      ref->info.height != cmp->info.height) {
-    GST_OBJECT_UNLOCK (self);
-
-    GST_ELEMENT_ERROR (self, STREAM, FAILED,
-        ("Video streams do not have the same sizes (add videoscale"
-            " and force the sizes to be equal on all sink pads.)"),
-        ("Reference width %d - compared width: %d. "
-            "Reference height %d - compared height: %d",
-            ref->info.width, cmp->info.width, ref->info.height,
-            cmp->info.height));
-
-    GST_OBJECT_LOCK (self);
-    return FALSE;
+
+  ptrs = g_new (unsigned char *, height);
+  ptrs2 = g_new (unsigned char *, height);
+
+  /* dssim wants packed rows, the subsampled pixels are gathered in a copy */
+  if (sub > 1)
+    copy = g_malloc (2 * width * height * 4);
+
+  for (y = 0; y < height; y++) {
+    gint row = job->rect.y + y * sub;
+    guint8 *ref_line = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (job->ref, 0) +
+        row * GST_VIDEO_FRAME_PLANE_STRIDE (job->ref, 0) + job->rect.x * 4;
+    guint8 *cmp_line = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (job->cmp, 0) +
+        row * GST_VIDEO_FRAME_PLANE_STRIDE (job->cmp, 0) + job->rect.x * 4;
+
+    if (copy) {
+      ptrs[y] = copy + y * width * 4;
+      ptrs2[y] = copy + (height + y) * width * 4;
+      for (x = 0; x < width; x++) {
+        memcpy (ptrs[y] + x * 4, ref_line + x * sub * 4, 4);
+        memcpy (ptrs2[y] + x * 4, cmp_line + x * sub * 4, 4);
+      }
+    } else {
+      ptrs[y] = ref_line;
+      ptrs2[y] = cmp_line;
+    }
   }
 
-  gst_buffer_map (ref->buffer, &ref_info, GST_MAP_READ);
-  gst_buffer_map (cmp->buffer, &cmp_info, GST_MAP_READ);
-  gst_buffer_map (outbuf, &out_info, GST_MAP_WRITE);
-  out = (dssim_rgba *) out_info.data;
+  ref_image =
+      dssim_create_image (attr, ptrs, DSSIM_RGBA, width, height, 0.45455);
+  cmp_image =
+      dssim_create_image (attr, ptrs2, DSSIM_RGBA, width, height, 0.45455);
+  job->dssim = dssim_compare (attr, ref_image, cmp_image);
+  job->map = dssim_pop_ssim_map (attr, 0, 0);
+  job->dssim_valid = TRUE;
+
+  g_free (ptrs);
+  g_free (ptrs2);
+  g_free (copy);
+  dssim_dealloc_image (ref_image);
+  dssim_dealloc_image (cmp_image);
+  dssim_dealloc_attr (attr);
+}
 
-  ptrs = g_malloc (sizeof (char **) * ref->info.height);
+/* draws the SSIM map of the job in the region of the output frame, each
+ * map value covering subsampling x subsampling output pixels */
+static void
+draw_dssim_map (GstIqaJob * job, GstVideoFrame * out_frame)
+{
+  guint8 *out = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
+  gint out_stride = GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0);
+  float *map = job->map.data;
+  guint sub = job->subsampling;
+  gint x, y;
+
+  for (y = 0; y < job->rect.h; y++) {
+    guint8 *line = out + (job->rect.y + y) * out_stride + job->rect.x * 4;
+    const float *map_line = map + (y / sub) * job->map.width;
+
+    for (x = 0; x < job->rect.w; x++) {
+      const float max = 1.0 - map_line[x / sub];
+      const float maxsq = max * max;
 
-  for (y = 0; y < ref->info.height; y++) {
-    ptrs[y] = ref_info.data + (ref->info.width * 4 * y);
+      line[x * 4 + 0] = to_byte (max * 3.0);
+      line[x * 4 + 1] = to_byte (maxsq * 6.0);
+      line[x * 4 + 2] = to_byte (max / ((1.0 - job->map.dssim) * 4.0));
+      line[x * 4 + 3] = 255;
+    }
   }
+}
+#endif
 
-  ref_image =
-      dssim_create_image (attr, ptrs, DSSIM_RGBA, ref->info.width,
-      ref->info.height, 0.45455);
+/* sum of the squared differences of the RGB components of n pixels, the
+ * plain loop on packed pixels is left for the compiler to vectorize */
+static guint64
+sse_line (const guint8 * ref, const guint8 * cmp, gint n, guint stride)
+{
+  guint64 sse = 0;
+  gint i;
 
-  ptrs2 = g_malloc (sizeof (char **) * cmp->info.height);
+  if (stride == 1) {
+    for (i = 0; i < n * 4; i++) {
+      gint d = ((i & 3) == 3) ? 0 : ref[i] - cmp[i];
 
-  for (y = 0; y < cmp->info.height; y++) {
-    ptrs2[y] = cmp_info.data + (cmp->info.width * 4 * y);
-  }
+      sse += d * d;
+    }
+  } else {
+    for (i = 0; i < n; i++) {
+      const guint8 *r = ref + i * stride * 4;
+      const guint8 *c = cmp + i * stride * 4;
+      gint dr = r[0] - c[0], dg = r[1] - c[1], db = r[2] - c[2];
 
-  cmp_image =
-      dssim_create_image (attr, ptrs2, DSSIM_RGBA, cmp->info.width,
-      cmp->info.height, 0.45455);
-  dssim = dssim_compare (attr, ref_image, cmp_image);
+      sse += dr * dr + dg * dg + db * db;
+    }
+  }
 
-  map_meta = dssim_pop_ssim_map (attr, 0, 0);
+  return sse;
+}
 
-  if (dssim > self->max_dssim) {
-    map = map_meta.data;
+static inline guint
+luma (const guint8 * p)
+{
+  return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+}
 
-    for (i = 0; i < map_meta.width * map_meta.height; i++) {
-      const float max = 1.0 - map[i];
-      const float maxsq = max * max;
-      out[i] = (dssim_rgba) {
-      .r = to_byte (max * 3.0),.g = to_byte (maxsq * 6.0),.b =
-            to_byte (max / ((1.0 - map_meta.dssim) * 4.0)),.a = 255,};
+/* SSIM of a block of SSIM_BLOCK_SIZE x SSIM_BLOCK_SIZE measured pixels,
+ * the lines pointers are at the top left corner of the block */
+static gdouble
+ssim_block (const guint8 * ref, gint ref_stride, const guint8 * cmp,
+    gint cmp_stride, guint sub)
+{
+  const gdouble n = SSIM_BLOCK_SIZE * SSIM_BLOCK_SIZE;
+  guint32 sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+  gdouble mx, my, vx, vy, cxy;
+  gint i, j;
+
+  for (j = 0; j < SSIM_BLOCK_SIZE; j++) {
+    const guint8 *r = ref + j * sub * ref_stride;
+    const guint8 *c = cmp + j * sub * cmp_stride;
+
+    for (i = 0; i < SSIM_BLOCK_SIZE; i++) {
+      guint x = luma (r + i * sub * 4);
+      guint y = luma (c + i * sub * 4);
+
+      sx += x;
+      sy += y;
+      sxx += x * x;
+      syy += y * y;
+      sxy += x * y;
     }
-    self->max_dssim = dssim;
   }
 
-  gst_structure_set (dssim_structure, padname, G_TYPE_DOUBLE, dssim, NULL);
-  gst_structure_set (msg_structure, "dssim", GST_TYPE_STRUCTURE,
-      dssim_structure, NULL);
-  gst_structure_free (dssim_structure);
+  mx = sx / n;
+  my = sy / n;
+  vx = sxx / n - mx * mx;
+  vy = syy / n - my * my;
+  cxy = sxy / n - mx * my;
 
-  g_free (ptrs);
-  g_free (ptrs2);
-  gst_buffer_unmap (ref->buffer, &ref_info);
-  gst_buffer_unmap (cmp->buffer, &cmp_info);
-  gst_buffer_unmap (outbuf, &out_info);
-  dssim_dealloc_image (ref_image);
-  dssim_dealloc_image (cmp_image);
-  dssim_dealloc_attr (attr);
+  return ((2 * mx * my + SSIM_C1) * (2 * cxy + SSIM_C2)) /
+      ((mx * mx + my * my + SSIM_C1) * (vx + vy + SSIM_C2));
+}
+
+static void
+do_stats (GstIqaJob * job)
+{
+  const guint8 *ref_data = GST_VIDEO_FRAME_PLANE_DATA (job->ref, 0);
+  const guint8 *cmp_data = GST_VIDEO_FRAME_PLANE_DATA (job->cmp, 0);
+  gint ref_stride = GST_VIDEO_FRAME_PLANE_STRIDE (job->ref, 0);
+  gint cmp_stride = GST_VIDEO_FRAME_PLANE_STRIDE (job->cmp, 0);
+  guint sub = job->subsampling;
+  gint width = get_n_samples (job->rect.w, sub);
+  gint x, y;
+
+  ref_data += job->rect.y * ref_stride + job->rect.x * 4;
+  cmp_data += job->rect.y * cmp_stride + job->rect.x * 4;
+
+  if (job->do_psnr) {
+    for (y = job->first_row; y < job->first_row + job->n_rows; y++) {
+      job->sse += sse_line (ref_data + y * sub * ref_stride,
+          cmp_data + y * sub * cmp_stride, width, sub);
+    }
+    job->n_samples += (guint64) width * job->n_rows * 3;
+  }
 
-  return TRUE;
+  /* the stripes start on a block boundary, only complete blocks count */
+  if (job->do_fast_ssim) {
+    for (y = job->first_row; y + SSIM_BLOCK_SIZE <= job->first_row +
+        job->n_rows; y += SSIM_BLOCK_SIZE) {
+      for (x = 0; x + SSIM_BLOCK_SIZE <= width; x += SSIM_BLOCK_SIZE) {
+        job->ssim_sum +=
+            ssim_block (ref_data + y * sub * ref_stride + x * sub * 4,
+            ref_stride, cmp_data + y * sub * cmp_stride + x * sub * 4,
+            cmp_stride, sub);
+        job->n_blocks++;
+      }
+    }
+  }
 }
+
+/* Runs the jobs [first, last) */
+static void
+gst_iqa_run_job_stripe (gpointer user_data, guint stripe, gint first,
+    gint last)
+{
+  GArray *jobs = user_data;
+  gint i;
+
+  for (i = first; i < last; i++) {
+    GstIqaJob *job = &g_array_index (jobs, GstIqaJob, i);
+
+    switch (job->type) {
+#ifdef HAVE_DSSIM
+      case GST_IQA_JOB_DSSIM:
+        do_dssim (job);
+        break;
 #endif
+      case GST_IQA_JOB_STATS:
+        do_stats (job);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Spreads the jobs over the stripe threads */
+static void
+gst_iqa_run_jobs (GstIqa * self, GArray * jobs)
+{
+  gst_stripe_threads_run (&self->threads, jobs->len, 1,
+      gst_iqa_run_job_stripe, jobs);
+}
 
+/* WITH GST_OBJECT_LOCK !!
+ * Returns the measured region clipped to the frame size */
 static gboolean
-compare_frames (GstIqa * self, GstVideoFrame * ref, GstVideoFrame * cmp,
-    GstBuffer * outbuf, GstStructure * msg_structure, gchar * padname)
+gst_iqa_get_region (GstIqa * self, gint width, gint height,
+    GstVideoRectangle * rect)
 {
+  rect->x = MIN (self->region.x, width);
+  rect->y = MIN (self->region.y, height);
+  rect->w = width - rect->x;
+  rect->h = height - rect->y;
+
+  if (self->region.w > 0)
+    rect->w = MIN (rect->w, self->region.w);
+  if (self->region.h > 0)
+    rect->h = MIN (rect->h, self->region.h);
+
+  return rect->w > 0 && rect->h > 0;
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Queues the jobs comparing cmp to ref: one for dssim, which is not additive
+ * over parts of the frame, and one per stripe for psnr and fast-ssim */
+static void
+add_jobs (GstIqa * self, GArray * jobs, GstVideoFrame * ref,
+    GstVideoFrame * cmp, const GstVideoRectangle * rect, guint pair)
+{
+  GstIqaJob job = { 0, };
+  guint n_stripes;
+  gint height, stripe_rows, y;
+
+  job.ref = ref;
+  job.cmp = cmp;
+  job.rect = *rect;
+  job.subsampling = self->subsampling;
+  job.pair = pair;
+
+  height = get_n_samples (rect->h, self->subsampling);
+
 #ifdef HAVE_DSSIM
   if (self->do_dssim) {
-    if (!do_dssim (self, ref, cmp, outbuf, msg_structure, padname))
-      return FALSE;
+    job.type = GST_IQA_JOB_DSSIM;
+    job.first_row = 0;
+    job.n_rows = height;
+    g_array_append_val (jobs, job);
+  }
+#endif
+
+  if (!self->do_psnr && !self->do_fast_ssim)
+    return;
+
+  job.type = GST_IQA_JOB_STATS;
+  job.do_psnr = self->do_psnr;
+  job.do_fast_ssim = self->do_fast_ssim;
+
+  n_stripes = gst_stripe_threads_get_n_stripes (&self->threads, height,
+      SSIM_BLOCK_SIZE);
+  stripe_rows = GST_ROUND_UP_N ((height + n_stripes - 1) / n_stripes,
+      SSIM_BLOCK_SIZE);
+  for (y = 0; y < height; y += stripe_rows) {
+    job.first_row = y;
+    job.n_rows = MIN (stripe_rows, height - y);
+    g_array_append_val (jobs, job);
   }
+}
+
+static void
+set_result (GstStructure * msg_structure, const gchar * metric,
+    const gchar * padname, gdouble value)
+{
+  GstStructure *structure;
+
+  gst_structure_get (msg_structure, metric, GST_TYPE_STRUCTURE, &structure,
+      NULL);
+  gst_structure_set (structure, padname, G_TYPE_DOUBLE, value, NULL);
+  gst_structure_set (msg_structure, metric, GST_TYPE_STRUCTURE, structure,
+      NULL);
+  gst_structure_free (structure);
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Gathers the results of the jobs of each compared pad in the message */
+static void
+collect_results (GstIqa * self, GArray * jobs, GPtrArray * padnames,
+    GstBuffer * outbuf, GstStructure * msg_structure)
+{
+#ifdef HAVE_DSSIM
+  GstIqaJob *max_job = NULL;
+#endif
+  guint pair, i;
+
+  for (pair = 0; pair < padnames->len; pair++) {
+    const gchar *padname = g_ptr_array_index (padnames, pair);
+    guint64 sse = 0, n_samples = 0, n_blocks = 0;
+    gdouble ssim_sum = 0.0;
+
+    for (i = 0; i < jobs->len; i++) {
+      GstIqaJob *job = &g_array_index (jobs, GstIqaJob, i);
+
+      if (job->pair != pair)
+        continue;
+
+#ifdef HAVE_DSSIM
+      if (job->type == GST_IQA_JOB_DSSIM && job->dssim_valid) {
+        set_result (msg_structure, "dssim", padname, job->dssim);
+        if (job->dssim > self->max_dssim) {
+          self->max_dssim = job->dssim;
+          max_job = job;
+        }
+      }
 #endif
+      if (job->type == GST_IQA_JOB_STATS) {
+        sse += job->sse;
+        n_samples += job->n_samples;
+        ssim_sum += job->ssim_sum;
+        n_blocks += job->n_blocks;
+      }
+    }
+
+    if (self->do_psnr && n_samples > 0) {
+      gdouble psnr = INFINITY;
+
+      if (sse > 0)
+        psnr = 10.0 * log10 (255.0 * 255.0 * n_samples / sse);
+      set_result (msg_structure, "psnr", padname, psnr);
+    }
+
+    if (self->do_fast_ssim && n_blocks > 0)
+      set_result (msg_structure, "fast-ssim", padname, ssim_sum / n_blocks);
+  }
 
-  return TRUE;
+#ifdef HAVE_DSSIM
+  if (max_job) {
+    GstVideoFrame out_frame;
+
+    if (gst_video_frame_map (&out_frame, &GST_VIDEO_AGGREGATOR (self)->info,
+            outbuf, GST_MAP_WRITE)) {
+      draw_dssim_map (max_job, &out_frame);
+      gst_video_frame_unmap (&out_frame);
+    }
+  }
+
+  for (i = 0; i < jobs->len; i++) {
+    GstIqaJob *job = &g_array_index (jobs, GstIqaJob, i);
+
+    if (job->dssim_valid)
+      free (job->map.data);
+  }
+#endif
 }
 
 static GstFlowReturn
@@ -233,37 +581,72 @@ gst_iqa_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   GstStructure *msg_structure = gst_structure_new_empty ("IQA");
   GstMessage *m = gst_message_new_element (GST_OBJECT (self), msg_structure);
   GstAggregator *agg = GST_AGGREGATOR (vagg);
+  GArray *jobs;
+  GPtrArray *padnames;
+  GstVideoRectangle rect;
 
+  GST_OBJECT_LOCK (vagg);
   if (self->do_dssim) {
     gst_structure_set (msg_structure, "dssim", GST_TYPE_STRUCTURE,
         gst_structure_new_empty ("dssim"), NULL);
     self->max_dssim = 0.0;
   }
+  if (self->do_psnr) {
+    gst_structure_set (msg_structure, "psnr", GST_TYPE_STRUCTURE,
+        gst_structure_new_empty ("psnr"), NULL);
+  }
+  if (self->do_fast_ssim) {
+    gst_structure_set (msg_structure, "fast-ssim", GST_TYPE_STRUCTURE,
+        gst_structure_new_empty ("fast-ssim"), NULL);
+  }
+
+  jobs = g_array_new (FALSE, FALSE, sizeof (GstIqaJob));
+  padnames = g_ptr_array_new_with_free_func (g_free);
 
-  GST_OBJECT_LOCK (vagg);
   for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
     GstVideoAggregatorPad *pad = l->data;
 
     if (pad->aggregated_frame != NULL) {
       if (!ref_frame) {
         ref_frame = pad->aggregated_frame;
+        if (!gst_iqa_get_region (self, ref_frame->info.width,
+                ref_frame->info.height, &rect)) {
+          GST_DEBUG_OBJECT (self, "measured region is empty");
+          break;
+        }
       } else {
-        gboolean res;
-        gchar *padname = gst_pad_get_name (pad);
         GstVideoFrame *cmp_frame = pad->aggregated_frame;
 
-        res = compare_frames (self, ref_frame, cmp_frame, outbuf, msg_structure,
-            padname);
-        g_free (padname);
+        if (ref_frame->info.width != cmp_frame->info.width ||
+            ref_frame->info.height != cmp_frame->info.height) {
+          GST_OBJECT_UNLOCK (self);
 
-        if (!res)
+          GST_ELEMENT_ERROR (self, STREAM, FAILED,
+              ("Video streams do not have the same sizes (add videoscale"
+                  " and force the sizes to be equal on all sink pads.)"),
+              ("Reference width %d - compared width: %d. "
+                  "Reference height %d - compared height: %d",
+                  ref_frame->info.width, cmp_frame->info.width,
+                  ref_frame->info.height, cmp_frame->info.height));
+
+          GST_OBJECT_LOCK (self);
           goto failed;
+        }
+
+        add_jobs (self, jobs, ref_frame, cmp_frame, &rect, padnames->len);
+        g_ptr_array_add (padnames, gst_pad_get_name (pad));
       }
     }
   }
 
+  gst_iqa_run_jobs (self, jobs);
+  collect_results (self, jobs, padnames, outbuf, msg_structure);
+
   GST_OBJECT_UNLOCK (vagg);
 
+  g_array_free (jobs, TRUE);
+  g_ptr_array_free (padnames, TRUE);
+
   /* We only post the message here, because we can't post it while the object
    * is locked.
    */
@@ -275,6 +658,10 @@ gst_iqa_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
 failed:
   GST_OBJECT_UNLOCK (vagg);
 
+  g_array_free (jobs, TRUE);
+  g_ptr_array_free (padnames, TRUE);
+  gst_message_unref (m);
+
   return GST_FLOW_ERROR;
 }
 
@@ -284,14 +671,40 @@ _set_property (GObject * object, guint prop_id, const GValue * value,
 {
   GstIqa *self = GST_IQA (object);
 
+  GST_OBJECT_LOCK (self);
   switch (prop_id) {
     case PROP_DO_SSIM:
       self->do_dssim = g_value_get_boolean (value);
       break;
+    case PROP_DO_PSNR:
+      self->do_psnr = g_value_get_boolean (value);
+      break;
+    case PROP_DO_FAST_SSIM:
+      self->do_fast_ssim = g_value_get_boolean (value);
+      break;
+    case PROP_REGION_X:
+      self->region.x = g_value_get_int (value);
+      break;
+    case PROP_REGION_Y:
+      self->region.y = g_value_get_int (value);
+      break;
+    case PROP_REGION_WIDTH:
+      self->region.w = g_value_get_int (value);
+      break;
+    case PROP_REGION_HEIGHT:
+      self->region.h = g_value_get_int (value);
+      break;
+    case PROP_SUBSAMPLING:
+      self->subsampling = g_value_get_uint (value);
+      break;
+    case PROP_N_THREADS:
+      self->threads.n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
+  GST_OBJECT_UNLOCK (self);
 }
 
 static void
@@ -300,14 +713,50 @@ _get_property (GObject * object,
 {
   GstIqa *self = GST_IQA (object);
 
+  GST_OBJECT_LOCK (self);
   switch (prop_id) {
     case PROP_DO_SSIM:
       g_value_set_boolean (value, self->do_dssim);
       break;
+    case PROP_DO_PSNR:
+      g_value_set_boolean (value, self->do_psnr);
+      break;
+    case PROP_DO_FAST_SSIM:
+      g_value_set_boolean (value, self->do_fast_ssim);
+      break;
+    case PROP_REGION_X:
+      g_value_set_int (value, self->region.x);
+      break;
+    case PROP_REGION_Y:
+      g_value_set_int (value, self->region.y);
+      break;
+    case PROP_REGION_WIDTH:
+      g_value_set_int (value, self->region.w);
+      break;
+    case PROP_REGION_HEIGHT:
+      g_value_set_int (value, self->region.h);
+      break;
+    case PROP_SUBSAMPLING:
+      g_value_set_uint (value, self->subsampling);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, self->threads.n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_iqa_finalize (GObject * object)
+{
+  GstIqa *self = GST_IQA (object);
+
+  gst_stripe_threads_clear (&self->threads);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 /* GObject boilerplate */
@@ -328,6 +777,7 @@ gst_iqa_class_init (GstIqaClass * klass)
 
   gobject_class->set_property = _set_property;
   gobject_class->get_property = _get_property;
+  gobject_class->finalize = gst_iqa_finalize;
 
 #ifdef HAVE_DSSIM
   g_object_class_install_property (gobject_class, PROP_DO_SSIM,
@@ -335,6 +785,106 @@ gst_iqa_class_init (GstIqaClass * klass)
           "Run structural similarity checks", FALSE, G_PARAM_READWRITE));
 #endif
 
+  /**
+   * GstIqa:do-psnr:
+   *
+   * Measure the peak signal to noise ratio of the RGB components.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_DO_PSNR,
+      g_param_spec_boolean ("do-psnr", "do-psnr",
+          "Measure the peak signal to noise ratio", DEFAULT_DO_PSNR,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIqa:do-fast-ssim:
+   *
+   * Measure the mean structural similarity of the luma of 8x8 blocks.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_DO_FAST_SSIM,
+      g_param_spec_boolean ("do-fast-ssim", "do-fast-ssim",
+          "Measure a block based structural similarity on the luma",
+          DEFAULT_DO_FAST_SSIM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIqa:region-x:
+   *
+   * Horizontal offset of the measured region.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_REGION_X,
+      g_param_spec_int ("region-x", "Region X",
+          "Horizontal offset of the measured region", 0, G_MAXINT,
+          DEFAULT_REGION_X, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIqa:region-y:
+   *
+   * Vertical offset of the measured region.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_REGION_Y,
+      g_param_spec_int ("region-y", "Region Y",
+          "Vertical offset of the measured region", 0, G_MAXINT,
+          DEFAULT_REGION_Y, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIqa:region-width:
+   *
+   * Width of the measured region, 0 extends it to the right edge.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_REGION_WIDTH,
+      g_param_spec_int ("region-width", "Region width",
+          "Width of the measured region (0 = up to the right edge)", 0,
+          G_MAXINT, DEFAULT_REGION_WIDTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIqa:region-height:
+   *
+   * Height of the measured region, 0 extends it to the bottom edge.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_REGION_HEIGHT,
+      g_param_spec_int ("region-height", "Region height",
+          "Height of the measured region (0 = up to the bottom edge)", 0,
+          G_MAXINT, DEFAULT_REGION_HEIGHT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIqa:subsampling:
+   *
+   * Only measure one pixel out of this many, horizontally and vertically.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SUBSAMPLING,
+      g_param_spec_uint ("subsampling", "Subsampling",
+          "Measure one pixel out of this many in both directions", 1, 64,
+          DEFAULT_SUBSAMPLING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIqa:n-threads:
+   *
+   * Number of threads doing the measurements. 0 uses one thread per
+   * processor.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads used for measuring (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (gstelement_class, "Iqa",
       "Filter/Analyzer/Video",
       "Provides various Image Quality Assessment metrics",
@@ -344,6 +894,14 @@ gst_iqa_class_init (GstIqaClass * klass)
 static void
 gst_iqa_init (GstIqa * self)
 {
+  self->do_psnr = DEFAULT_DO_PSNR;
+  self->do_fast_ssim = DEFAULT_DO_FAST_SSIM;
+  self->region.x = DEFAULT_REGION_X;
+  self->region.y = DEFAULT_REGION_Y;
+  self->region.w = DEFAULT_REGION_WIDTH;
+  self->region.h = DEFAULT_REGION_HEIGHT;
+  self->subsampling = DEFAULT_SUBSAMPLING;
+  gst_stripe_threads_init (&self->threads, DEFAULT_N_THREADS);
 }
 
 static gboolean
@@ -23,6 +23,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideoaggregator.h>
+#include <gst/stripe-threads-private.h>
 
 G_BEGIN_DECLS
 
@@ -50,6 +51,14 @@ struct _GstIqa
 
   gboolean do_dssim;
   double max_dssim;
+
+  gboolean do_psnr;
+  gboolean do_fast_ssim;
+  GstVideoRectangle region;
+  guint subsampling;
+
+  /* runs the jobs of a frame, the n-threads property is threads.n_threads */
+  GstStripeThreads threads;
 };
 
 struct _GstIqaClass
@@ -28,11 +28,36 @@
 #include "gstladspa.h"
 #include "gstladspautils.h"
 
+#include <string.h>
+
 GST_DEBUG_CATEGORY_EXTERN (ladspa_debug);
 #define GST_CAT_DEFAULT ladspa_debug
 
 #define GST_LADSPA_FILTER_CLASS_TAGS "Filter/Effect/Audio/LADSPA"
 
+enum
+{
+  GST_LADSPA_FILTER_PROP_0,
+  GST_LADSPA_FILTER_PROP_N_THREADS,
+  GST_LADSPA_FILTER_PROP_STATS,
+  GST_LADSPA_FILTER_PROP_LAST
+};
+
+#define DEFAULT_N_THREADS 1
+
+/* channels [first, last) of one buffer, for one thread */
+typedef struct
+{
+  GstLADSPAFilter *ladspa;
+  guint8 *indata;
+  guint8 *outdata;
+  guint samples;
+  guint channels;
+  gboolean planar;
+  guint first, last;
+  guint64 *dsp_time;
+} GstLADSPAFilterJob;
+
 static GstLADSPAFilterClass *gst_ladspa_filter_type_parent_class = NULL;
 
 /*
@@ -82,29 +107,54 @@ static GstCaps *
 gst_ladspa_filter_type_transform_caps (GstBaseTransform * base,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter)
 {
-  GstCaps *srccaps, *sinkcaps;
+  GstLADSPAFilterClass *ladspa_class = GST_LADSPA_FILTER_GET_CLASS (base);
+  GstCaps *srccaps, *sinkcaps, *templ, *other;
   GstCaps *ret = NULL;
+  guint i;
 
   srccaps = gst_pad_get_pad_template_caps (GST_BASE_TRANSFORM_SRC_PAD (base));
   sinkcaps = gst_pad_get_pad_template_caps (GST_BASE_TRANSFORM_SINK_PAD (base));
 
   switch (direction) {
     case GST_PAD_SINK:
-      if (gst_caps_can_intersect (caps, sinkcaps))
-        ret = gst_caps_copy (srccaps);
-      else
-        ret = gst_caps_new_empty ();
+      templ = sinkcaps;
+      other = srccaps;
       break;
     case GST_PAD_SRC:
-      if (gst_caps_can_intersect (caps, srccaps))
-        ret = gst_caps_copy (sinkcaps);
-      else
-        ret = gst_caps_new_empty ();
+      templ = srccaps;
+      other = sinkcaps;
       break;
     default:
       g_assert_not_reached ();
   }
 
+  /* both sides have the same layout, and mono plugins the same channels */
+  if (gst_caps_is_any (caps)) {
+    ret = gst_caps_copy (other);
+  } else {
+    ret = gst_caps_new_empty ();
+    for (i = 0; i < gst_caps_get_size (caps); i++) {
+      GstStructure *s = gst_caps_get_structure (caps, i);
+      GstCaps *tmp = gst_caps_copy_nth (caps, i);
+      const GValue *v;
+
+      if (!gst_caps_can_intersect (tmp, templ)) {
+        gst_caps_unref (tmp);
+        continue;
+      }
+      gst_caps_unref (tmp);
+
+      tmp = gst_caps_copy (other);
+      if ((v = gst_structure_get_value (s, "layout")))
+        gst_caps_set_value (tmp, "layout", v);
+      if (gst_ladspa_is_mono (&ladspa_class->ladspa)
+          && (v = gst_structure_get_value (s, "channels")))
+        gst_caps_set_value (tmp, "channels", v);
+      ret = gst_caps_merge (ret, gst_caps_intersect (tmp, other));
+      gst_caps_unref (tmp);
+    }
+  }
+
   GST_DEBUG_OBJECT (base, "transformed %" GST_PTR_FORMAT, ret);
 
   if (filter) {
@@ -153,12 +203,55 @@ gst_ladspa_filter_type_prepare_output_buffer (GstBaseTransform * base,
   }
 }
 
+static void
+gst_ladspa_filter_type_free_extra (GstLADSPAFilter * ladspa)
+{
+  guint i;
+
+  for (i = 0; i < ladspa->n_extra; i++) {
+    gst_ladspa_cleanup (&ladspa->extra[i]);
+    gst_ladspa_finalize (&ladspa->extra[i]);
+  }
+  g_free (ladspa->extra);
+  ladspa->extra = NULL;
+  ladspa->n_extra = 0;
+}
+
 static gboolean
 gst_ladspa_filter_type_setup (GstAudioFilter * audio, const GstAudioInfo * info)
 {
   GstLADSPAFilter *ladspa = GST_LADSPA_FILTER (audio);
+  unsigned long rate = GST_AUDIO_INFO_RATE (info);
+  guint n_extra = 0;
+  guint i;
+
+  if (gst_ladspa_is_mono (ladspa->ladspa.klass))
+    n_extra = GST_AUDIO_INFO_CHANNELS (info) - 1;
+
+  if (n_extra != ladspa->n_extra) {
+    gst_ladspa_filter_type_free_extra (ladspa);
+    ladspa->extra = g_new0 (GstLADSPA, n_extra);
+    for (i = 0; i < n_extra; i++)
+      gst_ladspa_init (&ladspa->extra[i], ladspa->ladspa.klass);
+    ladspa->n_extra = n_extra;
+  }
+
+  GST_DEBUG_OBJECT (ladspa, "%u plugin instances", n_extra + 1);
+
+  for (i = 0; i < n_extra; i++) {
+    if (!gst_ladspa_setup (&ladspa->extra[i], rate))
+      return FALSE;
+  }
+
+  GST_OBJECT_LOCK (ladspa);
+  g_free (ladspa->dsp_time);
+  ladspa->dsp_time = g_new0 (guint64, n_extra + 1);
+  ladspa->n_instances = n_extra + 1;
+  ladspa->buffers = 0;
+  ladspa->samples = 0;
+  GST_OBJECT_UNLOCK (ladspa);
 
-  return gst_ladspa_setup (&ladspa->ladspa, GST_AUDIO_INFO_RATE (info));
+  return gst_ladspa_setup (&ladspa->ladspa, rate);
 }
 
 static gboolean
@@ -166,20 +259,223 @@ gst_ladspa_filter_type_cleanup (GstBaseTransform * base)
 {
   GstLADSPAFilter *ladspa = GST_LADSPA_FILTER (base);
 
+  gst_ladspa_filter_type_free_extra (ladspa);
+
   return gst_ladspa_cleanup (&ladspa->ladspa);
 }
 
+/*
+ * Runs the instances of channels [first, last), straight on the buffers
+ * for not-interleaved audio, through a copy of the channel otherwise.
+ */
+static void
+gst_ladspa_filter_type_run_channels (GstLADSPAFilterJob * job)
+{
+  GstLADSPAFilter *ladspa = job->ladspa;
+  guint samples = job->samples;
+  guint channels = job->channels;
+  LADSPA_Data *in = NULL, *out = NULL;
+  guint c, i;
+
+  if (!job->planar) {
+    in = g_new (LADSPA_Data, 2 * samples);
+    out = in + samples;
+  }
+
+  for (c = job->first; c < job->last; c++) {
+    GstLADSPA *instance = c == 0 ? &ladspa->ladspa : &ladspa->extra[c - 1];
+    GstClockTime start;
+
+    if (job->planar) {
+      start = gst_util_get_timestamp ();
+      gst_ladspa_transform_planar (instance,
+          job->outdata + c * samples * sizeof (LADSPA_Data), samples,
+          job->indata + c * samples * sizeof (LADSPA_Data));
+      job->dsp_time[c] = gst_util_get_timestamp () - start;
+    } else {
+      const LADSPA_Data *src = (const LADSPA_Data *) job->indata + c;
+      LADSPA_Data *dest = (LADSPA_Data *) job->outdata + c;
+
+      for (i = 0; i < samples; i++)
+        in[i] = src[i * channels];
+      start = gst_util_get_timestamp ();
+      gst_ladspa_transform_planar (instance, (guint8 *) out, samples,
+          (guint8 *) in);
+      job->dsp_time[c] = gst_util_get_timestamp () - start;
+      for (i = 0; i < samples; i++)
+        dest[i * channels] = out[i];
+    }
+  }
+
+  g_free (in);
+}
+
+static void
+gst_ladspa_filter_type_job_func (gpointer data, gpointer user_data)
+{
+  GstLADSPAFilter *ladspa = user_data;
+
+  gst_ladspa_filter_type_run_channels (data);
+
+  g_mutex_lock (&ladspa->lock);
+  if (--ladspa->pending == 0)
+    g_cond_signal (&ladspa->cond);
+  g_mutex_unlock (&ladspa->lock);
+}
+
+/*
+ * Runs the channel instances of a mono plugin, the calling thread handles
+ * the first share of the channels and waits for the others to be done.
+ */
+static void
+gst_ladspa_filter_type_run_instances (GstLADSPAFilter * ladspa,
+    guint8 * outdata, guint8 * indata, guint samples, gboolean planar,
+    guint64 * dsp_time)
+{
+  GstLADSPAClass *klass = ladspa->ladspa.klass;
+  guint n_instances = ladspa->n_extra + 1;
+  guint n_threads = ladspa->n_threads;
+  GstLADSPAFilterJob *jobs;
+  guint i, n_jobs;
+
+  /* the controls are only set on the first instance */
+  for (i = 0; i < ladspa->n_extra; i++)
+    memcpy (ladspa->extra[i].ports.control.in, ladspa->ladspa.ports.control.in,
+        klass->count.control.in * sizeof (LADSPA_Data));
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  n_jobs = MIN (n_threads, n_instances);
+
+  jobs = g_newa (GstLADSPAFilterJob, n_jobs);
+  for (i = 0; i < n_jobs; i++) {
+    jobs[i].ladspa = ladspa;
+    jobs[i].indata = indata;
+    jobs[i].outdata = outdata;
+    jobs[i].samples = samples;
+    jobs[i].channels = n_instances;
+    jobs[i].planar = planar;
+    jobs[i].first = n_instances * i / n_jobs;
+    jobs[i].last = n_instances * (i + 1) / n_jobs;
+    jobs[i].dsp_time = dsp_time;
+  }
+
+  if (n_jobs == 1) {
+    gst_ladspa_filter_type_run_channels (&jobs[0]);
+    return;
+  }
+
+  if (!ladspa->pool) {
+    GError *err = NULL;
+
+    ladspa->pool = g_thread_pool_new (gst_ladspa_filter_type_job_func, ladspa,
+        n_jobs - 1, TRUE, &err);
+    if (err) {
+      GST_WARNING_OBJECT (ladspa, "Could not start threads: %s",
+          err->message);
+      g_clear_error (&err);
+    }
+  } else if (g_thread_pool_get_max_threads (ladspa->pool) != n_jobs - 1) {
+    g_thread_pool_set_max_threads (ladspa->pool, n_jobs - 1, NULL);
+  }
+
+  ladspa->pending = n_jobs;
+  for (i = 1; i < n_jobs; i++) {
+    if (!ladspa->pool || !g_thread_pool_push (ladspa->pool, &jobs[i], NULL))
+      gst_ladspa_filter_type_job_func (&jobs[i], ladspa);
+  }
+  gst_ladspa_filter_type_job_func (&jobs[0], ladspa);
+
+  g_mutex_lock (&ladspa->lock);
+  while (ladspa->pending > 0)
+    g_cond_wait (&ladspa->cond, &ladspa->lock);
+  g_mutex_unlock (&ladspa->lock);
+}
+
+static void
+gst_ladspa_filter_type_process (GstLADSPAFilter * ladspa, guint8 * outdata,
+    guint8 * indata, gsize size)
+{
+  GstAudioInfo *info = &GST_AUDIO_FILTER (ladspa)->info;
+  GstLADSPAClass *klass = ladspa->ladspa.klass;
+  gboolean planar =
+      GST_AUDIO_INFO_LAYOUT (info) == GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+  guint n_instances = ladspa->n_extra + 1;
+  guint64 *dsp_time = g_newa (guint64, n_instances);
+  guint samples, i;
+
+  if (gst_ladspa_is_mono (klass)) {
+    samples = size / sizeof (LADSPA_Data) / n_instances;
+    /* a single channel is the same in both layouts */
+    gst_ladspa_filter_type_run_instances (ladspa, outdata, indata, samples,
+        planar || n_instances == 1, dsp_time);
+  } else {
+    GstClockTime start;
+
+    samples = size / sizeof (LADSPA_Data) / klass->count.audio.in;
+    start = gst_util_get_timestamp ();
+    if (planar)
+      gst_ladspa_transform_planar (&ladspa->ladspa, outdata, samples, indata);
+    else
+      gst_ladspa_transform (&ladspa->ladspa, outdata, samples, indata);
+    dsp_time[0] = gst_util_get_timestamp () - start;
+  }
+
+  GST_OBJECT_LOCK (ladspa);
+  if (ladspa->n_instances == n_instances) {
+    for (i = 0; i < n_instances; i++)
+      ladspa->dsp_time[i] += dsp_time[i];
+  }
+  ladspa->buffers++;
+  ladspa->samples += samples;
+  GST_OBJECT_UNLOCK (ladspa);
+}
+
+static GstStructure *
+gst_ladspa_filter_type_get_stats (GstLADSPAFilter * ladspa)
+{
+  GstStructure *s;
+  GValue times = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  GstClockTime duration = 0, total = 0;
+  gint rate = GST_AUDIO_INFO_RATE (&GST_AUDIO_FILTER (ladspa)->info);
+  guint64 buffers;
+  guint i;
+
+  g_value_init (&times, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+
+  GST_OBJECT_LOCK (ladspa);
+  for (i = 0; i < ladspa->n_instances; i++) {
+    total += ladspa->dsp_time[i];
+    g_value_set_uint64 (&v, ladspa->dsp_time[i]);
+    gst_value_array_append_value (&times, &v);
+  }
+  if (rate > 0)
+    duration = gst_util_uint64_scale (ladspa->samples, GST_SECOND, rate);
+  buffers = ladspa->buffers;
+  GST_OBJECT_UNLOCK (ladspa);
+
+  s = gst_structure_new ("application/x-ladspa-filter-stats",
+      "buffers", G_TYPE_UINT64, buffers,
+      "duration", G_TYPE_UINT64, duration,
+      "dsp-time", G_TYPE_UINT64, total,
+      "dsp-load", G_TYPE_DOUBLE, duration ? (gdouble) total / duration : 0.0,
+      NULL);
+  gst_structure_take_value (s, "instance-dsp-time", &times);
+  g_value_unset (&v);
+
+  return s;
+}
+
 static GstFlowReturn
 gst_ladspa_filter_type_transform_ip (GstBaseTransform * base, GstBuffer * buf)
 {
   GstLADSPAFilter *ladspa = GST_LADSPA_FILTER (base);
   GstMapInfo map;
-  guint samples;
 
   gst_buffer_map (buf, &map, GST_MAP_READWRITE);
-  samples =
-      map.size / sizeof (LADSPA_Data) / ladspa->ladspa.klass->count.audio.in;
-  gst_ladspa_transform (&ladspa->ladspa, map.data, samples, map.data);
+  gst_ladspa_filter_type_process (ladspa, map.data, map.data, map.size);
   gst_buffer_unmap (buf, &map);
 
   return GST_FLOW_OK;
@@ -191,15 +487,13 @@ gst_ladspa_filter_type_transform (GstBaseTransform * base,
 {
   GstLADSPAFilter *ladspa = GST_LADSPA_FILTER (base);
   GstMapInfo inmap, outmap;
-  guint samples;
 
   gst_object_sync_values (GST_OBJECT (ladspa), GST_BUFFER_TIMESTAMP (inbuf));
 
   gst_buffer_map (inbuf, &inmap, GST_MAP_READ);
   gst_buffer_map (outbuf, &outmap, GST_MAP_WRITE);
-  samples =
-      inmap.size / sizeof (LADSPA_Data) / ladspa->ladspa.klass->count.audio.in;
-  gst_ladspa_transform (&ladspa->ladspa, outmap.data, samples, inmap.data);
+  gst_ladspa_filter_type_process (ladspa, outmap.data, inmap.data,
+      inmap.size);
   gst_buffer_unmap (outbuf, &outmap);
   gst_buffer_unmap (inbuf, &inmap);
 
@@ -212,8 +506,15 @@ gst_ladspa_filter_type_set_property (GObject * object, guint prop_id,
 {
   GstLADSPAFilter *ladspa = GST_LADSPA_FILTER (object);
 
-  gst_ladspa_object_set_property (&ladspa->ladspa, object, prop_id, value,
-      pspec);
+  switch (prop_id) {
+    case GST_LADSPA_FILTER_PROP_N_THREADS:
+      ladspa->n_threads = g_value_get_uint (value);
+      break;
+    default:
+      gst_ladspa_object_set_property (&ladspa->ladspa, object, prop_id, value,
+          pspec);
+      break;
+  }
 }
 
 static void
@@ -222,8 +523,18 @@ gst_ladspa_filter_type_get_property (GObject * object, guint prop_id,
 {
   GstLADSPAFilter *ladspa = GST_LADSPA_FILTER (object);
 
-  gst_ladspa_object_get_property (&ladspa->ladspa, object, prop_id, value,
-      pspec);
+  switch (prop_id) {
+    case GST_LADSPA_FILTER_PROP_N_THREADS:
+      g_value_set_uint (value, ladspa->n_threads);
+      break;
+    case GST_LADSPA_FILTER_PROP_STATS:
+      g_value_take_boxed (value, gst_ladspa_filter_type_get_stats (ladspa));
+      break;
+    default:
+      gst_ladspa_object_get_property (&ladspa->ladspa, object, prop_id, value,
+          pspec);
+      break;
+  }
 }
 
 static void
@@ -234,6 +545,10 @@ gst_ladspa_filter_type_init (GstLADSPAFilter * ladspa, LADSPA_Descriptor * desc)
 
   gst_ladspa_init (&ladspa->ladspa, &ladspa_class->ladspa);
 
+  ladspa->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&ladspa->lock);
+  g_cond_init (&ladspa->cond);
+
   /* even if channels are different LADSPA still maintains same samples */
   gst_base_transform_set_in_place (base,
       ladspa_class->ladspa.count.audio.in ==
@@ -247,9 +562,15 @@ static void
 gst_ladspa_filter_type_dispose (GObject * object)
 {
   GstBaseTransform *base = GST_BASE_TRANSFORM (object);
+  GstLADSPAFilter *ladspa = GST_LADSPA_FILTER (object);
 
   gst_ladspa_filter_type_cleanup (base);
 
+  if (ladspa->pool) {
+    g_thread_pool_free (ladspa->pool, FALSE, TRUE);
+    ladspa->pool = NULL;
+  }
+
   G_OBJECT_CLASS (gst_ladspa_filter_type_parent_class)->dispose (object);
 }
 
@@ -260,6 +581,10 @@ gst_ladspa_filter_type_finalize (GObject * object)
 
   gst_ladspa_finalize (&ladspa->ladspa);
 
+  g_free (ladspa->dsp_time);
+  g_mutex_clear (&ladspa->lock);
+  g_cond_clear (&ladspa->cond);
+
   G_OBJECT_CLASS (gst_ladspa_filter_type_parent_class)->finalize (object);
 }
 
@@ -321,8 +646,20 @@ gst_ladspa_filter_type_class_init (GstLADSPAFilterClass * ladspa_class,
 
   audio_class->setup = GST_DEBUG_FUNCPTR (gst_ladspa_filter_type_setup);
 
+  g_object_class_install_property (object_class,
+      GST_LADSPA_FILTER_PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads running the per channel instances of mono "
+          "plugins (0 = number of processors)", 0, G_MAXUINT,
+          DEFAULT_N_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, GST_LADSPA_FILTER_PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Time spent in the plugin instances", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_ladspa_object_class_install_properties (&ladspa_class->ladspa,
-      object_class, 1);
+      object_class, GST_LADSPA_FILTER_PROP_LAST);
 }
 
 G_DEFINE_ABSTRACT_TYPE (GstLADSPAFilter, gst_ladspa_filter,
@@ -47,6 +47,24 @@ struct _GstLADSPAFilter
   GstAudioFilter parent;
 
   GstLADSPA ladspa;
+
+  /* mono plugins get one instance per channel, ladspa runs the first
+   * channel and extra the others */
+  GstLADSPA *extra;
+  guint n_extra;
+
+  guint n_threads;
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  gint pending;
+
+  /* DSP time of each instance in nanoseconds, protected by the object
+   * lock */
+  guint64 *dsp_time;
+  guint n_instances;
+  guint64 buffers;
+  guint64 samples;
 };
 
 struct _GstLADSPAFilterClass
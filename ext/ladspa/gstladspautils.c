@@ -40,10 +40,10 @@
  * but will e.g. create a 4 channel out for a plugin that has 2 stereo
  * 'pairs'.
  *
- * Also, gstreamer supports not-interleaved audio, where you just memcpy
- * each channel after each other: c1...c1c2....c2 and so on. This is not
- * taken into account, but could be added to the _transform and caps easily
- * if users demands it.
+ * Filters also accept not-interleaved audio, where each channel follows
+ * the other: c1...c1c2....c2 and so on. The ports are then connected to
+ * the channels of the buffers directly instead of going through the
+ * de-interleaving copies.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -165,6 +165,21 @@ gst_ladspa_transform (GstLADSPA * ladspa, guint8 * outdata, guint samples,
   return TRUE;
 }
 
+/*
+ * The data entry/exit point for not-interleaved audio, no copies.
+ */
+gboolean
+gst_ladspa_transform_planar (GstLADSPA * ladspa, guint8 * outdata,
+    guint samples, guint8 * indata)
+{
+  gst_ladspa_connect_audio_in (ladspa, samples, (LADSPA_Data *) indata);
+  gst_ladspa_connect_audio_out (ladspa, samples, (LADSPA_Data *) outdata);
+
+  gst_ladspa_run (ladspa, samples);
+
+  return TRUE;
+}
+
 static gboolean
 gst_ladspa_activate (GstLADSPA * ladspa)
 {
@@ -657,23 +672,50 @@ gst_ladspa_element_class_set_metadata (GstLADSPAClass * ladspa_class,
   g_free (longname);
 }
 
+/*
+ * Mono plugins process any number of channels, with one instance per
+ * channel.
+ */
+static GstCaps *
+gst_ladspa_filter_type_caps_new (GstLADSPAClass * ladspa_class,
+    guint channels)
+{
+  GstCaps *caps;
+  GValue layouts = G_VALUE_INIT, layout = G_VALUE_INIT;
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
+      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+
+  if (gst_ladspa_is_mono (ladspa_class))
+    gst_caps_set_simple (caps, "channels", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+        NULL);
+  else
+    gst_caps_set_simple (caps, "channels", G_TYPE_INT, channels, NULL);
+
+  g_value_init (&layouts, GST_TYPE_LIST);
+  g_value_init (&layout, G_TYPE_STRING);
+  g_value_set_static_string (&layout, "interleaved");
+  gst_value_list_append_value (&layouts, &layout);
+  g_value_set_static_string (&layout, "non-interleaved");
+  gst_value_list_append_value (&layouts, &layout);
+  gst_caps_set_value (caps, "layout", &layouts);
+  g_value_unset (&layout);
+  g_value_unset (&layouts);
+
+  return caps;
+}
+
 void
 gst_ladspa_filter_type_class_add_pad_templates (GstLADSPAClass *
     ladspa_class, GstAudioFilterClass * audio_class)
 {
   GstCaps *srccaps, *sinkcaps;
 
-  srccaps = gst_caps_new_simple ("audio/x-raw",
-      "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
-      "channels", G_TYPE_INT, ladspa_class->count.audio.out,
-      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-      "layout", G_TYPE_STRING, "interleaved", NULL);
-
-  sinkcaps = gst_caps_new_simple ("audio/x-raw",
-      "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
-      "channels", G_TYPE_INT, ladspa_class->count.audio.in,
-      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-      "layout", G_TYPE_STRING, "interleaved", NULL);
+  srccaps = gst_ladspa_filter_type_caps_new (ladspa_class,
+      ladspa_class->count.audio.out);
+  sinkcaps = gst_ladspa_filter_type_caps_new (ladspa_class,
+      ladspa_class->count.audio.in);
 
   gst_my_audio_filter_class_add_pad_templates (audio_class, srccaps, sinkcaps);
 
@@ -99,10 +99,19 @@ struct _GstLADSPAClass
   } map;
 };
 
+/* one audio input and one audio output port */
+#define gst_ladspa_is_mono(ladspa_class) \
+    ((ladspa_class)->count.audio.in == 1 && \
+    (ladspa_class)->count.audio.out == 1)
+
 gboolean
 gst_ladspa_transform (GstLADSPA * ladspa, guint8 * outdata, guint samples,
     guint8 * indata);
 
+gboolean
+gst_ladspa_transform_planar (GstLADSPA * ladspa, guint8 * outdata,
+    guint samples, guint8 * indata);
+
 gboolean
 gst_ladspa_setup (GstLADSPA * ladspa, unsigned long rate);
 
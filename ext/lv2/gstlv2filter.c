@@ -59,6 +59,24 @@ struct _GstLV2Filter
   GstAudioFilter parent;
 
   GstLV2 lv2;
+
+  /* mono plugins get one instance per channel, lv2 runs the first
+   * channel and extra the others */
+  GstLV2 *extra;
+  guint n_extra;
+
+  guint n_threads;
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  gint pending;
+
+  /* DSP time of each instance in nanoseconds, protected by the object
+   * lock */
+  guint64 *dsp_time;
+  guint n_instances;
+  guint64 buffers;
+  guint64 samples;
 };
 
 struct _GstLV2FilterClass
@@ -68,6 +86,34 @@ struct _GstLV2FilterClass
   GstLV2Class lv2;
 };
 
+enum
+{
+  GST_LV2_FILTER_PROP_0,
+  GST_LV2_FILTER_PROP_N_THREADS,
+  GST_LV2_FILTER_PROP_STATS,
+  GST_LV2_FILTER_PROP_LAST
+};
+
+#define DEFAULT_N_THREADS 1
+
+/* one audio input and one audio output port */
+#define gst_lv2_filter_is_mono(lv2_class) \
+    ((lv2_class)->in_group.ports->len == 1 && \
+    (lv2_class)->out_group.ports->len == 1)
+
+/* channels [first, last) of one buffer, for one thread */
+typedef struct
+{
+  GstLV2Filter *self;
+  gfloat *indata;
+  gfloat *outdata;
+  guint samples;
+  guint channels;
+  gboolean planar;
+  guint first, last;
+  guint64 *dsp_time;
+} GstLV2FilterJob;
+
 static GstAudioFilter *parent_class = NULL;
 
 /* preset interface */
@@ -141,6 +187,43 @@ gst_lv2_filter_preset_interface_init (gpointer g_iface, gpointer iface_data)
 }
 
 
+static GstStructure *
+gst_lv2_filter_get_stats (GstLV2Filter * self)
+{
+  GstStructure *s;
+  GValue times = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  GstClockTime duration = 0, total = 0;
+  gint rate = GST_AUDIO_INFO_RATE (&GST_AUDIO_FILTER (self)->info);
+  guint64 buffers;
+  guint i;
+
+  g_value_init (&times, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+
+  GST_OBJECT_LOCK (self);
+  for (i = 0; i < self->n_instances; i++) {
+    total += self->dsp_time[i];
+    g_value_set_uint64 (&v, self->dsp_time[i]);
+    gst_value_array_append_value (&times, &v);
+  }
+  if (rate > 0)
+    duration = gst_util_uint64_scale (self->samples, GST_SECOND, rate);
+  buffers = self->buffers;
+  GST_OBJECT_UNLOCK (self);
+
+  s = gst_structure_new ("application/x-lv2-filter-stats",
+      "buffers", G_TYPE_UINT64, buffers,
+      "duration", G_TYPE_UINT64, duration,
+      "dsp-time", G_TYPE_UINT64, total,
+      "dsp-load", G_TYPE_DOUBLE, duration ? (gdouble) total / duration : 0.0,
+      NULL);
+  gst_structure_take_value (s, "instance-dsp-time", &times);
+  g_value_unset (&v);
+
+  return s;
+}
+
 /* GObject vmethods implementation */
 static void
 gst_lv2_filter_set_property (GObject * object, guint prop_id,
@@ -148,7 +231,14 @@ gst_lv2_filter_set_property (GObject * object, guint prop_id,
 {
   GstLV2Filter *self = (GstLV2Filter *) object;
 
-  gst_lv2_object_set_property (&self->lv2, object, prop_id, value, pspec);
+  switch (prop_id) {
+    case GST_LV2_FILTER_PROP_N_THREADS:
+      self->n_threads = g_value_get_uint (value);
+      break;
+    default:
+      gst_lv2_object_set_property (&self->lv2, object, prop_id, value, pspec);
+      break;
+  }
 }
 
 static void
@@ -157,7 +247,30 @@ gst_lv2_filter_get_property (GObject * object, guint prop_id, GValue * value,
 {
   GstLV2Filter *self = (GstLV2Filter *) object;
 
-  gst_lv2_object_get_property (&self->lv2, object, prop_id, value, pspec);
+  switch (prop_id) {
+    case GST_LV2_FILTER_PROP_N_THREADS:
+      g_value_set_uint (value, self->n_threads);
+      break;
+    case GST_LV2_FILTER_PROP_STATS:
+      g_value_take_boxed (value, gst_lv2_filter_get_stats (self));
+      break;
+    default:
+      gst_lv2_object_get_property (&self->lv2, object, prop_id, value, pspec);
+      break;
+  }
+}
+
+static void
+gst_lv2_filter_dispose (GObject * object)
+{
+  GstLV2Filter *self = (GstLV2Filter *) object;
+
+  if (self->pool) {
+    g_thread_pool_free (self->pool, FALSE, TRUE);
+    self->pool = NULL;
+  }
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
 static void
@@ -167,6 +280,10 @@ gst_lv2_filter_finalize (GObject * object)
 
   gst_lv2_finalize (&self->lv2);
 
+  g_free (self->dsp_time);
+  g_mutex_clear (&self->lock);
+  g_cond_clear (&self->cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -244,6 +361,7 @@ gst_lv2_filter_type_class_add_pad_templates (GstLV2FilterClass * klass)
   GstCaps *srccaps, *sinkcaps;
   GstPadTemplate *pad_template;
   GstElementClass *elem_class = GST_ELEMENT_CLASS (klass);
+  GValue layouts = G_VALUE_INIT, layout = G_VALUE_INIT;
 
   gint in_channels = 1, out_channels = 1;
 
@@ -251,18 +369,34 @@ gst_lv2_filter_type_class_add_pad_templates (GstLV2FilterClass * klass)
 
   out_channels = klass->lv2.out_group.ports->len;
 
-  /* FIXME Implement deintereleaved audio support */
   sinkcaps = gst_caps_new_simple ("audio/x-raw",
       "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
       "channels", G_TYPE_INT, in_channels,
-      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-      "layout", G_TYPE_STRING, "interleaved", NULL);
+      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
 
   srccaps = gst_caps_new_simple ("audio/x-raw",
       "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
       "channels", G_TYPE_INT, out_channels,
-      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-      "layout", G_TYPE_STRING, "interleaved", NULL);
+      "rate", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+
+  /* mono plugins process any number of channels, one instance each */
+  if (gst_lv2_filter_is_mono (&klass->lv2)) {
+    gst_caps_set_simple (sinkcaps, "channels", GST_TYPE_INT_RANGE, 1,
+        G_MAXINT, NULL);
+    gst_caps_set_simple (srccaps, "channels", GST_TYPE_INT_RANGE, 1,
+        G_MAXINT, NULL);
+  }
+
+  g_value_init (&layouts, GST_TYPE_LIST);
+  g_value_init (&layout, G_TYPE_STRING);
+  g_value_set_static_string (&layout, "interleaved");
+  gst_value_list_append_value (&layouts, &layout);
+  g_value_set_static_string (&layout, "non-interleaved");
+  gst_value_list_append_value (&layouts, &layout);
+  gst_caps_set_value (sinkcaps, "layout", &layouts);
+  gst_caps_set_value (srccaps, "layout", &layouts);
+  g_value_unset (&layout);
+  g_value_unset (&layouts);
 
   pad_template =
       gst_pad_template_new (GST_BASE_TRANSFORM_SINK_NAME, GST_PAD_SINK,
@@ -278,19 +412,58 @@ gst_lv2_filter_type_class_add_pad_templates (GstLV2FilterClass * klass)
   gst_caps_unref (srccaps);
 }
 
+static void
+gst_lv2_filter_free_extra (GstLV2Filter * self)
+{
+  guint i;
+
+  for (i = 0; i < self->n_extra; i++) {
+    if (self->extra[i].activated)
+      gst_lv2_cleanup (&self->extra[i], (GstObject *) self);
+    gst_lv2_finalize (&self->extra[i]);
+  }
+  g_free (self->extra);
+  self->extra = NULL;
+  self->n_extra = 0;
+}
+
 static gboolean
 gst_lv2_filter_setup (GstAudioFilter * gsp, const GstAudioInfo * info)
 {
   GstLV2Filter *self = (GstLV2Filter *) gsp;
+  GstLV2FilterClass *klass =
+      (GstLV2FilterClass *) GST_AUDIO_FILTER_GET_CLASS (self);
+  guint n_extra = 0;
+  guint i;
 
   g_return_val_if_fail (self->lv2.activated == FALSE, FALSE);
 
-  GST_DEBUG_OBJECT (self, "instantiating the plugin at %d Hz",
+  if (gst_lv2_filter_is_mono (&klass->lv2))
+    n_extra = GST_AUDIO_INFO_CHANNELS (info) - 1;
+
+  GST_DEBUG_OBJECT (self, "instantiating %u plugins at %d Hz", n_extra + 1,
       GST_AUDIO_INFO_RATE (info));
 
   if (!gst_lv2_setup (&self->lv2, GST_AUDIO_INFO_RATE (info)))
     goto no_instance;
 
+  gst_lv2_filter_free_extra (self);
+  self->extra = g_new0 (GstLV2, n_extra);
+  self->n_extra = n_extra;
+  for (i = 0; i < n_extra; i++) {
+    gst_lv2_init (&self->extra[i], &klass->lv2);
+    if (!gst_lv2_setup (&self->extra[i], GST_AUDIO_INFO_RATE (info)))
+      goto no_instance;
+  }
+
+  GST_OBJECT_LOCK (self);
+  g_free (self->dsp_time);
+  self->dsp_time = g_new0 (guint64, n_extra + 1);
+  self->n_instances = n_extra + 1;
+  self->buffers = 0;
+  self->samples = 0;
+  GST_OBJECT_UNLOCK (self);
+
   /* FIXME Handle audio channel positionning while negotiating CAPS */
 #if 0
   gint i;
@@ -346,6 +519,8 @@ gst_lv2_filter_stop (GstBaseTransform * transform)
 {
   GstLV2Filter *lv2 = (GstLV2Filter *) transform;
 
+  gst_lv2_filter_free_extra (lv2);
+
   return gst_lv2_cleanup (&lv2->lv2, (GstObject *) lv2);
 }
 
@@ -372,53 +547,26 @@ gst_lv2_filter_interleave_data (guint n_channels, gfloat * outdata,
     }
 }
 
-static GstFlowReturn
-gst_lv2_filter_transform_data (GstLV2Filter * self,
-    GstMapInfo * in_map, GstMapInfo * out_map)
+/* Connects the ports of one instance to not interleaved data and runs it */
+static void
+gst_lv2_filter_run (GstLV2 * lv2, gfloat * in, gfloat * out, guint samples)
 {
-  GstLV2FilterClass *klass =
-      (GstLV2FilterClass *) GST_AUDIO_FILTER_GET_CLASS (self);
-  GstLV2Class *lv2_class = &klass->lv2;
-  GstLV2Group *lv2_group;
+  GstLV2Class *lv2_class = lv2->klass;
   GstLV2Port *lv2_port;
-  guint j, k, l, nframes, samples, out_samples;
-  gfloat *in = NULL, *out = NULL, *cv = NULL, *mem;
+  gfloat *cv, *mem;
   gfloat val;
+  guint j, k, l;
 
-  nframes = in_map->size / sizeof (float);
-
-  /* multi channel inputs */
-  lv2_group = &lv2_class->in_group;
-  samples = nframes / lv2_group->ports->len;
-  GST_LOG_OBJECT (self, "in : samples=%u, nframes=%u, ports=%d", samples,
-      nframes, lv2_group->ports->len);
-
-  if (lv2_group->ports->len > 1) {
-    in = g_new0 (gfloat, nframes);
-    out = g_new0 (gfloat, samples * lv2_group->ports->len);
-    gst_lv2_filter_deinterleave_data (lv2_group->ports->len, in,
-        samples, (gfloat *) in_map->data);
-  } else {
-    in = (gfloat *) in_map->data;
-    out = (gfloat *) out_map->data;
-  }
-
-  for (j = 0; j < lv2_group->ports->len; ++j) {
-    lv2_port = &g_array_index (lv2_group->ports, GstLV2Port, j);
-    lilv_instance_connect_port (self->lv2.instance, lv2_port->index,
+  for (j = 0; j < lv2_class->in_group.ports->len; ++j) {
+    lv2_port = &g_array_index (lv2_class->in_group.ports, GstLV2Port, j);
+    lilv_instance_connect_port (lv2->instance, lv2_port->index,
         in + (j * samples));
   }
 
-  /* multi channel outputs */
-  lv2_group = &lv2_class->out_group;
-  out_samples = nframes / lv2_group->ports->len;
-
-  GST_LOG_OBJECT (self, "out: samples=%u, nframes=%u, ports=%d", out_samples,
-      nframes, lv2_group->ports->len);
-  for (j = 0; j < lv2_group->ports->len; ++j) {
-    lv2_port = &g_array_index (lv2_group->ports, GstLV2Port, j);
-    lilv_instance_connect_port (self->lv2.instance, lv2_port->index,
-        out + (j * out_samples));
+  for (j = 0; j < lv2_class->out_group.ports->len; ++j) {
+    lv2_port = &g_array_index (lv2_class->out_group.ports, GstLV2Port, j);
+    lilv_instance_connect_port (lv2->instance, lv2_port->index,
+        out + (j * samples));
   }
 
   /* cv ports */
@@ -429,23 +577,199 @@ gst_lv2_filter_transform_data (GstLV2Filter * self,
       continue;
 
     mem = cv + (k * samples);
-    val = self->lv2.ports.control.in[j];
+    val = lv2->ports.control.in[j];
     /* FIXME: use gst_control_binding_get_value_array */
     for (l = 0; l < samples; l++)
       mem[l] = val;
-    lilv_instance_connect_port (self->lv2.instance, lv2_port->index, mem);
+    lilv_instance_connect_port (lv2->instance, lv2_port->index, mem);
     k++;
   }
 
-  lilv_instance_run (self->lv2.instance, samples);
+  lilv_instance_run (lv2->instance, samples);
 
-  if (lv2_group->ports->len > 1) {
-    gst_lv2_filter_interleave_data (lv2_group->ports->len,
-        (gfloat *) out_map->data, out_samples, out);
-    g_free (out);
-    g_free (in);
-  }
   g_free (cv);
+}
+
+static void
+gst_lv2_filter_run_channels (GstLV2FilterJob * job)
+{
+  GstLV2Filter *self = job->self;
+  guint samples = job->samples;
+  guint channels = job->channels;
+  gfloat *in = NULL, *out = NULL;
+  guint c, i;
+
+  if (!job->planar) {
+    in = g_new (gfloat, 2 * samples);
+    out = in + samples;
+  }
+
+  for (c = job->first; c < job->last; c++) {
+    GstLV2 *lv2 = c == 0 ? &self->lv2 : &self->extra[c - 1];
+    GstClockTime start;
+
+    if (job->planar) {
+      start = gst_util_get_timestamp ();
+      gst_lv2_filter_run (lv2, job->indata + c * samples,
+          job->outdata + c * samples, samples);
+      job->dsp_time[c] = gst_util_get_timestamp () - start;
+    } else {
+      const gfloat *src = job->indata + c;
+      gfloat *dest = job->outdata + c;
+
+      for (i = 0; i < samples; i++)
+        in[i] = src[i * channels];
+      start = gst_util_get_timestamp ();
+      gst_lv2_filter_run (lv2, in, out, samples);
+      job->dsp_time[c] = gst_util_get_timestamp () - start;
+      for (i = 0; i < samples; i++)
+        dest[i * channels] = out[i];
+    }
+  }
+
+  g_free (in);
+}
+
+static void
+gst_lv2_filter_job_func (gpointer data, gpointer user_data)
+{
+  GstLV2Filter *self = user_data;
+
+  gst_lv2_filter_run_channels (data);
+
+  g_mutex_lock (&self->lock);
+  if (--self->pending == 0)
+    g_cond_signal (&self->cond);
+  g_mutex_unlock (&self->lock);
+}
+
+/*
+ * Runs the channel instances of a mono plugin, the calling thread handles
+ * the first share of the channels and waits for the others to be done.
+ */
+static void
+gst_lv2_filter_run_instances (GstLV2Filter * self, gfloat * outdata,
+    gfloat * indata, guint samples, gboolean planar, guint64 * dsp_time)
+{
+  GstLV2Class *lv2_class = self->lv2.klass;
+  guint n_instances = self->n_extra + 1;
+  guint n_threads = self->n_threads;
+  GstLV2FilterJob *jobs;
+  guint i, n_jobs;
+
+  /* the controls are only set on the first instance */
+  for (i = 0; i < self->n_extra; i++)
+    memcpy (self->extra[i].ports.control.in, self->lv2.ports.control.in,
+        lv2_class->control_in_ports->len * sizeof (gfloat));
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+  n_jobs = MIN (n_threads, n_instances);
+
+  jobs = g_newa (GstLV2FilterJob, n_jobs);
+  for (i = 0; i < n_jobs; i++) {
+    jobs[i].self = self;
+    jobs[i].indata = indata;
+    jobs[i].outdata = outdata;
+    jobs[i].samples = samples;
+    jobs[i].channels = n_instances;
+    jobs[i].planar = planar;
+    jobs[i].first = n_instances * i / n_jobs;
+    jobs[i].last = n_instances * (i + 1) / n_jobs;
+    jobs[i].dsp_time = dsp_time;
+  }
+
+  if (n_jobs == 1) {
+    gst_lv2_filter_run_channels (&jobs[0]);
+    return;
+  }
+
+  if (!self->pool) {
+    GError *err = NULL;
+
+    self->pool = g_thread_pool_new (gst_lv2_filter_job_func, self,
+        n_jobs - 1, TRUE, &err);
+    if (err) {
+      GST_WARNING_OBJECT (self, "Could not start threads: %s", err->message);
+      g_clear_error (&err);
+    }
+  } else if (g_thread_pool_get_max_threads (self->pool) != n_jobs - 1) {
+    g_thread_pool_set_max_threads (self->pool, n_jobs - 1, NULL);
+  }
+
+  self->pending = n_jobs;
+  for (i = 1; i < n_jobs; i++) {
+    if (!self->pool || !g_thread_pool_push (self->pool, &jobs[i], NULL))
+      gst_lv2_filter_job_func (&jobs[i], self);
+  }
+  gst_lv2_filter_job_func (&jobs[0], self);
+
+  g_mutex_lock (&self->lock);
+  while (self->pending > 0)
+    g_cond_wait (&self->cond, &self->lock);
+  g_mutex_unlock (&self->lock);
+}
+
+static GstFlowReturn
+gst_lv2_filter_transform_data (GstLV2Filter * self,
+    GstMapInfo * in_map, GstMapInfo * out_map)
+{
+  GstLV2FilterClass *klass =
+      (GstLV2FilterClass *) GST_AUDIO_FILTER_GET_CLASS (self);
+  GstLV2Class *lv2_class = &klass->lv2;
+  GstAudioInfo *info = &GST_AUDIO_FILTER (self)->info;
+  gboolean planar =
+      GST_AUDIO_INFO_LAYOUT (info) == GST_AUDIO_LAYOUT_NON_INTERLEAVED;
+  guint in_ports = lv2_class->in_group.ports->len;
+  guint out_ports = lv2_class->out_group.ports->len;
+  guint n_instances = self->n_extra + 1;
+  guint64 *dsp_time = g_newa (guint64, n_instances);
+  guint i, samples;
+
+  if (gst_lv2_filter_is_mono (lv2_class)) {
+    samples = in_map->size / sizeof (float) / n_instances;
+    /* a single channel is the same in both layouts */
+    gst_lv2_filter_run_instances (self, (gfloat *) out_map->data,
+        (gfloat *) in_map->data, samples, planar || n_instances == 1,
+        dsp_time);
+  } else {
+    gfloat *in, *out;
+    GstClockTime start;
+
+    samples = in_map->size / sizeof (float) / in_ports;
+    GST_LOG_OBJECT (self, "samples=%u, in ports=%u, out ports=%u", samples,
+        in_ports, out_ports);
+
+    if (planar) {
+      in = (gfloat *) in_map->data;
+      out = (gfloat *) out_map->data;
+    } else {
+      in = g_new0 (gfloat, samples * in_ports);
+      out = g_new0 (gfloat, samples * out_ports);
+      gst_lv2_filter_deinterleave_data (in_ports, in, samples,
+          (gfloat *) in_map->data);
+    }
+
+    start = gst_util_get_timestamp ();
+    gst_lv2_filter_run (&self->lv2, in, out, samples);
+    dsp_time[0] = gst_util_get_timestamp () - start;
+
+    if (!planar) {
+      gst_lv2_filter_interleave_data (out_ports, (gfloat *) out_map->data,
+          samples, out);
+      g_free (out);
+      g_free (in);
+    }
+  }
+
+  GST_OBJECT_LOCK (self);
+  if (self->n_instances == n_instances) {
+    for (i = 0; i < n_instances; i++)
+      self->dsp_time[i] += dsp_time[i];
+  }
+  self->buffers++;
+  self->samples += samples;
+  GST_OBJECT_UNLOCK (self);
 
   return GST_FLOW_OK;
 }
@@ -515,6 +839,7 @@ gst_lv2_filter_class_init (GstLV2FilterClass * klass)
 
   gobject_class->set_property = gst_lv2_filter_set_property;
   gobject_class->get_property = gst_lv2_filter_get_property;
+  gobject_class->dispose = gst_lv2_filter_dispose;
   gobject_class->finalize = gst_lv2_filter_finalize;
 
   audiofilter_class->setup = gst_lv2_filter_setup;
@@ -523,7 +848,20 @@ gst_lv2_filter_class_init (GstLV2FilterClass * klass)
   transform_class->transform = gst_lv2_filter_transform;
   transform_class->transform_ip = gst_lv2_filter_transform_ip;
 
-  gst_lv2_class_install_properties (&klass->lv2, gobject_class, 1);
+  g_object_class_install_property (gobject_class,
+      GST_LV2_FILTER_PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads running the per channel instances of mono "
+          "plugins (0 = number of processors)", 0, G_MAXUINT,
+          DEFAULT_N_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, GST_LV2_FILTER_PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Time spent in the plugin instances", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  gst_lv2_class_install_properties (&klass->lv2, gobject_class,
+      GST_LV2_FILTER_PROP_LAST);
 }
 
 static void
@@ -531,6 +869,10 @@ gst_lv2_filter_init (GstLV2Filter * self, GstLV2FilterClass * klass)
 {
   gst_lv2_init (&self->lv2, &klass->lv2);
 
+  self->n_threads = DEFAULT_N_THREADS;
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->cond);
+
   if (!lilv_plugin_has_feature (klass->lv2.plugin, in_place_broken_pred))
     gst_base_transform_set_in_place (GST_BASE_TRANSFORM (self), TRUE);
 }
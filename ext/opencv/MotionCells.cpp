@@ -63,11 +63,13 @@ MotionCells::MotionCells ()
   m_motioncellsidxcstr = NULL;
   m_saveInDatafile = false;
   mc_savefile = NULL;
-  m_pcurFrame = NULL;
-  m_pprevFrame = NULL;
+  m_pcurgreyImage = NULL;
+  m_pprevgreyImage = NULL;
+  m_pfullgreyImage = NULL;
   transparencyimg = NULL;
   m_pdifferenceImage = NULL;
   m_pbwImage = NULL;
+  m_hasPrevFrame = false;
   m_initdatafilefailed = new char[BUSMSGLEN];
   m_savedatafilefailed = new char[BUSMSGLEN];
   m_initerrorcode = 0;
@@ -76,12 +78,13 @@ MotionCells::MotionCells ()
   m_beta = 0.5;
   m_useAlpha = false;
   m_isVisible = false;
-  m_pCells = NULL;
   m_gridx = 0;
   m_gridy = 0;
   m_cellwidth = 0;
   m_cellheight = 0;
   m_sensitivity = 0;
+  m_decimation = 2;
+  gst_stripe_threads_init (&m_threads, 1);
   m_changed_datafile = false;
 
   memset (&m_header, 0, sizeof (MotionCellHeader));
@@ -104,16 +107,84 @@ MotionCells::~MotionCells ()
   delete[]m_savedatafilefailed;
   if (m_motioncellsidxcstr)
     delete[]m_motioncellsidxcstr;
-  if (m_pcurFrame)
-    cvReleaseImage (&m_pcurFrame);
-  if (m_pprevFrame)
-    cvReleaseImage (&m_pprevFrame);
+  if (m_pcurgreyImage)
+    cvReleaseImage (&m_pcurgreyImage);
+  if (m_pprevgreyImage)
+    cvReleaseImage (&m_pprevgreyImage);
+  if (m_pfullgreyImage)
+    cvReleaseImage (&m_pfullgreyImage);
   if (transparencyimg)
     cvReleaseImage (&transparencyimg);
   if (m_pdifferenceImage)
     cvReleaseImage (&m_pdifferenceImage);
   if (m_pbwImage)
     cvReleaseImage (&m_pbwImage);
+  gst_stripe_threads_clear (&m_threads);
+}
+
+//(Re)creates the analysis images when the frame or analysis size changed,
+//the previous frame has to be set again afterwards
+void
+MotionCells::allocateImages (CvSize p_frameSize, CvSize p_size)
+{
+  if (m_pcurgreyImage && m_pcurgreyImage->width == p_size.width
+      && m_pcurgreyImage->height == p_size.height) {
+    if (m_decimation == 1 || (m_pfullgreyImage
+            && m_pfullgreyImage->width == p_frameSize.width
+            && m_pfullgreyImage->height == p_frameSize.height))
+      return;
+  }
+
+  if (m_pcurgreyImage)
+    cvReleaseImage (&m_pcurgreyImage);
+  if (m_pprevgreyImage)
+    cvReleaseImage (&m_pprevgreyImage);
+  if (m_pfullgreyImage)
+    cvReleaseImage (&m_pfullgreyImage);
+  if (m_pdifferenceImage)
+    cvReleaseImage (&m_pdifferenceImage);
+  if (m_pbwImage)
+    cvReleaseImage (&m_pbwImage);
+
+  m_pcurgreyImage = cvCreateImage (p_size, IPL_DEPTH_8U, 1);
+  m_pprevgreyImage = cvCreateImage (p_size, IPL_DEPTH_8U, 1);
+  m_pdifferenceImage = cvCreateImage (p_size, IPL_DEPTH_8U, 1);
+  m_pbwImage = cvCreateImage (p_size, IPL_DEPTH_8U, 1);
+  if (m_decimation > 1)
+    m_pfullgreyImage = cvCreateImage (p_frameSize, IPL_DEPTH_8U, 1);
+  m_hasPrevFrame = false;
+}
+
+//Converts the frame to luma first so that only one channel is decimated
+void
+MotionCells::convertFrame (IplImage * p_frame, IplImage * p_grey)
+{
+  if (m_decimation == 1) {
+    cvCvtColor (p_frame, p_grey, CV_RGB2GRAY);
+  } else {
+    cvCvtColor (p_frame, m_pfullgreyImage, CV_RGB2GRAY);
+    cvResize (m_pfullgreyImage, p_grey, CV_INTER_AREA);
+  }
+}
+
+static CvSize
+getAnalysisSize (CvSize p_frameSize, int p_decimation)
+{
+  CvSize size;
+
+  size.width = MAX (p_frameSize.width / p_decimation, 1);
+  size.height = MAX (p_frameSize.height / p_decimation, 1);
+  return size;
+}
+
+void
+MotionCells::setPrevFrame (IplImage * p_prevframe)
+{
+  CvSize frameSize = cvGetSize (p_prevframe);
+
+  allocateImages (frameSize, getAnalysisSize (frameSize, m_decimation));
+  convertFrame (p_prevframe, m_pprevgreyImage);
+  m_hasPrevFrame = true;
 }
 
 int
@@ -124,7 +195,8 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
     int motionmaskcells_count, motioncellidx * motionmaskcellsidx,
     cellscolor motioncellscolor, int motioncells_count,
     motioncellidx * motioncellsidx, gint64 starttime, char *p_datafile,
-    bool p_changed_datafile, int p_thickness)
+    bool p_changed_datafile, int p_thickness, int p_decimation,
+    int p_n_threads)
 {
 
   int sumframecnt = 0;
@@ -150,26 +222,18 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
         return ret;
     }
 
-    frameSize = cvGetSize (p_frame);
-    frameSize.width /= 2;
-    frameSize.height /= 2;
+    m_decimation = MAX (p_decimation, 1);
+    m_threads.n_threads = MAX (p_n_threads, 0);
+    frameSize = getAnalysisSize (cvGetSize (p_frame), m_decimation);
     setMotionCells (frameSize.width, frameSize.height);
     m_sensitivity = 1 - p_sensitivity;
     m_isVisible = p_isVisible;
-    m_pcurFrame = cvCloneImage (p_frame);
-    IplImage *m_pcurgreyImage = cvCreateImage (frameSize, IPL_DEPTH_8U, 1);
-    IplImage *m_pprevgreyImage = cvCreateImage (frameSize, IPL_DEPTH_8U, 1);
-    IplImage *m_pgreyImage = cvCreateImage (frameSize, IPL_DEPTH_8U, 1);
-    IplImage *m_pcurDown =
-        cvCreateImage (frameSize, m_pcurFrame->depth, m_pcurFrame->nChannels);
-    IplImage *m_pprevDown = cvCreateImage (frameSize, m_pprevFrame->depth,
-        m_pprevFrame->nChannels);
-    m_pbwImage = cvCreateImage (frameSize, IPL_DEPTH_8U, 1);
-    cvPyrDown (m_pprevFrame, m_pprevDown);
-    cvCvtColor (m_pprevDown, m_pprevgreyImage, CV_RGB2GRAY);
-    cvPyrDown (m_pcurFrame, m_pcurDown);
-    cvCvtColor (m_pcurDown, m_pcurgreyImage, CV_RGB2GRAY);
-    m_pdifferenceImage = cvCloneImage (m_pcurgreyImage);
+    allocateImages (cvGetSize (p_frame), frameSize);
+    convertFrame (p_frame, m_pcurgreyImage);
+    if (!m_hasPrevFrame) {
+      cvCopy (m_pcurgreyImage, m_pprevgreyImage);
+      m_hasPrevFrame = true;
+    }
     //cvSmooth(m_pcurgreyImage, m_pcurgreyImage, CV_GAUSSIAN, 3, 0);//TODO camera noise reduce,something smoothing, and rethink runningavg weights
 
     //Minus the current gray frame from the 8U moving average.
@@ -191,14 +255,18 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
     if (getIsNonZero (m_pbwImage)) {    //detect Motion
       if (m_MotionCells.size () > 0)    //it contains previous motioncells what we used when frames dropped
         m_MotionCells.clear ();
-      if (transparencyimg)
-        cvReleaseImage (&transparencyimg);
       (motioncells_count > 0) ?
           calculateMotionPercentInMotionCells (motioncellsidx,
           motioncells_count)
           : calculateMotionPercentInMotionCells (motionmaskcellsidx, 0);
 
-      transparencyimg = cvCreateImage (cvGetSize (p_frame), p_frame->depth, 3);
+      if (transparencyimg && (transparencyimg->width != p_frame->width
+              || transparencyimg->height != p_frame->height
+              || transparencyimg->depth != p_frame->depth))
+        cvReleaseImage (&transparencyimg);
+      if (!transparencyimg)
+        transparencyimg =
+            cvCreateImage (cvGetSize (p_frame), p_frame->depth, 3);
       cvSetZero (transparencyimg);
       if (m_motioncellsidxcstr)
         delete[]m_motioncellsidxcstr;
@@ -208,10 +276,10 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
       tmpstr[0] = 0;
       for (unsigned int i = 0; i < m_MotionCells.size (); i++) {
         CvPoint pt1, pt2;
-        pt1.x = m_MotionCells.at (i).cell_pt1.x * 2;
-        pt1.y = m_MotionCells.at (i).cell_pt1.y * 2;
-        pt2.x = m_MotionCells.at (i).cell_pt2.x * 2;
-        pt2.y = m_MotionCells.at (i).cell_pt2.y * 2;
+        pt1.x = m_MotionCells.at (i).cell_pt1.x * m_decimation;
+        pt1.y = m_MotionCells.at (i).cell_pt1.y * m_decimation;
+        pt2.x = m_MotionCells.at (i).cell_pt2.x * m_decimation;
+        pt2.y = m_MotionCells.at (i).cell_pt2.y * m_decimation;
         if (m_useAlpha && m_isVisible) {
           cvRectangle (transparencyimg,
               pt1,
@@ -259,52 +327,27 @@ MotionCells::performDetectionMotionCells (IplImage * p_frame,
       m_motioncells_idx_count = 0;
       if (m_MotionCells.size () > 0)
         m_MotionCells.clear ();
-      if (transparencyimg)
-        cvReleaseImage (&transparencyimg);
     }
 
-    if (m_pprevFrame)
-      cvReleaseImage (&m_pprevFrame);
-    m_pprevFrame = cvCloneImage (m_pcurFrame);
+    //the current grey frame becomes the previous one
+    IplImage *tmp = m_pprevgreyImage;
+    m_pprevgreyImage = m_pcurgreyImage;
+    m_pcurgreyImage = tmp;
     m_framecnt = 0;
-    if (m_pcurFrame)
-      cvReleaseImage (&m_pcurFrame);
-    if (m_pdifferenceImage)
-      cvReleaseImage (&m_pdifferenceImage);
-    if (m_pcurgreyImage)
-      cvReleaseImage (&m_pcurgreyImage);
-    if (m_pprevgreyImage)
-      cvReleaseImage (&m_pprevgreyImage);
-    if (m_pgreyImage)
-      cvReleaseImage (&m_pgreyImage);
-    if (m_pbwImage)
-      cvReleaseImage (&m_pbwImage);
-    if (m_pprevDown)
-      cvReleaseImage (&m_pprevDown);
-    if (m_pcurDown)
-      cvReleaseImage (&m_pcurDown);
-    if (m_pCells) {
-      for (int i = 0; i < m_gridy; ++i) {
-        delete[]m_pCells[i];
-      }
-      delete[]m_pCells;
-    }
 
     if (p_framerate <= 5) {
       if (m_MotionCells.size () > 0)
         m_MotionCells.clear ();
-      if (transparencyimg)
-        cvReleaseImage (&transparencyimg);
     }
   } else {                      //we do frame drop
     m_motioncells_idx_count = 0;
     ret = -2;
     for (unsigned int i = 0; i < m_MotionCells.size (); i++) {
       CvPoint pt1, pt2;
-      pt1.x = m_MotionCells.at (i).cell_pt1.x * 2;
-      pt1.y = m_MotionCells.at (i).cell_pt1.y * 2;
-      pt2.x = m_MotionCells.at (i).cell_pt2.x * 2;
-      pt2.y = m_MotionCells.at (i).cell_pt2.y * 2;
+      pt1.x = m_MotionCells.at (i).cell_pt1.x * m_decimation;
+      pt1.y = m_MotionCells.at (i).cell_pt1.y * m_decimation;
+      pt2.x = m_MotionCells.at (i).cell_pt2.x * m_decimation;
+      pt2.y = m_MotionCells.at (i).cell_pt2.y * m_decimation;
       if (m_useAlpha && m_isVisible) {
         cvRectangle (transparencyimg,
             pt1,
@@ -430,13 +473,10 @@ MotionCells::saveMotionCells (gint64 timestamp_millisec)
   return 0;
 }
 
-double
-MotionCells::calculateMotionPercentInCell (int p_row, int p_col,
-    double *p_cellarea, double *p_motionarea)
+void
+MotionCells::calculateMotionPercentInCell (int p_row, int p_col)
 {
-  double cntpixelsnum = 0;
-  double cntmotionpixelnum = 0;
-
+  Cell & cell = getCell (p_row, p_col);
   int ybegin = floor ((double) p_row * m_cellheight);
   int yend = floor ((double) (p_row + 1) * m_cellheight);
   int xbegin = floor ((double) (p_col) * m_cellwidth);
@@ -444,80 +484,79 @@ MotionCells::calculateMotionPercentInCell (int p_row, int p_col,
   int cellw = xend - xbegin;
   int cellh = yend - ybegin;
   int cellarea = cellw * cellh;
-  *p_cellarea = cellarea;
-  int thresholdmotionpixelnum = floor ((double) cellarea * m_sensitivity);
-
-  for (int i = ybegin; i < yend; i++) {
-    for (int j = xbegin; j < xend; j++) {
-      cntpixelsnum++;
-      if ((((uchar *) (m_pbwImage->imageData + m_pbwImage->widthStep * i))[j]) >
-          0) {
-        cntmotionpixelnum++;
-        if (cntmotionpixelnum >= thresholdmotionpixelnum) {     //we dont needs calculate anymore
-          *p_motionarea = cntmotionpixelnum;
-          return (cntmotionpixelnum / cntpixelsnum);
-        }
-      }
-      int remainingpixelsnum = cellarea - cntpixelsnum;
-      if ((cntmotionpixelnum + remainingpixelsnum) < thresholdmotionpixelnum) { //moving pixels number will be less than threshold
-        *p_motionarea = 0;
-        return 0;
-      }
-    }
+  CvMat cellmat;
+
+  cell.CellArea = cellarea;
+  if (cellarea <= 0) {
+    cell.MotionArea = 0;
+    cell.MotionPercent = 0;
+    return;
   }
 
-  return (cntmotionpixelnum / cntpixelsnum);
+  cvGetSubRect (m_pbwImage, &cellmat, cvRect (xbegin, ybegin, cellw, cellh));
+  cell.MotionArea = cvCountNonZero (&cellmat);
+  cell.MotionPercent = cell.MotionArea / cell.CellArea;
+}
+
+void
+MotionCells::calculateCellsStripe (gpointer user_data, guint stripe,
+    gint first, gint last)
+{
+  CellsStripes *stripes = (CellsStripes *) user_data;
+  MotionCells *mc = stripes->mc;
+
+  for (int k = first; k < last; k++) {
+    int i, j;
+
+    if (stripes->cellsidx) {
+      i = stripes->cellsidx[k].lineidx;
+      j = stripes->cellsidx[k].columnidx;
+    } else {
+      i = k / mc->m_gridx;
+      j = k % mc->m_gridx;
+    }
+    mc->calculateMotionPercentInCell (i, j);
+    mc->getCell (i, j).hasMotion =
+        mc->getCell (i, j).MotionPercent > mc->m_sensitivity;
+  }
 }
 
 void
 MotionCells::calculateMotionPercentInMotionCells (motioncellidx *
     p_motioncellsidx, int p_motioncells_count)
 {
-  if (p_motioncells_count == 0) {
-    for (int i = 0; i < m_gridy; i++) {
-      for (int j = 0; j < m_gridx; j++) {
-        m_pCells[i][j].MotionPercent = calculateMotionPercentInCell (i, j,
-            &m_pCells[i][j].CellArea, &m_pCells[i][j].MotionArea);
-        m_pCells[i][j].hasMotion =
-            m_sensitivity < m_pCells[i][j].MotionPercent ? true : false;
-        if (m_pCells[i][j].hasMotion) {
-          MotionCellsIdx mci;
-          mci.lineidx = i;
-          mci.colidx = j;
-          mci.cell_pt1.x = floor ((double) j * m_cellwidth);
-          mci.cell_pt1.y = floor ((double) i * m_cellheight);
-          mci.cell_pt2.x = floor ((double) (j + 1) * m_cellwidth);
-          mci.cell_pt2.y = floor ((double) (i + 1) * m_cellheight);
-          int w = mci.cell_pt2.x - mci.cell_pt1.x;
-          int h = mci.cell_pt2.y - mci.cell_pt1.y;
-          mci.motioncell = cvRect (mci.cell_pt1.x, mci.cell_pt1.y, w, h);
-          m_MotionCells.push_back (mci);
-        }
-      }
+  motioncellidx *cellsidx = p_motioncells_count > 0 ? p_motioncellsidx : NULL;
+  int n_cells =
+      p_motioncells_count > 0 ? p_motioncells_count : m_gridx * m_gridy;
+  CellsStripes stripes = { this, cellsidx };
+
+  //cells are counted in blocks of at least a row of cells per thread
+  gst_stripe_threads_run (&m_threads, n_cells, m_gridx, calculateCellsStripe,
+      &stripes);
+
+  //collect the moving cells in order
+  for (int k = 0; k < n_cells; k++) {
+    int i, j;
+
+    if (cellsidx) {
+      i = cellsidx[k].lineidx;
+      j = cellsidx[k].columnidx;
+    } else {
+      i = k / m_gridx;
+      j = k % m_gridx;
     }
-  } else {
-    for (int k = 0; k < p_motioncells_count; ++k) {
-
-      int i = p_motioncellsidx[k].lineidx;
-      int j = p_motioncellsidx[k].columnidx;
-      m_pCells[i][j].MotionPercent =
-          calculateMotionPercentInCell (i, j,
-          &m_pCells[i][j].CellArea, &m_pCells[i][j].MotionArea);
-      m_pCells[i][j].hasMotion =
-          m_pCells[i][j].MotionPercent > m_sensitivity ? true : false;
-      if (m_pCells[i][j].hasMotion) {
-        MotionCellsIdx mci;
-        mci.lineidx = p_motioncellsidx[k].lineidx;
-        mci.colidx = p_motioncellsidx[k].columnidx;
-        mci.cell_pt1.x = floor ((double) j * m_cellwidth);
-        mci.cell_pt1.y = floor ((double) i * m_cellheight);
-        mci.cell_pt2.x = floor ((double) (j + 1) * m_cellwidth);
-        mci.cell_pt2.y = floor ((double) (i + 1) * m_cellheight);
-        int w = mci.cell_pt2.x - mci.cell_pt1.x;
-        int h = mci.cell_pt2.y - mci.cell_pt1.y;
-        mci.motioncell = cvRect (mci.cell_pt1.x, mci.cell_pt1.y, w, h);
-        m_MotionCells.push_back (mci);
-      }
+    if (getCell (i, j).hasMotion) {
+      MotionCellsIdx mci;
+      mci.lineidx = i;
+      mci.colidx = j;
+      mci.cell_pt1.x = floor ((double) j * m_cellwidth);
+      mci.cell_pt1.y = floor ((double) i * m_cellheight);
+      mci.cell_pt2.x = floor ((double) (j + 1) * m_cellwidth);
+      mci.cell_pt2.y = floor ((double) (i + 1) * m_cellheight);
+      int w = mci.cell_pt2.x - mci.cell_pt1.x;
+      int h = mci.cell_pt2.y - mci.cell_pt1.y;
+      mci.motioncell = cvRect (mci.cell_pt1.x, mci.cell_pt1.y, w, h);
+      m_MotionCells.push_back (mci);
     }
   }
 }
@@ -553,10 +592,15 @@ MotionCells::performMotionMask (motioncellidx * p_motionmaskcellsidx,
         (double) p_motionmaskcellsidx[k].columnidx * m_cellwidth + m_cellwidth;
     int endy =
         (double) p_motionmaskcellsidx[k].lineidx * m_cellheight + m_cellheight;
-    for (int i = beginy; i < endy; i++)
-      for (int j = beginx; j < endx; j++) {
-        ((uchar *) (m_pbwImage->imageData + m_pbwImage->widthStep * i))[j] = 0;
-      }
+    CvMat cellmat;
+
+    endx = MIN (endx, m_pbwImage->width);
+    endy = MIN (endy, m_pbwImage->height);
+    if (endx <= beginx || endy <= beginy)
+      continue;
+    cvGetSubRect (m_pbwImage, &cellmat,
+        cvRect (beginx, beginy, endx - beginx, endy - beginy));
+    cvSetZero (&cellmat);
   }
 }
 
@@ -55,6 +55,7 @@
 #include <fstream>
 #include <vector>
 #include <glib.h>
+#include <gst/stripe-threads-private.h>
 
 //MotionCells defines
 #define MC_HEADER 64
@@ -137,12 +138,10 @@ public:
       motionmaskcoordrect * motionmaskcoords, int motionmaskcells_count,
       motioncellidx * motionmaskcellsidx, cellscolor motioncellscolor,
       int motioncells_count, motioncellidx * motioncellsidx, gint64 starttime,
-      char *datafile, bool p_changed_datafile, int p_thickness);
+      char *datafile, bool p_changed_datafile, int p_thickness,
+      int p_decimation, int p_n_threads);
 
-  void setPrevFrame (IplImage * p_prevframe)
-  {
-    m_pprevFrame = cvCloneImage (p_prevframe);
-  }
+  void setPrevFrame (IplImage * p_prevframe);
   char *getMotionCellsIdx ()
   {
     return m_motioncellsidxcstr;
@@ -189,14 +188,24 @@ public:
 
 private:
 
-  double calculateMotionPercentInCell (int p_row, int p_col, double *p_cellarea,
-      double *p_motionarea);
+  //The cells to analyse, split in stripes over the threads
+  struct CellsStripes
+  {
+    MotionCells *mc;
+    motioncellidx *cellsidx;
+  };
+
+  static void calculateCellsStripe (gpointer user_data, guint stripe,
+      gint first, gint last);
+  void calculateMotionPercentInCell (int p_row, int p_col);
   void performMotionMaskCoords (motionmaskcoordrect * p_motionmaskcoords,
       int p_motionmaskcoords_count);
   void performMotionMask (motioncellidx * p_motionmaskcellsidx,
       int p_motionmaskcells_count);
   void calculateMotionPercentInMotionCells (motioncellidx *
       p_motionmaskcellsidx, int p_motionmaskcells_count = 0);
+  void allocateImages (CvSize p_frameSize, CvSize p_size);
+  void convertFrame (IplImage * p_frame, IplImage * p_grey);
   int saveMotionCells (gint64 timestamp_millisec);
   int initDataFile (char *p_datafile, gint64 starttime);
   void blendImages (IplImage * p_actFrame, IplImage * p_cellsFrame,
@@ -214,46 +223,45 @@ private:
 
   bool getIsNonZero (IplImage * img)
   {
-    int lin, col;
-
-    for (lin = 0; lin < img->height; lin++)
-      for (col = 0; col < img->width; col++) {
-        if ((((uchar *) (img->imageData + img->widthStep * lin))[col]) > 0)
-          return true;
-      }
-    return false;
+    return cvCountNonZero (img) > 0;
   }
 
   void setMotionCells (int p_frameWidth, int p_frameHeight)
   {
-    int i, j;
+    Cell cell;
 
     m_cellwidth = (double) p_frameWidth / (double) m_gridx;
     m_cellheight = (double) p_frameHeight / (double) m_gridy;
-    m_pCells = new Cell *[m_gridy];
-    for (i = 0; i < m_gridy; i++)
-      m_pCells[i] = new Cell[m_gridx];
 
     //init cells
-    for (i = 0; i < m_gridy; i++)
-      for (j = 0; j < m_gridx; j++) {
-        m_pCells[i][j].MotionArea = 0;
-        m_pCells[i][j].CellArea = 0;
-        m_pCells[i][j].MotionPercent = 0;
-        m_pCells[i][j].hasMotion = false;
-      }
+    cell.MotionArea = 0;
+    cell.CellArea = 0;
+    cell.MotionPercent = 0;
+    cell.hasMotion = false;
+    m_Cells.assign (m_gridx * m_gridy, cell);
+  }
+
+  Cell & getCell (int p_row, int p_col)
+  {
+    return m_Cells[p_row * m_gridx + p_col];
   }
 
-  IplImage *m_pcurFrame, *m_pprevFrame, *m_pdifferenceImage,
-      *m_pbwImage,*transparencyimg;
+  //grey images at the analysis size, the previous one is kept from the
+  //last analysed frame and swapped with the current one afterwards
+  IplImage *m_pcurgreyImage, *m_pprevgreyImage, *m_pdifferenceImage,
+      *m_pbwImage, *m_pfullgreyImage, *transparencyimg;
   bool m_isVisible, m_changed_datafile, m_useAlpha, m_saveInDatafile;
-  Cell **m_pCells;
+  bool m_hasPrevFrame;
+  vector < Cell > m_Cells;
   vector < MotionCellsIdx > m_MotionCells;
   vector < OverlayRegions > m_OverlayRegions;
   int m_gridx, m_gridy;
   double m_cellwidth, m_cellheight;
   double m_alpha, m_beta;
   double m_sensitivity;
+  int m_decimation;
+  //the n-threads property is m_threads.n_threads
+  GstStripeThreads m_threads;
   int m_framecnt, m_motioncells_idx_count, m_initerrorcode, m_saveerrorcode;
   char *m_motioncellsidxcstr, *m_initdatafilefailed, *m_savedatafilefailed;
   FILE *mc_savefile;
@@ -54,6 +54,10 @@
  * |[
  * gst-launch-1.0 autovideosrc ! videoconvert ! faceblur ! videoconvert ! autovideosink
  * ]|
+ * |[
+ * gst-launch-1.0 autovideosrc ! videoconvert ! faceblur asynchronous=true detection-scale=0.25 ! videoconvert ! autovideosink
+ * ]| Detect on a quarter size copy in the background, tracking the faces
+ * on the frames in between so that the video is not held up.
  * </refsect2>
  */
 
@@ -78,6 +82,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_face_blur_debug);
 #define DEFAULT_MIN_NEIGHBORS 3
 #define DEFAULT_MIN_SIZE_WIDTH 30
 #define DEFAULT_MIN_SIZE_HEIGHT 30
+#define DEFAULT_ASYNCHRONOUS FALSE
+#define DEFAULT_DETECTION_SCALE 0.5
+#define DEFAULT_DETECTION_INTERVAL 1
 
 using namespace cv;
 using namespace std;
@@ -89,7 +96,10 @@ enum
   PROP_MIN_NEIGHBORS,
   PROP_FLAGS,
   PROP_MIN_SIZE_WIDTH,
-  PROP_MIN_SIZE_HEIGHT
+  PROP_MIN_SIZE_HEIGHT,
+  PROP_ASYNCHRONOUS,
+  PROP_DETECTION_SCALE,
+  PROP_DETECTION_INTERVAL
 };
 
 /**
@@ -157,6 +167,8 @@ static GstFlowReturn gst_face_blur_transform_ip (GstOpencvVideoFilter *
 
 static CascadeClassifier *gst_face_blur_load_profile (GstFaceBlur *
     filter, gchar * profile);
+static void gst_face_blur_detect (const Mat & gray, gdouble scale,
+    vector < Rect > &faces, gpointer user_data);
 
 /* Clean up */
 static void
@@ -164,6 +176,9 @@ gst_face_blur_finalize (GObject * obj)
 {
   GstFaceBlur *filter = GST_FACE_BLUR (obj);
 
+  /* stops the detection thread before the cascade goes away */
+  gst_face_tracker_free (filter->tracker);
+
   if (filter->cvGray)
     cvReleaseImage (&filter->cvGray);
 
@@ -221,6 +236,22 @@ gst_face_blur_class_init (GstFaceBlurClass * klass)
       g_param_spec_int ("min-size-height", "Minimum size height",
           "Minimum window height size", 0, G_MAXINT, DEFAULT_MIN_SIZE_HEIGHT,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_ASYNCHRONOUS,
+      g_param_spec_boolean ("asynchronous", "Asynchronous",
+          "Detect faces in a separate thread and blur the latest ones, "
+          "tracked from frame to frame, without waiting for the detection",
+          DEFAULT_ASYNCHRONOUS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_SCALE,
+      g_param_spec_double ("detection-scale", "Detection scale",
+          "Scale of the copy of the frame the asynchronous detection runs on",
+          0.05, 1.0, DEFAULT_DETECTION_SCALE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_INTERVAL,
+      g_param_spec_uint ("detection-interval", "Detection interval",
+          "Minimum number of frames between the starts of two asynchronous "
+          "detections", 1, G_MAXINT, DEFAULT_DETECTION_INTERVAL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
   gst_element_class_set_static_metadata (element_class,
       "faceblur",
@@ -248,6 +279,10 @@ gst_face_blur_init (GstFaceBlur * filter)
   filter->flags = DEFAULT_FLAGS;
   filter->min_size_width = DEFAULT_MIN_SIZE_WIDTH;
   filter->min_size_height = DEFAULT_MIN_SIZE_HEIGHT;
+  filter->asynchronous = DEFAULT_ASYNCHRONOUS;
+  filter->detection_scale = DEFAULT_DETECTION_SCALE;
+  filter->detection_interval = DEFAULT_DETECTION_INTERVAL;
+  filter->tracker = gst_face_tracker_new (gst_face_blur_detect, filter);
 
   gst_opencv_video_filter_set_in_place (GST_OPENCV_VIDEO_FILTER_CAST (filter),
       TRUE);
@@ -261,12 +296,15 @@ gst_face_blur_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_PROFILE:
+      /* the detection thread may be using the cascade */
+      GST_OBJECT_LOCK (filter);
       g_free (filter->profile);
       if (filter->cvCascade)
         delete filter->cvCascade;
       filter->profile = g_value_dup_string (value);
       filter->cvCascade = gst_face_blur_load_profile (filter, filter->profile);
       filter->sent_profile_load_failed_msg = FALSE;
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_SCALE_FACTOR:
       filter->scale_factor = g_value_get_double (value);
@@ -283,6 +321,15 @@ gst_face_blur_set_property (GObject * object, guint prop_id,
     case PROP_FLAGS:
       filter->flags = g_value_get_flags (value);
       break;
+    case PROP_ASYNCHRONOUS:
+      filter->asynchronous = g_value_get_boolean (value);
+      break;
+    case PROP_DETECTION_SCALE:
+      filter->detection_scale = g_value_get_double (value);
+      break;
+    case PROP_DETECTION_INTERVAL:
+      filter->detection_interval = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -314,6 +361,15 @@ gst_face_blur_get_property (GObject * object, guint prop_id,
     case PROP_FLAGS:
       g_value_set_flags (value, filter->flags);
       break;
+    case PROP_ASYNCHRONOUS:
+      g_value_set_boolean (value, filter->asynchronous);
+      break;
+    case PROP_DETECTION_SCALE:
+      g_value_set_double (value, filter->detection_scale);
+      break;
+    case PROP_DETECTION_INTERVAL:
+      g_value_set_uint (value, filter->detection_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -331,6 +387,7 @@ gst_face_blur_set_caps (GstOpencvVideoFilter * transform,
     cvReleaseImage (&filter->cvGray);
   filter->cvGray =
       cvCreateImage (cvSize (in_width, in_height), IPL_DEPTH_8U, 1);
+  gst_face_tracker_reset (filter->tracker);
 
   return TRUE;
 }
@@ -357,9 +414,15 @@ gst_face_blur_transform_ip (GstOpencvVideoFilter * transform,
   cvCvtColor (img, filter->cvGray, CV_RGB2GRAY);
 
   Mat image = cvarrToMat(filter->cvGray);
-  filter->cvCascade->detectMultiScale (image, faces, filter->scale_factor,
-      filter->min_neighbors, filter->flags,
-      cvSize (filter->min_size_width, filter->min_size_height), cvSize (0, 0));
+  if (filter->asynchronous) {
+    gst_face_tracker_process (filter->tracker, image,
+        filter->detection_scale, filter->detection_interval, faces);
+  } else {
+    filter->cvCascade->detectMultiScale (image, faces, filter->scale_factor,
+        filter->min_neighbors, filter->flags,
+        cvSize (filter->min_size_width, filter->min_size_height),
+        cvSize (0, 0));
+  }
 
   if (!faces.empty ()) {
 
@@ -375,6 +438,24 @@ gst_face_blur_transform_ip (GstOpencvVideoFilter * transform,
   return GST_FLOW_OK;
 }
 
+/* runs in the detection thread of the tracker */
+static void
+gst_face_blur_detect (const Mat & gray, gdouble scale, vector < Rect > &faces,
+    gpointer user_data)
+{
+  GstFaceBlur *filter = GST_FACE_BLUR (user_data);
+
+  GST_OBJECT_LOCK (filter);
+  if (filter->cvCascade) {
+    filter->cvCascade->detectMultiScale (gray, faces, filter->scale_factor,
+        filter->min_neighbors, filter->flags,
+        cvSize (MAX (cvRound (filter->min_size_width * scale), 1),
+            MAX (cvRound (filter->min_size_height * scale), 1)),
+        cvSize (0, 0));
+  }
+  GST_OBJECT_UNLOCK (filter);
+}
+
 static CascadeClassifier *
 gst_face_blur_load_profile (GstFaceBlur * filter, gchar * profile)
 {
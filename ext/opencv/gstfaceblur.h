@@ -53,6 +53,8 @@
 #include <gst/opencv/gstopencvvideofilter.h>
 #include <opencv2/objdetect/objdetect.hpp>
 
+#include "gstfacetracker.h"
+
 G_BEGIN_DECLS
 /* #defines don't like whitespacey bits */
 #define GST_TYPE_FACE_BLUR \
@@ -81,9 +83,13 @@ struct _GstFaceBlur
   gint flags;
   gint min_size_width;
   gint min_size_height;
+  gboolean asynchronous;
+  gdouble detection_scale;
+  guint detection_interval;
 
   IplImage *cvGray;
   cv::CascadeClassifier *cvCascade;
+  GstFaceTracker *tracker;
 };
 
 struct _GstFaceBlurClass
@@ -63,6 +63,11 @@
  * |[
  * gst-launch-1.0 autovideosrc ! video/x-raw,width=320,height=240 ! videoconvert ! facedetect min-size-width=60 min-size-height=60 ! colorspace ! xvimagesink
  * ]| Detect large faces on a smaller image
+ * |[
+ * gst-launch-1.0 autovideosrc ! videoconvert ! facedetect asynchronous=true detection-scale=0.25 detection-interval=5 ! videoconvert ! xvimagesink
+ * ]| Detect on a quarter size copy of one frame out of five in the
+ * background, tracking the faces on the other frames. The nose, mouth and
+ * eyes are not looked for in this mode.
  *
  * </refsect2>
  */
@@ -101,6 +106,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_face_detect_debug);
 #define DEFAULT_MIN_SIZE_WIDTH 30
 #define DEFAULT_MIN_SIZE_HEIGHT 30
 #define DEFAULT_MIN_STDDEV 0
+#define DEFAULT_ASYNCHRONOUS FALSE
+#define DEFAULT_DETECTION_SCALE 0.5
+#define DEFAULT_DETECTION_INTERVAL 1
 
 using namespace cv;
 /* Filter signals and args */
@@ -124,7 +132,10 @@ enum
   PROP_MIN_SIZE_WIDTH,
   PROP_MIN_SIZE_HEIGHT,
   PROP_UPDATES,
-  PROP_MIN_STDDEV
+  PROP_MIN_STDDEV,
+  PROP_ASYNCHRONOUS,
+  PROP_DETECTION_SCALE,
+  PROP_DETECTION_INTERVAL
 };
 
 
@@ -238,6 +249,8 @@ static GstFlowReturn gst_face_detect_transform_ip (GstOpencvVideoFilter * base,
 
 static CascadeClassifier *gst_face_detect_load_profile (GstFaceDetect *
     filter, gchar * profile);
+static void gst_face_detect_detect (const Mat & gray, gdouble scale,
+    vector < Rect > &faces, gpointer user_data);
 
 /* Clean up */
 static void
@@ -245,6 +258,9 @@ gst_face_detect_finalize (GObject * obj)
 {
   GstFaceDetect *filter = GST_FACE_DETECT (obj);
 
+  /* stops the detection thread before the cascades go away */
+  gst_face_tracker_free (filter->tracker);
+
   if (filter->cvGray)
     cvReleaseImage (&filter->cvGray);
 
@@ -346,6 +362,23 @@ gst_face_detect_class_init (GstFaceDetectClass * klass)
           "false positives not performing face detection on images with "
           "little changes", 0, 255, DEFAULT_MIN_STDDEV,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_ASYNCHRONOUS,
+      g_param_spec_boolean ("asynchronous", "Asynchronous",
+          "Detect faces in a separate thread and report the latest ones, "
+          "tracked from frame to frame, without waiting for the detection. "
+          "Face features are not detected in this mode",
+          DEFAULT_ASYNCHRONOUS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_SCALE,
+      g_param_spec_double ("detection-scale", "Detection scale",
+          "Scale of the copy of the frame the asynchronous detection runs on",
+          0.05, 1.0, DEFAULT_DETECTION_SCALE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DETECTION_INTERVAL,
+      g_param_spec_uint ("detection-interval", "Detection interval",
+          "Minimum number of frames between the starts of two asynchronous "
+          "detections", 1, G_MAXINT, DEFAULT_DETECTION_INTERVAL,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
   gst_element_class_set_static_metadata (element_class,
       "facedetect",
@@ -375,6 +408,9 @@ gst_face_detect_init (GstFaceDetect * filter)
   filter->min_size_width = DEFAULT_MIN_SIZE_WIDTH;
   filter->min_size_height = DEFAULT_MIN_SIZE_HEIGHT;
   filter->min_stddev = DEFAULT_MIN_STDDEV;
+  filter->asynchronous = DEFAULT_ASYNCHRONOUS;
+  filter->detection_scale = DEFAULT_DETECTION_SCALE;
+  filter->detection_interval = DEFAULT_DETECTION_INTERVAL;
   filter->cvFaceDetect =
       gst_face_detect_load_profile (filter, filter->face_profile);
   filter->cvNoseDetect =
@@ -387,6 +423,7 @@ gst_face_detect_init (GstFaceDetect * filter)
   gst_opencv_video_filter_set_in_place (GST_OPENCV_VIDEO_FILTER_CAST (filter),
       TRUE);
   filter->updates = GST_FACEDETECT_UPDATES_EVERY_FRAME;
+  filter->tracker = gst_face_tracker_new (gst_face_detect_detect, filter);
 }
 
 static void
@@ -397,12 +434,15 @@ gst_face_detect_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_FACE_PROFILE:
+      /* the detection thread may be using the cascade */
+      GST_OBJECT_LOCK (filter);
       g_free (filter->face_profile);
       if (filter->cvFaceDetect)
         delete (filter->cvFaceDetect);
       filter->face_profile = g_value_dup_string (value);
       filter->cvFaceDetect =
           gst_face_detect_load_profile (filter, filter->face_profile);
+      GST_OBJECT_UNLOCK (filter);
       break;
     case PROP_NOSE_PROFILE:
       g_free (filter->nose_profile);
@@ -452,6 +492,15 @@ gst_face_detect_set_property (GObject * object, guint prop_id,
     case PROP_UPDATES:
       filter->updates = g_value_get_enum (value);
       break;
+    case PROP_ASYNCHRONOUS:
+      filter->asynchronous = g_value_get_boolean (value);
+      break;
+    case PROP_DETECTION_SCALE:
+      filter->detection_scale = g_value_get_double (value);
+      break;
+    case PROP_DETECTION_INTERVAL:
+      filter->detection_interval = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -501,6 +550,15 @@ gst_face_detect_get_property (GObject * object, guint prop_id,
     case PROP_UPDATES:
       g_value_set_enum (value, filter->updates);
       break;
+    case PROP_ASYNCHRONOUS:
+      g_value_set_boolean (value, filter->asynchronous);
+      break;
+    case PROP_DETECTION_SCALE:
+      g_value_set_double (value, filter->detection_scale);
+      break;
+    case PROP_DETECTION_INTERVAL:
+      g_value_set_uint (value, filter->detection_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -524,6 +582,7 @@ gst_face_detect_set_caps (GstOpencvVideoFilter * transform, gint in_width,
 
   filter->cvGray = cvCreateImage (cvSize (in_width, in_height), IPL_DEPTH_8U,
       1);
+  gst_face_tracker_reset (filter->tracker);
 
   return TRUE;
 }
@@ -596,10 +655,16 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
 
     cvCvtColor (img, filter->cvGray, CV_RGB2GRAY);
 
-    gst_face_detect_run_detector (filter, filter->cvFaceDetect,
-        filter->min_size_width, filter->min_size_height,
-        Rect (filter->cvGray->origin, filter->cvGray->origin,
-            filter->cvGray->width, filter->cvGray->height), faces);
+    if (filter->asynchronous) {
+      gst_face_tracker_process (filter->tracker,
+          cv::cvarrToMat (filter->cvGray), filter->detection_scale,
+          filter->detection_interval, faces);
+    } else {
+      gst_face_detect_run_detector (filter, filter->cvFaceDetect,
+          filter->min_size_width, filter->min_size_height,
+          Rect (filter->cvGray->origin, filter->cvGray->origin,
+              filter->cvGray->width, filter->cvGray->height), faces);
+    }
 
     switch (filter->updates) {
       case GST_FACEDETECT_UPDATES_EVERY_FRAME:
@@ -647,9 +712,10 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
       guint rhh = r.height / 2;
       gboolean have_nose, have_mouth, have_eyes;
 
-      /* detect face features */
+      /* detect face features, which would not be in sync with the tracked
+       * faces in asynchronous mode */
 
-      if (filter->cvNoseDetect) {
+      if (filter->cvNoseDetect && !filter->asynchronous) {
         rnx = r.x + r.width / 4;
         rny = r.y + r.height / 4;
         rnw = r.width / 2;
@@ -661,7 +727,7 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
         have_nose = FALSE;
       }
 
-      if (filter->cvMouthDetect) {
+      if (filter->cvMouthDetect && !filter->asynchronous) {
         rmx = r.x;
         rmy = r.y + r.height / 2;
         rmw = r.width;
@@ -673,7 +739,7 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
         have_mouth = FALSE;
       }
 
-      if (filter->cvEyesDetect) {
+      if (filter->cvEyesDetect && !filter->asynchronous) {
         rex = r.x;
         rey = r.y;
         rew = r.width;
@@ -780,6 +846,36 @@ gst_face_detect_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
 }
 
 
+/* runs in the detection thread of the tracker */
+static void
+gst_face_detect_detect (const Mat & gray, gdouble scale,
+    vector < Rect > &faces, gpointer user_data)
+{
+  GstFaceDetect *filter = GST_FACE_DETECT (user_data);
+
+  if (filter->min_stddev > 0) {
+    Scalar mean, stddev;
+
+    meanStdDev (gray, mean, stddev);
+    if (stddev.val[0] < filter->min_stddev) {
+      GST_LOG_OBJECT (filter,
+          "Calculated stddev %f lesser than min_stddev %d, detection not "
+          "performed", stddev.val[0], filter->min_stddev);
+      return;
+    }
+  }
+
+  GST_OBJECT_LOCK (filter);
+  if (filter->cvFaceDetect) {
+    filter->cvFaceDetect->detectMultiScale (gray, faces,
+        filter->scale_factor, filter->min_neighbors, filter->flags,
+        cvSize (MAX (cvRound (filter->min_size_width * scale), 1),
+            MAX (cvRound (filter->min_size_height * scale), 1)),
+        cvSize (0, 0));
+  }
+  GST_OBJECT_UNLOCK (filter);
+}
+
 static CascadeClassifier *
 gst_face_detect_load_profile (GstFaceDetect * filter, gchar * profile)
 {
@@ -54,6 +54,8 @@
 #include <gst/opencv/gstopencvvideofilter.h>
 #include <opencv2/objdetect/objdetect.hpp>
 
+#include "gstfacetracker.h"
+
 G_BEGIN_DECLS
 /* #defines don't like whitespacey bits */
 #define GST_TYPE_FACE_DETECT \
@@ -103,12 +105,16 @@ struct _GstFaceDetect
   gint min_size_height;
   gint min_stddev;
   gint updates;
+  gboolean asynchronous;
+  gdouble detection_scale;
+  guint detection_interval;
 
   IplImage *cvGray;
   cv::CascadeClassifier *cvFaceDetect;
   cv::CascadeClassifier *cvNoseDetect;
   cv::CascadeClassifier *cvMouthDetect;
   cv::CascadeClassifier *cvEyesDetect;
+  GstFaceTracker *tracker;
 };
 
 struct _GstFaceDetectClass
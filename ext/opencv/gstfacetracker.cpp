@@ -0,0 +1,303 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Asynchronous face detection shared by facedetect and faceblur.
+ *
+ * Every interval frames, a downscaled gray copy of the frame is handed to a
+ * worker thread running the (slow) cascade, unless it is still busy with
+ * the previous one. The streaming thread never waits for it: each frame
+ * gets the latest faces, moved along with the picture by matching the
+ * area of each face in the previous downscaled frame around its position
+ * in the new one. When the worker delivers, its faces are first moved from
+ * the frame they were detected on to the current one the same way.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstfacetracker.h"
+#include <opencv2/imgproc/imgproc.hpp>
+
+GST_DEBUG_CATEGORY_STATIC (gst_face_tracker_debug);
+#define GST_CAT_DEFAULT gst_face_tracker_debug
+
+using namespace cv;
+using namespace std;
+
+/* below this correlation a face is considered lost by the tracking and
+ * stays in place until the next detection */
+#define MIN_MATCH_SCORE 0.5
+/* faces are looked for up to this fraction of their size away */
+#define SEARCH_MARGIN 0.5
+#define MIN_TRACK_SIZE 8
+
+struct _GstFaceTracker
+{
+  GstFaceTrackerDetectFunc func;
+  gpointer user_data;
+
+  GThread *thread;
+  GMutex lock;
+  GCond cond;
+  gboolean running;
+
+  /* frame waiting for the worker, and its results, all protected by lock.
+   * The generation changes on reset so that late results get dropped. */
+  gboolean busy;
+  gboolean pending;
+  Mat pending_gray;
+  gdouble pending_scale;
+  guint pending_generation;
+  gboolean have_results;
+  Mat results_gray;
+  vector < Rect > results;
+  guint results_generation;
+  guint generation;
+
+  /* streaming thread only */
+  gdouble scale;
+  Mat prev_gray;
+  vector < Rect > faces;
+  guint frames_since_detection;
+};
+
+static gpointer
+gst_face_tracker_thread (gpointer data)
+{
+  GstFaceTracker *tracker = (GstFaceTracker *) data;
+
+  g_mutex_lock (&tracker->lock);
+  while (tracker->running) {
+    Mat gray;
+    vector < Rect > faces;
+    gdouble scale;
+    guint generation;
+
+    if (!tracker->pending) {
+      g_cond_wait (&tracker->cond, &tracker->lock);
+      continue;
+    }
+
+    gray = tracker->pending_gray;
+    tracker->pending_gray.release ();
+    scale = tracker->pending_scale;
+    generation = tracker->pending_generation;
+    tracker->pending = FALSE;
+    g_mutex_unlock (&tracker->lock);
+
+    tracker->func (gray, scale, faces, tracker->user_data);
+
+    g_mutex_lock (&tracker->lock);
+    tracker->results_gray = gray;
+    tracker->results = faces;
+    tracker->results_generation = generation;
+    tracker->have_results = TRUE;
+    tracker->busy = FALSE;
+  }
+  g_mutex_unlock (&tracker->lock);
+
+  return NULL;
+}
+
+GstFaceTracker *
+gst_face_tracker_new (GstFaceTrackerDetectFunc func, gpointer user_data)
+{
+  GstFaceTracker *tracker = new GstFaceTracker ();
+
+  if (g_once_init_enter (&gst_face_tracker_debug)) {
+    GstDebugCategory *cat;
+
+    GST_DEBUG_CATEGORY_INIT (cat, "facetracker", 0,
+        "Asynchronous face detection");
+    g_once_init_leave (&gst_face_tracker_debug, cat);
+  }
+
+  tracker->func = func;
+  tracker->user_data = user_data;
+  tracker->thread = NULL;
+  g_mutex_init (&tracker->lock);
+  g_cond_init (&tracker->cond);
+  tracker->running = FALSE;
+  tracker->busy = FALSE;
+  tracker->pending = FALSE;
+  tracker->pending_generation = 0;
+  tracker->have_results = FALSE;
+  tracker->results_generation = 0;
+  tracker->generation = 0;
+  tracker->scale = 1.0;
+  tracker->frames_since_detection = G_MAXUINT;
+
+  return tracker;
+}
+
+void
+gst_face_tracker_free (GstFaceTracker * tracker)
+{
+  if (tracker->thread) {
+    g_mutex_lock (&tracker->lock);
+    tracker->running = FALSE;
+    g_cond_signal (&tracker->cond);
+    g_mutex_unlock (&tracker->lock);
+    g_thread_join (tracker->thread);
+  }
+  g_mutex_clear (&tracker->lock);
+  g_cond_clear (&tracker->cond);
+
+  delete tracker;
+}
+
+/* Forgets the faces, for example when the frame size changes */
+void
+gst_face_tracker_reset (GstFaceTracker * tracker)
+{
+  g_mutex_lock (&tracker->lock);
+  tracker->generation++;
+  tracker->pending = FALSE;
+  tracker->pending_gray.release ();
+  tracker->have_results = FALSE;
+  tracker->results_gray.release ();
+  tracker->results.clear ();
+  g_mutex_unlock (&tracker->lock);
+
+  tracker->prev_gray.release ();
+  tracker->faces.clear ();
+  tracker->frames_since_detection = G_MAXUINT;
+}
+
+/* Moves faces found in from to where they best match in to */
+static void
+gst_face_tracker_track (const Mat & from, const Mat & to,
+    vector < Rect > &faces)
+{
+  Rect bounds (0, 0, to.cols, to.rows);
+
+  if (from.size () != to.size ())
+    return;
+
+  for (size_t i = 0; i < faces.size (); i++) {
+    Rect r = faces[i] & bounds;
+    Rect search;
+    Mat score;
+    double max_score;
+    Point max_loc;
+    int mx, my;
+
+    if (r.width < MIN_TRACK_SIZE || r.height < MIN_TRACK_SIZE)
+      continue;
+
+    mx = (int) (r.width * SEARCH_MARGIN);
+    my = (int) (r.height * SEARCH_MARGIN);
+    search = Rect (r.x - mx, r.y - my, r.width + 2 * mx,
+        r.height + 2 * my) & bounds;
+
+    matchTemplate (to (search), from (r), score, TM_CCOEFF_NORMED);
+    minMaxLoc (score, NULL, &max_score, NULL, &max_loc);
+    if (max_score < MIN_MATCH_SCORE)
+      continue;
+
+    faces[i].x += search.x + max_loc.x - r.x;
+    faces[i].y += search.y + max_loc.y - r.y;
+  }
+}
+
+/* Returns in faces the latest faces for the frame gray, in its
+ * coordinates. The detection runs on a copy scaled by scale, on one frame
+ * out of interval at most. */
+void
+gst_face_tracker_process (GstFaceTracker * tracker, const Mat & gray,
+    gdouble scale, guint interval, vector < Rect > &faces)
+{
+  Mat small;
+  Rect bounds (0, 0, gray.cols, gray.rows);
+
+  /* faces found at another scale are in the wrong coordinates */
+  if (scale != tracker->scale) {
+    gst_face_tracker_reset (tracker);
+    tracker->scale = scale;
+  }
+
+  if (scale < 1.0)
+    resize (gray, small, Size (), scale, scale, INTER_AREA);
+  else
+    small = gray.clone ();
+
+  g_mutex_lock (&tracker->lock);
+  if (!tracker->thread) {
+    GError *err = NULL;
+
+    tracker->running = TRUE;
+    tracker->thread = g_thread_try_new ("facetracker",
+        gst_face_tracker_thread, tracker, &err);
+    if (!tracker->thread) {
+      GST_WARNING ("Could not start detection thread: %s", err->message);
+      g_clear_error (&err);
+      tracker->running = FALSE;
+    }
+  }
+
+  if (tracker->have_results &&
+      tracker->results_generation == tracker->generation) {
+    tracker->faces = tracker->results;
+    gst_face_tracker_track (tracker->results_gray, small, tracker->faces);
+    tracker->have_results = FALSE;
+    tracker->results_gray.release ();
+  } else if (!tracker->prev_gray.empty ()) {
+    gst_face_tracker_track (tracker->prev_gray, small, tracker->faces);
+  }
+
+  if (tracker->frames_since_detection < G_MAXUINT)
+    tracker->frames_since_detection++;
+  if (!tracker->busy && tracker->frames_since_detection >= MAX (interval, 1)) {
+    tracker->pending_gray = small;
+    tracker->pending_scale = scale;
+    tracker->pending_generation = tracker->generation;
+    tracker->frames_since_detection = 0;
+
+    if (tracker->running) {
+      tracker->pending = TRUE;
+      tracker->busy = TRUE;
+      g_cond_signal (&tracker->cond);
+    } else {
+      /* no thread, detect in place */
+      vector < Rect > detected;
+
+      g_mutex_unlock (&tracker->lock);
+      tracker->func (small, scale, detected, tracker->user_data);
+      g_mutex_lock (&tracker->lock);
+      tracker->pending_gray.release ();
+      tracker->faces = detected;
+    }
+  }
+  g_mutex_unlock (&tracker->lock);
+
+  tracker->prev_gray = small;
+
+  faces.clear ();
+  for (size_t i = 0; i < tracker->faces.size (); i++) {
+    const Rect & s = tracker->faces[i];
+    Rect r (cvRound (s.x / scale), cvRound (s.y / scale),
+        cvRound (s.width / scale), cvRound (s.height / scale));
+
+    r &= bounds;
+    if (r.area () > 0)
+      faces.push_back (r);
+  }
+}
@@ -0,0 +1,45 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_FACE_TRACKER_H__
+#define __GST_FACE_TRACKER_H__
+
+#include <gst/gst.h>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+G_BEGIN_DECLS
+
+typedef struct _GstFaceTracker GstFaceTracker;
+
+/* Detects the faces of gray, a copy of the frame scaled by scale. Called
+ * from the worker thread. */
+typedef void (*GstFaceTrackerDetectFunc) (const cv::Mat & gray, gdouble scale,
+    std::vector < cv::Rect > &faces, gpointer user_data);
+
+GstFaceTracker *gst_face_tracker_new (GstFaceTrackerDetectFunc func,
+    gpointer user_data);
+void gst_face_tracker_free (GstFaceTracker * tracker);
+void gst_face_tracker_reset (GstFaceTracker * tracker);
+void gst_face_tracker_process (GstFaceTracker * tracker, const cv::Mat & gray,
+    gdouble scale, guint interval, std::vector < cv::Rect > &faces);
+
+G_END_DECLS
+
+#endif /* __GST_FACE_TRACKER_H__ */
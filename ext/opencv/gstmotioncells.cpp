@@ -85,6 +85,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_motion_cells_debug);
 #define THICKNESS_MIN -1
 #define THICKNESS_DEF 1
 #define THICKNESS_MAX 5
+#define DECIMATION_MIN 1
+#define DECIMATION_DEF 2
+#define DECIMATION_MAX 8
+#define N_THREADS_DEF 1
 #define DATE_MIN 0
 #define DATE_DEF 1
 #define DATE_MAX LONG_MAX
@@ -126,7 +130,9 @@ enum
   PROP_CALCULATEMOTION,
   PROP_POSTALLMOTION,
   PROP_USEALPHA,
-  PROP_MOTIONCELLTHICKNESS
+  PROP_MOTIONCELLTHICKNESS,
+  PROP_DECIMATION,
+  PROP_N_THREADS
 };
 
 /* the capabilities of the inputs and outputs.
@@ -301,6 +307,16 @@ gst_motion_cells_class_init (GstMotioncellsClass * klass)
           "Motion Cell Border Thickness. Set to -1 to fill motion cell",
           THICKNESS_MIN, THICKNESS_MAX, THICKNESS_DEF,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DECIMATION,
+      g_param_spec_int ("decimation", "Decimation",
+          "Factor by which the luma plane is scaled down before motion "
+          "analysis", DECIMATION_MIN, DECIMATION_MAX, DECIMATION_DEF,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads computing the cells statistics "
+          "(0 = number of processors)", 0, G_MAXINT, N_THREADS_DEF,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
   gst_element_class_set_static_metadata (element_class,
       "motioncells",
@@ -376,6 +392,8 @@ gst_motion_cells_init (GstMotioncells * filter)
   filter->sent_init_error_msg = FALSE;
   filter->sent_save_error_msg = FALSE;
   filter->thickness = THICKNESS_DEF;
+  filter->decimation = DECIMATION_DEF;
+  filter->n_threads = N_THREADS_DEF;
 
   filter->datafileidx = 0;
   filter->id = motion_cells_init ();
@@ -612,6 +630,12 @@ gst_motion_cells_set_property (GObject * object, guint prop_id,
     case PROP_MOTIONCELLTHICKNESS:
       filter->thickness = g_value_get_int (value);
       break;
+    case PROP_DECIMATION:
+      filter->decimation = g_value_get_int (value);
+      break;
+    case PROP_N_THREADS:
+      filter->n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -735,6 +759,12 @@ gst_motion_cells_get_property (GObject * object, guint prop_id,
     case PROP_MOTIONCELLTHICKNESS:
       g_value_set_int (value, filter->thickness);
       break;
+    case PROP_DECIMATION:
+      g_value_set_int (value, filter->decimation);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -875,7 +905,7 @@ gst_motion_cells_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
     double sensitivity;
     int framerate, gridx, gridy, motionmaskcells_count, motionmaskcoord_count,
         motioncells_count, i;
-    int thickness, success, motioncellsidxcnt, numberOfCells,
+    int thickness, decimation, n_threads, success, motioncellsidxcnt, numberOfCells,
         motioncellsnumber, cellsOfInterestNumber;
     int mincellsOfInterestNumber, motiondetect;
     guint minimum_motion_frames, postnomotion;
@@ -898,19 +928,21 @@ gst_motion_cells_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
     framerate = filter->framerate;
     gridx = filter->gridx;
     gridy = filter->gridy;
+    decimation = filter->decimation;
+    n_threads = filter->n_threads;
     display = filter->display;
     motionmaskcoord_count = filter->motionmaskcoord_count;
     motionmaskcoords =
         g_new0 (motionmaskcoordrect, filter->motionmaskcoord_count);
-    for (i = 0; i < filter->motionmaskcoord_count; i++) {       //we need divide 2 because we use gauss pyramid in C++ side
+    for (i = 0; i < filter->motionmaskcoord_count; i++) {       //we need divide because we analyse a decimated frame in C++ side
       motionmaskcoords[i].upper_left_x =
-          filter->motionmaskcoords[i].upper_left_x / 2;
+          filter->motionmaskcoords[i].upper_left_x / decimation;
       motionmaskcoords[i].upper_left_y =
-          filter->motionmaskcoords[i].upper_left_y / 2;
+          filter->motionmaskcoords[i].upper_left_y / decimation;
       motionmaskcoords[i].lower_right_x =
-          filter->motionmaskcoords[i].lower_right_x / 2;
+          filter->motionmaskcoords[i].lower_right_x / decimation;
       motionmaskcoords[i].lower_right_y =
-          filter->motionmaskcoords[i].lower_right_y / 2;
+          filter->motionmaskcoords[i].lower_right_y / decimation;
     }
 
     motioncellscolor.R_channel_value =
@@ -972,7 +1004,8 @@ gst_motion_cells_transform_ip (GstOpencvVideoFilter * base, GstBuffer * buf,
         filter->diff_timestamp, display, useAlpha, motionmaskcoord_count,
         motionmaskcoords, motionmaskcells_count, motionmaskcellsidx,
         motioncellscolor, motioncells_count, motioncellsidx, starttime,
-        datafile, changed_datafile, thickness, filter->id);
+        datafile, changed_datafile, thickness, decimation, n_threads,
+        filter->id);
 
     if ((success == 1) && (filter->sent_init_error_msg == FALSE)) {
       char *initfailedreason;
@@ -88,7 +88,8 @@ perform_detection_motion_cells (IplImage * p_image, double p_sensitivity,
     motionmaskcoordrect * motionmaskcoords, int motionmaskcells_count,
     motioncellidx * motionmaskcellsidx, cellscolor motioncellscolor,
     int motioncells_count, motioncellidx * motioncellsidx, gint64 starttime,
-    char *p_datafile, bool p_changed_datafile, int p_thickness, int p_id)
+    char *p_datafile, bool p_changed_datafile, int p_thickness,
+    int p_decimation, int p_n_threads, int p_id)
 {
   int idx = 0;
   idx = searchIdx (p_id);
@@ -98,7 +99,7 @@ perform_detection_motion_cells (IplImage * p_image, double p_sensitivity,
         p_isVisible, p_useAlpha, motionmaskcoord_count, motionmaskcoords,
         motionmaskcells_count, motionmaskcellsidx, motioncellscolor,
         motioncells_count, motioncellsidx, starttime, p_datafile,
-        p_changed_datafile, p_thickness);
+        p_changed_datafile, p_thickness, p_decimation, p_n_threads);
   else
     return -1;
 }
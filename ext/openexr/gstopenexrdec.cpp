@@ -29,6 +29,7 @@
 
 #include <ImfRgbaFile.h>
 #include <ImfIO.h>
+#include <ImfThreading.h>
 using namespace Imf;
 using namespace Imath;
 
@@ -85,6 +86,35 @@ MemIStream::clear ()
 GST_DEBUG_CATEGORY_STATIC (gst_openexr_dec_debug);
 #define GST_CAT_DEFAULT gst_openexr_dec_debug
 
+#define DEFAULT_THREADS 0
+#define DEFAULT_FRAME_THREADS 1
+
+enum
+{
+  PROP_0,
+  PROP_THREADS,
+  PROP_FRAME_THREADS
+};
+
+typedef struct
+{
+  GstVideoCodecFrame *frame;
+  GstMapInfo map;
+  GstVideoFrame vframe;
+  MemIStream *istr;
+  RgbaInputFile *file;
+  gboolean done;
+  gboolean ok;
+} GstOpenEXRDecJob;
+
+/* Maps the bits of a half to the ARGB64 component value */
+static guint16 half_to_uint16[1 << 16];
+
+static void gst_openexr_dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_openexr_dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static void gst_openexr_dec_finalize (GObject * object);
 static gboolean gst_openexr_dec_start (GstVideoDecoder * decoder);
 static gboolean gst_openexr_dec_stop (GstVideoDecoder * decoder);
 static GstFlowReturn gst_openexr_dec_parse (GstVideoDecoder * decoder,
@@ -95,6 +125,8 @@ static GstFlowReturn gst_openexr_dec_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame);
 static gboolean gst_openexr_dec_decide_allocation (GstVideoDecoder * decoder,
     GstQuery * query);
+static GstFlowReturn gst_openexr_dec_finish (GstVideoDecoder * decoder);
+static gboolean gst_openexr_dec_flush (GstVideoDecoder * decoder);
 
 static GstStaticPadTemplate gst_openexr_dec_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
@@ -116,12 +148,32 @@ G_DEFINE_TYPE (GstOpenEXRDec, gst_openexr_dec, GST_TYPE_VIDEO_DECODER);
 static void
 gst_openexr_dec_class_init (GstOpenEXRDecClass * klass)
 {
+  GObjectClass *gobject_class;
   GstElementClass *element_class;
   GstVideoDecoderClass *video_decoder_class;
+  guint i;
 
+  gobject_class = (GObjectClass *) klass;
   element_class = (GstElementClass *) klass;
   video_decoder_class = (GstVideoDecoderClass *) klass;
 
+  gobject_class->set_property = gst_openexr_dec_set_property;
+  gobject_class->get_property = gst_openexr_dec_get_property;
+  gobject_class->finalize = gst_openexr_dec_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+          "Size of the OpenEXR thread pool decoding the lines/tiles of a "
+          "frame, shared by the whole process (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_THREADS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_FRAME_THREADS,
+      g_param_spec_uint ("frame-threads", "Frame threads",
+          "Number of frames decoded in parallel (0 = number of processors, "
+          "1 = decode on the streaming thread)",
+          0, G_MAXINT, DEFAULT_FRAME_THREADS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
   gst_element_class_add_static_pad_template (element_class, &gst_openexr_dec_src_template);
   gst_element_class_add_static_pad_template (element_class, &gst_openexr_dec_sink_template);
 
@@ -138,9 +190,24 @@ gst_openexr_dec_class_init (GstOpenEXRDecClass * klass)
   video_decoder_class->handle_frame =
       GST_DEBUG_FUNCPTR (gst_openexr_dec_handle_frame);
   video_decoder_class->decide_allocation = gst_openexr_dec_decide_allocation;
+  video_decoder_class->finish = GST_DEBUG_FUNCPTR (gst_openexr_dec_finish);
+  video_decoder_class->drain = GST_DEBUG_FUNCPTR (gst_openexr_dec_finish);
+  video_decoder_class->flush = GST_DEBUG_FUNCPTR (gst_openexr_dec_flush);
 
   GST_DEBUG_CATEGORY_INIT (gst_openexr_dec_debug, "openexrdec", 0,
       "OpenEXR Decoder");
+
+  for (i = 0; i < G_N_ELEMENTS (half_to_uint16); i++) {
+    half h;
+    float f;
+
+    h.setBits (i);
+    f = h;
+    if (h.isNan () || !(f > 0.0f))
+      half_to_uint16[i] = 0;
+    else
+      half_to_uint16[i] = MIN (f * 65536.0f, 65535.0f);
+  }
 }
 
 static void
@@ -152,15 +219,214 @@ gst_openexr_dec_init (GstOpenEXRDec * self)
   gst_video_decoder_set_use_default_pad_acceptcaps (GST_VIDEO_DECODER_CAST
       (self), TRUE);
   GST_PAD_SET_ACCEPT_TEMPLATE (GST_VIDEO_DECODER_SINK_PAD (self));
+
+  self->threads = DEFAULT_THREADS;
+  self->frame_threads = DEFAULT_FRAME_THREADS;
+
+  g_queue_init (&self->pending);
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->cond);
+}
+
+static void
+gst_openexr_dec_finalize (GObject * object)
+{
+  GstOpenEXRDec *self = GST_OPENEXR_DEC (object);
+
+  g_mutex_clear (&self->lock);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_openexr_dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstOpenEXRDec *self = GST_OPENEXR_DEC (object);
+
+  switch (prop_id) {
+    case PROP_THREADS:
+      self->threads = g_value_get_uint (value);
+      break;
+    case PROP_FRAME_THREADS:
+      self->frame_threads = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_openexr_dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstOpenEXRDec *self = GST_OPENEXR_DEC (object);
+
+  switch (prop_id) {
+    case PROP_THREADS:
+      g_value_set_uint (value, self->threads);
+      break;
+    case PROP_FRAME_THREADS:
+      g_value_set_uint (value, self->frame_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static gboolean
+gst_openexr_dec_decode (RgbaInputFile * file, GstVideoFrame * vframe)
+{
+  Box2i dw = file->dataWindow ();
+  int width = dw.max.x - dw.min.x + 1;
+  int height = dw.max.y - dw.min.y + 1;
+  guint8 *dest = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (vframe, 0);
+  gint dstride = GST_VIDEO_FRAME_PLANE_STRIDE (vframe, 0);
+  Rgba *fb, *tmp = NULL;
+  gsize fb_stride;
+  gint i, j;
+
+  /* An Rgba pixel has the size of an ARGB64 one, so the halfs are read
+   * straight into the output frame and converted in place */
+  if (dstride % sizeof (Rgba) == 0) {
+    fb = (Rgba *) dest;
+    fb_stride = dstride / sizeof (Rgba);
+  } else {
+    tmp = new Rgba[width * height];
+    fb = tmp;
+    fb_stride = width;
+  }
+
+  try {
+    file->setFrameBuffer (fb - dw.min.x - dw.min.y * fb_stride, 1, fb_stride);
+    file->readPixels (dw.min.y, dw.max.y);
+  } catch (Iex::BaseExc& e) {
+    delete[] tmp;
+    return FALSE;
+  }
+
+  /* TODO: Use displayWindow here and add a conversion filter element
+   * that can change exposure and other things */
+  for (i = 0; i < height; i++) {
+    const Rgba *src = fb + i * fb_stride;
+    guint16 *d = (guint16 *) (dest + i * dstride);
+
+    for (j = 0; j < width; j++) {
+      guint16 r = src[j].r.bits ();
+      guint16 g = src[j].g.bits ();
+      guint16 b = src[j].b.bits ();
+      guint16 a = src[j].a.bits ();
+
+      d[4 * j + 0] = half_to_uint16[a];
+      d[4 * j + 1] = half_to_uint16[r];
+      d[4 * j + 2] = half_to_uint16[g];
+      d[4 * j + 3] = half_to_uint16[b];
+    }
+  }
+
+  delete[] tmp;
+
+  return TRUE;
+}
+
+static void
+gst_openexr_dec_worker (gpointer data, gpointer user_data)
+{
+  GstOpenEXRDecJob *job = (GstOpenEXRDecJob *) data;
+  GstOpenEXRDec *self = GST_OPENEXR_DEC (user_data);
+  gboolean ok;
+
+  ok = gst_openexr_dec_decode (job->file, &job->vframe);
+
+  g_mutex_lock (&self->lock);
+  job->ok = ok;
+  job->done = TRUE;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->lock);
+}
+
+static GstFlowReturn
+gst_openexr_dec_finish_job (GstOpenEXRDec * self, GstOpenEXRDecJob * job,
+    gboolean discard)
+{
+  GstVideoCodecFrame *frame = job->frame;
+  gboolean ok = job->ok;
+
+  gst_video_frame_unmap (&job->vframe);
+  delete job->file;
+  delete job->istr;
+  gst_buffer_unmap (frame->input_buffer, &job->map);
+  g_slice_free (GstOpenEXRDecJob, job);
+
+  if (discard) {
+    gst_video_decoder_release_frame (GST_VIDEO_DECODER (self), frame);
+    return GST_FLOW_FLUSHING;
+  }
+
+  if (!ok) {
+    gst_video_decoder_release_frame (GST_VIDEO_DECODER (self), frame);
+    GST_ELEMENT_ERROR (self, CORE, FAILED, ("Failed to read pixels"), (NULL));
+    return GST_FLOW_ERROR;
+  }
+
+  return gst_video_decoder_finish_frame (GST_VIDEO_DECODER (self), frame);
+}
+
+/* Finishes decoded jobs in order, waiting for the oldest one while more
+ * than max_pending are queued */
+static GstFlowReturn
+gst_openexr_dec_finish_jobs (GstOpenEXRDec * self, guint max_pending,
+    gboolean discard)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstOpenEXRDecJob *job;
+
+  g_mutex_lock (&self->lock);
+  while ((job = (GstOpenEXRDecJob *) g_queue_peek_head (&self->pending))) {
+    GstFlowReturn job_ret;
+
+    if (!job->done) {
+      if (g_queue_get_length (&self->pending) <= max_pending)
+        break;
+      g_cond_wait (&self->cond, &self->lock);
+      continue;
+    }
+
+    g_queue_pop_head (&self->pending);
+    g_mutex_unlock (&self->lock);
+    job_ret = gst_openexr_dec_finish_job (self, job, discard);
+    if (ret == GST_FLOW_OK)
+      ret = job_ret;
+    g_mutex_lock (&self->lock);
+  }
+  g_mutex_unlock (&self->lock);
+
+  return discard ? GST_FLOW_OK : ret;
 }
 
 static gboolean
 gst_openexr_dec_start (GstVideoDecoder * decoder)
 {
   GstOpenEXRDec *self = GST_OPENEXR_DEC (decoder);
+  guint n_threads;
 
   GST_DEBUG_OBJECT (self, "Starting");
 
+  n_threads = self->threads ? self->threads : g_get_num_processors ();
+  GST_DEBUG_OBJECT (self, "Using %u OpenEXR threads", n_threads);
+  setGlobalThreadCount (n_threads);
+
+  n_threads =
+      self->frame_threads ? self->frame_threads : g_get_num_processors ();
+  if (n_threads > 1) {
+    GST_DEBUG_OBJECT (self, "Decoding %u frames in parallel", n_threads);
+    self->pool = g_thread_pool_new (gst_openexr_dec_worker, self, n_threads,
+        FALSE, NULL);
+  }
+
   return TRUE;
 }
 
@@ -171,6 +437,12 @@ gst_openexr_dec_stop (GstVideoDecoder * video_decoder)
 
   GST_DEBUG_OBJECT (self, "Stopping");
 
+  if (self->pool) {
+    gst_openexr_dec_finish_jobs (self, 0, TRUE);
+    g_thread_pool_free (self->pool, FALSE, TRUE);
+    self->pool = NULL;
+  }
+
   if (self->output_state) {
     gst_video_codec_state_unref (self->output_state);
     self->output_state = NULL;
@@ -314,6 +586,8 @@ gst_openexr_dec_handle_frame (GstVideoDecoder * decoder,
   gint64 deadline;
   GstMapInfo map;
   GstVideoFrame vframe;
+  GstOpenEXRDecJob *job;
+  gchar *stream_id;
 
   GST_DEBUG_OBJECT (self, "Handling frame");
 
@@ -336,19 +610,21 @@ gst_openexr_dec_handle_frame (GstVideoDecoder * decoder,
   /* Now read the file and catch any exceptions */
   MemIStream *istr;
   RgbaInputFile *file;
+  stream_id = gst_pad_get_stream_id (GST_VIDEO_DECODER_SINK_PAD (decoder));
   try {
     istr =
         new
-        MemIStream (gst_pad_get_stream_id (GST_VIDEO_DECODER_SINK_PAD
-            (decoder)), map.data, map.size);
+        MemIStream (stream_id ? stream_id : "", map.data, map.size);
   }
   catch (Iex::BaseExc& e) {
+    g_free (stream_id);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
         ("Failed to create input stream"), (NULL));
     return GST_FLOW_ERROR;
   }
+  g_free (stream_id);
   try {
     file = new RgbaInputFile (*istr);
   }
@@ -397,55 +673,48 @@ gst_openexr_dec_handle_frame (GstVideoDecoder * decoder,
     return GST_FLOW_ERROR;
   }
 
-  /* Decode the file */
-  Box2i dw = file->dataWindow ();
-  int width = dw.max.x - dw.min.x + 1;
-  int height = dw.max.y - dw.min.y + 1;
-  Rgba *fb = new Rgba[width * height];
+  job = g_slice_new0 (GstOpenEXRDecJob);
+  job->frame = frame;
+  job->map = map;
+  job->vframe = vframe;
+  job->istr = istr;
+  job->file = file;
 
-  try {
-    file->setFrameBuffer (fb - dw.min.x - dw.min.y * width, 1, width);
-    file->readPixels (dw.min.y, dw.max.y);
-  } catch (Iex::BaseExc& e) {
-    delete[](fb);
-    delete file;
-    delete istr;
-    gst_buffer_unmap (frame->input_buffer, &map);
-    gst_video_frame_unmap (&vframe);
-
-    GST_ELEMENT_ERROR (self, CORE, FAILED, ("Failed to read pixels"), (NULL));
-    return GST_FLOW_ERROR;
+  if (!self->pool) {
+    job->ok = gst_openexr_dec_decode (file, &job->vframe);
+    return gst_openexr_dec_finish_job (self, job, FALSE);
   }
 
-  /* And convert from ARGB64_F16 to ARGB64 */
-  gint i, j;
-  guint16 *dest = (guint16 *) GST_VIDEO_FRAME_PLANE_DATA (&vframe, 0);
-  guint dstride = GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 0);
-  Rgba *ptr = fb;
+  g_mutex_lock (&self->lock);
+  g_queue_push_tail (&self->pending, job);
+  g_mutex_unlock (&self->lock);
+  g_thread_pool_push (self->pool, job, NULL);
 
-  /* TODO: Use displayWindow here and also support output of ARGB_F16
-   * and add a conversion filter element that can change exposure and
-   * other things */
-  for (i = 0; i < height; i++) {
-    for (j = 0; j < width; j++) {
-      dest[4 * j + 0] = CLAMP (((float) ptr->a) * 65536, 0, 65535);
-      dest[4 * j + 1] = CLAMP (((float) ptr->r) * 65536, 0, 65535);
-      dest[4 * j + 2] = CLAMP (((float) ptr->g) * 65536, 0, 65535);
-      dest[4 * j + 3] = CLAMP (((float) ptr->b) * 65536, 0, 65535);
-      ptr++;
-    }
-    dest += dstride / 2;
-  }
+  /* Keep at most one frame per thread in flight */
+  return gst_openexr_dec_finish_jobs (self,
+      g_thread_pool_get_max_threads (self->pool), FALSE);
+}
+
+static GstFlowReturn
+gst_openexr_dec_finish (GstVideoDecoder * decoder)
+{
+  GstOpenEXRDec *self = GST_OPENEXR_DEC (decoder);
+
+  GST_DEBUG_OBJECT (self, "Finishing pending frames");
 
-  delete[](fb);
-  delete file;
-  delete istr;
-  gst_buffer_unmap (frame->input_buffer, &map);
-  gst_video_frame_unmap (&vframe);
+  return gst_openexr_dec_finish_jobs (self, 0, FALSE);
+}
 
-  ret = gst_video_decoder_finish_frame (decoder, frame);
+static gboolean
+gst_openexr_dec_flush (GstVideoDecoder * decoder)
+{
+  GstOpenEXRDec *self = GST_OPENEXR_DEC (decoder);
 
-  return ret;
+  GST_DEBUG_OBJECT (self, "Discarding pending frames");
+
+  gst_openexr_dec_finish_jobs (self, 0, TRUE);
+
+  return TRUE;
 }
 
 static gboolean
@@ -49,6 +49,15 @@ struct _GstOpenEXRDec
   /* < private > */
   GstVideoCodecState *input_state;
   GstVideoCodecState *output_state;
+
+  guint threads;
+  guint frame_threads;
+
+  /* Frame-parallel decoding, jobs are finished in submission order */
+  GThreadPool *pool;
+  GQueue pending;
+  GMutex lock;
+  GCond cond;
 };
 
 struct _GstOpenEXRDecClass
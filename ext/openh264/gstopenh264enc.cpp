@@ -33,6 +33,7 @@
 #include <gst/base/base.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideoencoder.h>
+#include <gst/codecparsers/gsth264meta.h>
 #include <string.h>
 
 GST_DEBUG_CATEGORY_STATIC (gst_openh264enc_debug_category);
@@ -183,6 +184,9 @@ static void gst_openh264enc_set_rate_control (GstOpenh264Enc * openh264enc,
 #define DEFAULT_COMPLEXITY      MEDIUM_COMPLEXITY
 #define DEFAULT_QP_MIN             0
 #define DEFAULT_QP_MAX             51
+#define DEFAULT_NUM_TEMPORAL_LAYERS 1
+#define DEFAULT_NUM_SPATIAL_LAYERS 1
+#define DEFAULT_SUBFRAME_OUTPUT    FALSE
 
 enum
 {
@@ -205,6 +209,9 @@ enum
   PROP_COMPLEXITY,
   PROP_QP_MIN,
   PROP_QP_MAX,
+  PROP_NUM_TEMPORAL_LAYERS,
+  PROP_NUM_SPATIAL_LAYERS,
+  PROP_SUBFRAME_OUTPUT,
   N_PROPERTIES
 };
 
@@ -222,7 +229,7 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS
-    ("video/x-h264, stream-format=(string)\"byte-stream\", alignment=(string)\"au\", profile=(string)\"baseline\"")
+    ("video/x-h264, stream-format=(string)\"byte-stream\", alignment=(string){ au, nal }, profile=(string)\"baseline\"")
     );
 
 /* class initialization */
@@ -365,6 +372,25 @@ gst_openh264enc_class_init (GstOpenh264EncClass * klass)
       g_param_spec_enum ("complexity", "Complexity / quality / speed tradeoff",
           "Complexity", GST_TYPE_OPENH264ENC_COMPLEXITY, DEFAULT_COMPLEXITY,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_NUM_TEMPORAL_LAYERS,
+      g_param_spec_uint ("num-temporal-layers", "Number of temporal layers",
+          "The number of temporal layers", 1, MAX_TEMPORAL_LAYER_NUM,
+          DEFAULT_NUM_TEMPORAL_LAYERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_NUM_SPATIAL_LAYERS,
+      g_param_spec_uint ("num-spatial-layers", "Number of spatial layers",
+          "The number of spatial layers, each one twice the size of the "
+          "previous one", 1, MAX_SPATIAL_LAYER_NUM,
+          DEFAULT_NUM_SPATIAL_LAYERS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+
+  g_object_class_install_property (gobject_class, PROP_SUBFRAME_OUTPUT,
+      g_param_spec_boolean ("subframe-output", "Sub-frame output",
+          "Output each NAL unit in its own buffer (alignment=nal)",
+          DEFAULT_SUBFRAME_OUTPUT,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -394,6 +420,9 @@ gst_openh264enc_init (GstOpenh264Enc * openh264enc)
   openh264enc->num_slices = DEFAULT_NUM_SLICES;
   openh264enc->encoder = NULL;
   openh264enc->complexity = DEFAULT_COMPLEXITY;
+  openh264enc->num_temporal_layers = DEFAULT_NUM_TEMPORAL_LAYERS;
+  openh264enc->num_spatial_layers = DEFAULT_NUM_SPATIAL_LAYERS;
+  openh264enc->subframe_output = DEFAULT_SUBFRAME_OUTPUT;
   openh264enc->bitrate_changed = FALSE;
   openh264enc->max_bitrate_changed = FALSE;
   gst_openh264enc_set_usage_type (openh264enc, CAMERA_VIDEO_REAL_TIME);
@@ -529,6 +558,18 @@ gst_openh264enc_set_property (GObject * object, guint property_id,
       openh264enc->complexity = (ECOMPLEXITY_MODE) g_value_get_enum (value);
       break;
 
+    case PROP_NUM_TEMPORAL_LAYERS:
+      openh264enc->num_temporal_layers = g_value_get_uint (value);
+      break;
+
+    case PROP_NUM_SPATIAL_LAYERS:
+      openh264enc->num_spatial_layers = g_value_get_uint (value);
+      break;
+
+    case PROP_SUBFRAME_OUTPUT:
+      openh264enc->subframe_output = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -616,6 +657,18 @@ gst_openh264enc_get_property (GObject * object, guint property_id,
       g_value_set_enum (value, openh264enc->complexity);
       break;
 
+    case PROP_NUM_TEMPORAL_LAYERS:
+      g_value_set_uint (value, openh264enc->num_temporal_layers);
+      break;
+
+    case PROP_NUM_SPATIAL_LAYERS:
+      g_value_set_uint (value, openh264enc->num_spatial_layers);
+      break;
+
+    case PROP_SUBFRAME_OUTPUT:
+      g_value_set_boolean (value, openh264enc->subframe_output);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -673,6 +726,31 @@ gst_openh264enc_stop (GstVideoEncoder * encoder)
 }
 
 
+/* Splits the target and maximum bitrates over the spatial layers,
+ * proportionally to their size */
+static void
+gst_openh264enc_set_layer_bitrates (SEncParamExt * enc_params)
+{
+  guint64 total_area = 0;
+  gint i;
+
+  for (i = 0; i < enc_params->iSpatialLayerNum; i++) {
+    SSpatialLayerConfig *layer = &enc_params->sSpatialLayers[i];
+
+    total_area += (guint64) layer->iVideoWidth * layer->iVideoHeight;
+  }
+
+  for (i = 0; i < enc_params->iSpatialLayerNum; i++) {
+    SSpatialLayerConfig *layer = &enc_params->sSpatialLayers[i];
+    guint64 area = (guint64) layer->iVideoWidth * layer->iVideoHeight;
+
+    layer->iSpatialBitrate = (int)
+        gst_util_uint64_scale (enc_params->iTargetBitrate, area, total_area);
+    layer->iMaxSpatialBitrate = (int)
+        gst_util_uint64_scale (enc_params->iMaxBitrate, area, total_area);
+  }
+}
+
 static gboolean
 gst_openh264enc_set_format (GstVideoEncoder * encoder,
     GstVideoCodecState * state)
@@ -683,7 +761,7 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   SEncParamExt enc_params;
   SliceModeEnum slice_mode = SM_SINGLE_SLICE;
   guint n_slices = 1;
-  gint ret;
+  gint i, ret;
   GstCaps *outcaps;
   GstVideoCodecState *output_state;
   openh264enc->frame_count = 0;
@@ -727,8 +805,8 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   enc_params.iMaxQp = openh264enc->qp_max;
   enc_params.iMinQp = openh264enc->qp_min;
   enc_params.iRCMode = openh264enc->rate_control;
-  enc_params.iTemporalLayerNum = 1;
-  enc_params.iSpatialLayerNum = 1;
+  enc_params.iTemporalLayerNum = openh264enc->num_temporal_layers;
+  enc_params.iSpatialLayerNum = openh264enc->num_spatial_layers;
   enc_params.iLtrMarkPeriod = 30;
   enc_params.iMultipleThreadIdc = openh264enc->multi_thread;
   enc_params.bEnableDenoise = openh264enc->enable_denoise;
@@ -747,12 +825,18 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   enc_params.bPrefixNalAddingCtrl = 0;
   enc_params.fMaxFrameRate = fps_n * 1.0 / fps_d;
   enc_params.iLoopFilterDisableIdc = openh264enc->deblocking_mode;
-  enc_params.sSpatialLayers[0].uiProfileIdc = PRO_BASELINE;
-  enc_params.sSpatialLayers[0].iVideoWidth = enc_params.iPicWidth;
-  enc_params.sSpatialLayers[0].iVideoHeight = enc_params.iPicHeight;
-  enc_params.sSpatialLayers[0].fFrameRate = fps_n * 1.0 / fps_d;
-  enc_params.sSpatialLayers[0].iSpatialBitrate = enc_params.iTargetBitrate;
-  enc_params.sSpatialLayers[0].iMaxSpatialBitrate = enc_params.iMaxBitrate;
+  /* layers go from the lowest resolution to the input size, the
+   * enhancement layers are coded with the scalable baseline profile */
+  for (i = 0; i < enc_params.iSpatialLayerNum; i++) {
+    SSpatialLayerConfig *layer = &enc_params.sSpatialLayers[i];
+    gint shift = enc_params.iSpatialLayerNum - 1 - i;
+
+    layer->uiProfileIdc = i == 0 ? PRO_BASELINE : PRO_SCALABLE_BASELINE;
+    layer->iVideoWidth = GST_ROUND_UP_2 (enc_params.iPicWidth >> shift);
+    layer->iVideoHeight = GST_ROUND_UP_2 (enc_params.iPicHeight >> shift);
+    layer->fFrameRate = fps_n * 1.0 / fps_d;
+  }
+  gst_openh264enc_set_layer_bitrates (&enc_params);
 
   if (openh264enc->slice_mode == GST_OPENH264_SLICE_MODE_N_SLICES) {
     if (openh264enc->num_slices == 1)
@@ -773,15 +857,19 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
     slice_mode = SM_SINGLE_SLICE;
   }
 
+  for (i = 0; i < enc_params.iSpatialLayerNum; i++) {
 #if OPENH264_MAJOR == 1 && OPENH264_MINOR < 6
-  enc_params.sSpatialLayers[0].sSliceCfg.uiSliceMode = slice_mode;
-  enc_params.sSpatialLayers[0].sSliceCfg.sSliceArgument.uiSliceNum = n_slices;
+    enc_params.sSpatialLayers[i].sSliceCfg.uiSliceMode = slice_mode;
+    enc_params.sSpatialLayers[i].sSliceCfg.sSliceArgument.uiSliceNum =
+        n_slices;
 #else
-  enc_params.sSpatialLayers[0].sSliceArgument.uiSliceMode = slice_mode;
-  enc_params.sSpatialLayers[0].sSliceArgument.uiSliceNum = n_slices;
+    enc_params.sSpatialLayers[i].sSliceArgument.uiSliceMode = slice_mode;
+    enc_params.sSpatialLayers[i].sSliceArgument.uiSliceNum = n_slices;
 #endif
+  }
 
   openh264enc->framerate = (1 + fps_n / fps_d);
+  openh264enc->nal_aligned = openh264enc->subframe_output;
 
   ret = openh264enc->encoder->InitializeExt (&enc_params);
 
@@ -800,6 +888,8 @@ gst_openh264enc_set_format (GstVideoEncoder * encoder,
   outcaps =
       gst_caps_copy (gst_static_pad_template_get_caps
       (&gst_openh264enc_src_template));
+  gst_caps_set_simple (outcaps, "alignment", G_TYPE_STRING,
+      openh264enc->nal_aligned ? "nal" : "au", NULL);
 
   output_state = gst_video_encoder_set_output_state (encoder, outcaps, state);
   gst_video_codec_state_unref (output_state);
@@ -817,6 +907,98 @@ gst_openh264enc_propose_allocation (GstVideoEncoder * encoder, GstQuery * query)
       (gst_openh264enc_parent_class)->propose_allocation (encoder, query);
 }
 
+/* Returns the index of the coded layer if all the coded data of the
+ * access unit belongs to the same spatial and quality layer, -1 otherwise */
+static gint
+gst_openh264enc_get_single_layer (SFrameBSInfo * frame_info)
+{
+  gint i, vcl_layer = -1;
+
+  for (i = 0; i < frame_info->iLayerNum; i++) {
+    SLayerBSInfo *layer = &frame_info->sLayerInfo[i];
+
+    if (layer->uiLayerType != VIDEO_CODING_LAYER)
+      continue;
+
+    if (vcl_layer < 0) {
+      vcl_layer = i;
+    } else if (layer->uiSpatialId !=
+        frame_info->sLayerInfo[vcl_layer].uiSpatialId
+        || layer->uiQualityId !=
+        frame_info->sLayerInfo[vcl_layer].uiQualityId) {
+      return -1;
+    }
+  }
+
+  return vcl_layer;
+}
+
+/* Pushes every NAL unit of the access unit in its own buffer. The first one
+ * goes through finish_frame() so that the pending events and timestamps are
+ * handled by the base class, the following ones are pushed directly with the
+ * same timestamps. openh264 only returns once the whole picture is coded, so
+ * this mostly saves the copy into a single buffer and lets downstream
+ * forward or drop layers as soon as the picture is out. */
+static GstFlowReturn
+gst_openh264enc_push_nals (GstOpenh264Enc * openh264enc,
+    GstVideoCodecFrame * frame, SFrameBSInfo * frame_info)
+{
+  GstVideoEncoder *encoder = GST_VIDEO_ENCODER (openh264enc);
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint i, j, n_nals = 0, nal_idx = 0;
+
+  for (i = 0; i < frame_info->iLayerNum; i++)
+    n_nals += frame_info->sLayerInfo[i].iNalCount;
+
+  if (n_nals == 0)
+    return gst_video_encoder_finish_frame (encoder, frame);
+
+  /* keep the frame around for the timestamps of the following buffers */
+  gst_video_codec_frame_ref (frame);
+
+  for (i = 0; i < frame_info->iLayerNum; i++) {
+    SLayerBSInfo *layer = &frame_info->sLayerInfo[i];
+    guchar *data = layer->pBsBuf;
+
+    for (j = 0; j < layer->iNalCount; j++) {
+      gsize size = layer->pNalLengthInByte[j];
+      GstBuffer *buf;
+
+      buf = gst_video_encoder_allocate_output_buffer (encoder, size);
+      gst_buffer_fill (buf, 0, data, size);
+      data += size;
+
+      if (layer->uiLayerType == VIDEO_CODING_LAYER)
+        gst_buffer_add_h264_layer_meta (buf, layer->uiSpatialId,
+            layer->uiTemporalId, layer->uiQualityId);
+
+      if (++nal_idx == n_nals)
+        GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_MARKER);
+
+      if (nal_idx == 1) {
+        frame->output_buffer = buf;
+        ret = gst_video_encoder_finish_frame (encoder, frame);
+      } else {
+        GST_BUFFER_PTS (buf) = frame->pts;
+        GST_BUFFER_DTS (buf) = frame->dts;
+        GST_BUFFER_DURATION (buf) = frame->duration;
+        if (!GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT (frame))
+          GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+        ret = gst_pad_push (GST_VIDEO_ENCODER_SRC_PAD (encoder), buf);
+      }
+
+      if (ret != GST_FLOW_OK)
+        goto done;
+    }
+  }
+
+done:
+  gst_video_codec_frame_unref (frame);
+
+  return ret;
+}
+
 static GstFlowReturn
 gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
     GstVideoCodecFrame * frame)
@@ -829,7 +1011,7 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
   SFrameBSInfo frame_info;
   gfloat fps;
   GstMapInfo map;
-  gint i, j;
+  gint i, j, vcl_layer;
   gsize buf_length = 0;
 
   GST_OBJECT_LOCK (openh264enc);
@@ -838,16 +1020,11 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
     SEncParamExt enc_params;
     if (openh264enc->encoder->GetOption (ENCODER_OPTION_SVC_ENCODE_PARAM_EXT,
             &enc_params) == cmResultSuccess) {
-      if (openh264enc->bitrate_changed) {
+      if (openh264enc->bitrate_changed)
         enc_params.iTargetBitrate = openh264enc->bitrate;
-        enc_params.sSpatialLayers[0].iSpatialBitrate =
-            enc_params.iTargetBitrate;
-      }
-      if (openh264enc->max_bitrate_changed) {
+      if (openh264enc->max_bitrate_changed)
         enc_params.iMaxBitrate = openh264enc->max_bitrate;
-        enc_params.sSpatialLayers[0].iMaxSpatialBitrate =
-            enc_params.iMaxBitrate;
-      }
+      gst_openh264enc_set_layer_bitrates (&enc_params);
       if (openh264enc->encoder->SetOption (ENCODER_OPTION_SVC_ENCODE_PARAM_EXT,
               &enc_params) != cmResultSuccess) {
         GST_WARNING_OBJECT (openh264enc,
@@ -963,6 +1140,9 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
     GST_VIDEO_CODEC_FRAME_UNSET_SYNC_POINT (frame);
   }
 
+  if (openh264enc->nal_aligned)
+    return gst_openh264enc_push_nals (openh264enc, frame, &frame_info);
+
   for (i = 0; i < frame_info.iLayerNum; i++) {
     for (j = 0; j < frame_info.sLayerInfo[i].iNalCount; j++) {
       buf_length += frame_info.sLayerInfo[i].pNalLengthInByte[j];
@@ -985,6 +1165,14 @@ gst_openh264enc_handle_frame (GstVideoEncoder * encoder,
 
   gst_buffer_unmap (frame->output_buffer, &map);
 
+  vcl_layer = gst_openh264enc_get_single_layer (&frame_info);
+  if (vcl_layer >= 0) {
+    SLayerBSInfo *layer = &frame_info.sLayerInfo[vcl_layer];
+
+    gst_buffer_add_h264_layer_meta (frame->output_buffer, layer->uiSpatialId,
+        layer->uiTemporalId, layer->uiQualityId);
+  }
+
   GST_LOG_OBJECT (openh264enc, "openh264 picture %scoded OK!",
       (ret != cmResultSuccess) ? "NOT " : "");
 
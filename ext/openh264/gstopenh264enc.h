@@ -93,6 +93,10 @@ struct _GstOpenh264Enc
   ECOMPLEXITY_MODE complexity;
   gboolean bitrate_changed;
   gboolean max_bitrate_changed;
+  guint num_temporal_layers;
+  guint num_spatial_layers;
+  gboolean subframe_output;
+  gboolean nal_aligned;
 };
 
 struct _GstOpenh264EncClass
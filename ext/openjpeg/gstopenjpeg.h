@@ -39,4 +39,10 @@
 #define OPJ_CPRL CPRL
 #endif
 
+/* opj_codec_set_threads() appeared in 2.2 */
+#if !defined(HAVE_OPENJPEG_1) && defined(OPJ_VERSION_MAJOR) && \
+    (OPJ_VERSION_MAJOR > 2 || (OPJ_VERSION_MAJOR == 2 && OPJ_VERSION_MINOR >= 2))
+#define HAVE_OPENJPEG_THREADS 1
+#endif
+
 #endif /* __GST_OPENJPEG_H__ */
@@ -32,15 +32,55 @@
 GST_DEBUG_CATEGORY_STATIC (gst_openjpeg_dec_debug);
 #define GST_CAT_DEFAULT gst_openjpeg_dec_debug
 
+static void gst_openjpeg_dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_openjpeg_dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+static void gst_openjpeg_dec_finalize (GObject * object);
 static gboolean gst_openjpeg_dec_start (GstVideoDecoder * decoder);
 static gboolean gst_openjpeg_dec_stop (GstVideoDecoder * decoder);
 static gboolean gst_openjpeg_dec_set_format (GstVideoDecoder * decoder,
     GstVideoCodecState * state);
 static GstFlowReturn gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
     GstVideoCodecFrame * frame);
+static GstFlowReturn gst_openjpeg_dec_finish (GstVideoDecoder * decoder);
+static GstFlowReturn gst_openjpeg_dec_drain (GstVideoDecoder * decoder);
+static gboolean gst_openjpeg_dec_flush (GstVideoDecoder * decoder);
 static gboolean gst_openjpeg_dec_decide_allocation (GstVideoDecoder * decoder,
     GstQuery * query);
 
+static void gst_openjpeg_dec_decode_func (gpointer data, gpointer user_data);
+static void gst_openjpeg_dec_discard_pending (GstOpenJPEGDec * self);
+
+typedef enum
+{
+  GST_OPENJPEG_DEC_RESULT_OK,
+  GST_OPENJPEG_DEC_RESULT_INIT_ERROR,
+  GST_OPENJPEG_DEC_RESULT_MAP_ERROR,
+  GST_OPENJPEG_DEC_RESULT_OPEN_ERROR,
+  GST_OPENJPEG_DEC_RESULT_DECODE_ERROR
+} GstOpenJPEGDecResult;
+
+/* A frame being decoded, jobs are queued in decoding order and finished
+ * from the streaming thread once done */
+struct _GstOpenJPEGDecJob
+{
+  GstVideoCodecFrame *frame;
+  opj_image_t *image;
+  GstOpenJPEGDecResult result;
+  gboolean done;
+};
+
+enum
+{
+  PROP_0,
+  PROP_MAX_THREADS,
+  PROP_FRAME_THREADS
+};
+
+#define DEFAULT_MAX_THREADS 0
+#define DEFAULT_FRAME_THREADS 1
+
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
 #define GRAY16 "GRAY16_LE"
 #define YUV10 "Y444_10LE, I422_10LE, I420_10LE"
@@ -73,12 +113,18 @@ G_DEFINE_TYPE (GstOpenJPEGDec, gst_openjpeg_dec, GST_TYPE_VIDEO_DECODER);
 static void
 gst_openjpeg_dec_class_init (GstOpenJPEGDecClass * klass)
 {
+  GObjectClass *gobject_class;
   GstElementClass *element_class;
   GstVideoDecoderClass *video_decoder_class;
 
+  gobject_class = (GObjectClass *) klass;
   element_class = (GstElementClass *) klass;
   video_decoder_class = (GstVideoDecoderClass *) klass;
 
+  gobject_class->set_property = gst_openjpeg_dec_set_property;
+  gobject_class->get_property = gst_openjpeg_dec_get_property;
+  gobject_class->finalize = gst_openjpeg_dec_finalize;
+
   gst_element_class_add_static_pad_template (element_class,
       &gst_openjpeg_dec_src_template);
   gst_element_class_add_static_pad_template (element_class,
@@ -96,8 +142,25 @@ gst_openjpeg_dec_class_init (GstOpenJPEGDecClass * klass)
       GST_DEBUG_FUNCPTR (gst_openjpeg_dec_set_format);
   video_decoder_class->handle_frame =
       GST_DEBUG_FUNCPTR (gst_openjpeg_dec_handle_frame);
+  video_decoder_class->finish = GST_DEBUG_FUNCPTR (gst_openjpeg_dec_finish);
+  video_decoder_class->drain = GST_DEBUG_FUNCPTR (gst_openjpeg_dec_drain);
+  video_decoder_class->flush = GST_DEBUG_FUNCPTR (gst_openjpeg_dec_flush);
   video_decoder_class->decide_allocation = gst_openjpeg_dec_decide_allocation;
 
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_int ("max-threads", "Maximum threads",
+          "Maximum number of threads OpenJPEG uses to decode a frame "
+          "(0 = number of CPUs), needs OpenJPEG 2.2 or newer",
+          0, G_MAXINT, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAME_THREADS,
+      g_param_spec_int ("frame-threads", "Frame threads",
+          "Number of frames decoded in parallel, adds as many frames of "
+          "latency (0 = number of CPUs, 1 = decode in the streaming thread)",
+          0, G_MAXINT, DEFAULT_FRAME_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (gst_openjpeg_dec_debug, "openjpegdec", 0,
       "OpenJPEG Decoder");
 }
@@ -117,6 +180,64 @@ gst_openjpeg_dec_init (GstOpenJPEGDec * self)
   self->params.cp_limit_decoding = NO_LIMITATION;
 #endif
   self->sampling = GST_JPEG2000_SAMPLING_NONE;
+  self->max_threads = DEFAULT_MAX_THREADS;
+  self->frame_threads = DEFAULT_FRAME_THREADS;
+  g_mutex_init (&self->decode_lock);
+  g_cond_init (&self->decode_cond);
+  g_queue_init (&self->pending_jobs);
+}
+
+static void
+gst_openjpeg_dec_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MAX_THREADS:
+      self->max_threads = g_value_get_int (value);
+      break;
+    case PROP_FRAME_THREADS:
+      self->frame_threads = g_value_get_int (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_openjpeg_dec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (object);
+
+  GST_OBJECT_LOCK (self);
+  switch (prop_id) {
+    case PROP_MAX_THREADS:
+      g_value_set_int (value, self->max_threads);
+      break;
+    case PROP_FRAME_THREADS:
+      g_value_set_int (value, self->frame_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_openjpeg_dec_finalize (GObject * object)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (object);
+
+  g_mutex_clear (&self->decode_lock);
+  g_cond_clear (&self->decode_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static gboolean
@@ -126,6 +247,32 @@ gst_openjpeg_dec_start (GstVideoDecoder * decoder)
 
   GST_DEBUG_OBJECT (self, "Starting");
 
+  GST_OBJECT_LOCK (self);
+  self->n_threads = self->max_threads;
+  self->n_frame_threads = self->frame_threads;
+  GST_OBJECT_UNLOCK (self);
+
+  if (self->n_threads == 0)
+    self->n_threads = g_get_num_processors ();
+  if (self->n_frame_threads == 0)
+    self->n_frame_threads = g_get_num_processors ();
+
+  if (self->n_frame_threads > 1) {
+    GError *err = NULL;
+
+    self->decode_pool = g_thread_pool_new (gst_openjpeg_dec_decode_func, self,
+        self->n_frame_threads, FALSE, &err);
+    if (!self->decode_pool) {
+      GST_WARNING_OBJECT (self, "Failed to create thread pool: %s",
+          err->message);
+      g_clear_error (&err);
+      self->n_frame_threads = 1;
+    }
+  }
+
+  GST_DEBUG_OBJECT (self, "Decoding %d frames in parallel, %d threads each",
+      self->n_frame_threads, self->n_threads);
+
   return TRUE;
 }
 
@@ -136,6 +283,12 @@ gst_openjpeg_dec_stop (GstVideoDecoder * video_decoder)
 
   GST_DEBUG_OBJECT (self, "Stopping");
 
+  if (self->decode_pool) {
+    gst_openjpeg_dec_discard_pending (self);
+    g_thread_pool_free (self->decode_pool, FALSE, TRUE);
+    self->decode_pool = NULL;
+  }
+
   if (self->output_state) {
     gst_video_codec_state_unref (self->output_state);
     self->output_state = NULL;
@@ -195,6 +348,14 @@ gst_openjpeg_dec_set_format (GstVideoDecoder * decoder,
     gst_video_codec_state_unref (self->input_state);
   self->input_state = gst_video_codec_state_ref (state);
 
+  /* frames come out up to one per extra frame thread late */
+  if (self->n_frame_threads > 1 && state->info.fps_n > 0) {
+    GstClockTime latency = gst_util_uint64_scale (self->n_frame_threads - 1,
+        state->info.fps_d * GST_SECOND, state->info.fps_n);
+
+    gst_video_decoder_set_latency (decoder, latency, latency);
+  }
+
   return TRUE;
 }
 
@@ -1046,13 +1207,12 @@ seek_fn (OPJ_OFF_T p_nb_bytes, void *p_user_data)
 }
 #endif
 
-static GstFlowReturn
-gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
-    GstVideoCodecFrame * frame)
+/* Decodes the codestream of a frame into an opj_image_t. This only touches
+ * the frame's input buffer and settings that don't change while streaming,
+ * so it can run on any thread */
+static void
+gst_openjpeg_dec_decode_job (GstOpenJPEGDec * self, GstOpenJPEGDecJob * job)
 {
-  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
-  GstFlowReturn ret = GST_FLOW_OK;
-  gint64 deadline;
   GstMapInfo map;
 #ifdef HAVE_OPENJPEG_1
   opj_dinfo_t *dec;
@@ -1062,23 +1222,14 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
   opj_stream_t *stream;
   MemStream mstream;
 #endif
-  opj_image_t *image;
-  GstVideoFrame vframe;
+  opj_image_t *image = NULL;
   opj_dparameters_t params;
 
-  GST_DEBUG_OBJECT (self, "Handling frame");
-
-  deadline = gst_video_decoder_get_max_decode_time (decoder, frame);
-  if (deadline < 0) {
-    GST_LOG_OBJECT (self, "Dropping too late frame: deadline %" G_GINT64_FORMAT,
-        deadline);
-    ret = gst_video_decoder_drop_frame (decoder, frame);
-    return ret;
-  }
-
   dec = opj_create_decompress (self->codec_format);
-  if (!dec)
-    goto initialization_error;
+  if (!dec) {
+    job->result = GST_OPENJPEG_DEC_RESULT_INIT_ERROR;
+    return;
+  }
 
 #ifdef HAVE_OPENJPEG_1
   if (G_UNLIKELY (gst_debug_category_get_threshold (GST_CAT_DEFAULT) >=
@@ -1110,25 +1261,42 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
     params.jpwl_exp_comps = self->ncomps;
   opj_setup_decoder (dec, &params);
 
-  if (!gst_buffer_map (frame->input_buffer, &map, GST_MAP_READ))
-    goto map_read_error;
+#ifdef HAVE_OPENJPEG_THREADS
+  if (self->n_threads > 1 && opj_has_thread_support ()
+      && !opj_codec_set_threads (dec, self->n_threads))
+    GST_WARNING_OBJECT (self, "Failed to use %d threads", self->n_threads);
+#endif
+
+  if (!gst_buffer_map (job->frame->input_buffer, &map, GST_MAP_READ)) {
+    job->result = GST_OPENJPEG_DEC_RESULT_MAP_ERROR;
+    goto done;
+  }
 
-  if (self->is_jp2c && map.size < 8)
-    goto open_error;
+  if (self->is_jp2c && map.size < 8) {
+    job->result = GST_OPENJPEG_DEC_RESULT_OPEN_ERROR;
+    goto unmap;
+  }
 
 #ifdef HAVE_OPENJPEG_1
   io = opj_cio_open ((opj_common_ptr) dec, map.data + (self->is_jp2c ? 8 : 0),
       map.size - (self->is_jp2c ? 8 : 0));
-  if (!io)
-    goto open_error;
+  if (!io) {
+    job->result = GST_OPENJPEG_DEC_RESULT_OPEN_ERROR;
+    goto unmap;
+  }
 
   image = opj_decode (dec, io);
-  if (!image)
-    goto decode_error;
+  opj_cio_close (io);
+  if (!image) {
+    job->result = GST_OPENJPEG_DEC_RESULT_DECODE_ERROR;
+    goto unmap;
+  }
 #else
   stream = opj_stream_create (4096, OPJ_TRUE);
-  if (!stream)
-    goto open_error;
+  if (!stream) {
+    job->result = GST_OPENJPEG_DEC_RESULT_OPEN_ERROR;
+    goto unmap;
+  }
 
   mstream.data = map.data + (self->is_jp2c ? 8 : 0);
   mstream.offset = 0;
@@ -1141,26 +1309,76 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
   opj_stream_set_user_data (stream, &mstream, NULL);
   opj_stream_set_user_data_length (stream, mstream.size);
 
-  image = NULL;
-  if (!opj_read_header (stream, dec, &image))
-    goto decode_error;
+  if (!opj_read_header (stream, dec, &image)
+      || !opj_decode (dec, stream, image)) {
+    opj_stream_destroy (stream);
+    job->result = GST_OPENJPEG_DEC_RESULT_DECODE_ERROR;
+    goto unmap;
+  }
 
-  if (!opj_decode (dec, stream, image))
-    goto decode_error;
+  opj_end_decompress (dec, stream);
+  opj_stream_destroy (stream);
 #endif
 
   {
     gint i;
 
     for (i = 0; i < image->numcomps; i++) {
-      if (image->comps[i].data == NULL)
-        goto decode_error;
+      if (image->comps[i].data == NULL) {
+        job->result = GST_OPENJPEG_DEC_RESULT_DECODE_ERROR;
+        goto unmap;
+      }
     }
   }
 
-  gst_buffer_unmap (frame->input_buffer, &map);
+  job->image = image;
+  image = NULL;
+  job->result = GST_OPENJPEG_DEC_RESULT_OK;
+
+unmap:
+  gst_buffer_unmap (job->frame->input_buffer, &map);
+done:
+  if (image)
+    opj_image_destroy (image);
+#ifdef HAVE_OPENJPEG_1
+  opj_destroy_decompress (dec);
+#else
+  opj_destroy_codec (dec);
+#endif
+}
+
+static void
+gst_openjpeg_dec_job_free (GstOpenJPEGDecJob * job)
+{
+  if (job->image)
+    opj_image_destroy (job->image);
+  g_slice_free (GstOpenJPEGDecJob, job);
+}
+
+/* Converts the decoded image into an output buffer and finishes the frame,
+ * must be called from the streaming thread */
+static GstFlowReturn
+gst_openjpeg_dec_finish_job (GstOpenJPEGDec * self, GstOpenJPEGDecJob * job)
+{
+  GstVideoDecoder *decoder = GST_VIDEO_DECODER (self);
+  GstVideoCodecFrame *frame = job->frame;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstVideoFrame vframe;
+
+  switch (job->result) {
+    case GST_OPENJPEG_DEC_RESULT_OK:
+      break;
+    case GST_OPENJPEG_DEC_RESULT_INIT_ERROR:
+      goto initialization_error;
+    case GST_OPENJPEG_DEC_RESULT_MAP_ERROR:
+      goto map_read_error;
+    case GST_OPENJPEG_DEC_RESULT_OPEN_ERROR:
+      goto open_error;
+    case GST_OPENJPEG_DEC_RESULT_DECODE_ERROR:
+      goto decode_error;
+  }
 
-  ret = gst_openjpeg_dec_negotiate (self, image);
+  ret = gst_openjpeg_dec_negotiate (self, job->image);
   if (ret != GST_FLOW_OK)
     goto negotiate_error;
 
@@ -1172,20 +1390,11 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
           frame->output_buffer, GST_MAP_WRITE))
     goto map_write_error;
 
-  self->fill_frame (&vframe, image);
+  self->fill_frame (&vframe, job->image);
 
   gst_video_frame_unmap (&vframe);
 
-#ifdef HAVE_OPENJPEG_1
-  opj_cio_close (io);
-  opj_image_destroy (image);
-  opj_destroy_decompress (dec);
-#else
-  opj_end_decompress (dec, stream);
-  opj_stream_destroy (stream);
-  opj_image_destroy (image);
-  opj_destroy_codec (dec);
-#endif
+  gst_openjpeg_dec_job_free (job);
 
   ret = gst_video_decoder_finish_frame (decoder, frame);
 
@@ -1193,6 +1402,7 @@ gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
 
 initialization_error:
   {
+    gst_openjpeg_dec_job_free (job);
     gst_video_codec_frame_unref (frame);
     GST_ELEMENT_ERROR (self, LIBRARY, INIT,
         ("Failed to initialize OpenJPEG decoder"), (NULL));
@@ -1200,11 +1410,7 @@ initialization_error:
   }
 map_read_error:
   {
-#ifdef HAVE_OPENJPEG_1
-    opj_destroy_decompress (dec);
-#else
-    opj_destroy_codec (dec);
-#endif
+    gst_openjpeg_dec_job_free (job);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
@@ -1213,12 +1419,7 @@ map_read_error:
   }
 open_error:
   {
-#ifdef HAVE_OPENJPEG_1
-    opj_destroy_decompress (dec);
-#else
-    opj_destroy_codec (dec);
-#endif
-    gst_buffer_unmap (frame->input_buffer, &map);
+    gst_openjpeg_dec_job_free (job);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, LIBRARY, INIT,
@@ -1227,16 +1428,7 @@ open_error:
   }
 decode_error:
   {
-    if (image)
-      opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
-    gst_buffer_unmap (frame->input_buffer, &map);
+    gst_openjpeg_dec_job_free (job);
     gst_video_codec_frame_unref (frame);
 
     GST_VIDEO_DECODER_ERROR (self, 1, STREAM, DECODE,
@@ -1245,14 +1437,7 @@ decode_error:
   }
 negotiate_error:
   {
-    opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
+    gst_openjpeg_dec_job_free (job);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, NEGOTIATION,
@@ -1261,14 +1446,7 @@ negotiate_error:
   }
 allocate_error:
   {
-    opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
+    gst_openjpeg_dec_job_free (job);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
@@ -1277,14 +1455,7 @@ allocate_error:
   }
 map_write_error:
   {
-    opj_image_destroy (image);
-#ifdef HAVE_OPENJPEG_1
-    opj_cio_close (io);
-    opj_destroy_decompress (dec);
-#else
-    opj_stream_destroy (stream);
-    opj_destroy_codec (dec);
-#endif
+    gst_openjpeg_dec_job_free (job);
     gst_video_codec_frame_unref (frame);
 
     GST_ELEMENT_ERROR (self, CORE, FAILED,
@@ -1293,6 +1464,132 @@ map_write_error:
   }
 }
 
+static void
+gst_openjpeg_dec_decode_func (gpointer data, gpointer user_data)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (user_data);
+  GstOpenJPEGDecJob *job = data;
+
+  gst_openjpeg_dec_decode_job (self, job);
+
+  g_mutex_lock (&self->decode_lock);
+  job->done = TRUE;
+  g_cond_broadcast (&self->decode_cond);
+  g_mutex_unlock (&self->decode_lock);
+}
+
+/* Finishes the pending frames in decoding order until at most max_pending
+ * are left, and then all the following ones that are already decoded */
+static GstFlowReturn
+gst_openjpeg_dec_finish_pending (GstOpenJPEGDec * self, guint max_pending)
+{
+  GstOpenJPEGDecJob *job;
+  GstFlowReturn ret = GST_FLOW_OK, flow;
+
+  g_mutex_lock (&self->decode_lock);
+  while ((job = g_queue_peek_head (&self->pending_jobs))) {
+    if (!job->done) {
+      if (g_queue_get_length (&self->pending_jobs) <= max_pending)
+        break;
+      g_cond_wait (&self->decode_cond, &self->decode_lock);
+      continue;
+    }
+
+    g_queue_pop_head (&self->pending_jobs);
+    g_mutex_unlock (&self->decode_lock);
+    flow = gst_openjpeg_dec_finish_job (self, job);
+    if (ret == GST_FLOW_OK)
+      ret = flow;
+    g_mutex_lock (&self->decode_lock);
+  }
+  g_mutex_unlock (&self->decode_lock);
+
+  return ret;
+}
+
+/* Waits for the frames being decoded and throws them away */
+static void
+gst_openjpeg_dec_discard_pending (GstOpenJPEGDec * self)
+{
+  GstOpenJPEGDecJob *job;
+
+  g_mutex_lock (&self->decode_lock);
+  while ((job = g_queue_peek_head (&self->pending_jobs))) {
+    if (!job->done) {
+      g_cond_wait (&self->decode_cond, &self->decode_lock);
+      continue;
+    }
+
+    g_queue_pop_head (&self->pending_jobs);
+    gst_video_codec_frame_unref (job->frame);
+    gst_openjpeg_dec_job_free (job);
+  }
+  g_mutex_unlock (&self->decode_lock);
+}
+
+static GstFlowReturn
+gst_openjpeg_dec_handle_frame (GstVideoDecoder * decoder,
+    GstVideoCodecFrame * frame)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+  GstOpenJPEGDecJob *job;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint64 deadline;
+
+  GST_DEBUG_OBJECT (self, "Handling frame");
+
+  deadline = gst_video_decoder_get_max_decode_time (decoder, frame);
+  if (deadline < 0) {
+    GST_LOG_OBJECT (self, "Dropping too late frame: deadline %" G_GINT64_FORMAT,
+        deadline);
+    ret = gst_video_decoder_drop_frame (decoder, frame);
+    return ret;
+  }
+
+  job = g_slice_new0 (GstOpenJPEGDecJob);
+  job->frame = frame;
+
+  if (!self->decode_pool) {
+    gst_openjpeg_dec_decode_job (self, job);
+    return gst_openjpeg_dec_finish_job (self, job);
+  }
+
+  g_mutex_lock (&self->decode_lock);
+  g_queue_push_tail (&self->pending_jobs, job);
+  g_mutex_unlock (&self->decode_lock);
+
+  g_thread_pool_push (self->decode_pool, job, NULL);
+
+  /* keep one frame decoding per thread */
+  return gst_openjpeg_dec_finish_pending (self, self->n_frame_threads - 1);
+}
+
+static GstFlowReturn
+gst_openjpeg_dec_finish (GstVideoDecoder * decoder)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+
+  return gst_openjpeg_dec_finish_pending (self, 0);
+}
+
+static GstFlowReturn
+gst_openjpeg_dec_drain (GstVideoDecoder * decoder)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+
+  return gst_openjpeg_dec_finish_pending (self, 0);
+}
+
+static gboolean
+gst_openjpeg_dec_flush (GstVideoDecoder * decoder)
+{
+  GstOpenJPEGDec *self = GST_OPENJPEG_DEC (decoder);
+
+  gst_openjpeg_dec_discard_pending (self);
+
+  return TRUE;
+}
+
 static gboolean
 gst_openjpeg_dec_decide_allocation (GstVideoDecoder * decoder, GstQuery * query)
 {
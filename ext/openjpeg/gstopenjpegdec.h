@@ -43,6 +43,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstOpenJPEGDec GstOpenJPEGDec;
 typedef struct _GstOpenJPEGDecClass GstOpenJPEGDecClass;
+typedef struct _GstOpenJPEGDecJob GstOpenJPEGDecJob;
 
 struct _GstOpenJPEGDec
 {
@@ -61,6 +62,20 @@ struct _GstOpenJPEGDec
   void (*fill_frame) (GstVideoFrame *frame, opj_image_t * image);
 
   opj_dparameters_t params;
+
+  /* properties */
+  gint max_threads;
+  gint frame_threads;
+
+  /* resolved when starting */
+  gint n_threads;
+  gint n_frame_threads;
+
+  /* frame threading */
+  GThreadPool *decode_pool;
+  GMutex decode_lock;
+  GCond decode_cond;
+  GQueue pending_jobs;
 };
 
 struct _GstOpenJPEGDecClass
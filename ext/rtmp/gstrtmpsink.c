@@ -45,6 +45,8 @@
 
 #ifdef G_OS_WIN32
 #include <winsock2.h>
+#else
+#include <sys/socket.h>
 #endif
 
 #include <stdlib.h>
@@ -53,13 +55,37 @@ GST_DEBUG_CATEGORY_STATIC (gst_rtmp_sink_debug);
 #define GST_CAT_DEFAULT gst_rtmp_sink_debug
 
 #define DEFAULT_LOCATION NULL
+#define DEFAULT_ASYNC_WRITE FALSE
+#define DEFAULT_MAX_QUEUE_TIME (1 * GST_SECOND)
+#define DEFAULT_OVERFLOW GST_RTMP_SINK_OVERFLOW_BLOCK
 
 enum
 {
   PROP_0,
-  PROP_LOCATION
+  PROP_LOCATION,
+  PROP_ASYNC_WRITE,
+  PROP_MAX_QUEUE_TIME,
+  PROP_OVERFLOW
 };
 
+#define GST_TYPE_RTMP_SINK_OVERFLOW (gst_rtmp_sink_overflow_get_type ())
+static GType
+gst_rtmp_sink_overflow_get_type (void)
+{
+  static GType overflow_type = 0;
+  static const GEnumValue overflow[] = {
+    {GST_RTMP_SINK_OVERFLOW_BLOCK, "Wait for the queue to drain", "block"},
+    {GST_RTMP_SINK_OVERFLOW_DROP, "Drop data until the next keyframe", "drop"},
+    {GST_RTMP_SINK_OVERFLOW_ERROR, "Fail with an error", "error"},
+    {0, NULL, NULL},
+  };
+
+  if (!overflow_type) {
+    overflow_type = g_enum_register_static ("GstRTMPSinkOverflow", overflow);
+  }
+  return overflow_type;
+}
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -78,6 +104,10 @@ static gboolean gst_rtmp_sink_start (GstBaseSink * sink);
 static gboolean gst_rtmp_sink_event (GstBaseSink * sink, GstEvent * event);
 static gboolean gst_rtmp_sink_setcaps (GstBaseSink * sink, GstCaps * caps);
 static GstFlowReturn gst_rtmp_sink_render (GstBaseSink * sink, GstBuffer * buf);
+static GstFlowReturn gst_rtmp_sink_render_list (GstBaseSink * sink,
+    GstBufferList * list);
+static gboolean gst_rtmp_sink_unlock (GstBaseSink * sink);
+static gboolean gst_rtmp_sink_unlock_stop (GstBaseSink * sink);
 
 #define gst_rtmp_sink_parent_class parent_class
 G_DEFINE_TYPE_WITH_CODE (GstRTMPSink, gst_rtmp_sink, GST_TYPE_BASE_SINK,
@@ -104,6 +134,48 @@ gst_rtmp_sink_class_init (GstRTMPSinkClass * klass)
       g_param_spec_string ("location", "RTMP Location", "RTMP url",
           DEFAULT_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRTMPSink:async-write:
+   *
+   * Write to the server from a separate thread, through a send queue
+   * bounded by #GstRTMPSink:max-queue-time, so that short server stalls
+   * don't block the streaming thread. Queued data is written in as few
+   * writes as possible.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ASYNC_WRITE,
+      g_param_spec_boolean ("async-write", "Asynchronous write",
+          "Write to the server from a separate thread",
+          DEFAULT_ASYNC_WRITE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTMPSink:max-queue-time:
+   *
+   * Maximum amount of data, in nanoseconds of stream time, held in the send
+   * queue when #GstRTMPSink:async-write is enabled.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_QUEUE_TIME,
+      g_param_spec_uint64 ("max-queue-time", "Max queue time",
+          "Maximum amount of data in the send queue (in ns)",
+          0, G_MAXUINT64, DEFAULT_MAX_QUEUE_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstRTMPSink:overflow:
+   *
+   * What to do when the send queue is full.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_OVERFLOW,
+      g_param_spec_enum ("overflow", "Overflow",
+          "What to do when the send queue is full",
+          GST_TYPE_RTMP_SINK_OVERFLOW, DEFAULT_OVERFLOW,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "RTMP output sink",
       "Sink/Network", "Sends FLV content to a server via RTMP",
@@ -114,6 +186,11 @@ gst_rtmp_sink_class_init (GstRTMPSinkClass * klass)
   gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_rtmp_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_rtmp_sink_stop);
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_rtmp_sink_render);
+  gstbasesink_class->render_list =
+      GST_DEBUG_FUNCPTR (gst_rtmp_sink_render_list);
+  gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_rtmp_sink_unlock);
+  gstbasesink_class->unlock_stop =
+      GST_DEBUG_FUNCPTR (gst_rtmp_sink_unlock_stop);
   gstbasesink_class->set_caps = GST_DEBUG_FUNCPTR (gst_rtmp_sink_setcaps);
   gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_rtmp_sink_event);
 
@@ -134,6 +211,15 @@ gst_rtmp_sink_init (GstRTMPSink * sink)
     GST_ERROR_OBJECT (sink, "WSAStartup failed: 0x%08x", WSAGetLastError ());
   }
 #endif
+
+  sink->async_write = DEFAULT_ASYNC_WRITE;
+  sink->max_queue_time = DEFAULT_MAX_QUEUE_TIME;
+  sink->overflow = DEFAULT_OVERFLOW;
+
+  g_mutex_init (&sink->queue_lock);
+  g_cond_init (&sink->queue_cond);
+  g_queue_init (&sink->queue);
+  sink->queue_head_ts = GST_CLOCK_TIME_NONE;
 }
 
 static void
@@ -145,11 +231,167 @@ gst_rtmp_sink_finalize (GObject * object)
   WSACleanup ();
 #endif
   g_free (sink->uri);
+  g_mutex_clear (&sink->queue_lock);
+  g_cond_clear (&sink->queue_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 
+static gboolean
+gst_rtmp_sink_write (GstRTMPSink * sink, GstBuffer * buf)
+{
+  GstMapInfo map;
+  gboolean ret;
+
+  GST_LOG_OBJECT (sink, "Sending %" G_GSIZE_FORMAT " bytes to RTMP server",
+      gst_buffer_get_size (buf));
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  ret = RTMP_Write (sink->rtmp, (char *) map.data, map.size) > 0;
+  gst_buffer_unmap (buf, &map);
+
+  return ret;
+}
+
+static void
+gst_rtmp_sink_clear_queue (GstRTMPSink * sink)
+{
+  g_queue_foreach (&sink->queue, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&sink->queue);
+  sink->queue_head_ts = GST_CLOCK_TIME_NONE;
+}
+
+static gpointer
+gst_rtmp_sink_writer_thread (GstRTMPSink * sink)
+{
+  g_mutex_lock (&sink->queue_lock);
+  while (sink->writer_running) {
+    GstBuffer *buf;
+    gboolean ok;
+
+    if (g_queue_is_empty (&sink->queue)) {
+      g_cond_wait (&sink->queue_cond, &sink->queue_lock);
+      continue;
+    }
+
+    /* coalesce everything that queued up into a single write */
+    buf = g_queue_pop_head (&sink->queue);
+    while (!g_queue_is_empty (&sink->queue))
+      buf = gst_buffer_append (buf, g_queue_pop_head (&sink->queue));
+    sink->queue_head_ts = GST_CLOCK_TIME_NONE;
+    sink->writing = TRUE;
+    g_cond_broadcast (&sink->queue_cond);
+    g_mutex_unlock (&sink->queue_lock);
+
+    ok = gst_rtmp_sink_write (sink, buf);
+    gst_buffer_unref (buf);
+
+    if (!ok)
+      GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, (NULL),
+          ("Failed to write data"));
+
+    g_mutex_lock (&sink->queue_lock);
+    sink->writing = FALSE;
+    if (!ok) {
+      sink->writer_flow = GST_FLOW_ERROR;
+      gst_rtmp_sink_clear_queue (sink);
+      g_cond_broadcast (&sink->queue_cond);
+      break;
+    }
+    g_cond_broadcast (&sink->queue_cond);
+  }
+  g_mutex_unlock (&sink->queue_lock);
+
+  return NULL;
+}
+
+static gboolean
+gst_rtmp_sink_queue_full (GstRTMPSink * sink, GstBuffer * buf)
+{
+  GstClockTime ts = GST_BUFFER_TIMESTAMP (buf);
+
+  if (g_queue_is_empty (&sink->queue))
+    return FALSE;
+
+  return GST_CLOCK_TIME_IS_VALID (ts) &&
+      GST_CLOCK_TIME_IS_VALID (sink->queue_head_ts) &&
+      ts > sink->queue_head_ts &&
+      ts - sink->queue_head_ts > sink->max_queue_time;
+}
+
+/* takes ownership of @buf */
+static GstFlowReturn
+gst_rtmp_sink_queue_buffer (GstRTMPSink * sink, GstBuffer * buf)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  g_mutex_lock (&sink->queue_lock);
+  if (sink->dropping) {
+    if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT)) {
+      GST_LOG_OBJECT (sink, "Dropping %p until next keyframe", buf);
+      goto drop;
+    }
+    sink->dropping = FALSE;
+  }
+
+  while (sink->writer_flow == GST_FLOW_OK && !sink->flushing &&
+      gst_rtmp_sink_queue_full (sink, buf)) {
+    if (sink->overflow == GST_RTMP_SINK_OVERFLOW_DROP) {
+      GST_WARNING_OBJECT (sink, "Send queue full, dropping until next "
+          "keyframe");
+      sink->dropping = TRUE;
+      goto drop;
+    } else if (sink->overflow == GST_RTMP_SINK_OVERFLOW_ERROR) {
+      g_mutex_unlock (&sink->queue_lock);
+      gst_buffer_unref (buf);
+      GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, (NULL),
+          ("Send queue overflowed, the server is not reading fast enough"));
+      return GST_FLOW_ERROR;
+    }
+
+    GST_DEBUG_OBJECT (sink, "Send queue full, waiting");
+    g_cond_wait (&sink->queue_cond, &sink->queue_lock);
+  }
+
+  if (sink->flushing)
+    ret = GST_FLOW_FLUSHING;
+  else if (sink->writer_flow != GST_FLOW_OK)
+    ret = sink->writer_flow;
+
+  if (ret != GST_FLOW_OK)
+    goto drop;
+
+  if (g_queue_is_empty (&sink->queue))
+    sink->queue_head_ts = GST_BUFFER_TIMESTAMP (buf);
+  g_queue_push_tail (&sink->queue, buf);
+  g_cond_broadcast (&sink->queue_cond);
+  g_mutex_unlock (&sink->queue_lock);
+
+  return GST_FLOW_OK;
+
+drop:
+  g_mutex_unlock (&sink->queue_lock);
+  gst_buffer_unref (buf);
+  return ret;
+}
+
+/* waits until everything queued was written */
+static GstFlowReturn
+gst_rtmp_sink_drain (GstRTMPSink * sink)
+{
+  GstFlowReturn ret;
+
+  g_mutex_lock (&sink->queue_lock);
+  while (sink->writer_flow == GST_FLOW_OK && !sink->flushing &&
+      (!g_queue_is_empty (&sink->queue) || sink->writing))
+    g_cond_wait (&sink->queue_cond, &sink->queue_lock);
+  ret = sink->flushing ? GST_FLOW_FLUSHING : sink->writer_flow;
+  g_mutex_unlock (&sink->queue_lock);
+
+  return ret;
+}
+
 static gboolean
 gst_rtmp_sink_start (GstBaseSink * basesink)
 {
@@ -184,6 +426,14 @@ gst_rtmp_sink_start (GstBaseSink * basesink)
   sink->first = TRUE;
   sink->have_write_error = FALSE;
 
+  if (sink->async_write) {
+    sink->writer_flow = GST_FLOW_OK;
+    sink->writer_running = TRUE;
+    sink->dropping = FALSE;
+    sink->writer = g_thread_new ("rtmpsink-writer",
+        (GThreadFunc) gst_rtmp_sink_writer_thread, sink);
+  }
+
   return TRUE;
 
 error:
@@ -201,6 +451,24 @@ gst_rtmp_sink_stop (GstBaseSink * basesink)
 {
   GstRTMPSink *sink = GST_RTMP_SINK (basesink);
 
+  if (sink->writer) {
+    g_mutex_lock (&sink->queue_lock);
+    sink->writer_running = FALSE;
+    g_cond_broadcast (&sink->queue_cond);
+    g_mutex_unlock (&sink->queue_lock);
+
+    /* unblock a write to a stalled server */
+    if (sink->rtmp && RTMP_IsConnected (sink->rtmp))
+      shutdown (RTMP_Socket (sink->rtmp), 2);
+
+    g_thread_join (sink->writer);
+    sink->writer = NULL;
+
+    g_mutex_lock (&sink->queue_lock);
+    gst_rtmp_sink_clear_queue (sink);
+    g_mutex_unlock (&sink->queue_lock);
+  }
+
   if (sink->header) {
     gst_buffer_unref (sink->header);
     sink->header = NULL;
@@ -222,8 +490,6 @@ static GstFlowReturn
 gst_rtmp_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 {
   GstRTMPSink *sink = GST_RTMP_SINK (bsink);
-  gboolean need_unref = FALSE;
-  GstMapInfo map = GST_MAP_INFO_INIT;
 
   if (sink->rtmp == NULL) {
     /* Do not crash */
@@ -253,11 +519,17 @@ gst_rtmp_sink_render (GstBaseSink * bsink, GstBuffer * buf)
       GST_DEBUG_OBJECT (sink, "Opened connection to %s", sink->rtmp_uri);
     }
 
-    /* Prepend the header from the caps to the first non header buffer */
-    if (sink->header) {
-      buf = gst_buffer_append (gst_buffer_ref (sink->header),
-          gst_buffer_ref (buf));
-      need_unref = TRUE;
+    /* Send the header from the caps before the first non header buffer */
+    if (sink->header && !sink->have_write_error) {
+      if (sink->writer) {
+        GstFlowReturn ret;
+
+        ret = gst_rtmp_sink_queue_buffer (sink, gst_buffer_ref (sink->header));
+        if (ret != GST_FLOW_OK)
+          return ret;
+      } else if (!gst_rtmp_sink_write (sink, sink->header)) {
+        goto write_failed;
+      }
     }
 
     sink->first = FALSE;
@@ -266,32 +538,80 @@ gst_rtmp_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   if (sink->have_write_error)
     goto write_failed;
 
-  GST_LOG_OBJECT (sink, "Sending %" G_GSIZE_FORMAT " bytes to RTMP server",
-      gst_buffer_get_size (buf));
-
-  gst_buffer_map (buf, &map, GST_MAP_READ);
+  if (sink->writer)
+    return gst_rtmp_sink_queue_buffer (sink, gst_buffer_ref (buf));
 
-  if (RTMP_Write (sink->rtmp, (char *) map.data, map.size) <= 0)
+  if (!gst_rtmp_sink_write (sink, buf))
     goto write_failed;
 
-  gst_buffer_unmap (buf, &map);
-  if (need_unref)
-    gst_buffer_unref (buf);
-
   return GST_FLOW_OK;
 
   /* ERRORS */
 write_failed:
   {
     GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, (NULL), ("Failed to write data"));
-    gst_buffer_unmap (buf, &map);
-    if (need_unref)
-      gst_buffer_unref (buf);
     sink->have_write_error = TRUE;
     return GST_FLOW_ERROR;
   }
 }
 
+static GstFlowReturn
+gst_rtmp_sink_render_list (GstBaseSink * bsink, GstBufferList * list)
+{
+  GstBuffer *buf = NULL;
+  GstFlowReturn ret;
+  guint i, len;
+
+  /* coalesce the tags of the list into a single write */
+  len = gst_buffer_list_length (list);
+  for (i = 0; i < len; i++) {
+    GstBuffer *b = gst_buffer_list_get (list, i);
+
+    if (GST_BUFFER_FLAG_IS_SET (b, GST_BUFFER_FLAG_HEADER))
+      continue;
+
+    if (buf == NULL) {
+      buf = gst_buffer_new ();
+      gst_buffer_copy_into (buf, b,
+          GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, 0);
+    }
+    buf = gst_buffer_append (buf, gst_buffer_ref (b));
+  }
+
+  if (buf == NULL)
+    return GST_FLOW_OK;
+
+  ret = gst_rtmp_sink_render (bsink, buf);
+  gst_buffer_unref (buf);
+
+  return ret;
+}
+
+static gboolean
+gst_rtmp_sink_unlock (GstBaseSink * basesink)
+{
+  GstRTMPSink *sink = GST_RTMP_SINK (basesink);
+
+  g_mutex_lock (&sink->queue_lock);
+  sink->flushing = TRUE;
+  g_cond_broadcast (&sink->queue_cond);
+  g_mutex_unlock (&sink->queue_lock);
+
+  return TRUE;
+}
+
+static gboolean
+gst_rtmp_sink_unlock_stop (GstBaseSink * basesink)
+{
+  GstRTMPSink *sink = GST_RTMP_SINK (basesink);
+
+  g_mutex_lock (&sink->queue_lock);
+  sink->flushing = FALSE;
+  g_mutex_unlock (&sink->queue_lock);
+
+  return TRUE;
+}
+
 /*
  * URI interface support.
  */
@@ -386,6 +706,21 @@ gst_rtmp_sink_set_property (GObject * object, guint prop_id,
       gst_rtmp_sink_uri_set_uri (GST_URI_HANDLER (sink),
           g_value_get_string (value), NULL);
       break;
+    case PROP_ASYNC_WRITE:
+      sink->async_write = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_QUEUE_TIME:
+      g_mutex_lock (&sink->queue_lock);
+      sink->max_queue_time = g_value_get_uint64 (value);
+      g_cond_broadcast (&sink->queue_cond);
+      g_mutex_unlock (&sink->queue_lock);
+      break;
+    case PROP_OVERFLOW:
+      g_mutex_lock (&sink->queue_lock);
+      sink->overflow = g_value_get_enum (value);
+      g_cond_broadcast (&sink->queue_cond);
+      g_mutex_unlock (&sink->queue_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -455,6 +790,15 @@ gst_rtmp_sink_event (GstBaseSink * sink, GstEvent * event)
   switch (event->type) {
     case GST_EVENT_FLUSH_STOP:
       rtmpsink->have_write_error = FALSE;
+      g_mutex_lock (&rtmpsink->queue_lock);
+      gst_rtmp_sink_clear_queue (rtmpsink);
+      rtmpsink->dropping = FALSE;
+      g_mutex_unlock (&rtmpsink->queue_lock);
+      break;
+    case GST_EVENT_EOS:
+      /* everything must have been sent before EOS is done */
+      if (rtmpsink->writer)
+        gst_rtmp_sink_drain (rtmpsink);
       break;
     default:
       break;
@@ -473,6 +817,15 @@ gst_rtmp_sink_get_property (GObject * object, guint prop_id,
     case PROP_LOCATION:
       g_value_set_string (value, sink->uri);
       break;
+    case PROP_ASYNC_WRITE:
+      g_value_set_boolean (value, sink->async_write);
+      break;
+    case PROP_MAX_QUEUE_TIME:
+      g_value_set_uint64 (value, sink->max_queue_time);
+      break;
+    case PROP_OVERFLOW:
+      g_value_set_enum (value, sink->overflow);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
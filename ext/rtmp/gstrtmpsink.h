@@ -44,6 +44,24 @@ G_BEGIN_DECLS
 typedef struct _GstRTMPSink      GstRTMPSink;
 typedef struct _GstRTMPSinkClass GstRTMPSinkClass;
 
+/**
+ * GstRTMPSinkOverflow:
+ * @GST_RTMP_SINK_OVERFLOW_BLOCK: wait for the send queue to drain
+ * @GST_RTMP_SINK_OVERFLOW_DROP: drop data until the next keyframe
+ * @GST_RTMP_SINK_OVERFLOW_ERROR: fail with an error
+ *
+ * What to do when the send queue of an asynchronously writing #GstRTMPSink
+ * is full.
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_RTMP_SINK_OVERFLOW_BLOCK,
+  GST_RTMP_SINK_OVERFLOW_DROP,
+  GST_RTMP_SINK_OVERFLOW_ERROR,
+} GstRTMPSinkOverflow;
+
 struct _GstRTMPSink {
   GstBaseSink parent;
 
@@ -56,6 +74,22 @@ struct _GstRTMPSink {
   GstBuffer *header;
   gboolean first;
   gboolean have_write_error;
+
+  /* asynchronous writing */
+  gboolean async_write;
+  guint64 max_queue_time;
+  GstRTMPSinkOverflow overflow;
+
+  GThread *writer;
+  GMutex queue_lock;
+  GCond queue_cond;
+  GQueue queue;
+  GstClockTime queue_head_ts;
+  gboolean writer_running;
+  gboolean writing;
+  gboolean flushing;
+  gboolean dropping;
+  GstFlowReturn writer_flow;
 };
 
 struct _GstRTMPSinkClass {
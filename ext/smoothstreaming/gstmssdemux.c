@@ -434,9 +434,10 @@ gst_mss_demux_setup_streams (GstAdaptiveDemux * demux)
     }
   }
 
-  GST_INFO_OBJECT (mssdemux, "Changing max bitrate to %u",
-      demux->connection_speed);
-  gst_mss_manifest_change_bitrate (mssdemux->manifest, demux->connection_speed);
+  GST_INFO_OBJECT (mssdemux, "Changing max bitrate to %" G_GUINT64_FORMAT,
+      gst_adaptive_demux_get_startup_bitrate (demux));
+  gst_mss_manifest_change_bitrate (mssdemux->manifest,
+      gst_adaptive_demux_get_startup_bitrate (demux));
 
   GST_INFO_OBJECT (mssdemux, "Activating streams");
 
@@ -459,9 +460,10 @@ gst_mss_demux_setup_streams (GstAdaptiveDemux * demux)
     active_streams = g_slist_prepend (active_streams, stream);
   }
 
-  GST_INFO_OBJECT (mssdemux, "Changing max bitrate to %u",
-      demux->connection_speed);
-  gst_mss_manifest_change_bitrate (mssdemux->manifest, demux->connection_speed);
+  GST_INFO_OBJECT (mssdemux, "Changing max bitrate to %" G_GUINT64_FORMAT,
+      gst_adaptive_demux_get_startup_bitrate (demux));
+  gst_mss_manifest_change_bitrate (mssdemux->manifest,
+      gst_adaptive_demux_get_startup_bitrate (demux));
 
   for (iter = active_streams; iter; iter = g_slist_next (iter)) {
     GstMssDemuxStream *stream = iter->data;
@@ -28,6 +28,7 @@
 #include <ctype.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 
 /* for parsing h264 codec data */
 #include <gst/codecparsers/gsth264parser.h>
@@ -54,6 +55,9 @@ GST_DEBUG_CATEGORY_EXTERN (mssdemux_debug);
 #define MSS_PROP_TIMESCALE            "TimeScale"
 #define MSS_PROP_URL                  "Url"
 
+/* A run of @repetitions fragments of the same duration starting at @time.
+ * The runs of a stream are stored in an array ordered by time, which is the
+ * cumulative time index used to look them up with a binary search */
 typedef struct _GstMssStreamFragment
 {
   guint number;
@@ -80,7 +84,7 @@ struct _GstMssStream
   gboolean has_live_fragments;
   GstAdapter *live_adapter;
 
-  GList *fragments;
+  GArray *fragments;             /* of GstMssStreamFragment */
   GList *qualities;
 
   gchar *url;
@@ -89,7 +93,7 @@ struct _GstMssStream
   GstMssFragmentParser fragment_parser;
 
   guint fragment_repetition_index;
-  GList *current_fragment;
+  guint current_fragment;       /* index in fragments, fragments->len at the end */
   GList *current_quality;
 
   /* TODO move this to somewhere static */
@@ -112,12 +116,23 @@ struct _GstMssManifest
   GSList *streams;
 };
 
+#define CURRENT_FRAGMENT(stream) \
+    ((stream)->current_fragment < (stream)->fragments->len ? \
+    &g_array_index ((stream)->fragments, GstMssStreamFragment, \
+        (stream)->current_fragment) : NULL)
+#define LAST_FRAGMENT(stream) \
+    ((stream)->fragments->len > 0 ? \
+    &g_array_index ((stream)->fragments, GstMssStreamFragment, \
+        (stream)->fragments->len - 1) : NULL)
+#define FRAGMENT_END(fragment) \
+    ((fragment)->time + (fragment)->duration * (fragment)->repetitions)
+
 /* For parsing and building a fragments list */
 typedef struct _GstMssFragmentListBuilder
 {
-  GList *fragments;
+  GArray *fragments;
 
-  GstMssStreamFragment *previous_fragment;
+  gint previous_fragment;       /* index of the fragment missing its duration */
   guint fragment_number;
   guint64 fragment_time_accum;
 } GstMssFragmentListBuilder;
@@ -125,27 +140,21 @@ typedef struct _GstMssFragmentListBuilder
 static void
 gst_mss_fragment_list_builder_init (GstMssFragmentListBuilder * builder)
 {
-  builder->fragments = NULL;
-  builder->previous_fragment = NULL;
+  builder->fragments = g_array_new (FALSE, FALSE,
+      sizeof (GstMssStreamFragment));
+  builder->previous_fragment = -1;
   builder->fragment_time_accum = 0;
   builder->fragment_number = 0;
 }
 
+/* Takes ownership of the attribute values */
 static void
-gst_mss_fragment_list_builder_add (GstMssFragmentListBuilder * builder,
-    xmlNodePtr node)
+gst_mss_fragment_list_builder_add_values (GstMssFragmentListBuilder * builder,
+    gchar * duration_str, gchar * time_str, gchar * seqnum_str,
+    gchar * repetition_str)
 {
-  gchar *duration_str;
-  gchar *time_str;
-  gchar *seqnum_str;
-  gchar *repetition_str;
-  GstMssStreamFragment *fragment = g_new (GstMssStreamFragment, 1);
-
-  duration_str = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_DURATION);
-  time_str = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_TIME);
-  seqnum_str = (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_NUMBER);
-  repetition_str =
-      (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_REPETITIONS);
+  GstMssStreamFragment fragment_value;
+  GstMssStreamFragment *fragment = &fragment_value;
 
   /* use the node's seq number or use the previous + 1 */
   if (seqnum_str) {
@@ -174,29 +183,76 @@ gst_mss_fragment_list_builder_add (GstMssFragmentListBuilder * builder,
   }
 
   /* if we have a previous fragment, means we need to set its duration */
-  if (builder->previous_fragment)
-    builder->previous_fragment->duration =
-        (fragment->time -
-        builder->previous_fragment->time) /
-        builder->previous_fragment->repetitions;
+  if (builder->previous_fragment != -1) {
+    GstMssStreamFragment *previous = &g_array_index (builder->fragments,
+        GstMssStreamFragment, builder->previous_fragment);
+
+    previous->duration =
+        (fragment->time - previous->time) / previous->repetitions;
+  }
 
   if (duration_str) {
     fragment->duration = g_ascii_strtoull (duration_str, NULL, 10);
 
-    builder->previous_fragment = NULL;
+    builder->previous_fragment = -1;
     builder->fragment_time_accum += fragment->duration * fragment->repetitions;
     xmlFree (duration_str);
   } else {
     /* store to set the duration at the next iteration */
-    builder->previous_fragment = fragment;
+    fragment->duration = 0;
+    builder->previous_fragment = builder->fragments->len;
   }
 
-  /* we reverse it later */
-  builder->fragments = g_list_prepend (builder->fragments, fragment);
+  g_array_append_val (builder->fragments, fragment_value);
   GST_LOG ("Adding fragment number: %u, time: %" G_GUINT64_FORMAT
       ", duration: %" G_GUINT64_FORMAT ", repetitions: %u",
-      fragment->number, fragment->time, fragment->duration,
-      fragment->repetitions);
+      fragment_value.number, fragment_value.time, fragment_value.duration,
+      fragment_value.repetitions);
+}
+
+static void
+gst_mss_fragment_list_builder_add (GstMssFragmentListBuilder * builder,
+    xmlNodePtr node)
+{
+  gst_mss_fragment_list_builder_add_values (builder,
+      (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_DURATION),
+      (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_TIME),
+      (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_NUMBER),
+      (gchar *) xmlGetProp (node, (xmlChar *) MSS_PROP_REPETITIONS));
+}
+
+static void
+gst_mss_fragment_list_builder_add_from_reader (GstMssFragmentListBuilder *
+    builder, xmlTextReaderPtr reader)
+{
+  gst_mss_fragment_list_builder_add_values (builder,
+      (gchar *) xmlTextReaderGetAttribute (reader,
+          (xmlChar *) MSS_PROP_DURATION),
+      (gchar *) xmlTextReaderGetAttribute (reader, (xmlChar *) MSS_PROP_TIME),
+      (gchar *) xmlTextReaderGetAttribute (reader, (xmlChar *) MSS_PROP_NUMBER),
+      (gchar *) xmlTextReaderGetAttribute (reader,
+          (xmlChar *) MSS_PROP_REPETITIONS));
+}
+
+/* Binary search of the run containing @time, returns the number of runs if
+ * @time is after the last one */
+static guint
+gst_mss_fragments_find (GArray * fragments, guint64 time)
+{
+  guint lo = 0, hi = fragments->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+    GstMssStreamFragment *fragment =
+        &g_array_index (fragments, GstMssStreamFragment, mid);
+
+    if (FRAGMENT_END (fragment) > time)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return lo;
 }
 
 static GstBuffer *gst_buffer_from_hex_string (const gchar * s);
@@ -284,10 +340,8 @@ _gst_mss_stream_init (GstMssManifest * manifest, GstMssStream * stream,
     stream->live_adapter = gst_adapter_new ();
   }
 
-  if (builder.fragments) {
-    stream->fragments = g_list_reverse (builder.fragments);
-    stream->current_fragment = stream->fragments;
-  }
+  stream->fragments = builder.fragments;
+  stream->current_fragment = 0;
 
   /* order them from smaller to bigger based on bitrates */
   stream->qualities =
@@ -422,7 +476,7 @@ gst_mss_stream_free (GstMssStream * stream)
     g_object_unref (stream->live_adapter);
   }
 
-  g_list_free_full (stream->fragments, g_free);
+  g_array_free (stream->fragments, TRUE);
   g_list_free_full (stream->qualities,
       (GDestroyNotify) gst_mss_stream_quality_free);
   xmlFree (stream->url);
@@ -957,13 +1011,10 @@ gst_mss_manifest_get_duration (GstMssManifest * manifest)
       GstMssStream *stream = iter->data;
 
       if (stream->active) {
-        if (stream->fragments) {
-          GList *l = g_list_last (stream->fragments);
-          GstMssStreamFragment *fragment = (GstMssStreamFragment *) l->data;
-          guint64 frag_dur =
-              fragment->time + fragment->duration * fragment->repetitions;
-          max_dur = MAX (frag_dur, max_dur);
-        }
+        GstMssStreamFragment *fragment = LAST_FRAGMENT (stream);
+
+        if (fragment)
+          max_dur = MAX (FRAGMENT_END (fragment), max_dur);
       }
     }
 
@@ -1045,11 +1096,10 @@ gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (stream->current_fragment == NULL) /* stream is over */
+  fragment = CURRENT_FRAGMENT (stream);
+  if (fragment == NULL)         /* stream is over */
     return GST_FLOW_EOS;
 
-  fragment = stream->current_fragment->data;
-
   time =
       fragment->time + fragment->duration * stream->fragment_repetition_index;
   start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT, time);
@@ -1077,15 +1127,14 @@ gst_mss_stream_get_fragment_gst_timestamp (GstMssStream * stream)
 
   g_return_val_if_fail (stream->active, GST_CLOCK_TIME_NONE);
 
-  if (!stream->current_fragment) {
-    GList *last = g_list_last (stream->fragments);
-    if (last == NULL)
+  fragment = CURRENT_FRAGMENT (stream);
+  if (fragment == NULL) {
+    fragment = LAST_FRAGMENT (stream);
+    if (fragment == NULL)
       return GST_CLOCK_TIME_NONE;
 
-    fragment = last->data;
-    time = fragment->time + (fragment->duration * fragment->repetitions);
+    time = FRAGMENT_END (fragment);
   } else {
-    fragment = stream->current_fragment->data;
     time =
         fragment->time +
         (fragment->duration * stream->fragment_repetition_index);
@@ -1105,11 +1154,10 @@ gst_mss_stream_get_fragment_gst_duration (GstMssStream * stream)
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (!stream->current_fragment)
+  fragment = CURRENT_FRAGMENT (stream);
+  if (fragment == NULL)
     return GST_CLOCK_TIME_NONE;
 
-  fragment = stream->current_fragment->data;
-
   dur = fragment->duration;
   timescale = gst_mss_stream_get_timescale (stream);
   return (GstClockTime) gst_util_uint64_scale_round (dur, GST_SECOND,
@@ -1121,10 +1169,7 @@ gst_mss_stream_has_next_fragment (GstMssStream * stream)
 {
   g_return_val_if_fail (stream->active, FALSE);
 
-  if (stream->current_fragment == NULL)
-    return FALSE;
-
-  return TRUE;
+  return CURRENT_FRAGMENT (stream) != NULL;
 }
 
 GstFlowReturn
@@ -1136,20 +1181,20 @@ gst_mss_stream_advance_fragment (GstMssStream * stream)
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (stream->current_fragment == NULL)
+  fragment = CURRENT_FRAGMENT (stream);
+  if (fragment == NULL)
     return GST_FLOW_EOS;
 
-  fragment = stream->current_fragment->data;
   stream->fragment_repetition_index++;
   if (stream->fragment_repetition_index < fragment->repetitions)
     goto beach;
 
   stream->fragment_repetition_index = 0;
-  stream->current_fragment = g_list_next (stream->current_fragment);
+  stream->current_fragment++;
 
   GST_DEBUG ("Advanced to fragment #%d on %s stream", fragment->number,
       stream_type_name);
-  if (stream->current_fragment == NULL)
+  if (CURRENT_FRAGMENT (stream) == NULL)
     return GST_FLOW_EOS;
 
 beach:
@@ -1164,15 +1209,16 @@ gst_mss_stream_regress_fragment (GstMssStream * stream)
   GstMssStreamFragment *fragment;
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
-  if (stream->current_fragment == NULL)
+  if (CURRENT_FRAGMENT (stream) == NULL)
     return GST_FLOW_EOS;
 
-  fragment = stream->current_fragment->data;
   if (stream->fragment_repetition_index == 0) {
-    stream->current_fragment = g_list_previous (stream->current_fragment);
-    if (stream->current_fragment == NULL)
+    if (stream->current_fragment == 0) {
+      stream->current_fragment = stream->fragments->len;
       return GST_FLOW_EOS;
-    fragment = stream->current_fragment->data;
+    }
+    stream->current_fragment--;
+    fragment = CURRENT_FRAGMENT (stream);
     stream->fragment_repetition_index = fragment->repetitions - 1;
   } else {
     stream->fragment_repetition_index--;
@@ -1224,18 +1270,22 @@ void
 gst_mss_stream_seek (GstMssStream * stream, gboolean forward,
     GstSeekFlags flags, guint64 time, guint64 * final_time)
 {
-  GList *iter;
   guint64 timescale;
+  guint index;
   GstMssStreamFragment *fragment = NULL;
 
   timescale = gst_mss_stream_get_timescale (stream);
   time = gst_util_uint64_scale_round (time, timescale, GST_SECOND);
 
   GST_DEBUG ("Stream %s seeking to %" G_GUINT64_FORMAT, stream->url, time);
-  for (iter = stream->fragments; iter; iter = g_list_next (iter)) {
-    fragment = iter->data;
-    if (fragment->time + fragment->repetitions * fragment->duration > time) {
-      stream->current_fragment = iter;
+  index = gst_mss_fragments_find (stream->fragments, time);
+  if (index < stream->fragments->len) {
+    fragment = &g_array_index (stream->fragments, GstMssStreamFragment, index);
+    stream->current_fragment = index;
+    if (time < fragment->time) {
+      /* in a gap before the run */
+      stream->fragment_repetition_index = 0;
+    } else {
       stream->fragment_repetition_index =
           (time - fragment->time) / fragment->duration;
       if (((time - fragment->time) % fragment->duration) == 0) {
@@ -1246,28 +1296,32 @@ gst_mss_stream_seek (GstMssStream * stream, gboolean forward,
           stream->fragment_repetition_index--;
       } else if (SNAP_AFTER (forward, flags))
         stream->fragment_repetition_index++;
+    }
 
-      if (stream->fragment_repetition_index == fragment->repetitions) {
-        /* move to the next one */
+    if (stream->fragment_repetition_index == fragment->repetitions) {
+      /* move to the next one */
+      stream->fragment_repetition_index = 0;
+      stream->current_fragment++;
+      fragment = CURRENT_FRAGMENT (stream);
+
+    } else if (stream->fragment_repetition_index == -1) {
+      if (index > 0) {
+        stream->current_fragment = index - 1;
+        fragment = CURRENT_FRAGMENT (stream);
+        g_assert (fragment);
+        stream->fragment_repetition_index = fragment->repetitions - 1;
+      } else {
         stream->fragment_repetition_index = 0;
-        stream->current_fragment = g_list_next (iter);
-        fragment =
-            stream->current_fragment ? stream->current_fragment->data : NULL;
-
-      } else if (stream->fragment_repetition_index == -1) {
-        if (g_list_previous (iter)) {
-          stream->current_fragment = g_list_previous (iter);
-          fragment = stream->current_fragment->data;
-          g_assert (fragment);
-          stream->fragment_repetition_index = fragment->repetitions - 1;
-        } else {
-          stream->fragment_repetition_index = 0;
-        }
       }
-
-      break;
     }
-
+  } else if (!forward && index > 0) {
+    /* past the end, reverse playback starts from the last fragment */
+    stream->current_fragment = index - 1;
+    fragment = CURRENT_FRAGMENT (stream);
+    stream->fragment_repetition_index = fragment->repetitions - 1;
+  } else {
+    stream->current_fragment = index;
+    stream->fragment_repetition_index = 0;
   }
 
   GST_DEBUG ("Stream %s seeked to fragment time %" G_GUINT64_FORMAT
@@ -1280,10 +1334,11 @@ gst_mss_stream_seek (GstMssStream * stream, gboolean forward,
           stream->fragment_repetition_index * fragment->duration,
           GST_SECOND, timescale);
     } else {
-      GstMssStreamFragment *last_fragment = g_list_last (iter)->data;
-      *final_time = gst_util_uint64_scale_round (last_fragment->time +
-          last_fragment->repetitions * last_fragment->duration,
-          GST_SECOND, timescale);
+      GstMssStreamFragment *last_fragment = LAST_FRAGMENT (stream);
+
+      *final_time = last_fragment ?
+          gst_util_uint64_scale_round (FRAGMENT_END (last_fragment),
+          GST_SECOND, timescale) : 0;
     }
   }
 }
@@ -1314,73 +1369,149 @@ gst_mss_manifest_is_live (GstMssManifest * manifest)
 }
 
 static void
-gst_mss_stream_reload_fragments (GstMssStream * stream, xmlNodePtr streamIndex)
+gst_mss_stream_append_fragment (GstMssStream * stream,
+    const GstMssStreamFragment * fragment)
 {
-  xmlNodePtr iter;
+  GstMssStreamFragment *last = LAST_FRAGMENT (stream);
+
+  /* extend the last run if the fragment simply repeats it */
+  if (last && last->duration == fragment->duration
+      && FRAGMENT_END (last) == fragment->time) {
+    last->repetitions += fragment->repetitions;
+    return;
+  }
+
+  g_array_append_vals (stream->fragments, fragment, 1);
+}
+
+/* Merges the fragments of a reloaded manifest into the stream: the runs that
+ * left the DVR window are dropped from the front and the new ones are
+ * appended, so the current position stays valid without a new lookup */
+static void
+gst_mss_stream_reload_fragments (GstMssStream * stream, GArray * fragments)
+{
+  GstMssStreamFragment *first, *last;
   guint64 current_gst_time;
-  GstMssFragmentListBuilder builder;
+  guint i, n;
 
-  current_gst_time = gst_mss_stream_get_fragment_gst_timestamp (stream);
+  if (fragments->len == 0) {
+    g_array_free (fragments, TRUE);
+    return;
+  }
 
-  gst_mss_fragment_list_builder_init (&builder);
+  current_gst_time = gst_mss_stream_get_fragment_gst_timestamp (stream);
 
   GST_DEBUG ("Current position: %" GST_TIME_FORMAT,
       GST_TIME_ARGS (current_gst_time));
 
-  for (iter = streamIndex->children; iter; iter = iter->next) {
-    if (node_has_type (iter, MSS_NODE_STREAM_FRAGMENT)) {
-      gst_mss_fragment_list_builder_add (&builder, iter);
+  /* drop the runs that ended before the start of the new window */
+  first = &g_array_index (fragments, GstMssStreamFragment, 0);
+  n = gst_mss_fragments_find (stream->fragments, first->time);
+  if (n > 0) {
+    g_array_remove_range (stream->fragments, 0, n);
+    if (stream->current_fragment >= n) {
+      stream->current_fragment -= n;
     } else {
-      /* TODO gst log this */
+      stream->current_fragment = 0;
+      stream->fragment_repetition_index = 0;
     }
   }
 
-  /* store the new fragments list */
-  if (builder.fragments) {
-    g_list_free_full (stream->fragments, g_free);
-    stream->fragments = g_list_reverse (builder.fragments);
-    stream->current_fragment = stream->fragments;
-    /* TODO Verify how repositioning here works for reverse
-     * playback - it might start from the wrong fragment */
-    gst_mss_stream_seek (stream, TRUE, 0, current_gst_time, NULL);
-  }
-}
+  for (i = 0; i < fragments->len; i++) {
+    GstMssStreamFragment fragment =
+        g_array_index (fragments, GstMssStreamFragment, i);
+    guint64 end;
+    guint skip;
 
-static void
-gst_mss_manifest_reload_fragments_from_xml (GstMssManifest * manifest,
-    xmlNodePtr root)
-{
-  xmlNodePtr nodeiter;
-  GSList *streams = manifest->streams;
+    last = LAST_FRAGMENT (stream);
+    end = last ? FRAGMENT_END (last) : 0;
 
-  /* we assume the server is providing the streams in the same order in
-   * every manifest */
-  for (nodeiter = root->children; nodeiter && streams;
-      nodeiter = nodeiter->next) {
-    if (nodeiter->type == XML_ELEMENT_NODE
-        && (strcmp ((const char *) nodeiter->name, "StreamIndex") == 0)) {
-      gst_mss_stream_reload_fragments (streams->data, nodeiter);
-      streams = g_slist_next (streams);
+    if (last == NULL || fragment.time >= end) {
+      gst_mss_stream_append_fragment (stream, &fragment);
+      continue;
     }
+
+    if (FRAGMENT_END (&fragment) <= end)
+      continue;
+
+    /* the run overlaps the end of the known ones, only keep its new part */
+    if (fragment.duration == 0 || (end - fragment.time) % fragment.duration)
+      goto rebuild;
+
+    skip = (end - fragment.time) / fragment.duration;
+    fragment.time = end;
+    fragment.number += skip;
+    fragment.repetitions -= skip;
+    gst_mss_stream_append_fragment (stream, &fragment);
   }
+
+  g_array_free (fragments, TRUE);
+  return;
+
+rebuild:
+  GST_DEBUG ("Reloaded fragments don't line up with the known ones");
+  g_array_free (stream->fragments, TRUE);
+  stream->fragments = fragments;
+  stream->current_fragment = 0;
+  /* TODO Verify how repositioning here works for reverse
+   * playback - it might start from the wrong fragment */
+  gst_mss_stream_seek (stream, TRUE, 0, current_gst_time, NULL);
 }
 
+/* The reloads only need the fragment lists, so the manifest is read with a
+ * streaming parser instead of building a new document */
 void
 gst_mss_manifest_reload_fragments (GstMssManifest * manifest, GstBuffer * data)
 {
-  xmlDocPtr xml;
-  xmlNodePtr root;
+  xmlTextReaderPtr reader;
   GstMapInfo info;
+  GSList *streams = manifest->streams;
+  GstMssFragmentListBuilder builder;
+  gboolean in_stream = FALSE;
 
   gst_buffer_map (data, &info, GST_MAP_READ);
 
-  xml = xmlReadMemory ((const gchar *) info.data,
-      info.size, "manifest", NULL, 0);
-  root = xmlDocGetRootElement (xml);
+  reader = xmlReaderForMemory ((const gchar *) info.data, info.size,
+      "manifest", NULL, 0);
+  if (reader == NULL) {
+    GST_WARNING ("Failed to create a reader for the manifest");
+    gst_buffer_unmap (data, &info);
+    return;
+  }
 
-  gst_mss_manifest_reload_fragments_from_xml (manifest, root);
+  /* we assume the server is providing the streams in the same order in
+   * every manifest */
+  while (xmlTextReaderRead (reader) == 1) {
+    const gchar *name = (const gchar *) xmlTextReaderConstLocalName (reader);
+    gint type = xmlTextReaderNodeType (reader);
+    gint depth = xmlTextReaderDepth (reader);
 
-  xmlFreeDoc (xml);
+    if (name == NULL)
+      continue;
+
+    if (type == XML_READER_TYPE_ELEMENT) {
+      if (depth == 1 && streams && strcmp (name, "StreamIndex") == 0
+          && !xmlTextReaderIsEmptyElement (reader)) {
+        gst_mss_fragment_list_builder_init (&builder);
+        in_stream = TRUE;
+      } else if (depth == 1 && streams && strcmp (name, "StreamIndex") == 0) {
+        streams = g_slist_next (streams);
+      } else if (in_stream && depth == 2
+          && strcmp (name, MSS_NODE_STREAM_FRAGMENT) == 0) {
+        gst_mss_fragment_list_builder_add_from_reader (&builder, reader);
+      }
+    } else if (type == XML_READER_TYPE_END_ELEMENT && in_stream && depth == 1) {
+      gst_mss_stream_reload_fragments (streams->data, builder.fragments);
+      streams = g_slist_next (streams);
+      in_stream = FALSE;
+    }
+  }
+
+  /* truncated manifest */
+  if (in_stream)
+    g_array_free (builder.fragments, TRUE);
+
+  xmlFreeTextReader (reader);
 
   gst_buffer_unmap (data, &info);
 }
@@ -1530,21 +1661,21 @@ static gboolean
 gst_mss_stream_get_live_seek_range (GstMssStream * stream, gint64 * start,
     gint64 * stop)
 {
-  GList *l;
   GstMssStreamFragment *fragment;
   guint64 timescale = gst_mss_stream_get_timescale (stream);
 
   g_return_val_if_fail (stream->active, FALSE);
 
+  if (stream->fragments->len == 0)
+    return FALSE;
+
   /* XXX: assumes all the data in the stream is still available */
-  l = g_list_first (stream->fragments);
-  fragment = (GstMssStreamFragment *) l->data;
+  fragment = &g_array_index (stream->fragments, GstMssStreamFragment, 0);
   *start = gst_util_uint64_scale_round (fragment->time, GST_SECOND, timescale);
 
-  l = g_list_last (stream->fragments);
-  fragment = (GstMssStreamFragment *) l->data;
-  *stop = gst_util_uint64_scale_round (fragment->time + fragment->duration *
-      fragment->repetitions, GST_SECOND, timescale);
+  fragment = LAST_FRAGMENT (stream);
+  *stop = gst_util_uint64_scale_round (FRAGMENT_END (fragment), GST_SECOND,
+      timescale);
 
   return TRUE;
 }
@@ -1625,32 +1756,26 @@ gst_mss_stream_parse_fragment (GstMssStream * stream, GstBuffer * buffer)
   for (index = 0; index < traf->tfrf->entries_count; index++) {
     GstTfrfBoxEntry *entry =
         &g_array_index (traf->tfrf->entries, GstTfrfBoxEntry, index);
-    GList *l = g_list_last (stream->fragments);
-    GstMssStreamFragment *last;
-    GstMssStreamFragment *fragment;
-    guint64 parsed_time = entry->time;
-    guint64 parsed_duration = entry->duration;
+    GstMssStreamFragment *last = LAST_FRAGMENT (stream);
+    GstMssStreamFragment fragment;
 
-    if (l == NULL)
+    if (last == NULL)
       break;
 
-    last = (GstMssStreamFragment *) l->data;
-
     /* only add the fragment to the list if it's outside the time in the
      * current list */
-    if (last->time >= entry->time)
+    if (FRAGMENT_END (last) > entry->time)
       continue;
 
-    fragment = g_new (GstMssStreamFragment, 1);
-    fragment->number = last->number + 1;
-    fragment->repetitions = 1;
-    fragment->time = parsed_time;
-    fragment->duration = parsed_duration;
+    fragment.number = last->number + last->repetitions;
+    fragment.repetitions = 1;
+    fragment.time = entry->time;
+    fragment.duration = entry->duration;
 
-    stream->fragments = g_list_append (stream->fragments, fragment);
+    gst_mss_stream_append_fragment (stream, &fragment);
     GST_LOG ("Adding fragment number: %u to %s stream, time: %"
         G_GUINT64_FORMAT ", duration: %" G_GUINT64_FORMAT ", repetitions: %u",
-        fragment->number, stream_type_name, fragment->time,
-        fragment->duration, fragment->repetitions);
+        fragment.number, stream_type_name, fragment.time,
+        fragment.duration, fragment.repetitions);
   }
 }
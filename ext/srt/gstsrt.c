@@ -176,6 +176,52 @@ gst_srt_client_connect (GstElement * elem, int sender,
       NULL, 0);
 }
 
+/* Picks a latency for the link described by @stats, as a multiple of the
+ * round trip time that grows with the packet loss, following the SRT
+ * deployment guide. Small changes are ignored so that the latency does not
+ * follow every RTT fluctuation. */
+gint
+gst_srt_tune_latency (const GstStructure * stats, gint latency,
+    gint min_latency, gint max_latency)
+{
+  gdouble rtt = 0.0, loss;
+  gint64 sent = 0;
+  gint packets = 0, lost = 0;
+  gint multiplier, target;
+
+  if (!gst_structure_get_double (stats, "rtt-ms", &rtt) || rtt <= 0.0)
+    return latency;
+
+  if (gst_structure_get_int64 (stats, "packets-sent", &sent))
+    gst_structure_get_int (stats, "packets-sent-lost", &lost);
+  else if (gst_structure_get_int (stats, "packets-received", &packets))
+    gst_structure_get_int (stats, "packets-received-lost", &lost);
+  sent += packets;
+
+  loss = sent + lost > 0 ? (gdouble) lost / (sent + lost) : 0.0;
+
+  if (loss <= 0.01)
+    multiplier = 3;
+  else if (loss <= 0.03)
+    multiplier = 4;
+  else if (loss <= 0.07)
+    multiplier = 6;
+  else if (loss <= 0.10)
+    multiplier = 8;
+  else
+    multiplier = 10;
+
+  target = CLAMP ((gint) (multiplier * rtt), min_latency, max_latency);
+
+  if (ABS (target - latency) * 10 < latency)
+    return latency;
+
+  GST_DEBUG ("rtt %.1f ms, loss %.2f%%: latency %d -> %d ms", rtt,
+      loss * 100.0, latency, target);
+
+  return target;
+}
+
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
@@ -33,6 +33,10 @@
 #define SRT_DEFAULT_URI SRT_URI_SCHEME"://"SRT_DEFAULT_HOST":"G_STRINGIFY(SRT_DEFAULT_PORT)
 #define SRT_DEFAULT_LATENCY 125
 #define SRT_DEFAULT_KEY_LENGTH 16
+#define SRT_DEFAULT_STATS_INTERVAL 0
+#define SRT_DEFAULT_AUTO_LATENCY FALSE
+#define SRT_DEFAULT_MIN_LATENCY 20
+#define SRT_DEFAULT_MAX_LATENCY 8000
 
 G_BEGIN_DECLS
 
@@ -49,6 +53,10 @@ gst_srt_client_connect_full (GstElement * elem, int sender,
     GSocketAddress ** socket_address, gint * poll_id,
     gchar * passphrase, int key_length);
 
+gint
+gst_srt_tune_latency (const GstStructure * stats, gint latency,
+    gint min_latency, gint max_latency);
+
 G_END_DECLS
 
 
@@ -37,6 +37,10 @@ enum
   PROP_LATENCY,
   PROP_PASSPHRASE,
   PROP_KEY_LENGTH,
+  PROP_STATS_INTERVAL,
+  PROP_AUTO_LATENCY,
+  PROP_MIN_LATENCY,
+  PROP_MAX_LATENCY,
 
   /*< private > */
   PROP_LAST
@@ -80,6 +84,18 @@ gst_srt_base_sink_get_property (GObject * object,
     case PROP_KEY_LENGTH:
       g_value_set_int (value, self->key_length);
       break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
+    case PROP_AUTO_LATENCY:
+      g_value_set_boolean (value, self->auto_latency);
+      break;
+    case PROP_MIN_LATENCY:
+      g_value_set_int (value, self->min_latency);
+      break;
+    case PROP_MAX_LATENCY:
+      g_value_set_int (value, self->max_latency);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -112,6 +128,18 @@ gst_srt_base_sink_set_property (GObject * object,
       self->key_length = key_length;
       break;
     }
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
+    case PROP_AUTO_LATENCY:
+      self->auto_latency = g_value_get_boolean (value);
+      break;
+    case PROP_MIN_LATENCY:
+      self->min_latency = g_value_get_int (value);
+      break;
+    case PROP_MAX_LATENCY:
+      self->max_latency = g_value_get_int (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -186,6 +214,7 @@ gst_srt_base_sink_stop (GstBaseSink * sink)
   GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
 
   g_clear_pointer (&self->headers, gst_buffer_list_unref);
+  self->last_stats_time = 0;
 
   return TRUE;
 }
@@ -262,6 +291,49 @@ gst_srt_base_sink_class_init (GstSRTBaseSinkClass * klass)
       "Crypto key length in bytes{16,24,32}", 16,
       32, SRT_DEFAULT_KEY_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSRTBaseSink:stats-interval:
+   *
+   * The interval at which an "application/x-srt-statistics" element message
+   * with the statistics of the link is posted while data flows, one per
+   * connected peer.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_STATS_INTERVAL] =
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+      "Interval between statistics messages in milliseconds (0 = disabled)",
+      0, G_MAXUINT, SRT_DEFAULT_STATS_INTERVAL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstSRTBaseSink:auto-latency:
+   *
+   * Derive #GstSRTBaseSink:latency from the round trip time and the packet
+   * loss measured for #GstSRTBaseSink:stats-interval, within
+   * #GstSRTBaseSink:min-latency and #GstSRTBaseSink:max-latency. SRT fixes the
+   * latency of a connection when it is established, so the new value
+   * applies to the next connection.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_AUTO_LATENCY] =
+      g_param_spec_boolean ("auto-latency", "Automatic latency",
+      "Tune the latency from the measured RTT and packet loss",
+      SRT_DEFAULT_AUTO_LATENCY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_MIN_LATENCY] =
+      g_param_spec_int ("min-latency", "Minimum latency",
+      "Lowest latency picked by auto-latency (milliseconds)", 0,
+      G_MAXINT32, SRT_DEFAULT_MIN_LATENCY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_MAX_LATENCY] =
+      g_param_spec_int ("max-latency", "Maximum latency",
+      "Highest latency picked by auto-latency (milliseconds)", 0,
+      G_MAXINT32, SRT_DEFAULT_MAX_LATENCY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
   gstbasesink_class->set_caps = GST_DEBUG_FUNCPTR (gst_srt_base_sink_set_caps);
@@ -276,6 +348,10 @@ gst_srt_base_sink_init (GstSRTBaseSink * self)
   self->latency = SRT_DEFAULT_LATENCY;
   self->passphrase = NULL;
   self->key_length = SRT_DEFAULT_KEY_LENGTH;
+  self->stats_interval = SRT_DEFAULT_STATS_INTERVAL;
+  self->auto_latency = SRT_DEFAULT_AUTO_LATENCY;
+  self->min_latency = SRT_DEFAULT_MIN_LATENCY;
+  self->max_latency = SRT_DEFAULT_MAX_LATENCY;
 }
 
 static GstURIType
@@ -439,3 +515,56 @@ gst_srt_base_sink_get_stats (GSocketAddress * sockaddr, SRTSOCKET sock)
 
   return s;
 }
+
+/**
+ * gst_srt_base_sink_stats_due:
+ * @self: a #GstSRTBaseSink
+ *
+ * Returns: %TRUE if #GstSRTBaseSink:stats-interval elapsed since the
+ * statistics were last posted, in which case the subclass posts the
+ * statistics of each of its peers with gst_srt_base_sink_post_stats().
+ */
+gboolean
+gst_srt_base_sink_stats_due (GstSRTBaseSink * self)
+{
+  gint64 now;
+
+  if (self->stats_interval == 0)
+    return FALSE;
+
+  now = g_get_monotonic_time ();
+  if (self->last_stats_time != 0 &&
+      now - self->last_stats_time < self->stats_interval * G_GINT64_CONSTANT (1000))
+    return FALSE;
+
+  self->last_stats_time = now;
+
+  return TRUE;
+}
+
+/**
+ * gst_srt_base_sink_post_stats:
+ * @self: a #GstSRTBaseSink
+ * @stats: (transfer full): statistics from gst_srt_base_sink_get_stats()
+ *
+ * Posts @stats as an element message, after tuning the latency from them
+ * if #GstSRTBaseSink:auto-latency is enabled.
+ */
+void
+gst_srt_base_sink_post_stats (GstSRTBaseSink * self, GstStructure * stats)
+{
+  if (self->auto_latency) {
+    gint latency = gst_srt_tune_latency (stats, self->latency,
+        self->min_latency, self->max_latency);
+
+    if (latency != self->latency) {
+      GST_INFO_OBJECT (self, "latency tuned to %d ms", latency);
+      self->latency = latency;
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LATENCY]);
+    }
+    gst_structure_set (stats, "tuned-latency-ms", G_TYPE_INT, latency, NULL);
+  }
+
+  gst_element_post_message (GST_ELEMENT_CAST (self),
+      gst_message_new_element (GST_OBJECT_CAST (self), stats));
+}
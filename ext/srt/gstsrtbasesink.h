@@ -50,6 +50,12 @@ struct _GstSRTBaseSink {
   gchar *passphrase;
   gint key_length;
 
+  guint stats_interval;
+  gboolean auto_latency;
+  gint min_latency;
+  gint max_latency;
+  gint64 last_stats_time;
+
   /*< private >*/
   gpointer _gst_reserved[GST_PADDING];
 };
@@ -75,6 +81,10 @@ gboolean gst_srt_base_sink_send_headers (GstSRTBaseSink *sink,
 GstStructure * gst_srt_base_sink_get_stats (GSocketAddress *sockaddr,
     SRTSOCKET sock);
 
+gboolean gst_srt_base_sink_stats_due (GstSRTBaseSink *sink);
+
+void gst_srt_base_sink_post_stats (GstSRTBaseSink *sink, GstStructure *stats);
+
 
 G_END_DECLS
 
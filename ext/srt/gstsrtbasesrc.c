@@ -30,6 +30,9 @@
 #define GST_CAT_DEFAULT gst_debug_srt_base_src
 GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
 
+#define SRT_DEFAULT_BUFFER_LIST FALSE
+#define SRT_DEFAULT_MESSAGES_PER_BUFFER 1
+
 enum
 {
   PROP_URI = 1,
@@ -37,6 +40,12 @@ enum
   PROP_LATENCY,
   PROP_PASSPHRASE,
   PROP_KEY_LENGTH,
+  PROP_STATS_INTERVAL,
+  PROP_AUTO_LATENCY,
+  PROP_MIN_LATENCY,
+  PROP_MAX_LATENCY,
+  PROP_BUFFER_LIST,
+  PROP_MESSAGES_PER_BUFFER,
 
   /*< private > */
   PROP_LAST
@@ -84,6 +93,24 @@ gst_srt_base_src_get_property (GObject * object,
     case PROP_KEY_LENGTH:
       g_value_set_int (value, self->key_length);
       break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
+    case PROP_AUTO_LATENCY:
+      g_value_set_boolean (value, self->auto_latency);
+      break;
+    case PROP_MIN_LATENCY:
+      g_value_set_int (value, self->min_latency);
+      break;
+    case PROP_MAX_LATENCY:
+      g_value_set_int (value, self->max_latency);
+      break;
+    case PROP_BUFFER_LIST:
+      g_value_set_boolean (value, self->buffer_list);
+      break;
+    case PROP_MESSAGES_PER_BUFFER:
+      g_value_set_uint (value, self->messages_per_buffer);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -122,6 +149,24 @@ gst_srt_base_src_set_property (GObject * object,
       self->key_length = key_length;
       break;
     }
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
+    case PROP_AUTO_LATENCY:
+      self->auto_latency = g_value_get_boolean (value);
+      break;
+    case PROP_MIN_LATENCY:
+      self->min_latency = g_value_get_int (value);
+      break;
+    case PROP_MAX_LATENCY:
+      self->max_latency = g_value_get_int (value);
+      break;
+    case PROP_BUFFER_LIST:
+      self->buffer_list = g_value_get_boolean (value);
+      break;
+    case PROP_MESSAGES_PER_BUFFER:
+      self->messages_per_buffer = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -166,12 +211,258 @@ gst_srt_base_src_get_caps (GstBaseSrc * src, GstCaps * filter)
   return result;
 }
 
+static GstStructure *
+gst_srt_base_src_get_stats (SRTSOCKET sock)
+{
+  SRT_TRACEBSTATS stats;
+  GstStructure *s;
+
+  s = gst_structure_new_empty ("application/x-srt-statistics");
+
+  if (srt_bstats (sock, &stats, 0) >= 0) {
+    gst_structure_set (s,
+        /* number of received data packets */
+        "packets-received", G_TYPE_INT, stats.pktRecvTotal,
+        /* number of lost packets (receiver side) */
+        "packets-received-lost", G_TYPE_INT, stats.pktRcvLossTotal,
+        /* number of too-late-to-play dropped packets */
+        "packets-received-dropped", G_TYPE_INT, stats.pktRcvDropTotal,
+        /* number of sent NAK packets, each asks for retransmissions */
+        "packet-nack-sent", G_TYPE_INT, stats.pktSentNAKTotal,
+        "bytes-received", G_TYPE_UINT64, stats.byteRecvTotal,
+        "receive-rate-mbps", G_TYPE_DOUBLE, stats.mbpsRecvRate,
+        /* estimated bandwidth, in Mb/s */
+        "bandwidth-mbps", G_TYPE_DOUBLE, stats.mbpsBandwidth,
+        "rtt-ms", G_TYPE_DOUBLE, stats.msRTT,
+        /* occupancy of the receive buffer */
+        "receive-buffer-packets", G_TYPE_INT, stats.pktRcvBuf,
+        "receive-buffer-bytes", G_TYPE_INT, stats.byteRcvBuf,
+        "receive-buffer-ms", G_TYPE_INT, stats.msRcvBuf,
+        "negotiated-latency-ms", G_TYPE_INT, stats.msRcvTsbPdDelay, NULL);
+  }
+
+  return s;
+}
+
+static void
+gst_srt_base_src_post_stats (GstSRTBaseSrc * self)
+{
+  GstSRTBaseSrcClass *klass = GST_SRT_BASE_SRC_GET_CLASS (self);
+  GstStructure *stats;
+  SRTSOCKET sock;
+  gint poll_id;
+  gint64 now;
+
+  if (self->stats_interval == 0)
+    return;
+
+  now = g_get_monotonic_time ();
+  if (self->last_stats_time != 0 &&
+      now - self->last_stats_time < self->stats_interval * G_GINT64_CONSTANT (1000))
+    return;
+  self->last_stats_time = now;
+
+  if (!klass->get_socket || !klass->get_socket (self, &sock, &poll_id))
+    return;
+
+  stats = gst_srt_base_src_get_stats (sock);
+
+  if (self->auto_latency) {
+    gint latency = gst_srt_tune_latency (stats, self->latency,
+        self->min_latency, self->max_latency);
+
+    if (latency != self->latency) {
+      GST_INFO_OBJECT (self, "latency tuned to %d ms", latency);
+      self->latency = latency;
+      g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LATENCY]);
+    }
+    gst_structure_set (stats, "tuned-latency-ms", G_TYPE_INT, latency, NULL);
+  }
+
+  gst_element_post_message (GST_ELEMENT_CAST (self),
+      gst_message_new_element (GST_OBJECT_CAST (self), stats));
+}
+
+static gboolean
+gst_srt_base_src_socket_readable (SRTSOCKET sock, gint poll_id)
+{
+  SRTSOCKET ready[2];
+  int ready_len = G_N_ELEMENTS (ready);
+  int i;
+
+  if (srt_epoll_wait (poll_id, ready, &ready_len, 0, 0, 0, 0, 0, 0, 0) == -1) {
+    srt_clearlasterror ();
+    return FALSE;
+  }
+
+  for (i = 0; i < ready_len; i++) {
+    if (ready[i] == sock)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+ * gst_srt_base_src_receive:
+ * @self: a #GstSRTBaseSrc
+ * @sock: the connected socket, readable
+ * @poll_id: a poll id @sock was added to for reading
+ * @outbuf: the buffer to receive into
+ *
+ * Receives one message into @outbuf, followed by the messages that can be
+ * read without waiting, up to #GstSRTBaseSrc:messages-per-buffer in total.
+ *
+ * Returns: the number of bytes received, or what srt_recvmsg() returned
+ * for the first message if it failed.
+ */
+gint
+gst_srt_base_src_receive (GstSRTBaseSrc * self, SRTSOCKET sock,
+    gint poll_id, GstBuffer * outbuf)
+{
+  GstMapInfo info;
+  gsize blocksize, offset = 0;
+  guint n_messages = 0;
+  gint recv_len;
+
+  if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, WRITE,
+        ("Could not map the output stream"), (NULL));
+    return SRT_ERROR;
+  }
+
+  blocksize = MIN (gst_base_src_get_blocksize (GST_BASE_SRC (self)),
+      info.size);
+
+  do {
+    recv_len = srt_recvmsg (sock, (char *) info.data + offset,
+        info.size - offset);
+    if (recv_len <= 0)
+      break;
+
+    offset += recv_len;
+    n_messages++;
+  } while (n_messages < self->messages_per_buffer &&
+      info.size - offset >= blocksize &&
+      gst_srt_base_src_socket_readable (sock, poll_id));
+
+  gst_buffer_unmap (outbuf, &info);
+
+  GST_TRACE_OBJECT (self, "received %u messages, %" G_GSIZE_FORMAT " bytes",
+      n_messages, offset);
+
+  /* a failure after the first message is reported by the next call */
+  if (n_messages == 0)
+    return recv_len;
+  if (recv_len == SRT_ERROR)
+    srt_clearlasterror ();
+
+  return offset;
+}
+
+/* buffers sized for messages-per-buffer messages of up to blocksize bytes,
+ * not shared with downstream */
+static gboolean
+gst_srt_base_src_decide_allocation (GstBaseSrc * src, GstQuery * query)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (src);
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstCaps *caps;
+  guint size;
+
+  size = gst_base_src_get_blocksize (src) * MAX (self->messages_per_buffer, 1);
+
+  gst_query_parse_allocation (query, &caps, NULL);
+
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, size, 0, 0);
+  gst_buffer_pool_set_config (pool, config);
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, 0, 0);
+  else
+    gst_query_add_allocation_pool (query, pool, size, 0, 0);
+  gst_object_unref (pool);
+
+  return GST_BASE_SRC_CLASS (parent_class)->decide_allocation (src, query);
+}
+
+/* With buffer-list, everything that is readable after fill() returned is
+ * received into more buffers, and all of them are pushed as one list. */
+static GstFlowReturn
+gst_srt_base_src_create (GstPushSrc * src, GstBuffer ** outbuf)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (src);
+  GstSRTBaseSrcClass *klass = GST_SRT_BASE_SRC_GET_CLASS (src);
+  GstBaseSrc *bsrc = GST_BASE_SRC (src);
+  GstBaseSrcClass *bclass = GST_BASE_SRC_GET_CLASS (src);
+  GstBufferList *list;
+  GstBuffer *buf = NULL;
+  GstFlowReturn ret;
+  SRTSOCKET sock;
+  gint poll_id;
+  guint blocksize = gst_base_src_get_blocksize (bsrc);
+
+  ret = bclass->alloc (bsrc, -1, blocksize, &buf);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  ret = GST_PUSH_SRC_GET_CLASS (src)->fill (src, buf);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (buf);
+    return ret;
+  }
+
+  gst_srt_base_src_post_stats (self);
+
+  if (!self->buffer_list || gst_buffer_get_size (buf) == 0 ||
+      !klass->get_socket || !klass->get_socket (self, &sock, &poll_id)) {
+    *outbuf = buf;
+    return GST_FLOW_OK;
+  }
+
+  list = gst_buffer_list_new ();
+  gst_buffer_list_add (list, buf);
+
+  while (gst_srt_base_src_socket_readable (sock, poll_id)) {
+    GstClockTime pts;
+    gint recv_len;
+
+    buf = NULL;
+    if (bclass->alloc (bsrc, -1, blocksize, &buf) != GST_FLOW_OK)
+      break;
+
+    recv_len = gst_srt_base_src_receive (self, sock, poll_id, buf);
+    if (recv_len <= 0) {
+      /* left for the next fill() to handle */
+      srt_clearlasterror ();
+      gst_buffer_unref (buf);
+      break;
+    }
+
+    pts = gst_clock_get_time (GST_ELEMENT_CLOCK (src)) -
+        GST_ELEMENT_CAST (src)->base_time;
+    GST_BUFFER_PTS (buf) = pts;
+    gst_buffer_resize (buf, 0, recv_len);
+    gst_buffer_list_add (list, buf);
+  }
+
+  GST_LOG_OBJECT (self, "pushing %u buffers", gst_buffer_list_length (list));
+
+  gst_base_src_submit_buffer_list (bsrc, list);
+  *outbuf = NULL;
+
+  return GST_FLOW_OK;
+}
 
 static void
 gst_srt_base_src_class_init (GstSRTBaseSrcClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
+  GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_base_src_set_property;
   gobject_class->get_property = gst_srt_base_src_get_property;
@@ -210,9 +501,85 @@ gst_srt_base_src_class_init (GstSRTBaseSrcClass * klass)
       "Crypto key length in bytes{16,24,32}", 16,
       32, SRT_DEFAULT_KEY_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSRTBaseSrc:stats-interval:
+   *
+   * The interval at which an "application/x-srt-statistics" element message
+   * with the statistics of the link is posted while data flows, one per
+   * connected peer.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_STATS_INTERVAL] =
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+      "Interval between statistics messages in milliseconds (0 = disabled)",
+      0, G_MAXUINT, SRT_DEFAULT_STATS_INTERVAL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstSRTBaseSrc:auto-latency:
+   *
+   * Derive #GstSRTBaseSrc:latency from the round trip time and the packet
+   * loss measured for #GstSRTBaseSrc:stats-interval, within
+   * #GstSRTBaseSrc:min-latency and #GstSRTBaseSrc:max-latency. SRT fixes the
+   * latency of a connection when it is established, so the new value
+   * applies to the next connection.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_AUTO_LATENCY] =
+      g_param_spec_boolean ("auto-latency", "Automatic latency",
+      "Tune the latency from the measured RTT and packet loss",
+      SRT_DEFAULT_AUTO_LATENCY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_MIN_LATENCY] =
+      g_param_spec_int ("min-latency", "Minimum latency",
+      "Lowest latency picked by auto-latency (milliseconds)", 0,
+      G_MAXINT32, SRT_DEFAULT_MIN_LATENCY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  properties[PROP_MAX_LATENCY] =
+      g_param_spec_int ("max-latency", "Maximum latency",
+      "Highest latency picked by auto-latency (milliseconds)", 0,
+      G_MAXINT32, SRT_DEFAULT_MAX_LATENCY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstSRTBaseSrc:buffer-list:
+   *
+   * Receive all the messages that are readable on each wakeup and push them
+   * downstream as one buffer list.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_BUFFER_LIST] =
+      g_param_spec_boolean ("buffer-list", "Buffer List",
+      "Push all the messages readable on each wakeup as a buffer list",
+      SRT_DEFAULT_BUFFER_LIST,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstSRTBaseSrc:messages-per-buffer:
+   *
+   * The maximum number of messages aggregated into one output buffer. Only
+   * messages that are already readable are aggregated, a buffer is never
+   * held back waiting for more.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_MESSAGES_PER_BUFFER] =
+      g_param_spec_uint ("messages-per-buffer", "Messages per buffer",
+      "Maximum number of messages aggregated into one buffer", 1,
+      G_MAXUINT16, SRT_DEFAULT_MESSAGES_PER_BUFFER,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
   gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR (gst_srt_base_src_get_caps);
+  gstbasesrc_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_srt_base_src_decide_allocation);
+
+  gstpushsrc_class->create = GST_DEBUG_FUNCPTR (gst_srt_base_src_create);
 }
 
 static void
@@ -223,6 +590,12 @@ gst_srt_base_src_init (GstSRTBaseSrc * self)
   gst_base_src_set_live (GST_BASE_SRC (self), TRUE);
   self->latency = SRT_DEFAULT_LATENCY;
   self->key_length = SRT_DEFAULT_KEY_LENGTH;
+  self->stats_interval = SRT_DEFAULT_STATS_INTERVAL;
+  self->auto_latency = SRT_DEFAULT_AUTO_LATENCY;
+  self->min_latency = SRT_DEFAULT_MIN_LATENCY;
+  self->max_latency = SRT_DEFAULT_MAX_LATENCY;
+  self->buffer_list = SRT_DEFAULT_BUFFER_LIST;
+  self->messages_per_buffer = SRT_DEFAULT_MESSAGES_PER_BUFFER;
 }
 
 static GstURIType
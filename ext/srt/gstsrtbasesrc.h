@@ -24,6 +24,8 @@
 #include <gst/gst.h>
 #include <gst/base/gstpushsrc.h>
 
+#include <srt/srt.h>
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_SRT_BASE_SRC              (gst_srt_base_src_get_type ())
@@ -46,6 +48,14 @@ struct _GstSRTBaseSrc {
   gint latency;
   gchar *passphrase;
   gint key_length;
+  gboolean buffer_list;
+  guint messages_per_buffer;
+
+  guint stats_interval;
+  gboolean auto_latency;
+  gint min_latency;
+  gint max_latency;
+  gint64 last_stats_time;
 
   /*< private >*/
   gpointer _gst_reserved[GST_PADDING];
@@ -54,12 +64,19 @@ struct _GstSRTBaseSrc {
 struct _GstSRTBaseSrcClass {
   GstPushSrcClass parent_class;
 
+  /* the connected socket and a poll id it was added to for reading, FALSE
+   * when not connected */
+  gboolean (*get_socket)        (GstSRTBaseSrc *self, SRTSOCKET *sock, gint *poll_id);
+
   gpointer _gst_reserved[GST_PADDING_LARGE];
 };
 
 GST_EXPORT
 GType gst_srt_base_src_get_type (void);
 
+gint gst_srt_base_src_receive (GstSRTBaseSrc *self, SRTSOCKET sock,
+    gint poll_id, GstBuffer *outbuf);
+
 G_END_DECLS
 
 #endif /* __GST_SRT_BASE_SRC_H__ */
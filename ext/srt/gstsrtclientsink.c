@@ -200,6 +200,10 @@ gst_srt_client_sink_send_buffer (GstSRTBaseSink * sink,
     priv->sent_headers = TRUE;
   }
 
+  if (gst_srt_base_sink_stats_due (sink))
+    gst_srt_base_sink_post_stats (sink,
+        gst_srt_base_sink_get_stats (priv->sockaddr, priv->sock));
+
   return send_buffer_internal (sink, mapinfo, GINT_TO_POINTER (priv->sock));
 }
 
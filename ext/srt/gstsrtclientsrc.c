@@ -171,7 +171,6 @@ gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
   GstSRTClientSrc *self = GST_SRT_CLIENT_SRC (src);
   GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
   GstFlowReturn ret = GST_FLOW_OK;
-  GstMapInfo info;
   SRTSOCKET ready[2];
   gint recv_len;
 
@@ -188,17 +187,8 @@ gst_srt_client_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     goto out;
   }
 
-  if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
-    GST_ELEMENT_ERROR (src, RESOURCE, READ,
-        ("Could not map the buffer for writing "), (NULL));
-    ret = GST_FLOW_ERROR;
-    goto out;
-  }
-
-  recv_len = srt_recvmsg (priv->sock, (char *) info.data,
-      gst_buffer_get_size (outbuf));
-
-  gst_buffer_unmap (outbuf, &info);
+  recv_len = gst_srt_base_src_receive (GST_SRT_BASE_SRC (src), priv->sock,
+      priv->poll_id, outbuf);
 
   if (recv_len == SRT_ERROR) {
     GST_ELEMENT_ERROR (src, RESOURCE, READ,
@@ -229,6 +219,21 @@ out:
   return ret;
 }
 
+static gboolean
+gst_srt_client_src_get_socket (GstSRTBaseSrc * src, SRTSOCKET * sock,
+    gint * poll_id)
+{
+  GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (src);
+
+  if (priv->sock == SRT_INVALID_SOCK)
+    return FALSE;
+
+  *sock = priv->sock;
+  *poll_id = priv->poll_id;
+
+  return TRUE;
+}
+
 static gboolean
 gst_srt_client_src_start (GstBaseSrc * src)
 {
@@ -277,6 +282,7 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
   GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+  GstSRTBaseSrcClass *gstsrtbasesrc_class = GST_SRT_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_client_src_set_property;
   gobject_class->get_property = gst_srt_client_src_get_property;
@@ -321,6 +327,9 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_srt_client_src_stop);
 
   gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_client_src_fill);
+
+  gstsrtbasesrc_class->get_socket =
+      GST_DEBUG_FUNCPTR (gst_srt_client_src_get_socket);
 }
 
 static void
@@ -45,6 +45,12 @@
 #include <gio/gio.h>
 
 #define SRT_DEFAULT_POLL_TIMEOUT -1
+#define SRT_DEFAULT_CLIENT_QUEUE_SIZE 1024
+#define SRT_DEFAULT_CLIENT_OVERFLOW GST_SRT_SERVER_SINK_OVERFLOW_DROP
+
+/* how long the sender thread waits for congested clients to become writable
+ * before it looks at the queues of the other clients again */
+#define SRT_SENDER_POLL_TIMEOUT 5
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -67,7 +73,18 @@ struct _GstSRTServerSinkPrivate
   GSource *server_source;
   GThread *thread;
 
+  /* the clients and their send queues, protected by clients_lock which is
+   * never held during I/O. The sender thread drains the queues and waits on
+   * sender_poll_id for the clients whose SRT send buffer is full. */
+  GMutex clients_lock;
+  GCond clients_cond;
   GList *clients;
+  gint sender_poll_id;
+  GThread *sender_thread;
+  gboolean sender_running;
+
+  guint client_queue_size;
+  GstSRTServerSinkOverflow client_overflow;
 };
 
 #define GST_SRT_SERVER_SINK_GET_PRIVATE(obj)  \
@@ -77,6 +94,8 @@ enum
 {
   PROP_POLL_TIMEOUT = 1,
   PROP_STATS,
+  PROP_CLIENT_QUEUE_SIZE,
+  PROP_CLIENT_OVERFLOW,
   /*< private > */
   PROP_LAST
 };
@@ -99,35 +118,99 @@ G_DEFINE_TYPE_WITH_CODE (GstSRTServerSink, gst_srt_server_sink,
     GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, "srtserversink", 0,
         "SRT Server Sink"));
 
+#define GST_TYPE_SRT_SERVER_SINK_OVERFLOW (gst_srt_server_sink_overflow_get_type ())
+static GType
+gst_srt_server_sink_overflow_get_type (void)
+{
+  static GType overflow_type = 0;
+  static const GEnumValue overflow[] = {
+    {GST_SRT_SERVER_SINK_OVERFLOW_DROP, "Drop the oldest queued packet",
+        "drop"},
+    {GST_SRT_SERVER_SINK_OVERFLOW_DISCONNECT, "Disconnect the client",
+        "disconnect"},
+    {0, NULL, NULL},
+  };
+
+  if (!overflow_type) {
+    overflow_type =
+        g_enum_register_static ("GstSRTServerSinkOverflow", overflow);
+  }
+  return overflow_type;
+}
+
+/* Clients are shared between the streaming thread, which queues, and the
+ * sender thread, which sends, so that a client can be removed while a send
+ * to it is in progress. */
 typedef struct
 {
+  gint refcount;
+
   int sock;
   GSocketAddress *sockaddr;
   gboolean sent_headers;
+
+  /* GBytes of the queued messages, protected by clients_lock */
+  GQueue queue;
+  /* the SRT send buffer is full and the socket is in sender_poll_id */
+  gboolean congested;
+  gboolean removed;
+  guint64 dropped;
 } SRTClient;
 
 static SRTClient *
 srt_client_new (void)
 {
   SRTClient *client = g_new0 (SRTClient, 1);
+  client->refcount = 1;
   client->sock = SRT_INVALID_SOCK;
+  g_queue_init (&client->queue);
+  return client;
+}
+
+static SRTClient *
+srt_client_ref (SRTClient * client)
+{
+  g_atomic_int_inc (&client->refcount);
   return client;
 }
 
 static void
-srt_client_free (SRTClient * client)
+srt_client_unref (SRTClient * client)
 {
   g_return_if_fail (client != NULL);
 
+  if (!g_atomic_int_dec_and_test (&client->refcount))
+    return;
+
   g_clear_object (&client->sockaddr);
 
   if (client->sock != SRT_INVALID_SOCK) {
     srt_close (client->sock);
   }
 
+  g_queue_clear_full (&client->queue, (GDestroyNotify) g_bytes_unref);
+
   g_free (client);
 }
 
+/* call with clients_lock, the caller emits client-removed and drops the
+ * reference of the list */
+static void
+srt_client_remove_unlocked (GstSRTServerSink * self, SRTClient * client)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  priv->clients = g_list_remove (priv->clients, client);
+  client->removed = TRUE;
+
+  if (client->congested) {
+    srt_epoll_remove_usock (priv->sender_poll_id, client->sock);
+    client->congested = FALSE;
+  }
+
+  g_queue_clear_full (&client->queue, (GDestroyNotify) g_bytes_unref);
+}
+
 static void
 srt_emit_client_removed (SRTClient * client, gpointer user_data)
 {
@@ -153,19 +236,30 @@ gst_srt_server_sink_get_property (GObject * object,
     {
       GList *item;
 
-      GST_OBJECT_LOCK (self);
+      g_mutex_lock (&priv->clients_lock);
       for (item = priv->clients; item; item = item->next) {
         SRTClient *client = item->data;
+        GstStructure *stats;
         GValue tmp = G_VALUE_INIT;
 
+        stats = gst_srt_base_sink_get_stats (client->sockaddr, client->sock);
+        gst_structure_set (stats,
+            "packets-queued", G_TYPE_UINT, client->queue.length,
+            "packets-queue-dropped", G_TYPE_UINT64, client->dropped, NULL);
+
         g_value_init (&tmp, GST_TYPE_STRUCTURE);
-        g_value_take_boxed (&tmp, gst_srt_base_sink_get_stats (client->sockaddr,
-                client->sock));
+        g_value_take_boxed (&tmp, stats);
         gst_value_array_append_and_take_value (value, &tmp);
       }
-      GST_OBJECT_UNLOCK (self);
+      g_mutex_unlock (&priv->clients_lock);
       break;
     }
+    case PROP_CLIENT_QUEUE_SIZE:
+      g_value_set_uint (value, priv->client_queue_size);
+      break;
+    case PROP_CLIENT_OVERFLOW:
+      g_value_set_enum (value, priv->client_overflow);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -183,12 +277,34 @@ gst_srt_server_sink_set_property (GObject * object,
     case PROP_POLL_TIMEOUT:
       priv->poll_timeout = g_value_get_int (value);
       break;
+    case PROP_CLIENT_QUEUE_SIZE:
+      g_mutex_lock (&priv->clients_lock);
+      priv->client_queue_size = g_value_get_uint (value);
+      g_mutex_unlock (&priv->clients_lock);
+      break;
+    case PROP_CLIENT_OVERFLOW:
+      g_mutex_lock (&priv->clients_lock);
+      priv->client_overflow = g_value_get_enum (value);
+      g_mutex_unlock (&priv->clients_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_srt_server_sink_finalize (GObject * object)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (object);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  g_mutex_clear (&priv->clients_lock);
+  g_cond_clear (&priv->clients_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 idle_listen_callback (gpointer data)
 {
@@ -220,6 +336,10 @@ idle_listen_callback (gpointer data)
     }
   }
 
+  /* accepted sockets inherit the latency, which auto-latency may change */
+  srt_setsockopt (priv->sock, 0, SRTO_TSBPDDELAY,
+      &GST_SRT_BASE_SINK (self)->latency, sizeof (int));
+
   client = srt_client_new ();
   client->sock = srt_accept (priv->sock, &sa, &sa_len);
 
@@ -227,16 +347,16 @@ idle_listen_callback (gpointer data)
     GST_WARNING_OBJECT (self, "detected invalid SRT client socket (reason: %s)",
         srt_getlasterror_str ());
     srt_clearlasterror ();
-    srt_client_free (client);
+    srt_client_unref (client);
     ret = FALSE;
     goto out;
   }
 
   client->sockaddr = g_socket_address_new_from_native (&sa, sa_len);
 
-  GST_OBJECT_LOCK (self);
+  g_mutex_lock (&priv->clients_lock);
   priv->clients = g_list_append (priv->clients, client);
-  GST_OBJECT_UNLOCK (self);
+  g_mutex_unlock (&priv->clients_lock);
 
   g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0, client->sock,
       client->sockaddr);
@@ -257,6 +377,146 @@ thread_func (gpointer data)
   return NULL;
 }
 
+/* Sends the queued messages of @client until its queue is empty or its SRT
+ * send buffer is full. Returns FALSE if the client failed. */
+static gboolean
+srt_client_drain (GstSRTServerSink * self, SRTClient * client)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GQueue pending = G_QUEUE_INIT;
+  GBytes *bytes;
+
+  g_mutex_lock (&priv->clients_lock);
+  if (client->removed || client->congested) {
+    g_mutex_unlock (&priv->clients_lock);
+    return TRUE;
+  }
+  pending = client->queue;
+  g_queue_init (&client->queue);
+  g_mutex_unlock (&priv->clients_lock);
+
+  while ((bytes = g_queue_peek_head (&pending))) {
+    gsize size;
+    gconstpointer data = g_bytes_get_data (bytes, &size);
+
+    if (srt_sendmsg2 (client->sock, (char *) data, size, 0) == SRT_ERROR) {
+      if (srt_getlasterror (NULL) == SRT_EASYNCSND) {
+        srt_clearlasterror ();
+        break;
+      }
+
+      GST_WARNING_OBJECT (self, "%s", srt_getlasterror_str ());
+      g_queue_clear_full (&pending, (GDestroyNotify) g_bytes_unref);
+      return FALSE;
+    }
+
+    g_bytes_unref (g_queue_pop_head (&pending));
+  }
+
+  if (g_queue_is_empty (&pending))
+    return TRUE;
+
+  /* put back what could not be sent in front of what got queued meanwhile,
+   * and wait for the socket to become writable again */
+  g_mutex_lock (&priv->clients_lock);
+  if (!client->removed) {
+    while ((bytes = g_queue_pop_tail (&pending)))
+      g_queue_push_head (&client->queue, bytes);
+    client->congested = TRUE;
+    srt_epoll_add_usock (priv->sender_poll_id, client->sock, &(int) {
+        SRT_EPOLL_OUT | SRT_EPOLL_ERR});
+  }
+  g_mutex_unlock (&priv->clients_lock);
+
+  g_queue_clear_full (&pending, (GDestroyNotify) g_bytes_unref);
+
+  return TRUE;
+}
+
+static gpointer
+sender_thread_func (gpointer data)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (data);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+
+  g_mutex_lock (&priv->clients_lock);
+  while (priv->sender_running) {
+    GList *ready = NULL, *failed = NULL, *item;
+    gboolean have_ready, have_congested = FALSE;
+
+    for (item = priv->clients; item; item = item->next) {
+      SRTClient *client = item->data;
+
+      if (client->congested)
+        have_congested = TRUE;
+      else if (!g_queue_is_empty (&client->queue))
+        ready = g_list_prepend (ready, srt_client_ref (client));
+    }
+
+    have_ready = ready != NULL;
+    if (!have_ready && !have_congested) {
+      g_cond_wait (&priv->clients_cond, &priv->clients_lock);
+      continue;
+    }
+    g_mutex_unlock (&priv->clients_lock);
+
+    for (item = ready; item; item = item->next) {
+      if (!srt_client_drain (self, item->data))
+        failed = g_list_prepend (failed, srt_client_ref (item->data));
+    }
+    g_list_free_full (ready, (GDestroyNotify) srt_client_unref);
+
+    if (have_congested) {
+      SRTSOCKET wready[64];
+      int wready_len = G_N_ELEMENTS (wready);
+      int i;
+
+      if (srt_epoll_wait (priv->sender_poll_id, 0, 0, wready, &wready_len,
+              have_ready ? 0 : SRT_SENDER_POLL_TIMEOUT, 0, 0, 0, 0) == -1) {
+        wready_len = 0;
+        srt_clearlasterror ();
+      }
+
+      g_mutex_lock (&priv->clients_lock);
+      for (i = 0; i < wready_len; i++) {
+        for (item = priv->clients; item; item = item->next) {
+          SRTClient *client = item->data;
+
+          if (client->sock == wready[i] && client->congested) {
+            srt_epoll_remove_usock (priv->sender_poll_id, client->sock);
+            client->congested = FALSE;
+            break;
+          }
+        }
+      }
+      g_mutex_unlock (&priv->clients_lock);
+    }
+
+    for (item = failed; item; item = item->next) {
+      SRTClient *client = item->data;
+      gboolean removed;
+
+      g_mutex_lock (&priv->clients_lock);
+      removed = client->removed;
+      if (!removed)
+        srt_client_remove_unlocked (self, client);
+      g_mutex_unlock (&priv->clients_lock);
+
+      if (!removed) {
+        g_signal_emit (self, signals[SIG_CLIENT_REMOVED], 0, client->sock,
+            client->sockaddr);
+        srt_client_unref (client);
+      }
+    }
+    g_list_free_full (failed, (GDestroyNotify) srt_client_unref);
+
+    g_mutex_lock (&priv->clients_lock);
+  }
+  g_mutex_unlock (&priv->clients_lock);
+
+  return NULL;
+}
+
 static gboolean
 gst_srt_server_sink_start (GstBaseSink * sink)
 {
@@ -351,6 +611,24 @@ gst_srt_server_sink_start (GstBaseSink * sink)
     goto failed;
   }
 
+  priv->sender_poll_id = srt_epoll_create ();
+  if (priv->sender_poll_id == -1) {
+    GST_WARNING_OBJECT (self,
+        "failed to create sender poll id (reason: %s)",
+        srt_getlasterror_str ());
+    goto failed;
+  }
+
+  priv->sender_running = TRUE;
+  priv->sender_thread = g_thread_try_new ("srtserversink-send",
+      sender_thread_func, self, &error);
+  if (error != NULL) {
+    GST_WARNING_OBJECT (self, "failed to create sender thread (reason: %s)",
+        error->message);
+    priv->sender_running = FALSE;
+    goto failed;
+  }
+
   priv->context = g_main_context_new ();
 
   priv->server_source = g_idle_source_new ();
@@ -374,6 +652,11 @@ gst_srt_server_sink_start (GstBaseSink * sink)
   return ret;
 
 failed:
+  if (priv->sender_poll_id != SRT_ERROR) {
+    srt_epoll_release (priv->sender_poll_id);
+    priv->sender_poll_id = SRT_ERROR;
+  }
+
   if (priv->poll_id != SRT_ERROR) {
     srt_epoll_release (priv->poll_id);
     priv->poll_id = SRT_ERROR;
@@ -392,54 +675,83 @@ failed:
 }
 
 static gboolean
-send_buffer_internal (GstSRTBaseSink * sink,
+queue_buffer_internal (GstSRTBaseSink * sink,
     const GstMapInfo * mapinfo, gpointer user_data)
 {
   SRTClient *client = user_data;
 
-  if (srt_sendmsg2 (client->sock, (char *) mapinfo->data, mapinfo->size,
-          0) == SRT_ERROR) {
-    GST_WARNING_OBJECT (sink, "%s", srt_getlasterror_str ());
-    return FALSE;
-  }
+  g_queue_push_tail (&client->queue, g_bytes_new (mapinfo->data,
+          mapinfo->size));
 
   return TRUE;
 }
 
+/* Only queues the message for each client, the sender thread sends it. A
+ * client whose queue is full loses its oldest message or is disconnected,
+ * depending on client-overflow. */
 static gboolean
 gst_srt_server_sink_send_buffer (GstSRTBaseSink * sink,
     const GstMapInfo * mapinfo)
 {
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
-  GList *clients = priv->clients;
+  GList *clients, *overflowed = NULL, *stats = NULL;
+  gboolean stats_due = gst_srt_base_sink_stats_due (sink);
+  GBytes *bytes;
 
-  GST_OBJECT_LOCK (sink);
+  /* a single copy shared by all the clients */
+  bytes = g_bytes_new (mapinfo->data, mapinfo->size);
+
+  g_mutex_lock (&priv->clients_lock);
+  clients = priv->clients;
   while (clients != NULL) {
     SRTClient *client = clients->data;
     clients = clients->next;
 
     if (!client->sent_headers) {
-      if (!gst_srt_base_sink_send_headers (sink, send_buffer_internal, client))
-        goto err;
-
+      gst_srt_base_sink_send_headers (sink, queue_buffer_internal, client);
       client->sent_headers = TRUE;
     }
 
-    if (!send_buffer_internal (sink, mapinfo, client))
-      goto err;
+    if (priv->client_queue_size > 0 &&
+        client->queue.length >= priv->client_queue_size) {
+      if (priv->client_overflow == GST_SRT_SERVER_SINK_OVERFLOW_DISCONNECT) {
+        GST_WARNING_OBJECT (self, "send queue of client %d is full, "
+            "disconnecting", client->sock);
+        srt_client_remove_unlocked (self, client);
+        overflowed = g_list_prepend (overflowed, client);
+        continue;
+      }
+
+      g_bytes_unref (g_queue_pop_head (&client->queue));
+      client->dropped++;
+      GST_LOG_OBJECT (self, "send queue of client %d is full, dropped the "
+          "oldest message", client->sock);
+    }
+
+    g_queue_push_tail (&client->queue, g_bytes_ref (bytes));
+
+    if (stats_due)
+      stats = g_list_prepend (stats,
+          gst_srt_base_sink_get_stats (client->sockaddr, client->sock));
+  }
+  g_cond_signal (&priv->clients_cond);
+  g_mutex_unlock (&priv->clients_lock);
+
+  g_bytes_unref (bytes);
 
-    continue;
+  /* posted without the clients lock, the bus handlers may read stats */
+  for (clients = stats; clients; clients = clients->next)
+    gst_srt_base_sink_post_stats (sink, clients->data);
+  g_list_free (stats);
+
+  for (clients = overflowed; clients; clients = clients->next) {
+    SRTClient *client = clients->data;
 
-  err:
-    priv->clients = g_list_remove (priv->clients, client);
-    GST_OBJECT_UNLOCK (sink);
     g_signal_emit (self, signals[SIG_CLIENT_REMOVED], 0, client->sock,
         client->sockaddr);
-    srt_client_free (client);
-    GST_OBJECT_LOCK (sink);
   }
-  GST_OBJECT_UNLOCK (sink);
+  g_list_free_full (overflowed, (GDestroyNotify) srt_client_unref);
 
   return TRUE;
 }
@@ -451,15 +763,30 @@ gst_srt_server_sink_stop (GstBaseSink * sink)
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
   GList *clients;
 
+  if (priv->sender_thread) {
+    g_mutex_lock (&priv->clients_lock);
+    priv->sender_running = FALSE;
+    g_cond_signal (&priv->clients_cond);
+    g_mutex_unlock (&priv->clients_lock);
+
+    g_thread_join (priv->sender_thread);
+    priv->sender_thread = NULL;
+  }
+
   GST_DEBUG_OBJECT (self, "closing client sockets");
 
-  GST_OBJECT_LOCK (sink);
+  g_mutex_lock (&priv->clients_lock);
   clients = priv->clients;
   priv->clients = NULL;
-  GST_OBJECT_UNLOCK (sink);
+  g_mutex_unlock (&priv->clients_lock);
 
   g_list_foreach (clients, (GFunc) srt_emit_client_removed, self);
-  g_list_free_full (clients, (GDestroyNotify) srt_client_free);
+  g_list_free_full (clients, (GDestroyNotify) srt_client_unref);
+
+  if (priv->sender_poll_id != SRT_ERROR) {
+    srt_epoll_release (priv->sender_poll_id);
+    priv->sender_poll_id = SRT_ERROR;
+  }
 
   GST_DEBUG_OBJECT (self, "closing SRT connection");
   srt_epoll_remove_usock (priv->poll_id, priv->sock);
@@ -515,6 +842,7 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
 
   gobject_class->set_property = gst_srt_server_sink_set_property;
   gobject_class->get_property = gst_srt_server_sink_get_property;
+  gobject_class->finalize = gst_srt_server_sink_finalize;
 
   properties[PROP_POLL_TIMEOUT] =
       g_param_spec_int ("poll-timeout", "Poll Timeout",
@@ -529,6 +857,34 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS),
       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSRTServerSink:client-queue-size:
+   *
+   * The number of messages queued for each client before client-overflow
+   * applies. Every client is sent to from its own queue so that a slow
+   * client does not hold back the others or the pipeline.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_CLIENT_QUEUE_SIZE] =
+      g_param_spec_uint ("client-queue-size", "Client queue size",
+      "Maximum number of messages queued for each client (0 = unlimited)",
+      0, G_MAXUINT, SRT_DEFAULT_CLIENT_QUEUE_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GstSRTServerSink:client-overflow:
+   *
+   * What to do with a client whose queue is full.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_CLIENT_OVERFLOW] =
+      g_param_spec_enum ("client-overflow", "Client overflow",
+      "What to do when the queue of a client is full",
+      GST_TYPE_SRT_SERVER_SINK_OVERFLOW, SRT_DEFAULT_CLIENT_OVERFLOW,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
   /**
@@ -582,4 +938,10 @@ gst_srt_server_sink_init (GstSRTServerSink * self)
 {
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
   priv->poll_timeout = SRT_DEFAULT_POLL_TIMEOUT;
+  priv->poll_id = SRT_ERROR;
+  priv->sender_poll_id = SRT_ERROR;
+  priv->client_queue_size = SRT_DEFAULT_CLIENT_QUEUE_SIZE;
+  priv->client_overflow = SRT_DEFAULT_CLIENT_OVERFLOW;
+  g_mutex_init (&priv->clients_lock);
+  g_cond_init (&priv->clients_cond);
 }
@@ -34,6 +34,18 @@ G_BEGIN_DECLS
 #define GST_SRT_SERVER_SINK_CAST(obj)         ((GstSRTServerSink*)(obj))
 #define GST_SRT_SERVER_SINK_CLASS_CAST(klass) ((GstSRTServerSinkClass*)(klass))
 
+/**
+ * GstSRTServerSinkOverflow:
+ * @GST_SRT_SERVER_SINK_OVERFLOW_DROP: drop the oldest queued message
+ * @GST_SRT_SERVER_SINK_OVERFLOW_DISCONNECT: disconnect the client
+ *
+ * What srtserversink does with a client whose send queue is full.
+ */
+typedef enum {
+  GST_SRT_SERVER_SINK_OVERFLOW_DROP,
+  GST_SRT_SERVER_SINK_OVERFLOW_DISCONNECT,
+} GstSRTServerSinkOverflow;
+
 typedef struct _GstSRTServerSink GstSRTServerSink;
 typedef struct _GstSRTServerSinkClass GstSRTServerSinkClass;
 typedef struct _GstSRTServerSinkPrivate GstSRTServerSinkPrivate;
@@ -154,7 +154,6 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
   GstSRTServerSrc *self = GST_SRT_SERVER_SRC (src);
   GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
   GstFlowReturn ret = GST_FLOW_OK;
-  GstMapInfo info;
   SRTSOCKET ready[2];
   gint recv_len;
   struct sockaddr client_sa;
@@ -188,6 +187,10 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
       continue;
     }
 
+    /* accepted sockets inherit the latency, which auto-latency may change */
+    srt_setsockopt (priv->sock, 0, SRTO_TSBPDDELAY,
+        &GST_SRT_BASE_SRC (self)->latency, sizeof (int));
+
     priv->client_sock =
         srt_accept (priv->sock, &client_sa, (int *) &client_sa_len);
 
@@ -199,6 +202,9 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
       srt_clearlasterror ();
     } else {
       priv->has_client = TRUE;
+      /* for polling whether more messages are readable */
+      srt_epoll_add_usock (priv->poll_id, priv->client_sock, &(int) {
+          SRT_EPOLL_IN | SRT_EPOLL_ERR});
       g_clear_object (&priv->client_sockaddr);
       priv->client_sockaddr = g_socket_address_new_from_native (&client_sa,
           client_sa_len);
@@ -209,17 +215,8 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
 
   GST_DEBUG_OBJECT (self, "filling buffer");
 
-  if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
-    GST_ELEMENT_ERROR (src, RESOURCE, WRITE,
-        ("Could not map the output stream"), (NULL));
-    ret = GST_FLOW_ERROR;
-    goto out;
-  }
-
-  recv_len = srt_recvmsg (priv->client_sock, (char *) info.data,
-      gst_buffer_get_size (outbuf));
-
-  gst_buffer_unmap (outbuf, &info);
+  recv_len = gst_srt_base_src_receive (GST_SRT_BASE_SRC (src),
+      priv->client_sock, priv->poll_id, outbuf);
 
   if (recv_len == SRT_ERROR) {
     GST_WARNING_OBJECT (self, "%s", srt_getlasterror_str ());
@@ -227,6 +224,7 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
     g_signal_emit (self, signals[SIG_CLIENT_CLOSED], 0,
         priv->client_sock, priv->client_sockaddr);
 
+    srt_epoll_remove_usock (priv->poll_id, priv->client_sock);
     srt_close (priv->client_sock);
     priv->client_sock = SRT_INVALID_SOCK;
     g_clear_object (&priv->client_sockaddr);
@@ -258,6 +256,21 @@ out:
   return ret;
 }
 
+static gboolean
+gst_srt_server_src_get_socket (GstSRTBaseSrc * src, SRTSOCKET * sock,
+    gint * poll_id)
+{
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (src);
+
+  if (!priv->has_client)
+    return FALSE;
+
+  *sock = priv->client_sock;
+  *poll_id = priv->poll_id;
+
+  return TRUE;
+}
+
 static gboolean
 gst_srt_server_src_start (GstBaseSrc * src)
 {
@@ -382,6 +395,8 @@ gst_srt_server_src_stop (GstBaseSrc * src)
   if (priv->client_sock != SRT_INVALID_SOCK) {
     g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0,
         priv->client_sock, priv->client_sockaddr);
+    if (priv->poll_id != SRT_ERROR)
+      srt_epoll_remove_usock (priv->poll_id, priv->client_sock);
     srt_close (priv->client_sock);
     g_clear_object (&priv->client_sockaddr);
     priv->client_sock = SRT_INVALID_SOCK;
@@ -434,6 +449,7 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
   GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+  GstSRTBaseSrcClass *gstsrtbasesrc_class = GST_SRT_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_server_src_set_property;
   gobject_class->get_property = gst_srt_server_src_get_property;
@@ -496,6 +512,9 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
       GST_DEBUG_FUNCPTR (gst_srt_server_src_unlock_stop);
 
   gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_server_src_fill);
+
+  gstsrtbasesrc_class->get_socket =
+      GST_DEBUG_FUNCPTR (gst_srt_server_src_get_socket);
 }
 
 static void
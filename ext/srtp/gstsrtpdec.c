@@ -200,6 +200,10 @@ static GstFlowReturn gst_srtp_dec_chain_rtp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
 static GstFlowReturn gst_srtp_dec_chain_rtcp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
+static GstFlowReturn gst_srtp_dec_chain_list_rtp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
+static GstFlowReturn gst_srtp_dec_chain_list_rtcp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
 
 static GstStateChangeReturn gst_srtp_dec_change_state (GstElement * element,
     GstStateChange transition);
@@ -363,6 +367,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtp));
   gst_pad_set_chain_function (filter->rtp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtp));
+  gst_pad_set_chain_list_function (filter->rtp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtp));
 
   filter->rtp_srcpad =
       gst_pad_new_from_static_template (&rtp_src_template, "rtp_src");
@@ -386,6 +392,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtcp));
   gst_pad_set_chain_function (filter->rtcp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtcp));
+  gst_pad_set_chain_list_function (filter->rtcp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtcp));
 
   filter->rtcp_srcpad =
       gst_pad_new_from_static_template (&rtcp_src_template, "rtcp_src");
@@ -1139,19 +1147,20 @@ gst_srtp_dec_push_early_events (GstSrtpDec * filter, GstPad * pad,
  * This function should be called while holding the filter lock
  */
 static gboolean
-gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
-    gboolean is_rtcp, guint32 ssrc)
+gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad,
+    GstBuffer ** buffer, gboolean is_rtcp, guint32 ssrc)
 {
+  GstBuffer *buf;
   GstMapInfo map;
   srtp_err_status_t err;
   gint size;
 
   GST_LOG_OBJECT (pad, "Received %s buffer of size %" G_GSIZE_FORMAT
-      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (buf),
+      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (*buffer),
       ssrc);
 
-  /* Change buffer to remove protection */
-  buf = gst_buffer_make_writable (buf);
+  /* Change buffer to remove protection, in place if it's writable */
+  buf = *buffer = gst_buffer_make_writable (*buffer);
 
   gst_buffer_map (buf, &map, GST_MAP_READWRITE);
   size = map.size;
@@ -1268,7 +1277,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     goto push_out;
   }
 
-  if (!gst_srtp_dec_decode_buffer (filter, pad, buf, is_rtcp, ssrc)) {
+  if (!gst_srtp_dec_decode_buffer (filter, pad, &buf, is_rtcp, ssrc)) {
     GST_OBJECT_UNLOCK (filter);
     goto drop_buffer;
   }
@@ -1316,6 +1325,117 @@ gst_srtp_dec_chain_rtcp (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return gst_srtp_dec_chain (pad, parent, buf, TRUE);
 }
 
+typedef struct
+{
+  GstSrtpDec *filter;
+  GstPad *pad;
+  gboolean is_rtcp;
+  GstBufferList *rtp_list;
+  GstBufferList *rtcp_list;
+} DecodeBufferItData;
+
+/* called with the object lock held, moves the decoded buffers to the output
+ * lists */
+static gboolean
+decode_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+{
+  DecodeBufferItData *data = user_data;
+  GstSrtpDec *filter = data->filter;
+  GstSrtpDecSsrcStream *stream;
+  gboolean is_rtcp = data->is_rtcp;
+  GstBuffer *buf = *buffer;
+  guint32 ssrc = 0;
+
+  *buffer = NULL;
+
+  if (!(stream = validate_buffer (filter, buf, &ssrc, &is_rtcp))) {
+    GST_WARNING_OBJECT (filter, "Invalid buffer, dropping");
+    gst_buffer_unref (buf);
+    return TRUE;
+  }
+
+  if (STREAM_HAS_CRYPTO (stream)) {
+    if (!gst_srtp_dec_decode_buffer (filter, data->pad, &buf, is_rtcp, ssrc)) {
+      gst_buffer_unref (buf);
+      return TRUE;
+    }
+
+    /* If all is well, we may have reached soft limit */
+    if (gst_srtp_get_soft_limit_reached ()) {
+      GST_OBJECT_UNLOCK (filter);
+      request_key_with_signal (filter, ssrc, SIGNAL_SOFT_LIMIT);
+      GST_OBJECT_LOCK (filter);
+    }
+  }
+
+  if (is_rtcp) {
+    if (!data->rtcp_list)
+      data->rtcp_list = gst_buffer_list_new ();
+    gst_buffer_list_add (data->rtcp_list, buf);
+  } else {
+    if (!data->rtp_list)
+      data->rtp_list = gst_buffer_list_new ();
+    gst_buffer_list_add (data->rtp_list, buf);
+  }
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list, gboolean is_rtcp)
+{
+  GstSrtpDec *filter = GST_SRTP_DEC (parent);
+  DecodeBufferItData data = { filter, pad, is_rtcp, NULL, NULL };
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
+      gst_buffer_list_length (buf_list));
+
+  buf_list = gst_buffer_list_make_writable (buf_list);
+
+  GST_OBJECT_LOCK (filter);
+  gst_buffer_list_foreach (buf_list, decode_buffer_it, &data);
+  GST_OBJECT_UNLOCK (filter);
+
+  gst_buffer_list_unref (buf_list);
+
+  /* with rtcp-mux, RTCP packets can arrive on the RTP pad too */
+  if (data.rtcp_list) {
+    if (!filter->rtcp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
+          filter->rtp_srcpad, TRUE);
+    ret = gst_pad_push_list (filter->rtcp_srcpad, data.rtcp_list);
+  }
+
+  if (data.rtp_list) {
+    GstFlowReturn rtp_ret;
+
+    if (!filter->rtp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
+          filter->rtcp_srcpad, FALSE);
+    rtp_ret = gst_pad_push_list (filter->rtp_srcpad, data.rtp_list);
+    if (!is_rtcp || ret == GST_FLOW_OK)
+      ret = rtp_ret;
+  }
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, FALSE);
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtcp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, TRUE);
+}
+
 static GstStateChangeReturn
 gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
 {
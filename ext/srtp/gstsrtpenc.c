@@ -128,6 +128,11 @@ GST_DEBUG_CATEGORY_STATIC (gst_srtp_enc_debug);
 #define DEFAULT_REPLAY_WINDOW_SIZE 128
 #define DEFAULT_ALLOW_REPEAT_TX FALSE
 
+/* room needed after the payload for the SRTP trailer */
+#define TRAILER_SPACE (SRTP_MAX_TRAILER_LEN + 10)
+/* packets up to the usual MTU are copied into pooled buffers */
+#define POOL_BUFFER_SIZE (1500 + TRAILER_SPACE)
+
 #define HAS_CRYPTO(filter) (filter->rtp_cipher != GST_SRTP_CIPHER_NULL || \
       filter->rtcp_cipher != GST_SRTP_CIPHER_NULL ||                      \
       filter->rtp_auth != GST_SRTP_AUTH_NULL ||                           \
@@ -159,8 +164,8 @@ typedef struct ProcessBufferItData
 {
   GstSrtpEnc *filter;
   GstPad *pad;
-  GstBufferList *out_list;
   gboolean is_rtcp;
+  srtp_err_status_t err;
 } ProcessBufferItData;
 
 /* the capabilities of the inputs and outputs.
@@ -602,6 +607,10 @@ gst_srtp_enc_dispose (GObject * object)
     g_hash_table_unref (filter->ssrcs_set);
   filter->ssrcs_set = NULL;
 
+  if (filter->pool)
+    gst_object_unref (filter->pool);
+  filter->pool = NULL;
+
   G_OBJECT_CLASS (gst_srtp_enc_parent_class)->dispose (object);
 }
 
@@ -1029,64 +1038,110 @@ gst_srtp_enc_check_set_caps (GstSrtpEnc * filter, GstPad * pad,
   return GST_FLOW_OK;
 }
 
+/* Returns a writable buffer holding the packet of @buf followed by room for
+ * the SRTP trailer. That's @buf itself if it already has the room, otherwise
+ * the packet is copied into a pooled buffer. Takes ownership of @buf.
+ */
 static GstBuffer *
-gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
-    GstBuffer * buf, gboolean is_rtcp)
+gst_srtp_enc_prepare_buffer (GstSrtpEnc * filter, GstBuffer * buf)
 {
-  gint size_max, size;
+  gsize size, offset, maxsize;
   GstBuffer *bufout = NULL;
   GstMapInfo mapout;
-  srtp_err_status_t err;
 
-  /* Create a bigger buffer to add protection */
-  size = gst_buffer_get_size (buf);
-  size_max = size + SRTP_MAX_TRAILER_LEN + 10;
-  bufout = gst_buffer_new_allocate (NULL, size_max, NULL);
+  size = gst_buffer_get_sizes (buf, &offset, &maxsize);
 
-  gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+  if (gst_buffer_is_writable (buf) && gst_buffer_n_memory (buf) == 1
+      && gst_buffer_is_all_memory_writable (buf)
+      && maxsize - offset >= size + TRAILER_SPACE) {
+    gst_buffer_set_size (buf, size + TRAILER_SPACE);
+    return buf;
+  }
 
+  if (!filter->pool || size + TRAILER_SPACE > POOL_BUFFER_SIZE
+      || gst_buffer_pool_acquire_buffer (filter->pool, &bufout,
+          NULL) != GST_FLOW_OK)
+    bufout = gst_buffer_new_allocate (NULL, size + TRAILER_SPACE, NULL);
+  else
+    gst_buffer_set_size (bufout, size + TRAILER_SPACE);
+
+  gst_buffer_map (bufout, &mapout, GST_MAP_WRITE);
   gst_buffer_extract (buf, 0, mapout.data, size);
+  gst_buffer_unmap (bufout, &mapout);
 
-  GST_OBJECT_LOCK (filter);
+  gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_unref (buf);
 
-  gst_srtp_init_event_reporter ();
+  return bufout;
+}
 
-  if (is_rtcp)
-    err = srtp_protect_rtcp (filter->session, mapout.data, &size);
-  else
-    err = srtp_protect (filter->session, mapout.data, &size);
+/* Protects a buffer returned by gst_srtp_enc_prepare_buffer() in place.
+ * Must be called with the object lock held.
+ */
+static srtp_err_status_t
+gst_srtp_enc_protect_buffer (GstSrtpEnc * filter, GstBuffer * buf,
+    gboolean is_rtcp)
+{
+  GstMapInfo map;
+  srtp_err_status_t err;
+  gint size;
 
-  GST_OBJECT_UNLOCK (filter);
+  gst_buffer_map (buf, &map, GST_MAP_READWRITE);
+  size = map.size - TRAILER_SPACE;
 
-  gst_buffer_unmap (bufout, &mapout);
+  if (is_rtcp)
+    err = srtp_protect_rtcp (filter->session, map.data, &size);
+  else
+    err = srtp_protect (filter->session, map.data, &size);
 
-  if (err == srtp_err_status_ok) {
-    /* Buffer protected */
-    gst_buffer_set_size (bufout, size);
-    gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_unmap (buf, &map);
 
-    GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d",
-        is_rtcp ? "RTCP" : "RTP", size);
+  if (err == srtp_err_status_ok)
+    gst_buffer_set_size (buf, size);
 
-  } else if (err == srtp_err_status_key_expired) {
+  return err;
+}
 
+static void
+gst_srtp_enc_post_protect_error (GstSrtpEnc * filter, srtp_err_status_t err)
+{
+  if (err == srtp_err_status_key_expired) {
     GST_ELEMENT_ERROR (GST_ELEMENT_CAST (filter), STREAM, ENCODE,
         ("Key usage limit has been reached"),
         ("Unable to protect buffer (hard key usage limit reached)"));
-    goto fail;
-
   } else {
     /* srtp_protect failed */
     GST_ELEMENT_ERROR (filter, LIBRARY, FAILED, (NULL),
         ("Unable to protect buffer (protect failed) code %d", err));
-    goto fail;
   }
+}
 
-  return bufout;
+/* Takes ownership of @buf */
+static GstBuffer *
+gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
+    GstBuffer * buf, gboolean is_rtcp)
+{
+  srtp_err_status_t err;
 
-fail:
-  gst_buffer_unref (bufout);
-  return NULL;
+  buf = gst_srtp_enc_prepare_buffer (filter, buf);
+
+  GST_OBJECT_LOCK (filter);
+
+  gst_srtp_init_event_reporter ();
+  err = gst_srtp_enc_protect_buffer (filter, buf, is_rtcp);
+
+  GST_OBJECT_UNLOCK (filter);
+
+  if (err != srtp_err_status_ok) {
+    gst_srtp_enc_post_protect_error (filter, err);
+    gst_buffer_unref (buf);
+    return NULL;
+  }
+
+  GST_LOG_OBJECT (pad, "Encoding %s buffer of size %" G_GSIZE_FORMAT,
+      is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (buf));
+
+  return buf;
 }
 
 static GstFlowReturn
@@ -1096,10 +1151,10 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
   GstSrtpEnc *filter = GST_SRTP_ENC (parent);
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
-  GstBuffer *bufout = NULL;
 
   if ((ret = gst_srtp_enc_check_set_caps (filter, pad, is_rtcp)) != GST_FLOW_OK) {
-    goto out;
+    gst_buffer_unref (buf);
+    return ret;
   }
 
   GST_OBJECT_LOCK (filter);
@@ -1112,17 +1167,15 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
   GST_OBJECT_UNLOCK (filter);
 
-  if ((bufout = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp))) {
-    /* Push buffer to source pad */
-    otherpad = get_rtp_other_pad (pad);
-    ret = gst_pad_push (otherpad, bufout);
-    bufout = NULL;
+  if (!(buf = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp)))
+    return GST_FLOW_ERROR;
 
-    if (ret != GST_FLOW_OK)
-      goto out;
-  } else {
-    goto fail;
-  }
+  /* Push buffer to source pad */
+  otherpad = get_rtp_other_pad (pad);
+  ret = gst_pad_push (otherpad, buf);
+
+  if (ret != GST_FLOW_OK)
+    return ret;
 
   GST_OBJECT_LOCK (filter);
 
@@ -1136,34 +1189,39 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
   GST_OBJECT_UNLOCK (filter);
 
-out:
+  return ret;
+}
 
-  gst_buffer_unref (buf);
+static gboolean
+prepare_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+{
+  ProcessBufferItData *data = user_data;
 
-  return ret;
+  *buffer = gst_srtp_enc_prepare_buffer (data->filter, *buffer);
 
-fail:
-  ret = GST_FLOW_ERROR;
-  goto out;
+  return TRUE;
 }
 
+/* called with the object lock held */
 static gboolean
-process_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+protect_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
 {
   ProcessBufferItData *data = user_data;
-  GstBuffer *bufout;
+  srtp_err_status_t err;
 
-  if ((bufout =
-          gst_srtp_enc_process_buffer (data->filter, data->pad, *buffer,
-              data->is_rtcp))) {
-    gst_buffer_list_add (data->out_list, bufout);
-  } else {
+  err = gst_srtp_enc_protect_buffer (data->filter, *buffer, data->is_rtcp);
+  if (err != srtp_err_status_ok) {
     GST_WARNING_OBJECT (data->filter, "Error encoding buffer, dropping");
+    if (data->err == srtp_err_status_ok)
+      data->err = err;
+    gst_buffer_unref (*buffer);
+    *buffer = NULL;
   }
 
   return TRUE;
 }
 
+/* The whole list is protected in place under a single lock */
 static GstFlowReturn
 gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * buf_list, gboolean is_rtcp)
@@ -1171,8 +1229,8 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   GstSrtpEnc *filter = GST_SRTP_ENC (parent);
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
-  GstBufferList *out_list = NULL;
   ProcessBufferItData process_data;
+  gboolean soft_limit_reached;
 
   GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
       gst_buffer_list_length (buf_list));
@@ -1193,17 +1251,24 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
 
   GST_OBJECT_UNLOCK (filter);
 
-  out_list = gst_buffer_list_new ();
-
   process_data.filter = filter;
   process_data.pad = pad;
   process_data.is_rtcp = is_rtcp;
-  process_data.out_list = out_list;
+  process_data.err = srtp_err_status_ok;
+
+  buf_list = gst_buffer_list_make_writable (buf_list);
+  gst_buffer_list_foreach (buf_list, prepare_buffer_it, &process_data);
 
-  gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data);
+  GST_OBJECT_LOCK (filter);
+  gst_srtp_init_event_reporter ();
+  gst_buffer_list_foreach (buf_list, protect_buffer_it, &process_data);
+  soft_limit_reached = gst_srtp_get_soft_limit_reached ();
+  GST_OBJECT_UNLOCK (filter);
 
-  if (!gst_buffer_list_length (out_list)) {
-    gst_buffer_list_unref (out_list);
+  if (process_data.err != srtp_err_status_ok)
+    gst_srtp_enc_post_protect_error (filter, process_data.err);
+
+  if (!gst_buffer_list_length (buf_list)) {
     ret = GST_FLOW_OK;
     goto out;
   }
@@ -1212,27 +1277,25 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   otherpad = get_rtp_other_pad (pad);
   GST_LOG_OBJECT (pad, "Pushing buffer chain of %d",
       gst_buffer_list_length (buf_list));
-  ret = gst_pad_push_list (otherpad, out_list);
+  ret = gst_pad_push_list (otherpad, buf_list);
+  buf_list = NULL;
 
   if (ret != GST_FLOW_OK) {
     goto out;
   }
 
-  GST_OBJECT_LOCK (filter);
-
-  if (gst_srtp_get_soft_limit_reached ()) {
-    GST_OBJECT_UNLOCK (filter);
+  if (soft_limit_reached) {
     g_signal_emit (filter, gst_srtp_enc_signals[SIGNAL_SOFT_LIMIT], 0);
     GST_OBJECT_LOCK (filter);
     if (filter->random_key && !filter->key_changed)
       gst_srtp_enc_replace_random_key (filter);
+    GST_OBJECT_UNLOCK (filter);
   }
 
-  GST_OBJECT_UNLOCK (filter);
-
 out:
 
-  gst_buffer_list_unref (buf_list);
+  if (buf_list)
+    gst_buffer_list_unref (buf_list);
 
   return ret;
 }
@@ -1300,8 +1363,16 @@ gst_srtp_enc_change_state (GstElement * element, GstStateChange transition)
         gst_srtp_enc_reset_no_lock (filter);
       GST_OBJECT_UNLOCK (filter);
       break;
-    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    case GST_STATE_CHANGE_READY_TO_PAUSED:{
+      GstStructure *config;
+
+      filter->pool = gst_buffer_pool_new ();
+      config = gst_buffer_pool_get_config (filter->pool);
+      gst_buffer_pool_config_set_params (config, NULL, POOL_BUFFER_SIZE, 0, 0);
+      gst_buffer_pool_set_config (filter->pool, config);
+      gst_buffer_pool_set_active (filter->pool, TRUE);
       break;
+    }
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       break;
     default:
@@ -1316,6 +1387,11 @@ gst_srtp_enc_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_srtp_enc_reset (filter);
+      if (filter->pool) {
+        gst_buffer_pool_set_active (filter->pool, FALSE);
+        gst_object_unref (filter->pool);
+        filter->pool = NULL;
+      }
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
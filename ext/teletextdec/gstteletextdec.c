@@ -51,6 +51,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_teletextdec_debug);
 
 #define SUBTITLES_PAGE 888
 #define MAX_SLICES 32
+#define MAX_ROWS 32
+#define ALL_ROWS_DIRTY G_MAXUINT32
 #define DEFAULT_FONT_DESCRIPTION "verdana 12"
 #define PANGO_TEMPLATE "<span font_desc=\"%s\" foreground=\"%s\"> %s \n</span>"
 
@@ -99,6 +101,9 @@ typedef struct
 {
   int pgno;
   int subno;
+  /* fetched from the page cache on a page switch rather than on reception,
+   * the page may not have been received yet */
+  gboolean cached;
 } page_info;
 
 typedef enum
@@ -179,6 +184,7 @@ static gboolean gst_teletextdec_extract_data_units (GstTeletextDec *
 static void gst_teletextdec_zvbi_init (GstTeletextDec * teletext);
 static void gst_teletextdec_zvbi_clear (GstTeletextDec * teletext);
 static void gst_teletextdec_reset_frame (GstTeletextDec * teletext);
+static void gst_teletextdec_clear_page_cache (GstTeletextDec * teletext);
 
 /* initialize the gstteletext's class */
 static void
@@ -278,6 +284,13 @@ gst_teletextdec_init (GstTeletextDec * teletext)
 
   teletext->export_func = NULL;
   teletext->buf_pool = NULL;
+
+  teletext->page_switched = FALSE;
+  teletext->last_text = NULL;
+  teletext->row_lines = NULL;
+  teletext->page_text = NULL;
+  teletext->canvas = NULL;
+  gst_teletextdec_clear_page_cache (teletext);
 }
 
 static void
@@ -288,6 +301,7 @@ gst_teletextdec_finalize (GObject * object)
   g_mutex_clear (&teletext->queue_lock);
 
   g_free (teletext->frame);
+  gst_teletextdec_clear_page_cache (teletext);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -335,6 +349,8 @@ gst_teletextdec_zvbi_clear (GstTeletextDec * teletext)
   }
   g_mutex_unlock (&teletext->queue_lock);
 
+  gst_teletextdec_clear_page_cache (teletext);
+
   teletext->in_timestamp = GST_CLOCK_TIME_NONE;
   teletext->in_duration = GST_CLOCK_TIME_NONE;
   teletext->pageno = 0x100;
@@ -351,9 +367,11 @@ gst_teletextdec_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_PAGENO:
       teletext->pageno = (gint) vbi_bin2bcd (g_value_get_int (value));
+      teletext->page_switched = TRUE;
       break;
     case PROP_SUBNO:
       teletext->subno = g_value_get_int (value);
+      teletext->page_switched = TRUE;
       break;
     case PROP_SUBTITLES_MODE:
       teletext->subtitles_mode = g_value_get_boolean (value);
@@ -509,6 +527,70 @@ gst_teletextdec_reset_frame (GstTeletextDec * teletext)
   teletext->frame->last_frame_line = 0;
 }
 
+static void
+gst_teletextdec_clear_page_cache (GstTeletextDec * teletext)
+{
+  g_free (teletext->last_text);
+  teletext->last_text = NULL;
+  teletext->last_pgno = 0;
+  teletext->last_rows = 0;
+  teletext->last_columns = 0;
+  teletext->last_export_func = NULL;
+  teletext->dirty_rows = ALL_ROWS_DIRTY;
+
+  g_strfreev (teletext->row_lines);
+  teletext->row_lines = NULL;
+  g_free (teletext->page_text);
+  teletext->page_text = NULL;
+  teletext->page_text_size = 0;
+  g_free (teletext->canvas);
+  teletext->canvas = NULL;
+}
+
+/* Compares @page with the last exported page and sets a bit in dirty_rows for
+ * every row that needs to be regenerated */
+static void
+gst_teletextdec_update_dirty_rows (GstTeletextDec * teletext, vbi_page * page)
+{
+  const gsize row_size = page->columns * sizeof (vbi_char);
+  gint i;
+
+  if (teletext->last_text == NULL || page->rows > MAX_ROWS
+      || teletext->last_pgno != page->pgno
+      || teletext->last_rows != page->rows
+      || teletext->last_columns != page->columns
+      || teletext->last_export_func != teletext->export_func
+      || memcmp (teletext->last_color_map, page->color_map,
+          sizeof (teletext->last_color_map))) {
+    gst_teletextdec_clear_page_cache (teletext);
+
+    teletext->last_text = g_malloc (page->rows * row_size);
+    teletext->last_pgno = page->pgno;
+    teletext->last_rows = page->rows;
+    teletext->last_columns = page->columns;
+    teletext->last_export_func = teletext->export_func;
+    memcpy (teletext->last_color_map, page->color_map,
+        sizeof (teletext->last_color_map));
+  } else {
+    teletext->dirty_rows = 0;
+    for (i = 0; i < page->rows; i++) {
+      if (memcmp (teletext->last_text + i * page->columns,
+              page->text + i * page->columns, row_size))
+        teletext->dirty_rows |= 1u << i;
+    }
+  }
+
+  memcpy (teletext->last_text, page->text, page->rows * row_size);
+
+  GST_LOG_OBJECT (teletext, "dirty rows 0x%08x", teletext->dirty_rows);
+}
+
+static inline gboolean
+gst_teletextdec_row_is_dirty (GstTeletextDec * teletext, gint row)
+{
+  return (teletext->dirty_rows & (1u << row)) != 0;
+}
+
 static void
 gst_teletextdec_process_telx_buffer (GstTeletextDec * teletext, GstBuffer * buf)
 {
@@ -584,6 +666,7 @@ gst_teletextdec_event_handler (vbi_event * ev, void *user_data)
       pi = g_new (page_info, 1);
       pi->pgno = pgno;
       pi->subno = subno;
+      pi->cached = FALSE;
 
       g_mutex_lock (&teletext->queue_lock);
       g_queue_push_tail (teletext->queue, pi);
@@ -727,6 +810,17 @@ gst_teletextdec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   gst_buffer_unref (buf);
 
   g_mutex_lock (&teletext->queue_lock);
+  /* zvbi keeps every page of all magazines it received, so show a newly
+   * selected page right away if it is already known */
+  if (G_UNLIKELY (teletext->page_switched)) {
+    page_info *pi = g_new (page_info, 1);
+
+    teletext->page_switched = FALSE;
+    pi->pgno = teletext->pageno;
+    pi->subno = teletext->subno == -1 ? VBI_ANY_SUBNO : teletext->subno;
+    pi->cached = TRUE;
+    g_queue_push_tail (teletext->queue, pi);
+  }
   if (!g_queue_is_empty (teletext->queue)) {
     ret = gst_teletextdec_push_page (teletext);
     if (ret != GST_FLOW_OK) {
@@ -758,7 +852,7 @@ gst_teletextdec_push_page (GstTeletextDec * teletext)
   vbi_page page;
   page_info *pi;
   gint pgno, subno;
-  gboolean success;
+  gboolean success, cached;
   guint width, height;
 
   pi = g_queue_pop_head (teletext->queue);
@@ -769,9 +863,15 @@ gst_teletextdec_push_page (GstTeletextDec * teletext)
 
   success = vbi_fetch_vt_page (teletext->decoder, &page, pi->pgno, pi->subno,
       VBI_WST_LEVEL_3p5, 25, FALSE);
+  cached = pi->cached;
   g_free (pi);
-  if (G_UNLIKELY (!success))
+  if (G_UNLIKELY (!success)) {
+    if (cached) {
+      GST_DEBUG_OBJECT (teletext, "Page %03d not received yet", pgno);
+      return GST_FLOW_OK;
+    }
     goto fetch_page_failed;
+  }
 
   width = COLUMNS_TO_WIDTH (page.columns);
   height = ROWS_TO_HEIGHT (page.rows);
@@ -792,8 +892,11 @@ gst_teletextdec_push_page (GstTeletextDec * teletext)
     }
   }
 
-  teletext->export_func (teletext, &page, &buf);
+  gst_teletextdec_update_dirty_rows (teletext, &page);
+  ret = teletext->export_func (teletext, &page, &buf);
   vbi_unref_page (&page);
+  if (ret != GST_FLOW_OK)
+    goto push_failed;
 
   GST_BUFFER_TIMESTAMP (buf) = teletext->in_timestamp;
   GST_BUFFER_DURATION (buf) = teletext->in_duration;
@@ -822,25 +925,37 @@ push_failed:
 }
 
 static gchar **
-gst_teletextdec_vbi_page_to_text_lines (guint start, guint stop, vbi_page *
-    page)
+gst_teletextdec_vbi_page_to_text_lines (GstTeletextDec * teletext,
+    guint start, guint stop, vbi_page * page)
 {
   const guint lines_count = stop - start + 1;
   const guint line_length = page->columns;
   gchar **lines;
   guint i;
 
+  if (teletext->row_lines == NULL)
+    teletext->row_lines = g_new0 (gchar *, page->rows + 1);
+
   /* allocate a new NULL-terminated array of strings */
   lines = (gchar **) g_malloc (sizeof (gchar *) * (lines_count + 1));
   lines[lines_count] = NULL;
 
-  /* export each line in the range of the teletext page in text format */
+  /* export each line in the range of the teletext page in text format, only
+   * the rows that changed since the last page are printed again */
   for (i = start; i <= stop; i++) {
-    lines[i - start] = (gchar *) g_malloc (sizeof (gchar) * (line_length + 1));
-    vbi_print_page_region (page, lines[i - start], line_length + 1, "UTF-8",
-        TRUE, 0, 0, i, line_length, 1);
-    /* Add the null character */
-    lines[i - start][line_length] = '\0';
+    gchar *line = teletext->row_lines[i];
+
+    if (line == NULL || gst_teletextdec_row_is_dirty (teletext, i)) {
+      if (line == NULL) {
+        line = (gchar *) g_malloc (sizeof (gchar) * (line_length + 1));
+        teletext->row_lines[i] = line;
+      }
+      vbi_print_page_region (page, line, line_length + 1, "UTF-8",
+          TRUE, 0, 0, i, line_length, 1);
+      /* Add the null character */
+      line[line_length] = '\0';
+    }
+    lines[i - start] = g_strdup (line);
   }
 
   return lines;
@@ -858,7 +973,7 @@ gst_teletextdec_export_text_page (GstTeletextDec * teletext, vbi_page * page,
     GString *subs;
     guint i;
 
-    lines = gst_teletextdec_vbi_page_to_text_lines (1, 23, page);
+    lines = gst_teletextdec_vbi_page_to_text_lines (teletext, 1, 23, page);
     subs = g_string_new ("");
     /* Strip white spaces and squash blank lines */
     for (i = 0; i < 23; i++) {
@@ -876,9 +991,15 @@ gst_teletextdec_export_text_page (GstTeletextDec * teletext, vbi_page * page,
     g_string_free (subs, FALSE);
     g_strfreev (lines);
   } else {
-    size = page->columns * page->rows;
-    text = g_malloc (size);
-    vbi_print_page (page, text, size, "UTF-8", FALSE, TRUE);
+    if (teletext->page_text == NULL || teletext->dirty_rows) {
+      g_free (teletext->page_text);
+      teletext->page_text_size = page->columns * page->rows;
+      teletext->page_text = g_malloc (teletext->page_text_size);
+      vbi_print_page (page, teletext->page_text, teletext->page_text_size,
+          "UTF-8", FALSE, TRUE);
+    }
+    size = teletext->page_text_size;
+    text = g_memdup (teletext->page_text, size);
   }
 
   /* Allocate new buffer */
@@ -915,7 +1036,39 @@ gst_teletextdec_export_rgba_page (GstTeletextDec * teletext, vbi_page * page,
     return GST_FLOW_ERROR;
   }
 
-  vbi_draw_vt_page (page, VBI_PIXFMT_RGBA32_LE, buf_map.data, FALSE, TRUE);
+  /* only draw the rows that changed into the rendering of the last page,
+   * pool buffers may hold any older page so the whole canvas is copied */
+  if (teletext->canvas == NULL) {
+    teletext->canvas = g_malloc (size);
+    teletext->dirty_rows = ALL_ROWS_DIRTY;
+  }
+
+  if (teletext->dirty_rows == ALL_ROWS_DIRTY) {
+    vbi_draw_vt_page (page, VBI_PIXFMT_RGBA32_LE, teletext->canvas, FALSE,
+        TRUE);
+  } else {
+    const gint rowstride = teletext->width * sizeof (vbi_rgba);
+    gint row = 0;
+
+    while (row < page->rows) {
+      gint n_rows = 0;
+
+      while (row + n_rows < page->rows
+          && gst_teletextdec_row_is_dirty (teletext, row + n_rows))
+        n_rows++;
+
+      if (n_rows > 0) {
+        vbi_draw_vt_page_region (page, VBI_PIXFMT_RGBA32_LE,
+            teletext->canvas + ROWS_TO_HEIGHT (row) * rowstride, rowstride,
+            0, row, page->columns, n_rows, FALSE, TRUE);
+        row += n_rows;
+      } else {
+        row++;
+      }
+    }
+  }
+
+  memcpy (buf_map.data, teletext->canvas, size);
   gst_buffer_unmap (lbuf, &buf_map);
   *buf = lbuf;
 
@@ -952,7 +1105,8 @@ gst_teletextdec_export_pango_page (GstTeletextDec * teletext, vbi_page * page,
   /* get an array of strings with each line of the telext page */
   start = teletext->subtitles_mode ? 1 : 0;
   stop = teletext->subtitles_mode ? rows - 2 : rows - 1;
-  lines = gst_teletextdec_vbi_page_to_text_lines (start, stop, page);
+  lines = gst_teletextdec_vbi_page_to_text_lines (teletext, start, stop,
+      page);
 
   /* format each line in pango markup */
   subs = g_string_new ("");
@@ -80,6 +80,29 @@ struct _GstTeletextDec
 
   /* buffer pool received from the peer pad - used in RGBA output only. */
   GstBufferPool *buf_pool;
+
+  /* set when the page or sub-page property changed, the new page is then
+   * fetched from the zvbi page cache instead of waiting for it to be
+   * transmitted again */
+  gboolean page_switched;
+
+  /* content of the last exported page, used to only regenerate the rows
+   * that changed since */
+  vbi_char *last_text;
+  vbi_rgba last_color_map[40];
+  vbi_pgno last_pgno;
+  gint last_rows;
+  gint last_columns;
+  GstTeletextExportFunc last_export_func;
+  guint32 dirty_rows;
+
+  /* per-row text of the last page, and the whole page in text mode */
+  gchar **row_lines;
+  gchar *page_text;
+  guint page_text_size;
+
+  /* RGBA rendering of the last page */
+  guint8 *canvas;
 };
 
 struct _GstTeletextFrame
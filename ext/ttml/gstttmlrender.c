@@ -142,6 +142,17 @@ typedef struct
 } UnifiedBlock;
 
 
+/* Maximum number of rendered blocks kept in the class-wide block cache. */
+#define BLOCK_CACHE_MAX_ENTRIES 256
+
+
+typedef struct
+{
+  gchar *key;
+  GstTtmlRenderRenderedImage *image;
+} BlockCacheEntry;
+
+
 static GstElementClass *parent_class = NULL;
 static void gst_ttml_render_base_init (gpointer g_class);
 static void gst_ttml_render_class_init (GstTtmlRenderClass * klass);
@@ -271,6 +282,9 @@ gst_ttml_render_class_init (GstTtmlRenderClass * klass)
 
   klass->pango_lock = g_slice_new (GMutex);
   g_mutex_init (klass->pango_lock);
+
+  klass->block_cache = g_hash_table_new (g_str_hash, g_str_equal);
+  g_queue_init (&klass->block_cache_lru);
 }
 
 static void
@@ -2538,6 +2552,133 @@ gst_ttml_render_stitch_images (GPtrArray * images, GstTtmlDirection direction)
 }
 
 
+static void
+gst_ttml_render_append_style_key (GString * key,
+    const GstSubtitleStyleSet * style)
+{
+  g_string_append_printf (key, "%d|%u:%s|%.9g|%.9g|%d|%02x%02x%02x%02x|"
+      "%02x%02x%02x%02x|%d|%d|%d|%d|%d|%d|%.9g|%.9g,%.9g|%.9g,%.9g|%d|"
+      "%.9g,%.9g,%.9g,%.9g|%d|%d|%d|%d;", style->text_direction,
+      style->font_family ? (guint) strlen (style->font_family) : 0,
+      style->font_family ? style->font_family : "", style->font_size,
+      style->line_height, style->text_align, style->color.r, style->color.g,
+      style->color.b, style->color.a, style->background_color.r,
+      style->background_color.g, style->background_color.b,
+      style->background_color.a, style->font_style, style->font_weight,
+      style->text_decoration, style->unicode_bidi, style->wrap_option,
+      style->multi_row_align, style->line_padding, style->origin_x,
+      style->origin_y, style->extent_w, style->extent_h, style->display_align,
+      style->padding_start, style->padding_end, style->padding_before,
+      style->padding_after, style->writing_mode, style->show_background,
+      style->overflow, style->fill_line_gap);
+}
+
+
+/* Builds a key identifying everything the rendered image of @block depends
+ * on: the text and style of the block and its elements, the width available
+ * to it and the frame size the relative style values are resolved against.
+ * Returns NULL if the text of an element cannot be read. */
+static gchar *
+gst_ttml_render_get_block_cache_key (GstTtmlRender * render,
+    const GstSubtitleBlock * block, GstBuffer * text_buf, guint width,
+    gboolean overflow)
+{
+  GString *key = g_string_new (NULL);
+  guint i;
+
+  g_string_append_printf (key, "%dx%d|%u|%d;", render->width, render->height,
+      width, overflow);
+  gst_ttml_render_append_style_key (key, block->style_set);
+
+  for (i = 0; i < gst_subtitle_block_get_element_count (block); ++i) {
+    const GstSubtitleElement *element = gst_subtitle_block_get_element (block,
+        i);
+    gchar *text;
+
+    text = gst_ttml_render_get_text_from_buffer (text_buf, element->text_index);
+    if (!text) {
+      g_string_free (key, TRUE);
+      return NULL;
+    }
+
+    g_string_append_printf (key, "%d|%u:%s|", element->suppress_whitespace,
+        (guint) strlen (text), text);
+    gst_ttml_render_append_style_key (key, element->style_set);
+    g_free (text);
+  }
+
+  return g_string_free (key, FALSE);
+}
+
+
+static void
+gst_ttml_render_block_cache_entry_free (BlockCacheEntry * entry)
+{
+  g_free (entry->key);
+  gst_ttml_render_rendered_image_free (entry->image);
+  g_slice_free (BlockCacheEntry, entry);
+}
+
+
+/* Returns a copy of the cached rendering for @key, or NULL. The copy shares
+ * the image buffer with the cache, which is never written to afterwards. */
+static GstTtmlRenderRenderedImage *
+gst_ttml_render_block_cache_lookup (GstTtmlRender * render, const gchar * key)
+{
+  GstTtmlRenderClass *klass = GST_TTML_RENDER_GET_CLASS (render);
+  GstTtmlRenderRenderedImage *ret = NULL;
+  GList *link;
+
+  g_mutex_lock (klass->pango_lock);
+  link = g_hash_table_lookup (klass->block_cache, key);
+  if (link) {
+    BlockCacheEntry *entry = link->data;
+
+    g_queue_unlink (&klass->block_cache_lru, link);
+    g_queue_push_head_link (&klass->block_cache_lru, link);
+    ret = gst_ttml_render_rendered_image_copy (entry->image);
+  }
+  g_mutex_unlock (klass->pango_lock);
+
+  return ret;
+}
+
+
+/* Takes ownership of @key. */
+static void
+gst_ttml_render_block_cache_insert (GstTtmlRender * render, gchar * key,
+    GstTtmlRenderRenderedImage * image)
+{
+  GstTtmlRenderClass *klass = GST_TTML_RENDER_GET_CLASS (render);
+  BlockCacheEntry *entry;
+
+  g_mutex_lock (klass->pango_lock);
+
+  /* another instance may have rendered the same block in the meantime */
+  if (g_hash_table_contains (klass->block_cache, key)) {
+    g_mutex_unlock (klass->pango_lock);
+    g_free (key);
+    return;
+  }
+
+  while (klass->block_cache_lru.length >= BLOCK_CACHE_MAX_ENTRIES) {
+    BlockCacheEntry *old = g_queue_pop_tail (&klass->block_cache_lru);
+
+    g_hash_table_remove (klass->block_cache, old->key);
+    gst_ttml_render_block_cache_entry_free (old);
+  }
+
+  entry = g_slice_new (BlockCacheEntry);
+  entry->key = key;
+  entry->image = gst_ttml_render_rendered_image_copy (image);
+  g_queue_push_head (&klass->block_cache_lru, entry);
+  g_hash_table_insert (klass->block_cache, entry->key,
+      klass->block_cache_lru.head);
+
+  g_mutex_unlock (klass->pango_lock);
+}
+
+
 static GstTtmlRenderRenderedImage *
 gst_ttml_render_render_text_block (GstTtmlRender * render,
     const GstSubtitleBlock * block, GstBuffer * text_buf, guint width,
@@ -2551,8 +2692,22 @@ gst_ttml_render_render_text_block (GstTtmlRender * render,
   GPtrArray *split_blocks;
   GPtrArray *images;
   GstTtmlRenderRenderedImage *rendered_block = NULL;
+  gchar *cache_key;
   gint i;
 
+  /* Consecutive scenes usually only add or remove a paragraph and several
+   * instances often render the same stream, so reuse earlier renderings. */
+  cache_key = gst_ttml_render_get_block_cache_key (render, block, text_buf,
+      width, overflow);
+  if (cache_key) {
+    rendered_block = gst_ttml_render_block_cache_lookup (render, cache_key);
+    if (rendered_block) {
+      GST_CAT_LOG (ttmlrender_debug, "Reusing cached rendering of block");
+      g_free (cache_key);
+      return rendered_block;
+    }
+  }
+
   unified_block = gst_ttml_render_unify_block (render, block, text_buf);
   metrics = gst_ttml_render_get_block_metrics (render, unified_block);
   wrap = gst_ttml_render_elements_are_wrapped (block->elements);
@@ -2585,6 +2740,12 @@ gst_ttml_render_render_text_block (GstTtmlRender * render,
 
   g_ptr_array_unref (ranges);
   gst_ttml_render_unified_block_free (unified_block);
+
+  if (cache_key && rendered_block)
+    gst_ttml_render_block_cache_insert (render, cache_key, rendered_block);
+  else
+    g_free (cache_key);
+
   return rendered_block;
 }
 
@@ -100,6 +100,11 @@ struct _GstTtmlRenderClass {
 
     PangoContext *pango_context;
     GMutex       *pango_lock;
+
+    /* rendered blocks keyed on their text, style and target size; shared by
+     * all instances and protected by pango_lock */
+    GHashTable   *block_cache;
+    GQueue        block_cache_lru;
 };
 
 GType gst_ttml_render_get_type(void) G_GNUC_CONST;
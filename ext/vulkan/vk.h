@@ -34,6 +34,7 @@
 #include "vkdisplay.h"
 #include "vkwindow.h"
 #include "vkswapper.h"
+#include "vkmemoryarena.h"
 #include "vkmemory.h"
 #include "vkbuffermemory.h"
 #include "vkimagememory.h"
@@ -54,6 +54,9 @@ typedef struct _GstVulkanTrash GstVulkanTrash;
 
 typedef struct _GstVulkanFence GstVulkanFence;
 
+typedef struct _GstVulkanMemoryArena GstVulkanMemoryArena;
+typedef struct _GstVulkanMemoryBlock GstVulkanMemoryBlock;
+
 typedef struct _GstVulkanMemory GstVulkanMemory;
 typedef struct _GstVulkanMemoryAllocator GstVulkanMemoryAllocator;
 typedef struct _GstVulkanMemoryAllocatorClass GstVulkanMemoryAllocatorClass;
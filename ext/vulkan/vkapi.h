@@ -42,4 +42,10 @@
 
 #include <vulkan/vulkan.h>
 
+/* importing dmabufs needs headers that know about the external memory
+ * extensions, whether the device supports them is only known at runtime */
+#if defined (VK_KHR_external_memory_fd) && defined (VK_EXT_external_memory_dma_buf)
+#define GST_VULKAN_HAVE_DMABUF_IMPORT 1
+#endif
+
 #endif /* _VK_H_ */
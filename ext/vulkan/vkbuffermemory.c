@@ -24,6 +24,8 @@
 
 #include "vkbuffermemory.h"
 
+#include <unistd.h>
+
 /**
  * SECTION:vkbuffermemory
  * @title: vkbuffermemory
@@ -148,17 +150,14 @@ _vk_buffer_mem_new_alloc (GstAllocator * allocator, GstMemory * parent,
   if (!mem->vk_mem)
     goto error;
 
-  err = vkBindBufferMemory (device->device, buffer, mem->vk_mem->mem_ptr, 0);
+  err = vkBindBufferMemory (device->device, buffer, mem->vk_mem->mem_ptr,
+      mem->vk_mem->vk_offset);
   if (gst_vulkan_error_to_g_error (err, &error, "vkBindBufferMemory") < 0)
     goto vk_error;
 
+  /* only texel buffers are accessed through a view */
   if (usage & (VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT |
-          VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT |
-          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
-          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-          VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)) {
+          VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT)) {
     VkBufferViewCreateInfo view_info;
 
     _create_view_from_args (&view_info, mem->buffer, format, 0,
@@ -209,13 +208,9 @@ _vk_buffer_mem_new_wrapped (GstAllocator * allocator, GstMemory * parent,
 
   /* XXX: we don't actually if the buffer has a vkDeviceMemory bound so
    * this may fail */
+  /* only texel buffers are accessed through a view */
   if (usage & (VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT |
-          VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT |
-          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
-          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-          VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)) {
+          VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT)) {
     VkBufferViewCreateInfo view_info;
 
     _create_view_from_args (&view_info, mem->buffer, format, 0,
@@ -242,6 +237,94 @@ error:
   }
 }
 
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+static GstVulkanBufferMemory *
+_vk_buffer_mem_new_dmabuf (GstAllocator * allocator, GstVulkanDevice * device,
+    VkFormat format, gint fd, gsize offset, gsize size,
+    VkBufferUsageFlags usage, gpointer user_data, GDestroyNotify notify)
+{
+  VkExternalMemoryBufferCreateInfoKHR external_info = { 0, };
+  GstVulkanBufferMemory *mem = NULL;
+  GstAllocationParams params = { 0, };
+  VkBufferCreateInfo buffer_info;
+  GError *error = NULL;
+  VkBuffer buffer;
+  off_t dmabuf_size;
+  VkResult err;
+
+  dmabuf_size = lseek (fd, 0, SEEK_END);
+  if (dmabuf_size < 0 || (gint64) (offset + size) > dmabuf_size) {
+    GST_CAT_WARNING (GST_CAT_VULKAN_BUFFER_MEMORY, "dmabuf of size %"
+        G_GINT64_FORMAT " is too small", (gint64) dmabuf_size);
+    goto error;
+  }
+
+  external_info.sType =
+      VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR;
+  external_info.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+
+  if (!_create_info_from_args (&buffer_info, size, usage)) {
+    GST_CAT_ERROR (GST_CAT_VULKAN_BUFFER_MEMORY, "Incorrect buffer parameters");
+    goto error;
+  }
+  buffer_info.pNext = &external_info;
+
+  err = vkCreateBuffer (device->device, &buffer_info, NULL, &buffer);
+  if (gst_vulkan_error_to_g_error (err, &error, "vkCreateBuffer") < 0)
+    goto vk_error;
+
+  mem = g_new0 (GstVulkanBufferMemory, 1);
+  vkGetBufferMemoryRequirements (device->device, buffer, &mem->requirements);
+
+  /* the buffer lives inside of the dmabuf, it can only be mapped through
+   * the dmabuf itself */
+  params.align = mem->requirements.alignment - 1;
+  params.flags = GST_MEMORY_FLAG_NOT_MAPPABLE;
+  _vk_buffer_mem_init (mem, allocator, NULL, device, usage, &params,
+      mem->requirements.size, user_data, notify);
+  mem->buffer = buffer;
+  /* owned by mem now */
+  notify = NULL;
+
+  if (offset % mem->requirements.alignment != 0 ||
+      (gint64) (offset + mem->requirements.size) > dmabuf_size) {
+    GST_CAT_DEBUG (GST_CAT_VULKAN_BUFFER_MEMORY, "dmabuf offset %"
+        G_GSIZE_FORMAT " doesn't fit the buffer requirements", offset);
+    goto error;
+  }
+
+  mem->vk_mem = (GstVulkanMemory *) gst_vulkan_memory_import_dmabuf (device,
+      fd, dmabuf_size, mem->requirements.memoryTypeBits);
+  if (!mem->vk_mem)
+    goto error;
+  mem->vk_mem->vk_offset = offset;
+
+  err = vkBindBufferMemory (device->device, buffer, mem->vk_mem->mem_ptr,
+      mem->vk_mem->vk_offset);
+  if (gst_vulkan_error_to_g_error (err, &error, "vkBindBufferMemory") < 0)
+    goto vk_error;
+
+  return mem;
+
+vk_error:
+  {
+    GST_CAT_ERROR (GST_CAT_VULKAN_BUFFER_MEMORY,
+        "Failed to import dmabuf %s", error->message);
+    g_clear_error (&error);
+    goto error;
+  }
+
+error:
+  {
+    if (mem)
+      gst_memory_unref ((GstMemory *) mem);
+    if (notify)
+      notify (user_data);
+    return NULL;
+  }
+}
+#endif
+
 static gpointer
 _vk_buffer_mem_map_full (GstVulkanBufferMemory * mem, GstMapInfo * info,
     gsize size)
@@ -366,6 +449,40 @@ gst_vulkan_buffer_memory_wrapped (GstVulkanDevice * device, VkBuffer buffer,
   return (GstMemory *) mem;
 }
 
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+/**
+ * gst_vulkan_buffer_memory_import_dmabuf:
+ * @device: a #GstVulkanDevice
+ * @format: the #VkFormat of the buffer
+ * @fd: the dmabuf file descriptor
+ * @offset: where the buffer starts in the dmabuf
+ * @size: the size of the buffer
+ * @usage: the #VkBufferUsageFlags of the buffer
+ * @user_data: data passed to @notify
+ * @notify: called when the memory is freed or if the import fails
+ *
+ * Creates a #GstVulkanBufferMemory bound to the dmabuf @fd at @offset
+ * without copying any data.  This fails when @offset doesn't satisfy the
+ * alignment the device needs for such a buffer.
+ *
+ * Returns: a #GstMemory object or %NULL
+ *
+ * Since: 1.16
+ */
+GstMemory *
+gst_vulkan_buffer_memory_import_dmabuf (GstVulkanDevice * device,
+    VkFormat format, gint fd, gsize offset, gsize size,
+    VkBufferUsageFlags usage, gpointer user_data, GDestroyNotify notify)
+{
+  GstVulkanBufferMemory *mem;
+
+  mem = _vk_buffer_mem_new_dmabuf (_vulkan_buffer_memory_allocator, device,
+      format, fd, offset, size, usage, user_data, notify);
+
+  return (GstMemory *) mem;
+}
+#endif
+
 G_DEFINE_TYPE (GstVulkanBufferMemoryAllocator,
     gst_vulkan_buffer_memory_allocator, GST_TYPE_ALLOCATOR);
 
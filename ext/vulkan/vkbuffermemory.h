@@ -97,6 +97,17 @@ GstMemory *     gst_vulkan_buffer_memory_wrapped         (GstVulkanDevice * devi
                                                          gpointer user_data,
                                                          GDestroyNotify notify);
 
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+GstMemory *     gst_vulkan_buffer_memory_import_dmabuf   (GstVulkanDevice * device,
+                                                         VkFormat format,
+                                                         gint fd,
+                                                         gsize offset,
+                                                         gsize size,
+                                                         VkBufferUsageFlags usage,
+                                                         gpointer user_data,
+                                                         GDestroyNotify notify);
+#endif
+
 G_END_DECLS
 
 #endif /* _VK_BUFFER_MEMORY_H_ */
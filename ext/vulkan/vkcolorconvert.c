@@ -0,0 +1,810 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-vulkancolorconvert
+ * @title: vulkancolorconvert
+ *
+ * vulkancolorconvert converts and scales video frames held in Vulkan
+ * buffers with a compute shader, between RGBA, BGRA, RGBx, BGRx, I420, NV12
+ * and YUY2.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 videotestsrc ! video/x-raw,format=I420 ! vulkanupload ! vulkancolorconvert ! video/x-raw(memory:VulkanBuffer),format=BGRA,width=1920,height=1080 ! vulkansink
+ * ]|
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "vkcolorconvert.h"
+
+GST_DEBUG_CATEGORY (gst_debug_vulkan_color_convert);
+#define GST_CAT_DEFAULT gst_debug_vulkan_color_convert
+
+/* generated by glslc from shaders/colorconvert.comp */
+static const guint32 colorconvert_spv[] =
+#include "colorconvert.spv.h"
+    ;
+
+/* keep in sync with shaders/colorconvert.comp */
+enum
+{
+  SHADER_FORMAT_RGBA,
+  SHADER_FORMAT_BGRA,
+  SHADER_FORMAT_I420,
+  SHADER_FORMAT_NV12,
+  SHADER_FORMAT_YUY2,
+};
+
+/* the shader's push constants */
+typedef struct
+{
+  gint32 in_format;
+  gint32 out_format;
+  gint32 plane;
+  gint32 padding;
+  gint32 in_size[2];
+  gint32 out_size[2];
+  gint32 in_strides[4];
+  gint32 out_strides[4];
+  gfloat in_coeffs[4];
+  gfloat out_coeffs[4];
+} ColorConvertParams;
+
+/* 3 input and 3 output planes */
+#define N_BINDINGS 6
+/* the local size of the shader */
+#define GROUP_SIZE 8
+/* descriptor sets are only held for a frame, a few of them are enough */
+#define MAX_DESCRIPTOR_SETS 4
+
+#define VULKAN_CAPS \
+    GST_VIDEO_CAPS_MAKE_WITH_FEATURES (GST_CAPS_FEATURE_MEMORY_VULKAN_BUFFER, \
+        "{ RGBA, BGRA, RGBx, BGRx, I420, NV12, YUY2 }")
+
+static GstStaticPadTemplate gst_vulkan_color_convert_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (VULKAN_CAPS));
+
+static GstStaticPadTemplate gst_vulkan_color_convert_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (VULKAN_CAPS));
+
+static void gst_vulkan_color_convert_set_context (GstElement * element,
+    GstContext * context);
+static GstStateChangeReturn gst_vulkan_color_convert_change_state (GstElement *
+    element, GstStateChange transition);
+
+static gboolean gst_vulkan_color_convert_query (GstBaseTransform * bt,
+    GstPadDirection direction, GstQuery * query);
+static GstCaps *gst_vulkan_color_convert_transform_caps (GstBaseTransform * bt,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter);
+static GstCaps *gst_vulkan_color_convert_fixate_caps (GstBaseTransform * bt,
+    GstPadDirection direction, GstCaps * caps, GstCaps * othercaps);
+static gboolean gst_vulkan_color_convert_set_caps (GstBaseTransform * bt,
+    GstCaps * in_caps, GstCaps * out_caps);
+static gboolean gst_vulkan_color_convert_propose_allocation (GstBaseTransform *
+    bt, GstQuery * decide_query, GstQuery * query);
+static gboolean gst_vulkan_color_convert_decide_allocation (GstBaseTransform *
+    bt, GstQuery * query);
+static gboolean gst_vulkan_color_convert_stop (GstBaseTransform * bt);
+static GstFlowReturn gst_vulkan_color_convert_transform (GstBaseTransform * bt,
+    GstBuffer * inbuf, GstBuffer * outbuf);
+
+#define gst_vulkan_color_convert_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstVulkanColorConvert, gst_vulkan_color_convert,
+    GST_TYPE_BASE_TRANSFORM,
+    GST_DEBUG_CATEGORY_INIT (gst_debug_vulkan_color_convert,
+        "vulkancolorconvert", 0, "Vulkan Color Convert"));
+
+static void
+gst_vulkan_color_convert_class_init (GstVulkanColorConvertClass * klass)
+{
+  GstElementClass *gstelement_class;
+  GstBaseTransformClass *gstbasetransform_class;
+
+  gstelement_class = (GstElementClass *) klass;
+  gstbasetransform_class = (GstBaseTransformClass *) klass;
+
+  gst_element_class_set_metadata (gstelement_class, "Vulkan Color Convert",
+      "Filter/Converter/Video/Scaler",
+      "Converts and scales video on the GPU with a Vulkan compute shader",
+      "The GStreamer developers");
+
+  gst_element_class_add_static_pad_template (gstelement_class,
+      &gst_vulkan_color_convert_sink_template);
+  gst_element_class_add_static_pad_template (gstelement_class,
+      &gst_vulkan_color_convert_src_template);
+
+  gstelement_class->change_state = gst_vulkan_color_convert_change_state;
+  gstelement_class->set_context = gst_vulkan_color_convert_set_context;
+
+  gstbasetransform_class->passthrough_on_same_caps = TRUE;
+  gstbasetransform_class->query =
+      GST_DEBUG_FUNCPTR (gst_vulkan_color_convert_query);
+  gstbasetransform_class->transform_caps =
+      gst_vulkan_color_convert_transform_caps;
+  gstbasetransform_class->fixate_caps = gst_vulkan_color_convert_fixate_caps;
+  gstbasetransform_class->set_caps = gst_vulkan_color_convert_set_caps;
+  gstbasetransform_class->propose_allocation =
+      gst_vulkan_color_convert_propose_allocation;
+  gstbasetransform_class->decide_allocation =
+      gst_vulkan_color_convert_decide_allocation;
+  gstbasetransform_class->stop = gst_vulkan_color_convert_stop;
+  gstbasetransform_class->transform = gst_vulkan_color_convert_transform;
+}
+
+static void
+gst_vulkan_color_convert_init (GstVulkanColorConvert * conv)
+{
+}
+
+static gboolean
+gst_vulkan_color_convert_query (GstBaseTransform * bt,
+    GstPadDirection direction, GstQuery * query)
+{
+  GstVulkanColorConvert *conv = GST_VULKAN_COLOR_CONVERT (bt);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:{
+      if (gst_vulkan_handle_context_query (GST_ELEMENT (conv), query,
+              &conv->display, &conv->instance, &conv->device))
+        return TRUE;
+      break;
+    }
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->query (bt, direction, query);
+}
+
+static void
+gst_vulkan_color_convert_set_context (GstElement * element,
+    GstContext * context)
+{
+  GstVulkanColorConvert *conv = GST_VULKAN_COLOR_CONVERT (element);
+
+  gst_vulkan_handle_set_context (element, context, &conv->display,
+      &conv->instance);
+
+  GST_ELEMENT_CLASS (parent_class)->set_context (element, context);
+}
+
+static GstStateChangeReturn
+gst_vulkan_color_convert_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstVulkanColorConvert *conv = GST_VULKAN_COLOR_CONVERT (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_vulkan_ensure_element_data (element, &conv->display,
+              &conv->instance)) {
+        GST_ELEMENT_ERROR (conv, RESOURCE, NOT_FOUND,
+            ("Failed to retrieve vulkan instance/display"), (NULL));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      if (!gst_vulkan_device_run_context_query (element, &conv->device)) {
+        GST_ELEMENT_ERROR (conv, RESOURCE, NOT_FOUND,
+            ("Failed to retrieve vulkan device"), (NULL));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      if (conv->display)
+        gst_object_unref (conv->display);
+      conv->display = NULL;
+      if (conv->device)
+        gst_object_unref (conv->device);
+      conv->device = NULL;
+      if (conv->instance)
+        gst_object_unref (conv->instance);
+      conv->instance = NULL;
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+static GstCaps *
+gst_vulkan_color_convert_transform_caps (GstBaseTransform * bt,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter)
+{
+  GstCaps *result;
+  guint i, n;
+
+  /* any format and size can be converted to any other */
+  result = gst_caps_copy (caps);
+  n = gst_caps_get_size (result);
+  for (i = 0; i < n; i++) {
+    GstStructure *s = gst_caps_get_structure (result, i);
+
+    gst_structure_set (s, "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+        "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+    gst_structure_remove_fields (s, "format", "colorimetry", "chroma-site",
+        "pixel-aspect-ratio", NULL);
+  }
+
+  if (filter) {
+    GstCaps *tmp =
+        gst_caps_intersect_full (filter, result, GST_CAPS_INTERSECT_FIRST);
+
+    gst_caps_unref (result);
+    result = tmp;
+  }
+
+  return result;
+}
+
+static GstCaps *
+gst_vulkan_color_convert_fixate_caps (GstBaseTransform * bt,
+    GstPadDirection direction, GstCaps * caps, GstCaps * othercaps)
+{
+  GstStructure *in_s, *out_s;
+  const gchar *format;
+  gint v;
+
+  /* stay as close as possible to the other side */
+  othercaps = gst_caps_truncate (othercaps);
+  othercaps = gst_caps_make_writable (othercaps);
+
+  in_s = gst_caps_get_structure (caps, 0);
+  out_s = gst_caps_get_structure (othercaps, 0);
+
+  if ((format = gst_structure_get_string (in_s, "format")))
+    gst_structure_fixate_field_string (out_s, "format", format);
+  if (gst_structure_get_int (in_s, "width", &v))
+    gst_structure_fixate_field_nearest_int (out_s, "width", v);
+  if (gst_structure_get_int (in_s, "height", &v))
+    gst_structure_fixate_field_nearest_int (out_s, "height", v);
+
+  return gst_caps_fixate (othercaps);
+}
+
+static gint
+_shader_format (GstVideoFormat format)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_RGBA:
+    case GST_VIDEO_FORMAT_RGBx:
+      return SHADER_FORMAT_RGBA;
+    case GST_VIDEO_FORMAT_BGRA:
+    case GST_VIDEO_FORMAT_BGRx:
+      return SHADER_FORMAT_BGRA;
+    case GST_VIDEO_FORMAT_I420:
+      return SHADER_FORMAT_I420;
+    case GST_VIDEO_FORMAT_NV12:
+      return SHADER_FORMAT_NV12;
+    case GST_VIDEO_FORMAT_YUY2:
+      return SHADER_FORMAT_YUY2;
+    default:
+      g_assert_not_reached ();
+      return -1;
+  }
+}
+
+static void
+_fill_coeffs (const GstVideoInfo * info, gfloat coeffs[4])
+{
+  gdouble Kr = 0.299, Kb = 0.114;
+
+  if (GST_VIDEO_INFO_IS_YUV (info))
+    gst_video_color_matrix_get_Kr_Kb (info->colorimetry.matrix, &Kr, &Kb);
+
+  coeffs[0] = Kr;
+  coeffs[1] = Kb;
+  coeffs[2] = info->colorimetry.range == GST_VIDEO_COLOR_RANGE_0_255;
+  coeffs[3] = 0.0;
+}
+
+static void
+_destroy_pipeline (GstVulkanColorConvert * conv)
+{
+  VkDevice device;
+
+  if (!conv->device)
+    return;
+  device = conv->device->device;
+
+  if (conv->pipeline)
+    vkDestroyPipeline (device, conv->pipeline, NULL);
+  conv->pipeline = VK_NULL_HANDLE;
+  if (conv->pipeline_layout)
+    vkDestroyPipelineLayout (device, conv->pipeline_layout, NULL);
+  conv->pipeline_layout = VK_NULL_HANDLE;
+  if (conv->descriptor_pool)
+    vkDestroyDescriptorPool (device, conv->descriptor_pool, NULL);
+  conv->descriptor_pool = VK_NULL_HANDLE;
+  if (conv->descriptor_set_layout)
+    vkDestroyDescriptorSetLayout (device, conv->descriptor_set_layout, NULL);
+  conv->descriptor_set_layout = VK_NULL_HANDLE;
+  if (conv->shader)
+    vkDestroyShaderModule (device, conv->shader, NULL);
+  conv->shader = VK_NULL_HANDLE;
+  if (conv->cmd_pool)
+    vkDestroyCommandPool (device, conv->cmd_pool, NULL);
+  conv->cmd_pool = VK_NULL_HANDLE;
+
+  if (conv->queue)
+    gst_object_unref (conv->queue);
+  conv->queue = NULL;
+}
+
+static gboolean
+_ensure_pipeline (GstVulkanColorConvert * conv, GError ** error)
+{
+  VkDevice device = conv->device->device;
+  VkResult err;
+
+  if (conv->pipeline)
+    return TRUE;
+
+  conv->queue = gst_vulkan_device_get_queue (conv->device,
+      conv->device->queue_family_id, 0);
+
+  {
+    VkCommandPoolCreateInfo info = { 0, };
+
+    /* our own pool, command pools can't be shared between threads */
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    info.queueFamilyIndex = conv->device->queue_family_id;
+    info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    err = vkCreateCommandPool (device, &info, NULL, &conv->cmd_pool);
+    if (gst_vulkan_error_to_g_error (err, error, "vkCreateCommandPool") < 0)
+      goto error;
+  }
+
+  {
+    VkShaderModuleCreateInfo info = { 0, };
+
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.codeSize = sizeof (colorconvert_spv);
+    info.pCode = colorconvert_spv;
+
+    err = vkCreateShaderModule (device, &info, NULL, &conv->shader);
+    if (gst_vulkan_error_to_g_error (err, error, "vkCreateShaderModule") < 0)
+      goto error;
+  }
+
+  {
+    VkDescriptorSetLayoutBinding bindings[N_BINDINGS];
+    VkDescriptorSetLayoutCreateInfo info = { 0, };
+    guint i;
+
+    memset (bindings, 0, sizeof (bindings));
+    for (i = 0; i < N_BINDINGS; i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    info.bindingCount = N_BINDINGS;
+    info.pBindings = bindings;
+
+    err = vkCreateDescriptorSetLayout (device, &info, NULL,
+        &conv->descriptor_set_layout);
+    if (gst_vulkan_error_to_g_error (err, error,
+            "vkCreateDescriptorSetLayout") < 0)
+      goto error;
+  }
+
+  {
+    VkDescriptorPoolSize size = { 0, };
+    VkDescriptorPoolCreateInfo info = { 0, };
+
+    size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    size.descriptorCount = N_BINDINGS * MAX_DESCRIPTOR_SETS;
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    info.maxSets = MAX_DESCRIPTOR_SETS;
+    info.poolSizeCount = 1;
+    info.pPoolSizes = &size;
+
+    err = vkCreateDescriptorPool (device, &info, NULL, &conv->descriptor_pool);
+    if (gst_vulkan_error_to_g_error (err, error, "vkCreateDescriptorPool") < 0)
+      goto error;
+  }
+
+  {
+    VkPushConstantRange range = { 0, };
+    VkPipelineLayoutCreateInfo info = { 0, };
+
+    range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    range.offset = 0;
+    range.size = sizeof (ColorConvertParams);
+
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    info.setLayoutCount = 1;
+    info.pSetLayouts = &conv->descriptor_set_layout;
+    info.pushConstantRangeCount = 1;
+    info.pPushConstantRanges = &range;
+
+    err = vkCreatePipelineLayout (device, &info, NULL, &conv->pipeline_layout);
+    if (gst_vulkan_error_to_g_error (err, error, "vkCreatePipelineLayout") < 0)
+      goto error;
+  }
+
+  {
+    VkComputePipelineCreateInfo info = { 0, };
+
+    info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    info.stage.module = conv->shader;
+    info.stage.pName = "main";
+    info.layout = conv->pipeline_layout;
+
+    err = vkCreateComputePipelines (device, VK_NULL_HANDLE, 1, &info, NULL,
+        &conv->pipeline);
+    if (gst_vulkan_error_to_g_error (err, error,
+            "vkCreateComputePipelines") < 0)
+      goto error;
+  }
+
+  return TRUE;
+
+error:
+  _destroy_pipeline (conv);
+  return FALSE;
+}
+
+static gboolean
+gst_vulkan_color_convert_set_caps (GstBaseTransform * bt, GstCaps * in_caps,
+    GstCaps * out_caps)
+{
+  GstVulkanColorConvert *conv = GST_VULKAN_COLOR_CONVERT (bt);
+  GError *error = NULL;
+
+  if (!gst_video_info_from_caps (&conv->in_info, in_caps))
+    return FALSE;
+  if (!gst_video_info_from_caps (&conv->out_info, out_caps))
+    return FALSE;
+
+  if (gst_base_transform_is_passthrough (bt))
+    return TRUE;
+
+  if (!_ensure_pipeline (conv, &error)) {
+    GST_ELEMENT_ERROR (conv, RESOURCE, NOT_FOUND,
+        ("Failed to create the conversion pipeline: %s", error->message),
+        (NULL));
+    g_clear_error (&error);
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (conv, "converting %" GST_PTR_FORMAT " to %"
+      GST_PTR_FORMAT, in_caps, out_caps);
+
+  return TRUE;
+}
+
+static gboolean
+gst_vulkan_color_convert_propose_allocation (GstBaseTransform * bt,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstVulkanColorConvert *conv = GST_VULKAN_COLOR_CONVERT (bt);
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstVideoInfo info;
+  gboolean need_pool;
+  GstCaps *caps;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return FALSE;
+
+  if (!need_pool) {
+    gst_query_add_allocation_pool (query, NULL, info.size, 1, 0);
+    return TRUE;
+  }
+
+  pool = gst_vulkan_buffer_pool_new (conv->device);
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, info.size, 0, 0);
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    gst_object_unref (pool);
+    return FALSE;
+  }
+
+  gst_query_add_allocation_pool (query, pool, info.size, 1, 0);
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+static gboolean
+gst_vulkan_color_convert_decide_allocation (GstBaseTransform * bt,
+    GstQuery * query)
+{
+  GstVulkanColorConvert *conv = GST_VULKAN_COLOR_CONVERT (bt);
+  GstBufferPool *pool = NULL;
+  GstStructure *config;
+  guint min = 0, max = 0, size;
+  gboolean update_pool;
+  GstCaps *caps;
+
+  gst_query_parse_allocation (query, &caps, NULL);
+  if (caps == NULL)
+    return FALSE;
+
+  size = conv->out_info.size;
+  update_pool = gst_query_get_n_allocation_pools (query) > 0;
+  if (update_pool) {
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+    if (pool && !GST_IS_VULKAN_BUFFER_POOL (pool)) {
+      gst_object_unref (pool);
+      pool = NULL;
+    }
+  }
+
+  if (!pool)
+    pool = gst_vulkan_buffer_pool_new (conv->device);
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, size, min, max);
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    gst_object_unref (pool);
+    return FALSE;
+  }
+
+  if (update_pool)
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+  else
+    gst_query_add_allocation_pool (query, pool, size, min, max);
+
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+static gboolean
+gst_vulkan_color_convert_stop (GstBaseTransform * bt)
+{
+  _destroy_pipeline (GST_VULKAN_COLOR_CONVERT (bt));
+
+  return TRUE;
+}
+
+static VkBuffer
+_plane_buffer (GstBuffer * buffer, guint plane)
+{
+  GstMemory *mem;
+
+  if (plane >= gst_buffer_n_memory (buffer))
+    return VK_NULL_HANDLE;
+
+  mem = gst_buffer_peek_memory (buffer, plane);
+  if (!gst_is_vulkan_buffer_memory (mem))
+    return VK_NULL_HANDLE;
+
+  return ((GstVulkanBufferMemory *) mem)->buffer;
+}
+
+static gboolean
+_record_cmd (GstVulkanColorConvert * conv, VkCommandBuffer cmd,
+    VkDescriptorSet set, GError ** error)
+{
+  VkCommandBufferBeginInfo begin_info = { 0, };
+  VkMemoryBarrier barrier = { 0, };
+  ColorConvertParams params;
+  VkResult err;
+  guint i;
+
+  memset (&params, 0, sizeof (params));
+  params.in_format = _shader_format (GST_VIDEO_INFO_FORMAT (&conv->in_info));
+  params.out_format = _shader_format (GST_VIDEO_INFO_FORMAT (&conv->out_info));
+  params.in_size[0] = GST_VIDEO_INFO_WIDTH (&conv->in_info);
+  params.in_size[1] = GST_VIDEO_INFO_HEIGHT (&conv->in_info);
+  params.out_size[0] = GST_VIDEO_INFO_WIDTH (&conv->out_info);
+  params.out_size[1] = GST_VIDEO_INFO_HEIGHT (&conv->out_info);
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&conv->in_info); i++)
+    params.in_strides[i] = GST_VIDEO_INFO_PLANE_STRIDE (&conv->in_info, i);
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&conv->out_info); i++)
+    params.out_strides[i] = GST_VIDEO_INFO_PLANE_STRIDE (&conv->out_info, i);
+  _fill_coeffs (&conv->in_info, params.in_coeffs);
+  _fill_coeffs (&conv->out_info, params.out_coeffs);
+
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  err = vkBeginCommandBuffer (cmd, &begin_info);
+  if (gst_vulkan_error_to_g_error (err, error, "vkBeginCommandBuffer") < 0)
+    return FALSE;
+
+  vkCmdBindPipeline (cmd, VK_PIPELINE_BIND_POINT_COMPUTE, conv->pipeline);
+  vkCmdBindDescriptorSets (cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+      conv->pipeline_layout, 0, 1, &set, 0, NULL);
+
+  /* one dispatch per output plane, one invocation per 32 bit word */
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&conv->out_info); i++) {
+    guint words = params.out_strides[i] / 4;
+    guint rows = GST_VIDEO_INFO_COMP_HEIGHT (&conv->out_info, i);
+
+    params.plane = i;
+    vkCmdPushConstants (cmd, conv->pipeline_layout,
+        VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof (params), &params);
+    vkCmdDispatch (cmd, (words + GROUP_SIZE - 1) / GROUP_SIZE,
+        (rows + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+  }
+
+  /* the output is then copied to the swapchain, read by another shader or
+   * mapped */
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT |
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier (cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+      VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+  err = vkEndCommandBuffer (cmd);
+  if (gst_vulkan_error_to_g_error (err, error, "vkEndCommandBuffer") < 0)
+    return FALSE;
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_vulkan_color_convert_transform (GstBaseTransform * bt, GstBuffer * inbuf,
+    GstBuffer * outbuf)
+{
+  GstVulkanColorConvert *conv = GST_VULKAN_COLOR_CONVERT (bt);
+  VkDevice device = conv->device->device;
+  VkDescriptorBufferInfo buffer_infos[N_BINDINGS];
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  VkCommandBuffer cmd = VK_NULL_HANDLE;
+  GstVulkanFence *fence = NULL;
+  GError *error = NULL;
+  VkResult err;
+  guint i;
+
+  memset (buffer_infos, 0, sizeof (buffer_infos));
+  for (i = 0; i < N_BINDINGS / 2; i++) {
+    guint in_plane = MIN (i, GST_VIDEO_INFO_N_PLANES (&conv->in_info) - 1);
+    guint out_plane = MIN (i, GST_VIDEO_INFO_N_PLANES (&conv->out_info) - 1);
+
+    /* unused bindings point to the last plane */
+    buffer_infos[i].buffer = _plane_buffer (inbuf, in_plane);
+    buffer_infos[i].range = VK_WHOLE_SIZE;
+    buffer_infos[i + 3].buffer = _plane_buffer (outbuf, out_plane);
+    buffer_infos[i + 3].range = VK_WHOLE_SIZE;
+
+    if (!buffer_infos[i].buffer || !buffer_infos[i + 3].buffer) {
+      GST_ELEMENT_ERROR (conv, RESOURCE, NOT_FOUND,
+          ("Buffers are not backed by Vulkan buffer memory"), (NULL));
+      return GST_FLOW_ERROR;
+    }
+  }
+
+  {
+    VkDescriptorSetAllocateInfo info = { 0, };
+    VkWriteDescriptorSet write = { 0, };
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.descriptorPool = conv->descriptor_pool;
+    info.descriptorSetCount = 1;
+    info.pSetLayouts = &conv->descriptor_set_layout;
+
+    err = vkAllocateDescriptorSets (device, &info, &set);
+    if (gst_vulkan_error_to_g_error (err, &error,
+            "vkAllocateDescriptorSets") < 0)
+      goto error;
+
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.dstBinding = 0;
+    write.descriptorCount = N_BINDINGS;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = buffer_infos;
+    vkUpdateDescriptorSets (device, 1, &write, 0, NULL);
+  }
+
+  {
+    VkCommandBufferAllocateInfo info = { 0, };
+
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    info.commandPool = conv->cmd_pool;
+    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    info.commandBufferCount = 1;
+
+    err = vkAllocateCommandBuffers (device, &info, &cmd);
+    if (gst_vulkan_error_to_g_error (err, &error,
+            "vkAllocateCommandBuffers") < 0)
+      goto error;
+  }
+
+  if (!_record_cmd (conv, cmd, set, &error))
+    goto error;
+
+  fence = gst_vulkan_fence_new (conv->device, 0, &error);
+  if (!fence)
+    goto error;
+
+  {
+    VkSubmitInfo submit_info = { 0, };
+
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &cmd;
+
+    gst_vulkan_device_lock_queues (conv->device);
+    err = vkQueueSubmit (conv->queue->queue, 1, &submit_info,
+        GST_VULKAN_FENCE_FENCE (fence));
+    gst_vulkan_device_unlock_queues (conv->device);
+    if (gst_vulkan_error_to_g_error (err, &error, "vkQueueSubmit") < 0)
+      goto error;
+  }
+
+  /* buffers carry no synchronisation primitives downstream, the frame has
+   * to be complete when it is pushed */
+  err = vkWaitForFences (device, 1, &GST_VULKAN_FENCE_FENCE (fence), TRUE,
+      G_MAXUINT64);
+  if (gst_vulkan_error_to_g_error (err, &error, "vkWaitForFences") < 0)
+    goto error;
+
+  gst_vulkan_fence_unref (fence);
+  vkFreeCommandBuffers (device, conv->cmd_pool, 1, &cmd);
+  vkFreeDescriptorSets (device, conv->descriptor_pool, 1, &set);
+
+  return GST_FLOW_OK;
+
+error:
+  {
+    GST_ELEMENT_ERROR (conv, LIBRARY, FAILED, ("%s", error->message), (NULL));
+    g_clear_error (&error);
+
+    /* make sure nothing is still using what is freed */
+    if (fence) {
+      vkWaitForFences (device, 1, &GST_VULKAN_FENCE_FENCE (fence), TRUE,
+          G_MAXUINT64);
+      gst_vulkan_fence_unref (fence);
+    }
+    if (cmd)
+      vkFreeCommandBuffers (device, conv->cmd_pool, 1, &cmd);
+    if (set)
+      vkFreeDescriptorSets (device, conv->descriptor_pool, 1, &set);
+
+    return GST_FLOW_ERROR;
+  }
+}
@@ -38,6 +38,15 @@ static const char *device_validation_layers[] = {
   "VK_LAYER_LUNARG_image",
 };
 
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+/* all of them are needed to import dmabufs as device memory */
+static const char *dmabuf_import_extensions[] = {
+  VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
+  VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME,
+  VK_EXT_EXTERNAL_MEMORY_DMA_BUF_EXTENSION_NAME,
+};
+#endif
+
 #define GST_CAT_DEFAULT gst_vulkan_device_debug
 GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_CONTEXT);
@@ -53,6 +62,12 @@ static void gst_vulkan_device_finalize (GObject * object);
 struct _GstVulkanDevicePrivate
 {
   gboolean opened;
+  gboolean dmabuf_import;
+
+  /* queues have to be externally synchronised */
+  GMutex queue_lock;
+
+  GstVulkanMemoryArena *arena;
 };
 
 GstVulkanDevice *
@@ -74,6 +89,8 @@ gst_vulkan_device_init (GstVulkanDevice * device)
 {
   device->priv = G_TYPE_INSTANCE_GET_PRIVATE ((device),
       GST_TYPE_VULKAN_DEVICE, GstVulkanDevicePrivate);
+
+  g_mutex_init (&device->priv->queue_lock);
 }
 
 static void
@@ -94,6 +111,10 @@ gst_vulkan_device_finalize (GObject * object)
   g_free (device->queue_family_props);
   device->queue_family_props = NULL;
 
+  if (device->priv->arena)
+    gst_vulkan_memory_arena_free (device->priv->arena);
+  device->priv->arena = NULL;
+
   if (device->cmd_pool)
     vkDestroyCommandPool (device->device, device->cmd_pool, NULL);
   device->cmd_pool = VK_NULL_HANDLE;
@@ -108,6 +129,8 @@ gst_vulkan_device_finalize (GObject * object)
     gst_object_unref (device->instance);
   device->instance = VK_NULL_HANDLE;
 
+  g_mutex_clear (&device->priv->queue_lock);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -169,6 +192,9 @@ gst_vulkan_device_open (GstVulkanDevice * device, GError ** error)
   uint32_t device_layer_count = 0;
   VkLayerProperties *device_layers;
   gboolean have_swapchain_ext;
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+  guint n_dmabuf_exts = 0;
+#endif
   VkPhysicalDevice gpu;
   VkResult err;
   guint i;
@@ -241,8 +267,28 @@ gst_vulkan_device_open (GstVulkanDevice * device, GError ** error)
       extension_names[enabled_extension_count++] =
           (gchar *) VK_KHR_SWAPCHAIN_EXTENSION_NAME;
     }
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+    {
+      guint j;
+
+      for (j = 0; j < G_N_ELEMENTS (dmabuf_import_extensions); j++) {
+        if (!strcmp (dmabuf_import_extensions[j],
+                device_extensions[i].extensionName))
+          n_dmabuf_exts++;
+      }
+    }
+#endif
     g_assert (enabled_extension_count < 64);
   }
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+  if (n_dmabuf_exts == G_N_ELEMENTS (dmabuf_import_extensions)) {
+    for (i = 0; i < n_dmabuf_exts; i++)
+      extension_names[enabled_extension_count++] = dmabuf_import_extensions[i];
+    device->priv->dmabuf_import = TRUE;
+  }
+  GST_DEBUG_OBJECT (device, "dmabuf import %ssupported",
+      device->priv->dmabuf_import ? "" : "not ");
+#endif
   if (!have_swapchain_ext) {
     g_set_error_literal (error, GST_VULKAN_ERROR,
         VK_ERROR_EXTENSION_NOT_PRESENT,
@@ -314,6 +360,8 @@ gst_vulkan_device_open (GstVulkanDevice * device, GError ** error)
   }
   g_strfreev (enabled_layers);
 
+  device->priv->arena = gst_vulkan_memory_arena_new (device);
+
   {
     VkCommandPoolCreateInfo cmd_pool_info = { 0, };
 
@@ -439,6 +487,87 @@ gst_vulkan_device_create_cmd_buffer (GstVulkanDevice * device,
   return TRUE;
 }
 
+/**
+ * gst_vulkan_device_lock_queues:
+ * @device: a #GstVulkanDevice
+ *
+ * Locks the queues of @device, to be held around vkQueueSubmit() and
+ * vkQueuePresentKHR() as elements submit from their own threads.
+ *
+ * Since: 1.16
+ */
+void
+gst_vulkan_device_lock_queues (GstVulkanDevice * device)
+{
+  g_return_if_fail (GST_IS_VULKAN_DEVICE (device));
+
+  g_mutex_lock (&device->priv->queue_lock);
+}
+
+/**
+ * gst_vulkan_device_unlock_queues:
+ * @device: a #GstVulkanDevice
+ *
+ * Releases the lock taken with gst_vulkan_device_lock_queues().
+ *
+ * Since: 1.16
+ */
+void
+gst_vulkan_device_unlock_queues (GstVulkanDevice * device)
+{
+  g_return_if_fail (GST_IS_VULKAN_DEVICE (device));
+
+  g_mutex_unlock (&device->priv->queue_lock);
+}
+
+/* Returns the arena device memory is sub-allocated from, only valid while
+ * the device is opened */
+GstVulkanMemoryArena *
+gst_vulkan_device_get_memory_arena (GstVulkanDevice * device)
+{
+  g_return_val_if_fail (GST_IS_VULKAN_DEVICE (device), NULL);
+
+  return device->priv->arena;
+}
+
+/**
+ * gst_vulkan_device_can_import_dmabuf:
+ * @device: a #GstVulkanDevice
+ *
+ * Returns: whether dmabufs can be imported as device memory of @device with
+ *     gst_vulkan_memory_import_dmabuf()
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_vulkan_device_can_import_dmabuf (GstVulkanDevice * device)
+{
+  g_return_val_if_fail (GST_IS_VULKAN_DEVICE (device), FALSE);
+
+  return device->priv->dmabuf_import;
+}
+
+/**
+ * gst_vulkan_device_get_memory_stats:
+ * @device: a #GstVulkanDevice
+ *
+ * Returns: (transfer full) (nullable): a #GstStructure describing how much
+ *     device memory is allocated, used and how fragmented it is, or %NULL
+ *     if @device is not opened
+ *
+ * Since: 1.16
+ */
+GstStructure *
+gst_vulkan_device_get_memory_stats (GstVulkanDevice * device)
+{
+  g_return_val_if_fail (GST_IS_VULKAN_DEVICE (device), NULL);
+
+  if (!device->priv->arena)
+    return NULL;
+
+  return gst_vulkan_memory_arena_get_stats (device->priv->arena);
+}
+
 /**
  * gst_context_set_vulkan_device:
  * @context: a #GstContext
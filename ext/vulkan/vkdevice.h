@@ -83,6 +83,11 @@ VkPhysicalDevice    gst_vulkan_device_get_physical_device   (GstVulkanDevice * d
 gboolean            gst_vulkan_device_create_cmd_buffer     (GstVulkanDevice * device,
                                                              VkCommandBuffer * cmd,
                                                              GError ** error);
+GstVulkanMemoryArena * gst_vulkan_device_get_memory_arena   (GstVulkanDevice * device);
+gboolean            gst_vulkan_device_can_import_dmabuf     (GstVulkanDevice * device);
+void                gst_vulkan_device_lock_queues           (GstVulkanDevice * device);
+void                gst_vulkan_device_unlock_queues         (GstVulkanDevice * device);
+GstStructure *      gst_vulkan_device_get_memory_stats      (GstVulkanDevice * device);
 
 void                gst_context_set_vulkan_device           (GstContext * context,
                                                              GstVulkanDevice * device);
@@ -227,7 +227,8 @@ _vk_image_mem_new_alloc (GstAllocator * allocator, GstMemory * parent,
   if (!mem->vk_mem)
     goto error;
 
-  err = vkBindImageMemory (device->device, image, mem->vk_mem->mem_ptr, 0);
+  err = vkBindImageMemory (device->device, image, mem->vk_mem->mem_ptr,
+      mem->vk_mem->vk_offset);
   if (gst_vulkan_error_to_g_error (err, &error, "vkBindImageMemory") < 0)
     goto vk_error;
 
@@ -266,6 +266,19 @@ gst_vulkan_instance_open (GstVulkanInstance * instance, GError ** error)
         extension_names[enabled_extension_count++] =
             (gchar *) VK_EXT_DEBUG_REPORT_EXTENSION_NAME;
       }
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+      /* needed by the device's external memory extensions */
+      if (!g_strcmp0 (VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
+              instance_extensions[i].extensionName)) {
+        extension_names[enabled_extension_count++] =
+            (gchar *) VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+      }
+      if (!g_strcmp0 (VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME,
+              instance_extensions[i].extensionName)) {
+        extension_names[enabled_extension_count++] =
+            (gchar *) VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME;
+      }
+#endif
       if (!g_strcmp0 (winsys_ext_name, instance_extensions[i].extensionName)) {
         winsys_ext_found = TRUE;
         extension_names[enabled_extension_count++] = (gchar *) winsys_ext_name;
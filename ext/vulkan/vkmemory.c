@@ -23,6 +23,7 @@
 #endif
 
 #include <string.h>
+#include <unistd.h>
 
 #include "vkmemory.h"
 
@@ -134,6 +135,7 @@ _vk_mem_new (GstAllocator * allocator, GstMemory * parent,
     GDestroyNotify notify)
 {
   GstVulkanMemory *mem = g_new0 (GstVulkanMemory, 1);
+  GstVulkanMemoryArena *arena;
   GError *error = NULL;
   VkResult err;
 
@@ -150,6 +152,40 @@ _vk_mem_new (GstAllocator * allocator, GstMemory * parent,
     return NULL;
   }
 
+  arena = gst_vulkan_device_get_memory_arena (device);
+  if (arena)
+    gst_vulkan_memory_arena_track_dedicated (arena,
+        mem->alloc_info.allocationSize, TRUE);
+
+  return mem;
+}
+
+static GstVulkanMemory *
+_vk_mem_new_suballocated (GstAllocator * allocator, GstVulkanDevice * device,
+    GstVulkanMemoryArena * arena, guint32 memory_type_index,
+    GstAllocationParams * params, gsize size,
+    VkMemoryPropertyFlags mem_props_flags)
+{
+  GstVulkanMemory *mem = g_new0 (GstVulkanMemory, 1);
+  VkDeviceSize offset, reserved;
+
+  _vk_mem_init (mem, allocator, NULL, device, memory_type_index, params,
+      size, mem_props_flags, NULL, NULL);
+
+  mem->block = gst_vulkan_memory_arena_alloc (arena, memory_type_index,
+      mem->alloc_info.allocationSize, GST_MEMORY_CAST (mem)->align + 1,
+      &offset, &reserved);
+  if (!mem->block) {
+    GST_CAT_ERROR (GST_CAT_VULKAN_MEMORY, "Failed to sub-allocate device "
+        "memory");
+    gst_memory_unref ((GstMemory *) mem);
+    return NULL;
+  }
+
+  mem->mem_ptr = mem->block->memory;
+  mem->vk_offset = offset;
+  mem->alloc_info.allocationSize = reserved;
+
   return mem;
 }
 
@@ -165,6 +201,15 @@ _vk_mem_map_full (GstVulkanMemory * mem, GstMapInfo * info, gsize size)
     return NULL;
   }
 
+  if (mem->block) {
+    if (!mem->block->data) {
+      GST_CAT_ERROR (GST_CAT_VULKAN_MEMORY, "Memory block is not mapped");
+      return NULL;
+    }
+
+    return (guint8 *) mem->block->data + mem->vk_offset;
+  }
+
   err = vkMapMemory (mem->device->device, mem->mem_ptr, mem->vk_offset,
       size, 0, &data);
   if (gst_vulkan_error_to_g_error (err, &error, "vkMapMemory") < 0) {
@@ -180,7 +225,9 @@ _vk_mem_map_full (GstVulkanMemory * mem, GstMapInfo * info, gsize size)
 static void
 _vk_mem_unmap_full (GstVulkanMemory * mem, GstMapInfo * info)
 {
-  vkUnmapMemory (mem->device->device, mem->mem_ptr);
+  /* blocks stay mapped for as long as they exist */
+  if (!mem->block)
+    vkUnmapMemory (mem->device->device, mem->mem_ptr);
 }
 
 static GstMemory *
@@ -201,7 +248,8 @@ _vk_mem_share (GstVulkanMemory * mem, gssize offset, gsize size)
 
   g_return_val_if_fail (size > 0, NULL);
 
-  while ((parent = (GstVulkanMemory *) (GST_MEMORY_CAST (parent)->parent)));
+  while (GST_MEMORY_CAST (parent)->parent)
+    parent = (GstVulkanMemory *) GST_MEMORY_CAST (parent)->parent;
 
   params.flags = GST_MEMORY_FLAGS (mem);
   params.align = GST_MEMORY_CAST (parent)->align;
@@ -212,6 +260,7 @@ _vk_mem_share (GstVulkanMemory * mem, gssize offset, gsize size)
   shared->mem_ptr = parent->mem_ptr;
   shared->wrapped = TRUE;
   shared->vk_offset = offset + mem->vk_offset;
+  shared->block = parent->block;
 
   return GST_MEMORY_CAST (shared);
 }
@@ -244,8 +293,18 @@ _vk_mem_free (GstAllocator * allocator, GstMemory * memory)
   if (mem->notify)
     mem->notify (mem->user_data);
 
-  if (mem->mem_ptr && !mem->wrapped)
+  if (mem->block && !mem->wrapped) {
+    gst_vulkan_memory_arena_release (mem->block->arena, mem->block,
+        mem->vk_offset, mem->alloc_info.allocationSize);
+  } else if (mem->mem_ptr && !mem->wrapped) {
+    GstVulkanMemoryArena *arena =
+        gst_vulkan_device_get_memory_arena (mem->device);
+
     vkFreeMemory (mem->device->device, mem->mem_ptr, NULL);
+    if (arena)
+      gst_vulkan_memory_arena_track_dedicated (arena,
+          mem->alloc_info.allocationSize, FALSE);
+  }
 
   gst_object_unref (mem->device);
 }
@@ -280,7 +339,9 @@ gst_vulkan_memory_find_memory_type_index_with_type_properties (GstVulkanDevice *
  * @params: a #GstAllocationParams
  * @size: the size to allocate
  *
- * Allocated a new #GstVulkanMemory.
+ * Allocated a new #GstVulkanMemory.  Small allocations are sub-allocated
+ * from the memory blocks of @device, larger ones get their own device
+ * memory.
  *
  * Returns: a #GstMemory object backed by a vulkan device memory
  */
@@ -288,13 +349,113 @@ GstMemory *
 gst_vulkan_memory_alloc (GstVulkanDevice * device, guint32 memory_type_index,
     GstAllocationParams * params, gsize size, VkMemoryPropertyFlags mem_flags)
 {
+  GstVulkanMemoryArena *arena = gst_vulkan_device_get_memory_arena (device);
+  GstVulkanMemory *mem;
+
+  if (arena && gst_vulkan_memory_arena_can_suballocate (arena,
+          memory_type_index, size))
+    mem = _vk_mem_new_suballocated (_vulkan_memory_allocator, device, arena,
+        memory_type_index, params, size, mem_flags);
+  else
+    mem = _vk_mem_new (_vulkan_memory_allocator, NULL, device,
+        memory_type_index, params, size, mem_flags, NULL, NULL);
+
+  return (GstMemory *) mem;
+}
+
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+/**
+ * gst_vulkan_memory_import_dmabuf:
+ * @device: a #GstVulkanDevice
+ * @fd: the dmabuf file descriptor
+ * @size: the size of the dmabuf
+ * @type_bits: the memory types the memory will be bound to may use
+ *
+ * Imports the dmabuf @fd as device memory without copying it.  @fd is not
+ * consumed, the device keeps its own duplicate for as long as the memory
+ * exists.  @device has to support gst_vulkan_device_can_import_dmabuf().
+ *
+ * Returns: a #GstMemory object backed by the dmabuf or %NULL
+ *
+ * Since: 1.16
+ */
+GstMemory *
+gst_vulkan_memory_import_dmabuf (GstVulkanDevice * device, gint fd,
+    gsize size, guint32 type_bits)
+{
+  PFN_vkGetMemoryFdPropertiesKHR get_fd_props;
+  VkMemoryFdPropertiesKHR fd_props = { 0, };
+  VkImportMemoryFdInfoKHR import_info = { 0, };
+  GstVulkanMemoryArena *arena;
   GstVulkanMemory *mem;
+  GError *error = NULL;
+  guint32 type_idx;
+  VkResult err;
+
+  g_return_val_if_fail (gst_vulkan_device_can_import_dmabuf (device), NULL);
 
-  mem = _vk_mem_new (_vulkan_memory_allocator, NULL, device, memory_type_index,
-      params, size, mem_flags, NULL, NULL);
+  get_fd_props = (PFN_vkGetMemoryFdPropertiesKHR)
+      gst_vulkan_device_get_proc_address (device,
+      "vkGetMemoryFdPropertiesKHR");
+  if (!get_fd_props)
+    return NULL;
+
+  fd_props.sType = VK_STRUCTURE_TYPE_MEMORY_FD_PROPERTIES_KHR;
+  err = get_fd_props (device->device,
+      VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT, fd, &fd_props);
+  if (gst_vulkan_error_to_g_error (err, &error,
+          "vkGetMemoryFdPropertiesKHR") < 0)
+    goto vk_error;
+
+  type_bits &= fd_props.memoryTypeBits;
+  if (type_bits == 0) {
+    GST_CAT_WARNING (GST_CAT_VULKAN_MEMORY, "No memory type can hold the "
+        "dmabuf");
+    return NULL;
+  }
+  for (type_idx = 0; !(type_bits & (1 << type_idx)); type_idx++);
+
+  mem = g_new0 (GstVulkanMemory, 1);
+  _vk_mem_init (mem, _vulkan_memory_allocator, NULL, device, type_idx, NULL,
+      size, device->memory_properties.memoryTypes[type_idx].propertyFlags,
+      NULL, NULL);
+
+  /* the driver takes ownership of the descriptor on success */
+  import_info.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_FD_INFO_KHR;
+  import_info.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_DMA_BUF_BIT_EXT;
+  import_info.fd = dup (fd);
+  if (import_info.fd < 0) {
+    GST_CAT_ERROR (GST_CAT_VULKAN_MEMORY, "Failed to duplicate dmabuf fd");
+    gst_memory_unref ((GstMemory *) mem);
+    return NULL;
+  }
+
+  mem->alloc_info.pNext = &import_info;
+  err =
+      vkAllocateMemory (device->device, &mem->alloc_info, NULL, &mem->mem_ptr);
+  mem->alloc_info.pNext = NULL;
+  if (gst_vulkan_error_to_g_error (err, &error, "vkAllocMemory") < 0) {
+    close (import_info.fd);
+    gst_memory_unref ((GstMemory *) mem);
+    goto vk_error;
+  }
+
+  arena = gst_vulkan_device_get_memory_arena (device);
+  if (arena)
+    gst_vulkan_memory_arena_track_dedicated (arena,
+        mem->alloc_info.allocationSize, TRUE);
 
   return (GstMemory *) mem;
+
+vk_error:
+  {
+    GST_CAT_ERROR (GST_CAT_VULKAN_MEMORY, "Failed to import dmabuf %s",
+        error->message);
+    g_clear_error (&error);
+    return NULL;
+  }
 }
+#endif
 
 G_DEFINE_TYPE (GstVulkanMemoryAllocator, gst_vulkan_memory_allocator,
     GST_TYPE_ALLOCATOR);
@@ -65,6 +65,10 @@ struct _GstVulkanMemory
    * relation to the root memory */
   guint64                   vk_offset;
   gboolean                  wrapped;
+
+  /* the arena block the memory was sub-allocated from or NULL if it has its
+   * own device memory */
+  GstVulkanMemoryBlock     *block;
 };
 
 /**
@@ -96,6 +100,13 @@ GstMemory *     gst_vulkan_memory_alloc         (GstVulkanDevice * device,
                                                  gsize size,
                                                  VkMemoryPropertyFlags mem_prop_flags);
 
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+GstMemory *     gst_vulkan_memory_import_dmabuf (GstVulkanDevice * device,
+                                                 gint fd,
+                                                 gsize size,
+                                                 guint32 type_bits);
+#endif
+
 gboolean        gst_vulkan_memory_find_memory_type_index_with_type_properties   (GstVulkanDevice * device,
                                                                                  guint32 typeBits,
                                                                                  VkMemoryPropertyFlags properties,
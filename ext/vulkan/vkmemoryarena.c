@@ -0,0 +1,446 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "vkmemoryarena.h"
+
+/*
+ * GstVulkanMemoryArena sub-allocates the device memory of a #GstVulkanDevice
+ * from a few large blocks per memory type instead of calling
+ * vkAllocateMemory() for every buffer and image, which is slow and limited
+ * to maxMemoryAllocationCount allocations per device.
+ *
+ * Each block keeps a list of its free ranges sorted by offset.  Allocations
+ * take the first range that fits and releases merge the range back with its
+ * neighbours.  Offsets and sizes are rounded to bufferImageGranularity so
+ * that linear and optimal resources never share a page, and to
+ * nonCoherentAtomSize for host visible memory that is not coherent.
+ */
+
+#define GST_CAT_DEFAULT gst_vulkan_memory_arena_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+#define ALIGN_UP(v,a) ((((v) + (a) - 1) / (a)) * (a))
+
+typedef struct
+{
+  VkDeviceSize offset;
+  VkDeviceSize size;
+} GstVulkanMemoryRange;
+
+struct _GstVulkanMemoryArena
+{
+  /* not a reference, the device owns the arena */
+  GstVulkanDevice *device;
+
+  GMutex lock;
+  GList *blocks[VK_MAX_MEMORY_TYPES];
+
+  guint n_dedicated;
+  VkDeviceSize dedicated_size;
+};
+
+GstVulkanMemoryArena *
+gst_vulkan_memory_arena_new (GstVulkanDevice * device)
+{
+  GstVulkanMemoryArena *arena;
+  static volatile gsize _init = 0;
+
+  if (g_once_init_enter (&_init)) {
+    GST_DEBUG_CATEGORY_INIT (gst_vulkan_memory_arena_debug,
+        "vulkanmemoryarena", 0, "Vulkan Memory Arena");
+    g_once_init_leave (&_init, 1);
+  }
+
+  arena = g_new0 (GstVulkanMemoryArena, 1);
+  arena->device = device;
+  g_mutex_init (&arena->lock);
+
+  return arena;
+}
+
+static void
+_block_free (GstVulkanMemoryBlock * block)
+{
+  GstVulkanDevice *device = block->arena->device;
+
+  GST_DEBUG ("freeing block %p of type %u size %" G_GUINT64_FORMAT, block,
+      block->type_index, (guint64) block->size);
+
+  if (block->data)
+    vkUnmapMemory (device->device, block->memory);
+  vkFreeMemory (device->device, block->memory, NULL);
+  g_array_free (block->free_ranges, TRUE);
+  g_free (block);
+}
+
+/* must be called before the device is destroyed and after all the memory
+ * allocated from the arena has been released */
+void
+gst_vulkan_memory_arena_free (GstVulkanMemoryArena * arena)
+{
+  guint i;
+
+  for (i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+    GList *l;
+
+    for (l = arena->blocks[i]; l; l = l->next) {
+      GstVulkanMemoryBlock *block = l->data;
+
+      if (block->n_allocations > 0)
+        GST_WARNING ("block %p still has %u allocations", block,
+            block->n_allocations);
+      _block_free (block);
+    }
+    g_list_free (arena->blocks[i]);
+  }
+
+  g_mutex_clear (&arena->lock);
+  g_free (arena);
+}
+
+static VkDeviceSize
+_block_size (GstVulkanMemoryArena * arena, guint32 type_index)
+{
+  VkPhysicalDeviceMemoryProperties *props = &arena->device->memory_properties;
+  guint32 heap = props->memoryTypes[type_index].heapIndex;
+
+  /* don't let a single block take more than an eighth of a small heap */
+  return MIN (GST_VULKAN_MEMORY_BLOCK_SIZE, props->memoryHeaps[heap].size / 8);
+}
+
+gboolean
+gst_vulkan_memory_arena_can_suballocate (GstVulkanMemoryArena * arena,
+    guint32 type_index, VkDeviceSize size)
+{
+  g_return_val_if_fail (type_index < VK_MAX_MEMORY_TYPES, FALSE);
+
+  return size <= _block_size (arena, type_index) / 2;
+}
+
+static VkDeviceSize
+_granularity (GstVulkanMemoryArena * arena, guint32 type_index)
+{
+  GstVulkanDevice *device = arena->device;
+  VkMemoryPropertyFlags flags =
+      device->memory_properties.memoryTypes[type_index].propertyFlags;
+  VkDeviceSize granularity =
+      MAX (device->gpu_props.limits.bufferImageGranularity, 1);
+
+  if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+      !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+    granularity = MAX (granularity,
+        device->gpu_props.limits.nonCoherentAtomSize);
+
+  return granularity;
+}
+
+static guint
+_device_allocation_count (GstVulkanMemoryArena * arena)
+{
+  guint i, n = arena->n_dedicated;
+
+  for (i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    n += g_list_length (arena->blocks[i]);
+
+  return n;
+}
+
+static GstVulkanMemoryBlock *
+_block_new (GstVulkanMemoryArena * arena, guint32 type_index,
+    VkDeviceSize size)
+{
+  GstVulkanDevice *device = arena->device;
+  GstVulkanMemoryBlock *block;
+  GstVulkanMemoryRange range;
+  VkMemoryAllocateInfo alloc_info = { 0, };
+  VkDeviceMemory memory;
+  GError *error = NULL;
+  VkResult err;
+
+  if (_device_allocation_count (arena) >=
+      device->gpu_props.limits.maxMemoryAllocationCount)
+    GST_WARNING ("reached the device limit of %u memory allocations",
+        device->gpu_props.limits.maxMemoryAllocationCount);
+
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.pNext = NULL;
+  alloc_info.allocationSize = size;
+  alloc_info.memoryTypeIndex = type_index;
+
+  err = vkAllocateMemory (device->device, &alloc_info, NULL, &memory);
+  if (gst_vulkan_error_to_g_error (err, &error, "vkAllocMemory") < 0) {
+    GST_ERROR ("Failed to allocate a memory block: %s", error->message);
+    g_clear_error (&error);
+    return NULL;
+  }
+
+  block = g_new0 (GstVulkanMemoryBlock, 1);
+  block->arena = arena;
+  block->type_index = type_index;
+  block->memory = memory;
+  block->size = size;
+  block->free_ranges = g_array_new (FALSE, FALSE,
+      sizeof (GstVulkanMemoryRange));
+
+  range.offset = 0;
+  range.size = size;
+  g_array_append_val (block->free_ranges, range);
+
+  if (device->memory_properties.memoryTypes[type_index].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    err = vkMapMemory (device->device, memory, 0, VK_WHOLE_SIZE, 0,
+        &block->data);
+    if (gst_vulkan_error_to_g_error (err, &error, "vkMapMemory") < 0) {
+      GST_WARNING ("Failed to map memory block: %s", error->message);
+      g_clear_error (&error);
+      block->data = NULL;
+    }
+  }
+
+  GST_DEBUG ("new block %p of type %u size %" G_GUINT64_FORMAT, block,
+      type_index, (guint64) size);
+
+  return block;
+}
+
+static gboolean
+_block_alloc (GstVulkanMemoryBlock * block, VkDeviceSize size,
+    VkDeviceSize align, VkDeviceSize * offset)
+{
+  guint i;
+
+  for (i = 0; i < block->free_ranges->len; i++) {
+    GstVulkanMemoryRange *r =
+        &g_array_index (block->free_ranges, GstVulkanMemoryRange, i);
+    VkDeviceSize start = ALIGN_UP (r->offset, align);
+    VkDeviceSize end = r->offset + r->size;
+    GstVulkanMemoryRange head;
+
+    if (start + size > end)
+      continue;
+
+    head.offset = r->offset;
+    head.size = start - r->offset;
+
+    /* keep what is left after the allocation in place and the alignment gap
+     * in front of it as a range of its own */
+    r->offset = start + size;
+    r->size = end - r->offset;
+    if (r->size == 0)
+      g_array_remove_index (block->free_ranges, i);
+    if (head.size > 0)
+      g_array_insert_val (block->free_ranges, i, head);
+
+    block->used += size;
+    block->n_allocations++;
+    *offset = start;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Reserves @size bytes aligned to @align in a block of memory type
+ * @type_index, allocating a new block when none has enough room.  Returns
+ * the block with the offset of the range and the size actually reserved,
+ * which has to be passed back to gst_vulkan_memory_arena_release(). */
+GstVulkanMemoryBlock *
+gst_vulkan_memory_arena_alloc (GstVulkanMemoryArena * arena,
+    guint32 type_index, VkDeviceSize size, VkDeviceSize align,
+    VkDeviceSize * offset, VkDeviceSize * reserved)
+{
+  GstVulkanMemoryBlock *block = NULL;
+  VkDeviceSize granularity;
+  GList *l;
+
+  g_return_val_if_fail (type_index < VK_MAX_MEMORY_TYPES, NULL);
+  g_return_val_if_fail (offset != NULL, NULL);
+  g_return_val_if_fail (reserved != NULL, NULL);
+
+  granularity = _granularity (arena, type_index);
+  align = ALIGN_UP (MAX (align, 1), granularity);
+  size = ALIGN_UP (MAX (size, 1), granularity);
+
+  g_mutex_lock (&arena->lock);
+  for (l = arena->blocks[type_index]; l; l = l->next) {
+    if (_block_alloc (l->data, size, align, offset)) {
+      block = l->data;
+      break;
+    }
+  }
+
+  if (!block) {
+    VkDeviceSize block_size = MAX (_block_size (arena, type_index), size);
+
+    block = _block_new (arena, type_index, block_size);
+    if (block) {
+      arena->blocks[type_index] =
+          g_list_append (arena->blocks[type_index], block);
+      if (!_block_alloc (block, size, align, offset))
+        g_assert_not_reached ();
+    }
+  }
+  g_mutex_unlock (&arena->lock);
+
+  if (block) {
+    *reserved = size;
+    GST_TRACE ("reserved %" G_GUINT64_FORMAT " bytes at %" G_GUINT64_FORMAT
+        " in block %p", (guint64) size, (guint64) * offset, block);
+  }
+
+  return block;
+}
+
+void
+gst_vulkan_memory_arena_release (GstVulkanMemoryArena * arena,
+    GstVulkanMemoryBlock * block, VkDeviceSize offset, VkDeviceSize reserved)
+{
+  GstVulkanMemoryRange *prev = NULL, *next = NULL;
+  GstVulkanMemoryRange range;
+  guint i;
+
+  g_return_if_fail (block->arena == arena);
+
+  GST_TRACE ("releasing %" G_GUINT64_FORMAT " bytes at %" G_GUINT64_FORMAT
+      " in block %p", (guint64) reserved, (guint64) offset, block);
+
+  g_mutex_lock (&arena->lock);
+  for (i = 0; i < block->free_ranges->len; i++) {
+    if (g_array_index (block->free_ranges, GstVulkanMemoryRange,
+            i).offset > offset)
+      break;
+  }
+
+  if (i > 0)
+    prev = &g_array_index (block->free_ranges, GstVulkanMemoryRange, i - 1);
+  if (i < block->free_ranges->len)
+    next = &g_array_index (block->free_ranges, GstVulkanMemoryRange, i);
+
+  if (prev && prev->offset + prev->size == offset) {
+    prev->size += reserved;
+    if (next && prev->offset + prev->size == next->offset) {
+      prev->size += next->size;
+      g_array_remove_index (block->free_ranges, i);
+    }
+  } else if (next && offset + reserved == next->offset) {
+    next->offset = offset;
+    next->size += reserved;
+  } else {
+    range.offset = offset;
+    range.size = reserved;
+    g_array_insert_val (block->free_ranges, i, range);
+  }
+
+  block->used -= reserved;
+  block->n_allocations--;
+
+  /* keep a single empty block around per memory type so that a pool
+   * cycling through its buffers doesn't allocate device memory each time */
+  if (block->n_allocations == 0) {
+    GList *l;
+
+    for (l = arena->blocks[block->type_index]; l; l = l->next) {
+      GstVulkanMemoryBlock *other = l->data;
+
+      if (other != block && other->n_allocations == 0) {
+        arena->blocks[block->type_index] =
+            g_list_remove (arena->blocks[block->type_index], block);
+        _block_free (block);
+        break;
+      }
+    }
+  }
+  g_mutex_unlock (&arena->lock);
+}
+
+void
+gst_vulkan_memory_arena_track_dedicated (GstVulkanMemoryArena * arena,
+    VkDeviceSize size, gboolean allocated)
+{
+  g_mutex_lock (&arena->lock);
+  if (allocated) {
+    arena->n_dedicated++;
+    arena->dedicated_size += size;
+  } else {
+    arena->n_dedicated--;
+    arena->dedicated_size -= size;
+  }
+  g_mutex_unlock (&arena->lock);
+}
+
+/* Returns the usage of the device memory in a
+ * application/x-vulkan-memory-stats structure.  Fragmentation is the share
+ * of the free space in the blocks that is not part of the largest free
+ * range, 0.0 when all of it could be handed out at once. */
+GstStructure *
+gst_vulkan_memory_arena_get_stats (GstVulkanMemoryArena * arena)
+{
+  VkDeviceSize block_bytes = 0, used_bytes = 0, free_bytes = 0, largest = 0;
+  guint n_blocks = 0, n_allocations = 0, n_free_ranges = 0;
+  gdouble fragmentation = 0.0;
+  GstStructure *s;
+  guint i, j;
+
+  g_mutex_lock (&arena->lock);
+  for (i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+    GList *l;
+
+    for (l = arena->blocks[i]; l; l = l->next) {
+      GstVulkanMemoryBlock *block = l->data;
+
+      n_blocks++;
+      n_allocations += block->n_allocations;
+      block_bytes += block->size;
+      used_bytes += block->used;
+      n_free_ranges += block->free_ranges->len;
+
+      for (j = 0; j < block->free_ranges->len; j++) {
+        GstVulkanMemoryRange *r =
+            &g_array_index (block->free_ranges, GstVulkanMemoryRange, j);
+
+        free_bytes += r->size;
+        largest = MAX (largest, r->size);
+      }
+    }
+  }
+
+  if (free_bytes > 0)
+    fragmentation = 1.0 - (gdouble) largest / free_bytes;
+
+  s = gst_structure_new ("application/x-vulkan-memory-stats",
+      "blocks", G_TYPE_UINT, n_blocks,
+      "block-bytes", G_TYPE_UINT64, (guint64) block_bytes,
+      "used-bytes", G_TYPE_UINT64, (guint64) used_bytes,
+      "allocations", G_TYPE_UINT, n_allocations,
+      "free-ranges", G_TYPE_UINT, n_free_ranges,
+      "largest-free-range", G_TYPE_UINT64, (guint64) largest,
+      "fragmentation", G_TYPE_DOUBLE, fragmentation,
+      "dedicated-allocations", G_TYPE_UINT, arena->n_dedicated,
+      "dedicated-bytes", G_TYPE_UINT64, (guint64) arena->dedicated_size,
+      "device-allocations", G_TYPE_UINT, n_blocks + arena->n_dedicated,
+      "max-device-allocations", G_TYPE_UINT,
+      arena->device->gpu_props.limits.maxMemoryAllocationCount, NULL);
+  g_mutex_unlock (&arena->lock);
+
+  return s;
+}
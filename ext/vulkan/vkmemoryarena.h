@@ -0,0 +1,75 @@
+/*
+ * GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _VK_MEMORY_ARENA_H_
+#define _VK_MEMORY_ARENA_H_
+
+#include <gst/gst.h>
+
+#include <vk.h>
+
+G_BEGIN_DECLS
+
+/* the default size of the device memory blocks sub-allocations are made
+ * from, allocations larger than half a block get their own device memory */
+#define GST_VULKAN_MEMORY_BLOCK_SIZE (64 * 1024 * 1024)
+
+struct _GstVulkanMemoryBlock
+{
+  GstVulkanMemoryArena     *arena;
+
+  guint32                   type_index;
+  VkDeviceMemory            memory;
+  VkDeviceSize              size;
+  /* the whole block stays mapped for host visible memory types as a device
+   * memory cannot be mapped more than once */
+  gpointer                  data;
+
+  /* <private> */
+  GArray                   *free_ranges;
+  VkDeviceSize              used;
+  guint                     n_allocations;
+};
+
+GstVulkanMemoryArena *  gst_vulkan_memory_arena_new         (GstVulkanDevice * device);
+void                    gst_vulkan_memory_arena_free        (GstVulkanMemoryArena * arena);
+
+gboolean                gst_vulkan_memory_arena_can_suballocate (GstVulkanMemoryArena * arena,
+                                                             guint32 type_index,
+                                                             VkDeviceSize size);
+GstVulkanMemoryBlock *  gst_vulkan_memory_arena_alloc       (GstVulkanMemoryArena * arena,
+                                                             guint32 type_index,
+                                                             VkDeviceSize size,
+                                                             VkDeviceSize align,
+                                                             VkDeviceSize * offset,
+                                                             VkDeviceSize * reserved);
+void                    gst_vulkan_memory_arena_release     (GstVulkanMemoryArena * arena,
+                                                             GstVulkanMemoryBlock * block,
+                                                             VkDeviceSize offset,
+                                                             VkDeviceSize reserved);
+
+void                    gst_vulkan_memory_arena_track_dedicated (GstVulkanMemoryArena * arena,
+                                                             VkDeviceSize size,
+                                                             gboolean allocated);
+
+GstStructure *          gst_vulkan_memory_arena_get_stats   (GstVulkanMemoryArena * arena);
+
+G_END_DECLS
+
+#endif /* _VK_MEMORY_ARENA_H_ */
@@ -556,14 +556,17 @@ _swapper_set_image_layout (GstVulkanSwapper * swapper,
     submit_info.signalSemaphoreCount = 0;
     submit_info.pSignalSemaphores = NULL;
 
+    gst_vulkan_device_lock_queues (swapper->device);
     err =
         vkQueueSubmit (swapper->queue->queue, 1, &submit_info,
         GST_VULKAN_FENCE_FENCE (fence));
+    gst_vulkan_device_unlock_queues (swapper->device);
     if (gst_vulkan_error_to_g_error (err, error, "vkQueueSubmit") < 0)
       goto error;
   }
 
-  swapper->priv->trash_list = g_list_prepend (swapper->priv->trash_list,
+  swapper->priv->trash_list = gst_vulkan_trash_list_add
+      (swapper->priv->trash_list,
       gst_vulkan_trash_new_free_command_buffer (fence, cmd));
   fence = NULL;
 
@@ -958,16 +961,20 @@ reacquire:
     if (!fence)
       goto error;
 
+    gst_vulkan_device_lock_queues (swapper->device);
     err =
         vkQueueSubmit (swapper->queue->queue, 1, &submit_info,
         GST_VULKAN_FENCE_FENCE (fence));
+    gst_vulkan_device_unlock_queues (swapper->device);
     if (gst_vulkan_error_to_g_error (err, error, "vkQueueSubmit") < 0)
       goto error;
 
-    swapper->priv->trash_list = g_list_prepend (swapper->priv->trash_list,
+    swapper->priv->trash_list = gst_vulkan_trash_list_add
+        (swapper->priv->trash_list,
         gst_vulkan_trash_new_free_command_buffer (gst_vulkan_fence_ref (fence),
             cmd));
-    swapper->priv->trash_list = g_list_prepend (swapper->priv->trash_list,
+    swapper->priv->trash_list =
+        gst_vulkan_trash_list_add (swapper->priv->trash_list,
         gst_vulkan_trash_new_free_semaphore (fence, acquire_semaphore));
 
     cmd = VK_NULL_HANDLE;
@@ -983,7 +990,9 @@ reacquire:
   present.pImageIndices = &swap_idx;
   present.pResults = &present_err;
 
+  gst_vulkan_device_lock_queues (swapper->device);
   err = swapper->QueuePresentKHR (swapper->queue->queue, &present);
+  gst_vulkan_device_unlock_queues (swapper->device);
   if (gst_vulkan_error_to_g_error (err, error, "vkQueuePresentKHR") < 0)
     goto error;
 
@@ -1006,13 +1015,16 @@ reacquire:
     if (!fence)
       goto error;
 
+    gst_vulkan_device_lock_queues (swapper->device);
     err =
         vkQueueSubmit (swapper->queue->queue, 1, &submit_info,
         GST_VULKAN_FENCE_FENCE (fence));
+    gst_vulkan_device_unlock_queues (swapper->device);
     if (gst_vulkan_error_to_g_error (err, error, "vkQueueSubmit") < 0)
       goto error;
 
-    swapper->priv->trash_list = g_list_prepend (swapper->priv->trash_list,
+    swapper->priv->trash_list =
+        gst_vulkan_trash_list_add (swapper->priv->trash_list,
         gst_vulkan_trash_new_free_semaphore (fence, present_semaphore));
     fence = NULL;
   }
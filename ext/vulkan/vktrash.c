@@ -28,6 +28,17 @@
 GST_DEBUG_CATEGORY (gst_debug_vulkan_trash);
 #define GST_CAT_DEFAULT gst_debug_vulkan_trash
 
+/* Trash objects released by the same fence are merged into a single one by
+ * gst_vulkan_trash_list_add() so that garbage collecting a list only queries
+ * one fence per submission and releases everything of a submission at
+ * once, however many resources it used. */
+
+typedef struct
+{
+  GstVulkanTrashNotify notify;
+  gpointer user_data;
+} GstVulkanTrashEntry;
+
 static void
 _init_debug (void)
 {
@@ -50,10 +61,50 @@ gst_vulkan_trash_free (GstVulkanTrash * trash)
       trash->fence);
 
   gst_vulkan_fence_unref (trash->fence);
+  if (trash->extra)
+    g_array_free (trash->extra, TRUE);
 
   g_free (trash);
 }
 
+static void
+_trash_notify (GstVulkanTrash * trash)
+{
+  GstVulkanDevice *device = trash->fence->device;
+  guint i;
+
+  trash->notify (device, trash->user_data);
+
+  if (trash->extra) {
+    for (i = 0; i < trash->extra->len; i++) {
+      GstVulkanTrashEntry *entry =
+          &g_array_index (trash->extra, GstVulkanTrashEntry, i);
+
+      entry->notify (device, entry->user_data);
+    }
+  }
+}
+
+/* moves the resources of @trash into @into, both released by the same
+ * fence */
+static void
+_trash_merge (GstVulkanTrash * into, GstVulkanTrash * trash)
+{
+  GstVulkanTrashEntry entry;
+
+  if (!into->extra)
+    into->extra = g_array_new (FALSE, FALSE, sizeof (GstVulkanTrashEntry));
+
+  entry.notify = trash->notify;
+  entry.user_data = trash->user_data;
+  g_array_append_val (into->extra, entry);
+
+  if (trash->extra)
+    g_array_append_vals (into->extra, trash->extra->data, trash->extra->len);
+
+  gst_vulkan_trash_free (trash);
+}
+
 GstVulkanTrash *
 gst_vulkan_trash_new (GstVulkanFence * fence, GstVulkanTrashNotify notify,
     gpointer user_data)
@@ -76,6 +127,34 @@ gst_vulkan_trash_new (GstVulkanFence * fence, GstVulkanTrashNotify notify,
   return ret;
 }
 
+/**
+ * gst_vulkan_trash_list_add:
+ * @trash_list: a #GList of #GstVulkanTrash
+ * @trash: (transfer full): the #GstVulkanTrash to add
+ *
+ * Adds @trash to @trash_list.  When the most recently added trash is waiting
+ * on the same fence, @trash is merged into it instead of getting its own
+ * list entry.
+ *
+ * Returns: the new start of @trash_list
+ */
+GList *
+gst_vulkan_trash_list_add (GList * trash_list, GstVulkanTrash * trash)
+{
+  g_return_val_if_fail (trash != NULL, trash_list);
+
+  if (trash_list) {
+    GstVulkanTrash *head = trash_list->data;
+
+    if (head->fence->fence == trash->fence->fence) {
+      _trash_merge (head, trash);
+      return trash_list;
+    }
+  }
+
+  return g_list_prepend (trash_list, trash);
+}
+
 GList *
 gst_vulkan_trash_list_gc (GList * trash_list)
 {
@@ -86,9 +165,10 @@ gst_vulkan_trash_list_gc (GList * trash_list)
 
     if (gst_vulkan_fence_is_signaled (trash->fence)) {
       GList *next = g_list_next (l);
-      GST_TRACE ("fence %" GST_PTR_FORMAT " has been signalled, notifying",
-          trash->fence);
-      trash->notify (trash->fence->device, trash->user_data);
+      GST_TRACE ("fence %" GST_PTR_FORMAT " has been signalled, notifying "
+          "%u objects", trash->fence,
+          1 + (trash->extra ? trash->extra->len : 0));
+      _trash_notify (trash);
       gst_vulkan_trash_free (trash);
       trash_list = g_list_delete_link (trash_list, l);
       l = next;
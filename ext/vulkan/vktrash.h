@@ -33,6 +33,10 @@ struct _GstVulkanTrash
 
   GstVulkanTrashNotify  notify;
   gpointer              user_data;
+
+  /* <private> */
+  /* further resources released once the same fence signals */
+  GArray               *extra;
 };
 
 GstVulkanTrash *    gst_vulkan_trash_new                        (GstVulkanFence * fence,
@@ -44,6 +48,8 @@ GstVulkanTrash *    gst_vulkan_trash_new_free_semaphore         (GstVulkanFence
                                                                  VkSemaphore cmd);
 void                gst_vulkan_trash_free                       (GstVulkanTrash * trash);
 
+GList *             gst_vulkan_trash_list_add                   (GList * trash_list,
+                                                                 GstVulkanTrash * trash);
 GList *             gst_vulkan_trash_list_gc                    (GList * trash_list);
 gboolean            gst_vulkan_trash_list_wait                  (GList * trash_list,
                                                                  guint64 timeout);
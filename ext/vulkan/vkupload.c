@@ -31,8 +31,18 @@
 
 #include <string.h>
 
+#include <gst/allocators/gstdmabuf.h>
+
 #include "vkupload.h"
 
+#ifndef GST_CAPS_FEATURE_MEMORY_DMABUF
+#define GST_CAPS_FEATURE_MEMORY_DMABUF "memory:DMABuf"
+#endif
+
+/* buffers of the raw upload pool, allocated up front so that the copies of
+ * a frame don't wait for host visible memory to be allocated */
+#define RAW_UPLOAD_MIN_BUFFERS 2
+
 GST_DEBUG_CATEGORY (gst_debug_vulkan_upload);
 #define GST_CAT_DEFAULT gst_debug_vulkan_upload
 
@@ -180,6 +190,159 @@ static const struct UploadMethod buffer_upload = {
   _buffer_free,
 };
 
+struct DmabufToBufferUpload
+{
+  GstVulkanUpload *upload;
+
+  GstVideoInfo in_info;
+  GstVideoInfo out_info;
+};
+
+static gpointer
+_dmabuf_to_buffer_new_impl (GstVulkanUpload * upload)
+{
+  struct DmabufToBufferUpload *dmabuf =
+      g_new0 (struct DmabufToBufferUpload, 1);
+
+  dmabuf->upload = upload;
+
+  return dmabuf;
+}
+
+static GstCaps *
+_dmabuf_to_buffer_transform_caps (gpointer impl, GstPadDirection direction,
+    GstCaps * caps)
+{
+  GstCaps *ret;
+
+  if (direction == GST_PAD_SINK) {
+    ret =
+        _set_caps_features_with_passthrough (caps,
+        GST_CAPS_FEATURE_MEMORY_VULKAN_BUFFER, NULL);
+  } else {
+    ret =
+        _set_caps_features_with_passthrough (caps,
+        GST_CAPS_FEATURE_MEMORY_DMABUF, NULL);
+  }
+
+  return ret;
+}
+
+static gboolean
+_dmabuf_to_buffer_set_caps (gpointer impl, GstCaps * in_caps,
+    GstCaps * out_caps)
+{
+  struct DmabufToBufferUpload *dmabuf = impl;
+
+  if (!dmabuf->upload->device ||
+      !gst_vulkan_device_can_import_dmabuf (dmabuf->upload->device))
+    return FALSE;
+
+  if (!gst_video_info_from_caps (&dmabuf->in_info, in_caps))
+    return FALSE;
+
+  if (!gst_video_info_from_caps (&dmabuf->out_info, out_caps))
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+_dmabuf_to_buffer_propose_allocation (gpointer impl, GstQuery * decide_query,
+    GstQuery * query)
+{
+  /* the dmabufs come from the producer's own pool */
+}
+
+static GstFlowReturn
+_dmabuf_to_buffer_perform (gpointer impl, GstBuffer * inbuf,
+    GstBuffer ** outbuf)
+{
+#if GST_VULKAN_HAVE_DMABUF_IMPORT
+  struct DmabufToBufferUpload *dmabuf = impl;
+  GstVideoMeta *meta = gst_buffer_get_video_meta (inbuf);
+  guint i;
+
+  *outbuf = gst_buffer_new ();
+
+  for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&dmabuf->out_info); i++) {
+    GstVideoFormat v_format = GST_VIDEO_INFO_FORMAT (&dmabuf->out_info);
+    gsize offset, plane_size, skip;
+    guint idx, length;
+    GstMemory *in_mem, *mem;
+    gint stride;
+
+    if (meta) {
+      offset = meta->offset[i];
+      stride = meta->stride[i];
+    } else {
+      offset = GST_VIDEO_INFO_PLANE_OFFSET (&dmabuf->in_info, i);
+      stride = GST_VIDEO_INFO_PLANE_STRIDE (&dmabuf->in_info, i);
+    }
+
+    /* the consumers read the planes with the default strides */
+    if (stride != GST_VIDEO_INFO_PLANE_STRIDE (&dmabuf->out_info, i)) {
+      GST_DEBUG_OBJECT (dmabuf->upload, "plane %u has stride %d instead of "
+          "%d", i, stride, GST_VIDEO_INFO_PLANE_STRIDE (&dmabuf->out_info, i));
+      goto error;
+    }
+
+    plane_size = stride * GST_VIDEO_INFO_COMP_HEIGHT (&dmabuf->out_info, i);
+
+    if (!gst_buffer_find_memory (inbuf, offset, plane_size, &idx, &length,
+            &skip) || length != 1)
+      goto error;
+
+    in_mem = gst_buffer_peek_memory (inbuf, idx);
+    if (!gst_is_dmabuf_memory (in_mem))
+      goto error;
+
+    /* keep the frame from being reused by its producer while the device
+     * reads from it */
+    mem = gst_vulkan_buffer_memory_import_dmabuf (dmabuf->upload->device,
+        gst_vulkan_format_from_video_format (v_format, i),
+        gst_dmabuf_memory_get_fd (in_mem), in_mem->offset + skip, plane_size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        gst_buffer_ref (inbuf),
+        (GDestroyNotify) gst_buffer_unref);
+    if (!mem)
+      goto error;
+
+    gst_buffer_append_memory (*outbuf, mem);
+  }
+
+  return GST_FLOW_OK;
+
+error:
+  gst_buffer_unref (*outbuf);
+  *outbuf = NULL;
+#endif
+  return GST_FLOW_ERROR;
+}
+
+static void
+_dmabuf_to_buffer_free (gpointer impl)
+{
+  g_free (impl);
+}
+
+static GstStaticCaps _dmabuf_to_buffer_in_templ =
+GST_STATIC_CAPS ("video/x-raw(" GST_CAPS_FEATURE_MEMORY_DMABUF ")");
+static GstStaticCaps _dmabuf_to_buffer_out_templ =
+GST_STATIC_CAPS ("video/x-raw(" GST_CAPS_FEATURE_MEMORY_VULKAN_BUFFER ")");
+
+static const struct UploadMethod dmabuf_to_buffer_upload = {
+  "DmabufToVulkanBuffer",
+  &_dmabuf_to_buffer_in_templ,
+  &_dmabuf_to_buffer_out_templ,
+  _dmabuf_to_buffer_new_impl,
+  _dmabuf_to_buffer_transform_caps,
+  _dmabuf_to_buffer_set_caps,
+  _dmabuf_to_buffer_propose_allocation,
+  _dmabuf_to_buffer_perform,
+  _dmabuf_to_buffer_free,
+};
+
 struct RawToBufferUpload
 {
   GstVulkanUpload *upload;
@@ -263,6 +426,15 @@ static void
 _raw_to_buffer_propose_allocation (gpointer impl, GstQuery * decide_query,
     GstQuery * query)
 {
+  GstCaps *caps;
+
+  /* dmabufs are only copied when they can't be imported, their producer
+   * has no use for our pool */
+  gst_query_parse_allocation (query, &caps, NULL);
+  if (caps && gst_caps_features_contains (gst_caps_get_features (caps, 0),
+          GST_CAPS_FEATURE_MEMORY_DMABUF))
+    return;
+
   /* a little trickery with the impl pointer */
   _buffer_propose_allocation (impl, decide_query, query);
 }
@@ -277,7 +449,7 @@ _raw_to_buffer_perform (gpointer impl, GstBuffer * inbuf, GstBuffer ** outbuf)
 
   if (!raw->pool) {
     GstStructure *config;
-    guint min = 0, max = 0;
+    guint min = RAW_UPLOAD_MIN_BUFFERS, max = 0;
     gsize size = 1;
 
     raw->pool = gst_vulkan_buffer_pool_new (raw->upload->device);
@@ -304,7 +476,8 @@ _raw_to_buffer_perform (gpointer impl, GstBuffer * inbuf, GstBuffer ** outbuf)
 
   for (i = 0; i < GST_VIDEO_INFO_N_PLANES (&raw->out_info); i++) {
     GstMapInfo map_info;
-    gsize plane_size;
+    gint in_stride, out_stride;
+    guint height;
     GstMemory *mem;
 
     mem = gst_buffer_peek_memory (*outbuf, i);
@@ -317,11 +490,25 @@ _raw_to_buffer_perform (gpointer impl, GstBuffer * inbuf, GstBuffer ** outbuf)
       goto out;
     }
 
-    plane_size =
-        GST_VIDEO_INFO_PLANE_STRIDE (&raw->out_info,
-        i) * GST_VIDEO_INFO_COMP_HEIGHT (&raw->out_info, i);
-    g_assert (plane_size < map_info.size);
-    memcpy (map_info.data, v_frame.data[i], plane_size);
+    /* the memory is host visible and stays mapped, the data is written
+     * straight where the device reads it from */
+    in_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&v_frame, i);
+    out_stride = GST_VIDEO_INFO_PLANE_STRIDE (&raw->out_info, i);
+    height = GST_VIDEO_INFO_COMP_HEIGHT (&raw->out_info, i);
+    g_assert (out_stride * height <= map_info.size);
+
+    if (in_stride == out_stride) {
+      memcpy (map_info.data, v_frame.data[i], out_stride * height);
+    } else {
+      guint8 *src = v_frame.data[i], *dest = map_info.data;
+      guint j;
+
+      for (j = 0; j < height; j++) {
+        memcpy (dest, src, MIN (in_stride, out_stride));
+        src += in_stride;
+        dest += out_stride;
+      }
+    }
 
     gst_memory_unmap (GST_MEMORY_CAST (mem), &map_info);
   }
@@ -351,7 +538,9 @@ _raw_to_buffer_free (gpointer impl)
   g_free (impl);
 }
 
-static GstStaticCaps _raw_to_buffer_in_templ = GST_STATIC_CAPS ("video/x-raw");
+/* also the fallback for dmabufs that can't be imported */
+static GstStaticCaps _raw_to_buffer_in_templ = GST_STATIC_CAPS ("video/x-raw;"
+    "video/x-raw(" GST_CAPS_FEATURE_MEMORY_DMABUF ")");
 static GstStaticCaps _raw_to_buffer_out_templ =
 GST_STATIC_CAPS ("video/x-raw(" GST_CAPS_FEATURE_MEMORY_VULKAN_BUFFER ")");
 
@@ -369,6 +558,7 @@ static const struct UploadMethod raw_to_buffer_upload = {
 
 static const struct UploadMethod *upload_methods[] = {
   &buffer_upload,
+  &dmabuf_to_buffer_upload,
   &raw_to_buffer_upload,
 };
 
@@ -76,9 +76,28 @@ enum
   PROP_WINDOW_HEIGHT,
   PROP_DISPLAY,
   PROP_ALPHA,
-  PROP_ENABLE_TILE
+  PROP_ENABLE_TILE,
+  PROP_VBLANK_SYNC,
+  PROP_STATS
 };
 
+#define DEFAULT_VBLANK_SYNC FALSE
+
+/* the predicted vblank is only trusted to this fraction of a refresh cycle,
+ * commits are scheduled that far after the vblank preceding it */
+#define VBLANK_COMMIT_MARGIN_DIV 8
+
+typedef struct
+{
+  struct wp_presentation_feedback *feedback;
+  GstClockTime commit_time;
+  GstClockTime target_time;
+  GstClockTime running_time;
+  GstClockTime stream_time;
+  GstClockTime timestamp;
+  GstClockTime duration;
+} GstWlPresentationFeedback;
+
 GST_DEBUG_CATEGORY (gstwayland_debug);
 #define GST_CAT_DEFAULT gstwayland_debug
 
@@ -114,6 +133,8 @@ gst_wayland_sink_propose_allocation (GstBaseSink * bsink, GstQuery * query);
 static gboolean gst_wayland_sink_show_frame (GstVideoSink * bsink,
     GstBuffer * buffer);
 static void gst_wayland_sink_config_hdr10 (GstWaylandSink *sink, GstBuffer * buf);
+static void gst_wayland_sink_clear_presentation_feedbacks (GstWaylandSink *
+    sink);
 
 /* VideoOverlay interface */
 static void gst_wayland_sink_videooverlay_init (GstVideoOverlayInterface *
@@ -238,6 +259,35 @@ gst_wayland_sink_class_init (GstWaylandSinkClass * klass)
       g_param_spec_boolean ("enable-tile", "enable hantro tile",
       "When enabled, the sink propose VSI tile modifier to VPU", FALSE,
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT));
+
+  /**
+   * GstWaylandSink:vblank-sync:
+   *
+   * Schedule commits against the vblank predicted from the compositor's
+   * presentation feedback, and use the measured commit to presentation
+   * latency as render delay. Requires wp_presentation support in the
+   * compositor.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_VBLANK_SYNC,
+      g_param_spec_boolean ("vblank-sync", "VBlank sync",
+          "Schedule commits against the predicted next vblank",
+          DEFAULT_VBLANK_SYNC, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWaylandSink:stats:
+   *
+   * Presentation statistics reported by the compositor: the number of
+   * frames presented and discarded, the smoothed commit to presentation
+   * latency, the refresh interval and the jitter of the last frame.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Presentation statistics", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -252,6 +302,28 @@ gst_wayland_sink_init (GstWaylandSink * sink)
   sink->frame_showed = 0;
   sink->run_time = 0;
   sink->enable_tile = FALSE;
+  sink->vblank_sync = DEFAULT_VBLANK_SYNC;
+  g_queue_init (&sink->presentation_feedbacks);
+  sink->present_latency = GST_CLOCK_TIME_NONE;
+  sink->refresh = GST_CLOCK_TIME_NONE;
+  sink->last_presented = GST_CLOCK_TIME_NONE;
+}
+
+static GstStructure *
+gst_wayland_sink_get_stats (GstWaylandSink * sink)
+{
+  GstStructure *s;
+
+  g_mutex_lock (&sink->render_lock);
+  s = gst_structure_new ("application/x-wayland-sink-stats",
+      "presented", G_TYPE_UINT64, sink->frames_presented,
+      "discarded", G_TYPE_UINT64, sink->frames_discarded,
+      "latency", G_TYPE_UINT64, sink->present_latency,
+      "refresh", G_TYPE_UINT64, sink->refresh,
+      "jitter", G_TYPE_INT64, sink->last_jitter, NULL);
+  g_mutex_unlock (&sink->render_lock);
+
+  return s;
 }
 
 static void
@@ -278,6 +350,12 @@ gst_wayland_sink_get_property (GObject * object,
     case PROP_ENABLE_TILE:
       g_value_set_boolean (value, sink->enable_tile);
       break;
+    case PROP_VBLANK_SYNC:
+      g_value_set_boolean (value, sink->vblank_sync);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_wayland_sink_get_stats (sink));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -308,6 +386,9 @@ gst_wayland_sink_set_property (GObject * object,
     case PROP_ENABLE_TILE:
       sink->enable_tile = g_value_get_boolean (value);
       break;
+    case PROP_VBLANK_SYNC:
+      sink->vblank_sync = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -321,6 +402,8 @@ gst_wayland_sink_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (sink, "Finalizing the sink..");
 
+  gst_wayland_sink_clear_presentation_feedbacks (sink);
+
   if (sink->last_buffer)
     gst_buffer_unref (sink->last_buffer);
   if (sink->display)
@@ -439,6 +522,7 @@ gst_wayland_sink_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_buffer_replace (&sink->last_buffer, NULL);
       gst_wayland_sink_config_hdr10 (sink, NULL);
+      gst_wayland_sink_clear_presentation_feedbacks (sink);
       if (sink->window) {
         gst_wl_window_set_alpha(sink->window, 1.0);
         wl_surface_damage (sink->window->area_surface, 0, 0,
@@ -756,6 +840,284 @@ static const struct wl_callback_listener frame_callback_listener = {
   frame_redraw_callback
 };
 
+static void
+gst_wayland_sink_free_presentation_feedback (GstWlPresentationFeedback * entry)
+{
+  wp_presentation_feedback_destroy (entry->feedback);
+  g_slice_free (GstWlPresentationFeedback, entry);
+}
+
+static void
+gst_wayland_sink_clear_presentation_feedbacks (GstWaylandSink * sink)
+{
+  GstWlPresentationFeedback *entry;
+
+  g_mutex_lock (&sink->render_lock);
+  while ((entry = g_queue_pop_head (&sink->presentation_feedbacks)))
+    gst_wayland_sink_free_presentation_feedback (entry);
+  sink->present_latency = GST_CLOCK_TIME_NONE;
+  sink->last_presented = GST_CLOCK_TIME_NONE;
+  g_mutex_unlock (&sink->render_lock);
+}
+
+/* must be called with the render lock. The listener data is the sink and
+ * the entries are looked up by proxy, so that events racing with
+ * gst_wayland_sink_clear_presentation_feedbacks() are ignored */
+static GstWlPresentationFeedback *
+pop_presentation_feedback (GstWaylandSink * sink,
+    struct wp_presentation_feedback *feedback)
+{
+  GList *l;
+
+  for (l = sink->presentation_feedbacks.head; l; l = l->next) {
+    GstWlPresentationFeedback *entry = l->data;
+
+    if (entry->feedback == feedback) {
+      g_queue_delete_link (&sink->presentation_feedbacks, l);
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+static GstMessage *
+presentation_qos_message (GstWaylandSink * sink,
+    GstWlPresentationFeedback * entry, GstClockTimeDiff jitter)
+{
+  GstMessage *msg;
+
+  msg = gst_message_new_qos (GST_OBJECT_CAST (sink),
+      gst_base_sink_get_sync (GST_BASE_SINK (sink)), entry->running_time,
+      entry->stream_time, entry->timestamp, entry->duration);
+  gst_message_set_qos_values (msg, jitter, 1.0, 1000000);
+  gst_message_set_qos_stats (msg, GST_FORMAT_BUFFERS, sink->frames_presented,
+      sink->frames_discarded);
+
+  return msg;
+}
+
+static void
+presentation_sync_output (void *data,
+    struct wp_presentation_feedback *feedback, struct wl_output *output)
+{
+}
+
+static void
+presentation_presented (void *data, struct wp_presentation_feedback *feedback,
+    uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+    uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo, uint32_t flags)
+{
+  GstWaylandSink *sink = data;
+  GstWlPresentationFeedback *entry;
+  GstClockTime presented, now, now_wl, render_delay = GST_CLOCK_TIME_NONE;
+  GstClockTimeDiff jitter = 0;
+  GstMessage *qos_msg = NULL;
+  struct timespec ts;
+  GstClock *clock;
+
+  g_mutex_lock (&sink->render_lock);
+  entry = pop_presentation_feedback (sink, feedback);
+  if (!entry) {
+    g_mutex_unlock (&sink->render_lock);
+    return;
+  }
+
+  sink->frames_presented++;
+  if (refresh)
+    sink->refresh = refresh;
+  else
+    sink->refresh = sink->display->refresh;
+
+  clock = gst_element_get_clock (GST_ELEMENT_CAST (sink));
+  if (!clock)
+    goto done;
+
+  /* map the compositor timestamp to the pipeline clock */
+  presented = ((((guint64) tv_sec_hi) << 32) | tv_sec_lo) * GST_SECOND +
+      tv_nsec;
+  clock_gettime (sink->display->presentation_clock_id, &ts);
+  now_wl = GST_TIMESPEC_TO_TIME (ts);
+  now = gst_clock_get_time (clock);
+  gst_object_unref (clock);
+
+  if (now_wl < presented || now < now_wl - presented)
+    goto done;
+  presented = now - (now_wl - presented);
+  sink->last_presented = presented;
+
+  if (GST_CLOCK_TIME_IS_VALID (entry->commit_time)
+      && presented >= entry->commit_time) {
+    GstClockTime latency = presented - entry->commit_time;
+
+    if (GST_CLOCK_TIME_IS_VALID (sink->present_latency))
+      sink->present_latency = (7 * sink->present_latency + latency) / 8;
+    else
+      sink->present_latency = latency;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (entry->target_time)) {
+    jitter = GST_CLOCK_DIFF (entry->target_time, presented);
+    sink->last_jitter = jitter;
+
+    /* shown on a later vblank than the one it was due for */
+    if (GST_CLOCK_TIME_IS_VALID (sink->refresh) && jitter > 0
+        && jitter > sink->refresh
+        && gst_base_sink_is_qos_enabled (GST_BASE_SINK (sink)))
+      qos_msg = presentation_qos_message (sink, entry, jitter);
+  }
+
+  GST_LOG_OBJECT (sink, "frame presented at %" GST_TIME_FORMAT " (seq %"
+      G_GUINT64_FORMAT ", flags 0x%x), jitter %" GST_STIME_FORMAT
+      ", latency %" GST_TIME_FORMAT, GST_TIME_ARGS (presented),
+      (((guint64) seq_hi) << 32) | seq_lo, flags, GST_STIME_ARGS (jitter),
+      GST_TIME_ARGS (sink->present_latency));
+
+  if (sink->vblank_sync && GST_CLOCK_TIME_IS_VALID (sink->present_latency))
+    render_delay = sink->present_latency;
+
+done:
+  g_mutex_unlock (&sink->render_lock);
+  gst_wayland_sink_free_presentation_feedback (entry);
+
+  if (GST_CLOCK_TIME_IS_VALID (render_delay)) {
+    GstClockTime old = gst_base_sink_get_render_delay (GST_BASE_SINK (sink));
+
+    /* only follow changes large enough to matter, each one posts a latency
+     * message and makes the pipeline reconfigure its latency */
+    if (ABS (GST_CLOCK_DIFF (old, render_delay)) > GST_MSECOND) {
+      GST_DEBUG_OBJECT (sink, "render delay %" GST_TIME_FORMAT " -> %"
+          GST_TIME_FORMAT, GST_TIME_ARGS (old), GST_TIME_ARGS (render_delay));
+      gst_base_sink_set_render_delay (GST_BASE_SINK (sink), render_delay);
+      gst_element_post_message (GST_ELEMENT_CAST (sink),
+          gst_message_new_latency (GST_OBJECT_CAST (sink)));
+    }
+  }
+
+  if (qos_msg)
+    gst_element_post_message (GST_ELEMENT_CAST (sink), qos_msg);
+}
+
+static void
+presentation_discarded (void *data, struct wp_presentation_feedback *feedback)
+{
+  GstWaylandSink *sink = data;
+  GstWlPresentationFeedback *entry;
+  GstMessage *qos_msg = NULL;
+
+  g_mutex_lock (&sink->render_lock);
+  entry = pop_presentation_feedback (sink, feedback);
+  if (!entry) {
+    g_mutex_unlock (&sink->render_lock);
+    return;
+  }
+
+  sink->frames_discarded++;
+  GST_LOG_OBJECT (sink, "frame %" GST_TIME_FORMAT " was discarded",
+      GST_TIME_ARGS (entry->timestamp));
+
+  if (gst_base_sink_is_qos_enabled (GST_BASE_SINK (sink)))
+    qos_msg = presentation_qos_message (sink, entry, 0);
+  g_mutex_unlock (&sink->render_lock);
+
+  gst_wayland_sink_free_presentation_feedback (entry);
+
+  if (qos_msg)
+    gst_element_post_message (GST_ELEMENT_CAST (sink), qos_msg);
+}
+
+static const struct wp_presentation_feedback_listener
+    presentation_feedback_listener = {
+  presentation_sync_output,
+  presentation_presented,
+  presentation_discarded
+};
+
+/* must be called with the render lock, before the surface is committed */
+static void
+request_presentation_feedback (GstWaylandSink * sink,
+    struct wl_surface *surface)
+{
+  GstBaseSink *bsink = GST_BASE_SINK (sink);
+  GstBuffer *buffer = sink->last_buffer;
+  GstWlPresentationFeedback *entry;
+  GstClock *clock;
+
+  entry = g_slice_new0 (GstWlPresentationFeedback);
+  entry->commit_time = GST_CLOCK_TIME_NONE;
+  entry->target_time = GST_CLOCK_TIME_NONE;
+  entry->timestamp = GST_BUFFER_PTS (buffer);
+  entry->duration = GST_BUFFER_DURATION (buffer);
+  entry->running_time = gst_segment_to_running_time (&bsink->segment,
+      GST_FORMAT_TIME, entry->timestamp);
+  entry->stream_time = gst_segment_to_stream_time (&bsink->segment,
+      GST_FORMAT_TIME, entry->timestamp);
+
+  clock = gst_element_get_clock (GST_ELEMENT_CAST (sink));
+  if (clock) {
+    entry->commit_time = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+
+    if (GST_CLOCK_TIME_IS_VALID (entry->running_time))
+      entry->target_time = entry->running_time +
+          gst_element_get_base_time (GST_ELEMENT_CAST (sink)) +
+          gst_base_sink_get_latency (bsink);
+  }
+
+  entry->feedback = wp_presentation_feedback (sink->display->presentation,
+      surface);
+  wp_presentation_feedback_add_listener (entry->feedback,
+      &presentation_feedback_listener, sink);
+  g_queue_push_tail (&sink->presentation_feedbacks, entry);
+}
+
+/* Wait until just after the vblank preceding the one @buffer should be
+ * presented on, given the refresh cycles the compositor needs between a
+ * commit and its presentation. Committing any earlier holds the frame on
+ * screen a cycle too early, any later and it misses its vblank. Must be
+ * called from the streaming thread, without the render lock */
+static GstFlowReturn
+gst_wayland_sink_wait_vblank (GstWaylandSink * sink, GstBuffer * buffer)
+{
+  GstBaseSink *bsink = GST_BASE_SINK (sink);
+  GstClockTime last, refresh, latency, running_time, base_time, target;
+  GstClockTime vblank, commit;
+  guint64 cycles;
+
+  g_mutex_lock (&sink->render_lock);
+  last = sink->last_presented;
+  refresh = sink->refresh;
+  latency = sink->present_latency;
+  g_mutex_unlock (&sink->render_lock);
+
+  /* nothing to predict from yet */
+  if (!GST_CLOCK_TIME_IS_VALID (last) || !GST_CLOCK_TIME_IS_VALID (refresh)
+      || refresh == 0 || !GST_CLOCK_TIME_IS_VALID (latency))
+    return GST_FLOW_OK;
+
+  running_time = gst_segment_to_running_time (&bsink->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    return GST_FLOW_OK;
+
+  base_time = gst_element_get_base_time (GST_ELEMENT_CAST (sink));
+  target = running_time + base_time + gst_base_sink_get_latency (bsink);
+  if (target <= last)
+    return GST_FLOW_OK;
+
+  vblank = last + (target - last + refresh / 2) / refresh * refresh;
+  cycles = MAX (1, (latency + refresh / 2) / refresh);
+  if (vblank < base_time + cycles * refresh)
+    return GST_FLOW_OK;
+  commit = vblank - cycles * refresh + refresh / VBLANK_COMMIT_MARGIN_DIV;
+
+  GST_LOG_OBJECT (sink, "buffer due at %" GST_TIME_FORMAT ", vblank %"
+      GST_TIME_FORMAT ", committing at %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (target), GST_TIME_ARGS (vblank), GST_TIME_ARGS (commit));
+
+  return gst_base_sink_wait (bsink, commit - base_time, NULL);
+}
+
 /* must be called with the render lock */
 static void
 render_last_buffer (GstWaylandSink * sink, gboolean redraw)
@@ -772,6 +1134,9 @@ render_last_buffer (GstWaylandSink * sink, gboolean redraw)
   callback = wl_surface_frame (surface);
   wl_callback_add_listener (callback, &frame_callback_listener, sink);
 
+  if (sink->display->presentation && !redraw)
+    request_presentation_feedback (sink, surface);
+
   if (G_UNLIKELY (sink->video_info_changed && !redraw)) {
     info = &sink->video_info;
     sink->video_info_changed = FALSE;
@@ -858,6 +1223,12 @@ gst_wayland_sink_show_frame (GstVideoSink * vsink, GstBuffer * buffer)
 
   GstFlowReturn ret = GST_FLOW_OK;
 
+  if (sink->vblank_sync) {
+    ret = gst_wayland_sink_wait_vblank (sink, buffer);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+
   g_mutex_lock (&sink->render_lock);
 
   GST_LOG_OBJECT (sink, "render buffer %p", buffer);
@@ -80,6 +80,17 @@ struct _GstWaylandSink
   GstClockTime run_time;
 
   gboolean enable_tile;
+
+  /* presentation feedback, protected by the render_lock */
+  GQueue presentation_feedbacks;
+  GstClockTime present_latency;
+  GstClockTime refresh;
+  GstClockTime last_presented;
+  GstClockTimeDiff last_jitter;
+  guint64 frames_presented;
+  guint64 frames_discarded;
+
+  gboolean vblank_sync;
 };
 
 struct _GstWaylandSinkClass
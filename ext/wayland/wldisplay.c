@@ -55,6 +55,8 @@ gst_wl_display_init (GstWlDisplay * self)
   self->height = -1;
   self->preferred_width = -1;
   self->preferred_height = -1;
+  self->refresh = GST_CLOCK_TIME_NONE;
+  self->presentation_clock_id = CLOCK_MONOTONIC;
   g_mutex_init (&self->buffers_mutex);
 }
 
@@ -101,6 +103,9 @@ gst_wl_display_finalize (GObject * gobject)
   if (self->hdr10_metadata)
     zwp_hdr10_metadata_v1_destroy (self->hdr10_metadata);
 
+  if (self->presentation)
+    wp_presentation_destroy (self->presentation);
+
   if (self->shell)
     wl_shell_destroy (self->shell);
 
@@ -278,6 +283,10 @@ output_handle_mode(void *data, struct wl_output *wl_output,
   if (flags & WL_OUTPUT_MODE_CURRENT) {
     self->width = width;
     self->height = height;
+    /* refresh is in mHz */
+    if (refresh > 0)
+      self->refresh = gst_util_uint64_scale_int_round (GST_SECOND, 1000,
+          refresh);
   }
 }
 
@@ -296,6 +305,19 @@ output_handle_scale(void *data, struct wl_output *wl_output,
   /* Nothing to do now */
 }
 
+static void
+presentation_handle_clock_id (void *data,
+    struct wp_presentation *presentation, uint32_t clk_id)
+{
+  GstWlDisplay *self = data;
+
+  self->presentation_clock_id = clk_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+  presentation_handle_clock_id
+};
+
 static const struct wl_output_listener output_listener = {
   output_handle_geometry,
   output_handle_mode,
@@ -333,6 +355,11 @@ registry_handle_global (void *data, struct wl_registry *registry,
   } else if (g_strcmp0 (interface, "zwp_hdr10_metadata_v1") == 0) {
     self->hdr10_metadata =
         wl_registry_bind (registry, id, &zwp_hdr10_metadata_v1_interface, 1);
+  } else if (g_strcmp0 (interface, "wp_presentation") == 0) {
+    self->presentation =
+        wl_registry_bind (registry, id, &wp_presentation_interface, 1);
+    wp_presentation_add_listener (self->presentation, &presentation_listener,
+        self);
   } else if (g_strcmp0 (interface, "wl_output") == 0) {
     self->output =
         wl_registry_bind (registry, id, &wl_output_interface, MIN (version, 2));
@@ -28,6 +28,9 @@
 #include "linux-dmabuf-unstable-v1-client-protocol.h"
 #include "alpha-compositing-unstable-v1-client-protocol.h"
 #include "hdr10-metadata-unstable-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
+
+#include <time.h>
 
 G_BEGIN_DECLS
 
@@ -60,6 +63,7 @@ struct _GstWlDisplay
   struct zwp_linux_dmabuf_v1 *dmabuf;
   struct zwp_alpha_compositing_v1 *alpha_compositing;
   struct zwp_hdr10_metadata_v1 *hdr10_metadata;
+  struct wp_presentation *presentation;
   GArray *shm_formats;
   GArray *dmabuf_formats;
   GHashTable *dmabuf_modifiers;
@@ -70,6 +74,12 @@ struct _GstWlDisplay
   /* preferred window resolution */
   gint preferred_width, preferred_height;
 
+  /* refresh interval of the current output mode, or GST_CLOCK_TIME_NONE */
+  GstClockTime refresh;
+
+  /* the clock presentation feedback timestamps are taken from */
+  clockid_t presentation_clock_id;
+
   /* private */
   gboolean own_display;
   GThread *thread;
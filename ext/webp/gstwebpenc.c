@@ -37,13 +37,27 @@ enum
   PROP_LOSSLESS,
   PROP_QUALITY,
   PROP_SPEED,
-  PROP_PRESET
+  PROP_PRESET,
+  PROP_USE_THREADS,
+  PROP_FRAME_THREADS
 };
 
 #define DEFAULT_LOSSLESS FALSE
 #define DEFAULT_QUALITY 90
 #define DEFAULT_SPEED 4
 #define DEFAULT_PRESET WEBP_PRESET_PHOTO
+#define DEFAULT_USE_THREADS FALSE
+#define DEFAULT_FRAME_THREADS 1
+
+typedef struct
+{
+  GstVideoCodecFrame *frame;
+  GstVideoFrame vframe;
+  WebPPicture picture;
+  WebPMemoryWriter writer;
+  gboolean done;
+  gboolean ok;
+} GstWebpEncJob;
 
 static void gst_webp_enc_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
@@ -57,6 +71,9 @@ static GstFlowReturn gst_webp_enc_handle_frame (GstVideoEncoder * encoder,
     GstVideoCodecFrame * frame);
 static gboolean gst_webp_enc_propose_allocation (GstVideoEncoder * encoder,
     GstQuery * query);
+static GstFlowReturn gst_webp_enc_finish (GstVideoEncoder * encoder);
+static gboolean gst_webp_enc_flush (GstVideoEncoder * encoder);
+static void gst_webp_enc_finalize (GObject * object);
 
 static GstStaticPadTemplate webp_enc_sink_factory =
 GST_STATIC_PAD_TEMPLATE ("sink",
@@ -123,6 +140,7 @@ gst_webp_enc_class_init (GstWebpEncClass * klass)
 
   gobject_class->set_property = gst_webp_enc_set_property;
   gobject_class->get_property = gst_webp_enc_get_property;
+  gobject_class->finalize = gst_webp_enc_finalize;
   gst_element_class_add_static_pad_template (element_class,
       &webp_enc_sink_factory);
   gst_element_class_add_static_pad_template (element_class,
@@ -136,6 +154,8 @@ gst_webp_enc_class_init (GstWebpEncClass * klass)
   venc_class->set_format = gst_webp_enc_set_format;
   venc_class->handle_frame = gst_webp_enc_handle_frame;
   venc_class->propose_allocation = gst_webp_enc_propose_allocation;
+  venc_class->finish = gst_webp_enc_finish;
+  venc_class->flush = gst_webp_enc_flush;
 
   g_object_class_install_property (gobject_class, PROP_LOSSLESS,
       g_param_spec_boolean ("lossless", "Lossless",
@@ -154,6 +174,16 @@ gst_webp_enc_class_init (GstWebpEncClass * klass)
           "Preset name for visual tuning",
           GST_WEBP_ENC_PRESET_TYPE, DEFAULT_PRESET,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_USE_THREADS,
+      g_param_spec_boolean ("use-threads", "Use Threads",
+          "When enabled, use multi-threaded encoding", DEFAULT_USE_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FRAME_THREADS,
+      g_param_spec_uint ("frame-threads", "Frame threads",
+          "Number of frames encoded in parallel (0 = number of processors, "
+          "1 = encode on the streaming thread)",
+          0, G_MAXINT, DEFAULT_FRAME_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   GST_DEBUG_CATEGORY_INIT (webpenc_debug, "webpenc", 0,
       "WEBP encoding element");
@@ -168,9 +198,26 @@ gst_webp_enc_init (GstWebpEnc * webpenc)
   webpenc->quality = DEFAULT_QUALITY;
   webpenc->speed = DEFAULT_SPEED;
   webpenc->preset = DEFAULT_PRESET;
+  webpenc->use_threads = DEFAULT_USE_THREADS;
+  webpenc->frame_threads = DEFAULT_FRAME_THREADS;
 
   webpenc->use_argb = FALSE;
   webpenc->rgb_format = GST_VIDEO_FORMAT_UNKNOWN;
+
+  g_queue_init (&webpenc->pending);
+  g_mutex_init (&webpenc->lock);
+  g_cond_init (&webpenc->cond);
+}
+
+static void
+gst_webp_enc_finalize (GObject * object)
+{
+  GstWebpEnc *webpenc = GST_WEBP_ENC (object);
+
+  g_mutex_clear (&webpenc->lock);
+  g_cond_clear (&webpenc->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static gboolean
@@ -181,6 +228,9 @@ gst_webp_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
   GstVideoInfo *info;
   GstVideoFormat format;
 
+  /* Frames in flight still refer to the previous settings */
+  gst_webp_enc_finish (encoder);
+
   info = &state->info;
   format = GST_VIDEO_INFO_FORMAT (info);
 
@@ -213,28 +263,29 @@ gst_webp_enc_set_format (GstVideoEncoder * encoder, GstVideoCodecState * state)
 }
 
 static gboolean
-gst_webp_set_picture_params (GstWebpEnc * enc)
+gst_webp_set_picture_params (GstWebpEnc * enc, WebPPicture * picture,
+    WebPMemoryWriter * writer)
 {
   GstVideoInfo *info;
   gboolean ret = TRUE;
 
   info = &enc->input_state->info;
 
-  if (!WebPPictureInit (&enc->webp_picture)) {
+  if (!WebPPictureInit (picture)) {
     ret = FALSE;
     goto failed_pic_init;
   }
 
-  enc->webp_picture.use_argb = enc->use_argb;
+  picture->use_argb = enc->use_argb;
   if (!enc->use_argb)
-    enc->webp_picture.colorspace = enc->webp_color_space;
+    picture->colorspace = enc->webp_color_space;
 
-  enc->webp_picture.width = GST_VIDEO_INFO_WIDTH (info);
-  enc->webp_picture.height = GST_VIDEO_INFO_HEIGHT (info);
+  picture->width = GST_VIDEO_INFO_WIDTH (info);
+  picture->height = GST_VIDEO_INFO_HEIGHT (info);
 
-  WebPMemoryWriterInit (&enc->webp_writer);
-  enc->webp_picture.writer = WebPMemoryWrite;
-  enc->webp_picture.custom_ptr = &enc->webp_writer;
+  WebPMemoryWriterInit (writer);
+  picture->writer = WebPMemoryWrite;
+  picture->custom_ptr = writer;
 
   return ret;
 
@@ -245,68 +296,171 @@ failed_pic_init:
   }
 }
 
+static void
+gst_webp_enc_worker (gpointer data, gpointer user_data)
+{
+  GstWebpEncJob *job = data;
+  GstWebpEnc *enc = GST_WEBP_ENC (user_data);
+  gboolean ok;
+
+  ok = WebPEncode (&enc->webp_config, &job->picture);
+
+  g_mutex_lock (&enc->lock);
+  job->ok = ok;
+  job->done = TRUE;
+  g_cond_broadcast (&enc->cond);
+  g_mutex_unlock (&enc->lock);
+}
+
+static GstFlowReturn
+gst_webp_enc_finish_job (GstWebpEnc * enc, GstWebpEncJob * job,
+    gboolean discard)
+{
+  GstVideoCodecFrame *frame = job->frame;
+  gboolean ok = job->ok;
+
+  WebPPictureFree (&job->picture);
+  gst_video_frame_unmap (&job->vframe);
+
+  /* The encoded data is handed downstream without copying it */
+  if (ok && !discard) {
+    frame->output_buffer = gst_buffer_new_wrapped_full (0, job->writer.mem,
+        job->writer.size, 0, job->writer.size, job->writer.mem, free);
+  } else {
+    free (job->writer.mem);
+  }
+  g_slice_free (GstWebpEncJob, job);
+
+  if (discard) {
+    gst_video_codec_frame_unref (frame);
+    return GST_FLOW_FLUSHING;
+  }
+
+  if (!ok) {
+    GST_ERROR_OBJECT (enc, "Failed to encode WebPPicture");
+    gst_video_codec_frame_unref (frame);
+    return GST_FLOW_ERROR;
+  }
+
+  return gst_video_encoder_finish_frame (GST_VIDEO_ENCODER (enc), frame);
+}
+
+/* Finishes encoded jobs in order, waiting for the oldest one while more
+ * than max_pending are queued */
+static GstFlowReturn
+gst_webp_enc_finish_jobs (GstWebpEnc * enc, guint max_pending,
+    gboolean discard)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstWebpEncJob *job;
+
+  g_mutex_lock (&enc->lock);
+  while ((job = g_queue_peek_head (&enc->pending))) {
+    GstFlowReturn job_ret;
+
+    if (!job->done) {
+      if (g_queue_get_length (&enc->pending) <= max_pending)
+        break;
+      g_cond_wait (&enc->cond, &enc->lock);
+      continue;
+    }
+
+    g_queue_pop_head (&enc->pending);
+    g_mutex_unlock (&enc->lock);
+    job_ret = gst_webp_enc_finish_job (enc, job, discard);
+    if (ret == GST_FLOW_OK)
+      ret = job_ret;
+    g_mutex_lock (&enc->lock);
+  }
+  g_mutex_unlock (&enc->lock);
+
+  return discard ? GST_FLOW_OK : ret;
+}
+
 static GstFlowReturn
 gst_webp_enc_handle_frame (GstVideoEncoder * encoder,
     GstVideoCodecFrame * frame)
 {
   GstWebpEnc *enc = GST_WEBP_ENC (encoder);
-  GstBuffer *out_buffer = NULL;
-  GstVideoFrame vframe;
+  GstWebpEncJob *job;
 
   GST_LOG_OBJECT (enc, "got new frame");
 
-  gst_webp_set_picture_params (enc);
+  job = g_slice_new0 (GstWebpEncJob);
+  job->frame = frame;
 
-  if (!gst_video_frame_map (&vframe, &enc->input_state->info,
-          frame->input_buffer, GST_MAP_READ))
+  if (!gst_webp_set_picture_params (enc, &job->picture, &job->writer)) {
+    g_slice_free (GstWebpEncJob, job);
+    gst_video_codec_frame_unref (frame);
     return GST_FLOW_ERROR;
+  }
+
+  if (!gst_video_frame_map (&job->vframe, &enc->input_state->info,
+          frame->input_buffer, GST_MAP_READ)) {
+    g_slice_free (GstWebpEncJob, job);
+    gst_video_codec_frame_unref (frame);
+    return GST_FLOW_ERROR;
+  }
 
   if (!enc->use_argb) {
-    enc->webp_picture.y = GST_VIDEO_FRAME_COMP_DATA (&vframe, 0);
-    enc->webp_picture.u = GST_VIDEO_FRAME_COMP_DATA (&vframe, 1);
-    enc->webp_picture.v = GST_VIDEO_FRAME_COMP_DATA (&vframe, 2);
+    job->picture.y = GST_VIDEO_FRAME_COMP_DATA (&job->vframe, 0);
+    job->picture.u = GST_VIDEO_FRAME_COMP_DATA (&job->vframe, 1);
+    job->picture.v = GST_VIDEO_FRAME_COMP_DATA (&job->vframe, 2);
 
-    enc->webp_picture.y_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0);
-    enc->webp_picture.uv_stride = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 1);
+    job->picture.y_stride = GST_VIDEO_FRAME_COMP_STRIDE (&job->vframe, 0);
+    job->picture.uv_stride = GST_VIDEO_FRAME_COMP_STRIDE (&job->vframe, 1);
 
   } else {
     switch (enc->rgb_format) {
       case GST_VIDEO_FORMAT_RGB:
-        WebPPictureImportRGB (&enc->webp_picture,
-            GST_VIDEO_FRAME_COMP_DATA (&vframe, 0),
-            GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0));
+        WebPPictureImportRGB (&job->picture,
+            GST_VIDEO_FRAME_COMP_DATA (&job->vframe, 0),
+            GST_VIDEO_FRAME_COMP_STRIDE (&job->vframe, 0));
         break;
       case GST_VIDEO_FORMAT_RGBA:
-        WebPPictureImportRGBA (&enc->webp_picture,
-            GST_VIDEO_FRAME_COMP_DATA (&vframe, 0),
-            GST_VIDEO_FRAME_COMP_STRIDE (&vframe, 0));
+        WebPPictureImportRGBA (&job->picture,
+            GST_VIDEO_FRAME_COMP_DATA (&job->vframe, 0),
+            GST_VIDEO_FRAME_COMP_STRIDE (&job->vframe, 0));
         break;
       default:
         break;
     }
   }
 
-  if (WebPEncode (&enc->webp_config, &enc->webp_picture)) {
-    WebPPictureFree (&enc->webp_picture);
-
-    out_buffer = gst_buffer_new_allocate (NULL, enc->webp_writer.size, NULL);
-    if (!out_buffer) {
-      GST_ERROR_OBJECT (enc, "Failed to create output buffer");
-      gst_video_frame_unmap (&vframe);
-      return GST_FLOW_ERROR;
-    }
-    gst_buffer_fill (out_buffer, 0, enc->webp_writer.mem,
-        enc->webp_writer.size);
-    free (enc->webp_writer.mem);
-  } else {
-    GST_ERROR_OBJECT (enc, "Failed to encode WebPPicture");
-    gst_video_frame_unmap (&vframe);
-    return GST_FLOW_ERROR;
+  if (!enc->pool) {
+    job->ok = WebPEncode (&enc->webp_config, &job->picture);
+    return gst_webp_enc_finish_job (enc, job, FALSE);
   }
 
-  gst_video_frame_unmap (&vframe);
-  frame->output_buffer = out_buffer;
-  return gst_video_encoder_finish_frame (encoder, frame);
+  g_mutex_lock (&enc->lock);
+  g_queue_push_tail (&enc->pending, job);
+  g_mutex_unlock (&enc->lock);
+
+  g_thread_pool_push (enc->pool, job, NULL);
+
+  /* Keep at most one frame per thread in flight */
+  return gst_webp_enc_finish_jobs (enc,
+      g_thread_pool_get_max_threads (enc->pool), FALSE);
+}
+
+static GstFlowReturn
+gst_webp_enc_finish (GstVideoEncoder * encoder)
+{
+  GstWebpEnc *enc = GST_WEBP_ENC (encoder);
+
+  GST_DEBUG_OBJECT (enc, "Finishing pending frames");
+  return gst_webp_enc_finish_jobs (enc, 0, FALSE);
+}
+
+static gboolean
+gst_webp_enc_flush (GstVideoEncoder * encoder)
+{
+  GstWebpEnc *enc = GST_WEBP_ENC (encoder);
+
+  GST_DEBUG_OBJECT (enc, "Discarding pending frames");
+  gst_webp_enc_finish_jobs (enc, 0, TRUE);
+
+  return TRUE;
 }
 
 static gboolean
@@ -337,6 +491,12 @@ gst_webp_enc_set_property (GObject * object, guint prop_id,
     case PROP_PRESET:
       webpenc->preset = g_value_get_enum (value);
       break;
+    case PROP_USE_THREADS:
+      webpenc->use_threads = g_value_get_boolean (value);
+      break;
+    case PROP_FRAME_THREADS:
+      webpenc->frame_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -363,6 +523,12 @@ gst_webp_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PRESET:
       g_value_set_enum (value, webpenc->preset);
       break;
+    case PROP_USE_THREADS:
+      g_value_set_boolean (value, webpenc->use_threads);
+      break;
+    case PROP_FRAME_THREADS:
+      g_value_set_uint (value, webpenc->frame_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -373,6 +539,7 @@ static gboolean
 gst_webp_enc_start (GstVideoEncoder * benc)
 {
   GstWebpEnc *enc = (GstWebpEnc *) benc;
+  guint n_threads;
 
   if (!WebPConfigPreset (&enc->webp_config, enc->preset, enc->quality)) {
     GST_ERROR_OBJECT (enc, "Failed to Initialize WebPConfig ");
@@ -381,10 +548,19 @@ gst_webp_enc_start (GstVideoEncoder * benc)
 
   enc->webp_config.lossless = enc->lossless;
   enc->webp_config.method = enc->speed;
+  enc->webp_config.thread_level = enc->use_threads;
   if (!WebPValidateConfig (&enc->webp_config)) {
     GST_ERROR_OBJECT (enc, "Failed to Validate the WebPConfig");
     return FALSE;
   }
+
+  n_threads = enc->frame_threads ? enc->frame_threads : g_get_num_processors ();
+  if (n_threads > 1) {
+    GST_DEBUG_OBJECT (enc, "Encoding %u frames in parallel", n_threads);
+    enc->pool = g_thread_pool_new (gst_webp_enc_worker, enc, n_threads,
+        FALSE, NULL);
+  }
+
   return TRUE;
 }
 
@@ -392,8 +568,17 @@ static gboolean
 gst_webp_enc_stop (GstVideoEncoder * benc)
 {
   GstWebpEnc *enc = GST_WEBP_ENC (benc);
-  if (enc->input_state)
+
+  if (enc->pool) {
+    gst_webp_enc_finish_jobs (enc, 0, TRUE);
+    g_thread_pool_free (enc->pool, FALSE, TRUE);
+    enc->pool = NULL;
+  }
+
+  if (enc->input_state) {
     gst_video_codec_state_unref (enc->input_state);
+    enc->input_state = NULL;
+  }
   return TRUE;
 }
 
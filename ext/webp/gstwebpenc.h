@@ -54,14 +54,20 @@ struct _GstWebpEnc
   gfloat quality;
   guint speed;
   gint preset;
+  gboolean use_threads;
+  guint frame_threads;
 
   gboolean use_argb;
   GstVideoFormat rgb_format;
 
   WebPEncCSP webp_color_space;
   struct WebPConfig webp_config;
-  struct WebPPicture webp_picture;
-  WebPMemoryWriter webp_writer;
+
+  /* frames encoded in parallel, pending ones are finished in order */
+  GThreadPool *pool;
+  GQueue pending;
+  GMutex lock;
+  GCond cond;
 };
 
 struct _GstWebpEncClass
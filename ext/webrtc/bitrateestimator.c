@@ -0,0 +1,105 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Send side bandwidth estimation from the RTCP receiver reports, along the
+ * lines of the loss based controller of Google Congestion Control
+ * (draft-ietf-rmcat-gcc). The round trip time growing above its base value
+ * is used as the delay signal, as the per packet arrival times of
+ * transport-cc feedback are not available. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "bitrateestimator.h"
+
+#include <math.h>
+
+/* above this loss the estimate is decreased, below the low one it is
+ * increased */
+#define LOSS_HIGH 0.10
+#define LOSS_LOW 0.02
+/* multiplicative increase per second without loss or queuing */
+#define INCREASE_PER_SECOND 1.08
+/* decrease when the round trip time shows queuing */
+#define DELAY_DECREASE 0.85
+/* queuing delay, in seconds, above which the link is considered
+ * overused */
+#define QUEUING_DELAY_THRESHOLD 0.025
+/* how fast the base rtt follows increases, so a route change isn't taken as
+ * congestion forever */
+#define BASE_RTT_FOLLOW 0.01
+
+BitrateEstimator *
+bitrate_estimator_new (void)
+{
+  BitrateEstimator *estimator = g_new0 (BitrateEstimator, 1);
+
+  estimator->last_update = GST_CLOCK_TIME_NONE;
+
+  return estimator;
+}
+
+void
+bitrate_estimator_free (BitrateEstimator * estimator)
+{
+  g_free (estimator);
+}
+
+/* Updates the estimate with the @fraction_lost and @rtt (in seconds, 0 if
+ * unknown) of a receiver report. Returns %TRUE if the estimate changed */
+gboolean
+bitrate_estimator_update (BitrateEstimator * estimator, gdouble fraction_lost,
+    gdouble rtt, GstClockTime now, guint start_bitrate, guint min_bitrate,
+    guint max_bitrate)
+{
+  gdouble bitrate, elapsed = 0.0;
+  guint old_bitrate = estimator->bitrate;
+
+  if (estimator->bitrate == 0)
+    estimator->bitrate = start_bitrate;
+  bitrate = estimator->bitrate;
+
+  if (GST_CLOCK_TIME_IS_VALID (estimator->last_update)
+      && now > estimator->last_update)
+    elapsed = MIN (1.0, (gdouble) (now - estimator->last_update) / GST_SECOND);
+  estimator->last_update = now;
+
+  if (rtt > 0.0) {
+    if (estimator->base_rtt == 0.0 || rtt < estimator->base_rtt)
+      estimator->base_rtt = rtt;
+    else
+      estimator->base_rtt += (rtt - estimator->base_rtt) * BASE_RTT_FOLLOW;
+  }
+
+  if (fraction_lost > LOSS_HIGH) {
+    bitrate *= 1.0 - 0.5 * fraction_lost;
+  } else if (rtt > 0.0 && rtt - estimator->base_rtt >
+      MAX (QUEUING_DELAY_THRESHOLD, estimator->base_rtt * 0.5)) {
+    bitrate *= DELAY_DECREASE;
+  } else if (fraction_lost < LOSS_LOW) {
+    bitrate *= pow (INCREASE_PER_SECOND, elapsed);
+  }
+
+  if (max_bitrate != 0)
+    bitrate = MIN (bitrate, max_bitrate);
+  bitrate = MAX (bitrate, min_bitrate);
+  estimator->bitrate = MIN (bitrate, G_MAXUINT);
+
+  return estimator->bitrate != old_bitrate;
+}
@@ -0,0 +1,48 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BITRATE_ESTIMATOR_H__
+#define __BITRATE_ESTIMATOR_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  guint                     bitrate;                /* current estimate, 0 before the first report */
+  gdouble                   base_rtt;               /* round trip time without queuing, in seconds */
+  GstClockTime              last_update;
+} BitrateEstimator;
+
+G_GNUC_INTERNAL
+BitrateEstimator *      bitrate_estimator_new       (void);
+G_GNUC_INTERNAL
+void                    bitrate_estimator_free      (BitrateEstimator * estimator);
+G_GNUC_INTERNAL
+gboolean                bitrate_estimator_update    (BitrateEstimator * estimator,
+                                                     gdouble fraction_lost,
+                                                     gdouble rtt,
+                                                     GstClockTime now,
+                                                     guint start_bitrate,
+                                                     guint min_bitrate,
+                                                     guint max_bitrate);
+
+G_END_DECLS
+
+#endif /* __BITRATE_ESTIMATOR_H__ */
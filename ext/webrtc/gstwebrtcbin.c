@@ -22,6 +22,7 @@
 #endif
 
 #include "gstwebrtcbin.h"
+#include "bitrateestimator.h"
 #include "gstwebrtcstats.h"
 #include "transportstream.h"
 #include "transportreceivebin.h"
@@ -29,6 +30,8 @@
 #include "webrtcsdp.h"
 #include "webrtctransceiver.h"
 
+#include <gst/rtp/rtp.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -124,6 +127,9 @@ gst_webrtc_bin_pad_finalize (GObject * object)
     gst_caps_unref (pad->received_caps);
   pad->received_caps = NULL;
 
+  g_free (pad->rid);
+  pad->rid = NULL;
+
   G_OBJECT_CLASS (gst_webrtc_bin_pad_parent_class)->finalize (object);
 }
 
@@ -230,6 +236,14 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink_%u",
     GST_PAD_REQUEST,
     GST_STATIC_CAPS ("application/x-rtp"));
 
+/* https://tools.ietf.org/html/draft-ietf-mmusic-sdp-simulcast-13
+ * sink_<mlineindex>_<rid> */
+static GstStaticPadTemplate simulcast_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink_%u_%s",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src_%u",
     GST_PAD_SRC,
     GST_PAD_SOMETIMES,
@@ -243,12 +257,15 @@ enum
   SET_LOCAL_DESCRIPTION_SIGNAL,
   SET_REMOTE_DESCRIPTION_SIGNAL,
   ADD_ICE_CANDIDATE_SIGNAL,
+  ADD_ICE_CANDIDATES_SIGNAL,
   ON_NEGOTIATION_NEEDED_SIGNAL,
   ON_ICE_CANDIDATE_SIGNAL,
   ON_NEW_TRANSCEIVER_SIGNAL,
   GET_STATS_SIGNAL,
+  GET_STATS_OF_TYPE_SIGNAL,
   ADD_TRANSCEIVER_SIGNAL,
   GET_TRANSCEIVERS_SIGNAL,
+  ON_BANDWIDTH_ESTIMATE_SIGNAL,
   LAST_SIGNAL,
 };
 
@@ -267,8 +284,27 @@ enum
   PROP_PENDING_REMOTE_DESCRIPTION,
   PROP_STUN_SERVER,
   PROP_TURN_SERVER,
+  PROP_ICE_LITE,
+  PROP_LOCAL_ADDRESSES,
+  PROP_START_BITRATE,
+  PROP_MIN_BITRATE,
+  PROP_MAX_BITRATE,
+  PROP_DO_NACK,
+  PROP_FEC_TYPE,
+  PROP_FEC_PERCENTAGE,
 };
 
+#define DEFAULT_START_BITRATE 300000
+#define DEFAULT_MIN_BITRATE 30000
+#define DEFAULT_MAX_BITRATE 0
+#define DEFAULT_DO_NACK FALSE
+#define DEFAULT_FEC_TYPE GST_WEBRTC_FEC_TYPE_NONE
+#define DEFAULT_FEC_PERCENTAGE 100
+
+/* https://tools.ietf.org/html/draft-ietf-avtext-rid-09 */
+#define RID_EXTMAP_ID 1
+#define RID_EXTMAP_URI "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id"
+
 static guint gst_webrtc_bin_signals[LAST_SIGNAL] = { 0 };
 
 static GstWebRTCDTLSTransport *
@@ -305,17 +341,14 @@ typedef struct
 GstWebRTCICEStream *
 _find_ice_stream_for_session (GstWebRTCBin * webrtc, guint session_id)
 {
-  int i;
-
-  for (i = 0; i < webrtc->priv->ice_stream_map->len; i++) {
-    IceStreamItem *item =
-        &g_array_index (webrtc->priv->ice_stream_map, IceStreamItem, i);
+  GstWebRTCICEStream *stream;
 
-    if (item->session_id == session_id) {
-      GST_TRACE_OBJECT (webrtc, "Found ice stream id %" GST_PTR_FORMAT " for "
-          "session %u", item->stream, session_id);
-      return item->stream;
-    }
+  stream = g_hash_table_lookup (webrtc->priv->ice_stream_session_index,
+      GUINT_TO_POINTER (session_id));
+  if (stream) {
+    GST_TRACE_OBJECT (webrtc, "Found ice stream id %" GST_PTR_FORMAT " for "
+        "session %u", stream, session_id);
+    return stream;
   }
 
   GST_TRACE_OBJECT (webrtc, "No ice stream available for session %u",
@@ -332,6 +365,11 @@ _add_ice_stream_item (GstWebRTCBin * webrtc, guint session_id,
   GST_TRACE_OBJECT (webrtc, "adding ice stream %" GST_PTR_FORMAT " for "
       "session %u", stream, session_id);
   g_array_append_val (webrtc->priv->ice_stream_map, item);
+  /* the first stream of a session is the one found in the array */
+  if (!g_hash_table_contains (webrtc->priv->ice_stream_session_index,
+          GUINT_TO_POINTER (session_id)))
+    g_hash_table_insert (webrtc->priv->ice_stream_session_index,
+        GUINT_TO_POINTER (session_id), stream);
 }
 
 typedef struct
@@ -384,8 +422,8 @@ _find_transceiver_for_mline (GstWebRTCBin * webrtc, guint mlineindex)
 {
   GstWebRTCRTPTransceiver *trans;
 
-  trans = _find_transceiver (webrtc, &mlineindex,
-      (FindTransceiverFunc) transceiver_match_for_mline);
+  trans = g_hash_table_lookup (webrtc->priv->transceiver_mline_index,
+      GUINT_TO_POINTER (mlineindex));
 
   GST_TRACE_OBJECT (webrtc,
       "Found transceiver %" GST_PTR_FORMAT " for mlineindex %u", trans,
@@ -394,31 +432,62 @@ _find_transceiver_for_mline (GstWebRTCBin * webrtc, guint mlineindex)
   return trans;
 }
 
-typedef gboolean (*FindTransportFunc) (TransportStream * p1,
-    gconstpointer data);
+static GstWebRTCRTPTransceiver *
+_find_transceiver_for_mid (GstWebRTCBin * webrtc, const gchar * mid)
+{
+  return g_hash_table_lookup (webrtc->priv->transceiver_mid_index, mid);
+}
 
-static TransportStream *
-_find_transport (GstWebRTCBin * webrtc, gconstpointer data,
-    FindTransportFunc func)
+/* The indexes map each mline and mid to a single transceiver. They are not
+ * expected to be shared, the array is only scanned for another transceiver
+ * when the indexed one changes */
+static void
+_set_transceiver_mline (GstWebRTCBin * webrtc,
+    GstWebRTCRTPTransceiver * trans, guint mline)
 {
-  int i;
+  GHashTable *index = webrtc->priv->transceiver_mline_index;
+  guint old_mline = trans->mline;
 
-  for (i = 0; i < webrtc->priv->transports->len; i++) {
-    TransportStream *stream =
-        g_array_index (webrtc->priv->transports, TransportStream *,
-        i);
+  trans->mline = mline;
+
+  if (old_mline != mline && old_mline != -1
+      && g_hash_table_lookup (index, GUINT_TO_POINTER (old_mline)) == trans) {
+    GstWebRTCRTPTransceiver *other;
 
-    if (func (stream, data))
-      return stream;
+    g_hash_table_remove (index, GUINT_TO_POINTER (old_mline));
+    other = _find_transceiver (webrtc, &old_mline,
+        (FindTransceiverFunc) transceiver_match_for_mline);
+    if (other)
+      g_hash_table_insert (index, GUINT_TO_POINTER (old_mline), other);
   }
 
-  return NULL;
+  if (mline != -1 && !g_hash_table_contains (index, GUINT_TO_POINTER (mline)))
+    g_hash_table_insert (index, GUINT_TO_POINTER (mline), trans);
 }
 
-static gboolean
-match_stream_for_session (TransportStream * trans, guint * session)
+static void
+_set_transceiver_mid (GstWebRTCBin * webrtc,
+    GstWebRTCRTPTransceiver * trans, const gchar * mid)
 {
-  return trans->session_id == *session;
+  GHashTable *index = webrtc->priv->transceiver_mid_index;
+  gchar *old_mid = trans->mid;
+
+  trans->mid = g_strdup (mid);
+
+  if (old_mid && g_strcmp0 (old_mid, mid) != 0
+      && g_hash_table_lookup (index, old_mid) == trans) {
+    GstWebRTCRTPTransceiver *other;
+
+    g_hash_table_remove (index, old_mid);
+    other = _find_transceiver (webrtc, old_mid,
+        (FindTransceiverFunc) match_for_mid);
+    if (other)
+      g_hash_table_insert (index, g_strdup (old_mid), other);
+  }
+  g_free (old_mid);
+
+  if (mid && !g_hash_table_contains (index, mid))
+    g_hash_table_insert (index, g_strdup (mid), trans);
 }
 
 static TransportStream *
@@ -426,8 +495,8 @@ _find_transport_for_session (GstWebRTCBin * webrtc, guint session_id)
 {
   TransportStream *stream;
 
-  stream = _find_transport (webrtc, &session_id,
-      (FindTransportFunc) match_stream_for_session);
+  stream = g_hash_table_lookup (webrtc->priv->transport_session_index,
+      GUINT_TO_POINTER (session_id));
 
   GST_TRACE_OBJECT (webrtc,
       "Found transport %" GST_PTR_FORMAT " for session %u", stream, session_id);
@@ -470,11 +539,43 @@ _find_pad (GstWebRTCBin * webrtc, gconstpointer data, FindPadFunc func)
   return NULL;
 }
 
+static GHashTable *
+_get_pad_index (GstWebRTCBin * webrtc, GstPadDirection direction)
+{
+  return direction == GST_PAD_SRC ? webrtc->priv->src_pad_index :
+      webrtc->priv->sink_pad_index;
+}
+
+/* must be called with the object lock */
+static void
+_index_pad (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
+{
+  GHashTable *index = _get_pad_index (webrtc, GST_PAD_DIRECTION (pad));
+
+  /* simulcast layers are only reachable through their transceiver */
+  if (pad->rid)
+    return;
+
+  if (!g_hash_table_contains (index, GUINT_TO_POINTER (pad->mlineindex)))
+    g_hash_table_insert (index, GUINT_TO_POINTER (pad->mlineindex), pad);
+}
+
+/* must be called with the object lock */
+static void
+_unindex_pad (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
+{
+  GHashTable *index = _get_pad_index (webrtc, GST_PAD_DIRECTION (pad));
+
+  if (g_hash_table_lookup (index, GUINT_TO_POINTER (pad->mlineindex)) == pad)
+    g_hash_table_remove (index, GUINT_TO_POINTER (pad->mlineindex));
+}
+
 static void
 _add_pad_to_list (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
 {
   GST_OBJECT_LOCK (webrtc);
   webrtc->priv->pending_pads = g_list_prepend (webrtc->priv->pending_pads, pad);
+  _index_pad (webrtc, pad);
   GST_OBJECT_UNLOCK (webrtc);
 }
 
@@ -493,6 +594,9 @@ _add_pad (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
 
   if (webrtc->priv->running)
     gst_pad_set_active (GST_PAD (pad), TRUE);
+  GST_OBJECT_LOCK (webrtc);
+  _index_pad (webrtc, pad);
+  GST_OBJECT_UNLOCK (webrtc);
   gst_element_add_pad (GST_ELEMENT (webrtc), GST_PAD (pad));
 }
 
@@ -501,29 +605,26 @@ _remove_pad (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
 {
   _remove_pending_pad (webrtc, pad);
 
+  GST_OBJECT_LOCK (webrtc);
+  _unindex_pad (webrtc, pad);
+  GST_OBJECT_UNLOCK (webrtc);
   gst_element_remove_pad (GST_ELEMENT (webrtc), GST_PAD (pad));
 }
 
-typedef struct
-{
-  GstPadDirection direction;
-  guint mlineindex;
-} MLineMatch;
-
-static gboolean
-pad_match_for_mline (GstWebRTCBinPad * pad, const MLineMatch * match)
-{
-  return GST_PAD_DIRECTION (pad) == match->direction
-      && pad->mlineindex == match->mlineindex;
-}
-
 static GstWebRTCBinPad *
 _find_pad_for_mline (GstWebRTCBin * webrtc, GstPadDirection direction,
     guint mlineindex)
 {
-  MLineMatch m = { direction, mlineindex };
+  GstWebRTCBinPad *pad;
 
-  return _find_pad (webrtc, &m, (FindPadFunc) pad_match_for_mline);
+  GST_OBJECT_LOCK (webrtc);
+  pad = g_hash_table_lookup (_get_pad_index (webrtc, direction),
+      GUINT_TO_POINTER (mlineindex));
+  if (pad)
+    gst_object_ref (pad);
+  GST_OBJECT_UNLOCK (webrtc);
+
+  return pad;
 }
 
 typedef struct
@@ -543,6 +644,15 @@ _find_pad_for_transceiver (GstWebRTCBin * webrtc, GstPadDirection direction,
     GstWebRTCRTPTransceiver * trans)
 {
   TransMatch m = { direction, trans };
+  GstWebRTCBinPad *pad;
+
+  /* the pad of a transceiver is usually the one of its mline */
+  pad = _find_pad_for_mline (webrtc, direction, trans->mline);
+  if (pad) {
+    if (pad->trans == trans)
+      return pad;
+    gst_object_unref (pad);
+  }
 
   return _find_pad (webrtc, &m, (FindPadFunc) pad_match_for_transceiver);
 }
@@ -1343,9 +1453,17 @@ _create_webrtc_transceiver (GstWebRTCBin * webrtc,
   trans = webrtc_transceiver_new (webrtc, sender, receiver);
   rtp_trans = GST_WEBRTC_RTP_TRANSCEIVER (trans);
   rtp_trans->direction = direction;
-  rtp_trans->mline = mline;
+
+  /* loss recovery defaults, including for the transceivers implicitly
+   * created for the media of a remote offer */
+  GST_OBJECT_LOCK (webrtc);
+  g_object_set (trans, "do-nack", webrtc->priv->do_nack, "fec-type",
+      webrtc->priv->fec_type, "fec-percentage", webrtc->priv->fec_percentage,
+      NULL);
+  GST_OBJECT_UNLOCK (webrtc);
 
   g_array_append_val (webrtc->priv->transceivers, trans);
+  _set_transceiver_mline (webrtc, rtp_trans, mline);
 
   gst_object_unref (sender);
   gst_object_unref (receiver);
@@ -1401,6 +1519,10 @@ _create_transport_channel (GstWebRTCBin * webrtc, guint session_id)
   g_free (pad_name);
 
   g_array_append_val (webrtc->priv->transports, ret);
+  if (!g_hash_table_contains (webrtc->priv->transport_session_index,
+          GUINT_TO_POINTER (ret->session_id)))
+    g_hash_table_insert (webrtc->priv->transport_session_index,
+        GUINT_TO_POINTER (ret->session_id), ret);
 
   GST_TRACE_OBJECT (webrtc,
       "Create transport %" GST_PTR_FORMAT " for session %u", ret, session_id);
@@ -1622,6 +1744,48 @@ _media_add_ssrcs (GstSDPMedia * media, GstCaps * caps, GstWebRTCBin * webrtc,
         (GstStructureForeachFunc) _media_add_rtx_ssrc, &data);
 }
 
+static gchar **
+_transceiver_dup_rids (WebRTCTransceiver * trans)
+{
+  gchar **rids = NULL;
+
+  GST_OBJECT_LOCK (trans);
+  if (trans->rids && trans->rids[0])
+    rids = g_strdupv (trans->rids);
+  GST_OBJECT_UNLOCK (trans);
+
+  return rids;
+}
+
+/* https://tools.ietf.org/html/draft-ietf-mmusic-sdp-simulcast-13 */
+static void
+_media_add_simulcast (GstSDPMedia * media, WebRTCTransceiver * trans)
+{
+  gchar **rids, *str, *val;
+  guint i;
+
+  if (!(rids = _transceiver_dup_rids (trans)))
+    return;
+
+  str = g_strdup_printf ("%u %s", RID_EXTMAP_ID, RID_EXTMAP_URI);
+  gst_sdp_media_add_attribute (media, "extmap", str);
+  g_free (str);
+
+  for (i = 0; rids[i]; i++) {
+    str = g_strdup_printf ("%s send", rids[i]);
+    gst_sdp_media_add_attribute (media, "rid", str);
+    g_free (str);
+  }
+
+  str = g_strjoinv (";", rids);
+  val = g_strdup_printf ("send %s", str);
+  gst_sdp_media_add_attribute (media, "simulcast", val);
+  g_free (val);
+  g_free (str);
+
+  g_strfreev (rids);
+}
+
 /* based off https://tools.ietf.org/html/draft-ietf-rtcweb-jsep-18#section-5.2.1 */
 static gboolean
 sdp_media_from_transceiver (GstWebRTCBin * webrtc, GstSDPMedia * media,
@@ -1731,6 +1895,12 @@ sdp_media_from_transceiver (GstWebRTCBin * webrtc, GstSDPMedia * media,
   gst_sdp_media_add_attribute (media, "mid", sdp_mid);
   g_free (sdp_mid);
 
+  if (type == GST_WEBRTC_SDP_TYPE_OFFER
+      && (trans->direction == GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDONLY
+          || trans->direction ==
+          GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDRECV))
+    _media_add_simulcast (media, WEBRTC_TRANSCEIVER (trans));
+
   if (trans->sender) {
     gchar *cert, *fingerprint, *val;
 
@@ -1781,6 +1951,8 @@ _create_offer_task (GstWebRTCBin * webrtc, const GstStructure * options)
   gst_sdp_message_set_session_name (ret, "-");
   gst_sdp_message_add_time (ret, "0", "0", NULL);
   gst_sdp_message_add_attribute (ret, "ice-options", "trickle");
+  if (webrtc->priv->ice->ice_lite)
+    gst_sdp_message_add_attribute (ret, "ice-lite", NULL);
 
   /* https://tools.ietf.org/html/draft-ietf-mmusic-msid-05#section-3 */
   str = g_strdup_printf ("WMS %s", GST_OBJECT (webrtc)->name);
@@ -1817,8 +1989,10 @@ _create_offer_task (GstWebRTCBin * webrtc, const GstStructure * options)
 
   /* FIXME: pre-emptively setup receiving elements when needed */
 
-  /* XXX: only true for the initial offerer */
-  g_object_set (webrtc->priv->ice, "controller", TRUE, NULL);
+  /* XXX: only true for the initial offerer, an ICE-lite agent never
+   * controls */
+  g_object_set (webrtc->priv->ice, "controller",
+      !webrtc->priv->ice->ice_lite, NULL);
 
   return ret;
 }
@@ -1966,6 +2140,8 @@ _create_answer_task (GstWebRTCBin * webrtc, const GstStructure * options)
       gst_sdp_message_add_attribute (ret, attr->key, attr->value);
     }
   }
+  if (webrtc->priv->ice->ice_lite)
+    gst_sdp_message_add_attribute (ret, "ice-lite", NULL);
 
   for (i = 0; i < gst_sdp_message_medias_len (pending_remote->sdp); i++) {
     /* FIXME:
@@ -2178,8 +2354,11 @@ _create_answer_task (GstWebRTCBin * webrtc, const GstStructure * options)
 
   /* FIXME: can we add not matched transceivers? */
 
-  /* XXX: only true for the initial offerer */
-  g_object_set (webrtc->priv->ice, "controller", FALSE, NULL);
+  /* XXX: only true for the initial offerer, unless the offerer is an ICE-lite
+   * agent that can't control */
+  g_object_set (webrtc->priv->ice, "controller",
+      !webrtc->priv->ice->ice_lite
+      && _session_has_attribute_key (pending_remote->sdp, "ice-lite"), NULL);
 
   return ret;
 }
@@ -2294,21 +2473,98 @@ _find_transceiver_for_sdp_media (GstWebRTCBin * webrtc,
     const GstSDPAttribute *attr = gst_sdp_media_get_attribute (media, i);
 
     if (g_strcmp0 (attr->key, "mid") == 0) {
-      if ((ret =
-              _find_transceiver (webrtc, attr->value,
-                  (FindTransceiverFunc) match_for_mid)))
+      if ((ret = _find_transceiver_for_mid (webrtc, attr->value)))
         goto out;
     }
   }
 
-  ret = _find_transceiver (webrtc, &media_idx,
-      (FindTransceiverFunc) transceiver_match_for_mline);
+  ret = _find_transceiver_for_mline (webrtc, media_idx);
 
 out:
   GST_TRACE_OBJECT (webrtc, "Found transceiver %" GST_PTR_FORMAT, ret);
   return ret;
 }
 
+static gboolean
+_add_rid_extension (GstBuffer ** buffer, guint idx, const gchar * rid)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  *buffer = gst_buffer_make_writable (*buffer);
+  if (!gst_rtp_buffer_map (*buffer, GST_MAP_READWRITE, &rtp))
+    return TRUE;
+
+  if (!gst_rtp_buffer_add_extension_onebyte_header (&rtp, RID_EXTMAP_ID, rid,
+          strlen (rid)))
+    GST_LOG ("could not add rid %s to %" GST_PTR_FORMAT, rid, *buffer);
+
+  gst_rtp_buffer_unmap (&rtp);
+
+  return TRUE;
+}
+
+static GstPadProbeReturn
+_simulcast_rid_probe (GstPad * pad, GstPadProbeInfo * info, const gchar * rid)
+{
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+    _add_rid_extension (&buffer, 0, rid);
+    GST_PAD_PROBE_INFO_DATA (info) = buffer;
+  } else if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+
+    list = gst_buffer_list_make_writable (list);
+    gst_buffer_list_foreach (list, (GstBufferListFunc) _add_rid_extension,
+        (gpointer) rid);
+    GST_PAD_PROBE_INFO_DATA (info) = list;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* all the layers of a simulcast transceiver share its rtpbin session */
+static GstPad *
+_request_simulcast_sink (GstWebRTCBin * webrtc, WebRTCTransceiver * trans,
+    guint mlineindex)
+{
+  if (!trans->simulcast_funnel) {
+    GstPadTemplate *rtp_templ;
+    GstPad *rtp_sink, *srcpad;
+    GstElement *funnel;
+    gchar *pad_name;
+
+    funnel = gst_element_factory_make ("rtpfunnel", NULL);
+    if (!funnel) {
+      GST_ELEMENT_ERROR (webrtc, CORE, MISSING_PLUGIN, NULL,
+          ("%s", "rtpfunnel element is not available"));
+      return NULL;
+    }
+    gst_bin_add (GST_BIN (webrtc), funnel);
+    trans->simulcast_funnel = gst_object_ref (funnel);
+
+    rtp_templ =
+        _find_pad_template (webrtc->rtpbin, GST_PAD_SINK, GST_PAD_REQUEST,
+        "send_rtp_sink_%u");
+    g_assert (rtp_templ);
+
+    pad_name = g_strdup_printf ("send_rtp_sink_%u", mlineindex);
+    rtp_sink =
+        gst_element_request_pad (webrtc->rtpbin, rtp_templ, pad_name, NULL);
+    g_free (pad_name);
+
+    srcpad = gst_element_get_static_pad (funnel, "src");
+    if (gst_pad_link (srcpad, rtp_sink) != GST_PAD_LINK_OK)
+      g_warn_if_reached ();
+    gst_object_unref (srcpad);
+    gst_object_unref (rtp_sink);
+
+    gst_element_sync_state_with_parent (funnel);
+  }
+
+  return gst_element_get_request_pad (trans->simulcast_funnel, "sink_%u");
+}
+
 static GstPad *
 _connect_input_stream (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
 {
@@ -2323,30 +2579,51 @@ _connect_input_stream (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
  * o----------o send_rtp_sink_%u   ;                           ;
  * ;          '--------------------'                           ;
  * '--------------------- -------------------------------------'
+ *
+ * With simulcast, sink_%u and every sink_%u_%s go through an rtpfunnel in
+ * front of send_rtp_sink_%u and get their rid header extension added.
  */
-  GstPadTemplate *rtp_templ;
-  GstPad *rtp_sink;
+  GstPad *rtp_sink, *send_sink;
   gchar *pad_name;
+  gchar **rids;
   WebRTCTransceiver *trans;
 
   g_return_val_if_fail (pad->trans != NULL, NULL);
 
   GST_INFO_OBJECT (pad, "linking input stream %u", pad->mlineindex);
 
-  rtp_templ =
-      _find_pad_template (webrtc->rtpbin, GST_PAD_SINK, GST_PAD_REQUEST,
-      "send_rtp_sink_%u");
-  g_assert (rtp_templ);
+  trans = WEBRTC_TRANSCEIVER (pad->trans);
+  rids = _transceiver_dup_rids (trans);
+
+  if (pad->rid || rids) {
+    const gchar *rid = pad->rid ? pad->rid : rids[0];
+
+    rtp_sink = _request_simulcast_sink (webrtc, trans, pad->mlineindex);
+    if (!rtp_sink) {
+      g_strfreev (rids);
+      return NULL;
+    }
+
+    GST_DEBUG_OBJECT (pad, "sending simulcast layer %s", rid);
+    gst_pad_add_probe (GST_PAD (pad), GST_PAD_PROBE_TYPE_BUFFER |
+        GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        (GstPadProbeCallback) _simulcast_rid_probe, g_strdup (rid), g_free);
+  } else {
+    GstPadTemplate *rtp_templ =
+        _find_pad_template (webrtc->rtpbin, GST_PAD_SINK, GST_PAD_REQUEST,
+        "send_rtp_sink_%u");
+    g_assert (rtp_templ);
+
+    pad_name = g_strdup_printf ("send_rtp_sink_%u", pad->mlineindex);
+    rtp_sink =
+        gst_element_request_pad (webrtc->rtpbin, rtp_templ, pad_name, NULL);
+    g_free (pad_name);
+  }
+  g_strfreev (rids);
 
-  pad_name = g_strdup_printf ("send_rtp_sink_%u", pad->mlineindex);
-  rtp_sink =
-      gst_element_request_pad (webrtc->rtpbin, rtp_templ, pad_name, NULL);
-  g_free (pad_name);
   gst_ghost_pad_set_target (GST_GHOST_PAD (pad), rtp_sink);
   gst_object_unref (rtp_sink);
 
-  trans = WEBRTC_TRANSCEIVER (pad->trans);
-
   if (!trans->stream) {
     TransportStream *item;
     /* FIXME: bundle */
@@ -2356,11 +2633,17 @@ _connect_input_stream (GstWebRTCBin * webrtc, GstWebRTCBinPad * pad)
     webrtc_transceiver_set_transport (trans, item);
   }
 
-  pad_name = g_strdup_printf ("send_rtp_src_%u", pad->mlineindex);
-  if (!gst_element_link_pads (GST_ELEMENT (webrtc->rtpbin), pad_name,
-          GST_ELEMENT (trans->stream->send_bin), "rtp_sink"))
-    g_warn_if_reached ();
-  g_free (pad_name);
+  send_sink = gst_element_get_static_pad (GST_ELEMENT (trans->stream->send_bin),
+      "rtp_sink");
+  /* a simulcast session is only linked for its first layer */
+  if (!gst_pad_is_linked (send_sink)) {
+    pad_name = g_strdup_printf ("send_rtp_src_%u", pad->mlineindex);
+    if (!gst_element_link_pads (GST_ELEMENT (webrtc->rtpbin), pad_name,
+            GST_ELEMENT (trans->stream->send_bin), "rtp_sink"))
+      g_warn_if_reached ();
+    g_free (pad_name);
+  }
+  gst_object_unref (send_sink);
 
   gst_element_sync_state_with_parent (GST_ELEMENT (trans->stream->send_bin));
 
@@ -2465,15 +2748,13 @@ _update_transceiver_from_sdp_media (GstWebRTCBin * webrtc,
   gboolean new_rtcp_mux, new_rtcp_rsize;
   int i;
 
-  rtp_trans->mline = media_idx;
+  _set_transceiver_mline (webrtc, rtp_trans, media_idx);
 
   for (i = 0; i < gst_sdp_media_attributes_len (media); i++) {
     const GstSDPAttribute *attr = gst_sdp_media_get_attribute (media, i);
 
-    if (g_strcmp0 (attr->key, "mid") == 0) {
-      g_free (rtp_trans->mid);
-      rtp_trans->mid = g_strdup (attr->value);
-    }
+    if (g_strcmp0 (attr->key, "mid") == 0)
+      _set_transceiver_mid (webrtc, rtp_trans, attr->value);
   }
 
   if (!stream) {
@@ -2662,7 +2943,7 @@ _update_transceiver_from_sdp_media (GstWebRTCBin * webrtc,
     else
       transport_receive_bin_set_receive_state (receive, RECEIVE_STATE_DROP);
 
-    rtp_trans->mline = media_idx;
+    _set_transceiver_mline (webrtc, rtp_trans, media_idx);
     rtp_trans->current_direction = new_dir;
   }
 }
@@ -3108,18 +3389,37 @@ bad_input:
   }
 }
 
+/* Handles all the candidates queued since the last run, however many
+ * add-ice-candidate(s) calls they came from */
 static void
-_add_ice_candidate_task (GstWebRTCBin * webrtc, IceCandidateItem * item)
+_add_ice_candidates_task (GstWebRTCBin * webrtc, gpointer data)
 {
-  if (!webrtc->current_local_description || !webrtc->current_remote_description) {
-    IceCandidateItem *new = g_new0 (IceCandidateItem, 1);
-    new->mlineindex = item->mlineindex;
-    new->candidate = g_strdup (item->candidate);
+  GArray *queued;
+  int i;
+
+  g_mutex_lock (&webrtc->priv->ice_candidates_lock);
+  queued = webrtc->priv->queued_ice_candidates;
+  webrtc->priv->queued_ice_candidates =
+      g_array_new (FALSE, TRUE, sizeof (IceCandidateItem *));
+  g_array_set_clear_func (webrtc->priv->queued_ice_candidates,
+      (GDestroyNotify) _clear_ice_candidate_item);
+  webrtc->priv->ice_candidates_task_pending = FALSE;
+  g_mutex_unlock (&webrtc->priv->ice_candidates_lock);
 
-    g_array_append_val (webrtc->priv->pending_ice_candidates, new);
+  GST_LOG_OBJECT (webrtc, "handling %u queued ICE candidates", queued->len);
+
+  if (!webrtc->current_local_description || !webrtc->current_remote_description) {
+    /* the items are moved over to the pending ones */
+    g_array_append_vals (webrtc->priv->pending_ice_candidates, queued->data,
+        queued->len);
+    g_array_set_clear_func (queued, NULL);
   } else {
-    _add_ice_candidate (webrtc, item);
+    for (i = 0; i < queued->len; i++)
+      _add_ice_candidate (webrtc, g_array_index (queued, IceCandidateItem *,
+              i));
   }
+
+  g_array_free (queued, TRUE);
 }
 
 static void
@@ -3128,21 +3428,63 @@ _free_ice_candidate_item (IceCandidateItem * item)
   _clear_ice_candidate_item (&item);
 }
 
+/* must be called with the ice_candidates_lock */
 static void
-gst_webrtc_bin_add_ice_candidate (GstWebRTCBin * webrtc, guint mline,
-    const gchar * attr)
+_queue_ice_candidate (GstWebRTCBin * webrtc, guint mline, const gchar * attr)
 {
   IceCandidateItem *item;
+  gchar *candidate;
+
+  if (!g_ascii_strncasecmp (attr, "a=candidate:", 12)) {
+    candidate = g_strdup (attr);
+  } else if (!g_ascii_strncasecmp (attr, "candidate:", 10)) {
+    candidate = g_strdup_printf ("a=%s", attr);
+  } else {
+    GST_WARNING_OBJECT (webrtc, "Invalid ICE candidate '%s', ignoring", attr);
+    return;
+  }
 
   item = g_new0 (IceCandidateItem, 1);
   item->mlineindex = mline;
-  if (!g_ascii_strncasecmp (attr, "a=candidate:", 12))
-    item->candidate = g_strdup (attr);
-  else if (!g_ascii_strncasecmp (attr, "candidate:", 10))
-    item->candidate = g_strdup_printf ("a=%s", attr);
-  gst_webrtc_bin_enqueue_task (webrtc,
-      (GstWebRTCBinFunc) _add_ice_candidate_task, item,
-      (GDestroyNotify) _free_ice_candidate_item);
+  item->candidate = candidate;
+  g_array_append_val (webrtc->priv->queued_ice_candidates, item);
+}
+
+/* must be called with the ice_candidates_lock */
+static void
+_schedule_add_ice_candidates_task (GstWebRTCBin * webrtc)
+{
+  if (webrtc->priv->ice_candidates_task_pending
+      || webrtc->priv->queued_ice_candidates->len == 0)
+    return;
+
+  webrtc->priv->ice_candidates_task_pending = TRUE;
+  gst_webrtc_bin_enqueue_task (webrtc, _add_ice_candidates_task, NULL, NULL);
+}
+
+static void
+gst_webrtc_bin_add_ice_candidate (GstWebRTCBin * webrtc, guint mline,
+    const gchar * attr)
+{
+  g_mutex_lock (&webrtc->priv->ice_candidates_lock);
+  _queue_ice_candidate (webrtc, mline, attr);
+  _schedule_add_ice_candidates_task (webrtc);
+  g_mutex_unlock (&webrtc->priv->ice_candidates_lock);
+}
+
+static void
+gst_webrtc_bin_add_ice_candidates (GstWebRTCBin * webrtc, guint mline,
+    GStrv attrs)
+{
+  int i;
+
+  g_return_if_fail (attrs != NULL);
+
+  g_mutex_lock (&webrtc->priv->ice_candidates_lock);
+  for (i = 0; attrs[i]; i++)
+    _queue_ice_candidate (webrtc, mline, attrs[i]);
+  _schedule_add_ice_candidates_task (webrtc);
+  g_mutex_unlock (&webrtc->priv->ice_candidates_lock);
 }
 
 static void
@@ -3181,17 +3523,19 @@ _on_ice_candidate (GstWebRTCICE * ice, guint session_id,
 
 /* https://www.w3.org/TR/webrtc/#dfn-stats-selection-algorithm */
 static GstStructure *
-_get_stats_from_selector (GstWebRTCBin * webrtc, gpointer selector)
+_get_stats_from_selector (GstWebRTCBin * webrtc, gpointer selector,
+    GstWebRTCStatsType type)
 {
   if (selector)
     GST_FIXME_OBJECT (webrtc, "Implement stats selection");
 
-  return gst_structure_copy (webrtc->priv->stats);
+  return gst_webrtc_bin_copy_stats (webrtc, type);
 }
 
 struct get_stats
 {
   GstPad *pad;
+  GstWebRTCStatsType type;
   GstPromise *promise;
 };
 
@@ -3212,7 +3556,7 @@ _get_stats_task (GstWebRTCBin * webrtc, struct get_stats *stats)
   GstStructure *s;
   gpointer selector = NULL;
 
-  gst_webrtc_bin_update_stats (webrtc);
+  gst_webrtc_bin_update_stats (webrtc, stats->type);
 
   if (stats->pad) {
     GstWebRTCBinPad *wpad = GST_WEBRTC_BIN_PAD (stats->pad);
@@ -3226,13 +3570,13 @@ _get_stats_task (GstWebRTCBin * webrtc, struct get_stats *stats)
     }
   }
 
-  s = _get_stats_from_selector (webrtc, selector);
+  s = _get_stats_from_selector (webrtc, selector, stats->type);
   gst_promise_reply (stats->promise, s);
 }
 
 static void
-gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
-    GstPromise * promise)
+gst_webrtc_bin_get_stats_of_type (GstWebRTCBin * webrtc, GstPad * pad,
+    GstWebRTCStatsType type, GstPromise * promise)
 {
   struct get_stats *stats;
 
@@ -3240,6 +3584,7 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
   g_return_if_fail (pad == NULL || GST_IS_WEBRTC_BIN_PAD (pad));
 
   stats = g_new0 (struct get_stats, 1);
+  stats->type = type;
   stats->promise = gst_promise_ref (promise);
   /* FIXME: check that pad exists in element */
   if (pad)
@@ -3249,6 +3594,13 @@ gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
       stats, (GDestroyNotify) _free_get_stats);
 }
 
+static void
+gst_webrtc_bin_get_stats (GstWebRTCBin * webrtc, GstPad * pad,
+    GstPromise * promise)
+{
+  gst_webrtc_bin_get_stats_of_type (webrtc, pad, 0, promise);
+}
+
 static GstWebRTCRTPTransceiver *
 gst_webrtc_bin_add_transceiver (GstWebRTCBin * webrtc,
     GstWebRTCRTPTransceiverDirection direction, GstCaps * caps)
@@ -3397,8 +3749,7 @@ on_rtpbin_request_aux_sender (GstElement * rtpbin, guint session_id,
   GstWebRTCRTPTransceiver *trans;
 
   stream = _find_transport_for_session (webrtc, session_id);
-  trans = _find_transceiver (webrtc, &session_id,
-      (FindTransceiverFunc) transceiver_match_for_mline);
+  trans = _find_transceiver_for_mline (webrtc, session_id);
 
   if (stream) {
     guint i;
@@ -3584,8 +3935,7 @@ on_rtpbin_request_fec_encoder (GstElement * rtpbin, guint session_id,
   GstWebRTCRTPTransceiver *trans;
 
   stream = _find_transport_for_session (webrtc, session_id);
-  trans = _find_transceiver (webrtc, &session_id,
-      (FindTransceiverFunc) transceiver_match_for_mline);
+  trans = _find_transceiver_for_mline (webrtc, session_id);
 
   if (stream) {
     ulpfec_pt = _transport_stream_get_pt (stream, "ULPFEC");
@@ -3605,9 +3955,8 @@ on_rtpbin_request_fec_encoder (GstElement * rtpbin, guint session_id,
 
     gst_bin_add (GST_BIN (ret), fecenc);
     sinkpad = gst_element_get_static_pad (fecenc, "sink");
-    g_object_set (fecenc, "pt", ulpfec_pt, "percentage",
-        WEBRTC_TRANSCEIVER (trans)->fec_percentage, NULL);
-
+    g_object_set (fecenc, "pt", ulpfec_pt, NULL);
+    webrtc_transceiver_set_fec_encoder (WEBRTC_TRANSCEIVER (trans), fecenc);
 
     if (caps && !gst_caps_is_empty (caps)) {
       const GstStructure *s = gst_caps_get_structure (caps, 0);
@@ -3653,10 +4002,104 @@ on_rtpbin_request_fec_encoder (GstElement * rtpbin, guint session_id,
   return ret;
 }
 
+guint
+_get_bitrate_estimate_for_session (GstWebRTCBin * webrtc, guint session_id)
+{
+  BitrateEstimator *estimator;
+  guint bitrate = 0;
+
+  g_mutex_lock (&webrtc->priv->bwe_lock);
+  estimator = g_hash_table_lookup (webrtc->priv->bitrate_estimators,
+      GUINT_TO_POINTER (session_id));
+  if (estimator)
+    bitrate = estimator->bitrate;
+  g_mutex_unlock (&webrtc->priv->bwe_lock);
+
+  return bitrate;
+}
+
+struct bandwidth_estimate
+{
+  guint session_id;
+  guint bitrate;
+};
+
+static void
+_on_bandwidth_estimate_task (GstWebRTCBin * webrtc,
+    struct bandwidth_estimate *estimate)
+{
+  GST_DEBUG_OBJECT (webrtc, "new bandwidth estimate for session %u: %u bps",
+      estimate->session_id, estimate->bitrate);
+
+  /* FIXME: bundle support */
+  PC_UNLOCK (webrtc);
+  g_signal_emit (webrtc, gst_webrtc_bin_signals[ON_BANDWIDTH_ESTIMATE_SIGNAL],
+      0, estimate->session_id, estimate->bitrate);
+  PC_LOCK (webrtc);
+}
+
+/* Called for the remote sources sending RTCP, whose report blocks are about
+ * our senders */
 static void
 on_rtpbin_ssrc_active (GstElement * rtpbin, guint session_id, guint ssrc,
     GstWebRTCBin * webrtc)
 {
+  BitrateEstimator *estimator;
+  GObject *session = NULL, *source = NULL;
+  GstStructure *stats = NULL;
+  gboolean internal = TRUE, have_rb = FALSE, changed;
+  guint fraction_lost = 0, rtt = 0;
+  struct bandwidth_estimate *estimate;
+
+  g_signal_emit_by_name (rtpbin, "get-internal-session", session_id, &session);
+  if (!session)
+    return;
+  g_signal_emit_by_name (session, "get-source-by-ssrc", ssrc, &source);
+  g_object_unref (session);
+  if (!source)
+    return;
+  g_object_get (source, "stats", &stats, NULL);
+  g_object_unref (source);
+  if (!stats)
+    return;
+
+  gst_structure_get (stats, "internal", G_TYPE_BOOLEAN, &internal,
+      "have-rb", G_TYPE_BOOLEAN, &have_rb, NULL);
+  if (internal || !have_rb) {
+    gst_structure_free (stats);
+    return;
+  }
+  gst_structure_get_uint (stats, "rb-fractionlost", &fraction_lost);
+  gst_structure_get_uint (stats, "rb-round-trip", &rtt);
+  gst_structure_free (stats);
+
+  g_mutex_lock (&webrtc->priv->bwe_lock);
+  estimator = g_hash_table_lookup (webrtc->priv->bitrate_estimators,
+      GUINT_TO_POINTER (session_id));
+  if (!estimator) {
+    estimator = bitrate_estimator_new ();
+    g_hash_table_insert (webrtc->priv->bitrate_estimators,
+        GUINT_TO_POINTER (session_id), estimator);
+  }
+  /* the loss is a fraction of 256 and the rtt is 16.16 fixed point */
+  changed = bitrate_estimator_update (estimator, fraction_lost / 256.0,
+      (gdouble) ((rtt & 0xffff0000) >> 16) + ((rtt & 0xffff) / 65536.0),
+      g_get_monotonic_time () * GST_USECOND, webrtc->priv->start_bitrate,
+      webrtc->priv->min_bitrate, webrtc->priv->max_bitrate);
+  estimate = g_new0 (struct bandwidth_estimate, 1);
+  estimate->session_id = session_id;
+  estimate->bitrate = estimator->bitrate;
+  g_mutex_unlock (&webrtc->priv->bwe_lock);
+
+  GST_LOG_OBJECT (webrtc, "receiver report from %u in session %u, "
+      "fraction lost %u/256, rtt %u/65536s, estimate %u bps", ssrc, session_id,
+      fraction_lost, rtt, estimate->bitrate);
+
+  if (changed)
+    gst_webrtc_bin_enqueue_task (webrtc,
+        (GstWebRTCBinFunc) _on_bandwidth_estimate_task, estimate, g_free);
+  else
+    g_free (estimate);
 }
 
 static void
@@ -3665,8 +4108,7 @@ on_rtpbin_new_jitterbuffer (GstElement * rtpbin, GstElement * jitterbuffer,
 {
   GstWebRTCRTPTransceiver *trans;
 
-  trans = _find_transceiver (webrtc, &session_id,
-      (FindTransceiverFunc) transceiver_match_for_mline);
+  trans = _find_transceiver_for_mline (webrtc, session_id);
 
   if (trans) {
     /* We don't set do-retransmission on rtpbin as we want per-session control */
@@ -3802,7 +4244,7 @@ gst_webrtc_bin_request_new_pad (GstElement * element, GstPadTemplate * templ,
   GstWebRTCBin *webrtc = GST_WEBRTC_BIN (element);
   GstWebRTCBinPad *pad = NULL;
   GstPluginFeature *feature;
-  guint serial;
+  guint serial = 0;
 
   feature = gst_registry_lookup_feature (gst_registry_get (), "nicesrc");
   if (feature) {
@@ -3822,7 +4264,54 @@ gst_webrtc_bin_request_new_pad (GstElement * element, GstPadTemplate * templ,
     return NULL;
   }
 
-  if (templ->direction == GST_PAD_SINK ||
+  if (g_strcmp0 (templ->name_template, "sink_%u_%s") == 0) {
+    GstWebRTCRTPTransceiver *trans;
+    gchar **rids = NULL;
+    gchar *rid = NULL;
+    guint i;
+
+    if (name && g_str_has_prefix (name, "sink_")) {
+      serial = g_ascii_strtoull (&name[5], &rid, 10);
+      if (rid && rid[0] == '_')
+        rid++;
+      else
+        rid = NULL;
+    }
+
+    /* the rid is sent in a one-byte header extension */
+    if (!rid || !rid[0] || strlen (rid) > 16) {
+      GST_ERROR_OBJECT (webrtc, "invalid simulcast pad name %s", name);
+      return NULL;
+    }
+
+    trans = _find_transceiver_for_mline (webrtc, serial);
+    if (trans)
+      rids = _transceiver_dup_rids (WEBRTC_TRANSCEIVER (trans));
+    for (i = 0; rids && rids[i]; i++) {
+      if (g_strcmp0 (rids[i], rid) == 0)
+        break;
+    }
+    if (!rids || !rids[i]) {
+      GST_ERROR_OBJECT (webrtc, "no transceiver for mline %u with rid %s",
+          serial, rid);
+      g_strfreev (rids);
+      return NULL;
+    }
+    g_strfreev (rids);
+
+    pad = gst_webrtc_bin_pad_new (name, GST_PAD_SINK);
+    pad->mlineindex = serial;
+    pad->rid = g_strdup (rid);
+    pad->trans = gst_object_ref (trans);
+
+    pad->block_id = gst_pad_add_probe (GST_PAD (pad), GST_PAD_PROBE_TYPE_BLOCK |
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        (GstPadProbeCallback) pad_block, NULL, NULL);
+    webrtc->priv->pending_sink_transceivers =
+        g_list_append (webrtc->priv->pending_sink_transceivers,
+        gst_object_ref (pad));
+    _add_pad (webrtc, pad);
+  } else if (templ->direction == GST_PAD_SINK ||
       g_strcmp0 (templ->name_template, "sink_%u") == 0) {
     GstWebRTCRTPTransceiver *trans;
 
@@ -3864,10 +4353,31 @@ gst_webrtc_bin_release_pad (GstElement * element, GstPad * pad)
   GstWebRTCBin *webrtc = GST_WEBRTC_BIN (element);
   GstWebRTCBinPad *webrtc_pad = GST_WEBRTC_BIN_PAD (pad);
 
+  if (webrtc_pad->trans
+      && WEBRTC_TRANSCEIVER (webrtc_pad->trans)->simulcast_funnel) {
+    GstElement *funnel =
+        WEBRTC_TRANSCEIVER (webrtc_pad->trans)->simulcast_funnel;
+    GstPad *target = gst_ghost_pad_get_target (GST_GHOST_PAD (pad));
+
+    if (target && GST_PAD_PARENT (target) == funnel) {
+      gst_ghost_pad_set_target (GST_GHOST_PAD (pad), NULL);
+      gst_element_release_request_pad (funnel, target);
+    }
+    if (target)
+      gst_object_unref (target);
+  }
+
   if (webrtc_pad->trans)
     gst_object_unref (webrtc_pad->trans);
   webrtc_pad->trans = NULL;
 
+  /* released before it could be linked */
+  if (g_list_find (webrtc->priv->pending_sink_transceivers, webrtc_pad)) {
+    webrtc->priv->pending_sink_transceivers =
+        g_list_remove (webrtc->priv->pending_sink_transceivers, webrtc_pad);
+    gst_object_unref (webrtc_pad);
+  }
+
   _remove_pad (webrtc, webrtc_pad);
 }
 
@@ -3880,8 +4390,40 @@ gst_webrtc_bin_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_STUN_SERVER:
     case PROP_TURN_SERVER:
+    case PROP_ICE_LITE:
+    case PROP_LOCAL_ADDRESSES:
       g_object_set_property (G_OBJECT (webrtc->priv->ice), pspec->name, value);
       break;
+    case PROP_START_BITRATE:
+      g_mutex_lock (&webrtc->priv->bwe_lock);
+      webrtc->priv->start_bitrate = g_value_get_uint (value);
+      g_mutex_unlock (&webrtc->priv->bwe_lock);
+      break;
+    case PROP_MIN_BITRATE:
+      g_mutex_lock (&webrtc->priv->bwe_lock);
+      webrtc->priv->min_bitrate = g_value_get_uint (value);
+      g_mutex_unlock (&webrtc->priv->bwe_lock);
+      break;
+    case PROP_MAX_BITRATE:
+      g_mutex_lock (&webrtc->priv->bwe_lock);
+      webrtc->priv->max_bitrate = g_value_get_uint (value);
+      g_mutex_unlock (&webrtc->priv->bwe_lock);
+      break;
+    case PROP_DO_NACK:
+      GST_OBJECT_LOCK (webrtc);
+      webrtc->priv->do_nack = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
+    case PROP_FEC_TYPE:
+      GST_OBJECT_LOCK (webrtc);
+      webrtc->priv->fec_type = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
+    case PROP_FEC_PERCENTAGE:
+      GST_OBJECT_LOCK (webrtc);
+      webrtc->priv->fec_percentage = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3938,8 +4480,40 @@ gst_webrtc_bin_get_property (GObject * object, guint prop_id,
       break;
     case PROP_STUN_SERVER:
     case PROP_TURN_SERVER:
+    case PROP_ICE_LITE:
+    case PROP_LOCAL_ADDRESSES:
       g_object_get_property (G_OBJECT (webrtc->priv->ice), pspec->name, value);
       break;
+    case PROP_START_BITRATE:
+      g_mutex_lock (&webrtc->priv->bwe_lock);
+      g_value_set_uint (value, webrtc->priv->start_bitrate);
+      g_mutex_unlock (&webrtc->priv->bwe_lock);
+      break;
+    case PROP_MIN_BITRATE:
+      g_mutex_lock (&webrtc->priv->bwe_lock);
+      g_value_set_uint (value, webrtc->priv->min_bitrate);
+      g_mutex_unlock (&webrtc->priv->bwe_lock);
+      break;
+    case PROP_MAX_BITRATE:
+      g_mutex_lock (&webrtc->priv->bwe_lock);
+      g_value_set_uint (value, webrtc->priv->max_bitrate);
+      g_mutex_unlock (&webrtc->priv->bwe_lock);
+      break;
+    case PROP_DO_NACK:
+      GST_OBJECT_LOCK (webrtc);
+      g_value_set_boolean (value, webrtc->priv->do_nack);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
+    case PROP_FEC_TYPE:
+      GST_OBJECT_LOCK (webrtc);
+      g_value_set_enum (value, webrtc->priv->fec_type);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
+    case PROP_FEC_PERCENTAGE:
+      GST_OBJECT_LOCK (webrtc);
+      g_value_set_uint (value, webrtc->priv->fec_percentage);
+      GST_OBJECT_UNLOCK (webrtc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3968,6 +4542,10 @@ gst_webrtc_bin_dispose (GObject * object)
     g_array_free (webrtc->priv->ice_stream_map, TRUE);
   webrtc->priv->ice_stream_map = NULL;
 
+  if (webrtc->priv->ice_stream_session_index)
+    g_hash_table_unref (webrtc->priv->ice_stream_session_index);
+  webrtc->priv->ice_stream_session_index = NULL;
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -3976,6 +4554,12 @@ gst_webrtc_bin_finalize (GObject * object)
 {
   GstWebRTCBin *webrtc = GST_WEBRTC_BIN (object);
 
+  g_hash_table_unref (webrtc->priv->transport_session_index);
+  g_hash_table_unref (webrtc->priv->transceiver_mline_index);
+  g_hash_table_unref (webrtc->priv->transceiver_mid_index);
+  g_hash_table_unref (webrtc->priv->sink_pad_index);
+  g_hash_table_unref (webrtc->priv->src_pad_index);
+
   if (webrtc->priv->transports)
     g_array_free (webrtc->priv->transports, TRUE);
   webrtc->priv->transports = NULL;
@@ -3988,6 +4572,11 @@ gst_webrtc_bin_finalize (GObject * object)
     g_array_free (webrtc->priv->pending_ice_candidates, TRUE);
   webrtc->priv->pending_ice_candidates = NULL;
 
+  if (webrtc->priv->queued_ice_candidates)
+    g_array_free (webrtc->priv->queued_ice_candidates, TRUE);
+  webrtc->priv->queued_ice_candidates = NULL;
+  g_mutex_clear (&webrtc->priv->ice_candidates_lock);
+
   if (webrtc->priv->session_mid_map)
     g_array_free (webrtc->priv->session_mid_map, TRUE);
   webrtc->priv->session_mid_map = NULL;
@@ -4020,6 +4609,9 @@ gst_webrtc_bin_finalize (GObject * object)
     gst_structure_free (webrtc->priv->stats);
   webrtc->priv->stats = NULL;
 
+  g_hash_table_unref (webrtc->priv->bitrate_estimators);
+  g_mutex_clear (&webrtc->priv->bwe_lock);
+
   g_mutex_clear (PC_GET_LOCK (webrtc));
   g_cond_clear (PC_GET_COND (webrtc));
 
@@ -4040,6 +4632,8 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
 
   gst_element_class_add_static_pad_template_with_gtype (element_class,
       &sink_template, GST_TYPE_WEBRTC_BIN_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (element_class,
+      &simulcast_sink_template, GST_TYPE_WEBRTC_BIN_PAD);
   gst_element_class_add_static_pad_template (element_class, &src_template);
 
   gst_element_class_set_metadata (element_class, "WebRTC Bin",
@@ -4077,6 +4671,131 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
           "The TURN server of the form turn(s)://username:password@host:port",
           NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWebRTCBin:ice-lite:
+   *
+   * Run as an ICE-lite agent (RFC 5245, section 2.7), as suited for servers
+   * with a public address: only host candidates are offered, the STUN and
+   * TURN servers are not used and connectivity checks are only answered.
+   * The session descriptions then contain an a=ice-lite attribute.
+   *
+   * Must be set before the first offer or answer is created.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_ICE_LITE,
+      g_param_spec_boolean ("ice-lite", "ICE lite",
+          "Whether to run as an ICE-lite agent that only offers host "
+          "candidates and answers connectivity checks", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:local-addresses:
+   *
+   * The local IP addresses to gather host candidates from instead of all
+   * the network interfaces.
+   *
+   * Must be set before the first offer or answer is created.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_LOCAL_ADDRESSES,
+      g_param_spec_boxed ("local-addresses", "Local addresses",
+          "The local IP addresses to gather host candidates from, "
+          "instead of all the interfaces", G_TYPE_STRV,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:start-bitrate:
+   *
+   * The bitrate the bandwidth estimation of each session starts from, see
+   * #GstWebRTCBin::on-bandwidth-estimate.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_START_BITRATE,
+      g_param_spec_uint ("start-bitrate", "Start bitrate",
+          "Initial estimate of the available bandwidth in bits per second",
+          0, G_MAXUINT, DEFAULT_START_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:min-bitrate:
+   *
+   * The lowest bandwidth estimate reported by
+   * #GstWebRTCBin::on-bandwidth-estimate.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_MIN_BITRATE,
+      g_param_spec_uint ("min-bitrate", "Minimum bitrate",
+          "Minimum estimate of the available bandwidth in bits per second",
+          0, G_MAXUINT, DEFAULT_MIN_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:max-bitrate:
+   *
+   * The highest bandwidth estimate reported by
+   * #GstWebRTCBin::on-bandwidth-estimate, 0 for no limit.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_MAX_BITRATE,
+      g_param_spec_uint ("max-bitrate", "Maximum bitrate",
+          "Maximum estimate of the available bandwidth in bits per second "
+          "(0 = unlimited)", 0, G_MAXUINT, DEFAULT_MAX_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:do-nack:
+   *
+   * The initial #WebRTCTransceiver:do-nack of new transceivers. When set,
+   * NACK feedback and RTX are offered, and accepted when the remote offers
+   * them, so that lost packets are retransmitted instead of requesting a
+   * keyframe.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_DO_NACK,
+      g_param_spec_boolean ("do-nack", "Do nack",
+          "Whether new transceivers negotiate NACK feedback and RTX",
+          DEFAULT_DO_NACK, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:fec-type:
+   *
+   * The initial #WebRTCTransceiver:fec-type of new transceivers.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_FEC_TYPE,
+      g_param_spec_enum ("fec-type", "FEC type",
+          "The type of Forward Error Correction new transceivers negotiate",
+          GST_TYPE_WEBRTC_FEC_TYPE, DEFAULT_FEC_TYPE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstWebRTCBin:fec-percentage:
+   *
+   * The initial #WebRTCTransceiver:fec-percentage of new transceivers.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_FEC_PERCENTAGE,
+      g_param_spec_uint ("fec-percentage", "FEC percentage",
+          "The amount of Forward Error Correction new transceivers apply",
+          0, 100, DEFAULT_FEC_PERCENTAGE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class,
       PROP_CONNECTION_STATE,
       g_param_spec_enum ("connection-state", "Connection State",
@@ -4174,6 +4893,25 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
       G_CALLBACK (gst_webrtc_bin_add_ice_candidate), NULL, NULL,
       g_cclosure_marshal_generic, G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_STRING);
 
+  /**
+   * GstWebRTCBin::add-ice-candidates:
+   * @object: the #GstWebRtcBin
+   * @mline: the media line index of the candidates
+   * @ice-candidates: a %NULL-terminated array of ice candidates
+   *
+   * Adds several candidates at once, e.g. the ones received in a single
+   * signalling message. This is the same as calling
+   * #GstWebRTCBin::add-ice-candidate for each of them, but they are all
+   * handled in one go on the peerconnection thread.
+   *
+   * Since: 1.16
+   */
+  gst_webrtc_bin_signals[ADD_ICE_CANDIDATES_SIGNAL] =
+      g_signal_new_class_handler ("add-ice-candidates",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (gst_webrtc_bin_add_ice_candidates), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_STRV);
+
   /**
    * GstWebRTCBin::get-stats:
    * @object: the #GstWebRtcBin
@@ -4237,6 +4975,7 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
    * RTCOutboundRTPStreamStats supported fields (https://w3c.github.io/webrtc-stats/#outboundrtpstats-dict*)
    *
    *  "remote-id"           G_TYPE_STRING               identifier for the associated RTCRemoteInboundRTPSTreamStats
+   *  "target-bitrate"      G_TYPE_DOUBLE               estimated available bandwidth, see #GstWebRTCBin::on-bandwidth-estimate (Since: 1.16)
    *
    * RTCRemoteOutboundRTPStreamStats supported fields (https://w3c.github.io/webrtc-stats/#remoteoutboundrtpstats-dict*)
    *
@@ -4250,6 +4989,26 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
       g_cclosure_marshal_generic, G_TYPE_NONE, 2, GST_TYPE_PAD,
       GST_TYPE_PROMISE);
 
+  /**
+   * GstWebRTCBin::get-stats-of-type:
+   * @object: the #GstWebRtcBin
+   * @pad: (nullable): A #GstPad to get the stats for, or %NULL for all
+   * @type: the #GstWebRTCStatsType of the stats to get
+   * @promise: a #GstPromise for the result
+   *
+   * Like #GstWebRTCBin::get-stats but only gathers and returns the stats
+   * of @type, e.g. only the "outbound-rtp" ones. This is much cheaper than
+   * gathering all the stats when they are polled often.
+   *
+   * Since: 1.16
+   */
+  gst_webrtc_bin_signals[GET_STATS_OF_TYPE_SIGNAL] =
+      g_signal_new_class_handler ("get-stats-of-type",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_CALLBACK (gst_webrtc_bin_get_stats_of_type), NULL, NULL,
+      g_cclosure_marshal_generic, G_TYPE_NONE, 3, GST_TYPE_PAD,
+      GST_TYPE_WEBRTC_STATS_TYPE, GST_TYPE_PROMISE);
+
   /**
    * GstWebRTCBin::on-negotiation-needed:
    * @object: the #GstWebRtcBin
@@ -4279,6 +5038,26 @@ gst_webrtc_bin_class_init (GstWebRTCBinClass * klass)
       G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
       G_TYPE_NONE, 1, GST_TYPE_WEBRTC_RTP_TRANSCEIVER);
 
+  /**
+   * GstWebRTCBin::on-bandwidth-estimate:
+   * @object: the #GstWebRtcBin
+   * @mlineindex: the index of the media whose sending bandwidth changed
+   * @bitrate: the estimated available bandwidth in bits per second
+   *
+   * Emitted when the estimate of the bandwidth available to send the media
+   * changes. The estimate goes down on packet loss and when the round trip
+   * time shows queuing, and up otherwise, from the receiver reports of the
+   * remote peer. Applications should retune the bitrate of their encoders
+   * to it. The last estimate is also available as the "target-bitrate"
+   * field of the "outbound-rtp" stats.
+   *
+   * Since: 1.16
+   */
+  gst_webrtc_bin_signals[ON_BANDWIDTH_ESTIMATE_SIGNAL] =
+      g_signal_new ("on-bandwidth-estimate", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, NULL, NULL, g_cclosure_marshal_generic,
+      G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT);
+
   /**
    * GstWebRTCBin::add-transceiver:
    * @object: the #GstWebRtcBin
@@ -4347,6 +5126,17 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
   g_mutex_init (PC_GET_LOCK (webrtc));
   g_cond_init (PC_GET_COND (webrtc));
 
+  g_mutex_init (&webrtc->priv->bwe_lock);
+  webrtc->priv->bitrate_estimators =
+      g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) bitrate_estimator_free);
+  webrtc->priv->start_bitrate = DEFAULT_START_BITRATE;
+  webrtc->priv->min_bitrate = DEFAULT_MIN_BITRATE;
+  webrtc->priv->max_bitrate = DEFAULT_MAX_BITRATE;
+  webrtc->priv->do_nack = DEFAULT_DO_NACK;
+  webrtc->priv->fec_type = DEFAULT_FEC_TYPE;
+  webrtc->priv->fec_percentage = DEFAULT_FEC_PERCENTAGE;
+
   _start_thread (webrtc);
 
   webrtc->rtpbin = _create_rtpbin (webrtc);
@@ -4355,10 +5145,21 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
   webrtc->priv->transceivers = g_array_new (FALSE, TRUE, sizeof (gpointer));
   g_array_set_clear_func (webrtc->priv->transceivers,
       (GDestroyNotify) _deref_unparent_and_unref);
+  webrtc->priv->transceiver_mline_index =
+      g_hash_table_new (g_direct_hash, g_direct_equal);
+  webrtc->priv->transceiver_mid_index =
+      g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
   webrtc->priv->transports = g_array_new (FALSE, TRUE, sizeof (gpointer));
   g_array_set_clear_func (webrtc->priv->transports,
       (GDestroyNotify) _transport_free);
+  webrtc->priv->transport_session_index =
+      g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  webrtc->priv->sink_pad_index =
+      g_hash_table_new (g_direct_hash, g_direct_equal);
+  webrtc->priv->src_pad_index =
+      g_hash_table_new (g_direct_hash, g_direct_equal);
 
   webrtc->priv->session_mid_map =
       g_array_new (FALSE, TRUE, sizeof (SessionMidItem));
@@ -4370,8 +5171,15 @@ gst_webrtc_bin_init (GstWebRTCBin * webrtc)
       G_CALLBACK (_on_ice_candidate), webrtc);
   webrtc->priv->ice_stream_map =
       g_array_new (FALSE, TRUE, sizeof (IceStreamItem));
+  webrtc->priv->ice_stream_session_index =
+      g_hash_table_new (g_direct_hash, g_direct_equal);
   webrtc->priv->pending_ice_candidates =
       g_array_new (FALSE, TRUE, sizeof (IceCandidateItem *));
   g_array_set_clear_func (webrtc->priv->pending_ice_candidates,
       (GDestroyNotify) _clear_ice_candidate_item);
+  g_mutex_init (&webrtc->priv->ice_candidates_lock);
+  webrtc->priv->queued_ice_candidates =
+      g_array_new (FALSE, TRUE, sizeof (IceCandidateItem *));
+  g_array_set_clear_func (webrtc->priv->queued_ice_candidates,
+      (GDestroyNotify) _clear_ice_candidate_item);
 }
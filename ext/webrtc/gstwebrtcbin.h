@@ -55,6 +55,8 @@ struct _GstWebRTCBinPad
   GstGhostPad           parent;
 
   guint                 mlineindex;
+  /* the RTP stream id of a simulcast layer pad */
+  gchar                *rid;
 
   GstWebRTCRTPTransceiver *trans;
   gulong                block_id;
@@ -111,6 +113,11 @@ struct _GstWebRTCBinPrivate
   GstWebRTCICE *ice;
   GArray *ice_stream_map;
   GArray *pending_ice_candidates;
+  /* candidates added by the application and not yet handled by the
+   * peerconnection thread, protected by ice_candidates_lock */
+  GMutex ice_candidates_lock;
+  GArray *queued_ice_candidates;
+  gboolean ice_candidates_task_pending;
 
   /* peerconnection variables */
   gboolean is_closed;
@@ -130,11 +137,36 @@ struct _GstWebRTCBinPrivate
   GList *pending_pads;
   GList *pending_sink_transceivers;
 
+  /* indexes of the transceivers by mline and mid, of the transports and ice
+   * streams by session id, kept in sync with the arrays above */
+  GHashTable *transceiver_mline_index;
+  GHashTable *transceiver_mid_index;
+  GHashTable *transport_session_index;
+  GHashTable *ice_stream_session_index;
+  /* index of the pads and pending_pads by mlineindex, protected by the
+   * object lock */
+  GHashTable *sink_pad_index;
+  GHashTable *src_pad_index;
+
   /* count of the number of media streams we've offered for uniqueness */
   /* FIXME: overflow? */
   guint media_counter;
 
   GstStructure *stats;
+
+  /* send side bandwidth estimation, session id -> BitrateEstimator,
+   * protected by bwe_lock as it's updated from the RTCP threads */
+  GMutex bwe_lock;
+  GHashTable *bitrate_estimators;
+  guint start_bitrate;
+  guint min_bitrate;
+  guint max_bitrate;
+
+  /* initial loss recovery settings of new transceivers, protected by the
+   * object lock */
+  gboolean do_nack;
+  GstWebRTCFECType fec_type;
+  guint fec_percentage;
 };
 
 typedef void (*GstWebRTCBinFunc) (GstWebRTCBin * webrtc, gpointer data);
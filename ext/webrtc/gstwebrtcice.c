@@ -63,6 +63,8 @@ enum
   PROP_TURN_SERVER,
   PROP_CONTROLLER,
   PROP_AGENT,
+  PROP_ICE_LITE,
+  PROP_LOCAL_ADDRESSES,
 };
 
 static guint gst_webrtc_ice_signals[LAST_SIGNAL] = { 0 };
@@ -308,7 +310,8 @@ gst_webrtc_ice_add_stream (GstWebRTCICE * ice, guint session_id)
 
   item = _create_nice_stream_item (ice, session_id);
 
-  if (ice->turn_server) {
+  /* an ICE-lite agent only has host candidates */
+  if (ice->turn_server && !ice->ice_lite) {
     gboolean ret;
     gchar *user, *pass;
     const gchar *userinfo, *transport, *scheme;
@@ -600,6 +603,78 @@ _resolve_host (const gchar * host)
   return g_inet_address_to_string (addr);
 }
 
+static void
+_add_local_addresses (GstWebRTCICE * ice)
+{
+  int i;
+
+  for (i = 0; ice->local_addresses && ice->local_addresses[i]; i++) {
+    NiceAddress addr;
+
+    nice_address_init (&addr);
+    if (!nice_address_set_from_string (&addr, ice->local_addresses[i])) {
+      GST_ERROR_OBJECT (ice, "Invalid local address '%s'",
+          ice->local_addresses[i]);
+      continue;
+    }
+
+    GST_DEBUG_OBJECT (ice, "adding local address %s", ice->local_addresses[i]);
+    nice_agent_add_local_address (ice->priv->nice_agent, &addr);
+  }
+}
+
+static void
+_create_agent (GstWebRTCICE * ice)
+{
+  ice->priv->nice_agent = g_object_new (NICE_TYPE_AGENT,
+      "compatibility", NICE_COMPATIBILITY_RFC5245,
+      "main-context", ice->priv->main_context,
+      "full-mode", !ice->ice_lite, NULL);
+  g_signal_connect (ice->priv->nice_agent, "new-candidate-full",
+      G_CALLBACK (_on_new_candidate), ice);
+
+  _add_local_addresses (ice);
+}
+
+static gboolean
+_can_recreate_agent (GstWebRTCICE * ice)
+{
+  if (ice->priv->nice_stream_map->len > 0) {
+    GST_ERROR_OBJECT (ice, "Can't change the ICE agent configuration after "
+        "streams have been added");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* full-mode is construct-only and local addresses can't be removed again,
+ * so changing either means starting over with a new agent */
+static void
+_recreate_agent (GstWebRTCICE * ice)
+{
+  NiceAgent *old = ice->priv->nice_agent;
+  gboolean controlling;
+
+  g_object_get (old, "controlling-mode", &controlling, NULL);
+  g_signal_handlers_disconnect_by_data (old, ice);
+
+  _create_agent (ice);
+
+  g_object_set (ice->priv->nice_agent, "controlling-mode", controlling, NULL);
+  /* an ICE-lite agent doesn't probe for server reflexive candidates */
+  if (ice->stun_server && !ice->ice_lite) {
+    gchar *ip = _resolve_host (gst_uri_get_host (ice->stun_server));
+
+    if (ip)
+      g_object_set (ice->priv->nice_agent, "stun-server", ip,
+          "stun-server-port", gst_uri_get_port (ice->stun_server), NULL);
+    g_free (ip);
+  }
+
+  g_object_unref (old);
+}
+
 static void
 _set_turn_server (GstWebRTCICE * ice, const gchar * s)
 {
@@ -734,8 +809,9 @@ gst_webrtc_ice_set_property (GObject * object, guint prop_id,
         gst_uri_unref (ice->stun_server);
       ice->stun_server = uri;
 
-      g_object_set (ice->priv->nice_agent, "stun-server", ip,
-          "stun-server-port", port, NULL);
+      if (!ice->ice_lite)
+        g_object_set (ice->priv->nice_agent, "stun-server", ip,
+            "stun-server-port", port, NULL);
 
       g_free (ip);
       break;
@@ -748,6 +824,20 @@ gst_webrtc_ice_set_property (GObject * object, guint prop_id,
       g_object_set_property (G_OBJECT (ice->priv->nice_agent),
           "controlling-mode", value);
       break;
+    case PROP_ICE_LITE:
+      if (ice->ice_lite != g_value_get_boolean (value)
+          && _can_recreate_agent (ice)) {
+        ice->ice_lite = g_value_get_boolean (value);
+        _recreate_agent (ice);
+      }
+      break;
+    case PROP_LOCAL_ADDRESSES:
+      if (!_can_recreate_agent (ice))
+        break;
+      g_strfreev (ice->local_addresses);
+      ice->local_addresses = g_value_dup_boxed (value);
+      _recreate_agent (ice);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -780,6 +870,12 @@ gst_webrtc_ice_get_property (GObject * object, guint prop_id,
     case PROP_AGENT:
       g_value_set_object (value, ice->priv->nice_agent);
       break;
+    case PROP_ICE_LITE:
+      g_value_set_boolean (value, ice->ice_lite);
+      break;
+    case PROP_LOCAL_ADDRESSES:
+      g_value_set_boxed (value, ice->local_addresses);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -799,6 +895,7 @@ gst_webrtc_ice_finalize (GObject * object)
     gst_uri_unref (ice->turn_server);
   if (ice->stun_server)
     gst_uri_unref (ice->stun_server);
+  g_strfreev (ice->local_addresses);
 
   g_mutex_clear (&ice->priv->lock);
   g_cond_clear (&ice->priv->cond);
@@ -846,6 +943,20 @@ gst_webrtc_ice_class_init (GstWebRTCICEClass * klass)
           "ICE agent in use by this object", NICE_TYPE_AGENT,
           G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+      PROP_ICE_LITE,
+      g_param_spec_boolean ("ice-lite", "ICE lite",
+          "Whether to run as an ICE-lite agent that only offers host "
+          "candidates and answers connectivity checks", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_LOCAL_ADDRESSES,
+      g_param_spec_boxed ("local-addresses", "Local addresses",
+          "The local IP addresses to gather host candidates from, "
+          "instead of all the interfaces", G_TYPE_STRV,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstWebRTCICE::on-ice-candidate:
    * @object: the #GstWebRtcBin
@@ -869,10 +980,7 @@ gst_webrtc_ice_init (GstWebRTCICE * ice)
 
   _start_thread (ice);
 
-  ice->priv->nice_agent = nice_agent_new (ice->priv->main_context,
-      NICE_COMPATIBILITY_RFC5245);
-  g_signal_connect (ice->priv->nice_agent, "new-candidate-full",
-      G_CALLBACK (_on_new_candidate), ice);
+  _create_agent (ice);
 
   ice->priv->nice_stream_map =
       g_array_new (FALSE, TRUE, sizeof (struct NiceStreamItem));
@@ -48,6 +48,9 @@ struct _GstWebRTCICE
   GstUri                           *stun_server;
   GstUri                           *turn_server;
 
+  gboolean                          ice_lite;
+  gchar                           **local_addresses;
+
   GstWebRTCICEPrivate              *priv;
 };
 
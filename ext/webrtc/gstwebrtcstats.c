@@ -46,6 +46,24 @@ _init_debug (void)
   }
 }
 
+#define STATS_TYPE_FLAG(type) (1u << (type))
+#define ALL_STATS_TYPES (~0u)
+#define RTP_STREAM_STATS_TYPES (STATS_TYPE_FLAG (GST_WEBRTC_STATS_INBOUND_RTP) \
+    | STATS_TYPE_FLAG (GST_WEBRTC_STATS_OUTBOUND_RTP) \
+    | STATS_TYPE_FLAG (GST_WEBRTC_STATS_REMOTE_INBOUND_RTP) \
+    | STATS_TYPE_FLAG (GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP))
+
+/* state of one stats update */
+typedef struct
+{
+  GstWebRTCBin *webrtc;
+  GstStructure *s;
+  /* STATS_TYPE_FLAG() of the types to gather */
+  guint types;
+  /* session id -> stats of the rtp session, as several pads share them */
+  GHashTable *session_stats;
+} StatsContext;
+
 static double
 monotonic_time_as_double_milliseconds (void)
 {
@@ -86,10 +104,11 @@ _get_peer_connection_stats (GstWebRTCBin * webrtc)
 /* https://www.w3.org/TR/webrtc-stats/#inboundrtpstats-dict*
    https://www.w3.org/TR/webrtc-stats/#outboundrtpstats-dict* */
 static void
-_get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
+_get_stats_from_rtp_source_stats (StatsContext * ctx,
     const GstStructure * source_stats, const gchar * codec_id,
-    const gchar * transport_id, GstStructure * s)
+    const gchar * transport_id, guint target_bitrate)
 {
+  GstStructure *s = ctx->s;
   GstStructure *in, *out, *r_in, *r_out;
   gchar *in_id, *out_id, *r_in_id, *r_out_id;
   guint ssrc, fir, pli, nack, jitter;
@@ -234,9 +253,11 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
 
   /* RTCOutboundRTPStreamStats */
   gst_structure_set (out, "remote-id", G_TYPE_STRING, r_in_id, NULL);
+  if (target_bitrate)
+    gst_structure_set (out, "target-bitrate", G_TYPE_DOUBLE,
+        (double) target_bitrate, NULL);
 /* XXX:
     DOMHighResTimeStamp lastPacketSentTimestamp;
-    double              targetBitrate;
     unsigned long       framesEncoded;
     double              totalEncodeTime;
     double              averageRTCPInterval;
@@ -262,10 +283,14 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
 
   gst_structure_set (r_out, "local-id", G_TYPE_STRING, in_id, NULL);
 
-  gst_structure_set (s, in_id, GST_TYPE_STRUCTURE, in, NULL);
-  gst_structure_set (s, out_id, GST_TYPE_STRUCTURE, out, NULL);
-  gst_structure_set (s, r_in_id, GST_TYPE_STRUCTURE, r_in, NULL);
-  gst_structure_set (s, r_out_id, GST_TYPE_STRUCTURE, r_out, NULL);
+  if (ctx->types & STATS_TYPE_FLAG (GST_WEBRTC_STATS_INBOUND_RTP))
+    gst_structure_set (s, in_id, GST_TYPE_STRUCTURE, in, NULL);
+  if (ctx->types & STATS_TYPE_FLAG (GST_WEBRTC_STATS_OUTBOUND_RTP))
+    gst_structure_set (s, out_id, GST_TYPE_STRUCTURE, out, NULL);
+  if (ctx->types & STATS_TYPE_FLAG (GST_WEBRTC_STATS_REMOTE_INBOUND_RTP))
+    gst_structure_set (s, r_in_id, GST_TYPE_STRUCTURE, r_in, NULL);
+  if (ctx->types & STATS_TYPE_FLAG (GST_WEBRTC_STATS_REMOTE_OUTBOUND_RTP))
+    gst_structure_set (s, r_out_id, GST_TYPE_STRUCTURE, r_out, NULL);
 
   gst_structure_free (in);
   gst_structure_free (out);
@@ -280,9 +305,10 @@ _get_stats_from_rtp_source_stats (GstWebRTCBin * webrtc,
 
 /* https://www.w3.org/TR/webrtc-stats/#candidatepair-dict* */
 static gchar *
-_get_stats_from_ice_transport (GstWebRTCBin * webrtc,
-    GstWebRTCICETransport * transport, GstStructure * s)
+_get_stats_from_ice_transport (StatsContext * ctx,
+    GstWebRTCICETransport * transport)
 {
+  GstStructure *s = ctx->s;
   GstStructure *stats;
   gchar *id;
   double ts;
@@ -347,16 +373,20 @@ _get_stats_from_ice_transport (GstWebRTCBin * webrtc,
 
 /* https://www.w3.org/TR/webrtc-stats/#dom-rtctransportstats */
 static gchar *
-_get_stats_from_dtls_transport (GstWebRTCBin * webrtc,
-    GstWebRTCDTLSTransport * transport, GstStructure * s)
+_get_stats_from_dtls_transport (StatsContext * ctx,
+    GstWebRTCDTLSTransport * transport)
 {
+  GstStructure *s = ctx->s;
   GstStructure *stats;
   gchar *id;
   double ts;
 
+  id = g_strdup_printf ("transport-stats_%s", GST_OBJECT_NAME (transport));
+  if (!(ctx->types & STATS_TYPE_FLAG (GST_WEBRTC_STATS_TRANSPORT)))
+    return id;
+
   gst_structure_get_double (s, "timestamp", &ts);
 
-  id = g_strdup_printf ("transport-stats_%s", GST_OBJECT_NAME (transport));
   stats = gst_structure_new_empty (id);
   _set_base_stats (stats, GST_WEBRTC_STATS_TRANSPORT, ts, id);
 
@@ -395,45 +425,68 @@ _get_stats_from_dtls_transport (GstWebRTCBin * webrtc,
   gst_structure_set (s, id, GST_TYPE_STRUCTURE, stats, NULL);
   gst_structure_free (stats);
 
-  _get_stats_from_ice_transport (webrtc, transport->transport, s);
+  g_free (_get_stats_from_ice_transport (ctx, transport->transport));
 
   return id;
 }
 
+static const GstStructure *
+_get_rtp_session_stats (StatsContext * ctx, guint session_id)
+{
+  GstStructure *rtp_stats;
+  GObject *rtp_session;
+
+  rtp_stats = g_hash_table_lookup (ctx->session_stats,
+      GUINT_TO_POINTER (session_id));
+  if (rtp_stats)
+    return rtp_stats;
+
+  g_signal_emit_by_name (ctx->webrtc->rtpbin, "get-internal-session",
+      session_id, &rtp_session);
+  g_object_get (rtp_session, "stats", &rtp_stats, NULL);
+  g_object_unref (rtp_session);
+
+  g_hash_table_insert (ctx->session_stats, GUINT_TO_POINTER (session_id),
+      rtp_stats);
+
+  return rtp_stats;
+}
+
 static void
-_get_stats_from_transport_channel (GstWebRTCBin * webrtc,
-    TransportStream * stream, const gchar * codec_id, GstStructure * s)
+_get_stats_from_transport_channel (StatsContext * ctx,
+    TransportStream * stream, const gchar * codec_id)
 {
   GstWebRTCDTLSTransport *transport;
-  GObject *rtp_session;
-  GstStructure *rtp_stats;
+  const GstStructure *rtp_stats;
   GValueArray *source_stats;
   gchar *transport_id;
-  double ts;
+  guint target_bitrate;
   int i;
 
-  gst_structure_get_double (s, "timestamp", &ts);
-
   transport = stream->transport;
   if (!transport)
     transport = stream->transport;
   if (!transport)
     return;
 
-  g_signal_emit_by_name (webrtc->rtpbin, "get-internal-session",
-      stream->session_id, &rtp_session);
-  g_object_get (rtp_session, "stats", &rtp_stats, NULL);
+  transport_id = _get_stats_from_dtls_transport (ctx, transport);
+
+  if (!(ctx->types & RTP_STREAM_STATS_TYPES)) {
+    g_free (transport_id);
+    return;
+  }
 
+  rtp_stats = _get_rtp_session_stats (ctx, stream->session_id);
+  target_bitrate =
+      _get_bitrate_estimate_for_session (ctx->webrtc, stream->session_id);
   gst_structure_get (rtp_stats, "source-stats", G_TYPE_VALUE_ARRAY,
       &source_stats, NULL);
 
-  GST_DEBUG_OBJECT (webrtc, "retrieving rtp stream stats from transport %"
-      GST_PTR_FORMAT " rtp session %" GST_PTR_FORMAT " with %u rtp sources, "
-      "transport %" GST_PTR_FORMAT, stream, rtp_session, source_stats->n_values,
+  GST_DEBUG_OBJECT (ctx->webrtc, "retrieving rtp stream stats from transport %"
+      GST_PTR_FORMAT " rtp session %u with %u rtp sources, transport %"
+      GST_PTR_FORMAT, stream, stream->session_id, source_stats->n_values,
       transport);
 
-  transport_id = _get_stats_from_dtls_transport (webrtc, transport, s);
-
   /* construct stats objects */
   for (i = 0; i < source_stats->n_values; i++) {
     const GstStructure *stats;
@@ -447,29 +500,31 @@ _get_stats_from_transport_channel (GstWebRTCBin * webrtc,
     if (internal)
       continue;
 
-    _get_stats_from_rtp_source_stats (webrtc, stats, codec_id, transport_id, s);
+    _get_stats_from_rtp_source_stats (ctx, stats, codec_id, transport_id,
+        target_bitrate);
   }
 
-  g_object_unref (rtp_session);
-  gst_structure_free (rtp_stats);
   g_value_array_free (source_stats);
   g_free (transport_id);
 }
 
 /* https://www.w3.org/TR/webrtc-stats/#codec-dict* */
 static gchar *
-_get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
-    GstStructure * s)
+_get_codec_stats_from_pad (StatsContext * ctx, GstPad * pad)
 {
+  GstStructure *s = ctx->s;
   GstStructure *stats;
   GstCaps *caps;
   gchar *id;
   double ts;
 
+  id = g_strdup_printf ("codec-stats-%s", GST_OBJECT_NAME (pad));
+  if (!(ctx->types & STATS_TYPE_FLAG (GST_WEBRTC_STATS_CODEC)))
+    return id;
+
   gst_structure_get_double (s, "timestamp", &ts);
 
   stats = gst_structure_new_empty ("unused");
-  id = g_strdup_printf ("codec-stats-%s", GST_OBJECT_NAME (pad));
   _set_base_stats (stats, GST_WEBRTC_STATS_CODEC, ts, id);
 
   caps = gst_pad_get_current_caps (pad);
@@ -496,17 +551,17 @@ _get_codec_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad,
 }
 
 static gboolean
-_get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
+_get_stats_from_pad (GstElement * element, GstPad * pad, StatsContext * ctx)
 {
   GstWebRTCBinPad *wpad = GST_WEBRTC_BIN_PAD (pad);
   gchar *codec_id;
 
-  codec_id = _get_codec_stats_from_pad (webrtc, pad, s);
+  codec_id = _get_codec_stats_from_pad (ctx, pad);
   if (wpad->trans) {
     WebRTCTransceiver *trans;
     trans = WEBRTC_TRANSCEIVER (wpad->trans);
     if (trans->stream)
-      _get_stats_from_transport_channel (webrtc, trans->stream, codec_id, s);
+      _get_stats_from_transport_channel (ctx, trans->stream, codec_id);
   }
 
   g_free (codec_id);
@@ -514,32 +569,79 @@ _get_stats_from_pad (GstWebRTCBin * webrtc, GstPad * pad, GstStructure * s)
   return TRUE;
 }
 
+static gboolean
+_stats_is_not_of_type (GQuark field_id, GValue * value, gpointer type)
+{
+  const GstStructure *stats;
+  GstWebRTCStatsType stats_type;
+
+  if (!GST_VALUE_HOLDS_STRUCTURE (value))
+    return TRUE;
+
+  stats = gst_value_get_structure (value);
+  if (!gst_structure_get (stats, "type", GST_TYPE_WEBRTC_STATS_TYPE,
+          &stats_type, NULL))
+    return TRUE;
+
+  return stats_type != GPOINTER_TO_INT (type);
+}
+
+static gboolean
+_stats_is_of_type (GQuark field_id, GValue * value, gpointer type)
+{
+  return !_stats_is_not_of_type (field_id, value, type);
+}
+
+/* Gathers the stats of @type, or of every type if @type is 0, into the
+ * cached stats. The cached stats of the other types are kept, so polling a
+ * single type only queries the objects providing it. */
 void
-gst_webrtc_bin_update_stats (GstWebRTCBin * webrtc)
+gst_webrtc_bin_update_stats (GstWebRTCBin * webrtc, GstWebRTCStatsType type)
 {
-  GstStructure *s = gst_structure_new_empty ("application/x-webrtc-stats");
   double ts = monotonic_time_as_double_milliseconds ();
-  GstStructure *pc_stats;
+  StatsContext ctx;
+  GstStructure *s;
 
   _init_debug ();
 
+  if (type == 0 || webrtc->priv->stats == NULL) {
+    s = gst_structure_new_empty ("application/x-webrtc-stats");
+  } else {
+    s = webrtc->priv->stats;
+    webrtc->priv->stats = NULL;
+    /* objects that went away since the last update are dropped */
+    gst_structure_filter_and_map_in_place (s, _stats_is_not_of_type,
+        GINT_TO_POINTER (type));
+  }
+
   gst_structure_set (s, "timestamp", G_TYPE_DOUBLE, ts, NULL);
 
   /* FIXME: better unique IDs */
-  /* FIXME: rate limitting stat updates? */
   /* FIXME: all stats need to be kept forever */
 
-  GST_DEBUG_OBJECT (webrtc, "updating stats at time %f", ts);
+  GST_DEBUG_OBJECT (webrtc, "updating stats of type %d at time %f", type, ts);
+
+  ctx.webrtc = webrtc;
+  ctx.s = s;
+  ctx.types = type == 0 ? ALL_STATS_TYPES : STATS_TYPE_FLAG (type);
+  ctx.session_stats = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) gst_structure_free);
 
-  if ((pc_stats = _get_peer_connection_stats (webrtc))) {
-    const gchar *id = "peer-connection-stats";
-    _set_base_stats (pc_stats, GST_WEBRTC_STATS_PEER_CONNECTION, ts, id);
-    gst_structure_set (s, id, GST_TYPE_STRUCTURE, pc_stats, NULL);
-    gst_structure_free (pc_stats);
+  if (ctx.types & STATS_TYPE_FLAG (GST_WEBRTC_STATS_PEER_CONNECTION)) {
+    GstStructure *pc_stats;
+
+    if ((pc_stats = _get_peer_connection_stats (webrtc))) {
+      const gchar *id = "peer-connection-stats";
+      _set_base_stats (pc_stats, GST_WEBRTC_STATS_PEER_CONNECTION, ts, id);
+      gst_structure_set (s, id, GST_TYPE_STRUCTURE, pc_stats, NULL);
+      gst_structure_free (pc_stats);
+    }
   }
 
   gst_element_foreach_pad (GST_ELEMENT (webrtc),
-      (GstElementForeachPadFunc) _get_stats_from_pad, s);
+      (GstElementForeachPadFunc) _get_stats_from_pad, &ctx);
+
+  g_hash_table_unref (ctx.session_stats);
 
   gst_structure_remove_field (s, "timestamp");
 
@@ -547,3 +649,17 @@ gst_webrtc_bin_update_stats (GstWebRTCBin * webrtc)
     gst_structure_free (webrtc->priv->stats);
   webrtc->priv->stats = s;
 }
+
+/* Returns a copy of the cached stats of @type, or of all of them if @type
+ * is 0 */
+GstStructure *
+gst_webrtc_bin_copy_stats (GstWebRTCBin * webrtc, GstWebRTCStatsType type)
+{
+  GstStructure *s = gst_structure_copy (webrtc->priv->stats);
+
+  if (type != 0)
+    gst_structure_filter_and_map_in_place (s, _stats_is_of_type,
+        GINT_TO_POINTER (type));
+
+  return s;
+}
@@ -28,7 +28,11 @@
 G_BEGIN_DECLS
 
 G_GNUC_INTERNAL
-void        gst_webrtc_bin_update_stats         (GstWebRTCBin * webrtc);
+void        gst_webrtc_bin_update_stats         (GstWebRTCBin * webrtc,
+                                                 GstWebRTCStatsType type);
+G_GNUC_INTERNAL
+GstStructure * gst_webrtc_bin_copy_stats        (GstWebRTCBin * webrtc,
+                                                 GstWebRTCStatsType type);
 
 G_END_DECLS
 
@@ -38,6 +38,8 @@ GstWebRTCICEStream *    _find_ice_stream_for_session            (GstWebRTCBin *
 void                    _add_ice_stream_item                    (GstWebRTCBin * webrtc,
                                                                  guint session_id,
                                                                  GstWebRTCICEStream * stream);
+guint                   _get_bitrate_estimate_for_session       (GstWebRTCBin * webrtc,
+                                                                 guint session_id);
 
 struct pad_block
 {
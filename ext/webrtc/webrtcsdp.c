@@ -145,8 +145,7 @@ _check_sdp_crypto (GstWebRTCBin * webrtc, SDPSource source,
   return TRUE;
 }
 
-#if 0
-static gboolean
+gboolean
 _session_has_attribute_key (const GstSDPMessage * msg, const gchar * key)
 {
   int i;
@@ -160,6 +159,7 @@ _session_has_attribute_key (const GstSDPMessage * msg, const gchar * key)
   return FALSE;
 }
 
+#if 0
 static gboolean
 _session_has_attribute_key_value (const GstSDPMessage * msg, const gchar * key,
     const gchar * value)
@@ -75,6 +75,9 @@ void                                _generate_ice_credentials               (gch
 G_GNUC_INTERNAL
 gboolean                            _media_has_attribute_key                (const GstSDPMedia * media,
                                                                              const gchar * key);
+G_GNUC_INTERNAL
+gboolean                            _session_has_attribute_key              (const GstSDPMessage * msg,
+                                                                             const gchar * key);
 
 
 #endif /* __WEBRTC_UTILS_H__ */
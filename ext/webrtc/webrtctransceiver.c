@@ -40,6 +40,7 @@ enum
   PROP_FEC_TYPE,
   PROP_FEC_PERCENTAGE,
   PROP_DO_NACK,
+  PROP_RIDS,
 };
 
 void
@@ -69,11 +70,32 @@ webrtc_transceiver_set_transport (WebRTCTransceiver * trans,
         (GstObject *) stream->rtcp_transport);
 }
 
+/* keeps the percentage of the running encoder in sync with the
+ * fec-percentage property */
+void
+webrtc_transceiver_set_fec_encoder (WebRTCTransceiver * trans,
+    GstElement * fec_encoder)
+{
+  guint percentage;
+
+  g_return_if_fail (WEBRTC_IS_TRANSCEIVER (trans));
+
+  GST_OBJECT_LOCK (trans);
+  gst_object_replace ((GstObject **) & trans->fec_encoder,
+      (GstObject *) fec_encoder);
+  percentage = trans->fec_percentage;
+  GST_OBJECT_UNLOCK (trans);
+
+  if (fec_encoder)
+    g_object_set (fec_encoder, "percentage", percentage, NULL);
+}
+
 static void
 webrtc_transceiver_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
   WebRTCTransceiver *trans = WEBRTC_TRANSCEIVER (object);
+  GstElement *fec_encoder = NULL;
 
   switch (prop_id) {
     case PROP_WEBRTC:
@@ -93,12 +115,23 @@ webrtc_transceiver_set_property (GObject * object, guint prop_id,
       break;
     case PROP_FEC_PERCENTAGE:
       trans->fec_percentage = g_value_get_uint (value);
+      if (trans->fec_encoder)
+        fec_encoder = gst_object_ref (trans->fec_encoder);
+      break;
+    case PROP_RIDS:
+      g_strfreev (trans->rids);
+      trans->rids = g_value_dup_boxed (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
   GST_OBJECT_UNLOCK (trans);
+
+  if (fec_encoder) {
+    g_object_set (fec_encoder, "percentage", g_value_get_uint (value), NULL);
+    gst_object_unref (fec_encoder);
+  }
 }
 
 static void
@@ -118,6 +151,9 @@ webrtc_transceiver_get_property (GObject * object, guint prop_id,
     case PROP_FEC_PERCENTAGE:
       g_value_set_uint (value, trans->fec_percentage);
       break;
+    case PROP_RIDS:
+      g_value_set_boxed (value, trans->rids);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -138,6 +174,17 @@ webrtc_transceiver_finalize (GObject * object)
     gst_structure_free (trans->local_rtx_ssrc_map);
   trans->local_rtx_ssrc_map = NULL;
 
+  if (trans->simulcast_funnel)
+    gst_object_unref (trans->simulcast_funnel);
+  trans->simulcast_funnel = NULL;
+
+  if (trans->fec_encoder)
+    gst_object_unref (trans->fec_encoder);
+  trans->fec_encoder = NULL;
+
+  g_strfreev (trans->rids);
+  trans->rids = NULL;
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -177,9 +224,18 @@ webrtc_transceiver_class_init (WebRTCTransceiverClass * klass)
   g_object_class_install_property (gobject_class,
       PROP_FEC_PERCENTAGE,
       g_param_spec_uint ("fec-percentage", "FEC percentage",
-          "The amount of Forward Error Correction to apply",
+          "The amount of Forward Error Correction to apply, "
+          "can be changed while sending",
           0, 100, DEFAULT_FEC_PERCENTAGE,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* the RTP stream ids of the simulcast layers, see the sink_%u_%s pads of
+   * webrtcbin */
+  g_object_class_install_property (gobject_class,
+      PROP_RIDS,
+      g_param_spec_boxed ("rids", "RIDs",
+          "The RTP stream ids of the simulcast layers to send",
+          G_TYPE_STRV, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
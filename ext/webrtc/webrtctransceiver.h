@@ -40,10 +40,17 @@ struct _WebRTCTransceiver
   TransportStream          *stream;
   GstStructure             *local_rtx_ssrc_map;
 
+  /* simulcast layers are combined into the rtpbin session by this */
+  GstElement               *simulcast_funnel;
+
+  /* the rtpulpfecenc of the session, protected by the object lock */
+  GstElement               *fec_encoder;
+
   /* Properties */
   GstWebRTCFECType         fec_type;
   guint                    fec_percentage;
   gboolean                 do_nack;
+  gchar                  **rids;
 };
 
 struct _WebRTCTransceiverClass
@@ -58,6 +65,9 @@ WebRTCTransceiver *       webrtc_transceiver_new            (GstWebRTCBin * webr
 void                      webrtc_transceiver_set_transport  (WebRTCTransceiver * trans,
                                                              TransportStream * stream);
 
+void                      webrtc_transceiver_set_fec_encoder (WebRTCTransceiver * trans,
+                                                             GstElement * fec_encoder);
+
 G_END_DECLS
 
 #endif /* __WEBRTC_TRANSCEIVER_H__ */
@@ -217,6 +217,7 @@ enum
   PROP_VOICE_DETECTION,
   PROP_VOICE_DETECTION_FRAME_SIZE_MS,
   PROP_VOICE_DETECTION_LIKELIHOOD,
+  PROP_STATS,
 };
 
 /**
@@ -235,8 +236,15 @@ struct _GstWebrtcDsp
 
   /* Protected by the stream lock */
   GstAdapter *adapter;
+  GstBuffer *aligned_buffer;
   webrtc::AudioProcessing * apm;
 
+  /* Protected by the object lock */
+  guint64 processed_frames;
+  guint64 aligned_frames;
+  GstClockTime processing_time;
+  GstClockTime max_processing_time;
+
   /* Protected by the object lock */
   gchar *probe_name;
   GstWebrtcEchoProbe *probe;
@@ -414,11 +422,10 @@ gst_webrtc_vad_post_message (GstWebrtcDsp *self, GstClockTime timestamp,
       gst_message_new_element (GST_OBJECT (self), s));
 }
 
-static GstFlowReturn
-gst_webrtc_dsp_process_stream (GstWebrtcDsp * self,
-    GstBuffer * buffer)
+static void
+gst_webrtc_dsp_process_frame (GstWebrtcDsp * self, guint8 * data,
+    GstClockTime timestamp)
 {
-  GstMapInfo info;
   webrtc::AudioProcessing * apm = self->apm;
   webrtc::AudioFrame frame;
   gint err;
@@ -427,12 +434,7 @@ gst_webrtc_dsp_process_stream (GstWebrtcDsp * self,
   frame.sample_rate_hz_ = self->info.rate;
   frame.samples_per_channel_ = self->period_size / self->info.bpf;
 
-  if (!gst_buffer_map (buffer, &info, (GstMapFlags) GST_MAP_READWRITE)) {
-    gst_buffer_unref (buffer);
-    return GST_FLOW_ERROR;
-  }
-
-  memcpy (frame.data_, info.data, self->period_size);
+  memcpy (frame.data_, data, self->period_size);
 
   if ((err = apm->ProcessStream (&frame)) < 0) {
     GST_WARNING_OBJECT (self, "Failed to filter the audio: %s.",
@@ -442,16 +444,56 @@ gst_webrtc_dsp_process_stream (GstWebrtcDsp * self,
       gboolean stream_has_voice = apm->voice_detection ()->stream_has_voice ();
 
       if (stream_has_voice != self->stream_has_voice)
-        gst_webrtc_vad_post_message (self, GST_BUFFER_PTS (buffer), stream_has_voice);
+        gst_webrtc_vad_post_message (self, timestamp, stream_has_voice);
 
       self->stream_has_voice = stream_has_voice;
     }
-    memcpy (info.data, frame.data_, self->period_size);
+    memcpy (data, frame.data_, self->period_size);
+  }
+}
+
+/* Processes the buffer in place, one 10ms frame at a time */
+static GstFlowReturn
+gst_webrtc_dsp_process_stream (GstWebrtcDsp * self, GstBuffer * buffer)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstClockTime start, elapsed, timestamp;
+  GstMapInfo info;
+  guint64 frames = 0;
+  gsize offset;
+
+  if (!gst_buffer_map (buffer, &info, (GstMapFlags) GST_MAP_READWRITE))
+    return GST_FLOW_ERROR;
+
+  start = gst_util_get_timestamp ();
+
+  for (offset = 0; offset + self->period_size <= info.size;
+      offset += self->period_size) {
+    timestamp = GST_BUFFER_PTS (buffer);
+    if (GST_CLOCK_TIME_IS_VALID (timestamp))
+      timestamp += frames * 10 * GST_MSECOND;
+
+    ret = gst_webrtc_dsp_analyze_reverse_stream (self, timestamp);
+    if (ret != GST_FLOW_OK)
+      break;
+
+    gst_webrtc_dsp_process_frame (self, info.data + offset, timestamp);
+    frames++;
   }
 
+  elapsed = gst_util_get_timestamp () - start;
+
   gst_buffer_unmap (buffer, &info);
 
-  return GST_FLOW_OK;
+  GST_OBJECT_LOCK (self);
+  self->processed_frames += frames;
+  self->processing_time += elapsed;
+  if (frames > 0)
+    self->max_processing_time = MAX (self->max_processing_time,
+        elapsed / frames);
+  GST_OBJECT_UNLOCK (self);
+
+  return ret;
 }
 
 static GstFlowReturn
@@ -470,6 +512,16 @@ gst_webrtc_dsp_submit_input_buffer (GstBaseTransform * btrans,
     gst_adapter_clear (self->adapter);
   }
 
+  /* Buffers holding whole 10ms frames are processed in place, there is no
+   * need to break them up through the adapter */
+  if (gst_adapter_available (self->adapter) == 0 && self->period_size > 0 &&
+      gst_buffer_get_size (buffer) > 0 &&
+      gst_buffer_get_size (buffer) % self->period_size == 0) {
+    g_assert (self->aligned_buffer == NULL);
+    self->aligned_buffer = buffer;
+    return GST_FLOW_OK;
+  }
+
   gst_adapter_push (self->adapter, buffer);
 
   return GST_FLOW_OK;
@@ -479,7 +531,20 @@ static GstFlowReturn
 gst_webrtc_dsp_generate_output (GstBaseTransform * btrans, GstBuffer ** outbuf)
 {
   GstWebrtcDsp *self = GST_WEBRTC_DSP (btrans);
-  GstFlowReturn ret;
+
+  if (self->aligned_buffer) {
+    *outbuf = self->aligned_buffer;
+    self->aligned_buffer = NULL;
+
+    GST_BUFFER_DURATION (*outbuf) = gst_buffer_get_size (*outbuf) /
+        self->period_size * 10 * GST_MSECOND;
+
+    GST_OBJECT_LOCK (self);
+    self->aligned_frames += gst_buffer_get_size (*outbuf) / self->period_size;
+    GST_OBJECT_UNLOCK (self);
+
+    return gst_webrtc_dsp_process_stream (self, *outbuf);
+  }
 
   if (gst_adapter_available (self->adapter) < self->period_size) {
     *outbuf = NULL;
@@ -487,12 +552,8 @@ gst_webrtc_dsp_generate_output (GstBaseTransform * btrans, GstBuffer ** outbuf)
   }
 
   *outbuf = gst_webrtc_dsp_take_buffer (self);
-  ret = gst_webrtc_dsp_analyze_reverse_stream (self, GST_BUFFER_PTS (*outbuf));
-
-  if (ret == GST_FLOW_OK)
-    ret = gst_webrtc_dsp_process_stream (self, *outbuf);
 
-  return ret;
+  return gst_webrtc_dsp_process_stream (self, *outbuf);
 }
 
 static gboolean
@@ -514,6 +575,11 @@ gst_webrtc_dsp_start (GstBaseTransform * btrans)
 
   self->apm = webrtc::AudioProcessing::Create (config);
 
+  self->processed_frames = 0;
+  self->aligned_frames = 0;
+  self->processing_time = 0;
+  self->max_processing_time = 0;
+
   if (self->echo_cancel) {
     self->probe = gst_webrtc_acquire_echo_probe (self->probe_name);
 
@@ -545,6 +611,7 @@ gst_webrtc_dsp_setup (GstAudioFilter * filter, const GstAudioInfo * info)
   GST_OBJECT_LOCK (self);
 
   gst_adapter_clear (self->adapter);
+  gst_buffer_replace (&self->aligned_buffer, NULL);
   self->info = *info;
   apm = self->apm;
 
@@ -676,6 +743,7 @@ gst_webrtc_dsp_stop (GstBaseTransform * btrans)
   GST_OBJECT_LOCK (self);
 
   gst_adapter_clear (self->adapter);
+  gst_buffer_replace (&self->aligned_buffer, NULL);
 
   if (self->probe) {
     gst_webrtc_release_echo_probe (self->probe);
@@ -826,6 +894,18 @@ gst_webrtc_dsp_get_property (GObject * object,
     case PROP_VOICE_DETECTION_LIKELIHOOD:
       g_value_set_enum (value, self->voice_detection_likelihood);
       break;
+    case PROP_STATS:
+      g_value_take_boxed (value,
+          gst_structure_new ("application/x-webrtcdsp-stats",
+              "processed-frames", G_TYPE_UINT64, self->processed_frames,
+              "aligned-frames", G_TYPE_UINT64, self->aligned_frames,
+              "processing-time", G_TYPE_UINT64, self->processing_time,
+              "average-processing-time", G_TYPE_UINT64,
+              self->processed_frames ?
+              self->processing_time / self->processed_frames : 0,
+              "max-processing-time", G_TYPE_UINT64,
+              self->max_processing_time, NULL));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1034,6 +1114,23 @@ gst_webrtc_dsp_class_init (GstWebrtcDspClass * klass)
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
               G_PARAM_CONSTRUCT)));
 
+  /**
+   * GstWebrtcDsp:stats:
+   *
+   * Processing statistics since the element was started: the number of
+   * 10ms frames processed, how many of them were processed in place because
+   * the input buffers were already 10ms aligned, and the total, average and
+   * maximum processing time per frame in nanoseconds. The processing time
+   * includes the echo canceller reverse stream analysis.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Processing statistics", GST_TYPE_STRUCTURE,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
 }
 
 static gboolean
@@ -39,7 +39,10 @@
 GST_DEBUG_CATEGORY_EXTERN (webrtc_dsp_debug);
 #define GST_CAT_DEFAULT (webrtc_dsp_debug)
 
-#define MAX_ADAPTER_SIZE (1*1024*1024)
+/* Must be a power of two, so that the ring index stays continuous when the
+ * byte positions wrap around */
+#define RING_SIZE (1*1024*1024)
+#define RING_MASK (RING_SIZE - 1)
 
 static GstStaticPadTemplate gst_webrtc_echo_probe_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
@@ -69,6 +72,53 @@ static GList *gst_aec_probes = NULL;
 G_DEFINE_TYPE (GstWebrtcEchoProbe, gst_webrtc_echo_probe,
     GST_TYPE_AUDIO_FILTER);
 
+/* Must be called with the lock, after updating the locked fields and, if
+ * needed, the timestamp position */
+static void
+gst_webrtc_echo_probe_publish_state (GstWebrtcEchoProbe * self,
+    GstClockTime ts, gsize ts_pos)
+{
+  guint seq = self->state_seq.load (std::memory_order_relaxed);
+
+  self->state_seq.store (seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence (std::memory_order_release);
+
+  self->state.rate = self->info.rate;
+  self->state.channels = self->info.channels;
+  self->state.bpf = self->info.bpf;
+  self->state.period_size = self->period_size;
+  self->state.latency = self->latency;
+  self->state.delay = self->delay;
+  self->state.ts = ts;
+  self->state.ts_pos = ts_pos;
+
+  self->state_seq.store (seq + 2, std::memory_order_release);
+}
+
+static void
+gst_webrtc_echo_probe_get_state (GstWebrtcEchoProbe * self,
+    GstWebrtcEchoProbeState * state)
+{
+  guint seq;
+
+  do {
+    seq = self->state_seq.load (std::memory_order_acquire);
+    if (seq & 1)
+      continue;
+    *state = self->state;
+    std::atomic_thread_fence (std::memory_order_acquire);
+  } while ((seq & 1)
+      || seq != self->state_seq.load (std::memory_order_relaxed));
+}
+
+/* Must be called with the lock, drops everything that was not read yet */
+static void
+gst_webrtc_echo_probe_reset_ring (GstWebrtcEchoProbe * self)
+{
+  self->read_pos.store (self->write_pos.load (std::memory_order_relaxed));
+  gst_webrtc_echo_probe_publish_state (self, GST_CLOCK_TIME_NONE, 0);
+}
+
 static gboolean
 gst_webrtc_echo_probe_setup (GstAudioFilter * filter, const GstAudioInfo * info)
 {
@@ -87,6 +137,9 @@ gst_webrtc_echo_probe_setup (GstAudioFilter * filter, const GstAudioInfo * info)
   if ((webrtc::AudioFrame::kMaxDataSizeSamples * 2) < self->period_size)
     goto period_too_big;
 
+  /* the queued audio is in the old format */
+  gst_webrtc_echo_probe_reset_ring (self);
+
   GST_WEBRTC_ECHO_PROBE_UNLOCK (self);
 
   return TRUE;
@@ -106,7 +159,7 @@ gst_webrtc_echo_probe_stop (GstBaseTransform * btrans)
   GstWebrtcEchoProbe *self = GST_WEBRTC_ECHO_PROBE (btrans);
 
   GST_WEBRTC_ECHO_PROBE_LOCK (self);
-  gst_adapter_clear (self->adapter);
+  gst_webrtc_echo_probe_reset_ring (self);
   GST_WEBRTC_ECHO_PROBE_UNLOCK (self);
 
   return TRUE;
@@ -138,6 +191,8 @@ gst_webrtc_echo_probe_src_event (GstBaseTransform * btrans, GstEvent * event)
       GST_WEBRTC_ECHO_PROBE_LOCK (self);
       self->latency = latency;
       self->delay = upstream_latency / GST_MSECOND;
+      gst_webrtc_echo_probe_publish_state (self, self->state.ts,
+          self->state.ts_pos);
       GST_WEBRTC_ECHO_PROBE_UNLOCK (self);
 
       GST_DEBUG_OBJECT (self, "We have a latency of %" GST_TIME_FORMAT
@@ -156,20 +211,57 @@ gst_webrtc_echo_probe_transform_ip (GstBaseTransform * btrans,
     GstBuffer * buffer)
 {
   GstWebrtcEchoProbe *self = GST_WEBRTC_ECHO_PROBE (btrans);
-  GstBuffer *newbuf = NULL;
+  GstClockTime ts;
+  GstMapInfo map;
+  const guint8 *data;
+  gsize size, w, r, index, chunk;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return GST_FLOW_ERROR;
+
+  data = map.data;
+  size = map.size;
 
-  GST_WEBRTC_ECHO_PROBE_LOCK (self);
-  newbuf = gst_buffer_copy (buffer);
   /* Moves the buffer timestamp to be in Running time */
-  GST_BUFFER_PTS (newbuf) = gst_segment_to_running_time (&btrans->segment,
-      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
-  gst_adapter_push (self->adapter, newbuf);
+  ts = gst_segment_to_running_time (&btrans->segment, GST_FORMAT_TIME,
+      GST_BUFFER_PTS (buffer));
+
+  GST_WEBRTC_ECHO_PROBE_LOCK (self);
+
+  /* only the most recent audio fits */
+  if (size > RING_SIZE) {
+    if (GST_CLOCK_TIME_IS_VALID (ts) && self->info.bpf && self->info.rate)
+      ts += gst_util_uint64_scale_int ((size - RING_SIZE) / self->info.bpf,
+          GST_SECOND, self->info.rate);
+    data += size - RING_SIZE;
+    size = RING_SIZE;
+  }
+
+  w = self->write_pos.load (std::memory_order_relaxed);
+
+  /* Drop the oldest audio if the DSP is not keeping up. The read position
+   * must move before the data is overwritten, so that a read in progress
+   * notices it lost the race */
+  r = self->read_pos.load ();
+  while (w + size - r > RING_SIZE) {
+    if (self->read_pos.compare_exchange_weak (r, w + size - RING_SIZE))
+      break;
+  }
+
+  index = w & RING_MASK;
+  chunk = MIN (size, RING_SIZE - index);
+  memcpy (self->ring + index, data, chunk);
+  memcpy (self->ring, data + chunk, size - chunk);
+
+  self->write_pos.store (w + size, std::memory_order_release);
+
+  if (GST_CLOCK_TIME_IS_VALID (ts))
+    gst_webrtc_echo_probe_publish_state (self, ts, w);
 
-  if (gst_adapter_available (self->adapter) > MAX_ADAPTER_SIZE)
-    gst_adapter_flush (self->adapter,
-        gst_adapter_available (self->adapter) - MAX_ADAPTER_SIZE);
   GST_WEBRTC_ECHO_PROBE_UNLOCK (self);
 
+  gst_buffer_unmap (buffer, &map);
+
   return GST_FLOW_OK;
 }
 
@@ -182,8 +274,8 @@ gst_webrtc_echo_probe_finalize (GObject * object)
   gst_aec_probes = g_list_remove (gst_aec_probes, self);
   G_UNLOCK (gst_aec_probes);
 
-  gst_object_unref (self->adapter);
-  self->adapter = NULL;
+  g_free (self->ring);
+  self->ring = NULL;
 
   G_OBJECT_CLASS (gst_webrtc_echo_probe_parent_class)->finalize (object);
 }
@@ -191,12 +283,17 @@ gst_webrtc_echo_probe_finalize (GObject * object)
 static void
 gst_webrtc_echo_probe_init (GstWebrtcEchoProbe * self)
 {
-  self->adapter = gst_adapter_new ();
   gst_audio_info_init (&self->info);
   g_mutex_init (&self->lock);
 
   self->latency = GST_CLOCK_TIME_NONE;
 
+  self->ring = (guint8 *) g_malloc (RING_SIZE);
+  self->write_pos.store (0);
+  self->read_pos.store (0);
+  self->state_seq.store (0);
+  gst_webrtc_echo_probe_publish_state (self, GST_CLOCK_TIME_NONE, 0);
+
   G_LOCK (gst_aec_probes);
   gst_aec_probes = g_list_prepend (gst_aec_probes, self);
   G_UNLOCK (gst_aec_probes);
@@ -266,87 +363,90 @@ gst_webrtc_release_echo_probe (GstWebrtcEchoProbe * probe)
   gst_object_unref (probe);
 }
 
+/* Copies size bytes starting at position pos, the caller must check that
+ * the writer did not overwrite them in the meantime */
+static void
+gst_webrtc_echo_probe_copy_ring (GstWebrtcEchoProbe * self, gsize pos,
+    guint8 * dest, gsize size)
+{
+  gsize index = pos & RING_MASK;
+  gsize chunk = MIN (size, RING_SIZE - index);
+
+  memcpy (dest, self->ring + index, chunk);
+  memcpy (dest + chunk, self->ring, size - chunk);
+}
+
 gint
 gst_webrtc_echo_probe_read (GstWebrtcEchoProbe * self, GstClockTime rec_time,
     gpointer _frame)
 {
   webrtc::AudioFrame * frame = (webrtc::AudioFrame *) _frame;
+  GstWebrtcEchoProbeState state;
   GstClockTimeDiff diff;
-  gsize avail, skip, offset, size;
-  gint delay = -1;
-
-  GST_WEBRTC_ECHO_PROBE_LOCK (self);
-
-  if (!GST_CLOCK_TIME_IS_VALID (self->latency) ||
-      !GST_AUDIO_INFO_IS_VALID (&self->info))
-    goto done;
-
-  /* In delay agnostic mode, just return 10ms of data */
-  if (!GST_CLOCK_TIME_IS_VALID (rec_time)) {
-    avail = gst_adapter_available (self->adapter);
-
-    if (avail < self->period_size)
-      goto done;
+  gsize avail, skip, offset, size, r;
 
-    size = self->period_size;
-    skip = 0;
-    offset = 0;
+  /* This is called for every frame of every DSP, so it never takes the lock.
+   * If the writer overruns the audio being copied, the read position moved
+   * and the whole read is retried */
+  do {
+    gst_webrtc_echo_probe_get_state (self, &state);
 
-    goto copy;
-  }
-
-  if (gst_adapter_available (self->adapter) == 0) {
-    diff = G_MAXINT64;
-  } else {
-    GstClockTime play_time;
-    guint64 distance;
+    if (!GST_CLOCK_TIME_IS_VALID (state.latency) || state.rate == 0)
+      return -1;
 
-    play_time = gst_adapter_prev_pts (self->adapter, &distance);
+    r = self->read_pos.load ();
+    avail = self->write_pos.load (std::memory_order_acquire) - r;
 
-    if (GST_CLOCK_TIME_IS_VALID (play_time)) {
-      play_time += gst_util_uint64_scale_int (distance / self->info.bpf,
-          GST_SECOND, self->info.rate);
-      play_time += self->latency;
+    /* In delay agnostic mode, just return 10ms of data */
+    if (!GST_CLOCK_TIME_IS_VALID (rec_time)) {
+      if (avail < state.period_size)
+        return -1;
 
-      diff = GST_CLOCK_DIFF (rec_time, play_time) / GST_MSECOND;
+      size = state.period_size;
+      skip = 0;
+      offset = 0;
     } else {
-      /* We have no timestamp, assume perfect delay */
-      diff = self->delay;
-    }
-  }
-
-  avail = gst_adapter_available (self->adapter);
-
-  if (diff > self->delay) {
-    skip = (diff - self->delay) * self->info.rate / 1000 * self->info.bpf;
-    skip = MIN (self->period_size, skip);
-    offset = 0;
-  } else {
-    skip = 0;
-    offset = (self->delay - diff) * self->info.rate / 1000 * self->info.bpf;
-    offset = MIN (avail, offset);
-  }
+      if (avail == 0) {
+        diff = G_MAXINT64;
+      } else if (GST_CLOCK_TIME_IS_VALID (state.ts)) {
+        GstClockTimeDiff play_time;
+
+        /* the position may be before ts_pos if the reader is behind the
+         * last timestamped buffer */
+        play_time = state.ts + ((GstClockTimeDiff) (r - state.ts_pos) /
+            state.bpf) * GST_SECOND / state.rate;
+        play_time += state.latency;
+
+        diff = (play_time - (GstClockTimeDiff) rec_time) / GST_MSECOND;
+      } else {
+        /* We have no timestamp, assume perfect delay */
+        diff = state.delay;
+      }
 
-  size = MIN (avail - offset, self->period_size - skip);
+      if (diff > state.delay) {
+        skip = (diff - state.delay) * state.rate / 1000 * state.bpf;
+        skip = MIN (state.period_size, skip);
+        offset = 0;
+      } else {
+        skip = 0;
+        offset = (state.delay - diff) * state.rate / 1000 * state.bpf;
+        offset = MIN (avail, offset);
+      }
 
-  if (size < self->period_size)
-    memset (frame->data_, 0, self->period_size);
+      size = MIN (avail - offset, state.period_size - skip);
 
-copy:
-  if (size) {
-    gst_adapter_copy (self->adapter, (guint8 *) frame->data_ + skip,
-        offset, size);
-    gst_adapter_flush (self->adapter, offset + size);
-  }
-
-  frame->num_channels_ = self->info.channels;
-  frame->sample_rate_hz_ = self->info.rate;
-  frame->samples_per_channel_ = self->period_size / self->info.bpf;
+      if (size < state.period_size)
+        memset (frame->data_, 0, state.period_size);
+    }
 
-  delay = self->delay;
+    if (size)
+      gst_webrtc_echo_probe_copy_ring (self, r + offset,
+          (guint8 *) frame->data_ + skip, size);
+  } while (!self->read_pos.compare_exchange_strong (r, r + offset + size));
 
-done:
-  GST_WEBRTC_ECHO_PROBE_UNLOCK (self);
+  frame->num_channels_ = state.channels;
+  frame->sample_rate_hz_ = state.rate;
+  frame->samples_per_channel_ = state.period_size / state.bpf;
 
-  return delay;
+  return state.delay;
 }
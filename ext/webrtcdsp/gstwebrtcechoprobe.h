@@ -24,10 +24,11 @@
 #define __GST_WEBRTC_ECHO_PROBE_H__
 
 #include <gst/gst.h>
-#include <gst/base/gstadapter.h>
 #include <gst/base/gstbasetransform.h>
 #include <gst/audio/audio.h>
 
+#include <atomic>
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_WEBRTC_ECHO_PROBE            (gst_webrtc_echo_probe_get_type())
@@ -43,6 +44,23 @@ G_BEGIN_DECLS
 typedef struct _GstWebrtcEchoProbe GstWebrtcEchoProbe;
 typedef struct _GstWebrtcEchoProbeClass GstWebrtcEchoProbeClass;
 
+/* Copy of the far-end parameters the DSP needs for each frame. It is
+ * republished under a sequence counter every time it changes, so that
+ * readers can take a consistent snapshot without the lock. */
+typedef struct
+{
+  gint rate;
+  gint channels;
+  gint bpf;
+  guint period_size;
+  GstClockTime latency;
+  gint delay;
+
+  /* running time of the sample at ring position ts_pos */
+  GstClockTime ts;
+  gsize ts_pos;
+} GstWebrtcEchoProbeState;
+
 /**
  * GstWebrtcEchoProbe:
  *
@@ -66,7 +84,16 @@ struct _GstWebrtcEchoProbe
   gint delay;
 
   GstSegment segment;
-  GstAdapter *adapter;
+
+  /* Far-end audio. There is a single writer, which holds the lock, and a
+   * single reader, the DSP, which never takes it. Positions count bytes
+   * since the start, the ring index is the position modulo the ring size. */
+  guint8 *ring;
+  std::atomic<gsize> write_pos;
+  std::atomic<gsize> read_pos;
+
+  std::atomic<guint> state_seq;
+  GstWebrtcEchoProbeState state;
 
   /* Private */
   gboolean acquired;
@@ -53,7 +53,11 @@ enum
   PROP_OPTION_STRING,
   PROP_X265_LOG_LEVEL,
   PROP_SPEED_PRESET,
-  PROP_TUNE
+  PROP_TUNE,
+  PROP_FRAME_THREADS,
+  PROP_POOLS,
+  PROP_LOOKAHEAD_SLICES,
+  PROP_WPP
 };
 
 #define PROP_BITRATE_DEFAULT            (2 * 1024)
@@ -62,6 +66,10 @@ enum
 #define PROP_LOG_LEVEL_DEFAULT           -1     // None
 #define PROP_SPEED_PRESET_DEFAULT        6      // Medium
 #define PROP_TUNE_DEFAULT                2      // SSIM
+#define PROP_FRAME_THREADS_DEFAULT       0      // Auto
+#define PROP_POOLS_DEFAULT               NULL
+#define PROP_LOOKAHEAD_SLICES_DEFAULT    -1     // Preset default
+#define PROP_WPP_DEFAULT                 TRUE
 
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
 #define FORMATS "I420, Y444, I420_10LE, Y444_10LE"
@@ -171,7 +179,8 @@ static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
         "framerate = (fraction) [0/1, MAX], "
         "width = (int) [ 4, MAX ], " "height = (int) [ 4, MAX ], "
         "stream-format = (string) byte-stream, "
-        "alignment = (string) au, " "profile = (string) { main }")
+        "alignment = (string) au, "
+        "profile = (string) { main, main-10, main-444, main-444-10 }")
     );
 
 static void gst_x265_enc_finalize (GObject * object);
@@ -204,32 +213,13 @@ G_DEFINE_TYPE_WITH_CODE (GstX265Enc, gst_x265_enc, GST_TYPE_VIDEO_ENCODER,
     G_IMPLEMENT_INTERFACE (GST_TYPE_PRESET, NULL));
 
 static void
-set_value (GValue * val, gint count, ...)
+append_format (GValue * list, const gchar * format)
 {
-  const gchar *fmt = NULL;
-  GValue sval = G_VALUE_INIT;
-  va_list ap;
-  gint i;
-
-  g_value_init (&sval, G_TYPE_STRING);
-
-  if (count > 1)
-    g_value_init (val, GST_TYPE_LIST);
-
-  va_start (ap, count);
-  for (i = 0; i < count; i++) {
-    fmt = va_arg (ap, const gchar *);
-    g_value_set_string (&sval, fmt);
-    if (count > 1) {
-      gst_value_list_append_value (val, &sval);
-    }
-  }
-  va_end (ap);
+  GValue val = G_VALUE_INIT;
 
-  if (count == 1)
-    *val = sval;
-  else
-    g_value_unset (&sval);
+  g_value_init (&val, G_TYPE_STRING);
+  g_value_set_static_string (&val, format);
+  gst_value_list_append_and_take_value (list, &val);
 }
 
 static void
@@ -237,45 +227,59 @@ gst_x265_enc_add_x265_chroma_format (GstStructure * s,
     int x265_chroma_format_local)
 {
   GValue fmt = G_VALUE_INIT;
+  gboolean have_8bit, have_10bit;
 
-  if (x265_max_bit_depth >= 10) {
-    GST_INFO ("This x265 build supports %d-bit depth", x265_max_bit_depth);
-    if (x265_chroma_format_local == 0) {
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-      set_value (&fmt, 4, "I420", "Y444", "I420_10LE", "Y444_10LE");
-#else
-      set_value (&fmt, 4, "I420", "Y444", "I420_10BE", "Y444_10BE");
-#endif
-    } else if (x265_chroma_format_local == X265_CSP_I444) {
+  /* With a multilib x265 build the 8 and 10 bit encoders are separate
+   * libraries, so ask for each of them instead of x265_max_bit_depth */
+  have_8bit = x265_api_get (8) != NULL;
+  have_10bit = x265_api_get (10) != NULL;
+
+  GST_INFO ("This x265 build supports 8-bit depth: %d, 10-bit depth: %d",
+      have_8bit, have_10bit);
+
+  if (x265_chroma_format_local != 0 &&
+      x265_chroma_format_local != X265_CSP_I420 &&
+      x265_chroma_format_local != X265_CSP_I444) {
+    GST_ERROR ("Unsupported chroma format %d", x265_chroma_format_local);
+    return;
+  }
+
+  g_value_init (&fmt, GST_TYPE_LIST);
+
+  if (x265_chroma_format_local != X265_CSP_I444) {
+    if (have_8bit)
+      append_format (&fmt, "I420");
+    if (have_10bit)
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-      set_value (&fmt, 2, "Y444", "Y444_10LE");
+      append_format (&fmt, "I420_10LE");
 #else
-      set_value (&fmt, 2, "Y444", "Y444_10BE");
+      append_format (&fmt, "I420_10BE");
 #endif
-    } else if (x265_chroma_format_local == X265_CSP_I420) {
+  }
+
+  if (x265_chroma_format_local != X265_CSP_I420) {
+    if (have_8bit)
+      append_format (&fmt, "Y444");
+    if (have_10bit)
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-      set_value (&fmt, 2, "I420", "I420_10LE");
+      append_format (&fmt, "Y444_10LE");
 #else
-      set_value (&fmt, 2, "I420", "I420_10BE");
+      append_format (&fmt, "Y444_10BE");
 #endif
-    } else {
-      GST_ERROR ("Unsupported chroma format %d", x265_chroma_format_local);
-    }
-  } else if (x265_max_bit_depth == 8) {
-    GST_INFO ("This x265 build supports 8-bit depth");
-    if (x265_chroma_format_local == 0) {
-      set_value (&fmt, 2, "I420", "Y444");
-    } else if (x265_chroma_format_local == X265_CSP_I444) {
-      set_value (&fmt, 1, "Y444");
-    } else if (x265_chroma_format_local == X265_CSP_I420) {
-      set_value (&fmt, 1, "I420");
-    } else {
-      GST_ERROR ("Unsupported chroma format %d", x265_chroma_format_local);
-    }
   }
 
-  if (G_VALUE_TYPE (&fmt) != G_TYPE_INVALID)
+  if (gst_value_list_get_size (&fmt) == 1) {
+    GValue single = G_VALUE_INIT;
+
+    g_value_init (&single, G_TYPE_STRING);
+    g_value_copy (gst_value_list_get_value (&fmt, 0), &single);
+    gst_structure_take_value (s, "format", &single);
+    g_value_unset (&fmt);
+  } else if (gst_value_list_get_size (&fmt) > 1) {
     gst_structure_take_value (s, "format", &fmt);
+  } else {
+    g_value_unset (&fmt);
+  }
 }
 
 static GstCaps *
@@ -397,6 +401,63 @@ gst_x265_enc_class_init (GstX265EncClass * klass)
           "Preset name for tuning options", GST_X265_ENC_TUNE_TYPE,
           PROP_TUNE_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstX265Enc:frame-threads:
+   *
+   * Number of concurrently encoded frames, 0 lets x265 decide based on the
+   * number of CPU cores.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FRAME_THREADS,
+      g_param_spec_uint ("frame-threads", "Frame threads",
+          "Number of concurrently encoded frames (0 = auto)", 0, 16,
+          PROP_FRAME_THREADS_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstX265Enc:pools:
+   *
+   * Thread pool layout across NUMA nodes, in x265's "pools" syntax. For
+   * example "+,-" creates a pool on the first node only and "8,8" puts eight
+   * worker threads on each of the first two nodes. Unset lets x265 create a
+   * single pool spanning all nodes.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_POOLS,
+      g_param_spec_string ("pools", "Thread pools",
+          "Comma separated number of worker threads per NUMA node, "
+          "+ for all cores and - for none (NULL = x265 default)",
+          PROP_POOLS_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstX265Enc:lookahead-slices:
+   *
+   * Number of slices the lookahead splits each frame into for its analysis,
+   * -1 keeps the value of the speed preset.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_LOOKAHEAD_SLICES,
+      g_param_spec_int ("lookahead-slices", "Lookahead slices",
+          "Number of slices used by the lookahead (-1 = preset default)",
+          -1, 16, PROP_LOOKAHEAD_SLICES_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstX265Enc:wpp:
+   *
+   * Enable wavefront parallel processing, encoding rows of CTUs of a frame
+   * in parallel.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WPP,
+      g_param_spec_boolean ("wpp", "WPP",
+          "Enable wavefront parallel processing", PROP_WPP_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "x265enc", "Codec/Encoder/Video", "H265 Encoder",
       "Thijs Vermeir <thijs.vermeir@barco.com>");
@@ -423,67 +484,10 @@ gst_x265_enc_init (GstX265Enc * encoder)
   encoder->log_level = PROP_LOG_LEVEL_DEFAULT;
   encoder->speed_preset = PROP_SPEED_PRESET_DEFAULT;
   encoder->tune = PROP_TUNE_DEFAULT;
-}
-
-typedef struct
-{
-  GstVideoCodecFrame *frame;
-  GstVideoFrame vframe;
-} FrameData;
-
-static FrameData *
-gst_x265_enc_queue_frame (GstX265Enc * enc, GstVideoCodecFrame * frame,
-    GstVideoInfo * info)
-{
-  GstVideoFrame vframe;
-  FrameData *fdata;
-
-  if (!gst_video_frame_map (&vframe, info, frame->input_buffer, GST_MAP_READ))
-    return NULL;
-
-  fdata = g_slice_new (FrameData);
-  fdata->frame = gst_video_codec_frame_ref (frame);
-  fdata->vframe = vframe;
-
-  enc->pending_frames = g_list_prepend (enc->pending_frames, fdata);
-
-  return fdata;
-}
-
-static void
-gst_x265_enc_dequeue_frame (GstX265Enc * enc, GstVideoCodecFrame * frame)
-{
-  GList *l;
-
-  for (l = enc->pending_frames; l; l = l->next) {
-    FrameData *fdata = l->data;
-
-    if (fdata->frame != frame)
-      continue;
-
-    gst_video_frame_unmap (&fdata->vframe);
-    gst_video_codec_frame_unref (fdata->frame);
-    g_slice_free (FrameData, fdata);
-
-    enc->pending_frames = g_list_delete_link (enc->pending_frames, l);
-    return;
-  }
-}
-
-static void
-gst_x265_enc_dequeue_all_frames (GstX265Enc * enc)
-{
-  GList *l;
-
-  for (l = enc->pending_frames; l; l = l->next) {
-    FrameData *fdata = l->data;
-
-    gst_video_frame_unmap (&fdata->vframe);
-    gst_video_codec_frame_unref (fdata->frame);
-    g_slice_free (FrameData, fdata);
-  }
-  g_list_free (enc->pending_frames);
-  enc->pending_frames = NULL;
+  encoder->frame_threads = PROP_FRAME_THREADS_DEFAULT;
+  encoder->pools = g_strdup (PROP_POOLS_DEFAULT);
+  encoder->lookahead_slices = PROP_LOOKAHEAD_SLICES_DEFAULT;
+  encoder->wpp = PROP_WPP_DEFAULT;
 }
 
 static gboolean
@@ -503,7 +507,6 @@ gst_x265_enc_stop (GstVideoEncoder * encoder)
 
   gst_x265_enc_flush_frames (x265enc, FALSE);
   gst_x265_enc_close_encoder (x265enc);
-  gst_x265_enc_dequeue_all_frames (x265enc);
 
   if (x265enc->input_state)
     gst_video_codec_state_unref (x265enc->input_state);
@@ -522,7 +525,6 @@ gst_x265_enc_flush (GstVideoEncoder * encoder)
 
   gst_x265_enc_flush_frames (x265enc, FALSE);
   gst_x265_enc_close_encoder (x265enc);
-  gst_x265_enc_dequeue_all_frames (x265enc);
 
   gst_x265_enc_init_encoder (x265enc);
 
@@ -541,6 +543,7 @@ gst_x265_enc_finalize (GObject * object)
   gst_x265_enc_close_encoder (encoder);
 
   g_string_free (encoder->option_string_prop, TRUE);
+  g_free (encoder->pools);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -593,7 +596,8 @@ gst_x265_enc_parse_options (GstX265Enc * encoder, const gchar * str)
     GStrv key_val = g_strsplit (kvpairs[i], "=", 2);
 
     parse_result =
-        x265_param_parse (&encoder->x265param, key_val[0], key_val[1]);
+        encoder->api->param_parse (&encoder->x265param, key_val[0],
+        key_val[1]);
 
     if (parse_result == X265_PARAM_BAD_NAME) {
       GST_ERROR_OBJECT (encoder, "Bad name for option %s=%s",
@@ -626,6 +630,7 @@ static gboolean
 gst_x265_enc_init_encoder (GstX265Enc * encoder)
 {
   GstVideoInfo *info;
+  guint bit_depth;
 
   if (!encoder->input_state) {
     GST_DEBUG_OBJECT (encoder, "Have no input state yet");
@@ -637,9 +642,20 @@ gst_x265_enc_init_encoder (GstX265Enc * encoder)
   /* make sure that the encoder is closed */
   gst_x265_enc_close_encoder (encoder);
 
+  /* Pick the library matching the input depth, so 10-bit input is encoded
+   * as is even if the default library is 8-bit only */
+  bit_depth = GST_VIDEO_INFO_COMP_DEPTH (info, 0);
+  encoder->api = x265_api_get (bit_depth);
+  if (!encoder->api) {
+    GST_ELEMENT_ERROR (encoder, STREAM, ENCODE,
+        ("Can not initialize x265 encoder."),
+        ("x265 has no support for %u-bit encoding", bit_depth));
+    return FALSE;
+  }
+
   GST_OBJECT_LOCK (encoder);
 
-  if (x265_param_default_preset (&encoder->x265param,
+  if (encoder->api->param_default_preset (&encoder->x265param,
           x265_preset_names[encoder->speed_preset - 1],
           x265_tune_names[encoder->tune - 1]) < 0) {
     GST_DEBUG_OBJECT (encoder, "preset or tune unrecognized");
@@ -674,6 +690,13 @@ gst_x265_enc_init_encoder (GstX265Enc * encoder)
     encoder->x265param.rc.rateControlMode = X265_RC_ABR;
   }
 
+  /* threading */
+  encoder->x265param.frameNumThreads = encoder->frame_threads;
+  encoder->x265param.numaPools = encoder->pools;
+  encoder->x265param.bEnableWavefront = encoder->wpp;
+  if (encoder->lookahead_slices != -1)
+    encoder->x265param.lookaheadSlices = encoder->lookahead_slices;
+
   /* apply option-string property */
   if (encoder->option_string_prop && encoder->option_string_prop->len) {
     GST_DEBUG_OBJECT (encoder, "Applying option-string: %s",
@@ -693,7 +716,7 @@ gst_x265_enc_init_encoder (GstX265Enc * encoder)
 
   GST_OBJECT_UNLOCK (encoder);
 
-  encoder->x265enc = x265_encoder_open (&encoder->x265param);
+  encoder->x265enc = encoder->api->encoder_open (&encoder->x265param);
   if (!encoder->x265enc) {
     GST_ELEMENT_ERROR (encoder, STREAM, ENCODE,
         ("Can not initialize x265 encoder."), (NULL));
@@ -714,7 +737,7 @@ static void
 gst_x265_enc_close_encoder (GstX265Enc * encoder)
 {
   if (encoder->x265enc != NULL) {
-    x265_encoder_close (encoder->x265enc);
+    encoder->api->encoder_close (encoder->x265enc);
     encoder->x265enc = NULL;
   }
 }
@@ -765,7 +788,8 @@ gst_x265_enc_set_level_tier_and_profile (GstX265Enc * encoder, GstCaps * caps)
 
   GST_DEBUG_OBJECT (encoder, "set profile, level and tier");
 
-  header_return = x265_encoder_headers (encoder->x265enc, &nal, &i_nal);
+  header_return =
+      encoder->api->encoder_headers (encoder->x265enc, &nal, &i_nal);
   if (header_return < 0) {
     GST_ELEMENT_ERROR (encoder, STREAM, ENCODE, ("Encode x265 header failed."),
         ("x265_encoder_headers return code=%d", header_return));
@@ -800,7 +824,8 @@ gst_x265_enc_get_header_buffer (GstX265Enc * encoder)
   int header_return;
   GstBuffer *buf;
 
-  header_return = x265_encoder_headers (encoder->x265enc, &nal, &i_nal);
+  header_return =
+      encoder->api->encoder_headers (encoder->x265enc, &nal, &i_nal);
   if (header_return < 0) {
     GST_ELEMENT_ERROR (encoder, STREAM, ENCODE, ("Encode x265 header failed."),
         ("x265_encoder_headers return code=%d", header_return));
@@ -985,26 +1010,25 @@ gst_x265_enc_handle_frame (GstVideoEncoder * video_enc,
   GstX265Enc *encoder = GST_X265_ENC (video_enc);
   GstVideoInfo *info = &encoder->input_state->info;
   GstFlowReturn ret;
+  GstVideoFrame vframe;
   x265_picture pic_in;
   guint32 i_nal, i;
-  FrameData *fdata;
   gint nplanes = 0;
 
   if (G_UNLIKELY (encoder->x265enc == NULL))
     goto not_inited;
 
   /* set up input picture */
-  x265_picture_init (&encoder->x265param, &pic_in);
+  encoder->api->picture_init (&encoder->x265param, &pic_in);
 
-  fdata = gst_x265_enc_queue_frame (encoder, frame, info);
-  if (!fdata)
+  if (!gst_video_frame_map (&vframe, info, frame->input_buffer, GST_MAP_READ))
     goto invalid_frame;
 
   pic_in.colorSpace =
       gst_x265_enc_gst_to_x265_video_format (info->finfo->format, &nplanes);
   for (i = 0; i < nplanes; i++) {
-    pic_in.planes[i] = GST_VIDEO_FRAME_PLANE_DATA (&fdata->vframe, i);
-    pic_in.stride[i] = GST_VIDEO_FRAME_COMP_STRIDE (&fdata->vframe, i);
+    pic_in.planes[i] = GST_VIDEO_FRAME_PLANE_DATA (&vframe, i);
+    pic_in.stride[i] = GST_VIDEO_FRAME_COMP_STRIDE (&vframe, i);
   }
 
   pic_in.sliceType = X265_TYPE_AUTO;
@@ -1015,7 +1039,11 @@ gst_x265_enc_handle_frame (GstVideoEncoder * video_enc,
 
   ret = gst_x265_enc_encode_frame (encoder, &pic_in, frame, &i_nal, TRUE);
 
-  /* input buffer is released later on */
+  /* x265 copies the picture into its own frame buffers before
+   * x265_encoder_encode() returns, the input does not need to stay mapped
+   * while the frame is in the lookahead and frame threads */
+  gst_video_frame_unmap (&vframe);
+
   return ret;
 
 /* ERRORS */
@@ -1068,7 +1096,7 @@ gst_x265_enc_encode_frame (GstX265Enc * encoder, x265_picture * pic_in,
   if (G_UNLIKELY (update_latency))
     gst_x265_enc_set_latency (encoder);
 
-  encoder_return = x265_encoder_encode (encoder->x265enc,
+  encoder_return = encoder->api->encoder_encode (encoder->x265enc,
       &nal, i_nal, pic_in, &pic_out);
 
   GST_DEBUG_OBJECT (encoder, "encoder result (%d) with %u nal units",
@@ -1140,7 +1168,6 @@ gst_x265_enc_encode_frame (GstX265Enc * encoder, x265_picture * pic_in,
 
 out:
   if (frame) {
-    gst_x265_enc_dequeue_frame (encoder, frame);
     ret = gst_video_encoder_finish_frame (GST_VIDEO_ENCODER (encoder), frame);
   }
 
@@ -1202,6 +1229,19 @@ gst_x265_enc_set_property (GObject * object, guint prop_id,
     case PROP_TUNE:
       encoder->tune = g_value_get_enum (value);
       break;
+    case PROP_FRAME_THREADS:
+      encoder->frame_threads = g_value_get_uint (value);
+      break;
+    case PROP_POOLS:
+      g_free (encoder->pools);
+      encoder->pools = g_value_dup_string (value);
+      break;
+    case PROP_LOOKAHEAD_SLICES:
+      encoder->lookahead_slices = g_value_get_int (value);
+      break;
+    case PROP_WPP:
+      encoder->wpp = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1246,6 +1286,18 @@ gst_x265_enc_get_property (GObject * object, guint prop_id,
     case PROP_TUNE:
       g_value_set_enum (value, encoder->tune);
       break;
+    case PROP_FRAME_THREADS:
+      g_value_set_uint (value, encoder->frame_threads);
+      break;
+    case PROP_POOLS:
+      g_value_set_string (value, encoder->pools);
+      break;
+    case PROP_LOOKAHEAD_SLICES:
+      g_value_set_int (value, encoder->lookahead_slices);
+      break;
+    case PROP_WPP:
+      g_value_set_boolean (value, encoder->wpp);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
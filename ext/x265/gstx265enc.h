@@ -47,20 +47,21 @@ struct _GstX265Enc
 
   /*< private > */
   x265_encoder *x265enc;
+  const x265_api *api;
   x265_param x265param;
   GstClockTime dts_offset;
   gboolean push_header;
 
-  /* List of frame/buffer mapping structs for
-   * pending frames */
-  GList *pending_frames;
-
   /* properties */
   guint bitrate;
   gint qp;
   gint log_level;
   gint tune;
   gint speed_preset;
+  guint frame_threads;
+  gchar *pools;
+  gint lookahead_slices;
+  gboolean wpp;
   GString *option_string_prop;  /* option-string property */
   /*GString *option_string; *//* used by set prop */
 
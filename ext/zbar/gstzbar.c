@@ -35,6 +35,17 @@
  *   values.
  * * GstSample `frame`: the frame in which the barcode message was detected, if
  *   the .#GstZBar:attach-frame property was set to %TRUE (Since 1.6)
+ * * #GstClockTime `stream-time`: the stream time of the buffer.
+ * * #GstClockTime `running-time`: the running time of the buffer.
+ * * #GstClockTime `duration`: the duration of the buffer.
+ *
+ * Buffers are passed through untouched. For high resolution streams the
+ * scanning can be moved off the streaming thread with the
+ * .#GstZBar:async property: frames are then handed to a worker thread
+ * without copying, and a frame that arrives while the previous one is still
+ * being scanned replaces any frame waiting for the worker. The
+ * .#GstZBar:scan-interval, .#GstZBar:decimation and region of interest
+ * properties further limit the amount of pixels that are scanned.
  *
  * ## Example launch lines
  * |[
@@ -43,6 +54,10 @@
  * |[
  * gst-launch-1.0 -m v4l2src ! tee name=t ! queue ! videoconvert ! zbar ! fakesink t. ! queue ! xvimagesink
  * ]| Same as above, but running the filter on a branch to keep the display in color
+ * |[
+ * gst-launch-1.0 -m v4l2src ! video/x-raw,width=3840,height=2160 ! zbar async=true scan-interval=100000000 decimation=2 roi-y=540 roi-height=1080 ! videoconvert ! xvimagesink
+ * ]| Scan the central band of a 4K stream at half resolution, at most ten
+ * times per second, without blocking the display
  *
  */
 
@@ -73,12 +88,36 @@ enum
   PROP_0,
   PROP_MESSAGE,
   PROP_ATTACH_FRAME,
-  PROP_CACHE
+  PROP_CACHE,
+  PROP_ASYNC,
+  PROP_SCAN_INTERVAL,
+  PROP_DECIMATION,
+  PROP_ROI_X,
+  PROP_ROI_Y,
+  PROP_ROI_WIDTH,
+  PROP_ROI_HEIGHT
 };
 
 #define DEFAULT_CACHE    FALSE
 #define DEFAULT_MESSAGE  TRUE
 #define DEFAULT_ATTACH_FRAME FALSE
+#define DEFAULT_ASYNC    FALSE
+#define DEFAULT_SCAN_INTERVAL 0
+#define DEFAULT_DECIMATION 1
+#define DEFAULT_ROI_X 0
+#define DEFAULT_ROI_Y 0
+#define DEFAULT_ROI_WIDTH 0
+#define DEFAULT_ROI_HEIGHT 0
+
+/* a frame to scan, with the times of its buffer */
+typedef struct
+{
+  GstVideoFrame frame;
+  GstClockTime timestamp;
+  GstClockTime stream_time;
+  GstClockTime running_time;
+  GstClockTime duration;
+} GstZBarJob;
 
 #define ZBAR_YUV_CAPS \
     "{ Y800, I420, YV12, NV12, NV21, Y41B, Y42B, YUV9, YVU9 }"
@@ -105,6 +144,8 @@ static void gst_zbar_get_property (GObject * object, guint prop_id,
 
 static gboolean gst_zbar_start (GstBaseTransform * base);
 static gboolean gst_zbar_stop (GstBaseTransform * base);
+static gboolean gst_zbar_sink_event (GstBaseTransform * base,
+    GstEvent * event);
 
 static GstFlowReturn gst_zbar_transform_frame_ip (GstVideoFilter * vfilter,
     GstVideoFrame * frame);
@@ -154,6 +195,98 @@ gst_zbar_class_init (GstZBarClass * g_class)
           G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
           G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstZBar::async:
+   *
+   * Scan frames on a worker thread instead of the streaming thread. Only
+   * the most recent frame waits for the worker, older ones are skipped.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ASYNC,
+      g_param_spec_boolean ("async", "Async",
+          "Scan frames on a worker thread, skipping frames while it is busy",
+          DEFAULT_ASYNC,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstZBar::scan-interval:
+   *
+   * Minimum time between the timestamps of two scanned frames.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SCAN_INTERVAL,
+      g_param_spec_uint64 ("scan-interval", "Scan interval",
+          "Minimum time between two scanned frames in nanoseconds "
+          "(0 = scan every frame)", 0, G_MAXUINT64, DEFAULT_SCAN_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstZBar::decimation:
+   *
+   * Only scan every n-th pixel of every n-th line.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_DECIMATION,
+      g_param_spec_uint ("decimation", "Decimation",
+          "Scan every n-th pixel horizontally and vertically", 1, 16,
+          DEFAULT_DECIMATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstZBar::roi-x:
+   *
+   * Left edge of the region of interest.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ROI_X,
+      g_param_spec_uint ("roi-x", "ROI x",
+          "Left edge of the scanned region in pixels", 0, G_MAXINT,
+          DEFAULT_ROI_X, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstZBar::roi-y:
+   *
+   * Top edge of the region of interest.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ROI_Y,
+      g_param_spec_uint ("roi-y", "ROI y",
+          "Top edge of the scanned region in pixels", 0, G_MAXINT,
+          DEFAULT_ROI_Y, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstZBar::roi-width:
+   *
+   * Width of the region of interest, 0 to extend it to the right edge of
+   * the frame.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ROI_WIDTH,
+      g_param_spec_uint ("roi-width", "ROI width",
+          "Width of the scanned region in pixels (0 = up to the right edge)",
+          0, G_MAXINT, DEFAULT_ROI_WIDTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstZBar::roi-height:
+   *
+   * Height of the region of interest, 0 to extend it to the bottom edge of
+   * the frame.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ROI_HEIGHT,
+      g_param_spec_uint ("roi-height", "ROI height",
+          "Height of the scanned region in pixels (0 = up to the bottom edge)",
+          0, G_MAXINT, DEFAULT_ROI_HEIGHT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (gstelement_class, "Barcode detector",
       "Filter/Analyzer/Video",
       "Detect bar codes in the video streams",
@@ -166,7 +299,9 @@ gst_zbar_class_init (GstZBarClass * g_class)
 
   trans_class->start = GST_DEBUG_FUNCPTR (gst_zbar_start);
   trans_class->stop = GST_DEBUG_FUNCPTR (gst_zbar_stop);
-  trans_class->transform_ip_on_passthrough = FALSE;
+  trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_zbar_sink_event);
+  /* frames are only read, so map them read-only in passthrough mode */
+  trans_class->transform_ip_on_passthrough = TRUE;
 
   vfilter_class->transform_frame_ip =
       GST_DEBUG_FUNCPTR (gst_zbar_transform_frame_ip);
@@ -178,8 +313,22 @@ gst_zbar_init (GstZBar * zbar)
   zbar->cache = DEFAULT_CACHE;
   zbar->message = DEFAULT_MESSAGE;
   zbar->attach_frame = DEFAULT_ATTACH_FRAME;
+  zbar->async = DEFAULT_ASYNC;
+  zbar->scan_interval = DEFAULT_SCAN_INTERVAL;
+  zbar->decimation = DEFAULT_DECIMATION;
+  zbar->roi_x = DEFAULT_ROI_X;
+  zbar->roi_y = DEFAULT_ROI_Y;
+  zbar->roi_width = DEFAULT_ROI_WIDTH;
+  zbar->roi_height = DEFAULT_ROI_HEIGHT;
 
   zbar->scanner = zbar_image_scanner_create ();
+  zbar->image = zbar_image_create ();
+  zbar_image_set_format (zbar->image, GST_MAKE_FOURCC ('Y', '8', '0', '0'));
+
+  g_mutex_init (&zbar->lock);
+  g_cond_init (&zbar->cond);
+
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (zbar), TRUE);
 }
 
 static void
@@ -187,7 +336,12 @@ gst_zbar_finalize (GObject * object)
 {
   GstZBar *zbar = GST_ZBAR (object);
 
+  zbar_image_destroy (zbar->image);
   zbar_image_scanner_destroy (zbar->scanner);
+  g_free (zbar->scratch);
+
+  g_mutex_clear (&zbar->lock);
+  g_cond_clear (&zbar->cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -211,6 +365,37 @@ gst_zbar_set_property (GObject * object, guint prop_id, const GValue * value,
     case PROP_ATTACH_FRAME:
       zbar->attach_frame = g_value_get_boolean (value);
       break;
+    case PROP_ASYNC:
+      zbar->async = g_value_get_boolean (value);
+      break;
+    case PROP_SCAN_INTERVAL:
+      zbar->scan_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_DECIMATION:
+      GST_OBJECT_LOCK (zbar);
+      zbar->decimation = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_X:
+      GST_OBJECT_LOCK (zbar);
+      zbar->roi_x = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_Y:
+      GST_OBJECT_LOCK (zbar);
+      zbar->roi_y = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_WIDTH:
+      GST_OBJECT_LOCK (zbar);
+      zbar->roi_width = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_HEIGHT:
+      GST_OBJECT_LOCK (zbar);
+      zbar->roi_height = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -236,36 +421,113 @@ gst_zbar_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_ATTACH_FRAME:
       g_value_set_boolean (value, zbar->attach_frame);
       break;
+    case PROP_ASYNC:
+      g_value_set_boolean (value, zbar->async);
+      break;
+    case PROP_SCAN_INTERVAL:
+      g_value_set_uint64 (value, zbar->scan_interval);
+      break;
+    case PROP_DECIMATION:
+      GST_OBJECT_LOCK (zbar);
+      g_value_set_uint (value, zbar->decimation);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_X:
+      GST_OBJECT_LOCK (zbar);
+      g_value_set_uint (value, zbar->roi_x);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_Y:
+      GST_OBJECT_LOCK (zbar);
+      g_value_set_uint (value, zbar->roi_y);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_WIDTH:
+      GST_OBJECT_LOCK (zbar);
+      g_value_set_uint (value, zbar->roi_width);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
+    case PROP_ROI_HEIGHT:
+      GST_OBJECT_LOCK (zbar);
+      g_value_set_uint (value, zbar->roi_height);
+      GST_OBJECT_UNLOCK (zbar);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
-static GstFlowReturn
-gst_zbar_transform_frame_ip (GstVideoFilter * vfilter, GstVideoFrame * frame)
+/* points the zbar image at the pixels of the region of interest. Whole
+ * lines are scanned in place, otherwise the region is copied, and
+ * decimated, to the scratch buffer. Returns FALSE if nothing is left. */
+static gboolean
+gst_zbar_prepare_image (GstZBar * zbar, GstVideoFrame * frame)
 {
-  GstZBar *zbar = GST_ZBAR (vfilter);
-  gpointer data;
-  gint stride, height;
-  zbar_image_t *image;
-  const zbar_symbol_t *symbol;
-  int n;
+  guint8 *data = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+  gint stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  guint width = GST_VIDEO_FRAME_WIDTH (frame);
+  guint height = GST_VIDEO_FRAME_HEIGHT (frame);
+  guint x, y, w, h, dec, dw, dh, i, j;
+
+  GST_OBJECT_LOCK (zbar);
+  x = MIN (zbar->roi_x, width - 1);
+  y = MIN (zbar->roi_y, height - 1);
+  w = zbar->roi_width ? MIN (zbar->roi_width, width - x) : width - x;
+  h = zbar->roi_height ? MIN (zbar->roi_height, height - y) : height - y;
+  dec = zbar->decimation;
+  GST_OBJECT_UNLOCK (zbar);
+
+  data += y * stride;
+
+  if (dec == 1 && x == 0 && w == width) {
+    /* all formats we support start with an 8-bit Y plane. zbar doesn't need
+     * to know about the chroma plane(s) */
+    zbar_image_set_size (zbar->image, stride, h);
+    zbar_image_set_data (zbar->image, data, stride * h, NULL);
+    return TRUE;
+  }
 
-  image = zbar_image_create ();
+  dw = w / dec;
+  dh = h / dec;
+  if (dw == 0 || dh == 0)
+    return FALSE;
 
-  /* all formats we support start with an 8-bit Y plane. zbar doesn't need
-   * to know about the chroma plane(s) */
-  data = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
-  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
-  height = GST_VIDEO_FRAME_HEIGHT (frame);
+  if (zbar->scratch_size < dw * dh) {
+    g_free (zbar->scratch);
+    zbar->scratch_size = dw * dh;
+    zbar->scratch = g_malloc (zbar->scratch_size);
+  }
+
+  for (j = 0; j < dh; j++) {
+    const guint8 *src = data + j * dec * stride + x;
+    guint8 *dest = zbar->scratch + j * dw;
+
+    if (dec == 1) {
+      memcpy (dest, src, dw);
+    } else {
+      for (i = 0; i < dw; i++)
+        dest[i] = src[i * dec];
+    }
+  }
 
-  zbar_image_set_format (image, GST_MAKE_FOURCC ('Y', '8', '0', '0'));
-  zbar_image_set_size (image, stride, height);
-  zbar_image_set_data (image, (gpointer) data, stride * height, NULL);
+  zbar_image_set_size (zbar->image, dw, dh);
+  zbar_image_set_data (zbar->image, zbar->scratch, dw * dh, NULL);
+
+  return TRUE;
+}
+
+static void
+gst_zbar_scan (GstZBar * zbar, GstZBarJob * job)
+{
+  const zbar_symbol_t *symbol;
+  int n;
+
+  if (!gst_zbar_prepare_image (zbar, &job->frame))
+    return;
 
   /* scan the image for barcodes */
-  n = zbar_scan_image (zbar->scanner, image);
+  n = zbar_scan_image (zbar->scanner, zbar->image);
   if (G_UNLIKELY (n == -1)) {
     GST_WARNING_OBJECT (zbar, "Error trying to scan frame. Skipping");
     goto out;
@@ -274,7 +536,7 @@ gst_zbar_transform_frame_ip (GstVideoFilter * vfilter, GstVideoFrame * frame)
     goto out;
 
   /* extract results */
-  symbol = zbar_image_first_symbol (image);
+  symbol = zbar_image_first_symbol (zbar->image);
   for (; symbol; symbol = zbar_symbol_next (symbol)) {
     zbar_symbol_type_t typ = zbar_symbol_get_type (symbol);
     const char *data = zbar_symbol_get_data (symbol);
@@ -293,14 +555,17 @@ gst_zbar_transform_frame_ip (GstVideoFilter * vfilter, GstVideoFrame * frame)
       GstCaps *sample_caps;
 
       s = gst_structure_new ("barcode",
-          "timestamp", G_TYPE_UINT64, GST_BUFFER_TIMESTAMP (frame->buffer),
+          "timestamp", G_TYPE_UINT64, job->timestamp,
+          "stream-time", G_TYPE_UINT64, job->stream_time,
+          "running-time", G_TYPE_UINT64, job->running_time,
+          "duration", G_TYPE_UINT64, job->duration,
           "type", G_TYPE_STRING, zbar_get_symbol_name (typ),
           "symbol", G_TYPE_STRING, data, "quality", G_TYPE_INT, quality, NULL);
 
       if (zbar->attach_frame) {
         /* create a sample from image */
-        sample_caps = gst_video_info_to_caps (&frame->info);
-        sample = gst_sample_new (frame->buffer, sample_caps, NULL, NULL);
+        sample_caps = gst_video_info_to_caps (&job->frame.info);
+        sample = gst_sample_new (job->frame.buffer, sample_caps, NULL, NULL);
         gst_caps_unref (sample_caps);
         gst_structure_set (s, "frame", GST_TYPE_SAMPLE, sample, NULL);
         gst_sample_unref (sample);
@@ -316,8 +581,121 @@ gst_zbar_transform_frame_ip (GstVideoFilter * vfilter, GstVideoFrame * frame)
 
 out:
   /* clean up */
-  zbar_image_scanner_recycle_image (zbar->scanner, image);
-  zbar_image_destroy (image);
+  zbar_image_scanner_recycle_image (zbar->scanner, zbar->image);
+}
+
+static void
+gst_zbar_job_free (GstZBarJob * job)
+{
+  gst_video_frame_unmap (&job->frame);
+  g_slice_free (GstZBarJob, job);
+}
+
+static gpointer
+gst_zbar_thread (gpointer user_data)
+{
+  GstZBar *zbar = user_data;
+
+  g_mutex_lock (&zbar->lock);
+  while (TRUE) {
+    GstZBarJob *job;
+
+    while (!zbar->pending && !zbar->shutdown)
+      g_cond_wait (&zbar->cond, &zbar->lock);
+    if (zbar->shutdown)
+      break;
+
+    job = zbar->pending;
+    zbar->pending = NULL;
+    zbar->busy = TRUE;
+    g_mutex_unlock (&zbar->lock);
+
+    gst_zbar_scan (zbar, job);
+    gst_zbar_job_free (job);
+
+    g_mutex_lock (&zbar->lock);
+    zbar->busy = FALSE;
+    g_cond_broadcast (&zbar->cond);
+  }
+  g_mutex_unlock (&zbar->lock);
+
+  return NULL;
+}
+
+/* drops the frame waiting for the worker, if any */
+static void
+gst_zbar_flush (GstZBar * zbar)
+{
+  g_mutex_lock (&zbar->lock);
+  if (zbar->pending) {
+    gst_zbar_job_free (zbar->pending);
+    zbar->pending = NULL;
+  }
+  g_mutex_unlock (&zbar->lock);
+}
+
+/* waits until the worker scanned all frames it was given */
+static void
+gst_zbar_drain (GstZBar * zbar)
+{
+  g_mutex_lock (&zbar->lock);
+  while ((zbar->pending || zbar->busy) && !zbar->shutdown)
+    g_cond_wait (&zbar->cond, &zbar->lock);
+  g_mutex_unlock (&zbar->lock);
+}
+
+static GstFlowReturn
+gst_zbar_transform_frame_ip (GstVideoFilter * vfilter, GstVideoFrame * frame)
+{
+  GstZBar *zbar = GST_ZBAR (vfilter);
+  GstSegment *segment = &GST_BASE_TRANSFORM (vfilter)->segment;
+  GstClockTime timestamp = GST_BUFFER_PTS (frame->buffer);
+  GstZBarJob *job;
+
+  if (zbar->scan_interval > 0 && GST_CLOCK_TIME_IS_VALID (timestamp)) {
+    if (GST_CLOCK_TIME_IS_VALID (zbar->last_scan) &&
+        timestamp >= zbar->last_scan &&
+        timestamp - zbar->last_scan < zbar->scan_interval)
+      return GST_FLOW_OK;
+    zbar->last_scan = timestamp;
+  }
+
+  if (zbar->async) {
+    job = g_slice_new (GstZBarJob);
+    /* keeps a reference to the buffer until the worker is done with it */
+    if (!gst_video_frame_map (&job->frame, &frame->info, frame->buffer,
+            GST_MAP_READ)) {
+      GST_WARNING_OBJECT (zbar, "Failed to map frame. Skipping");
+      g_slice_free (GstZBarJob, job);
+      return GST_FLOW_OK;
+    }
+  } else {
+    job = g_newa (GstZBarJob, 1);
+    job->frame = *frame;
+  }
+
+  job->timestamp = timestamp;
+  job->stream_time = gst_segment_to_stream_time (segment, GST_FORMAT_TIME,
+      timestamp);
+  job->running_time = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+      timestamp);
+  job->duration = GST_BUFFER_DURATION (frame->buffer);
+
+  if (!zbar->async) {
+    gst_zbar_scan (zbar, job);
+    return GST_FLOW_OK;
+  }
+
+  g_mutex_lock (&zbar->lock);
+  if (zbar->pending) {
+    zbar->dropped++;
+    GST_LOG_OBJECT (zbar, "worker busy, skipping frame (%" G_GUINT64_FORMAT
+        " skipped)", zbar->dropped);
+    gst_zbar_job_free (zbar->pending);
+  }
+  zbar->pending = job;
+  g_cond_signal (&zbar->cond);
+  g_mutex_unlock (&zbar->lock);
 
   return GST_FLOW_OK;
 }
@@ -330,6 +708,14 @@ gst_zbar_start (GstBaseTransform * base)
   /* start the cache if enabled (e.g. for filtering dupes) */
   zbar_image_scanner_enable_cache (zbar->scanner, zbar->cache);
 
+  zbar->last_scan = GST_CLOCK_TIME_NONE;
+  zbar->dropped = 0;
+
+  if (zbar->async) {
+    zbar->shutdown = FALSE;
+    zbar->thread = g_thread_new ("zbar", gst_zbar_thread, zbar);
+  }
+
   return TRUE;
 }
 
@@ -338,12 +724,49 @@ gst_zbar_stop (GstBaseTransform * base)
 {
   GstZBar *zbar = GST_ZBAR (base);
 
+  if (zbar->thread) {
+    g_mutex_lock (&zbar->lock);
+    zbar->shutdown = TRUE;
+    g_cond_broadcast (&zbar->cond);
+    g_mutex_unlock (&zbar->lock);
+
+    g_thread_join (zbar->thread);
+    zbar->thread = NULL;
+    gst_zbar_flush (zbar);
+
+    GST_DEBUG_OBJECT (zbar, "skipped %" G_GUINT64_FORMAT " frames while the "
+        "worker was busy", zbar->dropped);
+  }
+
   /* stop the cache if enabled (e.g. for filtering dupes) */
   zbar_image_scanner_enable_cache (zbar->scanner, zbar->cache);
 
   return TRUE;
 }
 
+static gboolean
+gst_zbar_sink_event (GstBaseTransform * base, GstEvent * event)
+{
+  GstZBar *zbar = GST_ZBAR (base);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      gst_zbar_flush (zbar);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      zbar->last_scan = GST_CLOCK_TIME_NONE;
+      break;
+    case GST_EVENT_EOS:
+      /* post the results of the last frames before the EOS */
+      gst_zbar_drain (zbar);
+      break;
+    default:
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (base, event);
+}
+
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
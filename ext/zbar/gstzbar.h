@@ -55,9 +55,26 @@ struct _GstZBar
   gboolean message;
   gboolean attach_frame;
   gboolean cache;
+  gboolean async;
+  GstClockTime scan_interval;
+  guint decimation;
+  guint roi_x, roi_y, roi_width, roi_height;
 
   /* internals */
   zbar_image_scanner_t *scanner;
+  zbar_image_t *image;
+  guint8 *scratch;
+  gsize scratch_size;
+  GstClockTime last_scan;
+
+  /* worker thread for async mode, protected by lock */
+  GThread *thread;
+  GMutex lock;
+  GCond cond;
+  gpointer pending;
+  gboolean busy;
+  gboolean shutdown;
+  guint64 dropped;
 };
 
 struct _GstZBarClass
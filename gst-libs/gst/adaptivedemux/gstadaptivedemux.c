@@ -122,6 +122,8 @@ that the demux object and its streams are not changed by anybody else.
 #include "gstadaptivedemux.h"
 #include "gst/gst-i18n-plugin.h"
 #include <gst/base/gstadapter.h>
+#include <gst/uridownloader/gstfragmentcache.h>
+#include <math.h>
 
 GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define GST_CAT_DEFAULT adaptivedemux_debug
@@ -136,6 +138,25 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_BITRATE_LIMIT 0.8f
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
 #define NUM_LOOKBACK_FRAGMENTS 3
+#define DEFAULT_PREFETCH_DEPTH 0
+#define MAX_PREFETCH_DEPTH 16
+#define DEFAULT_ABR_ALGORITHM GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE
+#define DEFAULT_FRAGMENT_CACHE FALSE
+#define DEFAULT_STARTUP_BITRATE 0
+/* number of fragments the startup-bitrate ramp-up applies to */
+#define STARTUP_FRAGMENTS 2
+
+/* half-lives (in seconds of download time) of the ABR estimates */
+#define ABR_FAST_HALF_LIFE 2.0
+#define ABR_SLOW_HALF_LIFE 5.0
+/* buffer levels between which the buffer-based algorithm goes from being
+ * conservative to using more than the measured bandwidth */
+#define ABR_BUFFER_RESERVOIR (4 * GST_SECOND)
+#define ABR_BUFFER_CUSHION (16 * GST_SECOND)
+#define ABR_BUFFER_MIN_FACTOR 0.5
+#define ABR_BUFFER_MAX_FACTOR 1.2
+/* relative change of the estimate needed to report a new bitrate */
+#define ABR_SWITCH_THRESHOLD 0.15
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -162,9 +183,21 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_DEPTH,
+  PROP_ABR_ALGORITHM,
+  PROP_FRAGMENT_CACHE,
+  PROP_STARTUP_BITRATE,
   PROP_LAST
 };
 
+enum
+{
+  SIGNAL_SELECT_BITRATE,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
 /* Internal, so not using GST_FLOW_CUSTOM_SUCCESS_N */
 #define GST_ADAPTIVE_DEMUX_FLOW_SWITCH (GST_FLOW_CUSTOM_SUCCESS_2 + 1)
 
@@ -184,6 +217,10 @@ struct _GstAdaptiveDemuxPrivate
   /* used only from updates_task, no need to protect it */
   gint update_failed_count;
 
+  /* validators of the last manifest download, protected by manifest_lock */
+  gchar *manifest_entity_tag;
+  gchar *manifest_last_modified;
+
   guint32 segment_seqnum;       /* protected by manifest_lock */
 
   /* main lock used to protect adaptive demux and all its streams.
@@ -210,8 +247,50 @@ struct _GstAdaptiveDemuxPrivate
    * without needing to stop tasks when they just want to
    * update the segment boundaries */
   GMutex segment_lock;
+
+  /* number of fragments downloaded ahead of the current one */
+  guint prefetch_depth;         /* protected by manifest_lock */
+  GThreadPool *prefetch_pool;   /* MT safe */
+
+  GstAdaptiveDemuxAbrAlgorithm abr_algorithm;   /* protected by manifest_lock */
+
+  gboolean fragment_cache;      /* protected by manifest_lock */
+
+  guint64 startup_bitrate;      /* protected by manifest_lock */
+
+  /* headers and first fragments of the next period, downloaded while the
+   * current one ends. Protected by manifest_lock */
+  GQueue period_prefetch;
+  gboolean period_prefetched;
+  /* protected by period_prefetch_lock */
+  GList *period_prefetch_active;
+  GMutex period_prefetch_lock;
+  GCond period_prefetch_cond;
 };
 
+/* A fragment downloaded ahead of time by the prefetch_pool. Owned by the
+ * stream's prefetch_queue or the demuxer's period_prefetch queue, or by the
+ * pool thread once abandoned */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  /* the prefetch_lock, prefetch_cond and prefetch_active of the stream, or
+   * their period_prefetch counterparts of the demuxer */
+  GMutex *lock;
+  GCond *cond;
+  GList **active;
+  GstUriDownloader *downloader;
+
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+  gboolean use_cache;
+
+  /* protected by lock */
+  GstFragment *download;
+  gboolean done;
+  gboolean abandoned;
+} GstAdaptiveDemuxPrefetch;
+
 typedef struct _GstAdaptiveDemuxTimer
 {
   volatile gint ref_count;
@@ -307,6 +386,16 @@ static gboolean gst_adaptive_demux_clock_callback (GstClock * clock,
 static gboolean
 gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
     * demux);
+static void gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch *
+    prefetch, GstAdaptiveDemux * demux);
+static void gst_adaptive_demux_stream_cancel_prefetch (GstAdaptiveDemuxStream *
+    stream);
+static void gst_adaptive_demux_stream_clear_prefetch (GstAdaptiveDemuxStream *
+    stream);
+static void gst_adaptive_demux_cancel_period_prefetch (GstAdaptiveDemux *
+    demux);
+static void gst_adaptive_demux_clear_period_prefetch (GstAdaptiveDemux *
+    demux);
 
 /* we can't use G_DEFINE_ABSTRACT_TYPE because we need the klass in the _init
  * method to get to the padtemplates */
@@ -336,6 +425,31 @@ gst_adaptive_demux_get_type (void)
   return type;
 }
 
+GType
+gst_adaptive_demux_abr_algorithm_get_type (void)
+{
+  static volatile gsize type = 0;
+
+  if (g_once_init_enter (&type)) {
+    static const GEnumValue values[] = {
+      {GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+          "Smallest of the last and average fragment bitrates",
+          "moving-average"},
+      {GST_ADAPTIVE_DEMUX_ABR_EWMA,
+          "Exponentially weighted moving averages of the bitrate", "ewma"},
+      {GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED,
+          "EWMA bitrate scaled by the downstream buffer level",
+          "buffer-based"},
+      {0, NULL, NULL}
+    };
+    GType _type;
+
+    _type = g_enum_register_static ("GstAdaptiveDemuxAbrAlgorithm", values);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
 static void
 gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -354,6 +468,18 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_DEPTH:
+      demux->priv->prefetch_depth = g_value_get_uint (value);
+      break;
+    case PROP_ABR_ALGORITHM:
+      demux->priv->abr_algorithm = g_value_get_enum (value);
+      break;
+    case PROP_FRAGMENT_CACHE:
+      demux->priv->fragment_cache = g_value_get_boolean (value);
+      break;
+    case PROP_STARTUP_BITRATE:
+      demux->priv->startup_bitrate = (guint64) g_value_get_uint (value) * 1000;
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -378,6 +504,18 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_DEPTH:
+      g_value_set_uint (value, demux->priv->prefetch_depth);
+      break;
+    case PROP_ABR_ALGORITHM:
+      g_value_set_enum (value, demux->priv->abr_algorithm);
+      break;
+    case PROP_FRAGMENT_CACHE:
+      g_value_set_boolean (value, demux->priv->fragment_cache);
+      break;
+    case PROP_STARTUP_BITRATE:
+      g_value_set_uint (value, demux->priv->startup_bitrate / 1000);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -421,6 +559,97 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAdaptiveDemux:prefetch-depth:
+   *
+   * Number of fragments to request ahead of the one currently downloaded.
+   * They are downloaded in parallel and pushed in order once the download
+   * loop gets to them, which hides the request latency on links with a
+   * high round trip time. Only used when the subclass can tell the next
+   * fragments in advance, and in normal rate playback.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_DEPTH,
+      g_param_spec_uint ("prefetch-depth", "Prefetch depth",
+          "Number of fragments to download ahead of the current one "
+          "(0 = disabled)", 0, MAX_PREFETCH_DEPTH, DEFAULT_PREFETCH_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:abr-algorithm:
+   *
+   * Algorithm estimating the bitrate the next fragments are selected for.
+   * The estimate is scaled by the #GstAdaptiveDemux:bitrate-limit and can
+   * be overridden by the #GstAdaptiveDemux::select-bitrate signal.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ABR_ALGORITHM,
+      g_param_spec_enum ("abr-algorithm", "ABR algorithm",
+          "Algorithm used to select the bitrate of the alternates",
+          GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM, DEFAULT_ABR_ALGORITHM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:fragment-cache:
+   *
+   * Share the downloaded fragments, headers and indexes with the other
+   * demuxers of the process through the default #GstFragmentCache. Several
+   * demuxers playing the same stream then only download it once. See
+   * gst_fragment_cache_get_default() for its size limits.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FRAGMENT_CACHE,
+      g_param_spec_boolean ("fragment-cache", "Fragment cache",
+          "Share the downloaded fragments with the other demuxers of the "
+          "process", DEFAULT_FRAGMENT_CACHE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:startup-bitrate:
+   *
+   * Bitrate, in kbps, the first fragments are selected for when
+   * #GstAdaptiveDemux:connection-speed is not set. A low value gets the
+   * first frame out quickly on an unknown network. The throughput measured
+   * on the headers and the first fragments is then used as-is to switch up
+   * at the next fragment boundaries, without the usual smoothing.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_STARTUP_BITRATE,
+      g_param_spec_uint ("startup-bitrate", "Startup bitrate",
+          "Bitrate in kbps to select the first fragments for (0 = let the "
+          "subclass choose)", 0, G_MAXUINT / 1000, DEFAULT_STARTUP_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux::select-bitrate:
+   * @demux: the #GstAdaptiveDemux
+   * @pad: the source pad of the stream
+   * @bitrate: the bitrate estimated by the #GstAdaptiveDemux:abr-algorithm,
+   *     in bits per second
+   * @last_bitrate: the download bitrate of the last fragment
+   * @buffer_level: the duration of the data queued downstream of @pad, or
+   *     %GST_CLOCK_TIME_NONE if unknown
+   *
+   * Emitted from the streaming thread after each fragment, before the
+   * next one is selected. Can be used to implement a custom adaptive
+   * bitrate algorithm. Only the first connected handler is called and must
+   * not block.
+   *
+   * Returns: the bitrate to select the next fragments for, in bits per
+   *     second, or 0 to keep @bitrate
+   *
+   * Since: 1.16
+   */
+  signals[SIGNAL_SELECT_BITRATE] =
+      g_signal_new ("select-bitrate", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST, 0, g_signal_accumulator_first_wins, NULL, NULL,
+      G_TYPE_UINT64, 4, GST_TYPE_PAD, G_TYPE_UINT64, G_TYPE_UINT64,
+      G_TYPE_UINT64);
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
@@ -500,6 +729,14 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   g_cond_init (&demux->priv->preroll_cond);
   g_mutex_init (&demux->priv->preroll_lock);
 
+  demux->priv->prefetch_depth = DEFAULT_PREFETCH_DEPTH;
+  g_queue_init (&demux->priv->period_prefetch);
+  g_mutex_init (&demux->priv->period_prefetch_lock);
+  g_cond_init (&demux->priv->period_prefetch_cond);
+  demux->priv->prefetch_pool =
+      g_thread_pool_new ((GFunc) gst_adaptive_demux_prefetch_func, demux, -1,
+      FALSE, NULL);
+
   pad_template =
       gst_element_class_get_pad_template (GST_ELEMENT_CLASS (klass), "sink");
   g_return_if_fail (pad_template != NULL);
@@ -512,6 +749,9 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
 
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
+  demux->priv->abr_algorithm = DEFAULT_ABR_ALGORITHM;
+  demux->priv->fragment_cache = DEFAULT_FRAGMENT_CACHE;
+  demux->priv->startup_bitrate = DEFAULT_STARTUP_BITRATE;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
@@ -525,6 +765,11 @@ gst_adaptive_demux_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (object, "finalize");
 
+  /* the streams cancelled their prefetches when they were freed */
+  gst_adaptive_demux_clear_period_prefetch (demux);
+  g_thread_pool_free (priv->prefetch_pool, FALSE, TRUE);
+  g_mutex_clear (&priv->period_prefetch_lock);
+  g_cond_clear (&priv->period_prefetch_cond);
   g_object_unref (priv->input_adapter);
   g_object_unref (demux->downloader);
 
@@ -818,6 +1063,10 @@ gst_adaptive_demux_reset (GstAdaptiveDemux * demux)
   g_free (demux->manifest_base_uri);
   demux->manifest_uri = NULL;
   demux->manifest_base_uri = NULL;
+  g_free (demux->priv->manifest_entity_tag);
+  g_free (demux->priv->manifest_last_modified);
+  demux->priv->manifest_entity_tag = NULL;
+  demux->priv->manifest_last_modified = NULL;
 
   gst_adapter_clear (demux->priv->input_adapter);
   demux->priv->have_manifest = FALSE;
@@ -1324,6 +1573,9 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
   gst_segment_init (&stream->segment, GST_FORMAT_TIME);
   g_cond_init (&stream->fragment_download_cond);
   g_mutex_init (&stream->fragment_download_lock);
+  g_queue_init (&stream->prefetch_queue);
+  g_cond_init (&stream->prefetch_cond);
+  g_mutex_init (&stream->prefetch_lock);
 
   demux->next_streams = g_list_append (demux->next_streams, stream);
 
@@ -1390,6 +1642,14 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
 
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
+  /* the abandoned prefetches still point to the stream, wait for their
+   * (cancelled) downloads to return */
+  gst_adaptive_demux_stream_clear_prefetch (stream);
+  g_mutex_lock (&stream->prefetch_lock);
+  while (stream->prefetch_active)
+    g_cond_wait (&stream->prefetch_cond, &stream->prefetch_lock);
+  g_mutex_unlock (&stream->prefetch_lock);
+
   if (stream->pending_segment) {
     gst_event_unref (stream->pending_segment);
     stream->pending_segment = NULL;
@@ -1423,6 +1683,8 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
 
   g_cond_clear (&stream->fragment_download_cond);
   g_mutex_clear (&stream->fragment_download_lock);
+  g_cond_clear (&stream->prefetch_cond);
+  g_mutex_clear (&stream->prefetch_lock);
   g_free (stream->fragment_bitrates);
 
   if (stream->pad) {
@@ -2090,9 +2352,13 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       gst_task_stop (stream->download_task);
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+
+      /* wakes up the download loop if it waits for a prefetch */
+      gst_adaptive_demux_stream_cancel_prefetch (stream);
     }
     list_to_process = demux->prepared_streams;
   }
+  gst_adaptive_demux_cancel_period_prefetch (demux);
 
   GST_MANIFEST_UNLOCK (demux);
   g_mutex_lock (&demux->priv->preroll_lock);
@@ -2146,9 +2412,14 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       stream->download_error_count = 0;
       stream->need_header = TRUE;
       stream->qos_earliest_time = GST_CLOCK_TIME_NONE;
+      gst_adaptive_demux_stream_clear_prefetch (stream);
     }
     list_to_process = demux->prepared_streams;
   }
+
+  /* made for the position the tasks stopped at */
+  gst_adaptive_demux_clear_period_prefetch (demux);
+  demux->priv->period_prefetched = FALSE;
 }
 
 /* must be called with manifest_lock taken */
@@ -2217,6 +2488,81 @@ _update_average_bitrate (GstAdaptiveDemux * demux,
   return stream->moving_bitrate / stream->moving_index;
 }
 
+static gdouble
+_ewma_update (gdouble estimate, gdouble half_life, gdouble weight,
+    gdouble value)
+{
+  gdouble alpha = pow (0.5, weight / half_life);
+
+  return value * (1.0 - alpha) + estimate * alpha;
+}
+
+/* Returns the smallest of a fast and a slow moving estimate: quick to go
+ * down when the bandwidth drops and slow to go up. The samples are weighted
+ * by their download time so that small fragments downloaded from a cache
+ * don't inflate the estimate.
+ *
+ * must be called with manifest_lock taken */
+static guint64
+_update_ewma_bitrate (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, guint64 new_bitrate)
+{
+  gdouble weight, fast, slow;
+
+  if (new_bitrate != 0) {
+    if (GST_CLOCK_TIME_IS_VALID (stream->last_download_time)
+        && stream->last_download_time != 0)
+      weight = (gdouble) stream->last_download_time / GST_SECOND;
+    else
+      weight = 1.0;
+
+    stream->abr_fast_estimate = _ewma_update (stream->abr_fast_estimate,
+        ABR_FAST_HALF_LIFE, weight, new_bitrate);
+    stream->abr_slow_estimate = _ewma_update (stream->abr_slow_estimate,
+        ABR_SLOW_HALF_LIFE, weight, new_bitrate);
+    stream->abr_total_weight += weight;
+  }
+
+  if (stream->abr_total_weight == 0)
+    return new_bitrate;
+
+  /* the estimates start from 0, correct that bias */
+  fast = stream->abr_fast_estimate / (1.0 - pow (0.5,
+          stream->abr_total_weight / ABR_FAST_HALF_LIFE));
+  slow = stream->abr_slow_estimate / (1.0 - pow (0.5,
+          stream->abr_total_weight / ABR_SLOW_HALF_LIFE));
+
+  return (guint64) MIN (fast, slow);
+}
+
+/* Returns how far ahead of the downstream position data was pushed on the
+ * stream, or GST_CLOCK_TIME_NONE if downstream can't tell.
+ *
+ * must be called with manifest_lock taken */
+static GstClockTime
+gst_adaptive_demux_stream_get_buffer_level (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstClockTime pushed;
+  gint64 position;
+
+  if (!GST_CLOCK_TIME_IS_VALID (stream->segment.position))
+    return GST_CLOCK_TIME_NONE;
+
+  if (!gst_pad_peer_query_position (stream->pad, GST_FORMAT_TIME, &position)
+      || position < 0)
+    return GST_CLOCK_TIME_NONE;
+
+  pushed = gst_segment_to_stream_time (&stream->segment, GST_FORMAT_TIME,
+      stream->segment.position);
+  if (!GST_CLOCK_TIME_IS_VALID (pushed))
+    return GST_CLOCK_TIME_NONE;
+
+  if (demux->segment.rate < 0)
+    return position > pushed ? position - pushed : 0;
+  return pushed > position ? pushed - position : 0;
+}
+
 /* must be called with manifest_lock taken */
 static guint64
 gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
@@ -2224,6 +2570,10 @@ gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
 {
   guint64 average_bitrate;
   guint64 fragment_bitrate;
+  guint64 bitrate;
+  GstClockTime buffer_level = GST_CLOCK_TIME_NONE;
+  gboolean has_handler;
+  gboolean startup;
 
   if (demux->connection_speed) {
     GST_LOG_OBJECT (demux, "Connection-speed is set to %u kbps, using it",
@@ -2235,6 +2585,18 @@ gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
   GST_DEBUG_OBJECT (demux, "Download bitrate is : %" G_GUINT64_FORMAT " bps",
       fragment_bitrate);
 
+  /* The first fragments were selected for the startup bitrate and are
+   * small, measure over everything downloaded so far, headers included */
+  startup = demux->priv->startup_bitrate != 0
+      && stream->moving_index < STARTUP_FRAGMENTS;
+  if (startup && stream->startup_download_time > 0) {
+    fragment_bitrate = gst_util_uint64_scale (stream->startup_bytes,
+        8 * GST_SECOND, stream->startup_download_time);
+    GST_DEBUG_OBJECT (stream, "Startup bitrate is %" G_GUINT64_FORMAT
+        " bps (%" G_GUINT64_FORMAT " bytes)", fragment_bitrate,
+        stream->startup_bytes);
+  }
+
   average_bitrate = _update_average_bitrate (demux, stream, fragment_bitrate);
 
   GST_INFO_OBJECT (stream, "last fragment bitrate was %" G_GUINT64_FORMAT,
@@ -2243,13 +2605,80 @@ gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
       "Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
       NUM_LOOKBACK_FRAGMENTS, average_bitrate);
 
-  /* Conservative approach, make sure we don't upgrade too fast */
-  stream->current_download_rate = MIN (average_bitrate, fragment_bitrate);
+  has_handler = g_signal_has_handler_pending (demux,
+      signals[SIGNAL_SELECT_BITRATE], 0, FALSE);
+  if (has_handler
+      || demux->priv->abr_algorithm == GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED) {
+    buffer_level = gst_adaptive_demux_stream_get_buffer_level (demux, stream);
+    GST_DEBUG_OBJECT (stream, "Buffer level is %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (buffer_level));
+  }
+
+  switch (demux->priv->abr_algorithm) {
+    case GST_ADAPTIVE_DEMUX_ABR_EWMA:
+    case GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED:
+      bitrate = _update_ewma_bitrate (demux, stream, fragment_bitrate);
+      GST_INFO_OBJECT (stream, "EWMA bitrate is %" G_GUINT64_FORMAT, bitrate);
+
+      /* Use less than the bandwidth while the buffer is low to fill it up,
+       * and more once it's comfortable, as the buffer absorbs the
+       * fragments downloading slower than realtime */
+      if (demux->priv->abr_algorithm == GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED
+          && GST_CLOCK_TIME_IS_VALID (buffer_level)) {
+        gdouble level, factor;
+
+        level = (gdouble) (CLAMP (buffer_level, ABR_BUFFER_RESERVOIR,
+                ABR_BUFFER_CUSHION) - ABR_BUFFER_RESERVOIR) /
+            (ABR_BUFFER_CUSHION - ABR_BUFFER_RESERVOIR);
+        factor = ABR_BUFFER_MIN_FACTOR +
+            (ABR_BUFFER_MAX_FACTOR - ABR_BUFFER_MIN_FACTOR) * level;
+        bitrate *= factor;
+        GST_INFO_OBJECT (stream, "Bitrate after buffer factor (%0.2f): %"
+            G_GUINT64_FORMAT, factor, bitrate);
+      }
+
+      /* Don't switch on small variations of the estimate */
+      if (stream->abr_last_bitrate != 0 && bitrate != 0) {
+        gdouble change = (gdouble) bitrate / stream->abr_last_bitrate;
 
-  stream->current_download_rate *= demux->bitrate_limit;
+        if (change > 1.0 - ABR_SWITCH_THRESHOLD
+            && change < 1.0 + ABR_SWITCH_THRESHOLD)
+          bitrate = stream->abr_last_bitrate;
+      }
+      stream->abr_last_bitrate = bitrate;
+      break;
+    case GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE:
+    default:
+      /* Conservative approach, make sure we don't upgrade too fast */
+      bitrate = MIN (average_bitrate, fragment_bitrate);
+      break;
+  }
+
+  /* Switch up right away instead of waiting for the averages to catch up */
+  if (startup && fragment_bitrate != 0) {
+    bitrate = fragment_bitrate;
+    stream->abr_last_bitrate = bitrate;
+    GST_INFO_OBJECT (stream, "Using startup bitrate %" G_GUINT64_FORMAT,
+        bitrate);
+  }
+
+  stream->current_download_rate = bitrate * demux->bitrate_limit;
   GST_DEBUG_OBJECT (demux, "Bitrate after bitrate limit (%0.2f): %"
       G_GUINT64_FORMAT, demux->bitrate_limit, stream->current_download_rate);
 
+  if (has_handler) {
+    guint64 selected = 0;
+
+    g_signal_emit (demux, signals[SIGNAL_SELECT_BITRATE], 0, stream->pad,
+        stream->current_download_rate, fragment_bitrate, buffer_level,
+        &selected);
+    if (selected != 0) {
+      GST_DEBUG_OBJECT (stream, "Application selected bitrate %"
+          G_GUINT64_FORMAT, selected);
+      stream->current_download_rate = selected;
+    }
+  }
+
 #if 0
   /* Debugging code, modulate the bitrate every few fragments */
   {
@@ -2790,6 +3219,10 @@ _uri_handler_probe (GstPad * pad, GstPadProbeInfo * info,
           GST_TIME_ARGS (stream->last_latency));
     }
     stream->fragment_bytes_downloaded += gst_buffer_get_size (buf);
+    g_mutex_lock (&stream->fragment_download_lock);
+    if (stream->cache_data)
+      gst_buffer_list_add (stream->cache_data, gst_buffer_ref (buf));
+    g_mutex_unlock (&stream->fragment_download_lock);
     GST_LOG_OBJECT (pad,
         "Received buffer, size %" G_GSIZE_FORMAT " total %" G_GUINT64_FORMAT,
         gst_buffer_get_size (buf), stream->fragment_bytes_downloaded);
@@ -2810,6 +3243,10 @@ _uri_handler_probe (GstPad * pad, GstPadProbeInfo * info,
         stream->last_bitrate =
             gst_util_uint64_scale (stream->fragment_bytes_downloaded,
             8 * GST_SECOND, stream->last_download_time);
+        if (stream->moving_index < STARTUP_FRAGMENTS) {
+          stream->startup_bytes += stream->fragment_bytes_downloaded;
+          stream->startup_download_time += stream->last_download_time;
+        }
         GST_DEBUG_OBJECT (pad,
             "EOS since download_start %" GST_TIME_FORMAT " bitrate %"
             G_GUINT64_FORMAT " bps", GST_TIME_ARGS (stream->last_download_time),
@@ -3114,7 +3551,7 @@ uritype (GstAdaptiveDemuxStream * s)
  * Will return when URI is fully downloaded (or aborted/errored)
  */
 static GstFlowReturn
-gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
+gst_adaptive_demux_stream_fetch_uri (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream, const gchar * uri, gint64 start,
     gint64 end, guint * http_status)
 {
@@ -3271,6 +3708,579 @@ gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
   return ret;
 }
 
+static void
+gst_adaptive_demux_prefetch_free (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_object_unref (prefetch->downloader);
+  if (prefetch->download)
+    g_object_unref (prefetch->download);
+  g_free (prefetch->uri);
+  g_slice_free (GstAdaptiveDemuxPrefetch, prefetch);
+}
+
+static void
+gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch * prefetch,
+    GstAdaptiveDemux * demux)
+{
+  GstFragment *download;
+  gint64 range_end = prefetch->range_end;
+  gboolean abandoned, reserved = FALSE;
+
+  /* HTTP ranges are inclusive, GStreamer segments are exclusive for the
+   * stop position */
+  if (range_end != -1)
+    range_end += 1;
+
+  if (prefetch->use_cache) {
+    GstBuffer *buffer =
+        gst_fragment_cache_lookup_or_reserve (gst_fragment_cache_get_default
+        (), prefetch->uri, prefetch->range_start, prefetch->range_end,
+        &reserved);
+
+    if (buffer) {
+      download = gst_fragment_new ();
+      gst_fragment_add_buffer (download, buffer);
+      download->completed = TRUE;
+      goto done;
+    }
+  }
+
+  download = gst_uri_downloader_fetch_uri_with_range (prefetch->downloader,
+      prefetch->uri, NULL, FALSE, FALSE, TRUE, prefetch->range_start,
+      range_end, NULL);
+
+  if (download && prefetch->use_cache) {
+    GstBuffer *buffer = gst_fragment_get_buffer (download);
+
+    if (buffer) {
+      gst_fragment_cache_insert (gst_fragment_cache_get_default (),
+          prefetch->uri, prefetch->range_start, prefetch->range_end, buffer);
+      gst_buffer_unref (buffer);
+      reserved = FALSE;
+    }
+  }
+  if (reserved)
+    gst_fragment_cache_release (gst_fragment_cache_get_default (),
+        prefetch->uri, prefetch->range_start, prefetch->range_end);
+
+done:
+
+  GST_LOG_OBJECT (demux, "Prefetch of %s %s", prefetch->uri,
+      download ? "done" : "failed");
+
+  g_mutex_lock (prefetch->lock);
+  *prefetch->active = g_list_remove (*prefetch->active, prefetch);
+  abandoned = prefetch->abandoned;
+  if (!abandoned) {
+    prefetch->download = download;
+    prefetch->done = TRUE;
+  }
+  g_cond_broadcast (prefetch->cond);
+  g_mutex_unlock (prefetch->lock);
+
+  /* nobody else knows about it anymore, the stream might be gone already */
+  if (abandoned) {
+    if (download)
+      g_object_unref (download);
+    gst_adaptive_demux_prefetch_free (prefetch);
+  }
+}
+
+/* must be called with manifest_lock taken */
+static void
+gst_adaptive_demux_prefetch_abandon (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  gboolean done;
+
+  g_mutex_lock (prefetch->lock);
+  done = prefetch->done;
+  prefetch->abandoned = TRUE;
+  if (!done)
+    gst_uri_downloader_cancel (prefetch->downloader);
+  g_mutex_unlock (prefetch->lock);
+
+  if (done)
+    gst_adaptive_demux_prefetch_free (prefetch);
+}
+
+static gboolean
+gst_adaptive_demux_prefetch_matches (GstAdaptiveDemuxPrefetch * prefetch,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  return g_strcmp0 (prefetch->uri, uri) == 0 &&
+      prefetch->range_start == range_start && prefetch->range_end == range_end;
+}
+
+/* must be called with manifest_lock taken.
+ * Starts the download of @uri in the prefetch_pool. The new prefetch is added
+ * to @active while it runs */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_start (GstAdaptiveDemux * demux,
+    const gchar * uri, gint64 range_start, gint64 range_end, GMutex * lock,
+    GCond * cond, GList ** active)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  prefetch = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+  prefetch->lock = lock;
+  prefetch->cond = cond;
+  prefetch->active = active;
+  prefetch->downloader = gst_uri_downloader_new ();
+  gst_uri_downloader_set_parent (prefetch->downloader,
+      GST_ELEMENT_CAST (demux));
+  prefetch->uri = g_strdup (uri);
+  prefetch->range_start = range_start;
+  prefetch->range_end = range_end;
+  prefetch->use_cache = demux->priv->fragment_cache;
+
+  g_mutex_lock (lock);
+  *active = g_list_prepend (*active, prefetch);
+  g_mutex_unlock (lock);
+
+  g_thread_pool_push (demux->priv->prefetch_pool, prefetch, NULL);
+
+  return prefetch;
+}
+
+/* MT safe. Makes the ongoing prefetch downloads of @stream return */
+static void
+gst_adaptive_demux_stream_cancel_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GList *iter;
+
+  g_mutex_lock (&stream->prefetch_lock);
+  for (iter = stream->prefetch_active; iter; iter = g_list_next (iter)) {
+    GstAdaptiveDemuxPrefetch *prefetch = iter->data;
+
+    gst_uri_downloader_cancel (prefetch->downloader);
+  }
+  g_mutex_unlock (&stream->prefetch_lock);
+}
+
+/* must be called with manifest_lock taken */
+static void
+gst_adaptive_demux_stream_clear_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  if (!g_queue_is_empty (&stream->prefetch_queue))
+    GST_DEBUG_OBJECT (stream->pad, "Dropping %u prefetched fragments",
+        g_queue_get_length (&stream->prefetch_queue));
+
+  while ((prefetch = g_queue_pop_head (&stream->prefetch_queue)))
+    gst_adaptive_demux_prefetch_abandon (prefetch);
+}
+
+/* must be called with manifest_lock taken.
+ * Returns the prefetch of the current fragment if there is one. The queue
+ * is dropped if it doesn't start with the current fragment, it was made
+ * for another position */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_stream_take_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  prefetch = g_queue_peek_head (&stream->prefetch_queue);
+  if (prefetch == NULL)
+    return NULL;
+
+  if (gst_adaptive_demux_prefetch_matches (prefetch, stream->fragment.uri,
+          stream->fragment.range_start, stream->fragment.range_end))
+    return g_queue_pop_head (&stream->prefetch_queue);
+
+  gst_adaptive_demux_stream_clear_prefetch (stream);
+  return NULL;
+}
+
+/* must be called with manifest_lock taken.
+ * Makes the prefetch queue hold the prefetch-depth fragments following the
+ * current one, keeping the downloads already started for them */
+static void
+gst_adaptive_demux_stream_update_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  guint i, depth = demux->priv->prefetch_depth, kept = 0;
+
+  if (!klass->stream_peek_fragment || demux->segment.rate != 1.0)
+    depth = 0;
+
+  for (i = 1; i <= depth; i++) {
+    GstAdaptiveDemuxStreamFragment fragment = { 0, };
+    GstAdaptiveDemuxPrefetch *prefetch;
+
+    if (!klass->stream_peek_fragment (stream, i, &fragment) ||
+        fragment.uri == NULL) {
+      gst_adaptive_demux_stream_fragment_clear (&fragment);
+      break;
+    }
+
+    prefetch = g_queue_peek_nth (&stream->prefetch_queue, kept);
+    if (prefetch && gst_adaptive_demux_prefetch_matches (prefetch,
+            fragment.uri, fragment.range_start, fragment.range_end)) {
+      gst_adaptive_demux_stream_fragment_clear (&fragment);
+      kept++;
+      continue;
+    }
+
+    while (g_queue_get_length (&stream->prefetch_queue) > kept)
+      gst_adaptive_demux_prefetch_abandon (g_queue_pop_tail
+          (&stream->prefetch_queue));
+
+    GST_DEBUG_OBJECT (stream->pad, "Prefetching %s %" G_GINT64_FORMAT "-%"
+        G_GINT64_FORMAT, fragment.uri, fragment.range_start,
+        fragment.range_end);
+
+    prefetch = gst_adaptive_demux_prefetch_start (demux, fragment.uri,
+        fragment.range_start, fragment.range_end, &stream->prefetch_lock,
+        &stream->prefetch_cond, &stream->prefetch_active);
+    gst_adaptive_demux_stream_fragment_clear (&fragment);
+
+    g_queue_push_tail (&stream->prefetch_queue, prefetch);
+    kept++;
+  }
+
+  while (g_queue_get_length (&stream->prefetch_queue) > kept)
+    gst_adaptive_demux_prefetch_abandon (g_queue_pop_tail
+        (&stream->prefetch_queue));
+}
+
+/* MT safe. Makes the ongoing downloads of the next period return */
+static void
+gst_adaptive_demux_cancel_period_prefetch (GstAdaptiveDemux * demux)
+{
+  GList *iter;
+
+  g_mutex_lock (&demux->priv->period_prefetch_lock);
+  for (iter = demux->priv->period_prefetch_active; iter;
+      iter = g_list_next (iter)) {
+    GstAdaptiveDemuxPrefetch *prefetch = iter->data;
+
+    gst_uri_downloader_cancel (prefetch->downloader);
+  }
+  g_mutex_unlock (&demux->priv->period_prefetch_lock);
+}
+
+/* must be called with manifest_lock taken */
+static void
+gst_adaptive_demux_clear_period_prefetch (GstAdaptiveDemux * demux)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  while ((prefetch = g_queue_pop_head (&demux->priv->period_prefetch)))
+    gst_adaptive_demux_prefetch_abandon (prefetch);
+}
+
+/* must be called with manifest_lock taken */
+static void
+gst_adaptive_demux_period_prefetch_push (GstAdaptiveDemux * demux,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  GST_DEBUG_OBJECT (demux, "Prefetching %s %" G_GINT64_FORMAT "-%"
+      G_GINT64_FORMAT " of the next period", uri, range_start, range_end);
+
+  prefetch = gst_adaptive_demux_prefetch_start (demux, uri, range_start,
+      range_end, &demux->priv->period_prefetch_lock,
+      &demux->priv->period_prefetch_cond,
+      &demux->priv->period_prefetch_active);
+  g_queue_push_tail (&demux->priv->period_prefetch, prefetch);
+}
+
+/* must be called with manifest_lock taken.
+ * Starts downloading the headers and first fragments of the next period, so
+ * they are there when the streams of the current one are all done. Only
+ * done once per period */
+static void
+gst_adaptive_demux_prefetch_next_period (GstAdaptiveDemux * demux)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GArray *fragments;
+  guint i;
+
+  if (!klass->peek_next_period || demux->priv->period_prefetched ||
+      demux->segment.rate != 1.0 || !gst_adaptive_demux_has_next_period (demux))
+    return;
+
+  demux->priv->period_prefetched = TRUE;
+  gst_adaptive_demux_clear_period_prefetch (demux);
+
+  fragments = g_array_new (FALSE, TRUE,
+      sizeof (GstAdaptiveDemuxStreamFragment));
+  g_array_set_clear_func (fragments,
+      (GDestroyNotify) gst_adaptive_demux_stream_fragment_clear);
+  klass->peek_next_period (demux, fragments);
+
+  for (i = 0; i < fragments->len; i++) {
+    GstAdaptiveDemuxStreamFragment *fragment =
+        &g_array_index (fragments, GstAdaptiveDemuxStreamFragment, i);
+
+    if (fragment->header_uri)
+      gst_adaptive_demux_period_prefetch_push (demux, fragment->header_uri,
+          fragment->header_range_start, fragment->header_range_end);
+    if (fragment->index_uri)
+      gst_adaptive_demux_period_prefetch_push (demux, fragment->index_uri,
+          fragment->index_range_start, fragment->index_range_end);
+    if (fragment->uri)
+      gst_adaptive_demux_period_prefetch_push (demux, fragment->uri,
+          fragment->range_start, fragment->range_end);
+  }
+  g_array_unref (fragments);
+}
+
+/* must be called with manifest_lock taken.
+ * Returns the download of the next period that was started for @uri, if
+ * any */
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_take_period_prefetch (GstAdaptiveDemux * demux,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  GList *iter;
+
+  for (iter = demux->priv->period_prefetch.head; iter;
+      iter = g_list_next (iter)) {
+    GstAdaptiveDemuxPrefetch *prefetch = iter->data;
+
+    if (gst_adaptive_demux_prefetch_matches (prefetch, uri, range_start,
+            range_end)) {
+      g_queue_delete_link (&demux->priv->period_prefetch, iter);
+      return prefetch;
+    }
+  }
+
+  return NULL;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Feeds @buffer, the complete data of the current download, to the stream
+ * the way the source element would. @download_time is GST_CLOCK_TIME_NONE if
+ * it didn't come from the network, the last download measurements are kept
+ * then.
+ */
+static GstFlowReturn
+gst_adaptive_demux_stream_push_data (GstAdaptiveDemuxStream * stream,
+    GstBuffer * buffer, GstClockTime download_time)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstFlowReturn ret;
+  gsize size;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    gst_buffer_unref (buffer);
+    return stream->last_ret = GST_FLOW_FLUSHING;
+  }
+  stream->download_finished = FALSE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  size = gst_buffer_get_size (buffer);
+  GST_DEBUG_OBJECT (stream->pad, "Pushing %s of %" G_GSIZE_FORMAT " bytes",
+      uritype (stream), size);
+
+  /* what _uri_handler_probe() would have measured, without the time spent
+   * waiting in the queue */
+  stream->download_start_time =
+      GST_TIME_AS_USECONDS (gst_adaptive_demux_get_monotonic_time (demux));
+  stream->fragment_bytes_downloaded = size;
+  if (GST_CLOCK_TIME_IS_VALID (download_time)) {
+    stream->last_download_time = download_time;
+    if (download_time > 0)
+      stream->last_bitrate =
+          gst_util_uint64_scale (size, 8 * GST_SECOND, download_time);
+    if (stream->moving_index < STARTUP_FRAGMENTS) {
+      stream->startup_bytes += size;
+      stream->startup_download_time += download_time;
+    }
+  }
+
+  /* and what _src_chain() would have worked out from the source */
+  stream->downloading_first_buffer = FALSE;
+  if (!stream->downloading_header && !stream->downloading_index) {
+    if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0)
+      stream->fragment.bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (size,
+              8 * GST_SECOND, stream->fragment.duration));
+    if (stream->fragment.bitrate)
+      stream->bitrate_changed = TRUE;
+  }
+
+  /* the timestamps are set on it */
+  buffer = gst_buffer_make_writable (buffer);
+
+  GST_MANIFEST_UNLOCK (demux);
+  ret = _src_chain (stream->internal_pad, GST_OBJECT_CAST (demux), buffer);
+  GST_MANIFEST_LOCK (demux);
+
+  /* like the EOS of the source */
+  if (ret == GST_FLOW_OK)
+    gst_adaptive_demux_eos_handling (stream);
+
+  return stream->last_ret;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Waits for @prefetch, which is consumed, and feeds its data to the stream.
+ * Returns %FALSE if the prefetch failed, the fragment then has to be
+ * downloaded normally.
+ */
+static gboolean
+gst_adaptive_demux_stream_push_prefetch (GstAdaptiveDemuxStream * stream,
+    GstAdaptiveDemuxPrefetch * prefetch, GstFlowReturn * ret)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstFragment *download;
+  GstBuffer *buffer = NULL;
+  GstClockTime download_time = GST_CLOCK_TIME_NONE;
+  gboolean cancelled;
+
+  GST_MANIFEST_UNLOCK (demux);
+  g_mutex_lock (prefetch->lock);
+  while (!prefetch->done)
+    g_cond_wait (prefetch->cond, prefetch->lock);
+  download = prefetch->download;
+  prefetch->download = NULL;
+  g_mutex_unlock (prefetch->lock);
+  GST_MANIFEST_LOCK (demux);
+
+  if (download) {
+    buffer = gst_fragment_get_buffer (download);
+    /* fragments taken from the cache have no download time */
+    download_time =
+        download->download_stop_time - download->download_start_time;
+    if (download_time == 0)
+      download_time = GST_CLOCK_TIME_NONE;
+    g_object_unref (download);
+  }
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  cancelled = stream->cancelled;
+  g_mutex_unlock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (cancelled)) {
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    goto done;
+  }
+
+  if (buffer == NULL) {
+    GST_DEBUG_OBJECT (stream->pad, "Prefetch of %s failed, downloading it "
+        "again", prefetch->uri);
+    gst_adaptive_demux_prefetch_free (prefetch);
+    return FALSE;
+  }
+
+  /* the first download of a stream of the next period, the data goes where
+   * the source would push it */
+  if (stream->internal_pad == NULL &&
+      !gst_adaptive_demux_stream_update_source (stream, prefetch->uri, NULL,
+          FALSE, TRUE)) {
+    *ret = stream->last_ret = GST_FLOW_ERROR;
+    goto done;
+  }
+
+  GST_DEBUG_OBJECT (stream->pad, "Using prefetched %s %s", uritype (stream),
+      prefetch->uri);
+  *ret = gst_adaptive_demux_stream_push_data (stream, buffer, download_time);
+  buffer = NULL;
+
+done:
+  if (buffer)
+    gst_buffer_unref (buffer);
+  gst_adaptive_demux_prefetch_free (prefetch);
+  return TRUE;
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Like gst_adaptive_demux_stream_fetch_uri(), but with the fragment-cache
+ * property the data is taken from the fragment cache if there, and added to
+ * it once downloaded otherwise. The downloads started ahead of time for the
+ * next period are used first.
+ */
+static GstFlowReturn
+gst_adaptive_demux_stream_download_uri (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, const gchar * uri, gint64 start,
+    gint64 end, guint * http_status)
+{
+  GstFragmentCache *cache;
+  GstBufferList *data;
+  GstBuffer *buffer;
+  GstFlowReturn ret;
+  gboolean reserved;
+
+  if (!g_queue_is_empty (&demux->priv->period_prefetch)) {
+    GstAdaptiveDemuxPrefetch *prefetch =
+        gst_adaptive_demux_take_period_prefetch (demux, uri, start, end);
+
+    if (prefetch
+        && gst_adaptive_demux_stream_push_prefetch (stream, prefetch, &ret)) {
+      if (http_status)
+        *http_status = 200;
+      return ret;
+    }
+  }
+
+  if (!demux->priv->fragment_cache)
+    return gst_adaptive_demux_stream_fetch_uri (demux, stream, uri, start,
+        end, http_status);
+
+  cache = gst_fragment_cache_get_default ();
+  /* waits if another stream or demuxer is downloading the same fragment,
+   * which can need the manifest lock to finish */
+  GST_MANIFEST_UNLOCK (demux);
+  buffer = gst_fragment_cache_lookup_or_reserve (cache, uri, start, end,
+      &reserved);
+  GST_MANIFEST_LOCK (demux);
+  if (buffer) {
+    GST_DEBUG_OBJECT (stream->pad, "Found %s %s in the fragment cache",
+        uritype (stream), uri);
+    if (http_status)
+      *http_status = 200;
+
+    /* the data goes where the source would push it */
+    if (stream->internal_pad == NULL &&
+        !gst_adaptive_demux_stream_update_source (stream, uri, NULL, FALSE,
+            TRUE)) {
+      gst_buffer_unref (buffer);
+      return stream->last_ret = GST_FLOW_ERROR;
+    }
+    return gst_adaptive_demux_stream_push_data (stream, buffer,
+        GST_CLOCK_TIME_NONE);
+  }
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->cache_data = gst_buffer_list_new ();
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  ret = gst_adaptive_demux_stream_fetch_uri (demux, stream, uri, start, end,
+      http_status);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  data = stream->cache_data;
+  stream->cache_data = NULL;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  if (ret == GST_FLOW_OK && gst_buffer_list_length (data) > 0) {
+    guint i, len = gst_buffer_list_length (data);
+
+    buffer = gst_buffer_new ();
+    for (i = 0; i < len; i++)
+      buffer = gst_buffer_append (buffer,
+          gst_buffer_ref (gst_buffer_list_get (data, i)));
+    gst_fragment_cache_insert (cache, uri, start, end, buffer);
+    gst_buffer_unref (buffer);
+  } else if (reserved) {
+    gst_fragment_cache_release (cache, uri, start, end);
+  }
+  gst_buffer_list_unref (data);
+
+  return ret;
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -3430,9 +4440,20 @@ again:
         chunk_end = MIN (chunk_end, range_end);
     }
   } else {
-    ret =
-        gst_adaptive_demux_stream_download_uri (demux, stream, url,
-        stream->fragment.range_start, stream->fragment.range_end, &http_status);
+    GstAdaptiveDemuxPrefetch *prefetch =
+        gst_adaptive_demux_stream_take_prefetch (stream);
+
+    /* request the next fragments before waiting for this one */
+    gst_adaptive_demux_stream_update_prefetch (stream);
+
+    if (prefetch == NULL
+        || !gst_adaptive_demux_stream_push_prefetch (stream, prefetch,
+            &ret)) {
+      ret =
+          gst_adaptive_demux_stream_download_uri (demux, stream, url,
+          stream->fragment.range_start, stream->fragment.range_end,
+          &http_status);
+    }
     GST_DEBUG_OBJECT (stream->pad, "Fragment download result: %d (%d) %s",
         stream->last_ret, http_status, gst_flow_get_name (stream->last_ret));
   }
@@ -3798,6 +4819,9 @@ gst_adaptive_demux_stream_download_loop (GstAdaptiveDemuxStream * stream)
         gst_task_stop (stream->download_task);
       }
 
+      /* the other streams may still be downloading the end of the period */
+      gst_adaptive_demux_prefetch_next_period (demux);
+
       if (gst_adaptive_demux_combine_flows (demux) == GST_FLOW_EOS) {
         if (gst_adaptive_demux_has_next_period (demux)) {
           GST_DEBUG_OBJECT (stream->pad,
@@ -4222,6 +5246,9 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
             gst_adaptive_demux_stream_update_current_bitrate (demux, stream))) {
       stream->need_header = TRUE;
       ret = (GstFlowReturn) GST_ADAPTIVE_DEMUX_FLOW_SWITCH;
+
+      /* the prefetched fragments are from the previous bitrate */
+      gst_adaptive_demux_stream_clear_prefetch (stream);
     }
 
     /* the subclass might want to switch pads */
@@ -4328,9 +5355,20 @@ gst_adaptive_demux_update_manifest_default (GstAdaptiveDemux * demux)
   GstFlowReturn ret;
   GError *error = NULL;
 
-  download = gst_uri_downloader_fetch_uri (demux->downloader,
-      demux->manifest_uri, NULL, TRUE, TRUE, TRUE, &error);
-  if (download) {
+  download = gst_uri_downloader_fetch_uri_if_modified (demux->downloader,
+      demux->manifest_uri, NULL, TRUE, TRUE, TRUE,
+      demux->priv->manifest_entity_tag, demux->priv->manifest_last_modified,
+      &error);
+  if (download && download->not_modified) {
+    GST_DEBUG_OBJECT (demux, "Manifest not modified");
+    g_object_unref (download);
+    ret = GST_FLOW_OK;
+  } else if (download) {
+    g_free (demux->priv->manifest_entity_tag);
+    demux->priv->manifest_entity_tag = g_strdup (download->entity_tag);
+    g_free (demux->priv->manifest_last_modified);
+    demux->priv->manifest_last_modified = g_strdup (download->last_modified);
+
     g_free (demux->manifest_uri);
     g_free (demux->manifest_base_uri);
     if (download->redirect_permanent && download->redirect_uri) {
@@ -4347,6 +5385,13 @@ gst_adaptive_demux_update_manifest_default (GstAdaptiveDemux * demux)
     gst_buffer_unref (buffer);
     /* FIXME: Should the manifest uri vars be reverted to original
      * values if updating fails? */
+    if (ret != GST_FLOW_OK) {
+      /* make sure the next update gets the whole manifest again */
+      g_free (demux->priv->manifest_entity_tag);
+      demux->priv->manifest_entity_tag = NULL;
+      g_free (demux->priv->manifest_last_modified);
+      demux->priv->manifest_last_modified = NULL;
+    }
   } else {
     GST_WARNING_OBJECT (demux, "Failed to download manifest: %s",
         error->message);
@@ -4441,10 +5486,34 @@ gst_adaptive_demux_advance_period (GstAdaptiveDemux * demux)
 
   GST_DEBUG_OBJECT (demux, "Advancing to next period");
   klass->advance_period (demux);
+  /* the period_prefetch queue is kept for the new streams */
+  demux->priv->period_prefetched = FALSE;
   gst_adaptive_demux_prepare_streams (demux, FALSE);
   gst_adaptive_demux_start_tasks (demux, TRUE);
 }
 
+/**
+ * gst_adaptive_demux_get_startup_bitrate:
+ * @demux: #GstAdaptiveDemux
+ * Returns: the bitrate in bits per second to select the first fragments
+ *     for, or 0 if the subclass should use its own default
+ *
+ * Used by subclasses to select their initial alternates. Takes
+ * #GstAdaptiveDemux:connection-speed into account. Must be called with the
+ * manifest lock taken, as from the class virtual methods.
+ *
+ * Since: 1.16
+ */
+guint64
+gst_adaptive_demux_get_startup_bitrate (GstAdaptiveDemux * demux)
+{
+  g_return_val_if_fail (demux != NULL, 0);
+
+  if (demux->connection_speed)
+    return demux->connection_speed;
+  return demux->priv->startup_bitrate;
+}
+
 /**
  * gst_adaptive_demux_get_monotonic_time:
  * Returns: a monotonically increasing time, using the system realtime clock
@@ -84,6 +84,30 @@ G_BEGIN_DECLS
   g_clear_error (&err); \
 } G_STMT_END
 
+/**
+ * GstAdaptiveDemuxAbrAlgorithm:
+ * @GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE: the smallest of the last fragment
+ *     download bitrate and the average of the last fragments
+ * @GST_ADAPTIVE_DEMUX_ABR_EWMA: exponentially weighted moving averages of
+ *     the download bitrate
+ * @GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED: the EWMA estimate scaled by the
+ *     amount of data buffered downstream
+ *
+ * The algorithm used to estimate the bitrate the next fragments are
+ * selected for.
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_ADAPTIVE_DEMUX_ABR_MOVING_AVERAGE,
+  GST_ADAPTIVE_DEMUX_ABR_EWMA,
+  GST_ADAPTIVE_DEMUX_ABR_BUFFER_BASED
+} GstAdaptiveDemuxAbrAlgorithm;
+
+#define GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM \
+  (gst_adaptive_demux_abr_algorithm_get_type())
+
 /* DEPRECATED */
 #define GST_ADAPTIVE_DEMUX_FLOW_END_OF_FRAGMENT GST_FLOW_CUSTOM_SUCCESS_1
 
@@ -184,6 +208,17 @@ struct _GstAdaptiveDemuxStream
   guint moving_index;
   guint64 *fragment_bitrates;
 
+  /* EWMA estimates of the download bitrate, see the abr-algorithm property */
+  gdouble abr_fast_estimate;
+  gdouble abr_slow_estimate;
+  gdouble abr_total_weight;
+  guint64 abr_last_bitrate;
+
+  /* bytes and download time of the headers and fragments measured since the
+   * stream started, see the startup-bitrate property */
+  guint64 startup_bytes;
+  GstClockTime startup_download_time;
+
   /* QoS data */
   GstClockTime qos_earliest_time;
 
@@ -195,6 +230,18 @@ struct _GstAdaptiveDemuxStream
   gboolean eos;
 
   gboolean do_block; /* TRUE if stream should block on preroll */
+
+  /* fragments downloaded ahead of the current one, see the prefetch-depth
+   * property. The queue is protected by the manifest_lock, the state of the
+   * downloads by prefetch_lock */
+  GQueue prefetch_queue;
+  GList *prefetch_active;       /* protected by prefetch_lock */
+  GMutex prefetch_lock;
+  GCond prefetch_cond;
+
+  /* data of the current download, for the fragment cache. Protected by
+   * fragment_download_lock */
+  GstBufferList *cache_data;
 };
 
 /**
@@ -482,11 +529,46 @@ struct _GstAdaptiveDemuxClass
    * Return: %TRUE if the playlist needs to be refreshed periodically by the demuxer.
    */
   gboolean (*requires_periodical_playlist_update) (GstAdaptiveDemux * demux);
+
+  /**
+   * stream_peek_fragment:
+   * @stream: #GstAdaptiveDemuxStream
+   * @index: how far after the current fragment to look, 1 being the next one
+   * @fragment: the #GstAdaptiveDemuxStreamFragment to fill
+   *
+   * Optional. Sets the uri, range and duration of a fragment following the
+   * current one in @fragment, without moving to it. Used to download the
+   * next fragments ahead of time when the prefetch-depth property is set.
+   *
+   * Return: %TRUE if @fragment was set, %FALSE if there is no such fragment
+   * or it isn't known yet.
+   *
+   * Since: 1.16
+   */
+  gboolean (*stream_peek_fragment) (GstAdaptiveDemuxStream * stream, guint index, GstAdaptiveDemuxStreamFragment * fragment);
+
+  /**
+   * peek_next_period:
+   * @demux: #GstAdaptiveDemux
+   * @fragments: a #GArray of #GstAdaptiveDemuxStreamFragment to fill
+   *
+   * Optional. Appends to @fragments the first fragment, with its header and
+   * index, of each stream of the next period, as they will be after
+   * advance_period(). Only called when has_next_period() returned %TRUE.
+   * Used to download them while the current period ends, so the next
+   * period starts without waiting for the network.
+   *
+   * Since: 1.16
+   */
+  void     (*peek_next_period) (GstAdaptiveDemux * demux, GArray * fragments);
 };
 
 GST_ADAPTIVE_DEMUX_API
 GType    gst_adaptive_demux_get_type (void);
 
+GST_ADAPTIVE_DEMUX_API
+GType    gst_adaptive_demux_abr_algorithm_get_type (void);
+
 GST_ADAPTIVE_DEMUX_API
 void     gst_adaptive_demux_set_stream_struct_size (GstAdaptiveDemux * demux,
                                                     gsize struct_size);
@@ -523,6 +605,9 @@ GST_ADAPTIVE_DEMUX_API
 void gst_adaptive_demux_stream_queue_event (GstAdaptiveDemuxStream * stream,
     GstEvent * event);
 
+GST_ADAPTIVE_DEMUX_API
+guint64 gst_adaptive_demux_get_startup_bitrate (GstAdaptiveDemux * demux);
+
 GST_ADAPTIVE_DEMUX_API
 GstClockTime gst_adaptive_demux_get_monotonic_time (GstAdaptiveDemux * demux);
 
@@ -201,7 +201,9 @@ enum
   PROP_CURRENT_SUBSONG,
   PROP_SUBSONG_MODE,
   PROP_NUM_LOOPS,
-  PROP_OUTPUT_MODE
+  PROP_OUTPUT_MODE,
+  PROP_BATCH_SIZE,
+  PROP_RENDER_AHEAD
 };
 
 #define DEFAULT_CURRENT_SUBSONG 0
@@ -209,6 +211,8 @@ enum
 #define DEFAULT_NUM_SUBSONGS 0
 #define DEFAULT_NUM_LOOPS 0
 #define DEFAULT_OUTPUT_MODE GST_NONSTREAM_AUDIO_OUTPUT_MODE_STEADY
+#define DEFAULT_BATCH_SIZE 1
+#define DEFAULT_RENDER_AHEAD 0
 
 
 
@@ -295,6 +299,11 @@ static GstTagList
     * gst_nonstream_audio_decoder_add_main_tags (GstNonstreamAudioDecoder * dec,
     GstTagList * tags);
 
+static void gst_nonstream_audio_decoder_clear_render_queue
+    (GstNonstreamAudioDecoder * dec);
+static void gst_nonstream_audio_decoder_clear_pool (GstNonstreamAudioDecoder *
+    dec);
+
 static void gst_nonstream_audio_decoder_output_task (GstNonstreamAudioDecoder *
     dec);
 
@@ -482,6 +491,24 @@ gst_nonstream_audio_decoder_class_init (GstNonstreamAudioDecoderClass * klass)
           GST_TYPE_NONSTREAM_AUDIO_DECODER_OUTPUT_MODE,
           DEFAULT_OUTPUT_MODE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
+
+  g_object_class_install_property (object_class,
+      PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size",
+          "Batch size",
+          "Number of buffers to decode at once and push downstream as one buffer list",
+          1, G_MAXUINT,
+          DEFAULT_BATCH_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
+
+  g_object_class_install_property (object_class,
+      PROP_RENDER_AHEAD,
+      g_param_spec_uint64 ("render-ahead",
+          "Render ahead",
+          "Maximum amount of audio to decode ahead in a separate thread, in nanoseconds (0 = decode in the streaming thread); takes effect when playback (re)starts",
+          0, G_MAXUINT64,
+          DEFAULT_RENDER_AHEAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
 }
 
 
@@ -498,6 +525,8 @@ gst_nonstream_audio_decoder_init (GstNonstreamAudioDecoder * dec,
   dec->subsong_mode = DEFAULT_SUBSONG_MODE;
   dec->output_mode = DEFAULT_OUTPUT_MODE;
   dec->num_loops = DEFAULT_NUM_LOOPS;
+  dec->batch_size = DEFAULT_BATCH_SIZE;
+  dec->render_ahead = DEFAULT_RENDER_AHEAD;
 
   /* Calling this here, not in the NULL->READY state change,
    * to make sure get_property calls return valid values */
@@ -505,6 +534,9 @@ gst_nonstream_audio_decoder_init (GstNonstreamAudioDecoder * dec,
 
   dec->input_data_adapter = gst_adapter_new ();
   g_mutex_init (&(dec->mutex));
+  g_mutex_init (&(dec->render_lock));
+  g_cond_init (&(dec->render_cond));
+  g_queue_init (&(dec->render_queue));
 
   {
     /* set up src pad */
@@ -547,7 +579,11 @@ gst_nonstream_audio_decoder_finalize (GObject * object)
 {
   GstNonstreamAudioDecoder *dec = GST_NONSTREAM_AUDIO_DECODER (object);
 
+  gst_nonstream_audio_decoder_clear_pool (dec);
+
   g_mutex_clear (&(dec->mutex));
+  g_mutex_clear (&(dec->render_lock));
+  g_cond_clear (&(dec->render_cond));
   g_object_unref (G_OBJECT (dec->input_data_adapter));
 
   G_OBJECT_CLASS (gst_nonstream_audio_decoder_parent_class)->finalize (object);
@@ -689,6 +725,22 @@ gst_nonstream_audio_decoder_set_property (GObject * object, guint prop_id,
       break;
     }
 
+    case PROP_BATCH_SIZE:
+    {
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      dec->batch_size = g_value_get_uint (value);
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+      break;
+    }
+
+    case PROP_RENDER_AHEAD:
+    {
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      dec->render_ahead = g_value_get_uint64 (value);
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+      break;
+    }
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -735,6 +787,22 @@ gst_nonstream_audio_decoder_get_property (GObject * object, guint prop_id,
       break;
     }
 
+    case PROP_BATCH_SIZE:
+    {
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      g_value_set_uint (value, dec->batch_size);
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+      break;
+    }
+
+    case PROP_RENDER_AHEAD:
+    {
+      GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+      g_value_set_uint64 (value, dec->render_ahead);
+      GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+      break;
+    }
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1165,6 +1233,8 @@ gst_nonstream_audio_decoder_set_initial_state (GstNonstreamAudioDecoder * dec)
   dec->toc = NULL;
 
   dec->allocator = NULL;
+  dec->output_pool = NULL;
+  dec->output_pool_size = 0;
 }
 
 
@@ -1173,6 +1243,8 @@ gst_nonstream_audio_decoder_cleanup_state (GstNonstreamAudioDecoder * dec)
 {
   gst_adapter_clear (dec->input_data_adapter);
 
+  gst_nonstream_audio_decoder_clear_pool (dec);
+
   if (dec->allocator != NULL) {
     gst_object_unref (dec->allocator);
     dec->allocator = NULL;
@@ -1269,6 +1341,9 @@ gst_nonstream_audio_decoder_negotiate_default (GstNonstreamAudioDecoder * dec)
   dec->allocator = allocator;
   dec->allocation_params = allocation_params;
 
+  /* the output pool is set up again with the new allocator */
+  gst_nonstream_audio_decoder_clear_pool (dec);
+
 done:
   if (query != NULL)
     gst_query_unref (query);
@@ -1506,9 +1581,253 @@ gst_nonstream_audio_decoder_finish_load (GstNonstreamAudioDecoder * dec,
 }
 
 
+static void
+gst_nonstream_audio_decoder_clear_pool (GstNonstreamAudioDecoder * dec)
+{
+  if (dec->output_pool != NULL) {
+    gst_buffer_pool_set_active (dec->output_pool, FALSE);
+    gst_object_unref (dec->output_pool);
+    dec->output_pool = NULL;
+  }
+  dec->output_pool_size = 0;
+}
+
+
+/* Unrefs the rendered items. Returns TRUE if they contained a pending
+ * output format change, which then has to be negotiated later on. */
+static gboolean
+gst_nonstream_audio_decoder_drop_items (GQueue * items)
+{
+  gboolean format_changed = FALSE;
+  GstMiniObject *item;
+
+  while ((item = g_queue_pop_head (items)) != NULL) {
+    if (GST_IS_EVENT (item)
+        && GST_EVENT_TYPE (GST_EVENT_CAST (item)) == GST_EVENT_CAPS)
+      format_changed = TRUE;
+    gst_mini_object_unref (item);
+  }
+
+  return format_changed;
+}
+
+
+static void
+gst_nonstream_audio_decoder_clear_render_queue (GstNonstreamAudioDecoder * dec)
+{
+  /* must be called with lock */
+
+  g_mutex_lock (&(dec->render_lock));
+  if (gst_nonstream_audio_decoder_drop_items (&(dec->render_queue)))
+    dec->output_format_changed = TRUE;
+  dec->render_queued = 0;
+  dec->render_done = FALSE;
+  /* anything rendered right now was rendered for the old position */
+  dec->render_cookie++;
+  g_cond_broadcast (&(dec->render_cond));
+  g_mutex_unlock (&(dec->render_lock));
+}
+
+
+/* Calls decode() up to batch-size times and appends the decoded buffers,
+ * with their metadata set, to items. Events produced meanwhile, like new
+ * segments for loops, end up in between the buffers in the right order.
+ * Returns FALSE if playback ended (an EOS event is then the last item) or
+ * decoding failed. */
+static gboolean
+gst_nonstream_audio_decoder_render (GstNonstreamAudioDecoder * dec,
+    GQueue * items, GstClockTime * duration)
+{
+  /* must be called with lock */
+
+  GstNonstreamAudioDecoderClass *klass;
+  gboolean ret = TRUE;
+  guint i;
+
+  klass = GST_NONSTREAM_AUDIO_DECODER_CLASS (G_OBJECT_GET_CLASS (dec));
+  g_assert (klass->decode != NULL);
+
+  dec->pending_items = items;
+
+  for (i = 0; i < MAX (dec->batch_size, 1); i++) {
+    GstBuffer *outbuf = NULL;
+    guint num_samples;
+
+    /* with previous buffers not pushed yet, caps must not be sent */
+    dec->defer_negotiation = (i > 0 || dec->render_thread != NULL);
+
+    /* perform the actual decoding */
+    if (!(klass->decode (dec, &outbuf, &num_samples))) {
+      /* EOS case */
+      GST_INFO_OBJECT (dec, "decode() reports end -> sending EOS event");
+      g_queue_push_tail (items, gst_event_new_eos ());
+      ret = FALSE;
+      break;
+    }
+
+    if (outbuf == NULL) {
+      GST_ERROR_OBJECT (dec, "decode() produced NULL buffer");
+      ret = FALSE;
+      break;
+    }
+
+    /* set the buffer's metadata */
+    GST_BUFFER_DURATION (outbuf) =
+        gst_util_uint64_scale_int (num_samples, GST_SECOND,
+        dec->output_audio_info.rate);
+    GST_BUFFER_OFFSET (outbuf) = dec->cur_pos_in_samples;
+    GST_BUFFER_OFFSET_END (outbuf) = dec->cur_pos_in_samples + num_samples;
+    GST_BUFFER_PTS (outbuf) =
+        gst_util_uint64_scale_int (dec->cur_pos_in_samples, GST_SECOND,
+        dec->output_audio_info.rate);
+    GST_BUFFER_DTS (outbuf) = GST_BUFFER_PTS (outbuf);
+
+    if (G_UNLIKELY (dec->discont)) {
+      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+      dec->discont = FALSE;
+    }
+
+    GST_LOG_OBJECT (dec,
+        "output buffer stats: num_samples = %u  duration = %" GST_TIME_FORMAT
+        "  cur_pos_in_samples = %" G_GUINT64_FORMAT "  timestamp = %"
+        GST_TIME_FORMAT, num_samples,
+        GST_TIME_ARGS (GST_BUFFER_DURATION (outbuf)), dec->cur_pos_in_samples,
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf))
+        );
+
+    /* increment sample counters */
+    dec->cur_pos_in_samples += num_samples;
+    dec->num_decoded_samples += num_samples;
+
+    /* the decode() call might have set a new output format; the caps event
+     * marks where to renegotiate, it is not pushed as such */
+    if (G_UNLIKELY (dec->output_format_changed
+            && GST_AUDIO_INFO_IS_VALID (&(dec->output_audio_info)))) {
+      GstCaps *caps = gst_audio_info_to_caps (&(dec->output_audio_info));
+
+      g_queue_push_tail (items, gst_event_new_caps (caps));
+      gst_caps_unref (caps);
+      dec->output_format_changed = FALSE;
+    }
+
+    if (duration != NULL)
+      *duration += GST_BUFFER_DURATION (outbuf);
+    g_queue_push_tail (items, outbuf);
+  }
+
+  dec->pending_items = NULL;
+  dec->defer_negotiation = FALSE;
+
+  return ret;
+}
+
+
+static gpointer
+gst_nonstream_audio_decoder_render_func (gpointer user_data)
+{
+  GstNonstreamAudioDecoder *dec = user_data;
+  GQueue items = G_QUEUE_INIT;
+
+  g_mutex_lock (&(dec->render_lock));
+  while (dec->render_running) {
+    GstClockTime duration = 0;
+    gboolean more;
+    guint cookie;
+
+    if (dec->render_done || dec->render_queued >= dec->render_limit) {
+      g_cond_wait (&(dec->render_cond), &(dec->render_lock));
+      continue;
+    }
+    g_mutex_unlock (&(dec->render_lock));
+
+    GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+    cookie = dec->render_cookie;
+    more = gst_nonstream_audio_decoder_render (dec, &items, &duration);
+    GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+
+    g_mutex_lock (&(dec->render_lock));
+    if (cookie != dec->render_cookie) {
+      /* a seek or subsong switch happened in between */
+      g_mutex_unlock (&(dec->render_lock));
+      if (gst_nonstream_audio_decoder_drop_items (&items)) {
+        GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+        dec->output_format_changed = TRUE;
+        GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+      }
+      g_mutex_lock (&(dec->render_lock));
+      continue;
+    }
+
+    while (!g_queue_is_empty (&items))
+      g_queue_push_tail (&(dec->render_queue), g_queue_pop_head (&items));
+    dec->render_queued += duration;
+    if (!more)
+      dec->render_done = TRUE;
+    g_cond_broadcast (&(dec->render_cond));
+  }
+  g_mutex_unlock (&(dec->render_lock));
+
+  return NULL;
+}
+
+
+static void
+gst_nonstream_audio_decoder_start_render_thread (GstNonstreamAudioDecoder *
+    dec)
+{
+  GstClockTime render_ahead;
+  GError *err = NULL;
+
+  GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+  render_ahead = dec->render_ahead;
+  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+
+  g_mutex_lock (&(dec->render_lock));
+  dec->render_running = TRUE;
+  g_mutex_unlock (&(dec->render_lock));
+
+  if (dec->render_thread != NULL || render_ahead == 0)
+    return;
+
+  dec->render_done = FALSE;
+  dec->render_queued = 0;
+  dec->render_limit = render_ahead;
+
+  dec->render_thread = g_thread_try_new ("nonstreamrender",
+      gst_nonstream_audio_decoder_render_func, dec, &err);
+  if (dec->render_thread == NULL) {
+    GST_WARNING_OBJECT (dec, "could not start rendering thread: %s",
+        err->message);
+    g_clear_error (&err);
+  }
+}
+
+
+static void
+gst_nonstream_audio_decoder_stop_render_thread (GstNonstreamAudioDecoder * dec)
+{
+  if (dec->render_thread == NULL)
+    return;
+
+  g_mutex_lock (&(dec->render_lock));
+  dec->render_running = FALSE;
+  g_cond_broadcast (&(dec->render_cond));
+  g_mutex_unlock (&(dec->render_lock));
+
+  g_thread_join (dec->render_thread);
+  dec->render_thread = NULL;
+
+  GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+  gst_nonstream_audio_decoder_clear_render_queue (dec);
+  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+}
+
+
 static gboolean
 gst_nonstream_audio_decoder_start_task (GstNonstreamAudioDecoder * dec)
 {
+  gst_nonstream_audio_decoder_start_render_thread (dec);
+
   if (!gst_pad_start_task (dec->srcpad,
           (GstTaskFunction) gst_nonstream_audio_decoder_output_task, dec,
           NULL)) {
@@ -1522,11 +1841,22 @@ gst_nonstream_audio_decoder_start_task (GstNonstreamAudioDecoder * dec)
 static gboolean
 gst_nonstream_audio_decoder_stop_task (GstNonstreamAudioDecoder * dec)
 {
+  gboolean ret = TRUE;
+
+  /* wake up the output task if it waits for rendered data */
+  g_mutex_lock (&(dec->render_lock));
+  dec->render_running = FALSE;
+  g_cond_broadcast (&(dec->render_cond));
+  g_mutex_unlock (&(dec->render_lock));
+
   if (!gst_pad_stop_task (dec->srcpad)) {
     GST_ERROR_OBJECT (dec, "could not stop decoder output task");
-    return FALSE;
-  } else
-    return TRUE;
+    ret = FALSE;
+  }
+
+  gst_nonstream_audio_decoder_stop_render_thread (dec);
+
+  return ret;
 }
 
 
@@ -1843,7 +2173,14 @@ gst_nonstream_audio_decoder_output_new_segment (GstNonstreamAudioDecoder * dec,
   dec->cur_segment = segment;
   dec->discont = TRUE;
 
-  gst_pad_push_event (dec->srcpad, gst_event_new_segment (&segment));
+  /* inside decode() the segment has to follow the buffers decoded before
+   * it, otherwise whatever was rendered ahead belongs to the old one */
+  if (dec->pending_items != NULL) {
+    g_queue_push_tail (dec->pending_items, gst_event_new_segment (&segment));
+  } else {
+    gst_nonstream_audio_decoder_clear_render_queue (dec);
+    gst_pad_push_event (dec->srcpad, gst_event_new_segment (&segment));
+  }
 }
 
 
@@ -1974,6 +2311,8 @@ gst_nonstream_audio_decoder_do_seek (GstNonstreamAudioDecoder * dec,
       dec->output_audio_info.rate, GST_SECOND);
   dec->num_decoded_samples = 0;
 
+  gst_nonstream_audio_decoder_clear_render_queue (dec);
+
   GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
 
   if (flush) {
@@ -2055,79 +2394,101 @@ gst_nonstream_audio_decoder_add_main_tags (GstNonstreamAudioDecoder * dec,
 }
 
 
-static void
-gst_nonstream_audio_decoder_output_task (GstNonstreamAudioDecoder * dec)
+/* Pushes the rendered buffers and events downstream, in order. Consecutive
+ * buffers are pushed as one buffer list. */
+static GstFlowReturn
+gst_nonstream_audio_decoder_push_items (GstNonstreamAudioDecoder * dec,
+    GQueue * items)
 {
-  GstFlowReturn flow;
-  GstBuffer *outbuf;
-  guint num_samples;
+  GstFlowReturn flow = GST_FLOW_OK;
+  GstMiniObject *item;
 
-  GstNonstreamAudioDecoderClass *klass;
-  klass = GST_NONSTREAM_AUDIO_DECODER_CLASS (G_OBJECT_GET_CLASS (dec));
-  g_assert (klass->decode != NULL);
+  while (flow == GST_FLOW_OK && (item = g_queue_pop_head (items)) != NULL) {
+    GstBuffer *outbuf;
+    GstBufferList *list = NULL;
 
-  GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+    if (GST_IS_EVENT (item)) {
+      GstEvent *event = GST_EVENT_CAST (item);
 
-  /* perform the actual decoding */
-  if (!(klass->decode (dec, &outbuf, &num_samples))) {
-    /* EOS case */
-    GST_INFO_OBJECT (dec, "decode() reports end -> sending EOS event");
-    gst_pad_push_event (dec->srcpad, gst_event_new_eos ());
-    goto pause_unlock;
-  }
+      if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+        GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+        dec->output_format_changed = TRUE;
+        GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+        gst_event_unref (event);
+      } else {
+        gst_pad_push_event (dec->srcpad, event);
+      }
+      continue;
+    }
 
-  if (outbuf == NULL) {
-    GST_ERROR_OBJECT (outbuf, "decode() produced NULL buffer");
-    goto pause_unlock;
-  }
+    outbuf = GST_BUFFER_CAST (item);
 
-  /* set the buffer's metadata */
-  GST_BUFFER_DURATION (outbuf) =
-      gst_util_uint64_scale_int (num_samples, GST_SECOND,
-      dec->output_audio_info.rate);
-  GST_BUFFER_OFFSET (outbuf) = dec->cur_pos_in_samples;
-  GST_BUFFER_OFFSET_END (outbuf) = dec->cur_pos_in_samples + num_samples;
-  GST_BUFFER_PTS (outbuf) =
-      gst_util_uint64_scale_int (dec->cur_pos_in_samples, GST_SECOND,
-      dec->output_audio_info.rate);
-  GST_BUFFER_DTS (outbuf) = GST_BUFFER_PTS (outbuf);
+    /* a new output format might have been set -> renegotiate
+     * before sending the new buffer downstream */
+    GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+    if (G_UNLIKELY (dec->output_format_changed ||
+            (GST_AUDIO_INFO_IS_VALID (&(dec->output_audio_info))
+                && gst_pad_check_reconfigure (dec->srcpad))
+        )) {
+      if (!gst_nonstream_audio_decoder_negotiate (dec)) {
+        GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+        gst_buffer_unref (outbuf);
+        GST_LOG_OBJECT (dec, "could not push output buffer: negotiation failed");
+        flow = GST_FLOW_NOT_NEGOTIATED;
+        break;
+      }
+    }
+    GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
 
-  if (G_UNLIKELY (dec->discont)) {
-    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
-    dec->discont = FALSE;
+    while ((item = g_queue_peek_head (items)) != NULL && GST_IS_BUFFER (item)) {
+      if (list == NULL) {
+        list = gst_buffer_list_new ();
+        gst_buffer_list_add (list, outbuf);
+      }
+      gst_buffer_list_add (list, GST_BUFFER_CAST (g_queue_pop_head (items)));
+    }
+
+    /* push new samples downstream
+     * no need to unref buffer - gst_pad_push() does it in
+     * all cases (success and failure) */
+    if (list != NULL)
+      flow = gst_pad_push_list (dec->srcpad, list);
+    else
+      flow = gst_pad_push (dec->srcpad, outbuf);
   }
 
-  GST_LOG_OBJECT (dec,
-      "output buffer stats: num_samples = %u  duration = %" GST_TIME_FORMAT
-      "  cur_pos_in_samples = %" G_GUINT64_FORMAT "  timestamp = %"
-      GST_TIME_FORMAT, num_samples,
-      GST_TIME_ARGS (GST_BUFFER_DURATION (outbuf)), dec->cur_pos_in_samples,
-      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (outbuf))
-      );
+  gst_nonstream_audio_decoder_drop_items (items);
 
-  /* increment sample counters */
-  dec->cur_pos_in_samples += num_samples;
-  dec->num_decoded_samples += num_samples;
+  return flow;
+}
 
-  /* the decode() call might have set a new output format -> renegotiate
-   * before sending the new buffer downstream */
-  if (G_UNLIKELY (dec->output_format_changed ||
-          (GST_AUDIO_INFO_IS_VALID (&(dec->output_audio_info))
-              && gst_pad_check_reconfigure (dec->srcpad))
-      )) {
-    if (!gst_nonstream_audio_decoder_negotiate (dec)) {
-      gst_buffer_unref (outbuf);
-      GST_LOG_OBJECT (dec, "could not push output buffer: negotiation failed");
-      goto pause_unlock;
-    }
-  }
 
-  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+static void
+gst_nonstream_audio_decoder_output_task (GstNonstreamAudioDecoder * dec)
+{
+  GstFlowReturn flow;
+  GQueue items = G_QUEUE_INIT;
+  gboolean more;
+
+  if (dec->render_thread != NULL) {
+    /* take everything the rendering thread produced so far */
+    g_mutex_lock (&(dec->render_lock));
+    while (g_queue_is_empty (&(dec->render_queue)) && !dec->render_done
+        && dec->render_running)
+      g_cond_wait (&(dec->render_cond), &(dec->render_lock));
+    while (!g_queue_is_empty (&(dec->render_queue)))
+      g_queue_push_tail (&items, g_queue_pop_head (&(dec->render_queue)));
+    dec->render_queued = 0;
+    more = !dec->render_done && !g_queue_is_empty (&items);
+    g_cond_broadcast (&(dec->render_cond));
+    g_mutex_unlock (&(dec->render_lock));
+  } else {
+    GST_NONSTREAM_AUDIO_DECODER_LOCK_MUTEX (dec);
+    more = gst_nonstream_audio_decoder_render (dec, &items, NULL);
+    GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
+  }
 
-  /* push new samples downstream
-   * no need to unref buffer - gst_pad_push() does it in
-   * all cases (success and failure) */
-  flow = gst_pad_push (dec->srcpad, outbuf);
+  flow = gst_nonstream_audio_decoder_push_items (dec, &items);
   switch (flow) {
     case GST_FLOW_OK:
       break;
@@ -2149,6 +2510,9 @@ gst_nonstream_audio_decoder_output_task (GstNonstreamAudioDecoder * dec)
               flow));
   }
 
+  if (!more)
+    goto pause;
+
   return;
 
 pause:
@@ -2156,10 +2520,6 @@ pause:
   /* NOT using stop_task here, since that would cause a deadlock.
    * See the gst_pad_stop_task() documentation for details. */
   gst_pad_pause_task (dec->srcpad);
-  return;
-pause_unlock:
-  GST_NONSTREAM_AUDIO_DECODER_UNLOCK_MUTEX (dec);
-  goto pause;
 }
 
 
@@ -2484,6 +2844,7 @@ gst_nonstream_audio_decoder_get_downstream_info (GstNonstreamAudioDecoder * dec,
  * @size: Size of the output buffer, in bytes
  *
  * Allocates an output buffer with the internally configured buffer pool.
+ * Buffers of the same size are recycled once downstream releases them.
  *
  * This function may only be called from within @load_from_buffer,
  * @load_from_custom, and @decode.
@@ -2494,7 +2855,11 @@ GstBuffer *
 gst_nonstream_audio_decoder_allocate_output_buffer (GstNonstreamAudioDecoder *
     dec, gsize size)
 {
-  if (G_UNLIKELY (dec->output_format_changed ||
+  GstBuffer *buffer;
+
+  /* while buffers in the previous format still wait to be pushed, the
+   * negotiation is done later, right before the first new buffer */
+  if (!dec->defer_negotiation && G_UNLIKELY (dec->output_format_changed ||
           (GST_AUDIO_INFO_IS_VALID (&(dec->output_audio_info))
               && gst_pad_check_reconfigure (dec->srcpad))
       )) {
@@ -2508,6 +2873,31 @@ gst_nonstream_audio_decoder_allocate_output_buffer (GstNonstreamAudioDecoder *
     }
   }
 
+  if (size != dec->output_pool_size) {
+    GstBufferPool *pool = gst_buffer_pool_new ();
+    GstStructure *config = gst_buffer_pool_get_config (pool);
+
+    gst_nonstream_audio_decoder_clear_pool (dec);
+
+    gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, dec->allocator,
+        &(dec->allocation_params));
+    if (gst_buffer_pool_set_config (pool, config)
+        && gst_buffer_pool_set_active (pool, TRUE)) {
+      dec->output_pool = pool;
+    } else {
+      GST_WARNING_OBJECT (dec, "could not set up output buffer pool");
+      gst_object_unref (pool);
+    }
+    /* do not retry for every buffer if setting up the pool failed */
+    dec->output_pool_size = size;
+  }
+
+  if (dec->output_pool != NULL
+      && gst_buffer_pool_acquire_buffer (dec->output_pool, &buffer,
+          NULL) == GST_FLOW_OK)
+    return buffer;
+
   return gst_buffer_new_allocate (dec->allocator, size,
       &(dec->allocation_params));
 }
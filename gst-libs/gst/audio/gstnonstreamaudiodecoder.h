@@ -169,9 +169,26 @@ struct _GstNonstreamAudioDecoder
   /* allocation */
   GstAllocator *allocator;
   GstAllocationParams allocation_params;
+  GstBufferPool *output_pool;
+  gsize output_pool_size;
 
   /* thread safety */
   GMutex mutex;
+
+  /* batching; items collects what the current render call produces */
+  guint batch_size;
+  GQueue *pending_items;
+  gboolean defer_negotiation;
+
+  /* rendering ahead; the queue and the flags are protected by render_lock */
+  GstClockTime render_ahead;
+  GThread *render_thread;
+  GMutex render_lock;
+  GCond render_cond;
+  GQueue render_queue;
+  GstClockTime render_queued, render_limit;
+  guint render_cookie;
+  gboolean render_running, render_done;
 };
 
 
@@ -293,6 +310,12 @@ struct _GstNonstreamAudioDecoder
  *
  * All functions are called with a locked decoder mutex.
  *
+ * If the render-ahead property is set, @decode is called from a separate
+ * rendering thread, which decodes up to that much audio ahead of what
+ * has been pushed downstream. With batch-size larger than 1, @decode is
+ * called that many times in a row and the buffers are pushed downstream
+ * as one buffer list.
+ *
  * <note> If GST_ELEMENT_ERROR, GST_ELEMENT_WARNING, or GST_ELEMENT_INFO are called from
  * inside one of these functions, it is strongly recommended to unlock the decoder mutex
  * before and re-lock it after these macros to prevent potential deadlocks in case the
@@ -0,0 +1,136 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:gsth264meta
+ * @title: GstH264LayerMeta
+ * @short_description: Layer of scalable H.264 coded data
+ *
+ * #GstH264LayerMeta is attached by encoders producing scalable H.264 to
+ * tell which spatial, temporal and quality layer a buffer carries.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gsth264meta.h"
+
+GST_DEBUG_CATEGORY_STATIC (h264_meta_debug);
+#define GST_CAT_DEFAULT h264_meta_debug
+
+static gboolean
+gst_h264_layer_meta_init (GstH264LayerMeta * layer_meta,
+    gpointer params, GstBuffer * buffer)
+{
+  layer_meta->spatial_id = 0;
+  layer_meta->temporal_id = 0;
+  layer_meta->quality_id = 0;
+
+  return TRUE;
+}
+
+static gboolean
+gst_h264_layer_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstH264LayerMeta *smeta;
+
+  smeta = (GstH264LayerMeta *) meta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    if (!gst_buffer_add_h264_layer_meta (dest, smeta->spatial_id,
+            smeta->temporal_id, smeta->quality_id))
+      return FALSE;
+  } else {
+    /* return FALSE, if transform type is not supported */
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+GType
+gst_h264_layer_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstH264LayerMetaAPI", tags);
+    GST_DEBUG_CATEGORY_INIT (h264_meta_debug, "h264meta", 0,
+        "H.264 layer GstMeta");
+
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+const GstMetaInfo *
+gst_h264_layer_meta_get_info (void)
+{
+  static const GstMetaInfo *h264_layer_meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & h264_layer_meta_info)) {
+    const GstMetaInfo *meta =
+        gst_meta_register (GST_H264_LAYER_META_API_TYPE,
+        "GstH264LayerMeta", sizeof (GstH264LayerMeta),
+        (GstMetaInitFunction) gst_h264_layer_meta_init,
+        (GstMetaFreeFunction) NULL,
+        (GstMetaTransformFunction) gst_h264_layer_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & h264_layer_meta_info,
+        (GstMetaInfo *) meta);
+  }
+
+  return h264_layer_meta_info;
+}
+
+/**
+ * gst_buffer_add_h264_layer_meta:
+ * @buffer: a #GstBuffer
+ * @spatial_id: the spatial layer of the data
+ * @temporal_id: the temporal layer of the data
+ * @quality_id: the quality layer of the data
+ *
+ * Creates and adds a #GstH264LayerMeta to a @buffer.
+ *
+ * Returns: (transfer none): a newly created #GstH264LayerMeta
+ *
+ * Since: 1.16
+ */
+GstH264LayerMeta *
+gst_buffer_add_h264_layer_meta (GstBuffer * buffer, guint8 spatial_id,
+    guint8 temporal_id, guint8 quality_id)
+{
+  GstH264LayerMeta *layer_meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  layer_meta =
+      (GstH264LayerMeta *) gst_buffer_add_meta (buffer,
+      GST_H264_LAYER_META_INFO, NULL);
+
+  GST_LOG ("spatial %u, temporal %u, quality %u", spatial_id, temporal_id,
+      quality_id);
+
+  layer_meta->spatial_id = spatial_id;
+  layer_meta->temporal_id = temporal_id;
+  layer_meta->quality_id = quality_id;
+
+  return layer_meta;
+}
@@ -0,0 +1,75 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_H264_META_H__
+#define __GST_H264_META_H__
+
+#ifndef GST_USE_UNSTABLE_API
+#warning "The H.264 parsing library is unstable API and may change in future."
+#warning "You can define GST_USE_UNSTABLE_API to avoid this warning."
+#endif
+
+#include <gst/gst.h>
+#include <gst/codecparsers/codecparsers-prelude.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstH264LayerMeta GstH264LayerMeta;
+
+GST_CODEC_PARSERS_API
+GType gst_h264_layer_meta_api_get_type (void);
+#define GST_H264_LAYER_META_API_TYPE  (gst_h264_layer_meta_api_get_type())
+#define GST_H264_LAYER_META_INFO  (gst_h264_layer_meta_get_info())
+GST_CODEC_PARSERS_API
+const GstMetaInfo * gst_h264_layer_meta_get_info (void);
+
+/**
+ * GstH264LayerMeta:
+ * @meta: parent #GstMeta
+ * @spatial_id: the spatial layer (dependency_id) of the data
+ * @temporal_id: the temporal layer (temporal_id) of the data
+ * @quality_id: the quality layer (quality_id) of the data
+ *
+ * Extra buffer metadata telling which layer of a scalable H.264 stream the
+ * coded data of a buffer belongs to, so that forwarding elements can drop
+ * enhancement layers without parsing the SVC NAL unit headers.
+ *
+ * A non-scalable stream only has layer 0 in all dimensions.
+ *
+ * Since: 1.16
+ */
+struct _GstH264LayerMeta {
+  GstMeta meta;
+
+  guint8  spatial_id;
+  guint8  temporal_id;
+  guint8  quality_id;
+};
+
+#define gst_buffer_get_h264_layer_meta(b) ((GstH264LayerMeta*)gst_buffer_get_meta((b),GST_H264_LAYER_META_API_TYPE))
+
+GST_CODEC_PARSERS_API
+GstH264LayerMeta *
+gst_buffer_add_h264_layer_meta (GstBuffer * buffer,
+                                guint8 spatial_id,
+                                guint8 temporal_id,
+                                guint8 quality_id);
+
+G_END_DECLS
+
+#endif /* __GST_H264_META_H__ */
@@ -1243,6 +1243,56 @@ gst_h264_nal_parser_free (GstH264NalParser * nalparser)
   nalparser = NULL;
 }
 
+/**
+ * gst_h264_nal_parser_copy:
+ * @nalparser: the #GstH264NalParser to copy
+ *
+ * Creates a new #GstH264NalParser holding the same parameter sets as
+ * @nalparser, so that parsing can carry on from the current state
+ * independently, for example on several segments of a stream in parallel.
+ * Only the parameter sets in use are copied.
+ *
+ * Returns: a new #GstH264NalParser, to be freed with
+ *     gst_h264_nal_parser_free()
+ *
+ * Since: 1.16
+ */
+GstH264NalParser *
+gst_h264_nal_parser_copy (const GstH264NalParser * nalparser)
+{
+  GstH264NalParser *copy;
+  guint i;
+
+  g_return_val_if_fail (nalparser != NULL, NULL);
+
+  copy = gst_h264_nal_parser_new ();
+
+  for (i = 0; i < GST_H264_MAX_SPS_COUNT; i++) {
+    if (nalparser->sps[i].valid)
+      gst_h264_sps_copy (&copy->sps[i], &nalparser->sps[i]);
+  }
+
+  for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++) {
+    const GstH264PPS *pps = &nalparser->pps[i];
+
+    if (!pps->valid)
+      continue;
+
+    gst_h264_pps_copy (&copy->pps[i], pps);
+    /* point to the SPS of the copy */
+    if (pps->sequence >= nalparser->sps &&
+        pps->sequence < nalparser->sps + GST_H264_MAX_SPS_COUNT)
+      copy->pps[i].sequence = copy->sps + (pps->sequence - nalparser->sps);
+  }
+
+  if (nalparser->last_sps)
+    copy->last_sps = copy->sps + (nalparser->last_sps - nalparser->sps);
+  if (nalparser->last_pps)
+    copy->last_pps = copy->pps + (nalparser->last_pps - nalparser->pps);
+
+  return copy;
+}
+
 /**
  * gst_h264_parser_identify_nalu_unchecked:
  * @nalparser: a #GstH264NalParser
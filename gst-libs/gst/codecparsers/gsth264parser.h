@@ -1071,6 +1071,9 @@ GstH264ParserResult gst_h264_parser_parse_sei         (GstH264NalParser *nalpars
 GST_CODEC_PARSERS_API
 void gst_h264_nal_parser_free                         (GstH264NalParser *nalparser);
 
+GST_CODEC_PARSERS_API
+GstH264NalParser *gst_h264_nal_parser_copy            (const GstH264NalParser *nalparser);
+
 GST_CODEC_PARSERS_API
 GstH264ParserResult gst_h264_parse_subset_sps         (GstH264NalUnit *nalu,
                                                        GstH264SPS *sps, gboolean parse_vui_params);
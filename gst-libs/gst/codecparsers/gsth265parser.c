@@ -347,9 +347,31 @@ error:
   return FALSE;
 }
 
+/* Walks over sub_layer_hrd_parameters() without storing anything */
+static gboolean
+gst_h265_skip_sub_layer_hrd_parameters (NalReader * nr, guint8 CpbCnt,
+    guint8 sub_pic_hrd_params_present_flag)
+{
+  guint i, j, n_ue = sub_pic_hrd_params_present_flag ? 4 : 2;
+  guint32 dummy;
+
+  for (i = 0; i <= CpbCnt; i++) {
+    for (j = 0; j < n_ue; j++) {
+      if (!nal_reader_get_ue (nr, &dummy))
+        return FALSE;
+    }
+    /* cbr_flag */
+    if (!nal_reader_skip (nr, 1))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 gst_h265_parse_hrd_parameters (GstH265HRDParams * hrd, NalReader * nr,
-    guint8 commonInfPresentFlag, guint8 maxNumSubLayersMinus1)
+    guint8 commonInfPresentFlag, guint8 maxNumSubLayersMinus1,
+    gboolean skip_sub_layers)
 {
   guint i;
 
@@ -405,6 +427,18 @@ gst_h265_parse_hrd_parameters (GstH265HRDParams * hrd, NalReader * nr,
     if (!hrd->low_delay_hrd_flag[i])
       READ_UE_MAX (nr, hrd->cpb_cnt_minus1[i], 31);
 
+    if (skip_sub_layers) {
+      guint n = hrd->nal_hrd_parameters_present_flag
+          + hrd->vcl_hrd_parameters_present_flag;
+
+      while (n--) {
+        if (!gst_h265_skip_sub_layer_hrd_parameters (nr, hrd->cpb_cnt_minus1[i],
+                hrd->sub_pic_hrd_params_present_flag))
+          goto error;
+      }
+      continue;
+    }
+
     if (hrd->nal_hrd_parameters_present_flag)
       if (!gst_h265_parse_sub_layer_hrd_parameters (&hrd->sublayer_hrd_params
               [i], nr, hrd->cpb_cnt_minus1[i],
@@ -426,7 +460,8 @@ error:
 }
 
 static gboolean
-gst_h265_parse_vui_parameters (GstH265SPS * sps, NalReader * nr)
+gst_h265_parse_vui_parameters (GstH265SPS * sps, NalReader * nr,
+    gboolean skip_sub_layer_hrd)
 {
   GstH265VUIParams *vui = &sps->vui_params;
 
@@ -516,7 +551,7 @@ gst_h265_parse_vui_parameters (GstH265SPS * sps, NalReader * nr)
     READ_UINT8 (nr, vui->hrd_parameters_present_flag, 1);
     if (vui->hrd_parameters_present_flag)
       if (!gst_h265_parse_hrd_parameters (&vui->hrd_params, nr, 1,
-              sps->max_sub_layers_minus1))
+              sps->max_sub_layers_minus1, skip_sub_layer_hrd))
         goto error;
   }
 
@@ -1131,6 +1166,140 @@ gst_h265_parser_free (GstH265Parser * parser)
   parser = NULL;
 }
 
+/**
+ * gst_h265_parser_copy:
+ * @parser: the #GstH265Parser to copy
+ *
+ * Creates a new #GstH265Parser holding the same parameter sets as @parser,
+ * so that parsing can carry on from the current state independently, for
+ * example on several segments of a stream in parallel. Only the parameter
+ * sets in use are copied.
+ *
+ * Returns: a new #GstH265Parser, to be freed with gst_h265_parser_free()
+ *
+ * Since: 1.16
+ */
+GstH265Parser *
+gst_h265_parser_copy (const GstH265Parser * parser)
+{
+  GstH265Parser *copy;
+  guint i;
+
+  g_return_val_if_fail (parser != NULL, NULL);
+
+  copy = gst_h265_parser_new ();
+
+  for (i = 0; i < GST_H265_MAX_VPS_COUNT; i++) {
+    if (parser->vps[i].valid)
+      copy->vps[i] = parser->vps[i];
+  }
+
+  /* the SPS and PPS point to the parameter sets they refer to, make them
+   * point to the ones of the copy */
+  for (i = 0; i < GST_H265_MAX_SPS_COUNT; i++) {
+    const GstH265SPS *sps = &parser->sps[i];
+
+    if (!sps->valid)
+      continue;
+
+    copy->sps[i] = *sps;
+    if (sps->vps >= parser->vps && sps->vps < parser->vps +
+        GST_H265_MAX_VPS_COUNT)
+      copy->sps[i].vps = copy->vps + (sps->vps - parser->vps);
+  }
+
+  for (i = 0; i < GST_H265_MAX_PPS_COUNT; i++) {
+    const GstH265PPS *pps = &parser->pps[i];
+
+    if (!pps->valid)
+      continue;
+
+    copy->pps[i] = *pps;
+    if (pps->sps >= parser->sps && pps->sps < parser->sps +
+        GST_H265_MAX_SPS_COUNT)
+      copy->pps[i].sps = copy->sps + (pps->sps - parser->sps);
+  }
+
+  if (parser->last_vps)
+    copy->last_vps = copy->vps + (parser->last_vps - parser->vps);
+  if (parser->last_sps)
+    copy->last_sps = copy->sps + (parser->last_sps - parser->sps);
+  if (parser->last_pps)
+    copy->last_pps = copy->pps + (parser->last_pps - parser->pps);
+
+  copy->flags = parser->flags;
+  memcpy (copy->sei_payloads, parser->sei_payloads,
+      sizeof (parser->sei_payloads));
+
+  return copy;
+}
+
+/**
+ * gst_h265_parser_set_flags:
+ * @parser: a #GstH265Parser
+ * @flags: the #GstH265ParserFlags to use
+ *
+ * Sets which optional parts of the bitstream @parser skips instead of
+ * parsing them, for callers that only need a few fields (resolution,
+ * framerate, picture types) and want cheaper parsing.
+ *
+ * The flags can be changed at any time. The parts skipped so far can be
+ * parsed on demand by clearing the flags and parsing the NAL unit again,
+ * for example the active SPS with gst_h265_parser_parse_sps() once the HRD
+ * parameters are actually needed.
+ *
+ * Since: 1.16
+ */
+void
+gst_h265_parser_set_flags (GstH265Parser * parser, GstH265ParserFlags flags)
+{
+  g_return_if_fail (parser != NULL);
+
+  parser->flags = flags;
+}
+
+/**
+ * gst_h265_parser_get_flags:
+ * @parser: a #GstH265Parser
+ *
+ * Returns: the #GstH265ParserFlags set on @parser
+ *
+ * Since: 1.16
+ */
+GstH265ParserFlags
+gst_h265_parser_get_flags (GstH265Parser * parser)
+{
+  g_return_val_if_fail (parser != NULL, GST_H265_PARSER_FLAG_NONE);
+
+  return parser->flags;
+}
+
+/**
+ * gst_h265_parser_request_sei_payload:
+ * @parser: a #GstH265Parser
+ * @payload_type: a #GstH265SEIPayloadType, or any other payload type value
+ *   below 256
+ * @request: whether to parse SEI messages of @payload_type
+ *
+ * Selects the SEI payload types parsed by gst_h265_parser_parse_sei() when
+ * %GST_H265_PARSER_FLAG_SKIP_SEI_PAYLOADS is set. No payload type is
+ * requested by default.
+ *
+ * Since: 1.16
+ */
+void
+gst_h265_parser_request_sei_payload (GstH265Parser * parser,
+    guint payload_type, gboolean request)
+{
+  g_return_if_fail (parser != NULL);
+  g_return_if_fail (payload_type < 32 * G_N_ELEMENTS (parser->sei_payloads));
+
+  if (request)
+    parser->sei_payloads[payload_type / 32] |= 1U << (payload_type % 32);
+  else
+    parser->sei_payloads[payload_type / 32] &= ~(1U << (payload_type % 32));
+}
+
 /**
  * gst_h265_parser_identify_nalu_unchecked:
  * @parser: a #GstH265Parser
@@ -1461,7 +1630,7 @@ gst_h265_parse_vps (GstH265NalUnit * nalu, GstH265VPS * vps)
       CHECK_ALLOWED_MAX (vps->hrd_layer_set_idx, 0);
 
       if (!gst_h265_parse_hrd_parameters (&vps->hrd_params, &nr,
-              vps->cprms_present_flag, vps->max_sub_layers_minus1))
+              vps->cprms_present_flag, vps->max_sub_layers_minus1, FALSE))
         goto error;
     }
   }
@@ -1643,7 +1812,10 @@ gst_h265_parse_sps (GstH265Parser * parser, GstH265NalUnit * nalu,
   READ_UINT8 (&nr, sps->vui_parameters_present_flag, 1);
 
   if (sps->vui_parameters_present_flag && parse_vui_params) {
-    if (!gst_h265_parse_vui_parameters (sps, &nr))
+    gboolean skip_hrd = parser
+        && (parser->flags & GST_H265_PARSER_FLAG_SKIP_VUI_SUB_LAYER_HRD);
+
+    if (!gst_h265_parse_vui_parameters (sps, &nr, skip_hrd))
       goto error;
     vui = &sps->vui_params;
   }
@@ -2196,6 +2368,18 @@ nal_reader_has_more_data_in_payload (NalReader * nr,
   return TRUE;
 }
 
+static gboolean
+gst_h265_parser_sei_payload_wanted (GstH265Parser * parser, guint payload_type)
+{
+  if (!(parser->flags & GST_H265_PARSER_FLAG_SKIP_SEI_PAYLOADS))
+    return TRUE;
+
+  if (payload_type >= 32 * G_N_ELEMENTS (parser->sei_payloads))
+    return FALSE;
+
+  return (parser->sei_payloads[payload_type / 32] >> (payload_type % 32)) & 1;
+}
+
 static GstH265ParserResult
 gst_h265_parser_parse_sei_message (GstH265Parser * parser,
     guint8 nal_type, NalReader * nr, GstH265SEIMessage * sei)
@@ -2229,7 +2413,11 @@ gst_h265_parser_parse_sei_message (GstH265Parser * parser,
       ("SEI message received: payloadType  %u, payloadSize = %u bytes",
       sei->payloadType, payload_size);
 
-  if (nal_type == GST_H265_NAL_PREFIX_SEI) {
+  if (!gst_h265_parser_sei_payload_wanted (parser, sei->payloadType)) {
+    GST_DEBUG ("skipping unrequested SEI payload");
+    if (!nal_reader_skip_long (nr, payload_size))
+      goto error;
+  } else if (nal_type == GST_H265_NAL_PREFIX_SEI) {
     switch (sei->payloadType) {
       case GST_H265_SEI_BUF_PERIOD:
         /* size not set; might depend on emulation_prevention_three_byte */
@@ -2412,6 +2600,10 @@ gst_h265_sei_free (GstH265SEIMessage * sei)
  *
  * Parses @data, create and fills the @messages array.
  *
+ * If %GST_H265_PARSER_FLAG_SKIP_SEI_PAYLOADS is set on @nalparser, only the
+ * payload types requested with gst_h265_parser_request_sei_payload() are
+ * parsed and added to @messages, the others are skipped over.
+ *
  * Returns: a #GstH265ParserResult
  */
 GstH265ParserResult
@@ -2430,10 +2622,10 @@ gst_h265_parser_parse_sei (GstH265Parser * nalparser, GstH265NalUnit * nalu,
 
   do {
     res = gst_h265_parser_parse_sei_message (nalparser, nalu->type, &nr, &sei);
-    if (res == GST_H265_PARSER_OK)
-      g_array_append_val (*messages, sei);
-    else
+    if (res != GST_H265_PARSER_OK)
       break;
+    if (gst_h265_parser_sei_payload_wanted (nalparser, sei.payloadType))
+      g_array_append_val (*messages, sei);
   } while (nal_reader_has_more_data (&nr));
 
   return res;
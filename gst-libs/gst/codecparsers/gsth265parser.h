@@ -231,6 +231,27 @@ typedef enum
       /* and more...  */
 } GstH265SEIPayloadType;
 
+/**
+ * GstH265ParserFlags:
+ * @GST_H265_PARSER_FLAG_NONE: parse everything
+ * @GST_H265_PARSER_FLAG_SKIP_VUI_SUB_LAYER_HRD: walk over the per sub-layer
+ *   HRD parameters of the SPS VUI (bit rates and CPB sizes) without storing
+ *   them, #GstH265HRDParams.sublayer_hrd_params is left zeroed. The other
+ *   HRD fields, as needed to parse SEI messages, are still filled.
+ * @GST_H265_PARSER_FLAG_SKIP_SEI_PAYLOADS: only parse the SEI payload types
+ *   requested with gst_h265_parser_request_sei_payload()
+ *
+ * Flags to skip the parts of the bitstream a caller doesn't need.
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_H265_PARSER_FLAG_NONE                   = 0,
+  GST_H265_PARSER_FLAG_SKIP_VUI_SUB_LAYER_HRD = (1 << 0),
+  GST_H265_PARSER_FLAG_SKIP_SEI_PAYLOADS      = (1 << 1)
+} GstH265ParserFlags;
+
 /**
  * GstH265SEIPicStructType:
  * @GST_H265_SEI_PIC_STRUCT_FRAME: Picture is a frame
@@ -1082,6 +1103,9 @@ struct _GstH265Parser
   GstH265VPS *last_vps;
   GstH265SPS *last_sps;
   GstH265PPS *last_pps;
+
+  GstH265ParserFlags flags;
+  guint32 sei_payloads[8];
 };
 
 GST_CODEC_PARSERS_API
@@ -1142,6 +1166,21 @@ GstH265ParserResult gst_h265_parser_parse_sei       (GstH265Parser   * parser,
 GST_CODEC_PARSERS_API
 void                gst_h265_parser_free            (GstH265Parser  * parser);
 
+GST_CODEC_PARSERS_API
+GstH265Parser *     gst_h265_parser_copy            (const GstH265Parser * parser);
+
+GST_CODEC_PARSERS_API
+void                gst_h265_parser_set_flags       (GstH265Parser      * parser,
+                                                     GstH265ParserFlags   flags);
+
+GST_CODEC_PARSERS_API
+GstH265ParserFlags  gst_h265_parser_get_flags       (GstH265Parser      * parser);
+
+GST_CODEC_PARSERS_API
+void                gst_h265_parser_request_sei_payload (GstH265Parser * parser,
+                                                         guint           payload_type,
+                                                         gboolean        request);
+
 GST_CODEC_PARSERS_API
 GstH265ParserResult gst_h265_parse_vps              (GstH265NalUnit * nalu,
                                                      GstH265VPS     * vps);
@@ -0,0 +1,157 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:gstjpegmeta
+ * @title: GstJpegRestartMeta
+ * @short_description: Restart interval index of a JPEG image
+ *
+ * #GstJpegRestartMeta is attached by jpegparse to the images it outputs
+ * when requested, and lists where the restart intervals of each scan are.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstjpegmeta.h"
+
+GST_DEBUG_CATEGORY_STATIC (jpeg_meta_debug);
+#define GST_CAT_DEFAULT jpeg_meta_debug
+
+static gboolean
+gst_jpeg_restart_meta_init (GstJpegRestartMeta * restart_meta,
+    gpointer params, GstBuffer * buffer)
+{
+  restart_meta->restart_interval = 0;
+  restart_meta->n_scans = 0;
+  restart_meta->n_intervals = 0;
+  restart_meta->intervals = NULL;
+
+  return TRUE;
+}
+
+static void
+gst_jpeg_restart_meta_free (GstJpegRestartMeta * restart_meta,
+    GstBuffer * buffer)
+{
+  g_free (restart_meta->intervals);
+}
+
+static gboolean
+gst_jpeg_restart_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstJpegRestartMeta *smeta;
+
+  smeta = (GstJpegRestartMeta *) meta;
+
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = data;
+
+    /* only copy if the complete data is copied as well, the offsets
+     * would be meaningless otherwise */
+    if (!copy->region) {
+      if (!gst_buffer_add_jpeg_restart_meta (dest, smeta->restart_interval,
+              smeta->intervals, smeta->n_intervals))
+        return FALSE;
+    }
+  } else {
+    /* return FALSE, if transform type is not supported */
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+GType
+gst_jpeg_restart_meta_api_get_type (void)
+{
+  static volatile GType type;
+  static const gchar *tags[] = { "memory", NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstJpegRestartMetaAPI", tags);
+    GST_DEBUG_CATEGORY_INIT (jpeg_meta_debug, "jpegmeta", 0,
+        "JPEG restart interval GstMeta");
+
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+const GstMetaInfo *
+gst_jpeg_restart_meta_get_info (void)
+{
+  static const GstMetaInfo *jpeg_restart_meta_info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & jpeg_restart_meta_info)) {
+    const GstMetaInfo *meta =
+        gst_meta_register (GST_JPEG_RESTART_META_API_TYPE,
+        "GstJpegRestartMeta", sizeof (GstJpegRestartMeta),
+        (GstMetaInitFunction) gst_jpeg_restart_meta_init,
+        (GstMetaFreeFunction) gst_jpeg_restart_meta_free,
+        (GstMetaTransformFunction) gst_jpeg_restart_meta_transform);
+    g_once_init_leave ((GstMetaInfo **) & jpeg_restart_meta_info,
+        (GstMetaInfo *) meta);
+  }
+
+  return jpeg_restart_meta_info;
+}
+
+/**
+ * gst_buffer_add_jpeg_restart_meta:
+ * @buffer: a #GstBuffer
+ * @restart_interval: the number of MCUs in each restart interval (Ri)
+ * @intervals: (array length=n_intervals): the restart intervals of the
+ *   image, as filled by gst_jpeg_parse_restart_intervals()
+ * @n_intervals: the number of entries in @intervals
+ *
+ * Creates and adds a #GstJpegRestartMeta to a @buffer. The intervals are
+ * copied.
+ *
+ * Returns: (transfer none): a newly created #GstJpegRestartMeta
+ *
+ * Since: 1.16
+ */
+GstJpegRestartMeta *
+gst_buffer_add_jpeg_restart_meta (GstBuffer * buffer, guint restart_interval,
+    const GstJpegRestartInterval * intervals, guint n_intervals)
+{
+  GstJpegRestartMeta *restart_meta;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (intervals != NULL || n_intervals == 0, NULL);
+
+  restart_meta =
+      (GstJpegRestartMeta *) gst_buffer_add_meta (buffer,
+      GST_JPEG_RESTART_META_INFO, NULL);
+
+  GST_DEBUG ("restart interval %u, %u intervals", restart_interval,
+      n_intervals);
+
+  restart_meta->restart_interval = restart_interval;
+  if (n_intervals > 0) {
+    restart_meta->n_scans = intervals[n_intervals - 1].scan + 1;
+    restart_meta->n_intervals = n_intervals;
+    restart_meta->intervals =
+        g_memdup (intervals, n_intervals * sizeof (GstJpegRestartInterval));
+  }
+
+  return restart_meta;
+}
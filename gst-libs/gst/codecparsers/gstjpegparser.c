@@ -758,3 +758,69 @@ gst_jpeg_parse (GstJpegSegment * segment,
 failed:
   return FALSE;
 }
+
+/**
+ * gst_jpeg_parse_restart_intervals:
+ * @scan_segment: the #GST_JPEG_MARKER_SOS segment, as returned by
+ *   gst_jpeg_parse()
+ * @size: the size of the data the segment was parsed from
+ * @scan: the index of the scan in the image, stored in the intervals
+ * @intervals: (element-type GstJpegRestartInterval): the array to append
+ *   the restart intervals of the scan to
+ * @end_offset: (out) (optional): offset to the marker code that
+ *   terminates the entropy-coded data of the scan
+ *
+ * Walks the entropy-coded data that follows the scan header in
+ * @scan_segment and appends one #GstJpegRestartInterval to @intervals for
+ * each of the RSTn delimited intervals found, or a single one if the image
+ * does not use restart intervals.
+ *
+ * The whole scan must be available in the @size bytes of data, nothing is
+ * appended to @intervals otherwise.
+ *
+ * Returns: TRUE if the end of the entropy-coded data was found.
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_jpeg_parse_restart_intervals (const GstJpegSegment * scan_segment,
+    gsize size, guint scan, GArray * intervals, guint * end_offset)
+{
+  GstJpegRestartInterval interval;
+  guint start, len;
+  gint ofs;
+
+  g_return_val_if_fail (scan_segment != NULL, FALSE);
+  g_return_val_if_fail (scan_segment->marker == GST_JPEG_MARKER_SOS, FALSE);
+  g_return_val_if_fail (intervals != NULL, FALSE);
+
+  if (scan_segment->size < 0)
+    return FALSE;
+
+  start = scan_segment->offset + scan_segment->size;
+  len = intervals->len;
+
+  while (TRUE) {
+    ofs = gst_jpeg_scan_for_marker_code (scan_segment->data, size, start);
+    if (ofs < 0)
+      goto failed;
+
+    interval.scan = scan;
+    interval.offset = start;
+    interval.size = ofs - start;
+    g_array_append_val (intervals, interval);
+
+    if (scan_segment->data[ofs + 1] < GST_JPEG_MARKER_RST_MIN ||
+        scan_segment->data[ofs + 1] > GST_JPEG_MARKER_RST_MAX)
+      break;
+    start = ofs + 2;
+  }
+
+  if (end_offset)
+    *end_offset = ofs;
+  return TRUE;
+
+failed:
+  g_array_set_size (intervals, len);
+  return FALSE;
+}
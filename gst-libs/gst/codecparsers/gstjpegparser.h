@@ -67,6 +67,7 @@ typedef struct _GstJpegScanHdr          GstJpegScanHdr;
 typedef struct _GstJpegFrameComponent   GstJpegFrameComponent;
 typedef struct _GstJpegFrameHdr         GstJpegFrameHdr;
 typedef struct _GstJpegSegment          GstJpegSegment;
+typedef struct _GstJpegRestartInterval  GstJpegRestartInterval;
 
 /**
  * GstJpegMarker:
@@ -375,12 +376,38 @@ struct _GstJpegSegment
   gssize size;
 };
 
+/**
+ * GstJpegRestartInterval:
+ * @scan: Index of the scan the interval belongs to, in decoding order
+ * @offset: Offset to the first byte of entropy-coded data of the interval
+ * @size: Size of the entropy-coded data, without the terminating marker
+ *
+ * Location of the entropy-coded data of one restart interval. The intervals
+ * of a scan are delimited by RSTn markers and, as the DC predictions are
+ * reset at each of them, can be decoded independently of each other.
+ *
+ * Since: 1.16
+ */
+struct _GstJpegRestartInterval
+{
+  guint scan;
+  guint offset;
+  guint size;
+};
+
 GST_CODEC_PARSERS_API
 gboolean  gst_jpeg_parse (GstJpegSegment * seg,
                           const guint8   * data,
                           gsize            size,
                           guint            offset);
 
+GST_CODEC_PARSERS_API
+gboolean  gst_jpeg_parse_restart_intervals (const GstJpegSegment * scan_segment,
+                                            gsize size,
+                                            guint scan,
+                                            GArray * intervals,
+                                            guint * end_offset);
+
 GST_CODEC_PARSERS_API
 gboolean  gst_jpeg_segment_parse_frame_header  (const GstJpegSegment  * segment,
                                                 GstJpegFrameHdr       * frame_hdr);
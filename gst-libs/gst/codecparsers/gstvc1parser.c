@@ -237,6 +237,33 @@ static const VLCTable vc1_norm6_vlc_table[64] = {
   {63, (3 << 1) | 1, 6}
 };
 
+/* Norm-6 codes are up to 13 bits long: lookup table indexed by the next
+ * 13 bits of the bitstream, built from vc1_norm6_vlc_table on first use.
+ * Each entry holds the code length in the upper byte and the tile value in
+ * the lower one, 0 for invalid codes */
+#define NORM6_LUT_BITS 13
+static guint16 vc1_norm6_lut[1 << NORM6_LUT_BITS];
+
+static void
+ensure_norm6_lut (void)
+{
+  static gsize lut_gonce = 0;
+
+  if (g_once_init_enter (&lut_gonce)) {
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS (vc1_norm6_vlc_table); i++) {
+      const VLCTable *e = &vc1_norm6_vlc_table[i];
+      const guint shift = NORM6_LUT_BITS - e->cbits;
+
+      for (j = 0; j < (1 << shift); j++)
+        vc1_norm6_lut[(e->cword << shift) | j] = (e->cbits << 8) | e->value;
+    }
+
+    g_once_init_leave (&lut_gonce, 1);
+  }
+}
+
 /* SMPTE 421M Table 7 */
 typedef struct
 {
@@ -282,12 +309,60 @@ static const guint framerates_d[] = {
 };
 
 
+/* Expands the 8 bits of @bits, most significant first, into one 0 or 1
+ * byte per bit, in memory order once written out in little endian */
+static inline guint64
+spread_bits (guint8 bits)
+{
+  guint64 v = bits * G_GUINT64_CONSTANT (0x0101010101010101);
+
+  v &= G_GUINT64_CONSTANT (0x0102040810204080);
+  v += G_GUINT64_CONSTANT (0x7f7f7f7f7f7f7f7f);
+
+  return (v >> 7) & G_GUINT64_CONSTANT (0x0101010101010101);
+}
+
+/* Reads @n bits into @data, one byte per bit, a word at a time */
+static gboolean
+decode_bits (GstBitReader * br, guint8 * data, guint n, guint invert)
+{
+  const guint64 invert_mask = invert ?
+      G_GUINT64_CONSTANT (0x0101010101010101) : 0;
+  guint8 tmp[8];
+  guint32 v;
+  guint i;
+
+  for (; n >= 32; n -= 32) {
+    READ_UINT32 (br, v, 32);
+    for (i = 0; i < 4; i++, data += 8)
+      GST_WRITE_UINT64_LE (data, spread_bits (v >> (24 - i * 8)) ^
+          invert_mask);
+  }
+
+  for (; n >= 8; n -= 8, data += 8) {
+    READ_UINT32 (br, v, 8);
+    GST_WRITE_UINT64_LE (data, spread_bits (v) ^ invert_mask);
+  }
+
+  if (n) {
+    READ_UINT32 (br, v, n);
+    GST_WRITE_UINT64_LE (tmp, spread_bits (v << (8 - n)) ^ invert_mask);
+    memcpy (data, tmp, n);
+  }
+
+  return TRUE;
+
+failed:
+  return FALSE;
+}
+
 static inline gboolean
 decode_colskip (GstBitReader * br, guint8 * data, guint width, guint height,
     guint stride, guint invert)
 {
-  guint x, y;
-  guint8 colskip, v;
+  guint x, y, i, n;
+  guint8 colskip;
+  guint32 v;
 
   GST_DEBUG ("Parsing colskip");
 
@@ -297,9 +372,12 @@ decode_colskip (GstBitReader * br, guint8 * data, guint width, guint height,
 
     if (data) {
       if (colskip) {
-        for (y = 0; y < height; y++) {
-          READ_UINT8 (br, v, 1);
-          data[y * stride] = v ^ invert;
+        /* the column is strided, fetch it a word at a time and scatter */
+        for (y = 0; y < height; y += n) {
+          n = MIN (height - y, 32);
+          READ_UINT32 (br, v, n);
+          for (i = 0; i < n; i++)
+            data[(y + i) * stride] = ((v >> (n - 1 - i)) & 1) ^ invert;
         }
       } else {
         for (y = 0; y < height; y++)
@@ -322,8 +400,8 @@ static inline gboolean
 decode_rowskip (GstBitReader * br, guint8 * data, guint width, guint height,
     guint stride, guint invert)
 {
-  guint x, y;
-  guint8 rowskip, v;
+  guint y;
+  guint8 rowskip;
 
   GST_DEBUG ("Parsing rowskip");
 
@@ -334,12 +412,8 @@ decode_rowskip (GstBitReader * br, guint8 * data, guint width, guint height,
     if (data) {
       if (!rowskip)
         memset (data, invert, width);
-      else {
-        for (x = 0; x < width; x++) {
-          READ_UINT8 (br, v, 1);
-          data[x] = v ^ invert;
-        }
-      }
+      else if (!decode_bits (br, data, width, invert))
+        goto failed;
       data += stride;
     } else if (rowskip)
       SKIP (br, width);
@@ -428,6 +502,29 @@ failed:
   }
 }
 
+static inline gboolean
+decode_norm6 (GstBitReader * br, guint * res)
+{
+  guint16 e;
+
+  /* close to the end the codes can be shorter than the lookup window */
+  if (gst_bit_reader_get_remaining (br) < NORM6_LUT_BITS)
+    return decode_vlc (br, res, vc1_norm6_vlc_table,
+        G_N_ELEMENTS (vc1_norm6_vlc_table));
+
+  e = vc1_norm6_lut[gst_bit_reader_peek_bits_uint32_unchecked (br,
+          NORM6_LUT_BITS)];
+  if (!e) {
+    GST_WARNING ("Could not decode Norm-6 code");
+    return FALSE;
+  }
+
+  gst_bit_reader_skip_unchecked (br, e >> 8);
+  *res = e & 0xff;
+
+  return TRUE;
+}
+
 /*** bitplanes decoding ***/
 static gboolean
 bitplane_decoding (GstBitReader * br, guint8 * data,
@@ -505,11 +602,12 @@ bitplane_decoding (GstBitReader * br, guint8 * data,
 
       GST_DEBUG ("Parsing IMODE_DIFF6 or IMODE_NORM6 biplane");
 
+      ensure_norm6_lut ();
+
       if (!(height % 3) && (width % 3)) {       /* decode 2x3 "vertical" tiles */
         for (y = 0; y < height; y += 3) {
           for (x = width & 1; x < width; x += 2) {
-            if (!decode_vlc (br, &v, vc1_norm6_vlc_table,
-                    G_N_ELEMENTS (vc1_norm6_vlc_table)))
+            if (!decode_norm6 (br, &v))
               goto failed;
 
             if (pdata) {
@@ -534,8 +632,7 @@ bitplane_decoding (GstBitReader * br, guint8 * data,
           pdata += (height & 1) * stride;
         for (y = height & 1; y < height; y += 2) {
           for (x = width % 3; x < width; x += 3) {
-            if (!decode_vlc (br, &v, vc1_norm6_vlc_table,
-                    G_N_ELEMENTS (vc1_norm6_vlc_table)))
+            if (!decode_norm6 (br, &v))
               goto failed;
 
             if (pdata) {
@@ -664,6 +664,116 @@ gst_vp9_parser_free (GstVp9Parser * parser)
   }
 }
 
+/**
+ * gst_vp9_parser_parse_superframe_info:
+ * @parser: The #GstVp9Parser
+ * @superframe_info: The #GstVp9SuperframeInfo to fill
+ * @data: The data to parse
+ * @size: The size of the @data to parse
+ *
+ * Parses the superframe index at the end of @data, if any, and fills in
+ * @superframe_info with the offset and size of each of the frames packed in
+ * @data. Nothing is copied, the frames can be passed on as ranges of @data
+ * or, with gst_vp9_superframe_info_get_frame_buffer(), as sub-buffers.
+ *
+ * Returns: a #GstVp9ParserResult
+ *
+ * Since: 1.16
+ */
+GstVp9ParserResult
+gst_vp9_parser_parse_superframe_info (GstVp9Parser * parser,
+    GstVp9SuperframeInfo * superframe_info, const guint8 * data, gsize size)
+{
+  guint8 marker;
+  guint32 frames, mag, index_size, offset;
+  const guint8 *index;
+  guint i, j;
+
+  g_return_val_if_fail (parser != NULL, GST_VP9_PARSER_ERROR);
+  g_return_val_if_fail (superframe_info != NULL, GST_VP9_PARSER_ERROR);
+  g_return_val_if_fail (data != NULL, GST_VP9_PARSER_ERROR);
+
+  memset (superframe_info, 0, sizeof (*superframe_info));
+
+  if (size == 0)
+    return GST_VP9_PARSER_BROKEN_DATA;
+
+  /* the superframe marker byte ends the data, and is repeated at the start
+   * of the index */
+  marker = data[size - 1];
+  if ((marker & 0xe0) != 0xc0)
+    goto single_frame;
+
+  frames = (marker & 0x7) + 1;
+  mag = ((marker >> 3) & 0x3) + 1;
+  index_size = 2 + mag * frames;
+
+  if (size < index_size || data[size - index_size] != marker)
+    goto single_frame;
+
+  index = data + size - index_size + 1;
+  offset = 0;
+  for (i = 0; i < frames; i++) {
+    guint32 frame_size = 0;
+
+    for (j = 0; j < mag; j++)
+      frame_size |= (guint32) *index++ << (j * 8);
+
+    if (frame_size > size - index_size - offset) {
+      GST_ERROR ("Invalid superframe, frame %u does not fit in the data", i);
+      return GST_VP9_PARSER_BROKEN_DATA;
+    }
+
+    superframe_info->frame_offsets[i] = offset;
+    superframe_info->frame_sizes[i] = frame_size;
+    offset += frame_size;
+  }
+
+  superframe_info->bytes_per_framesize = mag;
+  superframe_info->frames_in_superframe = frames;
+  superframe_info->superframe_index_size = index_size;
+
+  GST_LOG ("superframe of %u frames, index of %u bytes", frames, index_size);
+
+  return GST_VP9_PARSER_OK;
+
+single_frame:
+  superframe_info->frames_in_superframe = 1;
+  superframe_info->frame_sizes[0] = size;
+
+  return GST_VP9_PARSER_OK;
+}
+
+/**
+ * gst_vp9_superframe_info_get_frame_buffer:
+ * @superframe_info: The #GstVp9SuperframeInfo of @buffer
+ * @buffer: The #GstBuffer holding the superframe
+ * @index: The index of the frame to get
+ *
+ * Creates a sub-buffer of @buffer with the frame number @index of the
+ * superframe described by @superframe_info. The sub-buffer shares the
+ * memory of @buffer, and gets its flags, timestamps and metadata.
+ *
+ * Returns: (transfer full) (nullable): a new #GstBuffer, or %NULL if
+ *   @index is out of range
+ *
+ * Since: 1.16
+ */
+GstBuffer *
+gst_vp9_superframe_info_get_frame_buffer (const GstVp9SuperframeInfo *
+    superframe_info, GstBuffer * buffer, guint index)
+{
+  g_return_val_if_fail (superframe_info != NULL, NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+
+  if (index >= superframe_info->frames_in_superframe)
+    return NULL;
+
+  return gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL,
+      superframe_info->frame_offsets[index],
+      superframe_info->frame_sizes[index]);
+}
+
 /**
  * gst_vp9_parser_parse_frame_header:
  * @parser: The #GstVp9Parser
@@ -61,6 +61,8 @@ G_BEGIN_DECLS
 
 #define GST_VP9_PREDICTION_PROBS   3
 
+#define GST_VP9_MAX_FRAMES_IN_SUPERFRAME 8
+
 typedef struct _GstVp9Parser               GstVp9Parser;
 typedef struct _GstVp9FrameHdr             GstVp9FrameHdr;
 typedef struct _GstVp9LoopFilter           GstVp9LoopFilter;
@@ -68,6 +70,7 @@ typedef struct _GstVp9QuantIndices         GstVp9QuantIndices;
 typedef struct _GstVp9Segmentation         GstVp9Segmentation;
 typedef struct _GstVp9SegmentationInfo     GstVp9SegmentationInfo;
 typedef struct _GstVp9SegmentationInfoData GstVp9SegmentationInfoData;
+typedef struct _GstVp9SuperframeInfo       GstVp9SuperframeInfo;
 
 /**
  * GstVp9ParseResult:
@@ -451,6 +454,30 @@ struct _GstVp9Segmentation
   guint8 reference_skip;
 };
 
+/**
+ * GstVp9SuperframeInfo:
+ * @bytes_per_framesize: the number of bytes used to code each frame size
+ *   in the superframe index, 0 if the data is not a superframe
+ * @frames_in_superframe: the number of frames in the data
+ * @frame_offsets: the offset of each frame from the start of the data
+ * @frame_sizes: the size of each frame
+ * @superframe_index_size: the size of the trailing superframe index
+ *
+ * The location of the frames packed in a VP9 superframe. Data that is not a
+ * superframe is described as a single frame spanning all of it, so that
+ * callers can handle both the same way.
+ *
+ * Since: 1.16
+ */
+struct _GstVp9SuperframeInfo
+{
+  guint32 bytes_per_framesize;
+  guint32 frames_in_superframe;
+  guint32 frame_offsets[GST_VP9_MAX_FRAMES_IN_SUPERFRAME];
+  guint32 frame_sizes[GST_VP9_MAX_FRAMES_IN_SUPERFRAME];
+  guint32 superframe_index_size;
+};
+
 /**
  * GstVp9Parser:
  * @priv: GstVp9ParserPrivate struct to keep track of state variables
@@ -489,6 +516,12 @@ GstVp9Parser *     gst_vp9_parser_new (void);
 GST_CODEC_PARSERS_API
 GstVp9ParserResult gst_vp9_parser_parse_frame_header (GstVp9Parser* parser, GstVp9FrameHdr * frame_hdr, const guint8 * data, gsize size);
 
+GST_CODEC_PARSERS_API
+GstVp9ParserResult gst_vp9_parser_parse_superframe_info (GstVp9Parser * parser, GstVp9SuperframeInfo * superframe_info, const guint8 * data, gsize size);
+
+GST_CODEC_PARSERS_API
+GstBuffer *        gst_vp9_superframe_info_get_frame_buffer (const GstVp9SuperframeInfo * superframe_info, GstBuffer * buffer, guint index);
+
 GST_CODEC_PARSERS_API
 void               gst_vp9_parser_free (GstVp9Parser * parser);
 
@@ -203,24 +203,57 @@ nal_reader_peek_bits_uint##bits (const NalReader *nr, guint##bits *val, guint nb
 
 NAL_READER_PEEK_BITS (8);
 
+static inline guint
+count_leading_zeros32 (guint32 v)
+{
+#if defined (__GNUC__)
+  return __builtin_clz (v);
+#else
+  guint n = 0;
+
+  while (!(v & 0x80000000)) {
+    v <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
 gboolean
 nal_reader_get_ue (NalReader * nr, guint32 * val)
 {
-  guint i = 0;
-  guint8 bit;
-  guint32 value;
+  guint i, avail;
+  guint32 window, value;
+
+  /* Bring up to 32 bits in the cache and decode the code from there: the
+   * prefix length is given by the count of leading zeros, and most codes fit
+   * entirely in the window */
+  avail = MIN (nal_reader_get_remaining (nr), 32);
+  /* The remaining size includes the emulation prevention bytes, so the read
+   * can come short at the end of the NAL, use what made it to the cache */
+  nal_reader_read (nr, avail);
+  avail = MIN (avail, nr->bits_in_cache);
+  if (G_UNLIKELY (avail == 0))
+    return FALSE;
 
-  if (G_UNLIKELY (!nal_reader_get_bits_uint8 (nr, &bit, 1)))
+  window = (((nr->cache << 8) | nr->first_byte) >>
+      (nr->bits_in_cache - avail)) & (G_MAXUINT32 >> (32 - avail));
+  window <<= 32 - avail;
+
+  /* More than 31 leading zeroes, or not enough data for the prefix */
+  if (G_UNLIKELY (window == 0))
     return FALSE;
 
-  while (bit == 0) {
-    i++;
-    if (G_UNLIKELY (!nal_reader_get_bits_uint8 (nr, &bit, 1)))
-      return FALSE;
+  i = count_leading_zeros32 (window);
+
+  if (G_LIKELY (2 * i + 1 <= avail)) {
+    nr->bits_in_cache -= 2 * i + 1;
+    *val = (guint32) ((((guint64) window) >> (31 - 2 * i)) - 1);
+    return TRUE;
   }
 
-  if (G_UNLIKELY (i > 31))
-    return FALSE;
+  /* Long code, consume the prefix and read the suffix separately */
+  nr->bits_in_cache -= i + 1;
 
   if (G_UNLIKELY (!nal_reader_get_bits_uint32 (nr, &value, i)))
     return FALSE;
@@ -297,8 +330,14 @@ nal_reader_has_more_data (NalReader * nr)
 
 /***********  end of nal parser ***************/
 
-gint
-scan_for_start_codes (const guint8 * data, guint size)
+/* The vectorised scanners below look for 00 00 01 at every offset of a
+ * block at once, by comparing the block loaded at offsets 0, 1 and 2 with
+ * each of the bytes of the start code. Like the scalar scan, they only
+ * report start codes followed by at least one byte. The remaining tail is
+ * handled by the scalar scan */
+
+static gint
+scan_for_start_codes_c (const guint8 * data, guint size)
 {
   GstByteReader br;
   gst_byte_reader_init (&br, data, size);
@@ -307,3 +346,125 @@ scan_for_start_codes (const guint8 * data, guint size)
   return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
       0, size);
 }
+
+static inline gint
+scan_for_start_codes_tail (const guint8 * data, guint size, guint offset)
+{
+  gint ret;
+
+  ret = scan_for_start_codes_c (data + offset, size - offset);
+  return ret < 0 ? ret : ret + offset;
+}
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+
+static gint
+scan_for_start_codes_sse2 (const guint8 * data, guint size)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i one = _mm_set1_epi8 (1);
+  guint i = 0;
+
+  /* 16 candidates per block, the last one needs 3 more bytes */
+  for (; i + 16 + 3 <= size; i += 16) {
+    __m128i b0 = _mm_loadu_si128 ((const __m128i *) (data + i));
+    __m128i b1 = _mm_loadu_si128 ((const __m128i *) (data + i + 1));
+    __m128i b2 = _mm_loadu_si128 ((const __m128i *) (data + i + 2));
+    __m128i m = _mm_and_si128 (_mm_and_si128 (_mm_cmpeq_epi8 (b0, zero),
+            _mm_cmpeq_epi8 (b1, zero)), _mm_cmpeq_epi8 (b2, one));
+    gint mask = _mm_movemask_epi8 (m);
+
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+
+  return scan_for_start_codes_tail (data, size, i);
+}
+#endif
+
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_SCAN_AVX2 1
+#include <immintrin.h>
+
+__attribute__ ((target ("avx2")))
+static gint
+scan_for_start_codes_avx2 (const guint8 * data, guint size)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i one = _mm256_set1_epi8 (1);
+  guint i = 0;
+
+  for (; i + 32 + 3 <= size; i += 32) {
+    __m256i b0 = _mm256_loadu_si256 ((const __m256i *) (data + i));
+    __m256i b1 = _mm256_loadu_si256 ((const __m256i *) (data + i + 1));
+    __m256i b2 = _mm256_loadu_si256 ((const __m256i *) (data + i + 2));
+    __m256i m = _mm256_and_si256 (_mm256_and_si256 (_mm256_cmpeq_epi8 (b0,
+                zero), _mm256_cmpeq_epi8 (b1, zero)), _mm256_cmpeq_epi8 (b2,
+            one));
+    guint mask = (guint) _mm256_movemask_epi8 (m);
+
+    if (mask)
+      return i + __builtin_ctz (mask);
+  }
+
+  return scan_for_start_codes_tail (data, size, i);
+}
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+
+static gint
+scan_for_start_codes_neon (const guint8 * data, guint size)
+{
+  const uint8x16_t zero = vdupq_n_u8 (0);
+  const uint8x16_t one = vdupq_n_u8 (1);
+  guint i = 0;
+
+  for (; i + 16 + 3 <= size; i += 16) {
+    uint8x16_t m = vandq_u8 (vandq_u8 (vceqq_u8 (vld1q_u8 (data + i), zero),
+            vceqq_u8 (vld1q_u8 (data + i + 1), zero)),
+        vceqq_u8 (vld1q_u8 (data + i + 2), one));
+    uint64x2_t m64 = vreinterpretq_u64_u8 (m);
+
+    /* No movemask on NEON, find the exact position in the scalar way */
+    if (vgetq_lane_u64 (m64, 0) | vgetq_lane_u64 (m64, 1))
+      return scan_for_start_codes_tail (data, size, i);
+  }
+
+  return scan_for_start_codes_tail (data, size, i);
+}
+#endif
+
+typedef gint (*ScanForStartCodesFunc) (const guint8 * data, guint size);
+
+static ScanForStartCodesFunc
+scan_for_start_codes_get_impl (void)
+{
+#ifdef HAVE_SCAN_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    return scan_for_start_codes_avx2;
+#endif
+#if defined (__SSE2__)
+  return scan_for_start_codes_sse2;
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  return scan_for_start_codes_neon;
+#else
+  return scan_for_start_codes_c;
+#endif
+}
+
+gint
+scan_for_start_codes (const guint8 * data, guint size)
+{
+  static gsize impl = 0;
+
+  if (g_once_init_enter (&impl)) {
+    gsize func = (gsize) scan_for_start_codes_get_impl ();
+    g_once_init_leave (&impl, func);
+  }
+
+  return ((ScanForStartCodesFunc) impl) (data, size);
+}
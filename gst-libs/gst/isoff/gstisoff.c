@@ -198,10 +198,8 @@ gst_isoff_tfhd_box_parse (GstTfhdBox * tfhd, GstByteReader * reader)
 }
 
 static gboolean
-gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
+gst_isoff_trun_box_parse_header (GstTrunBox * trun, GstByteReader * reader)
 {
-  gint i;
-
   memset (trun, 0, sizeof (*trun));
 
   if (gst_byte_reader_get_remaining (reader) < 4)
@@ -216,10 +214,6 @@ gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
   if (!gst_byte_reader_get_uint32_be (reader, &trun->sample_count))
     return FALSE;
 
-  trun->samples =
-      g_array_sized_new (FALSE, FALSE, sizeof (GstTrunSample),
-      trun->sample_count);
-
   if ((trun->flags & GST_TRUN_FLAGS_DATA_OFFSET_PRESENT) &&
       !gst_byte_reader_get_uint32_be (reader, (guint32 *) & trun->data_offset))
     return FALSE;
@@ -228,24 +222,51 @@ gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
       !gst_byte_reader_get_uint32_be (reader, &trun->first_sample_flags))
     return FALSE;
 
-  for (i = 0; i < trun->sample_count; i++) {
-    GstTrunSample sample = { 0, };
+  return TRUE;
+}
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT) &&
-        !gst_byte_reader_get_uint32_be (reader, &sample.sample_duration))
-      goto error;
+static gboolean
+gst_isoff_trun_sample_parse (GstTrunSample * sample, GstTrunFlags flags,
+    GstByteReader * reader)
+{
+  memset (sample, 0, sizeof (*sample));
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT) &&
-        !gst_byte_reader_get_uint32_be (reader, &sample.sample_size))
-      goto error;
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &sample->sample_duration))
+    return FALSE;
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT) &&
-        !gst_byte_reader_get_uint32_be (reader, &sample.sample_flags))
-      goto error;
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_SIZE_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &sample->sample_size))
+    return FALSE;
+
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_FLAGS_PRESENT) &&
+      !gst_byte_reader_get_uint32_be (reader, &sample->sample_flags))
+    return FALSE;
+
+  if ((flags & GST_TRUN_FLAGS_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
+      && !gst_byte_reader_get_uint32_be (reader,
+          &sample->sample_composition_time_offset.u))
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+gst_isoff_trun_box_parse (GstTrunBox * trun, GstByteReader * reader)
+{
+  gint i;
 
-    if ((trun->flags & GST_TRUN_FLAGS_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
-        && !gst_byte_reader_get_uint32_be (reader,
-            &sample.sample_composition_time_offset.u))
+  if (!gst_isoff_trun_box_parse_header (trun, reader))
+    return FALSE;
+
+  trun->samples =
+      g_array_sized_new (FALSE, FALSE, sizeof (GstTrunSample),
+      trun->sample_count);
+
+  for (i = 0; i < trun->sample_count; i++) {
+    GstTrunSample sample;
+
+    if (!gst_isoff_trun_sample_parse (&sample, trun->flags, reader))
       goto error;
 
     g_array_append_val (trun->samples, sample);
@@ -556,6 +577,172 @@ gst_isoff_moof_box_free (GstMoofBox * moof)
   g_free (moof);
 }
 
+/* Looks for the next child box of type @fourcc and sets @sub_reader to its
+ * content */
+static GstIsoffParserResult
+gst_isoff_find_next_box (GstByteReader * reader, guint32 fourcc,
+    GstByteReader * sub_reader)
+{
+  while (gst_byte_reader_get_remaining (reader) > 0) {
+    guint32 type;
+    guint header_size;
+    guint64 size;
+
+    if (!gst_isoff_parse_box_header (reader, &type, NULL, &header_size, &size))
+      return GST_ISOFF_PARSER_ERROR;
+    if (size < header_size
+        || gst_byte_reader_get_remaining (reader) < size - header_size)
+      return GST_ISOFF_PARSER_ERROR;
+
+    if (type == fourcc) {
+      gst_byte_reader_get_sub_reader (reader, sub_reader, size - header_size);
+      return GST_ISOFF_PARSER_OK;
+    }
+
+    gst_byte_reader_skip_unchecked (reader, size - header_size);
+  }
+
+  return GST_ISOFF_PARSER_DONE;
+}
+
+/**
+ * gst_isoff_moof_iterator_init:
+ * @iter: the #GstMoofIterator to initialize
+ * @reader: a #GstByteReader positioned at the content of a moof box
+ *
+ * Prepares @iter to walk the moof without allocating anything. The data of
+ * @reader must stay valid as long as @iter is used.
+ *
+ * Returns: %TRUE if the moof has a valid movie fragment header
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_isoff_moof_iterator_init (GstMoofIterator * iter, GstByteReader * reader)
+{
+  GstByteReader children, sub_reader;
+
+  INITIALIZE_DEBUG_CATEGORY;
+  memset (iter, 0, sizeof (*iter));
+
+  iter->moof = *reader;
+
+  children = iter->moof;
+  if (gst_isoff_find_next_box (&children, GST_ISOFF_FOURCC_MFHD,
+          &sub_reader) != GST_ISOFF_PARSER_OK)
+    return FALSE;
+
+  return gst_isoff_mfhd_box_parse (&iter->mfhd, &sub_reader);
+}
+
+/**
+ * gst_isoff_moof_iterator_next_traf:
+ * @iter: a #GstMoofIterator
+ * @tfhd: (out): the header of the track fragment
+ * @tfdt: (out) (allow-none): the decode time of the track fragment, with
+ *   %GST_CLOCK_TIME_NONE as decode time if there is none
+ *
+ * Moves to the next track fragment. Its runs are then walked with
+ * gst_isoff_moof_iterator_next_trun().
+ *
+ * Returns: %GST_ISOFF_PARSER_OK if there is a next track fragment,
+ *   %GST_ISOFF_PARSER_DONE at the end of the moof or
+ *   %GST_ISOFF_PARSER_ERROR if the data is invalid
+ *
+ * Since: 1.16
+ */
+GstIsoffParserResult
+gst_isoff_moof_iterator_next_traf (GstMoofIterator * iter, GstTfhdBox * tfhd,
+    GstTfdtBox * tfdt)
+{
+  GstIsoffParserResult res;
+  GstByteReader children, sub_reader;
+
+  res = gst_isoff_find_next_box (&iter->moof, GST_ISOFF_FOURCC_TRAF,
+      &iter->traf);
+  if (res != GST_ISOFF_PARSER_OK)
+    return res;
+
+  children = iter->traf;
+  if (gst_isoff_find_next_box (&children, GST_ISOFF_FOURCC_TFHD,
+          &sub_reader) != GST_ISOFF_PARSER_OK
+      || !gst_isoff_tfhd_box_parse (tfhd, &sub_reader))
+    return GST_ISOFF_PARSER_ERROR;
+
+  if (tfdt) {
+    tfdt->decode_time = GST_CLOCK_TIME_NONE;
+    children = iter->traf;
+    res = gst_isoff_find_next_box (&children, GST_ISOFF_FOURCC_TFDT,
+        &sub_reader);
+    if (res == GST_ISOFF_PARSER_ERROR || (res == GST_ISOFF_PARSER_OK
+            && !gst_isoff_tfdt_box_parse (tfdt, &sub_reader)))
+      return GST_ISOFF_PARSER_ERROR;
+  }
+
+  iter->samples_left = 0;
+
+  return GST_ISOFF_PARSER_OK;
+}
+
+/**
+ * gst_isoff_moof_iterator_next_trun:
+ * @iter: a #GstMoofIterator
+ * @trun: (out): the header of the track run, its samples array is not set
+ *
+ * Moves to the next track run of the current track fragment. Its samples
+ * are then read with gst_isoff_moof_iterator_next_sample().
+ *
+ * Returns: %GST_ISOFF_PARSER_OK if there is a next track run,
+ *   %GST_ISOFF_PARSER_DONE at the end of the track fragment or
+ *   %GST_ISOFF_PARSER_ERROR if the data is invalid
+ *
+ * Since: 1.16
+ */
+GstIsoffParserResult
+gst_isoff_moof_iterator_next_trun (GstMoofIterator * iter, GstTrunBox * trun)
+{
+  GstIsoffParserResult res;
+
+  res = gst_isoff_find_next_box (&iter->traf, GST_ISOFF_FOURCC_TRUN,
+      &iter->trun);
+  if (res != GST_ISOFF_PARSER_OK)
+    return res;
+
+  if (!gst_isoff_trun_box_parse_header (trun, &iter->trun))
+    return GST_ISOFF_PARSER_ERROR;
+
+  iter->trun_flags = trun->flags;
+  iter->samples_left = trun->sample_count;
+
+  return GST_ISOFF_PARSER_OK;
+}
+
+/**
+ * gst_isoff_moof_iterator_next_sample:
+ * @iter: a #GstMoofIterator
+ * @sample: (out): the next sample of the current track run
+ *
+ * Returns: %GST_ISOFF_PARSER_OK if there is a next sample,
+ *   %GST_ISOFF_PARSER_DONE at the end of the track run or
+ *   %GST_ISOFF_PARSER_ERROR if the data is invalid
+ *
+ * Since: 1.16
+ */
+GstIsoffParserResult
+gst_isoff_moof_iterator_next_sample (GstMoofIterator * iter,
+    GstTrunSample * sample)
+{
+  if (iter->samples_left == 0)
+    return GST_ISOFF_PARSER_DONE;
+
+  if (!gst_isoff_trun_sample_parse (sample, iter->trun_flags, &iter->trun))
+    return GST_ISOFF_PARSER_ERROR;
+
+  iter->samples_left--;
+
+  return GST_ISOFF_PARSER_OK;
+}
+
 static gboolean
 gst_isoff_mdhd_box_parse (GstMdhdBox * mdhd, GstByteReader * reader)
 {
@@ -192,6 +192,39 @@ GstMoofBox * gst_isoff_moof_box_parse (GstByteReader *reader);
 GST_ISOFF_API
 void gst_isoff_moof_box_free (GstMoofBox *moof);
 
+/**
+ * GstMoofIterator:
+ * @mfhd: the movie fragment header of the moof
+ *
+ * Walks the track fragments, track runs and samples of a moof in place,
+ * without copying them out of the data.
+ *
+ * Since: 1.16
+ */
+typedef struct _GstMoofIterator
+{
+  GstMfhdBox mfhd;
+
+  /*< private >*/
+  GstByteReader moof;
+  GstByteReader traf;
+  GstByteReader trun;
+  GstTrunFlags trun_flags;
+  guint32 samples_left;
+} GstMoofIterator;
+
+GST_ISOFF_API
+gboolean gst_isoff_moof_iterator_init (GstMoofIterator * iter, GstByteReader * reader);
+
+GST_ISOFF_API
+GstIsoffParserResult gst_isoff_moof_iterator_next_traf (GstMoofIterator * iter, GstTfhdBox * tfhd, GstTfdtBox * tfdt);
+
+GST_ISOFF_API
+GstIsoffParserResult gst_isoff_moof_iterator_next_trun (GstMoofIterator * iter, GstTrunBox * trun);
+
+GST_ISOFF_API
+GstIsoffParserResult gst_isoff_moof_iterator_next_sample (GstMoofIterator * iter, GstTrunSample * sample);
+
 typedef struct _GstTkhdBox
 {
   guint32 track_id;
@@ -212,7 +212,7 @@ _parse_eit (GstMpegtsSection * section)
     data += 2;
 
     event->descriptors =
-        gst_mpegts_parse_descriptors (data, descriptors_loop_length);
+        _parse_section_descriptors (section, data, descriptors_loop_length);
     if (event->descriptors == NULL)
       goto error;
     data += descriptors_loop_length;
@@ -335,7 +335,7 @@ _parse_bat (GstMpegtsSection * section)
     goto error;
   }
   bat->descriptors =
-      gst_mpegts_parse_descriptors (data, descriptors_loop_length);
+      _parse_section_descriptors (section, data, descriptors_loop_length);
   if (bat->descriptors == NULL)
     goto error;
   data += descriptors_loop_length;
@@ -387,7 +387,7 @@ _parse_bat (GstMpegtsSection * section)
       goto error;
     }
     stream->descriptors =
-        gst_mpegts_parse_descriptors (data, descriptors_loop_length);
+        _parse_section_descriptors (section, data, descriptors_loop_length);
     if (stream->descriptors == NULL)
       goto error;
 
@@ -516,7 +516,7 @@ _parse_nit (GstMpegtsSection * section)
     goto error;
   }
   nit->descriptors =
-      gst_mpegts_parse_descriptors (data, descriptors_loop_length);
+      _parse_section_descriptors (section, data, descriptors_loop_length);
   if (nit->descriptors == NULL)
     goto error;
   data += descriptors_loop_length;
@@ -568,7 +568,7 @@ _parse_nit (GstMpegtsSection * section)
       goto error;
     }
     stream->descriptors =
-        gst_mpegts_parse_descriptors (data, descriptors_loop_length);
+        _parse_section_descriptors (section, data, descriptors_loop_length);
     if (stream->descriptors == NULL)
       goto error;
 
@@ -897,7 +897,7 @@ _parse_sdt (GstMpegtsSection * section)
       goto error;
     }
     service->descriptors =
-        gst_mpegts_parse_descriptors (data, descriptors_loop_length);
+        _parse_section_descriptors (section, data, descriptors_loop_length);
     if (!service->descriptors)
       goto error;
     data += descriptors_loop_length;
@@ -1180,7 +1180,7 @@ _parse_tot (GstMpegtsSection * section)
 
   desc_len = GST_READ_UINT16_BE (data) & 0xFFF;
   data += 2;
-  tot->descriptors = gst_mpegts_parse_descriptors (data, desc_len);
+  tot->descriptors = _parse_section_descriptors (section, data, desc_len);
 
   return (gpointer) tot;
 }
@@ -39,6 +39,8 @@ G_GNUC_INTERNAL GstMpegtsDescriptor *_new_descriptor_with_extension (guint8 tag,
     guint8 tag_extension, guint8 length);
 G_GNUC_INTERNAL void _packetize_descriptor_array (GPtrArray * array,
     guint8 ** out_data);
+G_GNUC_INTERNAL GPtrArray *_parse_section_descriptors (GstMpegtsSection * section,
+    guint8 * buffer, gsize buf_len);
 G_GNUC_INTERNAL GstMpegtsSection *_gst_mpegts_section_init (guint16 pid, guint8 table_id);
 G_GNUC_INTERNAL void _packetize_common_section (GstMpegtsSection * section, gsize length);
 
@@ -720,26 +720,19 @@ gst_mpegts_descriptor_free (GstMpegtsDescriptor * desc)
   g_slice_free (GstMpegtsDescriptor, desc);
 }
 
+/* Descriptors whose data belongs to the section they were parsed from */
+static void
+_free_borrowed_descriptor (GstMpegtsDescriptor * desc)
+{
+  g_slice_free (GstMpegtsDescriptor, desc);
+}
+
 G_DEFINE_BOXED_TYPE (GstMpegtsDescriptor, gst_mpegts_descriptor,
     (GBoxedCopyFunc) _copy_descriptor,
     (GBoxedFreeFunc) gst_mpegts_descriptor_free);
 
-/**
- * gst_mpegts_parse_descriptors:
- * @buffer: (transfer none): descriptors to parse
- * @buf_len: Size of @buffer
- *
- * Parses the descriptors present in @buffer and returns them as an
- * array.
- *
- * Note: The data provided in @buffer will not be copied.
- *
- * Returns: (transfer full) (element-type GstMpegtsDescriptor): an
- * array of the parsed descriptors or %NULL if there was an error.
- * Release with #g_array_unref when done with it.
- */
-GPtrArray *
-gst_mpegts_parse_descriptors (guint8 * buffer, gsize buf_len)
+static GPtrArray *
+_parse_descriptors (guint8 * buffer, gsize buf_len, gboolean copy)
 {
   GPtrArray *res;
   guint8 length;
@@ -778,8 +771,9 @@ gst_mpegts_parse_descriptors (guint8 * buffer, gsize buf_len)
   }
 
   res =
-      g_ptr_array_new_full (nb_desc + 1,
-      (GDestroyNotify) gst_mpegts_descriptor_free);
+      g_ptr_array_new_full (nb_desc + 1, copy ?
+      (GDestroyNotify) gst_mpegts_descriptor_free :
+      (GDestroyNotify) _free_borrowed_descriptor);
 
   data = buffer;
 
@@ -790,7 +784,8 @@ gst_mpegts_parse_descriptors (guint8 * buffer, gsize buf_len)
     desc->tag = *data++;
     desc->length = *data++;
     /* Copy the data now that we known the size */
-    desc->data = g_memdup (desc->data, desc->length + 2);
+    if (copy)
+      desc->data = g_memdup (desc->data, desc->length + 2);
     GST_LOG ("descriptor 0x%02x length:%d", desc->tag, desc->length);
     GST_MEMDUMP ("descriptor", desc->data + 2, desc->length);
     /* extended descriptors */
@@ -808,6 +803,35 @@ gst_mpegts_parse_descriptors (guint8 * buffer, gsize buf_len)
   return res;
 }
 
+/**
+ * gst_mpegts_parse_descriptors:
+ * @buffer: (transfer none): descriptors to parse
+ * @buf_len: Size of @buffer
+ *
+ * Parses the descriptors present in @buffer and returns them as an
+ * array.
+ *
+ * Note: The data provided in @buffer will not be copied.
+ *
+ * Returns: (transfer full) (element-type GstMpegtsDescriptor): an
+ * array of the parsed descriptors or %NULL if there was an error.
+ * Release with #g_array_unref when done with it.
+ */
+GPtrArray *
+gst_mpegts_parse_descriptors (guint8 * buffer, gsize buf_len)
+{
+  return _parse_descriptors (buffer, buf_len, TRUE);
+}
+
+/* Parses the descriptors of a table, referencing the section data if the
+ * section is in zero-copy mode */
+GPtrArray *
+_parse_section_descriptors (GstMpegtsSection * section, guint8 * buffer,
+    gsize buf_len)
+{
+  return _parse_descriptors (buffer, buf_len, !section->zero_copy);
+}
+
 /**
  * gst_mpegts_find_descriptor:
  * @descriptors: (element-type GstMpegtsDescriptor) (transfer none): an array
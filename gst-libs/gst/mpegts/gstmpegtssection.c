@@ -234,6 +234,37 @@ gst_mpegts_section_get_data (GstMpegtsSection * section)
   return g_bytes_new (section->data, section->section_length);
 }
 
+/**
+ * gst_mpegts_section_set_zero_copy:
+ * @section: a #GstMpegtsSection
+ * @zero_copy: whether to reference the section data
+ *
+ * Sets whether the descriptors of the tables parsed from @section reference
+ * the section data instead of holding a copy of it. This saves one
+ * allocation and copy per descriptor, which adds up on large tables like
+ * the EIT schedule of a whole transponder.
+ *
+ * The parsed tables, and the descriptors they contain, are then only valid
+ * for the lifetime of @section: they must neither be kept nor copied with
+ * their boxed copy function. Descriptors can still be copied individually.
+ *
+ * This only affects the DVB tables (NIT, BAT, SDT, EIT and TOT) and has to be
+ * set before the table is parsed for the first time.
+ *
+ * Since: 1.16
+ */
+void
+gst_mpegts_section_set_zero_copy (GstMpegtsSection * section,
+    gboolean zero_copy)
+{
+  g_return_if_fail (section != NULL);
+
+  if (section->cached_parsed)
+    GST_WARNING ("Section was already parsed, setting zero-copy has no effect");
+
+  section->zero_copy = zero_copy;
+}
+
 /**
  * gst_message_parse_mpegts_section:
  * @message: a #GstMessage
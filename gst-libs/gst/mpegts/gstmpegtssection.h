@@ -172,14 +172,20 @@ struct _GstMpegtsSection
    * sections to that people can create private short sections ? */
   gboolean      short_section;
   GstMpegtsPacketizeFunc packetizer;
+  /* zero_copy: TRUE if the parsed tables reference @data */
+  gboolean      zero_copy;
 
   /* Padding for future extension */
-  gpointer _gst_reserved[GST_PADDING];
+  gpointer _gst_reserved[GST_PADDING - 1];
 };
 
 GST_MPEGTS_API
 GBytes *gst_mpegts_section_get_data (GstMpegtsSection *section);
 
+GST_MPEGTS_API
+void gst_mpegts_section_set_zero_copy (GstMpegtsSection *section,
+                                       gboolean zero_copy);
+
 /* PAT */
 #define GST_TYPE_MPEGTS_PAT_PROGRAM (gst_mpegts_pat_program_get_type())
 
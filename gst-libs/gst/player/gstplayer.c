@@ -49,6 +49,7 @@
 #include "gstplayer-media-info-private.h"
 
 #include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
 #include <gst/video/video.h>
 #include <gst/video/colorbalance.h>
 #include <gst/tag/tag.h>
@@ -67,6 +68,20 @@ GST_DEBUG_CATEGORY_STATIC (gst_player_debug);
 #define DEFAULT_RATE 1.0
 #define DEFAULT_POSITION_UPDATE_INTERVAL_MS 100
 #define DEFAULT_AUDIO_VIDEO_OFFSET 0
+#define DEFAULT_BUFFER_SIZE -1
+#define DEFAULT_BUFFER_DURATION -1
+#define DEFAULT_LATENCY GST_CLOCK_TIME_NONE
+#define DEFAULT_MAX_LATENESS -1
+#define DEFAULT_LIVE_MAX_DRIFT GST_CLOCK_TIME_NONE
+#define DEFAULT_LIVE_CATCH_UP_RATE 1.0
+
+/* values used by gst_player_config_set_low_latency_live() */
+#define LOW_LATENCY_BUFFER_SIZE (64 * 1024)
+#define LOW_LATENCY_BUFFER_DURATION (200 * GST_MSECOND)
+#define LOW_LATENCY_LATENCY (300 * GST_MSECOND)
+#define LOW_LATENCY_MAX_LATENESS (20 * GST_MSECOND)
+#define LOW_LATENCY_LIVE_MAX_DRIFT (200 * GST_MSECOND)
+#define LOW_LATENCY_LIVE_CATCH_UP_RATE 1.1
 
 GQuark
 gst_player_error_quark (void)
@@ -83,6 +98,12 @@ typedef enum
   CONFIG_QUARK_POSITION_INTERVAL_UPDATE,
   CONFIG_QUARK_ACCURATE_SEEK,
   CONFIG_QUARK_FORCE_ASPECT_RATIO,
+  CONFIG_QUARK_BUFFER_SIZE,
+  CONFIG_QUARK_BUFFER_DURATION,
+  CONFIG_QUARK_LATENCY,
+  CONFIG_QUARK_MAX_LATENESS,
+  CONFIG_QUARK_LIVE_MAX_DRIFT,
+  CONFIG_QUARK_LIVE_CATCH_UP_RATE,
 
   CONFIG_QUARK_MAX
 } ConfigQuarkId;
@@ -92,6 +113,12 @@ static const gchar *_config_quark_strings[] = {
   "position-interval-update",
   "accurate-seek",
   "force-aspect-ratio",
+  "buffer-size",
+  "buffer-duration",
+  "latency",
+  "max-lateness",
+  "live-max-drift",
+  "live-catch-up-rate",
 };
 
 GQuark _config_quark_table[CONFIG_QUARK_MAX];
@@ -104,6 +131,7 @@ enum
   PROP_VIDEO_RENDERER,
   PROP_SIGNAL_DISPATCHER,
   PROP_URI,
+  PROP_NEXT_URI,
   PROP_SUBURI,
   PROP_POSITION,
   PROP_DURATION,
@@ -136,6 +164,7 @@ enum
   SIGNAL_VOLUME_CHANGED,
   SIGNAL_MUTE_CHANGED,
   SIGNAL_SEEK_DONE,
+  SIGNAL_LOAD_PHASE,
   SIGNAL_LAST
 };
 
@@ -204,6 +233,19 @@ struct _GstPlayer
   /* When error occur, will set this flag to TRUE,
    * so that it could quit for sync play/stop loop */
   gboolean got_error;
+
+  /* Protected by lock */
+  gchar *next_uri;              /* continued with once uri is about to finish */
+  gchar *gapless_uri;           /* set on playbin but its stream didn't start */
+
+  /* Protected by lock, for reporting the load phases of the current URI */
+  GstClockTime load_start;
+  guint load_phases;
+  GstElement *source;
+
+  /* Protected by lock, factor applied on top of rate while a live stream
+   * catches up with the live edge */
+  gdouble catch_up_rate;
 };
 
 struct _GstPlayerClass
@@ -303,6 +345,8 @@ gst_player_init (GstPlayer * self)
   self->last_seek_time = GST_CLOCK_TIME_NONE;
   self->inhibit_sigs = FALSE;
   self->got_error = FALSE;
+  self->load_start = GST_CLOCK_TIME_NONE;
+  self->catch_up_rate = 1.0;
 
   GST_TRACE_OBJECT (self, "Initialized");
 }
@@ -350,6 +394,10 @@ gst_player_class_init (GstPlayerClass * klass)
   param_specs[PROP_URI] = g_param_spec_string ("uri", "URI", "Current URI",
       DEFAULT_URI, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  param_specs[PROP_NEXT_URI] = g_param_spec_string ("next-uri", "Next URI",
+      "URI to continue with gaplessly once the current one finishes", NULL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
   param_specs[PROP_SUBURI] = g_param_spec_string ("suburi", "Subtitle URI",
       "Current Subtitle URI", NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
@@ -487,6 +535,23 @@ gst_player_class_init (GstPlayerClass * klass)
       G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS, 0, NULL,
       NULL, NULL, G_TYPE_NONE, 1, GST_TYPE_CLOCK_TIME);
 
+  /**
+   * GstPlayer::load-phase:
+   * @player: the #GstPlayer
+   * @phase: the #GstPlayerLoadPhase that was reached
+   * @elapsed: time since loading the URI started
+   *
+   * Emitted once for each phase of loading a URI, with the time elapsed since
+   * the player started loading it or since it switched to it gaplessly.
+   *
+   * Since: 1.16
+   */
+  signals[SIGNAL_LOAD_PHASE] =
+      g_signal_new ("load-phase", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS, 0, NULL,
+      NULL, NULL, G_TYPE_NONE, 2, GST_TYPE_PLAYER_LOAD_PHASE,
+      GST_TYPE_CLOCK_TIME);
+
   config_quark_initialize ();
 }
 
@@ -526,6 +591,10 @@ gst_player_finalize (GObject * object)
   g_free (self->uri);
   g_free (self->redirect_uri);
   g_free (self->suburi);
+  g_free (self->next_uri);
+  g_free (self->gapless_uri);
+  if (self->source)
+    gst_object_unref (self->source);
   g_free (self->video_sid);
   g_free (self->audio_sid);
   g_free (self->subtitle_sid);
@@ -585,6 +654,87 @@ uri_loaded_signal_data_free (UriLoadedSignalData * data)
   g_free (data);
 }
 
+static void
+emit_uri_loaded (GstPlayer * self, const gchar * uri)
+{
+  if (g_signal_handler_find (self, G_SIGNAL_MATCH_ID,
+          signals[SIGNAL_URI_LOADED], 0, NULL, NULL, NULL) != 0) {
+    UriLoadedSignalData *data = g_new (UriLoadedSignalData, 1);
+
+    data->player = g_object_ref (self);
+    data->uri = g_strdup (uri);
+    gst_player_signal_dispatcher_dispatch (self->signal_dispatcher, self,
+        uri_loaded_dispatch, data,
+        (GDestroyNotify) uri_loaded_signal_data_free);
+  }
+}
+
+typedef struct
+{
+  GstPlayer *player;
+  GstPlayerLoadPhase phase;
+  GstClockTime elapsed;
+} LoadPhaseSignalData;
+
+static void
+load_phase_dispatch (gpointer user_data)
+{
+  LoadPhaseSignalData *data = user_data;
+
+  if (data->player->inhibit_sigs)
+    return;
+
+  g_signal_emit (data->player, signals[SIGNAL_LOAD_PHASE], 0, data->phase,
+      data->elapsed);
+}
+
+static void
+load_phase_signal_data_free (LoadPhaseSignalData * data)
+{
+  g_object_unref (data->player);
+  g_free (data);
+}
+
+/* Must be called with lock */
+static void
+gst_player_load_start_locked (GstPlayer * self)
+{
+  self->load_start = gst_util_get_timestamp ();
+  self->load_phases = 0;
+}
+
+/* Reports @phase of the current load, only the first time it is reached */
+static void
+emit_load_phase (GstPlayer * self, GstPlayerLoadPhase phase)
+{
+  GstClockTime elapsed;
+
+  g_mutex_lock (&self->lock);
+  if (!GST_CLOCK_TIME_IS_VALID (self->load_start)
+      || (self->load_phases & (1 << phase))) {
+    g_mutex_unlock (&self->lock);
+    return;
+  }
+  self->load_phases |= 1 << phase;
+  elapsed = gst_util_get_timestamp () - self->load_start;
+  g_mutex_unlock (&self->lock);
+
+  GST_DEBUG_OBJECT (self, "Load phase %s reached after %" GST_TIME_FORMAT,
+      gst_player_load_phase_get_name (phase), GST_TIME_ARGS (elapsed));
+
+  if (g_signal_handler_find (self, G_SIGNAL_MATCH_ID,
+          signals[SIGNAL_LOAD_PHASE], 0, NULL, NULL, NULL) != 0) {
+    LoadPhaseSignalData *data = g_new (LoadPhaseSignalData, 1);
+
+    data->player = g_object_ref (self);
+    data->phase = phase;
+    data->elapsed = elapsed;
+    gst_player_signal_dispatcher_dispatch (self->signal_dispatcher, self,
+        load_phase_dispatch, data,
+        (GDestroyNotify) load_phase_signal_data_free);
+  }
+}
+
 static gboolean
 gst_player_set_uri_internal (gpointer user_data)
 {
@@ -598,16 +748,7 @@ gst_player_set_uri_internal (gpointer user_data)
 
   g_object_set (self->playbin, "uri", self->uri, NULL);
 
-  if (g_signal_handler_find (self, G_SIGNAL_MATCH_ID,
-          signals[SIGNAL_URI_LOADED], 0, NULL, NULL, NULL) != 0) {
-    UriLoadedSignalData *data = g_new (UriLoadedSignalData, 1);
-
-    data->player = g_object_ref (self);
-    data->uri = g_strdup (self->uri);
-    gst_player_signal_dispatcher_dispatch (self->signal_dispatcher, self,
-        uri_loaded_dispatch, data,
-        (GDestroyNotify) uri_loaded_signal_data_free);
-  }
+  emit_uri_loaded (self, self->uri);
 
   g_object_set (self->playbin, "suburi", NULL, NULL);
 
@@ -692,6 +833,9 @@ gst_player_set_property (GObject * object, guint prop_id,
       g_free (self->suburi);
       self->suburi = NULL;
 
+      g_free (self->gapless_uri);
+      self->gapless_uri = NULL;
+
       self->uri = g_value_dup_string (value);
       GST_DEBUG_OBJECT (self, "Set uri=%s", self->uri);
       g_mutex_unlock (&self->lock);
@@ -700,6 +844,13 @@ gst_player_set_property (GObject * object, guint prop_id,
           gst_player_set_uri_internal, self, NULL);
       break;
     }
+    case PROP_NEXT_URI:
+      g_mutex_lock (&self->lock);
+      g_free (self->next_uri);
+      self->next_uri = g_value_dup_string (value);
+      GST_DEBUG_OBJECT (self, "Set next-uri=%s", self->next_uri);
+      g_mutex_unlock (&self->lock);
+      break;
     case PROP_SUBURI:{
       g_mutex_lock (&self->lock);
       g_free (self->suburi);
@@ -760,6 +911,11 @@ gst_player_get_property (GObject * object, guint prop_id,
       g_value_set_string (value, self->uri);
       g_mutex_unlock (&self->lock);
       break;
+    case PROP_NEXT_URI:
+      g_mutex_lock (&self->lock);
+      g_value_set_string (value, self->next_uri);
+      g_mutex_unlock (&self->lock);
+      break;
     case PROP_SUBURI:
       g_mutex_lock (&self->lock);
       g_value_set_string (value, self->suburi);
@@ -936,6 +1092,60 @@ position_updated_signal_data_free (PositionUpdatedSignalData * data)
   g_free (data);
 }
 
+/* Live pipelines that fall behind the live edge accumulate data ahead of the
+ * playback position. Play faster until only the target latency is left. */
+static void
+check_live_drift (GstPlayer * self, gint64 position)
+{
+  GstClockTime max_drift, latency, drift;
+  gdouble catch_up_rate;
+  GstQuery *query;
+  gint64 stop = -1;
+
+  gst_player_config_get_live_catch_up (self->config, &max_drift,
+      &catch_up_rate);
+  if (!GST_CLOCK_TIME_IS_VALID (max_drift) || catch_up_rate <= 1.0)
+    return;
+
+  query = gst_query_new_buffering (GST_FORMAT_TIME);
+  if (gst_element_query (self->playbin, query))
+    gst_query_parse_buffering_range (query, NULL, NULL, &stop, NULL);
+  gst_query_unref (query);
+
+  if (stop == -1 || stop < position)
+    return;
+  drift = stop - position;
+
+  latency = gst_player_config_get_latency (self->config);
+  if (!GST_CLOCK_TIME_IS_VALID (latency))
+    latency = 0;
+
+  g_mutex_lock (&self->lock);
+  if (self->catch_up_rate == 1.0 && drift > latency + max_drift) {
+    gboolean seekable = FALSE;
+
+    query = gst_query_new_seeking (GST_FORMAT_TIME);
+    if (gst_element_query (self->playbin, query))
+      gst_query_parse_seeking (query, NULL, &seekable, NULL, NULL);
+    gst_query_unref (query);
+
+    if (seekable) {
+      GST_DEBUG_OBJECT (self, "Drifted %" GST_TIME_FORMAT " behind live, "
+          "catching up at %.2lf", GST_TIME_ARGS (drift), catch_up_rate);
+      self->catch_up_rate = catch_up_rate;
+      gst_player_set_rate_internal (self);
+    } else {
+      GST_LOG_OBJECT (self, "Drifted %" GST_TIME_FORMAT " behind live but "
+          "can't change the rate", GST_TIME_ARGS (drift));
+    }
+  } else if (self->catch_up_rate != 1.0 && drift <= latency) {
+    GST_DEBUG_OBJECT (self, "Caught up with live");
+    self->catch_up_rate = 1.0;
+    gst_player_set_rate_internal (self);
+  }
+  g_mutex_unlock (&self->lock);
+}
+
 static gboolean
 tick_cb (gpointer user_data)
 {
@@ -958,6 +1168,9 @@ tick_cb (gpointer user_data)
           position_updated_dispatch, data,
           (GDestroyNotify) position_updated_signal_data_free);
     }
+
+    if (self->is_live && self->current_state == GST_STATE_PLAYING)
+      check_live_drift (self, position);
   }
 
   return G_SOURCE_CONTINUE;
@@ -1588,6 +1801,18 @@ state_changed_cb (G_GNUC_UNUSED GstBus * bus, GstMessage * msg,
 
   gst_message_parse_state_changed (msg, &old_state, &new_state, &pending_state);
 
+  if (old_state == GST_STATE_READY && new_state == GST_STATE_PAUSED) {
+    gboolean is_source;
+
+    g_mutex_lock (&self->lock);
+    is_source = self->source
+        && GST_MESSAGE_SRC (msg) == GST_OBJECT (self->source);
+    g_mutex_unlock (&self->lock);
+
+    if (is_source)
+      emit_load_phase (self, GST_PLAYER_LOAD_PHASE_SOURCE_OPENED);
+  }
+
   if (GST_MESSAGE_SRC (msg) == GST_OBJECT (self->playbin)) {
     gchar *transition_name;
 
@@ -1612,6 +1837,8 @@ state_changed_cb (G_GNUC_UNUSED GstBus * bus, GstMessage * msg,
 
       GST_DEBUG_OBJECT (self, "Initial PAUSED - pre-rolled");
 
+      emit_load_phase (self, GST_PLAYER_LOAD_PHASE_PREROLLED);
+
       g_mutex_lock (&self->lock);
       if (self->media_info)
         g_object_unref (self->media_info);
@@ -1694,6 +1921,9 @@ state_changed_cb (G_GNUC_UNUSED GstBus * bus, GstMessage * msg,
         add_tick_source (self);
         change_state (self, GST_PLAYER_STATE_PLAYING);
       }
+
+      /* live pipelines don't preroll, they are ready once playing */
+      emit_load_phase (self, GST_PLAYER_LOAD_PHASE_PREROLLED);
     } else if (new_state == GST_STATE_READY && old_state > GST_STATE_READY) {
       change_state (self, GST_PLAYER_STATE_STOPPED);
     } else {
@@ -2846,10 +3076,47 @@ mute_notify_cb (G_GNUC_UNUSED GObject * obj, G_GNUC_UNUSED GParamSpec * pspec,
   }
 }
 
+static GstPadProbeReturn
+source_buffer_probe_cb (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstPlayer *self = GST_PLAYER (user_data);
+
+  emit_load_phase (self, GST_PLAYER_LOAD_PHASE_FIRST_BUFFER);
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static gboolean
+source_add_buffer_probe (GstElement * source, GstPad * pad, gpointer user_data)
+{
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      source_buffer_probe_cb, user_data, NULL);
+
+  return TRUE;
+}
+
+static void
+source_pad_added_cb (GstElement * source, GstPad * pad, GstPlayer * self)
+{
+  if (GST_PAD_IS_SRC (pad))
+    source_add_buffer_probe (source, pad, self);
+}
+
 static void
 source_setup_cb (GstElement * playbin, GstElement * source, GstPlayer * self)
 {
   gchar *user_agent;
+  GstClockTime latency;
+
+  g_mutex_lock (&self->lock);
+  gst_object_replace ((GstObject **) & self->source, GST_OBJECT (source));
+  g_mutex_unlock (&self->lock);
+
+  gst_element_foreach_src_pad (source, source_add_buffer_probe, self);
+  g_signal_connect (source, "pad-added", G_CALLBACK (source_pad_added_cb),
+      self);
 
   user_agent = gst_player_config_get_user_agent (self->config);
   if (user_agent) {
@@ -2864,6 +3131,123 @@ source_setup_cb (GstElement * playbin, GstElement * source, GstPlayer * self)
 
     g_free (user_agent);
   }
+
+  latency = gst_player_config_get_latency (self->config);
+  if (GST_CLOCK_TIME_IS_VALID (latency)) {
+    GParamSpec *prop;
+
+    /* jitterbuffer based sources like rtspsrc take it in milliseconds */
+    prop = g_object_class_find_property (G_OBJECT_GET_CLASS (source),
+        "latency");
+    if (prop && prop->value_type == G_TYPE_UINT) {
+      GST_INFO_OBJECT (self, "Setting source latency: %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (latency));
+      g_object_set (source, "latency", (guint) (latency / GST_MSECOND), NULL);
+    }
+  }
+}
+
+static void
+element_setup_cb (GstElement * playbin, GstElement * element,
+    GstPlayer * self)
+{
+  gint64 max_lateness;
+
+  if (!GST_IS_BASE_SINK (element))
+    return;
+
+  max_lateness = gst_player_config_get_max_lateness (self->config);
+  if (max_lateness != DEFAULT_MAX_LATENESS) {
+    GST_INFO_OBJECT (self, "Setting max-lateness %" G_GINT64_FORMAT " on %"
+        GST_PTR_FORMAT, max_lateness, element);
+    gst_base_sink_set_max_lateness (GST_BASE_SINK (element), max_lateness);
+    gst_base_sink_set_qos_enabled (GST_BASE_SINK (element), TRUE);
+  }
+}
+
+/* Called whenever the pipeline is started from below PAUSED, the config
+ * can't change while playing */
+static void
+gst_player_apply_config (GstPlayer * self)
+{
+  GstClockTime latency;
+
+  g_object_set (self->playbin,
+      "buffer-size", gst_player_config_get_buffer_size (self->config),
+      "buffer-duration", gst_player_config_get_buffer_duration (self->config),
+      NULL);
+
+  /* GST_CLOCK_TIME_NONE goes back to the latency the pipeline reports */
+  latency = gst_player_config_get_latency (self->config);
+  gst_pipeline_set_latency (GST_PIPELINE (self->playbin), latency);
+}
+
+/* Called from a streaming thread when playbin needs the next URI to continue
+ * gaplessly */
+static void
+about_to_finish_cb (GstElement * playbin, GstPlayer * self)
+{
+  g_mutex_lock (&self->lock);
+  if (self->next_uri) {
+    GST_DEBUG_OBJECT (self, "Continuing gaplessly with '%s'", self->next_uri);
+
+    g_free (self->gapless_uri);
+    self->gapless_uri = self->next_uri;
+    self->next_uri = NULL;
+    g_object_set (self->playbin, "uri", self->gapless_uri, "suburi", NULL,
+        NULL);
+    gst_player_load_start_locked (self);
+  }
+  g_mutex_unlock (&self->lock);
+}
+
+static void
+stream_start_cb (G_GNUC_UNUSED GstBus * bus, GstMessage * msg,
+    gpointer user_data)
+{
+  GstPlayer *self = GST_PLAYER (user_data);
+  gint64 duration = -1;
+  gchar *uri;
+
+  if (GST_MESSAGE_SRC (msg) != GST_OBJECT (self->playbin))
+    return;
+
+  g_mutex_lock (&self->lock);
+  if (!self->gapless_uri) {
+    g_mutex_unlock (&self->lock);
+    return;
+  }
+
+  /* the stream of the preloaded next URI started playing */
+  GST_DEBUG_OBJECT (self, "Switched to '%s'", self->gapless_uri);
+
+  g_free (self->uri);
+  self->uri = self->gapless_uri;
+  self->gapless_uri = NULL;
+  g_free (self->redirect_uri);
+  self->redirect_uri = NULL;
+  g_free (self->suburi);
+  self->suburi = NULL;
+  uri = g_strdup (self->uri);
+
+  if (self->global_tags) {
+    gst_tag_list_unref (self->global_tags);
+    self->global_tags = NULL;
+  }
+  if (self->media_info)
+    g_object_unref (self->media_info);
+  self->media_info = gst_player_media_info_create (self);
+  g_mutex_unlock (&self->lock);
+
+  emit_uri_loaded (self, uri);
+  g_free (uri);
+
+  emit_media_info_updated_signal (self);
+  check_video_dimensions_changed (self);
+  if (gst_element_query_duration (self->playbin, GST_FORMAT_TIME, &duration))
+    emit_duration_changed (self, duration);
+  else
+    self->cached_duration = GST_CLOCK_TIME_NONE;
 }
 
 static gpointer
@@ -2939,6 +3323,8 @@ gst_player_main (gpointer data)
   g_signal_connect (G_OBJECT (bus), "message::element",
       G_CALLBACK (element_cb), self);
   g_signal_connect (G_OBJECT (bus), "message::tag", G_CALLBACK (tags_cb), self);
+  g_signal_connect (G_OBJECT (bus), "message::stream-start",
+      G_CALLBACK (stream_start_cb), self);
 
   if (self->use_playbin3) {
     g_signal_connect (G_OBJECT (bus), "message::stream-collection",
@@ -2967,6 +3353,10 @@ gst_player_main (gpointer data)
       G_CALLBACK (mute_notify_cb), self);
   g_signal_connect (self->playbin, "source-setup",
       G_CALLBACK (source_setup_cb), self);
+  g_signal_connect (self->playbin, "about-to-finish",
+      G_CALLBACK (about_to_finish_cb), self);
+  g_signal_connect (self->playbin, "element-setup",
+      G_CALLBACK (element_setup_cb), self);
 
   self->target_state = GST_STATE_NULL;
   self->current_state = GST_STATE_NULL;
@@ -3077,8 +3467,14 @@ gst_player_play_internal (gpointer user_data)
   remove_ready_timeout_source (self);
   self->target_state = GST_STATE_PLAYING;
 
-  if (self->current_state < GST_STATE_PAUSED)
+  if (self->current_state < GST_STATE_PAUSED) {
+    g_mutex_lock (&self->lock);
+    if (!GST_CLOCK_TIME_IS_VALID (self->load_start))
+      gst_player_load_start_locked (self);
+    g_mutex_unlock (&self->lock);
+    gst_player_apply_config (self);
     change_state (self, GST_PLAYER_STATE_BUFFERING);
+  }
 
   if (self->current_state >= GST_STATE_PAUSED && !self->is_eos
       && self->buffering >= 100 && !(self->seek_position != GST_CLOCK_TIME_NONE
@@ -3155,8 +3551,14 @@ gst_player_pause_internal (gpointer user_data)
 
   self->target_state = GST_STATE_PAUSED;
 
-  if (self->current_state < GST_STATE_PAUSED)
+  if (self->current_state < GST_STATE_PAUSED) {
+    g_mutex_lock (&self->lock);
+    if (!GST_CLOCK_TIME_IS_VALID (self->load_start))
+      gst_player_load_start_locked (self);
+    g_mutex_unlock (&self->lock);
+    gst_player_apply_config (self);
     change_state (self, GST_PLAYER_STATE_BUFFERING);
+  }
 
   state_ret = gst_element_set_state (self->playbin, GST_STATE_PAUSED);
   if (state_ret == GST_STATE_CHANGE_FAILURE) {
@@ -3242,6 +3644,20 @@ gst_player_stop_internal (GstPlayer * self, gboolean transient)
   self->seek_position = GST_CLOCK_TIME_NONE;
   self->last_seek_time = GST_CLOCK_TIME_NONE;
   self->rate = 1.0;
+  self->catch_up_rate = 1.0;
+  self->load_start = GST_CLOCK_TIME_NONE;
+  if (self->source) {
+    gst_object_unref (self->source);
+    self->source = NULL;
+  }
+  /* playbin may have switched to the next URI already, go back to the
+   * current one as its stream never started */
+  if (self->gapless_uri) {
+    g_free (self->gapless_uri);
+    self->gapless_uri = NULL;
+    g_object_set (self->playbin, "uri",
+        self->redirect_uri ? self->redirect_uri : self->uri, NULL);
+  }
   if (self->collection) {
     if (self->stream_notify_id)
       g_signal_handler_disconnect (self->collection, self->stream_notify_id);
@@ -3323,7 +3739,7 @@ gst_player_seek_internal_locked (GstPlayer * self)
   position = self->seek_position;
   self->seek_position = GST_CLOCK_TIME_NONE;
   self->seek_pending = TRUE;
-  rate = self->rate;
+  rate = self->rate * self->catch_up_rate;
   g_mutex_unlock (&self->lock);
 
   remove_tick_source (self);
@@ -3512,6 +3928,49 @@ gst_player_set_uri (GstPlayer * self, const gchar * val)
   g_object_set (self, "uri", val, NULL);
 }
 
+/**
+ * gst_player_set_next_uri:
+ * @player: #GstPlayer instance
+ * @uri: (allow-none): URI to continue with, or %NULL
+ *
+ * Sets the URI to continue with once the current one is about to finish.
+ * The next URI is preloaded while the current one is still playing and
+ * playback continues without a gap. #GstPlayer::uri-loaded is emitted when
+ * the player actually switched to it.
+ *
+ * Since: 1.16
+ */
+void
+gst_player_set_next_uri (GstPlayer * self, const gchar * uri)
+{
+  g_return_if_fail (GST_IS_PLAYER (self));
+
+  g_object_set (self, "next-uri", uri, NULL);
+}
+
+/**
+ * gst_player_get_next_uri:
+ * @player: #GstPlayer instance
+ *
+ * Gets the URI set with gst_player_set_next_uri() that was not switched to
+ * yet.
+ *
+ * Returns: (transfer full) (nullable): the next URI. g_free() after usage.
+ *
+ * Since: 1.16
+ */
+gchar *
+gst_player_get_next_uri (GstPlayer * self)
+{
+  gchar *val = NULL;
+
+  g_return_val_if_fail (GST_IS_PLAYER (self), NULL);
+
+  g_object_get (self, "next-uri", &val, NULL);
+
+  return val;
+}
+
 /**
  * gst_player_set_subtitle_uri:
  * @player: #GstPlayer instance
@@ -4416,6 +4875,54 @@ gst_player_state_get_type (void)
   return (GType) id;
 }
 
+GType
+gst_player_load_phase_get_type (void)
+{
+  static gsize id = 0;
+  static const GEnumValue values[] = {
+    {C_ENUM (GST_PLAYER_LOAD_PHASE_SOURCE_OPENED),
+        "GST_PLAYER_LOAD_PHASE_SOURCE_OPENED", "source-opened"},
+    {C_ENUM (GST_PLAYER_LOAD_PHASE_FIRST_BUFFER),
+        "GST_PLAYER_LOAD_PHASE_FIRST_BUFFER", "first-buffer"},
+    {C_ENUM (GST_PLAYER_LOAD_PHASE_PREROLLED),
+        "GST_PLAYER_LOAD_PHASE_PREROLLED", "prerolled"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&id)) {
+    GType tmp = g_enum_register_static ("GstPlayerLoadPhase", values);
+    g_once_init_leave (&id, tmp);
+  }
+
+  return (GType) id;
+}
+
+/**
+ * gst_player_load_phase_get_name:
+ * @phase: a #GstPlayerLoadPhase
+ *
+ * Gets a string representing the given load phase.
+ *
+ * Returns: (transfer none): a string with the name of the load phase.
+ *
+ * Since: 1.16
+ */
+const gchar *
+gst_player_load_phase_get_name (GstPlayerLoadPhase phase)
+{
+  switch (phase) {
+    case GST_PLAYER_LOAD_PHASE_SOURCE_OPENED:
+      return "source-opened";
+    case GST_PLAYER_LOAD_PHASE_FIRST_BUFFER:
+      return "first-buffer";
+    case GST_PLAYER_LOAD_PHASE_PREROLLED:
+      return "prerolled";
+  }
+
+  g_assert_not_reached ();
+  return NULL;
+}
+
 /**
  * gst_player_state_get_name:
  * @state: a #GstPlayerState
@@ -4680,6 +5187,253 @@ gst_player_config_get_seek_accurate (const GstStructure * config)
   return accurate;
 }
 
+/**
+ * gst_player_config_set_buffer_size:
+ * @config: a #GstPlayer configuration
+ * @size: buffer size in bytes, or -1 for the default
+ *
+ * Sets the amount of data buffered for network streams.
+ *
+ * Since: 1.16
+ */
+void
+gst_player_config_set_buffer_size (GstStructure * config, gint size)
+{
+  g_return_if_fail (config != NULL);
+  g_return_if_fail (size >= -1);
+
+  gst_structure_id_set (config,
+      CONFIG_QUARK (BUFFER_SIZE), G_TYPE_INT, size, NULL);
+}
+
+/**
+ * gst_player_config_get_buffer_size:
+ * @config: a #GstPlayer configuration
+ *
+ * Returns: the buffer size in bytes, or -1 for the default
+ *
+ * Since: 1.16
+ */
+gint
+gst_player_config_get_buffer_size (const GstStructure * config)
+{
+  gint size = DEFAULT_BUFFER_SIZE;
+
+  g_return_val_if_fail (config != NULL, DEFAULT_BUFFER_SIZE);
+
+  gst_structure_id_get (config,
+      CONFIG_QUARK (BUFFER_SIZE), G_TYPE_INT, &size, NULL);
+
+  return size;
+}
+
+/**
+ * gst_player_config_set_buffer_duration:
+ * @config: a #GstPlayer configuration
+ * @duration: buffer duration in nanoseconds, or -1 for the default
+ *
+ * Sets the duration of data buffered for network streams.
+ *
+ * Since: 1.16
+ */
+void
+gst_player_config_set_buffer_duration (GstStructure * config, gint64 duration)
+{
+  g_return_if_fail (config != NULL);
+  g_return_if_fail (duration >= -1);
+
+  gst_structure_id_set (config,
+      CONFIG_QUARK (BUFFER_DURATION), G_TYPE_INT64, duration, NULL);
+}
+
+/**
+ * gst_player_config_get_buffer_duration:
+ * @config: a #GstPlayer configuration
+ *
+ * Returns: the buffer duration in nanoseconds, or -1 for the default
+ *
+ * Since: 1.16
+ */
+gint64
+gst_player_config_get_buffer_duration (const GstStructure * config)
+{
+  gint64 duration = DEFAULT_BUFFER_DURATION;
+
+  g_return_val_if_fail (config != NULL, DEFAULT_BUFFER_DURATION);
+
+  gst_structure_id_get (config,
+      CONFIG_QUARK (BUFFER_DURATION), G_TYPE_INT64, &duration, NULL);
+
+  return duration;
+}
+
+/**
+ * gst_player_config_set_latency:
+ * @config: a #GstPlayer configuration
+ * @latency: target end-to-end latency, or %GST_CLOCK_TIME_NONE
+ *
+ * Sets the end-to-end latency of the pipeline instead of the minimum latency
+ * the elements report. It is also passed on to sources with a jitterbuffer
+ * and is the drift live streams catch up to, see
+ * gst_player_config_set_live_catch_up().
+ *
+ * Since: 1.16
+ */
+void
+gst_player_config_set_latency (GstStructure * config, GstClockTime latency)
+{
+  g_return_if_fail (config != NULL);
+
+  gst_structure_id_set (config,
+      CONFIG_QUARK (LATENCY), G_TYPE_UINT64, latency, NULL);
+}
+
+/**
+ * gst_player_config_get_latency:
+ * @config: a #GstPlayer configuration
+ *
+ * Returns: the target latency, or %GST_CLOCK_TIME_NONE if the pipeline
+ * latency is used
+ *
+ * Since: 1.16
+ */
+GstClockTime
+gst_player_config_get_latency (const GstStructure * config)
+{
+  GstClockTime latency = DEFAULT_LATENCY;
+
+  g_return_val_if_fail (config != NULL, DEFAULT_LATENCY);
+
+  gst_structure_id_get (config,
+      CONFIG_QUARK (LATENCY), G_TYPE_UINT64, &latency, NULL);
+
+  return latency;
+}
+
+/**
+ * gst_player_config_set_max_lateness:
+ * @config: a #GstPlayer configuration
+ * @max_lateness: maximum lateness in nanoseconds, or -1 for the sink default
+ *
+ * Sets how late buffers may be before the sinks drop them. Setting it also
+ * enables QoS on the sinks so upstream skips data that would be late anyway.
+ *
+ * Since: 1.16
+ */
+void
+gst_player_config_set_max_lateness (GstStructure * config,
+    gint64 max_lateness)
+{
+  g_return_if_fail (config != NULL);
+  g_return_if_fail (max_lateness >= -1);
+
+  gst_structure_id_set (config,
+      CONFIG_QUARK (MAX_LATENESS), G_TYPE_INT64, max_lateness, NULL);
+}
+
+/**
+ * gst_player_config_get_max_lateness:
+ * @config: a #GstPlayer configuration
+ *
+ * Returns: the maximum lateness in nanoseconds, or -1 for the sink default
+ *
+ * Since: 1.16
+ */
+gint64
+gst_player_config_get_max_lateness (const GstStructure * config)
+{
+  gint64 max_lateness = DEFAULT_MAX_LATENESS;
+
+  g_return_val_if_fail (config != NULL, DEFAULT_MAX_LATENESS);
+
+  gst_structure_id_get (config,
+      CONFIG_QUARK (MAX_LATENESS), G_TYPE_INT64, &max_lateness, NULL);
+
+  return max_lateness;
+}
+
+/**
+ * gst_player_config_set_live_catch_up:
+ * @config: a #GstPlayer configuration
+ * @max_drift: drift behind the target latency that triggers catching up, or
+ *     %GST_CLOCK_TIME_NONE to disable it
+ * @rate: rate to play at while catching up
+ *
+ * Live streams that fell behind the live edge by more than @max_drift on top
+ * of the target latency are played at @rate until the data buffered ahead of
+ * the playback position is down to the target latency again. This needs
+ * live sources that can change the rate, like adaptive streaming ones.
+ *
+ * Since: 1.16
+ */
+void
+gst_player_config_set_live_catch_up (GstStructure * config,
+    GstClockTime max_drift, gdouble rate)
+{
+  g_return_if_fail (config != NULL);
+  g_return_if_fail (rate >= 1.0);
+
+  gst_structure_id_set (config,
+      CONFIG_QUARK (LIVE_MAX_DRIFT), G_TYPE_UINT64, max_drift,
+      CONFIG_QUARK (LIVE_CATCH_UP_RATE), G_TYPE_DOUBLE, rate, NULL);
+}
+
+/**
+ * gst_player_config_get_live_catch_up:
+ * @config: a #GstPlayer configuration
+ * @max_drift: (out) (allow-none): the drift that triggers catching up
+ * @rate: (out) (allow-none): the rate to play at while catching up
+ *
+ * Gets the values set with gst_player_config_set_live_catch_up().
+ *
+ * Since: 1.16
+ */
+void
+gst_player_config_get_live_catch_up (const GstStructure * config,
+    GstClockTime * max_drift, gdouble * rate)
+{
+  GstClockTime drift = DEFAULT_LIVE_MAX_DRIFT;
+  gdouble catch_up_rate = DEFAULT_LIVE_CATCH_UP_RATE;
+
+  g_return_if_fail (config != NULL);
+
+  gst_structure_id_get (config,
+      CONFIG_QUARK (LIVE_MAX_DRIFT), G_TYPE_UINT64, &drift,
+      CONFIG_QUARK (LIVE_CATCH_UP_RATE), G_TYPE_DOUBLE, &catch_up_rate, NULL);
+
+  if (max_drift)
+    *max_drift = drift;
+  if (rate)
+    *rate = catch_up_rate;
+}
+
+/**
+ * gst_player_config_set_low_latency_live:
+ * @config: a #GstPlayer configuration
+ *
+ * Configures @config for playing live streams with low latency: small
+ * network buffers, a 300ms target latency, sinks dropping frames that are
+ * more than 20ms late and catching up at rate 1.1 once playback drifted
+ * more than 200ms behind the target latency.
+ *
+ * The individual settings can be changed afterwards with the other
+ * gst_player_config_set_*() functions.
+ *
+ * Since: 1.16
+ */
+void
+gst_player_config_set_low_latency_live (GstStructure * config)
+{
+  g_return_if_fail (config != NULL);
+
+  gst_player_config_set_buffer_size (config, LOW_LATENCY_BUFFER_SIZE);
+  gst_player_config_set_buffer_duration (config, LOW_LATENCY_BUFFER_DURATION);
+  gst_player_config_set_latency (config, LOW_LATENCY_LATENCY);
+  gst_player_config_set_max_lateness (config, LOW_LATENCY_MAX_LATENESS);
+  gst_player_config_set_live_catch_up (config, LOW_LATENCY_LIVE_MAX_DRIFT,
+      LOW_LATENCY_LIVE_CATCH_UP_RATE);
+}
+
 /**
  * gst_player_get_video_snapshot:
  * @player: #GstPlayer instance
@@ -96,6 +96,32 @@ typedef enum
 GST_PLAYER_API
 const gchar *gst_player_color_balance_type_get_name   (GstPlayerColorBalanceType type);
 
+GST_PLAYER_API
+GType        gst_player_load_phase_get_type           (void);
+#define      GST_TYPE_PLAYER_LOAD_PHASE               (gst_player_load_phase_get_type ())
+
+/**
+ * GstPlayerLoadPhase:
+ * @GST_PLAYER_LOAD_PHASE_SOURCE_OPENED: the source element of the URI
+ * started.
+ * @GST_PLAYER_LOAD_PHASE_FIRST_BUFFER: the source produced its first buffer.
+ * @GST_PLAYER_LOAD_PHASE_PREROLLED: the pipeline is prerolled and ready to
+ * play.
+ *
+ * Phases of loading a URI, reported by the #GstPlayer::load-phase signal.
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_PLAYER_LOAD_PHASE_SOURCE_OPENED,
+  GST_PLAYER_LOAD_PHASE_FIRST_BUFFER,
+  GST_PLAYER_LOAD_PHASE_PREROLLED
+} GstPlayerLoadPhase;
+
+GST_PLAYER_API
+const gchar *gst_player_load_phase_get_name           (GstPlayerLoadPhase phase);
+
 #define GST_TYPE_PLAYER             (gst_player_get_type ())
 #define GST_IS_PLAYER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GST_TYPE_PLAYER))
 #define GST_IS_PLAYER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), GST_TYPE_PLAYER))
@@ -134,6 +160,13 @@ gdouble      gst_player_get_rate                      (GstPlayer    * player);
 GST_PLAYER_API
 gchar *      gst_player_get_uri                       (GstPlayer    * player);
 
+GST_PLAYER_API
+void         gst_player_set_next_uri                  (GstPlayer    * player,
+                                                       const gchar  * uri);
+
+GST_PLAYER_API
+gchar *      gst_player_get_next_uri                  (GstPlayer    * player);
+
 GST_PLAYER_API
 void         gst_player_set_uri                       (GstPlayer    * player,
                                                        const gchar  * uri);
@@ -278,6 +311,47 @@ void           gst_player_config_set_seek_accurate (GstPlayer * player, gboolean
 GST_PLAYER_API
 gboolean       gst_player_config_get_seek_accurate (const GstStructure * config);
 
+GST_PLAYER_API
+void           gst_player_config_set_buffer_size      (GstStructure * config,
+                                                       gint           size);
+
+GST_PLAYER_API
+gint           gst_player_config_get_buffer_size      (const GstStructure * config);
+
+GST_PLAYER_API
+void           gst_player_config_set_buffer_duration  (GstStructure * config,
+                                                       gint64         duration);
+
+GST_PLAYER_API
+gint64         gst_player_config_get_buffer_duration  (const GstStructure * config);
+
+GST_PLAYER_API
+void           gst_player_config_set_latency          (GstStructure * config,
+                                                       GstClockTime   latency);
+
+GST_PLAYER_API
+GstClockTime   gst_player_config_get_latency          (const GstStructure * config);
+
+GST_PLAYER_API
+void           gst_player_config_set_max_lateness     (GstStructure * config,
+                                                       gint64         max_lateness);
+
+GST_PLAYER_API
+gint64         gst_player_config_get_max_lateness     (const GstStructure * config);
+
+GST_PLAYER_API
+void           gst_player_config_set_live_catch_up    (GstStructure * config,
+                                                       GstClockTime   max_drift,
+                                                       gdouble        rate);
+
+GST_PLAYER_API
+void           gst_player_config_get_live_catch_up    (const GstStructure * config,
+                                                       GstClockTime * max_drift,
+                                                       gdouble      * rate);
+
+GST_PLAYER_API
+void           gst_player_config_set_low_latency_live (GstStructure * config);
+
 typedef enum
 {
   GST_PLAYER_THUMBNAIL_RAW_NATIVE = 0,
@@ -0,0 +1,182 @@
+/* GStreamer
+ *
+ * stripe-threads-private.h: run a function over the rows of a frame in
+ * stripes handled by a thread pool
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __STRIPE_THREADS_PRIVATE_H__
+#define __STRIPE_THREADS_PRIVATE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Shared by the video filters with a "n-threads" property. The element
+ * embeds a GstStripeThreads, sets n_threads from the property (0 meaning
+ * one thread per processor) and calls gst_stripe_threads_run() for each
+ * frame, or gst_stripe_threads_run_stripes() when it keeps a result per
+ * stripe. The thread pool is only created once a frame is split. */
+
+typedef struct _GstStripeThreads GstStripeThreads;
+
+/* Processes rows [first, last), which make up stripe number @stripe */
+typedef void (*GstStripeFunc) (gpointer user_data, guint stripe, gint first,
+    gint last);
+
+struct _GstStripeThreads
+{
+  guint n_threads;
+
+  GThreadPool *pool;
+  GMutex lock;
+  GCond cond;
+  gint pending;
+};
+
+typedef struct
+{
+  GstStripeThreads *threads;
+  GstStripeFunc func;
+  gpointer user_data;
+  guint stripe;
+  gint first;
+  gint last;
+} GstStripe;
+
+static inline void
+gst_stripe_threads_run_stripe (gpointer data, gpointer user_data)
+{
+  /* casts for the C++ elements */
+  GstStripe *stripe = (GstStripe *) data;
+  GstStripeThreads *threads = (GstStripeThreads *) user_data;
+
+  stripe->func (stripe->user_data, stripe->stripe, stripe->first,
+      stripe->last);
+
+  g_mutex_lock (&threads->lock);
+  if (--threads->pending == 0)
+    g_cond_signal (&threads->cond);
+  g_mutex_unlock (&threads->lock);
+}
+
+static inline void
+gst_stripe_threads_init (GstStripeThreads * threads, guint n_threads)
+{
+  threads->n_threads = n_threads;
+  threads->pool = NULL;
+  threads->pending = 0;
+  g_mutex_init (&threads->lock);
+  g_cond_init (&threads->cond);
+}
+
+static inline void
+gst_stripe_threads_clear (GstStripeThreads * threads)
+{
+  if (threads->pool) {
+    g_thread_pool_free (threads->pool, FALSE, TRUE);
+    threads->pool = NULL;
+  }
+  g_mutex_clear (&threads->lock);
+  g_cond_clear (&threads->cond);
+}
+
+/* Number of stripes for n_rows rows, at most one per thread and with at
+ * least min_rows rows each */
+static inline guint
+gst_stripe_threads_get_n_stripes (GstStripeThreads * threads, gint n_rows,
+    gint min_rows)
+{
+  guint n_threads = threads->n_threads;
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  /* a stripe should have enough rows to be worth a thread */
+  return MIN (n_threads, MAX (n_rows / MAX (min_rows, 1), 1));
+}
+
+/* Runs func over n_rows rows split in n_stripes stripes of about the same
+ * height. The calling thread handles the first stripe and waits for the
+ * others to be done. */
+static inline void
+gst_stripe_threads_run_stripes (GstStripeThreads * threads, guint n_stripes,
+    gint n_rows, GstStripeFunc func, gpointer user_data)
+{
+  GstStripe *stripes;
+  guint i;
+
+  if (n_rows <= 0)
+    return;
+
+  if (n_stripes <= 1) {
+    func (user_data, 0, 0, n_rows);
+    return;
+  }
+
+  if (!threads->pool) {
+    GError *err = NULL;
+
+    threads->pool = g_thread_pool_new (gst_stripe_threads_run_stripe,
+        threads, n_stripes - 1, TRUE, &err);
+    if (err) {
+      GST_WARNING ("Could not start threads: %s", err->message);
+      g_clear_error (&err);
+    }
+  } else if (g_thread_pool_get_max_threads (threads->pool) !=
+      (gint) n_stripes - 1) {
+    g_thread_pool_set_max_threads (threads->pool, n_stripes - 1, NULL);
+  }
+
+  stripes = g_newa (GstStripe, n_stripes);
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].threads = threads;
+    stripes[i].func = func;
+    stripes[i].user_data = user_data;
+    stripes[i].stripe = i;
+    stripes[i].first = (gint64) n_rows * i / n_stripes;
+    stripes[i].last = (gint64) n_rows * (i + 1) / n_stripes;
+  }
+
+  threads->pending = n_stripes;
+  for (i = 1; i < n_stripes; i++) {
+    if (!threads->pool || !g_thread_pool_push (threads->pool, &stripes[i],
+            NULL))
+      gst_stripe_threads_run_stripe (&stripes[i], threads);
+  }
+  gst_stripe_threads_run_stripe (&stripes[0], threads);
+
+  g_mutex_lock (&threads->lock);
+  while (threads->pending > 0)
+    g_cond_wait (&threads->cond, &threads->lock);
+  g_mutex_unlock (&threads->lock);
+}
+
+/* Same as gst_stripe_threads_run_stripes() with as many stripes as
+ * gst_stripe_threads_get_n_stripes() allows */
+static inline void
+gst_stripe_threads_run (GstStripeThreads * threads, gint n_rows,
+    gint min_rows, GstStripeFunc func, gpointer user_data)
+{
+  gst_stripe_threads_run_stripes (threads,
+      gst_stripe_threads_get_n_stripes (threads, n_rows, min_rows), n_rows,
+      func, user_data);
+}
+
+G_END_DECLS
+
+#endif /* __STRIPE_THREADS_PRIVATE_H__ */
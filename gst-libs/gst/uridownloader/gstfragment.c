@@ -186,6 +186,8 @@ gst_fragment_finalize (GObject * gobject)
   g_free (fragment->name);
   if (fragment->headers)
     gst_structure_free (fragment->headers);
+  g_free (fragment->entity_tag);
+  g_free (fragment->last_modified);
   g_mutex_clear (&fragment->priv->lock);
 
   G_OBJECT_CLASS (gst_fragment_parent_class)->finalize (gobject);
@@ -57,6 +57,9 @@ struct _GstFragment
   gboolean index;               /* Index of the fragment */
   gboolean discontinuous;       /* Whether this fragment is discontinuous or not */
   GstStructure *headers;        /* HTTP request/response headers */
+  gchar * entity_tag;           /* ETag response header, if any */
+  gchar * last_modified;        /* Last-Modified response header, if any */
+  gboolean not_modified;        /* The server answered 304 Not Modified */
 
   GstFragmentPrivate *priv;
 };
@@ -0,0 +1,781 @@
+/* GStreamer
+ *
+ * gstfragmentcache.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* A cache of downloaded fragments, keyed by URI and byte range, so that
+ * several demuxers playing the same stream only download each fragment
+ * once. The least recently used fragments are evicted from memory once above
+ * the size limit, to the disk if a location is set for it, where they are
+ * evicted the same way.
+ *
+ * The files are read and written without holding the lock. A fragment
+ * being written to the disk stays readable from memory until it's done.
+ *
+ * Fragments being downloaded can be reserved, lookups of them then wait
+ * for the download to be inserted (or released on failure) instead of
+ * downloading them again.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "gstfragmentcache.h"
+
+GST_DEBUG_CATEGORY_STATIC (fragmentcache_debug);
+#define GST_CAT_DEFAULT fragmentcache_debug
+
+#define DEFAULT_MAX_SIZE (64 * 1024 * 1024)
+#define DEFAULT_MAX_DISK_SIZE (512 * 1024 * 1024)
+
+/* how long a lookup waits for a reserved fragment before giving up */
+#define PENDING_TIMEOUT (30 * G_TIME_SPAN_SECOND)
+
+typedef struct _GstFragmentCacheEntry
+{
+  gchar *key;
+  gsize size;
+
+  GstBuffer *buffer;            /* NULL if only on disk */
+  gchar *filename;              /* NULL if not on disk */
+
+  /* non-zero while being written to the disk, in neither LRU then */
+  guint writing;
+
+  GList memory_link;            /* in memory_lru if buffer is set */
+  GList disk_link;              /* in disk_lru if filename is set */
+} GstFragmentCacheEntry;
+
+/* a fragment to be written to the disk once the lock is released */
+typedef struct _GstFragmentCacheWrite
+{
+  gchar *key;
+  gchar *filename;
+  GstBuffer *buffer;
+  guint seqnum;
+} GstFragmentCacheWrite;
+
+struct _GstFragmentCache
+{
+  GMutex lock;
+
+  GHashTable *entries;
+
+  /* keys of the fragments being downloaded */
+  GHashTable *pending;
+  GCond pending_cond;
+
+  guint write_seqnum;
+
+  /* most recently used first */
+  GQueue memory_lru;
+  guint64 size;
+  guint64 max_size;
+
+  GQueue disk_lru;
+  gchar *location;
+  guint64 disk_size;
+  guint64 max_disk_size;
+
+  guint64 hits;
+  guint64 misses;
+};
+
+static gchar *
+gst_fragment_cache_make_key (const gchar * uri, gint64 range_start,
+    gint64 range_end)
+{
+  return g_strdup_printf ("%" G_GINT64_FORMAT "-%" G_GINT64_FORMAT " %s",
+      range_start, range_end, uri);
+}
+
+static void
+gst_fragment_cache_entry_free (GstFragmentCacheEntry * entry)
+{
+  if (entry->buffer)
+    gst_buffer_unref (entry->buffer);
+  if (entry->filename) {
+    g_unlink (entry->filename);
+    g_free (entry->filename);
+  }
+  g_free (entry->key);
+  g_slice_free (GstFragmentCacheEntry, entry);
+}
+
+/* call with the lock held */
+static void
+gst_fragment_cache_remove_entry (GstFragmentCache * cache,
+    GstFragmentCacheEntry * entry)
+{
+  if (entry->writing) {
+    g_hash_table_remove (cache->entries, entry->key);
+    return;
+  }
+
+  if (entry->buffer) {
+    g_queue_unlink (&cache->memory_lru, &entry->memory_link);
+    cache->size -= entry->size;
+  }
+  if (entry->filename) {
+    g_queue_unlink (&cache->disk_lru, &entry->disk_link);
+    cache->disk_size -= entry->size;
+  }
+  g_hash_table_remove (cache->entries, entry->key);
+}
+
+/* call with the lock held. Removes the entry if it isn't in memory either */
+static void
+gst_fragment_cache_drop_disk_copy (GstFragmentCache * cache,
+    GstFragmentCacheEntry * entry)
+{
+  if (entry->buffer == NULL) {
+    gst_fragment_cache_remove_entry (cache, entry);
+    return;
+  }
+
+  g_queue_unlink (&cache->disk_lru, &entry->disk_link);
+  cache->disk_size -= entry->size;
+  g_unlink (entry->filename);
+  g_free (entry->filename);
+  entry->filename = NULL;
+}
+
+/* call with the lock held */
+static void
+gst_fragment_cache_trim_disk (GstFragmentCache * cache)
+{
+  GList *tail;
+
+  while (cache->disk_size > cache->max_disk_size
+      && (tail = g_queue_peek_tail_link (&cache->disk_lru)))
+    gst_fragment_cache_drop_disk_copy (cache, tail->data);
+}
+
+/* call with the lock held. The fragments that need to be written to the
+ * disk are added to @writes, for gst_fragment_cache_write_to_disk() */
+static void
+gst_fragment_cache_trim_memory (GstFragmentCache * cache, GSList ** writes)
+{
+  GList *tail;
+
+  while (cache->size > cache->max_size
+      && (tail = g_queue_peek_tail_link (&cache->memory_lru))) {
+    GstFragmentCacheEntry *entry = tail->data;
+    GstFragmentCacheWrite *write;
+    gchar *name;
+
+    if (entry->filename == NULL && (cache->location == NULL
+            || entry->size > cache->max_disk_size)) {
+      gst_fragment_cache_remove_entry (cache, entry);
+      continue;
+    }
+
+    g_queue_unlink (&cache->memory_lru, &entry->memory_link);
+    cache->size -= entry->size;
+
+    if (entry->filename) {
+      /* already on disk */
+      gst_buffer_unref (entry->buffer);
+      entry->buffer = NULL;
+      continue;
+    }
+
+    name = g_compute_checksum_for_string (G_CHECKSUM_SHA1, entry->key, -1);
+    entry->filename = g_build_filename (cache->location, name, NULL);
+    g_free (name);
+
+    /* 0 is for entries that are not being written */
+    if (++cache->write_seqnum == 0)
+      cache->write_seqnum++;
+    entry->writing = cache->write_seqnum;
+
+    write = g_slice_new (GstFragmentCacheWrite);
+    write->key = g_strdup (entry->key);
+    write->filename = g_strdup (entry->filename);
+    write->buffer = gst_buffer_ref (entry->buffer);
+    write->seqnum = entry->writing;
+    *writes = g_slist_prepend (*writes, write);
+  }
+}
+
+/* call without the lock held. Writes the fragments evicted from memory by
+ * gst_fragment_cache_trim_memory() and moves them to the disk LRU, unless
+ * they were removed in the meantime */
+static void
+gst_fragment_cache_write_to_disk (GstFragmentCache * cache, GSList * writes)
+{
+  GSList *l;
+
+  writes = g_slist_reverse (writes);
+  for (l = writes; l; l = l->next) {
+    GstFragmentCacheWrite *write = l->data;
+    GstFragmentCacheEntry *entry;
+    GError *err = NULL;
+    GstMapInfo map;
+    gboolean ret = FALSE;
+
+    if (gst_buffer_map (write->buffer, &map, GST_MAP_READ)) {
+      ret = g_file_set_contents (write->filename, (const gchar *) map.data,
+          map.size, &err);
+      gst_buffer_unmap (write->buffer, &map);
+      if (!ret) {
+        GST_WARNING ("Failed to write %s: %s", write->filename, err->message);
+        g_clear_error (&err);
+      }
+    }
+
+    g_mutex_lock (&cache->lock);
+    entry = g_hash_table_lookup (cache->entries, write->key);
+    if (entry && entry->writing == write->seqnum) {
+      entry->writing = 0;
+      if (ret) {
+        gst_buffer_unref (entry->buffer);
+        entry->buffer = NULL;
+        g_queue_push_head_link (&cache->disk_lru, &entry->disk_link);
+        cache->disk_size += entry->size;
+        gst_fragment_cache_trim_disk (cache);
+      } else {
+        /* neither in memory nor on disk anymore */
+        g_hash_table_remove (cache->entries, write->key);
+      }
+    } else if (ret && (entry == NULL || entry->filename == NULL)) {
+      /* removed while being written, and not cached again to that file */
+      g_unlink (write->filename);
+    }
+    g_mutex_unlock (&cache->lock);
+
+    gst_buffer_unref (write->buffer);
+    g_free (write->filename);
+    g_free (write->key);
+    g_slice_free (GstFragmentCacheWrite, write);
+  }
+  g_slist_free (writes);
+}
+
+/**
+ * gst_fragment_cache_new:
+ * @max_size: the maximum size of the fragments kept in memory, in bytes
+ *
+ * Returns: (transfer full): a new #GstFragmentCache, without disk tier. Free
+ *     with gst_fragment_cache_free().
+ *
+ * Since: 1.16
+ */
+GstFragmentCache *
+gst_fragment_cache_new (guint64 max_size)
+{
+  GstFragmentCache *cache;
+
+  GST_DEBUG_CATEGORY_INIT (fragmentcache_debug, "fragmentcache", 0,
+      "Fragment cache");
+
+  cache = g_slice_new0 (GstFragmentCache);
+  g_mutex_init (&cache->lock);
+  cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) gst_fragment_cache_entry_free);
+  cache->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      NULL);
+  g_cond_init (&cache->pending_cond);
+  g_queue_init (&cache->memory_lru);
+  g_queue_init (&cache->disk_lru);
+  cache->max_size = max_size;
+  cache->max_disk_size = DEFAULT_MAX_DISK_SIZE;
+
+  return cache;
+}
+
+/**
+ * gst_fragment_cache_free:
+ * @cache: a #GstFragmentCache
+ *
+ * Frees @cache and removes its files from the disk.
+ *
+ * Since: 1.16
+ */
+void
+gst_fragment_cache_free (GstFragmentCache * cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  gst_fragment_cache_clear (cache);
+  g_hash_table_unref (cache->entries);
+  g_hash_table_unref (cache->pending);
+  g_cond_clear (&cache->pending_cond);
+  g_free (cache->location);
+  g_mutex_clear (&cache->lock);
+  g_slice_free (GstFragmentCache, cache);
+}
+
+static guint64
+gst_fragment_cache_getenv_size (const gchar * name, guint64 default_value)
+{
+  const gchar *value = g_getenv (name);
+  gchar *end = NULL;
+  guint64 size;
+
+  if (value == NULL)
+    return default_value;
+
+  size = g_ascii_strtoull (value, &end, 10);
+  if (end == value || *end != '\0') {
+    GST_WARNING ("Invalid %s value '%s'", name, value);
+    return default_value;
+  }
+
+  return size;
+}
+
+/**
+ * gst_fragment_cache_get_default:
+ *
+ * Returns the process-wide cache. Its memory limit is taken from the
+ * GST_FRAGMENT_CACHE_SIZE environment variable, 64MB by default, and it
+ * has a disk tier if GST_FRAGMENT_CACHE_DIR is set, limited to
+ * GST_FRAGMENT_CACHE_DISK_SIZE bytes, 512MB by default.
+ *
+ * Returns: (transfer none): the default #GstFragmentCache
+ *
+ * Since: 1.16
+ */
+GstFragmentCache *
+gst_fragment_cache_get_default (void)
+{
+  static GstFragmentCache *default_cache = NULL;
+
+  if (g_once_init_enter (&default_cache)) {
+    GstFragmentCache *cache;
+    const gchar *location;
+
+    cache = gst_fragment_cache_new (gst_fragment_cache_getenv_size
+        ("GST_FRAGMENT_CACHE_SIZE", DEFAULT_MAX_SIZE));
+
+    location = g_getenv ("GST_FRAGMENT_CACHE_DIR");
+    if (location && *location)
+      gst_fragment_cache_set_disk_location (cache, location,
+          gst_fragment_cache_getenv_size ("GST_FRAGMENT_CACHE_DISK_SIZE",
+              DEFAULT_MAX_DISK_SIZE));
+
+    g_once_init_leave (&default_cache, cache);
+  }
+
+  return default_cache;
+}
+
+/**
+ * gst_fragment_cache_set_max_size:
+ * @cache: a #GstFragmentCache
+ * @max_size: the maximum size of the fragments kept in memory, in bytes
+ *
+ * Sets the memory limit of @cache, 0 disables the cache.
+ *
+ * Since: 1.16
+ */
+void
+gst_fragment_cache_set_max_size (GstFragmentCache * cache, guint64 max_size)
+{
+  GSList *writes = NULL;
+
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->lock);
+  cache->max_size = max_size;
+  gst_fragment_cache_trim_memory (cache, &writes);
+  g_mutex_unlock (&cache->lock);
+
+  gst_fragment_cache_write_to_disk (cache, writes);
+}
+
+/**
+ * gst_fragment_cache_set_disk_location:
+ * @cache: a #GstFragmentCache
+ * @location: (allow-none): the directory to store the fragments evicted from
+ *     memory in, or %NULL to disable the disk tier
+ * @max_disk_size: the maximum size of the fragments stored on disk, in bytes
+ *
+ * The directory is created if needed. The fragments currently on disk are
+ * dropped, and files left in @location by other processes are not reused.
+ *
+ * Returns: %TRUE if the disk tier could be set up
+ *
+ * Since: 1.16
+ */
+gboolean
+gst_fragment_cache_set_disk_location (GstFragmentCache * cache,
+    const gchar * location, guint64 max_disk_size)
+{
+  GList *tail;
+  gboolean ret = TRUE;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+
+  g_mutex_lock (&cache->lock);
+
+  while ((tail = g_queue_peek_tail_link (&cache->disk_lru)))
+    gst_fragment_cache_drop_disk_copy (cache, tail->data);
+
+  g_free (cache->location);
+  cache->location = NULL;
+  cache->max_disk_size = max_disk_size;
+
+  if (location) {
+    if (g_mkdir_with_parents (location, 0700) == 0) {
+      cache->location = g_strdup (location);
+    } else {
+      GST_WARNING ("Can't create the fragment cache directory %s", location);
+      ret = FALSE;
+    }
+  }
+
+  g_mutex_unlock (&cache->lock);
+
+  return ret;
+}
+
+/* call with the lock held, which is released while reading the fragment
+ * from the disk */
+static GstBuffer *
+gst_fragment_cache_get_locked (GstFragmentCache * cache, const gchar * key,
+    GSList ** writes)
+{
+  GstFragmentCacheEntry *entry;
+  GstBuffer *buffer;
+  GError *err = NULL;
+  gchar *filename, *data;
+  gsize size;
+  gboolean ret;
+
+  entry = g_hash_table_lookup (cache->entries, key);
+  if (entry == NULL)
+    return NULL;
+
+  if (entry->writing)
+    return gst_buffer_ref (entry->buffer);
+
+  if (entry->filename) {
+    g_queue_unlink (&cache->disk_lru, &entry->disk_link);
+    g_queue_push_head_link (&cache->disk_lru, &entry->disk_link);
+  }
+
+  if (entry->buffer) {
+    g_queue_unlink (&cache->memory_lru, &entry->memory_link);
+    g_queue_push_head_link (&cache->memory_lru, &entry->memory_link);
+    return gst_buffer_ref (entry->buffer);
+  }
+
+  filename = g_strdup (entry->filename);
+  g_mutex_unlock (&cache->lock);
+
+  ret = g_file_get_contents (filename, &data, &size, &err);
+
+  g_mutex_lock (&cache->lock);
+
+  /* the entry can have changed while the lock was released */
+  entry = g_hash_table_lookup (cache->entries, key);
+
+  if (!ret) {
+    GST_WARNING ("Failed to read %s: %s", filename, err->message);
+    g_clear_error (&err);
+    if (entry && entry->buffer == NULL)
+      gst_fragment_cache_remove_entry (cache, entry);
+    g_free (filename);
+    return NULL;
+  }
+  g_free (filename);
+
+  if (entry && entry->buffer) {
+    /* read back by someone else already */
+    g_free (data);
+    return gst_buffer_ref (entry->buffer);
+  }
+
+  buffer = gst_buffer_new_wrapped (data, size);
+  if (entry == NULL)
+    return buffer;
+
+  /* back to memory, it will be used again soon */
+  entry->buffer = gst_buffer_ref (buffer);
+  g_queue_push_head_link (&cache->memory_lru, &entry->memory_link);
+  cache->size += entry->size;
+  gst_fragment_cache_trim_memory (cache, writes);
+
+  return buffer;
+}
+
+static GstBuffer *
+gst_fragment_cache_lookup_internal (GstFragmentCache * cache,
+    const gchar * uri, gint64 range_start, gint64 range_end,
+    gboolean * reserved)
+{
+  GstBuffer *buffer;
+  GSList *writes = NULL;
+  gint64 end_time;
+  gchar *key;
+
+  key = gst_fragment_cache_make_key (uri, range_start, range_end);
+  end_time = g_get_monotonic_time () + PENDING_TIMEOUT;
+
+  g_mutex_lock (&cache->lock);
+
+  /* wait for the download of the same fragment by someone else */
+  while (!g_hash_table_contains (cache->entries, key)
+      && g_hash_table_contains (cache->pending, key)) {
+    GST_LOG ("Waiting for the download of %s", key);
+    if (!g_cond_wait_until (&cache->pending_cond, &cache->lock, end_time)) {
+      GST_WARNING ("Timeout waiting for the download of %s", key);
+      break;
+    }
+  }
+
+  buffer = gst_fragment_cache_get_locked (cache, key, &writes);
+  if (buffer) {
+    cache->hits++;
+    GST_LOG ("Hit %s", key);
+  } else {
+    cache->misses++;
+    GST_LOG ("Miss %s", key);
+
+    if (reserved && !g_hash_table_contains (cache->pending, key)) {
+      g_hash_table_add (cache->pending, key);
+      key = NULL;
+      *reserved = TRUE;
+    }
+  }
+
+  g_mutex_unlock (&cache->lock);
+
+  gst_fragment_cache_write_to_disk (cache, writes);
+  g_free (key);
+
+  return buffer;
+}
+
+/**
+ * gst_fragment_cache_lookup:
+ * @cache: a #GstFragmentCache
+ * @uri: the URI of the fragment
+ * @range_start: the start of the byte range, as for the download
+ * @range_end: the end of the byte range, as for the download
+ *
+ * If the fragment was reserved with gst_fragment_cache_lookup_or_reserve(),
+ * this waits for it to be inserted or released.
+ *
+ * Returns: (transfer full) (nullable): the data of the fragment, or %NULL
+ *     if it isn't in @cache.
+ *
+ * Since: 1.16
+ */
+GstBuffer *
+gst_fragment_cache_lookup (GstFragmentCache * cache, const gchar * uri,
+    gint64 range_start, gint64 range_end)
+{
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (uri != NULL, NULL);
+
+  return gst_fragment_cache_lookup_internal (cache, uri, range_start,
+      range_end, NULL);
+}
+
+/**
+ * gst_fragment_cache_lookup_or_reserve:
+ * @cache: a #GstFragmentCache
+ * @uri: the URI of the fragment
+ * @range_start: the start of the byte range, as for the download
+ * @range_end: the end of the byte range, as for the download
+ * @reserved: (out): set to %TRUE if the fragment was reserved
+ *
+ * Same as gst_fragment_cache_lookup(), but reserves the fragment if it isn't
+ * in @cache and nobody else is downloading it. The caller then has to
+ * download it and call gst_fragment_cache_insert(), or
+ * gst_fragment_cache_release() if the download failed. Until then, the
+ * lookups of this fragment wait instead of downloading it again.
+ *
+ * Returns: (transfer full) (nullable): the data of the fragment, or %NULL
+ *     if it isn't in @cache.
+ *
+ * Since: 1.16
+ */
+GstBuffer *
+gst_fragment_cache_lookup_or_reserve (GstFragmentCache * cache,
+    const gchar * uri, gint64 range_start, gint64 range_end,
+    gboolean * reserved)
+{
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (uri != NULL, NULL);
+  g_return_val_if_fail (reserved != NULL, NULL);
+
+  *reserved = FALSE;
+
+  return gst_fragment_cache_lookup_internal (cache, uri, range_start,
+      range_end, reserved);
+}
+
+/* call with the lock held */
+static void
+gst_fragment_cache_unreserve (GstFragmentCache * cache, const gchar * key)
+{
+  if (g_hash_table_remove (cache->pending, key))
+    g_cond_broadcast (&cache->pending_cond);
+}
+
+/**
+ * gst_fragment_cache_release:
+ * @cache: a #GstFragmentCache
+ * @uri: the URI of the fragment
+ * @range_start: the start of the byte range, as for the download
+ * @range_end: the end of the byte range, as for the download
+ *
+ * Cancels the reservation of a fragment by
+ * gst_fragment_cache_lookup_or_reserve(), when it could not be downloaded.
+ * One of the lookups waiting for it will then reserve it again.
+ *
+ * Since: 1.16
+ */
+void
+gst_fragment_cache_release (GstFragmentCache * cache, const gchar * uri,
+    gint64 range_start, gint64 range_end)
+{
+  gchar *key;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (uri != NULL);
+
+  key = gst_fragment_cache_make_key (uri, range_start, range_end);
+
+  g_mutex_lock (&cache->lock);
+  gst_fragment_cache_unreserve (cache, key);
+  g_mutex_unlock (&cache->lock);
+
+  g_free (key);
+}
+
+/**
+ * gst_fragment_cache_insert:
+ * @cache: a #GstFragmentCache
+ * @uri: the URI of the fragment
+ * @range_start: the start of the byte range, as for the download
+ * @range_end: the end of the byte range, as for the download
+ * @buffer: (transfer none): the complete data of the fragment
+ *
+ * Adds a fragment to @cache, and ends its reservation if any. Fragments
+ * larger than the memory limit are not cached.
+ *
+ * Since: 1.16
+ */
+void
+gst_fragment_cache_insert (GstFragmentCache * cache, const gchar * uri,
+    gint64 range_start, gint64 range_end, GstBuffer * buffer)
+{
+  GstFragmentCacheEntry *entry;
+  GSList *writes = NULL;
+  gchar *key;
+  gsize size;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (uri != NULL);
+  g_return_if_fail (GST_IS_BUFFER (buffer));
+
+  size = gst_buffer_get_size (buffer);
+  key = gst_fragment_cache_make_key (uri, range_start, range_end);
+
+  g_mutex_lock (&cache->lock);
+
+  if (size == 0 || size > cache->max_size)
+    goto out;
+
+  if (g_hash_table_contains (cache->entries, key)) {
+    /* downloaded at the same time by another demuxer, that didn't wait
+     * for the reservation */
+    goto out;
+  }
+
+  entry = g_slice_new0 (GstFragmentCacheEntry);
+  entry->key = key;
+  key = NULL;
+  entry->size = size;
+  entry->buffer = gst_buffer_ref (buffer);
+  entry->memory_link.data = entry;
+  entry->disk_link.data = entry;
+  g_hash_table_insert (cache->entries, entry->key, entry);
+  g_queue_push_head_link (&cache->memory_lru, &entry->memory_link);
+  cache->size += size;
+
+  GST_LOG ("Inserted %s of %" G_GSIZE_FORMAT " bytes", entry->key, size);
+
+  /* the waiting lookups find it now */
+  gst_fragment_cache_unreserve (cache, entry->key);
+
+  gst_fragment_cache_trim_memory (cache, &writes);
+
+out:
+  /* or download it themselves if it wasn't cached */
+  if (key)
+    gst_fragment_cache_unreserve (cache, key);
+  g_mutex_unlock (&cache->lock);
+
+  gst_fragment_cache_write_to_disk (cache, writes);
+  g_free (key);
+}
+
+/**
+ * gst_fragment_cache_clear:
+ * @cache: a #GstFragmentCache
+ *
+ * Removes all the fragments from @cache, in memory and on disk.
+ *
+ * Since: 1.16
+ */
+void
+gst_fragment_cache_clear (GstFragmentCache * cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->lock);
+  g_queue_init (&cache->memory_lru);
+  g_queue_init (&cache->disk_lru);
+  g_hash_table_remove_all (cache->entries);
+  cache->size = 0;
+  cache->disk_size = 0;
+  g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * gst_fragment_cache_get_stats:
+ * @cache: a #GstFragmentCache
+ * @size: (out) (allow-none): size of the fragments in memory
+ * @disk_size: (out) (allow-none): size of the fragments on disk
+ * @hits: (out) (allow-none): number of lookups that found their fragment
+ * @misses: (out) (allow-none): number of lookups that didn't
+ *
+ * Since: 1.16
+ */
+void
+gst_fragment_cache_get_stats (GstFragmentCache * cache, guint64 * size,
+    guint64 * disk_size, guint64 * hits, guint64 * misses)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (&cache->lock);
+  if (size)
+    *size = cache->size;
+  if (disk_size)
+    *disk_size = cache->disk_size;
+  if (hits)
+    *hits = cache->hits;
+  if (misses)
+    *misses = cache->misses;
+  g_mutex_unlock (&cache->lock);
+}
@@ -0,0 +1,77 @@
+/* GStreamer
+ *
+ * gstfragmentcache.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GSTFRAGMENTCACHE_H__
+#define __GSTFRAGMENTCACHE_H__
+
+#include <gst/gst.h>
+#include <gst/uridownloader/uridownloader-prelude.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstFragmentCache GstFragmentCache;
+
+GST_URI_DOWNLOADER_API
+GstFragmentCache * gst_fragment_cache_get_default (void);
+
+GST_URI_DOWNLOADER_API
+GstFragmentCache * gst_fragment_cache_new (guint64 max_size);
+
+GST_URI_DOWNLOADER_API
+void gst_fragment_cache_free (GstFragmentCache * cache);
+
+GST_URI_DOWNLOADER_API
+void gst_fragment_cache_set_max_size (GstFragmentCache * cache, guint64 max_size);
+
+GST_URI_DOWNLOADER_API
+gboolean gst_fragment_cache_set_disk_location (GstFragmentCache * cache,
+                                               const gchar * location,
+                                               guint64 max_disk_size);
+
+GST_URI_DOWNLOADER_API
+GstBuffer * gst_fragment_cache_lookup (GstFragmentCache * cache, const gchar * uri,
+                                       gint64 range_start, gint64 range_end);
+
+GST_URI_DOWNLOADER_API
+GstBuffer * gst_fragment_cache_lookup_or_reserve (GstFragmentCache * cache,
+                                                  const gchar * uri,
+                                                  gint64 range_start,
+                                                  gint64 range_end,
+                                                  gboolean * reserved);
+
+GST_URI_DOWNLOADER_API
+void gst_fragment_cache_release (GstFragmentCache * cache, const gchar * uri,
+                                 gint64 range_start, gint64 range_end);
+
+GST_URI_DOWNLOADER_API
+void gst_fragment_cache_insert (GstFragmentCache * cache, const gchar * uri,
+                                gint64 range_start, gint64 range_end,
+                                GstBuffer * buffer);
+
+GST_URI_DOWNLOADER_API
+void gst_fragment_cache_clear (GstFragmentCache * cache);
+
+GST_URI_DOWNLOADER_API
+void gst_fragment_cache_get_stats (GstFragmentCache * cache, guint64 * size,
+                                   guint64 * disk_size, guint64 * hits,
+                                   guint64 * misses);
+
+G_END_DECLS
+#endif /* __GSTFRAGMENTCACHE_H__ */
@@ -27,6 +27,9 @@
 #define GST_CAT_DEFAULT uridownloader_debug
 GST_DEBUG_CATEGORY (uridownloader_debug);
 
+/* idle source elements kept per scheme and host */
+#define MAX_POOLED_SOURCES 4
+
 #define GST_URI_DOWNLOADER_GET_PRIVATE(obj)  \
    (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
     GST_TYPE_URI_DOWNLOADER, GstUriDownloaderPrivate))
@@ -63,6 +66,20 @@ static GstBusSyncReply gst_uri_downloader_bus_handler (GstBus * bus,
 static gboolean gst_uri_downloader_ensure_src (GstUriDownloader * downloader,
     const gchar * uri);
 static void gst_uri_downloader_destroy_src (GstUriDownloader * downloader);
+static void gst_uri_downloader_release_src (GstUriDownloader * downloader);
+static GstFragment *gst_uri_downloader_fetch (GstUriDownloader * downloader,
+    const gchar * uri, const gchar * referer, gboolean compress,
+    gboolean refresh, gboolean allow_cache, gint64 range_start,
+    gint64 range_end, const gchar * entity_tag, const gchar * last_modified,
+    GError ** err);
+
+/* The source elements downloaders are done with are kept in READY, so that
+ * the next download from the same host gets an element, and with keep-alive
+ * a connection, that is already set up. The pools are attached to the
+ * parent elements, sharing sources between pipelines could leak contexts.
+ * A pool maps "scheme://host:port" to a GQueue of sources */
+static GMutex src_pool_lock;
+static GQuark src_pool_quark;
 
 static GstStaticPadTemplate sinkpadtemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -88,6 +105,8 @@ gst_uri_downloader_class_init (GstUriDownloaderClass * klass)
 
   gobject_class->dispose = gst_uri_downloader_dispose;
   gobject_class->finalize = gst_uri_downloader_finalize;
+
+  src_pool_quark = g_quark_from_static_string ("GstUriDownloaderSrcPool");
 }
 
 static void
@@ -118,7 +137,7 @@ gst_uri_downloader_dispose (GObject * object)
 {
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
 
-  gst_uri_downloader_destroy_src (downloader);
+  gst_uri_downloader_release_src (downloader);
 
   if (downloader->priv->bus != NULL) {
     gst_object_unref (downloader->priv->bus);
@@ -235,6 +254,30 @@ gst_uri_downloader_bus_handler (GstBus * bus,
     GError *err = NULL;
     gchar *dbg_info = NULL;
     gchar *new_error = NULL;
+    const GstStructure *details = NULL;
+    guint status_code = 0;
+
+    /* sources report a 304 answer to a conditional request as an error,
+     * it is the download of an unmodified resource completing */
+    gst_message_parse_error_details (message, &details);
+    if (details && gst_structure_get_uint (details, "http-status-code",
+            &status_code) && status_code == 304) {
+      GST_OBJECT_LOCK (downloader);
+      if (downloader->priv->download != NULL) {
+        GST_DEBUG_OBJECT (downloader, "Resource not modified");
+        downloader->priv->download->not_modified = TRUE;
+        downloader->priv->download->completed = TRUE;
+        downloader->priv->download->download_stop_time =
+            gst_util_get_timestamp ();
+        g_cond_signal (&downloader->priv->cond);
+      }
+      GST_OBJECT_UNLOCK (downloader);
+
+      /* remove the sync handler to avoid duplicated messages */
+      gst_bus_set_sync_handler (downloader->priv->bus, NULL, NULL, NULL);
+      gst_message_unref (message);
+      return GST_BUS_DROP;
+    }
 
     gst_message_parse_error (message, &err, &dbg_info);
     GST_WARNING_OBJECT (downloader,
@@ -400,20 +443,148 @@ gst_uri_downloader_set_range (GstUriDownloader * downloader,
   return TRUE;
 }
 
+static gchar *
+gst_uri_downloader_get_src_key (const gchar * uri)
+{
+  GstUri *gst_uri;
+  gchar *key;
+
+  gst_uri = gst_uri_from_string (uri);
+  if (gst_uri == NULL)
+    return NULL;
+
+  key = g_strdup_printf ("%s://%s:%u", GST_STR_NULL (gst_uri_get_scheme
+          (gst_uri)), GST_STR_NULL (gst_uri_get_host (gst_uri)),
+      gst_uri_get_port (gst_uri));
+  gst_uri_unref (gst_uri);
+
+  return key;
+}
+
+static void
+gst_uri_downloader_free_pooled_srcs (GQueue * srcs)
+{
+  GstElement *src;
+
+  while ((src = g_queue_pop_head (srcs))) {
+    gst_element_set_state (src, GST_STATE_NULL);
+    gst_object_unref (src);
+  }
+  g_queue_free (srcs);
+}
+
+/* Returns a source element from the pool of the parent for @key, or NULL */
+static GstElement *
+gst_uri_downloader_take_pooled_src (GstUriDownloader * downloader,
+    const gchar * key)
+{
+  GstElement *parent;
+  GstElement *src = NULL;
+
+  parent = g_weak_ref_get (&downloader->priv->parent);
+  if (parent == NULL)
+    return NULL;
+
+  if (key) {
+    GHashTable *pool;
+
+    g_mutex_lock (&src_pool_lock);
+    pool = g_object_get_qdata (G_OBJECT (parent), src_pool_quark);
+    if (pool) {
+      GQueue *srcs = g_hash_table_lookup (pool, key);
+
+      if (srcs)
+        src = g_queue_pop_head (srcs);
+    }
+    g_mutex_unlock (&src_pool_lock);
+  }
+
+  gst_object_unref (parent);
+
+  return src;
+}
+
+/* Gives the source element back to the pool of the parent, or destroys it
+ * if it can't be reused */
+static void
+gst_uri_downloader_release_src (GstUriDownloader * downloader)
+{
+  GstElement *src = downloader->priv->urisrc;
+  GstElement *parent;
+
+  if (!src)
+    return;
+
+  downloader->priv->urisrc = NULL;
+
+  /* a failed download leaves the source in NULL */
+  parent = g_weak_ref_get (&downloader->priv->parent);
+  if (parent && GST_STATE (src) == GST_STATE_READY) {
+    gchar *uri, *key;
+
+    uri = gst_uri_handler_get_uri (GST_URI_HANDLER (src));
+    key = uri ? gst_uri_downloader_get_src_key (uri) : NULL;
+    g_free (uri);
+
+    if (key) {
+      GHashTable *pool;
+      GQueue *srcs;
+
+      /* a HEAD request must not stick to the next user */
+      if (g_object_class_find_property (G_OBJECT_GET_CLASS (src), "method"))
+        g_object_set (src, "method", NULL, NULL);
+
+      g_mutex_lock (&src_pool_lock);
+      pool = g_object_get_qdata (G_OBJECT (parent), src_pool_quark);
+      if (pool == NULL) {
+        pool = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify) gst_uri_downloader_free_pooled_srcs);
+        g_object_set_qdata_full (G_OBJECT (parent), src_pool_quark, pool,
+            (GDestroyNotify) g_hash_table_unref);
+      }
+
+      srcs = g_hash_table_lookup (pool, key);
+      if (srcs == NULL) {
+        srcs = g_queue_new ();
+        g_hash_table_insert (pool, key, srcs);
+        key = NULL;
+      }
+
+      if (g_queue_get_length (srcs) < MAX_POOLED_SOURCES) {
+        GST_DEBUG_OBJECT (downloader, "Keeping source element %s for reuse",
+            GST_ELEMENT_NAME (src));
+        g_queue_push_tail (srcs, src);
+        src = NULL;
+      }
+      g_mutex_unlock (&src_pool_lock);
+      g_free (key);
+    }
+  }
+
+  if (parent)
+    gst_object_unref (parent);
+
+  if (src) {
+    gst_element_set_state (src, GST_STATE_NULL);
+    gst_object_unref (src);
+  }
+}
+
 static gboolean
 gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
 {
+  gchar *key = gst_uri_downloader_get_src_key (uri);
+
   if (downloader->priv->urisrc) {
-    gchar *old_protocol, *new_protocol;
-    gchar *old_uri;
+    gchar *old_uri, *old_key;
 
     old_uri =
         gst_uri_handler_get_uri (GST_URI_HANDLER (downloader->priv->urisrc));
-    old_protocol = gst_uri_get_protocol (old_uri);
-    new_protocol = gst_uri_get_protocol (uri);
+    old_key = old_uri ? gst_uri_downloader_get_src_key (old_uri) : NULL;
 
-    if (!g_str_equal (old_protocol, new_protocol)) {
-      gst_uri_downloader_destroy_src (downloader);
+    if (key == NULL || g_strcmp0 (old_key, key) != 0) {
+      /* keep it, and its connection, for the next download from that host */
+      gst_uri_downloader_release_src (downloader);
       GST_DEBUG_OBJECT (downloader, "Can't re-use old source element");
     } else {
       GError *err = NULL;
@@ -428,8 +599,26 @@ gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
       }
     }
     g_free (old_uri);
-    g_free (old_protocol);
-    g_free (new_protocol);
+    g_free (old_key);
+  }
+
+  if (!downloader->priv->urisrc) {
+    downloader->priv->urisrc =
+        gst_uri_downloader_take_pooled_src (downloader, key);
+
+    if (downloader->priv->urisrc) {
+      GError *err = NULL;
+
+      GST_DEBUG_OBJECT (downloader, "Re-using pooled source element %s",
+          GST_ELEMENT_NAME (downloader->priv->urisrc));
+      if (!gst_uri_handler_set_uri
+          (GST_URI_HANDLER (downloader->priv->urisrc), uri, &err)) {
+        GST_DEBUG_OBJECT (downloader,
+            "Failed to re-use pooled source element: %s", err->message);
+        g_clear_error (&err);
+        gst_uri_downloader_destroy_src (downloader);
+      }
+    }
   }
 
   if (!downloader->priv->urisrc) {
@@ -446,6 +635,8 @@ gst_uri_downloader_ensure_src (GstUriDownloader * downloader, const gchar * uri)
     }
   }
 
+  g_free (key);
+
   return downloader->priv->urisrc != NULL;
 }
 
@@ -463,7 +654,8 @@ gst_uri_downloader_destroy_src (GstUriDownloader * downloader)
 static gboolean
 gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
     const gchar * referer, gboolean compress,
-    gboolean refresh, gboolean allow_cache)
+    gboolean refresh, gboolean allow_cache, const gchar * entity_tag,
+    const gchar * last_modified)
 {
   GstPad *pad;
   GObjectClass *gobject_class;
@@ -480,13 +672,20 @@ gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri,
   if (g_object_class_find_property (gobject_class, "keep-alive"))
     g_object_set (downloader->priv->urisrc, "keep-alive", TRUE, NULL);
   if (g_object_class_find_property (gobject_class, "extra-headers")) {
-    if (referer || refresh || !allow_cache) {
+    if (referer || refresh || !allow_cache || entity_tag || last_modified) {
       GstStructure *extra_headers = gst_structure_new_empty ("headers");
 
       if (referer)
         gst_structure_set (extra_headers, "Referer", G_TYPE_STRING, referer,
             NULL);
 
+      if (entity_tag)
+        gst_structure_set (extra_headers, "If-None-Match", G_TYPE_STRING,
+            entity_tag, NULL);
+      if (last_modified)
+        gst_structure_set (extra_headers, "If-Modified-Since", G_TYPE_STRING,
+            last_modified, NULL);
+
       if (!allow_cache)
         gst_structure_set (extra_headers, "Cache-Control", G_TYPE_STRING,
             "no-cache", NULL);
@@ -557,6 +756,73 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
     downloader, const gchar * uri, const gchar * referer, gboolean compress,
     gboolean refresh, gboolean allow_cache,
     gint64 range_start, gint64 range_end, GError ** err)
+{
+  return gst_uri_downloader_fetch (downloader, uri, referer, compress, refresh,
+      allow_cache, range_start, range_end, NULL, NULL, err);
+}
+
+/**
+ * gst_uri_downloader_fetch_uri_if_modified:
+ * @downloader: the #GstUriDownloader
+ * @uri: the uri
+ * @entity_tag: (allow-none): the ETag of the version we already have
+ * @last_modified: (allow-none): the Last-Modified date of the version we
+ *     already have
+ *
+ * Like gst_uri_downloader_fetch_uri(), but the server only sends the
+ * resource again if it changed since the version described by @entity_tag
+ * and @last_modified. Otherwise the returned #GstFragment is marked
+ * not_modified and has no buffer.
+ *
+ * Returns the downloaded #GstFragment
+ *
+ * Since: 1.16
+ */
+GstFragment *
+gst_uri_downloader_fetch_uri_if_modified (GstUriDownloader * downloader,
+    const gchar * uri, const gchar * referer, gboolean compress,
+    gboolean refresh, gboolean allow_cache, const gchar * entity_tag,
+    const gchar * last_modified, GError ** err)
+{
+  return gst_uri_downloader_fetch (downloader, uri, referer, compress, refresh,
+      allow_cache, 0, -1, entity_tag, last_modified, err);
+}
+
+/* Response headers names are case insensitive */
+static gchar *
+gst_uri_downloader_dup_response_header (GstFragment * download,
+    const gchar * name)
+{
+  const GstStructure *response_headers;
+  const GValue *value;
+  gint i, n;
+
+  if (download->headers == NULL)
+    return NULL;
+
+  value = gst_structure_get_value (download->headers, "response-headers");
+  if (value == NULL || !G_VALUE_HOLDS (value, GST_TYPE_STRUCTURE))
+    return NULL;
+
+  response_headers = gst_value_get_structure (value);
+  n = gst_structure_n_fields (response_headers);
+  for (i = 0; i < n; i++) {
+    const gchar *field = gst_structure_nth_field_name (response_headers, i);
+
+    if (g_ascii_strcasecmp (field, name) == 0) {
+      value = gst_structure_get_value (response_headers, field);
+      return G_VALUE_HOLDS_STRING (value) ? g_value_dup_string (value) : NULL;
+    }
+  }
+
+  return NULL;
+}
+
+static GstFragment *
+gst_uri_downloader_fetch (GstUriDownloader * downloader, const gchar * uri,
+    const gchar * referer, gboolean compress, gboolean refresh,
+    gboolean allow_cache, gint64 range_start, gint64 range_end,
+    const gchar * entity_tag, const gchar * last_modified, GError ** err)
 {
   GstStateChangeReturn ret;
   GstFragment *download = NULL;
@@ -574,7 +840,7 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
   }
 
   if (!gst_uri_downloader_set_uri (downloader, uri, referer, compress, refresh,
-          allow_cache)) {
+          allow_cache, entity_tag, last_modified)) {
     GST_WARNING_OBJECT (downloader, "Failed to set URI");
     goto quit;
   }
@@ -648,6 +914,8 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
   if (!downloader->priv->got_buffer) {
     if (download->range_start < 0 && download->range_end < 0) {
       /* HEAD request, so we don't expect a response */
+    } else if (download->not_modified) {
+      /* nothing is sent for unmodified resources */
     } else {
       g_object_unref (download);
       download = NULL;
@@ -655,6 +923,13 @@ gst_uri_downloader_fetch_uri_with_range (GstUriDownloader *
     }
   }
 
+  if (download != NULL && !download->not_modified) {
+    download->entity_tag =
+        gst_uri_downloader_dup_response_header (download, "ETag");
+    download->last_modified =
+        gst_uri_downloader_dup_response_header (download, "Last-Modified");
+  }
+
   if (download != NULL)
     GST_INFO_OBJECT (downloader, "URI fetched successfully");
   else
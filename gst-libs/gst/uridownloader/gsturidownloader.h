@@ -73,6 +73,9 @@ GstFragment * gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const
 GST_URI_DOWNLOADER_API
 GstFragment * gst_uri_downloader_fetch_uri_with_range (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, gint64 range_start, gint64 range_end, GError ** err);
 
+GST_URI_DOWNLOADER_API
+GstFragment * gst_uri_downloader_fetch_uri_if_modified (GstUriDownloader * downloader, const gchar * uri, const gchar * referer, gboolean compress, gboolean refresh, gboolean allow_cache, const gchar * entity_tag, const gchar * last_modified, GError ** err);
+
 GST_URI_DOWNLOADER_API
 void gst_uri_downloader_reset (GstUriDownloader *downloader);
 
@@ -77,6 +77,12 @@ struct _GstVideoAggregatorPadPrivate
   GstClockTime end_time;
 
   GstVideoInfo pending_vinfo;
+
+  /* statistics, protected by the object lock */
+  guint64 received, skipped, consumed, missed;
+  GstClockTimeDiff lateness, max_lateness;
+  /* arrival probe, only installed with enable-stats */
+  gulong stats_probe_id;
 };
 
 
@@ -136,6 +142,19 @@ gst_video_aggregator_pad_set_property (GObject * object, guint prop_id,
   gst_object_unref (vagg);
 }
 
+/* WITH GST_OBJECT_LOCK !! */
+static void
+gst_video_aggregator_pad_reset_stats (GstVideoAggregatorPad * pad)
+{
+  pad->priv->received = 0;
+  pad->priv->skipped = 0;
+  pad->priv->consumed = 0;
+  pad->priv->missed = 0;
+  /* nothing measured yet */
+  pad->priv->lateness = G_MININT64;
+  pad->priv->max_lateness = G_MININT64;
+}
+
 static GstFlowReturn
 _flush_pad (GstAggregatorPad * aggpad, GstAggregator * aggregator)
 {
@@ -147,6 +166,11 @@ _flush_pad (GstAggregatorPad * aggpad, GstAggregator * aggregator)
   pad->priv->start_time = -1;
   pad->priv->end_time = -1;
 
+  /* the queue of the pad is empty after a flush */
+  GST_OBJECT_LOCK (pad);
+  pad->priv->consumed = pad->priv->received - pad->priv->skipped;
+  GST_OBJECT_UNLOCK (pad);
+
   return GST_FLOW_OK;
 }
 
@@ -223,6 +247,7 @@ static gboolean
 gst_video_aggregator_pad_skip_buffer (GstAggregatorPad * aggpad,
     GstAggregator * agg, GstBuffer * buffer)
 {
+  GstVideoAggregatorPad *pad = GST_VIDEO_AGGREGATOR_PAD (aggpad);
   gboolean ret = FALSE;
   GstSegment *agg_segment = &GST_AGGREGATOR_PAD (agg->srcpad)->segment;
 
@@ -239,9 +264,90 @@ gst_video_aggregator_pad_skip_buffer (GstAggregatorPad * aggpad,
     ret = end_time < output_start_running_time;
   }
 
+  if (ret) {
+    GST_OBJECT_LOCK (pad);
+    pad->priv->skipped++;
+    GST_OBJECT_UNLOCK (pad);
+  }
+
   return ret;
 }
 
+/* WITH GST_OBJECT_LOCK !! */
+static void
+gst_video_aggregator_pad_add_arrival (GstVideoAggregatorPad * vpad,
+    GstBuffer * buffer, GstClockTime now)
+{
+  GstClockTime running_time;
+
+  vpad->priv->received++;
+  if (!GST_CLOCK_TIME_IS_VALID (now) || !GST_BUFFER_PTS_IS_VALID (buffer))
+    return;
+
+  running_time =
+      gst_segment_to_running_time (&GST_AGGREGATOR_PAD (vpad)->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+  if (GST_CLOCK_TIME_IS_VALID (running_time)) {
+    vpad->priv->lateness = GST_CLOCK_DIFF (running_time, now);
+    vpad->priv->max_lateness =
+        MAX (vpad->priv->max_lateness, vpad->priv->lateness);
+  }
+}
+
+/* Counts the incoming buffers and measures how late they arrive compared
+ * to their running time */
+static GstPadProbeReturn
+gst_video_aggregator_pad_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstVideoAggregatorPad *vpad = GST_VIDEO_AGGREGATOR_PAD (pad);
+  GstClockTime now = GST_CLOCK_TIME_NONE;
+  GstElement *parent;
+
+  parent = gst_pad_get_parent_element (pad);
+  if (parent) {
+    GstClock *clock = gst_element_get_clock (parent);
+
+    if (clock) {
+      now = gst_clock_get_time (clock) - gst_element_get_base_time (parent);
+      gst_object_unref (clock);
+    }
+    gst_object_unref (parent);
+  }
+
+  GST_OBJECT_LOCK (vpad);
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+    guint i, len = gst_buffer_list_length (list);
+
+    for (i = 0; i < len; i++)
+      gst_video_aggregator_pad_add_arrival (vpad,
+          gst_buffer_list_get (list, i), now);
+  } else {
+    gst_video_aggregator_pad_add_arrival (vpad,
+        GST_PAD_PROBE_INFO_BUFFER (info), now);
+  }
+  GST_OBJECT_UNLOCK (vpad);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Installs or removes the arrival probe, the buffers only need to be
+ * looked at when someone asked for the statistics */
+static void
+gst_video_aggregator_pad_set_stats_probe (GstVideoAggregatorPad * vpad,
+    gboolean enable)
+{
+  if (enable && !vpad->priv->stats_probe_id) {
+    vpad->priv->stats_probe_id = gst_pad_add_probe (GST_PAD (vpad),
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        gst_video_aggregator_pad_buffer_probe, NULL, NULL);
+  } else if (!enable && vpad->priv->stats_probe_id) {
+    gst_pad_remove_probe (GST_PAD (vpad), vpad->priv->stats_probe_id);
+    vpad->priv->stats_probe_id = 0;
+  }
+}
+
 static void
 gst_video_aggregator_pad_finalize (GObject * o)
 {
@@ -368,6 +474,9 @@ gst_video_aggregator_pad_init (GstVideoAggregatorPad * vaggpad)
   vaggpad->priv->converted_buffer = NULL;
 
   vaggpad->priv->convert = NULL;
+
+  vaggpad->priv->stats_probe_id = 0;
+  gst_video_aggregator_pad_reset_stats (vaggpad);
 }
 
 /*********************************
@@ -437,6 +546,26 @@ gst_video_aggregator_child_proxy_init (gpointer g_iface, gpointer iface_data)
         g_thread_self());                                      \
   } G_STMT_END
 
+#define DEFAULT_N_PREPARE_THREADS 1
+#define DEFAULT_ENABLE_STATS FALSE
+enum
+{
+  PROP_0,
+  PROP_N_PREPARE_THREADS,
+  PROP_ENABLE_STATS,
+  PROP_STATS,
+};
+
+/* Bucket i of the histograms counts the durations below 2^i ms, the last
+ * one all the longer ones */
+#define N_TIME_BUCKETS 8
+
+typedef struct
+{
+  guint64 buckets[N_TIME_BUCKETS];
+  GstClockTime total, max;
+  guint64 count;
+} GstVideoAggregatorTimeStats;
 
 struct _GstVideoAggregatorPrivate
 {
@@ -456,6 +585,19 @@ struct _GstVideoAggregatorPrivate
   GstCaps *current_caps;
 
   gboolean live;
+
+  /* threads preparing the pad frames, protected by the object lock */
+  guint n_prepare_threads;
+  GThreadPool *prepare_pool;
+
+  GMutex prepare_lock;
+  GCond prepare_cond;
+  guint prepares_pending;
+
+  /* statistics, protected by the object lock */
+  gboolean enable_stats;
+  guint64 timeouts;
+  GstVideoAggregatorTimeStats aggregate_stats, blend_stats;
 };
 
 /* Can't use the G_DEFINE_TYPE macros because we need the
@@ -1105,6 +1247,17 @@ gst_video_aggregator_reset (GstVideoAggregator * vagg)
   GST_OBJECT_UNLOCK (vagg);
 }
 
+/* Drops the head buffer of @pad, counting it for the statistics */
+static void
+gst_video_aggregator_pad_drop_buffer (GstVideoAggregatorPad * pad)
+{
+  gst_aggregator_pad_drop_buffer (GST_AGGREGATOR_PAD (pad));
+
+  GST_OBJECT_LOCK (pad);
+  pad->priv->consumed++;
+  GST_OBJECT_UNLOCK (pad);
+}
+
 static GstFlowReturn
 gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
     GstClockTime output_start_running_time,
@@ -1176,12 +1329,15 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
             pad->priv->pending_vinfo.finfo = NULL;
           }
           gst_buffer_unref (buf);
-          gst_aggregator_pad_drop_buffer (bpad);
+          gst_video_aggregator_pad_drop_buffer (pad);
           need_more_data = TRUE;
           continue;
         }
         gst_buffer_unref (buf);
         buf = gst_aggregator_pad_pop_buffer (bpad);
+        GST_OBJECT_LOCK (pad);
+        pad->priv->consumed++;
+        GST_OBJECT_UNLOCK (pad);
         gst_buffer_replace (&pad->buffer, buf);
         if (pad->priv->pending_vinfo.finfo) {
           pad->info = pad->priv->pending_vinfo;
@@ -1207,7 +1363,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
             GST_TIME_ARGS (end_time));
 
         gst_buffer_unref (buf);
-        gst_aggregator_pad_drop_buffer (bpad);
+        gst_video_aggregator_pad_drop_buffer (pad);
 
         need_more_data = TRUE;
         continue;
@@ -1238,7 +1394,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
       if (pad->priv->end_time != -1 && pad->priv->end_time > end_time) {
         GST_DEBUG_OBJECT (pad, "Buffer from the past, dropping");
         gst_buffer_unref (buf);
-        gst_aggregator_pad_drop_buffer (bpad);
+        gst_video_aggregator_pad_drop_buffer (pad);
         continue;
       }
 
@@ -1257,7 +1413,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
         pad->priv->end_time = end_time;
 
         gst_buffer_unref (buf);
-        gst_aggregator_pad_drop_buffer (bpad);
+        gst_video_aggregator_pad_drop_buffer (pad);
         eos = FALSE;
       } else if (start_time >= output_end_running_time) {
         GST_DEBUG_OBJECT (pad, "Keeping buffer until %" GST_TIME_FORMAT,
@@ -1278,7 +1434,7 @@ gst_video_aggregator_fill_queues (GstVideoAggregator * vagg,
             " out end %" GST_TIME_FORMAT, GST_TIME_ARGS (start_time),
             GST_TIME_ARGS (output_end_running_time));
         gst_buffer_unref (buf);
-        gst_aggregator_pad_drop_buffer (bpad);
+        gst_video_aggregator_pad_drop_buffer (pad);
 
         need_more_data = TRUE;
         continue;
@@ -1357,6 +1513,88 @@ prepare_frames (GstElement * agg, GstPad * pad, gpointer user_data)
   return vaggpad_class->prepare_frame (vpad, GST_VIDEO_AGGREGATOR_CAST (agg));
 }
 
+static void
+prepare_frame_func (gpointer data, gpointer user_data)
+{
+  GstVideoAggregator *vagg = user_data;
+  GstPad *pad = data;
+
+  prepare_frames (GST_ELEMENT_CAST (vagg), pad, NULL);
+  gst_object_unref (pad);
+
+  g_mutex_lock (&vagg->priv->prepare_lock);
+  if (--vagg->priv->prepares_pending == 0)
+    g_cond_signal (&vagg->priv->prepare_cond);
+  g_mutex_unlock (&vagg->priv->prepare_lock);
+}
+
+/* Prepares (maps and converts) the frames of all the pads, and does so
+ * concurrently in the prepare thread pool if there are several of them */
+static void
+gst_video_aggregator_prepare_frames (GstVideoAggregator * vagg)
+{
+  GstVideoAggregatorPrivate *priv = vagg->priv;
+  GList *pads = NULL, *l;
+  guint n_threads, n_pads = 0;
+
+  GST_OBJECT_LOCK (vagg);
+  n_threads = priv->n_prepare_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  if (n_threads > 1) {
+    for (l = GST_ELEMENT_CAST (vagg)->sinkpads; l; l = l->next) {
+      if (GST_VIDEO_AGGREGATOR_PAD_CAST (l->data)->buffer) {
+        pads = g_list_prepend (pads, gst_object_ref (l->data));
+        n_pads++;
+      }
+    }
+  }
+
+  if (n_pads > 1) {
+    guint max_threads = MIN (n_threads, n_pads) - 1;
+    GError *err = NULL;
+
+    if (!priv->prepare_pool) {
+      priv->prepare_pool = g_thread_pool_new (prepare_frame_func, vagg,
+          max_threads, TRUE, &err);
+    } else if (g_thread_pool_get_max_threads (priv->prepare_pool) <
+        max_threads) {
+      g_thread_pool_set_max_threads (priv->prepare_pool, max_threads, &err);
+    }
+
+    if (err) {
+      GST_WARNING_OBJECT (vagg, "Could not start prepare threads: %s",
+          err->message);
+      g_clear_error (&err);
+    }
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (n_pads < 2) {
+    g_list_free_full (pads, (GDestroyNotify) gst_object_unref);
+    gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames,
+        NULL);
+    return;
+  }
+
+  /* the first pad is prepared by this thread, the others by the pool */
+  priv->prepares_pending = n_pads;
+  for (l = pads->next; l; l = l->next) {
+    if (!priv->prepare_pool
+        || !g_thread_pool_push (priv->prepare_pool, l->data, NULL))
+      prepare_frame_func (l->data, vagg);
+  }
+  prepare_frame_func (pads->data, vagg);
+
+  g_mutex_lock (&priv->prepare_lock);
+  while (priv->prepares_pending > 0)
+    g_cond_wait (&priv->prepare_cond, &priv->prepare_lock);
+  g_mutex_unlock (&priv->prepare_lock);
+
+  g_list_free (pads);
+}
+
 static gboolean
 clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
 {
@@ -1371,6 +1609,22 @@ clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
   return TRUE;
 }
 
+static void
+gst_video_aggregator_time_stats_add (GstVideoAggregatorTimeStats * stats,
+    GstClockTime duration)
+{
+  guint i;
+
+  for (i = 0; i < N_TIME_BUCKETS - 1; i++) {
+    if (duration < (GST_MSECOND << i))
+      break;
+  }
+  stats->buckets[i]++;
+  stats->total += duration;
+  stats->max = MAX (stats->max, duration);
+  stats->count++;
+}
+
 static GstFlowReturn
 gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
     GstClockTime output_start_time, GstClockTime output_end_time,
@@ -1379,6 +1633,7 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   GstFlowReturn ret = GST_FLOW_OK;
   GstElementClass *klass = GST_ELEMENT_GET_CLASS (vagg);
   GstVideoAggregatorClass *vagg_klass = (GstVideoAggregatorClass *) klass;
+  GstClockTime start, blend_start, end;
 
   g_assert (vagg_klass->aggregate_frames != NULL);
   g_assert (vagg_klass->get_output_buffer != NULL);
@@ -1396,15 +1651,26 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   GST_BUFFER_TIMESTAMP (*outbuf) = output_start_time;
   GST_BUFFER_DURATION (*outbuf) = output_end_time - output_start_time;
 
+  start = gst_util_get_timestamp ();
+
   /* Sync pad properties to the stream time */
   gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
 
   /* Convert all the frames the subclass has before aggregating */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames, NULL);
+  gst_video_aggregator_prepare_frames (vagg);
 
+  blend_start = gst_util_get_timestamp ();
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
   gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), clean_pad, NULL);
+  end = gst_util_get_timestamp ();
+
+  GST_OBJECT_LOCK (vagg);
+  gst_video_aggregator_time_stats_add (&vagg->priv->aggregate_stats,
+      end - start);
+  gst_video_aggregator_time_stats_add (&vagg->priv->blend_stats,
+      end - blend_start);
+  GST_OBJECT_UNLOCK (vagg);
 
   return ret;
 }
@@ -1508,6 +1774,34 @@ gst_video_aggregator_advance_on_timeout (GstVideoAggregator * vagg)
   GST_OBJECT_UNLOCK (agg);
 }
 
+/* Counts the pads that had nothing queued when the output frame had to be
+ * produced anyway */
+static void
+gst_video_aggregator_count_missing_pads (GstVideoAggregator * vagg)
+{
+  gboolean missing = FALSE;
+  GList *l;
+
+  GST_OBJECT_LOCK (vagg);
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstAggregatorPad *bpad = GST_AGGREGATOR_PAD (pad);
+
+    if (gst_aggregator_pad_is_eos (bpad)
+        || gst_aggregator_pad_has_buffer (bpad))
+      continue;
+
+    GST_DEBUG_OBJECT (pad, "No buffer on timeout");
+    GST_OBJECT_LOCK (pad);
+    pad->priv->missed++;
+    GST_OBJECT_UNLOCK (pad);
+    missing = TRUE;
+  }
+  if (missing)
+    vagg->priv->timeouts++;
+  GST_OBJECT_UNLOCK (vagg);
+}
+
 static GstFlowReturn
 gst_video_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
 {
@@ -1566,6 +1860,9 @@ gst_video_aggregator_aggregate (GstAggregator * agg, gboolean timeout)
         output_end_running_time);
   }
 
+  if (flow_ret == GST_AGGREGATOR_FLOW_NEED_DATA && timeout)
+    gst_video_aggregator_count_missing_pads (vagg);
+
   if (flow_ret == GST_AGGREGATOR_FLOW_NEED_DATA && !timeout) {
     GST_DEBUG_OBJECT (vagg, "Need more data for decisions");
     goto unlock_and_return;
@@ -1895,9 +2192,22 @@ static gboolean
 gst_video_aggregator_start (GstAggregator * agg)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (agg);
+  GList *l;
 
   gst_caps_replace (&vagg->priv->current_caps, NULL);
 
+  GST_OBJECT_LOCK (vagg);
+  vagg->priv->timeouts = 0;
+  memset (&vagg->priv->aggregate_stats, 0,
+      sizeof (GstVideoAggregatorTimeStats));
+  memset (&vagg->priv->blend_stats, 0, sizeof (GstVideoAggregatorTimeStats));
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GST_OBJECT_LOCK (l->data);
+    gst_video_aggregator_pad_reset_stats (l->data);
+    GST_OBJECT_UNLOCK (l->data);
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
   return TRUE;
 }
 
@@ -1932,6 +2242,7 @@ gst_video_aggregator_request_new_pad (GstElement * element,
   vaggpad->zorder = GST_ELEMENT (vagg)->numsinkpads;
   vaggpad->priv->start_time = -1;
   vaggpad->priv->end_time = -1;
+  gst_video_aggregator_pad_set_stats_probe (vaggpad, vagg->priv->enable_stats);
   element->sinkpads = g_list_sort (element->sinkpads,
       (GCompareFunc) pad_zorder_compare);
   GST_OBJECT_UNLOCK (vagg);
@@ -2189,6 +2500,10 @@ gst_video_aggregator_finalize (GObject * o)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
+  if (vagg->priv->prepare_pool)
+    g_thread_pool_free (vagg->priv->prepare_pool, FALSE, TRUE);
+  g_mutex_clear (&vagg->priv->prepare_lock);
+  g_cond_clear (&vagg->priv->prepare_cond);
   g_mutex_clear (&vagg->priv->lock);
 
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->finalize (o);
@@ -2204,11 +2519,113 @@ gst_video_aggregator_dispose (GObject * o)
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->dispose (o);
 }
 
+static void
+gst_video_aggregator_add_time_stats (GstStructure * s, const gchar * prefix,
+    const GstVideoAggregatorTimeStats * stats)
+{
+  GValue histogram = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  gchar *name;
+  guint i;
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+  for (i = 0; i < N_TIME_BUCKETS; i++) {
+    g_value_set_uint64 (&v, stats->buckets[i]);
+    gst_value_array_append_value (&histogram, &v);
+  }
+  g_value_unset (&v);
+
+  name = g_strdup_printf ("%s-time-histogram", prefix);
+  gst_structure_take_value (s, name, &histogram);
+  g_free (name);
+
+  name = g_strdup_printf ("%s-time-average", prefix);
+  gst_structure_set (s, name, G_TYPE_UINT64,
+      stats->count ? stats->total / stats->count : 0, NULL);
+  g_free (name);
+
+  name = g_strdup_printf ("%s-time-max", prefix);
+  gst_structure_set (s, name, G_TYPE_UINT64, stats->max, NULL);
+  g_free (name);
+}
+
+static GstStructure *
+gst_video_aggregator_create_stats (GstVideoAggregator * vagg)
+{
+  GstStructure *s;
+  GValue pads = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  GList *l;
+
+  g_value_init (&pads, GST_TYPE_ARRAY);
+  g_value_init (&v, GST_TYPE_STRUCTURE);
+
+  GST_OBJECT_LOCK (vagg);
+  s = gst_structure_new ("application/x-videoaggregator-stats",
+      "processed", G_TYPE_UINT64, vagg->priv->qos_processed,
+      "dropped", G_TYPE_UINT64, vagg->priv->qos_dropped,
+      "timeouts", G_TYPE_UINT64, vagg->priv->timeouts, NULL);
+  gst_video_aggregator_add_time_stats (s, "aggregate",
+      &vagg->priv->aggregate_stats);
+  gst_video_aggregator_add_time_stats (s, "blend", &vagg->priv->blend_stats);
+
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstVideoAggregatorPadPrivate *priv = pad->priv;
+    GstStructure *pad_stats;
+    guint64 queued;
+
+    GST_OBJECT_LOCK (pad);
+    pad_stats = gst_structure_new ("application/x-videoaggregator-pad-stats",
+        "name", G_TYPE_STRING, GST_OBJECT_NAME (pad),
+        "skipped", G_TYPE_UINT64, priv->skipped,
+        "missed", G_TYPE_UINT64, priv->missed, NULL);
+    /* the arrivals are only counted by the enable-stats probe */
+    if (priv->stats_probe_id) {
+      queued = priv->received - priv->skipped;
+      queued = queued > priv->consumed ? queued - priv->consumed : 0;
+      gst_structure_set (pad_stats,
+          "received", G_TYPE_UINT64, priv->received,
+          "queued", G_TYPE_UINT64, queued, NULL);
+    }
+    if (priv->max_lateness != G_MININT64)
+      gst_structure_set (pad_stats,
+          "lateness", G_TYPE_INT64, priv->lateness,
+          "max-lateness", G_TYPE_INT64, priv->max_lateness, NULL);
+    GST_OBJECT_UNLOCK (pad);
+
+    g_value_take_boxed (&v, pad_stats);
+    gst_value_array_append_value (&pads, &v);
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  g_value_unset (&v);
+  gst_structure_take_value (s, "pads", &pads);
+
+  return s;
+}
+
 static void
 gst_video_aggregator_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_N_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      g_value_set_uint (value, vagg->priv->n_prepare_threads);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
+    case PROP_ENABLE_STATS:
+      GST_OBJECT_LOCK (vagg);
+      g_value_set_boolean (value, vagg->priv->enable_stats);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_video_aggregator_create_stats (vagg));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2219,7 +2636,25 @@ static void
 gst_video_aggregator_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (object);
+
   switch (prop_id) {
+    case PROP_N_PREPARE_THREADS:
+      GST_OBJECT_LOCK (vagg);
+      vagg->priv->n_prepare_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
+    case PROP_ENABLE_STATS:{
+      GList *l;
+
+      GST_OBJECT_LOCK (vagg);
+      vagg->priv->enable_stats = g_value_get_boolean (value);
+      for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next)
+        gst_video_aggregator_pad_set_stats_probe (l->data,
+            vagg->priv->enable_stats);
+      GST_OBJECT_UNLOCK (vagg);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2272,6 +2707,69 @@ gst_video_aggregator_class_init (GstVideoAggregatorClass * klass)
   klass->get_output_buffer = gst_video_aggregator_get_output_buffer;
   klass->update_caps = gst_video_aggregator_default_update_caps;
 
+  /**
+   * GstVideoAggregator:n-prepare-threads:
+   *
+   * Number of threads preparing (converting and scaling) the frames of the
+   * sink pads before they are aggregated, one pad per thread at a time.
+   * 0 uses one thread per processor. The #GstVideoAggregatorPadClass
+   * prepare_frame implementation has to be thread-safe when this is not 1.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_N_PREPARE_THREADS,
+      g_param_spec_uint ("n-prepare-threads", "Number of prepare threads",
+          "Number of threads used to convert the input frames "
+          "(0 = number of processors)", 0, G_MAXUINT,
+          DEFAULT_N_PREPARE_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVideoAggregator:enable-stats:
+   *
+   * Watch the buffers arriving on the sink pads to fill the "received",
+   * "queued", "lateness" and "max-lateness" fields of
+   * #GstVideoAggregator:stats. This adds a probe on every sink pad, so it
+   * is off by default.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ENABLE_STATS,
+      g_param_spec_boolean ("enable-stats", "Enable statistics",
+          "Measure the arrival of the buffers on the sink pads",
+          DEFAULT_ENABLE_STATS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstVideoAggregator:stats:
+   *
+   * Statistics to find out which sink pads make a live mixer miss its
+   * deadlines. The #GstStructure has these fields:
+   *
+   * * "processed" #guint64: output frames produced
+   * * "dropped" #guint64: output frames dropped because of QoS
+   * * "timeouts" #guint64: output frames produced on timeout while some
+   *   pads had no buffer
+   * * "aggregate-time-histogram" #GstValueArray of #guint64: frames per
+   *   time taken to produce them, bucket i counts the times below 2^i ms
+   *   and the last bucket all the longer ones
+   * * "aggregate-time-average" and "aggregate-time-max" #guint64: time in
+   *   nanoseconds taken to produce a frame
+   * * "blend-time-histogram", "blend-time-average" and "blend-time-max":
+   *   the same for the #GstVideoAggregatorClass.aggregate_frames() part
+   * * "pads" #GstValueArray of #GstStructure: per sink pad "name"
+   *   (#gchararray), "skipped" (too late to be used) and "missed" (no
+   *   buffer on timeout) #guint64. With #GstVideoAggregator:enable-stats
+   *   also "received" and "queued" #guint64, and once measured in a
+   *   running pipeline "lateness" and "max-lateness" (#gint64), the time
+   *   by which the buffers arrived after their running time
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Aggregation statistics and per sink pad input statistics",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   /* Register the pad class */
   g_type_class_ref (GST_TYPE_VIDEO_AGGREGATOR_PAD);
 }
@@ -2360,6 +2858,10 @@ gst_video_aggregator_init (GstVideoAggregator * vagg,
   vagg->priv->current_caps = NULL;
 
   g_mutex_init (&vagg->priv->lock);
+  g_mutex_init (&vagg->priv->prepare_lock);
+  g_cond_init (&vagg->priv->prepare_cond);
+  vagg->priv->n_prepare_threads = DEFAULT_N_PREPARE_THREADS;
+  vagg->priv->enable_stats = DEFAULT_ENABLE_STATS;
 
   /* initialize variables */
   g_mutex_lock (&sink_caps_mutex);
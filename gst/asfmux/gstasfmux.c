@@ -91,7 +91,9 @@ enum
   PROP_PREROLL,
   PROP_MERGE_STREAM_TAGS,
   PROP_PADDING,
-  PROP_STREAMABLE
+  PROP_STREAMABLE,
+  PROP_WRITE_SIZE,
+  PROP_WRITE_LATENCY
 };
 
 /* Stores a tag list for the available/known tags
@@ -129,6 +131,8 @@ typedef GstAsfExtContDescData GstAsfMetadataObjData;
 #define DEFAULT_MERGE_STREAM_TAGS TRUE
 #define DEFAULT_PADDING 0
 #define DEFAULT_STREAMABLE FALSE
+#define DEFAULT_WRITE_SIZE 0
+#define DEFAULT_WRITE_LATENCY (100 * GST_MSECOND)
 
 static GstStaticPadTemplate src_factory = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -174,6 +178,22 @@ static GstElementClass *parent_class = NULL;
 G_DEFINE_TYPE_WITH_CODE (GstAsfMux, gst_asf_mux, GST_TYPE_ELEMENT,
     G_IMPLEMENT_INTERFACE (GST_TYPE_TAG_SETTER, NULL));
 
+static void
+gst_asf_mux_clear_packets (GstAsfMux * asfmux)
+{
+  if (asfmux->packet_list) {
+    gst_buffer_list_unref (asfmux->packet_list);
+    asfmux->packet_list = NULL;
+  }
+  asfmux->packet_list_size = 0;
+  asfmux->packet_list_ts = GST_CLOCK_TIME_NONE;
+  if (asfmux->packet_pool) {
+    gst_buffer_pool_set_active (asfmux->packet_pool, FALSE);
+    gst_object_unref (asfmux->packet_pool);
+    asfmux->packet_pool = NULL;
+  }
+}
+
 static void
 gst_asf_mux_reset (GstAsfMux * asfmux)
 {
@@ -186,6 +206,7 @@ gst_asf_mux_reset (GstAsfMux * asfmux)
   asfmux->file_size = 0;
   asfmux->packet_size = 0;
   asfmux->first_ts = GST_CLOCK_TIME_NONE;
+  gst_asf_mux_clear_packets (asfmux);
 
   if (asfmux->payloads) {
     GSList *walk;
@@ -267,6 +288,35 @@ gst_asf_mux_class_init (GstAsfMuxClass * klass)
           DEFAULT_STREAMABLE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAsfMux:write-size:
+   *
+   * Push the data packets downstream in buffer lists of at least this many
+   * bytes, so that writers get fewer and larger writes. 0 pushes every
+   * packet on its own.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WRITE_SIZE,
+      g_param_spec_uint ("write-size", "Write size",
+          "Push data packets in lists of at least this many bytes "
+          "(0 = disabled)", 0, G_MAXUINT, DEFAULT_WRITE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAsfMux:write-latency:
+   *
+   * Maximum time span of the data packets held back in one list when
+   * #GstAsfMux:write-size is set.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WRITE_LATENCY,
+      g_param_spec_uint64 ("write-latency", "Write latency",
+          "Maximum time span of the data packets held back in one list (in ns)",
+          0, G_MAXUINT64, DEFAULT_WRITE_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_asf_mux_request_new_pad);
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_asf_mux_change_state);
@@ -306,6 +356,8 @@ gst_asf_mux_init (GstAsfMux * asfmux)
   asfmux->prop_merge_stream_tags = DEFAULT_MERGE_STREAM_TAGS;
   asfmux->prop_padding = DEFAULT_PADDING;
   asfmux->prop_streamable = DEFAULT_STREAMABLE;
+  asfmux->prop_write_size = DEFAULT_WRITE_SIZE;
+  asfmux->prop_write_latency = DEFAULT_WRITE_LATENCY;
   gst_asf_mux_reset (asfmux);
 }
 
@@ -363,6 +415,38 @@ gst_asf_mux_sink_event (GstCollectPads * pads, GstCollectData * cdata,
   return ret;
 }
 
+/**
+ * gst_asf_mux_push_packet_list:
+ * @asfmux: #GstAsfMux that should push the list
+ *
+ * Pushes the data packets held back in the pending list downstream
+ * and adds their size to the total file size
+ *
+ * Returns: the result of #gst_pad_push_list on the list
+ */
+static GstFlowReturn
+gst_asf_mux_push_packet_list (GstAsfMux * asfmux)
+{
+  GstFlowReturn ret;
+  GstBufferList *list = asfmux->packet_list;
+
+  if (list == NULL)
+    return GST_FLOW_OK;
+
+  GST_LOG_OBJECT (asfmux, "Pushing %u data packets, %" G_GSIZE_FORMAT
+      " bytes", gst_buffer_list_length (list), asfmux->packet_list_size);
+
+  asfmux->packet_list = NULL;
+  ret = gst_pad_push_list (asfmux->srcpad, list);
+
+  if (ret == GST_FLOW_OK)
+    asfmux->file_size += asfmux->packet_list_size;
+  asfmux->packet_list_size = 0;
+  asfmux->packet_list_ts = GST_CLOCK_TIME_NONE;
+
+  return ret;
+}
+
 /**
  * gst_asf_mux_push_buffer:
  * @asfmux: #GstAsfMux that should push the buffer
@@ -377,6 +461,13 @@ gst_asf_mux_push_buffer (GstAsfMux * asfmux, GstBuffer * buf, gsize bufsize)
 {
   GstFlowReturn ret;
 
+  /* keep the held back data packets in front of this buffer */
+  ret = gst_asf_mux_push_packet_list (asfmux);
+  if (ret != GST_FLOW_OK) {
+    gst_buffer_unref (buf);
+    return ret;
+  }
+
   ret = gst_pad_push (asfmux->srcpad, buf);
 
   if (ret == GST_FLOW_OK)
@@ -1432,20 +1523,41 @@ gst_asf_mux_add_simple_index_entry (GstAsfMux * asfmux,
  *
  * Pushes an asf data packet downstream. The total number
  * of packets and bytes of the stream are incremented.
+ * If write-size is set, the packet is held back in a list
+ * until enough data or time has been gathered.
  *
  * Returns: the result of pushing the buffer downstream
  */
 static GstFlowReturn
 gst_asf_mux_send_packet (GstAsfMux * asfmux, GstBuffer * buf, gsize bufsize)
 {
+  GstClockTime ts = GST_BUFFER_TIMESTAMP (buf);
+
   g_assert (bufsize == asfmux->packet_size);
   asfmux->total_data_packets++;
   GST_LOG_OBJECT (asfmux,
       "Pushing a packet of size %" G_GSIZE_FORMAT " and timestamp %"
-      G_GUINT64_FORMAT, bufsize, GST_BUFFER_TIMESTAMP (buf));
+      G_GUINT64_FORMAT, bufsize, ts);
   GST_LOG_OBJECT (asfmux, "Total data packets: %" G_GUINT64_FORMAT,
       asfmux->total_data_packets);
-  return gst_asf_mux_push_buffer (asfmux, buf, bufsize);
+
+  if (asfmux->prop_write_size == 0)
+    return gst_asf_mux_push_buffer (asfmux, buf, bufsize);
+
+  if (asfmux->packet_list == NULL)
+    asfmux->packet_list = gst_buffer_list_new ();
+  gst_buffer_list_add (asfmux->packet_list, buf);
+  asfmux->packet_list_size += bufsize;
+  if (!GST_CLOCK_TIME_IS_VALID (asfmux->packet_list_ts))
+    asfmux->packet_list_ts = ts;
+
+  if (asfmux->packet_list_size >= asfmux->prop_write_size ||
+      (GST_CLOCK_TIME_IS_VALID (ts) &&
+          GST_CLOCK_TIME_IS_VALID (asfmux->packet_list_ts) &&
+          ts >= asfmux->packet_list_ts + asfmux->prop_write_latency))
+    return gst_asf_mux_push_packet_list (asfmux);
+
+  return GST_FLOW_OK;
 }
 
 /**
@@ -1474,13 +1586,27 @@ gst_asf_mux_flush_payloads (GstAsfMux * asfmux)
   guint32 payload_size;
   guint offset;
   GstMapInfo map;
+  GstFlowReturn ret;
 
   if (asfmux->payloads == NULL)
     return GST_FLOW_OK;         /* nothing to send is ok */
 
   GST_LOG_OBJECT (asfmux, "Flushing payloads");
 
-  buf = gst_buffer_new_and_alloc (asfmux->packet_size);
+  if (G_UNLIKELY (asfmux->packet_pool == NULL)) {
+    GstStructure *config;
+
+    asfmux->packet_pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (asfmux->packet_pool);
+    gst_buffer_pool_config_set_params (config, NULL, asfmux->packet_size, 0,
+        0);
+    gst_buffer_pool_set_config (asfmux->packet_pool, config);
+    gst_buffer_pool_set_active (asfmux->packet_pool, TRUE);
+  }
+  ret = gst_buffer_pool_acquire_buffer (asfmux->packet_pool, &buf, NULL);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
   gst_buffer_map (buf, &map, GST_MAP_WRITE);
   memset (map.data, 0, asfmux->packet_size);
 
@@ -2033,6 +2159,9 @@ gst_asf_mux_collected (GstCollectPads * collect, gpointer data)
     }
     g_assert (asfmux->payloads == NULL);
     g_assert (asfmux->payload_data_size == 0);
+    ret = gst_asf_mux_push_packet_list (asfmux);
+    if (ret != GST_FLOW_OK)
+      return ret;
     /* in not on 'streamable' mode we need to push indexes
      * and update headers */
     if (!asfmux->prop_streamable) {
@@ -2373,6 +2502,12 @@ gst_asf_mux_get_property (GObject * object,
     case PROP_STREAMABLE:
       g_value_set_boolean (value, asfmux->prop_streamable);
       break;
+    case PROP_WRITE_SIZE:
+      g_value_set_uint (value, asfmux->prop_write_size);
+      break;
+    case PROP_WRITE_LATENCY:
+      g_value_set_uint64 (value, asfmux->prop_write_latency);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2402,6 +2537,12 @@ gst_asf_mux_set_property (GObject * object,
     case PROP_STREAMABLE:
       asfmux->prop_streamable = g_value_get_boolean (value);
       break;
+    case PROP_WRITE_SIZE:
+      asfmux->prop_write_size = g_value_get_uint (value);
+      break;
+    case PROP_WRITE_LATENCY:
+      asfmux->prop_write_latency = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2432,6 +2573,7 @@ gst_asf_mux_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_collect_pads_stop (asfmux->collect);
       asfmux->state = GST_ASF_MUX_STATE_NONE;
+      gst_asf_mux_clear_packets (asfmux);
       break;
     default:
       break;
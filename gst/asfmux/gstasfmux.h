@@ -67,6 +67,12 @@ struct _GstAsfPad
   GstClockTime play_duration;
   GstClockTime first_ts;
 
+  /* data packets waiting to be pushed as a list */
+  GstBufferPool *packet_pool;
+  GstBufferList *packet_list;
+  gsize packet_list_size;
+  GstClockTime packet_list_ts;
+
   GstBuffer *codec_data;
 
   /* stream only metadata */
@@ -131,6 +137,8 @@ struct _GstAsfMux
   gboolean prop_merge_stream_tags;
   guint64 prop_padding;
   gboolean prop_streamable;
+  guint prop_write_size;
+  GstClockTime prop_write_latency;
 
   /* same as properties, but those are stored here to be
    * used without modification while muxing a single file */
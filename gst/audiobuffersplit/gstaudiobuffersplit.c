@@ -46,6 +46,7 @@ enum
   PROP_ALIGNMENT_THRESHOLD,
   PROP_DISCONT_WAIT,
   PROP_STRICT_BUFFER_SIZE,
+  PROP_STRICT_CADENCE,
   LAST_PROP
 };
 
@@ -54,6 +55,7 @@ enum
 #define DEFAULT_ALIGNMENT_THRESHOLD   (40 * GST_MSECOND)
 #define DEFAULT_DISCONT_WAIT (1 * GST_SECOND)
 #define DEFAULT_STRICT_BUFFER_SIZE (FALSE)
+#define DEFAULT_STRICT_CADENCE (FALSE)
 
 #define parent_class gst_audio_buffer_split_parent_class
 G_DEFINE_TYPE (GstAudioBufferSplit, gst_audio_buffer_split, GST_TYPE_ELEMENT);
@@ -114,6 +116,14 @@ gst_audio_buffer_split_class_init (GstAudioBufferSplitClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
           GST_PARAM_MUTABLE_READY));
 
+  g_object_class_install_property (gobject_class, PROP_STRICT_CADENCE,
+      g_param_spec_boolean ("strict-cadence", "Strict cadence",
+          "Insert silence or drop samples on discontinuities instead of "
+          "resyncing, to keep the output timestamps on the sample grid",
+          DEFAULT_STRICT_CADENCE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "Audio Buffer Split", "Audio/Filter",
       "Splits raw audio buffers into equal sized chunks",
@@ -148,6 +158,7 @@ gst_audio_buffer_split_init (GstAudioBufferSplit * self)
   self->output_buffer_duration_n = DEFAULT_OUTPUT_BUFFER_DURATION_N;
   self->output_buffer_duration_d = DEFAULT_OUTPUT_BUFFER_DURATION_D;
   self->strict_buffer_size = DEFAULT_STRICT_BUFFER_SIZE;
+  self->strict_cadence = DEFAULT_STRICT_CADENCE;
 
   self->adapter = gst_adapter_new ();
 
@@ -240,6 +251,9 @@ gst_audio_buffer_split_set_property (GObject * object, guint property_id,
     case PROP_STRICT_BUFFER_SIZE:
       self->strict_buffer_size = g_value_get_boolean (value);
       break;
+    case PROP_STRICT_CADENCE:
+      self->strict_cadence = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -272,6 +286,9 @@ gst_audio_buffer_split_get_property (GObject * object, guint property_id,
     case PROP_STRICT_BUFFER_SIZE:
       g_value_set_boolean (value, self->strict_buffer_size);
       break;
+    case PROP_STRICT_CADENCE:
+      g_value_set_boolean (value, self->strict_cadence);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -343,7 +360,9 @@ gst_audio_buffer_split_output (GstAudioBufferSplit * self, gboolean force,
     GstClockTime resync_time_diff;
 
     size = MIN (size, avail);
-    buffer = gst_adapter_take_buffer (self->adapter, size);
+    /* Output periods that span several input buffers are returned as a
+     * list of memories instead of being copied into a single one */
+    buffer = gst_adapter_take_buffer_fast (self->adapter, size);
 
     /* After a reset we have to set the discont flag */
     if (self->current_offset == 0)
@@ -397,9 +416,87 @@ gst_audio_buffer_split_output (GstAudioBufferSplit * self, gboolean force,
   return ret;
 }
 
+/* Keeps the output on the sample grid across a discontinuity: the gap
+ * between the samples queued so far and the new buffer is filled with
+ * silence, or the overlapping samples at the start of the buffer are
+ * dropped. Returns FALSE if the buffer can't be placed on the grid, or if
+ * the gap is longer than discont-wait (and one output buffer), in which
+ * case the stream is resynced instead of allocating all that silence. */
+static gboolean
+gst_audio_buffer_split_fill_gap (GstAudioBufferSplit * self,
+    GstBuffer ** buffer, gint rate, gint bpf)
+{
+  GstClockTime pts = GST_BUFFER_PTS (*buffer);
+  guint64 n_samples = gst_buffer_get_size (*buffer) / bpf;
+  gint64 expected, actual;
+  GstClockTime max_gap;
+
+  if (self->segment.rate < 0.0 || self->current_offset == -1
+      || !GST_CLOCK_TIME_IS_VALID (pts)
+      || !GST_CLOCK_TIME_IS_VALID (self->resync_time))
+    return FALSE;
+
+  expected =
+      self->current_offset + gst_adapter_available (self->adapter) / bpf;
+  if (pts >= self->resync_time)
+    actual =
+        gst_util_uint64_scale_round (pts - self->resync_time, rate,
+        GST_SECOND);
+  else
+    actual =
+        -(gint64) gst_util_uint64_scale_round (self->resync_time - pts, rate,
+        GST_SECOND);
+
+  GST_OBJECT_LOCK (self);
+  max_gap = MAX (gst_audio_stream_align_get_discont_wait (self->stream_align),
+      gst_util_uint64_scale (GST_SECOND, self->output_buffer_duration_n,
+          self->output_buffer_duration_d));
+  GST_OBJECT_UNLOCK (self);
+
+  if (actual - expected > (gint64) gst_util_uint64_scale (max_gap, rate,
+          GST_SECOND)) {
+    GST_DEBUG_OBJECT (self, "Gap of %" G_GINT64_FORMAT " samples too long "
+        "to be filled, resyncing", actual - expected);
+    return FALSE;
+  }
+
+  if (actual > expected) {
+    GstBuffer *gap;
+    GstMapInfo map;
+    gsize size = (actual - expected) * bpf;
+
+    GST_DEBUG_OBJECT (self, "Inserting %" G_GINT64_FORMAT " samples of "
+        "silence", actual - expected);
+
+    gap = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_map (gap, &map, GST_MAP_WRITE);
+    gst_audio_format_fill_silence (self->info.finfo, map.data, map.size);
+    gst_buffer_unmap (gap, &map);
+    gst_adapter_push (self->adapter, gap);
+  } else if (actual < expected) {
+    guint64 drop = expected - actual;
+
+    GST_DEBUG_OBJECT (self, "Dropping %" G_GUINT64_FORMAT " overlapping "
+        "samples", MIN (drop, n_samples));
+
+    if (drop >= n_samples) {
+      gst_buffer_unref (*buffer);
+      *buffer = NULL;
+    } else {
+      GstBuffer *tmp = gst_buffer_copy_region (*buffer, GST_BUFFER_COPY_ALL,
+          drop * bpf, -1);
+
+      gst_buffer_unref (*buffer);
+      *buffer = tmp;
+    }
+  }
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_audio_buffer_split_handle_discont (GstAudioBufferSplit * self,
-    GstBuffer * buffer, gint rate, gint bpf, guint samples_per_buffer)
+    GstBuffer ** buffer, gint rate, gint bpf, guint samples_per_buffer)
 {
   gboolean discont;
   GstFlowReturn ret = GST_FLOW_OK;
@@ -407,12 +504,16 @@ gst_audio_buffer_split_handle_discont (GstAudioBufferSplit * self,
   GST_OBJECT_LOCK (self);
   discont =
       gst_audio_stream_align_process (self->stream_align,
-      self->segment.rate < 0 ? FALSE : GST_BUFFER_IS_DISCONT (buffer)
-      || GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_RESYNC),
-      GST_BUFFER_PTS (buffer), gst_buffer_get_size (buffer) / bpf, NULL, NULL,
-      NULL);
+      self->segment.rate < 0 ? FALSE : GST_BUFFER_IS_DISCONT (*buffer)
+      || GST_BUFFER_FLAG_IS_SET (*buffer, GST_BUFFER_FLAG_RESYNC),
+      GST_BUFFER_PTS (*buffer), gst_buffer_get_size (*buffer) / bpf, NULL,
+      NULL, NULL);
   GST_OBJECT_UNLOCK (self);
 
+  if (discont && self->strict_cadence
+      && gst_audio_buffer_split_fill_gap (self, buffer, rate, bpf))
+    return GST_FLOW_OK;
+
   if (discont) {
     if (self->strict_buffer_size) {
       gst_adapter_clear (self->adapter);
@@ -425,7 +526,7 @@ gst_audio_buffer_split_handle_discont (GstAudioBufferSplit * self,
 
     self->current_offset = 0;
     self->accumulated_error = 0;
-    self->resync_time = GST_BUFFER_PTS (buffer);
+    self->resync_time = GST_BUFFER_PTS (*buffer);
   }
 
   return ret;
@@ -468,12 +569,15 @@ gst_audio_buffer_split_sink_chain (GstPad * pad, GstObject * parent,
     return GST_FLOW_OK;
 
   ret =
-      gst_audio_buffer_split_handle_discont (self, buffer, rate, bpf,
+      gst_audio_buffer_split_handle_discont (self, &buffer, rate, bpf,
       samples_per_buffer);
   if (ret != GST_FLOW_OK) {
-    gst_buffer_unref (buffer);
+    if (buffer)
+      gst_buffer_unref (buffer);
     return ret;
   }
+  if (!buffer)
+    return GST_FLOW_OK;
 
   gst_adapter_push (self->adapter, buffer);
 
@@ -61,6 +61,7 @@ struct _GstAudioBufferSplit {
   guint accumulated_error;
 
   gboolean strict_buffer_size;
+  gboolean strict_cadence;
 };
 
 struct _GstAudioBufferSplitClass {
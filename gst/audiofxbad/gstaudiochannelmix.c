@@ -25,10 +25,19 @@
  * equal left/right channels on an input stream that has audio in only
  * one channel.
  *
+ * Streams with more than two channels are handled too, the gains then
+ * apply to the front left and front right channels and the others are
+ * left untouched.  The #GstAudioChannelMix:matrix property replaces the
+ * left/right gains with a full channels x channels gain matrix, for
+ * instance to fold the surround channels into the front pair.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -v audiotestsrc ! audiochannelmix ! autoaudiosink
  * ]|
+ * |[
+ * gst-launch-1.0 audiotestsrc ! audio/x-raw,channels=4 ! audiochannelmix matrix="<<1.0, 0.0, 0.5, 0.0>, <0.0, 1.0, 0.0, 0.5>, <0.0, 0.0, 0.0, 0.0>, <0.0, 0.0, 0.0, 0.0>>" ! fakesink
+ * ]|
  *
  */
 
@@ -40,6 +49,13 @@
 #include <gst/audio/gstaudiofilter.h>
 #include "gstaudiochannelmix.h"
 #include <math.h>
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 GST_DEBUG_CATEGORY_STATIC (gst_audio_channel_mix_debug_category);
 #define GST_CAT_DEFAULT gst_audio_channel_mix_debug_category
@@ -51,6 +67,7 @@ static void gst_audio_channel_mix_set_property (GObject * object,
     guint property_id, const GValue * value, GParamSpec * pspec);
 static void gst_audio_channel_mix_get_property (GObject * object,
     guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_audio_channel_mix_finalize (GObject * object);
 
 static gboolean gst_audio_channel_mix_setup (GstAudioFilter * filter,
     const GstAudioInfo * info);
@@ -63,25 +80,30 @@ enum
   PROP_LEFT_TO_LEFT,
   PROP_LEFT_TO_RIGHT,
   PROP_RIGHT_TO_LEFT,
-  PROP_RIGHT_TO_RIGHT
+  PROP_RIGHT_TO_RIGHT,
+  PROP_MATRIX
 };
 
+/* frames converted to float at a time by the matrix path */
+#define SCRATCH_FRAMES 256
+
+#define CAPS_STR "audio/x-raw,format={ " GST_AUDIO_NE (S16) ", " \
+    GST_AUDIO_NE (F32) " },rate=[1,max],channels=[2,max],layout=interleaved"
+
 /* pad templates */
 
 static GstStaticPadTemplate gst_audio_channel_mix_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("audio/x-raw,format=S16LE,rate=[1,max],"
-        "channels=2,layout=interleaved")
+    GST_STATIC_CAPS (CAPS_STR)
     );
 
 static GstStaticPadTemplate gst_audio_channel_mix_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
-    GST_STATIC_CAPS ("audio/x-raw,format=S16LE,rate=[1,max],"
-        "channels=2,layout=interleaved")
+    GST_STATIC_CAPS (CAPS_STR)
     );
 
 
@@ -113,9 +135,11 @@ gst_audio_channel_mix_class_init (GstAudioChannelMixClass * klass)
 
   gobject_class->set_property = gst_audio_channel_mix_set_property;
   gobject_class->get_property = gst_audio_channel_mix_get_property;
+  gobject_class->finalize = gst_audio_channel_mix_finalize;
   audio_filter_class->setup = GST_DEBUG_FUNCPTR (gst_audio_channel_mix_setup);
   base_transform_class->transform_ip =
       GST_DEBUG_FUNCPTR (gst_audio_channel_mix_transform_ip);
+  base_transform_class->transform_ip_on_passthrough = FALSE;
 
   g_object_class_install_property (gobject_class, PROP_LEFT_TO_LEFT,
       g_param_spec_double ("left-to-left", "Left to Left",
@@ -140,6 +164,26 @@ gst_audio_channel_mix_class_init (GstAudioChannelMixClass * klass)
           "Right channel to right channel gain",
           -G_MAXDOUBLE, G_MAXDOUBLE, 1.0,
           GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioChannelMix:matrix:
+   *
+   * Gain matrix with one row per output channel and one column per input
+   * channel, for as many channels as the stream has.  When set, it is
+   * used instead of the left/right gains.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MATRIX,
+      gst_param_spec_array ("matrix", "Matrix",
+          "Channel gain matrix, one row per output channel (empty to use "
+          "the left/right gains)",
+          gst_param_spec_array ("matrix-row", "Row", "Row",
+              g_param_spec_double ("matrix-gain", "Gain", "Gain",
+                  -G_MAXDOUBLE, G_MAXDOUBLE, 0.0,
+                  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+              G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -149,6 +193,52 @@ gst_audio_channel_mix_init (GstAudioChannelMix * audiochannelmix)
   audiochannelmix->left_to_right = 0.0;
   audiochannelmix->right_to_left = 0.0;
   audiochannelmix->right_to_right = 1.0;
+  audiochannelmix->dirty = TRUE;
+}
+
+static void
+gst_audio_channel_mix_finalize (GObject * object)
+{
+  GstAudioChannelMix *audiochannelmix = GST_AUDIO_CHANNEL_MIX (object);
+
+  g_free (audiochannelmix->matrix);
+  g_free (audiochannelmix->dense);
+  g_free (audiochannelmix->scratch);
+
+  G_OBJECT_CLASS (gst_audio_channel_mix_parent_class)->finalize (object);
+}
+
+static void
+gst_audio_channel_mix_set_matrix (GstAudioChannelMix * audiochannelmix,
+    const GValue * value)
+{
+  gint n = gst_value_array_get_size (value);
+  gdouble *matrix;
+  gint in, out;
+
+  g_free (audiochannelmix->matrix);
+  audiochannelmix->matrix = NULL;
+  audiochannelmix->matrix_channels = 0;
+
+  if (n == 0)
+    return;
+
+  matrix = g_new (gdouble, n * n);
+  for (out = 0; out < n; out++) {
+    const GValue *row = gst_value_array_get_value (value, out);
+
+    if (gst_value_array_get_size (row) != n) {
+      GST_WARNING_OBJECT (audiochannelmix, "matrix is not square, ignoring");
+      g_free (matrix);
+      return;
+    }
+    for (in = 0; in < n; in++)
+      matrix[out * n + in] =
+          g_value_get_double (gst_value_array_get_value (row, in));
+  }
+
+  audiochannelmix->matrix = matrix;
+  audiochannelmix->matrix_channels = n;
 }
 
 void
@@ -159,6 +249,7 @@ gst_audio_channel_mix_set_property (GObject * object, guint property_id,
 
   GST_DEBUG_OBJECT (audiochannelmix, "set_property");
 
+  GST_OBJECT_LOCK (audiochannelmix);
   switch (property_id) {
     case PROP_LEFT_TO_LEFT:
       audiochannelmix->left_to_left = g_value_get_double (value);
@@ -172,10 +263,19 @@ gst_audio_channel_mix_set_property (GObject * object, guint property_id,
     case PROP_RIGHT_TO_RIGHT:
       audiochannelmix->right_to_right = g_value_get_double (value);
       break;
+    case PROP_MATRIX:
+      gst_audio_channel_mix_set_matrix (audiochannelmix, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
   }
+  audiochannelmix->dirty = TRUE;
+  GST_OBJECT_UNLOCK (audiochannelmix);
+
+  /* the gains may not be the identity anymore */
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (audiochannelmix),
+      FALSE);
 }
 
 void
@@ -186,6 +286,7 @@ gst_audio_channel_mix_get_property (GObject * object, guint property_id,
 
   GST_DEBUG_OBJECT (audiochannelmix, "get_property");
 
+  GST_OBJECT_LOCK (audiochannelmix);
   switch (property_id) {
     case PROP_LEFT_TO_LEFT:
       g_value_set_double (value, audiochannelmix->left_to_left);
@@ -199,20 +300,380 @@ gst_audio_channel_mix_get_property (GObject * object, guint property_id,
     case PROP_RIGHT_TO_RIGHT:
       g_value_set_double (value, audiochannelmix->right_to_right);
       break;
+    case PROP_MATRIX:{
+      gint n = audiochannelmix->matrix_channels;
+      gint in, out;
+
+      for (out = 0; out < n; out++) {
+        GValue row = G_VALUE_INIT;
+
+        g_value_init (&row, GST_TYPE_ARRAY);
+        for (in = 0; in < n; in++) {
+          GValue itm = G_VALUE_INIT;
+
+          g_value_init (&itm, G_TYPE_DOUBLE);
+          g_value_set_double (&itm, audiochannelmix->matrix[out * n + in]);
+          gst_value_array_append_value (&row, &itm);
+          g_value_unset (&itm);
+        }
+        gst_value_array_append_value (value, &row);
+        g_value_unset (&row);
+      }
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
   }
+  GST_OBJECT_UNLOCK (audiochannelmix);
+}
+
+/* Builds the channels x channels gain matrix applied in place to every
+ * frame, either from the matrix property or from the left/right gains
+ * placed on the front left/right channels, and picks the kernel for it:
+ * nothing for the identity, the stereo pair kernel when only the 2x2
+ * block of the front pair differs from the identity and the dense matrix
+ * otherwise. Called with the object lock held. */
+static gboolean
+gst_audio_channel_mix_prepare (GstAudioChannelMix * audiochannelmix)
+{
+  GstAudioInfo *info = &GST_AUDIO_FILTER (audiochannelmix)->info;
+  gint n = GST_AUDIO_INFO_CHANNELS (info);
+  gint stride = GST_ROUND_UP_4 (n);
+  gint left = 0, right = 1;
+  gint lo, hi, in, out;
+  gdouble *m;
+
+  g_free (audiochannelmix->dense);
+  audiochannelmix->dense = NULL;
+  g_free (audiochannelmix->scratch);
+  audiochannelmix->scratch = NULL;
+
+  for (in = 0; in < n; in++) {
+    if (info->position[in] == GST_AUDIO_CHANNEL_POSITION_FRONT_LEFT)
+      left = in;
+    else if (info->position[in] == GST_AUDIO_CHANNEL_POSITION_FRONT_RIGHT)
+      right = in;
+  }
+  if (left == right) {
+    left = 0;
+    right = 1;
+  }
+
+  if (audiochannelmix->matrix) {
+    if (audiochannelmix->matrix_channels != n)
+      return FALSE;
+    m = g_memdup (audiochannelmix->matrix, n * n * sizeof (gdouble));
+  } else {
+    m = g_new0 (gdouble, n * n);
+    for (in = 0; in < n; in++)
+      m[in * n + in] = 1.0;
+    m[left * n + left] = audiochannelmix->left_to_left;
+    m[right * n + left] = audiochannelmix->left_to_right;
+    m[left * n + right] = audiochannelmix->right_to_left;
+    m[right * n + right] = audiochannelmix->right_to_right;
+  }
+
+  lo = MIN (left, right);
+  hi = MAX (left, right);
+  audiochannelmix->identity = TRUE;
+  audiochannelmix->pair_only = TRUE;
+  for (out = 0; out < n; out++) {
+    for (in = 0; in < n; in++) {
+      if (m[out * n + in] == (in == out ? 1.0 : 0.0))
+        continue;
+      audiochannelmix->identity = FALSE;
+      if ((in != lo && in != hi) || (out != lo && out != hi))
+        audiochannelmix->pair_only = FALSE;
+    }
+  }
+
+  /* the pair gains in memory order: lo to lo, lo to hi, hi to lo and
+   * hi to hi */
+  audiochannelmix->pair_lo = lo;
+  audiochannelmix->pair_hi = hi;
+  audiochannelmix->pair[0] = m[lo * n + lo];
+  audiochannelmix->pair[1] = m[hi * n + lo];
+  audiochannelmix->pair[2] = m[lo * n + hi];
+  audiochannelmix->pair[3] = m[hi * n + hi];
+
+  /* same layout as the dense audiomixmatrix kernel: one row of output
+   * gains per input channel, padded to a multiple of 4 */
+  if (!audiochannelmix->pair_only) {
+    audiochannelmix->dense = g_new0 (gfloat, n * stride);
+    for (in = 0; in < n; in++) {
+      for (out = 0; out < n; out++)
+        audiochannelmix->dense[in * stride + out] = m[out * n + in];
+    }
+    audiochannelmix->scratch = g_new (gfloat, 2 * SCRATCH_FRAMES * n);
+  }
+  g_free (m);
+
+  GST_DEBUG_OBJECT (audiochannelmix, "%d channels, %s", n,
+      audiochannelmix->identity ? "identity" : audiochannelmix->pair_only ?
+      "stereo pair" : "dense matrix");
+
+  return TRUE;
+}
+
+static inline gint16
+gst_audio_channel_mix_round_s16 (gfloat v)
+{
+  return rintf (CLAMP (v, -32768.0f, 32767.0f));
+}
+
+#if defined (__SSE2__)
+/* Rounds and saturates 8 samples, CLAMP (rint (v)) */
+static inline __m128i
+gst_audio_channel_mix_pack_s16 (__m128 v0, __m128 v1)
+{
+  const __m128 min = _mm_set1_ps (-32768.0f);
+  const __m128 max = _mm_set1_ps (32767.0f);
+
+  v0 = _mm_min_ps (_mm_max_ps (v0, min), max);
+  v1 = _mm_min_ps (_mm_max_ps (v1, min), max);
+  return _mm_packs_epi32 (_mm_cvtps_epi32 (v0), _mm_cvtps_epi32 (v1));
+}
+
+/* Mixes two interleaved stereo frames */
+static inline __m128
+gst_audio_channel_mix_pair_ps (__m128 v, __m128 c0, __m128 c1)
+{
+  __m128 a = _mm_shuffle_ps (v, v, _MM_SHUFFLE (2, 2, 0, 0));
+  __m128 b = _mm_shuffle_ps (v, v, _MM_SHUFFLE (3, 3, 1, 1));
+
+  return _mm_add_ps (_mm_mul_ps (a, c0), _mm_mul_ps (b, c1));
+}
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+static inline int16x8_t
+gst_audio_channel_mix_pack_s16 (float32x4_t v0, float32x4_t v1)
+{
+  const float32x4_t min = vdupq_n_f32 (-32768.0f);
+  const float32x4_t max = vdupq_n_f32 (32767.0f);
+  /* adding 1.5 * 2^23 rounds to nearest even into the low mantissa bits */
+  const float32x4_t magic = vdupq_n_f32 (12582912.0f);
+  const int32x4_t magic_bits = vdupq_n_s32 (0x4b400000);
+  int32x4_t i0, i1;
+
+  v0 = vaddq_f32 (vminq_f32 (vmaxq_f32 (v0, min), max), magic);
+  v1 = vaddq_f32 (vminq_f32 (vmaxq_f32 (v1, min), max), magic);
+  i0 = vsubq_s32 (vreinterpretq_s32_f32 (v0), magic_bits);
+  i1 = vsubq_s32 (vreinterpretq_s32_f32 (v1), magic_bits);
+  return vcombine_s16 (vmovn_s32 (i0), vmovn_s32 (i1));
+}
+
+static inline float32x4_t
+gst_audio_channel_mix_pair_ps (float32x4_t v, float32x4_t c0, float32x4_t c1)
+{
+  float32x4x2_t t = vtrnq_f32 (v, v);
+
+  return vaddq_f32 (vmulq_f32 (t.val[0], c0), vmulq_f32 (t.val[1], c1));
+}
+#endif
+
+static void
+gst_audio_channel_mix_pair_f32 (const gfloat * c, gfloat * data,
+    gint channels, gint lo, gint hi, gint n_frames)
+{
+  gint i = 0;
+
+  if (channels == 2) {
+#if defined (__SSE2__)
+    __m128 c0 = _mm_setr_ps (c[0], c[1], c[0], c[1]);
+    __m128 c1 = _mm_setr_ps (c[2], c[3], c[2], c[3]);
+
+    for (; i + 2 <= n_frames; i += 2)
+      _mm_storeu_ps (data + 2 * i,
+          gst_audio_channel_mix_pair_ps (_mm_loadu_ps (data + 2 * i), c0,
+              c1));
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    const gfloat c0s[4] = { c[0], c[1], c[0], c[1] };
+    const gfloat c1s[4] = { c[2], c[3], c[2], c[3] };
+    float32x4_t c0 = vld1q_f32 (c0s);
+    float32x4_t c1 = vld1q_f32 (c1s);
+
+    for (; i + 2 <= n_frames; i += 2)
+      vst1q_f32 (data + 2 * i,
+          gst_audio_channel_mix_pair_ps (vld1q_f32 (data + 2 * i), c0, c1));
+#endif
+  }
+
+  for (; i < n_frames; i++) {
+    gfloat *frame = data + i * channels;
+    gfloat a = frame[lo];
+    gfloat b = frame[hi];
+
+    frame[lo] = a * c[0] + b * c[2];
+    frame[hi] = a * c[1] + b * c[3];
+  }
+}
+
+static void
+gst_audio_channel_mix_pair_s16 (const gfloat * c, gint16 * data,
+    gint channels, gint lo, gint hi, gint n_frames)
+{
+  gint i = 0;
+
+  if (channels == 2) {
+#if defined (__SSE2__)
+    __m128 c0 = _mm_setr_ps (c[0], c[1], c[0], c[1]);
+    __m128 c1 = _mm_setr_ps (c[2], c[3], c[2], c[3]);
+
+    for (; i + 4 <= n_frames; i += 4) {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) (data + 2 * i));
+      __m128 v0 = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (v, v),
+              16));
+      __m128 v1 = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (v, v),
+              16));
+
+      v0 = gst_audio_channel_mix_pair_ps (v0, c0, c1);
+      v1 = gst_audio_channel_mix_pair_ps (v1, c0, c1);
+      _mm_storeu_si128 ((__m128i *) (data + 2 * i),
+          gst_audio_channel_mix_pack_s16 (v0, v1));
+    }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    const gfloat c0s[4] = { c[0], c[1], c[0], c[1] };
+    const gfloat c1s[4] = { c[2], c[3], c[2], c[3] };
+    float32x4_t c0 = vld1q_f32 (c0s);
+    float32x4_t c1 = vld1q_f32 (c1s);
+
+    for (; i + 4 <= n_frames; i += 4) {
+      int16x8_t v = vld1q_s16 (data + 2 * i);
+      float32x4_t v0 = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (v)));
+      float32x4_t v1 = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (v)));
+
+      v0 = gst_audio_channel_mix_pair_ps (v0, c0, c1);
+      v1 = gst_audio_channel_mix_pair_ps (v1, c0, c1);
+      vst1q_s16 (data + 2 * i, gst_audio_channel_mix_pack_s16 (v0, v1));
+    }
+#endif
+  }
+
+  for (; i < n_frames; i++) {
+    gint16 *frame = data + i * channels;
+    gfloat a = frame[lo];
+    gfloat b = frame[hi];
+
+    frame[lo] = gst_audio_channel_mix_round_s16 (a * c[0] + b * c[2]);
+    frame[hi] = gst_audio_channel_mix_round_s16 (a * c[1] + b * c[3]);
+  }
+}
+
+/* Same kernel as the dense audiomixmatrix path, inarray and outarray must
+ * not overlap */
+static void
+gst_audio_channel_mix_f32_dense (const gfloat * matrix,
+    const gfloat * inarray, gfloat * outarray, guint channels,
+    guint n_samples)
+{
+  guint stride = GST_ROUND_UP_4 (channels);
+  guint sample, in, out;
+
+  for (sample = 0; sample < n_samples; sample++) {
+    for (out = 0; out < channels; out += 4) {
+      gfloat acc[4];
+
+#if defined (__SSE2__)
+      __m128 vacc = _mm_setzero_ps ();
+
+      for (in = 0; in < channels; in++)
+        vacc = _mm_add_ps (vacc, _mm_mul_ps (_mm_set1_ps (inarray[in]),
+                _mm_loadu_ps (matrix + in * stride + out)));
+      if (out + 4 <= channels) {
+        _mm_storeu_ps (outarray + out, vacc);
+        continue;
+      }
+      _mm_storeu_ps (acc, vacc);
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+      float32x4_t vacc = vdupq_n_f32 (0);
+
+      for (in = 0; in < channels; in++)
+        vacc = vaddq_f32 (vacc, vmulq_n_f32 (vld1q_f32 (matrix + in * stride +
+                    out), inarray[in]));
+      if (out + 4 <= channels) {
+        vst1q_f32 (outarray + out, vacc);
+        continue;
+      }
+      vst1q_f32 (acc, vacc);
+#else
+      guint k;
+
+      acc[0] = acc[1] = acc[2] = acc[3] = 0;
+      for (in = 0; in < channels; in++) {
+        for (k = 0; k < 4; k++)
+          acc[k] += inarray[in] * matrix[in * stride + out + k];
+      }
+#endif
+      memcpy (outarray + out, acc, MIN (4, channels - out) * sizeof (gfloat));
+    }
+    inarray += channels;
+    outarray += channels;
+  }
+}
+
+static void
+gst_audio_channel_mix_store_s16 (const gfloat * src, gint16 * dest, gint n)
+{
+  gint i = 0;
+
+#if defined (__SSE2__)
+  for (; i + 8 <= n; i += 8)
+    _mm_storeu_si128 ((__m128i *) (dest + i),
+        gst_audio_channel_mix_pack_s16 (_mm_loadu_ps (src + i),
+            _mm_loadu_ps (src + i + 4)));
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  for (; i + 8 <= n; i += 8)
+    vst1q_s16 (dest + i, gst_audio_channel_mix_pack_s16 (vld1q_f32 (src + i),
+            vld1q_f32 (src + i + 4)));
+#endif
+
+  for (; i < n; i++)
+    dest[i] = gst_audio_channel_mix_round_s16 (src[i]);
+}
+
+/* Runs the dense matrix over the frames in blocks of SCRATCH_FRAMES, going
+ * through the scratch buffer as the mixing is done in place */
+static void
+gst_audio_channel_mix_dense (GstAudioChannelMix * audiochannelmix,
+    gpointer data, gboolean is_s16, gint channels, gint n_frames)
+{
+  gfloat *in = audiochannelmix->scratch;
+  gfloat *out = audiochannelmix->scratch + SCRATCH_FRAMES * channels;
+  gint i, k;
+
+  for (i = 0; i < n_frames; i += SCRATCH_FRAMES) {
+    gint len = MIN (SCRATCH_FRAMES, n_frames - i) * channels;
+
+    if (is_s16) {
+      gint16 *d = (gint16 *) data + i * channels;
+
+      for (k = 0; k < len; k++)
+        in[k] = d[k];
+      gst_audio_channel_mix_f32_dense (audiochannelmix->dense, in, out,
+          channels, len / channels);
+      gst_audio_channel_mix_store_s16 (out, d, len);
+    } else {
+      gfloat *d = (gfloat *) data + i * channels;
+
+      memcpy (in, d, len * sizeof (gfloat));
+      gst_audio_channel_mix_f32_dense (audiochannelmix->dense, in, d,
+          channels, len / channels);
+    }
+  }
 }
 
 static gboolean
 gst_audio_channel_mix_setup (GstAudioFilter * filter, const GstAudioInfo * info)
 {
-#ifndef GST_DISABLE_GST_DEBUG
   GstAudioChannelMix *audiochannelmix = GST_AUDIO_CHANNEL_MIX (filter);
 
   GST_DEBUG_OBJECT (audiochannelmix, "setup");
-#endif
+
+  GST_OBJECT_LOCK (audiochannelmix);
+  audiochannelmix->dirty = TRUE;
+  GST_OBJECT_UNLOCK (audiochannelmix);
+
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter), FALSE);
 
   return TRUE;
 }
@@ -221,30 +682,60 @@ static GstFlowReturn
 gst_audio_channel_mix_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 {
   GstAudioChannelMix *audiochannelmix = GST_AUDIO_CHANNEL_MIX (trans);
-  int n;
+  GstAudioInfo *info = &GST_AUDIO_FILTER (trans)->info;
+  gint channels = GST_AUDIO_INFO_CHANNELS (info);
+  gboolean is_s16 = GST_AUDIO_INFO_FORMAT (info) == GST_AUDIO_FORMAT_S16;
   GstMapInfo map;
-  int i;
-  double ll = audiochannelmix->left_to_left;
-  double lr = audiochannelmix->left_to_right;
-  double rl = audiochannelmix->right_to_left;
-  double rr = audiochannelmix->right_to_right;
-  int l, r;
-  gint16 *data;
+  gint n;
 
   GST_DEBUG_OBJECT (audiochannelmix, "transform_ip");
 
-  gst_buffer_map (buf, &map, GST_MAP_WRITE | GST_MAP_READ);
+  GST_OBJECT_LOCK (audiochannelmix);
+  if (audiochannelmix->dirty) {
+    if (!gst_audio_channel_mix_prepare (audiochannelmix)) {
+      gint matrix_channels = audiochannelmix->matrix_channels;
+
+      GST_OBJECT_UNLOCK (audiochannelmix);
+      GST_ELEMENT_ERROR (audiochannelmix, CORE, NEGOTIATION, (NULL),
+          ("Matrix is for %d channels but the stream has %d",
+              matrix_channels, channels));
+      return GST_FLOW_NOT_NEGOTIATED;
+    }
+    audiochannelmix->dirty = FALSE;
+  }
 
-  n = gst_buffer_get_size (buf) >> 2;
-  data = (gint16 *) map.data;
-  for (i = 0; i < n; i++) {
-    l = data[2 * i + 0];
-    r = data[2 * i + 1];
-    data[2 * i + 0] = CLAMP (rint (ll * l + rl * r), -32768, 32767);
-    data[2 * i + 1] = CLAMP (rint (lr * l + rr * r), -32768, 32767);
+  if (audiochannelmix->identity) {
+    GST_OBJECT_UNLOCK (audiochannelmix);
+
+    /* undo it again if the gains changed in the meantime */
+    gst_base_transform_set_passthrough (trans, TRUE);
+    GST_OBJECT_LOCK (audiochannelmix);
+    if (audiochannelmix->dirty) {
+      GST_OBJECT_UNLOCK (audiochannelmix);
+      gst_base_transform_set_passthrough (trans, FALSE);
+    } else {
+      GST_OBJECT_UNLOCK (audiochannelmix);
+    }
+    return GST_FLOW_OK;
   }
 
+  gst_buffer_map (buf, &map, GST_MAP_WRITE | GST_MAP_READ);
+
+  n = map.size / GST_AUDIO_INFO_BPF (info);
+  if (audiochannelmix->pair_only && is_s16)
+    gst_audio_channel_mix_pair_s16 (audiochannelmix->pair,
+        (gint16 *) map.data, channels, audiochannelmix->pair_lo,
+        audiochannelmix->pair_hi, n);
+  else if (audiochannelmix->pair_only)
+    gst_audio_channel_mix_pair_f32 (audiochannelmix->pair,
+        (gfloat *) map.data, channels, audiochannelmix->pair_lo,
+        audiochannelmix->pair_hi, n);
+  else
+    gst_audio_channel_mix_dense (audiochannelmix, map.data, is_s16,
+        channels, n);
+
   gst_buffer_unmap (buf, &map);
+  GST_OBJECT_UNLOCK (audiochannelmix);
 
   return GST_FLOW_OK;
 }
@@ -41,6 +41,19 @@ struct _GstAudioChannelMix
   double left_to_right;
   double right_to_left;
   double right_to_right;
+
+  /* user matrix, channels x channels gains indexed [out * n + in] */
+  gdouble *matrix;
+  gint matrix_channels;
+
+  /* derived from the properties and the negotiated layout */
+  gboolean dirty;
+  gboolean identity;
+  gint pair_lo, pair_hi;
+  gboolean pair_only;
+  gfloat pair[4];
+  gfloat *dense;
+  gfloat *scratch;
 };
 
 struct _GstAudioChannelMixClass
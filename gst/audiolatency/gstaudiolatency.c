@@ -49,12 +49,42 @@
  * "average-latency" fields in the GstStructure.
  *
  * The average latency is a running average of the last 5 measurements.
+ *
+ * ## Continuous mode
+ *
+ * With 'continuous' enabled, the ticks are replaced by a short maximum length
+ * sequence that is sent every 'interval' milliseconds. Incoming audio is
+ * correlated with that sequence, which finds the markers even with noise or
+ * filtering in the loop and places them with sub-sample precision. The
+ * latency must stay below the interval for the markers to be told apart.
+ *
+ * Every measurement then also adds the minimum, maximum, median, 90th and
+ * 99th percentile latency and the jitter of the last 'window-size'
+ * measurements to the "latency" element message, together with a histogram
+ * of them in bins of 'histogram-bin-width' microseconds:
+ *
+ *  * "min-latency", "max-latency", "p50-latency", "p90-latency",
+ *    "p99-latency" and "jitter" #G_TYPE_INT64, in microseconds
+ *  * "measurements" #G_TYPE_UINT: the number of measurements in the window
+ *  * "lost-markers" #G_TYPE_UINT: the markers that were sent but never
+ *    detected
+ *  * "histogram-start" and "histogram-bin-width" #G_TYPE_INT64: the lower
+ *    end of the first bin and the width of the bins, in microseconds
+ *  * "histogram" #GST_TYPE_ARRAY of #G_TYPE_UINT: the count of each bin
+ *
+ * |[
+ * gst-launch-1.0 autoaudiosrc ! audiolatency continuous=true interval=100 ! autoaudiosink
+ * ]| Measure the latency ten times a second
  */
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "gstaudiolatency.h"
 
 #define AUDIOLATENCY_CAPS "audio/x-raw, " \
@@ -82,16 +112,40 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
 G_DEFINE_TYPE (GstAudioLatency, gst_audiolatency, GST_TYPE_BIN);
 
 #define DEFAULT_PRINT_LATENCY   FALSE
+#define DEFAULT_CONTINUOUS      FALSE
+#define DEFAULT_INTERVAL        200
+#define DEFAULT_WINDOW_SIZE     100
+#define DEFAULT_HISTOGRAM_BIN_WIDTH 1000
 enum
 {
   PROP_0,
   PROP_PRINT_LATENCY,
   PROP_LAST_LATENCY,
-  PROP_AVERAGE_LATENCY
+  PROP_AVERAGE_LATENCY,
+  PROP_CONTINUOUS,
+  PROP_INTERVAL,
+  PROP_WINDOW_SIZE,
+  PROP_HISTOGRAM_BIN_WIDTH,
+  PROP_MIN_LATENCY,
+  PROP_MAX_LATENCY,
+  PROP_JITTER
 };
 
+/* audiotestsrc waves */
+#define WAVE_SILENCE 4
+#define WAVE_TICKS 8
+
+/* normalised correlation above which a marker is detected */
+#define MARKER_THRESHOLD 0.4
+
+/* the marker, +-0.5 */
+static gfloat mls[GST_AUDIOLATENCY_MLS_LENGTH];
+
 static gint64 gst_audiolatency_get_latency (GstAudioLatency * self);
 static gint64 gst_audiolatency_get_average_latency (GstAudioLatency * self);
+static void gst_audiolatency_get_extremes (GstAudioLatency * self,
+    gint64 * min, gint64 * max);
+static void gst_audiolatency_reset_continuous (GstAudioLatency * self);
 static GstFlowReturn gst_audiolatency_sink_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
 static GstPadProbeReturn gst_audiolatency_src_probe (GstPad * pad,
@@ -113,6 +167,37 @@ gst_audiolatency_get_property (GObject * object,
     case PROP_AVERAGE_LATENCY:
       g_value_set_int64 (value, gst_audiolatency_get_average_latency (self));
       break;
+    case PROP_CONTINUOUS:
+      g_value_set_boolean (value, self->continuous);
+      break;
+    case PROP_INTERVAL:
+      g_value_set_uint (value, self->interval);
+      break;
+    case PROP_WINDOW_SIZE:
+      g_value_set_uint (value, self->window_size);
+      break;
+    case PROP_HISTOGRAM_BIN_WIDTH:
+      g_value_set_uint (value, self->bin_width);
+      break;
+    case PROP_MIN_LATENCY:{
+      gint64 min, max;
+
+      gst_audiolatency_get_extremes (self, &min, &max);
+      g_value_set_int64 (value, min);
+      break;
+    }
+    case PROP_MAX_LATENCY:{
+      gint64 min, max;
+
+      gst_audiolatency_get_extremes (self, &min, &max);
+      g_value_set_int64 (value, max);
+      break;
+    }
+    case PROP_JITTER:
+      GST_OBJECT_LOCK (self);
+      g_value_set_int64 (value, (gint64) self->jitter);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -129,20 +214,67 @@ gst_audiolatency_set_property (GObject * object,
     case PROP_PRINT_LATENCY:
       self->print_latency = g_value_get_boolean (value);
       break;
+    case PROP_CONTINUOUS:
+      GST_OBJECT_LOCK (self);
+      self->continuous = g_value_get_boolean (value);
+      gst_audiolatency_reset_continuous (self);
+      GST_OBJECT_UNLOCK (self);
+      g_object_set (self->audiosrc, "wave",
+          self->continuous ? WAVE_SILENCE : WAVE_TICKS, NULL);
+      break;
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      self->interval = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_WINDOW_SIZE:
+      GST_OBJECT_LOCK (self);
+      self->window_size = g_value_get_uint (value);
+      g_free (self->window);
+      self->window = g_new0 (gint64, self->window_size);
+      self->window_fill = 0;
+      self->window_idx = 0;
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_HISTOGRAM_BIN_WIDTH:
+      GST_OBJECT_LOCK (self);
+      self->bin_width = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_audiolatency_finalize (GObject * object)
+{
+  GstAudioLatency *self = GST_AUDIOLATENCY (object);
+
+  g_free (self->work);
+  g_free (self->window);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_audiolatency_class_init (GstAudioLatencyClass * klass)
 {
   GObjectClass *gobject_class = (GObjectClass *) klass;
   GstElementClass *gstelement_class = (GstElementClass *) klass;
+  guint ii, lfsr = 0xff;
+
+  /* x^8 + x^6 + x^5 + x^4 + 1 */
+  for (ii = 0; ii < GST_AUDIOLATENCY_MLS_LENGTH; ii++) {
+    mls[ii] = (lfsr & 1) ? 0.5f : -0.5f;
+    lfsr = (lfsr >> 1) |
+        (((lfsr ^ (lfsr >> 2) ^ (lfsr >> 3) ^ (lfsr >> 4)) & 1) << 7);
+  }
 
   gobject_class->get_property = gst_audiolatency_get_property;
   gobject_class->set_property = gst_audiolatency_set_property;
+  gobject_class->finalize = gst_audiolatency_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PRINT_LATENCY,
       g_param_spec_boolean ("print-latency", "Print latencies",
@@ -159,6 +291,99 @@ gst_audiolatency_class_init (GstAudioLatencyClass * klass)
           "The running average latency, in microseconds", 0,
           G_USEC_PER_SEC, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioLatency:continuous:
+   *
+   * Send a marker sequence every #GstAudioLatency:interval milliseconds and
+   * detect it by correlation instead of sending a tick every second.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_CONTINUOUS,
+      g_param_spec_boolean ("continuous", "Continuous",
+          "Measure continuously with correlated marker sequences",
+          DEFAULT_CONTINUOUS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:interval:
+   *
+   * Time between two markers in continuous mode, this is also the highest
+   * latency that can be measured.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_INTERVAL,
+      g_param_spec_uint ("interval", "Interval",
+          "Time between two markers in continuous mode, in milliseconds",
+          20, 1000, DEFAULT_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:window-size:
+   *
+   * Number of measurements the statistics of the continuous mode are
+   * computed over.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WINDOW_SIZE,
+      g_param_spec_uint ("window-size", "Window size",
+          "Number of measurements the statistics are computed over",
+          1, 10000, DEFAULT_WINDOW_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:histogram-bin-width:
+   *
+   * Width of the bins of the latency histogram posted in continuous mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_HISTOGRAM_BIN_WIDTH,
+      g_param_spec_uint ("histogram-bin-width", "Histogram bin width",
+          "Width of the latency histogram bins, in microseconds",
+          1, G_USEC_PER_SEC, DEFAULT_HISTOGRAM_BIN_WIDTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:min-latency:
+   *
+   * Lowest latency of the last #GstAudioLatency:window-size measurements
+   * in continuous mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MIN_LATENCY,
+      g_param_spec_int64 ("min-latency", "Minimum latency",
+          "The lowest latency in the window, in microseconds", 0,
+          G_USEC_PER_SEC, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:max-latency:
+   *
+   * Highest latency of the last #GstAudioLatency:window-size measurements
+   * in continuous mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_LATENCY,
+      g_param_spec_int64 ("max-latency", "Maximum latency",
+          "The highest latency in the window, in microseconds", 0,
+          G_USEC_PER_SEC, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAudioLatency:jitter:
+   *
+   * Smoothed difference between consecutive latencies in continuous mode,
+   * computed like the interarrival jitter of RFC 3550.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_JITTER,
+      g_param_spec_int64 ("jitter", "Jitter",
+          "The latency jitter, in microseconds", 0,
+          G_USEC_PER_SEC, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
 
@@ -177,6 +402,12 @@ gst_audiolatency_init (GstAudioLatency * self)
   self->send_pts = 0;
   self->recv_pts = 0;
   self->print_latency = DEFAULT_PRINT_LATENCY;
+  self->continuous = DEFAULT_CONTINUOUS;
+  self->interval = DEFAULT_INTERVAL;
+  self->window_size = DEFAULT_WINDOW_SIZE;
+  self->window = g_new0 (gint64, self->window_size);
+  self->bin_width = DEFAULT_HISTOGRAM_BIN_WIDTH;
+  gst_audiolatency_reset_continuous (self);
 
   /* Setup sinkpad */
   self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
@@ -186,7 +417,8 @@ gst_audiolatency_init (GstAudioLatency * self)
 
   /* Setup srcpad */
   self->audiosrc = gst_element_factory_make ("audiotestsrc", NULL);
-  g_object_set (self->audiosrc, "wave", 8, "samplesperbuffer", 240, NULL);
+  g_object_set (self->audiosrc, "wave", WAVE_TICKS, "samplesperbuffer", 240,
+      NULL);
   gst_bin_add (GST_BIN (self), self->audiosrc);
 
   templ = gst_static_pad_template_get (&src_template);
@@ -247,9 +479,107 @@ gst_audiolatency_get_average_latency (GstAudioLatency * self)
   return average;
 }
 
+/* Must be called with the object lock */
+static void
+gst_audiolatency_reset_continuous (GstAudioLatency * self)
+{
+  self->samples_to_marker = 0;
+  self->marker_pos = GST_AUDIOLATENCY_MLS_LENGTH;
+  self->n_pending = 0;
+  self->lost = 0;
+  self->n_history = 0;
+  self->recv_samples = 0;
+  self->in_peak = FALSE;
+  self->last_corr = 0.0;
+  self->window_fill = 0;
+  self->window_idx = 0;
+  self->prev_latency = -1;
+  self->jitter = 0.0;
+}
+
+static void
+gst_audiolatency_get_extremes (GstAudioLatency * self, gint64 * min,
+    gint64 * max)
+{
+  guint ii;
+
+  GST_OBJECT_LOCK (self);
+  *min = *max = 0;
+  for (ii = 0; ii < self->window_fill; ii++) {
+    if (ii == 0 || self->window[ii] < *min)
+      *min = self->window[ii];
+    if (ii == 0 || self->window[ii] > *max)
+      *max = self->window[ii];
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+static int
+compare_latencies (const void *a, const void *b)
+{
+  gint64 la = *(const gint64 *) a, lb = *(const gint64 *) b;
+
+  return (la > lb) - (la < lb);
+}
+
+/* Adds a continuous mode measurement to the window and its statistics to
+ * the message structure, must be called with the object lock */
+static void
+gst_audiolatency_add_statistics_unlocked (GstAudioLatency * self,
+    gint64 latency, GstStructure * s)
+{
+  GValue histogram = G_VALUE_INIT;
+  GValue count = G_VALUE_INIT;
+  gint64 *sorted, start, end, bin;
+  guint ii, n, jj;
+
+  if (self->prev_latency >= 0)
+    self->jitter += (ABS (latency - self->prev_latency) - self->jitter) / 16.0;
+  self->prev_latency = latency;
+
+  self->window[self->window_idx] = latency;
+  self->window_idx = (self->window_idx + 1) % self->window_size;
+  self->window_fill = MIN (self->window_fill + 1, self->window_size);
+
+  n = self->window_fill;
+  sorted = g_memdup (self->window, n * sizeof (gint64));
+  qsort (sorted, n, sizeof (gint64), compare_latencies);
+
+  start = sorted[0] - sorted[0] % self->bin_width;
+  end = sorted[n - 1];
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&count, G_TYPE_UINT);
+  for (ii = 0, bin = start; bin <= end; bin += self->bin_width) {
+    jj = ii;
+    while (jj < n && sorted[jj] < bin + self->bin_width)
+      jj++;
+    g_value_set_uint (&count, jj - ii);
+    gst_value_array_append_value (&histogram, &count);
+    ii = jj;
+  }
+
+  gst_structure_set (s,
+      "min-latency", G_TYPE_INT64, sorted[0],
+      "max-latency", G_TYPE_INT64, sorted[n - 1],
+      "p50-latency", G_TYPE_INT64, sorted[(n - 1) * 50 / 100],
+      "p90-latency", G_TYPE_INT64, sorted[(n - 1) * 90 / 100],
+      "p99-latency", G_TYPE_INT64, sorted[(n - 1) * 99 / 100],
+      "jitter", G_TYPE_INT64, (gint64) self->jitter,
+      "measurements", G_TYPE_UINT, n,
+      "lost-markers", G_TYPE_UINT, self->lost,
+      "histogram-start", G_TYPE_INT64, start,
+      "histogram-bin-width", G_TYPE_INT64, (gint64) self->bin_width, NULL);
+  gst_structure_take_value (s, "histogram", &histogram);
+
+  g_value_unset (&count);
+  g_free (sorted);
+}
+
 static void
 gst_audiolatency_set_latency (GstAudioLatency * self, gint64 latency)
 {
+  GstStructure *s;
   gint64 avg_latency;
 
   GST_OBJECT_LOCK (self);
@@ -262,16 +592,30 @@ gst_audiolatency_set_latency (GstAudioLatency * self, gint64 latency)
 
   avg_latency = gst_audiolatency_get_average_latency_unlocked (self);
 
-  if (self->print_latency)
+  s = gst_structure_new ("latency", "last-latency", G_TYPE_INT64, latency,
+      "average-latency", G_TYPE_INT64, avg_latency, NULL);
+
+  if (self->continuous) {
+    gint64 min, max, jitter;
+
+    gst_audiolatency_add_statistics_unlocked (self, latency, s);
+    if (self->print_latency) {
+      gst_structure_get_int64 (s, "min-latency", &min);
+      gst_structure_get_int64 (s, "max-latency", &max);
+      gst_structure_get_int64 (s, "jitter", &jitter);
+      g_print ("last latency: %.2fms, running average: %.2fms, min: %.2fms, "
+          "max: %.2fms, jitter: %.2fms\n", latency / 1000.0,
+          avg_latency / 1000.0, min / 1000.0, max / 1000.0, jitter / 1000.0);
+    }
+  } else if (self->print_latency) {
     g_print ("last latency: %" G_GINT64_FORMAT "ms, running average: %"
         G_GINT64_FORMAT "ms\n", latency / 1000, avg_latency / 1000);
+  }
   GST_OBJECT_UNLOCK (self);
 
   /* Post an element message about it */
   gst_element_post_message (GST_ELEMENT (self),
-      gst_message_new_element (GST_OBJECT (self),
-          gst_structure_new ("latency", "last-latency", G_TYPE_INT64, latency,
-              "average-latency", G_TYPE_INT64, avg_latency, NULL)));
+      gst_message_new_element (GST_OBJECT (self), s));
 }
 
 static gint64
@@ -338,6 +682,211 @@ buffer_has_wave (GstBuffer * buffer, GstPad * pad)
   return (offset > 0) ? offset / 1000 : -1;
 }
 
+static gboolean
+get_format (GstPad * pad, gint * rate, gint * channels)
+{
+  const GstStructure *s;
+  GstCaps *caps;
+  gboolean ret;
+
+  caps = gst_pad_get_current_caps (pad);
+  if (!caps)
+    return FALSE;
+  s = gst_caps_get_structure (caps, 0);
+  ret = gst_structure_get_int (s, "rate", rate) &&
+      gst_structure_get_int (s, "channels", channels);
+  gst_caps_unref (caps);
+
+  if (!ret)
+    GST_WARNING_OBJECT (pad, "unknown format, can't handle markers");
+
+  return ret;
+}
+
+/* Remembers when a marker was sent, must be called with the object lock */
+static void
+gst_audiolatency_add_pending (GstAudioLatency * self, gint64 send_time)
+{
+  if (self->n_pending == GST_AUDIOLATENCY_MAX_PENDING) {
+    memmove (self->pending, self->pending + 1,
+        (self->n_pending - 1) * sizeof (gint64));
+    self->n_pending--;
+    self->lost++;
+  }
+  self->pending[self->n_pending++] = send_time;
+}
+
+/* Overwrites the silence from audiotestsrc with a marker every interval */
+static void
+gst_audiolatency_write_markers (GstAudioLatency * self, GstPad * pad,
+    GstPadProbeInfo * info)
+{
+  GstBuffer *buffer;
+  GstMapInfo minfo;
+  gint64 now;
+  guint64 period;
+  gsize ii, n_frames;
+  gint c, rate, channels;
+  gfloat *fdata;
+
+  now = g_get_monotonic_time ();
+
+  if (!get_format (pad, &rate, &channels))
+    return;
+
+  buffer = gst_buffer_make_writable (gst_pad_probe_info_get_buffer (info));
+  GST_PAD_PROBE_INFO_DATA (info) = buffer;
+  if (!gst_buffer_map (buffer, &minfo, GST_MAP_WRITE)) {
+    GST_WARNING_OBJECT (pad, "failed to map buffer %" GST_PTR_FORMAT, buffer);
+    return;
+  }
+
+  fdata = (gfloat *) minfo.data;
+  n_frames = minfo.size / (channels * sizeof (gfloat));
+
+  GST_OBJECT_LOCK (self);
+  /* markers must not overlap, even at low rates */
+  period = MAX (gst_util_uint64_scale_int (self->interval, rate, 1000),
+      2 * GST_AUDIOLATENCY_MLS_LENGTH);
+
+  for (ii = 0; ii < n_frames; ii++) {
+    if (self->samples_to_marker == 0) {
+      self->samples_to_marker = period;
+      self->marker_pos = 0;
+      gst_audiolatency_add_pending (self,
+          now + gst_util_uint64_scale_int (ii, G_USEC_PER_SEC, rate));
+    }
+    self->samples_to_marker--;
+
+    if (self->marker_pos < GST_AUDIOLATENCY_MLS_LENGTH) {
+      for (c = 0; c < channels; c++)
+        fdata[ii * channels + c] = mls[self->marker_pos];
+      self->marker_pos++;
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  gst_buffer_unmap (buffer, &minfo);
+}
+
+/* Matches a marker received at recv_time with the last one sent before,
+ * earlier markers were lost. Must be called with the object lock.
+ * Returns the latency or -1. */
+static gint64
+gst_audiolatency_match_marker (GstAudioLatency * self, gint64 recv_time)
+{
+  gint64 latency;
+  gint ii;
+
+  for (ii = self->n_pending - 1; ii >= 0; ii--) {
+    if (self->pending[ii] <= recv_time)
+      break;
+  }
+  if (ii < 0) {
+    GST_DEBUG_OBJECT (self, "marker received before any was sent");
+    return -1;
+  }
+
+  latency = recv_time - self->pending[ii];
+  self->lost += ii;
+  self->n_pending -= ii + 1;
+  memmove (self->pending, self->pending + ii + 1,
+      self->n_pending * sizeof (gint64));
+
+  return latency;
+}
+
+/* Correlates the first channel with the marker and returns the number of
+ * latencies found, stored in latencies */
+static guint
+gst_audiolatency_detect_markers (GstAudioLatency * self, GstPad * pad,
+    GstBuffer * buffer, gint64 * latencies)
+{
+  const gdouble mls_energy = 0.25 * GST_AUDIOLATENCY_MLS_LENGTH;
+  const guint len = GST_AUDIOLATENCY_MLS_LENGTH;
+  GstMapInfo minfo;
+  gint64 now, latency;
+  guint64 pos, buffer_start;
+  gsize ii, n_frames, n_work, keep;
+  gint rate, channels;
+  guint jj, n_latencies = 0;
+  gdouble corr, energy, delta, denom;
+  gfloat *fdata, *work;
+
+  now = g_get_monotonic_time ();
+
+  if (!get_format (pad, &rate, &channels))
+    return 0;
+
+  if (!gst_buffer_map (buffer, &minfo, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (pad, "failed to map buffer %" GST_PTR_FORMAT, buffer);
+    return 0;
+  }
+
+  fdata = (gfloat *) minfo.data;
+  n_frames = minfo.size / (channels * sizeof (gfloat));
+
+  GST_OBJECT_LOCK (self);
+  /* the end of the previous buffer followed by this one */
+  n_work = self->n_history + n_frames;
+  if (self->work_size < n_work) {
+    self->work = g_renew (gfloat, self->work, n_work);
+    self->work_size = n_work;
+  }
+  work = self->work;
+  for (ii = 0; ii < n_frames; ii++)
+    work[self->n_history + ii] = fdata[ii * channels];
+  gst_buffer_unmap (buffer, &minfo);
+
+  buffer_start = self->recv_samples;
+  pos = buffer_start - self->n_history;
+
+  for (ii = 0; ii + len <= n_work; ii++, pos++) {
+    corr = energy = 0.0;
+    for (jj = 0; jj < len; jj++) {
+      corr += mls[jj] * work[ii + jj];
+      energy += work[ii + jj] * work[ii + jj];
+    }
+
+    if (self->in_peak && pos == self->peak_pos + 1)
+      self->peak_next = corr;
+
+    if (energy > 0.0 && corr > MARKER_THRESHOLD * sqrt (energy * mls_energy)
+        && (!self->in_peak || corr > self->peak_corr)) {
+      self->in_peak = TRUE;
+      self->peak_corr = corr;
+      self->peak_prev = self->last_corr;
+      self->peak_next = 0.0;
+      self->peak_pos = pos;
+    } else if (self->in_peak && pos >= self->peak_pos + len) {
+      /* the peak is over, refine its position with a parabola through it
+       * and its neighbours */
+      delta = 0.0;
+      denom = self->peak_prev - 2.0 * self->peak_corr + self->peak_next;
+      if (denom < 0.0)
+        delta = CLAMP (0.5 * (self->peak_prev - self->peak_next) / denom,
+            -0.5, 0.5);
+
+      latency = gst_audiolatency_match_marker (self,
+          now + ((gdouble) self->peak_pos + delta -
+              (gdouble) buffer_start) * G_USEC_PER_SEC / rate);
+      if (latency >= 0 && n_latencies < GST_AUDIOLATENCY_MAX_PENDING)
+        latencies[n_latencies++] = latency;
+      self->in_peak = FALSE;
+    }
+    self->last_corr = corr;
+  }
+
+  /* keep what is needed to correlate across the buffer boundary */
+  keep = MIN (n_work, len - 1);
+  memmove (work, work + n_work - keep, keep * sizeof (gfloat));
+  self->n_history = keep;
+  self->recv_samples += n_frames;
+  GST_OBJECT_UNLOCK (self);
+
+  return n_latencies;
+}
+
 static GstPadProbeReturn
 gst_audiolatency_src_probe (GstPad * pad, GstPadProbeInfo * info,
     gpointer user_data)
@@ -354,6 +903,11 @@ gst_audiolatency_src_probe (GstPad * pad, GstPadProbeInfo * info,
 
   GST_TRACE ("audiotestsrc pushed out a buffer");
 
+  if (self->continuous) {
+    gst_audiolatency_write_markers (self, pad, info);
+    goto out;
+  }
+
   pts = g_get_monotonic_time ();
   /* Ticks are once a second, so once we send something, we can skip
    * checking ~1sec of buffers till the next one. */
@@ -388,6 +942,18 @@ gst_audiolatency_sink_chain (GstPad * pad, GstObject * parent,
   GstAudioLatency *self = GST_AUDIOLATENCY (parent);
   gint64 latency, offset, pts;
 
+  if (self->continuous) {
+    gint64 latencies[GST_AUDIOLATENCY_MAX_PENDING];
+    guint ii, n;
+
+    n = gst_audiolatency_detect_markers (self, pad, buffer, latencies);
+    for (ii = 0; ii < n; ii++) {
+      GST_INFO ("latency: %" G_GINT64_FORMAT "us", latencies[ii]);
+      gst_audiolatency_set_latency (self, latencies[ii]);
+    }
+    goto out;
+  }
+
   /* Ignore buffers till something gets sent out by us. Fixes a bug where we'd
    * start out by printing one garbage latency value on Windows. */
   if (self->send_pts == 0)
@@ -38,6 +38,10 @@ typedef struct _GstAudioLatency GstAudioLatency;
 typedef struct _GstAudioLatencyClass GstAudioLatencyClass;
 
 #define GST_AUDIOLATENCY_NUM_LATENCIES 5
+/* length of the maximum length sequence used as marker in continuous mode */
+#define GST_AUDIOLATENCY_MLS_LENGTH 255
+/* markers sent but not yet detected */
+#define GST_AUDIOLATENCY_MAX_PENDING 16
 
 struct _GstAudioLatency
 {
@@ -54,8 +58,35 @@ struct _GstAudioLatency
   gint next_latency_idx;
   gint latencies[GST_AUDIOLATENCY_NUM_LATENCIES];
 
+  /* continuous mode, marker generation */
+  guint64 samples_to_marker;
+  guint marker_pos;
+  gint64 pending[GST_AUDIOLATENCY_MAX_PENDING];
+  guint n_pending;
+  guint lost;
+
+  /* continuous mode, marker detection on the first channel */
+  gfloat *work;
+  guint work_size;
+  guint n_history;
+  guint64 recv_samples;
+  gboolean in_peak;
+  gdouble peak_corr, peak_prev, peak_next, last_corr;
+  guint64 peak_pos;
+
+  /* continuous mode, statistics over the last window_size measurements */
+  gint64 *window;
+  guint window_fill;
+  guint window_idx;
+  gint64 prev_latency;
+  gdouble jitter;
+
   /* properties */
   gboolean print_latency;
+  gboolean continuous;
+  guint interval;
+  guint window_size;
+  guint bin_width;
 };
 
 struct _GstAudioLatencyClass
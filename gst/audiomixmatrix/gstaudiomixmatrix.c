@@ -73,6 +73,12 @@
 #include <string.h>
 #include <math.h>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 GST_DEBUG_CATEGORY_STATIC (audiomixmatrix_debug);
 #define GST_CAT_DEFAULT audiomixmatrix_debug
 
@@ -141,6 +147,8 @@ static gboolean gst_audio_mix_matrix_set_caps (GstBaseTransform * trans,
     GstCaps * incaps, GstCaps * outcaps);
 static GstFlowReturn gst_audio_mix_matrix_transform (GstBaseTransform * trans,
     GstBuffer * inbuf, GstBuffer * outbuf);
+static GstFlowReturn gst_audio_mix_matrix_transform_ip (GstBaseTransform *
+    trans, GstBuffer * buf);
 static GstCaps *gst_audio_mix_matrix_transform_caps (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter);
 static GstCaps *gst_audio_mix_matrix_fixate_caps (GstBaseTransform * trans,
@@ -209,6 +217,8 @@ gst_audio_mix_matrix_class_init (GstAudioMixMatrixClass * klass)
       GST_DEBUG_FUNCPTR (gst_audio_mix_matrix_get_unit_size);
   trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_audio_mix_matrix_set_caps);
   trans_class->transform = GST_DEBUG_FUNCPTR (gst_audio_mix_matrix_transform);
+  trans_class->transform_ip =
+      GST_DEBUG_FUNCPTR (gst_audio_mix_matrix_transform_ip);
   trans_class->transform_caps =
       GST_DEBUG_FUNCPTR (gst_audio_mix_matrix_transform_caps);
   trans_class->fixate_caps =
@@ -228,6 +238,29 @@ gst_audio_mix_matrix_init (GstAudioMixMatrix * self)
   self->s16_conv_matrix = NULL;
   self->s32_conv_matrix = NULL;
   self->mode = GST_AUDIO_MIX_MATRIX_MODE_MANUAL;
+  self->format = GST_AUDIO_FORMAT_UNKNOWN;
+  self->prepared = FALSE;
+  self->tap_offsets = NULL;
+  self->tap_inputs = NULL;
+  self->tap_coeffs = NULL;
+  self->dense_matrix = NULL;
+  self->permutation = NULL;
+}
+
+static void
+gst_audio_mix_matrix_clear_taps (GstAudioMixMatrix * self)
+{
+  g_free (self->tap_offsets);
+  self->tap_offsets = NULL;
+  g_free (self->tap_inputs);
+  self->tap_inputs = NULL;
+  g_free (self->tap_coeffs);
+  self->tap_coeffs = NULL;
+  g_free (self->dense_matrix);
+  self->dense_matrix = NULL;
+  g_free (self->permutation);
+  self->permutation = NULL;
+  self->prepared = FALSE;
 }
 
 static void
@@ -240,6 +273,8 @@ gst_audio_mix_matrix_dispose (GObject * object)
     self->matrix = NULL;
   }
 
+  gst_audio_mix_matrix_clear_taps (self);
+
   G_OBJECT_CLASS (gst_audio_mix_matrix_parent_class)->dispose (object);
 }
 
@@ -289,6 +324,7 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
   switch (prop_id) {
     case PROP_IN_CHANNELS:
       self->in_channels = g_value_get_uint (value);
+      self->prepared = FALSE;
       if (self->matrix) {
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
@@ -296,6 +332,7 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
       break;
     case PROP_OUT_CHANNELS:
       self->out_channels = g_value_get_uint (value);
+      self->prepared = FALSE;
       if (self->matrix) {
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
@@ -324,6 +361,7 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
       }
       gst_audio_mix_matrix_convert_s16_matrix (self);
       gst_audio_mix_matrix_convert_s32_matrix (self);
+      self->prepared = FALSE;
       break;
     }
     case PROP_CHANNEL_MASK:
@@ -404,134 +442,448 @@ gst_audio_mix_matrix_change_state (GstElement * element,
       g_free (self->s32_conv_matrix);
       self->s32_conv_matrix = NULL;
     }
+
+    gst_audio_mix_matrix_clear_taps (self);
   }
 
   return s;
 }
 
 
-static GstFlowReturn
-gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
-    GstBuffer * inbuf, GstBuffer * outbuf)
+/* Derives the tap lists, the dense matrix and the permutation for the
+ * negotiated format and switches to passthrough for an identity matrix, or
+ * to in-place processing for a permutation */
+static void
+gst_audio_mix_matrix_prepare (GstAudioMixMatrix * self)
 {
-  GstMapInfo inmap, outmap;
-  GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (vfilter);
-  gint in, out, sample;
+  GstBaseTransform *trans = GST_BASE_TRANSFORM (self);
   guint inchannels = self->in_channels;
   guint outchannels = self->out_channels;
-  gdouble *matrix = self->matrix;
+  guint stride = GST_ROUND_UP_4 (outchannels);
+  guint in, out, n_taps = 0;
+  gboolean permutation = (inchannels == outchannels);
+  gboolean identity = permutation;
+  gboolean is_float = FALSE;
+  gsize coeff_size;
 
-  if (!gst_buffer_map (inbuf, &inmap, GST_MAP_READ)) {
-    return GST_FLOW_ERROR;
+  gst_audio_mix_matrix_clear_taps (self);
+
+  if (self->matrix == NULL || inchannels == 0 || outchannels == 0)
+    return;
+
+  switch (self->format) {
+    case GST_AUDIO_FORMAT_F32LE:
+    case GST_AUDIO_FORMAT_F32BE:
+      coeff_size = sizeof (gfloat);
+      is_float = TRUE;
+      break;
+    case GST_AUDIO_FORMAT_F64LE:
+    case GST_AUDIO_FORMAT_F64BE:
+      coeff_size = sizeof (gdouble);
+      is_float = TRUE;
+      break;
+    case GST_AUDIO_FORMAT_S16LE:
+    case GST_AUDIO_FORMAT_S16BE:
+      if (self->s16_conv_matrix == NULL)
+        gst_audio_mix_matrix_convert_s16_matrix (self);
+      coeff_size = sizeof (gint32);
+      break;
+    case GST_AUDIO_FORMAT_S32LE:
+    case GST_AUDIO_FORMAT_S32BE:
+      if (self->s32_conv_matrix == NULL)
+        gst_audio_mix_matrix_convert_s32_matrix (self);
+      coeff_size = sizeof (gint64);
+      break;
+    default:
+      return;
   }
-  if (!gst_buffer_map (outbuf, &outmap, GST_MAP_WRITE)) {
-    gst_buffer_unmap (inbuf, &inmap);
-    return GST_FLOW_ERROR;
+
+  for (out = 0; out < outchannels; out++) {
+    guint out_taps = 0;
+
+    for (in = 0; in < inchannels; in++) {
+      gdouble coeff = self->matrix[out * inchannels + in];
+
+      if (coeff != 0) {
+        out_taps++;
+        if (coeff != 1.0 || in != out)
+          identity = FALSE;
+        if (coeff != 1.0)
+          permutation = FALSE;
+      }
+    }
+    if (out_taps != 1) {
+      permutation = FALSE;
+      identity = FALSE;
+    }
+    n_taps += out_taps;
+  }
+
+  self->tap_offsets = g_new (guint, outchannels + 1);
+  self->tap_inputs = g_new (guint, MAX (n_taps, 1));
+  self->tap_coeffs = g_malloc (coeff_size * MAX (n_taps, 1));
+  n_taps = 0;
+  for (out = 0; out < outchannels; out++) {
+    self->tap_offsets[out] = n_taps;
+    for (in = 0; in < inchannels; in++) {
+      guint i = out * inchannels + in;
+
+      if (self->matrix[i] == 0)
+        continue;
+
+      self->tap_inputs[n_taps] = in;
+      switch (self->format) {
+        case GST_AUDIO_FORMAT_F32LE:
+        case GST_AUDIO_FORMAT_F32BE:
+          ((gfloat *) self->tap_coeffs)[n_taps] = self->matrix[i];
+          break;
+        case GST_AUDIO_FORMAT_F64LE:
+        case GST_AUDIO_FORMAT_F64BE:
+          ((gdouble *) self->tap_coeffs)[n_taps] = self->matrix[i];
+          break;
+        case GST_AUDIO_FORMAT_S16LE:
+        case GST_AUDIO_FORMAT_S16BE:
+          ((gint32 *) self->tap_coeffs)[n_taps] = self->s16_conv_matrix[i];
+          break;
+        default:
+          ((gint64 *) self->tap_coeffs)[n_taps] = self->s32_conv_matrix[i];
+          break;
+      }
+      n_taps++;
+    }
+  }
+  self->tap_offsets[outchannels] = n_taps;
+
+  /* every output channel takes an input channel, check that no input
+   * channel is used twice */
+  if (permutation) {
+    guint64 used = 0;
+
+    self->permutation = g_new (guint, outchannels);
+    for (out = 0; out < outchannels; out++) {
+      in = self->tap_inputs[out];
+      if (used & (G_GUINT64_CONSTANT (1) << in))
+        permutation = FALSE;
+      used |= G_GUINT64_CONSTANT (1) << in;
+      self->permutation[out] = in;
+    }
+    if (!permutation) {
+      g_free (self->permutation);
+      self->permutation = NULL;
+    }
+  }
+
+  /* a dense SIMD pass costs about one multiply-add per 4 coefficients, the
+   * tap lists one per non-zero coefficient */
+  self->sparse = n_taps * 4 <= inchannels * outchannels;
+
+  if (!self->sparse && is_float) {
+    self->dense_matrix = g_malloc0 (coeff_size * inchannels * stride);
+    for (in = 0; in < inchannels; in++) {
+      for (out = 0; out < outchannels; out++) {
+        gdouble coeff = self->matrix[out * inchannels + in];
+
+        if (coeff_size == sizeof (gfloat))
+          ((gfloat *) self->dense_matrix)[in * stride + out] = coeff;
+        else
+          ((gdouble *) self->dense_matrix)[in * stride + out] = coeff;
+      }
+    }
+  }
+
+  GST_DEBUG_OBJECT (self, "%u of %u taps used, %s path%s", n_taps,
+      inchannels * outchannels, self->dense_matrix ? "dense" : "sparse",
+      identity ? ", identity" : permutation ? ", permutation" : "");
+
+  gst_base_transform_set_passthrough (trans, identity);
+  gst_base_transform_set_in_place (trans, permutation && !identity);
+
+  self->prepared = TRUE;
+}
+
+static void
+gst_audio_mix_matrix_f32_dense (const gfloat * matrix, const gfloat * inarray,
+    gfloat * outarray, guint inchannels, guint outchannels, guint n_samples)
+{
+  guint stride = GST_ROUND_UP_4 (outchannels);
+  guint sample, in, out;
+
+  for (sample = 0; sample < n_samples; sample++) {
+    for (out = 0; out < outchannels; out += 4) {
+      gfloat acc[4];
+
+#if defined (__SSE2__)
+      __m128 vacc = _mm_setzero_ps ();
+
+      for (in = 0; in < inchannels; in++)
+        vacc = _mm_add_ps (vacc, _mm_mul_ps (_mm_set1_ps (inarray[in]),
+                _mm_loadu_ps (matrix + in * stride + out)));
+      if (out + 4 <= outchannels) {
+        _mm_storeu_ps (outarray + out, vacc);
+        continue;
+      }
+      _mm_storeu_ps (acc, vacc);
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+      float32x4_t vacc = vdupq_n_f32 (0);
+
+      for (in = 0; in < inchannels; in++)
+        vacc = vaddq_f32 (vacc, vmulq_n_f32 (vld1q_f32 (matrix + in * stride +
+                    out), inarray[in]));
+      if (out + 4 <= outchannels) {
+        vst1q_f32 (outarray + out, vacc);
+        continue;
+      }
+      vst1q_f32 (acc, vacc);
+#else
+      guint k;
+
+      acc[0] = acc[1] = acc[2] = acc[3] = 0;
+      for (in = 0; in < inchannels; in++) {
+        for (k = 0; k < 4; k++)
+          acc[k] += inarray[in] * matrix[in * stride + out + k];
+      }
+#endif
+      memcpy (outarray + out, acc,
+          MIN (4, outchannels - out) * sizeof (gfloat));
+    }
+    inarray += inchannels;
+    outarray += outchannels;
+  }
+}
+
+static void
+gst_audio_mix_matrix_f64_dense (const gdouble * matrix,
+    const gdouble * inarray, gdouble * outarray, guint inchannels,
+    guint outchannels, guint n_samples)
+{
+  guint stride = GST_ROUND_UP_4 (outchannels);
+  guint sample, in, out;
+
+  for (sample = 0; sample < n_samples; sample++) {
+    for (out = 0; out < outchannels; out += 2) {
+      gdouble acc[2];
+
+#if defined (__SSE2__)
+      __m128d vacc = _mm_setzero_pd ();
+
+      for (in = 0; in < inchannels; in++)
+        vacc = _mm_add_pd (vacc, _mm_mul_pd (_mm_set1_pd (inarray[in]),
+                _mm_loadu_pd (matrix + in * stride + out)));
+      _mm_storeu_pd (acc, vacc);
+#else
+      acc[0] = acc[1] = 0;
+      for (in = 0; in < inchannels; in++) {
+        acc[0] += inarray[in] * matrix[in * stride + out];
+        acc[1] += inarray[in] * matrix[in * stride + out + 1];
+      }
+#endif
+      outarray[out] = acc[0];
+      if (out + 1 < outchannels)
+        outarray[out + 1] = acc[1];
+    }
+    inarray += inchannels;
+    outarray += outchannels;
   }
+}
+
+/* Processes n_samples frames with the tap lists or the dense matrix, inarray
+ * and outarray must not overlap */
+static void
+gst_audio_mix_matrix_process (GstAudioMixMatrix * self, gconstpointer inarray,
+    gpointer outarray, guint n_samples)
+{
+  const guint *offsets = self->tap_offsets;
+  const guint *inputs = self->tap_inputs;
+  guint inchannels = self->in_channels;
+  guint outchannels = self->out_channels;
+  guint sample, out, t;
 
   switch (self->format) {
     case GST_AUDIO_FORMAT_F32LE:
     case GST_AUDIO_FORMAT_F32BE:{
-      const gfloat *inarray;
-      gfloat *outarray;
-      guint n_samples = outmap.size / (sizeof (gfloat) * outchannels);
+      const gfloat *in = inarray;
+      gfloat *outp = outarray;
+      const gfloat *coeffs = self->tap_coeffs;
 
-      inarray = (gfloat *) inmap.data;
-      outarray = (gfloat *) outmap.data;
+      if (self->dense_matrix) {
+        gst_audio_mix_matrix_f32_dense (self->dense_matrix, in, outp,
+            inchannels, outchannels, n_samples);
+        break;
+      }
 
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gfloat outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
+
+          for (t = offsets[out]; t < offsets[out + 1]; t++)
+            outval += in[inputs[t]] * coeffs[t];
+          outp[out] = outval;
         }
+        in += inchannels;
+        outp += outchannels;
       }
       break;
     }
     case GST_AUDIO_FORMAT_F64LE:
     case GST_AUDIO_FORMAT_F64BE:{
-      const gdouble *inarray;
-      gdouble *outarray;
-      guint n_samples = outmap.size / (sizeof (gdouble) * outchannels);
+      const gdouble *in = inarray;
+      gdouble *outp = outarray;
+      const gdouble *coeffs = self->tap_coeffs;
 
-      inarray = (gdouble *) inmap.data;
-      outarray = (gdouble *) outmap.data;
+      if (self->dense_matrix) {
+        gst_audio_mix_matrix_f64_dense (self->dense_matrix, in, outp,
+            inchannels, outchannels, n_samples);
+        break;
+      }
 
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gdouble outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
+
+          for (t = offsets[out]; t < offsets[out + 1]; t++)
+            outval += in[inputs[t]] * coeffs[t];
+          outp[out] = outval;
         }
+        in += inchannels;
+        outp += outchannels;
       }
       break;
     }
     case GST_AUDIO_FORMAT_S16LE:
     case GST_AUDIO_FORMAT_S16BE:{
-      const gint16 *inarray;
-      gint16 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint16) * outchannels);
+      const gint16 *in = inarray;
+      gint16 *outp = outarray;
+      const gint32 *coeffs = self->tap_coeffs;
       guint n = self->shift_bytes;
-      gint32 *conv_matrix = self->s16_conv_matrix;
-
-      inarray = (gint16 *) inmap.data;
-      outarray = (gint16 *) outmap.data;
 
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gint32 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint32) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint16) (outval >> n);
+
+          for (t = offsets[out]; t < offsets[out + 1]; t++)
+            outval += (gint32) (in[inputs[t]] * coeffs[t]);
+          outp[out] = (gint16) (outval >> n);
         }
+        in += inchannels;
+        outp += outchannels;
       }
       break;
     }
     case GST_AUDIO_FORMAT_S32LE:
     case GST_AUDIO_FORMAT_S32BE:{
-      const gint32 *inarray;
-      gint32 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint32) * outchannels);
+      const gint32 *in = inarray;
+      gint32 *outp = outarray;
+      const gint64 *coeffs = self->tap_coeffs;
       guint n = self->shift_bytes;
-      gint64 *conv_matrix = self->s32_conv_matrix;
-
-      inarray = (gint32 *) inmap.data;
-      outarray = (gint32 *) outmap.data;
 
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gint64 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint64) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint32) (outval >> n);
+
+          for (t = offsets[out]; t < offsets[out + 1]; t++)
+            outval += (gint64) (in[inputs[t]] * coeffs[t]);
+          outp[out] = (gint32) (outval >> n);
         }
+        in += inchannels;
+        outp += outchannels;
       }
       break;
     }
     default:
-      gst_buffer_unmap (inbuf, &inmap);
-      gst_buffer_unmap (outbuf, &outmap);
-      return GST_FLOW_NOT_SUPPORTED;
+      g_assert_not_reached ();
+      break;
+  }
+}
+
+static GstFlowReturn
+gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
+    GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstMapInfo inmap, outmap;
+  GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (vfilter);
+  guint n_samples;
 
+  if (!self->prepared)
+    gst_audio_mix_matrix_prepare (self);
+  if (!self->prepared)
+    return GST_FLOW_NOT_SUPPORTED;
+
+  if (!gst_buffer_map (inbuf, &inmap, GST_MAP_READ)) {
+    return GST_FLOW_ERROR;
   }
+  if (!gst_buffer_map (outbuf, &outmap, GST_MAP_WRITE)) {
+    gst_buffer_unmap (inbuf, &inmap);
+    return GST_FLOW_ERROR;
+  }
+
+  n_samples = outmap.size / (GST_AUDIO_FORMAT_INFO_WIDTH
+      (gst_audio_format_get_info (self->format)) / 8 * self->out_channels);
+  gst_audio_mix_matrix_process (self, inmap.data, outmap.data, n_samples);
 
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
   return GST_FLOW_OK;
 }
 
+/* Used when the matrix only reorders the channels, or when the matrix was
+ * changed while processing in place */
+static GstFlowReturn
+gst_audio_mix_matrix_transform_ip (GstBaseTransform * vfilter, GstBuffer * buf)
+{
+  GstMapInfo map;
+  GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (vfilter);
+  guint channels = self->out_channels;
+  guint bps, sample, out;
+  guint8 *data, *tmp;
+
+  if (!self->prepared)
+    gst_audio_mix_matrix_prepare (self);
+  if (!self->prepared)
+    return GST_FLOW_NOT_SUPPORTED;
+
+  if (gst_base_transform_is_passthrough (vfilter))
+    return GST_FLOW_OK;
+
+  if (self->in_channels != channels)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  if (!gst_buffer_map (buf, &map, GST_MAP_READWRITE))
+    return GST_FLOW_ERROR;
+
+  bps = GST_AUDIO_FORMAT_INFO_WIDTH (gst_audio_format_get_info
+      (self->format)) / 8;
+  tmp = g_alloca (bps * channels);
+  data = map.data;
+
+  for (sample = 0; sample < map.size / (bps * channels); sample++) {
+    memcpy (tmp, data, bps * channels);
+    if (self->permutation) {
+      const guint *perm = self->permutation;
+
+      switch (bps) {
+        case 2:
+          for (out = 0; out < channels; out++)
+            ((guint16 *) data)[out] = ((guint16 *) tmp)[perm[out]];
+          break;
+        case 4:
+          for (out = 0; out < channels; out++)
+            ((guint32 *) data)[out] = ((guint32 *) tmp)[perm[out]];
+          break;
+        default:
+          for (out = 0; out < channels; out++)
+            ((guint64 *) data)[out] = ((guint64 *) tmp)[perm[out]];
+          break;
+      }
+    } else {
+      gst_audio_mix_matrix_process (self, tmp, data, 1);
+    }
+    data += bps * channels;
+  }
+
+  gst_buffer_unmap (buf, &map);
+  return GST_FLOW_OK;
+}
+
 static gboolean
 gst_audio_mix_matrix_get_unit_size (GstBaseTransform * trans,
     GstCaps * caps, gsize * size)
@@ -567,6 +919,7 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     self->in_channels = info.channels;
     self->out_channels = out_info.channels;
 
+    g_free (self->matrix);
     self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
 
     for (out = 0; out < self->out_channels; out++) {
@@ -596,6 +949,9 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     default:
       break;
   }
+
+  gst_audio_mix_matrix_prepare (self);
+
   return TRUE;
 }
 
@@ -63,6 +63,21 @@ struct _GstAudioMixMatrix
   gint shift_bytes;
 
   GstAudioFormat format;
+
+  /* derived from the matrix for the negotiated format */
+  gboolean prepared;
+  gboolean sparse;
+  /* taps with a non-zero coefficient, the ones of output channel out are
+   * tap_offsets[out] to tap_offsets[out + 1] - 1 */
+  guint *tap_offsets;
+  guint *tap_inputs;
+  gpointer tap_coeffs;
+  /* transposed matrix with rows padded to a multiple of 4 for the dense
+   * float paths */
+  gpointer dense_matrix;
+  /* input channel of each output channel if the matrix only reorders the
+   * channels */
+  guint *permutation;
 };
 
 struct _GstAudioMixMatrixClass
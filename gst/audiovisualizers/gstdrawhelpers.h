@@ -20,6 +20,21 @@
  */
  
 /* FIXME: add versions that don't ignore alpha */
+
+/* adds the bytes of _c to the ones of _p, saturating at 255 */
+static inline void
+add_pixel (guint32 * _p, guint32 _c)
+{
+  guint32 p = *_p;
+  guint32 s, o;
+
+  /* add the lower 7 bits of each byte, then the top bits without carrying
+   * into the next byte and saturate the bytes that overflowed */
+  s = (p & 0x7f7f7f7f) + (_c & 0x7f7f7f7f);
+  o = ((p & _c) | ((p | _c) & s)) & 0x80808080;
+  s ^= (p ^ _c) & 0x80808080;
+  *_p = s | ((o >> 7) * 0xff);
+}
  
 #define draw_dot(_vd, _x, _y, _st, _c) G_STMT_START {                          \
   _vd[(_y * _st) + _x] = _c;                                                   \
@@ -45,13 +60,14 @@
 #define draw_line(_vd, _x1, _x2, _y1, _y2, _st, _c) G_STMT_START {             \
   guint _i, _j, _x, _y;                                                        \
   gint _dx = _x2 - _x1, _dy = _y2 - _y1;                                       \
-  gfloat _f;                                                                   \
+  gfloat _sx, _sy;                                                             \
                                                                                \
   _j = abs (_dx) > abs (_dy) ? abs (_dx) : abs (_dy);                          \
+  _sx = (gfloat) _dx / (gfloat) _j;                                            \
+  _sy = (gfloat) _dy / (gfloat) _j;                                            \
   for (_i = 0; _i < _j; _i++) {                                                \
-    _f = (gfloat) _i / (gfloat) _j;                                            \
-    _x = _x1 + _dx * _f;                                                       \
-    _y = _y1 + _dy * _f;                                                       \
+    _x = _x1 + _sx * _i;                                                       \
+    _y = _y1 + _sy * _i;                                                       \
     draw_dot (_vd, _x, _y, _st, _c);                                           \
   }                                                                            \
 } G_STMT_END
@@ -59,13 +75,15 @@
 #define draw_line_aa(_vd, _x1, _x2, _y1, _y2, _st, _c) G_STMT_START {          \
   guint _i, _j, _x, _y;                                                        \
   gint _dx = _x2 - _x1, _dy = _y2 - _y1;                                       \
-  gfloat _f, _rx, _ry, _fx, _fy;                                               \
+  gfloat _f, _rx, _ry, _fx, _fy, _sx, _sy;                                     \
                                                                                \
+  /* one division per line instead of one per point */                         \
   _j = abs (_dx) > abs (_dy) ? abs (_dx) : abs (_dy);                          \
+  _sx = (gfloat) _dx / (gfloat) _j;                                            \
+  _sy = (gfloat) _dy / (gfloat) _j;                                            \
   for (_i = 0; _i < _j; _i++) {                                                \
-    _f = (gfloat) _i / (gfloat) _j;                                            \
-    _rx = _x1 + _dx * _f;                                                      \
-    _ry = _y1 + _dy * _f;                                                      \
+    _rx = _x1 + _sx * _i;                                                      \
+    _ry = _y1 + _sy * _i;                                                      \
     _x = (guint)_rx;                                                           \
     _y = (guint)_ry;                                                           \
     _fx = _rx - (gfloat)_x;                                                    \
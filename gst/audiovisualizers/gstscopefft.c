@@ -0,0 +1,101 @@
+/* GStreamer
+ *
+ * gstscopefft.c: float fft with precomputed window for the scopes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "gstscopefft.h"
+
+/* Returns the closest length >= len the fft can handle efficiently, the
+ * real fft also needs it to be even. */
+guint
+gst_scope_fft_get_length (guint len)
+{
+  len = gst_fft_next_fast_length (MAX (len, 2));
+  while (len & 1)
+    len = gst_fft_next_fast_length (len + 1);
+  return len;
+}
+
+GstScopeFFT *
+gst_scope_fft_new (guint len, GstFFTWindow window)
+{
+  GstScopeFFT *fft;
+  guint i;
+
+  g_return_val_if_fail (len > 0 && (len & 1) == 0, NULL);
+
+  fft = g_new0 (GstScopeFFT, 1);
+  fft->len = len;
+  fft->fft = gst_fft_f32_new (len, FALSE);
+  fft->input = g_new0 (gfloat, len);
+  fft->freq = g_new (GstFFTF32Complex, len / 2 + 1);
+
+  /* the float fft does not scale its output like the integer ones, fold
+   * this into the window so that it costs nothing per frame */
+  fft->window = g_new (gfloat, len);
+  for (i = 0; i < len; i++)
+    fft->window[i] = 1.0f / len;
+  gst_fft_f32_window (fft->fft, fft->window, window);
+
+  return fft;
+}
+
+void
+gst_scope_fft_free (GstScopeFFT * fft)
+{
+  if (!fft)
+    return;
+
+  gst_fft_f32_free (fft->fft);
+  g_free (fft->window);
+  g_free (fft->input);
+  g_free (fft->freq);
+  g_free (fft);
+}
+
+void
+gst_scope_fft_run (GstScopeFFT * fft)
+{
+  gfloat *input = fft->input;
+  const gfloat *window = fft->window;
+  guint i = 0;
+
+#if defined (__SSE2__)
+  for (; i + 4 <= fft->len; i += 4)
+    _mm_storeu_ps (input + i, _mm_mul_ps (_mm_loadu_ps (input + i),
+            _mm_loadu_ps (window + i)));
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  for (; i + 4 <= fft->len; i += 4)
+    vst1q_f32 (input + i, vmulq_f32 (vld1q_f32 (input + i),
+            vld1q_f32 (window + i)));
+#endif
+  for (; i < fft->len; i++)
+    input[i] *= window[i];
+
+  gst_fft_f32_fft (fft->fft, input, fft->freq);
+}
@@ -0,0 +1,53 @@
+/* GStreamer
+ *
+ * gstscopefft.h: float fft with precomputed window for the scopes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SCOPE_FFT_H__
+#define __GST_SCOPE_FFT_H__
+
+#include <gst/gst.h>
+#include <gst/fft/gstfftf32.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstScopeFFT GstScopeFFT;
+
+/* An fft plan that is created once per configuration and reused for every
+ * frame. The caller fills @input with @len samples, gst_scope_fft_run()
+ * then windows them and leaves the @len / 2 + 1 bins in @freq, scaled like
+ * the output of the S16 fft for input in the S16 range. */
+struct _GstScopeFFT
+{
+  guint len;
+  GstFFTF32 *fft;
+  /* window coefficients, including the 1 / len normalisation */
+  gfloat *window;
+  gfloat *input;
+  GstFFTF32Complex *freq;
+};
+
+guint gst_scope_fft_get_length (guint len);
+
+GstScopeFFT *gst_scope_fft_new (guint len, GstFFTWindow window);
+void gst_scope_fft_free (GstScopeFFT * fft);
+
+void gst_scope_fft_run (GstScopeFFT * fft);
+
+G_END_DECLS
+#endif /* __GST_SCOPE_FFT_H__ */
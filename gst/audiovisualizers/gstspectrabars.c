@@ -0,0 +1,99 @@
+/* GStreamer
+ *
+ * gstspectrabars.c: bar drawing for the spectrascope
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "gstspectrabars.h"
+#include "gstdrawhelpers.h"
+
+/* Draws the bars of all columns row by row: the pixel at the top of a bar
+ * is set to white, the pixels below it are brightened and the bottom row
+ * is brightened once more. */
+void
+gst_spectra_scope_draw_bars (guint32 * vdata, gint stride, const guint * tops,
+    guint w, guint h)
+{
+  guint x, y, min_top = h;
+
+  for (x = 0; x < w; x++)
+    min_top = MIN (min_top, tops[x]);
+
+  for (y = min_top; y <= h; y++) {
+    guint32 *line = (guint32 *) ((guint8 *) vdata + y * stride);
+    guint32 bottom = (y == h) ? 0x007F7F7F : 0;
+
+    x = 0;
+#if defined (__SSE2__)
+    {
+      const __m128i white = _mm_set1_epi32 (0x00FFFFFF);
+      const __m128i add = _mm_set1_epi32 (0x007F7F7F);
+      const __m128i vbottom = _mm_set1_epi32 (bottom);
+      const __m128i vy = _mm_set1_epi32 (y);
+
+      for (; x + 4 <= w; x += 4) {
+        __m128i t = _mm_loadu_si128 ((const __m128i *) (tops + x));
+        __m128i p = _mm_loadu_si128 ((__m128i *) (line + x));
+        __m128i top = _mm_cmpeq_epi32 (vy, t);
+        __m128i below = _mm_cmpgt_epi32 (vy, t);
+
+        p = _mm_or_si128 (_mm_and_si128 (top, white),
+            _mm_andnot_si128 (top, p));
+        p = _mm_adds_epu8 (p, _mm_and_si128 (below, add));
+        p = _mm_adds_epu8 (p, vbottom);
+        _mm_storeu_si128 ((__m128i *) (line + x), p);
+      }
+    }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    {
+      const uint32x4_t white = vdupq_n_u32 (0x00FFFFFF);
+      const uint32x4_t add = vdupq_n_u32 (0x007F7F7F);
+      const uint8x16_t vbottom = vreinterpretq_u8_u32 (vdupq_n_u32 (bottom));
+      const uint32x4_t vy = vdupq_n_u32 (y);
+
+      for (; x + 4 <= w; x += 4) {
+        uint32x4_t t = vld1q_u32 (tops + x);
+        uint32x4_t p = vld1q_u32 (line + x);
+        uint8x16_t p8;
+
+        p = vbslq_u32 (vceqq_u32 (vy, t), white, p);
+        p8 = vqaddq_u8 (vreinterpretq_u8_u32 (p),
+            vreinterpretq_u8_u32 (vandq_u32 (vcgtq_u32 (vy, t), add)));
+        vst1q_u32 (line + x, vreinterpretq_u32_u8 (vqaddq_u8 (p8, vbottom)));
+      }
+    }
+#endif
+    for (; x < w; x++) {
+      if (y == tops[x])
+        line[x] = 0x00FFFFFF;
+      else if (y > tops[x])
+        add_pixel (&line[x], 0x007F7F7F);
+      if (bottom)
+        add_pixel (&line[x], bottom);
+    }
+  }
+}
@@ -27,6 +27,11 @@
  * Spectrascope is a simple spectrum visualisation element. It renders the
  * frequency spectrum as a series of bars.
  *
+ * By default the spectrum has one frequency band per video column. The
+ * #GstSpectraScope:fft-size property allows analysing the audio with a
+ * different resolution, the bands are then grouped or spread over the
+ * columns.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 audiotestsrc ! audioconvert ! spectrascope ! ximagesink
@@ -37,8 +42,10 @@
 #include "config.h"
 #endif
 #include <stdlib.h>
+#include <math.h>
 
 #include "gstspectrascope.h"
+#include "gstspectrabars.h"
 
 #if G_BYTE_ORDER == G_BIG_ENDIAN
 #define RGB_ORDER "xRGB"
@@ -68,6 +75,18 @@ GST_STATIC_PAD_TEMPLATE ("sink",
 GST_DEBUG_CATEGORY_STATIC (spectra_scope_debug);
 #define GST_CAT_DEFAULT spectra_scope_debug
 
+#define DEFAULT_FFT_SIZE 0
+
+enum
+{
+  PROP_0,
+  PROP_FFT_SIZE
+};
+
+static void gst_spectra_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_spectra_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 static void gst_spectra_scope_finalize (GObject * object);
 
 static gboolean gst_spectra_scope_setup (GstAudioVisualizer * scope);
@@ -84,8 +103,25 @@ gst_spectra_scope_class_init (GstSpectraScopeClass * g_class)
   GstElementClass *element_class = (GstElementClass *) g_class;
   GstAudioVisualizerClass *scope_class = (GstAudioVisualizerClass *) g_class;
 
+  gobject_class->set_property = gst_spectra_scope_set_property;
+  gobject_class->get_property = gst_spectra_scope_get_property;
   gobject_class->finalize = gst_spectra_scope_finalize;
 
+  /**
+   * GstSpectraScope:fft-size:
+   *
+   * Number of audio samples analysed per frame, rounded up to a size the
+   * fft handles efficiently. 0 uses two samples per video column. Takes
+   * effect on the next caps.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FFT_SIZE,
+      g_param_spec_uint ("fft-size", "FFT size",
+          "Number of samples analysed per frame (0 = twice the video width)",
+          0, 65536, DEFAULT_FFT_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Frequency spectrum scope", "Visualization",
       "Simple frequency spectrum scope", "Stefan Kost <ensonic@users.sf.net>");
@@ -102,22 +138,52 @@ gst_spectra_scope_class_init (GstSpectraScopeClass * g_class)
 static void
 gst_spectra_scope_init (GstSpectraScope * scope)
 {
-  /* do nothing */
+  scope->fft_size = DEFAULT_FFT_SIZE;
 }
 
 static void
-gst_spectra_scope_finalize (GObject * object)
+gst_spectra_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
 {
   GstSpectraScope *scope = GST_SPECTRA_SCOPE (object);
 
-  if (scope->fft_ctx) {
-    gst_fft_s16_free (scope->fft_ctx);
-    scope->fft_ctx = NULL;
+  switch (prop_id) {
+    case PROP_FFT_SIZE:
+      scope->fft_size = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
   }
-  if (scope->freq_data) {
-    g_free (scope->freq_data);
-    scope->freq_data = NULL;
+}
+
+static void
+gst_spectra_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSpectraScope *scope = GST_SPECTRA_SCOPE (object);
+
+  switch (prop_id) {
+    case PROP_FFT_SIZE:
+      g_value_set_uint (value, scope->fft_size);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
   }
+}
+
+static void
+gst_spectra_scope_finalize (GObject * object)
+{
+  GstSpectraScope *scope = GST_SPECTRA_SCOPE (object);
+
+  gst_scope_fft_free (scope->fft);
+  scope->fft = NULL;
+  g_free (scope->power);
+  scope->power = NULL;
+  g_free (scope->tops);
+  scope->tops = NULL;
 
   G_OBJECT_CLASS (gst_spectra_scope_parent_class)->finalize (object);
 }
@@ -126,42 +192,27 @@ static gboolean
 gst_spectra_scope_setup (GstAudioVisualizer * bscope)
 {
   GstSpectraScope *scope = GST_SPECTRA_SCOPE (bscope);
-  guint num_freq = GST_VIDEO_INFO_WIDTH (&bscope->vinfo) + 1;
+  guint w = GST_VIDEO_INFO_WIDTH (&bscope->vinfo);
+  guint len;
 
-  if (scope->fft_ctx)
-    gst_fft_s16_free (scope->fft_ctx);
-  g_free (scope->freq_data);
+  gst_scope_fft_free (scope->fft);
+  g_free (scope->power);
+  g_free (scope->tops);
 
-  /* we'd need this amount of samples per render() call */
-  bscope->req_spf = num_freq * 2 - 2;
-  scope->fft_ctx = gst_fft_s16_new (bscope->req_spf, FALSE);
-  scope->freq_data = g_new (GstFFTS16Complex, num_freq);
+  if (scope->fft_size)
+    len = gst_scope_fft_get_length (scope->fft_size);
+  else
+    len = w * 2;
 
-  return TRUE;
-}
+  /* we'd need this amount of samples per render() call */
+  bscope->req_spf = len;
+  scope->fft = gst_scope_fft_new (len, GST_FFT_WINDOW_HAMMING);
+  scope->power = g_new (gfloat, len / 2 + 1);
+  scope->tops = g_new (guint, w);
 
-static inline void
-add_pixel (guint32 * _p, guint32 _c)
-{
-  guint8 *p = (guint8 *) _p;
-  guint8 *c = (guint8 *) & _c;
+  GST_DEBUG_OBJECT (scope, "fft size %u for %u columns", len, w);
 
-  if (p[0] < 255 - c[0])
-    p[0] += c[0];
-  else
-    p[0] = 255;
-  if (p[1] < 255 - c[1])
-    p[1] += c[1];
-  else
-    p[1] = 255;
-  if (p[2] < 255 - c[2])
-    p[2] += c[2];
-  else
-    p[2] = 255;
-  if (p[3] < 255 - c[3])
-    p[3] += c[3];
-  else
-    p[3] = 255;
+  return TRUE;
 }
 
 static gboolean
@@ -169,63 +220,74 @@ gst_spectra_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
     GstVideoFrame * video)
 {
   GstSpectraScope *scope = GST_SPECTRA_SCOPE (bscope);
-  gint16 *mono_adata;
-  GstFFTS16Complex *fdata = scope->freq_data;
-  guint x, y, off, l;
+  GstScopeFFT *fft = scope->fft;
+  GstFFTF32Complex *fdata = fft->freq;
+  gfloat *input = fft->input;
+  gfloat *power = scope->power;
+  guint *tops = scope->tops;
+  guint x, y, i, bin, next, n_bins = fft->len / 2;
   guint w = GST_VIDEO_INFO_WIDTH (&bscope->vinfo);
   guint h = GST_VIDEO_INFO_HEIGHT (&bscope->vinfo) - 1;
-  gfloat fr, fi;
+  gfloat max;
   GstMapInfo amap;
+  gint16 *adata;
   guint32 *vdata;
-  gint channels;
+  guint channels, num_samples;
 
   gst_buffer_map (audio, &amap, GST_MAP_READ);
   vdata = (guint32 *) GST_VIDEO_FRAME_PLANE_DATA (video, 0);
+  adata = (gint16 *) amap.data;
 
   channels = GST_AUDIO_INFO_CHANNELS (&bscope->ainfo);
+  num_samples = MIN (amap.size / (channels * sizeof (gint16)), fft->len);
 
-  mono_adata = (gint16 *) g_memdup (amap.data, amap.size);
-
-  if (channels > 1) {
-    guint ch = channels;
-    guint num_samples = amap.size / (ch * sizeof (gint16));
-    guint i, c, v, s = 0;
+  /* mixdown */
+  if (channels == 2) {
+    for (i = 0; i < num_samples; i++)
+      input[i] = (adata[2 * i] + adata[2 * i + 1]) * 0.5f;
+  } else {
+    guint c;
 
-    /* deinterleave and mixdown adata */
     for (i = 0; i < num_samples; i++) {
-      v = 0;
-      for (c = 0; c < ch; c++) {
-        v += mono_adata[s++];
-      }
-      mono_adata[i] = v / ch;
+      gint v = 0;
+
+      for (c = 0; c < channels; c++)
+        v += adata[i * channels + c];
+      input[i] = (gfloat) v / channels;
     }
   }
+  for (; i < fft->len; i++)
+    input[i] = 0.0f;
+  gst_buffer_unmap (audio, &amap);
 
   /* run fft */
-  gst_fft_s16_window (scope->fft_ctx, mono_adata, GST_FFT_WINDOW_HAMMING);
-  gst_fft_s16_fft (scope->fft_ctx, mono_adata, fdata);
-  g_free (mono_adata);
+  gst_scope_fft_run (fft);
 
-  /* draw lines */
+  for (i = 1; i <= n_bins; i++)
+    power[i] = fdata[i].r * fdata[i].r + fdata[i].i * fdata[i].i;
+
+  /* figure out the bar of each column, taking the strongest of the bins
+   * that fall into it or the nearest bin if there are less bins than
+   * columns */
   for (x = 0; x < w; x++) {
+    bin = 1 + (guint64) x * n_bins / w;
+    next = 1 + (guint64) (x + 1) * n_bins / w;
+    max = power[bin];
+    for (i = bin + 1; i < next; i++)
+      max = MAX (max, power[i]);
+
     /* figure out the range so that we don't need to clip,
      * or even better do a log mapping? */
-    fr = (gfloat) fdata[1 + x].r / 512.0;
-    fi = (gfloat) fdata[1 + x].i / 512.0;
-    y = (guint) (h * sqrt (fr * fr + fi * fi));
+    y = (guint) (h * sqrtf (max) / 512.0f);
     if (y > h)
       y = h;
-    y = h - y;
-    off = (y * w) + x;
-    vdata[off] = 0x00FFFFFF;
-    for (l = y; l < h; l++) {
-      off += w;
-      add_pixel (&vdata[off], 0x007F7F7F);
-    }
-    /* ensure bottom line is full bright (especially in move-up mode) */
-    add_pixel (&vdata[off], 0x007F7F7F);
+    tops[x] = h - y;
   }
-  gst_buffer_unmap (audio, &amap);
+
+  /* draw lines */
+  gst_spectra_scope_draw_bars (vdata, GST_VIDEO_FRAME_PLANE_STRIDE (video, 0),
+      tops, w, h);
+
   return TRUE;
 }
 
@@ -23,7 +23,7 @@
 #define __GST_SPECTRA_SCOPE_H__
 
 #include "gst/pbutils/gstaudiovisualizer.h"
-#include <gst/fft/gstffts16.h>
+#include "gstscopefft.h"
 
 G_BEGIN_DECLS
 #define GST_TYPE_SPECTRA_SCOPE            (gst_spectra_scope_get_type())
@@ -38,8 +38,13 @@ struct _GstSpectraScope
 {
   GstAudioVisualizer parent;
 
-  GstFFTS16 *fft_ctx;
-  GstFFTS16Complex *freq_data;
+  /* properties */
+  guint fft_size;
+
+  GstScopeFFT *fft;
+  /* squared magnitude of the bins, highest bar per column */
+  gfloat *power;
+  guint *tops;
 };
 
 struct _GstSpectraScopeClass
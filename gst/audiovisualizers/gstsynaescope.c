@@ -26,6 +26,10 @@
  * Synaescope is an audio visualisation element. It analyzes frequencies and
  * out-of phase properties of audio and draws this as clouds of stars.
  *
+ * By default each video row shows one frequency band, the
+ * #GstSynaeScope:fft-size property allows analysing the audio with a
+ * different resolution.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 audiotestsrc ! audioconvert ! synaescope ! ximagesink
@@ -36,7 +40,11 @@
 #include "config.h"
 #endif
 
+#include <math.h>
+#include <string.h>
+
 #include "gstsynaescope.h"
+#include "gstdrawhelpers.h"
 
 #if G_BYTE_ORDER == G_BIG_ENDIAN
 #define RGB_ORDER "xRGB"
@@ -66,6 +74,18 @@ GST_STATIC_PAD_TEMPLATE ("sink",
 GST_DEBUG_CATEGORY_STATIC (synae_scope_debug);
 #define GST_CAT_DEFAULT synae_scope_debug
 
+#define DEFAULT_FFT_SIZE 0
+
+enum
+{
+  PROP_0,
+  PROP_FFT_SIZE
+};
+
+static void gst_synae_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_synae_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 static void gst_synae_scope_finalize (GObject * object);
 
 static gboolean gst_synae_scope_setup (GstAudioVisualizer * scope);
@@ -82,8 +102,25 @@ gst_synae_scope_class_init (GstSynaeScopeClass * g_class)
   GstElementClass *element_class = (GstElementClass *) g_class;
   GstAudioVisualizerClass *scope_class = (GstAudioVisualizerClass *) g_class;
 
+  gobject_class->set_property = gst_synae_scope_set_property;
+  gobject_class->get_property = gst_synae_scope_get_property;
   gobject_class->finalize = gst_synae_scope_finalize;
 
+  /**
+   * GstSynaeScope:fft-size:
+   *
+   * Number of audio samples analysed per frame, rounded up to a size the
+   * fft handles efficiently. 0 uses two samples per video row. Takes
+   * effect on the next caps.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FFT_SIZE,
+      g_param_spec_uint ("fft-size", "FFT size",
+          "Number of samples analysed per frame (0 = twice the video height)",
+          0, 65536, DEFAULT_FFT_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class, "Synaescope",
       "Visualization",
       "Creates video visualizations of audio input, using stereo and pitch information",
@@ -120,33 +157,51 @@ gst_synae_scope_init (GstSynaeScope * scope)
 
   for (i = 0; i < 256; i++)
     shade[i] = i * 200 >> 8;
+
+  scope->fft_size = DEFAULT_FFT_SIZE;
 }
 
 static void
-gst_synae_scope_finalize (GObject * object)
+gst_synae_scope_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
 {
   GstSynaeScope *scope = GST_SYNAE_SCOPE (object);
 
-  if (scope->fft_ctx) {
-    gst_fft_s16_free (scope->fft_ctx);
-    scope->fft_ctx = NULL;
-  }
-  if (scope->freq_data_l) {
-    g_free (scope->freq_data_l);
-    scope->freq_data_l = NULL;
-  }
-  if (scope->freq_data_r) {
-    g_free (scope->freq_data_r);
-    scope->freq_data_r = NULL;
-  }
-  if (scope->adata_l) {
-    g_free (scope->adata_l);
-    scope->adata_l = NULL;
+  switch (prop_id) {
+    case PROP_FFT_SIZE:
+      scope->fft_size = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
   }
-  if (scope->adata_r) {
-    g_free (scope->adata_r);
-    scope->adata_r = NULL;
+}
+
+static void
+gst_synae_scope_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSynaeScope *scope = GST_SYNAE_SCOPE (object);
+
+  switch (prop_id) {
+    case PROP_FFT_SIZE:
+      g_value_set_uint (value, scope->fft_size);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
   }
+}
+
+static void
+gst_synae_scope_finalize (GObject * object)
+{
+  GstSynaeScope *scope = GST_SYNAE_SCOPE (object);
+
+  gst_scope_fft_free (scope->fft);
+  scope->fft = NULL;
+  g_free (scope->freq_data_l);
+  scope->freq_data_l = NULL;
 
   G_OBJECT_CLASS (gst_synae_scope_parent_class)->finalize (object);
 }
@@ -155,53 +210,29 @@ static gboolean
 gst_synae_scope_setup (GstAudioVisualizer * bscope)
 {
   GstSynaeScope *scope = GST_SYNAE_SCOPE (bscope);
-  guint num_freq = GST_VIDEO_INFO_HEIGHT (&bscope->vinfo) + 1;
+  guint h = GST_VIDEO_INFO_HEIGHT (&bscope->vinfo);
+  guint len;
 
-  if (scope->fft_ctx)
-    gst_fft_s16_free (scope->fft_ctx);
+  gst_scope_fft_free (scope->fft);
   g_free (scope->freq_data_l);
-  g_free (scope->freq_data_r);
-  g_free (scope->adata_l);
-  g_free (scope->adata_r);
 
   /* FIXME: we could have horizontal or vertical layout */
 
+  if (scope->fft_size)
+    len = gst_scope_fft_get_length (scope->fft_size);
+  else
+    len = h * 2;
+
   /* we'd need this amount of samples per render() call */
-  bscope->req_spf = num_freq * 2 - 2;
-  scope->fft_ctx = gst_fft_s16_new (bscope->req_spf, FALSE);
-  scope->freq_data_l = g_new (GstFFTS16Complex, num_freq);
-  scope->freq_data_r = g_new (GstFFTS16Complex, num_freq);
+  bscope->req_spf = len;
+  scope->fft = gst_scope_fft_new (len, GST_FFT_WINDOW_RECTANGULAR);
+  scope->freq_data_l = g_new (GstFFTF32Complex, len / 2 + 1);
 
-  scope->adata_l = g_new (gint16, bscope->req_spf);
-  scope->adata_r = g_new (gint16, bscope->req_spf);
+  GST_DEBUG_OBJECT (scope, "fft size %u for %u rows", len, h);
 
   return TRUE;
 }
 
-static inline void
-add_pixel (guint32 * _p, guint32 _c)
-{
-  guint8 *p = (guint8 *) _p;
-  guint8 *c = (guint8 *) & _c;
-
-  if (p[0] < 255 - c[0])
-    p[0] += c[0];
-  else
-    p[0] = 255;
-  if (p[1] < 255 - c[1])
-    p[1] += c[1];
-  else
-    p[1] = 255;
-  if (p[2] < 255 - c[2])
-    p[2] += c[2];
-  else
-    p[2] = 255;
-  if (p[3] < 255 - c[3])
-    p[3] += c[3];
-  else
-    p[3] = 255;
-}
-
 static gboolean
 gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
     GstVideoFrame * video)
@@ -210,10 +241,11 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
   GstMapInfo amap;
   guint32 *vdata;
   gint16 *adata;
-  gint16 *adata_l = scope->adata_l;
-  gint16 *adata_r = scope->adata_r;
-  GstFFTS16Complex *fdata_l = scope->freq_data_l;
-  GstFFTS16Complex *fdata_r = scope->freq_data_r;
+  GstScopeFFT *fft = scope->fft;
+  gfloat *input = fft->input;
+  GstFFTF32Complex *fdata_l = scope->freq_data_l;
+  GstFFTF32Complex *fdata_r = fft->freq;
+  guint n_bins = fft->len / 2, bin, next;
   gint x, y;
   guint off;
   guint w = GST_VIDEO_INFO_WIDTH (&bscope->vinfo);
@@ -227,7 +259,7 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
   gint br, br1, br2;
   gint clarity;
   gdouble fc, r, l, rr, ll;
-  gdouble frl, fil, frr, fir;
+  gdouble frl, fil, frr, fir, cc;
   const guint sl = 30;
 
   gst_buffer_map (audio, &amap, GST_MAP_READ);
@@ -235,36 +267,45 @@ gst_synae_scope_render (GstAudioVisualizer * bscope, GstBuffer * audio,
   vdata = (guint32 *) GST_VIDEO_FRAME_PLANE_DATA (video, 0);
   adata = (gint16 *) amap.data;
 
-  num_samples = amap.size / (ch * sizeof (gint16));
+  num_samples = MIN (amap.size / (ch * sizeof (gint16)), fft->len);
 
-  /* deinterleave */
-  for (i = 0, j = 0; i < num_samples; i++) {
-    adata_l[i] = adata[j++];
-    adata_r[i] = adata[j++];
-  }
+  /* run the fft on each channel in turn, reusing the plan */
+  for (i = 0, j = 0; i < num_samples; i++, j += 2)
+    input[i] = adata[j];
+  for (; i < fft->len; i++)
+    input[i] = 0.0f;
+  gst_scope_fft_run (fft);
+  memcpy (fdata_l, fft->freq, (n_bins + 1) * sizeof (GstFFTF32Complex));
 
-  /* run fft */
-  /*gst_fft_s16_window (scope->fft_ctx, adata_l, GST_FFT_WINDOW_HAMMING); */
-  gst_fft_s16_fft (scope->fft_ctx, adata_l, fdata_l);
-  /*gst_fft_s16_window (scope->fft_ctx, adata_r, GST_FFT_WINDOW_HAMMING); */
-  gst_fft_s16_fft (scope->fft_ctx, adata_r, fdata_r);
+  for (i = 0, j = 1; i < num_samples; i++, j += 2)
+    input[i] = adata[j];
+  for (; i < fft->len; i++)
+    input[i] = 0.0f;
+  gst_scope_fft_run (fft);
 
   /* draw stars */
   for (y = 0; y < h; y++) {
     b = h - y;
-    frl = (gdouble) fdata_l[b].r;
-    fil = (gdouble) fdata_l[b].i;
-    frr = (gdouble) fdata_r[b].r;
-    fir = (gdouble) fdata_r[b].i;
 
-    ll = (frl + fil) * (frl + fil) + (frr - fir) * (frr - fir);
+    /* sum up the energy of the bins that fall into this row, or take the
+     * nearest bin if there are less bins than rows */
+    bin = 1 + (guint64) (b - 1) * n_bins / h;
+    next = MAX (1 + (guint64) b * n_bins / h, bin + 1);
+    ll = rr = cc = 0.0;
+    for (; bin < next; bin++) {
+      frl = (gdouble) fdata_l[bin].r;
+      fil = (gdouble) fdata_l[bin].i;
+      frr = (gdouble) fdata_r[bin].r;
+      fir = (gdouble) fdata_r[bin].i;
+
+      ll += (frl + fil) * (frl + fil) + (frr - fir) * (frr - fir);
+      rr += (frl - fil) * (frl - fil) + (frr + fir) * (frr + fir);
+      cc += (frl + fil) * (frl - fil) + (frr + fir) * (frr - fir);
+    }
     l = sqrt (ll);
-    rr = (frl - fil) * (frl - fil) + (frr + fir) * (frr + fir);
     r = sqrt (rr);
     /* out-of-phase'ness for this frequency component */
-    clarity = (gint) (
-        ((frl + fil) * (frl - fil) + (frr + fir) * (frr - fir)) /
-        (ll + rr) * 256);
+    clarity = (gint) (cc / (ll + rr) * 256);
     fc = r + l;
 
     x = (guint) (r * w / fc);
@@ -32,6 +32,10 @@
  * The list of element it will look into can be specified in the
  * #GstAutoConvert::factories property, otherwise it will look at all available
  * elements.
+ *
+ * The element selected for a pair of sink and source caps is remembered, and
+ * elements that were created once stay in the bin, so switching back to caps
+ * that were seen before does not go through the candidates again.
  */
 
 
@@ -49,6 +53,27 @@ GST_DEBUG_CATEGORY (autoconvert_debug);
 #define GST_AUTOCONVERT_LOCK(ac) GST_OBJECT_LOCK (ac)
 #define GST_AUTOCONVERT_UNLOCK(ac) GST_OBJECT_UNLOCK (ac)
 
+/* number of caps to factory decisions that are remembered */
+#define CACHE_SIZE 16
+
+/* A factory with exactly one always sink and source pad template, and the
+ * caps of these templates */
+typedef struct
+{
+  GstElementFactory *factory;
+  GstCaps *sink_caps;
+  GstCaps *src_caps;
+} GstAutoConvertCandidate;
+
+/* The factory that was selected for sink caps and the caps of the peer of
+ * the source pad */
+typedef struct
+{
+  GstCaps *sink_caps;
+  GstCaps *src_caps;
+  GstElementFactory *factory;
+} GstAutoConvertCacheEntry;
+
 /* elementfactory information */
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -211,6 +236,25 @@ gst_auto_convert_init (GstAutoConvert * autoconvert)
   gst_element_add_pad (GST_ELEMENT (autoconvert), autoconvert->srcpad);
 }
 
+static void
+gst_auto_convert_candidate_free (GstAutoConvertCandidate * candidate)
+{
+  gst_object_unref (candidate->factory);
+  gst_caps_unref (candidate->sink_caps);
+  gst_caps_unref (candidate->src_caps);
+  g_slice_free (GstAutoConvertCandidate, candidate);
+}
+
+static void
+gst_auto_convert_cache_entry_free (GstAutoConvertCacheEntry * entry)
+{
+  gst_caps_unref (entry->sink_caps);
+  if (entry->src_caps)
+    gst_caps_unref (entry->src_caps);
+  gst_object_unref (entry->factory);
+  g_slice_free (GstAutoConvertCacheEntry, entry);
+}
+
 static void
 gst_auto_convert_dispose (GObject * object)
 {
@@ -220,6 +264,13 @@ gst_auto_convert_dispose (GObject * object)
   g_clear_object (&autoconvert->current_internal_sinkpad);
   g_clear_object (&autoconvert->current_internal_srcpad);
 
+  g_list_free_full (autoconvert->candidates,
+      (GDestroyNotify) gst_auto_convert_candidate_free);
+  autoconvert->candidates = NULL;
+  g_list_free_full (autoconvert->cache,
+      (GDestroyNotify) gst_auto_convert_cache_entry_free);
+  autoconvert->cache = NULL;
+
   for (;;) {
     GList *factories = g_atomic_pointer_get (&autoconvert->factories);
 
@@ -570,57 +621,182 @@ gst_auto_convert_get_or_make_element_from_factory (GstAutoConvert * autoconvert,
 }
 
 /*
- * This function checks if there is one and only one pad template on the
- * factory that can accept the given caps. If there is one and only one,
- * it returns TRUE, otherwise, its FALSE
+ * This function returns the caps of the static pad template of the factory
+ * in the given direction. If there is not exactly one such template, it
+ * returns NULL
  */
 
-static gboolean
-factory_can_intersect (GstAutoConvert * autoconvert,
-    GstElementFactory * factory, GstPadDirection direction, GstCaps * caps)
+static GstCaps *
+factory_get_template_caps (GstAutoConvert * autoconvert,
+    GstElementFactory * factory, GstPadDirection direction)
 {
   const GList *templates;
-  gint has_direction = FALSE;
-  gboolean ret = FALSE;
-
-  g_return_val_if_fail (factory != NULL, FALSE);
-  g_return_val_if_fail (caps != NULL, FALSE);
+  GstStaticPadTemplate *found = NULL;
 
   templates = gst_element_factory_get_static_pad_templates (factory);
 
-  while (templates) {
+  for (; templates; templates = g_list_next (templates)) {
     GstStaticPadTemplate *template = (GstStaticPadTemplate *) templates->data;
 
-    if (template->direction == direction) {
-      GstCaps *tmpl_caps = NULL;
-      gboolean intersect;
+    if (template->direction != direction)
+      continue;
 
-      /* If there is more than one pad in this direction, we return FALSE
-       * Only transform elements (with one sink and one source pad)
-       * are accepted
-       */
-      if (has_direction) {
-        GST_DEBUG_OBJECT (autoconvert, "Factory %p"
-            " has more than one static template with dir %d",
-            template, direction);
-        return FALSE;
-      }
-      has_direction = TRUE;
+    /* If there is more than one pad in this direction, we return NULL
+     * Only transform elements (with one sink and one source pad)
+     * are accepted
+     */
+    if (found) {
+      GST_DEBUG_OBJECT (autoconvert, "Factory %p"
+          " has more than one static template with dir %d",
+          template, direction);
+      return NULL;
+    }
+    found = template;
+  }
+
+  if (!found)
+    return NULL;
+
+  return gst_static_caps_get (&found->static_caps);
+}
+
+/*
+ * Builds the candidate list from the factories, once, so that the static
+ * pad templates don't have to be looked up again on every caps change or
+ * caps query
+ */
+
+static GList *
+gst_auto_convert_get_candidates (GstAutoConvert * autoconvert)
+{
+  GList *factories, *elem, *candidates = NULL;
+
+  GST_AUTOCONVERT_LOCK (autoconvert);
+  candidates = autoconvert->candidates;
+  GST_AUTOCONVERT_UNLOCK (autoconvert);
+
+  if (candidates)
+    return candidates;
+
+  factories = g_atomic_pointer_get (&autoconvert->factories);
 
-      tmpl_caps = gst_static_caps_get (&template->static_caps);
-      intersect = gst_caps_can_intersect (tmpl_caps, caps);
-      GST_DEBUG_OBJECT (autoconvert, "Factories %" GST_PTR_FORMAT
-          " static caps %" GST_PTR_FORMAT " and caps %" GST_PTR_FORMAT
-          " can%s intersect", factory, tmpl_caps, caps,
-          intersect ? "" : " not");
-      gst_caps_unref (tmpl_caps);
+  if (!factories)
+    factories = gst_auto_convert_load_factories (autoconvert);
 
-      ret |= intersect;
+  for (elem = factories; elem; elem = g_list_next (elem)) {
+    GstElementFactory *factory = GST_ELEMENT_FACTORY (elem->data);
+    GstAutoConvertCandidate *candidate;
+    GstCaps *sink_caps, *src_caps;
+
+    sink_caps = factory_get_template_caps (autoconvert, factory, GST_PAD_SINK);
+    src_caps = factory_get_template_caps (autoconvert, factory, GST_PAD_SRC);
+
+    if (!sink_caps || !src_caps) {
+      GST_LOG_OBJECT (autoconvert, "Factory %s is not a transform element",
+          gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)));
+      if (sink_caps)
+        gst_caps_unref (sink_caps);
+      if (src_caps)
+        gst_caps_unref (src_caps);
+      continue;
     }
-    templates = g_list_next (templates);
+
+    candidate = g_slice_new (GstAutoConvertCandidate);
+    candidate->factory = gst_object_ref (factory);
+    candidate->sink_caps = sink_caps;
+    candidate->src_caps = src_caps;
+    candidates = g_list_prepend (candidates, candidate);
   }
 
-  return ret;
+  candidates = g_list_reverse (candidates);
+
+  /* a caps query on another thread may have built it in the meantime */
+  GST_AUTOCONVERT_LOCK (autoconvert);
+  if (!autoconvert->candidates) {
+    autoconvert->candidates = candidates;
+    candidates = NULL;
+  }
+  GST_AUTOCONVERT_UNLOCK (autoconvert);
+
+  g_list_free_full (candidates,
+      (GDestroyNotify) gst_auto_convert_candidate_free);
+
+  return autoconvert->candidates;
+}
+
+static gboolean
+caps_equal_or_null (GstCaps * caps1, GstCaps * caps2)
+{
+  if (!caps1 || !caps2)
+    return caps1 == caps2;
+
+  return gst_caps_is_equal (caps1, caps2);
+}
+
+/* returns the factory that was selected for these caps before, if any */
+static GstElementFactory *
+gst_auto_convert_cache_lookup (GstAutoConvert * autoconvert, GstCaps * caps,
+    GstCaps * other_caps)
+{
+  GstElementFactory *factory = NULL;
+  GList *item;
+
+  GST_AUTOCONVERT_LOCK (autoconvert);
+  for (item = autoconvert->cache; item; item = g_list_next (item)) {
+    GstAutoConvertCacheEntry *entry = item->data;
+
+    if (gst_caps_is_equal (entry->sink_caps, caps) &&
+        caps_equal_or_null (entry->src_caps, other_caps)) {
+      factory = gst_object_ref (entry->factory);
+      autoconvert->cache = g_list_remove_link (autoconvert->cache, item);
+      autoconvert->cache = g_list_concat (item, autoconvert->cache);
+      break;
+    }
+  }
+  GST_AUTOCONVERT_UNLOCK (autoconvert);
+
+  return factory;
+}
+
+static void
+gst_auto_convert_cache_remove (GstAutoConvert * autoconvert, GstCaps * caps,
+    GstCaps * other_caps)
+{
+  GList *item;
+
+  GST_AUTOCONVERT_LOCK (autoconvert);
+  for (item = autoconvert->cache; item; item = g_list_next (item)) {
+    GstAutoConvertCacheEntry *entry = item->data;
+
+    if (gst_caps_is_equal (entry->sink_caps, caps) &&
+        caps_equal_or_null (entry->src_caps, other_caps)) {
+      autoconvert->cache = g_list_delete_link (autoconvert->cache, item);
+      gst_auto_convert_cache_entry_free (entry);
+      break;
+    }
+  }
+  GST_AUTOCONVERT_UNLOCK (autoconvert);
+}
+
+static void
+gst_auto_convert_cache_add (GstAutoConvert * autoconvert, GstCaps * caps,
+    GstCaps * other_caps, GstElementFactory * factory)
+{
+  GstAutoConvertCacheEntry *entry = g_slice_new (GstAutoConvertCacheEntry);
+
+  entry->sink_caps = gst_caps_ref (caps);
+  entry->src_caps = other_caps ? gst_caps_ref (other_caps) : NULL;
+  entry->factory = gst_object_ref (factory);
+
+  GST_AUTOCONVERT_LOCK (autoconvert);
+  autoconvert->cache = g_list_prepend (autoconvert->cache, entry);
+  if (g_list_length (autoconvert->cache) > CACHE_SIZE) {
+    GList *last = g_list_last (autoconvert->cache);
+
+    gst_auto_convert_cache_entry_free (last->data);
+    autoconvert->cache = g_list_delete_link (autoconvert->cache, last);
+  }
+  GST_AUTOCONVERT_UNLOCK (autoconvert);
 }
 
 static gboolean
@@ -712,8 +888,10 @@ gst_auto_convert_sink_setcaps (GstAutoConvert * autoconvert, GstCaps * caps)
 {
   GList *elem;
   GstCaps *other_caps = NULL;
-  GList *factories;
+  GList *candidates;
   GstCaps *current_caps;
+  GstElementFactory *factory;
+  GstElement *element;
 
   g_return_val_if_fail (autoconvert != NULL, FALSE);
 
@@ -749,27 +927,43 @@ gst_auto_convert_sink_setcaps (GstAutoConvert * autoconvert, GstCaps * caps)
 
   other_caps = gst_pad_peer_query_caps (autoconvert->srcpad, NULL);
 
-  factories = g_atomic_pointer_get (&autoconvert->factories);
+  /* Try the element that was selected the last time we saw these caps */
+  factory = gst_auto_convert_cache_lookup (autoconvert, caps, other_caps);
+  if (factory) {
+    element =
+        gst_auto_convert_get_or_make_element_from_factory (autoconvert,
+        factory);
+    if (element && gst_auto_convert_activate_element (autoconvert, element,
+            caps)) {
+      GST_DEBUG_OBJECT (autoconvert, "Reused cached selection %s",
+          gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)));
+      gst_object_unref (factory);
+      goto get_out;
+    }
+    if (element)
+      gst_object_unref (element);
+    gst_auto_convert_cache_remove (autoconvert, caps, other_caps);
+    gst_object_unref (factory);
+  }
 
-  if (!factories)
-    factories = gst_auto_convert_load_factories (autoconvert);
+  candidates = gst_auto_convert_get_candidates (autoconvert);
 
-  for (elem = factories; elem; elem = g_list_next (elem)) {
-    GstElementFactory *factory = GST_ELEMENT_FACTORY (elem->data);
-    GstElement *element;
+  for (elem = candidates; elem; elem = g_list_next (elem)) {
+    GstAutoConvertCandidate *candidate = elem->data;
+
+    factory = candidate->factory;
 
     /* Lets first check if according to the static pad templates on the factory
      * these caps have any chance of success
      */
-    if (!factory_can_intersect (autoconvert, factory, GST_PAD_SINK, caps)) {
+    if (!gst_caps_can_intersect (candidate->sink_caps, caps)) {
       GST_LOG_OBJECT (autoconvert, "Factory %s does not accept sink caps %"
           GST_PTR_FORMAT,
           gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)), caps);
       continue;
     }
     if (other_caps != NULL) {
-      if (!factory_can_intersect (autoconvert, factory, GST_PAD_SRC,
-              other_caps)) {
+      if (!gst_caps_can_intersect (candidate->src_caps, other_caps)) {
         GST_LOG_OBJECT (autoconvert,
             "Factory %s does not accept src caps %" GST_PTR_FORMAT,
             gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)),
@@ -786,10 +980,12 @@ gst_auto_convert_sink_setcaps (GstAutoConvert * autoconvert, GstCaps * caps)
       continue;
 
     /* And make it the current child */
-    if (gst_auto_convert_activate_element (autoconvert, element, caps))
+    if (gst_auto_convert_activate_element (autoconvert, element, caps)) {
+      gst_auto_convert_cache_add (autoconvert, caps, other_caps, factory);
       break;
-    else
+    } else {
       gst_object_unref (element);
+    }
   }
 
 get_out:
@@ -852,8 +1048,11 @@ gst_auto_convert_default_filter_func (GstPluginFeature * feature,
 
     caps = gst_static_pad_template_get_caps (template);
 
-    if (gst_caps_is_any (caps) || gst_caps_is_empty (caps))
+    if (gst_caps_is_any (caps) || gst_caps_is_empty (caps)) {
+      gst_caps_unref (caps);
       return FALSE;
+    }
+    gst_caps_unref (caps);
   }
 
   if (!src || !sink)
@@ -895,7 +1094,8 @@ gst_auto_convert_load_factories (GstAutoConvert * autoconvert)
 
   g_assert (all_factories);
 
-  if (g_atomic_pointer_compare_and_exchange (&autoconvert->factories, NULL,
+  /* someone else set the factories in the meantime */
+  if (!g_atomic_pointer_compare_and_exchange (&autoconvert->factories, NULL,
           all_factories)) {
     gst_plugin_feature_list_free (all_factories);
   }
@@ -1066,7 +1266,7 @@ gst_auto_convert_getcaps (GstAutoConvert * autoconvert, GstCaps * filter,
     GstPadDirection dir)
 {
   GstCaps *caps = NULL, *other_caps = NULL;
-  GList *elem, *factories;
+  GList *elem, *candidates;
 
   caps = gst_caps_new_empty ();
 
@@ -1083,19 +1283,26 @@ gst_auto_convert_getcaps (GstAutoConvert * autoconvert, GstCaps * filter,
     goto out;
   }
 
-  factories = g_atomic_pointer_get (&autoconvert->factories);
-
-  if (!factories)
-    factories = gst_auto_convert_load_factories (autoconvert);
+  candidates = gst_auto_convert_get_candidates (autoconvert);
 
-  for (elem = factories; elem; elem = g_list_next (elem)) {
-    GstElementFactory *factory = GST_ELEMENT_FACTORY (elem->data);
+  for (elem = candidates; elem; elem = g_list_next (elem)) {
+    GstAutoConvertCandidate *candidate = elem->data;
+    GstElementFactory *factory = candidate->factory;
+    GstCaps *dir_caps, *other_dir_caps;
     GstElement *element = NULL;
     GstCaps *element_caps;
     GstPad *internal_pad = NULL;
 
+    if (dir == GST_PAD_SINK) {
+      dir_caps = candidate->sink_caps;
+      other_dir_caps = candidate->src_caps;
+    } else {
+      dir_caps = candidate->src_caps;
+      other_dir_caps = candidate->sink_caps;
+    }
+
     if (filter) {
-      if (!factory_can_intersect (autoconvert, factory, dir, filter)) {
+      if (!gst_caps_can_intersect (dir_caps, filter)) {
         GST_LOG_OBJECT (autoconvert,
             "Factory %s does not accept src caps %" GST_PTR_FORMAT,
             gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)),
@@ -1105,8 +1312,7 @@ gst_auto_convert_getcaps (GstAutoConvert * autoconvert, GstCaps * filter,
     }
 
     if (other_caps != NULL) {
-      if (!factory_can_intersect (autoconvert, factory,
-              dir == GST_PAD_SINK ? GST_PAD_SRC : GST_PAD_SINK, other_caps)) {
+      if (!gst_caps_can_intersect (other_dir_caps, other_caps)) {
         GST_LOG_OBJECT (autoconvert,
             "Factory %s does not accept src caps %" GST_PTR_FORMAT,
             gst_plugin_feature_get_name (GST_PLUGIN_FEATURE (factory)),
@@ -1137,24 +1343,11 @@ gst_auto_convert_getcaps (GstAutoConvert * autoconvert, GstCaps * filter,
       if (gst_caps_is_any (caps))
         goto out;
     } else {
-      const GList *tmp;
-
-      for (tmp = gst_element_factory_get_static_pad_templates (factory);
-          tmp; tmp = g_list_next (tmp)) {
-        GstStaticPadTemplate *template = tmp->data;
+      caps = gst_caps_merge (caps, gst_caps_ref (dir_caps));
 
-        if (GST_PAD_TEMPLATE_DIRECTION (template) == dir) {
-          GstCaps *static_caps = gst_static_pad_template_get_caps (template);
-
-          if (static_caps) {
-            caps = gst_caps_merge (caps, static_caps);
-          }
-
-          /* Early out, any is absorbing */
-          if (gst_caps_is_any (caps))
-            goto out;
-        }
-      }
+      /* Early out, any is absorbing */
+      if (gst_caps_is_any (caps))
+        goto out;
     }
   }
 
@@ -53,6 +53,14 @@ struct _GstAutoConvert
   GstElement *current_subelement;
   GstPad *current_internal_srcpad;
   GstPad *current_internal_sinkpad;
+
+  /* GstAutoConvertCandidate list, built from the factories on first use
+   * and not modified afterwards. Set with the object lock held */
+  GList *candidates;
+
+  /* GstAutoConvertCacheEntry list, most recently used first
+   * Protected by the object lock */
+  GList *cache;
 };
 
 struct _GstAutoConvertClass
@@ -26,6 +26,15 @@
  * @title: bayer2rgb
  *
  * Decodes raw camera bayer (fourcc BA81) to RGB.
+ *
+ * Besides 8 bit bayer, 10, 12, 14 and 16 bit samples in little or big
+ * endian words are accepted (for example bggr12le), they are scaled down
+ * to 8 bit RGB.
+ *
+ * The default bilinear #GstBayer2RGB:method is fast, the malvar-he-cutler
+ * method uses gradient corrected 5x5 kernels that give sharper edges with
+ * less colour fringing. Set #GstBayer2RGB:n-threads to spread the rows of
+ * large frames over several threads.
  */
 
 /*
@@ -79,6 +88,7 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
+#include <gst/stripe-threads-private.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -86,6 +96,7 @@
 #include <stdint.h>
 #endif
 
+#include "gstbayer2rgbmhc.h"
 #include "gstbayerorc.h"
 
 #define GST_CAT_DEFAULT gst_bayer2rgb_debug
@@ -99,6 +110,31 @@ enum
   GST_BAYER_2_RGB_FORMAT_RGGB
 };
 
+typedef enum
+{
+  GST_BAYER_2_RGB_METHOD_BILINEAR = 0,
+  GST_BAYER_2_RGB_METHOD_MALVAR
+} GstBayer2RGBMethod;
+
+#define GST_TYPE_BAYER_2_RGB_METHOD (gst_bayer2rgb_method_get_type ())
+static GType
+gst_bayer2rgb_method_get_type (void)
+{
+  static GType method_type = 0;
+  static const GEnumValue methods[] = {
+    {GST_BAYER_2_RGB_METHOD_BILINEAR, "Bilinear interpolation", "bilinear"},
+    {GST_BAYER_2_RGB_METHOD_MALVAR,
+        "Gradient corrected interpolation (Malvar-He-Cutler)",
+        "malvar-he-cutler"},
+    {0, NULL, NULL}
+  };
+
+  if (!method_type) {
+    method_type = g_enum_register_static ("GstBayer2RGBMethod", methods);
+  }
+  return method_type;
+}
+
 
 #define GST_TYPE_BAYER2RGB            (gst_bayer2rgb_get_type())
 #define GST_BAYER2RGB(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_BAYER2RGB,GstBayer2RGB))
@@ -123,6 +159,14 @@ struct _GstBayer2RGB
   int g_off;                    /* offset for green */
   int b_off;                    /* offset for blue */
   int format;
+  int bpp;                      /* bits per bayer sample */
+  gboolean big_endian;
+
+  /* properties */
+  GstBayer2RGBMethod method;
+
+  /* the n-threads property is threads.n_threads */
+  GstStripeThreads threads;
 };
 
 struct _GstBayer2RGBClass
@@ -133,14 +177,25 @@ struct _GstBayer2RGBClass
 #define	SRC_CAPS                                 \
   GST_VIDEO_CAPS_MAKE ("{ RGBx, xRGB, BGRx, xBGR, RGBA, ARGB, BGRA, ABGR }")
 
-#define SINK_CAPS "video/x-bayer,format=(string){bggr,grbg,gbrg,rggb}," \
+#define BAYER_FORMATS(bits) \
+  "bggr" bits "le,grbg" bits "le,gbrg" bits "le,rggb" bits "le," \
+  "bggr" bits "be,grbg" bits "be,gbrg" bits "be,rggb" bits "be"
+
+#define SINK_CAPS "video/x-bayer,format=(string){bggr,grbg,gbrg,rggb," \
+  BAYER_FORMATS ("10") "," BAYER_FORMATS ("12") "," BAYER_FORMATS ("14") \
+  "," BAYER_FORMATS ("16") "}," \
   "width=(int)[1,MAX],height=(int)[1,MAX],framerate=(fraction)[0/1,MAX]"
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_METHOD,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_METHOD GST_BAYER_2_RGB_METHOD_BILINEAR
+#define DEFAULT_N_THREADS 1
+
 GType gst_bayer2rgb_get_type (void);
 
 #define gst_bayer2rgb_parent_class parent_class
@@ -150,6 +205,7 @@ static void gst_bayer2rgb_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_bayer2rgb_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static void gst_bayer2rgb_finalize (GObject * object);
 
 static gboolean gst_bayer2rgb_set_caps (GstBaseTransform * filter,
     GstCaps * incaps, GstCaps * outcaps);
@@ -173,6 +229,18 @@ gst_bayer2rgb_class_init (GstBayer2RGBClass * klass)
 
   gobject_class->set_property = gst_bayer2rgb_set_property;
   gobject_class->get_property = gst_bayer2rgb_get_property;
+  gobject_class->finalize = gst_bayer2rgb_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_METHOD,
+      g_param_spec_enum ("method", "Method", "Demosaicing method",
+          GST_TYPE_BAYER_2_RGB_METHOD, DEFAULT_METHOD,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads used for demosaicing, each one handles a "
+          "stripe of rows (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (gstelement_class,
       "Bayer to RGB decoder for cameras", "Filter/Converter/Video",
@@ -202,17 +270,36 @@ gst_bayer2rgb_class_init (GstBayer2RGBClass * klass)
 static void
 gst_bayer2rgb_init (GstBayer2RGB * filter)
 {
+  filter->method = DEFAULT_METHOD;
+  gst_stripe_threads_init (&filter->threads, DEFAULT_N_THREADS);
+
   gst_bayer2rgb_reset (filter);
   gst_base_transform_set_in_place (GST_BASE_TRANSFORM (filter), TRUE);
 }
 
-/* No properties are implemented, so only a warning is produced */
+static void
+gst_bayer2rgb_finalize (GObject * object)
+{
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
+
+  gst_stripe_threads_clear (&filter->threads);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_bayer2rgb_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
 
   switch (prop_id) {
+    case PROP_METHOD:
+      filter->method = g_value_get_enum (value);
+      break;
+    case PROP_N_THREADS:
+      filter->threads.n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -223,14 +310,59 @@ static void
 gst_bayer2rgb_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
+  GstBayer2RGB *filter = GST_BAYER2RGB (object);
 
   switch (prop_id) {
+    case PROP_METHOD:
+      g_value_set_enum (value, filter->method);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->threads.n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* Parses the pattern, and the sample size and endianness of the >8 bit
+ * formats named like bggr12le */
+static gboolean
+gst_bayer2rgb_parse_format (const char *format, int *pattern, int *bpp,
+    gboolean * big_endian)
+{
+  if (format == NULL || strlen (format) < 4)
+    return FALSE;
+
+  if (g_str_has_prefix (format, "bggr")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_BGGR;
+  } else if (g_str_has_prefix (format, "gbrg")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_GBRG;
+  } else if (g_str_has_prefix (format, "grbg")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_GRBG;
+  } else if (g_str_has_prefix (format, "rggb")) {
+    *pattern = GST_BAYER_2_RGB_FORMAT_RGGB;
+  } else {
+    return FALSE;
+  }
+
+  format += 4;
+  if (*format == '\0') {
+    *bpp = 8;
+    *big_endian = FALSE;
+    return TRUE;
+  }
+
+  if (strlen (format) != 4 || (!g_str_has_suffix (format, "le") &&
+          !g_str_has_suffix (format, "be")))
+    return FALSE;
+
+  *bpp = atoi (format);
+  *big_endian = g_str_has_suffix (format, "be");
+
+  return *bpp > 8 && *bpp <= 16;
+}
+
 static gboolean
 gst_bayer2rgb_set_caps (GstBaseTransform * base, GstCaps * incaps,
     GstCaps * outcaps)
@@ -249,17 +381,9 @@ gst_bayer2rgb_set_caps (GstBaseTransform * base, GstCaps * incaps,
   gst_structure_get_int (structure, "height", &bayer2rgb->height);
 
   format = gst_structure_get_string (structure, "format");
-  if (g_str_equal (format, "bggr")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_BGGR;
-  } else if (g_str_equal (format, "gbrg")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_GBRG;
-  } else if (g_str_equal (format, "grbg")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_GRBG;
-  } else if (g_str_equal (format, "rggb")) {
-    bayer2rgb->format = GST_BAYER_2_RGB_FORMAT_RGGB;
-  } else {
+  if (!gst_bayer2rgb_parse_format (format, &bayer2rgb->format,
+          &bayer2rgb->bpp, &bayer2rgb->big_endian))
     return FALSE;
-  }
 
   /* To cater for different RGB formats, we need to set params for later */
   gst_video_info_from_caps (&info, outcaps);
@@ -280,6 +404,8 @@ gst_bayer2rgb_reset (GstBayer2RGB * filter)
   filter->r_off = 0;
   filter->g_off = 0;
   filter->b_off = 0;
+  filter->bpp = 8;
+  filter->big_endian = FALSE;
   gst_video_info_init (&filter->info);
 }
 
@@ -334,7 +460,13 @@ gst_bayer2rgb_get_unit_size (GstBaseTransform * base, GstCaps * caps,
     name = gst_structure_get_name (structure);
     /* Our name must be either video/x-bayer video/x-raw */
     if (strcmp (name, "video/x-raw")) {
-      *size = GST_ROUND_UP_4 (width) * height;
+      int pattern, bpp;
+      gboolean big_endian;
+
+      if (!gst_bayer2rgb_parse_format (gst_structure_get_string (structure,
+                  "format"), &pattern, &bpp, &big_endian))
+        bpp = 8;
+      *size = GST_ROUND_UP_4 (width * (bpp > 8 ? 2 : 1)) * height;
       return TRUE;
     } else {
       /* For output, calculate according to format (always 32 bits) */
@@ -381,14 +513,160 @@ typedef void (*process_func) (guint8 * d0, const guint8 * s0, const guint8 * s1,
     const guint8 * s2, const guint8 * s3, const guint8 * s4, const guint8 * s5,
     int n);
 
+typedef struct
+{
+  GstBayer2RGB *bayer2rgb;
+  guint8 *dest;
+  int dest_stride;
+  const guint8 *src;
+  int src_stride;
+  process_func merge[2];
+  GstBayer2RGBMethod method;
+  int first;
+  int last;
+} GstBayer2RGBStripe;
+
+/* Scales a line of >8 bit samples down to 8 bit */
+static void
+gst_bayer2rgb_reduce_line (guint8 * dest, const guint8 * src, int width,
+    int bpp, gboolean big_endian)
+{
+  int shift = bpp - 8;
+  int i;
+
+  if (big_endian) {
+    for (i = 0; i < width; i++)
+      dest[i] = MIN (GST_READ_UINT16_BE (src + 2 * i) >> shift, 255);
+  } else {
+    for (i = 0; i < width; i++)
+      dest[i] = MIN (GST_READ_UINT16_LE (src + 2 * i) >> shift, 255);
+  }
+}
+
+static void
+gst_bayer2rgb_upsample_row (GstBayer2RGBStripe * stripe, guint8 * dest0,
+    guint8 * dest1, int row, guint8 * tmp)
+{
+  GstBayer2RGB *bayer2rgb = stripe->bayer2rgb;
+  const guint8 *src;
+
+  row = gst_bayer2rgb_mirror (row, bayer2rgb->height);
+  src = stripe->src + row * stripe->src_stride;
+  if (bayer2rgb->bpp > 8) {
+    gst_bayer2rgb_reduce_line (tmp, src, bayer2rgb->width, bayer2rgb->bpp,
+        bayer2rgb->big_endian);
+    src = tmp;
+  }
+
+  gst_bayer2rgb_split_and_upsample_horiz (dest0, dest1, src, bayer2rgb->width);
+}
+
+static void
+gst_bayer2rgb_process_bilinear (GstBayer2RGBStripe * stripe)
+{
+  GstBayer2RGB *bayer2rgb = stripe->bayer2rgb;
+  int width = bayer2rgb->width;
+  guint8 *tmp, *line = NULL;
+  int j;
+
+  tmp = g_malloc (2 * 4 * width);
+  if (bayer2rgb->bpp > 8)
+    line = g_malloc (width);
+#define LINE(x) (tmp + ((x)&7) * width)
+
+  /* each stripe starts from the line above its first one */
+  j = stripe->first;
+  gst_bayer2rgb_upsample_row (stripe, LINE (j * 2 - 2), LINE (j * 2 - 1),
+      j - 1, line);
+  gst_bayer2rgb_upsample_row (stripe, LINE (j * 2 + 0), LINE (j * 2 + 1),
+      j, line);
+
+  for (; j < stripe->last; j++) {
+    gst_bayer2rgb_upsample_row (stripe, LINE ((j + 1) * 2 + 0),
+        LINE ((j + 1) * 2 + 1), j + 1, line);
+
+    stripe->merge[j & 1] (stripe->dest + j * stripe->dest_stride,
+        LINE (j * 2 - 2), LINE (j * 2 - 1),
+        LINE (j * 2 + 0), LINE (j * 2 + 1),
+        LINE (j * 2 + 2), LINE (j * 2 + 3), width >> 1);
+  }
+#undef LINE
+
+  g_free (line);
+  g_free (tmp);
+}
+
+static void
+gst_bayer2rgb_process_malvar (GstBayer2RGBStripe * stripe)
+{
+  GstBayer2RGB *bayer2rgb = stripe->bayer2rgb;
+  int width = bayer2rgb->width;
+  int height = bayer2rgb->height;
+  int stride = width + 2 * GST_BAYER2RGB_MHC_PAD;
+  gboolean first_red, first_green;
+  gint16 *lines, *rows[5];
+  guint8 *planes;
+  int j, k;
+
+  /* colour of the first row and whether the first column is green */
+  first_red = bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_GRBG ||
+      bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_RGGB;
+  first_green = bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_GBRG ||
+      bayer2rgb->format == GST_BAYER_2_RGB_FORMAT_GRBG;
+
+  lines = g_new (gint16, 5 * stride);
+  planes = g_malloc (3 * width);
+#define MHC_LINE(x) (lines + (((x) + 10) % 5) * stride + GST_BAYER2RGB_MHC_PAD)
+
+  for (j = stripe->first - 2; j < stripe->first + 2; j++) {
+    gst_bayer2rgb_load_line (MHC_LINE (j), stripe->src +
+        gst_bayer2rgb_mirror (j, height) * stripe->src_stride, width,
+        bayer2rgb->bpp, bayer2rgb->big_endian);
+  }
+
+  for (j = stripe->first; j < stripe->last; j++) {
+    gboolean row_red = first_red ^ (j & 1);
+    guint8 *x = planes, *g = planes + width, *y = planes + 2 * width;
+
+    gst_bayer2rgb_load_line (MHC_LINE (j + 2), stripe->src +
+        gst_bayer2rgb_mirror (j + 2, height) * stripe->src_stride, width,
+        bayer2rgb->bpp, bayer2rgb->big_endian);
+    for (k = 0; k < 5; k++)
+      rows[k] = MHC_LINE (j - 2 + k);
+
+    gst_bayer2rgb_mhc_line (g, x, y, rows, first_green ^ (j & 1), width);
+    gst_bayer2rgb_pack_line (stripe->dest + j * stripe->dest_stride,
+        row_red ? x : y, g, row_red ? y : x, bayer2rgb->r_off,
+        bayer2rgb->g_off, bayer2rgb->b_off, width);
+  }
+#undef MHC_LINE
+
+  g_free (planes);
+  g_free (lines);
+}
+
+/* user_data is the stripe of the whole frame */
+static void
+gst_bayer2rgb_stripe_func (gpointer user_data, guint n, gint first, gint last)
+{
+  GstBayer2RGBStripe stripe = *(GstBayer2RGBStripe *) user_data;
+
+  stripe.first = first;
+  stripe.last = last;
+  if (stripe.method == GST_BAYER_2_RGB_METHOD_MALVAR)
+    gst_bayer2rgb_process_malvar (&stripe);
+  else
+    gst_bayer2rgb_process_bilinear (&stripe);
+}
+
 static void
 gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
     int dest_stride, uint8_t * src, int src_stride)
 {
-  int j;
-  guint8 *tmp;
+  GstBayer2RGBStripe frame;
   process_func merge[2] = { NULL, NULL };
   int r_off, g_off, b_off;
+  GstBayer2RGBMethod method = bayer2rgb->method;
 
   /* We exploit some symmetry in the functions here.  The base functions
    * are all named for the BGGR arrangement.  For RGGB, we swap the
@@ -423,33 +701,21 @@ gst_bayer2rgb_process (GstBayer2RGB * bayer2rgb, uint8_t * dest,
     merge[1] = tmp;
   }
 
-  tmp = g_malloc (2 * 4 * bayer2rgb->width);
-#define LINE(x) (tmp + ((x)&7) * bayer2rgb->width)
-
-  gst_bayer2rgb_split_and_upsample_horiz (LINE (3 * 2 + 0), LINE (3 * 2 + 1),
-      src + 1 * src_stride, bayer2rgb->width);
-  j = 0;
-  gst_bayer2rgb_split_and_upsample_horiz (LINE (j * 2 + 0), LINE (j * 2 + 1),
-      src + j * src_stride, bayer2rgb->width);
-
-  for (j = 0; j < bayer2rgb->height; j++) {
-    if (j < bayer2rgb->height - 1) {
-      gst_bayer2rgb_split_and_upsample_horiz (LINE ((j + 1) * 2 + 0),
-          LINE ((j + 1) * 2 + 1), src + (j + 1) * src_stride, bayer2rgb->width);
-    }
-
-    merge[j & 1] (dest + j * dest_stride,
-        LINE (j * 2 - 2), LINE (j * 2 - 1),
-        LINE (j * 2 + 0), LINE (j * 2 + 1),
-        LINE (j * 2 + 2), LINE (j * 2 + 3), bayer2rgb->width >> 1);
-  }
-
-  g_free (tmp);
+  frame.bayer2rgb = bayer2rgb;
+  frame.dest = dest;
+  frame.dest_stride = dest_stride;
+  frame.src = src;
+  frame.src_stride = src_stride;
+  frame.merge[0] = merge[0];
+  frame.merge[1] = merge[1];
+  frame.method = method;
+  frame.first = 0;
+  frame.last = bayer2rgb->height;
+
+  gst_stripe_threads_run (&bayer2rgb->threads, bayer2rgb->height, 16,
+      gst_bayer2rgb_stripe_func, &frame);
 }
 
-
-
-
 static GstFlowReturn
 gst_bayer2rgb_transform (GstBaseTransform * base, GstBuffer * inbuf,
     GstBuffer * outbuf)
@@ -471,7 +737,7 @@ gst_bayer2rgb_transform (GstBaseTransform * base, GstBuffer * inbuf,
 
   output = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
   gst_bayer2rgb_process (filter, output, frame.info.stride[0],
-      map.data, GST_ROUND_UP_4 (filter->width));
+      map.data, GST_ROUND_UP_4 (filter->width * (filter->bpp > 8 ? 2 : 1)));
 
   gst_video_frame_unmap (&frame);
   gst_buffer_unmap (inbuf, &map);
@@ -0,0 +1,268 @@
+/*
+ * GStreamer
+ * Copyright (C) 2007 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * March 2008
+ * Logic enhanced by William Brack <wbrack@mmm.com.hk>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstbayer2rgbmhc.h"
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+static inline guint
+gst_bayer2rgb_read_sample (const guint8 * src, int i, gboolean big_endian)
+{
+  return big_endian ? GST_READ_UINT16_BE (src + 2 * i) :
+      GST_READ_UINT16_LE (src + 2 * i);
+}
+
+/* Loads a line of bayer samples as 10 bit values, with
+ * GST_BAYER2RGB_MHC_PAD mirrored samples on both sides */
+void
+gst_bayer2rgb_load_line (gint16 * dest, const guint8 * src, int width,
+    int bpp, gboolean big_endian)
+{
+  int i;
+
+  if (bpp == 8) {
+    for (i = 0; i < width; i++)
+      dest[i] = src[i] << 2;
+  } else {
+    int shift = bpp - 10;
+
+    for (i = 0; i < width; i++) {
+      guint v = gst_bayer2rgb_read_sample (src, i, big_endian);
+
+      dest[i] = MIN (shift >= 0 ? v >> shift : v << -shift, 1023);
+    }
+  }
+
+  for (i = 1; i <= GST_BAYER2RGB_MHC_PAD; i++) {
+    dest[-i] = dest[gst_bayer2rgb_mirror (-i, width)];
+    dest[width - 1 + i] = dest[gst_bayer2rgb_mirror (width - 1 + i, width)];
+  }
+}
+
+static inline guint8
+gst_bayer2rgb_mhc_clamp (int k)
+{
+  return CLAMP ((k + 32) >> 6, 0, 255);
+}
+
+/* Computes green, the colour of the row and the other colour for pixels
+ * [i, width) of a line, sites are the non green columns of the row */
+static void
+gst_bayer2rgb_mhc_line_c (guint8 * g, guint8 * x, guint8 * y,
+    gint16 ** rows, int site, int i, int width)
+{
+  for (; i < width; i++) {
+    const gint16 *n2 = rows[0] + i;
+    const gint16 *n1 = rows[1] + i;
+    const gint16 *c = rows[2] + i;
+    const gint16 *s1 = rows[3] + i;
+    const gint16 *s2 = rows[4] + i;
+    int cc = c[0];
+    int diag = n1[-1] + n1[1] + s1[-1] + s1[1];
+    int h2 = c[-2] + c[2];
+    int v2 = n2[0] + s2[0];
+
+    if ((i & 1) == site) {
+      g[i] = gst_bayer2rgb_mhc_clamp (8 * cc + 4 * (n1[0] + s1[0] + c[-1] +
+              c[1]) - 2 * (h2 + v2));
+      x[i] = gst_bayer2rgb_mhc_clamp (16 * cc);
+      y[i] = gst_bayer2rgb_mhc_clamp (12 * cc + 4 * diag - 3 * (h2 + v2));
+    } else {
+      g[i] = gst_bayer2rgb_mhc_clamp (16 * cc);
+      x[i] = gst_bayer2rgb_mhc_clamp (10 * cc + 8 * (c[-1] + c[1]) - 2 * h2 -
+          2 * diag + v2);
+      y[i] = gst_bayer2rgb_mhc_clamp (10 * cc + 8 * (n1[0] + s1[0]) - 2 * v2 -
+          2 * diag + h2);
+    }
+  }
+}
+
+#if defined (__SSE2__)
+void
+gst_bayer2rgb_mhc_line (guint8 * g, guint8 * x, guint8 * y, gint16 ** rows,
+    int site, int width)
+{
+  const __m128i even = _mm_set_epi16 (0, -1, 0, -1, 0, -1, 0, -1);
+  const __m128i sites = site ? _mm_xor_si128 (even, _mm_set1_epi16 (-1)) :
+      even;
+  const __m128i round = _mm_set1_epi16 (32);
+  int i;
+
+#define LOAD(r,o) _mm_loadu_si128 ((const __m128i *) (rows[r] + i + (o)))
+  for (i = 0; i + 8 <= width; i += 8) {
+    __m128i cc = LOAD (2, 0);
+    __m128i h1 = _mm_add_epi16 (LOAD (2, -1), LOAD (2, 1));
+    __m128i v1 = _mm_add_epi16 (LOAD (1, 0), LOAD (3, 0));
+    __m128i h2 = _mm_add_epi16 (LOAD (2, -2), LOAD (2, 2));
+    __m128i v2 = _mm_add_epi16 (LOAD (0, 0), LOAD (4, 0));
+    __m128i diag = _mm_add_epi16 (_mm_add_epi16 (LOAD (1, -1), LOAD (1, 1)),
+        _mm_add_epi16 (LOAD (3, -1), LOAD (3, 1)));
+    __m128i hv2 = _mm_add_epi16 (h2, v2);
+    __m128i c10 = _mm_mullo_epi16 (cc, _mm_set1_epi16 (10));
+    __m128i c16 = _mm_slli_epi16 (cc, 4);
+    __m128i diag2 = _mm_slli_epi16 (diag, 1);
+    __m128i kg, krow, kcol, kdiag, vg, vx, vy;
+
+    kg = _mm_sub_epi16 (_mm_add_epi16 (_mm_slli_epi16 (cc, 3),
+            _mm_slli_epi16 (_mm_add_epi16 (h1, v1), 2)),
+        _mm_slli_epi16 (hv2, 1));
+    kdiag = _mm_sub_epi16 (_mm_add_epi16 (_mm_mullo_epi16 (cc,
+                _mm_set1_epi16 (12)), _mm_slli_epi16 (diag, 2)),
+        _mm_mullo_epi16 (hv2, _mm_set1_epi16 (3)));
+    krow = _mm_add_epi16 (_mm_add_epi16 (c10, _mm_slli_epi16 (h1, 3)), v2);
+    krow = _mm_sub_epi16 (krow, _mm_add_epi16 (_mm_slli_epi16 (h2, 1), diag2));
+    kcol = _mm_add_epi16 (_mm_add_epi16 (c10, _mm_slli_epi16 (v1, 3)), h2);
+    kcol = _mm_sub_epi16 (kcol, _mm_add_epi16 (_mm_slli_epi16 (v2, 1), diag2));
+
+    vg = _mm_or_si128 (_mm_and_si128 (sites, kg), _mm_andnot_si128 (sites,
+            c16));
+    vx = _mm_or_si128 (_mm_and_si128 (sites, c16), _mm_andnot_si128 (sites,
+            krow));
+    vy = _mm_or_si128 (_mm_and_si128 (sites, kdiag), _mm_andnot_si128 (sites,
+            kcol));
+    vg = _mm_srai_epi16 (_mm_add_epi16 (vg, round), 6);
+    vx = _mm_srai_epi16 (_mm_add_epi16 (vx, round), 6);
+    vy = _mm_srai_epi16 (_mm_add_epi16 (vy, round), 6);
+
+    _mm_storel_epi64 ((__m128i *) (g + i), _mm_packus_epi16 (vg, vg));
+    _mm_storel_epi64 ((__m128i *) (x + i), _mm_packus_epi16 (vx, vx));
+    _mm_storel_epi64 ((__m128i *) (y + i), _mm_packus_epi16 (vy, vy));
+  }
+#undef LOAD
+
+  gst_bayer2rgb_mhc_line_c (g, x, y, rows, site, i, width);
+}
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+void
+gst_bayer2rgb_mhc_line (guint8 * g, guint8 * x, guint8 * y, gint16 ** rows,
+    int site, int width)
+{
+  static const guint16 even_lanes[8] = { 0xffff, 0, 0xffff, 0, 0xffff, 0,
+    0xffff, 0
+  };
+  uint16x8_t sites = vld1q_u16 (even_lanes);
+  int i;
+
+  if (site)
+    sites = vmvnq_u16 (sites);
+
+#define LOAD(r,o) vld1q_s16 (rows[r] + i + (o))
+  for (i = 0; i + 8 <= width; i += 8) {
+    int16x8_t cc = LOAD (2, 0);
+    int16x8_t h1 = vaddq_s16 (LOAD (2, -1), LOAD (2, 1));
+    int16x8_t v1 = vaddq_s16 (LOAD (1, 0), LOAD (3, 0));
+    int16x8_t h2 = vaddq_s16 (LOAD (2, -2), LOAD (2, 2));
+    int16x8_t v2 = vaddq_s16 (LOAD (0, 0), LOAD (4, 0));
+    int16x8_t diag = vaddq_s16 (vaddq_s16 (LOAD (1, -1), LOAD (1, 1)),
+        vaddq_s16 (LOAD (3, -1), LOAD (3, 1)));
+    int16x8_t hv2 = vaddq_s16 (h2, v2);
+    int16x8_t c16 = vshlq_n_s16 (cc, 4);
+    int16x8_t kg, krow, kcol, kdiag;
+
+    kg = vmulq_n_s16 (cc, 8);
+    kg = vmlaq_n_s16 (kg, vaddq_s16 (h1, v1), 4);
+    kg = vmlsq_n_s16 (kg, hv2, 2);
+    kdiag = vmulq_n_s16 (cc, 12);
+    kdiag = vmlaq_n_s16 (kdiag, diag, 4);
+    kdiag = vmlsq_n_s16 (kdiag, hv2, 3);
+    krow = vmlaq_n_s16 (vmulq_n_s16 (cc, 10), h1, 8);
+    krow = vaddq_s16 (krow, v2);
+    krow = vmlsq_n_s16 (vmlsq_n_s16 (krow, h2, 2), diag, 2);
+    kcol = vmlaq_n_s16 (vmulq_n_s16 (cc, 10), v1, 8);
+    kcol = vaddq_s16 (kcol, h2);
+    kcol = vmlsq_n_s16 (vmlsq_n_s16 (kcol, v2, 2), diag, 2);
+
+    vst1_u8 (g + i, vqrshrun_n_s16 (vbslq_s16 (sites, kg, c16), 6));
+    vst1_u8 (x + i, vqrshrun_n_s16 (vbslq_s16 (sites, c16, krow), 6));
+    vst1_u8 (y + i, vqrshrun_n_s16 (vbslq_s16 (sites, kdiag, kcol), 6));
+  }
+#undef LOAD
+
+  gst_bayer2rgb_mhc_line_c (g, x, y, rows, site, i, width);
+}
+#else
+void
+gst_bayer2rgb_mhc_line (guint8 * g, guint8 * x, guint8 * y, gint16 ** rows,
+    int site, int width)
+{
+  gst_bayer2rgb_mhc_line_c (g, x, y, rows, site, 0, width);
+}
+#endif
+
+/* Interleaves the red, green and blue planes into 32 bit pixels with an
+ * opaque alpha (or padding) byte */
+void
+gst_bayer2rgb_pack_line (guint8 * dest, const guint8 * r, const guint8 * g,
+    const guint8 * b, int r_off, int g_off, int b_off, int width)
+{
+  int a_off = 6 - r_off - g_off - b_off;
+  int i = 0;
+
+#if defined (__SSE2__)
+  for (; i + 16 <= width; i += 16) {
+    __m128i v[4], lo01, hi01, lo23, hi23;
+
+    v[r_off] = _mm_loadu_si128 ((const __m128i *) (r + i));
+    v[g_off] = _mm_loadu_si128 ((const __m128i *) (g + i));
+    v[b_off] = _mm_loadu_si128 ((const __m128i *) (b + i));
+    v[a_off] = _mm_set1_epi8 (-1);
+    lo01 = _mm_unpacklo_epi8 (v[0], v[1]);
+    hi01 = _mm_unpackhi_epi8 (v[0], v[1]);
+    lo23 = _mm_unpacklo_epi8 (v[2], v[3]);
+    hi23 = _mm_unpackhi_epi8 (v[2], v[3]);
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * i),
+        _mm_unpacklo_epi16 (lo01, lo23));
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * i + 16),
+        _mm_unpackhi_epi16 (lo01, lo23));
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * i + 32),
+        _mm_unpacklo_epi16 (hi01, hi23));
+    _mm_storeu_si128 ((__m128i *) (dest + 4 * i + 48),
+        _mm_unpackhi_epi16 (hi01, hi23));
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  for (; i + 16 <= width; i += 16) {
+    uint8x16x4_t v;
+
+    v.val[r_off] = vld1q_u8 (r + i);
+    v.val[g_off] = vld1q_u8 (g + i);
+    v.val[b_off] = vld1q_u8 (b + i);
+    v.val[a_off] = vdupq_n_u8 (0xff);
+    vst4q_u8 (dest + 4 * i, v);
+  }
+#endif
+
+  for (; i < width; i++) {
+    dest[4 * i + r_off] = r[i];
+    dest[4 * i + g_off] = g[i];
+    dest[4 * i + b_off] = b[i];
+    dest[4 * i + a_off] = 0xff;
+  }
+}
@@ -0,0 +1,70 @@
+/*
+ * GStreamer
+ * Copyright (C) 2007 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * March 2008
+ * Logic enhanced by William Brack <wbrack@mmm.com.hk>
+ */
+
+#ifndef __GST_BAYER2RGB_MHC_H__
+#define __GST_BAYER2RGB_MHC_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* The Malvar-He-Cutler method works on the raw mosaic with 5x5 kernels,
+ * computed on 10 bit samples in 16 bit lanes. All kernels are scaled by 16
+ * so that their coefficients are integers:
+ *
+ *   green at red or blue:  8 C + 4 (N1 + S1 + W1 + E1) - 2 (N2 + S2 + W2 + E2)
+ *   colour of the row at green:
+ *       10 C + 8 (W1 + E1) - 2 (W2 + E2) - 2 (diagonals) + (N2 + S2)
+ *   colour of the column at green:
+ *       10 C + 8 (N1 + S1) - 2 (N2 + S2) - 2 (diagonals) + (W2 + E2)
+ *   red at blue or blue at red:
+ *       12 C + 4 (diagonals) - 3 (N2 + S2 + W2 + E2)
+ *
+ * which stays within 16 bits, the 8 bit result is (k + 32) >> 6. */
+#define GST_BAYER2RGB_MHC_PAD 2
+
+/* Rows and columns out of the frame are mirrored around the first and last
+ * ones, which keeps the bayer pattern intact */
+static inline int
+gst_bayer2rgb_mirror (int i, int n)
+{
+  if (i < 0)
+    i = -i;
+  if (i >= n)
+    i = 2 * (n - 1) - i;
+  return CLAMP (i, 0, n - 1);
+}
+
+G_GNUC_INTERNAL
+void gst_bayer2rgb_load_line (gint16 * dest, const guint8 * src, int width,
+    int bpp, gboolean big_endian);
+G_GNUC_INTERNAL
+void gst_bayer2rgb_mhc_line (guint8 * g, guint8 * x, guint8 * y,
+    gint16 ** rows, int site, int width);
+G_GNUC_INTERNAL
+void gst_bayer2rgb_pack_line (guint8 * dest, const guint8 * r,
+    const guint8 * g, const guint8 * b, int r_off, int g_off, int b_off,
+    int width);
+
+G_END_DECLS
+#endif /* __GST_BAYER2RGB_MHC_H__ */
@@ -26,6 +26,12 @@
  *
  * A camera bin src element that wraps a default video source with a single
  * pad into the 3pad model that camerabin2 expects.
+ *
+ * When #GstWrapperCameraBinSrc:zsl-frames is set, the last viewfinder frames
+ * are kept around and an image capture takes the one closest to the moment
+ * it was requested instead of waiting for the source to switch to image
+ * capture. The viewfinder caps then have to be the full resolution image
+ * capture caps, as there is no renegotiation.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -43,9 +49,12 @@ enum
 {
   PROP_0,
   PROP_VIDEO_SRC,
-  PROP_VIDEO_SRC_FILTER
+  PROP_VIDEO_SRC_FILTER,
+  PROP_ZSL_FRAMES
 };
 
+#define DEFAULT_ZSL_FRAMES 0
+
 GST_DEBUG_CATEGORY (wrapper_camera_bin_src_debug);
 #define GST_CAT_DEFAULT wrapper_camera_bin_src_debug
 
@@ -74,6 +83,29 @@ GST_STATIC_PAD_TEMPLATE (GST_BASE_CAMERA_SRC_VIDEO_PAD_NAME,
 static void set_capsfilter_caps (GstWrapperCameraBinSrc * self,
     GstCaps * new_caps);
 
+/* call with the zsl_lock */
+static void
+gst_wrapper_camera_bin_src_zsl_trim (GstWrapperCameraBinSrc * self,
+    guint max_frames)
+{
+  while (g_queue_get_length (&self->zsl_ring) > max_frames)
+    gst_sample_unref (g_queue_pop_head (&self->zsl_ring));
+}
+
+/* call with the zsl_lock */
+static void
+gst_wrapper_camera_bin_src_zsl_reset (GstWrapperCameraBinSrc * self)
+{
+  gst_wrapper_camera_bin_src_zsl_trim (self, 0);
+
+  if (self->zsl_pool) {
+    gst_buffer_pool_set_active (self->zsl_pool, FALSE);
+    gst_object_unref (self->zsl_pool);
+    self->zsl_pool = NULL;
+  }
+  self->zsl_pool_size = 0;
+}
+
 static void
 gst_wrapper_camera_bin_src_dispose (GObject * object)
 {
@@ -105,12 +137,18 @@ gst_wrapper_camera_bin_src_dispose (GObject * object)
   }
   gst_caps_replace (&self->image_capture_caps, NULL);
 
+  g_mutex_lock (&self->zsl_lock);
+  gst_wrapper_camera_bin_src_zsl_reset (self);
+  g_mutex_unlock (&self->zsl_lock);
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
 static void
 gst_wrapper_camera_bin_src_finalize (GstWrapperCameraBinSrc * self)
 {
+  g_mutex_clear (&self->zsl_lock);
+
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) (self));
 }
 
@@ -147,6 +185,14 @@ gst_wrapper_camera_bin_src_set_property (GObject * object,
           gst_object_ref (self->app_vid_filter);
       }
       break;
+    case PROP_ZSL_FRAMES:
+      g_mutex_lock (&self->zsl_lock);
+      self->zsl_frames = g_value_get_uint (value);
+      /* the pool is sized for the old number of frames */
+      if (self->zsl_frames == 0 || self->zsl_pool)
+        gst_wrapper_camera_bin_src_zsl_reset (self);
+      g_mutex_unlock (&self->zsl_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -172,6 +218,11 @@ gst_wrapper_camera_bin_src_get_property (GObject * object,
       else
         g_value_set_object (value, self->app_vid_filter);
       break;
+    case PROP_ZSL_FRAMES:
+      g_mutex_lock (&self->zsl_lock);
+      g_value_set_uint (value, self->zsl_frames);
+      g_mutex_unlock (&self->zsl_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (self, prop_id, pspec);
       break;
@@ -280,7 +331,11 @@ gst_wrapper_camera_bin_src_imgsrc_probe (GstPad * pad, GstPadProbeInfo * info,
     gst_caps_unref (caps);
     gst_sample_unref (sample);
 
-    if (self->image_capture_count == 0) {
+    if (self->image_capture_count == 0 && self->zsl_capture) {
+      /* the viewfinder kept running, there is nothing to restore */
+      self->zsl_capture = FALSE;
+      gst_base_camera_src_finish_capture (camerasrc);
+    } else if (self->image_capture_count == 0) {
       GstCaps *anycaps = gst_caps_new_any ();
 
       /* Get back to viewfinder */
@@ -296,6 +351,100 @@ gst_wrapper_camera_bin_src_imgsrc_probe (GstPad * pad, GstPadProbeInfo * info,
   return ret;
 }
 
+static gboolean
+gst_wrapper_camera_bin_src_zsl_setup_pool (GstWrapperCameraBinSrc * self,
+    GstCaps * caps, gsize size)
+{
+  GstStructure *config;
+
+  gst_wrapper_camera_bin_src_zsl_reset (self);
+
+  /* one more than the ring holds for the frame being captured */
+  self->zsl_pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (self->zsl_pool);
+  gst_buffer_pool_config_set_params (config, caps, size,
+      self->zsl_frames + 1, self->zsl_frames + 1);
+  if (!gst_buffer_pool_set_config (self->zsl_pool, config) ||
+      !gst_buffer_pool_set_active (self->zsl_pool, TRUE)) {
+    GST_WARNING_OBJECT (self, "Failed to set up zero shutter lag pool");
+    gst_object_unref (self->zsl_pool);
+    self->zsl_pool = NULL;
+    return FALSE;
+  }
+  self->zsl_pool_size = size;
+
+  return TRUE;
+}
+
+/**
+ * gst_wrapper_camera_bin_src_zsl_probe:
+ *
+ * Buffer probe keeping the last viewfinder frames for zero shutter lag
+ * image capture.
+ */
+static GstPadProbeReturn
+gst_wrapper_camera_bin_src_zsl_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer data)
+{
+  GstWrapperCameraBinSrc *self = GST_WRAPPER_CAMERA_BIN_SRC (data);
+  GstBuffer *buffer = GST_BUFFER (info->data);
+  GstBufferPoolAcquireParams params = { 0, };
+  GstBuffer *copy = NULL;
+  GstEvent *event = NULL;
+  const GstSegment *segment = NULL;
+  GstCaps *caps = NULL;
+  GstMapInfo map;
+
+  g_mutex_lock (&self->zsl_lock);
+  if (self->zsl_frames == 0)
+    goto done;
+
+  event = gst_pad_get_sticky_event (pad, GST_EVENT_SEGMENT, 0);
+  if (event)
+    gst_event_parse_segment (event, &segment);
+  caps = gst_pad_get_current_caps (pad);
+  if (!segment || segment->format != GST_FORMAT_TIME || !caps
+      || !GST_BUFFER_PTS_IS_VALID (buffer))
+    goto done;
+
+  /* recycle the oldest frame once the ring is full */
+  gst_wrapper_camera_bin_src_zsl_trim (self, self->zsl_frames - 1);
+
+  if (self->zsl_pool_size != gst_buffer_get_size (buffer) &&
+      !gst_wrapper_camera_bin_src_zsl_setup_pool (self, caps,
+          gst_buffer_get_size (buffer)))
+    goto done;
+
+  /* don't hold up the viewfinder while a captured frame is being encoded */
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+  if (gst_buffer_pool_acquire_buffer (self->zsl_pool, &copy,
+          &params) != GST_FLOW_OK) {
+    GST_LOG_OBJECT (self, "No free zero shutter lag buffer, skipping frame");
+    goto done;
+  }
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    gst_buffer_unref (copy);
+    goto done;
+  }
+  gst_buffer_fill (copy, 0, map.data, map.size);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_copy_into (copy, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+
+  g_queue_push_tail (&self->zsl_ring, gst_sample_new (copy, caps, segment,
+          NULL));
+  gst_buffer_unref (copy);
+
+done:
+  g_mutex_unlock (&self->zsl_lock);
+  if (caps)
+    gst_caps_unref (caps);
+  if (event)
+    gst_event_unref (event);
+
+  return GST_PAD_PROBE_OK;
+}
+
 /**
  * gst_wrapper_camera_bin_src_vidsrc_probe:
  *
@@ -615,6 +764,8 @@ gst_wrapper_camera_bin_src_construct_pipeline (GstBaseCameraSrc * bcamsrc)
         gst_wrapper_camera_bin_src_imgsrc_probe, self, NULL);
     gst_pad_add_probe (self->video_tee_sink, GST_PAD_PROBE_TYPE_BUFFER,
         gst_wrapper_camera_bin_src_vidsrc_probe, self, NULL);
+    gst_pad_add_probe (self->src_pad, GST_PAD_PROBE_TYPE_BUFFER,
+        gst_wrapper_camera_bin_src_zsl_probe, self, NULL);
   }
 
   /* Do this even if pipeline is constructed */
@@ -1003,6 +1154,114 @@ set_capsfilter_caps (GstWrapperCameraBinSrc * self, GstCaps * new_caps)
   GST_INFO_OBJECT (self, "updated");
 }
 
+static void
+gst_wrapper_camera_bin_src_zsl_push (GstElement * element, gpointer user_data)
+{
+  GstWrapperCameraBinSrc *self = GST_WRAPPER_CAMERA_BIN_SRC (element);
+  GstBaseCameraSrc *camerasrc = GST_BASE_CAMERA_SRC_CAST (element);
+  GstSample *sample = user_data;
+  GstCaps *caps = gst_sample_get_caps (sample);
+  GstCaps *current_caps;
+  GstFlowReturn ret;
+
+  if (!self->zsl_stream_started) {
+    gchar *stream_id;
+
+    stream_id = gst_pad_create_stream_id (self->imgsrc, element, "zsl");
+    gst_pad_push_event (self->imgsrc, gst_event_new_stream_start (stream_id));
+    g_free (stream_id);
+    self->zsl_stream_started = TRUE;
+  }
+
+  current_caps = gst_pad_get_current_caps (self->imgsrc);
+  if (!current_caps || !gst_caps_is_equal (current_caps, caps))
+    gst_pad_push_event (self->imgsrc, gst_event_new_caps (caps));
+  if (current_caps)
+    gst_caps_unref (current_caps);
+
+  gst_pad_push_event (self->imgsrc,
+      gst_event_new_segment (gst_sample_get_segment (sample)));
+
+  ret = gst_pad_push (self->imgsrc,
+      gst_buffer_ref (gst_sample_get_buffer (sample)));
+  if (ret != GST_FLOW_OK) {
+    GST_WARNING_OBJECT (self, "Failed to push captured frame: %s",
+        gst_flow_get_name (ret));
+
+    /* the image probe didn't finish the capture */
+    g_mutex_lock (&camerasrc->capturing_mutex);
+    if (self->zsl_capture) {
+      self->zsl_capture = FALSE;
+      self->image_capture_count = 0;
+      gst_base_camera_src_finish_capture (camerasrc);
+    }
+    g_mutex_unlock (&camerasrc->capturing_mutex);
+  }
+}
+
+/* Called with the capturing_mutex. Takes the kept frame closest to now, it is
+ * pushed from another thread as the image probe takes the capturing_mutex */
+static gboolean
+gst_wrapper_camera_bin_src_zsl_capture (GstWrapperCameraBinSrc * self)
+{
+  GstClockTime now, best_diff = GST_CLOCK_TIME_NONE;
+  GstSample *best = NULL;
+  GstClock *clock;
+  GList *l;
+
+  clock = gst_element_get_clock (GST_ELEMENT_CAST (self));
+  if (!clock)
+    return FALSE;
+  now = gst_clock_get_time (clock) -
+      gst_element_get_base_time (GST_ELEMENT_CAST (self));
+  gst_object_unref (clock);
+
+  g_mutex_lock (&self->zsl_lock);
+  for (l = self->zsl_ring.head; l; l = l->next) {
+    GstSample *sample = l->data;
+    GstClockTime running_time, diff;
+
+    running_time = gst_segment_to_running_time (gst_sample_get_segment
+        (sample), GST_FORMAT_TIME,
+        GST_BUFFER_PTS (gst_sample_get_buffer (sample)));
+    if (!GST_CLOCK_TIME_IS_VALID (running_time))
+      continue;
+
+    diff = running_time > now ? running_time - now : now - running_time;
+    if (!best || diff < best_diff) {
+      best = sample;
+      best_diff = diff;
+    }
+  }
+  if (best)
+    gst_sample_ref (best);
+  g_mutex_unlock (&self->zsl_lock);
+
+  if (!best) {
+    GST_DEBUG_OBJECT (self, "No frames kept, capturing the next one");
+    return FALSE;
+  }
+
+  if (!gst_pad_peer_query_accept_caps (self->imgsrc,
+          gst_sample_get_caps (best))) {
+    GST_DEBUG_OBJECT (self, "Image capture caps differ from the viewfinder "
+        "caps, capturing the next frame");
+    gst_sample_unref (best);
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (self, "Capturing frame %" GST_TIME_FORMAT " away from "
+      "the request", GST_TIME_ARGS (best_diff));
+
+  self->image_capture_count = 1;
+  self->zsl_capture = TRUE;
+  gst_element_call_async (GST_ELEMENT_CAST (self),
+      gst_wrapper_camera_bin_src_zsl_push, best,
+      (GDestroyNotify) gst_sample_unref);
+
+  return TRUE;
+}
+
 static gboolean
 gst_wrapper_camera_bin_src_start_capture (GstBaseCameraSrc * camerasrc)
 {
@@ -1010,6 +1269,10 @@ gst_wrapper_camera_bin_src_start_capture (GstBaseCameraSrc * camerasrc)
   GstPad *pad;
   gboolean ret = TRUE;
 
+  if (src->mode == MODE_IMAGE && src->zsl_frames > 0 &&
+      gst_wrapper_camera_bin_src_zsl_capture (src))
+    return TRUE;
+
   pad = gst_element_get_static_pad (src->src_vid_src, "src");
 
   /* TODO should we access this directly? Maybe a macro is better? */
@@ -1070,6 +1333,10 @@ gst_wrapper_camera_bin_src_change_state (GstElement * element,
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       self->video_renegotiate = TRUE;
       self->image_renegotiate = TRUE;
+      g_mutex_lock (&self->zsl_lock);
+      gst_wrapper_camera_bin_src_zsl_reset (self);
+      g_mutex_unlock (&self->zsl_lock);
+      self->zsl_stream_started = FALSE;
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
@@ -1110,6 +1377,20 @@ gst_wrapper_camera_bin_src_class_init (GstWrapperCameraBinSrcClass * klass)
           "Optional video source filter element",
           GST_TYPE_ELEMENT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstWrapperCameraBinSrc:zsl-frames:
+   *
+   * Number of viewfinder frames to keep for zero shutter lag image capture,
+   * 0 disables it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ZSL_FRAMES,
+      g_param_spec_uint ("zsl-frames", "Zero shutter lag frames",
+          "Number of viewfinder frames kept for zero shutter lag image "
+          "capture (0 = disabled)", 0, 64, DEFAULT_ZSL_FRAMES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_wrapper_camera_bin_src_change_state;
 
   gstbasecamerasrc_class->construct_pipeline =
@@ -1168,6 +1449,10 @@ gst_wrapper_camera_bin_src_init (GstWrapperCameraBinSrc * self)
   self->image_renegotiate = TRUE;
   self->mode = GST_BASE_CAMERA_SRC_CAST (self)->mode;
   self->app_vid_filter = NULL;
+
+  self->zsl_frames = DEFAULT_ZSL_FRAMES;
+  g_mutex_init (&self->zsl_lock);
+  g_queue_init (&self->zsl_ring);
 }
 
 gboolean
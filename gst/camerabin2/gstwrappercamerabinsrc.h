@@ -112,6 +112,16 @@ struct _GstWrapperCameraBinSrc
   GstCaps *image_capture_caps;
   gboolean image_renegotiate;
   gboolean video_renegotiate;
+
+  /* Zero shutter lag: the last viewfinder frames, copied into buffers of
+   * our own pool so the video source doesn't run out of buffers */
+  guint zsl_frames;
+  GMutex zsl_lock;
+  GQueue zsl_ring;              /* GstSample, oldest first */
+  GstBufferPool *zsl_pool;
+  gsize zsl_pool_size;
+  gboolean zsl_capture;         /* protected by the capturing_mutex */
+  gboolean zsl_stream_started;
 };
 
 
@@ -29,6 +29,14 @@
  *     autovideosink
  * ]| This pipeline shows the effect of coloreffects on a test stream.
  *
+ * |[
+ * gst-launch-1.0 -v videotestsrc ! video/x-raw,format=NV12 !
+ *     coloreffects lut-location=grade.cube n-threads=0 ! autovideosink
+ * ]| This pipeline applies the 3D LUT of a .cube file, directly on NV12.
+ *
+ * A 3D LUT set with #GstColorEffects:lut-location takes precedence over the
+ * preset. On YUV input the LUT is resampled into the YUV domain of the
+ * stream, so no conversion to RGB is needed.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -39,6 +47,12 @@
 #include "gstcoloreffects.h"
 
 #define DEFAULT_PROP_PRESET GST_COLOR_EFFECTS_PRESET_NONE
+#define DEFAULT_PROP_LUT_LOCATION NULL
+#define DEFAULT_PROP_LUT_INTERPOLATION GST_LUT3D_INTERPOLATION_TETRAHEDRAL
+#define DEFAULT_PROP_N_THREADS 1
+
+/* nodes per component of the LUTs resampled for YUV input */
+#define YUV_LUT_SIZE 33
 
 GST_DEBUG_CATEGORY_STATIC (coloreffects_debug);
 #define GST_CAT_DEFAULT (coloreffects_debug)
@@ -46,14 +60,18 @@ GST_DEBUG_CATEGORY_STATIC (coloreffects_debug);
 enum
 {
   PROP_0,
-  PROP_PRESET
+  PROP_PRESET,
+  PROP_LUT_LOCATION,
+  PROP_LUT_INTERPOLATION,
+  PROP_N_THREADS
 };
 
 #define gst_color_effects_parent_class parent_class
 G_DEFINE_TYPE (GstColorEffects, gst_color_effects, GST_TYPE_VIDEO_FILTER);
 
 #define CAPS_STR GST_VIDEO_CAPS_MAKE ("{ " \
-    "ARGB, BGRA, ABGR, RGBA, xRGB, BGRx, xBGR, RGBx, RGB, BGR, AYUV }")
+    "ARGB, BGRA, ABGR, RGBA, xRGB, BGRx, xBGR, RGBx, RGB, BGR, AYUV, " \
+    "I420, NV12 }")
 
 static GstStaticPadTemplate gst_color_effects_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
@@ -93,6 +111,27 @@ gst_color_effects_preset_get_type (void)
   return preset_type;
 }
 
+#define GST_TYPE_COLOR_EFFECTS_LUT_INTERPOLATION \
+  (gst_color_effects_lut_interpolation_get_type())
+static GType
+gst_color_effects_lut_interpolation_get_type (void)
+{
+  static GType interpolation_type = 0;
+
+  static const GEnumValue interpolations[] = {
+    {GST_LUT3D_INTERPOLATION_TRILINEAR, "Trilinear", "trilinear"},
+    {GST_LUT3D_INTERPOLATION_TETRAHEDRAL, "Tetrahedral", "tetrahedral"},
+    {0, NULL, NULL},
+  };
+
+  if (!interpolation_type) {
+    interpolation_type =
+        g_enum_register_static ("GstColorEffectsLutInterpolation",
+        interpolations);
+  }
+  return interpolation_type;
+}
+
 /*
  * Currently hardcoded tables, in the future may be nice to load them
  * from a file or just leave these as default presets and add a
@@ -300,10 +339,10 @@ static const gint cog_rgb_to_ycbcr_matrix_8bit_sdtv[] = {
 
 static void
 gst_color_effects_transform_rgb (GstColorEffects * filter,
-    GstVideoFrame * frame)
+    GstVideoFrame * frame, gint first, gint last)
 {
   gint i, j;
-  gint width, height;
+  gint width;
   gint pixel_stride, row_stride, row_wrap;
   guint32 r, g, b;
   guint32 luma;
@@ -316,15 +355,24 @@ gst_color_effects_transform_rgb (GstColorEffects * filter,
   offsets[2] = GST_VIDEO_FRAME_COMP_POFFSET (frame, 2);
 
   width = GST_VIDEO_FRAME_WIDTH (frame);
-  height = GST_VIDEO_FRAME_HEIGHT (frame);
 
   row_stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
   pixel_stride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 0);
   row_wrap = row_stride - pixel_stride * width;
+  data += first * row_stride;
+
+  if (filter->lut) {
+    for (i = first; i < last; i++) {
+      gst_lut3d_apply_line (filter->lut, filter->interpolation, data,
+          pixel_stride, offsets, width);
+      data += row_stride;
+    }
+    return;
+  }
 
   /* transform */
 
-  for (i = 0; i < height; i++) {
+  for (i = first; i < last; i++) {
     for (j = 0; j < width; j++) {
       r = data[offsets[0]];
       g = data[offsets[1]];
@@ -358,10 +406,10 @@ gst_color_effects_transform_rgb (GstColorEffects * filter,
 
 static void
 gst_color_effects_transform_ayuv (GstColorEffects * filter,
-    GstVideoFrame * frame)
+    GstVideoFrame * frame, gint first, gint last)
 {
   gint i, j;
-  gint width, height;
+  gint width;
   gint pixel_stride, row_stride, row_wrap;
   gint r, g, b;
   gint y, u, v;
@@ -374,13 +422,22 @@ gst_color_effects_transform_ayuv (GstColorEffects * filter,
   offsets[2] = GST_VIDEO_FRAME_COMP_POFFSET (frame, 2);
 
   width = GST_VIDEO_FRAME_WIDTH (frame);
-  height = GST_VIDEO_FRAME_HEIGHT (frame);
 
   row_stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
   pixel_stride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 0);
   row_wrap = row_stride - pixel_stride * width;
+  data += first * row_stride;
 
-  for (i = 0; i < height; i++) {
+  if (filter->lut) {
+    for (i = first; i < last; i++) {
+      gst_lut3d_apply_line (filter->yuv_lut, filter->interpolation, data,
+          pixel_stride, offsets, width);
+      data += row_stride;
+    }
+    return;
+  }
+
+  for (i = first; i < last; i++) {
     for (j = 0; j < width; j++) {
       y = data[offsets[0]];
       u = data[offsets[1]];
@@ -432,6 +489,194 @@ gst_color_effects_transform_ayuv (GstColorEffects * filter,
   }
 }
 
+/* 4:2:0 formats: each row of the chroma planes covers two rows of luma.
+ * The pixels sharing a chroma sample are looked up with it and get the
+ * average of their new chroma. */
+static void
+gst_color_effects_transform_420 (GstColorEffects * filter,
+    GstVideoFrame * frame, gint first, gint last)
+{
+  const GstLut3D *lut = filter->yuv_lut;
+  gint i, j, k;
+  gint width, height, chroma_width;
+  gint y_stride, u_stride, v_stride, u_pstride, v_pstride;
+  guint8 *y_data, *u_data, *v_data;
+
+  width = GST_VIDEO_FRAME_WIDTH (frame);
+  height = GST_VIDEO_FRAME_HEIGHT (frame);
+  chroma_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1);
+
+  y_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
+  u_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 1);
+  v_stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 2);
+  u_pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 1);
+  v_pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 2);
+
+  for (i = first; i < last; i++) {
+    guint8 *rows[2];
+    gint n_rows = MIN (height - 2 * i, 2);
+
+    y_data = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
+    rows[0] = y_data + 2 * i * y_stride;
+    rows[1] = rows[0] + y_stride;
+    u_data = (guint8 *) GST_VIDEO_FRAME_COMP_DATA (frame, 1) + i * u_stride;
+    v_data = (guint8 *) GST_VIDEO_FRAME_COMP_DATA (frame, 2) + i * v_stride;
+
+    for (j = 0; j < chroma_width; j++) {
+      guint u = u_data[j * u_pstride];
+      guint v = v_data[j * v_pstride];
+      guint u_sum = 0, v_sum = 0, n = 0;
+      gint x, x_end = MIN (2 * j + 2, width);
+      guint8 out[3];
+
+      for (k = 0; k < n_rows; k++) {
+        for (x = 2 * j; x < x_end; x++) {
+          gst_lut3d_lookup (lut, filter->interpolation, rows[k][x], u, v,
+              out);
+          rows[k][x] = out[0];
+          u_sum += out[1];
+          v_sum += out[2];
+          n++;
+        }
+      }
+      u_data[j * u_pstride] = (u_sum + n / 2) / n;
+      v_data[j * v_pstride] = (v_sum + n / 2) / n;
+    }
+  }
+}
+
+static gfloat
+gst_color_effects_sample_table (const guint8 * table, gint c, gfloat v)
+{
+  gfloat x = CLAMP (v, 0.0, 1.0) * 254.999;
+  gint i = (gint) x;
+  gfloat f = x - i;
+
+  return (table[i * 3 + c] * (1.0 - f) + table[(i + 1) * 3 + c] * f) / 255.0;
+}
+
+typedef struct
+{
+  GstColorEffects *filter;
+  gdouble Kr, Kb;
+  gboolean full_range;
+} GstColorEffectsYuvLutData;
+
+/* Y'CbCr code values to Y'CbCr, through the LUT or preset and back */
+static void
+gst_color_effects_yuv_lut_func (const gfloat in[3], gfloat out[3],
+    gpointer user_data)
+{
+  GstColorEffectsYuvLutData *d = user_data;
+  GstColorEffects *filter = d->filter;
+  gdouble Kr = d->Kr, Kb = d->Kb, Kg = 1.0 - Kr - Kb;
+  gdouble y, cb, cr;
+  gfloat rgb[3], res[3];
+  gint k;
+
+  if (d->full_range) {
+    y = in[0];
+    cb = in[1] - 128.0 / 255.0;
+    cr = in[2] - 128.0 / 255.0;
+  } else {
+    y = (in[0] * 255.0 - 16.0) / 219.0;
+    cb = (in[1] * 255.0 - 128.0) / 224.0;
+    cr = (in[2] * 255.0 - 128.0) / 224.0;
+  }
+
+  rgb[0] = y + 2.0 * (1.0 - Kr) * cr;
+  rgb[2] = y + 2.0 * (1.0 - Kb) * cb;
+  rgb[1] = (y - Kr * rgb[0] - Kb * rgb[2]) / Kg;
+  for (k = 0; k < 3; k++)
+    rgb[k] = CLAMP (rgb[k], 0.0, 1.0);
+
+  if (filter->lut) {
+    gst_lut3d_eval (filter->lut, filter->interpolation, rgb, res);
+  } else if (filter->map_luma) {
+    gfloat luma = 0.2126 * rgb[0] + 0.7152 * rgb[1] + 0.0722 * rgb[2];
+
+    for (k = 0; k < 3; k++)
+      res[k] = gst_color_effects_sample_table (filter->table, k, luma);
+  } else {
+    for (k = 0; k < 3; k++)
+      res[k] = gst_color_effects_sample_table (filter->table, k, rgb[k]);
+  }
+
+  y = Kr * res[0] + Kg * res[1] + Kb * res[2];
+  cb = (res[2] - y) / (2.0 * (1.0 - Kb));
+  cr = (res[0] - y) / (2.0 * (1.0 - Kr));
+
+  if (d->full_range) {
+    out[0] = y;
+    out[1] = cb + 128.0 / 255.0;
+    out[2] = cr + 128.0 / 255.0;
+  } else {
+    out[0] = (y * 219.0 + 16.0) / 255.0;
+    out[1] = (cb * 224.0 + 128.0) / 255.0;
+    out[2] = (cr * 224.0 + 128.0) / 255.0;
+  }
+}
+
+/* called with the object lock */
+static void
+gst_color_effects_update_yuv_lut (GstColorEffects * filter)
+{
+  GstColorEffectsYuvLutData data;
+
+  if (!filter->yuv_lut_dirty)
+    return;
+
+  if (filter->yuv_lut) {
+    gst_lut3d_free (filter->yuv_lut);
+    filter->yuv_lut = NULL;
+  }
+  filter->yuv_lut_dirty = FALSE;
+
+  if (!filter->lut && !filter->table)
+    return;
+
+  data.filter = filter;
+  data.full_range =
+      filter->info.colorimetry.range == GST_VIDEO_COLOR_RANGE_0_255;
+  if (!gst_video_color_matrix_get_Kr_Kb (filter->info.colorimetry.matrix,
+          &data.Kr, &data.Kb)) {
+    data.Kr = 0.299;
+    data.Kb = 0.114;
+  }
+
+  filter->yuv_lut = gst_lut3d_new_from_func (YUV_LUT_SIZE,
+      gst_color_effects_yuv_lut_func, &data);
+}
+
+typedef struct
+{
+  GstColorEffects *filter;
+  GstVideoFrame *frame;
+} GstColorEffectsFrame;
+
+static void
+gst_color_effects_process_stripe (gpointer user_data, guint stripe,
+    gint first, gint last)
+{
+  GstColorEffectsFrame *cf = user_data;
+
+  cf->filter->process (cf->filter, cf->frame, first, last);
+}
+
+/* called with the object lock */
+static void
+gst_color_effects_process_frame (GstColorEffects * filter,
+    GstVideoFrame * frame)
+{
+  GstColorEffectsFrame cf;
+
+  cf.filter = filter;
+  cf.frame = frame;
+  gst_stripe_threads_run (&filter->threads,
+      GST_VIDEO_FRAME_COMP_HEIGHT (frame, 1), 16,
+      gst_color_effects_process_stripe, &cf);
+}
+
 static gboolean
 gst_color_effects_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
     GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
@@ -449,7 +694,14 @@ gst_color_effects_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
 
   GST_OBJECT_LOCK (filter);
 
+  filter->info = *in_info;
+  filter->yuv_lut_dirty = TRUE;
+
   switch (filter->format) {
+    case GST_VIDEO_FORMAT_I420:
+    case GST_VIDEO_FORMAT_NV12:
+      filter->process = gst_color_effects_transform_420;
+      break;
     case GST_VIDEO_FORMAT_AYUV:
       filter->process = gst_color_effects_transform_ayuv;
       break;
@@ -483,12 +735,17 @@ gst_color_effects_transform_frame_ip (GstVideoFilter * vfilter,
   if (!filter->process)
     goto not_negotiated;
 
+  GST_OBJECT_LOCK (filter);
   /* do nothing if there is no table ("none" preset) */
-  if (filter->table == NULL)
+  if (filter->table == NULL && filter->lut == NULL) {
+    GST_OBJECT_UNLOCK (filter);
     return GST_FLOW_OK;
+  }
 
-  GST_OBJECT_LOCK (filter);
-  filter->process (filter, out);
+  if (GST_VIDEO_INFO_IS_YUV (&filter->info))
+    gst_color_effects_update_yuv_lut (filter);
+
+  gst_color_effects_process_frame (filter, out);
   GST_OBJECT_UNLOCK (filter);
 
   return GST_FLOW_OK;
@@ -537,6 +794,42 @@ gst_color_effects_set_property (GObject * object, guint prop_id,
           g_assert_not_reached ();
 
       }
+      filter->yuv_lut_dirty = TRUE;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LUT_LOCATION:{
+      const gchar *location = g_value_get_string (value);
+      GstLut3D *lut = NULL;
+      GError *err = NULL;
+
+      if (location) {
+        lut = gst_lut3d_new_from_cube_file (location, &err);
+        if (!lut) {
+          GST_ELEMENT_WARNING (filter, RESOURCE, SETTINGS,
+              ("Could not load 3D LUT"), ("%s", err->message));
+          g_clear_error (&err);
+        }
+      }
+
+      GST_OBJECT_LOCK (filter);
+      g_free (filter->lut_location);
+      filter->lut_location = g_strdup (location);
+      if (filter->lut)
+        gst_lut3d_free (filter->lut);
+      filter->lut = lut;
+      filter->yuv_lut_dirty = TRUE;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    }
+    case PROP_LUT_INTERPOLATION:
+      GST_OBJECT_LOCK (filter);
+      filter->interpolation = g_value_get_enum (value);
+      filter->yuv_lut_dirty = TRUE;
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (filter);
+      filter->threads.n_threads = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (filter);
       break;
     default:
@@ -557,12 +850,43 @@ gst_color_effects_get_property (GObject * object, guint prop_id, GValue * value,
       g_value_set_enum (value, filter->preset);
       GST_OBJECT_UNLOCK (filter);
       break;
+    case PROP_LUT_LOCATION:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_string (value, filter->lut_location);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_LUT_INTERPOLATION:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_enum (value, filter->interpolation);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (filter);
+      g_value_set_uint (value, filter->threads.n_threads);
+      GST_OBJECT_UNLOCK (filter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_color_effects_finalize (GObject * object)
+{
+  GstColorEffects *filter = GST_COLOR_EFFECTS (object);
+
+  gst_stripe_threads_clear (&filter->threads);
+
+  if (filter->lut)
+    gst_lut3d_free (filter->lut);
+  if (filter->yuv_lut)
+    gst_lut3d_free (filter->yuv_lut);
+  g_free (filter->lut_location);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_color_effects_class_init (GstColorEffectsClass * klass)
 {
@@ -575,11 +899,28 @@ gst_color_effects_class_init (GstColorEffectsClass * klass)
 
   gobject_class->set_property = gst_color_effects_set_property;
   gobject_class->get_property = gst_color_effects_get_property;
+  gobject_class->finalize = gst_color_effects_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PRESET,
       g_param_spec_enum ("preset", "Preset", "Color effect preset to use",
           GST_TYPE_COLOR_EFFECTS_PRESET, DEFAULT_PROP_PRESET,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_LUT_LOCATION,
+      g_param_spec_string ("lut-location", "LUT location",
+          "Location of a .cube 3D LUT file, overrides the preset",
+          DEFAULT_PROP_LUT_LOCATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_LUT_INTERPOLATION,
+      g_param_spec_enum ("lut-interpolation", "LUT interpolation",
+          "Interpolation between the nodes of the 3D LUT",
+          GST_TYPE_COLOR_EFFECTS_LUT_INTERPOLATION,
+          DEFAULT_PROP_LUT_INTERPOLATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_PROP_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   vfilter_class->set_info = GST_DEBUG_FUNCPTR (gst_color_effects_set_info);
   vfilter_class->transform_frame_ip =
@@ -602,4 +943,10 @@ gst_color_effects_init (GstColorEffects * filter)
   filter->preset = GST_COLOR_EFFECTS_PRESET_NONE;
   filter->table = NULL;
   filter->map_luma = TRUE;
+  filter->lut_location = DEFAULT_PROP_LUT_LOCATION;
+  filter->lut = NULL;
+  filter->interpolation = DEFAULT_PROP_LUT_INTERPOLATION;
+  filter->yuv_lut = NULL;
+  filter->yuv_lut_dirty = TRUE;
+  gst_stripe_threads_init (&filter->threads, DEFAULT_PROP_N_THREADS);
 }
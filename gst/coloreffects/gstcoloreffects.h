@@ -23,6 +23,9 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
+#include <gst/stripe-threads-private.h>
+
+#include "gstlut3d.h"
 
 G_BEGIN_DECLS
 #define GST_TYPE_COLOR_EFFECTS \
@@ -73,12 +76,27 @@ struct _GstColorEffects
   const guint8 *table;
   gboolean map_luma;
 
+  /* 3D LUT loaded from lut-location, overrides the preset */
+  gchar *lut_location;
+  GstLut3D *lut;
+  GstLut3DInterpolation interpolation;
+
+  /* the LUT or preset resampled for YUV input, rebuilt when dirty */
+  GstLut3D *yuv_lut;
+  gboolean yuv_lut_dirty;
+
   /* video format */
+  GstVideoInfo info;
   GstVideoFormat format;
   gint width;
   gint height;
 
-  void (*process) (GstColorEffects * filter, GstVideoFrame * frame);
+  /* the n-threads property is threads.n_threads */
+  GstStripeThreads threads;
+
+  /* processes the rows [first, last) of the chroma planes */
+  void (*process) (GstColorEffects * filter, GstVideoFrame * frame,
+      gint first, gint last);
 };
 
 struct _GstColorEffectsClass
@@ -0,0 +1,497 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * 3D lookup tables, as found in .cube files. The table is evaluated in
+ * fixed point for 8 bit pixels, either with trilinear interpolation
+ * between the 8 surrounding nodes or with tetrahedral interpolation
+ * between 4 of them. The three components of a pixel are computed at once
+ * in the lanes of a SIMD register.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstlut3d.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#define LUT3D_MAX_SIZE 256
+
+/* fixed point node values are scaled by 1 << LUT3D_SHIFT */
+#define LUT3D_SHIFT 6
+
+static void
+gst_lut3d_prepare (GstLut3D * lut)
+{
+  gint n = lut->size;
+  gint i, k;
+
+  lut->table = g_new0 (guint16, 4 * n * n * n);
+  for (i = 0; i < n * n * n; i++) {
+    for (k = 0; k < 3; k++) {
+      gfloat v = CLAMP (lut->data[3 * i + k], 0.0, 1.0);
+
+      lut->table[4 * i + k] = (guint16) (v * (255 << LUT3D_SHIFT) + 0.5);
+    }
+  }
+
+  lut->steps[0] = 4;
+  lut->steps[1] = 4 * n;
+  lut->steps[2] = 4 * n * n;
+
+  for (k = 0; k < 3; k++) {
+    gfloat range = lut->domain_max[k] - lut->domain_min[k];
+
+    for (i = 0; i < 256; i++) {
+      gfloat x = (i / 255.0 - lut->domain_min[k]) / range;
+      gint pos = (gint) (CLAMP (x, 0.0, 1.0) * (n - 1) * 256 + 0.5);
+      gint node = MIN (pos >> 8, n - 2);
+
+      lut->offsets[k][i] = node * lut->steps[k];
+      lut->fracs[k][i] = pos - node * 256;
+    }
+  }
+}
+
+static GstLut3D *
+gst_lut3d_new (gint size, gfloat * data, const gfloat domain_min[3],
+    const gfloat domain_max[3])
+{
+  GstLut3D *lut = g_new0 (GstLut3D, 1);
+
+  lut->size = size;
+  lut->data = data;
+  memcpy (lut->domain_min, domain_min, sizeof (lut->domain_min));
+  memcpy (lut->domain_max, domain_max, sizeof (lut->domain_max));
+  gst_lut3d_prepare (lut);
+
+  return lut;
+}
+
+static gboolean
+gst_lut3d_parse_floats (gchar * str, gfloat * values, gint n)
+{
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    gchar *end;
+
+    values[i] = g_ascii_strtod (str, &end);
+    if (end == str)
+      return FALSE;
+    str = end;
+  }
+
+  return *g_strchug (str) == '\0';
+}
+
+/* Parses the Adobe/Resolve .cube format: keywords, then one output colour
+ * per line with red changing fastest */
+GstLut3D *
+gst_lut3d_new_from_cube_file (const gchar * filename, GError ** error)
+{
+  gchar *contents = NULL;
+  gchar **lines, **l;
+  gfloat domain_min[3] = { 0.0, 0.0, 0.0 };
+  gfloat domain_max[3] = { 1.0, 1.0, 1.0 };
+  gfloat *data = NULL;
+  gint size = 0, n_values = 0, line = 0;
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return NULL;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (l = lines; *l; l++) {
+    gchar *s = g_strstrip (*l);
+
+    line++;
+    if (*s == '\0' || *s == '#' || g_str_has_prefix (s, "TITLE"))
+      continue;
+
+    if (g_str_has_prefix (s, "LUT_3D_SIZE")) {
+      size = atoi (s + strlen ("LUT_3D_SIZE"));
+      if (data || size < 2 || size > LUT3D_MAX_SIZE)
+        goto bad_line;
+      data = g_new (gfloat, 3 * size * size * size);
+    } else if (g_str_has_prefix (s, "DOMAIN_MIN")) {
+      if (!gst_lut3d_parse_floats (s + strlen ("DOMAIN_MIN"), domain_min, 3))
+        goto bad_line;
+    } else if (g_str_has_prefix (s, "DOMAIN_MAX")) {
+      if (!gst_lut3d_parse_floats (s + strlen ("DOMAIN_MAX"), domain_max, 3))
+        goto bad_line;
+    } else if (g_str_has_prefix (s, "LUT_3D_INPUT_RANGE")) {
+      gfloat range[2];
+
+      if (!gst_lut3d_parse_floats (s + strlen ("LUT_3D_INPUT_RANGE"), range,
+              2))
+        goto bad_line;
+      domain_min[0] = domain_min[1] = domain_min[2] = range[0];
+      domain_max[0] = domain_max[1] = domain_max[2] = range[1];
+    } else if (g_ascii_isalpha (*s)) {
+      /* LUT_1D_SIZE and friends */
+      goto bad_line;
+    } else {
+      if (!data || n_values == size * size * size ||
+          !gst_lut3d_parse_floats (s, data + 3 * n_values, 3))
+        goto bad_line;
+      n_values++;
+    }
+  }
+  g_strfreev (lines);
+
+  if (!data || n_values != size * size * size) {
+    g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+        "%s: expected %d entries, found %d", filename, size * size * size,
+        n_values);
+    g_free (data);
+    return NULL;
+  }
+
+  if (domain_max[0] <= domain_min[0] || domain_max[1] <= domain_min[1] ||
+      domain_max[2] <= domain_min[2]) {
+    g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+        "%s: invalid domain", filename);
+    g_free (data);
+    return NULL;
+  }
+
+  return gst_lut3d_new (size, data, domain_min, domain_max);
+
+bad_line:
+  g_set_error (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+      "%s:%d: unsupported or invalid line", filename, line);
+  g_strfreev (lines);
+  g_free (data);
+  return NULL;
+}
+
+/* Samples func on a size^3 grid over the unit cube */
+GstLut3D *
+gst_lut3d_new_from_func (gint size, GstLut3DFunc func, gpointer user_data)
+{
+  static const gfloat domain_min[3] = { 0.0, 0.0, 0.0 };
+  static const gfloat domain_max[3] = { 1.0, 1.0, 1.0 };
+  gfloat *data = g_new (gfloat, 3 * size * size * size);
+  gfloat *d = data;
+  gint i, j, k;
+
+  for (k = 0; k < size; k++) {
+    for (j = 0; j < size; j++) {
+      for (i = 0; i < size; i++) {
+        gfloat in[3];
+
+        in[0] = (gfloat) i / (size - 1);
+        in[1] = (gfloat) j / (size - 1);
+        in[2] = (gfloat) k / (size - 1);
+        func (in, d, user_data);
+        d += 3;
+      }
+    }
+  }
+
+  return gst_lut3d_new (size, data, domain_min, domain_max);
+}
+
+void
+gst_lut3d_free (GstLut3D * lut)
+{
+  g_free (lut->data);
+  g_free (lut->table);
+  g_free (lut);
+}
+
+/* Evaluates the table in floating point, used to derive other tables */
+void
+gst_lut3d_eval (const GstLut3D * lut, GstLut3DInterpolation method,
+    const gfloat in[3], gfloat out[3])
+{
+  gint n = lut->size;
+  gint node[3], step[3];
+  gfloat f[3];
+  const gfloat *c0;
+  gint k;
+
+  step[0] = 3;
+  step[1] = 3 * n;
+  step[2] = 3 * n * n;
+  for (k = 0; k < 3; k++) {
+    gfloat x = (in[k] - lut->domain_min[k]) /
+        (lut->domain_max[k] - lut->domain_min[k]);
+
+    x = CLAMP (x, 0.0, 1.0) * (n - 1);
+    node[k] = MIN ((gint) x, n - 2);
+    f[k] = x - node[k];
+  }
+  c0 = lut->data + node[0] * step[0] + node[1] * step[1] + node[2] * step[2];
+
+  if (method == GST_LUT3D_INTERPOLATION_TETRAHEDRAL) {
+    gint a, b, c;
+    const gfloat *c1, *c2, *c3;
+
+    /* order the components by decreasing fraction */
+    a = 0;
+    b = 1;
+    c = 2;
+    if (f[b] > f[a]) {
+      gint t = a;
+      a = b;
+      b = t;
+    }
+    if (f[c] > f[b]) {
+      gint t = b;
+      b = c;
+      c = t;
+    }
+    if (f[b] > f[a]) {
+      gint t = a;
+      a = b;
+      b = t;
+    }
+    c1 = c0 + step[a];
+    c2 = c1 + step[b];
+    c3 = c2 + step[c];
+    for (k = 0; k < 3; k++) {
+      out[k] = (1.0 - f[a]) * c0[k] + (f[a] - f[b]) * c1[k] +
+          (f[b] - f[c]) * c2[k] + f[c] * c3[k];
+    }
+  } else {
+    for (k = 0; k < 3; k++) {
+      gfloat v[4];
+      gint i;
+
+      for (i = 0; i < 4; i++) {
+        const gfloat *p = c0 + (i & 1) * step[1] + (i >> 1) * step[2];
+
+        v[i] = p[k] + f[0] * (p[step[0] + k] - p[k]);
+      }
+      v[0] += f[1] * (v[1] - v[0]);
+      v[2] += f[1] * (v[3] - v[2]);
+      out[k] = v[0] + f[2] * (v[2] - v[0]);
+    }
+  }
+}
+
+/* The fixed point versions below all round the same way, so that the
+ * vector code gives the same result as the scalar one. Trilinear
+ * interpolation goes through 16 bit intermediates, tetrahedral uses
+ * weights that sum to 256. */
+#if defined (__SSE2__)
+static inline __m128i
+lut3d_load (const guint16 * p)
+{
+  return _mm_loadl_epi64 ((const __m128i *) p);
+}
+
+/* a * (256 - f) + b * f in 32 bit lanes */
+static inline __m128i
+lut3d_lerp (__m128i a, __m128i b, gint f)
+{
+  return _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b),
+      _mm_set1_epi32 ((f << 16) | (256 - f)));
+}
+
+static inline __m128i
+lut3d_lerp_round (__m128i a, __m128i b, gint f)
+{
+  __m128i v = _mm_srai_epi32 (_mm_add_epi32 (lut3d_lerp (a, b, f),
+          _mm_set1_epi32 (128)), 8);
+
+  return _mm_packs_epi32 (v, v);
+}
+
+static inline void
+lut3d_store (__m128i v, guint8 out[3])
+{
+  guint32 rgb;
+
+  v = _mm_packus_epi16 (v, v);
+  rgb = _mm_cvtsi128_si32 (v);
+  out[0] = rgb & 0xff;
+  out[1] = (rgb >> 8) & 0xff;
+  out[2] = (rgb >> 16) & 0xff;
+}
+#endif
+
+static inline void
+lut3d_tetrahedral (const GstLut3D * lut, const guint16 * c0, gint fa,
+    gint fb, gint fc, guint32 sa, guint32 sb, guint32 sc, guint8 out[3])
+{
+  const guint16 *c1 = c0 + sa;
+  const guint16 *c2 = c1 + sb;
+  const guint16 *c3 = c2 + sc;
+#if defined (__SSE2__)
+  __m128i v;
+
+  v = _mm_add_epi32 (_mm_madd_epi16 (_mm_unpacklo_epi16 (lut3d_load (c0),
+              lut3d_load (c1)), _mm_set1_epi32 (((fa - fb) << 16) | (256 -
+                  fa))), _mm_madd_epi16 (_mm_unpacklo_epi16 (lut3d_load (c2),
+              lut3d_load (c3)), _mm_set1_epi32 ((fc << 16) | (fb - fc))));
+  v = _mm_srai_epi32 (_mm_add_epi32 (v, _mm_set1_epi32 (1 << (7 +
+                  LUT3D_SHIFT))), 8 + LUT3D_SHIFT);
+  lut3d_store (_mm_packs_epi32 (v, v), out);
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  uint32x4_t v;
+  uint16x4_t r;
+
+  v = vmull_n_u16 (vld1_u16 (c0), 256 - fa);
+  v = vmlal_n_u16 (v, vld1_u16 (c1), fa - fb);
+  v = vmlal_n_u16 (v, vld1_u16 (c2), fb - fc);
+  v = vmlal_n_u16 (v, vld1_u16 (c3), fc);
+  r = vrshrn_n_u32 (v, 8 + LUT3D_SHIFT);
+  out[0] = vget_lane_u16 (r, 0);
+  out[1] = vget_lane_u16 (r, 1);
+  out[2] = vget_lane_u16 (r, 2);
+#else
+  gint k;
+
+  for (k = 0; k < 3; k++) {
+    guint32 v = (256 - fa) * c0[k] + (fa - fb) * c1[k] + (fb - fc) * c2[k] +
+        fc * c3[k];
+
+    out[k] = (v + (1 << (7 + LUT3D_SHIFT))) >> (8 + LUT3D_SHIFT);
+  }
+#endif
+}
+
+static inline void
+lut3d_trilinear (const GstLut3D * lut, const guint16 * c0, gint f0, gint f1,
+    gint f2, guint8 out[3])
+{
+  guint32 s0 = lut->steps[0], s1 = lut->steps[1], s2 = lut->steps[2];
+#if defined (__SSE2__)
+  __m128i v00, v10, v01, v11, v0, v1, v;
+
+  v00 = lut3d_lerp_round (lut3d_load (c0), lut3d_load (c0 + s0), f0);
+  v10 = lut3d_lerp_round (lut3d_load (c0 + s1), lut3d_load (c0 + s1 + s0),
+      f0);
+  v01 = lut3d_lerp_round (lut3d_load (c0 + s2), lut3d_load (c0 + s2 + s0),
+      f0);
+  v11 = lut3d_lerp_round (lut3d_load (c0 + s2 + s1),
+      lut3d_load (c0 + s2 + s1 + s0), f0);
+  v0 = lut3d_lerp_round (v00, v10, f1);
+  v1 = lut3d_lerp_round (v01, v11, f1);
+  v = lut3d_lerp_round (v0, v1, f2);
+  v = _mm_srai_epi16 (_mm_add_epi16 (v, _mm_set1_epi16 (1 << (LUT3D_SHIFT -
+                  1))), LUT3D_SHIFT);
+  lut3d_store (v, out);
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define LERP(a,b,f) vrshrn_n_u32 (vmlal_n_u16 (vmull_n_u16 ((a), 256 - (f)), \
+      (b), (f)), 8)
+  uint16x4_t v00, v10, v01, v11, v0, v1, v;
+
+  v00 = LERP (vld1_u16 (c0), vld1_u16 (c0 + s0), f0);
+  v10 = LERP (vld1_u16 (c0 + s1), vld1_u16 (c0 + s1 + s0), f0);
+  v01 = LERP (vld1_u16 (c0 + s2), vld1_u16 (c0 + s2 + s0), f0);
+  v11 = LERP (vld1_u16 (c0 + s2 + s1), vld1_u16 (c0 + s2 + s1 + s0), f0);
+  v0 = LERP (v00, v10, f1);
+  v1 = LERP (v01, v11, f1);
+  v = vrshr_n_u16 (LERP (v0, v1, f2), LUT3D_SHIFT);
+#undef LERP
+  out[0] = vget_lane_u16 (v, 0);
+  out[1] = vget_lane_u16 (v, 1);
+  out[2] = vget_lane_u16 (v, 2);
+#else
+#define LERP(a,b,f) (((a) * (256 - (f)) + (b) * (f) + 128) >> 8)
+  gint k;
+
+  for (k = 0; k < 3; k++) {
+    guint v00, v10, v01, v11, v;
+
+    v00 = LERP (c0[k], c0[s0 + k], f0);
+    v10 = LERP (c0[s1 + k], c0[s1 + s0 + k], f0);
+    v01 = LERP (c0[s2 + k], c0[s2 + s0 + k], f0);
+    v11 = LERP (c0[s2 + s1 + k], c0[s2 + s1 + s0 + k], f0);
+    v = LERP (LERP (v00, v10, f1), LERP (v01, v11, f1), f2);
+    out[k] = (v + (1 << (LUT3D_SHIFT - 1))) >> LUT3D_SHIFT;
+  }
+#undef LERP
+#endif
+}
+
+static inline void
+lut3d_lookup (const GstLut3D * lut, GstLut3DInterpolation method, guint c0,
+    guint c1, guint c2, guint8 out[3])
+{
+  const guint16 *node = lut->table + lut->offsets[0][c0] +
+      lut->offsets[1][c1] + lut->offsets[2][c2];
+  gint f0 = lut->fracs[0][c0];
+  gint f1 = lut->fracs[1][c1];
+  gint f2 = lut->fracs[2][c2];
+  guint32 s0 = lut->steps[0], s1 = lut->steps[1], s2 = lut->steps[2];
+
+  if (method == GST_LUT3D_INTERPOLATION_TRILINEAR) {
+    lut3d_trilinear (lut, node, f0, f1, f2, out);
+    return;
+  }
+
+  /* walk from the lower node to the upper one along the components in
+   * order of decreasing fraction */
+  if (f0 > f1) {
+    if (f1 > f2)
+      lut3d_tetrahedral (lut, node, f0, f1, f2, s0, s1, s2, out);
+    else if (f0 > f2)
+      lut3d_tetrahedral (lut, node, f0, f2, f1, s0, s2, s1, out);
+    else
+      lut3d_tetrahedral (lut, node, f2, f0, f1, s2, s0, s1, out);
+  } else {
+    if (f2 > f1)
+      lut3d_tetrahedral (lut, node, f2, f1, f0, s2, s1, s0, out);
+    else if (f2 > f0)
+      lut3d_tetrahedral (lut, node, f1, f2, f0, s1, s2, s0, out);
+    else
+      lut3d_tetrahedral (lut, node, f1, f0, f2, s1, s0, s2, out);
+  }
+}
+
+void
+gst_lut3d_lookup (const GstLut3D * lut, GstLut3DInterpolation method,
+    guint c0, guint c1, guint c2, guint8 out[3])
+{
+  lut3d_lookup (lut, method, c0, c1, c2, out);
+}
+
+/* Maps width pixels in place, offsets are those of the components in the
+ * order of the table */
+void
+gst_lut3d_apply_line (const GstLut3D * lut, GstLut3DInterpolation method,
+    guint8 * data, gint pixel_stride, const gint offsets[3], gint width)
+{
+  gint i;
+
+  for (i = 0; i < width; i++) {
+    guint8 out[3];
+
+    lut3d_lookup (lut, method, data[offsets[0]], data[offsets[1]],
+        data[offsets[2]], out);
+    data[offsets[0]] = out[0];
+    data[offsets[1]] = out[1];
+    data[offsets[2]] = out[2];
+    data += pixel_stride;
+  }
+}
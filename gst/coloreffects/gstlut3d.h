@@ -0,0 +1,71 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_LUT3D_H__
+#define __GST_LUT3D_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GST_LUT3D_INTERPOLATION_TRILINEAR,
+  GST_LUT3D_INTERPOLATION_TETRAHEDRAL
+} GstLut3DInterpolation;
+
+typedef struct _GstLut3D GstLut3D;
+
+/* Maps one colour to another, all components normalised to [0, 1] */
+typedef void (*GstLut3DFunc) (const gfloat in[3], gfloat out[3],
+    gpointer user_data);
+
+struct _GstLut3D
+{
+  gint size;
+  /* size^3 output colours, the first component changing fastest */
+  gfloat *data;
+  gfloat domain_min[3];
+  gfloat domain_max[3];
+
+  /* the same colours in fixed point, 4 samples per node scaled by 64 */
+  guint16 *table;
+  /* table offset of the node below each 8 bit input value, per component,
+   * and position between that node and the next one in 1/256 */
+  guint32 offsets[3][256];
+  guint16 fracs[3][256];
+  guint32 steps[3];
+};
+
+GstLut3D *gst_lut3d_new_from_cube_file (const gchar * filename,
+    GError ** error);
+GstLut3D *gst_lut3d_new_from_func (gint size, GstLut3DFunc func,
+    gpointer user_data);
+void gst_lut3d_free (GstLut3D * lut);
+
+void gst_lut3d_eval (const GstLut3D * lut, GstLut3DInterpolation method,
+    const gfloat in[3], gfloat out[3]);
+void gst_lut3d_lookup (const GstLut3D * lut, GstLut3DInterpolation method,
+    guint c0, guint c1, guint c2, guint8 out[3]);
+void gst_lut3d_apply_line (const GstLut3D * lut,
+    GstLut3DInterpolation method, guint8 * data, gint pixel_stride,
+    const gint offsets[3], gint width);
+
+G_END_DECLS
+
+#endif /* __GST_LUT3D_H__ */
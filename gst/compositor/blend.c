@@ -27,6 +27,7 @@
 #endif
 
 #include "blend.h"
+#include "blendsimd.h"
 #include "compositororc.h"
 
 #include <string.h>
@@ -38,6 +39,27 @@ GST_DEBUG_CATEGORY_STATIC (gst_compositor_blend_debug);
 
 /* Below are the implementations of everything */
 
+/* The ORC blend programs, replaced by hand-written kernels in
+ * gst_compositor_init_blend() when the CPU has some */
+static BlendLoopFunction blend_u8_loop = compositor_orc_blend_u8;
+static BlendLoopFunction blend_argb_loop = compositor_orc_blend_argb;
+static BlendLoopFunction blend_bgra_loop = compositor_orc_blend_bgra;
+
+/* The lines of the checker pattern only depend on (line & 8), so only lines
+ * 0 and 8 are drawn and the other ones are copied from them. This leaves
+ * the copies to the vectorised memcpy of the C library instead of looping
+ * over the pixels */
+static inline void
+_copy_checker_lines (guint8 * data, gint stride, gint row_size, gint height)
+{
+  gint i;
+
+  for (i = 1; i < height; i++) {
+    if (i != 8)
+      memcpy (data + i * stride, data + (i & 0x8) * stride, row_size);
+  }
+}
+
 /* A32 is for AYUV, ARGB and BGRA */
 #define BLEND_A32(name, method, LOOP)		\
 static void \
@@ -118,7 +140,7 @@ _blend_loop_##name (guint8 * dest, const guint8 * src, gint src_height, \
     GstCompositorBlendMode mode) \
 { \
   s_alpha = MIN (255, s_alpha); \
-  compositor_orc_blend_##name (dest, dest_stride, src, src_stride, \
+  blend_##name##_loop (dest, dest_stride, src, src_stride, \
     s_alpha, src_width, src_height); \
 }
 
@@ -146,35 +168,27 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
   gint i, j; \
   gint val; \
   static const gint tab[] = { 80, 160, 80, 160 }; \
-  gint width, height; \
+  gint width, height, stride; \
   guint8 *dest; \
   \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
   height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
-  if (!RGB) { \
-    for (i = 0; i < height; i++) { \
-      for (j = 0; j < width; j++) { \
-        dest[A] = 0xff; \
-        dest[C1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-        dest[C2] = 128; \
-        dest[C3] = 128; \
-        dest += 4; \
-      } \
-    } \
-  } else { \
-    for (i = 0; i < height; i++) { \
-      for (j = 0; j < width; j++) { \
-        val = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-        dest[A] = 0xFF; \
-        dest[C1] = val; \
-        dest[C2] = val; \
-        dest[C3] = val; \
-        dest += 4; \
-      } \
+  for (i = 0; i < MIN (height, 9); i += 8) { \
+    guint8 *line = dest + i * stride; \
+    \
+    for (j = 0; j < width; j++) { \
+      val = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
+      line[A] = 0xff; \
+      line[C1] = val; \
+      line[C2] = RGB ? val : 128; \
+      line[C3] = RGB ? val : 128; \
+      line += 4; \
     } \
   } \
+  _copy_checker_lines (dest, stride, width * 4, height); \
 }
 
 A32_CHECKER_C (argb, TRUE, 0, 1, 2, 3);
@@ -191,12 +205,13 @@ fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
 { \
   gint c1, c2, c3; \
   guint32 val; \
-  gint width, height; \
+  gint i, width, height, stride; \
   guint8 *dest; \
   \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
   height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
   if (RGB) { \
     c1 = YUV_TO_R (Y, U, V); \
@@ -209,7 +224,10 @@ fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
   } \
   val = GUINT32_FROM_BE ((0xff << A) | (c1 << C1) | (c2 << C2) | (c3 << C3)); \
   \
-  compositor_orc_splat_u32 ((guint32 *) dest, val, height * width); \
+  for (i = 0; i < height; i++) { \
+    compositor_orc_splat_u32 ((guint32 *) dest, val, width); \
+    dest += stride; \
+  } \
 }
 
 A32_COLOR (argb, TRUE, 24, 16, 8, 0);
@@ -374,12 +392,13 @@ fill_checker_##format_name (GstVideoFrame * frame) \
   comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
-  for (i = 0; i < comp_height; i++) { \
-    for (j = 0; j < comp_width; j++) { \
-      *p++ = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
+  for (i = 0; i < MIN (comp_height, 9); i += 8) { \
+    for (j = 0; j < comp_width; j += 8) { \
+      MEMSET (p + i * rowstride + j, tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)], \
+          MIN (8, comp_width - j)); \
     } \
-    p += rowstride - comp_width; \
   } \
+  _copy_checker_lines (p, rowstride, comp_width, comp_height); \
   \
   p = GST_VIDEO_FRAME_COMP_DATA (frame, 1); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); \
@@ -446,20 +465,20 @@ fill_color_##format_name (GstVideoFrame * frame, \
 #define GST_ROUND_UP_1(x) (x)
 
 PLANAR_YUV_BLEND (i420, GST_VIDEO_FORMAT_I420, GST_ROUND_UP_2,
-    GST_ROUND_UP_2, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_2, memcpy, blend_u8_loop);
 PLANAR_YUV_FILL_CHECKER (i420, GST_VIDEO_FORMAT_I420, memset);
 PLANAR_YUV_FILL_COLOR (i420, GST_VIDEO_FORMAT_I420, memset);
 PLANAR_YUV_FILL_COLOR (yv12, GST_VIDEO_FORMAT_YV12, memset);
 PLANAR_YUV_BLEND (y444, GST_VIDEO_FORMAT_Y444, GST_ROUND_UP_1,
-    GST_ROUND_UP_1, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_1, memcpy, blend_u8_loop);
 PLANAR_YUV_FILL_CHECKER (y444, GST_VIDEO_FORMAT_Y444, memset);
 PLANAR_YUV_FILL_COLOR (y444, GST_VIDEO_FORMAT_Y444, memset);
 PLANAR_YUV_BLEND (y42b, GST_VIDEO_FORMAT_Y42B, GST_ROUND_UP_2,
-    GST_ROUND_UP_1, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_1, memcpy, blend_u8_loop);
 PLANAR_YUV_FILL_CHECKER (y42b, GST_VIDEO_FORMAT_Y42B, memset);
 PLANAR_YUV_FILL_COLOR (y42b, GST_VIDEO_FORMAT_Y42B, memset);
 PLANAR_YUV_BLEND (y41b, GST_VIDEO_FORMAT_Y41B, GST_ROUND_UP_4,
-    GST_ROUND_UP_1, memcpy, compositor_orc_blend_u8);
+    GST_ROUND_UP_1, memcpy, blend_u8_loop);
 PLANAR_YUV_FILL_CHECKER (y41b, GST_VIDEO_FORMAT_Y41B, memset);
 PLANAR_YUV_FILL_COLOR (y41b, GST_VIDEO_FORMAT_Y41B, memset);
 
@@ -603,12 +622,13 @@ fill_checker_##format_name (GstVideoFrame * frame) \
   comp_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
   rowstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   \
-  for (i = 0; i < comp_height; i++) { \
-    for (j = 0; j < comp_width; j++) { \
-      *p++ = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
+  for (i = 0; i < MIN (comp_height, 9); i += 8) { \
+    for (j = 0; j < comp_width; j += 8) { \
+      MEMSET (p + i * rowstride + j, tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)], \
+          MIN (8, comp_width - j)); \
     } \
-    p += rowstride - comp_width; \
   } \
+  _copy_checker_lines (p, rowstride, comp_width, comp_height); \
   \
   p = GST_VIDEO_FRAME_PLANE_DATA (frame, 1); \
   comp_width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 1); \
@@ -657,10 +677,10 @@ fill_color_##format_name (GstVideoFrame * frame, \
   } \
 }
 
-NV_YUV_BLEND (nv12, memcpy, compositor_orc_blend_u8);
+NV_YUV_BLEND (nv12, memcpy, blend_u8_loop);
 NV_YUV_FILL_CHECKER (nv12, memset);
 NV_YUV_FILL_COLOR (nv12, memset);
-NV_YUV_BLEND (nv21, memcpy, compositor_orc_blend_u8);
+NV_YUV_BLEND (nv21, memcpy, blend_u8_loop);
 NV_YUV_FILL_CHECKER (nv21, memset);
 
 /* RGB, BGR, xRGB, xBGR, RGBx, BGRx */
@@ -737,24 +757,25 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
-  gint stride, dest_add, width, height; \
+  gint stride, width, height; \
   guint8 *dest; \
   \
   width = GST_VIDEO_FRAME_WIDTH (frame); \
   height = GST_VIDEO_FRAME_HEIGHT (frame); \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
-  dest_add = stride - width * bpp; \
   \
-  for (i = 0; i < height; i++) { \
+  for (i = 0; i < MIN (height, 9); i += 8) { \
+    guint8 *line = dest + i * stride; \
+    \
     for (j = 0; j < width; j++) { \
-      dest[r] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* red */ \
-      dest[g] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* green */ \
-      dest[b] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* blue */ \
-      dest += bpp; \
+      line[r] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* red */ \
+      line[g] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* green */ \
+      line[b] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)];       /* blue */ \
+      line += bpp; \
     } \
-    dest += dest_add; \
   } \
+  _copy_checker_lines (dest, stride, width * bpp, height); \
 }
 
 #define RGB_FILL_COLOR(name, bpp, MEMSET_RGB) \
@@ -807,7 +828,7 @@ _memset_##name (guint8* dest, gint red, gint green, gint blue, gint width) { \
 
 #define _orc_memcpy_u32(dest,src,len) compositor_orc_memcpy_u32((guint32 *) dest, (const guint32 *) src, len/4)
 
-RGB_BLEND (rgb, 3, memcpy, compositor_orc_blend_u8);
+RGB_BLEND (rgb, 3, memcpy, blend_u8_loop);
 RGB_FILL_CHECKER_C (rgb, 3, 0, 1, 2);
 MEMSET_RGB_C (rgb, 0, 1, 2);
 RGB_FILL_COLOR (rgb_c, 3, _memset_rgb_c);
@@ -815,7 +836,7 @@ RGB_FILL_COLOR (rgb_c, 3, _memset_rgb_c);
 MEMSET_RGB_C (bgr, 2, 1, 0);
 RGB_FILL_COLOR (bgr_c, 3, _memset_bgr_c);
 
-RGB_BLEND (xrgb, 4, _orc_memcpy_u32, compositor_orc_blend_u8);
+RGB_BLEND (xrgb, 4, _orc_memcpy_u32, blend_u8_loop);
 RGB_FILL_CHECKER_C (xrgb, 4, 1, 2, 3);
 MEMSET_XRGB (xrgb, 24, 16, 0);
 RGB_FILL_COLOR (xrgb, 4, _memset_xrgb);
@@ -906,7 +927,7 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
 { \
   gint i, j; \
   static const int tab[] = { 80, 160, 80, 160 }; \
-  gint dest_add; \
+  gint stride; \
   gint width, height; \
   guint8 *dest; \
   \
@@ -914,19 +935,21 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
   width = GST_ROUND_UP_2 (width); \
   height = GST_VIDEO_FRAME_HEIGHT (frame); \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
-  dest_add = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0) - width * 2; \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
   width /= 2; \
   \
-  for (i = 0; i < height; i++) { \
+  for (i = 0; i < MIN (height, 9); i += 8) { \
+    guint8 *line = dest + i * stride; \
+    \
     for (j = 0; j < width; j++) { \
-      dest[Y1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-      dest[Y2] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
-      dest[U] = 128; \
-      dest[V] = 128; \
-      dest += 4; \
+      line[Y1] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
+      line[Y2] = tab[((i & 0x8) >> 3) + ((j & 0x8) >> 3)]; \
+      line[U] = 128; \
+      line[V] = 128; \
+      line += 4; \
     } \
-    dest += dest_add; \
   } \
+  _copy_checker_lines (dest, stride, width * 4, height); \
 }
 
 #define PACKED_422_FILL_COLOR(name, Y1, U, Y2, V) \
@@ -955,7 +978,7 @@ fill_color_##name (GstVideoFrame * frame, \
   } \
 }
 
-PACKED_422_BLEND (yuy2, memcpy, compositor_orc_blend_u8);
+PACKED_422_BLEND (yuy2, memcpy, blend_u8_loop);
 PACKED_422_FILL_CHECKER_C (yuy2, 0, 1, 2, 3);
 PACKED_422_FILL_CHECKER_C (uyvy, 1, 0, 3, 2);
 PACKED_422_FILL_COLOR (yuy2, 24, 16, 8, 0);
@@ -1026,9 +1049,20 @@ FillColorFunction gst_compositor_fill_color_uyvy;
 void
 gst_compositor_init_blend (void)
 {
+  BlendKernels kernels;
+  const gchar *simd;
+
   GST_DEBUG_CATEGORY_INIT (gst_compositor_blend_debug, "compositor_blend", 0,
       "video compositor blending functions");
 
+  simd = compositor_blend_get_simd_kernels (&kernels);
+  if (simd) {
+    GST_INFO ("using the %s blend kernels", simd);
+    blend_u8_loop = kernels.blend_u8;
+    blend_argb_loop = kernels.blend_argb;
+    blend_bgra_loop = kernels.blend_bgra;
+  }
+
   gst_compositor_blend_argb = GST_DEBUG_FUNCPTR (blend_argb);
   gst_compositor_blend_bgra = GST_DEBUG_FUNCPTR (blend_bgra);
   gst_compositor_overlay_argb = GST_DEBUG_FUNCPTR (overlay_argb);
@@ -0,0 +1,320 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* AVX2 and NEON versions of the ORC blend programs of the hot formats.
+ * They follow the ORC opcodes step by step, including the wrap-around of
+ * the 16 bit intermediates, so their output is identical to the ORC one.
+ *
+ * The ARGB and BGRA kernels address the alpha byte by its position in
+ * memory, unlike the ORC programs which work on native endian words, so
+ * they are only used on little endian. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "blendsimd.h"
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_BLEND_AVX2 1
+#include <immintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define HAVE_BLEND_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined (HAVE_BLEND_AVX2) || defined (HAVE_BLEND_NEON)
+/* ORC div255w */
+static inline guint16
+div255w (guint16 x)
+{
+  guint16 t = (guint16) (x + 128);
+
+  t = (guint16) (t + (t >> 8));
+  return t >> 8;
+}
+
+/* compositor_orc_blend_u8 for the end of a line */
+static inline void
+blend_u8_pixels (guint8 * d, const guint8 * s, gint alpha, gint n)
+{
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    guint16 t = (guint16) ((d[i] << 8) + (s[i] - d[i]) * alpha);
+
+    d[i] = t >> 8;
+  }
+}
+
+/* compositor_orc_blend_argb/bgra for the end of a line, the alpha being
+ * byte @a of each pixel */
+static inline void
+blend_a32_pixels (guint8 * d, const guint8 * s, gint alpha, gint n, gint a)
+{
+  gint i, c;
+
+  for (i = 0; i < n; i++) {
+    guint16 s_alpha = div255w (s[a] * alpha);
+
+    for (c = 0; c < 4; c++)
+      d[c] = d[c] + div255w ((guint16) ((s[c] - d[c]) * s_alpha));
+    d[a] = 0xff;
+
+    d += 4;
+    s += 4;
+  }
+}
+#endif
+
+#ifdef HAVE_BLEND_AVX2
+__attribute__ ((target ("avx2")))
+static inline __m256i
+div255w_avx2 (__m256i x)
+{
+  __m256i t = _mm256_add_epi16 (x, _mm256_set1_epi16 (128));
+
+  t = _mm256_add_epi16 (t, _mm256_srli_epi16 (t, 8));
+  return _mm256_srli_epi16 (t, 8);
+}
+
+/* 16 pixels, widened to 16 bits */
+__attribute__ ((target ("avx2")))
+static inline __m256i
+blend_u8_avx2_16 (const guint8 * d, const guint8 * s, __m256i alpha)
+{
+  __m256i dw = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) d));
+  __m256i sw = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) s));
+  __m256i t = _mm256_mullo_epi16 (_mm256_sub_epi16 (sw, dw), alpha);
+
+  return _mm256_srli_epi16 (_mm256_add_epi16 (_mm256_slli_epi16 (dw, 8), t),
+      8);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+blend_u8_avx2 (guint8 * d1, int d1_stride, const guint8 * s1, int s1_stride,
+    int p1, int n, int m)
+{
+  const __m256i alpha = _mm256_set1_epi16 (p1);
+  gint i, j;
+
+  for (j = 0; j < m; j++) {
+    guint8 *d = d1 + j * d1_stride;
+    const guint8 *s = s1 + j * s1_stride;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+      __m256i lo = blend_u8_avx2_16 (d + i, s + i, alpha);
+      __m256i hi = blend_u8_avx2_16 (d + i + 16, s + i + 16, alpha);
+
+      /* packing works per 128 bit lane, put the quarters back in order */
+      _mm256_storeu_si256 ((__m256i *) (d + i),
+          _mm256_permute4x64_epi64 (_mm256_packus_epi16 (lo, hi), 0xd8));
+    }
+    blend_u8_pixels (d + i, s + i, p1, n - i);
+  }
+}
+
+/* 4 pixels, widened to 16 bits and truncated back to 8 like convwb */
+__attribute__ ((target ("avx2")))
+static inline __m256i
+blend_a32_avx2_4 (const guint8 * d, const guint8 * s, __m256i alpha,
+    __m256i alpha_shuffle)
+{
+  __m256i dw = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) d));
+  __m256i sw = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) s));
+  __m256i a = _mm256_shuffle_epi8 (sw, alpha_shuffle);
+
+  a = div255w_avx2 (_mm256_mullo_epi16 (a, alpha));
+  sw = _mm256_mullo_epi16 (_mm256_sub_epi16 (sw, dw), a);
+  dw = _mm256_add_epi16 (dw, div255w_avx2 (sw));
+
+  return _mm256_and_si256 (dw, _mm256_set1_epi16 (0xff));
+}
+
+__attribute__ ((target ("avx2")))
+static inline void
+blend_a32_avx2 (guint8 * d1, int d1_stride, const guint8 * s1, int s1_stride,
+    int p1, int n, int m, gint a)
+{
+  const __m256i alpha = _mm256_set1_epi16 (p1);
+  /* spread the alpha word of each pixel over its 4 words */
+  const __m256i alpha_shuffle = a == 0 ?
+      _mm256_setr_epi8 (0, 1, 0, 1, 0, 1, 0, 1, 8, 9, 8, 9, 8, 9, 8, 9,
+      0, 1, 0, 1, 0, 1, 0, 1, 8, 9, 8, 9, 8, 9, 8, 9) :
+      _mm256_setr_epi8 (6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+      6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+  const __m256i opaque = _mm256_set1_epi32 (a == 0 ? 0xff : (gint) 0xff000000);
+  gint i, j;
+
+  for (j = 0; j < m; j++) {
+    guint8 *d = d1 + j * d1_stride;
+    const guint8 *s = s1 + j * s1_stride;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+      __m256i lo = blend_a32_avx2_4 (d + 4 * i, s + 4 * i, alpha,
+          alpha_shuffle);
+      __m256i hi = blend_a32_avx2_4 (d + 4 * i + 16, s + 4 * i + 16, alpha,
+          alpha_shuffle);
+      __m256i t =
+          _mm256_permute4x64_epi64 (_mm256_packus_epi16 (lo, hi), 0xd8);
+
+      _mm256_storeu_si256 ((__m256i *) (d + 4 * i),
+          _mm256_or_si256 (t, opaque));
+    }
+    blend_a32_pixels (d + 4 * i, s + 4 * i, p1, n - i, a);
+  }
+}
+
+__attribute__ ((target ("avx2")))
+static void
+blend_argb_avx2 (guint8 * d1, int d1_stride, const guint8 * s1,
+    int s1_stride, int p1, int n, int m)
+{
+  blend_a32_avx2 (d1, d1_stride, s1, s1_stride, p1, n, m, 0);
+}
+
+__attribute__ ((target ("avx2")))
+static void
+blend_bgra_avx2 (guint8 * d1, int d1_stride, const guint8 * s1,
+    int s1_stride, int p1, int n, int m)
+{
+  blend_a32_avx2 (d1, d1_stride, s1, s1_stride, p1, n, m, 3);
+}
+#endif
+
+#ifdef HAVE_BLEND_NEON
+static inline uint16x8_t
+div255w_neon (uint16x8_t x)
+{
+  uint16x8_t t = vaddq_u16 (x, vdupq_n_u16 (128));
+
+  t = vaddq_u16 (t, vshrq_n_u16 (t, 8));
+  return vshrq_n_u16 (t, 8);
+}
+
+static inline uint8x8_t
+blend_u8_neon_8 (uint8x8_t d, uint8x8_t s, uint16x8_t alpha)
+{
+  uint16x8_t dw = vmovl_u8 (d);
+  uint16x8_t t = vmulq_u16 (vsubq_u16 (vmovl_u8 (s), dw), alpha);
+
+  return vshrn_n_u16 (vaddq_u16 (vshlq_n_u16 (dw, 8), t), 8);
+}
+
+static void
+blend_u8_neon (guint8 * d1, int d1_stride, const guint8 * s1, int s1_stride,
+    int p1, int n, int m)
+{
+  const uint16x8_t alpha = vdupq_n_u16 (p1);
+  gint i, j;
+
+  for (j = 0; j < m; j++) {
+    guint8 *d = d1 + j * d1_stride;
+    const guint8 *s = s1 + j * s1_stride;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+      uint8x16_t dv = vld1q_u8 (d + i);
+      uint8x16_t sv = vld1q_u8 (s + i);
+
+      vst1q_u8 (d + i,
+          vcombine_u8 (blend_u8_neon_8 (vget_low_u8 (dv), vget_low_u8 (sv),
+                  alpha), blend_u8_neon_8 (vget_high_u8 (dv),
+                  vget_high_u8 (sv), alpha)));
+    }
+    blend_u8_pixels (d + i, s + i, p1, n - i);
+  }
+}
+
+static inline void
+blend_a32_neon (guint8 * d1, int d1_stride, const guint8 * s1, int s1_stride,
+    int p1, int n, int m, gint a)
+{
+  const uint8x8_t alpha = vdup_n_u8 (p1);
+  gint i, j, c;
+
+  for (j = 0; j < m; j++) {
+    guint8 *d = d1 + j * d1_stride;
+    const guint8 *s = s1 + j * s1_stride;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+      uint8x8x4_t sv = vld4_u8 (s + 4 * i);
+      uint8x8x4_t dv = vld4_u8 (d + 4 * i);
+      uint16x8_t s_alpha = div255w_neon (vmull_u8 (sv.val[a], alpha));
+
+      for (c = 0; c < 4; c++) {
+        uint16x8_t dw = vmovl_u8 (dv.val[c]);
+        uint16x8_t t = vmulq_u16 (vsubq_u16 (vmovl_u8 (sv.val[c]), dw),
+            s_alpha);
+
+        dv.val[c] = vmovn_u16 (vaddq_u16 (dw, div255w_neon (t)));
+      }
+      dv.val[a] = vdup_n_u8 (0xff);
+
+      vst4_u8 (d + 4 * i, dv);
+    }
+    blend_a32_pixels (d + 4 * i, s + 4 * i, p1, n - i, a);
+  }
+}
+
+static void
+blend_argb_neon (guint8 * d1, int d1_stride, const guint8 * s1,
+    int s1_stride, int p1, int n, int m)
+{
+  blend_a32_neon (d1, d1_stride, s1, s1_stride, p1, n, m, 0);
+}
+
+static void
+blend_bgra_neon (guint8 * d1, int d1_stride, const guint8 * s1,
+    int s1_stride, int p1, int n, int m)
+{
+  blend_a32_neon (d1, d1_stride, s1, s1_stride, p1, n, m, 3);
+}
+#endif
+
+/**
+ * compositor_blend_get_simd_kernels:
+ * @kernels: (out): the kernels to use
+ *
+ * Fills @kernels with the hand-written blend loops for the running CPU.
+ *
+ * Returns: the name of the instruction set, or %NULL if there are no
+ *   kernels for this CPU and @kernels was left untouched.
+ */
+const gchar *
+compositor_blend_get_simd_kernels (BlendKernels * kernels)
+{
+#ifdef HAVE_BLEND_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    kernels->blend_u8 = blend_u8_avx2;
+    kernels->blend_argb = blend_argb_avx2;
+    kernels->blend_bgra = blend_bgra_avx2;
+    return "AVX2";
+  }
+#endif
+#ifdef HAVE_BLEND_NEON
+  kernels->blend_u8 = blend_u8_neon;
+  kernels->blend_argb = blend_argb_neon;
+  kernels->blend_bgra = blend_bgra_neon;
+  return "NEON";
+#endif
+
+  return NULL;
+}
@@ -0,0 +1,48 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLEND_SIMD_H__
+#define __BLEND_SIMD_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Same arguments as the ORC functions they stand in for */
+typedef void (*BlendLoopFunction) (guint8 * d1, int d1_stride,
+    const guint8 * s1, int s1_stride, int p1, int n, int m);
+
+/**
+ * BlendKernels:
+ * @blend_u8: replaces compositor_orc_blend_u8 (planar, semi-planar, RGB)
+ * @blend_argb: replaces compositor_orc_blend_argb (ARGB, AYUV)
+ * @blend_bgra: replaces compositor_orc_blend_bgra (BGRA)
+ *
+ * The blend loops with a hand-written version for the running CPU.
+ */
+typedef struct
+{
+  BlendLoopFunction blend_u8;
+  BlendLoopFunction blend_argb;
+  BlendLoopFunction blend_bgra;
+} BlendKernels;
+
+const gchar * compositor_blend_get_simd_kernels (BlendKernels * kernels);
+
+G_END_DECLS
+
+#endif /* __BLEND_SIMD_H__ */
@@ -251,6 +251,37 @@ _mixer_pad_get_output_size (GstCompositor * comp,
   *height = pad_height;
 }
 
+/* The buffers hold the same frame if they share their memory: we keep a
+ * reference on the old one, so nobody can have written into it since */
+static gboolean
+gst_compositor_same_content (GstBuffer * buf1, GstBuffer * buf2)
+{
+  guint i, n;
+
+  if (buf1 == buf2)
+    return TRUE;
+  if (!buf1 || !buf2)
+    return FALSE;
+
+  n = gst_buffer_n_memory (buf1);
+  if (n != gst_buffer_n_memory (buf2))
+    return FALSE;
+
+  for (i = 0; i < n; i++) {
+    if (gst_buffer_peek_memory (buf1, i) != gst_buffer_peek_memory (buf2, i))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_compositor_pad_clear_cache (GstCompositorPad * cpad)
+{
+  gst_buffer_replace (&cpad->cached_input, NULL);
+  gst_buffer_replace (&cpad->cached_buffer, NULL);
+}
+
 static gboolean
 gst_compositor_pad_set_info (GstVideoAggregatorPad * pad,
     GstVideoAggregator * vagg G_GNUC_UNUSED,
@@ -270,6 +301,7 @@ gst_compositor_pad_set_info (GstVideoAggregatorPad * pad,
 
   if (cpad->convert)
     gst_video_converter_free (cpad->convert);
+  gst_compositor_pad_clear_cache (cpad);
 
   cpad->convert = NULL;
 
@@ -351,6 +383,64 @@ is_rectangle_contained (GstVideoRectangle rect1, GstVideoRectangle rect2)
   return FALSE;
 }
 
+#define MAX_UNCOVERED_RECTS 64
+
+/* Returns TRUE if @rect is entirely covered by the union of @covers, by
+ * subtracting them one after the other from @rect. Gives up (and returns
+ * FALSE) if what is left gets too fragmented */
+static gboolean
+is_rectangle_covered (GstVideoRectangle rect, const GstVideoRectangle * covers,
+    guint n_covers)
+{
+  GstVideoRectangle uncovered[2][MAX_UNCOVERED_RECTS];
+  guint i, j, n = 1, cur = 0;
+
+  uncovered[0][0] = rect;
+
+  for (i = 0; i < n_covers && n > 0; i++) {
+    const GstVideoRectangle *c = &covers[i];
+    GstVideoRectangle *next = uncovered[!cur];
+    guint n_next = 0;
+
+#define ADD_UNCOVERED(X, Y, W, H) G_STMT_START {        \
+      if ((W) > 0 && (H) > 0) {                         \
+        if (n_next == MAX_UNCOVERED_RECTS)              \
+          return FALSE;                                 \
+        next[n_next].x = (X);                           \
+        next[n_next].y = (Y);                           \
+        next[n_next].w = (W);                           \
+        next[n_next].h = (H);                           \
+        n_next++;                                       \
+      }                                                 \
+    } G_STMT_END
+
+    for (j = 0; j < n; j++) {
+      GstVideoRectangle r = uncovered[cur][j];
+      gint top = MAX (r.y, c->y);
+      gint bottom = MIN (r.y + r.h, c->y + c->h);
+      gint left = MAX (r.x, c->x);
+      gint right = MIN (r.x + r.w, c->x + c->w);
+
+      if (top >= bottom || left >= right) {
+        ADD_UNCOVERED (r.x, r.y, r.w, r.h);
+        continue;
+      }
+
+      /* the parts of r above, below, left and right of c */
+      ADD_UNCOVERED (r.x, r.y, r.w, top - r.y);
+      ADD_UNCOVERED (r.x, bottom, r.w, r.y + r.h - bottom);
+      ADD_UNCOVERED (r.x, top, left - r.x, bottom - top);
+      ADD_UNCOVERED (right, top, r.x + r.w - right, bottom - top);
+    }
+#undef ADD_UNCOVERED
+
+    n = n_next;
+    cur = !cur;
+  }
+
+  return n == 0;
+}
+
 static GstVideoRectangle
 clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
     gint outer_height)
@@ -384,6 +474,7 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   static GstAllocationParams params = { 0, 15, 0, 0, };
   gint width, height;
   gboolean frame_obscured = FALSE;
+  GArray *opaque_rects = NULL;
   GList *l;
   /* The rectangle representing this frame, clamped to the video's boundaries.
    * Due to the clamping, this is different from the frame width/height above. */
@@ -421,6 +512,7 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     if (cpad->convert)
       gst_video_converter_free (cpad->convert);
     cpad->convert = NULL;
+    gst_compositor_pad_clear_cache (cpad);
 
     colorimetry = gst_video_colorimetry_to_string (&pad->info.colorimetry);
     chroma = gst_video_chroma_to_string (pad->info.chroma_site);
@@ -498,9 +590,8 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     l = l->next;
   }
 
-  /* Check if this frame is obscured by a higher-zorder frame
-   * TODO: Also skip a frame if it's obscured by a combination of
-   * higher-zorder frames */
+  /* Check if this frame is obscured by a higher-zorder frame, or by a
+   * combination of them */
   for (; l; l = l->next) {
     GstVideoRectangle frame2_rect;
     GstVideoAggregatorPad *pad2 = l->data;
@@ -520,9 +611,11 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
 
     /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
      * channel, then check opacity and frame boundaries */
-    if (pad2->buffer && cpad2->alpha == 1.0 &&
-        !GST_VIDEO_INFO_HAS_ALPHA (&pad2->info) &&
-        is_rectangle_contained (frame_rect, frame2_rect)) {
+    if (!pad2->buffer || cpad2->alpha != 1.0 ||
+        GST_VIDEO_INFO_HAS_ALPHA (&pad2->info))
+      continue;
+
+    if (is_rectangle_contained (frame_rect, frame2_rect)) {
       frame_obscured = TRUE;
       GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by %s %ix%i@(%i,%i) "
           "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
@@ -532,14 +625,47 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
           GST_VIDEO_INFO_HEIGHT (&vagg->info));
       break;
     }
+
+    if (!opaque_rects)
+      opaque_rects = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+    g_array_append_val (opaque_rects, frame2_rect);
   }
   GST_OBJECT_UNLOCK (vagg);
 
+  if (!frame_obscured && opaque_rects && opaque_rects->len > 1 &&
+      is_rectangle_covered (frame_rect,
+          (GstVideoRectangle *) opaque_rects->data, opaque_rects->len)) {
+    frame_obscured = TRUE;
+    GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by %u higher-zorder "
+        "frames in output of size %ix%i; skipping frame", frame_rect.w,
+        frame_rect.h, frame_rect.x, frame_rect.y, opaque_rects->len,
+        GST_VIDEO_INFO_WIDTH (&vagg->info),
+        GST_VIDEO_INFO_HEIGHT (&vagg->info));
+  }
+  if (opaque_rects)
+    g_array_free (opaque_rects, TRUE);
+
   if (frame_obscured) {
     converted_frame = NULL;
     goto done;
   }
 
+  /* Stalled live sources and still images keep sending the same frame, no
+   * need to convert it again */
+  if (cpad->convert && cpad->cached_buffer &&
+      gst_compositor_same_content (cpad->cached_input, pad->buffer)) {
+    converted_frame = g_slice_new0 (GstVideoFrame);
+
+    if (gst_video_frame_map (converted_frame, &cpad->conversion_info,
+            cpad->cached_buffer, GST_MAP_READ)) {
+      GST_LOG_OBJECT (pad, "Input unchanged, reusing converted frame");
+      goto done;
+    }
+
+    g_slice_free (GstVideoFrame, converted_frame);
+    gst_compositor_pad_clear_cache (cpad);
+  }
+
   frame = g_slice_new0 (GstVideoFrame);
 
   if (!gst_video_frame_map (frame, &pad->info, pad->buffer, GST_MAP_READ)) {
@@ -570,6 +696,8 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
 
     gst_video_converter_frame (cpad->convert, frame, converted_frame);
     cpad->converted_buffer = converted_buf;
+    gst_buffer_replace (&cpad->cached_input, pad->buffer);
+    gst_buffer_replace (&cpad->cached_buffer, converted_buf);
     gst_video_frame_unmap (frame);
     g_slice_free (GstVideoFrame, frame);
   } else {
@@ -608,6 +736,7 @@ gst_compositor_pad_finalize (GObject * object)
   if (pad->convert)
     gst_video_converter_free (pad->convert);
   pad->convert = NULL;
+  gst_compositor_pad_clear_cache (pad);
 
   G_OBJECT_CLASS (gst_compositor_pad_parent_class)->finalize (object);
 }
@@ -669,10 +798,12 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_N_THREADS 1
 enum
 {
   PROP_0,
   PROP_BACKGROUND,
+  PROP_N_THREADS,
 };
 
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
@@ -708,12 +839,28 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->threads.n_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* WITH GST_OBJECT_LOCK !! */
+static void
+gst_compositor_invalidate_retained (GstCompositor * self)
+{
+  gst_buffer_replace (&self->retained, NULL);
+  if (self->last_states) {
+    g_array_free (self->last_states, TRUE);
+    self->last_states = NULL;
+  }
+}
+
 static void
 gst_compositor_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
@@ -722,7 +869,15 @@ gst_compositor_set_property (GObject * object,
 
   switch (prop_id) {
     case PROP_BACKGROUND:
+      GST_OBJECT_LOCK (self);
       self->background = g_value_get_enum (value);
+      gst_compositor_invalidate_retained (self);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->threads.n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -989,9 +1144,58 @@ _negotiated_caps (GstAggregator * agg, GstCaps * caps)
     return FALSE;
   }
 
+  GST_OBJECT_LOCK (agg);
+  gst_compositor_invalidate_retained (GST_COMPOSITOR (agg));
+  gst_compositor_clear_scratch_pool (GST_COMPOSITOR (agg));
+  GST_OBJECT_UNLOCK (agg);
+
   return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg, caps);
 }
 
+static void
+gst_compositor_clear_scratch_pool (GstCompositor * self)
+{
+  if (self->scratch_pool) {
+    gst_buffer_pool_set_active (self->scratch_pool, FALSE);
+    gst_object_unref (self->scratch_pool);
+    self->scratch_pool = NULL;
+  }
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Returns a buffer for a scratch frame of @info, the buffers go back to a
+ * pool once the frames mapping them are unmapped */
+static GstBuffer *
+gst_compositor_acquire_scratch_buffer (GstCompositor * self,
+    GstVideoInfo * info)
+{
+  GstBuffer *buffer = NULL;
+
+  if (!self->scratch_pool) {
+    GstStructure *config;
+    GstCaps *caps;
+
+    self->scratch_pool = gst_video_buffer_pool_new ();
+    caps = gst_video_info_to_caps (info);
+    config = gst_buffer_pool_get_config (self->scratch_pool);
+    gst_buffer_pool_config_set_params (config, caps, info->size, 0, 0);
+    gst_caps_unref (caps);
+
+    if (!gst_buffer_pool_set_config (self->scratch_pool, config) ||
+        !gst_buffer_pool_set_active (self->scratch_pool, TRUE)) {
+      GST_WARNING_OBJECT (self, "Could not set up the scratch buffer pool");
+      gst_object_unref (self->scratch_pool);
+      self->scratch_pool = NULL;
+    }
+  }
+
+  if (!self->scratch_pool || gst_buffer_pool_acquire_buffer (self->scratch_pool,
+          &buffer, NULL) != GST_FLOW_OK)
+    buffer = gst_buffer_new_allocate (NULL, info->size, NULL);
+
+  return buffer;
+}
+
 /* Fills frame with transparent pixels if @nframe is NULL otherwise copy @frame
  * properties and fill @nframes with transparent pixels */
 static GstFlowReturn
@@ -1001,7 +1205,8 @@ gst_compositor_fill_transparent (GstCompositor * self, GstVideoFrame * frame,
   guint plane, num_planes, height, i;
 
   if (nframe) {
-    GstBuffer *cbuffer = gst_buffer_copy_deep (frame->buffer);
+    GstBuffer *cbuffer =
+        gst_compositor_acquire_scratch_buffer (self, &frame->info);
 
     if (!gst_video_frame_map (nframe, &frame->info, cbuffer, GST_MAP_WRITE)) {
       GST_WARNING_OBJECT (self, "Could not map output buffer");
@@ -1115,6 +1320,352 @@ gst_compositor_crossfade_frames (GstCompositor * self, GstVideoFrame * outframe)
   return all_crossfading;
 }
 
+/* A part of the output frame, blended by one thread. The regions start on
+ * a multiple of 32 columns and 16 lines, so that the chroma subsampling, the
+ * position rounding of the blend functions and the checker pattern line up
+ * exactly as when the whole frame is blended at once */
+typedef struct
+{
+  GstVideoFrame frame;
+  gint x, y;
+  gboolean draw_background;
+  BlendFunction composite;
+  GArray *layers;
+  /* rectangles of the output frame fully overwritten by opaque layers */
+  GArray *covers;
+  gint x_align, y_align;
+} GstCompositorRegion;
+
+#define REGION_X_ALIGN 32
+#define REGION_Y_ALIGN 16
+
+typedef struct
+{
+  GstVideoFrame *frame;
+  gint xpos, ypos;
+  gdouble alpha;
+  gboolean opaque;
+} GstCompositorLayer;
+
+/* What was blended for a pad in the last output frame, to find out which
+ * parts of the frame need to be blended again */
+typedef struct
+{
+  GstPad *pad;
+  GstBuffer *buffer;
+  gboolean drawn;
+  /* position as rounded by the blend functions */
+  GstVideoRectangle rect;
+  gdouble alpha;
+} GstCompositorPadState;
+
+typedef enum
+{
+  COMPOSITOR_REDRAW_ALL,        /* no previous frame to compare with */
+  COMPOSITOR_REDRAW_MOST,       /* most of the frame changed */
+  COMPOSITOR_REDRAW_RECTS,      /* only the dirty rectangles changed */
+} GstCompositorRedraw;
+
+static void
+gst_compositor_draw_background (GstCompositor * self, GstVideoFrame * frame)
+{
+  switch (self->background) {
+    case COMPOSITOR_BACKGROUND_CHECKER:
+      self->fill_checker (frame);
+      break;
+    case COMPOSITOR_BACKGROUND_BLACK:
+      self->fill_color (frame, 16, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_WHITE:
+      self->fill_color (frame, 240, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_TRANSPARENT:
+      gst_compositor_fill_transparent (self, frame, NULL);
+      break;
+  }
+}
+
+/* Makes @view a view on the @width x @height area of @frame at @x, @y */
+static void
+gst_compositor_frame_view (GstVideoFrame * frame, gint x, gint y, gint width,
+    gint height, GstVideoFrame * view)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint i;
+
+  *view = *frame;
+  view->info.width = width;
+  view->info.height = height;
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (frame); i++) {
+    guint plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, i);
+
+    view->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i, y) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane) +
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, i, x) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (frame, i);
+  }
+}
+
+/* The blend functions round the position of the frames up to the chroma
+ * subsampling of @frame */
+static void
+gst_compositor_get_alignment (GstVideoFrame * frame, gint * x_align,
+    gint * y_align)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint i, w_sub = 0, h_sub = 0;
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (frame); i++) {
+    w_sub = MAX (w_sub, GST_VIDEO_FORMAT_INFO_W_SUB (finfo, i));
+    h_sub = MAX (h_sub, GST_VIDEO_FORMAT_INFO_H_SUB (finfo, i));
+  }
+  *x_align = 1 << w_sub;
+  *y_align = 1 << h_sub;
+}
+
+static void
+gst_compositor_region_init (GstCompositorRegion * region,
+    GstVideoFrame * frame, gint x, gint y, gint width, gint height)
+{
+  gst_compositor_frame_view (frame, x, y, width, height, &region->frame);
+  region->x = x;
+  region->y = y;
+  gst_compositor_get_alignment (frame, &region->x_align, &region->y_align);
+}
+
+static void
+gst_compositor_blend_region (GstCompositor * self,
+    GstCompositorRegion * region)
+{
+  gint width = GST_VIDEO_FRAME_WIDTH (&region->frame);
+  gint height = GST_VIDEO_FRAME_HEIGHT (&region->frame);
+  guint i;
+
+  /* nothing of the background would be left visible */
+  if (region->draw_background && region->covers && region->covers->len > 0) {
+    GstVideoRectangle rect = { region->x, region->y, width, height };
+
+    if (is_rectangle_covered (rect, (GstVideoRectangle *) region->covers->data,
+            region->covers->len)) {
+      GST_TRACE_OBJECT (self, "background of %ix%i@(%i,%i) is covered",
+          width, height, region->x, region->y);
+      region->draw_background = FALSE;
+    }
+  }
+
+  if (region->draw_background)
+    gst_compositor_draw_background (self, &region->frame);
+
+  for (i = 0; i < region->layers->len; i++) {
+    GstCompositorLayer *layer =
+        &g_array_index (region->layers, GstCompositorLayer, i);
+    gint x = GST_ROUND_UP_N (layer->xpos, region->x_align) - region->x;
+    gint y = GST_ROUND_UP_N (layer->ypos, region->y_align) - region->y;
+
+    /* skip the layers that don't reach into the region once rounded, the
+     * blend functions don't all cope with nothing to blend */
+    if (x >= width || x + GST_VIDEO_FRAME_WIDTH (layer->frame) <= 0 ||
+        y >= height || y + GST_VIDEO_FRAME_HEIGHT (layer->frame) <= 0)
+      continue;
+
+    region->composite (layer->frame, layer->xpos - region->x,
+        layer->ypos - region->y, layer->alpha, &region->frame,
+        COMPOSITOR_BLEND_MODE_NORMAL);
+  }
+}
+
+typedef struct
+{
+  GstCompositor *self;
+  GstVideoFrame *outframe;
+  gboolean draw_background;
+  BlendFunction composite;
+  GArray *layers;
+  GArray *covers;
+} GstCompositorStripes;
+
+/* Blends the rows of blocks [first, last) of REGION_Y_ALIGN lines */
+static void
+gst_compositor_blend_stripe (gpointer user_data, guint stripe, gint first,
+    gint last)
+{
+  GstCompositorStripes *stripes = user_data;
+  GstCompositorRegion region;
+  gint height = GST_VIDEO_FRAME_HEIGHT (stripes->outframe);
+  gint y = first * REGION_Y_ALIGN;
+
+  gst_compositor_region_init (&region, stripes->outframe, 0, y,
+      GST_VIDEO_FRAME_WIDTH (stripes->outframe),
+      MIN (last * REGION_Y_ALIGN, height) - y);
+  region.draw_background = stripes->draw_background;
+  region.composite = stripes->composite;
+  region.layers = stripes->layers;
+  region.covers = stripes->covers;
+
+  gst_compositor_blend_region (stripes->self, &region);
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Splits the frame in horizontal stripes blended by the stripe threads, each
+ * with all the layers in z-order */
+static void
+gst_compositor_blend_stripes (GstCompositor * self, GstVideoFrame * outframe,
+    gboolean draw_background, BlendFunction composite, GArray * layers,
+    GArray * covers)
+{
+  GstCompositorStripes stripes = { self, outframe, draw_background,
+    composite, layers, covers
+  };
+  gint n_blocks = (GST_VIDEO_FRAME_HEIGHT (outframe) + REGION_Y_ALIGN - 1) /
+      REGION_Y_ALIGN;
+
+  gst_stripe_threads_run (&self->threads, n_blocks, 1,
+      gst_compositor_blend_stripe, &stripes);
+}
+
+static void
+gst_compositor_pad_state_clear (GstCompositorPadState * state)
+{
+  gst_object_unref (state->pad);
+  gst_buffer_replace (&state->buffer, NULL);
+}
+
+static void
+gst_compositor_add_dirty_rect (GArray * rects, const GstVideoRectangle * rect,
+    gint width, gint height)
+{
+  GstVideoRectangle dirty;
+  gint x1, y1;
+
+  dirty.x = CLAMP (rect->x, 0, width) & ~(REGION_X_ALIGN - 1);
+  dirty.y = CLAMP (rect->y, 0, height) & ~(REGION_Y_ALIGN - 1);
+  x1 = MIN (GST_ROUND_UP_N (CLAMP (rect->x + rect->w, 0, width),
+          REGION_X_ALIGN), width);
+  y1 = MIN (GST_ROUND_UP_N (CLAMP (rect->y + rect->h, 0, height),
+          REGION_Y_ALIGN), height);
+  dirty.w = x1 - dirty.x;
+  dirty.h = y1 - dirty.y;
+
+  if (dirty.w > 0 && dirty.h > 0)
+    g_array_append_val (rects, dirty);
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Compares the pads with what was blended in the last output frame and
+ * collects the rectangles that have to be blended again in @rects */
+static GstCompositorRedraw
+gst_compositor_get_dirty_rects (GstCompositor * self, GArray * states,
+    GArray * rects)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  gint width = GST_VIDEO_INFO_WIDTH (&vagg->info);
+  gint height = GST_VIDEO_INFO_HEIGHT (&vagg->info);
+  gint64 area = 0;
+  guint i;
+
+  if (!self->last_states || self->last_states->len != states->len)
+    return COMPOSITOR_REDRAW_ALL;
+
+  for (i = 0; i < states->len; i++) {
+    GstCompositorPadState *old =
+        &g_array_index (self->last_states, GstCompositorPadState, i);
+    GstCompositorPadState *new =
+        &g_array_index (states, GstCompositorPadState, i);
+
+    if (old->pad != new->pad)
+      return COMPOSITOR_REDRAW_ALL;
+
+    if (old->drawn == new->drawn && (!new->drawn ||
+            (old->alpha == new->alpha &&
+                old->rect.x == new->rect.x && old->rect.y == new->rect.y &&
+                old->rect.w == new->rect.w && old->rect.h == new->rect.h &&
+                gst_compositor_same_content (old->buffer, new->buffer))))
+      continue;
+
+    if (old->drawn)
+      gst_compositor_add_dirty_rect (rects, &old->rect, width, height);
+    if (new->drawn)
+      gst_compositor_add_dirty_rect (rects, &new->rect, width, height);
+  }
+
+  for (i = 0; i < rects->len; i++) {
+    GstVideoRectangle *rect = &g_array_index (rects, GstVideoRectangle, i);
+
+    area += rect->w * rect->h;
+  }
+
+  /* blending the rectangles and copying them around isn't worth it anymore */
+  if (rects->len > 32 || area > (gint64) width * height / 2)
+    return COMPOSITOR_REDRAW_MOST;
+
+  return COMPOSITOR_REDRAW_RECTS;
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Starts from the retained output frame and only blends the dirty
+ * rectangles again, then updates them in the retained frame */
+static gboolean
+gst_compositor_blend_dirty_rects (GstCompositor * self,
+    GstVideoFrame * outframe, BlendFunction composite, GArray * layers,
+    GArray * covers, GArray * rects)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  GstVideoFrame retained_frame;
+  guint i;
+
+  if (!gst_video_frame_map (&retained_frame, &vagg->info, self->retained,
+          GST_MAP_READWRITE))
+    return FALSE;
+
+  gst_video_frame_copy (outframe, &retained_frame);
+
+  GST_LOG_OBJECT (self, "blending %u dirty rectangles", rects->len);
+  for (i = 0; i < rects->len; i++) {
+    GstVideoRectangle *rect = &g_array_index (rects, GstVideoRectangle, i);
+    GstCompositorRegion region;
+    GstVideoFrame view;
+
+    gst_compositor_region_init (&region, outframe, rect->x, rect->y, rect->w,
+        rect->h);
+    region.draw_background = TRUE;
+    region.composite = composite;
+    region.layers = layers;
+    region.covers = covers;
+    gst_compositor_blend_region (self, &region);
+
+    gst_compositor_frame_view (&retained_frame, rect->x, rect->y, rect->w,
+        rect->h, &view);
+    gst_video_frame_copy (&view, &region.frame);
+  }
+
+  gst_video_frame_unmap (&retained_frame);
+
+  return TRUE;
+}
+
+/* WITH GST_OBJECT_LOCK !! */
+static void
+gst_compositor_retain_frame (GstCompositor * self, GstVideoFrame * outframe)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  GstVideoFrame retained_frame;
+
+  if (!self->retained)
+    self->retained = gst_buffer_new_allocate (NULL,
+        GST_VIDEO_INFO_SIZE (&vagg->info), NULL);
+
+  if (!gst_video_frame_map (&retained_frame, &vagg->info, self->retained,
+          GST_MAP_WRITE)) {
+    gst_buffer_replace (&self->retained, NULL);
+    return;
+  }
+
+  gst_video_frame_copy (&retained_frame, outframe);
+  gst_video_frame_unmap (&retained_frame);
+}
+
 static GstFlowReturn
 gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
 {
@@ -1122,6 +1673,10 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   GstCompositor *self = GST_COMPOSITOR (vagg);
   BlendFunction composite;
   GstVideoFrame out_frame, *outframe;
+  GstCompositorRedraw redraw;
+  GArray *layers, *states, *rects, *covers;
+  gboolean draw_background = TRUE;
+  gint x_align, y_align;
 
   if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
     GST_WARNING_OBJECT (vagg, "Could not map output buffer");
@@ -1131,43 +1686,107 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   outframe = &out_frame;
   /* default to blending */
   composite = self->blend;
-  /* TODO: If the frames to be composited completely obscure the background,
-   * don't bother drawing the background at all. */
-  switch (self->background) {
-    case COMPOSITOR_BACKGROUND_CHECKER:
-      self->fill_checker (outframe);
-      break;
-    case COMPOSITOR_BACKGROUND_BLACK:
-      self->fill_color (outframe, 16, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_WHITE:
-      self->fill_color (outframe, 240, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_TRANSPARENT:
-      gst_compositor_fill_transparent (self, outframe, NULL);
-      /* use overlay to keep background transparent */
-      composite = self->overlay;
+  /* use overlay to keep background transparent */
+  if (self->background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    composite = self->overlay;
+
+  GST_OBJECT_LOCK (vagg);
+  /* The crossfade frames are mixed into the background, so it has to be
+   * drawn over the whole frame first */
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    if (GST_COMPOSITOR_PAD (l->data)->crossfade >= 0.0) {
+      gst_compositor_invalidate_retained (self);
+      gst_compositor_draw_background (self, outframe);
+      draw_background = FALSE;
       break;
+    }
   }
 
-  GST_OBJECT_LOCK (vagg);
   /* First mix the crossfade frames as required */
-  if (!gst_compositor_crossfade_frames (self, outframe)) {
-    for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
-      GstVideoAggregatorPad *pad = l->data;
-      GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
-
-      if (pad->aggregated_frame != NULL) {
-        composite (pad->aggregated_frame,
-            compo_pad->crossfaded ? 0 : compo_pad->xpos,
-            compo_pad->crossfaded ? 0 : compo_pad->ypos, compo_pad->alpha,
-            outframe, COMPOSITOR_BLEND_MODE_NORMAL);
-        compo_pad->crossfaded = FALSE;
+  if (gst_compositor_crossfade_frames (self, outframe)) {
+    if (draw_background)
+      gst_compositor_draw_background (self, outframe);
+    gst_compositor_invalidate_retained (self);
+    GST_OBJECT_UNLOCK (vagg);
+    gst_video_frame_unmap (outframe);
+
+    return GST_FLOW_OK;
+  }
+
+  gst_compositor_get_alignment (outframe, &x_align, &y_align);
+
+  layers = g_array_new (FALSE, FALSE, sizeof (GstCompositorLayer));
+  covers = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  states = g_array_new (FALSE, TRUE, sizeof (GstCompositorPadState));
+  g_array_set_clear_func (states,
+      (GDestroyNotify) gst_compositor_pad_state_clear);
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
+    GstCompositorPadState state = { NULL, };
+    GstCompositorLayer layer;
+
+    state.pad = gst_object_ref (pad);
+    if (pad->buffer)
+      state.buffer = gst_buffer_ref (pad->buffer);
+
+    if (pad->aggregated_frame != NULL) {
+      layer.frame = pad->aggregated_frame;
+      layer.xpos = compo_pad->crossfaded ? 0 : compo_pad->xpos;
+      layer.ypos = compo_pad->crossfaded ? 0 : compo_pad->ypos;
+      layer.alpha = compo_pad->alpha;
+      /* a crossfaded frame is a scratch frame with transparent parts */
+      layer.opaque = !compo_pad->crossfaded && layer.alpha == 1.0 &&
+          !GST_VIDEO_INFO_HAS_ALPHA (&pad->info);
+      g_array_append_val (layers, layer);
+      compo_pad->crossfaded = FALSE;
+
+      state.drawn = TRUE;
+      state.rect.x = GST_ROUND_UP_N (layer.xpos, x_align);
+      state.rect.y = GST_ROUND_UP_N (layer.ypos, y_align);
+      state.rect.w = GST_VIDEO_FRAME_WIDTH (layer.frame);
+      state.rect.h = GST_VIDEO_FRAME_HEIGHT (layer.frame);
+      state.alpha = layer.alpha;
+
+      /* the covered area is rounded down to whole chroma samples, a blend
+       * function may leave a partial one at the right or bottom edge */
+      if (layer.opaque) {
+        GstVideoRectangle cover = state.rect;
+
+        cover.w = GST_ROUND_DOWN_N (cover.x + cover.w, x_align) - cover.x;
+        cover.h = GST_ROUND_DOWN_N (cover.y + cover.h, y_align) - cover.y;
+        if (cover.w > 0 && cover.h > 0)
+          g_array_append_val (covers, cover);
       }
     }
+    g_array_append_val (states, state);
   }
+
+  rects = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  redraw = gst_compositor_get_dirty_rects (self, states, rects);
+
+  if (redraw != COMPOSITOR_REDRAW_RECTS || !self->retained ||
+      !gst_compositor_blend_dirty_rects (self, outframe, composite, layers,
+          covers, rects)) {
+    gst_compositor_blend_stripes (self, outframe, draw_background, composite,
+        layers, covers);
+
+    /* keep a copy to start from next time, unless everything changes on
+     * every frame anyway */
+    if (redraw != COMPOSITOR_REDRAW_MOST && draw_background)
+      gst_compositor_retain_frame (self, outframe);
+    else
+      gst_buffer_replace (&self->retained, NULL);
+  }
+
+  if (self->last_states)
+    g_array_free (self->last_states, TRUE);
+  self->last_states = states;
   GST_OBJECT_UNLOCK (vagg);
 
+  g_array_free (rects, TRUE);
+  g_array_free (covers, TRUE);
+  g_array_free (layers, TRUE);
   gst_video_frame_unmap (outframe);
 
   return GST_FLOW_OK;
@@ -1215,6 +1834,18 @@ _sink_query (GstAggregator * agg, GstAggregatorPad * bpad, GstQuery * query)
   }
 }
 
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  gst_stripe_threads_clear (&self->threads);
+  gst_compositor_invalidate_retained (self);
+  gst_compositor_clear_scratch_pool (self);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 /* GObject boilerplate */
 static void
 gst_compositor_class_init (GstCompositorClass * klass)
@@ -1227,6 +1858,7 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   agg_class->sink_query = _sink_query;
   agg_class->fixate_src_caps = _fixate_caps;
@@ -1238,6 +1870,20 @@ gst_compositor_class_init (GstCompositorClass * klass)
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:n-threads:
+   *
+   * Number of threads blending the output frame, each one handles an
+   * horizontal stripe of it. 0 uses one thread per processor.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads used for blending (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &src_factory, GST_TYPE_AGGREGATOR_PAD);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
@@ -1254,6 +1900,7 @@ gst_compositor_init (GstCompositor * self)
 {
   /* initialize variables */
   self->background = DEFAULT_BACKGROUND;
+  gst_stripe_threads_init (&self->threads, DEFAULT_N_THREADS);
 }
 
 /* Element registration */
@@ -24,6 +24,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideoaggregator.h>
+#include <gst/stripe-threads-private.h>
 
 #include "blend.h"
 
@@ -72,6 +73,18 @@ struct _GstCompositor
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* blends the output frame in stripes, the n-threads property is
+   * threads.n_threads */
+  GstStripeThreads threads;
+
+  /* copy of the last output frame and what was blended into it, so that
+   * only the parts that changed are blended again */
+  GstBuffer *retained;
+  GArray *last_states;
+
+  /* scratch frames the crossfaded pads are mixed into */
+  GstBufferPool *scratch_pool;
 };
 
 struct _GstCompositorClass
@@ -58,6 +58,11 @@ struct _GstCompositorPad
   GstVideoInfo conversion_info;
   GstBuffer *converted_buffer;
 
+  /* last input frame and its conversion, reused while the input stays the
+   * same */
+  GstBuffer *cached_input;
+  GstBuffer *cached_buffer;
+
   gboolean crossfaded;
 };
 
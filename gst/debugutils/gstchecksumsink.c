@@ -23,6 +23,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasesink.h>
+#include <string.h>
 #include "gstchecksumsink.h"
 
 static void gst_checksum_sink_set_property (GObject * object, guint prop_id,
@@ -36,13 +37,33 @@ static gboolean gst_checksum_sink_start (GstBaseSink * sink);
 static gboolean gst_checksum_sink_stop (GstBaseSink * sink);
 static GstFlowReturn
 gst_checksum_sink_render (GstBaseSink * sink, GstBuffer * buffer);
+static gboolean gst_checksum_sink_set_caps (GstBaseSink * sink,
+    GstCaps * caps);
 
 enum
 {
   PROP_0,
   PROP_HASH,
+  PROP_MODE,
 };
 
+/* non-cryptographic hashes, next to the GChecksumType ones */
+enum
+{
+  GST_CHECKSUM_SINK_HASH_XXH64 = 100,
+  GST_CHECKSUM_SINK_HASH_CRC32C,
+};
+
+typedef enum
+{
+  GST_CHECKSUM_SINK_MODE_BUFFER,
+  GST_CHECKSUM_SINK_MODE_FRAME,
+  GST_CHECKSUM_SINK_MODE_PLANES,
+} GstChecksumSinkMode;
+
+#define DEFAULT_HASH G_CHECKSUM_SHA1
+#define DEFAULT_MODE GST_CHECKSUM_SINK_MODE_BUFFER
+
 static GstStaticPadTemplate gst_checksum_sink_sink_template =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -63,6 +84,8 @@ gst_checksum_sink_hash_get_type (void)
       {G_CHECKSUM_SHA1, "SHA-1", "sha1"},
       {G_CHECKSUM_SHA256, "SHA-256", "sha256"},
       {G_CHECKSUM_SHA512, "SHA-512", "sha512"},
+      {GST_CHECKSUM_SINK_HASH_XXH64, "xxHash64", "xxh64"},
+      {GST_CHECKSUM_SINK_HASH_CRC32C, "CRC-32C", "crc32c"},
       {0, NULL, NULL},
     };
 
@@ -71,6 +94,366 @@ gst_checksum_sink_hash_get_type (void)
   return gtype;
 }
 
+#define GST_TYPE_CHECKSUM_SINK_MODE (gst_checksum_sink_mode_get_type ())
+static GType
+gst_checksum_sink_mode_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {GST_CHECKSUM_SINK_MODE_BUFFER, "One checksum of the whole buffer",
+          "buffer"},
+      {GST_CHECKSUM_SINK_MODE_FRAME,
+          "One checksum of the visible pixels of raw video", "frame"},
+      {GST_CHECKSUM_SINK_MODE_PLANES,
+          "One checksum per plane of the visible pixels of raw video",
+          "planes"},
+      {0, NULL, NULL},
+    };
+
+    gtype = g_enum_register_static ("GstChecksumSinkMode", values);
+  }
+  return gtype;
+}
+
+/* xxHash64 */
+
+#define XXH_PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define XXH_PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define XXH_PRIME64_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+#define XXH_ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+typedef struct
+{
+  guint64 total_len;
+  guint64 v[4];
+  guint8 mem[32];
+  guint mem_size;
+} Xxh64State;
+
+static inline guint64
+xxh64_read64 (const guint8 * p)
+{
+  guint64 v;
+
+  memcpy (&v, p, 8);
+  return GUINT64_FROM_LE (v);
+}
+
+static inline guint32
+xxh64_read32 (const guint8 * p)
+{
+  guint32 v;
+
+  memcpy (&v, p, 4);
+  return GUINT32_FROM_LE (v);
+}
+
+static inline guint64
+xxh64_round (guint64 acc, guint64 input)
+{
+  acc += input * XXH_PRIME64_2;
+  acc = XXH_ROTL64 (acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+static inline guint64
+xxh64_merge_round (guint64 acc, guint64 val)
+{
+  acc ^= xxh64_round (0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static void
+xxh64_init (Xxh64State * state)
+{
+  memset (state, 0, sizeof (Xxh64State));
+  state->v[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+  state->v[1] = XXH_PRIME64_2;
+  state->v[2] = 0;
+  state->v[3] = -XXH_PRIME64_1;
+}
+
+/* The four independent lanes keep the CPU busy enough to hash at memory
+ * speed without explicit SIMD */
+static void
+xxh64_update (Xxh64State * state, const guint8 * data, gsize len)
+{
+  const guint8 *end = data + len;
+
+  state->total_len += len;
+
+  if (state->mem_size + len < 32) {
+    memcpy (state->mem + state->mem_size, data, len);
+    state->mem_size += len;
+    return;
+  }
+
+  if (state->mem_size) {
+    guint fill = 32 - state->mem_size;
+
+    memcpy (state->mem + state->mem_size, data, fill);
+    state->v[0] = xxh64_round (state->v[0], xxh64_read64 (state->mem));
+    state->v[1] = xxh64_round (state->v[1], xxh64_read64 (state->mem + 8));
+    state->v[2] = xxh64_round (state->v[2], xxh64_read64 (state->mem + 16));
+    state->v[3] = xxh64_round (state->v[3], xxh64_read64 (state->mem + 24));
+    data += fill;
+    state->mem_size = 0;
+  }
+
+  if (data + 32 <= end) {
+    guint64 v1 = state->v[0], v2 = state->v[1];
+    guint64 v3 = state->v[2], v4 = state->v[3];
+
+    do {
+      v1 = xxh64_round (v1, xxh64_read64 (data));
+      v2 = xxh64_round (v2, xxh64_read64 (data + 8));
+      v3 = xxh64_round (v3, xxh64_read64 (data + 16));
+      v4 = xxh64_round (v4, xxh64_read64 (data + 24));
+      data += 32;
+    } while (data + 32 <= end);
+
+    state->v[0] = v1;
+    state->v[1] = v2;
+    state->v[2] = v3;
+    state->v[3] = v4;
+  }
+
+  if (data < end) {
+    memcpy (state->mem, data, end - data);
+    state->mem_size = end - data;
+  }
+}
+
+static guint64
+xxh64_digest (const Xxh64State * state)
+{
+  const guint8 *p = state->mem;
+  const guint8 *end = p + state->mem_size;
+  guint64 h;
+
+  if (state->total_len >= 32) {
+    h = XXH_ROTL64 (state->v[0], 1) + XXH_ROTL64 (state->v[1], 7) +
+        XXH_ROTL64 (state->v[2], 12) + XXH_ROTL64 (state->v[3], 18);
+    h = xxh64_merge_round (h, state->v[0]);
+    h = xxh64_merge_round (h, state->v[1]);
+    h = xxh64_merge_round (h, state->v[2]);
+    h = xxh64_merge_round (h, state->v[3]);
+  } else {
+    h = state->v[2] + XXH_PRIME64_5;
+  }
+
+  h += state->total_len;
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= xxh64_round (0, xxh64_read64 (p));
+    h = XXH_ROTL64 (h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+  }
+  if (p + 4 <= end) {
+    h ^= (guint64) xxh64_read32 (p) * XXH_PRIME64_1;
+    h = XXH_ROTL64 (h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h ^= (*p) * XXH_PRIME64_5;
+    h = XXH_ROTL64 (h, 11) * XXH_PRIME64_1;
+  }
+
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+/* CRC-32C (Castagnoli) */
+
+typedef guint32 (*Crc32cUpdateFunc) (guint32 crc, const guint8 * data,
+    gsize len);
+
+static guint32 crc32c_table[8][256];
+
+static void
+crc32c_init_table (void)
+{
+  guint32 i, j, crc;
+
+  for (i = 0; i < 256; i++) {
+    crc = i;
+    for (j = 0; j < 8; j++)
+      crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+    crc32c_table[0][i] = crc;
+  }
+  for (i = 0; i < 256; i++) {
+    crc = crc32c_table[0][i];
+    for (j = 1; j < 8; j++) {
+      crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+      crc32c_table[j][i] = crc;
+    }
+  }
+}
+
+/* slicing-by-8 */
+static guint32
+crc32c_update_c (guint32 crc, const guint8 * data, gsize len)
+{
+  for (; len >= 8; len -= 8, data += 8) {
+    guint32 lo = xxh64_read32 (data) ^ crc;
+    guint32 hi = xxh64_read32 (data + 4);
+
+    crc = crc32c_table[7][lo & 0xff] ^ crc32c_table[6][(lo >> 8) & 0xff] ^
+        crc32c_table[5][(lo >> 16) & 0xff] ^ crc32c_table[4][lo >> 24] ^
+        crc32c_table[3][hi & 0xff] ^ crc32c_table[2][(hi >> 8) & 0xff] ^
+        crc32c_table[1][(hi >> 16) & 0xff] ^ crc32c_table[0][hi >> 24];
+  }
+  for (; len; len--, data++)
+    crc = crc32c_table[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+
+  return crc;
+}
+
+#if defined (__GNUC__) && defined (__x86_64__)
+#define HAVE_CRC32C_SSE42 1
+#include <nmmintrin.h>
+
+__attribute__ ((target ("sse4.2")))
+static guint32
+crc32c_update_sse42 (guint32 crc, const guint8 * data, gsize len)
+{
+  guint64 crc64 = crc;
+
+  for (; len && ((guintptr) data & 7); len--, data++)
+    crc64 = _mm_crc32_u8 ((guint32) crc64, *data);
+  for (; len >= 8; len -= 8, data += 8)
+    crc64 = _mm_crc32_u64 (crc64, *(const guint64 *) data);
+  for (; len; len--, data++)
+    crc64 = _mm_crc32_u8 ((guint32) crc64, *data);
+
+  return (guint32) crc64;
+}
+#endif
+
+#if defined (__ARM_FEATURE_CRC32) && defined (__aarch64__)
+#define HAVE_CRC32C_ARMV8 1
+#include <arm_acle.h>
+
+static guint32
+crc32c_update_armv8 (guint32 crc, const guint8 * data, gsize len)
+{
+  for (; len && ((guintptr) data & 7); len--, data++)
+    crc = __crc32cb (crc, *data);
+  for (; len >= 8; len -= 8, data += 8)
+    crc = __crc32cd (crc, *(const guint64 *) data);
+  for (; len; len--, data++)
+    crc = __crc32cb (crc, *data);
+
+  return crc;
+}
+#endif
+
+static Crc32cUpdateFunc
+crc32c_get_impl (void)
+{
+#ifdef HAVE_CRC32C_SSE42
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("sse4.2"))
+    return crc32c_update_sse42;
+#endif
+#ifdef HAVE_CRC32C_ARMV8
+  return crc32c_update_armv8;
+#endif
+  crc32c_init_table ();
+  return crc32c_update_c;
+}
+
+static guint32
+crc32c_update (guint32 crc, const guint8 * data, gsize len)
+{
+  static gsize impl = 0;
+
+  if (g_once_init_enter (&impl)) {
+    gsize func = (gsize) crc32c_get_impl ();
+    g_once_init_leave (&impl, func);
+  }
+
+  return ((Crc32cUpdateFunc) impl) (crc, data, len);
+}
+
+/* Incremental hashing, so lines can be fed one by one */
+
+typedef struct
+{
+  gint hash;
+  GChecksum *checksum;
+  Xxh64State xxh64;
+  guint32 crc32c;
+} GstChecksumSinkHasher;
+
+static void
+hasher_init (GstChecksumSinkHasher * hasher, gint hash)
+{
+  hasher->hash = hash;
+  hasher->checksum = NULL;
+
+  switch (hash) {
+    case GST_CHECKSUM_SINK_HASH_XXH64:
+      xxh64_init (&hasher->xxh64);
+      break;
+    case GST_CHECKSUM_SINK_HASH_CRC32C:
+      hasher->crc32c = 0xffffffff;
+      break;
+    default:
+      hasher->checksum = g_checksum_new ((GChecksumType) hash);
+      break;
+  }
+}
+
+static void
+hasher_update (GstChecksumSinkHasher * hasher, const guint8 * data,
+    gsize len)
+{
+  switch (hasher->hash) {
+    case GST_CHECKSUM_SINK_HASH_XXH64:
+      xxh64_update (&hasher->xxh64, data, len);
+      break;
+    case GST_CHECKSUM_SINK_HASH_CRC32C:
+      hasher->crc32c = crc32c_update (hasher->crc32c, data, len);
+      break;
+    default:
+      g_checksum_update (hasher->checksum, data, len);
+      break;
+  }
+}
+
+static gchar *
+hasher_finish (GstChecksumSinkHasher * hasher)
+{
+  gchar *s;
+
+  switch (hasher->hash) {
+    case GST_CHECKSUM_SINK_HASH_XXH64:
+      s = g_strdup_printf ("%016" G_GINT64_MODIFIER "x",
+          xxh64_digest (&hasher->xxh64));
+      break;
+    case GST_CHECKSUM_SINK_HASH_CRC32C:
+      s = g_strdup_printf ("%08x", hasher->crc32c ^ 0xffffffff);
+      break;
+    default:
+      s = g_strdup (g_checksum_get_string (hasher->checksum));
+      g_checksum_free (hasher->checksum);
+      hasher->checksum = NULL;
+      break;
+  }
+
+  return s;
+}
+
 #define gst_checksum_sink_parent_class parent_class
 G_DEFINE_TYPE (GstChecksumSink, gst_checksum_sink, GST_TYPE_BASE_SINK);
 
@@ -88,13 +471,22 @@ gst_checksum_sink_class_init (GstChecksumSinkClass * klass)
   base_sink_class->start = GST_DEBUG_FUNCPTR (gst_checksum_sink_start);
   base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_checksum_sink_stop);
   base_sink_class->render = GST_DEBUG_FUNCPTR (gst_checksum_sink_render);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_checksum_sink_set_caps);
 
   gst_element_class_add_static_pad_template (element_class,
       &gst_checksum_sink_sink_template);
 
   g_object_class_install_property (gobject_class, PROP_HASH,
       g_param_spec_enum ("hash", "Hash", "Checksum type",
-          gst_checksum_sink_hash_get_type (), G_CHECKSUM_SHA1,
+          gst_checksum_sink_hash_get_type (), DEFAULT_HASH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+          "What to calculate checksums of. The frame and planes modes only "
+          "hash the visible pixels of raw video, line by line, so padding "
+          "and strides don't change the result",
+          gst_checksum_sink_mode_get_type (), DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_set_static_metadata (element_class, "Checksum sink",
@@ -106,7 +498,8 @@ static void
 gst_checksum_sink_init (GstChecksumSink * checksumsink)
 {
   gst_base_sink_set_sync (GST_BASE_SINK (checksumsink), FALSE);
-  checksumsink->hash = G_CHECKSUM_SHA1;
+  checksumsink->hash = DEFAULT_HASH;
+  checksumsink->mode = DEFAULT_MODE;
 }
 
 static void
@@ -119,6 +512,9 @@ gst_checksum_sink_set_property (GObject * object, guint prop_id,
     case PROP_HASH:
       checksumsink->hash = g_value_get_enum (value);
       break;
+    case PROP_MODE:
+      checksumsink->mode = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -135,6 +531,9 @@ gst_checksum_sink_get_property (GObject * object, guint prop_id,
     case PROP_HASH:
       g_value_set_enum (value, checksumsink->hash);
       break;
+    case PROP_MODE:
+      g_value_set_enum (value, checksumsink->mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -162,20 +561,102 @@ gst_checksum_sink_start (GstBaseSink * sink)
 static gboolean
 gst_checksum_sink_stop (GstBaseSink * sink)
 {
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  checksumsink->have_video_info = FALSE;
+
   return TRUE;
 }
 
+static gboolean
+gst_checksum_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+  GstChecksumSink *checksumsink = GST_CHECKSUM_SINK (sink);
+
+  checksumsink->have_video_info =
+      gst_video_info_from_caps (&checksumsink->video_info, caps);
+
+  return TRUE;
+}
+
+static void
+gst_checksum_sink_hash_plane (GstVideoFrame * frame, guint plane,
+    GstChecksumSinkHasher * hasher)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  const guint8 *data = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+  gint stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+  guint comp, width = 0, height = 0, i;
+
+  for (comp = 0; comp < GST_VIDEO_FRAME_N_COMPONENTS (frame); comp++) {
+    if (GST_VIDEO_FRAME_COMP_PLANE (frame, comp) == plane)
+      break;
+  }
+  if (comp == GST_VIDEO_FRAME_N_COMPONENTS (frame))
+    return;
+
+  height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, comp);
+  /* the visible part of packed formats with pixel groups can't be told
+   * apart, those hash whole lines */
+  if (GST_VIDEO_FORMAT_INFO_IS_COMPLEX (finfo) ||
+      GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp) == 0 ||
+      GST_VIDEO_FORMAT_INFO_IS_TILED (finfo))
+    width = ABS (stride);
+  else
+    width = GST_VIDEO_FRAME_COMP_WIDTH (frame, comp) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp);
+
+  for (i = 0; i < height; i++)
+    hasher_update (hasher, data + (gssize) i * stride, width);
+}
+
 static GstFlowReturn
 gst_checksum_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
+  GstChecksumSinkHasher hasher;
   gchar *s;
   GstMapInfo map;
   GstChecksumSink *checksumsink;
+  GstVideoFrame frame;
+  guint i;
 
   checksumsink = GST_CHECKSUM_SINK (sink);
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
-  s = g_compute_checksum_for_data (checksumsink->hash, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
+
+  if (checksumsink->mode != GST_CHECKSUM_SINK_MODE_BUFFER &&
+      checksumsink->have_video_info &&
+      gst_video_frame_map (&frame, &checksumsink->video_info, buffer,
+          GST_MAP_READ)) {
+    GString *str = g_string_new (NULL);
+
+    /* no copy, the frame follows the strides of the GstVideoMeta */
+    hasher_init (&hasher, checksumsink->hash);
+    for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&frame); i++) {
+      gst_checksum_sink_hash_plane (&frame, i, &hasher);
+
+      if (checksumsink->mode == GST_CHECKSUM_SINK_MODE_PLANES) {
+        s = hasher_finish (&hasher);
+        g_string_append_printf (str, "%s%s", i ? " " : "", s);
+        g_free (s);
+        if (i + 1 < GST_VIDEO_FRAME_N_PLANES (&frame))
+          hasher_init (&hasher, checksumsink->hash);
+      }
+    }
+    if (checksumsink->mode == GST_CHECKSUM_SINK_MODE_FRAME) {
+      s = hasher_finish (&hasher);
+      g_string_append (str, s);
+      g_free (s);
+    }
+    gst_video_frame_unmap (&frame);
+
+    s = g_string_free (str, FALSE);
+  } else {
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    hasher_init (&hasher, checksumsink->hash);
+    hasher_update (&hasher, map.data, map.size);
+    s = hasher_finish (&hasher);
+    gst_buffer_unmap (buffer, &map);
+  }
+
   g_print ("%" GST_TIME_FORMAT " %s\n",
       GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)), s);
 
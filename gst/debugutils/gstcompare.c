@@ -24,12 +24,14 @@
 #include "config.h"
 #endif
 #include <string.h>
+#include <math.h>
 
 #include <gst/gst.h>
 #include <gst/base/gstcollectpads.h>
 #include <gst/video/video.h>
 
 #include "gstcompare.h"
+#include "gstcomparemetrics.h"
 
 GST_DEBUG_CATEGORY_STATIC (compare_debug);
 #define GST_CAT_DEFAULT   compare_debug
@@ -55,7 +57,8 @@ enum GstCompareMethod
 {
   GST_COMPARE_METHOD_MEM,
   GST_COMPARE_METHOD_MAX,
-  GST_COMPARE_METHOD_SSIM
+  GST_COMPARE_METHOD_SSIM,
+  GST_COMPARE_METHOD_PSNR
 };
 
 #define GST_COMPARE_METHOD_TYPE (gst_compare_method_get_type())
@@ -68,6 +71,7 @@ gst_compare_method_get_type (void)
     {GST_COMPARE_METHOD_MEM, "Memory", "mem"},
     {GST_COMPARE_METHOD_MAX, "Maximum metric", "max"},
     {GST_COMPARE_METHOD_SSIM, "SSIM (raw video)", "ssim"},
+    {GST_COMPARE_METHOD_PSNR, "PSNR in dB (raw video)", "psnr"},
     {0, NULL, NULL}
   };
 
@@ -91,7 +95,9 @@ enum
   PROP_OFFSET_TS,
   PROP_METHOD,
   PROP_THRESHOLD,
-  PROP_UPPER
+  PROP_UPPER,
+  PROP_N_THREADS,
+  PROP_POST_STATS
 };
 
 #define DEFAULT_META             GST_BUFFER_COPY_ALL
@@ -99,6 +105,40 @@ enum
 #define DEFAULT_METHOD           GST_COMPARE_METHOD_MEM
 #define DEFAULT_THRESHOLD        0
 #define DEFAULT_UPPER            TRUE
+#define DEFAULT_N_THREADS        1
+#define DEFAULT_POST_STATS       FALSE
+
+/* reported for identical content */
+#define MAX_PSNR                 100.0
+
+typedef struct
+{
+  const guint8 *data1;
+  const guint8 *data2;
+  gint stride1;
+  gint stride2;
+  gint step;
+  gint width;
+  gint height;
+  gboolean ssim;
+  /* one per stripe */
+  GstCompareStats *stats;
+  /* the SSIM sum of each row of windows, added up in order afterwards so
+   * that the result does not depend on the number of stripes */
+  gdouble *ssim_rows;
+} GstCompareComponent;
+
+typedef struct
+{
+  gint n_comps;
+  gdouble weight[4];
+  gdouble psnr[4];
+  gdouble ssim[4];
+  guint max;
+  gdouble mean_abs_diff;
+  gdouble psnr_total;
+  gdouble ssim_total;
+} GstCompareResult;
 
 static void gst_compare_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
@@ -125,6 +165,8 @@ gst_compare_finalize (GObject * object)
 
   gst_object_unref (comp->cpads);
 
+  gst_stripe_threads_clear (&comp->threads);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -168,6 +210,16 @@ gst_compare_class_init (GstCompareClass * klass)
       g_param_spec_boolean ("upper", "Threshold Upper Bound",
           "Whether threshold value is upper bound or lower bound for difference measure",
           DEFAULT_UPPER, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of threads to compare raw video with "
+          "(0 = number of processors)", 0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_POST_STATS,
+      g_param_spec_boolean ("post-stats", "Post statistics",
+          "Post a compare-stats message with the PSNR, SSIM and differences "
+          "of every raw video frame", DEFAULT_POST_STATS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_factory);
@@ -210,6 +262,9 @@ gst_compare_init (GstCompare * comp)
   comp->method = DEFAULT_METHOD;
   comp->threshold = DEFAULT_THRESHOLD;
   comp->upper = DEFAULT_UPPER;
+  comp->post_stats = DEFAULT_POST_STATS;
+
+  gst_stripe_threads_init (&comp->threads, DEFAULT_N_THREADS);
 
   gst_compare_reset (comp);
 }
@@ -217,6 +272,7 @@ gst_compare_init (GstCompare * comp)
 static void
 gst_compare_reset (GstCompare * comp)
 {
+  comp->frames = 0;
 }
 
 static gboolean
@@ -320,197 +376,234 @@ static gint
 gst_compare_max (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     GstBuffer * buf2, GstCaps * caps2)
 {
-  gint i, delta = 0;
-  gint8 *data1, *data2;
+  GstCompareStats stats = { 0, };
   GstMapInfo map1, map2;
 
   gst_buffer_map (buf1, &map1, GST_MAP_READ);
   gst_buffer_map (buf2, &map2, GST_MAP_READ);
 
-  data1 = (gint8 *) map1.data;
-  data2 = (gint8 *) map2.data;
-
-  /* primitive loop */
-  for (i = 0; i < map1.size; i++) {
-    gint diff = ABS (*data1 - *data2);
-    if (diff > 0)
-      GST_LOG_OBJECT (comp, "diff at %d = %d", i, diff);
-    delta = MAX (delta, ABS (*data1 - *data2));
-    data1++;
-    data2++;
-  }
+  gst_compare_row_diff (map1.data, map2.data, map1.size, 1, &stats);
 
   gst_buffer_unmap (buf1, &map1);
   gst_buffer_unmap (buf2, &map2);
 
-  return delta;
+  return stats.max;
 }
 
-static double
-gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
-    gint width, gint height, gint step, gint stride)
+static void
+gst_compare_process_stripe (gpointer user_data, guint stripe, gint first,
+    gint last)
 {
-  gint count = 0, i, j;
-  gint sum1 = 0, sum2 = 0, ssum1 = 0, ssum2 = 0, acov = 0;
-  gdouble avg1, avg2, var1, var2, cov;
-
-  const gdouble k1 = 0.01;
-  const gdouble k2 = 0.03;
-  const gdouble L = 255.0;
-  const gdouble c1 = (k1 * L) * (k1 * L);
-  const gdouble c2 = (k2 * L) * (k2 * L);
-
-  /* For empty images, return maximum similarity */
-  if (height <= 0 || width <= 0)
-    return 1.0;
-
-  /* plain and simple; no fancy optimizations */
-  for (i = 0; i < height; i++) {
-    for (j = 0; j < width; j++) {
-      sum1 += *data1;
-      sum2 += *data2;
-      ssum1 += *data1 * *data1;
-      ssum2 += *data2 * *data2;
-      acov += *data1 * *data2;
-      count++;
-      data1 += step;
-      data2 += step;
-    }
-    data1 -= j * step;
-    data2 -= j * step;
-    data1 += stride;
-    data2 += stride;
+  GstCompareComponent *c = user_data;
+  GstCompareStats *stats = &c->stats[stripe];
+  const gint half = SSIM_WINDOW / 2;
+  gint i, j;
+
+  for (j = first; j < last; j++) {
+    gst_compare_row_diff (c->data1 + j * c->stride1,
+        c->data2 + j * c->stride2, c->width, c->step, stats);
   }
 
-  avg1 = sum1 / count;
-  avg2 = sum2 / count;
-  var1 = ssum1 / count - avg1 * avg1;
-  var2 = ssum2 / count - avg2 * avg2;
-  cov = acov / count - avg1 * avg2;
-
-  return (2 * avg1 * avg2 + c1) * (2 * cov + c2) /
-      ((avg1 * avg1 + avg2 * avg2 + c1) * (var1 + var2 + c2));
+  /* the half overlapping windows whose first row is in this stripe */
+  if (c->ssim) {
+    for (j = GST_ROUND_UP_N (first, half);
+        j < last && j + half < c->height; j += half) {
+      gdouble sum = 0;
+
+      for (i = 0; i + half < c->width; i += half) {
+        sum += gst_compare_ssim_window (c->data1 + c->step * i +
+            j * c->stride1, c->stride1, c->data2 + c->step * i +
+            j * c->stride2, c->stride2, MIN (SSIM_WINDOW, c->width - i),
+            MIN (SSIM_WINDOW, c->height - j), c->step);
+        stats->ssim_count++;
+      }
+      c->ssim_rows[j / half] = sum;
+    }
+  }
 }
 
-/* @width etc are for the particular component */
-static gdouble
-gst_compare_ssim_component (GstCompare * comp, guint8 * data1, guint8 * data2,
-    gint width, gint height, gint step, gint stride)
+/* compares one component in stripes of rows, possibly in threads */
+static void
+gst_compare_component (GstCompare * comp, GstVideoFrame * frame1,
+    GstVideoFrame * frame2, gint component, gboolean ssim,
+    GstCompareStats * stats)
 {
-  const gint window = 16;
-  gdouble ssim_sum = 0;
-  gint count = 0, i, j;
-
-  for (j = 0; j + (window / 2) < height; j += (window / 2)) {
-    for (i = 0; i + (window / 2) < width; i += (window / 2)) {
-      gdouble ssim;
-
-      ssim = gst_compare_ssim_window (comp, data1 + step * i + j * stride,
-          data2 + step * i + j * stride,
-          MIN (window, width - i), MIN (window, height - j), step, stride);
-      GST_LOG_OBJECT (comp, "ssim for %dx%d at (%d, %d) = %f", window, window,
-          i, j, ssim);
-      ssim_sum += ssim;
-      count++;
-    }
+  GstCompareComponent c;
+  gint n_rows = GST_VIDEO_FRAME_COMP_HEIGHT (frame1, component);
+  guint i, n_stripes, n_ssim_rows = 0;
+
+  GST_OBJECT_LOCK (comp);
+  n_stripes = gst_stripe_threads_get_n_stripes (&comp->threads, n_rows, 32);
+  GST_OBJECT_UNLOCK (comp);
+
+  c.data1 = GST_VIDEO_FRAME_COMP_DATA (frame1, component);
+  c.data2 = GST_VIDEO_FRAME_COMP_DATA (frame2, component);
+  c.stride1 = GST_VIDEO_FRAME_COMP_STRIDE (frame1, component);
+  c.stride2 = GST_VIDEO_FRAME_COMP_STRIDE (frame2, component);
+  c.step = GST_VIDEO_FRAME_COMP_PSTRIDE (frame1, component);
+  c.width = GST_VIDEO_FRAME_COMP_WIDTH (frame1, component);
+  c.height = n_rows;
+  c.ssim = ssim;
+  c.stats = g_newa (GstCompareStats, n_stripes);
+  memset (c.stats, 0, n_stripes * sizeof (GstCompareStats));
+  if (ssim && n_rows > SSIM_WINDOW / 2)
+    n_ssim_rows = (n_rows - 1) / (SSIM_WINDOW / 2);
+  c.ssim_rows = g_newa (gdouble, n_ssim_rows + 1);
+
+  gst_stripe_threads_run_stripes (&comp->threads, n_stripes, n_rows,
+      gst_compare_process_stripe, &c);
+
+  memset (stats, 0, sizeof (GstCompareStats));
+  for (i = 0; i < n_stripes; i++) {
+    stats->sad += c.stats[i].sad;
+    stats->ssd += c.stats[i].ssd;
+    stats->max = MAX (stats->max, c.stats[i].max);
+    stats->ssim_count += c.stats[i].ssim_count;
   }
+  for (i = 0; i < n_ssim_rows; i++)
+    stats->ssim_sum += c.ssim_rows[i];
+}
 
-  /* For empty images, return maximum similarity */
-  if (count == 0)
-    return 1.0;
+static gdouble
+gst_compare_psnr_from_mse (gdouble mse)
+{
+  if (mse <= 0)
+    return MAX_PSNR;
 
-  return (ssim_sum / count);
+  return MIN (10.0 * log10 (255.0 * 255.0 / mse), MAX_PSNR);
 }
 
-static gdouble
-gst_compare_ssim (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
-    GstBuffer * buf2, GstCaps * caps2)
+/* compares the visible area of raw video frames, @info1 and @info2 are
+ * known to have the same format and size */
+static gboolean
+gst_compare_video (GstCompare * comp, GstBuffer * buf1, GstVideoInfo * info1,
+    GstBuffer * buf2, GstVideoInfo * info2, gboolean ssim,
+    GstCompareResult * res)
 {
-  GstVideoInfo info1, info2;
   GstVideoFrame frame1, frame2;
+  gdouble mse = 0, mad = 0;
+  guint64 n_samples = 0;
   gint i, comps;
-  gdouble cssim[4], ssim, c[4] = { 1.0, 0.0, 0.0, 0.0 };
-
-  if (!caps1)
-    goto invalid_input;
 
-  if (!gst_video_info_from_caps (&info1, caps1))
-    goto invalid_input;
+  memset (res, 0, sizeof (GstCompareResult));
+  res->weight[0] = 1.0;
 
-  if (!caps2)
-    goto invalid_input;
-
-  if (!gst_video_info_from_caps (&info2, caps1))
-    goto invalid_input;
-
-  if (GST_VIDEO_INFO_FORMAT (&info1) != GST_VIDEO_INFO_FORMAT (&info2) ||
-      GST_VIDEO_INFO_WIDTH (&info1) != GST_VIDEO_INFO_WIDTH (&info2) ||
-      GST_VIDEO_INFO_HEIGHT (&info1) != GST_VIDEO_INFO_HEIGHT (&info2))
-    return comp->threshold + 1;
+  comps = GST_VIDEO_INFO_N_COMPONENTS (info1);
+  for (i = 0; i < comps; i++) {
+    /* only support most common formats */
+    if (GST_VIDEO_INFO_COMP_DEPTH (info1, i) != 8)
+      goto unsupported_input;
+  }
 
-  comps = GST_VIDEO_INFO_N_COMPONENTS (&info1);
   /* note that some are reported both yuv and gray */
   for (i = 0; i < comps; ++i)
-    c[i] = 1.0;
+    res->weight[i] = 1.0;
   /* increase luma weight if yuv */
-  if (GST_VIDEO_INFO_IS_YUV (&info1) && (comps > 1))
-    c[0] = comps - 1;
+  if (GST_VIDEO_INFO_IS_YUV (info1) && (comps > 1))
+    res->weight[0] = comps - 1;
   for (i = 0; i < comps; ++i)
-    c[i] /= (GST_VIDEO_INFO_IS_YUV (&info1) && (comps > 1)) ?
+    res->weight[i] /= (GST_VIDEO_INFO_IS_YUV (info1) && (comps > 1)) ?
         2 * (comps - 1) : comps;
 
-  gst_video_frame_map (&frame1, &info1, buf1, GST_MAP_READ);
-  gst_video_frame_map (&frame2, &info2, buf2, GST_MAP_READ);
+  if (!gst_video_frame_map (&frame1, info1, buf1, GST_MAP_READ))
+    goto map_failed;
+  if (!gst_video_frame_map (&frame2, info2, buf2, GST_MAP_READ)) {
+    gst_video_frame_unmap (&frame1);
+    goto map_failed;
+  }
 
+  res->n_comps = comps;
   for (i = 0; i < comps; i++) {
-    gint cw, ch, step, stride;
-
-    /* only support most common formats */
-    if (GST_VIDEO_INFO_COMP_DEPTH (&info1, i) != 8)
-      goto unsupported_input;
-    cw = GST_VIDEO_FRAME_COMP_WIDTH (&frame1, i);
-    ch = GST_VIDEO_FRAME_COMP_HEIGHT (&frame1, i);
-    step = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame1, i);
-    stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame1, i);
-
-    GST_LOG_OBJECT (comp, "component %d", i);
-    cssim[i] = gst_compare_ssim_component (comp,
-        GST_VIDEO_FRAME_COMP_DATA (&frame1, i),
-        GST_VIDEO_FRAME_COMP_DATA (&frame2, i), cw, ch, step, stride);
-    GST_LOG_OBJECT (comp, "ssim[%d] = %f", i, cssim[i]);
+    GstCompareStats stats;
+    guint64 n = (guint64) GST_VIDEO_FRAME_COMP_WIDTH (&frame1, i) *
+        GST_VIDEO_FRAME_COMP_HEIGHT (&frame1, i);
+
+    gst_compare_component (comp, &frame1, &frame2, i, ssim, &stats);
+
+    res->max = MAX (res->max, stats.max);
+    res->psnr[i] = gst_compare_psnr_from_mse (n ? (gdouble) stats.ssd / n : 0);
+    /* For empty images, return maximum similarity */
+    res->ssim[i] = stats.ssim_count ? stats.ssim_sum / stats.ssim_count : 1.0;
+    mse += res->weight[i] * (n ? (gdouble) stats.ssd / n : 0);
+    mad += stats.sad;
+    n_samples += n;
+
+    GST_LOG_OBJECT (comp, "component %d: max %u, psnr %f, ssim %f", i,
+        stats.max, res->psnr[i], res->ssim[i]);
   }
 
   gst_video_frame_unmap (&frame1);
   gst_video_frame_unmap (&frame2);
 
-#ifndef GST_DISABLE_GST_DEBUG
-  for (i = 0; i < 4; i++) {
-    GST_DEBUG_OBJECT (comp, "ssim[%d] = %f, c[%d] = %f", i, cssim[i], i, c[i]);
-  }
-#endif
+  res->ssim_total = 0;
+  for (i = 0; i < comps; i++)
+    res->ssim_total += res->ssim[i] * res->weight[i];
+  res->psnr_total = gst_compare_psnr_from_mse (mse);
+  res->mean_abs_diff = n_samples ? mad / n_samples : 0;
 
-  ssim = cssim[0] * c[0] + cssim[1] * c[1] + cssim[2] * c[2] + cssim[3] * c[3];
+  GST_DEBUG_OBJECT (comp, "max %u, mean abs diff %f, psnr %f, ssim %f",
+      res->max, res->mean_abs_diff, res->psnr_total, res->ssim_total);
 
-  return ssim;
+  return TRUE;
 
   /* ERRORS */
-invalid_input:
+unsupported_input:
   {
-    GST_ERROR_OBJECT (comp, "ssim method needs raw video input");
-    return 0;
+    GST_ERROR_OBJECT (comp, "raw video format %s not supported",
+        gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (info1)));
+    return FALSE;
   }
-unsupported_input:
+map_failed:
   {
-    GST_ERROR_OBJECT (comp, "raw video format not supported %" GST_PTR_FORMAT,
-        caps1);
-    return 0;
+    GST_ERROR_OBJECT (comp, "failed to map video frames");
+    return FALSE;
   }
 }
 
+static void
+gst_compare_post_stats (GstCompare * comp, GstBuffer * buf,
+    GstCompareResult * res, gboolean ssim)
+{
+  GValue psnr = G_VALUE_INIT, ssims = G_VALUE_INIT, v = G_VALUE_INIT;
+  GstStructure *s;
+  gint i;
+
+  g_value_init (&psnr, GST_TYPE_ARRAY);
+  g_value_init (&ssims, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < res->n_comps; i++) {
+    g_value_set_double (&v, res->psnr[i]);
+    gst_value_array_append_value (&psnr, &v);
+    g_value_set_double (&v, res->ssim[i]);
+    gst_value_array_append_value (&ssims, &v);
+  }
+  g_value_unset (&v);
+
+  s = gst_structure_new ("compare-stats",
+      "frame", G_TYPE_UINT64, comp->frames,
+      "timestamp", G_TYPE_UINT64, GST_BUFFER_PTS (buf),
+      "max", G_TYPE_INT, res->max,
+      "mean-abs-diff", G_TYPE_DOUBLE, res->mean_abs_diff,
+      "psnr", G_TYPE_DOUBLE, res->psnr_total, NULL);
+  gst_structure_take_value (s, "psnr-components", &psnr);
+  if (ssim) {
+    gst_structure_set (s, "ssim", G_TYPE_DOUBLE, res->ssim_total, NULL);
+    gst_structure_take_value (s, "ssim-components", &ssims);
+  } else {
+    g_value_unset (&ssims);
+  }
+
+  gst_element_post_message (GST_ELEMENT (comp),
+      gst_message_new_element (GST_OBJECT (comp), s));
+}
+
 static void
 gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     GstBuffer * buf2, GstCaps * caps2)
 {
+  GstVideoInfo info1, info2;
+  GstCompareResult res;
+  gboolean is_video, post_stats, ssim;
   gdouble delta = 0;
   gsize size1, size2;
 
@@ -518,21 +611,79 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
   gst_compare_meta (comp, buf1, caps1, buf2, caps2);
 
   size1 = gst_buffer_get_size (buf1);
-  size2 = gst_buffer_get_size (buf1);
+  size2 = gst_buffer_get_size (buf2);
 
-  /* check content according to method */
-  /* but at least size should match */
-  if (size1 != size2) {
-    delta = comp->threshold + 1;
-  } else {
+  is_video = caps1 && caps2 && gst_video_info_from_caps (&info1, caps1) &&
+      gst_video_info_from_caps (&info2, caps2);
+
+  GST_OBJECT_LOCK (comp);
+  post_stats = comp->post_stats;
+  GST_OBJECT_UNLOCK (comp);
+
+  comp->frames++;
+
+  {
     GstMapInfo map1, map2;
 
     gst_buffer_map (buf1, &map1, GST_MAP_READ);
     gst_buffer_map (buf2, &map2, GST_MAP_READ);
-    GST_MEMDUMP_OBJECT (comp, "buffer 1", map1.data, map2.size);
+    GST_MEMDUMP_OBJECT (comp, "buffer 1", map1.data, map1.size);
     GST_MEMDUMP_OBJECT (comp, "buffer 2", map2.data, map2.size);
     gst_buffer_unmap (buf1, &map1);
     gst_buffer_unmap (buf2, &map2);
+  }
+
+  /* check content according to method */
+  if (is_video) {
+    /* raw video is compared on the visible area, so the frames may differ
+     * in strides and padding but must have the same format and size */
+    if (GST_VIDEO_INFO_FORMAT (&info1) != GST_VIDEO_INFO_FORMAT (&info2) ||
+        GST_VIDEO_INFO_WIDTH (&info1) != GST_VIDEO_INFO_WIDTH (&info2) ||
+        GST_VIDEO_INFO_HEIGHT (&info1) != GST_VIDEO_INFO_HEIGHT (&info2))
+      goto mismatch;
+
+    if (comp->method == GST_COMPARE_METHOD_MEM && size1 == size2 &&
+        !post_stats) {
+      delta = gst_compare_mem (comp, buf1, caps1, buf2, caps2);
+    } else {
+      ssim = post_stats || comp->method == GST_COMPARE_METHOD_SSIM;
+      if (!gst_compare_video (comp, buf1, &info1, buf2, &info2, ssim, &res)) {
+        /* fall back to comparing bytes for the unsupported formats */
+        if (comp->method == GST_COMPARE_METHOD_SSIM ||
+            comp->method == GST_COMPARE_METHOD_PSNR)
+          delta = 0;
+        else if (size1 != size2)
+          goto mismatch;
+        else if (comp->method == GST_COMPARE_METHOD_MEM)
+          delta = gst_compare_mem (comp, buf1, caps1, buf2, caps2);
+        else
+          delta = gst_compare_max (comp, buf1, caps1, buf2, caps2);
+      } else {
+        switch (comp->method) {
+          case GST_COMPARE_METHOD_MEM:
+            delta = res.max ? 1 : 0;
+            break;
+          case GST_COMPARE_METHOD_MAX:
+            delta = res.max;
+            break;
+          case GST_COMPARE_METHOD_SSIM:
+            delta = res.ssim_total;
+            break;
+          case GST_COMPARE_METHOD_PSNR:
+            delta = res.psnr_total;
+            break;
+          default:
+            g_assert_not_reached ();
+            break;
+        }
+        if (post_stats)
+          gst_compare_post_stats (comp, buf1, &res, ssim);
+      }
+    }
+  } else if (size1 != size2) {
+    /* but at least size should match */
+    goto mismatch;
+  } else {
     switch (comp->method) {
       case GST_COMPARE_METHOD_MEM:
         delta = gst_compare_mem (comp, buf1, caps1, buf2, caps2);
@@ -541,7 +692,10 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
         delta = gst_compare_max (comp, buf1, caps1, buf2, caps2);
         break;
       case GST_COMPARE_METHOD_SSIM:
-        delta = gst_compare_ssim (comp, buf1, caps1, buf2, caps2);
+      case GST_COMPARE_METHOD_PSNR:
+        GST_ERROR_OBJECT (comp, "%s method needs raw video input",
+            comp->method == GST_COMPARE_METHOD_SSIM ? "ssim" : "psnr");
+        delta = 0;
         break;
       default:
         g_assert_not_reached ();
@@ -549,6 +703,13 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstCaps * caps1,
     }
   }
 
+  goto check;
+
+mismatch:
+  /* a delta that fails the match in either direction */
+  delta = comp->upper ? comp->threshold + 1 : comp->threshold - 1;
+
+check:
   if ((comp->upper && delta > comp->threshold) ||
       (!comp->upper && delta < comp->threshold)) {
     GST_WARNING_OBJECT (comp, "buffers %p and %p failed content match %f",
@@ -627,6 +788,16 @@ gst_compare_set_property (GObject * object, guint prop_id,
     case PROP_UPPER:
       comp->upper = g_value_get_boolean (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (comp);
+      comp->threads.n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (comp);
+      break;
+    case PROP_POST_STATS:
+      GST_OBJECT_LOCK (comp);
+      comp->post_stats = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (comp);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -655,6 +826,12 @@ gst_compare_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_UPPER:
       g_value_set_boolean (value, comp->upper);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, comp->threads.n_threads);
+      break;
+    case PROP_POST_STATS:
+      g_value_set_boolean (value, comp->post_stats);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -26,6 +26,7 @@
 
 
 #include <gst/gst.h>
+#include <gst/stripe-threads-private.h>
 
 G_BEGIN_DECLS
 
@@ -55,6 +56,10 @@ struct _GstCompare {
   GstCollectPads *cpads;
 
   gint count;
+  guint64 frames;
+
+  /* stripe threads, the n-threads property is threads.n_threads */
+  GstStripeThreads threads;
 
   /* properties */
   GstBufferCopyFlags meta;
@@ -62,6 +67,7 @@ struct _GstCompare {
   gint method;
   gdouble threshold;
   gboolean upper;
+  gboolean post_stats;
 };
 
 struct _GstCompareClass {
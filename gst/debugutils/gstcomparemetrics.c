@@ -0,0 +1,172 @@
+/* GStreamer
+ *
+ * gstcomparemetrics.c: difference and SSIM sums for compare
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "gstcomparemetrics.h"
+
+/* accumulates the absolute differences of @n samples @step bytes apart */
+void
+gst_compare_row_diff (const guint8 * s1, const guint8 * s2, gint n,
+    gint step, GstCompareStats * stats)
+{
+  guint64 sad = 0, ssd = 0;
+  guint max = stats->max;
+  gint i = 0;
+
+#if defined (__SSE2__)
+  if (step == 1 && n >= 16) {
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i vsad = zero, vssd = zero, vmax = zero;
+    guint64 t[2];
+    guint8 m[16];
+    gint k;
+
+    for (; i + 16 <= n; i += 16) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (s1 + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (s2 + i));
+      __m128i d = _mm_or_si128 (_mm_subs_epu8 (a, b), _mm_subs_epu8 (b, a));
+      __m128i lo = _mm_unpacklo_epi8 (d, zero);
+      __m128i hi = _mm_unpackhi_epi8 (d, zero);
+      __m128i sq = _mm_add_epi32 (_mm_madd_epi16 (lo, lo),
+          _mm_madd_epi16 (hi, hi));
+
+      vsad = _mm_add_epi64 (vsad, _mm_sad_epu8 (d, zero));
+      vmax = _mm_max_epu8 (vmax, d);
+      /* widen to 64 bits, long rows would overflow 32 bit lanes */
+      vssd = _mm_add_epi64 (vssd, _mm_unpacklo_epi32 (sq, zero));
+      vssd = _mm_add_epi64 (vssd, _mm_unpackhi_epi32 (sq, zero));
+    }
+
+    _mm_storeu_si128 ((__m128i *) t, vsad);
+    sad = t[0] + t[1];
+    _mm_storeu_si128 ((__m128i *) t, vssd);
+    ssd = t[0] + t[1];
+    _mm_storeu_si128 ((__m128i *) m, vmax);
+    for (k = 0; k < 16; k++)
+      max = MAX (max, m[k]);
+  }
+#endif
+
+  for (; i < n; i++) {
+    guint d = ABS (s1[i * step] - s2[i * step]);
+
+    sad += d;
+    ssd += d * d;
+    max = MAX (max, d);
+  }
+
+  stats->sad += sad;
+  stats->ssd += ssd;
+  stats->max = max;
+}
+
+/* the SSIM of one window of @width x @height samples */
+gdouble
+gst_compare_ssim_window (const guint8 * data1, gint stride1,
+    const guint8 * data2, gint stride2, gint width, gint height, gint step)
+{
+  guint64 sum1 = 0, sum2 = 0, ssum1 = 0, ssum2 = 0, acov = 0;
+  gdouble count, avg1, avg2, var1, var2, cov;
+  gint i, j;
+
+  const gdouble k1 = 0.01;
+  const gdouble k2 = 0.03;
+  const gdouble L = 255.0;
+  const gdouble c1 = (k1 * L) * (k1 * L);
+  const gdouble c2 = (k2 * L) * (k2 * L);
+
+  /* For empty images, return maximum similarity */
+  if (height <= 0 || width <= 0)
+    return 1.0;
+
+  i = 0;
+#if defined (__SSE2__)
+  /* full windows of packed samples, the common case */
+  if (step == 1 && width == SSIM_WINDOW) {
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i vsum1 = zero, vsum2 = zero;
+    __m128i vssum1 = zero, vssum2 = zero, vacov = zero;
+    guint64 t[2];
+    guint32 u[4];
+
+    for (; i < height; i++) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (data1 + i * stride1));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (data2 + i * stride2));
+      __m128i alo = _mm_unpacklo_epi8 (a, zero);
+      __m128i ahi = _mm_unpackhi_epi8 (a, zero);
+      __m128i blo = _mm_unpacklo_epi8 (b, zero);
+      __m128i bhi = _mm_unpackhi_epi8 (b, zero);
+
+      /* at most 16 rows of 4 * 255 * 255 per lane, fits 32 bits */
+      vsum1 = _mm_add_epi64 (vsum1, _mm_sad_epu8 (a, zero));
+      vsum2 = _mm_add_epi64 (vsum2, _mm_sad_epu8 (b, zero));
+      vssum1 = _mm_add_epi32 (vssum1, _mm_add_epi32 (_mm_madd_epi16 (alo,
+                  alo), _mm_madd_epi16 (ahi, ahi)));
+      vssum2 = _mm_add_epi32 (vssum2, _mm_add_epi32 (_mm_madd_epi16 (blo,
+                  blo), _mm_madd_epi16 (bhi, bhi)));
+      vacov = _mm_add_epi32 (vacov, _mm_add_epi32 (_mm_madd_epi16 (alo,
+                  blo), _mm_madd_epi16 (ahi, bhi)));
+    }
+
+    _mm_storeu_si128 ((__m128i *) t, vsum1);
+    sum1 = t[0] + t[1];
+    _mm_storeu_si128 ((__m128i *) t, vsum2);
+    sum2 = t[0] + t[1];
+    _mm_storeu_si128 ((__m128i *) u, vssum1);
+    ssum1 = (guint64) u[0] + u[1] + u[2] + u[3];
+    _mm_storeu_si128 ((__m128i *) u, vssum2);
+    ssum2 = (guint64) u[0] + u[1] + u[2] + u[3];
+    _mm_storeu_si128 ((__m128i *) u, vacov);
+    acov = (guint64) u[0] + u[1] + u[2] + u[3];
+  }
+#endif
+
+  for (; i < height; i++) {
+    const guint8 *s1 = data1 + i * stride1;
+    const guint8 *s2 = data2 + i * stride2;
+
+    for (j = 0; j < width; j++) {
+      guint a = s1[j * step], b = s2[j * step];
+
+      sum1 += a;
+      sum2 += b;
+      ssum1 += a * a;
+      ssum2 += b * b;
+      acov += a * b;
+    }
+  }
+
+  count = width * height;
+  avg1 = sum1 / count;
+  avg2 = sum2 / count;
+  var1 = ssum1 / count - avg1 * avg1;
+  var2 = ssum2 / count - avg2 * avg2;
+  cov = acov / count - avg1 * avg2;
+
+  return (2 * avg1 * avg2 + c1) * (2 * cov + c2) /
+      ((avg1 * avg1 + avg2 * avg2 + c1) * (var1 + var2 + c2));
+}
@@ -0,0 +1,49 @@
+/* GStreamer
+ *
+ * gstcomparemetrics.h: difference and SSIM sums for compare
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_COMPARE_METRICS_H__
+#define __GST_COMPARE_METRICS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* SSIM is averaged over windows overlapping by half */
+#define SSIM_WINDOW              16
+
+typedef struct
+{
+  guint64 sad;
+  guint64 ssd;
+  guint max;
+  gdouble ssim_sum;
+  guint ssim_count;
+} GstCompareStats;
+
+G_GNUC_INTERNAL
+void gst_compare_row_diff (const guint8 * s1, const guint8 * s2, gint n,
+    gint step, GstCompareStats * stats);
+
+G_GNUC_INTERNAL
+gdouble gst_compare_ssim_window (const guint8 * data1, gint stride1,
+    const guint8 * data2, gint stride2, gint width, gint height, gint step);
+
+G_END_DECLS
+#endif /* __GST_COMPARE_METRICS_H__ */
@@ -0,0 +1,696 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+/**
+ * SECTION:element-latencyhistogram
+ * @title: latencyhistogram
+ *
+ * The latencyhistogram element measures how long buffers take to get
+ * through other elements of the pipeline. Buffers are stamped when they
+ * enter one of the elements or bins named in the elements property and
+ * matched by timestamp when they leave it again.
+ *
+ * For each element two histograms are kept: the latency, from entering to
+ * leaving the element, and the processing time, which leaves out the time
+ * a buffer waited for the element to finish with the previous one. The
+ * histograms use logarithmic buckets with 8 linear sub-buckets each, so
+ * the reported percentiles are within 12.5% of the real values.
+ *
+ * Every interval, an element message named "latency-histogram" is posted
+ * on the bus. It contains one structure per measured element with the
+ * number of buffers and the 50th, 90th and 99th percentiles and the
+ * maximum of both histograms in nanoseconds, for the buffers since the
+ * previous message. The same structure can be read from the stats
+ * property.
+ *
+ * The element itself passes buffers through untouched and can be put
+ * anywhere in the pipeline.
+ *
+ * ## Example launch line
+ * |[
+ * gst-launch-1.0 -m videotestsrc ! x264enc name=enc ! latencyhistogram elements=enc ! fakesink
+ * ]|
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include "gstlatencyhistogram.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_latency_histogram_debug_category);
+#define GST_CAT_DEFAULT gst_latency_histogram_debug_category
+
+/* values below 2^SUB_BITS microseconds get a bucket each, above every power
+ * of two is split in 2^SUB_BITS linear buckets */
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_N_BUCKETS ((32 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+/* number of entry stamps remembered per element, buffers that stay longer
+ * in an element than it takes this many others to enter aren't measured */
+#define N_STAMPS 64
+
+typedef struct
+{
+  volatile gint count;
+  volatile gint max;            /* in microseconds */
+  volatile gint buckets[HISTOGRAM_N_BUCKETS];
+} GstLatencyHistogramCounts;
+
+typedef struct
+{
+  volatile gint ref_count;
+
+  GstElement *element;
+  gulong pad_added_id;
+
+  /* protected by the object lock of element */
+  GPtrArray *pads;
+  GArray *probe_ids;
+
+  /* protected by lock */
+  GMutex lock;
+  GstClockTime stamp_ts[N_STAMPS];
+  GstClockTime stamp_time[N_STAMPS];
+  guint next_stamp;
+  GstClockTime last_exit;
+
+  GstLatencyHistogramCounts latency;
+  GstLatencyHistogramCounts processing;
+} GstLatencyHistogramTarget;
+
+/* prototypes */
+
+static void gst_latency_histogram_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_latency_histogram_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_latency_histogram_finalize (GObject * object);
+
+static GstStateChangeReturn
+gst_latency_histogram_change_state (GstElement * element,
+    GstStateChange transition);
+
+enum
+{
+  PROP_0,
+  PROP_ELEMENTS,
+  PROP_INTERVAL,
+  PROP_STATS
+};
+
+#define DEFAULT_ELEMENTS NULL
+#define DEFAULT_INTERVAL GST_SECOND
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE (GstLatencyHistogram, gst_latency_histogram,
+    GST_TYPE_BASE_TRANSFORM,
+    GST_DEBUG_CATEGORY_INIT (gst_latency_histogram_debug_category,
+        "latencyhistogram", 0, "debug category for latencyhistogram element"));
+
+static void
+gst_latency_histogram_class_init (GstLatencyHistogramClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_klass = (GstElementClass *) klass;
+
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
+      gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+          gst_caps_new_any ()));
+
+  gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
+      "Latency histogram", "Generic",
+      "Keeps latency histograms of other elements in the pipeline",
+      "The GStreamer developers");
+
+  gstelement_klass->change_state =
+      GST_DEBUG_FUNCPTR (gst_latency_histogram_change_state);
+  gobject_class->set_property = gst_latency_histogram_set_property;
+  gobject_class->get_property = gst_latency_histogram_get_property;
+  gobject_class->finalize = gst_latency_histogram_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_ELEMENTS,
+      g_param_spec_string ("elements", "Elements",
+          "Comma separated names of the elements or bins to measure",
+          DEFAULT_ELEMENTS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_INTERVAL,
+      g_param_spec_uint64 ("interval", "Interval",
+          "Interval in nanoseconds between latency-histogram messages, "
+          "0 means no messages", 0, G_MAXUINT64, DEFAULT_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Latency percentiles of the measured elements since the last "
+          "message", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_latency_histogram_init (GstLatencyHistogram * histogram)
+{
+  gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (histogram), TRUE);
+
+  histogram->elements = g_strdup (DEFAULT_ELEMENTS);
+  histogram->interval = DEFAULT_INTERVAL;
+  histogram->targets = g_ptr_array_new ();
+}
+
+static void
+gst_latency_histogram_finalize (GObject * object)
+{
+  GstLatencyHistogram *histogram = GST_LATENCY_HISTOGRAM (object);
+
+  g_free (histogram->elements);
+  g_ptr_array_unref (histogram->targets);
+
+  G_OBJECT_CLASS (gst_latency_histogram_parent_class)->finalize (object);
+}
+
+static guint
+histogram_bucket (guint32 us)
+{
+  guint shift;
+
+  if (us < HISTOGRAM_SUB_BUCKETS)
+    return us;
+
+  shift = g_bit_storage (us) - 1 - HISTOGRAM_SUB_BITS;
+
+  return (shift + 1) * HISTOGRAM_SUB_BUCKETS +
+      ((us >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/* middle of the range of values counted in bucket, in nanoseconds */
+static GstClockTime
+histogram_bucket_value (guint bucket)
+{
+  guint shift;
+  guint64 low;
+
+  if (bucket < HISTOGRAM_SUB_BUCKETS)
+    return bucket * GST_USECOND;
+
+  shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  low = (guint64) (HISTOGRAM_SUB_BUCKETS +
+      bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+
+  return (low * 2 + (G_GUINT64_CONSTANT (1) << shift)) * GST_USECOND / 2;
+}
+
+/* can be called from any number of threads at once */
+static void
+histogram_add (GstLatencyHistogramCounts * counts, GstClockTime time)
+{
+  gint us = MIN (time / GST_USECOND, G_MAXINT);
+  gint max;
+
+  g_atomic_int_inc (&counts->buckets[histogram_bucket (us)]);
+  g_atomic_int_inc (&counts->count);
+
+  do {
+    max = g_atomic_int_get (&counts->max);
+  } while (us > max && !g_atomic_int_compare_and_exchange (&counts->max, max,
+          us));
+}
+
+/* Takes the counts gathered so far and starts over. Values added meanwhile
+ * end up in either of the two windows. */
+static void
+histogram_take (GstLatencyHistogramCounts * counts, gint * buckets,
+    gint * count, gint * max)
+{
+  guint i;
+
+  *count = 0;
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i++) {
+    buckets[i] = g_atomic_int_and ((volatile guint *) &counts->buckets[i], 0);
+    *count += buckets[i];
+  }
+  g_atomic_int_and ((volatile guint *) &counts->count, 0);
+  *max = g_atomic_int_and ((volatile guint *) &counts->max, 0);
+}
+
+static GstClockTime
+histogram_percentile (const gint * buckets, gint count, guint percent)
+{
+  gint64 wanted = ((gint64) count * percent + 99) / 100;
+  gint64 seen = 0;
+  guint i;
+
+  if (count == 0)
+    return GST_CLOCK_TIME_NONE;
+
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= wanted)
+      return histogram_bucket_value (i);
+  }
+
+  return histogram_bucket_value (HISTOGRAM_N_BUCKETS - 1);
+}
+
+static void
+histogram_append_stats (GstLatencyHistogramCounts * counts,
+    GstStructure * s, const gchar * prefix)
+{
+  gint buckets[HISTOGRAM_N_BUCKETS];
+  gchar *p50, *p90, *p99, *max_name;
+  gint count, max;
+
+  histogram_take (counts, buckets, &count, &max);
+
+  p50 = g_strconcat (prefix, "-p50", NULL);
+  p90 = g_strconcat (prefix, "-p90", NULL);
+  p99 = g_strconcat (prefix, "-p99", NULL);
+  max_name = g_strconcat (prefix, "-max", NULL);
+
+  gst_structure_set (s,
+      p50, G_TYPE_UINT64, histogram_percentile (buckets, count, 50),
+      p90, G_TYPE_UINT64, histogram_percentile (buckets, count, 90),
+      p99, G_TYPE_UINT64, histogram_percentile (buckets, count, 99),
+      max_name, G_TYPE_UINT64, count ? max * GST_USECOND : GST_CLOCK_TIME_NONE,
+      NULL);
+
+  /* both histograms get a value for every buffer */
+  if (!gst_structure_has_field (s, "count"))
+    gst_structure_set (s, "count", G_TYPE_UINT, (guint) count, NULL);
+
+  g_free (p50);
+  g_free (p90);
+  g_free (p99);
+  g_free (max_name);
+}
+
+static GstLatencyHistogramTarget *
+target_ref (GstLatencyHistogramTarget * target)
+{
+  g_atomic_int_inc (&target->ref_count);
+
+  return target;
+}
+
+static void
+target_unref (GstLatencyHistogramTarget * target)
+{
+  if (!g_atomic_int_dec_and_test (&target->ref_count))
+    return;
+
+  gst_object_unref (target->element);
+  g_ptr_array_unref (target->pads);
+  g_array_unref (target->probe_ids);
+  g_mutex_clear (&target->lock);
+  g_free (target);
+}
+
+static GstClockTime
+buffer_probe_get_ts (GstPadProbeInfo * info)
+{
+  GstBuffer *buffer;
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+
+    if (gst_buffer_list_length (list) == 0)
+      return GST_CLOCK_TIME_NONE;
+    buffer = gst_buffer_list_get (list, 0);
+  } else {
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  }
+
+  if (GST_BUFFER_PTS_IS_VALID (buffer))
+    return GST_BUFFER_PTS (buffer);
+
+  return GST_BUFFER_DTS (buffer);
+}
+
+static GstPadProbeReturn
+target_sink_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstLatencyHistogramTarget *target = user_data;
+  GstClockTime ts = buffer_probe_get_ts (info);
+
+  if (!GST_CLOCK_TIME_IS_VALID (ts))
+    return GST_PAD_PROBE_OK;
+
+  g_mutex_lock (&target->lock);
+  target->stamp_ts[target->next_stamp] = ts;
+  target->stamp_time[target->next_stamp] = gst_util_get_timestamp ();
+  target->next_stamp = (target->next_stamp + 1) % N_STAMPS;
+  g_mutex_unlock (&target->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+target_src_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstLatencyHistogramTarget *target = user_data;
+  GstClockTime ts = buffer_probe_get_ts (info);
+  GstClockTime now, entry = GST_CLOCK_TIME_NONE, start;
+  guint i, idx;
+
+  if (!GST_CLOCK_TIME_IS_VALID (ts))
+    return GST_PAD_PROBE_OK;
+
+  now = gst_util_get_timestamp ();
+
+  g_mutex_lock (&target->lock);
+  /* newest first, buffers mostly leave right after entering */
+  for (i = 1; i <= N_STAMPS; i++) {
+    idx = (target->next_stamp + N_STAMPS - i) % N_STAMPS;
+    if (target->stamp_ts[idx] == ts) {
+      entry = target->stamp_time[idx];
+      /* only measure the first buffer leaving for this one */
+      target->stamp_ts[idx] = GST_CLOCK_TIME_NONE;
+      break;
+    }
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID (entry)) {
+    g_mutex_unlock (&target->lock);
+    return GST_PAD_PROBE_OK;
+  }
+
+  start = entry;
+  if (GST_CLOCK_TIME_IS_VALID (target->last_exit) && target->last_exit > start)
+    start = target->last_exit;
+  target->last_exit = now;
+  g_mutex_unlock (&target->lock);
+
+  histogram_add (&target->latency, now - entry);
+  histogram_add (&target->processing, now - start);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* call with the object lock of the target element */
+static void
+target_add_pad (GstLatencyHistogramTarget * target, GstPad * pad)
+{
+  gulong id;
+
+  id = gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      GST_PAD_IS_SINK (pad) ? target_sink_probe : target_src_probe,
+      target_ref (target), (GDestroyNotify) target_unref);
+
+  g_ptr_array_add (target->pads, gst_object_ref (pad));
+  g_array_append_val (target->probe_ids, id);
+}
+
+static void
+target_pad_added_cb (GstElement * element, GstPad * pad,
+    GstLatencyHistogramTarget * target)
+{
+  GST_OBJECT_LOCK (element);
+  target_add_pad (target, pad);
+  GST_OBJECT_UNLOCK (element);
+}
+
+static GstLatencyHistogramTarget *
+target_new (GstElement * element)
+{
+  GstLatencyHistogramTarget *target = g_new0 (GstLatencyHistogramTarget, 1);
+  GList *l;
+  guint i;
+
+  target->ref_count = 1;
+  target->element = gst_object_ref (element);
+  target->pads = g_ptr_array_new_with_free_func (gst_object_unref);
+  target->probe_ids = g_array_new (FALSE, FALSE, sizeof (gulong));
+  g_mutex_init (&target->lock);
+  for (i = 0; i < N_STAMPS; i++)
+    target->stamp_ts[i] = GST_CLOCK_TIME_NONE;
+  target->last_exit = GST_CLOCK_TIME_NONE;
+
+  GST_OBJECT_LOCK (element);
+  for (l = element->sinkpads; l; l = l->next)
+    target_add_pad (target, l->data);
+  for (l = element->srcpads; l; l = l->next)
+    target_add_pad (target, l->data);
+  GST_OBJECT_UNLOCK (element);
+
+  target->pad_added_id = g_signal_connect_data (element, "pad-added",
+      G_CALLBACK (target_pad_added_cb), target_ref (target),
+      (GClosureNotify) target_unref, 0);
+
+  return target;
+}
+
+static void
+target_free (GstLatencyHistogramTarget * target)
+{
+  guint i;
+
+  g_signal_handler_disconnect (target->element, target->pad_added_id);
+
+  GST_OBJECT_LOCK (target->element);
+  for (i = 0; i < target->pads->len; i++)
+    gst_pad_remove_probe (g_ptr_array_index (target->pads, i),
+        g_array_index (target->probe_ids, gulong, i));
+  GST_OBJECT_UNLOCK (target->element);
+
+  /* probes that are running keep their own reference */
+  target_unref (target);
+}
+
+static void
+gst_latency_histogram_add_targets (GstLatencyHistogram * histogram)
+{
+  GstObject *top = GST_OBJECT (histogram), *parent;
+  gchar **names;
+  guint i;
+
+  while ((parent = gst_object_get_parent (top))) {
+    if (top != GST_OBJECT (histogram))
+      gst_object_unref (top);
+    top = parent;
+  }
+
+  if (top == GST_OBJECT (histogram) || !GST_IS_BIN (top)) {
+    GST_WARNING_OBJECT (histogram, "Not in a bin, nothing to measure");
+    goto done;
+  }
+
+  GST_OBJECT_LOCK (histogram);
+  names = g_strsplit (histogram->elements ? histogram->elements : "", ",", -1);
+  GST_OBJECT_UNLOCK (histogram);
+
+  for (i = 0; names[i]; i++) {
+    GstElement *element;
+
+    g_strstrip (names[i]);
+    if (!names[i][0])
+      continue;
+
+    element = gst_bin_get_by_name (GST_BIN (top), names[i]);
+    if (!element) {
+      GST_WARNING_OBJECT (histogram, "No element named '%s'", names[i]);
+      continue;
+    }
+
+    GST_DEBUG_OBJECT (histogram, "Measuring %" GST_PTR_FORMAT, element);
+    GST_OBJECT_LOCK (histogram);
+    g_ptr_array_add (histogram->targets, target_new (element));
+    GST_OBJECT_UNLOCK (histogram);
+    gst_object_unref (element);
+  }
+  g_strfreev (names);
+
+done:
+  if (top != GST_OBJECT (histogram))
+    gst_object_unref (top);
+}
+
+static void
+gst_latency_histogram_remove_targets (GstLatencyHistogram * histogram)
+{
+  GPtrArray *targets;
+
+  GST_OBJECT_LOCK (histogram);
+  targets = histogram->targets;
+  histogram->targets = g_ptr_array_new ();
+  GST_OBJECT_UNLOCK (histogram);
+
+  g_ptr_array_foreach (targets, (GFunc) target_free, NULL);
+  g_ptr_array_unref (targets);
+}
+
+static GstStructure *
+gst_latency_histogram_get_stats (GstLatencyHistogram * histogram)
+{
+  GstStructure *stats = gst_structure_new_empty ("latency-histogram");
+  guint i;
+
+  GST_OBJECT_LOCK (histogram);
+  for (i = 0; i < histogram->targets->len; i++) {
+    GstLatencyHistogramTarget *target =
+        g_ptr_array_index (histogram->targets, i);
+    GstStructure *s = gst_structure_new_empty ("element-latency");
+    gchar *name = gst_object_get_name (GST_OBJECT (target->element));
+
+    histogram_append_stats (&target->latency, s, "latency");
+    histogram_append_stats (&target->processing, s, "processing");
+
+    gst_structure_set (stats, name, GST_TYPE_STRUCTURE, s, NULL);
+    gst_structure_free (s);
+    g_free (name);
+  }
+  GST_OBJECT_UNLOCK (histogram);
+
+  return stats;
+}
+
+static gboolean
+gst_latency_histogram_report (GstClock * clock, GstClockTime time,
+    GstClockID id, gpointer user_data)
+{
+  GstLatencyHistogram *histogram = GST_LATENCY_HISTOGRAM (user_data);
+
+  gst_element_post_message (GST_ELEMENT_CAST (histogram),
+      gst_message_new_element (GST_OBJECT_CAST (histogram),
+          gst_latency_histogram_get_stats (histogram)));
+
+  return TRUE;
+}
+
+static void
+gst_latency_histogram_start_reports (GstLatencyHistogram * histogram)
+{
+  GstClockTime interval;
+
+  GST_OBJECT_LOCK (histogram);
+  interval = histogram->interval;
+  GST_OBJECT_UNLOCK (histogram);
+
+  if (interval == 0)
+    return;
+
+  /* not tied to the pipeline clock so reports continue while paused */
+  histogram->report_clock = gst_system_clock_obtain ();
+  histogram->report_id = gst_clock_new_periodic_id (histogram->report_clock,
+      gst_clock_get_time (histogram->report_clock) + interval, interval);
+  gst_clock_id_wait_async (histogram->report_id, gst_latency_histogram_report,
+      gst_object_ref (histogram), gst_object_unref);
+}
+
+static void
+gst_latency_histogram_stop_reports (GstLatencyHistogram * histogram)
+{
+  if (histogram->report_id) {
+    gst_clock_id_unschedule (histogram->report_id);
+    gst_clock_id_unref (histogram->report_id);
+    histogram->report_id = NULL;
+  }
+  if (histogram->report_clock) {
+    gst_object_unref (histogram->report_clock);
+    histogram->report_clock = NULL;
+  }
+}
+
+void
+gst_latency_histogram_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstLatencyHistogram *histogram = GST_LATENCY_HISTOGRAM (object);
+
+  switch (property_id) {
+    case PROP_ELEMENTS:
+      GST_OBJECT_LOCK (histogram);
+      g_free (histogram->elements);
+      histogram->elements = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (histogram);
+      break;
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (histogram);
+      histogram->interval = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (histogram);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+void
+gst_latency_histogram_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstLatencyHistogram *histogram = GST_LATENCY_HISTOGRAM (object);
+
+  switch (property_id) {
+    case PROP_ELEMENTS:
+      GST_OBJECT_LOCK (histogram);
+      g_value_set_string (value, histogram->elements);
+      GST_OBJECT_UNLOCK (histogram);
+      break;
+    case PROP_INTERVAL:
+      GST_OBJECT_LOCK (histogram);
+      g_value_set_uint64 (value, histogram->interval);
+      GST_OBJECT_UNLOCK (histogram);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_latency_histogram_get_stats (histogram));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+/*
+ * Change state handler for the element.
+ */
+static GstStateChangeReturn
+gst_latency_histogram_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstStateChangeReturn ret = GST_STATE_CHANGE_SUCCESS;
+  GstLatencyHistogram *histogram = GST_LATENCY_HISTOGRAM (element);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_latency_histogram_add_targets (histogram);
+      gst_latency_histogram_start_reports (histogram);
+      break;
+    default:
+      break;
+  }
+
+  ret =
+      GST_ELEMENT_CLASS (gst_latency_histogram_parent_class)->change_state
+      (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_latency_histogram_stop_reports (histogram);
+      gst_latency_histogram_remove_targets (histogram);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
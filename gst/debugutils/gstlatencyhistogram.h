@@ -0,0 +1,59 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef _GST_LATENCY_HISTOGRAM_H_
+#define _GST_LATENCY_HISTOGRAM_H_
+
+#include <gst/base/gstbasetransform.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_LATENCY_HISTOGRAM   (gst_latency_histogram_get_type())
+#define GST_LATENCY_HISTOGRAM(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_LATENCY_HISTOGRAM,GstLatencyHistogram))
+#define GST_LATENCY_HISTOGRAM_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_LATENCY_HISTOGRAM,GstLatencyHistogramClass))
+#define GST_IS_LATENCY_HISTOGRAM(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_LATENCY_HISTOGRAM))
+#define GST_IS_LATENCY_HISTOGRAM_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_LATENCY_HISTOGRAM))
+
+typedef struct _GstLatencyHistogram GstLatencyHistogram;
+typedef struct _GstLatencyHistogramClass GstLatencyHistogramClass;
+
+struct _GstLatencyHistogram
+{
+  GstBaseTransform base_latency_histogram;
+
+  /* properties */
+  gchar *elements;
+  GstClockTime interval;
+
+  /* GstLatencyHistogramTarget, protected by the object lock */
+  GPtrArray *targets;
+
+  GstClock *report_clock;
+  GstClockID report_id;
+};
+
+struct _GstLatencyHistogramClass
+{
+  GstBaseTransformClass base_latency_histogram_class;
+};
+
+GType gst_latency_histogram_get_type (void);
+
+G_END_DECLS
+
+#endif
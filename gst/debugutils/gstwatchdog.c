@@ -33,6 +33,13 @@
  * This element is currently intended for transcoding pipelines,
  * although may be useful in other contexts.
  *
+ * To help finding out why the pipeline stalled, the watchdog keeps
+ * statistics of all pads in its parent bin: when the last buffer passed
+ * and the buffer rate. These and the levels of queues are added to the
+ * error message. With the soft property set, warnings are posted instead of
+ * errors, and the min-rate property makes the watchdog warn when fewer
+ * buffers than that pass it per second.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -v fakesrc ! watchdog ! fakesink
@@ -75,9 +82,35 @@ gst_watchdog_change_state (GstElement * element, GstStateChange transition);
 enum
 {
   PROP_0,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_SOFT,
+  PROP_MIN_RATE,
+  PROP_DIAGNOSTICS,
+  PROP_DUMP_THREADS
 };
 
+#define DEFAULT_SOFT FALSE
+#define DEFAULT_MIN_RATE 0.0
+#define DEFAULT_DIAGNOSTICS TRUE
+#define DEFAULT_DUMP_THREADS FALSE
+
+/* interval in ms at which buffer rates are updated */
+#define STATS_INTERVAL 1000
+
+typedef struct
+{
+  volatile gint ref_count;
+
+  GstPad *pad;
+  gulong probe_id;
+
+  volatile gint buffers;
+  volatile gint last_buffer_ms;   /* since start_time, -1 if none yet */
+
+  gint prev_buffers;
+  gdouble rate;
+} GstWatchdogPadStats;
+
 /* class initialization */
 
 G_DEFINE_TYPE_WITH_CODE (GstWatchdog, gst_watchdog, GST_TYPE_BASE_TRANSFORM,
@@ -121,12 +154,34 @@ gst_watchdog_class_init (GstWatchdogClass * klass)
           "which an element error is sent to the bus if no buffers are "
           "received. 0 means disabled.", 0, G_MAXINT, 1000,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_SOFT,
+      g_param_spec_boolean ("soft", "Soft",
+          "Post warning messages instead of errors", DEFAULT_SOFT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MIN_RATE,
+      g_param_spec_double ("min-rate", "Minimum rate",
+          "Post a warning when less buffers per second pass while playing. "
+          "0 means disabled.", 0.0, G_MAXDOUBLE, DEFAULT_MIN_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DIAGNOSTICS,
+      g_param_spec_boolean ("diagnostics", "Diagnostics",
+          "Keep flow statistics of all pads in the parent bin and add them "
+          "to the messages", DEFAULT_DIAGNOSTICS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DUMP_THREADS,
+      g_param_spec_boolean ("dump-threads", "Dump threads",
+          "Add the state of the streaming threads to the messages",
+          DEFAULT_DUMP_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
 }
 
 static void
 gst_watchdog_init (GstWatchdog * watchdog)
 {
+  watchdog->soft = DEFAULT_SOFT;
+  watchdog->min_rate = DEFAULT_MIN_RATE;
+  watchdog->diagnostics = DEFAULT_DIAGNOSTICS;
+  watchdog->dump_threads = DEFAULT_DUMP_THREADS;
 }
 
 void
@@ -144,6 +199,26 @@ gst_watchdog_set_property (GObject * object, guint property_id,
       gst_watchdog_feed (watchdog, NULL, FALSE);
       GST_OBJECT_UNLOCK (watchdog);
       break;
+    case PROP_SOFT:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->soft = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
+    case PROP_MIN_RATE:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->min_rate = g_value_get_double (value);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
+    case PROP_DIAGNOSTICS:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->diagnostics = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
+    case PROP_DUMP_THREADS:
+      GST_OBJECT_LOCK (watchdog);
+      watchdog->dump_threads = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (watchdog);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -162,6 +237,18 @@ gst_watchdog_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_int (value, watchdog->timeout);
       break;
+    case PROP_SOFT:
+      g_value_set_boolean (value, watchdog->soft);
+      break;
+    case PROP_MIN_RATE:
+      g_value_set_double (value, watchdog->min_rate);
+      break;
+    case PROP_DIAGNOSTICS:
+      g_value_set_boolean (value, watchdog->diagnostics);
+      break;
+    case PROP_DUMP_THREADS:
+      g_value_set_boolean (value, watchdog->dump_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -182,15 +269,312 @@ gst_watchdog_thread (gpointer user_data)
   return NULL;
 }
 
+static gint
+gst_watchdog_now_ms (GstWatchdog * watchdog)
+{
+  return (g_get_monotonic_time () - watchdog->start_time) / 1000;
+}
+
+static GstWatchdogPadStats *
+pad_stats_ref (GstWatchdogPadStats * stats)
+{
+  g_atomic_int_inc (&stats->ref_count);
+
+  return stats;
+}
+
+static void
+pad_stats_unref (GstWatchdogPadStats * stats)
+{
+  if (!g_atomic_int_dec_and_test (&stats->ref_count))
+    return;
+
+  gst_object_unref (stats->pad);
+  g_free (stats);
+}
+
+static void
+pad_stats_free (GstWatchdogPadStats * stats)
+{
+  gst_pad_remove_probe (stats->pad, stats->probe_id);
+  pad_stats_unref (stats);
+}
+
+static GstPadProbeReturn
+gst_watchdog_pad_stats_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstWatchdogPadStats *stats = user_data;
+  GstWatchdog *watchdog = GST_WATCHDOG (g_object_get_data (G_OBJECT (pad),
+          "watchdog"));
+  guint n = 1;
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST)
+    n = gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+
+  g_atomic_int_add (&stats->buffers, n);
+  if (watchdog)
+    g_atomic_int_set (&stats->last_buffer_ms, gst_watchdog_now_ms (watchdog));
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+gst_watchdog_add_pad_stats (const GValue * item, gpointer user_data)
+{
+  GstWatchdog *watchdog = GST_WATCHDOG (user_data);
+  GstPad *pad = g_value_get_object (item);
+  GstWatchdogPadStats *stats = g_new0 (GstWatchdogPadStats, 1);
+
+  stats->ref_count = 1;
+  stats->pad = gst_object_ref (pad);
+  stats->last_buffer_ms = -1;
+  /* not a reference, the pad stats are removed before the watchdog goes */
+  g_object_set_data (G_OBJECT (pad), "watchdog", watchdog);
+  stats->probe_id = gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      gst_watchdog_pad_stats_probe, pad_stats_ref (stats),
+      (GDestroyNotify) pad_stats_unref);
+
+  g_ptr_array_add (watchdog->pad_stats, stats);
+}
+
+static void
+gst_watchdog_add_element_stats (const GValue * item, gpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  GstIterator *it;
+
+  it = gst_element_iterate_pads (element);
+  while (gst_iterator_foreach (it, gst_watchdog_add_pad_stats,
+          user_data) == GST_ITERATOR_RESYNC)
+    gst_iterator_resync (it);
+  gst_iterator_free (it);
+}
+
+static void
+gst_watchdog_start_stats (GstWatchdog * watchdog)
+{
+  GstObject *parent;
+  GstIterator *it;
+
+  watchdog->start_time = g_get_monotonic_time ();
+  watchdog->last_stats_time = 0;
+  watchdog->buffers = 0;
+  watchdog->prev_buffers = 0;
+  watchdog->rate = 0.0;
+  watchdog->below_min_rate = FALSE;
+  watchdog->pad_stats =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) pad_stats_free);
+
+  if (!watchdog->diagnostics)
+    return;
+
+  parent = gst_object_get_parent (GST_OBJECT (watchdog));
+  if (!parent)
+    return;
+
+  if (GST_IS_BIN (parent)) {
+    it = gst_bin_iterate_recurse (GST_BIN (parent));
+    while (gst_iterator_foreach (it, gst_watchdog_add_element_stats,
+            watchdog) == GST_ITERATOR_RESYNC) {
+      g_ptr_array_set_size (watchdog->pad_stats, 0);
+      gst_iterator_resync (it);
+    }
+    gst_iterator_free (it);
+  }
+  gst_object_unref (parent);
+
+  GST_DEBUG_OBJECT (watchdog, "keeping statistics of %u pads",
+      watchdog->pad_stats->len);
+}
+
+static void
+gst_watchdog_stop_stats (GstWatchdog * watchdog)
+{
+  guint i;
+
+  if (!watchdog->pad_stats)
+    return;
+
+  for (i = 0; i < watchdog->pad_stats->len; i++) {
+    GstWatchdogPadStats *stats = g_ptr_array_index (watchdog->pad_stats, i);
+
+    g_object_set_data (G_OBJECT (stats->pad), "watchdog", NULL);
+  }
+  g_ptr_array_unref (watchdog->pad_stats);
+  watchdog->pad_stats = NULL;
+}
+
+static const gchar *
+gst_watchdog_task_state_name (GstTaskState state)
+{
+  switch (state) {
+    case GST_TASK_STARTED:
+      return "started";
+    case GST_TASK_STOPPED:
+      return "stopped";
+    case GST_TASK_PAUSED:
+      return "paused";
+  }
+
+  return "unknown";
+}
+
+static void
+gst_watchdog_append_queue_level (const GValue * item, gpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  GString *report = user_data;
+  guint buffers, bytes;
+  guint64 time;
+
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+          "current-level-buffers"))
+    return;
+
+  g_object_get (element, "current-level-buffers", &buffers,
+      "current-level-bytes", &bytes, "current-level-time", &time, NULL);
+  g_string_append_printf (report, "\n  queue %s: %u buffers, %u bytes, %"
+      GST_TIME_FORMAT, GST_OBJECT_NAME (element), buffers, bytes,
+      GST_TIME_ARGS (time));
+}
+
+/* Called from the watchdog thread */
+static gchar *
+gst_watchdog_get_report (GstWatchdog * watchdog, const gchar * reason)
+{
+  GString *report = g_string_new (reason);
+  gint now = gst_watchdog_now_ms (watchdog);
+  gboolean dump_threads;
+  GstObject *parent;
+  guint i;
+
+  GST_OBJECT_LOCK (watchdog);
+  dump_threads = watchdog->dump_threads;
+  GST_OBJECT_UNLOCK (watchdog);
+
+  if (!watchdog->pad_stats || watchdog->pad_stats->len == 0)
+    return g_string_free (report, FALSE);
+
+  for (i = 0; i < watchdog->pad_stats->len; i++) {
+    GstWatchdogPadStats *stats = g_ptr_array_index (watchdog->pad_stats, i);
+    gint last = g_atomic_int_get (&stats->last_buffer_ms);
+
+    g_string_append_printf (report, "\n  %s:%s: ",
+        GST_DEBUG_PAD_NAME (stats->pad));
+    if (last < 0)
+      g_string_append (report, "no buffers");
+    else
+      g_string_append_printf (report, "%d buffers, last %d ms ago, "
+          "%.2f buffers/s", g_atomic_int_get (&stats->buffers), now - last,
+          stats->rate);
+
+    if (dump_threads) {
+      GstTask *task;
+
+      GST_OBJECT_LOCK (stats->pad);
+      task = GST_PAD_TASK (stats->pad);
+      if (task)
+        g_string_append_printf (report, ", task %s",
+            gst_watchdog_task_state_name (gst_task_get_state (task)));
+      if (GST_PAD_IS_BLOCKED (stats->pad))
+        g_string_append (report, ", blocked");
+      if (GST_PAD_IS_FLUSHING (stats->pad))
+        g_string_append (report, ", flushing");
+      GST_OBJECT_UNLOCK (stats->pad);
+    }
+  }
+
+  parent = gst_object_get_parent (GST_OBJECT (watchdog));
+  if (parent && GST_IS_BIN (parent)) {
+    GstIterator *it = gst_bin_iterate_recurse (GST_BIN (parent));
+
+    while (gst_iterator_foreach (it, gst_watchdog_append_queue_level,
+            report) == GST_ITERATOR_RESYNC) {
+      gst_iterator_resync (it);
+    }
+    gst_iterator_free (it);
+  }
+  if (parent)
+    gst_object_unref (parent);
+
+  return g_string_free (report, FALSE);
+}
+
+static gboolean
+gst_watchdog_update_stats (gpointer ptr)
+{
+  GstWatchdog *watchdog = GST_WATCHDOG (ptr);
+  gint now = gst_watchdog_now_ms (watchdog);
+  gdouble elapsed = (now - watchdog->last_stats_time) / 1000.0;
+  gdouble min_rate;
+  gint buffers;
+  guint i;
+
+  if (elapsed <= 0)
+    return TRUE;
+
+  for (i = 0; watchdog->pad_stats && i < watchdog->pad_stats->len; i++) {
+    GstWatchdogPadStats *stats = g_ptr_array_index (watchdog->pad_stats, i);
+
+    buffers = g_atomic_int_get (&stats->buffers);
+    stats->rate = (buffers - stats->prev_buffers) / elapsed;
+    stats->prev_buffers = buffers;
+  }
+
+  buffers = g_atomic_int_get (&watchdog->buffers);
+  watchdog->rate = (buffers - watchdog->prev_buffers) / elapsed;
+  watchdog->prev_buffers = buffers;
+  watchdog->last_stats_time = now;
+
+  GST_OBJECT_LOCK (watchdog);
+  min_rate = watchdog->min_rate;
+  GST_OBJECT_UNLOCK (watchdog);
+
+  if (min_rate > 0 && GST_STATE (watchdog) == GST_STATE_PLAYING &&
+      watchdog->rate < min_rate) {
+    /* only once per drop */
+    if (!watchdog->below_min_rate) {
+      gchar *reason, *report;
+
+      reason = g_strdup_printf ("Throughput dropped to %.2f buffers/s, "
+          "expected at least %.2f", watchdog->rate, min_rate);
+      report = gst_watchdog_get_report (watchdog, reason);
+      GST_ELEMENT_WARNING (watchdog, STREAM, FAILED, ("%s", reason),
+          ("%s", report));
+      g_free (report);
+      g_free (reason);
+      watchdog->below_min_rate = TRUE;
+    }
+  } else {
+    watchdog->below_min_rate = FALSE;
+  }
+
+  return TRUE;
+}
+
 static gboolean
 gst_watchdog_trigger (gpointer ptr)
 {
   GstWatchdog *watchdog = GST_WATCHDOG (ptr);
+  gboolean soft;
+  gchar *report;
 
   GST_DEBUG_OBJECT (watchdog, "watchdog triggered");
 
-  GST_ELEMENT_ERROR (watchdog, STREAM, FAILED, ("Watchdog triggered"),
-      ("Watchdog triggered"));
+  GST_OBJECT_LOCK (watchdog);
+  soft = watchdog->soft;
+  GST_OBJECT_UNLOCK (watchdog);
+
+  report = gst_watchdog_get_report (watchdog, "Watchdog triggered");
+  if (soft)
+    GST_ELEMENT_WARNING (watchdog, STREAM, FAILED, ("Watchdog triggered"),
+        ("%s", report));
+  else
+    GST_ELEMENT_ERROR (watchdog, STREAM, FAILED, ("Watchdog triggered"),
+        ("%s", report));
+  g_free (report);
 
   return FALSE;
 }
@@ -269,6 +653,16 @@ gst_watchdog_start (GstBaseTransform * trans)
 
   watchdog->main_context = g_main_context_new ();
   watchdog->main_loop = g_main_loop_new (watchdog->main_context, TRUE);
+  GST_OBJECT_UNLOCK (watchdog);
+
+  /* outside the object lock, this iterates over the parent bin */
+  gst_watchdog_start_stats (watchdog);
+
+  GST_OBJECT_LOCK (watchdog);
+  watchdog->stats_source = g_timeout_source_new (STATS_INTERVAL);
+  g_source_set_callback (watchdog->stats_source, gst_watchdog_update_stats,
+      watchdog, NULL);
+  g_source_attach (watchdog->stats_source, watchdog->main_context);
   watchdog->thread = g_thread_new ("watchdog", gst_watchdog_thread, watchdog);
 
   GST_OBJECT_UNLOCK (watchdog);
@@ -289,6 +683,11 @@ gst_watchdog_stop (GstBaseTransform * trans)
     g_source_unref (watchdog->source);
     watchdog->source = NULL;
   }
+  if (watchdog->stats_source) {
+    g_source_destroy (watchdog->stats_source);
+    g_source_unref (watchdog->stats_source);
+    watchdog->stats_source = NULL;
+  }
 
   /* dispatch an idle event that trigger g_main_loop_quit to avoid race
    * between g_main_loop_run and g_main_loop_quit */
@@ -308,6 +707,9 @@ gst_watchdog_stop (GstBaseTransform * trans)
   watchdog->main_context = NULL;
 
   GST_OBJECT_UNLOCK (watchdog);
+
+  gst_watchdog_stop_stats (watchdog);
+
   return TRUE;
 }
 
@@ -362,6 +764,8 @@ gst_watchdog_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
 
   GST_DEBUG_OBJECT (watchdog, "transform_ip");
 
+  g_atomic_int_inc (&watchdog->buffers);
+
   GST_OBJECT_LOCK (watchdog);
   gst_watchdog_feed (watchdog, buf, FALSE);
   GST_OBJECT_UNLOCK (watchdog);
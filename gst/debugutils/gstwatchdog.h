@@ -40,6 +40,10 @@ struct _GstWatchdog
 
   /* properties */
   int timeout;
+  gboolean soft;
+  gdouble min_rate;
+  gboolean diagnostics;
+  gboolean dump_threads;
 
   GMainContext *main_context;
   GMainLoop *main_loop;
@@ -49,6 +53,16 @@ struct _GstWatchdog
   gboolean waiting_for_a_buffer;
   gboolean waiting_for_flush_start;
   gboolean waiting_for_flush_stop;
+
+  /* flow statistics, only used from the watchdog thread while it runs */
+  GPtrArray *pad_stats;
+  GSource *stats_source;
+  gint64 start_time;
+  gint64 last_stats_time;
+  volatile gint buffers;
+  gint prev_buffers;
+  gdouble rate;
+  gboolean below_min_rate;
 };
 
 struct _GstWatchdogClass
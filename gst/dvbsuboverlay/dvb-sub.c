@@ -65,11 +65,23 @@ typedef struct DVBSubCLUT
   guint32 clut16[16];
   guint32 clut256[256];
 
+  guint32 serial;               /* changes whenever an entry changes */
+
   struct DVBSubCLUT *next;
 } DVBSubCLUT;
 
 static DVBSubCLUT default_clut;
 
+/* Serials are process-wide so that they stay unique when a DvbSub is
+ * recreated, e.g. on flushes; 0 is reserved for the default CLUT */
+static volatile gint dvb_sub_serial = 0;
+
+static guint32
+dvb_sub_next_serial (void)
+{
+  return (guint32) g_atomic_int_add (&dvb_sub_serial, 1) + 1;
+}
+
 typedef struct DVBSubObjectDisplay
 {
   /* FIXME: Use more correct sizes */
@@ -125,6 +137,8 @@ typedef struct DVBSubRegion
 
   DVBSubObjectDisplay *display_list;
 
+  guint32 serial;               /* changes with pbuf, depth or clut */
+
   struct DVBSubRegion *next;
 } DVBSubRegion;
 
@@ -301,6 +315,7 @@ dvb_sub_init (void)
    * structures are initialized from (to start off with default CLUTs
    * as defined in the specification). */
   default_clut.id = -1;
+  default_clut.serial = 0;
 
   default_clut.clut4[0] = RGBA_TO_AYUV (0, 0, 0, 0);
   default_clut.clut4[1] = RGBA_TO_AYUV (255, 255, 255, 255);
@@ -449,6 +464,7 @@ _dvb_sub_parse_region_segment (DvbSub * dvb_sub, guint16 page_id, guint8 * buf,
   DVBSubObject *object;
   DVBSubObjectDisplay *object_display;
   gboolean fill;
+  guint8 old_depth, old_clut;
 
   if (buf_size < 10)
     return;
@@ -464,6 +480,9 @@ _dvb_sub_parse_region_segment (DvbSub * dvb_sub, guint16 page_id, guint8 * buf,
     dvb_sub->region_list = region;
   }
 
+  old_depth = region->depth;
+  old_clut = region->clut;
+
   fill = ((*buf++) >> 3) & 1;
 
   region->width = GST_READ_UINT16_BE (buf);
@@ -510,6 +529,9 @@ _dvb_sub_parse_region_segment (DvbSub * dvb_sub, guint16 page_id, guint8 * buf,
         region->bgcolor);
   }
 
+  if (fill || region->depth != old_depth || region->clut != old_clut)
+    region->serial = dvb_sub_next_serial ();
+
   delete_region_display_list (dvb_sub, region); /* Delete the region display list for current region - FIXME: why? */
 
   while (buf + 6 <= buf_end) {
@@ -570,6 +592,8 @@ _dvb_sub_parse_clut_segment (DvbSub * dvb_sub, guint16 page_id, guint8 * buf,
   DVBSubCLUT *clut;
   int entry_id, depth, full_range;
   int y, cr, cb, alpha;
+  guint32 ayuv;
+  gboolean changed = FALSE;
 
   GST_MEMDUMP ("DVB clut packet", buf, buf_size);
 
@@ -584,6 +608,7 @@ _dvb_sub_parse_clut_segment (DvbSub * dvb_sub, guint16 page_id, guint8 * buf,
     memcpy (clut, &default_clut, sizeof (DVBSubCLUT));
 
     clut->id = clut_id;
+    changed = TRUE;
 
     clut->next = dvb_sub->clut_list;
     dvb_sub->clut_list = clut;
@@ -596,7 +621,7 @@ _dvb_sub_parse_clut_segment (DvbSub * dvb_sub, guint16 page_id, guint8 * buf,
 
     if (depth == 0) {
       GST_WARNING ("Invalid clut depth 0x%x!", *buf);
-      return;
+      break;
     }
 
     full_range = (*buf++) & 1;
@@ -621,13 +646,24 @@ _dvb_sub_parse_clut_segment (DvbSub * dvb_sub, guint16 page_id, guint8 * buf,
     GST_DEBUG ("CLUT DEFINITION: clut %d := (%d,%d,%d,%d)", entry_id, y, cb, cr,
         alpha);
 
-    if (depth & 0x80)
-      clut->clut4[entry_id] = AYUV (y, cb, cr, 255 - alpha);
-    if (depth & 0x40)
-      clut->clut16[entry_id] = AYUV (y, cb, cr, 255 - alpha);
-    if (depth & 0x20)
-      clut->clut256[entry_id] = AYUV (y, cb, cr, 255 - alpha);
+    ayuv = AYUV (y, cb, cr, 255 - alpha);
+
+    if ((depth & 0x80) && clut->clut4[entry_id] != ayuv) {
+      clut->clut4[entry_id] = ayuv;
+      changed = TRUE;
+    }
+    if ((depth & 0x40) && clut->clut16[entry_id] != ayuv) {
+      clut->clut16[entry_id] = ayuv;
+      changed = TRUE;
+    }
+    if ((depth & 0x20) && clut->clut256[entry_id] != ayuv) {
+      clut->clut256[entry_id] = ayuv;
+      changed = TRUE;
+    }
   }
+
+  if (changed)
+    clut->serial = dvb_sub_next_serial ();
 }
 
 // FFMPEG-FIXME: The same code in ffmpeg is much more complex, it could use the same
@@ -935,6 +971,8 @@ _dvb_sub_parse_pixel_data_block (DvbSub * dvb_sub,
     return;
   }
 
+  region->serial = dvb_sub_next_serial ();
+
   pbuf = region->pbuf;
 
   x_pos = display->x_pos;
@@ -1229,6 +1267,9 @@ _dvb_sub_parse_end_of_display_set (DvbSub * dvb_sub, guint16 page_id,
     if (!clut)
       clut = &default_clut;
 
+    rect->region_serial = region->serial;
+    rect->clut_serial = clut->serial;
+
     switch (region->depth) {
       case 2:
         clut_table = clut->clut4;
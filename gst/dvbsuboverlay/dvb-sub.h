@@ -64,6 +64,12 @@ typedef struct DVBSubtitleRect {
 	int h;
 
 	DVBSubtitlePicture pict;
+
+	/* Serials of the region pixels and of the CLUT used for the palette. They
+	 * are unique across all DvbSub instances, so rects with equal serials
+	 * have identical picture contents */
+	guint32 region_serial;
+	guint32 clut_serial;
 } DVBSubtitleRect;
 
 /**
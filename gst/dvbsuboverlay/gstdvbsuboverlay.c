@@ -174,6 +174,21 @@ gst_dvbsub_overlay_class_init (GstDVBSubOverlayClass * klass)
       "Renders DVB subtitles", "Mart Raudsepp <mart.raudsepp@collabora.co.uk>");
 }
 
+typedef struct
+{
+  guint32 region_serial;
+  guint32 clut_serial;
+  gint x, y, w, h;
+  GstVideoOverlayRectangle *rect;
+} GstDVBSubCachedRect;
+
+static void
+gst_dvbsub_cached_rect_free (GstDVBSubCachedRect * cached)
+{
+  gst_video_overlay_rectangle_unref (cached->rect);
+  g_slice_free (GstDVBSubCachedRect, cached);
+}
+
 static void
 gst_dvbsub_overlay_flush_subtitles (GstDVBSubOverlay * render)
 {
@@ -192,6 +207,10 @@ gst_dvbsub_overlay_flush_subtitles (GstDVBSubOverlay * render)
     gst_video_overlay_composition_unref (render->current_comp);
   render->current_comp = NULL;
 
+  g_list_free_full (render->cached_rects,
+      (GDestroyNotify) gst_dvbsub_cached_rect_free);
+  render->cached_rects = NULL;
+
   if (render->dvb_sub)
     dvb_sub_free (render->dvb_sub);
 
@@ -279,6 +298,10 @@ gst_dvbsub_overlay_finalize (GObject * object)
     gst_video_overlay_composition_unref (overlay->current_comp);
   overlay->current_comp = NULL;
 
+  g_list_free_full (overlay->cached_rects,
+      (GDestroyNotify) gst_dvbsub_cached_rect_free);
+  overlay->cached_rects = NULL;
+
   if (overlay->dvb_sub)
     dvb_sub_free (overlay->dvb_sub);
 
@@ -904,6 +927,7 @@ gst_dvbsub_overlay_subs_to_comp (GstDVBSubOverlay * overlay,
 {
   GstVideoOverlayComposition *comp = NULL;
   GstVideoOverlayRectangle *rect;
+  GList *cached_rects = NULL;
   gint width, height, dw, dh, wx, wy;
   gint i;
 
@@ -932,6 +956,7 @@ gst_dvbsub_overlay_subs_to_comp (GstDVBSubOverlay * overlay,
 
   for (i = 0; i < subs->num_rects; i++) {
     DVBSubtitleRect *srect = &subs->rects[i];
+    GstDVBSubCachedRect *cached;
     GstBuffer *buf;
     gint w, h;
     guint8 *in_data;
@@ -939,10 +964,44 @@ gst_dvbsub_overlay_subs_to_comp (GstDVBSubOverlay * overlay,
     gint rx, ry, rw, rh, stride;
     gint k, l;
     GstMapInfo map;
+    GList *link;
 
     GST_LOG_OBJECT (overlay, "rectangle %d: %dx%d @ (%d, %d)", i,
         srect->w, srect->h, srect->x, srect->y);
 
+    /* this is assuming the subtitle rectangle coordinates are relative
+     * to the window (if there is one) within a display of specified dimension.
+     * Coordinate wrt the latter is then scaled to the actual dimension of
+     * the video we are dealing with here. */
+    rx = gst_util_uint64_scale (wx + srect->x, width, dw);
+    ry = gst_util_uint64_scale (wy + srect->y, height, dh);
+    rw = gst_util_uint64_scale (srect->w, width, dw);
+    rh = gst_util_uint64_scale (srect->h, height, dh);
+
+    /* Reuse the rectangle of the previous page if neither the region pixels
+     * nor its CLUT changed. This also keeps the scaled and converted pixels
+     * the rectangle caches internally when blending. */
+    for (link = overlay->cached_rects; link; link = link->next) {
+      cached = link->data;
+      if (cached->region_serial == srect->region_serial
+          && cached->clut_serial == srect->clut_serial && cached->x == rx
+          && cached->y == ry && cached->w == rw && cached->h == rh)
+        break;
+    }
+
+    if (link) {
+      GST_LOG_OBJECT (overlay, "rectangle %d unchanged, reusing it", i);
+      overlay->cached_rects =
+          g_list_remove_link (overlay->cached_rects, link);
+      cached_rects = g_list_concat (link, cached_rects);
+      if (comp) {
+        gst_video_overlay_composition_add_rectangle (comp, cached->rect);
+      } else {
+        comp = gst_video_overlay_composition_new (cached->rect);
+      }
+      continue;
+    }
+
     w = srect->w;
     h = srect->h;
 
@@ -965,15 +1024,6 @@ gst_dvbsub_overlay_subs_to_comp (GstDVBSubOverlay * overlay,
     }
     gst_buffer_unmap (buf, &map);
 
-    /* this is assuming the subtitle rectangle coordinates are relative
-     * to the window (if there is one) within a display of specified dimension.
-     * Coordinate wrt the latter is then scaled to the actual dimension of
-     * the video we are dealing with here. */
-    rx = gst_util_uint64_scale (wx + srect->x, width, dw);
-    ry = gst_util_uint64_scale (wy + srect->y, height, dh);
-    rw = gst_util_uint64_scale (srect->w, width, dw);
-    rh = gst_util_uint64_scale (srect->h, height, dh);
-
     GST_LOG_OBJECT (overlay, "rectangle %d rendered: %dx%d @ (%d, %d)", i,
         rw, rh, rx, ry);
 
@@ -986,10 +1036,25 @@ gst_dvbsub_overlay_subs_to_comp (GstDVBSubOverlay * overlay,
     } else {
       comp = gst_video_overlay_composition_new (rect);
     }
-    gst_video_overlay_rectangle_unref (rect);
+
+    cached = g_slice_new (GstDVBSubCachedRect);
+    cached->region_serial = srect->region_serial;
+    cached->clut_serial = srect->clut_serial;
+    cached->x = rx;
+    cached->y = ry;
+    cached->w = rw;
+    cached->h = rh;
+    cached->rect = rect;
+    cached_rects = g_list_prepend (cached_rects, cached);
+
     gst_buffer_unref (buf);
   }
 
+  /* only keep the rectangles of the current page around */
+  g_list_free_full (overlay->cached_rects,
+      (GDestroyNotify) gst_dvbsub_cached_rect_free);
+  overlay->cached_rects = cached_rects;
+
   return comp;
 }
 
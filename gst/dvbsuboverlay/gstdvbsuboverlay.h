@@ -56,6 +56,9 @@ struct _GstDVBSubOverlay
 
   DVBSubtitles *current_subtitle; /* The currently active set of subtitle regions, if any */
   GstVideoOverlayComposition *current_comp;
+  /* overlay rectangles of current_comp with the region and CLUT serials they
+   * were converted from, reused for unchanged regions of the next page */
+  GList *cached_rects;
   GQueue *pending_subtitles; /* A queue of raw subtitle region sets with
 			      * metadata that are waiting their running time */
 
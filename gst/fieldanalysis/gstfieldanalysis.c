@@ -66,6 +66,7 @@
 #include <stdlib.h>             /* for abs() */
 
 #include "gstfieldanalysis.h"
+#include "gstfieldanalysiscomb.h"
 #include "gstfieldanalysisorc.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_field_analysis_debug);
@@ -82,6 +83,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_field_analysis_debug);
 #define DEFAULT_BLOCK_HEIGHT 16
 #define DEFAULT_BLOCK_THRESH 80
 #define DEFAULT_IGNORED_LINES 2
+#define DEFAULT_N_THREADS 1
+#define DEFAULT_DECIMATION 1
 
 enum
 {
@@ -96,7 +99,9 @@ enum
   PROP_BLOCK_WIDTH,
   PROP_BLOCK_HEIGHT,
   PROP_BLOCK_THRESH,
-  PROP_IGNORED_LINES
+  PROP_IGNORED_LINES,
+  PROP_N_THREADS,
+  PROP_DECIMATION
 };
 
 static GstStaticPadTemplate sink_factory =
@@ -274,6 +279,17 @@ gst_field_analysis_class_init (GstFieldAnalysisClass * klass)
           "Ignore this many lines from the top and bottom for windowed comb detection",
           2, G_MAXUINT64, DEFAULT_IGNORED_LINES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads computing the metrics, each one handles a "
+          "stripe of rows (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DECIMATION,
+      g_param_spec_uint ("decimation", "Decimation",
+          "Only analyse every Nth line of the fields, or every Nth row of blocks for windowed comb detection. Faster and usually enough when only the telecine cadence is of interest (1 = analyse everything)",
+          1, G_MAXINT, DEFAULT_DECIMATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_field_analysis_change_state);
@@ -297,12 +313,6 @@ static gfloat same_parity_3_tap (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 static gfloat opposite_parity_5_tap (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
-static guint64 block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
-static guint64 block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
-static guint64 block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1);
 static gfloat opposite_parity_windowed_comb (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2]);
 
@@ -325,10 +335,6 @@ gst_field_analysis_reset (GstFieldAnalysis * filter)
   filter->is_telecine = FALSE;
   filter->first_buffer = TRUE;
   gst_video_info_init (&filter->vinfo);
-  g_free (filter->comb_mask);
-  filter->comb_mask = NULL;
-  g_free (filter->block_scores);
-  filter->block_scores = NULL;
 }
 
 static void
@@ -352,12 +358,14 @@ gst_field_analysis_init (GstFieldAnalysis * filter)
   filter->same_frame = &opposite_parity_5_tap;
   filter->frame_thresh = DEFAULT_FRAME_THRESH;
   filter->noise_floor = DEFAULT_NOISE_FLOOR;
-  filter->block_score_for_row = &block_score_for_row_5_tap;
+  filter->comb_method = DEFAULT_COMB_METHOD;
   filter->spatial_thresh = DEFAULT_SPATIAL_THRESH;
   filter->block_width = DEFAULT_BLOCK_WIDTH;
   filter->block_height = DEFAULT_BLOCK_HEIGHT;
   filter->block_thresh = DEFAULT_BLOCK_THRESH;
   filter->ignored_lines = DEFAULT_IGNORED_LINES;
+  filter->decimation = DEFAULT_DECIMATION;
+  gst_stripe_threads_init (&filter->threads, DEFAULT_N_THREADS);
 }
 
 static void
@@ -404,37 +412,13 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
       filter->frame_thresh = g_value_get_float (value);
       break;
     case PROP_COMB_METHOD:
-      switch (g_value_get_enum (value)) {
-        case METHOD_32DETECT:
-          filter->block_score_for_row = &block_score_for_row_32detect;
-          break;
-        case METHOD_IS_COMBED:
-          filter->block_score_for_row = &block_score_for_row_iscombed;
-          break;
-        case METHOD_5_TAP:
-          filter->block_score_for_row = &block_score_for_row_5_tap;
-          break;
-        default:
-          break;
-      }
+      filter->comb_method = g_value_get_enum (value);
       break;
     case PROP_SPATIAL_THRESH:
       filter->spatial_thresh = g_value_get_int64 (value);
       break;
     case PROP_BLOCK_WIDTH:
       filter->block_width = g_value_get_uint64 (value);
-      if (GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame)) {
-        const gint frame_width =
-            GST_VIDEO_FRAME_WIDTH (&filter->frames[0].frame);
-        if (filter->block_scores) {
-          gsize nbytes = (frame_width / filter->block_width) * sizeof (guint);
-          filter->block_scores = g_realloc (filter->block_scores, nbytes);
-          memset (filter->block_scores, 0, nbytes);
-        } else {
-          filter->block_scores =
-              g_malloc0 ((frame_width / filter->block_width) * sizeof (guint));
-        }
-      }
       break;
     case PROP_BLOCK_HEIGHT:
       filter->block_height = g_value_get_uint64 (value);
@@ -445,6 +429,12 @@ gst_field_analysis_set_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       filter->ignored_lines = g_value_get_uint64 (value);
       break;
+    case PROP_N_THREADS:
+      filter->threads.n_threads = g_value_get_uint (value);
+      break;
+    case PROP_DECIMATION:
+      filter->decimation = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -492,18 +482,8 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
       g_value_set_float (value, filter->frame_thresh);
       break;
     case PROP_COMB_METHOD:
-    {
-      FieldAnalysisCombMethod method = DEFAULT_COMB_METHOD;
-      if (filter->block_score_for_row == &block_score_for_row_32detect) {
-        method = METHOD_32DETECT;
-      } else if (filter->block_score_for_row == &block_score_for_row_iscombed) {
-        method = METHOD_IS_COMBED;
-      } else if (filter->block_score_for_row == &block_score_for_row_5_tap) {
-        method = METHOD_5_TAP;
-      }
-      g_value_set_enum (value, method);
+      g_value_set_enum (value, filter->comb_method);
       break;
-    }
     case PROP_SPATIAL_THRESH:
       g_value_set_int64 (value, filter->spatial_thresh);
       break;
@@ -519,6 +499,12 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
     case PROP_IGNORED_LINES:
       g_value_set_uint64 (value, filter->ignored_lines);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, filter->threads.n_threads);
+      break;
+    case PROP_DECIMATION:
+      g_value_set_uint (value, filter->decimation);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -528,7 +514,6 @@ gst_field_analysis_get_property (GObject * object, guint prop_id,
 static void
 gst_field_analysis_update_format (GstFieldAnalysis * filter, GstCaps * caps)
 {
-  gint width;
   GQueue *outbufs;
   GstVideoInfo vinfo;
 
@@ -565,22 +550,6 @@ gst_field_analysis_update_format (GstFieldAnalysis * filter, GstCaps * caps)
   filter->flushing = FALSE;
 
   filter->vinfo = vinfo;
-  width = GST_VIDEO_INFO_WIDTH (&filter->vinfo);
-
-  /* update allocations for metric scores */
-  if (filter->comb_mask) {
-    filter->comb_mask = g_realloc (filter->comb_mask, width);
-  } else {
-    filter->comb_mask = g_malloc (width);
-  }
-  if (filter->block_scores) {
-    gsize nbytes = (width / filter->block_width) * sizeof (guint);
-    filter->block_scores = g_realloc (filter->block_scores, nbytes);
-    memset (filter->block_scores, 0, nbytes);
-  } else {
-    filter->block_scores =
-        g_malloc0 ((width / filter->block_width) * sizeof (guint));
-  }
 
   GST_OBJECT_UNLOCK (filter);
   return;
@@ -802,121 +771,174 @@ gst_field_analysis_sink_event (GstPad * pad, GstObject * parent,
 }
 
 
-static gfloat
-same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+/* pointer to line j of the field */
+static inline guint8 *
+gst_field_analysis_field_line (FieldAnalysisFields * field, gint j)
+{
+  const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&field->frame, 0);
+
+  return GST_VIDEO_FRAME_COMP_DATA (&field->frame, 0) +
+      GST_VIDEO_FRAME_COMP_OFFSET (&field->frame, 0) +
+      (field->parity + 2 * j) * stride;
+}
+
+/* number of the rows out of n_rows that are analysed */
+static inline gint
+gst_field_analysis_decimated_rows (GstFieldAnalysis * filter, gint n_rows)
+{
+  return (n_rows + filter->decimation - 1) / filter->decimation;
+}
+
+/* Computes a metric for the analysed rows [first, last), row k being row
+ * k * decimation of the field or frame. Must not touch the filter state so
+ * that stripes can run in parallel. */
+typedef guint64 (*FieldAnalysisRowsFunc) (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint first, gint last);
+
+typedef struct
+{
+  GstFieldAnalysis *filter;
+  FieldAnalysisFields (*history)[2];
+  FieldAnalysisRowsFunc func;
+  guint64 *results;
+} FieldAnalysisStripes;
+
+static void
+gst_field_analysis_stripe_func (gpointer user_data, guint stripe, gint first,
+    gint last)
+{
+  FieldAnalysisStripes *stripes = user_data;
+
+  stripes->results[stripe] =
+      stripes->func (stripes->filter, stripes->history, first, last);
+}
+
+/* Runs func over the n_rows analysed rows split in stripes, the calling
+ * thread handles the first one and the thread pool the others. Returns the
+ * sum of the stripe results, or their maximum if max is TRUE. */
+static guint64
+gst_field_analysis_run_stripes (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], FieldAnalysisRowsFunc func,
+    gint n_rows, gboolean max)
+{
+  FieldAnalysisStripes stripes;
+  guint i, n_stripes;
+  guint64 result = 0;
+
+  if (n_rows <= 0)
+    return 0;
+
+  n_stripes = gst_stripe_threads_get_n_stripes (&filter->threads, n_rows, 8);
+
+  stripes.filter = filter;
+  stripes.history = history;
+  stripes.func = func;
+  stripes.results = g_newa (guint64, n_stripes);
+  gst_stripe_threads_run_stripes (&filter->threads, n_stripes, n_rows,
+      gst_field_analysis_stripe_func, &stripes);
+
+  for (i = 0; i < n_stripes; i++) {
+    if (max)
+      result = MAX (result, stripes.results[i]);
+    else
+      result += stripes.results[i];
+  }
+
+  return result;
+}
+
+static guint64
+same_parity_sad_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint first, gint last)
 {
-  gint j;
-  gfloat sum;
-  guint8 *f1j, *f2j;
+  gint k;
+  guint64 sum = 0;
 
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
   const guint32 noise_floor = filter->noise_floor;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  for (k = first; k < last; k++) {
+    const gint j = k * filter->decimation;
     guint32 tempsum = 0;
-    fieldanalysis_orc_same_parity_sad_planar_yuv (&tempsum, f1j, f2j,
-        noise_floor, width);
+
+    fieldanalysis_orc_same_parity_sad_planar_yuv (&tempsum,
+        gst_field_analysis_field_line (&(*history)[0], j),
+        gst_field_analysis_field_line (&(*history)[1], j), noise_floor, width);
     sum += tempsum;
-    f1j += stride0x2;
-    f2j += stride1x2;
   }
 
-  return sum / (0.5f * width * height);
+  return sum;
 }
 
 static gfloat
-same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_sad (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint j;
-  gfloat sum;
-  guint8 *f1j, *f2j;
-
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
+  const gint n_rows = gst_field_analysis_decimated_rows (filter, height >> 1);
+  guint64 sum;
+
+  sum = gst_field_analysis_run_stripes (filter, history, same_parity_sad_rows,
+      n_rows, FALSE);
+
+  return sum * ((gfloat) (height >> 1) / n_rows) / (0.5f * width * height);
+}
+
+static guint64
+same_parity_ssd_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint first, gint last)
+{
+  gint k;
+  guint64 sum = 0;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   /* noise floor needs to be squared for SSD */
   const guint32 noise_floor = filter->noise_floor * filter->noise_floor;
 
-  f1j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-      0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  for (k = first; k < last; k++) {
+    const gint j = k * filter->decimation;
     guint32 tempsum = 0;
-    fieldanalysis_orc_same_parity_ssd_planar_yuv (&tempsum, f1j, f2j,
-        noise_floor, width);
+
+    fieldanalysis_orc_same_parity_ssd_planar_yuv (&tempsum,
+        gst_field_analysis_field_line (&(*history)[0], j),
+        gst_field_analysis_field_line (&(*history)[1], j), noise_floor, width);
     sum += tempsum;
-    f1j += stride0x2;
-    f2j += stride1x2;
   }
 
-  return sum / (0.5f * width * height); /* field is half height */
+  return sum;
 }
 
-/* horizontal [1,4,1] diff between fields - is this a good idea or should the
- * current sample be emphasised more or less? */
 static gfloat
-same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
+same_parity_ssd (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint i, j;
-  gfloat sum;
-  guint8 *f1j, *f2j;
-
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
+  const gint n_rows = gst_field_analysis_decimated_rows (filter, height >> 1);
+  guint64 sum;
+
+  sum = gst_field_analysis_run_stripes (filter, history, same_parity_ssd_rows,
+      n_rows, FALSE);
+
+  /* field is half height */
+  return sum * ((gfloat) (height >> 1) / n_rows) / (0.5f * width * height);
+}
+
+static guint64
+same_parity_3_tap_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint first, gint last)
+{
+  gint i, k;
+  guint64 sum = 0;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
   /* noise floor needs to be *6 for [1,4,1] */
   const guint32 noise_floor = filter->noise_floor * 6;
 
-  f1j = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame, 0) +
-      GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0) +
-      (*history)[0].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame,
-      0);
-  f2j =
-      GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-      0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-      0) +
-      (*history)[1].parity * GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame,
-      0);
-
-  sum = 0.0f;
-  for (j = 0; j < (height >> 1); j++) {
+  for (k = first; k < last; k++) {
+    const gint j = k * filter->decimation;
+    guint8 *f1j = gst_field_analysis_field_line (&(*history)[0], j);
+    guint8 *f2j = gst_field_analysis_field_line (&(*history)[1], j);
     guint32 tempsum = 0;
     guint32 diff;
 
@@ -937,385 +959,221 @@ same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
         - ((f2j[i - incr] << 1) + (f2j[i] << 2)));
     if (diff > noise_floor)
       sum += diff;
-
-    f1j += stride0x2;
-    f2j += stride1x2;
   }
 
-  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 = 6; field is half height */
+  return sum;
 }
 
-/* vertical [1,-3,4,-3,1] - same as is used in FieldDiff from TIVTC,
- * tritical's AVISynth IVTC filter */
-/* 0th field's parity defines operation */
+/* horizontal [1,4,1] diff between fields - is this a good idea or should the
+ * current sample be emphasised more or less? */
 static gfloat
-opposite_parity_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2])
+same_parity_3_tap (GstFieldAnalysis * filter, FieldAnalysisFields (*history)[2])
 {
-  gint j;
-  gfloat sum;
-  guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
-  guint32 tempsum;
-
   const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
   const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride0x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const gint stride1x2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0) << 1;
-  /* noise floor needs to be *6 for [1,-3,4,-3,1] */
-  const guint32 noise_floor = filter->noise_floor * 6;
+  const gint n_rows = gst_field_analysis_decimated_rows (filter, height >> 1);
+  guint64 sum;
+
+  sum = gst_field_analysis_run_stripes (filter, history,
+      same_parity_3_tap_rows, n_rows, FALSE);
 
-  sum = 0.0f;
+  /* 1 + 4 + 1 = 6; field is half height */
+  return sum * ((gfloat) (height >> 1) / n_rows) / ((6.0f / 2.0f) * width *
+      height);
+}
 
-  /* fj is line j of the combined frame made from the top field even lines of
-   *   field 0 and the bottom field odd lines from field 1
-   * fjp1 is one line down from fj
-   * fjm2 is two lines up from fj
-   * fj with j == 0 is the 0th line of the top field
-   * fj with j == 1 is the 0th line of the bottom field or the 1st field of
-   *   the frame*/
+/* fj is line j of the combined frame made from the top field even lines of
+ * one field and the bottom field odd lines from the other one, fjp1 is one
+ * line down from fj and fjm2 is two lines up from fj. The first and last
+ * lines mirror the missing neighbours. */
+static guint64
+opposite_parity_5_tap_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint first, gint last)
+{
+  gint k;
+  guint64 sum = 0;
+  FieldAnalysisFields *top, *bottom;
 
-  /* unroll first line as it is a special case */
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint n_lines = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame) >> 1;
+  /* noise floor needs to be *6 for [1,-3,4,-3,1] */
+  const guint32 noise_floor = filter->noise_floor * 6;
+
+  /* 0th field's parity defines operation */
   if ((*history)[0].parity == TOP_FIELD) {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0);
-    fjp2 = fj + stride0x2;
+    top = &(*history)[0];
+    bottom = &(*history)[1];
   } else {
-    fj = GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame, 0);
-    fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
-    fjp2 = fj + stride1x2;
+    top = &(*history)[1];
+    bottom = &(*history)[0];
   }
 
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjp2, fjp1, fj,
-      fjp1, fjp2, noise_floor, width);
-  sum += tempsum;
-
-  for (j = 1; j < (height >> 1) - 1; j++) {
-    /* shift everything down a line in the field of interest (means += stridex2) */
-    fjm2 = fj;
-    fjm1 = fjp1;
-    fj = fjp2;
-    if ((*history)[0].parity == TOP_FIELD) {
-      fjp1 += stride1x2;
-      fjp2 += stride0x2;
+  for (k = first; k < last; k++) {
+    const gint j = k * filter->decimation;
+    guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
+    guint32 tempsum = 0;
+
+    fj = gst_field_analysis_field_line (top, j);
+    if (j == 0) {
+      fjp1 = fjm1 = gst_field_analysis_field_line (bottom, j);
+      fjp2 = fjm2 = gst_field_analysis_field_line (top, j + 1);
+    } else if (j == n_lines - 1) {
+      fjp1 = fjm1 = gst_field_analysis_field_line (bottom, j - 1);
+      fjp2 = fjm2 = gst_field_analysis_field_line (top, j - 1);
     } else {
-      fjp1 += stride0x2;
-      fjp2 += stride1x2;
+      fjm2 = gst_field_analysis_field_line (top, j - 1);
+      fjm1 = gst_field_analysis_field_line (bottom, j - 1);
+      fjp1 = gst_field_analysis_field_line (bottom, j);
+      fjp2 = gst_field_analysis_field_line (top, j + 1);
     }
 
-    tempsum = 0;
     fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1,
         fj, fjp1, fjp2, noise_floor, width);
     sum += tempsum;
   }
 
-  /* unroll the last line as it is a special case */
-  /* shift everything down a line in the field of interest (means += stridex2) */
-  fjm2 = fj;
-  fjm1 = fjp1;
-  fj = fjp2;
+  return sum;
+}
+
+/* vertical [1,-3,4,-3,1] - same as is used in FieldDiff from TIVTC,
+ * tritical's AVISynth IVTC filter */
+static gfloat
+opposite_parity_5_tap (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2])
+{
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+  const gint n_rows = gst_field_analysis_decimated_rows (filter, height >> 1);
+  guint64 sum;
 
-  tempsum = 0;
-  fieldanalysis_orc_opposite_parity_5_tap_planar_yuv (&tempsum, fjm2, fjm1, fj,
-      fjm1, fjm2, noise_floor, width);
-  sum += tempsum;
+  sum = gst_field_analysis_run_stripes (filter, history,
+      opposite_parity_5_tap_rows, n_rows, FALSE);
 
-  return sum / ((6.0f / 2.0f) * width * height);        /* 1 + 4 + 1 == 3 + 3 == 6; field is half height */
+  /* 1 + 4 + 1 == 3 + 3 == 6; field is half height */
+  return sum * ((gfloat) (height >> 1) / n_rows) / ((6.0f / 2.0f) * width *
+      height);
 }
 
-/* this metric was sourced from HandBrake but originally from transcode
- * the return value is the highest block score for the row of blocks */
-static inline guint64
-block_score_for_row_32detect (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+/* if the samples to the left and right are combed, they contribute to the
+ * block score */
+static void
+comb_mask_score_line (const guint8 * comb_mask, guint * block_scores,
+    gint width, guint64 block_width)
 {
-  guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
-  guint8 *fjm2, *fjm1, *fj, *fjp1;
-  const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
-  const gint stridex2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const guint64 block_width = filter->block_width;
-  const guint64 block_height = filter->block_height;
-  const gint64 spatial_thresh = filter->spatial_thresh;
-  const gint width =
-      GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
-      (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
-
-  fjm2 = base_fj - stridex2;
-  fjm1 = base_fjp1 - stridex2;
-  fj = base_fj;
-  fjp1 = base_fjp1;
-
-  for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] = abs (fj[0] - fjm2[0]) < 10 && abs (fj[0] - fjm1[0]) > 15;
-    } else {
-      comb_mask[0] = FALSE;
-    }
+  gint i;
 
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
+  if (width < 2)
+    return;
 
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] = abs (fj[idx] - fjm2[idx]) < 10
-            && abs (fj[idx] - fjm1[idx]) > 15;
-      } else {
-        comb_mask[i] = FALSE;
-      }
+  /* left edge */
+  if (comb_mask[0] && comb_mask[1])
+    block_scores[0]++;
 
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
-      }
-    }
-    /* advance down a line */
-    fjm2 = fjm1;
-    fjm1 = fj;
-    fj = fjp1;
-    fjp1 = fjm1 + stridex2;
+  for (i = 2; i < width - 1; i++) {
+    if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
+      block_scores[(i - 1) / block_width]++;
   }
 
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
+  /* right edge */
+  if (i == width - 1) {
+    if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
+      block_scores[(i - 1) / block_width]++;
+    if (comb_mask[i - 1] && comb_mask[i])
+      block_scores[i / block_width]++;
   }
-
-  g_free (block_scores);
-  g_free (comb_mask);
-  return block_score;
 }
 
-/* this metric was sourced from HandBrake but originally from
- * tritical's isCombedT Avisynth function
- * the return value is the highest block score for the row of blocks */
-static inline guint64
-block_score_for_row_iscombed (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+/* the return value is the highest block score for the row of blocks
+ * starting at line 0 of the combined frame made from base_fj for the even
+ * lines and base_fjp1 for the odd ones */
+static guint64
+block_score_for_row (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1,
+    guint8 * comb_mask, guint * block_scores)
 {
-  guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
-  guint8 *fjm1, *fj, *fjp1;
+  gint k;
+  guint64 i, block_score;
   const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
-  const gint stridex2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
+  const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
   const guint64 block_width = filter->block_width;
-  const guint64 block_height = filter->block_height;
-  const gint64 spatial_thresh = filter->spatial_thresh;
-  const gint64 spatial_thresh_squared = spatial_thresh * spatial_thresh;
+  const gint block_height = filter->block_height;
   const gint width =
       GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
       (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
 
-  fjm1 = base_fjp1 - stridex2;
-  fj = base_fj;
-  fjp1 = base_fjp1;
-
-  for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] =
-          (fjm1[0] - fj[0]) * (fjp1[0] - fj[0]) > spatial_thresh_squared;
-    } else {
-      comb_mask[0] = FALSE;
-    }
+#define LINE(k) (((k) & 1) ? base_fjp1 + ((k) - 1) * stride : \
+    base_fj + (k) * stride)
 
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
-
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] =
-            (fjm1[idx] - fj[idx]) * (fjp1[idx] - fj[idx]) >
-            spatial_thresh_squared;
-      } else {
-        comb_mask[i] = FALSE;
-      }
+  memset (block_scores, 0, (width / block_width) * sizeof (guint));
 
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
-      }
-    }
-    /* advance down a line */
-    fjm1 = fj;
-    fj = fjp1;
-    fjp1 = fjm1 + stridex2;
+  for (k = 0; k < block_height; k++) {
+    gst_field_analysis_comb_mask_line (filter->comb_method, comb_mask,
+        LINE (k - 2), LINE (k - 1), LINE (k), LINE (k + 1), LINE (k + 2),
+        width, incr, filter->spatial_thresh);
+    comb_mask_score_line (comb_mask, block_scores, width, block_width);
   }
 
+#undef LINE
+
   block_score = 0;
   for (i = 0; i < width / block_width; i++) {
     if (block_scores[i] > block_score)
       block_score = block_scores[i];
   }
 
-  g_free (block_scores);
-  g_free (comb_mask);
   return block_score;
 }
 
-/* this metric was sourced from HandBrake but originally from
- * tritical's isCombedT Avisynth function
- * the return value is the highest block score for the row of blocks */
-static inline guint64
-block_score_for_row_5_tap (GstFieldAnalysis * filter,
-    FieldAnalysisFields (*history)[2], guint8 * base_fj, guint8 * base_fjp1)
+/* returns 2 if a row of blocks is combed, 1 if one is slightly combed and 0
+ * otherwise */
+static guint64
+opposite_parity_windowed_comb_rows (GstFieldAnalysis * filter,
+    FieldAnalysisFields (*history)[2], gint first, gint last)
 {
-  guint64 i, j;
-  guint8 *comb_mask = filter->comb_mask;
-  guint *block_scores = filter->block_scores;
-  guint64 block_score;
-  guint8 *fjm2, *fjm1, *fj, *fjp1, *fjp2;
-  const gint incr = GST_VIDEO_FRAME_COMP_PSTRIDE (&(*history)[0].frame, 0);
-  const gint stridex2 =
-      GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0) << 1;
-  const guint64 block_width = filter->block_width;
+  gint k;
+  guint64 result = 0;
+  guint8 *comb_mask, *base_fj, *base_fjp1;
+  guint *block_scores;
+
+  const gint width = GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame);
+  const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
+  const guint64 block_thresh = filter->block_thresh;
   const guint64 block_height = filter->block_height;
-  const gint64 spatial_thresh = filter->spatial_thresh;
-  const gint64 spatial_threshx6 = 6 * spatial_thresh;
-  const gint width =
-      GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) -
-      (GST_VIDEO_FRAME_WIDTH (&(*history)[0].frame) % block_width);
 
+  /* 0th field's parity defines operation */
+  if ((*history)[0].parity == TOP_FIELD) {
+    base_fj = gst_field_analysis_field_line (&(*history)[0], 0);
+    base_fjp1 = gst_field_analysis_field_line (&(*history)[1], 0);
+  } else {
+    base_fj = gst_field_analysis_field_line (&(*history)[1], 0);
+    base_fjp1 = gst_field_analysis_field_line (&(*history)[0], 0);
+  }
 
-  fjm2 = base_fj - stridex2;
-  fjm1 = base_fjp1 - stridex2;
-  fj = base_fj;
-  fjp1 = base_fjp1;
-  fjp2 = fj + stridex2;
-
-  for (j = 0; j < block_height; j++) {
-    /* we have to work one result ahead of ourselves which results in some small
-     * peculiarities below */
-    gint diff1, diff2;
-
-    diff1 = fj[0] - fjm1[0];
-    diff2 = fj[0] - fjp1[0];
-    /* change in the same direction */
-    if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-        || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-      comb_mask[0] =
-          abs (fjm2[0] + (fj[0] << 2) + fjp2[0] - 3 * (fjm1[0] + fjp1[0])) >
-          spatial_threshx6;
-
-      /* motion detection that needs previous and next frames
-         this isn't really necessary, but acts as an optimisation if the
-         additional delay isn't a problem
-         if (motion_detection) {
-         if (abs(fpj[idx] - fj[idx]               ) > motion_thresh &&
-         abs(           fjm1[idx] - fnjm1[idx]) > motion_thresh &&
-         abs(           fjp1[idx] - fnjp1[idx]) > motion_thresh)
-         motion++;
-         if (abs(             fj[idx]   - fnj[idx]) > motion_thresh &&
-         abs(fpjm1[idx] - fjm1[idx]           ) > motion_thresh &&
-         abs(fpjp1[idx] - fjp1[idx]           ) > motion_thresh)
-         motion++;
-         } else {
-         motion = 1;
-         }
-       */
-    } else {
-      comb_mask[0] = FALSE;
-    }
+  /* per stripe as the stripes run in parallel */
+  comb_mask = g_malloc (width);
+  block_scores = g_malloc ((width / filter->block_width + 1) * sizeof (guint));
 
-    for (i = 1; i < width; i++) {
-      const guint64 idx = i * incr;
-      const guint64 res_idx = (i - 1) / block_width;
-
-      diff1 = fj[idx] - fjm1[idx];
-      diff2 = fj[idx] - fjp1[idx];
-      if ((diff1 > spatial_thresh && diff2 > spatial_thresh)
-          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)) {
-        comb_mask[i] =
-            abs (fjm2[idx] + (fj[idx] << 2) + fjp2[idx] - 3 * (fjm1[idx] +
-                fjp1[idx])) > spatial_threshx6;
-      } else {
-        comb_mask[i] = FALSE;
-      }
+  for (k = first; k < last; k++) {
+    guint64 j = k * filter->decimation * block_height;
+    guint64 line_offset = (filter->ignored_lines + j) * stride;
+    guint64 block_score = block_score_for_row (filter, history,
+        base_fj + line_offset, base_fjp1 + line_offset, comb_mask,
+        block_scores);
 
-      if (i == 1 && comb_mask[i - 1] && comb_mask[i]) {
-        /* left edge */
-        block_scores[res_idx]++;
-      } else if (i == width - 1) {
-        /* right edge */
-        if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i])
-          block_scores[res_idx]++;
-        if (comb_mask[i - 1] && comb_mask[i])
-          block_scores[i / block_width]++;
-      } else if (comb_mask[i - 2] && comb_mask[i - 1] && comb_mask[i]) {
-        block_scores[res_idx]++;
-      }
+    if (block_score > (block_thresh >> 1)
+        && block_score <= block_thresh) {
+      /* blend if nothing more combed comes along */
+      result = 1;
+    } else if (block_score > block_thresh) {
+      result = 2;
+      break;
     }
-    /* advance down a line */
-    fjm2 = fjm1;
-    fjm1 = fj;
-    fj = fjp1;
-    fjp1 = fjp2;
-    fjp2 = fj + stridex2;
-  }
-
-  block_score = 0;
-  for (i = 0; i < width / block_width; i++) {
-    if (block_scores[i] > block_score)
-      block_score = block_scores[i];
   }
 
   g_free (block_scores);
   g_free (comb_mask);
-  return block_score;
+
+  return result;
 }
 
 /* a pass is made over the field using one of three comb-detection metrics
@@ -1325,63 +1183,42 @@ block_score_for_row_5_tap (GstFieldAnalysis * filter,
    score is between half the threshold and the threshold, the block is
    slightly combed. if when analysis is complete, slight combing is detected
    that is returned. if any results are observed that are above the threshold,
-   the function returns immediately */
+   the frame is combed */
 /* 0th field's parity defines operation */
 static gfloat
 opposite_parity_windowed_comb (GstFieldAnalysis * filter,
     FieldAnalysisFields (*history)[2])
 {
-  gint j;
-  gboolean slightly_combed;
-
-  const gint height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
-  const gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
-  const guint64 block_thresh = filter->block_thresh;
-  const guint64 block_height = filter->block_height;
-  guint8 *base_fj, *base_fjp1;
-
-  if ((*history)[0].parity == TOP_FIELD) {
-    base_fj =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame, 0);
-    base_fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[1].frame, 0);
-  } else {
-    base_fj =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[1].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[1].frame, 0);
-    base_fjp1 =
-        GST_VIDEO_FRAME_COMP_DATA (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_OFFSET (&(*history)[0].frame,
-        0) + GST_VIDEO_FRAME_COMP_STRIDE (&(*history)[0].frame, 0);
-  }
-
-  /* we operate on a row of blocks of height block_height through each iteration */
-  slightly_combed = FALSE;
-  for (j = 0; j <= height - filter->ignored_lines - block_height;
-      j += block_height) {
-    guint64 line_offset = (filter->ignored_lines + j) * stride;
-    guint block_score =
-        filter->block_score_for_row (filter, history, base_fj + line_offset,
-        base_fjp1 + line_offset);
-
-    if (block_score > (block_thresh >> 1)
-        && block_score <= block_thresh) {
-      /* blend if nothing more combed comes along */
-      slightly_combed = TRUE;
-    } else if (block_score > block_thresh) {
+  const gint64 height = GST_VIDEO_FRAME_HEIGHT (&(*history)[0].frame);
+  const gint64 block_height = filter->block_height;
+  gint64 last_line;
+  gint n_rows;
+
+  if (block_height == 0 || filter->block_width == 0)
+    return 0.0f;
+
+  /* rows of blocks read up to two lines below their last one and the bottom
+   * ignored lines are not analysed */
+  last_line = height - filter->ignored_lines - block_height - 2;
+  if (last_line < 0)
+    return 0.0f;
+  n_rows = gst_field_analysis_decimated_rows (filter,
+      last_line / block_height + 1);
+
+  switch (gst_field_analysis_run_stripes (filter, history,
+          opposite_parity_windowed_comb_rows, n_rows, TRUE)) {
+    case 2:
       if (GST_VIDEO_INFO_INTERLACE_MODE (&(*history)[0].frame.info) ==
           GST_VIDEO_INTERLACE_MODE_INTERLEAVED) {
         return 1.0f;            /* blend */
       } else {
         return 2.0f;            /* deinterlace */
       }
-    }
+    case 1:
+      return 1.0f;              /* blend */
+    default:
+      return 0.0f;
   }
-
-  return (gfloat) slightly_combed;      /* TRUE means blend, else don't */
 }
 
 /* this is where the magic happens
@@ -1832,6 +1669,8 @@ gst_field_analysis_finalize (GObject * object)
 
   gst_field_analysis_reset (filter);
 
+  gst_stripe_threads_clear (&filter->threads);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -0,0 +1,262 @@
+/*
+ * GStreamer
+ * Copyright (C) 2011 Robert Swain <robert.swain@collabora.co.uk>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>             /* for abs() */
+
+#include "gstfieldanalysiscomb.h"
+
+/* the comb metrics mark a sample as combed if it differs from both vertical
+ * neighbours in the same direction by more than the spatial threshold and
+ * then:
+ * 32detect - sourced from HandBrake but originally from transcode, it is
+ *   close to the sample two lines up and far from the one above
+ * iscombed - sourced from HandBrake but originally from tritical's isCombedT
+ *   Avisynth function, the product of the differences is large
+ * 5_tap - the [1,-3,4,-3,1] vertical filter response is large */
+static inline gboolean
+comb_mask_sample (FieldAnalysisCombMethod method, gint fjm2, gint fjm1,
+    gint fj, gint fjp1, gint fjp2, gint64 spatial_thresh)
+{
+  const gint diff1 = fj - fjm1;
+  const gint diff2 = fj - fjp1;
+
+  /* change in the same direction */
+  if (!((diff1 > spatial_thresh && diff2 > spatial_thresh)
+          || (diff1 < -spatial_thresh && diff2 < -spatial_thresh)))
+    return FALSE;
+
+  switch (method) {
+    case METHOD_32DETECT:
+      return abs (fj - fjm2) < 10 && abs (fj - fjm1) > 15;
+    case METHOD_IS_COMBED:
+      return (fjm1 - fj) * (fjp1 - fj) > spatial_thresh * spatial_thresh;
+    case METHOD_5_TAP:
+    default:
+      /* motion detection that needs previous and next frames
+         this isn't really necessary, but acts as an optimisation if the
+         additional delay isn't a problem
+         if (motion_detection) {
+         if (abs(fpj[idx] - fj[idx]               ) > motion_thresh &&
+         abs(           fjm1[idx] - fnjm1[idx]) > motion_thresh &&
+         abs(           fjp1[idx] - fnjp1[idx]) > motion_thresh)
+         motion++;
+         if (abs(             fj[idx]   - fnj[idx]) > motion_thresh &&
+         abs(fpjm1[idx] - fjm1[idx]           ) > motion_thresh &&
+         abs(fpjp1[idx] - fjp1[idx]           ) > motion_thresh)
+         motion++;
+         } else {
+         motion = 1;
+         }
+       */
+      return abs (fjm2 + (fj << 2) + fjp2 - 3 * (fjm1 + fjp1)) >
+          6 * spatial_thresh;
+  }
+}
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+
+/* 8 samples of comb_mask_sample() in 16 bit lanes, the thresholds clamped
+ * to the range where they can still make a difference. Returns 0xffff for
+ * combed samples. */
+static inline __m128i
+comb_mask_sse2 (FieldAnalysisCombMethod method, const guint8 * pjm2,
+    const guint8 * pjm1, const guint8 * pj, const guint8 * pjp1,
+    const guint8 * pjp2, gint16 thresh, gint16 thresh6, gint32 thresh_sq)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i t = _mm_set1_epi16 (thresh);
+  const __m128i mt = _mm_set1_epi16 (-thresh);
+  __m128i fjm2 = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) pjm2),
+      zero);
+  __m128i fjm1 = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) pjm1),
+      zero);
+  __m128i fj = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) pj),
+      zero);
+  __m128i fjp1 = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) pjp1),
+      zero);
+  __m128i diff1 = _mm_sub_epi16 (fj, fjm1);
+  __m128i diff2 = _mm_sub_epi16 (fj, fjp1);
+  __m128i dir = _mm_or_si128 (_mm_and_si128 (_mm_cmpgt_epi16 (diff1, t),
+          _mm_cmpgt_epi16 (diff2, t)), _mm_and_si128 (_mm_cmplt_epi16 (diff1,
+              mt), _mm_cmplt_epi16 (diff2, mt)));
+  __m128i m;
+
+  switch (method) {
+    case METHOD_32DETECT:{
+      __m128i d = _mm_sub_epi16 (fj, fjm2);
+
+      d = _mm_max_epi16 (d, _mm_sub_epi16 (zero, d));
+      m = _mm_and_si128 (_mm_cmplt_epi16 (d, _mm_set1_epi16 (10)),
+          _mm_cmpgt_epi16 (_mm_max_epi16 (diff1, _mm_sub_epi16 (zero, diff1)),
+              _mm_set1_epi16 (15)));
+      break;
+    }
+    case METHOD_IS_COMBED:{
+      __m128i a = _mm_sub_epi16 (fjm1, fj);
+      __m128i b = _mm_sub_epi16 (fjp1, fj);
+      __m128i lo = _mm_mullo_epi16 (a, b);
+      __m128i hi = _mm_mulhi_epi16 (a, b);
+      __m128i sq = _mm_set1_epi32 (thresh_sq);
+
+      m = _mm_packs_epi32 (_mm_cmpgt_epi32 (_mm_unpacklo_epi16 (lo, hi), sq),
+          _mm_cmpgt_epi32 (_mm_unpackhi_epi16 (lo, hi), sq));
+      break;
+    }
+    case METHOD_5_TAP:
+    default:{
+      __m128i fjp2 =
+          _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) pjp2), zero);
+      __m128i mid = _mm_add_epi16 (fjm1, fjp1);
+      __m128i v = _mm_sub_epi16 (_mm_add_epi16 (_mm_add_epi16 (fjm2, fjp2),
+              _mm_slli_epi16 (fj, 2)), _mm_add_epi16 (mid, _mm_add_epi16 (mid,
+                  mid)));
+
+      v = _mm_max_epi16 (v, _mm_sub_epi16 (zero, v));
+      m = _mm_cmpgt_epi16 (v, _mm_set1_epi16 (thresh6));
+      break;
+    }
+  }
+
+  return _mm_and_si128 (dir, m);
+}
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+
+/* 8 samples of comb_mask_sample() in 16 bit lanes, the thresholds clamped
+ * to the range where they can still make a difference. Returns 0xffff for
+ * combed samples. */
+static inline uint16x8_t
+comb_mask_neon (FieldAnalysisCombMethod method, const guint8 * pjm2,
+    const guint8 * pjm1, const guint8 * pj, const guint8 * pjp1,
+    const guint8 * pjp2, gint16 thresh, gint16 thresh6, gint32 thresh_sq)
+{
+  const int16x8_t t = vdupq_n_s16 (thresh);
+  const int16x8_t mt = vdupq_n_s16 (-thresh);
+  int16x8_t fjm2 = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (pjm2)));
+  int16x8_t fjm1 = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (pjm1)));
+  int16x8_t fj = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (pj)));
+  int16x8_t fjp1 = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (pjp1)));
+  int16x8_t diff1 = vsubq_s16 (fj, fjm1);
+  int16x8_t diff2 = vsubq_s16 (fj, fjp1);
+  uint16x8_t dir = vorrq_u16 (vandq_u16 (vcgtq_s16 (diff1, t),
+          vcgtq_s16 (diff2, t)), vandq_u16 (vcltq_s16 (diff1, mt),
+          vcltq_s16 (diff2, mt)));
+  uint16x8_t m;
+
+  switch (method) {
+    case METHOD_32DETECT:
+      m = vandq_u16 (vcltq_s16 (vabdq_s16 (fj, fjm2), vdupq_n_s16 (10)),
+          vcgtq_s16 (vabsq_s16 (diff1), vdupq_n_s16 (15)));
+      break;
+    case METHOD_IS_COMBED:{
+      int16x8_t a = vsubq_s16 (fjm1, fj);
+      int16x8_t b = vsubq_s16 (fjp1, fj);
+      int32x4_t sq = vdupq_n_s32 (thresh_sq);
+
+      m = vcombine_u16 (vmovn_u32 (vcgtq_s32 (vmull_s16 (vget_low_s16 (a),
+                      vget_low_s16 (b)), sq)),
+          vmovn_u32 (vcgtq_s32 (vmull_s16 (vget_high_s16 (a),
+                      vget_high_s16 (b)), sq)));
+      break;
+    }
+    case METHOD_5_TAP:
+    default:{
+      int16x8_t fjp2 = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (pjp2)));
+      int16x8_t v = vsubq_s16 (vaddq_s16 (vaddq_s16 (fjm2, fjp2),
+              vshlq_n_s16 (fj, 2)), vmulq_n_s16 (vaddq_s16 (fjm1, fjp1), 3));
+
+      m = vcgtq_s16 (vabsq_s16 (v), vdupq_n_s16 (thresh6));
+      break;
+    }
+  }
+
+  return vandq_u16 (dir, m);
+}
+#endif
+
+/* fills comb_mask[i] for the width samples of line fj, which are incr bytes
+ * apart */
+void
+gst_field_analysis_comb_mask_line (FieldAnalysisCombMethod method,
+    guint8 * comb_mask, const guint8 * fjm2, const guint8 * fjm1,
+    const guint8 * fj, const guint8 * fjp1, const guint8 * fjp2, gint width,
+    gint incr, gint64 spatial_thresh)
+{
+  gint i = 0;
+
+#if defined (__SSE2__) || defined (__ARM_NEON) || defined (__ARM_NEON__)
+  if (incr == 1) {
+    /* differences of two samples are within [-255,255] and the filter
+     * responses within [-1530,1530] */
+    const gint16 thresh = MIN (spatial_thresh, 256);
+    const gint16 thresh6 = MIN (6 * spatial_thresh, 1531);
+    const gint32 thresh_sq = MIN (spatial_thresh * spatial_thresh, 65026);
+
+    for (; i + 8 <= width; i += 8) {
+#if defined (__SSE2__)
+      __m128i m = comb_mask_sse2 (method, fjm2 + i, fjm1 + i, fj + i,
+          fjp1 + i, fjp2 + i, thresh, thresh6, thresh_sq);
+
+      _mm_storel_epi64 ((__m128i *) (comb_mask + i), _mm_packs_epi16 (m, m));
+#else
+      uint16x8_t m = comb_mask_neon (method, fjm2 + i, fjm1 + i, fj + i,
+          fjp1 + i, fjp2 + i, thresh, thresh6, thresh_sq);
+
+      vst1_u8 (comb_mask + i, vmovn_u16 (m));
+#endif
+    }
+  }
+#endif
+
+  for (; i < width; i++) {
+    const gint idx = i * incr;
+
+    comb_mask[i] = comb_mask_sample (method, fjm2[idx], fjm1[idx], fj[idx],
+        fjp1[idx], fjp2[idx], spatial_thresh);
+  }
+}
@@ -57,6 +57,12 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 #include "gstfreeverb.h"
 
 #define GST_CAT_DEFAULT gst_freeverb_debug
@@ -137,6 +143,9 @@ static const GstFreeverbProcessFunc process_functions[2][2] = {
  */
 
 /* Denormalising:
+ *
+ * Where the SIMD code is used, denormals are flushed to zero while
+ * processing (see gst_freeverb_transform()) and no offset is needed.
  *
  * Another method fixes the problem cheaper: Use a small DC-offset in
  * the filter calculations.  Now the signals converge not against 0,
@@ -146,9 +155,15 @@ static const GstFreeverbProcessFunc process_functions[2][2] = {
  * problems.
  */
 
-//#define DC_OFFSET 0
+#if defined (__SSE2__) || defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define DC_OFFSET 0
+#else
 #define DC_OFFSET 1e-8
-//#define DC_OFFSET 0.001f
+#endif
+
+/* Samples processed at once, also limited to the shortest delay line so
+ * that no delay line sample is both read and written within a block */
+#define FREEVERB_BLOCK 128
 
 /* all pass filter */
 
@@ -163,6 +178,7 @@ typedef struct _freeverb_allpass
 static void
 freeverb_allpass_setbuffer (freeverb_allpass * allpass, gint size)
 {
+  size = MAX (size, 1);
   allpass->bufidx = 0;
   allpass->buffer = g_new (gfloat, size);
   allpass->bufsize = size;
@@ -198,17 +214,54 @@ freeverb_allpass_getfeedback(freeverb_allpass* allpass)
   return allpass->feedback;
 }*/
 
-#define freeverb_allpass_process(_allpass, _input_1) \
-{ \
-  gfloat output; \
-  gfloat bufout; \
-  bufout = _allpass.buffer[_allpass.bufidx]; \
-  output = bufout-_input_1; \
-  _allpass.buffer[_allpass.bufidx] = _input_1 + (bufout * _allpass.feedback); \
-  if (++_allpass.bufidx >= _allpass.bufsize) { \
-    _allpass.bufidx = 0; \
-  } \
-  _input_1 = output; \
+/* Runs n samples through the allpass in place */
+static void
+freeverb_allpass_process_block (freeverb_allpass * allpass, gfloat * data,
+    gint n)
+{
+  gfloat feedback = allpass->feedback;
+
+  while (n > 0) {
+    gint len = MIN (n, allpass->bufsize - allpass->bufidx);
+    gfloat *buf = allpass->buffer + allpass->bufidx;
+    gint k = 0;
+
+#if defined (__SSE2__)
+    {
+      __m128 vfeedback = _mm_set1_ps (feedback);
+
+      for (; k + 4 <= len; k += 4) {
+        __m128 bufout = _mm_loadu_ps (buf + k);
+        __m128 input = _mm_loadu_ps (data + k);
+
+        _mm_storeu_ps (buf + k, _mm_add_ps (input,
+                _mm_mul_ps (bufout, vfeedback)));
+        _mm_storeu_ps (data + k, _mm_sub_ps (bufout, input));
+      }
+    }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+    for (; k + 4 <= len; k += 4) {
+      float32x4_t bufout = vld1q_f32 (buf + k);
+      float32x4_t input = vld1q_f32 (data + k);
+
+      vst1q_f32 (buf + k, vaddq_f32 (input, vmulq_n_f32 (bufout, feedback)));
+      vst1q_f32 (data + k, vsubq_f32 (bufout, input));
+    }
+#endif
+    for (; k < len; k++) {
+      gfloat bufout = buf[k];
+      gfloat input = data[k];
+
+      buf[k] = input + (bufout * feedback);
+      data[k] = bufout - input;
+    }
+
+    allpass->bufidx += len;
+    if (allpass->bufidx >= allpass->bufsize)
+      allpass->bufidx = 0;
+    data += len;
+    n -= len;
+  }
 }
 
 /* comb filter */
@@ -227,6 +280,7 @@ typedef struct _freeverb_comb
 static void
 freeverb_comb_setbuffer (freeverb_comb * comb, gint size)
 {
+  size = MAX (size, 1);
   comb->filterstore = 0;
   comb->bufidx = 0;
   comb->buffer = g_new (gfloat, size);
@@ -277,15 +331,27 @@ freeverb_comb_getfeedback(freeverb_comb* comb)
   return comb->feedback;
 }*/
 
-#define freeverb_comb_process(_comb, _input_1, _output) \
-{ \
-  gfloat _tmp = _comb.buffer[_comb.bufidx]; \
-  _comb.filterstore = (_tmp * _comb.damp2) + (_comb.filterstore * _comb.damp1); \
-  _comb.buffer[_comb.bufidx] = _input_1 + (_comb.filterstore * _comb.feedback); \
-  if (++_comb.bufidx >= _comb.bufsize) { \
-    _comb.bufidx = 0; \
-  } \
-  _output += _tmp; \
+/* Copies the next n samples of the delay line to data */
+static void
+freeverb_comb_read (freeverb_comb * comb, gfloat * data, gint n)
+{
+  gint len = MIN (n, comb->bufsize - comb->bufidx);
+
+  memcpy (data, comb->buffer + comb->bufidx, len * sizeof (gfloat));
+  memcpy (data + len, comb->buffer, (n - len) * sizeof (gfloat));
+}
+
+/* Replaces the next n samples of the delay line with data */
+static void
+freeverb_comb_write (freeverb_comb * comb, const gfloat * data, gint n)
+{
+  gint len = MIN (n, comb->bufsize - comb->bufidx);
+
+  memcpy (comb->buffer + comb->bufidx, data, len * sizeof (gfloat));
+  memcpy (comb->buffer, data + len, (n - len) * sizeof (gfloat));
+  comb->bufidx += n;
+  if (comb->bufidx >= comb->bufsize)
+    comb->bufidx -= comb->bufsize;
 }
 
 #define numcombs 8
@@ -329,6 +395,7 @@ freeverb_comb_getfeedback(freeverb_comb* comb)
 
 struct _GstFreeverbPrivate
 {
+  gint block_size;
   gfloat roomsize;
   gfloat damp;
   gfloat wet, wet1, wet2, dry;
@@ -379,6 +446,178 @@ freeverb_revmodel_free (GstFreeverb * filter)
   }
 }
 
+/* dst[j * dst_stride + i] = src[i * src_stride + j] for rows i, rows being
+ * a multiple of 4, and columns j */
+static void
+freeverb_transpose (const gfloat * src, gint src_stride, gfloat * dst,
+    gint dst_stride, gint rows, gint cols)
+{
+  gint i, j = 0;
+
+#if defined (__SSE2__)
+  for (; j + 4 <= cols; j += 4) {
+    for (i = 0; i < rows; i += 4) {
+      __m128 r0 = _mm_loadu_ps (src + (i + 0) * src_stride + j);
+      __m128 r1 = _mm_loadu_ps (src + (i + 1) * src_stride + j);
+      __m128 r2 = _mm_loadu_ps (src + (i + 2) * src_stride + j);
+      __m128 r3 = _mm_loadu_ps (src + (i + 3) * src_stride + j);
+
+      _MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+      _mm_storeu_ps (dst + (j + 0) * dst_stride + i, r0);
+      _mm_storeu_ps (dst + (j + 1) * dst_stride + i, r1);
+      _mm_storeu_ps (dst + (j + 2) * dst_stride + i, r2);
+      _mm_storeu_ps (dst + (j + 3) * dst_stride + i, r3);
+    }
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  for (; j + 4 <= cols; j += 4) {
+    for (i = 0; i < rows; i += 4) {
+      float32x4x2_t t01 = vtrnq_f32 (vld1q_f32 (src + (i + 0) * src_stride +
+              j), vld1q_f32 (src + (i + 1) * src_stride + j));
+      float32x4x2_t t23 = vtrnq_f32 (vld1q_f32 (src + (i + 2) * src_stride +
+              j), vld1q_f32 (src + (i + 3) * src_stride + j));
+
+      vst1q_f32 (dst + (j + 0) * dst_stride + i,
+          vcombine_f32 (vget_low_f32 (t01.val[0]), vget_low_f32 (t23.val[0])));
+      vst1q_f32 (dst + (j + 1) * dst_stride + i,
+          vcombine_f32 (vget_low_f32 (t01.val[1]), vget_low_f32 (t23.val[1])));
+      vst1q_f32 (dst + (j + 2) * dst_stride + i,
+          vcombine_f32 (vget_high_f32 (t01.val[0]),
+              vget_high_f32 (t23.val[0])));
+      vst1q_f32 (dst + (j + 3) * dst_stride + i,
+          vcombine_f32 (vget_high_f32 (t01.val[1]),
+              vget_high_f32 (t23.val[1])));
+    }
+  }
+#endif
+  for (; j < cols; j++) {
+    for (i = 0; i < rows; i++)
+      dst[j * dst_stride + i] = src[i * src_stride + j];
+  }
+}
+
+/* Runs n <= block_size samples of left and right input, already scaled by
+ * the gain, through the combs in parallel and the allpasses in series.
+ *
+ * As a block is never longer than a delay line, the comb inputs are known
+ * up front. They are transposed so that each sample becomes a vector of
+ * all 16 combs, then only the damping filter remains as a serial
+ * computation, done on all combs at once. */
+static void
+freeverb_revmodel_process_block (GstFreeverbPrivate * priv,
+    const gfloat * in_l, const gfloat * in_r, gfloat * out_l, gfloat * out_r,
+    gint n)
+{
+  gfloat delayed[2 * numcombs][FREEVERB_BLOCK];
+  gfloat lanes[FREEVERB_BLOCK][2 * numcombs];
+  gfloat filterstore[2 * numcombs], damp1[2 * numcombs];
+  gfloat damp2[2 * numcombs], feedback[2 * numcombs];
+  freeverb_comb *combs[2 * numcombs];
+  gint c, k;
+
+  for (c = 0; c < numcombs; c++) {
+    combs[c] = &priv->combL[c];
+    combs[numcombs + c] = &priv->combR[c];
+  }
+
+  for (c = 0; c < 2 * numcombs; c++) {
+    freeverb_comb_read (combs[c], delayed[c], n);
+    filterstore[c] = combs[c]->filterstore;
+    damp1[c] = combs[c]->damp1;
+    damp2[c] = combs[c]->damp2;
+    feedback[c] = combs[c]->feedback;
+  }
+
+  /* the delayed samples are the comb outputs */
+  memcpy (out_l, delayed[0], n * sizeof (gfloat));
+  memcpy (out_r, delayed[numcombs], n * sizeof (gfloat));
+  for (c = 1; c < numcombs; c++) {
+    for (k = 0; k < n; k++) {
+      out_l[k] += delayed[c][k];
+      out_r[k] += delayed[numcombs + c][k];
+    }
+  }
+
+  freeverb_transpose (&delayed[0][0], FREEVERB_BLOCK, &lanes[0][0],
+      2 * numcombs, 2 * numcombs, n);
+
+#if defined (__SSE2__)
+  {
+    __m128 fs[4], d1[4], d2[4], fb[4];
+
+    for (c = 0; c < 4; c++) {
+      fs[c] = _mm_loadu_ps (filterstore + 4 * c);
+      d1[c] = _mm_loadu_ps (damp1 + 4 * c);
+      d2[c] = _mm_loadu_ps (damp2 + 4 * c);
+      fb[c] = _mm_loadu_ps (feedback + 4 * c);
+    }
+    for (k = 0; k < n; k++) {
+      __m128 input_l = _mm_set1_ps (in_l[k]);
+      __m128 input_r = _mm_set1_ps (in_r[k]);
+
+      for (c = 0; c < 4; c++) {
+        __m128 tmp = _mm_loadu_ps (&lanes[k][4 * c]);
+
+        fs[c] = _mm_add_ps (_mm_mul_ps (tmp, d2[c]), _mm_mul_ps (fs[c],
+                d1[c]));
+        _mm_storeu_ps (&lanes[k][4 * c], _mm_add_ps (c < 2 ? input_l :
+                input_r, _mm_mul_ps (fs[c], fb[c])));
+      }
+    }
+    for (c = 0; c < 4; c++)
+      _mm_storeu_ps (filterstore + 4 * c, fs[c]);
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  {
+    float32x4_t fs[4], d1[4], d2[4], fb[4];
+
+    for (c = 0; c < 4; c++) {
+      fs[c] = vld1q_f32 (filterstore + 4 * c);
+      d1[c] = vld1q_f32 (damp1 + 4 * c);
+      d2[c] = vld1q_f32 (damp2 + 4 * c);
+      fb[c] = vld1q_f32 (feedback + 4 * c);
+    }
+    for (k = 0; k < n; k++) {
+      float32x4_t input_l = vdupq_n_f32 (in_l[k]);
+      float32x4_t input_r = vdupq_n_f32 (in_r[k]);
+
+      for (c = 0; c < 4; c++) {
+        float32x4_t tmp = vld1q_f32 (&lanes[k][4 * c]);
+
+        fs[c] = vaddq_f32 (vmulq_f32 (tmp, d2[c]), vmulq_f32 (fs[c], d1[c]));
+        vst1q_f32 (&lanes[k][4 * c], vaddq_f32 (c < 2 ? input_l : input_r,
+                vmulq_f32 (fs[c], fb[c])));
+      }
+    }
+    for (c = 0; c < 4; c++)
+      vst1q_f32 (filterstore + 4 * c, fs[c]);
+  }
+#else
+  for (k = 0; k < n; k++) {
+    for (c = 0; c < 2 * numcombs; c++) {
+      gfloat input = c < numcombs ? in_l[k] : in_r[k];
+
+      filterstore[c] =
+          (lanes[k][c] * damp2[c]) + (filterstore[c] * damp1[c]);
+      lanes[k][c] = input + (filterstore[c] * feedback[c]);
+    }
+  }
+#endif
+
+  freeverb_transpose (&lanes[0][0], 2 * numcombs, &delayed[0][0],
+      FREEVERB_BLOCK, n, 2 * numcombs);
+
+  for (c = 0; c < 2 * numcombs; c++) {
+    freeverb_comb_write (combs[c], delayed[c], n);
+    combs[c]->filterstore = filterstore[c];
+  }
+
+  for (c = 0; c < numallpasses; c++) {
+    freeverb_allpass_process_block (&priv->allpassL[c], out_l, n);
+    freeverb_allpass_process_block (&priv->allpassR[c], out_r, n);
+  }
+}
+
 /* GObject vmethod implementations */
 
 static void
@@ -486,6 +725,7 @@ gst_freeverb_init_rev_model (GstFreeverb * filter)
 {
   gfloat srfactor = GST_AUDIO_INFO_RATE (&filter->info) / 44100.0f;
   GstFreeverbPrivate *priv = filter->priv;
+  gint i;
 
   freeverb_revmodel_free (filter);
 
@@ -516,6 +756,12 @@ gst_freeverb_init_rev_model (GstFreeverb * filter)
   freeverb_allpass_setbuffer (&priv->allpassL[3], allpasstuningL4 * srfactor);
   freeverb_allpass_setbuffer (&priv->allpassR[3], allpasstuningR4 * srfactor);
 
+  priv->block_size = FREEVERB_BLOCK;
+  for (i = 0; i < numcombs; i++) {
+    priv->block_size = MIN (priv->block_size, priv->combL[i].bufsize);
+    priv->block_size = MIN (priv->block_size, priv->combR[i].bufsize);
+  }
+
   /* clear buffers */
   freeverb_revmodel_init (filter);
 
@@ -693,46 +939,44 @@ gst_freeverb_transform_m2s_int (GstFreeverb * filter,
     gint16 * idata, gint16 * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1;
-  gfloat out_l2, out_r2, input_2;
+  gfloat in_l[FREEVERB_BLOCK], in_r[FREEVERB_BLOCK];
+  gfloat out_l1[FREEVERB_BLOCK], out_r1[FREEVERB_BLOCK];
+  gfloat out_l2, out_r2;
+  gint j, n;
+  guint k;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
+  for (k = 0; k < num_samples; k += n) {
+    n = MIN ((gint) (num_samples - k), priv->block_size);
 
     /* The original Freeverb code expects a stereo signal and 'input_1'
      * is set to the sum of the left and right input_1 sample. Since
      * this code works on a mono signal, 'input_1' is set to twice the
      * input_1 sample. */
-    input_2 = (gfloat) * idata++;
-    input_1 = (2.0f * input_2 + DC_OFFSET) * priv->gain;
-
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
+    for (j = 0; j < n; j++)
+      in_l[j] = in_r[j] = (2.0f * (gfloat) idata[j] + DC_OFFSET) * priv->gain;
+
+    freeverb_revmodel_process_block (priv, in_l, in_r, out_l1, out_r1, n);
+
+    for (j = 0; j < n; j++) {
+      /* Remove the DC offset */
+      out_l1[j] -= (gfloat) DC_OFFSET;
+      out_r1[j] -= (gfloat) DC_OFFSET;
+
+      /* Calculate output */
+      out_l2 = out_l1[j] * priv->wet1 + out_r1[j] * priv->wet2 +
+          idata[j] * priv->dry;
+      out_r2 = out_r1[j] * priv->wet1 + out_l1[j] * priv->wet2 +
+          idata[j] * priv->dry;
+      out_l2 = CLAMP (out_l2, G_MININT16, G_MAXINT16);
+      out_r2 = CLAMP (out_r2, G_MININT16, G_MAXINT16);
+      *odata++ = (gint16) out_l2;
+      *odata++ = (gint16) out_r2;
+
+      if (abs ((gint16) out_l2) > 0 || abs ((gint16) out_r2) > 0)
+        drained = FALSE;
     }
-
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
-
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2 * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2 * priv->dry;
-    out_l2 = CLAMP (out_l2, G_MININT16, G_MAXINT16);
-    out_r2 = CLAMP (out_r2, G_MININT16, G_MAXINT16);
-    *odata++ = (gint16) out_l2;
-    *odata++ = (gint16) out_r2;
-
-    if (abs ((gint16) out_l2) > 0 || abs ((gint16) out_r2) > 0)
-      drained = FALSE;
+    idata += n;
   }
   return drained;
 }
@@ -742,44 +986,42 @@ gst_freeverb_transform_s2s_int (GstFreeverb * filter,
     gint16 * idata, gint16 * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1l, input_1r;
-  gfloat out_l2, out_r2, input_2l, input_2r;
+  gfloat in_l[FREEVERB_BLOCK], in_r[FREEVERB_BLOCK];
+  gfloat out_l1[FREEVERB_BLOCK], out_r1[FREEVERB_BLOCK];
+  gfloat out_l2, out_r2;
+  gint j, n;
+  guint k;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
-
-    input_2l = (gfloat) * idata++;
-    input_2r = (gfloat) * idata++;
-    input_1l = (input_2l + DC_OFFSET) * priv->gain;
-    input_1r = (input_2r + DC_OFFSET) * priv->gain;
+  for (k = 0; k < num_samples; k += n) {
+    n = MIN ((gint) (num_samples - k), priv->block_size);
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1l, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1r, out_r1);
+    for (j = 0; j < n; j++) {
+      in_l[j] = ((gfloat) idata[2 * j] + DC_OFFSET) * priv->gain;
+      in_r[j] = ((gfloat) idata[2 * j + 1] + DC_OFFSET) * priv->gain;
     }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
-    }
-
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
-
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2l * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2r * priv->dry;
-    out_l2 = CLAMP (out_l2, G_MININT16, G_MAXINT16);
-    out_r2 = CLAMP (out_r2, G_MININT16, G_MAXINT16);
-    *odata++ = (gint16) out_l2;
-    *odata++ = (gint16) out_r2;
 
-    if (abs ((gint16) out_l2) > 0 || abs ((gint16) out_r2) > 0)
-      drained = FALSE;
+    freeverb_revmodel_process_block (priv, in_l, in_r, out_l1, out_r1, n);
+
+    for (j = 0; j < n; j++) {
+      /* Remove the DC offset */
+      out_l1[j] -= (gfloat) DC_OFFSET;
+      out_r1[j] -= (gfloat) DC_OFFSET;
+
+      /* Calculate output */
+      out_l2 = out_l1[j] * priv->wet1 + out_r1[j] * priv->wet2 +
+          idata[2 * j] * priv->dry;
+      out_r2 = out_r1[j] * priv->wet1 + out_l1[j] * priv->wet2 +
+          idata[2 * j + 1] * priv->dry;
+      out_l2 = CLAMP (out_l2, G_MININT16, G_MAXINT16);
+      out_r2 = CLAMP (out_r2, G_MININT16, G_MAXINT16);
+      *odata++ = (gint16) out_l2;
+      *odata++ = (gint16) out_r2;
+
+      if (abs ((gint16) out_l2) > 0 || abs ((gint16) out_r2) > 0)
+        drained = FALSE;
+    }
+    idata += 2 * n;
   }
   return drained;
 }
@@ -789,44 +1031,42 @@ gst_freeverb_transform_m2s_float (GstFreeverb * filter,
     gfloat * idata, gfloat * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1;
-  gfloat out_l2, out_r2, input_2;
+  gfloat in_l[FREEVERB_BLOCK], in_r[FREEVERB_BLOCK];
+  gfloat out_l1[FREEVERB_BLOCK], out_r1[FREEVERB_BLOCK];
+  gfloat out_l2, out_r2;
+  gint j, n;
+  guint k;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
+  for (k = 0; k < num_samples; k += n) {
+    n = MIN ((gint) (num_samples - k), priv->block_size);
 
     /* The original Freeverb code expects a stereo signal and 'input_1'
      * is set to the sum of the left and right input_1 sample. Since
      * this code works on a mono signal, 'input_1' is set to twice the
      * input_1 sample. */
-    input_2 = *idata++;
-    input_1 = (2.0f * input_2 + DC_OFFSET) * priv->gain;
-
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1, out_r1);
+    for (j = 0; j < n; j++)
+      in_l[j] = in_r[j] = (2.0f * (gfloat) idata[j] + DC_OFFSET) * priv->gain;
+
+    freeverb_revmodel_process_block (priv, in_l, in_r, out_l1, out_r1, n);
+
+    for (j = 0; j < n; j++) {
+      /* Remove the DC offset */
+      out_l1[j] -= (gfloat) DC_OFFSET;
+      out_r1[j] -= (gfloat) DC_OFFSET;
+
+      /* Calculate output */
+      out_l2 = out_l1[j] * priv->wet1 + out_r1[j] * priv->wet2 +
+          idata[j] * priv->dry;
+      out_r2 = out_r1[j] * priv->wet1 + out_l1[j] * priv->wet2 +
+          idata[j] * priv->dry;
+      *odata++ = out_l2;
+      *odata++ = out_r2;
+
+      if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
+        drained = FALSE;
     }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
-    }
-
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
-
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2 * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2 * priv->dry;
-    *odata++ = out_l2;
-    *odata++ = out_r2;
-
-    if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
-      drained = FALSE;
+    idata += n;
   }
   return drained;
 }
@@ -836,46 +1076,78 @@ gst_freeverb_transform_s2s_float (GstFreeverb * filter,
     gfloat * idata, gfloat * odata, guint num_samples)
 {
   GstFreeverbPrivate *priv = filter->priv;
-  gint i, k;
-  gfloat out_l1, out_r1, input_1l, input_1r;
-  gfloat out_l2, out_r2, input_2l, input_2r;
+  gfloat in_l[FREEVERB_BLOCK], in_r[FREEVERB_BLOCK];
+  gfloat out_l1[FREEVERB_BLOCK], out_r1[FREEVERB_BLOCK];
+  gfloat out_l2, out_r2;
+  gint j, n;
+  guint k;
   gboolean drained = TRUE;
 
-  for (k = 0; k < num_samples; k++) {
-    out_l1 = out_r1 = 0.0;
-
-    input_2l = *idata++;
-    input_2r = *idata++;
-    input_1l = (input_2l + DC_OFFSET) * priv->gain;
-    input_1r = (input_2r + DC_OFFSET) * priv->gain;
+  for (k = 0; k < num_samples; k += n) {
+    n = MIN ((gint) (num_samples - k), priv->block_size);
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      freeverb_comb_process (priv->combL[i], input_1l, out_l1);
-      freeverb_comb_process (priv->combR[i], input_1r, out_r1);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      freeverb_allpass_process (priv->allpassL[i], out_l1);
-      freeverb_allpass_process (priv->allpassR[i], out_r1);
+    for (j = 0; j < n; j++) {
+      in_l[j] = ((gfloat) idata[2 * j] + DC_OFFSET) * priv->gain;
+      in_r[j] = ((gfloat) idata[2 * j + 1] + DC_OFFSET) * priv->gain;
     }
 
-    /* Remove the DC offset */
-    out_l1 -= (gfloat) DC_OFFSET;
-    out_r1 -= (gfloat) DC_OFFSET;
+    freeverb_revmodel_process_block (priv, in_l, in_r, out_l1, out_r1, n);
+
+    for (j = 0; j < n; j++) {
+      /* Remove the DC offset */
+      out_l1[j] -= (gfloat) DC_OFFSET;
+      out_r1[j] -= (gfloat) DC_OFFSET;
 
-    /* Calculate output */
-    out_l2 = out_l1 * priv->wet1 + out_r1 * priv->wet2 + input_2l * priv->dry;
-    out_r2 = out_r1 * priv->wet1 + out_l1 * priv->wet2 + input_2r * priv->dry;
-    *odata++ = out_l2;
-    *odata++ = out_r2;
+      /* Calculate output */
+      out_l2 = out_l1[j] * priv->wet1 + out_r1[j] * priv->wet2 +
+          idata[2 * j] * priv->dry;
+      out_r2 = out_r1[j] * priv->wet1 + out_l1[j] * priv->wet2 +
+          idata[2 * j + 1] * priv->dry;
+      *odata++ = out_l2;
+      *odata++ = out_r2;
 
-    if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
-      drained = FALSE;
+      if (fabs (out_l2) > 0 || fabs (out_r2) > 0)
+        drained = FALSE;
+    }
+    idata += 2 * n;
   }
   return drained;
 }
 
+/* Flushes denormals to zero, these would otherwise show up while the reverb
+ * decays and make the processing many times slower. Returns the previous
+ * state for freeverb_restore_denormals(). */
+static guint64
+freeverb_flush_denormals (void)
+{
+#if defined (__SSE2__)
+  guint csr = _mm_getcsr ();
+
+  /* flush-to-zero and denormals-are-zero */
+  _mm_setcsr (csr | 0x8040);
+  return csr;
+#elif defined (__aarch64__) && defined (__GNUC__)
+  guint64 fpcr;
+
+  __asm__ __volatile__ ("mrs %0, fpcr":"=r" (fpcr));
+  __asm__ __volatile__ ("msr fpcr, %0"::"r" (fpcr | (1 << 24)));
+  return fpcr;
+#else
+  /* ARMv7 NEON always flushes, elsewhere the DC offset is used */
+  return 0;
+#endif
+}
+
+static void
+freeverb_restore_denormals (guint64 state)
+{
+#if defined (__SSE2__)
+  _mm_setcsr ((guint) state);
+#elif defined (__aarch64__) && defined (__GNUC__)
+  __asm__ __volatile__ ("msr fpcr, %0"::"r" (state));
+#endif
+}
+
 /* this function does the actual processing
  */
 static GstFlowReturn
@@ -913,8 +1185,11 @@ gst_freeverb_transform (GstBaseTransform * base, GstBuffer * inbuf,
   }
 
   if (!filter->drained) {
+    guint64 fpstate = freeverb_flush_denormals ();
+
     filter->drained =
         filter->process (filter, inmap.data, outmap.data, num_samples);
+    freeverb_restore_denormals (fpstate);
   }
 
   if (filter->drained) {
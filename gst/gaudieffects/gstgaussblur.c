@@ -56,18 +56,23 @@
  * gst-launch-1.0 -v videotestsrc ! gaussianblur ! videoconvert ! autovideosink
  * ]| This pipeline shows the effect of gaussianblur on a test stream
  *
+ * The default method convolves with the gaussian kernel, whose cost grows
+ * with sigma. The box method approximates it with three successive box
+ * blurs and costs the same for any sigma, which suits large radii.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
-#include <string.h>
 #endif
 
+#include <string.h>
 #include <math.h>
 #include <gst/gst.h>
 
 #include "gstplugin.h"
 #include "gstgaussblur.h"
+#include "gstgaussblurpass.h"
 
 static void gst_gaussianblur_finalize (GObject * object);
 
@@ -111,17 +116,56 @@ GST_STATIC_PAD_TEMPLATE ("src",
 enum
 {
   PROP_0,
-  PROP_SIGMA
+  PROP_SIGMA,
+  PROP_METHOD,
+  PROP_N_THREADS
 };
 
+/* the kernel coefficients are in Q12, the rows blurred vertically in Q4 */
+#define COEFF_SHIFT 12
+#define TMP_SHIFT 4
+
+typedef void (*GstGaussianBlurRowsFunc) (GstGaussianBlur * gb,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame, gint first,
+    gint last);
+
 static gboolean make_gaussian_kernel (GstGaussianBlur * gb, float sigma);
-static void gaussian_smooth (GstGaussianBlur * gb, guint8 * image,
-    guint8 * out_image);
+static void make_box_radii (GstGaussianBlur * gb, float sigma);
+static void gaussian_smooth (GstGaussianBlur * gb, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame, gint first, gint last);
+static void box_smooth_rows (GstGaussianBlur * gb, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame, gint first, gint last);
+static void box_smooth_columns (GstGaussianBlur * gb,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame, gint first,
+    gint last);
+static void gst_gaussianblur_run (GstGaussianBlur * gb, gint n_units,
+    GstGaussianBlurRowsFunc func, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame);
+
+#define GST_TYPE_GAUSSIANBLUR_METHOD (gst_gaussianblur_method_get_type ())
+static GType
+gst_gaussianblur_method_get_type (void)
+{
+  static GType method_type = 0;
+
+  static const GEnumValue methods[] = {
+    {GST_GAUSSIANBLUR_METHOD_GAUSSIAN, "Gaussian kernel", "gaussian"},
+    {GST_GAUSSIANBLUR_METHOD_BOX, "Approximation by three box blurs", "box"},
+    {0, NULL, NULL},
+  };
+
+  if (!method_type) {
+    method_type = g_enum_register_static ("GstGaussianBlurMethod", methods);
+  }
+  return method_type;
+}
 
 #define gst_gaussianblur_parent_class parent_class
 G_DEFINE_TYPE (GstGaussianBlur, gst_gaussianblur, GST_TYPE_VIDEO_FILTER);
 
 #define DEFAULT_SIGMA 1.2
+#define DEFAULT_METHOD GST_GAUSSIANBLUR_METHOD_GAUSSIAN
+#define DEFAULT_N_THREADS 1
 
 /* Initalize the gaussianblur's class. */
 static void
@@ -151,6 +195,15 @@ gst_gaussianblur_class_init (GstGaussianBlurClass * klass)
           "Sigma value for gaussian blur (negative for sharpen)",
           -20.0, 20.0, DEFAULT_SIGMA,
           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_METHOD,
+      g_param_spec_enum ("method", "Method",
+          "How to compute the blur", GST_TYPE_GAUSSIANBLUR_METHOD,
+          DEFAULT_METHOD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   vfilter_class->transform_frame =
       GST_DEBUG_FUNCPTR (gst_gaussianblur_transform_frame);
@@ -162,15 +215,18 @@ gst_gaussianblur_set_info (GstVideoFilter * filter, GstCaps * incaps,
     GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
 {
   GstGaussianBlur *gb = GST_GAUSSIANBLUR (filter);
-  guint32 n_elems;
 
   gb->width = GST_VIDEO_INFO_WIDTH (in_info);
   gb->height = GST_VIDEO_INFO_HEIGHT (in_info);
 
   /* get stride */
   gb->stride = GST_VIDEO_INFO_COMP_STRIDE (in_info, 0);
-  n_elems = gb->stride * gb->height;
-  gb->tempim = g_malloc (sizeof (gfloat) * n_elems);
+
+  /* the box method buffers are allocated on first use */
+  g_free (gb->boxim[0]);
+  gb->boxim[0] = NULL;
+  g_free (gb->boxim[1]);
+  gb->boxim[1] = NULL;
 
   return TRUE;
 }
@@ -180,6 +236,9 @@ gst_gaussianblur_init (GstGaussianBlur * gb)
 {
   gb->sigma = (gfloat) DEFAULT_SIGMA;
   gb->cur_sigma = -1.0;
+  gb->method = DEFAULT_METHOD;
+  gb->n_threads = DEFAULT_N_THREADS;
+  gst_stripe_threads_init (&gb->threads, DEFAULT_N_THREADS);
 }
 
 static void
@@ -187,16 +246,17 @@ gst_gaussianblur_finalize (GObject * object)
 {
   GstGaussianBlur *gb = GST_GAUSSIANBLUR (object);
 
-  g_free (gb->tempim);
-  gb->tempim = NULL;
+  gst_stripe_threads_clear (&gb->threads);
 
-  g_free (gb->smoothedim);
-  gb->smoothedim = NULL;
+  g_free (gb->boxim[0]);
+  gb->boxim[0] = NULL;
+  g_free (gb->boxim[1]);
+  gb->boxim[1] = NULL;
 
   g_free (gb->kernel);
   gb->kernel = NULL;
-  g_free (gb->kernel_sum);
-  gb->kernel_sum = NULL;
+  g_free (gb->coeffs);
+  gb->coeffs = NULL;
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -209,7 +269,7 @@ gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
   GstClockTime timestamp;
   gint64 stream_time;
   gfloat sigma;
-  guint8 *src, *dest;
+  GstGaussianBlurMethod method;
 
   /* GstController: update the properties */
   timestamp = GST_BUFFER_TIMESTAMP (in_frame->buffer);
@@ -225,13 +285,15 @@ gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
 
   GST_OBJECT_LOCK (filter);
   sigma = filter->sigma;
+  method = filter->method;
+  filter->threads.n_threads = filter->n_threads;
   GST_OBJECT_UNLOCK (filter);
 
   if (filter->cur_sigma != sigma) {
     g_free (filter->kernel);
     filter->kernel = NULL;
-    g_free (filter->kernel_sum);
-    filter->kernel_sum = NULL;
+    g_free (filter->coeffs);
+    filter->coeffs = NULL;
     filter->cur_sigma = sigma;
   }
   if (filter->kernel == NULL &&
@@ -245,114 +307,256 @@ gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
    * Perform gaussian smoothing on the image using the input standard
    * deviation.
    */
-  src = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0);
-  dest = GST_VIDEO_FRAME_COMP_DATA (out_frame, 0);
-  gst_video_frame_copy (out_frame, in_frame);
-  if (filter->sigma != 0.0)
-    gaussian_smooth (filter, src, dest);
+  if (filter->cur_sigma == 0.0) {
+    gst_video_frame_copy (out_frame, in_frame);
+  } else if (method == GST_GAUSSIANBLUR_METHOD_BOX) {
+    gsize n_elems = (gsize) filter->width * 4 * filter->height;
+
+    if (filter->boxim[0] == NULL) {
+      filter->boxim[0] = g_new (guint16, n_elems);
+      filter->boxim[1] = g_new (guint16, n_elems);
+    }
+    make_box_radii (filter, filter->cur_sigma);
+    /* rows are independent in the horizontal passes, columns in the
+     * vertical ones */
+    gst_gaussianblur_run (filter, filter->height, box_smooth_rows, in_frame,
+        out_frame);
+    gst_gaussianblur_run (filter, filter->width, box_smooth_columns,
+        in_frame, out_frame);
+  } else {
+    gst_gaussianblur_run (filter, filter->height, gaussian_smooth, in_frame,
+        out_frame);
+  }
 
   return GST_FLOW_OK;
 }
 
+typedef struct
+{
+  GstGaussianBlur *gb;
+  GstGaussianBlurRowsFunc func;
+  GstVideoFrame *in_frame;
+  GstVideoFrame *out_frame;
+} GstGaussianBlurPass;
+
+static void
+gst_gaussianblur_run_stripe (gpointer user_data, guint stripe, gint first,
+    gint last)
+{
+  GstGaussianBlurPass *pass = user_data;
+
+  pass->func (pass->gb, pass->in_frame, pass->out_frame, first, last);
+}
+
+/* Runs func over n_units rows or columns split in stripes, the calling
+ * thread handles the first stripe and waits for the others to be done. */
 static void
-blur_row_x (GstGaussianBlur * gb, guint8 * in_row, gfloat * out_row)
+gst_gaussianblur_run (GstGaussianBlur * gb, gint n_units,
+    GstGaussianBlurRowsFunc func, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame)
 {
-  int c, cc, center;
-  float dot[4], sum;
-  int k, kmin, kmax;
-
-  center = gb->windowsize / 2;
-
-  for (c = 0; c < gb->width; c++) {
-    /* Calculate min */
-    cc = center - c;
-    kmin = MAX (0, cc);
-    cc = kmin - cc;
-    /* Calc max */
-    kmax = MIN (gb->windowsize, gb->width - cc);
-    cc *= 4;
-
-    dot[0] = dot[1] = dot[2] = dot[3] = 0.0;
-    /* Calculate sum for range */
-    sum = gb->kernel_sum[kmax - 1];
-    sum -= kmin ? gb->kernel_sum[kmin - 1] : 0.0;
-
-    for (k = kmin; k < kmax; k++) {
-      float coeff = gb->kernel[k];
-      dot[0] += (float) in_row[cc++] * coeff;
-      dot[1] += (float) in_row[cc++] * coeff;
-      dot[2] += (float) in_row[cc++] * coeff;
-      dot[3] += (float) in_row[cc++] * coeff;
+  GstGaussianBlurPass pass;
+
+  pass.gb = gb;
+  pass.func = func;
+  pass.in_frame = in_frame;
+  pass.out_frame = out_frame;
+  gst_stripe_threads_run (&gb->threads, n_units, 16,
+      gst_gaussianblur_run_stripe, &pass);
+}
+
+/* Separable convolution of the output rows [first, last), with the edge
+ * pixels repeated outside of the frame */
+static void
+gaussian_smooth (GstGaussianBlur * gb, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame, gint first, gint last)
+{
+  gint r, k, center = gb->windowsize / 2;
+  gint n = gb->width * 4;
+  gint n_taps = (gb->windowsize + 1) & ~1;
+  guint8 *image = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0);
+  guint8 *out_image = GST_VIDEO_FRAME_COMP_DATA (out_frame, 0);
+  gint in_stride = GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 0);
+  gint out_stride = GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 0);
+  const guint8 **rows = g_newa (const guint8 *, n_taps);
+  gint16 *tmp, *row;
+
+  /* room for the repeated pixels, plus the padding tap */
+  tmp = g_new0 (gint16, n + 4 * (n_taps + 1));
+  row = tmp + 4 * center;
+
+  for (r = first; r < last; r++) {
+    gint x;
+
+    for (k = 0; k < n_taps; k++) {
+      gint y = CLAMP (r + MIN (k, gb->windowsize - 1) - center, 0,
+          gb->height - 1);
+
+      rows[k] = image + y * in_stride;
+    }
+    gst_gaussianblur_column_pass (gb->coeffs, n_taps, rows, row, n);
+
+    for (x = 0; x < center; x++) {
+      memcpy (tmp + 4 * x, row, 4 * sizeof (gint16));
+      memcpy (row + n + 4 * x, row + n - 4, 4 * sizeof (gint16));
     }
 
-    out_row[c * 4] = dot[0] / sum;
-    out_row[c * 4 + 1] = dot[1] / sum;
-    out_row[c * 4 + 2] = dot[2] / sum;
-    out_row[c * 4 + 3] = dot[3] / sum;
+    gst_gaussianblur_row_pass (gb->coeffs, n_taps, tmp,
+        out_image + r * out_stride, n);
+  }
+
+  g_free (tmp);
+}
+
+/* One box blur of radius r along a line of Q8 samples, step elements apart,
+ * with the edge samples repeated */
+static inline void
+box_blur_line (const guint16 * src, guint16 * dest, gint len, gint step,
+    gint r)
+{
+  guint32 inv = (65536 + r) / (2 * r + 1);
+  guint32 sum;
+  gint i;
+
+  sum = (r + 1) * src[0];
+  for (i = 1; i <= r; i++)
+    sum += src[MIN (i, len - 1) * step];
+
+  for (i = 0; i < len; i++) {
+    dest[i * step] = (sum * inv + 32768) >> 16;
+    sum += src[MIN (i + r + 1, len - 1) * step];
+    sum -= src[MAX (i - r, 0) * step];
   }
 }
 
+/* Horizontal box passes over the rows [first, last), from the input frame
+ * to boxim[0] */
 static void
-gaussian_smooth (GstGaussianBlur * gb, guint8 * image, guint8 * out_image)
+box_smooth_rows (GstGaussianBlur * gb, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame, gint first, gint last)
 {
-  int r, c, rr, center;
-  float dot[4], sum;
-  int k, kmin, kmax;
-  guint8 *in_row = image;
-  float *tmp_out_row = gb->tempim;
-  float *tmp_in_pos;
-  gint y_avail = 0;
-  guint8 *out_row;
-
-  /* Apply the gaussian kernel */
-  center = gb->windowsize / 2;
-
-  /* Blur in the y - direction. */
-  for (r = 0; r < gb->height; r++) {
-    /* Calculate input row range */
-    rr = center - r;
-    kmin = MAX (0, rr);
-    rr = kmin - rr;
-    /* Calc max */
-    kmax = MIN (gb->windowsize, gb->height - rr);
-
-    /* Precalculate sum for range */
-    sum = gb->kernel_sum[kmax - 1];
-    sum -= kmin ? gb->kernel_sum[kmin - 1] : 0.0;
-
-    /* Blur more input rows (x direction blur) */
-    while (y_avail <= (r + center) && y_avail < gb->height) {
-      blur_row_x (gb, in_row, tmp_out_row);
-      in_row += gb->stride;
-      tmp_out_row += gb->stride;
-      y_avail++;
+  guint8 *image = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0);
+  gint in_stride = GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 0);
+  gint n = gb->width * 4;
+  guint16 *a = g_new (guint16, 2 * n);
+  guint16 *b = a + n;
+  gint y, i, c;
+
+  for (y = first; y < last; y++) {
+    guint8 *in = image + y * in_stride;
+    guint16 *out = gb->boxim[0] + y * n;
+
+    for (i = 0; i < n; i++)
+      a[i] = in[i] << 8;
+
+    for (c = 0; c < 4; c++) {
+      box_blur_line (a + c, b + c, gb->width, 4, gb->box_radius[0]);
+      box_blur_line (b + c, a + c, gb->width, 4, gb->box_radius[1]);
+      box_blur_line (a + c, out + c, gb->width, 4, gb->box_radius[2]);
     }
+  }
 
-    tmp_in_pos = gb->tempim + (rr * gb->stride);
-    out_row = out_image + r * gb->stride;
+  g_free (a);
+}
 
-    for (c = 0; c < gb->width; c++) {
-      float *tmp = tmp_in_pos;
+/* One box blur of radius r down the columns [c0, c1) of src, with the
+ * edge rows repeated. The columns are processed side by side so that the
+ * memory is walked row by row. */
+static void
+box_blur_columns (GstGaussianBlur * gb, const guint16 * src, guint16 * dest,
+    guint32 * sums, gint c0, gint c1, gint r)
+{
+  gint n = gb->width * 4, h = gb->height;
+  guint32 inv = (65536 + r) / (2 * r + 1);
+  gint y, i, c;
 
-      dot[0] = dot[1] = dot[2] = dot[3] = 0.0;
-      for (k = kmin; k < kmax; k++, tmp += gb->stride) {
-        float kern = gb->kernel[k];
-        dot[0] += tmp[0] * kern;
-        dot[1] += tmp[1] * kern;
-        dot[2] += tmp[2] * kern;
-        dot[3] += tmp[3] * kern;
-      }
+  for (c = c0; c < c1; c++)
+    sums[c - c0] = (r + 1) * src[c];
+  for (i = 1; i <= r; i++) {
+    const guint16 *s = src + MIN (i, h - 1) * n;
+
+    for (c = c0; c < c1; c++)
+      sums[c - c0] += s[c];
+  }
+
+  for (y = 0; y < h; y++) {
+    const guint16 *add = src + MIN (y + r + 1, h - 1) * n;
+    const guint16 *sub = src + MAX (y - r, 0) * n;
+    guint16 *d = dest + y * n;
 
-      *out_row++ = (guint8) CLAMP ((dot[0] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[1] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[2] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[3] / sum + 0.5), 0, 255);
+    for (c = c0; c < c1; c++) {
+      guint32 sum = sums[c - c0];
 
-      tmp_in_pos += 4;
+      d[c] = (sum * inv + 32768) >> 16;
+      sums[c - c0] = sum + add[c] - sub[c];
     }
   }
 }
 
+/* Vertical box passes over the pixel columns [first, last), from boxim[0]
+ * to the output frame. A negative sigma sharpens by subtracting the blur
+ * from twice the input. */
+static void
+box_smooth_columns (GstGaussianBlur * gb, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame, gint first, gint last)
+{
+  guint8 *image = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0);
+  guint8 *out_image = GST_VIDEO_FRAME_COMP_DATA (out_frame, 0);
+  gint in_stride = GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 0);
+  gint out_stride = GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 0);
+  gint n = gb->width * 4;
+  gint c0 = first * 4, c1 = last * 4;
+  guint32 *sums = g_new (guint32, c1 - c0);
+  gint y, c;
+
+  box_blur_columns (gb, gb->boxim[0], gb->boxim[1], sums, c0, c1,
+      gb->box_radius[0]);
+  box_blur_columns (gb, gb->boxim[1], gb->boxim[0], sums, c0, c1,
+      gb->box_radius[1]);
+  box_blur_columns (gb, gb->boxim[0], gb->boxim[1], sums, c0, c1,
+      gb->box_radius[2]);
+
+  for (y = 0; y < gb->height; y++) {
+    const guint16 *blur = gb->boxim[1] + y * n;
+    const guint8 *in = image + y * in_stride;
+    guint8 *out = out_image + y * out_stride;
+
+    if (gb->cur_sigma < 0) {
+      for (c = c0; c < c1; c++) {
+        gint v = ((in[c] << 9) - blur[c] + 128) >> 8;
+
+        out[c] = CLAMP (v, 0, 255);
+      }
+    } else {
+      for (c = c0; c < c1; c++)
+        out[c] = MIN ((blur[c] + 128) >> 8, 255);
+    }
+  }
+
+  g_free (sums);
+}
+
+/*
+ * Radii of three box blurs whose succession approximates a gaussian blur
+ * of standard deviation sigma, the variance of a box of width w being
+ * (w * w - 1) / 12.
+ */
+static void
+make_box_radii (GstGaussianBlur * gb, float sigma)
+{
+  gdouble s2 = sigma * sigma;
+  gint wl, m, i;
+
+  wl = (gint) sqrt (12.0 * s2 / 3 + 1);
+  if (wl % 2 == 0)
+    wl--;
+  m = (gint) floor ((12.0 * s2 - 3 * wl * wl - 12 * wl - 9) /
+      (-4.0 * wl - 4) + 0.5);
+
+  for (i = 0; i < 3; i++)
+    gb->box_radius[i] = ((i < m ? wl : wl + 2) - 1) / 2;
+}
+
 /*
  * Create a one dimensional gaussian kernel.
  */
@@ -360,7 +564,8 @@ static gboolean
 make_gaussian_kernel (GstGaussianBlur * gb, float sigma)
 {
   int i, center, left, right;
-  float sum, sum2;
+  float sum;
+  gint isum;
   const float fe = -0.5 / (sigma * sigma);
   const float dx = 1.0 / (sigma * sqrt (2 * G_PI));
 
@@ -368,13 +573,14 @@ make_gaussian_kernel (GstGaussianBlur * gb, float sigma)
   gb->windowsize = (int) (1 + 2 * center);
 
   gb->kernel = g_new (float, gb->windowsize);
-  gb->kernel_sum = g_new (float, gb->windowsize);
-  if (gb->kernel == NULL || gb->kernel_sum == NULL)
+  /* padded to an even number of taps */
+  gb->coeffs = g_new0 (gint16, gb->windowsize + 1);
+  if (gb->kernel == NULL || gb->coeffs == NULL)
     return FALSE;
 
   if (gb->windowsize == 1) {
     gb->kernel[0] = 1.0;
-    gb->kernel_sum[0] = 1.0;
+    gb->coeffs[0] = 1 << COEFF_SHIFT;
     return TRUE;
   }
 
@@ -398,22 +604,25 @@ make_gaussian_kernel (GstGaussianBlur * gb, float sigma)
   for (i = 0; i < gb->windowsize; i++)
     gb->kernel[i] /= sum;
 
-  sum2 = 0.0;
+  /* fixed point version, the rounding error goes to the center so that
+   * flat areas are left untouched */
+  isum = 0;
   for (i = 0; i < gb->windowsize; i++) {
-    sum2 += gb->kernel[i];
-    gb->kernel_sum[i] = sum2;
+    gb->coeffs[i] = (gint16) floor (gb->kernel[i] * (1 << COEFF_SHIFT) +
+        0.5);
+    isum += gb->coeffs[i];
   }
+  gb->coeffs[center] += (1 << COEFF_SHIFT) - isum;
 
 #if 0
   g_print ("Sigma %f: ", sigma);
   for (i = 0; i < gb->windowsize; i++)
     g_print ("%f ", gb->kernel[i]);
   g_print ("\n");
-  g_print ("sums: ");
+  g_print ("coeffs: ");
   for (i = 0; i < gb->windowsize; i++)
-    g_print ("%f ", gb->kernel_sum[i]);
+    g_print ("%d ", gb->coeffs[i]);
   g_print ("\n");
-  g_print ("sum %f sum2 %f\n", sum, sum2);
 #endif
 
   return TRUE;
@@ -430,6 +639,16 @@ gst_gaussianblur_set_property (GObject * object,
       gb->sigma = g_value_get_double (value);
       GST_OBJECT_UNLOCK (object);
       break;
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (object);
+      gb->method = g_value_get_enum (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (object);
+      gb->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -447,6 +666,16 @@ gst_gaussianblur_get_property (GObject * object,
       g_value_set_double (value, gb->sigma);
       GST_OBJECT_UNLOCK (gb);
       break;
+    case PROP_METHOD:
+      GST_OBJECT_LOCK (gb);
+      g_value_set_enum (value, gb->method);
+      GST_OBJECT_UNLOCK (gb);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (gb);
+      g_value_set_uint (value, gb->n_threads);
+      GST_OBJECT_UNLOCK (gb);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -51,6 +51,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
+#include <gst/stripe-threads-private.h>
 
 G_BEGIN_DECLS
 
@@ -61,18 +62,31 @@ G_BEGIN_DECLS
 typedef struct _GstGaussianBlur GstGaussianBlur;
 typedef struct _GstGaussianBlurClass GstGaussianBlurClass;
 
+typedef enum
+{
+  GST_GAUSSIANBLUR_METHOD_GAUSSIAN,
+  GST_GAUSSIANBLUR_METHOD_BOX
+} GstGaussianBlurMethod;
+
 struct _GstGaussianBlur
 {
   GstVideoFilter videofilter;
   gint width, height, stride;
 
   float cur_sigma, sigma;
+  GstGaussianBlurMethod method;
   int windowsize;
 
   float *kernel;
-  float *kernel_sum;
-  float *tempim;
-  gint16 *smoothedim;
+  gint16 *coeffs;
+
+  /* box method */
+  gint box_radius[3];
+  guint16 *boxim[2];
+
+  guint n_threads;
+  /* threads.n_threads is n_threads for the current frame */
+  GstStripeThreads threads;
 };
 
 struct _GstGaussianBlurClass
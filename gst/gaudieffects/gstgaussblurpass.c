@@ -0,0 +1,174 @@
+/*
+ * GStreamer
+ * Copyright (C) <2010> Jan Schmidt <thaytan@noraisin.net>
+ * Copyright (C) <2012> Luis de Bethencourt <luis@debethencourt.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "gstgaussblurpass.h"
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/* Vertical pass: out[i] = sum of coeffs[k] * rows[k][i] in Q4. The
+ * coefficients and rows are padded to an even count so that the taps can
+ * be taken two at a time. */
+void
+gst_gaussianblur_column_pass (const gint16 * coeffs, gint n_taps,
+    const guint8 ** rows, gint16 * out, gint n)
+{
+  gint i = 0, k;
+
+#if defined (__SSE2__)
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; i + 16 <= n; i += 16) {
+    __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+
+    for (k = 0; k < n_taps; k += 2) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (rows[k] + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (rows[k + 1] + i));
+      __m128i c = _mm_set1_epi32 ((guint32) (guint16) coeffs[k + 1] << 16 |
+          (guint16) coeffs[k]);
+      __m128i lo = _mm_unpacklo_epi8 (a, b);
+      __m128i hi = _mm_unpackhi_epi8 (a, b);
+
+      /* a0 b0 a1 b1 ... as 16 bit pairs */
+      acc0 = _mm_add_epi32 (acc0, _mm_madd_epi16 (_mm_unpacklo_epi8 (lo,
+                  zero), c));
+      acc1 = _mm_add_epi32 (acc1, _mm_madd_epi16 (_mm_unpackhi_epi8 (lo,
+                  zero), c));
+      acc2 = _mm_add_epi32 (acc2, _mm_madd_epi16 (_mm_unpacklo_epi8 (hi,
+                  zero), c));
+      acc3 = _mm_add_epi32 (acc3, _mm_madd_epi16 (_mm_unpackhi_epi8 (hi,
+                  zero), c));
+    }
+    acc0 = _mm_srai_epi32 (_mm_add_epi32 (acc0, _mm_set1_epi32 (128)), 8);
+    acc1 = _mm_srai_epi32 (_mm_add_epi32 (acc1, _mm_set1_epi32 (128)), 8);
+    acc2 = _mm_srai_epi32 (_mm_add_epi32 (acc2, _mm_set1_epi32 (128)), 8);
+    acc3 = _mm_srai_epi32 (_mm_add_epi32 (acc3, _mm_set1_epi32 (128)), 8);
+    _mm_storeu_si128 ((__m128i *) (out + i), _mm_packs_epi32 (acc0, acc1));
+    _mm_storeu_si128 ((__m128i *) (out + i + 8), _mm_packs_epi32 (acc2,
+            acc3));
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  for (; i + 8 <= n; i += 8) {
+    int32x4_t acc0 = vdupq_n_s32 (0), acc1 = vdupq_n_s32 (0);
+
+    for (k = 0; k < n_taps; k++) {
+      int16x8_t v = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (rows[k] + i)));
+
+      acc0 = vmlal_n_s16 (acc0, vget_low_s16 (v), coeffs[k]);
+      acc1 = vmlal_n_s16 (acc1, vget_high_s16 (v), coeffs[k]);
+    }
+    vst1q_s16 (out + i, vcombine_s16 (vrshrn_n_s32 (acc0, 8),
+            vrshrn_n_s32 (acc1, 8)));
+  }
+#endif
+
+  for (; i < n; i++) {
+    gint acc = 0;
+
+    for (k = 0; k < n_taps; k++)
+      acc += coeffs[k] * rows[k][i];
+    out[i] = (acc + 128) >> 8;
+  }
+}
+
+/* Horizontal pass over a Q4 row with the edge pixels repeated on both
+ * sides, out[i] = sum of coeffs[k] * in[i + 4 * k] */
+void
+gst_gaussianblur_row_pass (const gint16 * coeffs, gint n_taps,
+    const gint16 * in, guint8 * out, gint n)
+{
+  gint i = 0, k;
+
+#if defined (__SSE2__)
+  for (; i + 8 <= n; i += 8) {
+    __m128i acc0 = _mm_setzero_si128 (), acc1 = _mm_setzero_si128 ();
+
+    for (k = 0; k < n_taps; k += 2) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (in + i + 4 * k));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (in + i + 4 * k + 4));
+      __m128i c = _mm_set1_epi32 ((guint32) (guint16) coeffs[k + 1] << 16 |
+          (guint16) coeffs[k]);
+
+      acc0 = _mm_add_epi32 (acc0, _mm_madd_epi16 (_mm_unpacklo_epi16 (a, b),
+              c));
+      acc1 = _mm_add_epi32 (acc1, _mm_madd_epi16 (_mm_unpackhi_epi16 (a, b),
+              c));
+    }
+    acc0 = _mm_srai_epi32 (_mm_add_epi32 (acc0, _mm_set1_epi32 (1 << 15)),
+        16);
+    acc1 = _mm_srai_epi32 (_mm_add_epi32 (acc1, _mm_set1_epi32 (1 << 15)),
+        16);
+    acc0 = _mm_packs_epi32 (acc0, acc1);
+    _mm_storel_epi64 ((__m128i *) (out + i), _mm_packus_epi16 (acc0, acc0));
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  for (; i + 8 <= n; i += 8) {
+    int32x4_t acc0 = vdupq_n_s32 (0), acc1 = vdupq_n_s32 (0);
+
+    for (k = 0; k < n_taps; k++) {
+      int16x8_t v = vld1q_s16 (in + i + 4 * k);
+
+      acc0 = vmlal_n_s16 (acc0, vget_low_s16 (v), coeffs[k]);
+      acc1 = vmlal_n_s16 (acc1, vget_high_s16 (v), coeffs[k]);
+    }
+    vst1_u8 (out + i, vqmovun_s16 (vcombine_s16 (vqrshrn_n_s32 (acc0, 16),
+                vqrshrn_n_s32 (acc1, 16))));
+  }
+#endif
+
+  for (; i < n; i++) {
+    gint acc = 0;
+
+    for (k = 0; k < n_taps; k++)
+      acc += coeffs[k] * in[i + 4 * k];
+    out[i] = CLAMP ((acc + (1 << 15)) >> 16, 0, 255);
+  }
+}
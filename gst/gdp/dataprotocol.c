@@ -132,6 +132,8 @@ G_STMT_START {							\
 #define POLY       0x1021
 #define CRC_INIT   0xFFFF
 
+static guint16 gst_dp_crc_update (guint16 crc_register,
+    const guint8 * buffer, gsize length);
 static guint16 gst_dp_crc (const guint8 * buffer, guint length);
 static guint16 gst_dp_crc_from_memory_maps (const GstMapInfo * maps,
     guint n_maps);
@@ -148,6 +150,7 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   guint16 flags_mask;
   guint16 header_crc = 0, crc = 0;
   gsize buffer_size;
+  guint n_mem, max_mem, i;
 
   mem = gst_allocator_alloc (NULL, GST_DP_HEADER_LENGTH, NULL);
   gst_memory_map (mem, &map, GST_MAP_READWRITE);
@@ -220,8 +223,22 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   /* header */
   gst_buffer_append_memory (ret_buf, mem);
 
-  /* buffer data */
-  return gst_buffer_append (ret_buf, gst_buffer_ref (buffer));
+  /* buffer data, by reference. gst_buffer_append() would merge all memories
+   * into a new one if they don't fit next to the header, so only merge the
+   * ones that don't fit in that case */
+  n_mem = gst_buffer_n_memory (buffer);
+  max_mem = gst_buffer_get_max_memory ();
+  for (i = 0; i < n_mem; i++) {
+    if (n_mem < max_mem || i < max_mem - 2) {
+      gst_buffer_append_memory (ret_buf, gst_buffer_get_memory (buffer, i));
+    } else {
+      gst_buffer_append_memory (ret_buf,
+          gst_buffer_get_memory_range (buffer, i, -1));
+      break;
+    }
+  }
+
+  return ret_buf;
 }
 
 GstBuffer *
@@ -375,6 +392,60 @@ static const guint16 gst_dp_crc_table[256] = {
  *
  * Returns: a two-byte CRC checksum.
  */
+/* gst_dp_crc_slice_table[k][b] is the CRC register contribution of byte b
+ * followed by k zero bytes, so that 8 bytes can be processed per step
+ * ("slicing-by-8"). The first table is gst_dp_crc_table. */
+static guint16 gst_dp_crc_slice_table[8][256];
+
+static gpointer
+gst_dp_crc_init_slice_table (gpointer data)
+{
+  guint k, b;
+
+  for (b = 0; b < 256; b++)
+    gst_dp_crc_slice_table[0][b] = gst_dp_crc_table[b];
+
+  for (k = 1; k < 8; k++) {
+    for (b = 0; b < 256; b++) {
+      guint16 prev = gst_dp_crc_slice_table[k - 1][b];
+
+      gst_dp_crc_slice_table[k][b] = (guint16) ((prev << 8) ^
+          gst_dp_crc_table[(prev >> 8) & 0x00ff]);
+    }
+  }
+
+  return NULL;
+}
+
+static guint16
+gst_dp_crc_update (guint16 crc_register, const guint8 * buffer, gsize length)
+{
+  static GOnce slice_table_once = G_ONCE_INIT;
+
+  g_once (&slice_table_once, gst_dp_crc_init_slice_table, NULL);
+
+  while (length >= 8) {
+    crc_register =
+        gst_dp_crc_slice_table[7][buffer[0] ^ (crc_register >> 8)] ^
+        gst_dp_crc_slice_table[6][buffer[1] ^ (crc_register & 0x00ff)] ^
+        gst_dp_crc_slice_table[5][buffer[2]] ^
+        gst_dp_crc_slice_table[4][buffer[3]] ^
+        gst_dp_crc_slice_table[3][buffer[4]] ^
+        gst_dp_crc_slice_table[2][buffer[5]] ^
+        gst_dp_crc_slice_table[1][buffer[6]] ^
+        gst_dp_crc_slice_table[0][buffer[7]];
+    buffer += 8;
+    length -= 8;
+  }
+
+  while (length-- > 0) {
+    crc_register = (guint16) ((crc_register << 8) ^
+        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+  }
+
+  return crc_register;
+}
+
 static guint16
 gst_dp_crc (const guint8 * buffer, guint length)
 {
@@ -386,10 +457,8 @@ gst_dp_crc (const guint8 * buffer, guint length)
   g_assert (buffer != NULL);
 
   /* calc CRC */
-  for (; length--;) {
-    crc_register = (guint16) ((crc_register << 8) ^
-        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
-  }
+  crc_register = gst_dp_crc_update (crc_register, buffer, length);
+
   return (0xffff ^ crc_register);
 }
 
@@ -406,15 +475,8 @@ gst_dp_crc_from_memory_maps (const GstMapInfo * maps, guint n_maps)
 
   /* calc CRC */
   while (n_maps > 0) {
-    guint8 *buffer = maps->data;
-    gsize length = maps->size;
-
-    total_length += length;
-
-    while (length-- > 0) {
-      crc_register = (guint16) ((crc_register << 8) ^
-          gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
-    }
+    total_length += maps->size;
+    crc_register = gst_dp_crc_update (crc_register, maps->data, maps->size);
     --n_maps;
     ++maps;
   }
@@ -507,14 +569,38 @@ gst_dp_buffer_from_header (guint header_length, const guint8 * header,
       gst_buffer_new_allocate (allocator,
       (guint) GST_DP_HEADER_PAYLOAD_LENGTH (header), allocation_params);
 
+  gst_dp_buffer_set_header_fields (buffer, header_length, header);
+
+  return buffer;
+}
+
+/**
+ * gst_dp_buffer_set_header_fields:
+ * @buffer: a #GstBuffer
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ *
+ * Sets the timestamps, offsets and flags described by @header on @buffer,
+ * for when the payload is not read into a buffer from
+ * gst_dp_buffer_from_header().
+ *
+ * This function does not check the header passed to it, use
+ * gst_dp_validate_header() first if the header data is unchecked.
+ */
+void
+gst_dp_buffer_set_header_fields (GstBuffer * buffer, guint header_length,
+    const guint8 * header)
+{
+  g_return_if_fail (GST_IS_BUFFER (buffer));
+  g_return_if_fail (header != NULL);
+  g_return_if_fail (header_length >= GST_DP_HEADER_LENGTH);
+
   GST_BUFFER_TIMESTAMP (buffer) = GST_DP_HEADER_TIMESTAMP (header);
   GST_BUFFER_DTS (buffer) = GST_DP_HEADER_DTS (header);
   GST_BUFFER_DURATION (buffer) = GST_DP_HEADER_DURATION (header);
   GST_BUFFER_OFFSET (buffer) = GST_DP_HEADER_OFFSET (header);
   GST_BUFFER_OFFSET_END (buffer) = GST_DP_HEADER_OFFSET_END (header);
   GST_BUFFER_FLAGS (buffer) = GST_DP_HEADER_BUFFER_FLAGS (header);
-
-  return buffer;
 }
 
 /**
@@ -754,6 +840,59 @@ crc_error:
   }
 }
 
+/**
+ * gst_dp_validate_payload_buffer:
+ * @header_length: the length of the packet header
+ * @header: the byte array of the packet header
+ * @payload: a #GstBuffer with the packet payload
+ *
+ * Like gst_dp_validate_payload(), but for a payload that can be spread over
+ * several memories, which are checked without merging them.
+ *
+ * Returns: %TRUE if the CRC matches, or no CRC checksum is present.
+ */
+gboolean
+gst_dp_validate_payload_buffer (guint header_length, const guint8 * header,
+    GstBuffer * payload)
+{
+  guint16 crc_read, crc_calculated;
+  GstMapInfo *maps;
+  guint n_maps, i;
+
+  g_return_val_if_fail (header != NULL, FALSE);
+  g_return_val_if_fail (header_length >= GST_DP_HEADER_LENGTH, FALSE);
+  g_return_val_if_fail (GST_IS_BUFFER (payload), FALSE);
+
+  if (!(GST_DP_HEADER_FLAGS (header) & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    return TRUE;
+
+  n_maps = gst_buffer_n_memory (payload);
+  maps = g_newa (GstMapInfo, n_maps);
+  for (i = 0; i < n_maps; ++i)
+    gst_memory_map (gst_buffer_peek_memory (payload, i), &maps[i],
+        GST_MAP_READ);
+
+  crc_read = GST_DP_HEADER_CRC_PAYLOAD (header);
+  crc_calculated = gst_dp_crc_from_memory_maps (maps, n_maps);
+
+  for (i = 0; i < n_maps; ++i)
+    gst_memory_unmap (maps[i].memory, &maps[i]);
+
+  if (crc_read != crc_calculated)
+    goto crc_error;
+
+  GST_LOG ("payload crc validation: %02x", crc_read);
+  return TRUE;
+
+  /* ERRORS */
+crc_error:
+  {
+    GST_WARNING ("payload crc mismatch: read %02x, calculated %02x", crc_read,
+        crc_calculated);
+    return FALSE;
+  }
+}
+
 /**
  * gst_dp_validate_packet:
  * @header_length: the length of the packet header
@@ -341,13 +341,15 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
         }
 
         if (this->payload_length) {
-          const guint8 *data;
+          GstBuffer *payload;
           gboolean res;
 
-          data = gst_adapter_map (this->adapter, this->payload_length);
-          res = gst_dp_validate_payload (GST_DP_HEADER_LENGTH, this->header,
-              data);
-          gst_adapter_unmap (this->adapter);
+          /* checks the payload in place, without merging the memories */
+          payload = gst_adapter_get_buffer_fast (this->adapter,
+              this->payload_length);
+          res = gst_dp_validate_payload_buffer (GST_DP_HEADER_LENGTH,
+              this->header, payload);
+          gst_buffer_unref (payload);
 
           if (!res)
             goto payload_validate_error;
@@ -362,21 +364,34 @@ gst_gdp_depay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
           goto no_caps;
 
         GST_LOG_OBJECT (this, "reading GDP buffer from adapter");
-        buf =
-            gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
-            this->allocator, &this->allocation_params);
-        if (!buf)
-          goto buffer_failed;
-
-        /* now take the payload if there is any */
-        if (this->payload_length > 0) {
-          GstMapInfo map;
-
-          gst_buffer_map (buf, &map, GST_MAP_WRITE);
-          gst_adapter_copy (this->adapter, map.data, 0, this->payload_length);
-          gst_buffer_unmap (buf, &map);
-
-          gst_adapter_flush (this->adapter, this->payload_length);
+        if (this->payload_length > 0 && this->allocator == NULL &&
+            this->allocation_params.align == 0 &&
+            this->allocation_params.prefix == 0 &&
+            this->allocation_params.padding == 0) {
+          /* nothing special is needed downstream, so use the payload
+           * memory directly. It is only copied if it is spread over
+           * several input buffers */
+          buf = gst_adapter_take_buffer (this->adapter, this->payload_length);
+          gst_dp_buffer_set_header_fields (buf, GST_DP_HEADER_LENGTH,
+              this->header);
+        } else {
+          buf =
+              gst_dp_buffer_from_header (GST_DP_HEADER_LENGTH, this->header,
+              this->allocator, &this->allocation_params);
+          if (!buf)
+            goto buffer_failed;
+
+          /* now take the payload if there is any */
+          if (this->payload_length > 0) {
+            GstMapInfo map;
+
+            gst_buffer_map (buf, &map, GST_MAP_WRITE);
+            gst_adapter_copy (this->adapter, map.data, 0,
+                this->payload_length);
+            gst_buffer_unmap (buf, &map);
+
+            gst_adapter_flush (this->adapter, this->payload_length);
+          }
         }
 
         if (GST_BUFFER_TIMESTAMP (buf) > -this->ts_offset)
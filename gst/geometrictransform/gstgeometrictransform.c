@@ -49,7 +49,8 @@ static GstVideoFilterClass *parent_class = NULL;
 enum
 {
   PROP_0,
-  PROP_OFF_EDGE_PIXELS
+  PROP_OFF_EDGE_PIXELS,
+  PROP_N_THREADS
 };
 
 #define GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE ( \
@@ -75,16 +76,178 @@ gst_geometric_transform_off_edges_pixels_method_get_type (void)
 }
 
 #define DEFAULT_OFF_EDGE_PIXELS GST_GT_OFF_EDGES_PIXELS_IGNORE
+#define DEFAULT_N_THREADS 1
+
+/* A generate or remap pass over the output frame, ret has the result of
+ * each stripe */
+typedef struct
+{
+  GstGeometricTransform *gt;
+  gboolean generate;
+  gboolean *ret;
+  const guint8 *in_data;
+  guint8 *out_data;
+} GstGeometricTransformPass;
+
+/* Applies the off edge pixels method and returns the offset of the input
+ * pixel in_x,in_y, or -1 if there is none */
+static gint32
+gst_geometric_transform_get_in_offset (GstGeometricTransform * gt,
+    gdouble in_x, gdouble in_y)
+{
+  gint trunc_x, trunc_y;
+
+  /* operate on out of edge pixels */
+  switch (gt->off_edge_pixels) {
+    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
+      in_x = CLAMP (in_x, 0, gt->width - 1);
+      in_y = CLAMP (in_y, 0, gt->height - 1);
+      break;
+
+    case GST_GT_OFF_EDGES_PIXELS_WRAP:
+      in_x = gst_gm_mod_float (in_x, gt->width);
+      in_y = gst_gm_mod_float (in_y, gt->height);
+      if (in_x < 0)
+        in_x += gt->width;
+      if (in_y < 0)
+        in_y += gt->height;
+      break;
+
+    default:
+      break;
+  }
+
+  trunc_x = (gint) in_x;
+  trunc_y = (gint) in_y;
+  /* only set the values if the values are valid */
+  if (trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
+      trunc_y < gt->height)
+    return trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+
+  return -1;
+}
 
-/* must be called with the object lock */
 static gboolean
-gst_geometric_transform_generate_map (GstGeometricTransform * gt)
+gst_geometric_transform_generate_stripe (GstGeometricTransform * gt,
+    gint y0, gint height)
 {
-  gint x, y;
+  GstGeometricTransformClass *klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
+  gint32 *ptr = gt->map + y0 * gt->width;
   gdouble in_x, in_y;
+  gint x, y;
+
+  for (y = y0; y < y0 + height; y++) {
+    for (x = 0; x < gt->width; x++) {
+      if (!klass->map_func (gt, x, y, &in_x, &in_y)) {
+        /* child should have warned */
+        return FALSE;
+      }
+
+      *ptr++ = gst_geometric_transform_get_in_offset (gt, in_x, in_y);
+    }
+  }
+
+  return TRUE;
+}
+
+/* Copies the input pixels for each output pixel of the stripe, off edge
+ * pixels are set to black. The pixel stride is constant inside the loops
+ * so that the copies compile to plain loads and stores. */
+#define REMAP_STRIPE(pstride) G_STMT_START { \
+  for (y = y0; y < y0 + height; y++) { \
+    guint8 *out = out_data + y * gt->row_stride; \
+    for (x = 0; x < gt->width; x++) { \
+      gint32 offset = *ptr++; \
+      memcpy (out, offset >= 0 ? in_data + offset : black, pstride); \
+      out += pstride; \
+    } \
+  } \
+} G_STMT_END
+
+static void
+gst_geometric_transform_remap_stripe (GstGeometricTransform * gt,
+    const guint8 * in_data, guint8 * out_data, gint y0, gint height)
+{
+  const gint32 *ptr = gt->map + y0 * gt->width;
+  guint8 black[8] = { 0, };
+  gint x, y;
+
+  if (gt->format == GST_VIDEO_FORMAT_AYUV)
+    GST_WRITE_UINT32_BE (black, 0xff108080);
+
+  switch (gt->pixel_stride) {
+    case 1:
+      REMAP_STRIPE (1);
+      break;
+    case 2:
+      REMAP_STRIPE (2);
+      break;
+    case 3:
+      REMAP_STRIPE (3);
+      break;
+    case 4:
+      REMAP_STRIPE (4);
+      break;
+    default:
+      g_assert (gt->pixel_stride <= sizeof (black));
+      REMAP_STRIPE (gt->pixel_stride);
+      break;
+  }
+}
+
+#undef REMAP_STRIPE
+
+static void
+gst_geometric_transform_stripe_func (gpointer user_data, guint stripe,
+    gint first, gint last)
+{
+  GstGeometricTransformPass *pass = user_data;
+
+  if (pass->generate)
+    pass->ret[stripe] =
+        gst_geometric_transform_generate_stripe (pass->gt, first,
+        last - first);
+  else
+    gst_geometric_transform_remap_stripe (pass->gt, pass->in_data,
+        pass->out_data, first, last - first);
+}
+
+/* must be called with the object lock. Runs generate or remap over the
+ * whole frame in horizontal stripes, one per thread. Returns FALSE if
+ * generating any stripe failed. */
+static gboolean
+gst_geometric_transform_run_stripes (GstGeometricTransform * gt,
+    gboolean generate, const guint8 * in_data, guint8 * out_data)
+{
+  GstGeometricTransformPass pass;
+  guint i, n_stripes;
   gboolean ret = TRUE;
+
+  n_stripes = gst_stripe_threads_get_n_stripes (&gt->threads, gt->height, 1);
+
+  pass.gt = gt;
+  pass.generate = generate;
+  pass.in_data = in_data;
+  pass.out_data = out_data;
+  pass.ret = g_newa (gboolean, n_stripes);
+  for (i = 0; i < n_stripes; i++)
+    pass.ret[i] = TRUE;
+
+  gst_stripe_threads_run_stripes (&gt->threads, n_stripes, gt->height,
+      gst_geometric_transform_stripe_func, &pass);
+
+  for (i = 0; i < n_stripes; i++)
+    ret &= pass.ret[i];
+
+  return ret;
+}
+
+/* must be called with the object lock */
+static gboolean
+gst_geometric_transform_generate_map (GstGeometricTransform * gt)
+{
+  gboolean ret;
   GstGeometricTransformClass *klass;
-  gdouble *ptr;
 
   GST_INFO_OBJECT (gt, "Generating new transform map");
 
@@ -98,26 +261,13 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   g_return_val_if_fail (klass->map_func, FALSE);
 
   /*
-   * (x,y) pairs of the inverse mapping
+   * Offset of the input pixel for each output pixel, with the off edge
+   * pixels method already applied, or -1 for black
    */
-  gt->map = g_malloc0 (sizeof (gdouble) * gt->width * gt->height * 2);
-  ptr = gt->map;
-
-  for (y = 0; y < gt->height; y++) {
-    for (x = 0; x < gt->width; x++) {
-      if (!klass->map_func (gt, x, y, &in_x, &in_y)) {
-        /* child should have warned */
-        ret = FALSE;
-        goto end;
-      }
+  gt->map = g_malloc (sizeof (gint32) * gt->width * gt->height);
 
-      ptr[0] = in_x;
-      ptr[1] = in_y;
-      ptr += 2;
-    }
-  }
+  ret = gst_geometric_transform_run_stripes (gt, TRUE, NULL, NULL);
 
-end:
   if (!ret) {
     GST_WARNING_OBJECT (gt, "Generating transform map failed");
     g_free (gt->map);
@@ -135,6 +285,8 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   gboolean ret = TRUE;
   gint old_width;
   gint old_height;
+  gint old_row_stride;
+  gint old_pixel_stride;
   GstGeometricTransformClass *klass;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
@@ -142,16 +294,21 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
 
   old_width = gt->width;
   old_height = gt->height;
+  old_row_stride = gt->row_stride;
+  old_pixel_stride = gt->pixel_stride;
 
   gt->width = in_info->width;
   gt->height = in_info->height;
   gt->row_stride = in_info->stride[0];
   gt->pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE (in_info, 0);
+  gt->format = GST_VIDEO_INFO_FORMAT (in_info);
 
   /* regenerate the map */
   GST_OBJECT_LOCK (gt);
   if (gt->map == NULL || old_width == 0 || old_height == 0
-      || gt->width != old_width || gt->height != old_height) {
+      || gt->width != old_width || gt->height != old_height
+      || gt->row_stride != old_row_stride
+      || gt->pixel_stride != old_pixel_stride) {
     if (klass->prepare_func)
       if (!klass->prepare_func (gt)) {
         GST_OBJECT_UNLOCK (gt);
@@ -168,42 +325,14 @@ static void
 gst_geometric_transform_do_map (GstGeometricTransform * gt, guint8 * in_data,
     guint8 * out_data, gint x, gint y, gdouble in_x, gdouble in_y)
 {
-  gint in_offset;
+  gint32 in_offset;
   gint out_offset;
 
   out_offset = y * gt->row_stride + x * gt->pixel_stride;
 
-  /* operate on out of edge pixels */
-  switch (gt->off_edge_pixels) {
-    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
-      in_x = CLAMP (in_x, 0, gt->width - 1);
-      in_y = CLAMP (in_y, 0, gt->height - 1);
-      break;
-
-    case GST_GT_OFF_EDGES_PIXELS_WRAP:
-      in_x = gst_gm_mod_float (in_x, gt->width);
-      in_y = gst_gm_mod_float (in_y, gt->height);
-      if (in_x < 0)
-        in_x += gt->width;
-      if (in_y < 0)
-        in_y += gt->height;
-      break;
-
-    default:
-      break;
-  }
-
-  {
-    gint trunc_x = (gint) in_x;
-    gint trunc_y = (gint) in_y;
-    /* only set the values if the values are valid */
-    if (trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
-        trunc_y < gt->height) {
-      in_offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
-
-      memcpy (out_data + out_offset, in_data + in_offset, gt->pixel_stride);
-    }
-  }
+  in_offset = gst_geometric_transform_get_in_offset (gt, in_x, in_y);
+  if (in_offset >= 0)
+    memcpy (out_data + out_offset, in_data + in_offset, gt->pixel_stride);
 }
 
 static void
@@ -231,7 +360,6 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
   GstGeometricTransformClass *klass;
   gint x, y, i;
   GstFlowReturn ret = GST_FLOW_OK;
-  gdouble *ptr;
   guint8 *in_data;
   guint8 *out_data;
 
@@ -241,16 +369,6 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
   in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
   out_data = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
 
-  if (GST_VIDEO_FRAME_FORMAT (out_frame) == GST_VIDEO_FORMAT_AYUV) {
-    /* in AYUV black is not just all zeros:
-     * 0x10 is black for Y,
-     * 0x80 is black for Cr and Cb */
-    for (i = 0; i < out_frame->map[0].size; i += 4)
-      GST_WRITE_UINT32_BE (out_data + i, 0xff108080);
-  } else {
-    memset (out_data, 0, out_frame->map[0].size);
-  }
-
   GST_OBJECT_LOCK (gt);
   if (gt->precalc_map) {
     if (gt->needs_remap) {
@@ -261,17 +379,23 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
         }
       gst_geometric_transform_generate_map (gt);
     }
-    g_return_val_if_fail (gt->map, GST_FLOW_ERROR);
-    ptr = gt->map;
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        /* do the mapping */
-        gst_geometric_transform_do_map (gt, in_data, out_data, x, y, ptr[0],
-            ptr[1]);
-        ptr += 2;
-      }
+    if (!gt->map) {
+      ret = GST_FLOW_ERROR;
+      goto end;
     }
+    /* writes every output pixel, black ones included */
+    gst_geometric_transform_run_stripes (gt, FALSE, in_data, out_data);
   } else {
+    if (GST_VIDEO_FRAME_FORMAT (out_frame) == GST_VIDEO_FORMAT_AYUV) {
+      /* in AYUV black is not just all zeros:
+       * 0x10 is black for Y,
+       * 0x80 is black for Cr and Cb */
+      for (i = 0; i < out_frame->map[0].size; i += 4)
+        GST_WRITE_UINT32_BE (out_data + i, 0xff108080);
+    } else {
+      memset (out_data, 0, out_frame->map[0].size);
+    }
+
     for (y = 0; y < gt->height; y++) {
       for (x = 0; x < gt->width; x++) {
         gdouble in_x, in_y;
@@ -301,9 +425,21 @@ gst_geometric_transform_set_property (GObject * object, guint prop_id,
   gt = GST_GEOMETRIC_TRANSFORM_CAST (object);
 
   switch (prop_id) {
-    case PROP_OFF_EDGE_PIXELS:
+    case PROP_OFF_EDGE_PIXELS:{
+      gint off_edge_pixels = g_value_get_enum (value);
+
+      GST_OBJECT_LOCK (gt);
+      /* the map has the method applied already */
+      if (off_edge_pixels != gt->off_edge_pixels) {
+        gt->off_edge_pixels = off_edge_pixels;
+        gst_geometric_transform_set_need_remap (gt);
+      }
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    }
+    case PROP_N_THREADS:
       GST_OBJECT_LOCK (gt);
-      gt->off_edge_pixels = g_value_get_enum (value);
+      gt->threads.n_threads = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (gt);
       break;
     default:
@@ -324,12 +460,26 @@ gst_geometric_transform_get_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       g_value_set_enum (value, gt->off_edge_pixels);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (gt);
+      g_value_set_uint (value, gt->threads.n_threads);
+      GST_OBJECT_UNLOCK (gt);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static void
+gst_geometric_transform_finalize (GObject * object)
+{
+  GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (object);
+
+  gst_stripe_threads_clear (&gt->threads);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
 
 static gboolean
 gst_geometric_transform_stop (GstBaseTransform * trans)
@@ -373,6 +523,7 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
 
   obj_class->set_property = gst_geometric_transform_set_property;
   obj_class->get_property = gst_geometric_transform_get_property;
+  obj_class->finalize = gst_geometric_transform_finalize;
 
   trans_class->stop = GST_DEBUG_FUNCPTR (gst_geometric_transform_stop);
   trans_class->before_transform =
@@ -388,6 +539,13 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
           "What to do with off edge pixels",
           GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE, DEFAULT_OFF_EDGE_PIXELS,
           GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (obj_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads generating the map and transforming frames, "
+          "each one handles an horizontal stripe (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -398,6 +556,7 @@ gst_geometric_transform_init (GTypeInstance * instance, gpointer g_class)
   gt->off_edge_pixels = DEFAULT_OFF_EDGE_PIXELS;
   gt->precalc_map = TRUE;
   gt->needs_remap = TRUE;
+  gst_stripe_threads_init (&gt->threads, DEFAULT_N_THREADS);
 }
 
 GType
@@ -22,6 +22,7 @@
 
 #include <gst/video/gstvideofilter.h>
 #include <gst/video/video.h>
+#include <gst/stripe-threads-private.h>
 
 G_BEGIN_DECLS
 
@@ -100,7 +101,11 @@ struct _GstGeometricTransform {
   /* properties */
   gint off_edge_pixels;
 
-  gdouble *map;
+  /* input pixel offset for each output pixel, -1 for black */
+  gint32 *map;
+
+  /* the n-threads property is threads.n_threads */
+  GstStripeThreads threads;
 };
 
 struct _GstGeometricTransformClass {
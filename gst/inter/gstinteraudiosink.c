@@ -73,7 +73,8 @@ static gboolean gst_inter_audio_sink_query (GstBaseSink * sink,
 enum
 {
   PROP_0,
-  PROP_CHANNEL
+  PROP_CHANNEL,
+  PROP_OVERRUNS
 };
 
 #define DEFAULT_CHANNEL ("default")
@@ -124,13 +125,25 @@ gst_inter_audio_sink_class_init (GstInterAudioSinkClass * klass)
       g_param_spec_string ("channel", "Channel",
           "Channel name to match inter src and sink elements",
           DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterAudioSink:overruns:
+   *
+   * Number of times samples were dropped because the audio ring was full,
+   * i.e. the interaudiosrc of the channel did not keep up or is not running.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_OVERRUNS,
+      g_param_spec_uint64 ("overruns", "Overruns",
+          "Number of times samples were dropped because the ring was full",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_inter_audio_sink_init (GstInterAudioSink * interaudiosink)
 {
   interaudiosink->channel = g_strdup (DEFAULT_CHANNEL);
-  interaudiosink->input_adapter = gst_adapter_new ();
 }
 
 void
@@ -160,6 +173,9 @@ gst_inter_audio_sink_get_property (GObject * object, guint property_id,
     case PROP_CHANNEL:
       g_value_set_string (value, interaudiosink->channel);
       break;
+    case PROP_OVERRUNS:
+      g_value_set_uint64 (value, interaudiosink->overruns);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -173,7 +189,6 @@ gst_inter_audio_sink_finalize (GObject * object)
 
   /* clean up object here */
   g_free (interaudiosink->channel);
-  gst_object_unref (interaudiosink->input_adapter);
 
   G_OBJECT_CLASS (gst_inter_audio_sink_parent_class)->finalize (object);
 }
@@ -208,6 +223,11 @@ gst_inter_audio_sink_start (GstBaseSink * sink)
   interaudiosink->surface = gst_inter_surface_get (interaudiosink->channel);
   g_mutex_lock (&interaudiosink->surface->mutex);
   memset (&interaudiosink->surface->audio_info, 0, sizeof (GstAudioInfo));
+  gst_inter_surface_reset_audio_ring (interaudiosink->surface);
+  interaudiosink->ring = NULL;
+  interaudiosink->ring_cookie = interaudiosink->surface->audio_ring_cookie;
+  interaudiosink->write_pos = 0;
+  interaudiosink->overruns = 0;
 
   /* We want to write latency-time before syncing has happened */
   /* FIXME: The other side can change this value when it starts */
@@ -226,14 +246,16 @@ gst_inter_audio_sink_stop (GstBaseSink * sink)
   GST_DEBUG_OBJECT (interaudiosink, "stop");
 
   g_mutex_lock (&interaudiosink->surface->mutex);
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
   memset (&interaudiosink->surface->audio_info, 0, sizeof (GstAudioInfo));
+  gst_inter_surface_reset_audio_ring (interaudiosink->surface);
   g_mutex_unlock (&interaudiosink->surface->mutex);
 
   gst_inter_surface_unref (interaudiosink->surface);
   interaudiosink->surface = NULL;
 
-  gst_adapter_clear (interaudiosink->input_adapter);
+  if (interaudiosink->ring)
+    gst_inter_audio_ring_unref (interaudiosink->ring);
+  interaudiosink->ring = NULL;
 
   return TRUE;
 }
@@ -253,7 +275,7 @@ gst_inter_audio_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   interaudiosink->surface->audio_info = info;
   interaudiosink->info = info;
   /* TODO: Ideally we would drain the source here */
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
+  gst_inter_surface_reset_audio_ring (interaudiosink->surface);
   g_mutex_unlock (&interaudiosink->surface->mutex);
 
   return TRUE;
@@ -265,18 +287,14 @@ gst_inter_audio_sink_event (GstBaseSink * sink, GstEvent * event)
   GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (sink);
 
   switch (GST_EVENT_TYPE (event)) {
-    case GST_EVENT_EOS:{
-      GstBuffer *tmp;
-      guint n;
-
-      if ((n = gst_adapter_available (interaudiosink->input_adapter)) > 0) {
-        g_mutex_lock (&interaudiosink->surface->mutex);
-        tmp = gst_adapter_take_buffer (interaudiosink->input_adapter, n);
-        gst_adapter_push (interaudiosink->surface->audio_adapter, tmp);
-        g_mutex_unlock (&interaudiosink->surface->mutex);
-      }
+    case GST_EVENT_EOS:
+      /* publish the last incomplete period */
+      if (interaudiosink->ring
+          && interaudiosink->ring_cookie ==
+          g_atomic_int_get (&interaudiosink->surface->audio_ring_cookie))
+        g_atomic_int_set (&interaudiosink->ring->write_pos,
+            interaudiosink->write_pos);
       break;
-    }
     default:
       break;
   }
@@ -284,62 +302,74 @@ gst_inter_audio_sink_event (GstBaseSink * sink, GstEvent * event)
   return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
 }
 
+/* Picks up a new ring from the surface if it was replaced since the last
+ * call, the mutex is only taken in that case */
+static GstInterAudioRing *
+gst_inter_audio_sink_update_ring (GstInterAudioSink * interaudiosink)
+{
+  GstInterSurface *surface = interaudiosink->surface;
+
+  if (g_atomic_int_get (&surface->audio_ring_cookie) !=
+      interaudiosink->ring_cookie) {
+    if (interaudiosink->ring)
+      gst_inter_audio_ring_unref (interaudiosink->ring);
+    interaudiosink->ring = gst_inter_surface_get_audio_ring (surface, NULL,
+        &interaudiosink->ring_cookie);
+    interaudiosink->write_pos = interaudiosink->ring ?
+        (guint) g_atomic_int_get (&interaudiosink->ring->write_pos) : 0;
+    GST_DEBUG_OBJECT (interaudiosink, "using new ring of %u samples",
+        interaudiosink->ring ? interaudiosink->ring->size : 0);
+  }
+
+  return interaudiosink->ring;
+}
+
 static GstFlowReturn
 gst_inter_audio_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (sink);
-  guint n, bpf;
-  guint64 period_time, buffer_time;
-  guint64 period_samples, buffer_samples;
+  GstInterAudioRing *ring;
+  GstMapInfo map;
+  guint n, bpf, space, offset, first;
 
   GST_DEBUG_OBJECT (interaudiosink, "render %" G_GSIZE_FORMAT,
       gst_buffer_get_size (buffer));
-  bpf = interaudiosink->info.bpf;
-
-  g_mutex_lock (&interaudiosink->surface->mutex);
 
-  buffer_time = interaudiosink->surface->audio_buffer_time;
-  period_time = interaudiosink->surface->audio_period_time;
+  ring = gst_inter_audio_sink_update_ring (interaudiosink);
+  if (!ring) {
+    GST_ERROR_OBJECT (interaudiosink, "No audio format on the surface");
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+  bpf = ring->bpf;
 
-  if (buffer_time < period_time) {
-    GST_ERROR_OBJECT (interaudiosink,
-        "Buffer time smaller than period time (%" GST_TIME_FORMAT " < %"
-        GST_TIME_FORMAT ")", GST_TIME_ARGS (buffer_time),
-        GST_TIME_ARGS (period_time));
-    g_mutex_unlock (&interaudiosink->surface->mutex);
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+    GST_ERROR_OBJECT (interaudiosink, "Failed to map buffer");
     return GST_FLOW_ERROR;
   }
 
-  buffer_samples =
-      gst_util_uint64_scale (buffer_time, interaudiosink->info.rate,
-      GST_SECOND);
-  period_samples =
-      gst_util_uint64_scale (period_time, interaudiosink->info.rate,
-      GST_SECOND);
-
-  n = gst_adapter_available (interaudiosink->surface->audio_adapter) / bpf;
-  while (n > buffer_samples) {
-    GST_DEBUG_OBJECT (interaudiosink, "flushing %" GST_TIME_FORMAT,
-        GST_TIME_ARGS (period_time));
-    gst_adapter_flush (interaudiosink->surface->audio_adapter,
-        period_samples * bpf);
-    n -= period_samples;
+  n = map.size / bpf;
+  space = ring->size - (interaudiosink->write_pos -
+      (guint) g_atomic_int_get (&ring->read_pos));
+  if (n > space) {
+    GST_DEBUG_OBJECT (interaudiosink, "ring full, dropping %u samples",
+        n - space);
+    interaudiosink->overruns++;
+    n = space;
   }
 
-  n = gst_adapter_available (interaudiosink->input_adapter);
-  if (period_samples * bpf > gst_buffer_get_size (buffer) + n) {
-    gst_adapter_push (interaudiosink->input_adapter, gst_buffer_ref (buffer));
-  } else {
-    GstBuffer *tmp;
-
-    if (n > 0) {
-      tmp = gst_adapter_take_buffer (interaudiosink->input_adapter, n);
-      gst_adapter_push (interaudiosink->surface->audio_adapter, tmp);
-    }
-    gst_adapter_push (interaudiosink->surface->audio_adapter,
-        gst_buffer_ref (buffer));
-  }
-  g_mutex_unlock (&interaudiosink->surface->mutex);
+  offset = interaudiosink->write_pos % ring->size;
+  first = MIN (n, ring->size - offset);
+  memcpy (ring->data + (gsize) offset * bpf, map.data, (gsize) first * bpf);
+  memcpy (ring->data, map.data + (gsize) first * bpf,
+      (gsize) (n - first) * bpf);
+  gst_buffer_unmap (buffer, &map);
+  interaudiosink->write_pos += n;
+
+  /* The source fills up with silence what it can't read, only hand over
+   * complete periods */
+  if (interaudiosink->write_pos - (guint) g_atomic_int_get (&ring->write_pos)
+      >= ring->period)
+    g_atomic_int_set (&ring->write_pos, interaudiosink->write_pos);
 
   return GST_FLOW_OK;
 }
@@ -41,8 +41,15 @@ struct _GstInterAudioSink
   GstInterSurface *surface;
   char *channel;
 
-  GstAdapter *input_adapter;
   GstAudioInfo info;
+
+  /* our reference to the surface audio ring and the cookie it belongs to */
+  GstInterAudioRing *ring;
+  gint ring_cookie;
+  /* frames written up to here, published to the source once a period
+   * is complete */
+  guint write_pos;
+  guint64 overruns;
 };
 
 struct _GstInterAudioSinkClass
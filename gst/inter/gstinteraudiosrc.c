@@ -62,6 +62,7 @@ static GstCaps *gst_inter_audio_src_get_caps (GstBaseSrc * src,
 static gboolean gst_inter_audio_src_set_caps (GstBaseSrc * src, GstCaps * caps);
 static gboolean gst_inter_audio_src_start (GstBaseSrc * src);
 static gboolean gst_inter_audio_src_stop (GstBaseSrc * src);
+static void gst_inter_audio_src_drop_chunks (GstInterAudioSrc * interaudiosrc);
 static void
 gst_inter_audio_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
     GstClockTime * start, GstClockTime * end);
@@ -77,7 +78,8 @@ enum
   PROP_CHANNEL,
   PROP_BUFFER_TIME,
   PROP_LATENCY_TIME,
-  PROP_PERIOD_TIME
+  PROP_PERIOD_TIME,
+  PROP_UNDERRUNS
 };
 
 #define DEFAULT_CHANNEL ("default")
@@ -148,6 +150,20 @@ gst_inter_audio_src_class_init (GstInterAudioSrcClass * klass)
           "The minimum amount of data to read in each iteration",
           1, G_MAXUINT64, DEFAULT_AUDIO_PERIOD_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterAudioSrc:underruns:
+   *
+   * Number of times the source ran out of samples and had to fill up with
+   * silence after it had received data from the interaudiosink of the
+   * channel.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_UNDERRUNS,
+      g_param_spec_uint64 ("underruns", "Underruns",
+          "Number of times the source ran out of samples",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -161,6 +177,7 @@ gst_inter_audio_src_init (GstInterAudioSrc * interaudiosrc)
   interaudiosrc->buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   interaudiosrc->latency_time = DEFAULT_AUDIO_LATENCY_TIME;
   interaudiosrc->period_time = DEFAULT_AUDIO_PERIOD_TIME;
+  g_queue_init (&interaudiosrc->chunks);
 }
 
 void
@@ -208,6 +225,9 @@ gst_inter_audio_src_get_property (GObject * object, guint property_id,
     case PROP_PERIOD_TIME:
       g_value_set_uint64 (value, interaudiosrc->period_time);
       break;
+    case PROP_UNDERRUNS:
+      g_value_set_uint64 (value, interaudiosrc->underruns);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -287,8 +307,17 @@ gst_inter_audio_src_start (GstBaseSrc * src)
   interaudiosrc->surface->audio_buffer_time = interaudiosrc->buffer_time;
   interaudiosrc->surface->audio_latency_time = interaudiosrc->latency_time;
   interaudiosrc->surface->audio_period_time = interaudiosrc->period_time;
+  /* resize the ring if the sink already set a format */
+  gst_inter_surface_reset_audio_ring (interaudiosrc->surface);
   g_mutex_unlock (&interaudiosrc->surface->mutex);
 
+  interaudiosrc->ring =
+      gst_inter_surface_get_audio_ring (interaudiosrc->surface,
+      &interaudiosrc->ring_info, &interaudiosrc->ring_cookie);
+  interaudiosrc->read_pos = 0;
+  interaudiosrc->starved = TRUE;
+  interaudiosrc->underruns = 0;
+
   return TRUE;
 }
 
@@ -299,6 +328,11 @@ gst_inter_audio_src_stop (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (interaudiosrc, "stop");
 
+  gst_inter_audio_src_drop_chunks (interaudiosrc);
+  if (interaudiosrc->ring)
+    gst_inter_audio_ring_unref (interaudiosrc->ring);
+  interaudiosrc->ring = NULL;
+
   gst_inter_surface_unref (interaudiosrc->surface);
   interaudiosrc->surface = NULL;
 
@@ -330,27 +364,149 @@ gst_inter_audio_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
   }
 }
 
+typedef struct
+{
+  gint ref_count;
+  GstInterAudioRing *ring;
+  /* ring position right after the chunk */
+  guint end;
+} GstInterAudioSrcChunk;
+
+static GstInterAudioSrcChunk *
+gst_inter_audio_src_chunk_ref (GstInterAudioSrcChunk * chunk)
+{
+  g_atomic_int_inc (&chunk->ref_count);
+
+  return chunk;
+}
+
+static void
+gst_inter_audio_src_chunk_unref (GstInterAudioSrcChunk * chunk)
+{
+  if (g_atomic_int_dec_and_test (&chunk->ref_count)) {
+    gst_inter_audio_ring_unref (chunk->ring);
+    g_slice_free (GstInterAudioSrcChunk, chunk);
+  }
+}
+
+/* Gives the chunks downstream is done with back to the sink. The queue holds
+ * one reference to each chunk and every memory wrapping it one more. */
+static void
+gst_inter_audio_src_release_chunks (GstInterAudioSrc * interaudiosrc)
+{
+  GstInterAudioSrcChunk *chunk;
+
+  while ((chunk = g_queue_peek_head (&interaudiosrc->chunks))
+      && g_atomic_int_get (&chunk->ref_count) == 1) {
+    g_atomic_int_set (&interaudiosrc->ring->read_pos, chunk->end);
+    g_queue_pop_head (&interaudiosrc->chunks);
+    gst_inter_audio_src_chunk_unref (chunk);
+  }
+}
+
+static void
+gst_inter_audio_src_drop_chunks (GstInterAudioSrc * interaudiosrc)
+{
+  GstInterAudioSrcChunk *chunk;
+
+  while ((chunk = g_queue_pop_head (&interaudiosrc->chunks)))
+    gst_inter_audio_src_chunk_unref (chunk);
+}
+
+/* Picks up a new ring from the surface if it was replaced since the last
+ * call, the mutex is only taken in that case */
+static void
+gst_inter_audio_src_update_ring (GstInterAudioSrc * interaudiosrc)
+{
+  GstInterSurface *surface = interaudiosrc->surface;
+
+  if (g_atomic_int_get (&surface->audio_ring_cookie) ==
+      interaudiosrc->ring_cookie)
+    return;
+
+  gst_inter_audio_src_drop_chunks (interaudiosrc);
+  if (interaudiosrc->ring)
+    gst_inter_audio_ring_unref (interaudiosrc->ring);
+  interaudiosrc->ring = gst_inter_surface_get_audio_ring (surface,
+      &interaudiosrc->ring_info, &interaudiosrc->ring_cookie);
+  interaudiosrc->read_pos = interaudiosrc->ring ?
+      (guint) g_atomic_int_get (&interaudiosrc->ring->read_pos) : 0;
+  interaudiosrc->starved = TRUE;
+
+  GST_DEBUG_OBJECT (interaudiosrc, "using new ring of %u samples",
+      interaudiosrc->ring ? interaudiosrc->ring->size : 0);
+}
+
+static void
+gst_inter_audio_src_append_chunk (GstInterAudioSrc * interaudiosrc,
+    GstBuffer * buffer, GstInterAudioSrcChunk * chunk, guint offset, guint n)
+{
+  GstInterAudioRing *ring = interaudiosrc->ring;
+
+  gst_buffer_append_memory (buffer,
+      gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, ring->data,
+          (gsize) ring->size * ring->bpf, (gsize) offset * ring->bpf,
+          (gsize) n * ring->bpf, gst_inter_audio_src_chunk_ref (chunk),
+          (GDestroyNotify) gst_inter_audio_src_chunk_unref));
+}
+
+/* Returns a buffer with up to n samples from the ring, wrapping the ring
+ * memory instead of copying it */
+static GstBuffer *
+gst_inter_audio_src_read_ring (GstInterAudioSrc * interaudiosrc, guint * n)
+{
+  GstInterAudioRing *ring = interaudiosrc->ring;
+  GstInterAudioSrcChunk *chunk;
+  GstBuffer *buffer;
+  guint avail, offset, first;
+
+  gst_inter_audio_src_release_chunks (interaudiosrc);
+
+  avail = (guint) g_atomic_int_get (&ring->write_pos) -
+      interaudiosrc->read_pos;
+  *n = MIN (*n, avail);
+  if (*n == 0)
+    return NULL;
+
+  chunk = g_slice_new (GstInterAudioSrcChunk);
+  chunk->ref_count = 1;
+  chunk->ring = gst_inter_audio_ring_ref (ring);
+  chunk->end = interaudiosrc->read_pos + *n;
+
+  buffer = gst_buffer_new ();
+  offset = interaudiosrc->read_pos % ring->size;
+  first = MIN (*n, ring->size - offset);
+  gst_inter_audio_src_append_chunk (interaudiosrc, buffer, chunk, offset,
+      first);
+  if (first < *n)
+    gst_inter_audio_src_append_chunk (interaudiosrc, buffer, chunk, 0,
+        *n - first);
+
+  g_queue_push_tail (&interaudiosrc->chunks, chunk);
+  interaudiosrc->read_pos += *n;
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
     GstBuffer ** buf)
 {
   GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (src);
   GstCaps *caps;
-  GstBuffer *buffer;
+  GstBuffer *buffer = NULL;
   guint n, bpf;
-  guint64 period_time;
   guint64 period_samples;
 
   GST_DEBUG_OBJECT (interaudiosrc, "create");
 
-  buffer = NULL;
   caps = NULL;
 
-  g_mutex_lock (&interaudiosrc->surface->mutex);
-  if (interaudiosrc->surface->audio_info.finfo) {
-    if (!gst_audio_info_is_equal (&interaudiosrc->surface->audio_info,
+  gst_inter_audio_src_update_ring (interaudiosrc);
+  if (interaudiosrc->ring_info.finfo) {
+    if (!gst_audio_info_is_equal (&interaudiosrc->ring_info,
             &interaudiosrc->info)) {
-      caps = gst_audio_info_to_caps (&interaudiosrc->surface->audio_info);
+      caps = gst_audio_info_to_caps (&interaudiosrc->ring_info);
       interaudiosrc->timestamp_offset +=
           gst_util_uint64_scale (interaudiosrc->n_samples, GST_SECOND,
           interaudiosrc->info.rate);
@@ -358,39 +514,40 @@ gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  bpf = interaudiosrc->surface->audio_info.bpf;
-  period_time = interaudiosrc->surface->audio_period_time;
-  period_samples =
-      gst_util_uint64_scale (period_time, interaudiosrc->info.rate, GST_SECOND);
-
-  if (bpf > 0)
-    n = gst_adapter_available (interaudiosrc->surface->audio_adapter) / bpf;
-  else
-    n = 0;
-
-  if (n > period_samples)
-    n = period_samples;
-  if (n > 0) {
-    buffer = gst_adapter_take_buffer (interaudiosrc->surface->audio_adapter,
-        n * bpf);
-  } else {
-    buffer = gst_buffer_new ();
-    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
-  }
-  g_mutex_unlock (&interaudiosrc->surface->mutex);
-
   if (caps) {
     gboolean ret = gst_base_src_set_caps (src, caps);
     gst_caps_unref (caps);
     if (!ret) {
       GST_ERROR_OBJECT (src, "Failed to set caps %" GST_PTR_FORMAT, caps);
-      if (buffer)
-        gst_buffer_unref (buffer);
       return GST_FLOW_NOT_NEGOTIATED;
     }
   }
 
-  buffer = gst_buffer_make_writable (buffer);
+  period_samples = gst_util_uint64_scale (interaudiosrc->period_time,
+      interaudiosrc->info.rate, GST_SECOND);
+
+  n = period_samples;
+  if (interaudiosrc->ring
+      && interaudiosrc->ring->bpf == interaudiosrc->info.bpf)
+    buffer = gst_inter_audio_src_read_ring (interaudiosrc, &n);
+  else
+    n = 0;
+
+  if (n < period_samples) {
+    if (!interaudiosrc->starved) {
+      GST_DEBUG_OBJECT (interaudiosrc, "underrun, %" G_GUINT64_FORMAT
+          " samples missing", period_samples - n);
+      interaudiosrc->underruns++;
+    }
+    interaudiosrc->starved = TRUE;
+  } else {
+    interaudiosrc->starved = FALSE;
+  }
+
+  if (!buffer) {
+    buffer = gst_buffer_new ();
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
+  }
 
   bpf = interaudiosrc->info.bpf;
   if (n < period_samples) {
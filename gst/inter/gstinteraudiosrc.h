@@ -46,6 +46,18 @@ struct _GstInterAudioSrc
   GstClockTime timestamp_offset;
   GstAudioInfo info;
   guint64 buffer_time, latency_time, period_time;
+
+  /* our reference to the surface audio ring, the cookie and the format it
+   * belongs to */
+  GstInterAudioRing *ring;
+  gint ring_cookie;
+  GstAudioInfo ring_info;
+  /* frames read up to here */
+  guint read_pos;
+  /* chunks of the ring still used by buffers downstream, oldest first */
+  GQueue chunks;
+  gboolean starved;
+  guint64 underruns;
 };
 
 struct _GstInterAudioSrcClass
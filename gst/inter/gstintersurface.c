@@ -48,10 +48,10 @@ gst_inter_surface_get (const char *name)
   surface->ref_count = 1;
   surface->name = g_strdup (name);
   g_mutex_init (&surface->mutex);
-  surface->audio_adapter = gst_adapter_new ();
   surface->audio_buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   surface->audio_latency_time = DEFAULT_AUDIO_LATENCY_TIME;
   surface->audio_period_time = DEFAULT_AUDIO_PERIOD_TIME;
+  gst_inter_surface_set_video_ring_size (surface, DEFAULT_VIDEO_RING_SIZE);
 
   list = g_list_append (list, surface);
   g_mutex_unlock (&mutex);
@@ -79,10 +79,141 @@ gst_inter_surface_unref (GstInterSurface * surface)
 
     g_mutex_clear (&surface->mutex);
     gst_buffer_replace (&surface->video_buffer, NULL);
+    gst_inter_surface_clear_video_ring (surface);
+    g_free (surface->video_ring);
     gst_buffer_replace (&surface->sub_buffer, NULL);
-    gst_object_unref (surface->audio_adapter);
+    if (surface->audio_ring)
+      gst_inter_audio_ring_unref (surface->audio_ring);
     g_free (surface->name);
     g_free (surface);
   }
   g_mutex_unlock (&mutex);
 }
+
+void
+gst_inter_surface_clear_video_ring (GstInterSurface * surface)
+{
+  guint i;
+
+  for (i = 0; i < surface->video_ring_size; i++) {
+    gst_buffer_replace (&surface->video_ring[i].buffer, NULL);
+    surface->video_ring[i].time = GST_CLOCK_TIME_NONE;
+  }
+}
+
+void
+gst_inter_surface_set_video_ring_size (GstInterSurface * surface, guint size)
+{
+  g_return_if_fail (size > 0);
+
+  if (size == surface->video_ring_size)
+    return;
+
+  /* frames can't stay at the same place, just drop them. The write
+   * position is kept so that the consumers don't see old frames again. */
+  gst_inter_surface_clear_video_ring (surface);
+  g_free (surface->video_ring);
+  surface->video_ring = g_new0 (GstInterVideoFrame, size);
+  surface->video_ring_size = size;
+  gst_inter_surface_clear_video_ring (surface);
+}
+
+void
+gst_inter_surface_push_video_frame (GstInterSurface * surface,
+    GstBuffer * buffer, GstClockTime time)
+{
+  GstInterVideoFrame *frame;
+
+  frame = &surface->video_ring[surface->video_ring_written %
+      surface->video_ring_size];
+  gst_buffer_replace (&frame->buffer, buffer);
+  frame->time = time;
+  surface->video_ring_written++;
+}
+
+/* Returns frame n if it is still in the ring */
+const GstInterVideoFrame *
+gst_inter_surface_get_video_frame (GstInterSurface * surface, guint64 n)
+{
+  const GstInterVideoFrame *frame;
+
+  if (n >= surface->video_ring_written
+      || surface->video_ring_written - n > surface->video_ring_size)
+    return NULL;
+
+  frame = &surface->video_ring[n % surface->video_ring_size];
+
+  return frame->buffer ? frame : NULL;
+}
+
+/* Replaces the audio ring with an empty one for the current audio_info and
+ * audio_buffer_time, or with none if there is no format. The elements
+ * pick it up on their next iteration, data in the old ring is lost. */
+void
+gst_inter_surface_reset_audio_ring (GstInterSurface * surface)
+{
+  GstInterAudioRing *ring = NULL;
+
+  if (surface->audio_info.finfo && surface->audio_info.rate > 0
+      && surface->audio_info.bpf > 0) {
+    guint64 size, period;
+
+    size = gst_util_uint64_scale (surface->audio_buffer_time,
+        surface->audio_info.rate, GST_SECOND);
+    period = gst_util_uint64_scale (surface->audio_period_time,
+        surface->audio_info.rate, GST_SECOND);
+    period = MAX (period, 1);
+    /* room for at least one period being written while one is read */
+    size = MAX (size, 2 * period);
+    size = MIN (size, G_MAXINT / surface->audio_info.bpf);
+
+    ring = g_new0 (GstInterAudioRing, 1);
+    ring->ref_count = 1;
+    ring->bpf = surface->audio_info.bpf;
+    ring->size = size;
+    ring->period = MIN (period, size / 2);
+    ring->data = g_malloc ((gsize) ring->size * ring->bpf);
+  }
+
+  if (surface->audio_ring)
+    gst_inter_audio_ring_unref (surface->audio_ring);
+  surface->audio_ring = ring;
+  g_atomic_int_inc (&surface->audio_ring_cookie);
+}
+
+/* Returns a new reference to the current audio ring, or NULL, with the
+ * format and the cookie it belongs to. Takes the surface mutex, the elements
+ * only call this when audio_ring_cookie changed. */
+GstInterAudioRing *
+gst_inter_surface_get_audio_ring (GstInterSurface * surface,
+    GstAudioInfo * info, gint * cookie)
+{
+  GstInterAudioRing *ring = NULL;
+
+  g_mutex_lock (&surface->mutex);
+  if (surface->audio_ring)
+    ring = gst_inter_audio_ring_ref (surface->audio_ring);
+  if (info)
+    *info = surface->audio_info;
+  *cookie = g_atomic_int_get (&surface->audio_ring_cookie);
+  g_mutex_unlock (&surface->mutex);
+
+  return ring;
+}
+
+GstInterAudioRing *
+gst_inter_audio_ring_ref (GstInterAudioRing * ring)
+{
+  g_atomic_int_inc (&ring->ref_count);
+
+  return ring;
+}
+
+void
+gst_inter_audio_ring_unref (GstInterAudioRing * ring)
+{
+  if (g_atomic_int_dec_and_test (&ring->ref_count)) {
+    g_free (ring->data);
+    g_free (ring);
+  }
+}
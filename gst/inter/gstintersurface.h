@@ -20,13 +20,41 @@
 #ifndef _GST_INTER_SURFACE_H_
 #define _GST_INTER_SURFACE_H_
 
-#include <gst/base/gstadapter.h>
 #include <gst/audio/audio.h>
 #include <gst/video/video.h>
 
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterVideoFrame GstInterVideoFrame;
+typedef struct _GstInterAudioRing GstInterAudioRing;
+
+struct _GstInterVideoFrame
+{
+  GstBuffer *buffer;
+  /* clock time at which the sink rendered the frame, or
+   * GST_CLOCK_TIME_NONE */
+  GstClockTime time;
+};
+
+/* Single producer, single consumer ring of audio frames. The positions
+ * count frames and wrap around, write_pos is only written by the sink and
+ * read_pos only by the source. read_pos is the end of the data the source
+ * is done with, which can be behind what it already read while downstream
+ * still uses the ring memory. */
+struct _GstInterAudioRing
+{
+  gint ref_count;
+
+  guint8 *data;
+  guint bpf;
+  /* in frames */
+  guint size;
+  guint period;
+
+  guint write_pos;
+  guint read_pos;
+};
 
 struct _GstInterSurface
 {
@@ -44,20 +72,44 @@ struct _GstInterSurface
   guint64 audio_buffer_time;
   guint64 audio_latency_time;
   guint64 audio_period_time;
+  /* replaced with the surface mutex held, audio_ring_cookie is incremented
+   * every time so that the elements can notice without taking the mutex */
+  GstInterAudioRing *audio_ring;
+  gint audio_ring_cookie;
 
   GstBuffer *video_buffer;
+  /* the last video_ring_size frames, frame n is at n % video_ring_size.
+   * Consumers keep their own position in it. */
+  GstInterVideoFrame *video_ring;
+  guint video_ring_size;
+  guint64 video_ring_written;
   GstBuffer *sub_buffer;
-  GstAdapter *audio_adapter;
 };
 
 #define DEFAULT_AUDIO_BUFFER_TIME  (GST_SECOND)
 #define DEFAULT_AUDIO_LATENCY_TIME (100 * GST_MSECOND)
 #define DEFAULT_AUDIO_PERIOD_TIME  (25 * GST_MSECOND)
+#define DEFAULT_VIDEO_RING_SIZE    1
 
 
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+/* call with the surface mutex held */
+void gst_inter_surface_set_video_ring_size (GstInterSurface *surface,
+    guint size);
+void gst_inter_surface_push_video_frame (GstInterSurface *surface,
+    GstBuffer *buffer, GstClockTime time);
+void gst_inter_surface_clear_video_ring (GstInterSurface *surface);
+const GstInterVideoFrame * gst_inter_surface_get_video_frame (
+    GstInterSurface *surface, guint64 n);
+void gst_inter_surface_reset_audio_ring (GstInterSurface *surface);
+GstInterAudioRing * gst_inter_surface_get_audio_ring (GstInterSurface *surface,
+    GstAudioInfo *info, gint *cookie);
+
+GstInterAudioRing * gst_inter_audio_ring_ref (GstInterAudioRing *ring);
+void gst_inter_audio_ring_unref (GstInterAudioRing *ring);
+
 
 G_END_DECLS
 
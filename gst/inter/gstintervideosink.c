@@ -66,10 +66,12 @@ static GstFlowReturn gst_inter_video_sink_show_frame (GstVideoSink * sink,
 enum
 {
   PROP_0,
-  PROP_CHANNEL
+  PROP_CHANNEL,
+  PROP_RING_SIZE
 };
 
 #define DEFAULT_CHANNEL ("default")
+#define DEFAULT_RING_SIZE (DEFAULT_VIDEO_RING_SIZE)
 
 /* pad templates */
 static GstStaticPadTemplate gst_inter_video_sink_sink_template =
@@ -118,12 +120,27 @@ gst_inter_video_sink_class_init (GstInterVideoSinkClass * klass)
       g_param_spec_string ("channel", "Channel",
           "Channel name to match inter src and sink elements",
           DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterVideoSink:ring-size:
+   *
+   * Number of frames kept for the intervideosrc elements of the channel. Only
+   * the last one is used by sources in the default mode, see
+   * #GstInterVideoSrc:mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Number of frames kept for the sources", 1, 64, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_inter_video_sink_init (GstInterVideoSink * intervideosink)
 {
   intervideosink->channel = g_strdup (DEFAULT_CHANNEL);
+  intervideosink->ring_size = DEFAULT_RING_SIZE;
 }
 
 void
@@ -137,6 +154,9 @@ gst_inter_video_sink_set_property (GObject * object, guint property_id,
       g_free (intervideosink->channel);
       intervideosink->channel = g_value_dup_string (value);
       break;
+    case PROP_RING_SIZE:
+      intervideosink->ring_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -153,6 +173,9 @@ gst_inter_video_sink_get_property (GObject * object, guint property_id,
     case PROP_CHANNEL:
       g_value_set_string (value, intervideosink->channel);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, intervideosink->ring_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -199,6 +222,8 @@ gst_inter_video_sink_start (GstBaseSink * sink)
   intervideosink->surface = gst_inter_surface_get (intervideosink->channel);
   g_mutex_lock (&intervideosink->surface->mutex);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
+  gst_inter_surface_set_video_ring_size (intervideosink->surface,
+      intervideosink->ring_size);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   return TRUE;
@@ -214,6 +239,7 @@ gst_inter_video_sink_stop (GstBaseSink * sink)
     gst_buffer_unref (intervideosink->surface->video_buffer);
   }
   intervideosink->surface->video_buffer = NULL;
+  gst_inter_surface_clear_video_ring (intervideosink->surface);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
   g_mutex_unlock (&intervideosink->surface->mutex);
 
@@ -246,16 +272,26 @@ static GstFlowReturn
 gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
+  GstClockTime time;
 
   GST_DEBUG_OBJECT (intervideosink, "render ts %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
+  /* clock time of the frame, for the sources choosing the nearest frame */
+  GST_OBJECT_LOCK (sink);
+  time = gst_segment_to_running_time (&GST_BASE_SINK (sink)->segment,
+      GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+  if (GST_CLOCK_TIME_IS_VALID (time))
+    time += GST_ELEMENT_CAST (sink)->base_time;
+  GST_OBJECT_UNLOCK (sink);
+
   g_mutex_lock (&intervideosink->surface->mutex);
   if (intervideosink->surface->video_buffer) {
     gst_buffer_unref (intervideosink->surface->video_buffer);
   }
   intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
   intervideosink->surface->video_buffer_count = 0;
+  gst_inter_surface_push_video_frame (intervideosink->surface, buffer, time);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   return GST_FLOW_OK;
@@ -71,11 +71,37 @@ enum
 {
   PROP_0,
   PROP_CHANNEL,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_MODE
 };
 
 #define DEFAULT_CHANNEL ("default")
 #define DEFAULT_TIMEOUT (GST_SECOND)
+#define DEFAULT_MODE (GST_INTER_VIDEO_SRC_MODE_LATEST)
+
+GType
+gst_inter_video_src_mode_get_type (void)
+{
+  static volatile gsize mode_type = 0;
+  static const GEnumValue modes[] = {
+    {GST_INTER_VIDEO_SRC_MODE_LATEST,
+        "Output the latest frame of the sink", "latest"},
+    {GST_INTER_VIDEO_SRC_MODE_QUEUED,
+        "Output every frame of the sink in order, as far as the ring goes",
+        "queued"},
+    {GST_INTER_VIDEO_SRC_MODE_NEAREST,
+          "Output the frame rendered by the sink the nearest to the output "
+          "time", "nearest"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&mode_type)) {
+    GType tmp = g_enum_register_static ("GstInterVideoSrcMode", modes);
+    g_once_init_leave (&mode_type, tmp);
+  }
+
+  return (GType) mode_type;
+}
 
 /* pad templates */
 static GstStaticPadTemplate gst_inter_video_src_src_template =
@@ -130,6 +156,22 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
           "Timeout after which to start outputting black frames",
           0, G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterVideoSrc:mode:
+   *
+   * How frames are picked from the sink. In the queued and nearest modes,
+   * each source keeps its own position in the last
+   * #GstInterVideoSink:ring-size frames of the sink, so that several
+   * sources of the same channel don't interfere with each other.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_enum ("mode", "Mode",
+          "How frames are picked from the sink",
+          GST_TYPE_INTER_VIDEO_SRC_MODE, DEFAULT_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -140,6 +182,7 @@ gst_inter_video_src_init (GstInterVideoSrc * intervideosrc)
 
   intervideosrc->channel = g_strdup (DEFAULT_CHANNEL);
   intervideosrc->timeout = DEFAULT_TIMEOUT;
+  intervideosrc->mode = DEFAULT_MODE;
 }
 
 void
@@ -156,6 +199,9 @@ gst_inter_video_src_set_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       intervideosrc->timeout = g_value_get_uint64 (value);
       break;
+    case PROP_MODE:
+      intervideosrc->mode = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -175,6 +221,9 @@ gst_inter_video_src_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, intervideosrc->timeout);
       break;
+    case PROP_MODE:
+      g_value_set_enum (value, intervideosrc->mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -277,6 +326,15 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
 
+  /* start with the last frame rendered by the sink */
+  g_mutex_lock (&intervideosrc->surface->mutex);
+  intervideosrc->read_pos = intervideosrc->surface->video_ring_written;
+  if (intervideosrc->read_pos > 0)
+    intervideosrc->read_pos--;
+  g_mutex_unlock (&intervideosrc->surface->mutex);
+  intervideosrc->last_frame_time = GST_CLOCK_TIME_NONE;
+  intervideosrc->repeat_count = 0;
+
   return TRUE;
 }
 
@@ -290,6 +348,7 @@ gst_inter_video_src_stop (GstBaseSrc * src)
   gst_inter_surface_unref (intervideosrc->surface);
   intervideosrc->surface = NULL;
   gst_buffer_replace (&intervideosrc->black_frame, NULL);
+  gst_buffer_replace (&intervideosrc->last_frame, NULL);
 
   return TRUE;
 }
@@ -319,6 +378,90 @@ gst_inter_video_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
   }
 }
 
+/* Picks the next frame from the surface ring, or repeats the last one.
+ * Call with the surface mutex held. */
+static GstBuffer *
+gst_inter_video_src_take_frame (GstInterVideoSrc * intervideosrc,
+    guint64 frames, gboolean * is_gap)
+{
+  GstInterSurface *surface = intervideosrc->surface;
+  const GstInterVideoFrame *frame = NULL, *f;
+  guint64 n, pos = 0, oldest = 0;
+
+  if (surface->video_ring_written > surface->video_ring_size)
+    oldest = surface->video_ring_written - surface->video_ring_size;
+  if (intervideosrc->read_pos < oldest) {
+    GST_DEBUG_OBJECT (intervideosrc, "Missed %" G_GUINT64_FORMAT " frames",
+        oldest - intervideosrc->read_pos);
+    intervideosrc->read_pos = oldest;
+  }
+
+  if (intervideosrc->mode == GST_INTER_VIDEO_SRC_MODE_NEAREST) {
+    GstClockTime target;
+    GstClockTimeDiff best = G_MAXINT64;
+
+    /* clock time at which the frame we are creating is output */
+    target = GST_ELEMENT_CAST (intervideosrc)->base_time +
+        intervideosrc->timestamp_offset +
+        gst_util_uint64_scale (GST_SECOND * intervideosrc->n_frames,
+        GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
+        GST_VIDEO_INFO_FPS_N (&intervideosrc->info));
+
+    if (GST_CLOCK_TIME_IS_VALID (intervideosrc->last_frame_time))
+      best = ABS (GST_CLOCK_DIFF (target, intervideosrc->last_frame_time));
+
+    for (n = intervideosrc->read_pos; n < surface->video_ring_written; n++) {
+      GstClockTimeDiff diff;
+
+      if (!(f = gst_inter_surface_get_video_frame (surface, n)))
+        continue;
+      /* without a time, fall back to the order of the frames */
+      if (!GST_CLOCK_TIME_IS_VALID (f->time)) {
+        if (!frame) {
+          frame = f;
+          pos = n;
+        }
+        break;
+      }
+      diff = ABS (GST_CLOCK_DIFF (target, f->time));
+      if (diff >= best)
+        break;
+      best = diff;
+      frame = f;
+      pos = n;
+    }
+  } else {
+    for (n = intervideosrc->read_pos; n < surface->video_ring_written; n++) {
+      if ((frame = gst_inter_surface_get_video_frame (surface, n))) {
+        pos = n;
+        break;
+      }
+    }
+  }
+
+  if (frame) {
+    intervideosrc->read_pos = pos + 1;
+    gst_buffer_replace (&intervideosrc->last_frame, frame->buffer);
+    intervideosrc->last_frame_time = frame->time;
+    intervideosrc->repeat_count = 0;
+    return gst_buffer_ref (frame->buffer);
+  }
+
+  /* nothing better, repeat the last frame until the timeout */
+  if (!intervideosrc->last_frame)
+    return NULL;
+
+  *is_gap = TRUE;
+  intervideosrc->repeat_count++;
+  if (intervideosrc->timeout > 0 && intervideosrc->repeat_count >= frames) {
+    gst_buffer_replace (&intervideosrc->last_frame, NULL);
+    intervideosrc->last_frame_time = GST_CLOCK_TIME_NONE;
+    return NULL;
+  }
+
+  return gst_buffer_ref (intervideosrc->last_frame);
+}
+
 static GstFlowReturn
 gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     GstBuffer ** buf)
@@ -360,24 +503,28 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  if (intervideosrc->surface->video_buffer) {
-    /* We have a buffer to push */
-    buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
+  if (intervideosrc->mode != GST_INTER_VIDEO_SRC_MODE_LATEST) {
+    buffer = gst_inter_video_src_take_frame (intervideosrc, frames, &is_gap);
+  } else {
+    if (intervideosrc->surface->video_buffer) {
+      /* We have a buffer to push */
+      buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
+
+      /* Can only be true if timeout > 0 */
+      if (intervideosrc->surface->video_buffer_count == frames) {
+        gst_buffer_unref (intervideosrc->surface->video_buffer);
+        intervideosrc->surface->video_buffer = NULL;
+      }
+    }
 
-    /* Can only be true if timeout > 0 */
-    if (intervideosrc->surface->video_buffer_count == frames) {
-      gst_buffer_unref (intervideosrc->surface->video_buffer);
-      intervideosrc->surface->video_buffer = NULL;
+    if (intervideosrc->surface->video_buffer_count != 0 &&
+        intervideosrc->surface->video_buffer_count != (frames + 1)) {
+      /* This is a repeat of the stored buffer or of a black frame */
+      is_gap = TRUE;
     }
-  }
 
-  if (intervideosrc->surface->video_buffer_count != 0 &&
-      intervideosrc->surface->video_buffer_count != (frames + 1)) {
-    /* This is a repeat of the stored buffer or of a black frame */
-    is_gap = TRUE;
+    intervideosrc->surface->video_buffer_count++;
   }
-
-  intervideosrc->surface->video_buffer_count++;
   g_mutex_unlock (&intervideosrc->surface->mutex);
 
   if (caps) {
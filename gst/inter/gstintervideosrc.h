@@ -32,6 +32,15 @@ G_BEGIN_DECLS
 #define GST_IS_INTER_VIDEO_SRC(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_INTER_VIDEO_SRC))
 #define GST_IS_INTER_VIDEO_SRC_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_INTER_VIDEO_SRC))
 
+#define GST_TYPE_INTER_VIDEO_SRC_MODE (gst_inter_video_src_mode_get_type())
+
+typedef enum
+{
+  GST_INTER_VIDEO_SRC_MODE_LATEST,
+  GST_INTER_VIDEO_SRC_MODE_QUEUED,
+  GST_INTER_VIDEO_SRC_MODE_NEAREST
+} GstInterVideoSrcMode;
+
 typedef struct _GstInterVideoSrc GstInterVideoSrc;
 typedef struct _GstInterVideoSrcClass GstInterVideoSrcClass;
 
@@ -43,6 +52,14 @@ struct _GstInterVideoSrc
 
   char *channel;
   guint64 timeout;
+  GstInterVideoSrcMode mode;
+
+  /* next frame of the surface ring to look at, and the last frame taken
+   * from it, in the queued and nearest modes */
+  guint64 read_pos;
+  GstBuffer *last_frame;
+  GstClockTime last_frame_time;
+  guint64 repeat_count;
 
   GstVideoInfo info;
   GstBuffer *black_frame;
@@ -56,6 +73,7 @@ struct _GstInterVideoSrcClass
 };
 
 GType gst_inter_video_src_get_type (void);
+GType gst_inter_video_src_mode_get_type (void);
 
 G_END_DECLS
 
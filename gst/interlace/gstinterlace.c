@@ -59,6 +59,7 @@
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
+#include <gst/stripe-threads-private.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -105,6 +106,9 @@ struct _GstInterlace
   int fields_since_timebase;
   guint pattern_offset;         /* initial offset into the pattern */
   gboolean passthrough;
+
+  /* field copy threads, the n-threads property is threads.n_threads */
+  GstStripeThreads threads;
 };
 
 struct _GstInterlaceClass
@@ -118,9 +122,12 @@ enum
   PROP_TOP_FIELD_FIRST,
   PROP_PATTERN,
   PROP_PATTERN_OFFSET,
-  PROP_ALLOW_RFF
+  PROP_ALLOW_RFF,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_N_THREADS 1
+
 typedef enum
 {
   GST_INTERLACE_PATTERN_1_1,
@@ -243,6 +250,12 @@ gst_interlace_class_init (GstInterlaceClass * klass)
           "Allow generation of buffers with RFF flag set, i.e., duration of 3 fields",
           FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads copying fields (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (element_class,
       "Interlace filter", "Filter/Video",
       "Creates an interlaced video from progressive frames",
@@ -259,6 +272,10 @@ gst_interlace_class_init (GstInterlaceClass * klass)
 static void
 gst_interlace_finalize (GObject * obj)
 {
+  GstInterlace *interlace = GST_INTERLACE (obj);
+
+  gst_stripe_threads_clear (&interlace->threads);
+
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
 
@@ -295,6 +312,7 @@ gst_interlace_init (GstInterlace * interlace)
   interlace->allow_rff = FALSE;
   interlace->pattern = GST_INTERLACE_PATTERN_2_3;
   interlace->pattern_offset = 0;
+  gst_stripe_threads_init (&interlace->threads, DEFAULT_N_THREADS);
   gst_interlace_reset (interlace);
 }
 
@@ -785,45 +803,89 @@ gst_interlace_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
   return ret;
 }
 
+typedef struct
+{
+  GstVideoFrame *dframe;
+  GstVideoFrame *sframe;
+  gint field_index;
+  guint n_stripes;
+} GstInterlaceField;
+
+/* Copies the share of the field lines of every plane that belongs to the
+ * stripe, only the bytes of the visible samples of each line are copied.
+ * The planes have different heights, so they are split by stripe index and
+ * not by the rows given by the stripe threads. */
 static void
-copy_field (GstInterlace * interlace, GstBuffer * dest, GstBuffer * src,
-    int field_index)
+copy_field_stripe (gpointer user_data, guint stripe, gint first_row,
+    gint last_row)
 {
-  GstVideoInfo *info = &interlace->info;
-  gint i, j, n_planes;
-  guint8 *d, *s;
-  GstVideoFrame dframe, sframe;
-
-  if (!gst_video_frame_map (&dframe, info, dest, GST_MAP_WRITE))
-    goto dest_map_failed;
-
-  if (!gst_video_frame_map (&sframe, info, src, GST_MAP_READ))
-    goto src_map_failed;
+  GstInterlaceField *field = user_data;
+  GstVideoFrame *dframe = field->dframe;
+  GstVideoFrame *sframe = field->sframe;
+  const GstVideoFormatInfo *finfo = dframe->info.finfo;
+  gint i, c, j, n_planes;
 
-  n_planes = GST_VIDEO_FRAME_N_PLANES (&dframe);
+  n_planes = GST_VIDEO_FRAME_N_PLANES (dframe);
 
   for (i = 0; i < n_planes; i++) {
-    gint cheight, cwidth;
+    gint cheight, n_lines, first, last, row_size = 0;
     gint ss, ds;
+    guint8 *d, *s;
+
+    /* the first component of the plane gives its row size, as for the
+     * packed formats the pixel stride covers all components */
+    for (c = 0; c < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); c++) {
+      if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, c) == i) {
+        row_size = GST_VIDEO_FRAME_COMP_WIDTH (dframe, c) *
+            GST_VIDEO_FRAME_COMP_PSTRIDE (dframe, c);
+        break;
+      }
+    }
 
-    d = GST_VIDEO_FRAME_PLANE_DATA (&dframe, i);
-    s = GST_VIDEO_FRAME_PLANE_DATA (&sframe, i);
-
-    ds = GST_VIDEO_FRAME_PLANE_STRIDE (&dframe, i);
-    ss = GST_VIDEO_FRAME_PLANE_STRIDE (&sframe, i);
+    ds = GST_VIDEO_FRAME_PLANE_STRIDE (dframe, i);
+    ss = GST_VIDEO_FRAME_PLANE_STRIDE (sframe, i);
+    row_size = MIN (row_size, MIN (ABS (ss), ABS (ds)));
 
-    d += field_index * ds;
-    s += field_index * ss;
+    cheight = GST_VIDEO_FRAME_COMP_HEIGHT (dframe, i);
+    n_lines = (cheight - field->field_index + 1) / 2;
+    first = (gint64) n_lines * stripe / field->n_stripes;
+    last = (gint64) n_lines * (stripe + 1) / field->n_stripes;
 
-    cheight = GST_VIDEO_FRAME_COMP_HEIGHT (&dframe, i);
-    cwidth = MIN (ABS (ss), ABS (ds));
+    d = GST_VIDEO_FRAME_PLANE_DATA (dframe, i);
+    s = GST_VIDEO_FRAME_PLANE_DATA (sframe, i);
+    d += (2 * first + field->field_index) * ds;
+    s += (2 * first + field->field_index) * ss;
 
-    for (j = field_index; j < cheight; j += 2) {
-      memcpy (d, s, cwidth);
+    for (j = first; j < last; j++) {
+      memcpy (d, s, row_size);
       d += ds * 2;
       s += ss * 2;
     }
   }
+}
+
+static void
+copy_field (GstInterlace * interlace, GstBuffer * dest, GstBuffer * src,
+    int field_index)
+{
+  GstVideoInfo *info = &interlace->info;
+  GstVideoFrame dframe, sframe;
+  GstInterlaceField field;
+  gint height = GST_VIDEO_INFO_HEIGHT (info);
+
+  if (!gst_video_frame_map (&dframe, info, dest, GST_MAP_WRITE))
+    goto dest_map_failed;
+
+  if (!gst_video_frame_map (&sframe, info, src, GST_MAP_READ))
+    goto src_map_failed;
+
+  field.dframe = &dframe;
+  field.sframe = &sframe;
+  field.field_index = field_index;
+  field.n_stripes = gst_stripe_threads_get_n_stripes (&interlace->threads,
+      height, 32);
+  gst_stripe_threads_run_stripes (&interlace->threads, field.n_stripes,
+      height, copy_field_stripe, &field);
 
   gst_video_frame_unmap (&dframe);
   gst_video_frame_unmap (&sframe);
@@ -842,6 +904,22 @@ src_map_failed:
   }
 }
 
+/* TRUE if the buffer and its memory can be written without a copy */
+static gboolean
+gst_interlace_buffer_is_writable (GstBuffer * buffer)
+{
+  guint i, n;
+
+  if (!gst_buffer_is_writable (buffer))
+    return FALSE;
+
+  n = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n; i++) {
+    if (!gst_memory_is_writable (gst_buffer_peek_memory (buffer, i)))
+      return FALSE;
+  }
+  return TRUE;
+}
 
 static GstFlowReturn
 gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
@@ -920,10 +998,19 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     if (interlace->stored_fields > 0) {
       GST_DEBUG ("1 field from stored, 1 from current");
 
-      output_buffer = gst_buffer_new_and_alloc (gst_buffer_get_size (buffer));
-      /* take the first field from the stored frame */
-      copy_field (interlace, output_buffer, interlace->stored_frame,
-          interlace->field_index);
+      if (interlace->stored_fields == 1
+          && gst_interlace_buffer_is_writable (interlace->stored_frame)) {
+        /* the stored frame is not needed anymore, it already holds the
+         * first field so only the second one has to be copied into it */
+        output_buffer = interlace->stored_frame;
+        interlace->stored_frame = NULL;
+      } else {
+        output_buffer =
+            gst_buffer_new_and_alloc (gst_buffer_get_size (buffer));
+        /* take the first field from the stored frame */
+        copy_field (interlace, output_buffer, interlace->stored_frame,
+            interlace->field_index);
+      }
       interlace->stored_fields--;
       /* take the second field from the incoming buffer */
       copy_field (interlace, output_buffer, buffer, interlace->field_index ^ 1);
@@ -931,7 +1018,6 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       n_output_fields = 2;
       interlaced = TRUE;
     } else {
-      output_buffer = gst_buffer_make_writable (gst_buffer_ref (buffer));
       if (num_fields >= 3 && interlace->allow_rff) {
         GST_DEBUG ("3 fields from current");
         /* take both fields from incoming buffer */
@@ -943,6 +1029,14 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
         current_fields -= 2;
         n_output_fields = 2;
       }
+
+      if (current_fields > 0) {
+        output_buffer = gst_buffer_make_writable (gst_buffer_ref (buffer));
+      } else {
+        /* last use of the incoming buffer, push it on */
+        output_buffer = gst_buffer_make_writable (buffer);
+        buffer = NULL;
+      }
     }
     num_fields -= n_output_fields;
 
@@ -981,7 +1075,7 @@ gst_interlace_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   if (current_fields > 0) {
     interlace->stored_frame = buffer;
     interlace->stored_fields = current_fields;
-  } else {
+  } else if (buffer) {
     gst_buffer_unref (buffer);
   }
   return ret;
@@ -1006,6 +1100,9 @@ gst_interlace_set_property (GObject * object,
     case PROP_ALLOW_RFF:
       interlace->allow_rff = g_value_get_boolean (value);
       break;
+    case PROP_N_THREADS:
+      interlace->threads.n_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1031,6 +1128,9 @@ gst_interlace_get_property (GObject * object,
     case PROP_ALLOW_RFF:
       g_value_set_boolean (value, interlace->allow_rff);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, interlace->threads.n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
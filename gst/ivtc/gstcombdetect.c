@@ -49,6 +49,11 @@ GST_DEBUG_CATEGORY_STATIC (gst_comb_detect_debug_category);
 /* prototypes */
 
 
+static void gst_comb_detect_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_comb_detect_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_comb_detect_finalize (GObject * object);
 static GstCaps *gst_comb_detect_transform_caps (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter);
 static gboolean gst_comb_detect_set_info (GstVideoFilter * filter,
@@ -59,9 +64,12 @@ static GstFlowReturn gst_comb_detect_transform_frame (GstVideoFilter * filter,
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_N_THREADS 1
+
 /* pad templates */
 
 /* Yeah, the max width is hard-coded 2048. */
@@ -97,10 +105,22 @@ G_DEFINE_TYPE_WITH_CODE (GstCombDetect, gst_comb_detect, GST_TYPE_VIDEO_FILTER,
 static void
 gst_comb_detect_class_init (GstCombDetectClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstBaseTransformClass *base_transform_class =
       GST_BASE_TRANSFORM_CLASS (klass);
   GstVideoFilterClass *video_filter_class = GST_VIDEO_FILTER_CLASS (klass);
 
+  gobject_class->set_property = gst_comb_detect_set_property;
+  gobject_class->get_property = gst_comb_detect_get_property;
+  gobject_class->finalize = gst_comb_detect_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads used for comb detection, each one handles a "
+          "stripe of rows (0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* Setting up pads and setting metadata should be moved to
      base_class_init if you intend to subclass this class. */
   gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
@@ -123,6 +143,51 @@ gst_comb_detect_class_init (GstCombDetectClass * klass)
 static void
 gst_comb_detect_init (GstCombDetect * combdetect)
 {
+  gst_stripe_threads_init (&combdetect->threads, DEFAULT_N_THREADS);
+}
+
+static void
+gst_comb_detect_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstCombDetect *combdetect = GST_COMB_DETECT (object);
+
+  switch (property_id) {
+    case PROP_N_THREADS:
+      combdetect->threads.n_threads = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_comb_detect_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstCombDetect *combdetect = GST_COMB_DETECT (object);
+
+  switch (property_id) {
+    case PROP_N_THREADS:
+      g_value_set_uint (value, combdetect->threads.n_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_comb_detect_finalize (GObject * object)
+{
+  GstCombDetect *combdetect = GST_COMB_DETECT (object);
+
+  gst_stripe_threads_clear (&combdetect->threads);
+  g_free (combdetect->comb_mask);
+  g_free (combdetect->comb_rows);
+
+  G_OBJECT_CLASS (gst_comb_detect_parent_class)->finalize (object);
 }
 
 
@@ -182,23 +247,99 @@ gst_comb_detect_set_info (GstVideoFilter * filter,
 {
   GstCombDetect *combdetect = GST_COMB_DETECT (filter);
 
+  int width, height;
+
   memcpy (&combdetect->vinfo, in_info, sizeof (GstVideoInfo));
 
+  width = GST_VIDEO_INFO_COMP_WIDTH (in_info, 0);
+  height = GST_VIDEO_INFO_COMP_HEIGHT (in_info, 0);
+  g_free (combdetect->comb_mask);
+  g_free (combdetect->comb_rows);
+  combdetect->comb_mask = g_malloc (width * height);
+  combdetect->comb_rows = g_malloc (height);
+
   return TRUE;
 }
 
+#define GET_LINE(frame,comp,line) (((unsigned char *)(frame)->data[k]) + \
+      (line) * GST_VIDEO_FRAME_COMP_STRIDE((frame), (comp)))
+
+typedef struct
+{
+  GstCombDetect *combdetect;
+  GstVideoFrame *inframe;
+  GstVideoFrame *outframe;
+  int z;
+} CombDetectFrame;
+
+static void
+gst_comb_detect_mask_rows (gpointer user_data, guint stripe, int first,
+    int last)
+{
+  CombDetectFrame *cf = user_data;
+  GstCombDetect *combdetect = cf->combdetect;
+  int width = GST_VIDEO_FRAME_COMP_WIDTH (cf->inframe, 0);
+  int j;
+  int k = 0;
+
+  /* rows are counted from 2, the first and last two are not analysed */
+  for (j = first + 2; j < last + 2; j++) {
+    guint8 *src1 = GET_LINE (cf->inframe, 0, j - 1);
+    guint8 *src2 = GET_LINE (cf->inframe, 0, j);
+    guint8 *src3 = GET_LINE (cf->inframe, 0, j + 1);
+
+    combdetect->comb_rows[j] =
+        gst_ivtc_comb_mask_line (combdetect->comb_mask + j * width, src1,
+        src2, src3, width);
+  }
+}
+
+static void
+gst_comb_detect_draw_rows (gpointer user_data, guint stripe, int first,
+    int last)
+{
+  CombDetectFrame *cf = user_data;
+  GstCombDetect *combdetect = cf->combdetect;
+  int height = GST_VIDEO_FRAME_COMP_HEIGHT (cf->outframe, 0);
+  int width = GST_VIDEO_FRAME_COMP_WIDTH (cf->outframe, 0);
+  int i, j;
+  int k = 0;
+
+  for (j = first; j < last; j++) {
+    guint8 *dest = GET_LINE (cf->outframe, 0, j);
+    guint8 *src = GET_LINE (cf->inframe, 0, j);
+
+    if (j < 2 || j >= height - 2) {
+      for (i = 0; i < width; i++) {
+        dest[i] = src[i] / 2;
+      }
+    } else if (!combdetect->comb_rows[j]) {
+      memcpy (dest, src, width);
+    } else {
+      guint8 *mask = combdetect->comb_mask + j * width;
+
+      for (i = 0; i < width; i++) {
+        if (mask[i] == GST_IVTC_COMB_MARKED) {
+          dest[i] = ((i + j + cf->z) & 0x4) ? 235 : 16;
+        } else {
+          dest[i] = src[i];
+        }
+      }
+    }
+  }
+}
+
 static GstFlowReturn
 gst_comb_detect_transform_frame (GstVideoFilter * filter,
     GstVideoFrame * inframe, GstVideoFrame * outframe)
 {
+  GstCombDetect *combdetect = GST_COMB_DETECT (filter);
+  CombDetectFrame cf;
   static int z;
   int k;
   int height;
   int width;
 
-#define GET_LINE(frame,comp,line) (((unsigned char *)(frame)->data[k]) + \
-      (line) * GST_VIDEO_FRAME_COMP_STRIDE((frame), (comp)))
-
   z++;
 
   for (k = 1; k < 3; k++) {
@@ -213,6 +354,7 @@ gst_comb_detect_transform_frame (GstVideoFilter * filter,
   {
     int j;
     int thisline[MAX_WIDTH];
+    gboolean cleared = TRUE;
     int score = 0;
 
     height = GST_VIDEO_FRAME_COMP_HEIGHT (outframe, 0);
@@ -220,43 +362,37 @@ gst_comb_detect_transform_frame (GstVideoFilter * filter,
 
     memset (thisline, 0, sizeof (thisline));
 
-    k = 0;
-    for (j = 0; j < height; j++) {
-      int i;
-      if (j < 2 || j >= height - 2) {
-        guint8 *dest = GET_LINE (outframe, 0, j);
-        guint8 *src = GET_LINE (inframe, 0, j);
-        for (i = 0; i < width; i++) {
-          dest[i] = src[i] / 2;
-        }
-      } else {
-        guint8 *dest = GET_LINE (outframe, 0, j);
-        guint8 *src1 = GET_LINE (inframe, 0, j - 1);
-        guint8 *src2 = GET_LINE (inframe, 0, j);
-        guint8 *src3 = GET_LINE (inframe, 0, j + 1);
-
-        for (i = 0; i < width; i++) {
-          if (src2[i] < MIN (src1[i], src3[i]) - 5 ||
-              src2[i] > MAX (src1[i], src3[i]) + 5) {
-            if (i > 0) {
-              thisline[i] += thisline[i - 1];
-            }
-            thisline[i]++;
-            if (thisline[i] > 1000)
-              thisline[i] = 1000;
-          } else {
-            thisline[i] = 0;
-          }
-          if (thisline[i] > 100) {
-            dest[i] = ((i + j + z) & 0x4) ? 235 : 16;
-            score++;
-          } else {
-            dest[i] = src2[i];
-          }
+    cf.combdetect = combdetect;
+    cf.inframe = inframe;
+    cf.outframe = outframe;
+    cf.z = z;
+
+    /* The comb mask and the output only depend on a few lines and are
+     * computed in parallel stripes, the runs carry over from one line to
+     * the next one so they are accumulated serially in between. */
+    gst_stripe_threads_run (&combdetect->threads, height - 4,
+        GST_IVTC_STRIPE_MIN_ROWS, gst_comb_detect_mask_rows, &cf);
+
+    for (j = 2; j < height - 2; j++) {
+      int line_score;
+
+      if (!combdetect->comb_rows[j]) {
+        if (!cleared) {
+          memset (thisline, 0, width * sizeof (int));
+          cleared = TRUE;
         }
+        continue;
       }
+      line_score = gst_ivtc_comb_score_line (thisline,
+          combdetect->comb_mask + j * width, width);
+      combdetect->comb_rows[j] = line_score > 0;
+      score += line_score;
+      cleared = FALSE;
     }
 
+    gst_stripe_threads_run (&combdetect->threads, height,
+        GST_IVTC_STRIPE_MIN_ROWS, gst_comb_detect_draw_rows, &cf);
+
     if (score > 10)
       GST_DEBUG ("score %d", score);
   }
@@ -23,6 +23,8 @@
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
 
+#include "gstivtcutils.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_COMB_DETECT   (gst_comb_detect_get_type())
@@ -39,6 +41,13 @@ struct _GstCombDetect
   GstVideoFilter base_combdetect;
 
   GstVideoInfo vinfo;
+
+  /* properties */
+  GstStripeThreads threads;
+
+  /* comb mask of the luma plane, and whether each row has marked samples */
+  guint8 *comb_mask;
+  guint8 *comb_rows;
 };
 
 struct _GstCombDetectClass
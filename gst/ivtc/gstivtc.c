@@ -69,17 +69,26 @@ static gboolean gst_ivtc_sink_event (GstBaseTransform * trans,
     GstEvent * event);
 static GstFlowReturn gst_ivtc_transform (GstBaseTransform * trans,
     GstBuffer * inbuf, GstBuffer * outbuf);
+static void gst_ivtc_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_ivtc_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec);
+static void gst_ivtc_finalize (GObject * object);
 static void gst_ivtc_flush (GstIvtc * ivtc);
 static void gst_ivtc_retire_fields (GstIvtc * ivtc, int n_fields);
 static void gst_ivtc_construct_frame (GstIvtc * itvc, GstBuffer * outbuf);
 
-static int get_comb_score (GstVideoFrame * top, GstVideoFrame * bottom);
+static int get_comb_score (GstIvtc * ivtc, GstVideoFrame * top,
+    GstVideoFrame * bottom);
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_N_THREADS
 };
 
+#define DEFAULT_N_THREADS 1
+
 /* pad templates */
 
 #define MAX_WIDTH 2048
@@ -114,9 +123,22 @@ G_DEFINE_TYPE_WITH_CODE (GstIvtc, gst_ivtc, GST_TYPE_BASE_TRANSFORM,
 static void
 gst_ivtc_class_init (GstIvtcClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstBaseTransformClass *base_transform_class =
       GST_BASE_TRANSFORM_CLASS (klass);
 
+  gobject_class->set_property = gst_ivtc_set_property;
+  gobject_class->get_property = gst_ivtc_get_property;
+  gobject_class->finalize = gst_ivtc_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads used for comb detection and field "
+          "interpolation, each one handles a stripe of rows "
+          "(0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /* Setting up pads and setting metadata should be moved to
      base_class_init if you intend to subclass this class. */
   gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
@@ -139,6 +161,51 @@ gst_ivtc_class_init (GstIvtcClass * klass)
 static void
 gst_ivtc_init (GstIvtc * ivtc)
 {
+  gst_stripe_threads_init (&ivtc->threads, DEFAULT_N_THREADS);
+}
+
+static void
+gst_ivtc_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstIvtc *ivtc = GST_IVTC (object);
+
+  switch (property_id) {
+    case PROP_N_THREADS:
+      ivtc->threads.n_threads = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_ivtc_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstIvtc *ivtc = GST_IVTC (object);
+
+  switch (property_id) {
+    case PROP_N_THREADS:
+      g_value_set_uint (value, ivtc->threads.n_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_ivtc_finalize (GObject * object)
+{
+  GstIvtc *ivtc = GST_IVTC (object);
+
+  gst_stripe_threads_clear (&ivtc->threads);
+  g_free (ivtc->comb_mask);
+  g_free (ivtc->comb_rows);
+
+  G_OBJECT_CLASS (gst_ivtc_parent_class)->finalize (object);
 }
 
 static GstCaps *
@@ -227,10 +294,18 @@ gst_ivtc_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     GstCaps * outcaps)
 {
   GstIvtc *ivtc = GST_IVTC (trans);
+  int width, height;
 
   gst_video_info_from_caps (&ivtc->sink_video_info, incaps);
   gst_video_info_from_caps (&ivtc->src_video_info, outcaps);
 
+  width = GST_VIDEO_INFO_COMP_WIDTH (&ivtc->sink_video_info, 0);
+  height = GST_VIDEO_INFO_COMP_HEIGHT (&ivtc->sink_video_info, 0);
+  g_free (ivtc->comb_mask);
+  g_free (ivtc->comb_rows);
+  ivtc->comb_mask = g_malloc (width * height);
+  ivtc->comb_rows = g_malloc (height);
+
   ivtc->field_duration = gst_util_uint64_scale_int (GST_SECOND,
       ivtc->sink_video_info.fps_d, ivtc->sink_video_info.fps_n * 2);
   GST_DEBUG_OBJECT (trans, "field duration %" GST_TIME_FORMAT,
@@ -319,9 +394,9 @@ similarity (GstIvtc * ivtc, int i1, int i2)
   f2 = &ivtc->fields[i2];
 
   if (f1->parity == TOP_FIELD) {
-    score = get_comb_score (&f1->frame, &f2->frame);
+    score = get_comb_score (ivtc, &f1->frame, &f2->frame);
   } else {
-    score = get_comb_score (&f2->frame, &f1->frame);
+    score = get_comb_score (ivtc, &f2->frame, &f1->frame);
   }
 
   GST_DEBUG ("score %d", score);
@@ -366,125 +441,61 @@ reconstruct (GstIvtc * ivtc, GstVideoFrame * dest_frame, int i1, int i2)
 
 }
 
-static int
-reconstruct_line (guint8 * line1, guint8 * line2, int i, int a, int b, int c,
-    int d)
+typedef struct
 {
-  int x;
-
-  x = line1[i - 3] * a;
-  x += line1[i - 2] * b;
-  x += line1[i - 1] * c;
-  x += line1[i - 0] * d;
-  x += line2[i + 0] * d;
-  x += line2[i + 1] * c;
-  x += line2[i + 2] * b;
-  x += line2[i + 3] * a;
-  return (x + 16) >> 5;
-}
-
+  GstVideoFrame *dest_frame;
+  GstIvtcField *field;
+  int k;
+} ReconstructSingle;
 
 static void
-reconstruct_single (GstIvtc * ivtc, GstVideoFrame * dest_frame, int i1)
+reconstruct_single_rows (gpointer user_data, guint stripe, int first,
+    int last)
 {
+  ReconstructSingle *rs = user_data;
+  GstVideoFrame *dest_frame = rs->dest_frame;
+  GstIvtcField *field = rs->field;
+  int k = rs->k;
+  int height = GST_VIDEO_FRAME_COMP_HEIGHT (dest_frame, k);
+  int width = GST_VIDEO_FRAME_COMP_WIDTH (dest_frame, k);
   int j;
-  int k;
-  int height;
-  int width;
-  GstIvtcField *field = &ivtc->fields[i1];
 
-  for (k = 0; k < 1; k++) {
-    height = GST_VIDEO_FRAME_COMP_HEIGHT (dest_frame, k);
-    width = GST_VIDEO_FRAME_COMP_WIDTH (dest_frame, k);
-    for (j = 0; j < height; j++) {
-      if ((j & 1) == field->parity) {
+  for (j = first; j < last; j++) {
+    if ((j & 1) == field->parity) {
+      memcpy (GET_LINE (dest_frame, k, j),
+          GET_LINE (&field->frame, k, j), width);
+    } else {
+      if (j == 0 || j == height - 1) {
         memcpy (GET_LINE (dest_frame, k, j),
-            GET_LINE (&field->frame, k, j), width);
+            GET_LINE (&field->frame, k, (j ^ 1)), width);
       } else {
-        if (j == 0 || j == height - 1) {
-          memcpy (GET_LINE (dest_frame, k, j),
-              GET_LINE (&field->frame, k, (j ^ 1)), width);
-        } else {
-          guint8 *dest = GET_LINE (dest_frame, k, j);
-          guint8 *line1 = GET_LINE (&field->frame, k, j - 1);
-          guint8 *line2 = GET_LINE (&field->frame, k, j + 1);
-          int i;
-
-#define MARGIN 3
-          for (i = MARGIN; i < width - MARGIN; i++) {
-            int dx, dy;
-
-            dx = -line1[i - 1] - line2[i - 1] + line1[i + 1] + line2[i + 1];
-            dx *= 2;
-
-            dy = -line1[i - 1] - 2 * line1[i] - line1[i + 1]
-                + line2[i - 1] + 2 * line2[i] + line2[i + 1];
-            if (dy < 0) {
-              dy = -dy;
-              dx = -dx;
-            }
-
-            if (dx == 0 && dy == 0) {
-              dest[i] = (line1[i] + line2[i] + 1) >> 1;
-            } else if (dx < 0) {
-              if (dx < -2 * dy) {
-                dest[i] = reconstruct_line (line1, line2, i, 0, 0, 0, 16);
-              } else if (dx < -dy) {
-                dest[i] = reconstruct_line (line1, line2, i, 0, 0, 8, 8);
-              } else if (2 * dx < -dy) {
-                dest[i] = reconstruct_line (line1, line2, i, 0, 4, 8, 4);
-              } else if (3 * dx < -dy) {
-                dest[i] = reconstruct_line (line1, line2, i, 1, 7, 7, 1);
-              } else {
-                dest[i] = reconstruct_line (line1, line2, i, 4, 8, 4, 0);
-              }
-            } else {
-              if (dx > 2 * dy) {
-                dest[i] = reconstruct_line (line2, line1, i, 0, 0, 0, 16);
-              } else if (dx > dy) {
-                dest[i] = reconstruct_line (line2, line1, i, 0, 0, 8, 8);
-              } else if (2 * dx > dy) {
-                dest[i] = reconstruct_line (line2, line1, i, 0, 4, 8, 4);
-              } else if (3 * dx > dy) {
-                dest[i] = reconstruct_line (line2, line1, i, 1, 7, 7, 1);
-              } else {
-                dest[i] = reconstruct_line (line2, line1, i, 4, 8, 4, 0);
-              }
-            }
-          }
-
-          for (i = 0; i < MARGIN; i++) {
-            dest[i] = (line1[i] + line2[i] + 1) >> 1;
-          }
-          for (i = width - MARGIN; i < width; i++) {
-            dest[i] = (line1[i] + line2[i] + 1) >> 1;
-          }
-        }
+        guint8 *dest = GET_LINE (dest_frame, k, j);
+        guint8 *line1 = GET_LINE (&field->frame, k, j - 1);
+        guint8 *line2 = GET_LINE (&field->frame, k, j + 1);
+
+        /* edge directed interpolation on luma, plain average on chroma */
+        if (k == 0)
+          gst_ivtc_reconstruct_interpolate (dest, line1, line2, width);
+        else
+          gst_ivtc_reconstruct_average (dest, line1, line2, 0, width);
       }
     }
   }
-  for (k = 1; k < 3; k++) {
-    height = GST_VIDEO_FRAME_COMP_HEIGHT (dest_frame, k);
-    width = GST_VIDEO_FRAME_COMP_WIDTH (dest_frame, k);
-    for (j = 0; j < height; j++) {
-      if ((j & 1) == field->parity) {
-        memcpy (GET_LINE (dest_frame, k, j),
-            GET_LINE (&field->frame, k, j), width);
-      } else {
-        if (j == 0 || j == height - 1) {
-          memcpy (GET_LINE (dest_frame, k, j),
-              GET_LINE (&field->frame, k, (j ^ 1)), width);
-        } else {
-          guint8 *dest = GET_LINE (dest_frame, k, j);
-          guint8 *line1 = GET_LINE (&field->frame, k, j - 1);
-          guint8 *line2 = GET_LINE (&field->frame, k, j + 1);
-          int i;
-          for (i = 0; i < width; i++) {
-            dest[i] = (line1[i] + line2[i] + 1) >> 1;
-          }
-        }
-      }
-    }
+}
+
+static void
+reconstruct_single (GstIvtc * ivtc, GstVideoFrame * dest_frame, int i1)
+{
+  ReconstructSingle rs;
+  int k;
+
+  rs.dest_frame = dest_frame;
+  rs.field = &ivtc->fields[i1];
+  for (k = 0; k < 3; k++) {
+    rs.k = k;
+    gst_stripe_threads_run (&ivtc->threads,
+        GST_VIDEO_FRAME_COMP_HEIGHT (dest_frame, k), GST_IVTC_STRIPE_MIN_ROWS,
+        reconstruct_single_rows, &rs);
   }
 }
 
@@ -629,46 +640,76 @@ gst_ivtc_construct_frame (GstIvtc * ivtc, GstBuffer * outbuf)
 
 }
 
+typedef struct
+{
+  GstIvtc *ivtc;
+  GstVideoFrame *top;
+  GstVideoFrame *bottom;
+} CombScore;
+
+static void
+comb_mask_rows (gpointer user_data, guint stripe, int first,
+    int last)
+{
+  CombScore *cs = user_data;
+  GstIvtc *ivtc = cs->ivtc;
+  int width = GST_VIDEO_FRAME_COMP_WIDTH (cs->top, 0);
+  int j;
+  int k = 0;
+
+  /* rows are counted from 2, see get_comb_score() */
+  for (j = first + 2; j < last + 2; j++) {
+    guint8 *src1 = GET_LINE_IL (cs->top, cs->bottom, 0, j - 1);
+    guint8 *src2 = GET_LINE_IL (cs->top, cs->bottom, 0, j);
+    guint8 *src3 = GET_LINE_IL (cs->top, cs->bottom, 0, j + 1);
+
+    ivtc->comb_rows[j] = gst_ivtc_comb_mask_line (ivtc->comb_mask + j * width,
+        src1, src2, src3, width);
+  }
+}
+
 static int
-get_comb_score (GstVideoFrame * top, GstVideoFrame * bottom)
+get_comb_score (GstIvtc * ivtc, GstVideoFrame * top, GstVideoFrame * bottom)
 {
+  CombScore cs;
   int j;
   int thisline[MAX_WIDTH];
+  gboolean cleared = TRUE;
   int score = 0;
   int height;
   int width;
-  int k;
 
   height = GST_VIDEO_FRAME_COMP_HEIGHT (top, 0);
   width = GST_VIDEO_FRAME_COMP_WIDTH (top, 0);
 
   memset (thisline, 0, sizeof (thisline));
 
-  k = 0;
   /* remove a few lines from top and bottom, as they sometimes contain
    * artifacts */
+  if (height <= 4)
+    return 0;
+
+  /* The comb mask only depends on three lines and is computed in parallel
+   * stripes. The runs carry over from one line to the next one so they are
+   * accumulated serially, which is cheap as lines without combing reset
+   * them all at once. */
+  cs.ivtc = ivtc;
+  cs.top = top;
+  cs.bottom = bottom;
+  gst_stripe_threads_run (&ivtc->threads, height - 4,
+      GST_IVTC_STRIPE_MIN_ROWS, comb_mask_rows, &cs);
+
   for (j = 2; j < height - 2; j++) {
-    guint8 *src1 = GET_LINE_IL (top, bottom, 0, j - 1);
-    guint8 *src2 = GET_LINE_IL (top, bottom, 0, j);
-    guint8 *src3 = GET_LINE_IL (top, bottom, 0, j + 1);
-    int i;
-
-    for (i = 0; i < width; i++) {
-      if (src2[i] < MIN (src1[i], src3[i]) - 5 ||
-          src2[i] > MAX (src1[i], src3[i]) + 5) {
-        if (i > 0) {
-          thisline[i] += thisline[i - 1];
-        }
-        thisline[i]++;
-        if (thisline[i] > 1000)
-          thisline[i] = 1000;
-      } else {
-        thisline[i] = 0;
-      }
-      if (thisline[i] > 100) {
-        score++;
+    if (!ivtc->comb_rows[j]) {
+      if (!cleared) {
+        memset (thisline, 0, width * sizeof (int));
+        cleared = TRUE;
       }
+      continue;
     }
+    score += gst_ivtc_comb_score_line (thisline, ivtc->comb_mask + j * width,
+        width);
+    cleared = FALSE;
   }
 
   GST_DEBUG ("score %d", score);
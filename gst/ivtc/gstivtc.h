@@ -23,6 +23,8 @@
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
 
+#include "gstivtcutils.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_IVTC   (gst_ivtc_get_type())
@@ -58,6 +60,13 @@ struct _GstIvtc
 
   int n_fields;
   GstIvtcField fields[GST_IVTC_MAX_FIELDS];
+
+  /* properties */
+  GstStripeThreads threads;
+
+  /* comb mask of the luma plane, and whether each row has combed samples */
+  guint8 *comb_mask;
+  guint8 *comb_rows;
 };
 
 struct _GstIvtcClass
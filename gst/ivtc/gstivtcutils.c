@@ -0,0 +1,437 @@
+/* GStreamer
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstivtcutils.h"
+
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/* Sets mask[i] to GST_IVTC_COMB_COMBED where src2 lies more than 5 outside
+ * of the range of the lines above and below, GST_IVTC_COMB_NONE elsewhere.
+ * Returns TRUE if any sample of the line is combed. */
+gboolean
+gst_ivtc_comb_mask_line (guint8 * mask, const guint8 * src1,
+    const guint8 * src2, const guint8 * src3, int width)
+{
+  gboolean combed = FALSE;
+  int i = 0;
+
+#if defined (__SSE2__)
+  {
+    const __m128i five = _mm_set1_epi8 (5);
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i any = zero;
+
+    /* with saturation, min - 5 > src2 becomes min - sat (src2 + 5) != 0 and
+     * src2 > max + 5 becomes sat (src2 - 5) - max != 0 */
+    for (; i + 16 <= width; i += 16) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (src1 + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (src2 + i));
+      __m128i c = _mm_loadu_si128 ((const __m128i *) (src3 + i));
+      __m128i lo =
+          _mm_subs_epu8 (_mm_min_epu8 (a, c), _mm_adds_epu8 (b, five));
+      __m128i hi =
+          _mm_subs_epu8 (_mm_subs_epu8 (b, five), _mm_max_epu8 (a, c));
+      __m128i m = _mm_cmpeq_epi8 (_mm_or_si128 (lo, hi), zero);
+
+      m = _mm_xor_si128 (m, _mm_cmpeq_epi8 (zero, zero));
+      _mm_storeu_si128 ((__m128i *) (mask + i), m);
+      any = _mm_or_si128 (any, m);
+    }
+    combed = _mm_movemask_epi8 (any) != 0;
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  {
+    const uint8x16_t five = vdupq_n_u8 (5);
+    uint8x16_t any = vdupq_n_u8 (0);
+
+    for (; i + 16 <= width; i += 16) {
+      uint8x16_t a = vld1q_u8 (src1 + i);
+      uint8x16_t b = vld1q_u8 (src2 + i);
+      uint8x16_t c = vld1q_u8 (src3 + i);
+      uint8x16_t lo = vcgtq_u8 (vminq_u8 (a, c), vqaddq_u8 (b, five));
+      uint8x16_t hi = vcgtq_u8 (vqsubq_u8 (b, five), vmaxq_u8 (a, c));
+      uint8x16_t m = vorrq_u8 (lo, hi);
+
+      vst1q_u8 (mask + i, m);
+      any = vorrq_u8 (any, m);
+    }
+    combed = (vgetq_lane_u64 (vreinterpretq_u64_u8 (any), 0) |
+        vgetq_lane_u64 (vreinterpretq_u64_u8 (any), 1)) != 0;
+  }
+#endif
+
+  for (; i < width; i++) {
+    if (src2[i] < MIN (src1[i], src3[i]) - 5 ||
+        src2[i] > MAX (src1[i], src3[i]) + 5) {
+      mask[i] = GST_IVTC_COMB_COMBED;
+      combed = TRUE;
+    } else {
+      mask[i] = GST_IVTC_COMB_NONE;
+    }
+  }
+
+  return combed;
+}
+
+static inline int
+gst_ivtc_comb_score_sample (int *thisline, guint8 * mask, int i, int *prev)
+{
+  if (mask[i]) {
+    int v = thisline[i] + *prev + 1;
+
+    if (v > 1000)
+      v = 1000;
+    thisline[i] = v;
+    *prev = v;
+    if (v > 100) {
+      mask[i] = GST_IVTC_COMB_MARKED;
+      return 1;
+    }
+  } else {
+    thisline[i] = 0;
+    *prev = 0;
+  }
+  return 0;
+}
+
+/* Accumulates the runs of combed samples of one mask line into thisline,
+ * which carries the run lengths over from the previous line. Samples
+ * whose run is long enough are counted and marked with
+ * GST_IVTC_COMB_MARKED in the mask. */
+int
+gst_ivtc_comb_score_line (int *thisline, guint8 * mask, int width)
+{
+  int score = 0;
+  int prev = 0;
+  int i, n;
+
+  for (i = 0; i + 16 <= width; i += 16) {
+    guint64 m[2];
+
+    /* uncombed samples reset the runs whatever came before */
+    memcpy (m, mask + i, 16);
+    if ((m[0] | m[1]) == 0) {
+      memset (thisline + i, 0, 16 * sizeof (int));
+      prev = 0;
+      continue;
+    }
+    for (n = i; n < i + 16; n++)
+      score += gst_ivtc_comb_score_sample (thisline, mask, n, &prev);
+  }
+  for (; i < width; i++)
+    score += gst_ivtc_comb_score_sample (thisline, mask, i, &prev);
+
+  return score;
+}
+
+static int
+reconstruct_line (guint8 * line1, guint8 * line2, int i, int a, int b, int c,
+    int d)
+{
+  int x;
+
+  x = line1[i - 3] * a;
+  x += line1[i - 2] * b;
+  x += line1[i - 1] * c;
+  x += line1[i - 0] * d;
+  x += line2[i + 0] * d;
+  x += line2[i + 1] * c;
+  x += line2[i + 2] * b;
+  x += line2[i + 3] * a;
+  return (x + 16) >> 5;
+}
+
+static int
+reconstruct_pixel (guint8 * line1, guint8 * line2, int i)
+{
+  int dx, dy;
+
+  dx = -line1[i - 1] - line2[i - 1] + line1[i + 1] + line2[i + 1];
+  dx *= 2;
+
+  dy = -line1[i - 1] - 2 * line1[i] - line1[i + 1]
+      + line2[i - 1] + 2 * line2[i] + line2[i + 1];
+  if (dy < 0) {
+    dy = -dy;
+    dx = -dx;
+  }
+
+  if (dx == 0 && dy == 0) {
+    return (line1[i] + line2[i] + 1) >> 1;
+  } else if (dx < 0) {
+    if (dx < -2 * dy) {
+      return reconstruct_line (line1, line2, i, 0, 0, 0, 16);
+    } else if (dx < -dy) {
+      return reconstruct_line (line1, line2, i, 0, 0, 8, 8);
+    } else if (2 * dx < -dy) {
+      return reconstruct_line (line1, line2, i, 0, 4, 8, 4);
+    } else if (3 * dx < -dy) {
+      return reconstruct_line (line1, line2, i, 1, 7, 7, 1);
+    } else {
+      return reconstruct_line (line1, line2, i, 4, 8, 4, 0);
+    }
+  } else {
+    if (dx > 2 * dy) {
+      return reconstruct_line (line2, line1, i, 0, 0, 0, 16);
+    } else if (dx > dy) {
+      return reconstruct_line (line2, line1, i, 0, 0, 8, 8);
+    } else if (2 * dx > dy) {
+      return reconstruct_line (line2, line1, i, 0, 4, 8, 4);
+    } else if (3 * dx > dy) {
+      return reconstruct_line (line2, line1, i, 1, 7, 7, 1);
+    } else {
+      return reconstruct_line (line2, line1, i, 4, 8, 4, 0);
+    }
+  }
+}
+
+/* The vector versions of reconstruct_pixel() rely on the choice of the
+ * filter only depending on |dx| against dy, and on the sign of dx for the
+ * direction. The filter is then applied as
+ * a * s3 + b * s2 + c * s1 + d * s0 where sk is the sum of the two samples
+ * k pixels apart from i in that direction. dx == dy == 0 is the plain
+ * average, which is the (0, 0, 0, 16) filter. */
+#if defined (__SSE2__)
+static inline __m128i
+load_u16 (const guint8 * p)
+{
+  return _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) p),
+      _mm_setzero_si128 ());
+}
+
+static inline __m128i
+select_i16 (__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b));
+}
+
+static inline __m128i
+tap_sum (guint8 * line1, guint8 * line2, int i, int k, __m128i left)
+{
+  __m128i s1 = _mm_add_epi16 (load_u16 (line1 + i - k),
+      load_u16 (line2 + i + k));
+  __m128i s2 = _mm_add_epi16 (load_u16 (line2 + i - k),
+      load_u16 (line1 + i + k));
+
+  return select_i16 (left, s1, s2);
+}
+
+static int
+reconstruct_pixels_sse2 (guint8 * dest, guint8 * line1, guint8 * line2,
+    int i, int end)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (; i + 8 <= end; i += 8) {
+    __m128i l1m = load_u16 (line1 + i - 1);
+    __m128i l1 = load_u16 (line1 + i);
+    __m128i l1p = load_u16 (line1 + i + 1);
+    __m128i l2m = load_u16 (line2 + i - 1);
+    __m128i l2 = load_u16 (line2 + i);
+    __m128i l2p = load_u16 (line2 + i + 1);
+    __m128i dx, dy, neg, adx, left, flat, m, a, b, c, d, x;
+
+    dx = _mm_sub_epi16 (_mm_add_epi16 (l1p, l2p), _mm_add_epi16 (l1m, l2m));
+    dx = _mm_add_epi16 (dx, dx);
+    dy = _mm_sub_epi16 (_mm_add_epi16 (_mm_add_epi16 (l2m, l2p),
+            _mm_add_epi16 (l2, l2)), _mm_add_epi16 (_mm_add_epi16 (l1m, l1p),
+            _mm_add_epi16 (l1, l1)));
+    neg = _mm_cmplt_epi16 (dy, zero);
+    dy = _mm_sub_epi16 (_mm_xor_si128 (dy, neg), neg);
+    dx = _mm_sub_epi16 (_mm_xor_si128 (dx, neg), neg);
+    flat = _mm_and_si128 (_mm_cmpeq_epi16 (dx, zero),
+        _mm_cmpeq_epi16 (dy, zero));
+    left = _mm_cmplt_epi16 (dx, zero);
+    adx = _mm_sub_epi16 (_mm_xor_si128 (dx, left), left);
+
+    a = _mm_set1_epi16 (4);
+    b = _mm_set1_epi16 (8);
+    c = _mm_set1_epi16 (4);
+    d = zero;
+    m = _mm_cmpgt_epi16 (_mm_add_epi16 (_mm_add_epi16 (adx, adx), adx), dy);
+    a = select_i16 (m, _mm_set1_epi16 (1), a);
+    b = select_i16 (m, _mm_set1_epi16 (7), b);
+    c = select_i16 (m, _mm_set1_epi16 (7), c);
+    d = select_i16 (m, _mm_set1_epi16 (1), d);
+    m = _mm_cmpgt_epi16 (_mm_add_epi16 (adx, adx), dy);
+    a = _mm_andnot_si128 (m, a);
+    b = select_i16 (m, _mm_set1_epi16 (4), b);
+    c = select_i16 (m, _mm_set1_epi16 (8), c);
+    d = select_i16 (m, _mm_set1_epi16 (4), d);
+    m = _mm_cmpgt_epi16 (adx, dy);
+    b = _mm_andnot_si128 (m, b);
+    d = select_i16 (m, _mm_set1_epi16 (8), d);
+    m = _mm_or_si128 (_mm_cmpgt_epi16 (adx, _mm_add_epi16 (dy, dy)), flat);
+    a = _mm_andnot_si128 (m, a);
+    b = _mm_andnot_si128 (m, b);
+    c = _mm_andnot_si128 (m, c);
+    d = select_i16 (m, _mm_set1_epi16 (16), d);
+
+    x = _mm_mullo_epi16 (d, _mm_add_epi16 (l1, l2));
+    x = _mm_add_epi16 (x, _mm_mullo_epi16 (c,
+            select_i16 (left, _mm_add_epi16 (l1m, l2p),
+                _mm_add_epi16 (l2m, l1p))));
+    x = _mm_add_epi16 (x, _mm_mullo_epi16 (b,
+            tap_sum (line1, line2, i, 2, left)));
+    x = _mm_add_epi16 (x, _mm_mullo_epi16 (a,
+            tap_sum (line1, line2, i, 3, left)));
+    x = _mm_srli_epi16 (_mm_add_epi16 (x, _mm_set1_epi16 (16)), 5);
+
+    _mm_storel_epi64 ((__m128i *) (dest + i), _mm_packus_epi16 (x, x));
+  }
+
+  return i;
+}
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+static inline int16x8_t
+load_s16 (const guint8 * p)
+{
+  return vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (p)));
+}
+
+static inline int16x8_t
+tap_sum (guint8 * line1, guint8 * line2, int i, int k, uint16x8_t left)
+{
+  int16x8_t s1 = vaddq_s16 (load_s16 (line1 + i - k), load_s16 (line2 + i + k));
+  int16x8_t s2 = vaddq_s16 (load_s16 (line2 + i - k), load_s16 (line1 + i + k));
+
+  return vbslq_s16 (left, s1, s2);
+}
+
+static int
+reconstruct_pixels_neon (guint8 * dest, guint8 * line1, guint8 * line2,
+    int i, int end)
+{
+  const int16x8_t zero = vdupq_n_s16 (0);
+
+  for (; i + 8 <= end; i += 8) {
+    int16x8_t l1m = load_s16 (line1 + i - 1);
+    int16x8_t l1 = load_s16 (line1 + i);
+    int16x8_t l1p = load_s16 (line1 + i + 1);
+    int16x8_t l2m = load_s16 (line2 + i - 1);
+    int16x8_t l2 = load_s16 (line2 + i);
+    int16x8_t l2p = load_s16 (line2 + i + 1);
+    int16x8_t dx, dy, adx, a, b, c, d, x;
+    uint16x8_t neg, left, flat, m;
+
+    dx = vsubq_s16 (vaddq_s16 (l1p, l2p), vaddq_s16 (l1m, l2m));
+    dx = vaddq_s16 (dx, dx);
+    dy = vsubq_s16 (vaddq_s16 (vaddq_s16 (l2m, l2p), vaddq_s16 (l2, l2)),
+        vaddq_s16 (vaddq_s16 (l1m, l1p), vaddq_s16 (l1, l1)));
+    neg = vcltq_s16 (dy, zero);
+    dy = vabsq_s16 (dy);
+    dx = vbslq_s16 (neg, vnegq_s16 (dx), dx);
+    flat = vandq_u16 (vceqq_s16 (dx, zero), vceqq_s16 (dy, zero));
+    left = vcltq_s16 (dx, zero);
+    adx = vabsq_s16 (dx);
+
+    a = vdupq_n_s16 (4);
+    b = vdupq_n_s16 (8);
+    c = vdupq_n_s16 (4);
+    d = zero;
+    m = vcgtq_s16 (vaddq_s16 (vaddq_s16 (adx, adx), adx), dy);
+    a = vbslq_s16 (m, vdupq_n_s16 (1), a);
+    b = vbslq_s16 (m, vdupq_n_s16 (7), b);
+    c = vbslq_s16 (m, vdupq_n_s16 (7), c);
+    d = vbslq_s16 (m, vdupq_n_s16 (1), d);
+    m = vcgtq_s16 (vaddq_s16 (adx, adx), dy);
+    a = vbslq_s16 (m, zero, a);
+    b = vbslq_s16 (m, vdupq_n_s16 (4), b);
+    c = vbslq_s16 (m, vdupq_n_s16 (8), c);
+    d = vbslq_s16 (m, vdupq_n_s16 (4), d);
+    m = vcgtq_s16 (adx, dy);
+    b = vbslq_s16 (m, zero, b);
+    d = vbslq_s16 (m, vdupq_n_s16 (8), d);
+    m = vorrq_u16 (vcgtq_s16 (adx, vaddq_s16 (dy, dy)), flat);
+    a = vbslq_s16 (m, zero, a);
+    b = vbslq_s16 (m, zero, b);
+    c = vbslq_s16 (m, zero, c);
+    d = vbslq_s16 (m, vdupq_n_s16 (16), d);
+
+    x = vmulq_s16 (d, vaddq_s16 (l1, l2));
+    x = vmlaq_s16 (x, c, vbslq_s16 (left, vaddq_s16 (l1m, l2p),
+            vaddq_s16 (l2m, l1p)));
+    x = vmlaq_s16 (x, b, tap_sum (line1, line2, i, 2, left));
+    x = vmlaq_s16 (x, a, tap_sum (line1, line2, i, 3, left));
+
+    vst1_u8 (dest + i, vqrshrun_n_s16 (x, 5));
+  }
+
+  return i;
+}
+#endif
+
+/* averages line1 and line2 into dest from i to end */
+void
+gst_ivtc_reconstruct_average (guint8 * dest, guint8 * line1, guint8 * line2,
+    int i, int end)
+{
+#if defined (__SSE2__)
+  for (; i + 16 <= end; i += 16) {
+    _mm_storeu_si128 ((__m128i *) (dest + i),
+        _mm_avg_epu8 (_mm_loadu_si128 ((__m128i *) (line1 + i)),
+            _mm_loadu_si128 ((__m128i *) (line2 + i))));
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  for (; i + 16 <= end; i += 16) {
+    vst1q_u8 (dest + i, vrhaddq_u8 (vld1q_u8 (line1 + i),
+            vld1q_u8 (line2 + i)));
+  }
+#endif
+  for (; i < end; i++) {
+    dest[i] = (line1[i] + line2[i] + 1) >> 1;
+  }
+}
+
+#define MARGIN 3
+/* interpolates the line between line1 and line2 along the edges, the
+ * MARGIN samples at both ends are averaged */
+void
+gst_ivtc_reconstruct_interpolate (guint8 * dest, guint8 * line1,
+    guint8 * line2, int width)
+{
+  int i = MARGIN;
+
+  if (width <= 2 * MARGIN) {
+    gst_ivtc_reconstruct_average (dest, line1, line2, 0, width);
+    return;
+  }
+
+#if defined (__SSE2__)
+  i = reconstruct_pixels_sse2 (dest, line1, line2, i, width - MARGIN);
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  i = reconstruct_pixels_neon (dest, line1, line2, i, width - MARGIN);
+#endif
+  for (; i < width - MARGIN; i++) {
+    dest[i] = reconstruct_pixel (line1, line2, i);
+  }
+
+  gst_ivtc_reconstruct_average (dest, line1, line2, 0, MARGIN);
+  gst_ivtc_reconstruct_average (dest, line1, line2, width - MARGIN, width);
+}
@@ -0,0 +1,46 @@
+/* GStreamer
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_IVTC_UTILS_H_
+#define _GST_IVTC_UTILS_H_
+
+#include <gst/gst.h>
+#include <gst/stripe-threads-private.h>
+
+G_BEGIN_DECLS
+
+/* values of the comb mask samples */
+#define GST_IVTC_COMB_NONE 0x00
+#define GST_IVTC_COMB_MARKED 0x01
+#define GST_IVTC_COMB_COMBED 0xff
+
+/* rows per stripe below which a frame is not split further */
+#define GST_IVTC_STRIPE_MIN_ROWS 16
+
+gboolean gst_ivtc_comb_mask_line (guint8 * mask, const guint8 * src1,
+    const guint8 * src2, const guint8 * src3, int width);
+int gst_ivtc_comb_score_line (int *thisline, guint8 * mask, int width);
+void gst_ivtc_reconstruct_average (guint8 * dest, guint8 * line1,
+    guint8 * line2, int i, int end);
+void gst_ivtc_reconstruct_interpolate (guint8 * dest, guint8 * line1,
+    guint8 * line2, int width);
+
+G_END_DECLS
+
+#endif
@@ -178,7 +178,7 @@ gst_jp2k_decimator_decimate_jpc (GstJP2kDecimator * self, GstBuffer * inbuf,
   GstFlowReturn ret = GST_FLOW_OK;
   GstMapInfo info;
   GstByteReader reader;
-  GstByteWriter writer;
+  CodestreamWriter writer;
   MainHeader main_header;
 
 
@@ -190,7 +190,7 @@ gst_jp2k_decimator_decimate_jpc (GstJP2kDecimator * self, GstBuffer * inbuf,
   }
 
   gst_byte_reader_init (&reader, info.data, info.size);
-  gst_byte_writer_init_with_size (&writer, gst_buffer_get_size (inbuf), FALSE);
+  init_codestream_writer (&writer, inbuf, info.data);
 
   /* main header */
   memset (&main_header, 0, sizeof (MainHeader));
@@ -206,7 +206,7 @@ gst_jp2k_decimator_decimate_jpc (GstJP2kDecimator * self, GstBuffer * inbuf,
   if (ret != GST_FLOW_OK)
     goto done;
 
-  outbuf = gst_byte_writer_reset_and_get_buffer (&writer);
+  outbuf = finish_codestream_writer (&writer);
   gst_buffer_copy_into (outbuf, inbuf, GST_BUFFER_COPY_METADATA, 0, -1);
 
   GST_DEBUG_OBJECT (self,
@@ -220,6 +220,7 @@ done:
   gst_buffer_unmap (inbuf, &info);
 
   *outbuf_ = outbuf;
+  reset_codestream_writer (&writer);
   reset_main_header (self, &main_header);
   gst_buffer_unref (inbuf);
 
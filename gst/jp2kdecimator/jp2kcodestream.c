@@ -59,6 +59,10 @@ GST_DEBUG_CATEGORY_EXTERN (gst_jp2k_decimator_debug);
 #define MARKER_CRG 0xFF63
 #define MARKER_COM 0xFF64
 
+/* Runs of retained data shorter than this are copied instead of being
+ * referenced from the input */
+#define MIN_REFERENCE_SIZE 1024
+
 static void
 packet_iterator_changed_resolution_or_component (PacketIterator * it)
 {
@@ -838,6 +842,37 @@ write_plt (GstJP2kDecimator * self, GstByteWriter * writer,
   return GST_FLOW_OK;
 }
 
+static gboolean
+packet_is_dropped (GstJP2kDecimator * self, const PacketIterator * it)
+{
+  return (self->max_layers != 0 && it->cur_layer >= self->max_layers) ||
+      (self->max_decomposition_levels != -1
+      && it->cur_resolution > self->max_decomposition_levels);
+}
+
+/* If layers or resolutions are the outermost loop of the progression
+ * order, all packets after the first dropped one are dropped too */
+static gboolean
+remaining_packets_dropped (GstJP2kDecimator * self, const MainHeader * header,
+    const Tile * tile, const PacketIterator * it)
+{
+  ProgressionOrder order;
+
+  order = (tile->cod) ? tile->cod->progression_order :
+      header->cod.progression_order;
+
+  switch (order) {
+    case PROGRESSION_ORDER_LRCP:
+      return self->max_layers != 0 && it->cur_layer >= self->max_layers;
+    case PROGRESSION_ORDER_RLCP:
+    case PROGRESSION_ORDER_RPCL:
+      return self->max_decomposition_levels != -1
+          && it->cur_resolution > self->max_decomposition_levels;
+    default:
+      return FALSE;
+  }
+}
+
 static GstFlowReturn
 parse_packet (GstJP2kDecimator * self, GstByteReader * reader,
     const MainHeader * header, Tile * tile, const PacketIterator * it)
@@ -1003,7 +1038,7 @@ sizeof_packet (GstJP2kDecimator * self, const Packet * packet)
 
 static GstFlowReturn
 parse_packets (GstJP2kDecimator * self, GstByteReader * reader,
-    const MainHeader * header, Tile * tile)
+    const MainHeader * header, Tile * tile, guint tile_end)
 {
   guint16 marker = 0;
   GstFlowReturn ret = GST_FLOW_OK;
@@ -1021,6 +1056,33 @@ parse_packets (GstJP2kDecimator * self, GstByteReader * reader,
     goto done;
 
   while ((it.next (&it))) {
+    /* Packets that are all going to be dropped are only counted, and the
+     * rest of the tile part is skipped */
+    if (tile_end != 0 && remaining_packets_dropped (self, header, tile, &it)) {
+      gboolean sop = (tile->cod) ? tile->cod->sop : header->cod.sop;
+      gboolean eph = (tile->cod) ? tile->cod->eph : header->cod.eph;
+
+      GST_LOG_OBJECT (self, "Skipping packets from packet %d", it.cur_packet);
+
+      do {
+        Packet *p = g_slice_new0 (Packet);
+
+        p->sop = sop;
+        p->eph = eph;
+        p->seqno = it.cur_packet;
+        p->length = 1;
+        tile->packets = g_list_prepend (tile->packets, p);
+      } while ((it.next (&it)));
+
+      if (tile_end < gst_byte_reader_get_pos (reader)
+          || !gst_byte_reader_set_pos (reader, tile_end)) {
+        GST_ERROR_OBJECT (self, "Truncated tile part");
+        ret = GST_FLOW_ERROR;
+        goto done;
+      }
+      break;
+    }
+
     ret = parse_packet (self, reader, header, tile, &it);
     if (ret != GST_FLOW_OK)
       goto done;
@@ -1039,6 +1101,7 @@ parse_tile (GstJP2kDecimator * self, GstByteReader * reader,
 {
   GstFlowReturn ret = GST_FLOW_OK;
   guint16 marker = 0, length;
+  guint tile_start, tile_end = 0;
 
   if (!gst_byte_reader_peek_uint16_be (reader, &marker)) {
     GST_ERROR_OBJECT (self, "Could not read marker");
@@ -1046,6 +1109,8 @@ parse_tile (GstJP2kDecimator * self, GstByteReader * reader,
     goto done;
   }
 
+  tile_start = gst_byte_reader_get_pos (reader);
+
   if (marker != MARKER_SOT) {
     GST_ERROR_OBJECT (self, "Unexpected marker 0x%04x", marker);
     ret = GST_FLOW_ERROR;
@@ -1081,6 +1146,10 @@ parse_tile (GstJP2kDecimator * self, GstByteReader * reader,
     goto done;
   }
 
+  /* A length of 0 means the tile part goes until EOC */
+  if (tile->sot.tile_part_size != 0)
+    tile_end = tile_start + tile->sot.tile_part_size;
+
   tile->tile_x = tile->sot.tile_index % header->n_tiles_x;
   tile->tile_y = tile->sot.tile_index / header->n_tiles_x;
 
@@ -1210,7 +1279,7 @@ parse_tile (GstJP2kDecimator * self, GstByteReader * reader,
     }
   }
 
-  ret = parse_packets (self, reader, header, tile);
+  ret = parse_packets (self, reader, header, tile, tile_end);
 
 done:
 
@@ -1316,15 +1385,128 @@ write_marker_buffer (GstJP2kDecimator * self, GstByteWriter * writer,
   return GST_FLOW_OK;
 }
 
+/* Appends the written bytes to the output */
+static void
+flush_written_data (CodestreamWriter * cw)
+{
+  if (gst_byte_writer_get_size (&cw->writer) == 0)
+    return;
+
+  cw->output = gst_buffer_append (cw->output,
+      gst_byte_writer_reset_and_get_buffer (&cw->writer));
+  gst_byte_writer_init (&cw->writer);
+}
+
+/* Appends the pending run of input data to the output */
+static void
+flush_referenced_data (CodestreamWriter * cw)
+{
+  GstBuffer *region;
+
+  if (cw->ref_length == 0)
+    return;
+
+  region = NULL;
+  if (cw->ref_length >= MIN_REFERENCE_SIZE)
+    region = gst_buffer_copy_region (cw->input, GST_BUFFER_COPY_MEMORY,
+        cw->ref_data - cw->input_data, cw->ref_length);
+
+  /* Buffers only hold a few memories before merging them, so copy once
+   * there is no room left for this one and the following written data */
+  if (region && gst_buffer_n_memory (cw->output) + gst_buffer_n_memory (region)
+      + 2 <= gst_buffer_get_max_memory ()) {
+    flush_written_data (cw);
+    cw->output = gst_buffer_append (cw->output, region);
+  } else {
+    if (region)
+      gst_buffer_unref (region);
+    gst_byte_writer_put_data (&cw->writer, cw->ref_data, cw->ref_length);
+  }
+
+  cw->ref_length = 0;
+}
+
+/* Returns the writer for rewritten data, after any pending input data */
+static GstByteWriter *
+get_byte_writer (CodestreamWriter * cw)
+{
+  flush_referenced_data (cw);
+
+  return &cw->writer;
+}
+
+static void
+reference_data (CodestreamWriter * cw, const guint8 * data, guint length)
+{
+  if (cw->ref_length > 0 && cw->ref_data + cw->ref_length == data) {
+    cw->ref_length += length;
+    return;
+  }
+
+  flush_referenced_data (cw);
+  cw->ref_data = data;
+  cw->ref_length = length;
+}
+
+void
+init_codestream_writer (CodestreamWriter * cw, GstBuffer * input,
+    const guint8 * input_data)
+{
+  memset (cw, 0, sizeof (CodestreamWriter));
+
+  cw->input = input;
+  cw->input_data = input_data;
+  cw->output = gst_buffer_new ();
+  gst_byte_writer_init (&cw->writer);
+}
+
+GstBuffer *
+finish_codestream_writer (CodestreamWriter * cw)
+{
+  GstBuffer *output;
+
+  flush_referenced_data (cw);
+  flush_written_data (cw);
+
+  output = cw->output;
+  cw->output = NULL;
+
+  return output;
+}
+
+void
+reset_codestream_writer (CodestreamWriter * cw)
+{
+  gst_byte_writer_reset (&cw->writer);
+  if (cw->output)
+    gst_buffer_unref (cw->output);
+
+  memset (cw, 0, sizeof (CodestreamWriter));
+}
+
 static GstFlowReturn
-write_packet (GstJP2kDecimator * self, GstByteWriter * writer,
+write_packet (GstJP2kDecimator * self, CodestreamWriter * cw,
     const Packet * packet)
 {
+  GstByteWriter *writer;
   guint size = packet->length;
 
+  /* Retained packets are referenced together with their SOP marker
+   * segment, which precedes them unchanged in the input */
+  if (packet->data) {
+    if (packet->sop)
+      reference_data (cw, packet->data - 6, packet->length + 6);
+    else
+      reference_data (cw, packet->data, packet->length);
+
+    return GST_FLOW_OK;
+  }
+
+  writer = get_byte_writer (cw);
+
   if (packet->sop)
     size += 6;
-  if (packet->eph && !packet->data)
+  if (packet->eph)
     size += 2;
 
   if (!gst_byte_writer_ensure_free_space (writer, size)) {
@@ -1338,22 +1520,20 @@ write_packet (GstJP2kDecimator * self, GstByteWriter * writer,
     gst_byte_writer_put_uint16_be_unchecked (writer, packet->seqno);
   }
 
-  if (packet->data) {
-    gst_byte_writer_put_data_unchecked (writer, packet->data, packet->length);
-  } else {
-    gst_byte_writer_put_uint8_unchecked (writer, 0);
-    if (packet->eph) {
-      gst_byte_writer_put_uint16_be_unchecked (writer, MARKER_EPH);
-    }
+  /* Empty packet */
+  gst_byte_writer_put_uint8_unchecked (writer, 0);
+  if (packet->eph) {
+    gst_byte_writer_put_uint16_be_unchecked (writer, MARKER_EPH);
   }
 
   return GST_FLOW_OK;
 }
 
 static GstFlowReturn
-write_tile (GstJP2kDecimator * self, GstByteWriter * writer,
+write_tile (GstJP2kDecimator * self, CodestreamWriter * cw,
     const MainHeader * header, Tile * tile)
 {
+  GstByteWriter *writer = get_byte_writer (cw);
   GList *l;
   GstFlowReturn ret = GST_FLOW_OK;
 
@@ -1415,7 +1595,7 @@ write_tile (GstJP2kDecimator * self, GstByteWriter * writer,
   for (l = tile->packets; l; l = l->next) {
     Packet *p = l->data;
 
-    ret = write_packet (self, writer, p);
+    ret = write_packet (self, cw, p);
     if (ret != GST_FLOW_OK)
       goto done;
   }
@@ -1683,9 +1863,10 @@ reset_main_header (GstJP2kDecimator * self, MainHeader * header)
 }
 
 GstFlowReturn
-write_main_header (GstJP2kDecimator * self, GstByteWriter * writer,
+write_main_header (GstJP2kDecimator * self, CodestreamWriter * cw,
     const MainHeader * header)
 {
+  GstByteWriter *writer = get_byte_writer (cw);
   GstFlowReturn ret = GST_FLOW_OK;
   GList *l;
   gint i;
@@ -1734,11 +1915,12 @@ write_main_header (GstJP2kDecimator * self, GstByteWriter * writer,
   }
 
   for (i = 0; i < header->n_tiles; i++) {
-    ret = write_tile (self, writer, header, &header->tiles[i]);
+    ret = write_tile (self, cw, header, &header->tiles[i]);
     if (ret != GST_FLOW_OK)
       goto done;
   }
 
+  writer = get_byte_writer (cw);
   if (!gst_byte_writer_ensure_free_space (writer, 2)) {
     GST_ERROR_OBJECT (self, "Could not ensure free space");
     ret = GST_FLOW_ERROR;
@@ -1782,16 +1964,16 @@ decimate_main_header (GstJP2kDecimator * self, MainHeader * header)
       if (l == NULL) {
         GST_ERROR_OBJECT (self, "Not enough packets");
         ret = GST_FLOW_ERROR;
-        g_array_free (plt->packet_lengths, TRUE);
-        g_slice_free (PacketLengthTilePart, plt);
+        if (plt) {
+          g_array_free (plt->packet_lengths, TRUE);
+          g_slice_free (PacketLengthTilePart, plt);
+        }
         goto done;
       }
 
       p = l->data;
 
-      if ((self->max_layers != 0 && it.cur_layer >= self->max_layers) ||
-          (self->max_decomposition_levels != -1
-              && it.cur_resolution > self->max_decomposition_levels)) {
+      if (packet_is_dropped (self, &it)) {
         p->data = NULL;
         p->length = 1;
       }
@@ -150,6 +150,21 @@ typedef struct
   Tile *tiles;
 } MainHeader;
 
+/* Output codestream: rewritten marker segments are written to the writer
+ * while retained packet data is referenced from the input buffer */
+typedef struct
+{
+  GstBuffer *input;
+  const guint8 *input_data;     /* mapped data of the input */
+
+  GstBuffer *output;
+  GstByteWriter writer;
+
+  /* run of input data to reference next */
+  const guint8 *ref_data;
+  guint ref_length;
+} CodestreamWriter;
+
 typedef struct _PacketIterator PacketIterator;
 struct _PacketIterator
 {
@@ -187,7 +202,11 @@ struct _PacketIterator
 GstFlowReturn parse_main_header (GstJP2kDecimator * self, GstByteReader * reader, MainHeader * header);
 guint sizeof_main_header (GstJP2kDecimator * self, const MainHeader * header);
 void reset_main_header (GstJP2kDecimator * self, MainHeader * header);
-GstFlowReturn write_main_header (GstJP2kDecimator * self, GstByteWriter * writer, const MainHeader * header);
+GstFlowReturn write_main_header (GstJP2kDecimator * self, CodestreamWriter * cw, const MainHeader * header);
 GstFlowReturn decimate_main_header (GstJP2kDecimator * self, MainHeader * header);
 
+void init_codestream_writer (CodestreamWriter * cw, GstBuffer * input, const guint8 * input_data);
+GstBuffer * finish_codestream_writer (CodestreamWriter * cw);
+void reset_codestream_writer (CodestreamWriter * cw);
+
 #endif /* __JP2K_CODESTREAM_H__ */
@@ -38,6 +38,10 @@
  * The above pipeline fetches a motion JPEG stream from an IP camera over
  * HTTP and stores it in a matroska file.
  *
+ * When #GstJpegParse:restart-meta is enabled, the images that use restart
+ * intervals get a #GstJpegRestartMeta listing where each of the intervals
+ * of their scans is, so that decoders can decode them in parallel.
+ *
  */
 /* FIXME: output plain JFIF APP marker only. This provides best code reuse.
  * JPEG decoders would not need to handle this part anymore. Also when remuxing
@@ -51,6 +55,7 @@
 #include <string.h>
 #include <gst/base/gstbytereader.h>
 #include <gst/tag/tag.h>
+#include <gst/codecparsers/gstjpegmeta.h>
 
 #include "gstjpegparse.h"
 
@@ -75,6 +80,14 @@ GST_STATIC_PAD_TEMPLATE ("sink",
 GST_DEBUG_CATEGORY_STATIC (jpeg_parse_debug);
 #define GST_CAT_DEFAULT jpeg_parse_debug
 
+#define DEFAULT_RESTART_META FALSE
+
+enum
+{
+  PROP_0,
+  PROP_RESTART_META
+};
+
 struct _GstJpegParsePrivate
 {
   guint last_offset;
@@ -107,8 +120,19 @@ struct _GstJpegParsePrivate
 
   /* tags */
   GstTagList *tags;
+
+  /* properties */
+  gboolean restart_meta;
+
+  /* scratch array for the restart intervals of the current image */
+  GArray *restart_intervals;
 };
 
+static void gst_jpeg_parse_finalize (GObject * object);
+static void gst_jpeg_parse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_jpeg_parse_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 static GstFlowReturn
 gst_jpeg_parse_handle_frame (GstBaseParse * bparse, GstBaseParseFrame * frame,
     gint * skipsize);
@@ -137,6 +161,25 @@ gst_jpeg_parse_class_init (GstJpegParseClass * klass)
 
   g_type_class_add_private (gobject_class, sizeof (GstJpegParsePrivate));
 
+  gobject_class->finalize = gst_jpeg_parse_finalize;
+  gobject_class->set_property = gst_jpeg_parse_set_property;
+  gobject_class->get_property = gst_jpeg_parse_get_property;
+
+  /**
+   * GstJpegParse:restart-meta:
+   *
+   * Attach a #GstJpegRestartMeta to the images that use restart intervals,
+   * giving the location of the independently decodable intervals of each
+   * scan.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_RESTART_META,
+      g_param_spec_boolean ("restart-meta", "Restart meta",
+          "Attach the location of the restart intervals of each scan to the "
+          "output buffers", DEFAULT_RESTART_META,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstbaseparse_class->start = gst_jpeg_parse_start;
   gstbaseparse_class->stop = gst_jpeg_parse_stop;
   gstbaseparse_class->set_sink_caps = gst_jpeg_parse_set_sink_caps;
@@ -165,6 +208,51 @@ gst_jpeg_parse_init (GstJpegParse * parse)
       GstJpegParsePrivate);
 
   parse->priv->next_ts = GST_CLOCK_TIME_NONE;
+  parse->priv->restart_meta = DEFAULT_RESTART_META;
+  parse->priv->restart_intervals =
+      g_array_new (FALSE, FALSE, sizeof (GstJpegRestartInterval));
+}
+
+static void
+gst_jpeg_parse_finalize (GObject * object)
+{
+  GstJpegParse *parse = GST_JPEG_PARSE_CAST (object);
+
+  g_array_free (parse->priv->restart_intervals, TRUE);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_jpeg_parse_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstJpegParse *parse = GST_JPEG_PARSE_CAST (object);
+
+  switch (prop_id) {
+    case PROP_RESTART_META:
+      parse->priv->restart_meta = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_jpeg_parse_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstJpegParse *parse = GST_JPEG_PARSE_CAST (object);
+
+  switch (prop_id) {
+    case PROP_RESTART_META:
+      g_value_set_boolean (value, parse->priv->restart_meta);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
 }
 
 static gboolean
@@ -229,6 +317,79 @@ gst_jpeg_parse_parse_tag_has_entropy_segment (guint8 tag)
   return FALSE;
 }
 
+/* Whether 0xff followed by byte ends an entropy-coded segment, i.e. it is
+ * neither a stuffed 0xff nor a restart marker */
+static inline gboolean
+gst_jpeg_parse_is_entropy_end (guint8 byte)
+{
+  return byte != 0x00 && (byte < RST0 || byte > RST7);
+}
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/* Scans entropy-coded data for the marker that ends it, skipping stuffed
+ * 0xff 0x00 and restart markers. Like gst_byte_reader_masked_scan_uint32()
+ * with a 0x0000ff00 mask, the returned offset is 2 bytes before the 0xff
+ * and the scan starts at offset; returns -1 if no such marker is found in
+ * the first size bytes. */
+static gint
+gst_jpeg_parse_scan_entropy_segment (const guint8 * data, guint size,
+    guint offset)
+{
+  guint i = offset + 2;
+
+#if defined (__SSE2__)
+  {
+    const __m128i ff = _mm_set1_epi8 ((gchar) 0xff);
+
+    /* 16 candidates per block, the last one needs 1 more byte */
+    for (; i + 16 + 1 <= size; i += 16) {
+      gint mask =
+          _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i
+                      *) (data + i)), ff));
+
+      while (mask) {
+        guint pos = i + __builtin_ctz (mask);
+
+        if (gst_jpeg_parse_is_entropy_end (data[pos + 1]))
+          return pos - 2;
+        mask &= mask - 1;
+      }
+    }
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  {
+    const uint8x16_t ff = vdupq_n_u8 (0xff);
+
+    for (; i + 16 + 1 <= size; i += 16) {
+      uint64x2_t m64 =
+          vreinterpretq_u64_u8 (vceqq_u8 (vld1q_u8 (data + i), ff));
+      guint j;
+
+      if (!(vgetq_lane_u64 (m64, 0) | vgetq_lane_u64 (m64, 1)))
+        continue;
+
+      /* No movemask on NEON, check the block in the scalar way */
+      for (j = i; j < i + 16; j++) {
+        if (data[j] == 0xff && gst_jpeg_parse_is_entropy_end (data[j + 1]))
+          return j - 2;
+      }
+    }
+  }
+#endif
+
+  for (; i + 1 < size; i++) {
+    if (data[i] == 0xff && gst_jpeg_parse_is_entropy_end (data[i + 1]))
+      return i - 2;
+  }
+
+  return -1;
+}
+
 /* returns image length in bytes if parsed successfully,
  * otherwise 0 if more data needed,
  * if < 0 the absolute value needs to be flushed */
@@ -329,21 +490,15 @@ gst_jpeg_parse_get_image_length (GstJpegParse * parse, GstMapInfo * mapinfo)
       guint eseglen = parse->priv->last_entropy_len;
 
       GST_DEBUG ("0x%08x: finding entropy segment length", offset + 2);
-      noffset = offset + 2 + frame_len + eseglen;
-      while (1) {
-        noffset = gst_byte_reader_masked_scan_uint32_peek (&reader, 0x0000ff00,
-            0x0000ff00, noffset, size - noffset, &value);
-        if (noffset < 0) {
-          /* need more data */
-          parse->priv->last_entropy_len = size - offset - 4 - frame_len - 2;
-          goto need_more_data;
-        }
-        if ((value & 0xff) != 0x00) {
-          eseglen = noffset - offset - frame_len - 2;
-          break;
-        }
-        noffset++;
+      /* Restart markers are part of the entropy-coded data */
+      noffset = gst_jpeg_parse_scan_entropy_segment (mapinfo->data, size,
+          offset + 2 + frame_len + eseglen);
+      if (noffset < 0) {
+        /* need more data */
+        parse->priv->last_entropy_len = size - offset - 4 - frame_len - 2;
+        goto need_more_data;
       }
+      eseglen = noffset - offset - frame_len - 2;
       parse->priv->last_entropy_len = 0;
       frame_len += eseglen;
       GST_DEBUG ("entropy segment length=%u => frame_len=%u", eseglen,
@@ -758,6 +913,53 @@ gst_jpeg_parse_set_new_caps (GstJpegParse * parse, gboolean header_ok)
 
 }
 
+/* Walks the segments of the image in @buffer and attaches the location of
+ * the restart intervals of its scans, if it has any */
+static void
+gst_jpeg_parse_add_restart_meta (GstJpegParse * parse, GstBuffer * buffer)
+{
+  GArray *intervals = parse->priv->restart_intervals;
+  GstJpegSegment seg;
+  GstMapInfo map;
+  guint offset = 0, scan = 0, restart_interval = 0;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    return;
+
+  g_array_set_size (intervals, 0);
+
+  while (gst_jpeg_parse (&seg, map.data, map.size, offset)) {
+    if (seg.size < 0 || seg.offset + seg.size > map.size)
+      break;
+
+    if (seg.marker == GST_JPEG_MARKER_EOI)
+      break;
+
+    if (seg.marker == GST_JPEG_MARKER_DRI) {
+      if (!gst_jpeg_segment_parse_restart_interval (&seg, &restart_interval))
+        break;
+    } else if (seg.marker == GST_JPEG_MARKER_SOS) {
+      /* continue from the marker that terminates the scan */
+      if (!gst_jpeg_parse_restart_intervals (&seg, map.size, scan++,
+              intervals, &offset))
+        break;
+      continue;
+    }
+
+    offset = seg.offset + seg.size;
+  }
+
+  gst_buffer_unmap (buffer, &map);
+
+  if (restart_interval == 0 || intervals->len == 0)
+    return;
+
+  GST_LOG_OBJECT (parse, "%u restart intervals of %u MCUs in %u scans",
+      intervals->len, restart_interval, scan);
+  gst_buffer_add_jpeg_restart_meta (buffer, restart_interval,
+      (const GstJpegRestartInterval *) intervals->data, intervals->len);
+}
+
 static GstFlowReturn
 gst_jpeg_parse_pre_push_frame (GstBaseParse * bparse, GstBaseParseFrame * frame)
 {
@@ -776,6 +978,9 @@ gst_jpeg_parse_pre_push_frame (GstBaseParse * bparse, GstBaseParseFrame * frame)
 
   GST_BUFFER_DURATION (outbuf) = parse->priv->duration;
 
+  if (parse->priv->restart_meta)
+    gst_jpeg_parse_add_restart_meta (parse, outbuf);
+
   return GST_FLOW_OK;
 }
 
@@ -55,6 +55,9 @@ GST_DEBUG_CATEGORY_STATIC (rfbsrc_debug);
 GST_DEBUG_CATEGORY (rfbdecoder_debug);
 #define GST_CAT_DEFAULT rfbsrc_debug
 
+/* above this many damaged rectangles only their bounding box is attached */
+#define MAX_DAMAGE_RECTS 16
+
 static GstStaticPadTemplate gst_rfb_src_template =
     GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -76,9 +79,8 @@ static gboolean gst_rfb_src_negotiate (GstBaseSrc * bsrc);
 static gboolean gst_rfb_src_stop (GstBaseSrc * bsrc);
 static gboolean gst_rfb_src_event (GstBaseSrc * bsrc, GstEvent * event);
 static gboolean gst_rfb_src_unlock (GstBaseSrc * bsrc);
-static gboolean gst_rfb_src_decide_allocation (GstBaseSrc * bsrc,
-    GstQuery * query);
-static GstFlowReturn gst_rfb_src_fill (GstPushSrc * psrc, GstBuffer * outbuf);
+static GstFlowReturn gst_rfb_src_create (GstPushSrc * psrc,
+    GstBuffer ** outbuf);
 
 #define gst_rfb_src_parent_class parent_class
 G_DEFINE_TYPE (GstRfbSrc, gst_rfb_src, GST_TYPE_PUSH_SRC);
@@ -152,9 +154,7 @@ gst_rfb_src_class_init (GstRfbSrcClass * klass)
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_rfb_src_stop);
   gstbasesrc_class->event = GST_DEBUG_FUNCPTR (gst_rfb_src_event);
   gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_rfb_src_unlock);
-  gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_rfb_src_fill);
-  gstbasesrc_class->decide_allocation =
-      GST_DEBUG_FUNCPTR (gst_rfb_src_decide_allocation);
+  gstpushsrc_class->create = GST_DEBUG_FUNCPTR (gst_rfb_src_create);
 
   gstelement_class = GST_ELEMENT_CLASS (klass);
 
@@ -338,56 +338,6 @@ gst_rfb_src_get_property (GObject * object, guint prop_id,
   }
 }
 
-static gboolean
-gst_rfb_src_decide_allocation (GstBaseSrc * bsrc, GstQuery * query)
-{
-  GstBufferPool *pool = NULL;
-  guint size, min = 1, max = 0;
-  GstStructure *config;
-  GstCaps *caps;
-  GstVideoInfo info;
-  gboolean ret;
-
-  gst_query_parse_allocation (query, &caps, NULL);
-
-  if (!caps || !gst_video_info_from_caps (&info, caps))
-    return FALSE;
-
-  while (gst_query_get_n_allocation_pools (query) > 0) {
-    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
-
-    /* TODO We restrict to the exact size as we don't support strides or
-     * special padding */
-    if (size == info.size)
-      break;
-
-    gst_query_remove_nth_allocation_pool (query, 0);
-    gst_object_unref (pool);
-    pool = NULL;
-  }
-
-  if (pool == NULL) {
-    /* we did not get a pool, make one ourselves then */
-    pool = gst_video_buffer_pool_new ();
-    size = info.size;
-    min = 1;
-    max = 0;
-
-    if (gst_query_get_n_allocation_pools (query) > 0)
-      gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
-    else
-      gst_query_add_allocation_pool (query, pool, size, min, max);
-  }
-
-  config = gst_buffer_pool_get_config (pool);
-  gst_buffer_pool_config_set_params (config, caps, size, min, max);
-
-  ret = gst_buffer_pool_set_config (pool, config);
-  gst_object_unref (pool);
-
-  return ret;
-}
-
 static gboolean
 gst_rfb_src_negotiate (GstBaseSrc * bsrc)
 {
@@ -468,9 +418,10 @@ gst_rfb_src_negotiate (GstBaseSrc * bsrc)
   gst_video_info_set_format (&vinfo, vformat, decoder->rect_width,
       decoder->rect_height);
 
-  decoder->frame = g_malloc (vinfo.size);
-  if (decoder->use_copyrect)
-    decoder->prev_frame = g_malloc (vinfo.size);
+  /* the framebuffer is pushed downstream as is and only copied when an
+   * update arrives while downstream still holds the previous frame */
+  src->frame = gst_allocator_alloc (NULL, vinfo.size, NULL);
+  gst_memory_memset (src->frame, 0, 0, vinfo.size);
 
   caps = gst_video_info_to_caps (&vinfo);
 
@@ -488,58 +439,104 @@ gst_rfb_src_stop (GstBaseSrc * bsrc)
 
   rfb_decoder_disconnect (src->decoder);
 
-  if (src->decoder->frame) {
-    g_free (src->decoder->frame);
-    src->decoder->frame = NULL;
+  if (src->frame) {
+    gst_memory_unref (src->frame);
+    src->frame = NULL;
   }
 
-  if (src->decoder->prev_frame) {
-    g_free (src->decoder->prev_frame);
-    src->decoder->prev_frame = NULL;
+  return TRUE;
+}
+
+static void
+gst_rfb_src_add_damage_meta (GstRfbSrc * src, GstBuffer * buffer)
+{
+  GArray *damage = src->decoder->damage;
+  guint i;
+
+  if (damage->len > MAX_DAMAGE_RECTS) {
+    RfbRectangle *rect = &g_array_index (damage, RfbRectangle, 0);
+    gint x1 = rect->x, y1 = rect->y;
+    gint x2 = rect->x + rect->width, y2 = rect->y + rect->height;
+
+    for (i = 1; i < damage->len; i++) {
+      rect = &g_array_index (damage, RfbRectangle, i);
+      x1 = MIN (x1, rect->x);
+      y1 = MIN (y1, rect->y);
+      x2 = MAX (x2, rect->x + rect->width);
+      y2 = MAX (y2, rect->y + rect->height);
+    }
+
+    gst_buffer_add_video_region_of_interest_meta (buffer, "damage", x1, y1,
+        x2 - x1, y2 - y1);
+    return;
   }
 
-  return TRUE;
+  for (i = 0; i < damage->len; i++) {
+    RfbRectangle *rect = &g_array_index (damage, RfbRectangle, i);
+
+    gst_buffer_add_video_region_of_interest_meta (buffer, "damage", rect->x,
+        rect->y, rect->width, rect->height);
+  }
 }
 
 static GstFlowReturn
-gst_rfb_src_fill (GstPushSrc * psrc, GstBuffer * outbuf)
+gst_rfb_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
   GstRfbSrc *src = GST_RFB_SRC (psrc);
   RfbDecoder *decoder = src->decoder;
   GstMapInfo info;
+  GstBuffer *buffer;
+  gboolean ret = TRUE;
+
+  /* downstream still holds the last frame, continue on a copy of it */
+  if (GST_MINI_OBJECT_REFCOUNT_VALUE (src->frame) > 1) {
+    GstMemory *copy = gst_memory_copy (src->frame, 0, -1);
+
+    gst_memory_unref (src->frame);
+    src->frame = copy;
+  }
+
+  if (!gst_memory_map (src->frame, &info, GST_MAP_READWRITE)) {
+    GST_ELEMENT_ERROR (src, RESOURCE, WRITE,
+        ("Could not map the output frame"), (NULL));
+    return GST_FLOW_ERROR;
+  }
+  decoder->frame = info.data;
 
   rfb_decoder_send_update_request (decoder, src->incremental_update,
       decoder->offset_x, decoder->offset_y, decoder->rect_width,
       decoder->rect_height);
 
   while (decoder->state != NULL) {
-    if (!rfb_decoder_iterate (decoder)) {
-      if (decoder->error != NULL) {
-        GST_ELEMENT_ERROR (src, RESOURCE, READ,
-            ("Error on VNC connection to host %s on port %d: %s",
-                src->host, src->port, decoder->error->message), (NULL));
-      } else {
-        GST_ELEMENT_ERROR (src, RESOURCE, READ,
-            ("Error on setup VNC connection to host %s on port %d", src->host,
-                src->port), (NULL));
-      }
-      return GST_FLOW_ERROR;
-    }
+    if (!(ret = rfb_decoder_iterate (decoder)))
+      break;
   }
 
-  if (!gst_buffer_map (outbuf, &info, GST_MAP_WRITE)) {
-    GST_ELEMENT_ERROR (src, RESOURCE, WRITE,
-        ("Could not map the output frame"), (NULL));
+  decoder->frame = NULL;
+  gst_memory_unmap (src->frame, &info);
+
+  if (!ret) {
+    if (decoder->error != NULL) {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ,
+          ("Error on VNC connection to host %s on port %d: %s",
+              src->host, src->port, decoder->error->message), (NULL));
+    } else {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ,
+          ("Error on setup VNC connection to host %s on port %d", src->host,
+              src->port), (NULL));
+    }
     return GST_FLOW_ERROR;
   }
 
-  memcpy (info.data, decoder->frame, info.size);
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, gst_memory_ref (src->frame));
+  gst_rfb_src_add_damage_meta (src, buffer);
 
-  GST_BUFFER_PTS (outbuf) =
+  GST_BUFFER_PTS (buffer) =
       gst_clock_get_time (GST_ELEMENT_CLOCK (src)) -
       GST_ELEMENT_CAST (src)->base_time;
 
-  gst_buffer_unmap (outbuf, &info);
+  *outbuf = buffer;
 
   return GST_FLOW_OK;
 }
@@ -55,6 +55,7 @@ struct _GstRfbSrc
   gint port;
 
   RfbDecoder *decoder;
+  GstMemory *frame;
   gboolean go;
   gboolean incremental_update;
   gboolean view_only;
@@ -45,6 +45,12 @@ static gboolean rfb_decoder_corre_encoding (RfbDecoder * decoder, gint start_x,
     gint start_y, gint rect_w, gint rect_h);
 static gboolean rfb_decoder_hextile_encoding (RfbDecoder * decoder,
     gint start_x, gint start_y, gint rect_w, gint rect_h);
+#ifdef HAVE_ZLIB
+static gboolean rfb_decoder_zrle_encoding (RfbDecoder * decoder, gint start_x,
+    gint start_y, gint rect_w, gint rect_h);
+static gboolean rfb_decoder_tight_encoding (RfbDecoder * decoder,
+    gint start_x, gint start_y, gint rect_w, gint rect_h);
+#endif
 
 RfbDecoder *
 rfb_decoder_new (void)
@@ -67,6 +73,7 @@ rfb_decoder_new (void)
   decoder->data = NULL;
   decoder->data_len = 0;
   decoder->error = NULL;
+  decoder->damage = g_array_new (FALSE, FALSE, sizeof (RfbRectangle));
 
   g_mutex_init (&decoder->write_lock);
 
@@ -82,6 +89,7 @@ rfb_decoder_free (RfbDecoder * decoder)
 
   g_clear_object (&decoder->socket_client);
   g_clear_object (&decoder->cancellable);
+  g_array_free (decoder->damage, TRUE);
   g_mutex_clear (&decoder->write_lock);
   g_free (decoder);
 }
@@ -145,6 +153,26 @@ rfb_decoder_disconnect (RfbDecoder * decoder)
   g_clear_object (&decoder->connection);
   g_clear_error (&decoder->error);
   g_clear_pointer (&decoder->data, g_free);
+  decoder->data_len = 0;
+
+#ifdef HAVE_ZLIB
+  {
+    gint i;
+
+    if (decoder->zrle_stream_inited) {
+      inflateEnd (&decoder->zrle_stream);
+      decoder->zrle_stream_inited = FALSE;
+    }
+    for (i = 0; i < G_N_ELEMENTS (decoder->tight_streams); i++) {
+      if (decoder->tight_streams_inited[i]) {
+        inflateEnd (&decoder->tight_streams[i]);
+        decoder->tight_streams_inited[i] = FALSE;
+      }
+    }
+    g_clear_pointer (&decoder->zlib_data, g_free);
+    decoder->zlib_data_len = 0;
+  }
+#endif
 
   g_mutex_unlock (&decoder->write_lock);
 }
@@ -292,12 +320,6 @@ rfb_decoder_send_update_request (RfbDecoder * decoder,
 
   rfb_decoder_send (decoder, data, 10);
 
-  /* create a backup of the prev frame for copyrect encoding */
-  if (decoder->use_copyrect) {
-    memcpy (decoder->prev_frame, decoder->frame,
-        decoder->rect_width * decoder->rect_height * decoder->bpp / 8);
-  }
-
   decoder->state = rfb_decoder_state_normal;
 }
 
@@ -608,6 +630,12 @@ rfb_decoder_state_set_encodings (RfbDecoder * decoder)
 
   GST_DEBUG ("entered set encodings");
 
+#ifdef HAVE_ZLIB
+  encoder_list =
+      g_slist_append (encoder_list, GUINT_TO_POINTER (ENCODING_TYPE_ZRLE));
+  encoder_list =
+      g_slist_append (encoder_list, GUINT_TO_POINTER (ENCODING_TYPE_TIGHT));
+#endif
   encoder_list =
       g_slist_append (encoder_list, GUINT_TO_POINTER (ENCODING_TYPE_HEXTILE));
   encoder_list =
@@ -689,6 +717,29 @@ rfb_decoder_state_wait_for_server_initialisation (RfbDecoder * decoder)
   GST_DEBUG ("green_shift= %d", decoder->green_shift);
   GST_DEBUG ("blue_shift = %d", decoder->blue_shift);
 
+  /* ZRLE sends 32 bit pixels as 3 bytes if all colour bits fit into
+   * either the 3 least or the 3 most significant bytes */
+  decoder->cpixel_size = decoder->bpp / 8;
+  decoder->cpixel_offset = 0;
+  if (decoder->bpp == 32 && decoder->depth <= 24 && decoder->true_colour) {
+    guint32 mask = (decoder->red_max << decoder->red_shift) |
+        (decoder->green_max << decoder->green_shift) |
+        (decoder->blue_max << decoder->blue_shift);
+
+    if ((mask & 0xff000000) == 0) {
+      decoder->cpixel_size = 3;
+      decoder->cpixel_offset = decoder->big_endian ? 1 : 0;
+    } else if ((mask & 0x000000ff) == 0) {
+      decoder->cpixel_size = 3;
+      decoder->cpixel_offset = decoder->big_endian ? 0 : 1;
+    }
+  }
+
+  /* and Tight as red, green and blue bytes for 8 bit components */
+  decoder->tpixel_rgb24 = decoder->bpp == 32 && decoder->depth == 24 &&
+      decoder->true_colour && decoder->red_max == 0xff &&
+      decoder->green_max == 0xff && decoder->blue_max == 0xff;
+
   name_length = RFB_GET_UINT32 (decoder->data + 20);
 
   if (!rfb_decoder_read (decoder, name_length))
@@ -786,6 +837,8 @@ rfb_decoder_state_framebuffer_update (RfbDecoder * decoder)
   decoder->n_rects = RFB_GET_UINT16 (decoder->data + 1);
   GST_DEBUG ("Number of rectangles : %d", decoder->n_rects);
 
+  g_array_set_size (decoder->damage, 0);
+
   decoder->state = rfb_decoder_state_framebuffer_update_rectangle;
 
   return TRUE;
@@ -812,10 +865,14 @@ rfb_decoder_state_framebuffer_update_rectangle (RfbDecoder * decoder)
   GST_DEBUG ("w:%d h:%d", w, h);
   GST_DEBUG ("encoding: %d", encoding);
 
-  if (((w * h) + (x * y)) > (decoder->width * decoder->height)) {
-    GST_ERROR ("Desktop resize is unsupported.");
-    decoder->state = NULL;
-    return TRUE;
+  if (x < 0 || y < 0 || (guint) (x + w) > decoder->rect_width ||
+      (guint) (y + h) > decoder->rect_height) {
+    GST_ERROR ("Rectangle outside of the frame, desktop resize is "
+        "unsupported.");
+    if (decoder->error == NULL)
+      g_set_error_literal (&decoder->error, G_IO_ERROR,
+          G_IO_ERROR_INVALID_DATA, "Rectangle outside of the frame");
+    return FALSE;
   }
 
   switch (encoding) {
@@ -834,6 +891,14 @@ rfb_decoder_state_framebuffer_update_rectangle (RfbDecoder * decoder)
     case ENCODING_TYPE_HEXTILE:
       ret = rfb_decoder_hextile_encoding (decoder, x, y, w, h);
       break;
+#ifdef HAVE_ZLIB
+    case ENCODING_TYPE_ZRLE:
+      ret = rfb_decoder_zrle_encoding (decoder, x, y, w, h);
+      break;
+    case ENCODING_TYPE_TIGHT:
+      ret = rfb_decoder_tight_encoding (decoder, x, y, w, h);
+      break;
+#endif
     default:
       g_critical ("unimplemented encoding\n");
       break;
@@ -842,6 +907,12 @@ rfb_decoder_state_framebuffer_update_rectangle (RfbDecoder * decoder)
   if (!ret)
     return FALSE;
 
+  if (w > 0 && h > 0) {
+    RfbRectangle rect = { x, y, w, h };
+
+    g_array_append_val (decoder->damage, rect);
+  }
+
   decoder->n_rects--;
   if (decoder->n_rects == 0) {
     decoder->state = NULL;
@@ -898,17 +969,35 @@ rfb_decoder_copyrect_encoding (RfbDecoder * decoder, gint start_x, gint start_y,
   src_y = RFB_GET_UINT16 (decoder->data + 2) - decoder->offset_y;
   GST_DEBUG ("Copyrect from %d %d", src_x, src_y);
 
+  if (src_x < 0 || src_y < 0 || (guint) (src_x + rect_w) > decoder->rect_width
+      || (guint) (src_y + rect_h) > decoder->rect_height) {
+    GST_ERROR ("Copyrect source outside of the frame");
+    if (decoder->error == NULL)
+      g_set_error_literal (&decoder->error, G_IO_ERROR,
+          G_IO_ERROR_INVALID_DATA, "Copyrect source outside of the frame");
+    return FALSE;
+  }
+
+  /* Rectangles are applied in order, so copy within the current frame.
+   * Copy from the bottom if the source is above an overlapping
+   * destination, memmove() takes care of overlaps within a line */
   copyrect_width = rect_w * decoder->bytespp;
   line_width = decoder->line_size;
   src =
-      decoder->prev_frame + ((src_y * decoder->rect_width) +
+      decoder->frame + ((src_y * decoder->rect_width) +
       src_x) * decoder->bytespp;
   dst =
       decoder->frame + ((start_y * decoder->rect_width) +
       start_x) * decoder->bytespp;
 
+  if (src_y < start_y) {
+    src += (rect_h - 1) * line_width;
+    dst += (rect_h - 1) * line_width;
+    line_width = -line_width;
+  }
+
   while (rect_h--) {
-    memcpy (dst, src, copyrect_width);
+    memmove (dst, src, copyrect_width);
     src += line_width;
     dst += line_width;
   }
@@ -983,7 +1072,6 @@ rfb_decoder_corre_encoding (RfbDecoder * decoder, gint start_x, gint start_y,
 
   number_of_rectangles = RFB_GET_UINT32 (decoder->data);
   color = GUINT32_SWAP_LE_BE ((RFB_GET_UINT32 (decoder->data + 4)));
-  g_free (decoder->data);
 
   GST_DEBUG ("number of rectangles :%d", number_of_rectangles);
 
@@ -1003,8 +1091,6 @@ rfb_decoder_corre_encoding (RfbDecoder * decoder, gint start_x, gint start_y,
 
     /* draw the rectangle in the foreground */
     rfb_decoder_fill_rectangle (decoder, start_x + x, start_y + y, w, h, color);
-
-    g_free (decoder->data);
   }
 
   return TRUE;
@@ -1103,6 +1189,536 @@ rfb_decoder_hextile_encoding (RfbDecoder * decoder, gint start_x, gint start_y,
   return TRUE;
 }
 
+#ifdef HAVE_ZLIB
+#define ZRLE_TILE_SIZE 64
+
+#define RFB_FRAME_PTR(decoder, x, y) ((decoder)->frame + \
+    (((y) * (decoder)->rect_width) + (x)) * (decoder)->bytespp)
+
+static gboolean
+rfb_decoder_invalid_data (RfbDecoder * decoder, const gchar * message)
+{
+  GST_ERROR ("%s", message);
+  if (decoder->error == NULL)
+    g_set_error_literal (&decoder->error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+        message);
+
+  return FALSE;
+}
+
+/* Pixels are passed around as a guint32 holding the bytespp bytes of
+ * their framebuffer representation */
+static inline void
+rfb_decoder_put_pixel (RfbDecoder * decoder, guint8 * dst, guint32 pixel)
+{
+  memcpy (dst, &pixel, decoder->bytespp);
+}
+
+static void
+rfb_decoder_fill_pixels (RfbDecoder * decoder, gint x, gint y, gint w, gint h,
+    guint32 pixel)
+{
+  gint i, j;
+
+  for (j = 0; j < h; j++) {
+    guint8 *dst = RFB_FRAME_PTR (decoder, x, y + j);
+
+    for (i = 0; i < w; i++) {
+      rfb_decoder_put_pixel (decoder, dst, pixel);
+      dst += decoder->bytespp;
+    }
+  }
+}
+
+static guint32
+rfb_decoder_pixel_from_value (RfbDecoder * decoder, guint32 value)
+{
+  guint8 bytes[4] = { 0, };
+  guint32 pixel;
+  gint i, n = decoder->bytespp;
+
+  for (i = 0; i < n; i++)
+    bytes[i] = value >> (decoder->big_endian ? (n - 1 - i) * 8 : i * 8);
+  memcpy (&pixel, bytes, sizeof (pixel));
+
+  return pixel;
+}
+
+static guint32
+rfb_decoder_value_from_pixel (RfbDecoder * decoder, const guint8 * data)
+{
+  guint32 value = 0;
+  gint i, n = decoder->bytespp;
+
+  for (i = 0; i < n; i++)
+    value |= (guint32) data[i] << (decoder->big_endian ? (n - 1 - i) * 8 :
+        i * 8);
+
+  return value;
+}
+
+static gboolean
+rfb_decoder_init_stream (RfbDecoder * decoder, z_stream * stream,
+    gboolean * inited)
+{
+  if (*inited)
+    return TRUE;
+
+  memset (stream, 0, sizeof (z_stream));
+  if (inflateInit (stream) != Z_OK)
+    return rfb_decoder_invalid_data (decoder, "Failed to set up zlib");
+
+  *inited = TRUE;
+  return TRUE;
+}
+
+/* Reads len bytes of compressed data and inflates all of it */
+static const guint8 *
+rfb_decoder_inflate (RfbDecoder * decoder, z_stream * stream, guint32 len,
+    gsize * out_len)
+{
+  gsize out = 0;
+  gint ret;
+
+  if (len == 0) {
+    rfb_decoder_invalid_data (decoder, "Empty zlib data");
+    return NULL;
+  }
+
+  if (!rfb_decoder_read (decoder, len))
+    return NULL;
+
+  stream->next_in = decoder->data;
+  stream->avail_in = len;
+
+  do {
+    if (out == decoder->zlib_data_len) {
+      decoder->zlib_data_len = MAX (decoder->zlib_data_len * 2, 64 * 1024);
+      decoder->zlib_data =
+          g_realloc (decoder->zlib_data, decoder->zlib_data_len);
+    }
+    stream->next_out = decoder->zlib_data + out;
+    stream->avail_out = decoder->zlib_data_len - out;
+
+    ret = inflate (stream, Z_SYNC_FLUSH);
+    out = decoder->zlib_data_len - stream->avail_out;
+
+    if (ret == Z_BUF_ERROR && stream->avail_out > 0)
+      break;
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+      rfb_decoder_invalid_data (decoder, "Invalid zlib data");
+      return NULL;
+    }
+  } while (stream->avail_in > 0 || stream->avail_out == 0);
+
+  *out_len = out;
+  return decoder->zlib_data;
+}
+
+static inline guint32
+rfb_decoder_zrle_cpixel (RfbDecoder * decoder, const guint8 * data)
+{
+  guint32 pixel = 0;
+
+  memcpy ((guint8 *) & pixel + decoder->cpixel_offset, data,
+      decoder->cpixel_size);
+
+  return pixel;
+}
+
+static gboolean
+rfb_decoder_zrle_run_length (const guint8 ** data, const guint8 * end,
+    gint max, gint * run)
+{
+  const guint8 *p = *data;
+  gint len = 1;
+  guint8 b;
+
+  do {
+    if (p >= end)
+      return FALSE;
+    b = *p++;
+    len += b;
+    if (len > max)
+      return FALSE;
+  } while (b == 255);
+
+  *data = p;
+  *run = len;
+  return TRUE;
+}
+
+/* Writes run pixels starting at position pos of the tile */
+static void
+rfb_decoder_zrle_put_run (RfbDecoder * decoder, gint x, gint y, gint w,
+    gint pos, gint run, guint32 pixel)
+{
+  while (run > 0) {
+    gint n = MIN (run, w - pos % w);
+    guint8 *dst = RFB_FRAME_PTR (decoder, x + pos % w, y + pos / w);
+
+    pos += n;
+    run -= n;
+    while (n--) {
+      rfb_decoder_put_pixel (decoder, dst, pixel);
+      dst += decoder->bytespp;
+    }
+  }
+}
+
+static gboolean
+rfb_decoder_zrle_tile (RfbDecoder * decoder, const guint8 ** data,
+    const guint8 * end, gint x, gint y, gint w, gint h)
+{
+  const guint8 *p = *data;
+  gint cps = decoder->cpixel_size;
+  gint count = w * h;
+  guint32 palette[128];
+  gint n_colors = 0;
+  gint i, j, pos, run;
+  guint8 subencoding;
+
+  if (p >= end)
+    return FALSE;
+  subencoding = *p++;
+
+  if (subencoding >= 2 && subencoding <= 16)
+    n_colors = subencoding;
+  else if (subencoding >= 130)
+    n_colors = subencoding - 128;
+
+  if (n_colors > 0) {
+    if (end - p < n_colors * cps)
+      return FALSE;
+    for (i = 0; i < n_colors; i++, p += cps)
+      palette[i] = rfb_decoder_zrle_cpixel (decoder, p);
+  }
+
+  if (subencoding == 0) {
+    /* raw */
+    if (end - p < count * cps)
+      return FALSE;
+    for (j = 0; j < h; j++) {
+      guint8 *dst = RFB_FRAME_PTR (decoder, x, y + j);
+
+      for (i = 0; i < w; i++, p += cps, dst += decoder->bytespp)
+        rfb_decoder_put_pixel (decoder, dst,
+            rfb_decoder_zrle_cpixel (decoder, p));
+    }
+  } else if (subencoding == 1) {
+    /* solid */
+    if (end - p < cps)
+      return FALSE;
+    rfb_decoder_fill_pixels (decoder, x, y, w, h,
+        rfb_decoder_zrle_cpixel (decoder, p));
+    p += cps;
+  } else if (subencoding <= 16) {
+    /* packed palette, rows are padded to whole bytes */
+    gint bits = n_colors == 2 ? 1 : (n_colors <= 4 ? 2 : 4);
+    gint row_len = (w * bits + 7) / 8;
+    guint8 mask = (1 << bits) - 1;
+
+    if (end - p < row_len * h)
+      return FALSE;
+    for (j = 0; j < h; j++, p += row_len) {
+      guint8 *dst = RFB_FRAME_PTR (decoder, x, y + j);
+
+      for (i = 0; i < w; i++, dst += decoder->bytespp) {
+        gint bit = i * bits;
+        gint idx = (p[bit / 8] >> (8 - bits - bit % 8)) & mask;
+
+        if (idx >= n_colors)
+          return FALSE;
+        rfb_decoder_put_pixel (decoder, dst, palette[idx]);
+      }
+    }
+  } else if (subencoding == 128) {
+    /* plain RLE */
+    for (pos = 0; pos < count; pos += run) {
+      guint32 pixel;
+
+      if (end - p < cps)
+        return FALSE;
+      pixel = rfb_decoder_zrle_cpixel (decoder, p);
+      p += cps;
+      if (!rfb_decoder_zrle_run_length (&p, end, count - pos, &run))
+        return FALSE;
+      rfb_decoder_zrle_put_run (decoder, x, y, w, pos, run, pixel);
+    }
+  } else if (subencoding >= 130) {
+    /* palette RLE */
+    for (pos = 0; pos < count; pos += run) {
+      guint8 idx;
+
+      if (p >= end)
+        return FALSE;
+      idx = *p++;
+      run = 1;
+      if ((idx & 0x80) &&
+          !rfb_decoder_zrle_run_length (&p, end, count - pos, &run))
+        return FALSE;
+      idx &= 0x7f;
+      if (idx >= n_colors)
+        return FALSE;
+      rfb_decoder_zrle_put_run (decoder, x, y, w, pos, run, palette[idx]);
+    }
+  } else {
+    return FALSE;
+  }
+
+  *data = p;
+  return TRUE;
+}
+
+static gboolean
+rfb_decoder_zrle_encoding (RfbDecoder * decoder, gint start_x, gint start_y,
+    gint rect_w, gint rect_h)
+{
+  const guint8 *data, *end;
+  guint32 length;
+  gsize size;
+  gint x, y;
+
+  if (!rfb_decoder_init_stream (decoder, &decoder->zrle_stream,
+          &decoder->zrle_stream_inited))
+    return FALSE;
+
+  if (!rfb_decoder_read (decoder, 4))
+    return FALSE;
+
+  length = RFB_GET_UINT32 (decoder->data);
+  GST_DEBUG ("Inflating %u bytes of ZRLE data", length);
+
+  data = rfb_decoder_inflate (decoder, &decoder->zrle_stream, length, &size);
+  if (!data)
+    return FALSE;
+  end = data + size;
+
+  for (y = start_y; y < start_y + rect_h; y += ZRLE_TILE_SIZE) {
+    for (x = start_x; x < start_x + rect_w; x += ZRLE_TILE_SIZE) {
+      if (!rfb_decoder_zrle_tile (decoder, &data, end, x, y,
+              MIN (ZRLE_TILE_SIZE, start_x + rect_w - x),
+              MIN (ZRLE_TILE_SIZE, start_y + rect_h - y)))
+        return rfb_decoder_invalid_data (decoder, "Invalid ZRLE data");
+    }
+  }
+
+  return TRUE;
+}
+
+static inline guint
+rfb_decoder_tight_tpixel_size (RfbDecoder * decoder)
+{
+  return decoder->tpixel_rgb24 ? 3 : decoder->bytespp;
+}
+
+static guint32
+rfb_decoder_tight_tpixel (RfbDecoder * decoder, const guint8 * data)
+{
+  guint32 pixel = 0;
+
+  if (decoder->tpixel_rgb24)
+    return rfb_decoder_pixel_from_value (decoder,
+        ((guint32) data[0] << decoder->red_shift) |
+        ((guint32) data[1] << decoder->green_shift) |
+        ((guint32) data[2] << decoder->blue_shift));
+
+  memcpy (&pixel, data, decoder->bytespp);
+  return pixel;
+}
+
+/* Each component is predicted from its left, upper and upper left
+ * neighbours, the data holds the differences */
+static void
+rfb_decoder_tight_gradient (RfbDecoder * decoder, const guint8 * data,
+    gint x, gint y, gint w, gint h)
+{
+  guint tps = rfb_decoder_tight_tpixel_size (decoder);
+  const gint max[3] = { decoder->red_max, decoder->green_max,
+    decoder->blue_max
+  };
+  const guint shift[3] = { decoder->red_shift, decoder->green_shift,
+    decoder->blue_shift
+  };
+  guint16 *rows, *prev_row, *row, *tmp;
+  gint i, j, c;
+
+  rows = g_new0 (guint16, 2 * 3 * w);
+  prev_row = rows;
+  row = rows + 3 * w;
+
+  for (j = 0; j < h; j++) {
+    guint8 *dst = RFB_FRAME_PTR (decoder, x, y + j);
+
+    for (i = 0; i < w; i++, data += tps, dst += decoder->bytespp) {
+      guint32 value = 0;
+
+      if (!decoder->tpixel_rgb24)
+        value = rfb_decoder_value_from_pixel (decoder, data);
+
+      for (c = 0; c < 3; c++) {
+        gint left = i > 0 ? row[3 * (i - 1) + c] : 0;
+        gint up_left = i > 0 ? prev_row[3 * (i - 1) + c] : 0;
+        gint estimate = CLAMP (left + prev_row[3 * i + c] - up_left, 0,
+            max[c]);
+        gint diff = decoder->tpixel_rgb24 ? data[c] :
+            (value >> shift[c]) & max[c];
+
+        row[3 * i + c] = (estimate + diff) & max[c];
+      }
+
+      rfb_decoder_put_pixel (decoder, dst,
+          rfb_decoder_pixel_from_value (decoder,
+              ((guint32) row[3 * i] << shift[0]) |
+              ((guint32) row[3 * i + 1] << shift[1]) |
+              ((guint32) row[3 * i + 2] << shift[2])));
+    }
+
+    tmp = prev_row;
+    prev_row = row;
+    row = tmp;
+  }
+
+  g_free (rows);
+}
+
+static gboolean
+rfb_decoder_tight_encoding (RfbDecoder * decoder, gint start_x, gint start_y,
+    gint rect_w, gint rect_h)
+{
+  guint tps = rfb_decoder_tight_tpixel_size (decoder);
+  guint32 palette[256];
+  gint n_colors = 0;
+  guint8 control, filter = TIGHT_FILTER_COPY;
+  const guint8 *data;
+  gsize raw_size, size;
+  gint i, j;
+
+  if (!rfb_decoder_read (decoder, 1))
+    return FALSE;
+  control = RFB_GET_UINT8 (decoder->data);
+
+  /* the lower bits ask to reset the zlib streams */
+  for (i = 0; i < G_N_ELEMENTS (decoder->tight_streams); i++) {
+    if ((control & (1 << i)) && decoder->tight_streams_inited[i])
+      inflateReset (&decoder->tight_streams[i]);
+  }
+  control >>= 4;
+
+  if (control == TIGHT_FILL) {
+    if (!rfb_decoder_read (decoder, tps))
+      return FALSE;
+    rfb_decoder_fill_pixels (decoder, start_x, start_y, rect_w, rect_h,
+        rfb_decoder_tight_tpixel (decoder, decoder->data));
+    return TRUE;
+  }
+
+  /* JPEG is only used if a quality level was requested, which we don't */
+  if (control > TIGHT_FILL)
+    return rfb_decoder_invalid_data (decoder, "Unsupported Tight compression");
+
+  if (control & TIGHT_EXPLICIT_FILTER) {
+    if (!rfb_decoder_read (decoder, 1))
+      return FALSE;
+    filter = RFB_GET_UINT8 (decoder->data);
+  }
+
+  switch (filter) {
+    case TIGHT_FILTER_COPY:
+    case TIGHT_FILTER_GRADIENT:
+      raw_size = rect_w * rect_h * tps;
+      break;
+    case TIGHT_FILTER_PALETTE:
+      if (!rfb_decoder_read (decoder, 1))
+        return FALSE;
+      n_colors = RFB_GET_UINT8 (decoder->data) + 1;
+      if (!rfb_decoder_read (decoder, n_colors * tps))
+        return FALSE;
+      for (i = 0; i < n_colors; i++)
+        palette[i] =
+            rfb_decoder_tight_tpixel (decoder, decoder->data + i * tps);
+      raw_size = n_colors == 2 ? ((rect_w + 7) / 8) * rect_h : rect_w * rect_h;
+      break;
+    default:
+      return rfb_decoder_invalid_data (decoder, "Invalid Tight filter");
+  }
+
+  if (raw_size == 0)
+    return TRUE;
+
+  /* less than 12 bytes are sent uncompressed */
+  if (raw_size < 12) {
+    if (!rfb_decoder_read (decoder, raw_size))
+      return FALSE;
+    data = decoder->data;
+  } else {
+    gint stream_id = control & 0x03;
+    guint32 length = 0;
+
+    /* compact length: 7 bits in each of the first two bytes while the
+     * high bit is set, then 8 bits */
+    for (i = 0; i < 3; i++) {
+      guint8 b;
+
+      if (!rfb_decoder_read (decoder, 1))
+        return FALSE;
+      b = RFB_GET_UINT8 (decoder->data);
+      length |= (guint32) (i < 2 ? b & 0x7f : b) << (7 * i);
+      if (i < 2 && !(b & 0x80))
+        break;
+    }
+
+    if (!rfb_decoder_init_stream (decoder, &decoder->tight_streams[stream_id],
+            &decoder->tight_streams_inited[stream_id]))
+      return FALSE;
+
+    data = rfb_decoder_inflate (decoder, &decoder->tight_streams[stream_id],
+        length, &size);
+    if (!data)
+      return FALSE;
+    if (size < raw_size)
+      return rfb_decoder_invalid_data (decoder, "Short Tight data");
+  }
+
+  switch (filter) {
+    case TIGHT_FILTER_COPY:
+      for (j = 0; j < rect_h; j++) {
+        guint8 *dst = RFB_FRAME_PTR (decoder, start_x, start_y + j);
+
+        for (i = 0; i < rect_w; i++, data += tps, dst += decoder->bytespp)
+          rfb_decoder_put_pixel (decoder, dst,
+              rfb_decoder_tight_tpixel (decoder, data));
+      }
+      break;
+    case TIGHT_FILTER_PALETTE:
+      for (j = 0; j < rect_h; j++) {
+        guint8 *dst = RFB_FRAME_PTR (decoder, start_x, start_y + j);
+
+        for (i = 0; i < rect_w; i++, dst += decoder->bytespp) {
+          gint idx;
+
+          /* two colours are packed as one bit per pixel */
+          if (n_colors == 2)
+            idx = (data[i / 8] >> (7 - i % 8)) & 1;
+          else
+            idx = data[i];
+          if (idx >= n_colors)
+            return rfb_decoder_invalid_data (decoder, "Invalid Tight data");
+          rfb_decoder_put_pixel (decoder, dst, palette[idx]);
+        }
+        data += n_colors == 2 ? (rect_w + 7) / 8 : rect_w;
+      }
+      break;
+    case TIGHT_FILTER_GRADIENT:
+      rfb_decoder_tight_gradient (decoder, data, start_x, start_y, rect_w,
+          rect_h);
+      break;
+  }
+
+  return TRUE;
+}
+#endif
+
 static gboolean
 rfb_decoder_state_set_colour_map_entries (RfbDecoder * decoder)
 {
@@ -5,6 +5,10 @@
 
 #include <glib.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 G_BEGIN_DECLS
 
 enum
@@ -26,6 +30,8 @@ enum
 #define ENCODING_TYPE_RRE                   2
 #define ENCODING_TYPE_CORRE                 4
 #define ENCODING_TYPE_HEXTILE               5
+#define ENCODING_TYPE_TIGHT                 7
+#define ENCODING_TYPE_ZRLE                  16
 
 #define SUBENCODING_RAW                     1
 #define SUBENCODING_BACKGROUND              2
@@ -33,7 +39,24 @@ enum
 #define SUBENCODING_ANYSUBRECTS             8
 #define SUBENCODING_SUBRECTSCOLORED         16
 
+#define TIGHT_EXPLICIT_FILTER               0x04
+#define TIGHT_FILL                          0x08
+#define TIGHT_JPEG                          0x09
+
+#define TIGHT_FILTER_COPY                   0
+#define TIGHT_FILTER_PALETTE                1
+#define TIGHT_FILTER_GRADIENT               2
+
 typedef struct _RfbDecoder RfbDecoder;
+typedef struct _RfbRectangle RfbRectangle;
+
+struct _RfbRectangle
+{
+  gint x;
+  gint y;
+  gint width;
+  gint height;
+};
 
 struct _RfbDecoder
 {
@@ -50,7 +73,19 @@ struct _RfbDecoder
   guint32 data_len;
   gpointer decoder_private;
   guint8 *frame;
-  guint8 *prev_frame;
+
+  /* RfbRectangles updated by the last framebuffer update */
+  GArray *damage;
+
+#ifdef HAVE_ZLIB
+  /* ZRLE and Tight keep their zlib streams for the whole connection */
+  z_stream zrle_stream;
+  gboolean zrle_stream_inited;
+  z_stream tight_streams[4];
+  gboolean tight_streams_inited[4];
+  guint8 *zlib_data;
+  gsize zlib_data_len;
+#endif
 
   GError *error;
 
@@ -94,6 +129,11 @@ struct _RfbDecoder
   guint bytespp;
   guint line_size;
 
+  /* compressed pixel layout of ZRLE (CPIXEL) and Tight (TPIXEL) */
+  guint cpixel_size;
+  guint cpixel_offset;
+  gboolean tpixel_rgb24;
+
   /* Seriliaze writes operations */
   GMutex write_lock;
 };
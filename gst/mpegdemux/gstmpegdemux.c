@@ -51,6 +51,7 @@
 #include <gst/tag/tag.h>
 #include <gst/pbutils/pbutils.h>
 #include <gst/base/gstbytereader.h>
+#include <gst/base/gstbytewriter.h>
 
 #include "gstmpegdefs.h"
 #include "gstmpegdemux.h"
@@ -64,6 +65,9 @@
 
 #define DURATION_SCAN_LIMIT         4 * 1024 * 1024
 
+/* Minimum SCR distance between two seek index entries, 0.5s */
+#define INDEX_SCR_INTERVAL          (CLOCK_FREQ / 2)
+
 typedef enum
 {
   SCAN_SCR,
@@ -91,9 +95,16 @@ enum
 enum
 {
   PROP_0,
+  PROP_INDEX_LOCATION,
   /* FILL ME */
 };
 
+typedef struct
+{
+  guint64 scr;
+  guint64 offset;
+} GstPsDemuxIndexEntry;
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -139,6 +150,10 @@ static void gst_ps_demux_class_init (GstPsDemuxClass * klass);
 static void gst_ps_demux_init (GstPsDemux * demux);
 static void gst_ps_demux_finalize (GstPsDemux * demux);
 static void gst_ps_demux_reset (GstPsDemux * demux);
+static void gst_ps_demux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_ps_demux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static gboolean gst_ps_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
@@ -245,6 +260,15 @@ gst_ps_demux_class_init (GstPsDemuxClass * klass)
   gstelement_class = (GstElementClass *) klass;
 
   gobject_class->finalize = (GObjectFinalizeFunc) gst_ps_demux_finalize;
+  gobject_class->set_property = gst_ps_demux_set_property;
+  gobject_class->get_property = gst_ps_demux_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index location",
+          "Location of a seek index sidecar file, loaded in pull mode if it "
+          "matches the stream size and written back when stopping "
+          "(NULL to disable)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state = gst_ps_demux_change_state;
 }
@@ -275,6 +299,7 @@ gst_ps_demux_init (GstPsDemux * demux)
   demux->adapter = gst_adapter_new ();
   demux->rev_adapter = gst_adapter_new ();
   demux->flowcombiner = gst_flow_combiner_new ();
+  demux->index = g_array_new (FALSE, FALSE, sizeof (GstPsDemuxIndexEntry));
 
   gst_ps_demux_reset (demux);
 }
@@ -289,10 +314,49 @@ gst_ps_demux_finalize (GstPsDemux * demux)
   gst_flow_combiner_free (demux->flowcombiner);
   g_object_unref (demux->adapter);
   g_object_unref (demux->rev_adapter);
+  g_array_free (demux->index, TRUE);
+  g_free (demux->index_location);
 
   G_OBJECT_CLASS (parent_class)->finalize (G_OBJECT (demux));
 }
 
+static void
+gst_ps_demux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstPsDemux *demux = GST_PS_DEMUX (object);
+
+  switch (prop_id) {
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->index_location);
+      demux->index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_ps_demux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstPsDemux *demux = GST_PS_DEMUX (object);
+
+  switch (prop_id) {
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->index_location);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_ps_demux_reset (GstPsDemux * demux)
 {
@@ -343,6 +407,8 @@ gst_ps_demux_reset (GstPsDemux * demux)
   gst_ps_demux_flush (demux);
   demux->have_group_id = FALSE;
   demux->group_id = G_MAXUINT;
+  g_array_set_size (demux->index, 0);
+  demux->upstream_size = -1;
 }
 
 static GstPsStream *
@@ -1117,6 +1183,221 @@ not_supported:
   }
 }
 
+/* Returns the index of the last entry with an offset <= offset, or -1 */
+static gint
+gst_ps_demux_index_find_offset (GstPsDemux * demux, guint64 offset)
+{
+  gint lo = 0, hi = (gint) demux->index->len - 1, res = -1;
+
+  while (lo <= hi) {
+    gint mid = lo + (hi - lo) / 2;
+
+    if (g_array_index (demux->index, GstPsDemuxIndexEntry, mid).offset <=
+        offset) {
+      res = mid;
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  return res;
+}
+
+/* Returns the index of the last entry with an SCR <= scr, or -1 */
+static gint
+gst_ps_demux_index_find_scr (GstPsDemux * demux, guint64 scr)
+{
+  gint lo = 0, hi = (gint) demux->index->len - 1, res = -1;
+
+  while (lo <= hi) {
+    gint mid = lo + (hi - lo) / 2;
+
+    if (g_array_index (demux->index, GstPsDemuxIndexEntry, mid).scr <= scr) {
+      res = mid;
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+
+  return res;
+}
+
+/* Remembers the (unadjusted) SCR of the pack starting at offset. Entries are
+ * kept sorted by both offset and SCR, packs that would break the ordering
+ * (SCR discontinuities) or are closer than INDEX_SCR_INTERVAL to their
+ * neighbours are not added. */
+static void
+gst_ps_demux_index_add (GstPsDemux * demux, guint64 scr, guint64 offset)
+{
+  GstPsDemuxIndexEntry entry;
+  gint i;
+
+  if (!demux->random_access || scr == G_MAXUINT64)
+    return;
+
+  i = gst_ps_demux_index_find_offset (demux, offset);
+  if (i >= 0) {
+    GstPsDemuxIndexEntry *prev =
+        &g_array_index (demux->index, GstPsDemuxIndexEntry, i);
+
+    if (prev->offset == offset || scr < prev->scr + INDEX_SCR_INTERVAL)
+      return;
+  }
+  if (i + 1 < (gint) demux->index->len) {
+    GstPsDemuxIndexEntry *next =
+        &g_array_index (demux->index, GstPsDemuxIndexEntry, i + 1);
+
+    if (scr + INDEX_SCR_INTERVAL > next->scr)
+      return;
+  }
+
+  entry.scr = scr;
+  entry.offset = offset;
+  g_array_insert_val (demux->index, i + 1, entry);
+}
+
+/* Seek index sidecar
+ *
+ * All values are big-endian:
+ *   "PSIX" | version (u32) | file size (u64) |
+ *   first_scr (u64) | first_scr_offset (u64) |
+ *   last_scr (u64) | last_scr_offset (u64) |
+ *   first_pts (u64) | last_pts (u64) | start offset (u64) |
+ *   n entries (u32) | n * (scr (u64) | offset (u64))
+ */
+#define INDEX_MAGIC GST_MAKE_FOURCC ('P', 'S', 'I', 'X')
+#define INDEX_VERSION 1
+
+static gboolean
+gst_ps_demux_save_index (GstPsDemux * demux, const gchar * filename)
+{
+  GstByteWriter bw;
+  GError *err = NULL;
+  guint8 *data;
+  guint size, i;
+  gboolean res;
+
+  gst_byte_writer_init_with_size (&bw,
+      76 + 16 * demux->index->len, FALSE);
+  gst_byte_writer_put_uint32_le (&bw, INDEX_MAGIC);
+  gst_byte_writer_put_uint32_be (&bw, INDEX_VERSION);
+  gst_byte_writer_put_uint64_be (&bw, demux->upstream_size);
+  gst_byte_writer_put_uint64_be (&bw, demux->first_scr);
+  gst_byte_writer_put_uint64_be (&bw, demux->first_scr_offset);
+  gst_byte_writer_put_uint64_be (&bw, demux->last_scr);
+  gst_byte_writer_put_uint64_be (&bw, demux->last_scr_offset);
+  gst_byte_writer_put_uint64_be (&bw, demux->first_pts);
+  gst_byte_writer_put_uint64_be (&bw, demux->last_pts);
+  gst_byte_writer_put_uint64_be (&bw, demux->start_offset);
+  gst_byte_writer_put_uint32_be (&bw, demux->index->len);
+  for (i = 0; i < demux->index->len; i++) {
+    GstPsDemuxIndexEntry *entry =
+        &g_array_index (demux->index, GstPsDemuxIndexEntry, i);
+
+    gst_byte_writer_put_uint64_be (&bw, entry->scr);
+    gst_byte_writer_put_uint64_be (&bw, entry->offset);
+  }
+
+  size = gst_byte_writer_get_size (&bw);
+  data = gst_byte_writer_reset_and_get_data (&bw);
+
+  res = g_file_set_contents (filename, (const gchar *) data, size, &err);
+  if (!res) {
+    GST_WARNING_OBJECT (demux, "Could not write seek index to %s: %s",
+        filename, err->message);
+    g_error_free (err);
+  } else {
+    GST_INFO_OBJECT (demux, "Wrote %u index entries to %s",
+        demux->index->len, filename);
+  }
+  g_free (data);
+
+  return res;
+}
+
+/* Loads the first/last SCR and PTS values and the index entries, the caller
+ * can then skip the duration scan */
+static gboolean
+gst_ps_demux_load_index (GstPsDemux * demux, const gchar * filename)
+{
+  GstByteReader br;
+  gchar *contents;
+  gsize length;
+  guint32 magic = 0, version = 0, n_entries = 0, i;
+  guint64 size = 0;
+  guint64 first_scr, first_scr_offset, last_scr, last_scr_offset;
+  guint64 first_pts, last_pts, start_offset;
+
+  if (!g_file_get_contents (filename, &contents, &length, NULL)) {
+    GST_DEBUG_OBJECT (demux, "No seek index at %s", filename);
+    return FALSE;
+  }
+
+  gst_byte_reader_init (&br, (const guint8 *) contents, length);
+  if (!gst_byte_reader_get_uint32_le (&br, &magic) || magic != INDEX_MAGIC ||
+      !gst_byte_reader_get_uint32_be (&br, &version) ||
+      version != INDEX_VERSION ||
+      !gst_byte_reader_get_uint64_be (&br, &size) ||
+      !gst_byte_reader_get_uint64_be (&br, &first_scr) ||
+      !gst_byte_reader_get_uint64_be (&br, &first_scr_offset) ||
+      !gst_byte_reader_get_uint64_be (&br, &last_scr) ||
+      !gst_byte_reader_get_uint64_be (&br, &last_scr_offset) ||
+      !gst_byte_reader_get_uint64_be (&br, &first_pts) ||
+      !gst_byte_reader_get_uint64_be (&br, &last_pts) ||
+      !gst_byte_reader_get_uint64_be (&br, &start_offset) ||
+      !gst_byte_reader_get_uint32_be (&br, &n_entries) ||
+      gst_byte_reader_get_remaining (&br) / 16 < n_entries)
+    goto invalid;
+
+  if (size != demux->upstream_size) {
+    GST_INFO_OBJECT (demux, "Seek index %s doesn't match stream (size %"
+        G_GUINT64_FORMAT " vs %" G_GUINT64_FORMAT ")", filename, size,
+        demux->upstream_size);
+    g_free (contents);
+    return FALSE;
+  }
+
+  if (first_scr == G_MAXUINT64 || last_scr == G_MAXUINT64 ||
+      first_scr > last_scr || first_scr_offset > last_scr_offset ||
+      last_scr_offset > size || start_offset > size)
+    goto invalid;
+
+  g_array_set_size (demux->index, n_entries);
+  for (i = 0; i < n_entries; i++) {
+    GstPsDemuxIndexEntry *entry =
+        &g_array_index (demux->index, GstPsDemuxIndexEntry, i);
+
+    entry->scr = gst_byte_reader_get_uint64_be_unchecked (&br);
+    entry->offset = gst_byte_reader_get_uint64_be_unchecked (&br);
+    if (entry->offset >= size || (i > 0 && (entry->offset <= entry[-1].offset
+                || entry->scr <= entry[-1].scr))) {
+      g_array_set_size (demux->index, 0);
+      goto invalid;
+    }
+  }
+
+  demux->first_scr = first_scr;
+  demux->first_scr_offset = first_scr_offset;
+  demux->last_scr = last_scr;
+  demux->last_scr_offset = last_scr_offset;
+  demux->first_pts = first_pts;
+  demux->last_pts = last_pts;
+  demux->start_offset = start_offset;
+
+  GST_INFO_OBJECT (demux, "Loaded %u index entries from %s", n_entries,
+      filename);
+  g_free (contents);
+
+  return TRUE;
+
+invalid:
+  GST_WARNING_OBJECT (demux, "Invalid seek index %s", filename);
+  g_free (contents);
+  return FALSE;
+}
+
 #define MAX_RECURSION_COUNT 100
 
 /* Binary search for requested SCR */
@@ -1138,9 +1419,9 @@ find_offset (GstPsDemux * demux, guint64 scr,
       MIN (gst_util_uint64_scale (scr - min_scr, scr_rate_n,
           scr_rate_d), demux->sink_segment.stop);
 
-  if (!gst_ps_demux_scan_forward_ts (demux, &offset, SCAN_SCR, &fscr, 0)) {
-    gst_ps_demux_scan_backward_ts (demux, &offset, SCAN_SCR, &fscr, 0);
-  }
+  if (gst_ps_demux_scan_forward_ts (demux, &offset, SCAN_SCR, &fscr, 0) ||
+      gst_ps_demux_scan_backward_ts (demux, &offset, SCAN_SCR, &fscr, 0))
+    gst_ps_demux_index_add (demux, fscr, offset);
 
   if (fscr == scr || fscr == min_scr || fscr == max_scr) {
     return offset;
@@ -1161,6 +1442,8 @@ gst_ps_demux_do_seek (GstPsDemux * demux, GstSegment * seeksegment)
   gboolean found;
   guint64 fscr, offset;
   guint64 scr = GSTTIME_TO_MPEGTIME (seeksegment->position + demux->base_time);
+  guint64 min_scr, min_scr_offset, max_scr, max_scr_offset;
+  gint i;
 
   /* In some clips the PTS values are completely unaligned with SCR values.
    * To improve the seek in that situation we apply a factor considering the
@@ -1175,9 +1458,45 @@ gst_ps_demux_do_seek (GstPsDemux * demux, GstSegment * seeksegment)
   GST_INFO_OBJECT (demux, "sink segment configured %" GST_SEGMENT_FORMAT
       ", trying to go at SCR: %" G_GUINT64_FORMAT, &demux->sink_segment, scr);
 
-  offset =
-      find_offset (demux, scr, demux->first_scr, demux->first_scr_offset,
-      demux->last_scr, demux->last_scr_offset, 0);
+  /* Narrow the search down to the index entries around the target */
+  min_scr = demux->first_scr;
+  min_scr_offset = demux->first_scr_offset;
+  max_scr = demux->last_scr;
+  max_scr_offset = demux->last_scr_offset;
+
+  i = gst_ps_demux_index_find_scr (demux, scr);
+  if (i >= 0) {
+    GstPsDemuxIndexEntry *entry =
+        &g_array_index (demux->index, GstPsDemuxIndexEntry, i);
+
+    if (entry->scr > min_scr && entry->offset > min_scr_offset) {
+      min_scr = entry->scr;
+      min_scr_offset = entry->offset;
+    }
+  }
+  if (i + 1 < (gint) demux->index->len) {
+    GstPsDemuxIndexEntry *entry =
+        &g_array_index (demux->index, GstPsDemuxIndexEntry, i + 1);
+
+    if (entry->scr < max_scr && entry->offset < max_scr_offset) {
+      max_scr = entry->scr;
+      max_scr_offset = entry->offset;
+    }
+  }
+
+  if (min_scr == scr) {
+    offset = min_scr_offset;
+  } else if (i >= 0 && max_scr - min_scr <= 2 * INDEX_SCR_INTERVAL) {
+    /* Close enough, refine from the pack before the target */
+    offset = min_scr_offset;
+  } else {
+    offset = find_offset (demux, scr, min_scr, min_scr_offset, max_scr,
+        max_scr_offset, 0);
+  }
+
+  GST_DEBUG_OBJECT (demux, "index gave SCR range %" G_GUINT64_FORMAT "-%"
+      G_GUINT64_FORMAT ", starting at offset %" G_GUINT64_FORMAT, min_scr,
+      max_scr, offset);
 
   if (offset == (guint64) - 1) {
     return FALSE;
@@ -1727,6 +2046,10 @@ gst_ps_demux_parse_pack_start (GstPsDemux * demux)
       scr, scr_adjusted, new_rate,
       GST_TIME_ARGS (MPEGTIME_TO_GSTTIME ((guint64) scr)));
 
+  /* adapter_offset is still at the pack start code here */
+  if (demux->sink_segment.rate >= 0.0)
+    gst_ps_demux_index_add (demux, scr, demux->adapter_offset);
+
   /* keep the first src in order to calculate delta time */
   if (G_UNLIKELY (demux->first_scr == G_MAXUINT64)) {
     gint64 diff;
@@ -2709,6 +3032,7 @@ gst_ps_sink_get_duration (GstPsDemux * demux)
   guint64 offset;
   guint i;
   guint64 scr = 0;
+  gchar *index_location;
   /* init the sink segment */
   gst_segment_init (&demux->sink_segment, format);
   /* get peer to figure out length */
@@ -2723,6 +3047,23 @@ gst_ps_sink_get_duration (GstPsDemux * demux)
   demux->sink_segment.stop = length;
   gst_segment_set_duration (&demux->sink_segment, format, length);
   gst_segment_set_position (&demux->sink_segment, format, 0);
+  demux->upstream_size = length;
+  demux->start_offset = 0;
+  /* A matching seek index already has everything the scans below would
+   * find, without reading the end of the file */
+  GST_OBJECT_LOCK (demux);
+  index_location = g_strdup (demux->index_location);
+  GST_OBJECT_UNLOCK (demux);
+  if (index_location) {
+    gboolean loaded = gst_ps_demux_load_index (demux, index_location);
+
+    g_free (index_location);
+    if (loaded) {
+      GST_DEBUG_OBJECT (demux, "Using seek index, skipping duration scan");
+      demux->sink_segment.position = demux->start_offset;
+      goto configure;
+    }
+  }
   /* Scan for notorious SCR and PTS to calculate the duration */
   /* scan for first SCR in the stream */
   offset = demux->sink_segment.start;
@@ -2733,6 +3074,7 @@ gst_ps_sink_get_duration (GstPsDemux * demux)
       " in packet starting at %" G_GUINT64_FORMAT, demux->first_scr,
       GST_TIME_ARGS (MPEGTIME_TO_GSTTIME (demux->first_scr)), offset);
   demux->first_scr_offset = offset;
+  gst_ps_demux_index_add (demux, demux->first_scr, offset);
   /* scan for last SCR in the stream */
   offset = demux->sink_segment.stop;
   gst_ps_demux_scan_backward_ts (demux, &offset, SCAN_SCR,
@@ -2742,6 +3084,7 @@ gst_ps_sink_get_duration (GstPsDemux * demux)
       " in packet starting at %" G_GUINT64_FORMAT, demux->last_scr,
       GST_TIME_ARGS (MPEGTIME_TO_GSTTIME (demux->last_scr)), offset);
   demux->last_scr_offset = offset;
+  gst_ps_demux_index_add (demux, demux->last_scr, offset);
   /* scan for first PTS in the stream */
   offset = demux->sink_segment.start;
   gst_ps_demux_scan_forward_ts (demux, &offset, SCAN_PTS,
@@ -2773,6 +3116,7 @@ gst_ps_sink_get_duration (GstPsDemux * demux)
         demux->first_scr_offset = offset;
         /* Start demuxing from the right place */
         demux->sink_segment.position = offset;
+        demux->start_offset = offset;
         GST_DEBUG_OBJECT (demux, "Replaced First SCR: %" G_GINT64_FORMAT
             " %" GST_TIME_FORMAT " in packet starting at %"
             G_GUINT64_FORMAT, demux->first_scr,
@@ -2781,6 +3125,7 @@ gst_ps_sink_get_duration (GstPsDemux * demux)
       }
     }
   }
+configure:
   /* Set the base_time and avg rate */
   demux->base_time = MPEGTIME_TO_GSTTIME (demux->first_scr);
   demux->scr_rate_n = demux->last_scr_offset - demux->first_scr_offset;
@@ -3189,6 +3534,18 @@ gst_ps_demux_change_state (GstElement * element, GstStateChange transition)
   result = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* The streaming task is stopped, store the index before the reset */
+      if (demux->random_access && demux->upstream_size != -1 &&
+          demux->first_scr != G_MAXUINT64 && demux->last_scr != G_MAXUINT64) {
+        gchar *index_location;
+
+        GST_OBJECT_LOCK (demux);
+        index_location = g_strdup (demux->index_location);
+        GST_OBJECT_UNLOCK (demux);
+        if (index_location)
+          gst_ps_demux_save_index (demux, index_location);
+        g_free (index_location);
+      }
       gst_ps_demux_reset (demux);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
@@ -156,6 +156,17 @@ struct _GstPsDemux
 
   /* Indicates an MPEG-2 stream */
   gboolean is_mpeg2_pack;
+
+  /* Seek index of GstPsDemuxIndexEntry, sorted by offset and SCR. Only
+   * filled in pull mode */
+  GArray *index;
+  /* Sidecar file to load/save the index from/to (protected by OBJECT_LOCK,
+   * NULL if unused) */
+  gchar *index_location;
+  /* Upstream size in bytes, used to validate the index */
+  guint64 upstream_size;
+  /* Offset to start demuxing from after the duration scan */
+  guint64 start_offset;
 };
 
 struct _GstPsDemuxClass
@@ -54,10 +54,14 @@ GST_DEBUG_CATEGORY (mpegpsmux_debug);
 
 enum
 {
-  PROP_AGGREGATE_GOPS = 1
+  PROP_AGGREGATE_GOPS = 1,
+  PROP_WRITE_SIZE,
+  PROP_WRITE_LATENCY
 };
 
 #define DEFAULT_AGGREGATE_GOPS FALSE
+#define DEFAULT_WRITE_SIZE 0
+#define DEFAULT_WRITE_LATENCY (100 * GST_MSECOND)
 
 static GstStaticPadTemplate mpegpsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%u",
@@ -95,6 +99,8 @@ static void gst_mpegpsmux_get_property (GObject * object, guint prop_id,
 
 static void mpegpsmux_finalize (GObject * object);
 static gboolean new_packet_cb (guint8 * data, guint len, void *user_data);
+static GstFlowReturn mpegpsmux_flush_output (MpegPsMux * mux);
+static void mpegpsmux_clear_output (MpegPsMux * mux);
 
 static gboolean mpegpsdemux_prepare_srcpad (MpegPsMux * mux);
 static GstFlowReturn mpegpsmux_collected (GstCollectPads * pads,
@@ -127,6 +133,35 @@ mpegpsmux_class_init (MpegPsMuxClass * klass)
           "Whether to aggregate GOPs and push them out as buffer lists",
           DEFAULT_AGGREGATE_GOPS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * MpegPsMux:write-size:
+   *
+   * Gather the output packets into buffers of up to this many bytes, so
+   * that downstream writers get fewer and larger writes. 0 outputs every
+   * packet as its own buffer.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WRITE_SIZE,
+      g_param_spec_uint ("write-size", "Write size",
+          "Gather output packets into buffers of up to this many bytes "
+          "(0 = disabled)", 0, G_MAXINT, DEFAULT_WRITE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MpegPsMux:write-latency:
+   *
+   * Maximum time span of the packets gathered into one buffer when
+   * #MpegPsMux:write-size is set.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_WRITE_LATENCY,
+      g_param_spec_uint64 ("write-latency", "Write latency",
+          "Maximum time span of the packets gathered into one buffer (in ns)",
+          0, G_MAXUINT64, DEFAULT_WRITE_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class,
       &mpegpsmux_sink_factory);
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -156,6 +191,9 @@ mpegpsmux_init (MpegPsMux * mux)
   mux->first = TRUE;
   mux->last_flow_ret = GST_FLOW_OK;
   mux->last_ts = 0;             /* XXX: or -1? */
+
+  mux->write_size = DEFAULT_WRITE_SIZE;
+  mux->write_latency = DEFAULT_WRITE_LATENCY;
 }
 
 static void
@@ -177,6 +215,8 @@ mpegpsmux_finalize (GObject * object)
     mux->gop_list = NULL;
   }
 
+  mpegpsmux_clear_output (mux);
+
   G_OBJECT_CLASS (mpegpsmux_parent_class)->finalize (object);
 }
 
@@ -190,6 +230,12 @@ gst_mpegpsmux_set_property (GObject * object, guint prop_id,
     case PROP_AGGREGATE_GOPS:
       mux->aggregate_gops = g_value_get_boolean (value);
       break;
+    case PROP_WRITE_SIZE:
+      mux->write_size = g_value_get_uint (value);
+      break;
+    case PROP_WRITE_LATENCY:
+      mux->write_latency = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -206,6 +252,12 @@ gst_mpegpsmux_get_property (GObject * object, guint prop_id,
     case PROP_AGGREGATE_GOPS:
       g_value_set_boolean (value, mux->aggregate_gops);
       break;
+    case PROP_WRITE_SIZE:
+      g_value_set_uint (value, mux->write_size);
+      break;
+    case PROP_WRITE_LATENCY:
+      g_value_set_uint64 (value, mux->write_latency);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -548,11 +600,18 @@ mpegpsmux_collected (GstCollectPads * pads, MpegPsMux * mux)
     /* start of new GOP? */
     keyunit = !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
 
-    if (keyunit && best->stream_id == mux->video_stream_id
-        && mux->gop_list != NULL) {
-      ret = mpegpsmux_push_gop_list (mux);
-      if (ret != GST_FLOW_OK)
-        goto done;
+    if (keyunit && best->stream_id == mux->video_stream_id) {
+      /* the gathered packets belong to the previous GOP */
+      if (mux->aggregate_gops && mux->out_buf != NULL) {
+        ret = mpegpsmux_flush_output (mux);
+        if (ret != GST_FLOW_OK)
+          goto done;
+      }
+      if (mux->gop_list != NULL) {
+        ret = mpegpsmux_push_gop_list (mux);
+        if (ret != GST_FLOW_OK)
+          goto done;
+      }
     }
 
     /* give the buffer to libpsmux for processing */
@@ -572,12 +631,15 @@ mpegpsmux_collected (GstCollectPads * pads, MpegPsMux * mux)
   } else {
     /* FIXME: Drain all remaining streams */
     /* At EOS */
-    if (mux->gop_list != NULL)
-      mpegpsmux_push_gop_list (mux);
-
     if (!psmux_write_end_code (mux->psmux)) {
       GST_WARNING_OBJECT (mux, "Writing MPEG PS Program end code failed.");
     }
+
+    if (mux->out_buf != NULL)
+      mpegpsmux_flush_output (mux);
+    if (mux->gop_list != NULL)
+      mpegpsmux_push_gop_list (mux);
+
     gst_pad_push_event (mux->srcpad, gst_event_new_eos ());
 
     ret = GST_FLOW_EOS;
@@ -658,6 +720,106 @@ mpegpsmux_release_pad (GstElement * element, GstPad * pad)
   gst_collect_pads_remove_pad (mux->collect, pad);
 }
 
+static GstFlowReturn
+mpegpsmux_output (MpegPsMux * mux, GstBuffer * buf)
+{
+  if (mux->aggregate_gops) {
+    if (mux->gop_list == NULL)
+      mux->gop_list = gst_buffer_list_new ();
+
+    gst_buffer_list_add (mux->gop_list, buf);
+    return GST_FLOW_OK;
+  }
+
+  return gst_pad_push (mux->srcpad, buf);
+}
+
+/* outputs the packets gathered so far */
+static GstFlowReturn
+mpegpsmux_flush_output (MpegPsMux * mux)
+{
+  GstBuffer *buf = mux->out_buf;
+
+  if (buf == NULL)
+    return GST_FLOW_OK;
+
+  gst_buffer_unmap (buf, &mux->out_map);
+  gst_buffer_resize (buf, 0, mux->out_offset);
+  GST_BUFFER_TIMESTAMP (buf) = mux->out_ts;
+  mux->out_buf = NULL;
+
+  GST_LOG_OBJECT (mux, "Outputting %" G_GSIZE_FORMAT " bytes of packets",
+      mux->out_offset);
+
+  return mpegpsmux_output (mux, buf);
+}
+
+static void
+mpegpsmux_clear_output (MpegPsMux * mux)
+{
+  if (mux->out_buf) {
+    gst_buffer_unmap (mux->out_buf, &mux->out_map);
+    gst_buffer_unref (mux->out_buf);
+    mux->out_buf = NULL;
+  }
+  if (mux->pool) {
+    gst_buffer_pool_set_active (mux->pool, FALSE);
+    gst_object_unref (mux->pool);
+    mux->pool = NULL;
+  }
+}
+
+static gboolean
+mpegpsmux_gather_packet (MpegPsMux * mux, const guint8 * data, guint len)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (mux->out_buf != NULL && (mux->out_offset + len > mux->write_size ||
+          (GST_CLOCK_TIME_IS_VALID (mux->out_ts) &&
+              mux->last_ts > mux->out_ts + mux->write_latency)))
+    ret = mpegpsmux_flush_output (mux);
+
+  if (ret == GST_FLOW_OK && mux->out_buf == NULL) {
+    if (mux->pool != NULL) {
+      GstStructure *config = gst_buffer_pool_get_config (mux->pool);
+      guint size = 0;
+
+      /* write-size may have changed since the pool was made */
+      gst_buffer_pool_config_get_params (config, NULL, &size, NULL, NULL);
+      gst_structure_free (config);
+      if (size != mux->write_size)
+        mpegpsmux_clear_output (mux);
+    }
+
+    if (mux->pool == NULL) {
+      GstStructure *config;
+
+      mux->pool = gst_buffer_pool_new ();
+      config = gst_buffer_pool_get_config (mux->pool);
+      gst_buffer_pool_config_set_params (config, NULL, mux->write_size, 0, 0);
+      gst_buffer_pool_set_config (mux->pool, config);
+      gst_buffer_pool_set_active (mux->pool, TRUE);
+    }
+
+    ret = gst_buffer_pool_acquire_buffer (mux->pool, &mux->out_buf, NULL);
+    if (ret == GST_FLOW_OK) {
+      gst_buffer_map (mux->out_buf, &mux->out_map, GST_MAP_WRITE);
+      mux->out_offset = 0;
+      mux->out_ts = mux->last_ts;
+    }
+  }
+
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    mux->last_flow_ret = ret;
+    return FALSE;
+  }
+
+  memcpy (mux->out_map.data + mux->out_offset, data, len);
+  mux->out_offset += len;
+
+  return TRUE;
+}
+
 static gboolean
 new_packet_cb (guint8 * data, guint len, void *user_data)
 {
@@ -670,20 +832,22 @@ new_packet_cb (guint8 * data, guint len, void *user_data)
 
   GST_LOG_OBJECT (mux, "Outputting a packet of length %d", len);
 
+  if (mux->write_size > 0 && len <= mux->write_size)
+    return mpegpsmux_gather_packet (mux, data, len);
+
+  /* keep the order with the packets gathered so far */
+  ret = mpegpsmux_flush_output (mux);
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    mux->last_flow_ret = ret;
+    return FALSE;
+  }
+
   data = g_memdup (data, len);
   buf = gst_buffer_new_wrapped (data, len);
 
   GST_BUFFER_TIMESTAMP (buf) = mux->last_ts;
 
-  if (mux->aggregate_gops) {
-    if (mux->gop_list == NULL)
-      mux->gop_list = gst_buffer_list_new ();
-
-    gst_buffer_list_add (mux->gop_list, buf);
-    return TRUE;
-  }
-
-  ret = gst_pad_push (mux->srcpad, buf);
+  ret = mpegpsmux_output (mux, buf);
 
   if (G_UNLIKELY (ret != GST_FLOW_OK)) {
     mux->last_flow_ret = ret;
@@ -753,6 +917,7 @@ mpegpsmux_change_state (GstElement * element, GstStateChange transition)
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_collect_pads_stop (mux->collect);
+      mpegpsmux_clear_output (mux);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
       break;
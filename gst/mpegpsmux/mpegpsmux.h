@@ -81,6 +81,15 @@ struct MpegPsMux {
 
   GstBufferList *gop_list;
   gboolean       aggregate_gops;
+
+  /* packets are gathered into pooled buffers of write_size bytes */
+  guint          write_size;
+  GstClockTime   write_latency;
+  GstBufferPool *pool;
+  GstBuffer     *out_buf;
+  GstMapInfo     out_map;
+  gsize          out_offset;
+  GstClockTime   out_ts;
 };
 
 struct MpegPsMuxClass  {
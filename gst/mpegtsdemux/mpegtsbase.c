@@ -206,6 +206,9 @@ mpegts_base_reset (MpegTSBase * base)
   base->mode = BASE_MODE_STREAMING;
   base->seen_pat = FALSE;
   base->seek_offset = -1;
+  base->upstream_size = -1;
+  base->has_index_checksum = FALSE;
+  base->index_values = -1;
 
   g_hash_table_foreach_remove (base->programs, (GHRFunc) remove_each_program,
       base);
@@ -217,6 +220,9 @@ mpegts_base_reset (MpegTSBase * base)
 
   if (klass->reset)
     klass->reset (base);
+
+  /* Subclasses might have added known PSI PIDs */
+  base->pid_table_dirty = TRUE;
 }
 
 static void
@@ -238,6 +244,7 @@ mpegts_base_init (MpegTSBase * base)
   base->parse_private_sections = FALSE;
   base->is_pes = g_new0 (guint8, 1024);
   base->known_psi = g_new0 (guint8, 1024);
+  base->pid_table = g_new0 (guint8, 0x2000);
   base->program_size = sizeof (MpegTSBaseProgram);
   base->stream_size = sizeof (MpegTSBaseStream);
 
@@ -257,6 +264,7 @@ mpegts_base_dispose (GObject * object)
     base->disposed = TRUE;
     g_free (base->known_psi);
     g_free (base->is_pes);
+    g_free (base->pid_table);
   }
 
   if (G_OBJECT_CLASS (parent_class)->dispose)
@@ -273,6 +281,7 @@ mpegts_base_finalize (GObject * object)
     base->pat = NULL;
   }
   g_hash_table_destroy (base->programs);
+  g_free (base->index_location);
 
   if (G_OBJECT_CLASS (parent_class)->finalize)
     G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -416,6 +425,7 @@ mpegts_base_add_program (MpegTSBase * base,
         pmt_pid);
   }
   MPEGTS_BIT_SET (base->known_psi, pmt_pid);
+  base->pid_table_dirty = TRUE;
 
   g_hash_table_insert (base->programs,
       GINT_TO_POINTER (program_number), program);
@@ -862,6 +872,7 @@ mpegts_base_deactivate_program (MpegTSBase * base, MpegTSBaseProgram * program)
     mpegts_base_program_remove_stream (base, program, program->pcr_pid);
     if (!mpegts_pid_in_active_programs (base, program->pcr_pid))
       MPEGTS_BIT_UNSET (base->is_pes, program->pcr_pid);
+    base->pid_table_dirty = TRUE;
 
     GST_DEBUG ("program stream_list is now %p", program->stream_list);
   }
@@ -924,6 +935,7 @@ mpegts_base_activate_program (MpegTSBase * base, MpegTSBaseProgram * program,
    * streams above, no new stream will be created */
   mpegts_base_program_add_stream (base, program, pmt->pcr_pid, -1, NULL);
   MPEGTS_BIT_SET (base->is_pes, pmt->pcr_pid);
+  base->pid_table_dirty = TRUE;
 
   program->active = TRUE;
   program->initial_program = initial_program;
@@ -1042,6 +1054,8 @@ mpegts_base_apply_pat (MpegTSBase * base, GstMpegtsSection * section)
     g_ptr_array_unref (old_pat);
   }
 
+  base->pid_table_dirty = TRUE;
+
   return TRUE;
 }
 
@@ -1199,6 +1213,7 @@ mpegts_base_parse_atsc_mgt (MpegTSBase * base, GstMpegtsSection * section)
         (table->table_type >= GST_MPEGTS_ATSC_MGT_TABLE_TYPE_ETT0 &&
             table->table_type <= GST_MPEGTS_ATSC_MGT_TABLE_TYPE_ETT127)) {
       MPEGTS_BIT_SET (base->known_psi, table->pid);
+      base->pid_table_dirty = TRUE;
     }
   }
 
@@ -1356,6 +1371,36 @@ mpegts_base_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return res;
 }
 
+static void
+mpegts_base_rebuild_pid_table (MpegTSBase * base)
+{
+  guint i, j;
+
+  GST_DEBUG_OBJECT (base, "Rebuilding PID dispatch table");
+
+  for (i = 0; i < 1024; i++) {
+    guint8 pes = base->is_pes[i], psi = base->known_psi[i];
+    guint8 *entry = base->pid_table + (i << 3);
+
+    if (G_LIKELY ((pes | psi) == 0)) {
+      memset (entry, MPEGTS_BASE_PID_UNKNOWN, 8);
+      continue;
+    }
+
+    /* PES has precedence, like in the packet loop before this table */
+    for (j = 0; j < 8; j++) {
+      if (pes & (1 << j))
+        entry[j] = MPEGTS_BASE_PID_PES;
+      else if (psi & (1 << j))
+        entry[j] = MPEGTS_BASE_PID_PSI;
+      else
+        entry[j] = MPEGTS_BASE_PID_UNKNOWN;
+    }
+  }
+
+  base->pid_table_dirty = FALSE;
+}
+
 static GstFlowReturn
 mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -1394,7 +1439,12 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   mpegts_packetizer_push (base->packetizer, buf);
 
+  if (G_UNLIKELY (base->pid_table_dirty))
+    mpegts_base_rebuild_pid_table (base);
+
   while (res == GST_FLOW_OK) {
+    guint8 pid_type;
+
     pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
 
     /* If we don't have enough data, return */
@@ -1410,13 +1460,14 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
     if (klass->inspect_packet)
       klass->inspect_packet (base, &packet);
 
+    pid_type = base->pid_table[packet.pid];
+
     /* If it's a known PES, push it */
-    if (MPEGTS_BIT_IS_SET (base->is_pes, packet.pid)) {
+    if (pid_type == MPEGTS_BASE_PID_PES) {
       /* push the packet downstream */
       if (base->push_data)
         res = klass->push (base, &packet, NULL);
-    } else if (packet.payload
-        && MPEGTS_BIT_IS_SET (base->known_psi, packet.pid)) {
+    } else if (packet.payload && pid_type == MPEGTS_BASE_PID_PSI) {
       /* base PSI data */
       GList *others, *tmp;
       GstMpegtsSection *section;
@@ -1430,6 +1481,10 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
         g_list_free (others);
       }
 
+      /* Sections (PAT/PMT/...) might have changed the PID assignment */
+      if (G_UNLIKELY (base->pid_table_dirty))
+        mpegts_base_rebuild_pid_table (base);
+
       /* we need to push section packet downstream */
       if (base->push_section)
         res = klass->push (base, &packet, section);
@@ -1451,6 +1506,42 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return res;
 }
 
+/* Bytes at the start and at the end of upstream that identify the stream
+ * for the seek index, on top of its size */
+#define INDEX_CHECKSUM_BYTES 16384
+
+static gboolean
+mpegts_base_checksum_upstream (MpegTSBase * base, guint64 upstream_size,
+    guint8 * checksum)
+{
+  GChecksum *sha1 = g_checksum_new (G_CHECKSUM_SHA1);
+  guint64 length = MIN (upstream_size, INDEX_CHECKSUM_BYTES);
+  guint64 offsets[2] = { 0, upstream_size - length };
+  gsize checksum_size = MPEGTS_INDEX_CHECKSUM_SIZE;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (offsets); i++) {
+    GstBuffer *buf = NULL;
+    GstMapInfo map;
+
+    if (gst_pad_pull_range (base->sinkpad, offsets[i], length,
+            &buf) != GST_FLOW_OK) {
+      GST_DEBUG_OBJECT (base, "Couldn't read stream to checksum it");
+      g_checksum_free (sha1);
+      return FALSE;
+    }
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    g_checksum_update (sha1, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  g_checksum_get_digest (sha1, checksum, &checksum_size);
+  g_checksum_free (sha1);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 mpegts_base_scan (MpegTSBase * base)
 {
@@ -1463,6 +1554,7 @@ mpegts_base_scan (MpegTSBase * base)
   gint64 upstream_size, seek_pos, reverse_limit;
   GstFormat format;
   guint initial_pcr_seen;
+  gchar *index_location;
 
   GST_DEBUG ("Scanning for initial sync point");
 
@@ -1513,6 +1605,30 @@ mpegts_base_scan (MpegTSBase * base)
   if (!gst_pad_peer_query_duration (base->sinkpad, format, &tmpval))
     goto beach;
   upstream_size = tmpval;
+  base->upstream_size = upstream_size;
+
+  /* If we have an index for this stream, it already contains all the
+   * PCR observations the backward scan would give us (and more) */
+  GST_OBJECT_LOCK (base);
+  index_location = g_strdup (base->index_location);
+  GST_OBJECT_UNLOCK (base);
+  if (index_location) {
+    gboolean loaded = FALSE;
+
+    base->has_index_checksum = mpegts_base_checksum_upstream (base,
+        upstream_size, base->index_checksum);
+    if (base->has_index_checksum)
+      loaded = mpegts_packetizer_load_index (base->packetizer,
+          index_location, upstream_size, base->index_checksum);
+
+    g_free (index_location);
+    if (loaded) {
+      GST_DEBUG_OBJECT (base, "Using seek index, skipping backward scan");
+      base->index_values =
+          mpegts_packetizer_get_index_values (base->packetizer);
+      goto beach;
+    }
+  }
 
   /* The scanning takes place on the last 2048kB. Considering PCR should
    * be present at least every 100ms, this should cope with streams
@@ -1840,6 +1956,25 @@ mpegts_base_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* The streaming task is stopped, store what we learnt about the
+       * PCR/offset mapping before it gets cleared */
+      if (base->mode != BASE_MODE_PUSHING && base->has_index_checksum) {
+        gchar *index_location;
+
+        GST_OBJECT_LOCK (base);
+        index_location = g_strdup (base->index_location);
+        GST_OBJECT_UNLOCK (base);
+        /* Don't rewrite an index we loaded if playback didn't add to it */
+        if (index_location && base->index_values != -1 &&
+            mpegts_packetizer_get_index_values (base->packetizer) ==
+            base->index_values) {
+          GST_DEBUG_OBJECT (base, "Seek index unchanged, not saving");
+        } else if (index_location) {
+          mpegts_packetizer_save_index (base->packetizer, index_location,
+              base->upstream_size, base->index_checksum);
+        }
+        g_free (index_location);
+      }
       mpegts_base_reset (base);
       if (base->mode != BASE_MODE_PUSHING)
         base->mode = BASE_MODE_SCANNING;
@@ -132,6 +132,12 @@ struct _MpegTSBase {
   guint8 *known_psi;
   guint8 *is_pes;
 
+  /* Flattened view of the above (one MpegTSBasePIDType per PID) used by the
+   * packet loop. Must be marked dirty whenever known_psi/is_pes change, it
+   * is then rebuilt before the next packet is dispatched */
+  guint8 *pid_table;
+  gboolean pid_table_dirty;
+
   gboolean disposed;
 
   /* size of the MpegTSBaseProgram structure, can be overridden
@@ -161,6 +167,17 @@ struct _MpegTSBase {
   /* Whether the parent bin is streams-aware, meaning we can
    * add/remove streams at any point in time */
   gboolean streams_aware;
+
+  /* Seek index sidecar file to load/save PCR observations from/to in pull
+   * mode (protected by OBJECT_LOCK, NULL if unused) */
+  gchar *index_location;
+  /* Upstream size in bytes seen when scanning, used to validate the index */
+  guint64 upstream_size;
+  /* Checksum of the start and end of upstream, valid if has_index_checksum */
+  guint8 index_checksum[MPEGTS_INDEX_CHECKSUM_SIZE];
+  gboolean has_index_checksum;
+  /* Number of PCR values in the index that was loaded, -1 if none was */
+  gint index_values;
 };
 
 struct _MpegTSBaseClass {
@@ -213,6 +230,12 @@ struct _MpegTSBaseClass {
   void (*eit_info) (GstStructure *eit);
 };
 
+typedef enum {
+  MPEGTS_BASE_PID_UNKNOWN = 0,
+  MPEGTS_BASE_PID_PSI,
+  MPEGTS_BASE_PID_PES
+} MpegTSBasePIDType;
+
 #define MPEGTS_BIT_SET(field, offs)    ((field)[(offs) >> 3] |=  (1 << ((offs) & 0x7)))
 #define MPEGTS_BIT_UNSET(field, offs)  ((field)[(offs) >> 3] &= ~(1 << ((offs) & 0x7)))
 #define MPEGTS_BIT_IS_SET(field, offs) ((field)[(offs) >> 3] &   (1 << ((offs) & 0x7)))
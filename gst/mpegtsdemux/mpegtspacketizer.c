@@ -25,6 +25,15 @@
 #include <string.h>
 #include <stdlib.h>
 
+/* Vectorized sync byte scanning, picked at runtime on x86 */
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+#define HAVE_SCAN_SYNC_X86 1
+#include <immintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define HAVE_SCAN_SYNC_NEON 1
+#include <arm_neon.h>
+#endif
+
 /* Skew calculation pameters */
 #define MAX_TIME	(2 * GST_SECOND)
 
@@ -33,6 +42,9 @@
 #define PCR_GST_MAX_VALUE (PCR_MAX_VALUE * GST_MSECOND / (PCR_MSECOND))
 #define PTS_DTS_MAX_VALUE (((guint64)1) << 33)
 
+#include <gst/base/gstbytereader.h>
+#include <gst/base/gstbytewriter.h>
+
 #include "mpegtspacketizer.h"
 #include "gstmpegdesc.h"
 
@@ -40,6 +52,7 @@ GST_DEBUG_CATEGORY_STATIC (mpegts_packetizer_debug);
 #define GST_CAT_DEFAULT mpegts_packetizer_debug
 
 static void _init_local (void);
+static MpegTSScanSyncFunc mpegts_packetizer_get_scan_sync (void);
 G_DEFINE_TYPE_EXTENDED (MpegTSPacketizer2, mpegts_packetizer, G_TYPE_OBJECT, 0,
     _init_local ());
 
@@ -261,6 +274,9 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->map_size = 0;
   packetizer->map_offset = 0;
   packetizer->need_sync = FALSE;
+  packetizer->scan_sync = mpegts_packetizer_get_scan_sync ();
+  packetizer->zero_copy = FALSE;
+  packetizer->map_buffer = NULL;
 
   memset (packetizer->pcrtablelut, 0xff, 0x2000);
   memset (packetizer->observations, 0x0, sizeof (packetizer->observations));
@@ -272,12 +288,27 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->pcr_discont_threshold = GST_SECOND;
 }
 
+static void
+mpegts_packetizer_release_map (MpegTSPacketizer2 * packetizer)
+{
+  if (packetizer->map_buffer) {
+    gst_buffer_unmap (packetizer->map_buffer, &packetizer->map_info);
+    gst_buffer_unref (packetizer->map_buffer);
+    packetizer->map_buffer = NULL;
+  }
+
+  packetizer->map_data = NULL;
+  packetizer->map_size = 0;
+  packetizer->map_offset = 0;
+}
+
 static void
 mpegts_packetizer_dispose (GObject * object)
 {
   MpegTSPacketizer2 *packetizer = GST_MPEGTS_PACKETIZER (object);
 
   if (!packetizer->disposed) {
+    mpegts_packetizer_release_map (packetizer);
     if (packetizer->packet_size)
       packetizer->packet_size = 0;
     if (packetizer->streams) {
@@ -571,13 +602,11 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
     memset (packetizer->streams, 0, 8192 * sizeof (MpegTSPacketizerStream *));
   }
 
+  mpegts_packetizer_release_map (packetizer);
   gst_adapter_clear (packetizer->adapter);
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -610,14 +639,12 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer, gboolean hard)
       }
     }
   }
+  mpegts_packetizer_release_map (packetizer);
   gst_adapter_clear (packetizer->adapter);
 
   packetizer->offset = 0;
   packetizer->empty = TRUE;
   packetizer->need_sync = FALSE;
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
   packetizer->last_in_time = GST_CLOCK_TIME_NONE;
 
   pcrtable = packetizer->observations[packetizer->pcrtablelut[0x1fff]];
@@ -651,6 +678,22 @@ mpegts_packetizer_remove_stream (MpegTSPacketizer2 * packetizer, gint16 pid)
   }
 }
 
+GstBuffer *
+mpegts_packetizer_share_data (MpegTSPacketizer2 * packetizer,
+    const guint8 * data, gsize size)
+{
+  gsize offset;
+
+  g_return_val_if_fail (packetizer->map_buffer != NULL, NULL);
+  g_return_val_if_fail (data >= packetizer->map_data, NULL);
+
+  offset = data - packetizer->map_data;
+  g_return_val_if_fail (offset + size <= packetizer->map_size, NULL);
+
+  return gst_buffer_copy_region (packetizer->map_buffer, GST_BUFFER_COPY_MEMORY,
+      offset, size);
+}
+
 MpegTSPacketizer2 *
 mpegts_packetizer_new (void)
 {
@@ -682,14 +725,12 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
 static void
 mpegts_packetizer_flush_bytes (MpegTSPacketizer2 * packetizer, gsize size)
 {
+  mpegts_packetizer_release_map (packetizer);
+
   if (size > 0) {
     GST_LOG ("flushing %" G_GSIZE_FORMAT " bytes from adapter", size);
     gst_adapter_flush (packetizer->adapter, size);
   }
-
-  packetizer->map_data = NULL;
-  packetizer->map_size = 0;
-  packetizer->map_offset = 0;
 }
 
 static gboolean
@@ -706,10 +747,26 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   if (available < size)
     return FALSE;
 
-  packetizer->map_data =
-      (guint8 *) gst_adapter_map (packetizer->adapter, available);
-  if (!packetizer->map_data)
-    return FALSE;
+  if (packetizer->zero_copy) {
+    /* Only merges (copies) if the data spans several input buffers, which
+     * gst_adapter_map() would have to do as well */
+    packetizer->map_buffer =
+        gst_adapter_get_buffer (packetizer->adapter, available);
+    if (!packetizer->map_buffer)
+      return FALSE;
+    if (!gst_buffer_map (packetizer->map_buffer, &packetizer->map_info,
+            GST_MAP_READ)) {
+      gst_buffer_unref (packetizer->map_buffer);
+      packetizer->map_buffer = NULL;
+      return FALSE;
+    }
+    packetizer->map_data = packetizer->map_info.data;
+  } else {
+    packetizer->map_data =
+        (guint8 *) gst_adapter_map (packetizer->adapter, available);
+    if (!packetizer->map_data)
+      return FALSE;
+  }
 
   packetizer->map_size = available;
   packetizer->map_offset = 0;
@@ -719,11 +776,185 @@ mpegts_packetizer_map (MpegTSPacketizer2 * packetizer, gsize size)
   return TRUE;
 }
 
+#define SYNC_BYTE_PATTERN G_GUINT64_CONSTANT (0x4747474747474747)
+#define SWAR_ONES G_GUINT64_CONSTANT (0x0101010101010101)
+#define SWAR_HIGHS G_GUINT64_CONSTANT (0x8080808080808080)
+
+/* The sync byte scanners return the first offset i in [start, end[ for which
+ * data[i + k * stride] is a sync byte for all k in [0, count[, or end if
+ * there is none.
+ *
+ * The caller guarantees that data[end - 1 + (count - 1) * stride] is valid.
+ *
+ * They all check several candidate offsets at once, the scalar loop being
+ * used for the tail (and to confirm a hit where they can't locate it) */
+static gsize
+mpegts_packetizer_scan_sync_scalar (const guint8 * data, gsize start,
+    gsize end, guint stride, guint count)
+{
+  gsize i;
+  guint k;
+
+  for (i = start; i < end; i++) {
+    for (k = 0; k < count; k++) {
+      if (data[i + k * stride] != PACKET_SYNC_BYTE)
+        break;
+    }
+    if (k == count)
+      return i;
+  }
+
+  return end;
+}
+
+/* Eight candidates per iteration, by loading 64 bits at each stride and
+ * looking for a zero byte in the OR of the XOR'ed words */
+static gsize
+mpegts_packetizer_scan_sync_swar (const guint8 * data, gsize start,
+    gsize end, guint stride, guint count)
+{
+  gsize i = start;
+  guint k;
+
+  while (i + 8 <= end) {
+    guint64 acc = 0, zero;
+
+    for (k = 0; k < count; k++)
+      acc |= GST_READ_UINT64_LE (data + i + k * stride) ^ SYNC_BYTE_PATTERN;
+
+    zero = (acc - SWAR_ONES) & ~acc & SWAR_HIGHS;
+    if (G_UNLIKELY (zero))
+      break;
+
+    i += 8;
+  }
+
+  return mpegts_packetizer_scan_sync_scalar (data, i, end, stride, count);
+}
+
+#ifdef HAVE_SCAN_SYNC_X86
+/* 16 (SSE2) or 32 (AVX2) candidates per iteration, the first bit of the
+ * mask of the byte comparisons ANDed over the strides is the first hit */
+__attribute__ ((target ("sse2")))
+static gsize
+mpegts_packetizer_scan_sync_sse2 (const guint8 * data, gsize start,
+    gsize end, guint stride, guint count)
+{
+  const __m128i sync = _mm_set1_epi8 (PACKET_SYNC_BYTE);
+  gsize i = start;
+  guint k;
+
+  while (i + 16 <= end) {
+    __m128i eq = _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *)
+            (data + i)), sync);
+    guint mask;
+
+    for (k = 1; k < count; k++)
+      eq = _mm_and_si128 (eq, _mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i
+                      *) (data + i + k * stride)), sync));
+
+    mask = _mm_movemask_epi8 (eq);
+    if (G_UNLIKELY (mask))
+      return i + __builtin_ctz (mask);
+
+    i += 16;
+  }
+
+  return mpegts_packetizer_scan_sync_scalar (data, i, end, stride, count);
+}
+
+__attribute__ ((target ("avx2")))
+static gsize
+mpegts_packetizer_scan_sync_avx2 (const guint8 * data, gsize start,
+    gsize end, guint stride, guint count)
+{
+  const __m256i sync = _mm256_set1_epi8 (PACKET_SYNC_BYTE);
+  gsize i = start;
+  guint k;
+
+  while (i + 32 <= end) {
+    __m256i eq = _mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *)
+            (data + i)), sync);
+    guint32 mask;
+
+    for (k = 1; k < count; k++)
+      eq = _mm256_and_si256 (eq,
+          _mm256_cmpeq_epi8 (_mm256_loadu_si256 ((const __m256i *)
+                  (data + i + k * stride)), sync));
+
+    mask = _mm256_movemask_epi8 (eq);
+    if (G_UNLIKELY (mask))
+      return i + __builtin_ctz (mask);
+
+    i += 32;
+  }
+
+  return mpegts_packetizer_scan_sync_sse2 (data, i, end, stride, count);
+}
+#endif
+
+#ifdef HAVE_SCAN_SYNC_NEON
+/* 16 candidates per iteration, NEON has no movemask so the scalar loop
+ * locates the hit in the block */
+static gsize
+mpegts_packetizer_scan_sync_neon (const guint8 * data, gsize start,
+    gsize end, guint stride, guint count)
+{
+  const uint8x16_t sync = vdupq_n_u8 (PACKET_SYNC_BYTE);
+  gsize i = start;
+  guint k;
+
+  while (i + 16 <= end) {
+    uint8x16_t eq = vceqq_u8 (vld1q_u8 (data + i), sync);
+    uint64x2_t eq64;
+
+    for (k = 1; k < count; k++)
+      eq = vandq_u8 (eq, vceqq_u8 (vld1q_u8 (data + i + k * stride), sync));
+
+    eq64 = vreinterpretq_u64_u8 (eq);
+    if (G_UNLIKELY (vgetq_lane_u64 (eq64, 0) | vgetq_lane_u64 (eq64, 1)))
+      break;
+
+    i += 16;
+  }
+
+  return mpegts_packetizer_scan_sync_scalar (data, i, end, stride, count);
+}
+#endif
+
+/* Picks the fastest scanner the CPU supports. GST_MPEGTS_SCAN_SYNC can name
+ * one of "swar", "sse2", "avx2" or "neon" to use it instead if available,
+ * which the tests use to compare them */
+static MpegTSScanSyncFunc
+mpegts_packetizer_get_scan_sync (void)
+{
+  const gchar *name = g_getenv ("GST_MPEGTS_SCAN_SYNC");
+
+  if (!g_strcmp0 (name, "swar"))
+    return mpegts_packetizer_scan_sync_swar;
+
+#ifdef HAVE_SCAN_SYNC_X86
+  __builtin_cpu_init ();
+  if (name && !strcmp (name, "sse2") && __builtin_cpu_supports ("sse2"))
+    return mpegts_packetizer_scan_sync_sse2;
+  if (__builtin_cpu_supports ("avx2"))
+    return mpegts_packetizer_scan_sync_avx2;
+  if (__builtin_cpu_supports ("sse2"))
+    return mpegts_packetizer_scan_sync_sse2;
+#endif
+
+#ifdef HAVE_SCAN_SYNC_NEON
+  return mpegts_packetizer_scan_sync_neon;
+#endif
+
+  return mpegts_packetizer_scan_sync_swar;
+}
+
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
   guint8 *data;
-  gsize size, i, j;
+  gsize size, i, j, end;
 
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -738,25 +969,20 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   size = packetizer->map_size - packetizer->map_offset;
   data = packetizer->map_data + packetizer->map_offset;
 
-  for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
-    /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
-
-    /* check for 4 consecutive sync bytes with each possible packet size */
-    for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
-      guint packet_size = psizes[j];
-
-      if (data[i + packet_size] == PACKET_SYNC_BYTE &&
-          data[i + 2 * packet_size] == PACKET_SYNC_BYTE &&
-          data[i + 3 * packet_size] == PACKET_SYNC_BYTE) {
-        packetizer->packet_size = packet_size;
-        goto out;
-      }
+  /* look for 4 consecutive sync bytes with each possible packet size,
+   * keeping the earliest offset (and the first packet size in case of
+   * a tie). Each following scan can stop at the best offset so far */
+  end = i = size - 3 * MPEGTS_MAX_PACKETSIZE;
+  for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
+    gsize found = packetizer->scan_sync (data, 0, end, psizes[j], 4);
+
+    if (found < i) {
+      i = found;
+      end = found;
+      packetizer->packet_size = psizes[j];
     }
   }
 
-out:
   packetizer->map_offset += i;
 
   if (packetizer->packet_size == 0) {
@@ -781,7 +1007,7 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   gboolean found = FALSE;
   guint8 *data;
   guint packet_size;
-  gsize size, sync_offset, i;
+  gsize size, sync_offset, i, end;
 
   packet_size = packetizer->packet_size;
 
@@ -796,13 +1022,12 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   else
     sync_offset = 0;
 
-  for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
-        data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
-      found = TRUE;
-      break;
-    }
+  end = size - 2 * packet_size;
+  if (sync_offset < end) {
+    i = packetizer->scan_sync (data, sync_offset, end, packet_size, 3);
+    found = (i < end);
+  } else {
+    i = sync_offset;
   }
 
   packetizer->map_offset += i - sync_offset;
@@ -2539,3 +2764,198 @@ mpegts_packetizer_set_current_pcr_offset (MpegTSPacketizer2 * packetizer,
   }
   PACKETIZER_GROUP_UNLOCK (packetizer);
 }
+
+/* Seek index sidecar
+ *
+ * All values are big-endian:
+ *   "TSIX" | version (u32) | file size (u64) | checksum (20 bytes) |
+ *   n tables (u16)
+ * For each table:
+ *   pid (u16) | n groups (u32)
+ * For each group:
+ *   flags (u32) | first_pcr (u64) | first_offset (u64) | pcr_offset (u64) |
+ *   n values (u32) | n * (pcr (u64) | offset (u64))
+ */
+#define INDEX_MAGIC GST_MAKE_FOURCC ('T', 'S', 'I', 'X')
+#define INDEX_VERSION 2
+
+gboolean
+mpegts_packetizer_save_index (MpegTSPacketizer2 * packetizer,
+    const gchar * filename, guint64 file_size, const guint8 * checksum)
+{
+  GstByteWriter bw;
+  GError *err = NULL;
+  guint8 *data;
+  guint size;
+  gboolean res;
+  guint i;
+
+  gst_byte_writer_init_with_size (&bw, 4096, FALSE);
+  gst_byte_writer_put_uint32_le (&bw, INDEX_MAGIC);
+  gst_byte_writer_put_uint32_be (&bw, INDEX_VERSION);
+  gst_byte_writer_put_uint64_be (&bw, file_size);
+  gst_byte_writer_put_data (&bw, checksum, MPEGTS_INDEX_CHECKSUM_SIZE);
+  gst_byte_writer_put_uint16_be (&bw, packetizer->lastobsid);
+
+  PACKETIZER_GROUP_LOCK (packetizer);
+  for (i = 0; i < packetizer->lastobsid; i++) {
+    MpegTSPCR *pcrtable = packetizer->observations[i];
+    GList *tmp;
+
+    gst_byte_writer_put_uint16_be (&bw, pcrtable->pid);
+    gst_byte_writer_put_uint32_be (&bw, g_list_length (pcrtable->groups));
+
+    for (tmp = pcrtable->groups; tmp; tmp = tmp->next) {
+      PCROffsetGroup *group = (PCROffsetGroup *) tmp->data;
+      guint j;
+
+      gst_byte_writer_put_uint32_be (&bw, group->flags);
+      gst_byte_writer_put_uint64_be (&bw, group->first_pcr);
+      gst_byte_writer_put_uint64_be (&bw, group->first_offset);
+      gst_byte_writer_put_uint64_be (&bw, group->pcr_offset);
+      gst_byte_writer_put_uint32_be (&bw, group->last_value + 1);
+      for (j = 0; j <= group->last_value; j++) {
+        gst_byte_writer_put_uint64_be (&bw, group->values[j].pcr);
+        gst_byte_writer_put_uint64_be (&bw, group->values[j].offset);
+      }
+    }
+  }
+  PACKETIZER_GROUP_UNLOCK (packetizer);
+
+  size = gst_byte_writer_get_size (&bw);
+  data = gst_byte_writer_reset_and_get_data (&bw);
+
+  res = g_file_set_contents (filename, (const gchar *) data, size, &err);
+  if (!res) {
+    GST_WARNING ("Could not write seek index to %s: %s", filename,
+        err->message);
+    g_error_free (err);
+  } else {
+    GST_INFO ("Wrote %u bytes of seek index to %s", size, filename);
+  }
+  g_free (data);
+
+  return res;
+}
+
+gboolean
+mpegts_packetizer_load_index (MpegTSPacketizer2 * packetizer,
+    const gchar * filename, guint64 file_size, const guint8 * checksum)
+{
+  GstByteReader br;
+  gchar *contents;
+  gsize length;
+  guint32 magic = 0, version = 0;
+  guint64 size = 0;
+  const guint8 *stored_checksum = NULL;
+  guint16 nb_tables = 0;
+  guint i;
+
+  if (!g_file_get_contents (filename, &contents, &length, NULL)) {
+    GST_DEBUG ("No seek index at %s", filename);
+    return FALSE;
+  }
+
+  gst_byte_reader_init (&br, (const guint8 *) contents, length);
+  if (!gst_byte_reader_get_uint32_le (&br, &magic) || magic != INDEX_MAGIC ||
+      !gst_byte_reader_get_uint32_be (&br, &version) ||
+      version != INDEX_VERSION ||
+      !gst_byte_reader_get_uint64_be (&br, &size) ||
+      !gst_byte_reader_get_data (&br, MPEGTS_INDEX_CHECKSUM_SIZE,
+          &stored_checksum) ||
+      !gst_byte_reader_get_uint16_be (&br, &nb_tables))
+    goto invalid;
+
+  if (nb_tables > MAX_PCR_OBS_CHANNELS)
+    goto invalid;
+
+  if (size != file_size) {
+    GST_INFO ("Seek index %s doesn't match stream (size %" G_GUINT64_FORMAT
+        " vs %" G_GUINT64_FORMAT ")", filename, size, file_size);
+    g_free (contents);
+    return FALSE;
+  }
+
+  /* Same size but different content, e.g. a re-encode or an edit in place */
+  if (memcmp (stored_checksum, checksum, MPEGTS_INDEX_CHECKSUM_SIZE) != 0) {
+    GST_INFO ("Seek index %s doesn't match stream (checksum differs)",
+        filename);
+    g_free (contents);
+    return FALSE;
+  }
+
+  PACKETIZER_GROUP_LOCK (packetizer);
+  flush_observations (packetizer);
+  for (i = 0; i < nb_tables; i++) {
+    MpegTSPCR *pcrtable;
+    guint16 pid;
+    guint32 nb_groups, j;
+
+    if (!gst_byte_reader_get_uint16_be (&br, &pid) || pid > 0x1fff ||
+        !gst_byte_reader_get_uint32_be (&br, &nb_groups))
+      goto invalid_locked;
+
+    pcrtable = get_pcr_table (packetizer, pid);
+    for (j = 0; j < nb_groups; j++) {
+      PCROffsetGroup *group;
+      guint32 flags, nb_values, k;
+      guint64 first_pcr, first_offset, pcr_offset;
+
+      if (!gst_byte_reader_get_uint32_be (&br, &flags) ||
+          !gst_byte_reader_get_uint64_be (&br, &first_pcr) ||
+          !gst_byte_reader_get_uint64_be (&br, &first_offset) ||
+          !gst_byte_reader_get_uint64_be (&br, &pcr_offset) ||
+          !gst_byte_reader_get_uint32_be (&br, &nb_values) || nb_values == 0 ||
+          gst_byte_reader_get_remaining (&br) / 16 < nb_values)
+        goto invalid_locked;
+
+      group = _new_group (first_pcr, first_offset, pcr_offset, flags);
+      if (nb_values > group->nb_allocated) {
+        group->nb_allocated = nb_values;
+        group->values = g_renew (PCROffset, group->values, nb_values);
+      }
+      for (k = 0; k < nb_values; k++) {
+        group->values[k].pcr = gst_byte_reader_get_uint64_be_unchecked (&br);
+        group->values[k].offset =
+            gst_byte_reader_get_uint64_be_unchecked (&br);
+      }
+      group->last_value = nb_values - 1;
+
+      pcrtable->groups = g_list_append (pcrtable->groups, group);
+    }
+    packetizer->nb_seen_offsets += nb_groups;
+  }
+  PACKETIZER_GROUP_UNLOCK (packetizer);
+
+  GST_INFO ("Loaded seek index from %s (%u PCR tables)", filename, nb_tables);
+  g_free (contents);
+
+  return TRUE;
+
+invalid_locked:
+  /* Don't leave a half-loaded index behind */
+  flush_observations (packetizer);
+  PACKETIZER_GROUP_UNLOCK (packetizer);
+invalid:
+  GST_WARNING ("Invalid seek index %s", filename);
+  g_free (contents);
+  return FALSE;
+}
+
+/* Number of PCR/offset values that would be written to the index */
+guint
+mpegts_packetizer_get_index_values (MpegTSPacketizer2 * packetizer)
+{
+  guint i, nb_values = 0;
+
+  PACKETIZER_GROUP_LOCK (packetizer);
+  for (i = 0; i < packetizer->lastobsid; i++) {
+    GList *tmp;
+
+    for (tmp = packetizer->observations[i]->groups; tmp; tmp = tmp->next)
+      nb_values += ((PCROffsetGroup *) tmp->data)->last_value + 1;
+  }
+  PACKETIZER_GROUP_UNLOCK (packetizer);
+
+  return nb_values;
+}
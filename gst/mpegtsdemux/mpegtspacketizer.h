@@ -66,6 +66,11 @@ G_BEGIN_DECLS
 typedef struct _MpegTSPacketizer2 MpegTSPacketizer2;
 typedef struct _MpegTSPacketizer2Class MpegTSPacketizer2Class;
 
+/* Returns the first offset i in [start, end[ for which data[i + k * stride]
+ * is a sync byte for all k in [0, count[, or end if there is none */
+typedef gsize (*MpegTSScanSyncFunc) (const guint8 * data, gsize start,
+    gsize end, guint stride, guint count);
+
 typedef struct
 {
   guint16 pid;
@@ -268,6 +273,14 @@ struct _MpegTSPacketizer2 {
   gsize map_offset;
   gsize map_size;
   gboolean need_sync;
+  /* Sync byte scanner for the CPU */
+  MpegTSScanSyncFunc scan_sync;
+
+  /* If TRUE, the adapter contents are mapped through a GstBuffer so that
+   * regions of packets can be shared without copying them */
+  gboolean zero_copy;
+  GstBuffer *map_buffer;
+  GstMapInfo map_info;
 
   /* Reference offset */
   guint64 refoffset;
@@ -351,6 +364,11 @@ G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetiz
 G_GNUC_INTERNAL void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
   gint16 pid);
 
+/* Only valid if zero_copy is TRUE and data points within the current packet */
+G_GNUC_INTERNAL GstBuffer *
+mpegts_packetizer_share_data (MpegTSPacketizer2 * packetizer,
+			      const guint8 * data, gsize size);
+
 G_GNUC_INTERNAL GstMpegtsSection *mpegts_packetizer_push_section (MpegTSPacketizer2 *packetzer,
 								  MpegTSPacketizerPacket *packet, GList **remaining);
 
@@ -376,6 +394,21 @@ mpegts_packetizer_set_reference_offset (MpegTSPacketizer2 * packetizer,
 G_GNUC_INTERNAL void
 mpegts_packetizer_set_pcr_discont_threshold (MpegTSPacketizer2 * packetizer,
 					GstClockTime threshold);
+
+/* Seek index sidecar files, file_size and checksum (SHA-1 of the start and
+ * end of the stream) are used to validate the index */
+#define MPEGTS_INDEX_CHECKSUM_SIZE 20
+
+G_GNUC_INTERNAL gboolean
+mpegts_packetizer_save_index (MpegTSPacketizer2 * packetizer,
+			      const gchar * filename, guint64 file_size,
+			      const guint8 * checksum);
+G_GNUC_INTERNAL gboolean
+mpegts_packetizer_load_index (MpegTSPacketizer2 * packetizer,
+			      const gchar * filename, guint64 file_size,
+			      const guint8 * checksum);
+G_GNUC_INTERNAL guint
+mpegts_packetizer_get_index_values (MpegTSPacketizer2 * packetizer);
 G_END_DECLS
 
 #endif /* GST_MPEGTS_PACKETIZER_H */
@@ -64,6 +64,12 @@ struct _MpegTSParsePad
 
   /* the return of the latest push */
   GstFlowReturn flow_return;
+
+  /* packets waiting to be pushed as a single buffer list */
+  GstBufferList *pending;
+  GstClockTime pending_ts;
+  /* the (combined) return of the latest buffer list push */
+  GstFlowReturn pending_flow;
 };
 
 static GstStaticPadTemplate src_template =
@@ -84,6 +90,8 @@ enum
   PROP_SET_TIMESTAMPS,
   PROP_SMOOTHING_LATENCY,
   PROP_PCR_PID,
+  PROP_BUFFER_LIST_SIZE,
+  PROP_BUFFER_LIST_LATENCY,
   /* FILL ME */
 };
 
@@ -123,6 +131,8 @@ static GstFlowReturn mpegts_parse_input_done (MpegTSBase * base,
     GstBuffer * buffer);
 static GstFlowReturn
 drain_pending_buffers (MpegTSParse2 * parse, gboolean drain_all);
+static GstFlowReturn mpegts_parse_tspad_push_pending (MpegTSParse2 * parse,
+    MpegTSParsePad * tspad);
 
 static void
 mpegts_parse_dispose (GObject * object)
@@ -159,6 +169,17 @@ mpegts_parse_class_init (MpegTSParse2Class * klass)
       g_param_spec_int ("pcr-pid", "PID containing PCR",
           "Set the PID to use for PCR values (-1 for auto)",
           -1, G_MAXINT, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_BUFFER_LIST_SIZE,
+      g_param_spec_uint ("buffer-list-size", "Buffer list size",
+          "Maximum number of packets pushed as a single buffer list on the "
+          "program pads (0 = push packets one by one)",
+          0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_BUFFER_LIST_LATENCY,
+      g_param_spec_uint ("buffer-list-latency", "Buffer list latency",
+          "Maximum time in milliseconds packets can be held back on the "
+          "program pads when buffer-list-size is set (0 = only until the end "
+          "of the current input buffer)",
+          0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   element_class = GST_ELEMENT_CLASS (klass);
   element_class->pad_removed = mpegts_parse_pad_removed;
@@ -213,6 +234,7 @@ static void
 mpegts_parse_reset (MpegTSBase * base)
 {
   MpegTSParse2 *parse = (MpegTSParse2 *) base;
+  GList *tmp;
 
   /* Set the various know PIDs we are interested in */
 
@@ -244,6 +266,18 @@ mpegts_parse_reset (MpegTSBase * base)
   g_list_free_full (parse->pending_buffers, (GDestroyNotify) gst_buffer_unref);
   parse->pending_buffers = NULL;
 
+  GST_OBJECT_LOCK (parse);
+  for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
+    MpegTSParsePad *tspad = gst_pad_get_element_private (tmp->data);
+
+    if (tspad && tspad->pending) {
+      gst_buffer_list_unref (tspad->pending);
+      tspad->pending = NULL;
+      tspad->pending_flow = GST_FLOW_OK;
+    }
+  }
+  GST_OBJECT_UNLOCK (parse);
+
   parse->current_pcr = GST_CLOCK_TIME_NONE;
   parse->previous_pcr = GST_CLOCK_TIME_NONE;
   parse->base_pcr = GST_CLOCK_TIME_NONE;
@@ -270,6 +304,12 @@ mpegts_parse_set_property (GObject * object, guint prop_id,
     case PROP_PCR_PID:
       parse->pcr_pid = parse->user_pcr_pid = g_value_get_int (value);
       break;
+    case PROP_BUFFER_LIST_SIZE:
+      parse->buffer_list_size = g_value_get_uint (value);
+      break;
+    case PROP_BUFFER_LIST_LATENCY:
+      parse->buffer_list_latency = GST_MSECOND * g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -291,6 +331,12 @@ mpegts_parse_get_property (GObject * object, guint prop_id,
     case PROP_PCR_PID:
       g_value_set_int (value, parse->pcr_pid);
       break;
+    case PROP_BUFFER_LIST_SIZE:
+      g_value_set_uint (value, parse->buffer_list_size);
+      break;
+    case PROP_BUFFER_LIST_LATENCY:
+      g_value_set_uint (value, parse->buffer_list_latency / GST_MSECOND);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -380,6 +426,18 @@ push_event (MpegTSBase * base, GstEvent * event)
   for (tmp = parse->srcpads; tmp; tmp = tmp->next) {
     GstPad *pad = (GstPad *) tmp->data;
     if (pad) {
+      MpegTSParsePad *tspad = gst_pad_get_element_private (pad);
+
+      /* Serialized events go after the packets we're still holding back */
+      if (tspad->pending) {
+        if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+          gst_buffer_list_unref (tspad->pending);
+          tspad->pending = NULL;
+          tspad->pending_flow = GST_FLOW_OK;
+        } else if (GST_EVENT_IS_SERIALIZED (event)) {
+          mpegts_parse_tspad_push_pending (parse, tspad);
+        }
+      }
       gst_event_ref (event);
       gst_pad_push_event (pad, event);
     }
@@ -407,6 +465,9 @@ mpegts_parse_create_tspad (MpegTSParse2 * parse, const gchar * pad_name)
   tspad->program = NULL;
   tspad->pushed = FALSE;
   tspad->flow_return = GST_FLOW_NOT_LINKED;
+  tspad->pending = NULL;
+  tspad->pending_ts = GST_CLOCK_TIME_NONE;
+  tspad->pending_flow = GST_FLOW_OK;
   gst_pad_set_element_private (pad, tspad);
   gst_flow_combiner_add_pad (parse->flowcombiner, pad);
 
@@ -416,6 +477,9 @@ mpegts_parse_create_tspad (MpegTSParse2 * parse, const gchar * pad_name)
 static void
 mpegts_parse_destroy_tspad (MpegTSParse2 * parse, MpegTSParsePad * tspad)
 {
+  if (tspad->pending)
+    gst_buffer_list_unref (tspad->pending);
+
   /* free the wrapper */
   g_free (tspad);
 }
@@ -525,6 +589,93 @@ mpegts_parse_release_pad (GstElement * element, GstPad * pad)
   gst_element_remove_pad (element, pad);
 }
 
+static GstFlowReturn
+mpegts_parse_tspad_push_pending (MpegTSParse2 * parse, MpegTSParsePad * tspad)
+{
+  GstBufferList *list = tspad->pending;
+  GstFlowReturn ret;
+
+  if (list == NULL)
+    return tspad->pending_flow;
+
+  tspad->pending = NULL;
+  tspad->pending_ts = GST_CLOCK_TIME_NONE;
+
+  GST_LOG_OBJECT (tspad->pad, "Pushing list of %u packets",
+      gst_buffer_list_length (list));
+
+  ret = gst_pad_push_list (tspad->pad, list);
+  ret = gst_flow_combiner_update_flow (parse->flowcombiner, ret);
+  tspad->pending_flow = ret;
+
+  return ret;
+}
+
+/* Pushes the packet, or queues it in the pad buffer list if enabled */
+static GstFlowReturn
+mpegts_parse_tspad_push_buffer (MpegTSParse2 * parse, MpegTSParsePad * tspad,
+    GstBuffer * buf)
+{
+  MpegTSBase *base = (MpegTSBase *) parse;
+  GstClockTime now = base->packetizer->last_in_time;
+  GstFlowReturn ret;
+
+  if (parse->buffer_list_size < 2) {
+    ret = gst_pad_push (tspad->pad, buf);
+    return gst_flow_combiner_update_flow (parse->flowcombiner, ret);
+  }
+
+  if (tspad->pending == NULL) {
+    tspad->pending = gst_buffer_list_new_sized (parse->buffer_list_size);
+    tspad->pending_ts = now;
+  }
+  gst_buffer_list_add (tspad->pending, buf);
+
+  if (gst_buffer_list_length (tspad->pending) >= parse->buffer_list_size ||
+      (parse->buffer_list_latency && GST_CLOCK_TIME_IS_VALID (now) &&
+          GST_CLOCK_TIME_IS_VALID (tspad->pending_ts) &&
+          now >= tspad->pending_ts + parse->buffer_list_latency))
+    return mpegts_parse_tspad_push_pending (parse, tspad);
+
+  return tspad->pending_flow;
+}
+
+/* Pushes the buffer lists that are full or have expired at the end of an
+ * input buffer */
+static GstFlowReturn
+mpegts_parse_push_pending_lists (MpegTSParse2 * parse)
+{
+  MpegTSBase *base = (MpegTSBase *) parse;
+  GstClockTime now = base->packetizer->last_in_time;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GList *pads, *tmp;
+
+  GST_OBJECT_LOCK (parse);
+  pads = g_list_copy_deep (parse->srcpads, (GCopyFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (parse);
+
+  for (tmp = pads; tmp; tmp = tmp->next) {
+    MpegTSParsePad *tspad = gst_pad_get_element_private (tmp->data);
+    GstFlowReturn pad_ret;
+
+    if (tspad == NULL || tspad->pending == NULL)
+      continue;
+
+    if (parse->buffer_list_latency && GST_CLOCK_TIME_IS_VALID (now) &&
+        GST_CLOCK_TIME_IS_VALID (tspad->pending_ts) &&
+        now < tspad->pending_ts + parse->buffer_list_latency)
+      continue;
+
+    pad_ret = mpegts_parse_tspad_push_pending (parse, tspad);
+    if (pad_ret != GST_FLOW_OK && pad_ret != GST_FLOW_NOT_LINKED)
+      ret = pad_ret;
+  }
+
+  g_list_free_full (pads, gst_object_unref);
+
+  return ret;
+}
+
 static GstFlowReturn
 mpegts_parse_tspad_push_section (MpegTSParse2 * parse, MpegTSParsePad * tspad,
     GstMpegtsSection * section, MpegTSPacketizerPacket * packet)
@@ -558,8 +709,7 @@ mpegts_parse_tspad_push_section (MpegTSParse2 * parse, MpegTSParsePad * tspad,
         gst_buffer_new_and_alloc (packet->data_end - packet->data_start);
     gst_buffer_fill (buf, 0, packet->data_start,
         packet->data_end - packet->data_start);
-    ret = gst_pad_push (tspad->pad, buf);
-    ret = gst_flow_combiner_update_flow (parse->flowcombiner, ret);
+    ret = mpegts_parse_tspad_push_buffer (parse, tspad, buf);
   }
 
   GST_LOG_OBJECT (parse, "Returning %s", gst_flow_get_name (ret));
@@ -589,8 +739,7 @@ mpegts_parse_tspad_push (MpegTSParse2 * parse, MpegTSParsePad * tspad,
       gst_buffer_fill (buf, 0, packet->data_start,
           packet->data_end - packet->data_start);
       /* push if there's no filter or if the pid is in the filter */
-      ret = gst_pad_push (tspad->pad, buf);
-      ret = gst_flow_combiner_update_flow (parse->flowcombiner, ret);
+      ret = mpegts_parse_tspad_push_buffer (parse, tspad, buf);
     }
   }
   GST_DEBUG_OBJECT (parse, "Returning %s", gst_flow_get_name (ret));
@@ -897,6 +1046,12 @@ mpegts_parse_input_done (MpegTSBase * base, GstBuffer * buffer)
     ret = gst_flow_combiner_update_flow (parse->flowcombiner, ret);
   }
 
+  if (parse->buffer_list_size > 1 && parse->srcpads) {
+    GstFlowReturn list_ret = mpegts_parse_push_pending_lists (parse);
+    if (ret == GST_FLOW_OK)
+      ret = list_ret;
+  }
+
   return ret;
 }
 
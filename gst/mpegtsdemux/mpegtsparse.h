@@ -71,6 +71,10 @@ struct _MpegTSParse2 {
   gboolean first;
   gboolean set_timestamps;
 
+  /* Buffer lists on the program pads */
+  guint buffer_list_size;
+  GstClockTime buffer_list_latency;
+
   /* Pending buffer state */
   GList *pending_buffers;
   GstClockTime previous_pcr;
@@ -47,6 +47,7 @@
 #include "mpegtspacketizer.h"
 #include "pesparse.h"
 #include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
 #include <gst/codecparsers/gstmpegvideoparser.h>
 #include <gst/video/video-color.h>
 
@@ -75,6 +76,10 @@
 /* latency in nsecs */
 #define TS_LATENCY (700 * GST_MSECOND)
 
+/* Maximum number of buffers (or buffer lists) in the output queue of a
+ * stream in threaded-push mode */
+#define TS_DEMUX_QUEUE_MAX_BUFFERS 32
+
 GST_DEBUG_CATEGORY_STATIC (ts_demux_debug);
 #define GST_CAT_DEFAULT ts_demux_debug
 
@@ -113,6 +118,8 @@ typedef struct
 typedef struct _TSDemuxStream TSDemuxStream;
 
 typedef struct _TSDemuxH264ParsingInfos TSDemuxH264ParsingInfos;
+typedef struct _TSDemuxH265ParsingInfos TSDemuxH265ParsingInfos;
+typedef struct _TSDemuxMpegVideoParsingInfos TSDemuxMpegVideoParsingInfos;
 typedef struct _TSDemuxJP2KParsingInfos TSDemuxJP2KParsingInfos;
 
 /* Returns TRUE if a keyframe was found */
@@ -135,6 +142,24 @@ struct _TSDemuxH264ParsingInfos
   SimpleBuffer framedata;
 };
 
+struct _TSDemuxH265ParsingInfos
+{
+  /* H265 parsing data */
+  GstH265Parser *parser;
+  GstByteWriter *vps;
+  GstByteWriter *sps;
+  GstByteWriter *pps;
+  GstByteWriter *sei;
+  SimpleBuffer framedata;
+};
+
+struct _TSDemuxMpegVideoParsingInfos
+{
+  /* MPEG-1/2 video parsing data */
+  GstByteWriter *seqhdr;
+  SimpleBuffer framedata;
+};
+
 struct _TSDemuxJP2KParsingInfos
 {
   /* J2K parsing data */
@@ -149,6 +174,16 @@ struct _TSDemuxStream
   /* Whether the pad was added or not */
   gboolean active;
 
+  /* Output queue and result of the last push of the pad task, only used in
+   * threaded-push mode */
+  GstDataQueue *queue;
+  /* protected by queue_lock, like queued */
+  GstFlowReturn push_flow;
+  /* Number of items queued and not pushed downstream yet */
+  guint queued;
+  GMutex queue_lock;
+  GCond queue_cond;
+
   /* Whether this is a sparse stream (subtitles or metadata) */
   gboolean sparse;
 
@@ -161,6 +196,10 @@ struct _TSDemuxStream
   /* Data being reconstructed (allocated) */
   guint8 *data;
 
+  /* Payloads shared from the input buffers, used instead of ->data
+   * in zero-copy mode */
+  GstBufferList *payloads;
+
   /* Size of data being reconstructed (if known, else 0) */
   guint expected_size;
 
@@ -207,6 +246,8 @@ struct _TSDemuxStream
 
   GstTsDemuxKeyFrameScanFunction scan_function;
   TSDemuxH264ParsingInfos h264infos;
+  TSDemuxH265ParsingInfos h265infos;
+  TSDemuxMpegVideoParsingInfos mpegvideoinfos;
   TSDemuxJP2KParsingInfos jp2kInfos;
 };
 
@@ -282,6 +323,9 @@ enum
   PROP_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_ZERO_COPY,
+  PROP_INDEX_LOCATION,
+  PROP_THREADED_PUSH,
   /* FILL ME */
 };
 
@@ -373,6 +417,59 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTSDemux:zero-copy:
+   *
+   * Keep PES payloads in the memory of the incoming buffers instead of
+   * copying them into a newly allocated buffer. Each PES is still pushed
+   * as one buffer, made of one memory per TS packet. PES spanning more TS
+   * packets than a buffer can hold memories are copied as usual.
+   *
+   * Streams that require contiguous data in tsdemux (Opus, JPEG 2000 and
+   * keyframe scanning after a seek) are also copied.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Push PES payloads in the memory of the input instead of copying "
+          "them", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:index-location:
+   *
+   * Location of a seek index sidecar file. In pull mode the PCR/offset
+   * observations are loaded from it if it exists and matches the size and
+   * a checksum of the first and last 16kB of the stream, which avoids
+   * scanning the end of the file and makes seeks into already-seen parts
+   * immediate. The observations are written back when going from PAUSED to
+   * READY, unless the index was loaded and nothing was added to it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index location",
+          "Location of the seek index sidecar file (NULL to disable)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstTSDemux:threaded-push:
+   *
+   * Push each output stream from its own thread. The packets are still
+   * demuxed and timestamped in the streaming thread, their PES are then
+   * handed to a pad task per output pad, so that downstream processing of
+   * the different streams (parsing, decoding) can run in parallel.
+   *
+   * Only taken into account for the streams created after setting it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_THREADED_PUSH,
+      g_param_spec_boolean ("threaded-push", "Threaded push",
+          "Push each output stream from its own thread", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -466,6 +563,23 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_ZERO_COPY:
+      GST_OBJECT_LOCK (demux);
+      demux->zero_copy = g_value_get_boolean (value);
+      MPEG_TS_BASE_PACKETIZER (demux)->zero_copy = demux->zero_copy;
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_free (((MpegTSBase *) demux)->index_location);
+      ((MpegTSBase *) demux)->index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_THREADED_PUSH:
+      GST_OBJECT_LOCK (demux);
+      demux->threaded_push = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -484,6 +598,19 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, demux->zero_copy);
+      break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, ((MpegTSBase *) demux)->index_location);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_THREADED_PUSH:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_boolean (value, demux->threaded_push);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -793,6 +920,272 @@ scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
   return FALSE;
 }
 
+static void
+tsdemux_append_writer (GstByteWriter * dest, GstByteWriter * src)
+{
+  gsize tmpsize = gst_byte_writer_get_size (src);
+  guint8 *data;
+
+  if (!tmpsize)
+    return;
+
+  data = gst_byte_writer_reset_and_get_data (src);
+  gst_byte_writer_put_data (dest, data, tmpsize);
+  g_free (data);
+}
+
+static gboolean
+scan_keyframe_h265 (TSDemuxStream * stream, const guint8 * data,
+    const gsize data_size, const gsize max_frame_offset)
+{
+  guint offset = 0;
+  GstH265NalUnit unit, frame_unit = { 0, };
+  GstH265ParserResult res = GST_H265_PARSER_OK;
+  TSDemuxH265ParsingInfos *h265infos = &stream->h265infos;
+  GstByteWriter *writer;
+
+  GstH265Parser *parser = h265infos->parser;
+
+  if (G_UNLIKELY (parser == NULL)) {
+    parser = h265infos->parser = gst_h265_parser_new ();
+    h265infos->vps = gst_byte_writer_new ();
+    h265infos->sps = gst_byte_writer_new ();
+    h265infos->pps = gst_byte_writer_new ();
+    h265infos->sei = gst_byte_writer_new ();
+  }
+
+  while (res == GST_H265_PARSER_OK) {
+    res =
+        gst_h265_parser_identify_nalu (parser, data, offset, data_size, &unit);
+
+    if (res != GST_H265_PARSER_OK && res != GST_H265_PARSER_NO_NAL_END) {
+      GST_INFO_OBJECT (stream->pad, "Error identifying nalu: %i", res);
+      break;
+    }
+
+    writer = NULL;
+    switch (unit.type) {
+      case GST_H265_NAL_VPS:
+        writer = h265infos->vps;
+        break;
+      case GST_H265_NAL_SPS:
+        writer = h265infos->sps;
+        break;
+      case GST_H265_NAL_PPS:
+        writer = h265infos->pps;
+        break;
+      case GST_H265_NAL_PREFIX_SEI:
+        writer = h265infos->sei;
+        break;
+        /* IRAP pictures, the ones h265parse considers keyframes */
+      case GST_H265_NAL_SLICE_BLA_W_LP:
+      case GST_H265_NAL_SLICE_BLA_W_RADL:
+      case GST_H265_NAL_SLICE_BLA_N_LP:
+      case GST_H265_NAL_SLICE_IDR_W_RADL:
+      case GST_H265_NAL_SLICE_IDR_N_LP:
+      case GST_H265_NAL_SLICE_CRA_NUT:
+      case 22:                 /* RSV_IRAP_VCL22 */
+      case 23:                 /* RSV_IRAP_VCL23 */
+        if (h265infos->framedata.size || frame_unit.size)
+          break;
+
+        /* first_slice_segment_in_pic_flag, right after the 2 bytes header */
+        if (unit.size > 2 && (unit.data[unit.offset + 2] & 0x80)) {
+          GST_DEBUG_OBJECT (stream->pad, "Found keyframe at: %u",
+              unit.sc_offset);
+          frame_unit = unit;
+        }
+        break;
+      default:
+        break;
+    }
+
+    if (writer && !frame_unit.size) {
+      if (gst_byte_writer_put_data (writer, unit.data + unit.sc_offset,
+              unit.size + unit.offset - unit.sc_offset)) {
+        GST_DEBUG ("adding NAL %u of size %u", unit.type,
+            unit.size + unit.offset - unit.sc_offset);
+      } else {
+        GST_WARNING ("Could not write NAL %u", unit.type);
+      }
+    }
+
+    if (res == GST_H265_PARSER_NO_NAL_END
+        || offset == unit.offset + unit.size)
+      break;
+
+    offset = unit.offset + unit.size;
+  }
+
+  /* Same as for H.264, we need the parameter sets (VPS / SPS / PPS) and a
+   * keyframe, then we can stop rewinding the stream */
+  if (gst_byte_writer_get_size (h265infos->vps) &&
+      gst_byte_writer_get_size (h265infos->sps) &&
+      gst_byte_writer_get_size (h265infos->pps) &&
+      (h265infos->framedata.size || frame_unit.size)) {
+
+    /* Put everything in the VPS writer, which goes first */
+    tsdemux_append_writer (h265infos->vps, h265infos->sps);
+    tsdemux_append_writer (h265infos->vps, h265infos->pps);
+    tsdemux_append_writer (h265infos->vps, h265infos->sei);
+
+    GST_DEBUG ("Adding Keyframe");
+    if (frame_unit.size) {      /*  We found the everything in one go! */
+      gst_byte_writer_put_data (h265infos->vps,
+          frame_unit.data + frame_unit.sc_offset,
+          stream->current_size - frame_unit.sc_offset);
+    } else {
+      gst_byte_writer_put_data (h265infos->vps,
+          h265infos->framedata.data, h265infos->framedata.size);
+      clear_simple_buffer (&h265infos->framedata);
+    }
+
+    g_free (stream->data);
+    stream->current_size = gst_byte_writer_get_size (h265infos->vps);
+    stream->data = gst_byte_writer_reset_and_get_data (h265infos->vps);
+    gst_byte_writer_init (h265infos->vps);
+    gst_byte_writer_init (h265infos->sps);
+    gst_byte_writer_init (h265infos->pps);
+    gst_byte_writer_init (h265infos->sei);
+
+    return TRUE;
+  }
+
+  if (frame_unit.size) {
+    GST_DEBUG_OBJECT (stream->pad, "Keep the keyframe as this is the one"
+        " we will push later");
+
+    h265infos->framedata.data =
+        g_memdup (frame_unit.data + frame_unit.sc_offset,
+        stream->current_size - frame_unit.sc_offset);
+    h265infos->framedata.size = stream->current_size - frame_unit.sc_offset;
+  }
+
+  return FALSE;
+}
+
+static gboolean
+scan_keyframe_mpegvideo (TSDemuxStream * stream, const guint8 * data,
+    const gsize data_size, const gsize max_frame_offset)
+{
+  TSDemuxMpegVideoParsingInfos *infos = &stream->mpegvideoinfos;
+  GstMpegVideoPacket packet;
+  GstMpegVideoPictureHdr pichdr;
+  guint offset = 0;
+  /* Start of the sequence header (and its extensions) being parsed */
+  gint seq_start = -1;
+  /* Start of the sequence/GOP headers preceding the next picture */
+  gint header_start = -1;
+  gboolean header_has_seq = FALSE;
+  gint frame_start = -1;
+  gboolean frame_has_seq = FALSE;
+
+  if (G_UNLIKELY (infos->seqhdr == NULL))
+    infos->seqhdr = gst_byte_writer_new ();
+
+  while (frame_start < 0 && gst_mpeg_video_parse (&packet, data, data_size,
+          offset)) {
+    gint sc_offset = packet.offset - 4;
+
+    /* The sequence header ends with its last extension, keep it around to
+     * be able to prepend it to a keyframe found in a later chunk */
+    if (seq_start >= 0 && packet.type != GST_MPEG_VIDEO_PACKET_EXTENSION &&
+        packet.type != GST_MPEG_VIDEO_PACKET_USER_DATA) {
+      if (!infos->framedata.size) {
+        gst_byte_writer_reset (infos->seqhdr);
+        gst_byte_writer_put_data (infos->seqhdr, data + seq_start,
+            sc_offset - seq_start);
+      }
+      seq_start = -1;
+    }
+
+    switch (packet.type) {
+      case GST_MPEG_VIDEO_PACKET_SEQUENCE:
+        seq_start = sc_offset;
+        if (header_start < 0)
+          header_start = sc_offset;
+        header_has_seq = TRUE;
+        break;
+      case GST_MPEG_VIDEO_PACKET_GOP:
+        if (header_start < 0)
+          header_start = sc_offset;
+        break;
+      case GST_MPEG_VIDEO_PACKET_EXTENSION:
+      case GST_MPEG_VIDEO_PACKET_USER_DATA:
+        break;
+      case GST_MPEG_VIDEO_PACKET_PICTURE:
+        if (!infos->framedata.size &&
+            gst_mpeg_video_packet_parse_picture_header (&packet, &pichdr) &&
+            pichdr.pic_type == GST_MPEG_VIDEO_PICTURE_TYPE_I) {
+          frame_start = header_start >= 0 ? header_start : sc_offset;
+          frame_has_seq = header_has_seq;
+          GST_DEBUG_OBJECT (stream->pad, "Found keyframe at: %d", frame_start);
+        }
+        header_start = -1;
+        header_has_seq = FALSE;
+        break;
+      default:
+        header_start = -1;
+        header_has_seq = FALSE;
+        break;
+    }
+
+    if (packet.size < 0)
+      break;
+
+    offset = packet.offset + packet.size;
+  }
+
+  /* Sequence header at the very end of the chunk */
+  if (seq_start >= 0 && !infos->framedata.size) {
+    gst_byte_writer_reset (infos->seqhdr);
+    gst_byte_writer_put_data (infos->seqhdr, data + seq_start,
+        data_size - seq_start);
+  }
+
+  if (frame_start >= 0 && frame_has_seq) {
+    GST_DEBUG_OBJECT (stream->pad, "Keyframe comes with a sequence header");
+    if (frame_start > 0) {
+      stream->current_size -= frame_start;
+      memmove (stream->data, stream->data + frame_start, stream->current_size);
+    }
+    gst_byte_writer_reset (infos->seqhdr);
+    clear_simple_buffer (&infos->framedata);
+    return TRUE;
+  }
+
+  if (gst_byte_writer_get_size (infos->seqhdr) &&
+      (infos->framedata.size || frame_start >= 0)) {
+    GST_DEBUG ("Adding Keyframe");
+    if (frame_start >= 0) {
+      gst_byte_writer_put_data (infos->seqhdr, stream->data + frame_start,
+          stream->current_size - frame_start);
+    } else {
+      gst_byte_writer_put_data (infos->seqhdr,
+          infos->framedata.data, infos->framedata.size);
+      clear_simple_buffer (&infos->framedata);
+    }
+
+    g_free (stream->data);
+    stream->current_size = gst_byte_writer_get_size (infos->seqhdr);
+    stream->data = gst_byte_writer_reset_and_get_data (infos->seqhdr);
+    gst_byte_writer_init (infos->seqhdr);
+
+    return TRUE;
+  }
+
+  if (frame_start >= 0) {
+    GST_DEBUG_OBJECT (stream->pad, "Keep the keyframe as this is the one"
+        " we will push later");
+
+    infos->framedata.data = g_memdup (stream->data + frame_start,
+        stream->current_size - frame_start);
+    infos->framedata.size = stream->current_size - frame_start;
+  }
+
+  return FALSE;
+}
+
 /* We merge data from TS packets so that the scanning methods get a continuous chunk,
  however the scanning method will return keyframe offset which needs to be translated
  back to actual offset in file */
@@ -911,6 +1304,75 @@ done:
   return res;
 }
 
+static void
+gst_ts_demux_queue_item_free (GstDataQueueItem * item)
+{
+  if (item->object)
+    gst_mini_object_unref (item->object);
+  g_slice_free (GstDataQueueItem, item);
+}
+
+static gboolean
+gst_ts_demux_queue_check_full (GstDataQueue * queue, guint visible,
+    guint bytes, guint64 time, gpointer checkdata)
+{
+  return visible >= TS_DEMUX_QUEUE_MAX_BUFFERS;
+}
+
+/* Pad task of the streams in threaded-push mode, pushes the content of the
+ * output queue downstream */
+static void
+gst_ts_demux_stream_loop (TSDemuxStream * stream)
+{
+  GstDataQueueItem *item;
+  GstMiniObject *obj;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if (!gst_data_queue_pop (stream->queue, &item)) {
+    GST_DEBUG_OBJECT (stream->pad, "queue is flushing, pausing task");
+    gst_pad_pause_task (stream->pad);
+    g_mutex_lock (&stream->queue_lock);
+    g_cond_broadcast (&stream->queue_cond);
+    g_mutex_unlock (&stream->queue_lock);
+    return;
+  }
+
+  obj = item->object;
+  item->object = NULL;
+  gst_ts_demux_queue_item_free (item);
+
+  if (GST_IS_BUFFER (obj)) {
+    ret = gst_pad_push (stream->pad, GST_BUFFER_CAST (obj));
+  } else if (GST_IS_BUFFER_LIST (obj)) {
+    ret = gst_pad_push_list (stream->pad, GST_BUFFER_LIST_CAST (obj));
+  } else {
+    gst_pad_push_event (stream->pad, GST_EVENT_CAST (obj));
+  }
+
+  g_mutex_lock (&stream->queue_lock);
+  if (GST_IS_BUFFER (obj) || GST_IS_BUFFER_LIST (obj))
+    stream->push_flow = ret;
+  if (--stream->queued == 0)
+    g_cond_broadcast (&stream->queue_cond);
+  g_mutex_unlock (&stream->queue_lock);
+}
+
+static gboolean
+gst_ts_demux_srcpad_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  TSDemuxStream *stream = gst_pad_get_element_private (pad);
+
+  /* Make sure the pad task doesn't hold the stream lock while blocked on the
+   * queue, deactivating the pad would otherwise never return */
+  if (!active && stream && stream->queue) {
+    gst_data_queue_set_flushing (stream->queue, TRUE);
+    gst_pad_stop_task (pad);
+  }
+
+  return TRUE;
+}
+
 static gboolean
 gst_ts_demux_srcpad_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -934,6 +1396,112 @@ gst_ts_demux_srcpad_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return res;
 }
 
+static GstFlowReturn
+gst_ts_demux_stream_push_item (TSDemuxStream * stream, GstMiniObject * obj)
+{
+  GstDataQueueItem *item;
+  GstFlowReturn ret;
+
+  item = g_slice_new0 (GstDataQueueItem);
+  item->object = obj;
+  item->visible = !GST_IS_EVENT (obj);
+  item->destroy = (GDestroyNotify) gst_ts_demux_queue_item_free;
+
+  g_mutex_lock (&stream->queue_lock);
+  stream->queued++;
+  g_mutex_unlock (&stream->queue_lock);
+
+  if (!gst_data_queue_push (stream->queue, item)) {
+    GST_DEBUG_OBJECT (stream->pad, "queue is flushing");
+    gst_ts_demux_queue_item_free (item);
+    g_mutex_lock (&stream->queue_lock);
+    stream->queued--;
+    g_cond_broadcast (&stream->queue_cond);
+    g_mutex_unlock (&stream->queue_lock);
+    return GST_FLOW_FLUSHING;
+  }
+
+  /* written by the pad task */
+  g_mutex_lock (&stream->queue_lock);
+  ret = stream->push_flow;
+  g_mutex_unlock (&stream->queue_lock);
+
+  return ret;
+}
+
+/* Push @event on the pad of @stream, through its output queue in
+ * threaded-push mode. Flushes go directly to the pad so they also unblock
+ * the pad task */
+static gboolean
+gst_ts_demux_stream_push_event (TSDemuxStream * stream, GstEvent * event)
+{
+  gboolean res;
+
+  if (stream->queue == NULL)
+    return gst_pad_push_event (stream->pad, event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      gst_data_queue_set_flushing (stream->queue, TRUE);
+      res = gst_pad_push_event (stream->pad, event);
+      gst_pad_pause_task (stream->pad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_data_queue_set_flushing (stream->queue, TRUE);
+      gst_pad_pause_task (stream->pad);
+      gst_data_queue_flush (stream->queue);
+      res = gst_pad_push_event (stream->pad, event);
+      g_mutex_lock (&stream->queue_lock);
+      stream->queued = 0;
+      stream->push_flow = GST_FLOW_OK;
+      g_cond_broadcast (&stream->queue_cond);
+      g_mutex_unlock (&stream->queue_lock);
+      gst_data_queue_set_flushing (stream->queue, FALSE);
+      if (stream->active && gst_pad_is_active (stream->pad))
+        gst_pad_start_task (stream->pad,
+            (GstTaskFunction) gst_ts_demux_stream_loop, stream, NULL);
+      break;
+    default:
+      res = gst_ts_demux_stream_push_item (stream,
+          GST_MINI_OBJECT_CAST (event)) != GST_FLOW_FLUSHING;
+      break;
+  }
+
+  return res;
+}
+
+static GstFlowReturn
+gst_ts_demux_stream_push_buffer (TSDemuxStream * stream, GstBuffer * buffer)
+{
+  if (stream->queue == NULL)
+    return gst_pad_push (stream->pad, buffer);
+
+  return gst_ts_demux_stream_push_item (stream, GST_MINI_OBJECT_CAST (buffer));
+}
+
+static GstFlowReturn
+gst_ts_demux_stream_push_list (TSDemuxStream * stream, GstBufferList * list)
+{
+  if (stream->queue == NULL)
+    return gst_pad_push_list (stream->pad, list);
+
+  return gst_ts_demux_stream_push_item (stream, GST_MINI_OBJECT_CAST (list));
+}
+
+/* Wait until everything queued on @stream was pushed downstream */
+static void
+gst_ts_demux_stream_drain_queue (TSDemuxStream * stream)
+{
+  if (stream->queue == NULL)
+    return;
+
+  g_mutex_lock (&stream->queue_lock);
+  while (stream->queued > 0 && gst_pad_get_task_state (stream->pad) ==
+      GST_TASK_STARTED)
+    g_cond_wait (&stream->queue_cond, &stream->queue_lock);
+  g_mutex_unlock (&stream->queue_lock);
+}
+
 static void
 clean_global_taglist (GstTagList * taglist)
 {
@@ -993,7 +1561,7 @@ push_event (MpegTSBase * base, GstEvent * event)
         gst_ts_demux_push_pending_data (demux, stream, NULL);
 
       gst_event_ref (event);
-      gst_pad_push_event (stream->pad, event);
+      gst_ts_demux_stream_push_event (stream, event);
     }
   }
 
@@ -1684,6 +2252,9 @@ done:
     GST_LOG ("stream:%p creating pad with name %s and caps %" GST_PTR_FORMAT,
         stream, name, caps);
     pad = gst_pad_new_from_template (template, name);
+    gst_pad_set_element_private (pad, stream);
+    gst_pad_set_activatemode_function (pad,
+        gst_ts_demux_srcpad_activate_mode);
     gst_pad_set_active (pad, TRUE);
     gst_pad_use_fixed_caps (pad);
     stream_id = gst_stream_get_stream_id (bstream->stream_object);
@@ -1746,12 +2317,36 @@ gst_ts_demux_stream_added (MpegTSBase * base, MpegTSBaseStream * bstream,
         gst_flow_combiner_add_pad (demux->flowcombiner, stream->pad);
     }
 
-    if (base->mode != BASE_MODE_PUSHING
-        && bstream->stream_type == GST_MPEGTS_STREAM_TYPE_VIDEO_H264) {
-      stream->scan_function =
-          (GstTsDemuxKeyFrameScanFunction) scan_keyframe_h264;
-    } else {
-      stream->scan_function = NULL;
+    GST_OBJECT_LOCK (demux);
+    if (stream->pad && demux->threaded_push) {
+      g_mutex_init (&stream->queue_lock);
+      g_cond_init (&stream->queue_cond);
+      stream->queued = 0;
+      stream->push_flow = GST_FLOW_OK;
+      stream->queue = gst_data_queue_new (gst_ts_demux_queue_check_full,
+          NULL, NULL, NULL);
+    }
+    GST_OBJECT_UNLOCK (demux);
+
+    stream->scan_function = NULL;
+    if (base->mode != BASE_MODE_PUSHING) {
+      switch (bstream->stream_type) {
+        case GST_MPEGTS_STREAM_TYPE_VIDEO_H264:
+          stream->scan_function =
+              (GstTsDemuxKeyFrameScanFunction) scan_keyframe_h264;
+          break;
+        case GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC:
+          stream->scan_function =
+              (GstTsDemuxKeyFrameScanFunction) scan_keyframe_h265;
+          break;
+        case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1:
+        case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2:
+          stream->scan_function =
+              (GstTsDemuxKeyFrameScanFunction) scan_keyframe_mpegvideo;
+          break;
+        default:
+          break;
+      }
     }
 
     stream->active = FALSE;
@@ -1791,6 +2386,32 @@ tsdemux_h264_parsing_info_clear (TSDemuxH264ParsingInfos * h264infos)
   }
 }
 
+static void
+tsdemux_h265_parsing_info_clear (TSDemuxH265ParsingInfos * h265infos)
+{
+  clear_simple_buffer (&h265infos->framedata);
+
+  if (h265infos->parser) {
+    gst_h265_parser_free (h265infos->parser);
+    gst_byte_writer_free (h265infos->vps);
+    gst_byte_writer_free (h265infos->sps);
+    gst_byte_writer_free (h265infos->pps);
+    gst_byte_writer_free (h265infos->sei);
+    h265infos->parser = NULL;
+  }
+}
+
+static void
+tsdemux_mpegvideo_parsing_info_clear (TSDemuxMpegVideoParsingInfos * infos)
+{
+  clear_simple_buffer (&infos->framedata);
+
+  if (infos->seqhdr) {
+    gst_byte_writer_free (infos->seqhdr);
+    infos->seqhdr = NULL;
+  }
+}
+
 static void
 gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
 {
@@ -1807,7 +2428,8 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
         gst_ts_demux_push_pending_data ((GstTSDemux *) base, stream, NULL);
 
         GST_DEBUG_OBJECT (stream->pad, "Pushing out EOS");
-        gst_pad_push_event (stream->pad, gst_event_new_eos ());
+        gst_ts_demux_stream_push_event (stream, gst_event_new_eos ());
+        gst_ts_demux_stream_drain_queue (stream);
         gst_pad_set_active (stream->pad, FALSE);
       }
 
@@ -1820,6 +2442,15 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
     stream->pad = NULL;
   }
 
+  if (stream->queue) {
+    gst_data_queue_set_flushing (stream->queue, TRUE);
+    gst_data_queue_flush (stream->queue);
+    g_object_unref (stream->queue);
+    stream->queue = NULL;
+    g_mutex_clear (&stream->queue_lock);
+    g_cond_clear (&stream->queue_cond);
+  }
+
   gst_ts_demux_stream_flush (stream, GST_TS_DEMUX_CAST (base), TRUE);
 
   if (stream->taglist != NULL) {
@@ -1828,6 +2459,8 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
   }
 
   tsdemux_h264_parsing_info_clear (&stream->h264infos);
+  tsdemux_h265_parsing_info_clear (&stream->h265infos);
+  tsdemux_mpegvideo_parsing_info_clear (&stream->mpegvideoinfos);
 }
 
 static void
@@ -1838,6 +2471,9 @@ activate_pad_for_stream (GstTSDemux * tsdemux, TSDemuxStream * stream)
         GST_DEBUG_PAD_NAME (stream->pad), stream);
     gst_element_add_pad ((GstElement *) tsdemux, stream->pad);
     stream->active = TRUE;
+    if (stream->queue)
+      gst_pad_start_task (stream->pad,
+          (GstTaskFunction) gst_ts_demux_stream_loop, stream, NULL);
     GST_DEBUG_OBJECT (stream->pad, "done adding pad");
   } else if (((MpegTSBaseStream *) stream)->stream_type != 0xff) {
     GST_DEBUG_OBJECT (tsdemux,
@@ -1855,6 +2491,10 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
 
   g_free (stream->data);
   stream->data = NULL;
+  if (stream->payloads) {
+    gst_buffer_list_unref (stream->payloads);
+    stream->payloads = NULL;
+  }
   stream->state = PENDING_PACKET_EMPTY;
   stream->expected_size = 0;
   stream->allocated_size = 0;
@@ -1940,7 +2580,7 @@ gst_ts_demux_update_program (MpegTSBase * base, MpegTSBaseProgram * program)
          * or serialized event (which means very late in case of subtitle streams),
          * and playsink waits for stream-start or another serialized event */
         GST_DEBUG_OBJECT (stream->pad, "sparse stream, pushing GAP event");
-        gst_pad_push_event (stream->pad, gst_event_new_gap (0, 0));
+        gst_ts_demux_stream_push_event (stream, gst_event_new_gap (0, 0));
       }
     }
   }
@@ -2028,7 +2668,7 @@ gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
          * or serialized event (which means very late in case of subtitle streams),
          * and playsink waits for stream-start or another serialized event */
         GST_DEBUG_OBJECT (stream->pad, "sparse stream, pushing GAP event");
-        gst_pad_push_event (stream->pad, gst_event_new_gap (0, 0));
+        gst_ts_demux_stream_push_event (stream, gst_event_new_gap (0, 0));
       }
     }
 
@@ -2254,6 +2894,61 @@ check_pending_buffers (GstTSDemux * demux)
   return TRUE;
 }
 
+/* Turn the shared payloads of a zero-copy stream into contiguous ->data */
+static void
+gst_ts_demux_stream_merge_payloads (TSDemuxStream * stream)
+{
+  guint i, n;
+  gsize offset = 0;
+
+  g_assert (stream->data == NULL);
+
+  GST_LOG ("merging %u bytes of payload", stream->current_size);
+
+  stream->data = g_malloc (MAX (stream->current_size, 1));
+  n = gst_buffer_list_length (stream->payloads);
+  for (i = 0; i < n; i++) {
+    GstBuffer *buf = gst_buffer_list_get (stream->payloads, i);
+    offset += gst_buffer_extract (buf, 0, stream->data + offset,
+        stream->current_size - offset);
+  }
+  stream->allocated_size = MAX (stream->current_size, 1);
+
+  gst_buffer_list_unref (stream->payloads);
+  stream->payloads = NULL;
+}
+
+/* One buffer for the whole PES, made of the memories of the payloads if a
+ * buffer can hold them all, copied otherwise */
+static GstBuffer *
+gst_ts_demux_stream_take_payloads (TSDemuxStream * stream)
+{
+  GstBuffer *buffer;
+  guint i, j, n, n_memory = 0;
+
+  n = gst_buffer_list_length (stream->payloads);
+  for (i = 0; i < n; i++)
+    n_memory += gst_buffer_n_memory (gst_buffer_list_get (stream->payloads, i));
+
+  if (n_memory > gst_buffer_get_max_memory ()) {
+    gst_ts_demux_stream_merge_payloads (stream);
+    return gst_buffer_new_wrapped (stream->data, stream->current_size);
+  }
+
+  buffer = gst_buffer_new ();
+  for (i = 0; i < n; i++) {
+    GstBuffer *payload = gst_buffer_list_get (stream->payloads, i);
+
+    for (j = 0; j < gst_buffer_n_memory (payload); j++)
+      gst_buffer_append_memory (buffer, gst_buffer_get_memory (payload, j));
+  }
+
+  gst_buffer_list_unref (stream->payloads);
+  stream->payloads = NULL;
+
+  return buffer;
+}
+
 static void
 gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
     guint8 * data, guint32 length, guint64 bufferoffset)
@@ -2312,13 +3007,28 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   data += header.header_size;
   length -= header.header_size;
 
+  g_assert (stream->data == NULL && stream->payloads == NULL);
+
+  if (demux->zero_copy && MPEG_TS_BASE_PACKETIZER (demux)->map_buffer) {
+    /* Keep references to the input data, one TS payload per buffer */
+    guint n = stream->expected_size ? stream->expected_size / 184 + 1 : 64;
+
+    stream->payloads = gst_buffer_list_new_sized (n);
+    if (length)
+      gst_buffer_list_add (stream->payloads,
+          mpegts_packetizer_share_data (MPEG_TS_BASE_PACKETIZER (demux), data,
+              length));
+    stream->current_size = length;
+    stream->state = PENDING_PACKET_BUFFER;
+    return;
+  }
+
   /* Create the output buffer */
   if (stream->expected_size)
     stream->allocated_size = MAX (stream->expected_size, length);
   else
     stream->allocated_size = MAX (8192, length);
 
-  g_assert (stream->data == NULL);
   stream->data = g_malloc (stream->allocated_size);
   memcpy (stream->data, data, length);
   stream->current_size = length;
@@ -2384,6 +3094,17 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_BUFFER:
     {
       GST_LOG ("BUFFER: appending data");
+      if (stream->payloads) {
+        if (G_LIKELY (MPEG_TS_BASE_PACKETIZER (demux)->map_buffer)) {
+          gst_buffer_list_add (stream->payloads,
+              mpegts_packetizer_share_data (MPEG_TS_BASE_PACKETIZER (demux),
+                  data, size));
+          stream->current_size += size;
+          break;
+        }
+        /* zero-copy was disabled in the middle of this PES */
+        gst_ts_demux_stream_merge_payloads (stream);
+      }
       if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
         GST_LOG ("resizing buffer");
         do {
@@ -2402,6 +3123,10 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
         g_free (stream->data);
         stream->data = NULL;
       }
+      if (G_UNLIKELY (stream->payloads)) {
+        gst_buffer_list_unref (stream->payloads);
+        stream->payloads = NULL;
+      }
       stream->continuity_counter = CONTINUITY_UNSET;
       break;
     }
@@ -2490,11 +3215,11 @@ push_new_segment:
     if (demux->segment_event) {
       GST_DEBUG_OBJECT (stream->pad, "Pushing newsegment event");
       gst_event_ref (demux->segment_event);
-      gst_pad_push_event (stream->pad, demux->segment_event);
+      gst_ts_demux_stream_push_event (stream, demux->segment_event);
     }
 
     if (demux->global_tags) {
-      gst_pad_push_event (stream->pad,
+      gst_ts_demux_stream_push_event (stream,
           gst_event_new_tag (gst_tag_list_ref (demux->global_tags)));
     }
 
@@ -2502,7 +3227,8 @@ push_new_segment:
     if (stream->taglist) {
       GST_DEBUG_OBJECT (stream->pad, "Sending tags %" GST_PTR_FORMAT,
           stream->taglist);
-      gst_pad_push_event (stream->pad, gst_event_new_tag (stream->taglist));
+      gst_ts_demux_stream_push_event (stream,
+          gst_event_new_tag (stream->taglist));
       stream->taglist = NULL;
     }
 
@@ -2560,7 +3286,7 @@ gst_ts_demux_check_and_sync_streams (GstTSDemux * demux, GstClockTime time)
         calculate_and_push_newsegment (demux, ps, NULL);
 
       /* Now send gap event */
-      gst_pad_push_event (ps->pad, gst_event_new_gap (time, 0));
+      gst_ts_demux_stream_push_event (ps, gst_event_new_gap (time, 0));
     }
 
     /* Update GAP tracking vars so we don't re-check this stream for a while */
@@ -2825,7 +3551,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
       "stream:%p, pid:0x%04x stream_type:%d state:%d", stream, bs->pid,
       bs->stream_type, stream->state);
 
-  if (G_UNLIKELY (stream->data == NULL)) {
+  if (G_UNLIKELY (stream->data == NULL && stream->payloads == NULL)) {
     GST_LOG ("stream->data == NULL");
     goto beach;
   }
@@ -2846,6 +3572,13 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
     goto beach;
   }
 
+  /* Keyframe scanning and access unit parsing need contiguous data */
+  if (stream->payloads && (stream->needs_keyframe ||
+          bs->stream_type == GST_MPEGTS_STREAM_TYPE_VIDEO_JP2K ||
+          (bs->stream_type == GST_MPEGTS_STREAM_TYPE_PRIVATE_PES_PACKETS &&
+              bs->registration_id == DRF_ID_OPUS)))
+    gst_ts_demux_stream_merge_payloads (stream);
+
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
@@ -2914,6 +3647,8 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         res = GST_FLOW_ERROR;
         goto beach;
       }
+    } else if (stream->payloads) {
+      buffer = gst_ts_demux_stream_take_payloads (stream);
     } else {
       buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
     }
@@ -2963,7 +3698,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         GST_BUFFER_FLAG_SET (pend->buffer, GST_BUFFER_FLAG_DISCONT);
       stream->discont = FALSE;
 
-      res = gst_pad_push (stream->pad, pend->buffer);
+      res = gst_ts_demux_stream_push_buffer (stream, pend->buffer);
       stream->nb_out_buffers += 1;
       g_slice_free (PendingBuffer, pend);
     }
@@ -3018,12 +3753,12 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
     demux->segment.position = stream->pts;
 
   if (buffer) {
-    res = gst_pad_push (stream->pad, buffer);
+    res = gst_ts_demux_stream_push_buffer (stream, buffer);
     /* Record that a buffer was pushed */
     stream->nb_out_buffers += 1;
   } else {
     guint n = gst_buffer_list_length (buffer_list);
-    res = gst_pad_push_list (stream->pad, buffer_list);
+    res = gst_ts_demux_stream_push_list (stream, buffer_list);
     /* Record that a buffer was pushed */
     stream->nb_out_buffers += n;
   }
@@ -3061,6 +3796,10 @@ beach:
   GST_LOG ("Resetting to EMPTY, returning %s", gst_flow_get_name (res));
   stream->state = PENDING_PACKET_EMPTY;
   stream->data = NULL;
+  if (stream->payloads) {
+    gst_buffer_list_unref (stream->payloads);
+    stream->payloads = NULL;
+  }
   stream->expected_size = 0;
   stream->current_size = 0;
 
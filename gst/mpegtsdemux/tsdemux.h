@@ -76,6 +76,8 @@ struct _GstTSDemux
   gint requested_program_number; /* Required program number (ignore:-1) */
   guint program_number;
   gboolean emit_statistics;
+  gboolean zero_copy;
+  gboolean threaded_push;
 
   /*< private >*/
   gint program_generation; /* Incremented each time we switch program 0..15 */
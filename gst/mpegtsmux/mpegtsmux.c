@@ -105,8 +105,6 @@
 GST_DEBUG_CATEGORY (mpegtsmux_debug);
 #define GST_CAT_DEFAULT mpegtsmux_debug
 
-#define COLLECT_DATA_PAD(collect_data) (((GstCollectData *)(collect_data))->pad)
-
 enum
 {
   PROP_0,
@@ -115,11 +113,17 @@ enum
   PROP_PAT_INTERVAL,
   PROP_PMT_INTERVAL,
   PROP_ALIGNMENT,
-  PROP_SI_INTERVAL
+  PROP_SI_INTERVAL,
+  PROP_BITRATE,
+  PROP_PCR_INTERVAL
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
+
+/* Packets preallocated in the packet pool, about 80ms of a 20 Mbit/s stream */
+#define MPEGTSMUX_PACKET_POOL_MIN_BUFFERS 1024
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
+#define MPEGTSMUX_DEFAULT_BITRATE      0
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
@@ -172,6 +176,7 @@ static void gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
 static void mpegtsmux_reset (MpegTsMux * mux, gboolean alloc);
+static void mpegtsmux_pad_reset (MpegTsPadData * pad_data);
 static void mpegtsmux_dispose (GObject * object);
 static void alloc_packet_cb (GstBuffer ** _buf, void *user_data);
 static gboolean new_packet_cb (GstBuffer * buf, void *user_data,
@@ -184,23 +189,20 @@ static gboolean new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf,
     gint64 new_pcr);
 
 static void mpegtsmux_prepare_srcpad (MpegTsMux * mux);
-GstFlowReturn mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
-    GstCollectData * cdata, GstBuffer * buf, GstBuffer ** outbuf,
-    gpointer user_data);
-static GstFlowReturn mpegtsmux_collected_buffer (GstCollectPads * pads,
-    GstCollectData * data, GstBuffer * buf, MpegTsMux * mux);
-
-static gboolean mpegtsmux_sink_event (GstCollectPads * pads,
-    GstCollectData * data, GstEvent * event, gpointer user_data);
-static GstPad *mpegtsmux_request_new_pad (GstElement * element,
+static GstBuffer *mpegtsmux_clip_inc_running_time (GstAggregator * agg,
+    GstAggregatorPad * agg_pad, GstBuffer * buf);
+static GstFlowReturn mpegtsmux_aggregate (GstAggregator * agg,
+    gboolean timeout);
+static GstClockTime mpegtsmux_get_next_time (GstAggregator * agg);
+static gboolean mpegtsmux_stop (GstAggregator * agg);
+
+static gboolean mpegtsmux_sink_event (GstAggregator * agg,
+    GstAggregatorPad * agg_pad, GstEvent * event);
+static GstAggregatorPad *mpegtsmux_create_new_pad (GstAggregator * agg,
     GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
-static void mpegtsmux_release_pad (GstElement * element, GstPad * pad);
-static GstStateChangeReturn mpegtsmux_change_state (GstElement * element,
-    GstStateChange transition);
 static gboolean mpegtsmux_send_event (GstElement * element, GstEvent * event);
 static void mpegtsmux_set_header_on_caps (MpegTsMux * mux);
-static gboolean mpegtsmux_src_event (GstPad * pad, GstObject * parent,
-    GstEvent * event);
+static gboolean mpegtsmux_src_event (GstAggregator * agg, GstEvent * event);
 
 #if 0
 static void mpegtsmux_set_index (GstElement * element, GstIndex * index);
@@ -216,7 +218,41 @@ typedef struct
   GstBuffer *buffer;
 } StreamData;
 
-G_DEFINE_TYPE (MpegTsMux, mpegtsmux, GST_TYPE_ELEMENT)
+G_DEFINE_TYPE (MpegTsPadData, mpegtsmux_pad, GST_TYPE_AGGREGATOR_PAD);
+
+static void
+mpegtsmux_pad_dispose (GObject * object)
+{
+  mpegtsmux_pad_reset (GST_MPEG_TSMUX_PAD (object));
+
+  G_OBJECT_CLASS (mpegtsmux_pad_parent_class)->dispose (object);
+}
+
+static GstFlowReturn
+mpegtsmux_pad_flush (GstAggregatorPad * agg_pad, GstAggregator * agg)
+{
+  GST_MPEG_TSMUX_PAD (agg_pad)->dts = GST_CLOCK_STIME_NONE;
+
+  return GST_FLOW_OK;
+}
+
+static void
+mpegtsmux_pad_class_init (MpegTsPadDataClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstAggregatorPadClass *gstaggpad_class = GST_AGGREGATOR_PAD_CLASS (klass);
+
+  gobject_class->dispose = mpegtsmux_pad_dispose;
+  gstaggpad_class->flush = GST_DEBUG_FUNCPTR (mpegtsmux_pad_flush);
+}
+
+static void
+mpegtsmux_pad_init (MpegTsPadData * pad_data)
+{
+  mpegtsmux_pad_reset (pad_data);
+}
+
+G_DEFINE_TYPE (MpegTsMux, mpegtsmux, GST_TYPE_AGGREGATOR)
 
 /* Takes over the ref on the buffer */
      static StreamData *stream_data_new (GstBuffer * buffer)
@@ -245,11 +281,12 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
 {
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstAggregatorClass *gstagg_class = GST_AGGREGATOR_CLASS (klass);
 
-  gst_element_class_add_static_pad_template (gstelement_class,
-      &mpegtsmux_sink_factory);
-  gst_element_class_add_static_pad_template (gstelement_class,
-      &mpegtsmux_src_factory);
+  gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
+      &mpegtsmux_sink_factory, GST_TYPE_MPEG_TSMUX_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
+      &mpegtsmux_src_factory, GST_TYPE_AGGREGATOR_PAD);
 
   gst_element_class_set_static_metadata (gstelement_class,
       "MPEG Transport Stream Muxer", "Codec/Muxer",
@@ -260,11 +297,16 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
   gobject_class->get_property = GST_DEBUG_FUNCPTR (gst_mpegtsmux_get_property);
   gobject_class->dispose = mpegtsmux_dispose;
 
-  gstelement_class->request_new_pad = mpegtsmux_request_new_pad;
-  gstelement_class->release_pad = mpegtsmux_release_pad;
-  gstelement_class->change_state = mpegtsmux_change_state;
   gstelement_class->send_event = mpegtsmux_send_event;
 
+  gstagg_class->create_new_pad = GST_DEBUG_FUNCPTR (mpegtsmux_create_new_pad);
+  gstagg_class->sink_event = GST_DEBUG_FUNCPTR (mpegtsmux_sink_event);
+  gstagg_class->src_event = GST_DEBUG_FUNCPTR (mpegtsmux_src_event);
+  gstagg_class->clip = GST_DEBUG_FUNCPTR (mpegtsmux_clip_inc_running_time);
+  gstagg_class->aggregate = GST_DEBUG_FUNCPTR (mpegtsmux_aggregate);
+  gstagg_class->get_next_time = GST_DEBUG_FUNCPTR (mpegtsmux_get_next_time);
+  gstagg_class->stop = GST_DEBUG_FUNCPTR (mpegtsmux_stop);
+
 #if 0
   gstelement_class->set_index = GST_DEBUG_FUNCPTR (mpegtsmux_set_index);
   gstelement_class->get_index = GST_DEBUG_FUNCPTR (mpegtsmux_get_index);
@@ -305,28 +347,27 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "Set the interval (in ticks of the 90kHz clock) for writing out the Service"
           "Information tables", 1, G_MAXUINT, TSMUX_DEFAULT_SI_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_BITRATE,
+      g_param_spec_uint64 ("bitrate", "Bitrate (in bits per second)",
+          "Set the target bitrate, will insert null packets as padding "
+          "to achieve multiplex-wide constant bitrate (0 = VBR). "
+          "Padding is written up to the next input data, so the output "
+          "only keeps going while the inputs stall in live pipelines",
+          0, G_MAXUINT64, MPEGTSMUX_DEFAULT_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_PCR_INTERVAL,
+      g_param_spec_uint ("pcr-interval", "PCR interval",
+          "Set the interval (in ticks of the 90kHz clock) for writing PCR",
+          1, G_MAXUINT, TSMUX_DEFAULT_PCR_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 mpegtsmux_init (MpegTsMux * mux)
 {
-  mux->srcpad =
-      gst_pad_new_from_static_template (&mpegtsmux_src_factory, "src");
-  gst_pad_use_fixed_caps (mux->srcpad);
-  gst_pad_set_event_function (mux->srcpad,
-      GST_DEBUG_FUNCPTR (mpegtsmux_src_event));
-  gst_element_add_pad (GST_ELEMENT (mux), mux->srcpad);
-
-  mux->collect = gst_collect_pads_new ();
-  gst_collect_pads_set_buffer_function (mux->collect,
-      (GstCollectPadsBufferFunction)
-      GST_DEBUG_FUNCPTR (mpegtsmux_collected_buffer), mux);
-
-  gst_collect_pads_set_event_function (mux->collect,
-      (GstCollectPadsEventFunction) GST_DEBUG_FUNCPTR (mpegtsmux_sink_event),
-      mux);
-  gst_collect_pads_set_clip_function (mux->collect, (GstCollectPadsClipFunction)
-      GST_DEBUG_FUNCPTR (mpegtsmux_clip_inc_running_time), mux);
+  gst_pad_use_fixed_caps (GST_AGGREGATOR_SRC_PAD (mux));
 
   mux->adapter = gst_adapter_new ();
   mux->out_adapter = gst_adapter_new ();
@@ -336,6 +377,8 @@ mpegtsmux_init (MpegTsMux * mux)
   mux->pat_interval = TSMUX_DEFAULT_PAT_INTERVAL;
   mux->pmt_interval = TSMUX_DEFAULT_PMT_INTERVAL;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
+  mux->bitrate = MPEGTSMUX_DEFAULT_BITRATE;
+  mux->pcr_interval = TSMUX_DEFAULT_PCR_INTERVAL;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
 
@@ -377,7 +420,7 @@ static void
 mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
 {
   GstBuffer *buf;
-  GSList *walk;
+  GList *walk;
 
   mux->first = TRUE;
   mux->last_flow_ret = GST_FLOW_OK;
@@ -404,6 +447,12 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   if (mux->out_adapter)
     gst_adapter_clear (mux->out_adapter);
 
+  if (mux->packet_pool) {
+    gst_buffer_pool_set_active (mux->packet_pool, FALSE);
+    gst_object_unref (mux->packet_pool);
+    mux->packet_pool = NULL;
+  }
+
   if (mux->tsmux) {
     tsmux_free (mux->tsmux);
     mux->tsmux = NULL;
@@ -420,17 +469,18 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   gst_event_replace (&mux->force_key_unit_event, NULL);
   gst_buffer_replace (&mux->out_buffer, NULL);
 
-  if (mux->collect) {
-    GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
-    for (walk = mux->collect->data; walk != NULL; walk = g_slist_next (walk))
-      mpegtsmux_pad_reset ((MpegTsPadData *) walk->data);
-    GST_COLLECT_PADS_STREAM_UNLOCK (mux->collect);
-  }
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT_CAST (mux)->sinkpads; walk != NULL;
+      walk = g_list_next (walk))
+    mpegtsmux_pad_reset ((MpegTsPadData *) walk->data);
+  GST_OBJECT_UNLOCK (mux);
 
   if (alloc) {
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
     tsmux_set_alloc_func (mux->tsmux, alloc_packet_cb, mux);
+    tsmux_set_bitrate (mux->tsmux, mux->bitrate);
+    tsmux_set_pcr_interval (mux->tsmux, mux->pcr_interval);
   }
 }
 
@@ -449,10 +499,6 @@ mpegtsmux_dispose (GObject * object)
     g_object_unref (mux->out_adapter);
     mux->out_adapter = NULL;
   }
-  if (mux->collect) {
-    gst_object_unref (mux->collect);
-    mux->collect = NULL;
-  }
   if (mux->prog_map) {
     gst_structure_free (mux->prog_map);
     mux->prog_map = NULL;
@@ -469,7 +515,7 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
   MpegTsMux *mux = GST_MPEG_TSMUX (object);
-  GSList *walk;
+  GList *walk;
 
   switch (prop_id) {
     case PROP_M2TS_MODE:
@@ -494,15 +540,18 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
         tsmux_set_pat_interval (mux->tsmux, mux->pat_interval);
       break;
     case PROP_PMT_INTERVAL:
-      walk = mux->collect->data;
+      GST_OBJECT_LOCK (mux);
+      walk = GST_ELEMENT_CAST (mux)->sinkpads;
       mux->pmt_interval = g_value_get_uint (value);
 
       while (walk) {
         MpegTsPadData *ts_data = (MpegTsPadData *) walk->data;
 
-        tsmux_set_pmt_interval (ts_data->prog, mux->pmt_interval);
-        walk = g_slist_next (walk);
+        if (ts_data->prog)
+          tsmux_set_pmt_interval (ts_data->prog, mux->pmt_interval);
+        walk = g_list_next (walk);
       }
+      GST_OBJECT_UNLOCK (mux);
       break;
     case PROP_ALIGNMENT:
       mux->alignment = g_value_get_int (value);
@@ -511,6 +560,16 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
       mux->si_interval = g_value_get_uint (value);
       tsmux_set_si_interval (mux->tsmux, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      mux->bitrate = g_value_get_uint64 (value);
+      if (mux->tsmux)
+        tsmux_set_bitrate (mux->tsmux, mux->bitrate);
+      break;
+    case PROP_PCR_INTERVAL:
+      mux->pcr_interval = g_value_get_uint (value);
+      if (mux->tsmux)
+        tsmux_set_pcr_interval (mux->tsmux, mux->pcr_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -542,6 +601,12 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case PROP_SI_INTERVAL:
       g_value_set_uint (value, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      g_value_set_uint64 (value, mux->bitrate);
+      break;
+    case PROP_PCR_INTERVAL:
+      g_value_set_uint (value, mux->pcr_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -604,7 +669,7 @@ mpegtsmux_create_stream (MpegTsMux * mux, MpegTsPadData * ts_data)
   guint8 color_spec = 0;
   j2k_private_data *private_data = NULL;
 
-  pad = ts_data->collect.pad;
+  pad = GST_PAD_CAST (ts_data);
   caps = gst_pad_get_current_caps (pad);
   if (caps == NULL)
     goto not_negotiated;
@@ -920,80 +985,70 @@ not_negotiated:
 }
 
 static GstFlowReturn
-mpegtsmux_create_streams (MpegTsMux * mux)
+mpegtsmux_create_pad_stream (MpegTsMux * mux, MpegTsPadData * ts_data)
 {
   GstFlowReturn ret = GST_FLOW_OK;
-  GSList *walk = mux->collect->data;
-
-  /* Create the streams */
-  while (walk) {
-    GstCollectData *c_data = (GstCollectData *) walk->data;
-    MpegTsPadData *ts_data = (MpegTsPadData *) walk->data;
-    gchar *name = NULL;
-
-    walk = g_slist_next (walk);
-
-    if (ts_data->prog_id == -1) {
-      name = GST_PAD_NAME (c_data->pad);
-      if (mux->prog_map != NULL && gst_structure_has_field (mux->prog_map,
-              name)) {
-        gint idx;
-        gboolean ret = gst_structure_get_int (mux->prog_map, name, &idx);
-        if (!ret) {
-          GST_ELEMENT_ERROR (mux, STREAM, MUX,
-              ("Reading program map failed. Assuming default"), (NULL));
-          idx = DEFAULT_PROG_ID;
-        }
-        if (idx < 0) {
-          GST_DEBUG_OBJECT (mux, "Program number %d associate with pad %s less "
-              "than zero; DEFAULT_PROGRAM = %d is used instead",
-              idx, name, DEFAULT_PROG_ID);
-          idx = DEFAULT_PROG_ID;
-        }
-        ts_data->prog_id = idx;
-      } else {
-        ts_data->prog_id = DEFAULT_PROG_ID;
+  gchar *name = NULL;
+
+  if (ts_data->prog_id == -1) {
+    name = GST_PAD_NAME (ts_data);
+    if (mux->prog_map != NULL && gst_structure_has_field (mux->prog_map, name)) {
+      gint idx;
+      gboolean ret = gst_structure_get_int (mux->prog_map, name, &idx);
+      if (!ret) {
+        GST_ELEMENT_ERROR (mux, STREAM, MUX,
+            ("Reading program map failed. Assuming default"), (NULL));
+        idx = DEFAULT_PROG_ID;
       }
+      if (idx < 0) {
+        GST_DEBUG_OBJECT (mux, "Program number %d associate with pad %s less "
+            "than zero; DEFAULT_PROGRAM = %d is used instead",
+            idx, name, DEFAULT_PROG_ID);
+        idx = DEFAULT_PROG_ID;
+      }
+      ts_data->prog_id = idx;
+    } else {
+      ts_data->prog_id = DEFAULT_PROG_ID;
+    }
 
-      if (!ts_data->pid) {
-        gint pid = -1;
+    if (!ts_data->pid) {
+      gint pid = -1;
 
-        name = GST_PAD_NAME (c_data->pad);
-        if (name != NULL && sscanf (name, "sink_%d", &pid) == 1) {
-          if (tsmux_find_stream (mux->tsmux, pid)) {
-            GST_WARNING_OBJECT (mux, "Duplicate PID");
-          }
-        } else {
-          pid = tsmux_get_new_pid (mux->tsmux);
+      name = GST_PAD_NAME (ts_data);
+      if (name != NULL && sscanf (name, "sink_%d", &pid) == 1) {
+        if (tsmux_find_stream (mux->tsmux, pid)) {
+          GST_WARNING_OBJECT (mux, "Duplicate PID");
         }
-
-        ts_data->pid = pid;
+      } else {
+        pid = tsmux_get_new_pid (mux->tsmux);
       }
-    }
 
-    ts_data->prog =
-        g_hash_table_lookup (mux->programs, GINT_TO_POINTER (ts_data->prog_id));
-    if (ts_data->prog == NULL) {
-      ts_data->prog = tsmux_program_new (mux->tsmux, ts_data->prog_id);
-      if (ts_data->prog == NULL)
-        goto no_program;
-      tsmux_set_pmt_interval (ts_data->prog, mux->pmt_interval);
-      g_hash_table_insert (mux->programs,
-          GINT_TO_POINTER (ts_data->prog_id), ts_data->prog);
-
-      /* Take the first stream of the program for the PCR */
-      GST_DEBUG_OBJECT (COLLECT_DATA_PAD (ts_data),
-          "Use stream (pid=%d) from pad as PCR for program (prog_id = %d)",
-          ts_data->pid, ts_data->prog_id);
-
-      tsmux_program_set_pcr_stream (ts_data->prog, ts_data->stream);
+      ts_data->pid = pid;
     }
+  }
 
-    if (ts_data->stream == NULL) {
-      ret = mpegtsmux_create_stream (mux, ts_data);
-      if (ret != GST_FLOW_OK)
-        goto no_stream;
-    }
+  ts_data->prog =
+      g_hash_table_lookup (mux->programs, GINT_TO_POINTER (ts_data->prog_id));
+  if (ts_data->prog == NULL) {
+    ts_data->prog = tsmux_program_new (mux->tsmux, ts_data->prog_id);
+    if (ts_data->prog == NULL)
+      goto no_program;
+    tsmux_set_pmt_interval (ts_data->prog, mux->pmt_interval);
+    g_hash_table_insert (mux->programs,
+        GINT_TO_POINTER (ts_data->prog_id), ts_data->prog);
+
+    /* Take the first stream of the program for the PCR */
+    GST_DEBUG_OBJECT (GST_PAD_CAST (ts_data),
+        "Use stream (pid=%d) from pad as PCR for program (prog_id = %d)",
+        ts_data->pid, ts_data->prog_id);
+
+    tsmux_program_set_pcr_stream (ts_data->prog, ts_data->stream);
+  }
+
+  if (ts_data->stream == NULL) {
+    ret = mpegtsmux_create_stream (mux, ts_data);
+    if (ret != GST_FLOW_OK)
+      goto no_stream;
   }
 
   return GST_FLOW_OK;
@@ -1013,19 +1068,49 @@ no_stream:
   }
 }
 
+static GstFlowReturn
+mpegtsmux_create_streams (MpegTsMux * mux)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GList *pads, *walk;
+
+  GST_OBJECT_LOCK (mux);
+  pads = g_list_copy_deep (GST_ELEMENT_CAST (mux)->sinkpads,
+      (GCopyFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (mux);
+
+  /* Create the streams */
+  for (walk = pads; walk != NULL && ret == GST_FLOW_OK; walk = walk->next) {
+    MpegTsPadData *ts_data = (MpegTsPadData *) walk->data;
+
+    /* A sparse or late input may not be configured yet when the first
+     * buffers are output, its stream is added to the PMT once it is */
+    if (!gst_pad_has_current_caps (GST_PAD_CAST (ts_data))) {
+      GST_DEBUG_OBJECT (ts_data, "No caps yet, creating the stream later");
+      continue;
+    }
+
+    ret = mpegtsmux_create_pad_stream (mux, ts_data);
+  }
+
+  g_list_free_full (pads, gst_object_unref);
+
+  return ret;
+}
+
 static gboolean
-mpegtsmux_sink_event (GstCollectPads * pads, GstCollectData * data,
-    GstEvent * event, gpointer user_data)
+mpegtsmux_sink_event (GstAggregator * agg, GstAggregatorPad * agg_pad,
+    GstEvent * event)
 {
-  MpegTsMux *mux = GST_MPEG_TSMUX (user_data);
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
   gboolean res = FALSE;
   gboolean forward = TRUE;
-  MpegTsPadData *pad_data = (MpegTsPadData *) data;
+  MpegTsPadData *pad_data = GST_MPEG_TSMUX_PAD (agg_pad);
 
 #ifndef GST_DISABLE_GST_DEBUG
   GstPad *pad;
 
-  pad = data->pad;
+  pad = GST_PAD_CAST (agg_pad);
 #endif
 
   switch (GST_EVENT_TYPE (event)) {
@@ -1083,7 +1168,7 @@ mpegtsmux_sink_event (GstCollectPads * pads, GstCollectData * data,
         g_free (lang);
       }
 
-      /* handled this, don't want collectpads to forward it downstream */
+      /* handled this, only global tags are forwarded downstream */
       res = TRUE;
       forward = gst_tag_list_get_scope (list) == GST_TAG_SCOPE_GLOBAL;
       break;
@@ -1093,12 +1178,10 @@ mpegtsmux_sink_event (GstCollectPads * pads, GstCollectData * data,
 
       gst_event_parse_stream_flags (event, &flags);
 
-      /* Don't wait for data on sparse inputs like metadata streams */
-      if ((flags & GST_STREAM_FLAG_SPARSE)) {
-        GST_COLLECT_PADS_STATE_UNSET (data, GST_COLLECT_PADS_STATE_LOCKED);
-        gst_collect_pads_set_waiting (pads, data, FALSE);
-        GST_COLLECT_PADS_STATE_SET (data, GST_COLLECT_PADS_STATE_LOCKED);
-      }
+      /* Sparse inputs like metadata streams are not waited for beyond the
+       * latency when live, otherwise they need to send gap events */
+      if ((flags & GST_STREAM_FLAG_SPARSE))
+        GST_DEBUG_OBJECT (pad, "sparse stream");
       break;
     }
     default:
@@ -1109,15 +1192,16 @@ out:
   if (!forward)
     gst_event_unref (event);
   else
-    res = gst_collect_pads_event_default (pads, data, event, FALSE);
+    res = GST_AGGREGATOR_CLASS (parent_class)->sink_event (agg, agg_pad,
+        event);
 
   return res;
 }
 
 static gboolean
-mpegtsmux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
+mpegtsmux_src_event (GstAggregator * agg, GstEvent * event)
 {
-  MpegTsMux *mux = GST_MPEG_TSMUX (parent);
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
   gboolean res = TRUE, forward = TRUE;
 
   switch (GST_EVENT_TYPE (event)) {
@@ -1163,7 +1247,7 @@ mpegtsmux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
             done = TRUE;
             break;
           case GST_ITERATOR_OK:
-            GST_INFO_OBJECT (pad, "forwarding");
+            GST_INFO_OBJECT (sinkpad, "forwarding");
             tmp = gst_pad_push_event (sinkpad, gst_event_ref (event));
             GST_INFO_OBJECT (mux, "result %d", tmp);
             /* succeed if at least one pad succeeds */
@@ -1186,7 +1270,7 @@ mpegtsmux_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
   }
 
   if (forward)
-    res = gst_pad_event_default (pad, parent, event);
+    res = GST_AGGREGATOR_CLASS (parent_class)->src_event (agg, event);
   else
     gst_event_unref (event);
 
@@ -1244,33 +1328,30 @@ out:
   return event;
 }
 
-GstFlowReturn
-mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
-    GstCollectData * cdata, GstBuffer * buf, GstBuffer ** outbuf,
-    gpointer user_data)
+static GstBuffer *
+mpegtsmux_clip_inc_running_time (GstAggregator * agg,
+    GstAggregatorPad * agg_pad, GstBuffer * buf)
 {
-  MpegTsPadData *pad_data = (MpegTsPadData *) cdata;
+  MpegTsPadData *pad_data = GST_MPEG_TSMUX_PAD (agg_pad);
   GstClockTime time;
 
-  *outbuf = buf;
-
   /* PTS */
   time = GST_BUFFER_PTS (buf);
 
   /* invalid left alone and passed */
   if (G_LIKELY (GST_CLOCK_TIME_IS_VALID (time))) {
-    time = gst_segment_to_running_time (&cdata->segment, GST_FORMAT_TIME, time);
+    time = gst_segment_to_running_time (&agg_pad->segment, GST_FORMAT_TIME,
+        time);
     if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (time))) {
-      GST_DEBUG_OBJECT (cdata->pad, "clipping buffer on pad outside segment");
+      GST_DEBUG_OBJECT (agg_pad, "clipping buffer on pad outside segment");
       gst_buffer_unref (buf);
-      *outbuf = NULL;
-      goto beach;
+      return NULL;
     } else {
-      GST_LOG_OBJECT (cdata->pad, "buffer pts %" GST_TIME_FORMAT " ->  %"
+      GST_LOG_OBJECT (agg_pad, "buffer pts %" GST_TIME_FORMAT " ->  %"
           GST_TIME_FORMAT " running time",
           GST_TIME_ARGS (GST_BUFFER_PTS (buf)), GST_TIME_ARGS (time));
-      buf = *outbuf = gst_buffer_make_writable (buf);
-      GST_BUFFER_PTS (*outbuf) = time;
+      buf = gst_buffer_make_writable (buf);
+      GST_BUFFER_PTS (buf) = time;
     }
   }
 
@@ -1282,78 +1363,55 @@ mpegtsmux_clip_inc_running_time (GstCollectPads * pads,
     gint sign;
     gint64 dts;
 
-    sign = gst_segment_to_running_time_full (&cdata->segment, GST_FORMAT_TIME,
-        time, &time);
+    sign = gst_segment_to_running_time_full (&agg_pad->segment,
+        GST_FORMAT_TIME, time, &time);
 
     if (sign > 0)
       dts = (gint64) time;
     else
       dts = -((gint64) time);
 
-    GST_LOG_OBJECT (cdata->pad, "buffer dts %" GST_TIME_FORMAT " -> %"
+    GST_LOG_OBJECT (agg_pad, "buffer dts %" GST_TIME_FORMAT " -> %"
         GST_STIME_FORMAT " running time", GST_TIME_ARGS (GST_BUFFER_DTS (buf)),
         GST_STIME_ARGS (dts));
 
     if (GST_CLOCK_STIME_IS_VALID (pad_data->dts) && dts < pad_data->dts) {
       /* Ignore DTS going backward */
-      GST_WARNING_OBJECT (cdata->pad, "ignoring DTS going backward");
+      GST_WARNING_OBJECT (agg_pad, "ignoring DTS going backward");
       dts = pad_data->dts;
     }
 
-    *outbuf = gst_buffer_make_writable (buf);
+    buf = gst_buffer_make_writable (buf);
     if (sign > 0)
-      GST_BUFFER_DTS (*outbuf) = time;
+      GST_BUFFER_DTS (buf) = time;
     else
-      GST_BUFFER_DTS (*outbuf) = GST_CLOCK_TIME_NONE;
+      GST_BUFFER_DTS (buf) = GST_CLOCK_TIME_NONE;
 
     pad_data->dts = dts;
   } else {
     pad_data->dts = GST_CLOCK_STIME_NONE;
   }
 
-beach:
-  return GST_FLOW_OK;
+  return buf;
 }
 
 static GstFlowReturn
-mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
-    GstBuffer * buf, MpegTsMux * mux)
+mpegtsmux_mux_buffer (MpegTsMux * mux, MpegTsPadData * best, GstBuffer * buf)
 {
   GstFlowReturn ret = GST_FLOW_OK;
-  MpegTsPadData *best = (MpegTsPadData *) data;
   TsMuxProgram *prog;
   gint64 pts = GST_CLOCK_STIME_NONE;
   gint64 dts = GST_CLOCK_STIME_NONE;
   gboolean delta = TRUE, header = FALSE;
   StreamData *stream_data;
 
-  GST_DEBUG_OBJECT (mux, "Pads collected");
-
-  if (G_UNLIKELY (mux->first)) {
-    ret = mpegtsmux_create_streams (mux);
+  if (G_UNLIKELY (best->stream == NULL)) {
+    /* input that had no caps yet when the first buffers were muxed */
+    ret = mpegtsmux_create_pad_stream (mux, best);
     if (G_UNLIKELY (ret != GST_FLOW_OK)) {
-      if (buf)
-        gst_buffer_unref (buf);
+      gst_buffer_unref (buf);
       return ret;
     }
-
-    mpegtsmux_prepare_srcpad (mux);
-
-    mux->first = FALSE;
-  }
-
-  if (G_UNLIKELY (best == NULL)) {
-    /* EOS */
-    GST_INFO_OBJECT (mux, "EOS");
-    /* drain some possibly cached data */
-    new_packet_m2ts (mux, NULL, -1);
-    mpegtsmux_push_packets (mux, TRUE);
-    gst_pad_push_event (mux->srcpad, gst_event_new_eos ());
-
-    if (buf)
-      gst_buffer_unref (buf);
-
-    return GST_FLOW_OK;
   }
 
   prog = best->prog;
@@ -1375,7 +1433,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     GstEvent *event;
 
     event = check_pending_key_unit_event (mux->force_key_unit_event,
-        &best->collect.segment, GST_BUFFER_PTS (buf),
+        &GST_AGGREGATOR_PAD (best)->segment, GST_BUFFER_PTS (buf),
         GST_BUFFER_FLAGS (buf), mux->pending_key_unit_ts);
     if (event) {
       GstClockTime running_time;
@@ -1391,7 +1449,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
       GST_INFO_OBJECT (mux, "pushing downstream force-key-unit event %d "
           "%" GST_TIME_FORMAT " count %d", gst_event_get_seqnum (event),
           GST_TIME_ARGS (running_time), count);
-      gst_pad_push_event (mux->srcpad, event);
+      gst_pad_push_event (GST_AGGREGATOR_SRC_PAD (mux), event);
 
       /* output PAT, SI tables */
       tsmux_resend_pat (mux->tsmux);
@@ -1408,7 +1466,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
 
   if (G_UNLIKELY (prog->pcr_stream == NULL)) {
     /* Take the first data stream for the PCR */
-    GST_DEBUG_OBJECT (COLLECT_DATA_PAD (best),
+    GST_DEBUG_OBJECT (GST_PAD_CAST (best),
         "Use stream (pid=%d) from pad as PCR for program (prog_id = %d)",
         best->pid, best->prog_id);
 
@@ -1416,7 +1474,7 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
     tsmux_program_set_pcr_stream (prog, best->stream);
   }
 
-  GST_DEBUG_OBJECT (COLLECT_DATA_PAD (best),
+  GST_DEBUG_OBJECT (GST_PAD_CAST (best),
       "Chose stream for output (PID: 0x%04x)", best->pid);
 
   if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_PTS (buf))) {
@@ -1499,20 +1557,188 @@ no_program:
       gst_buffer_unref (buf);
     GST_ELEMENT_ERROR (mux, STREAM, MUX,
         ("Stream on pad %" GST_PTR_FORMAT
-            " is not associated with any program", COLLECT_DATA_PAD (best)),
+            " is not associated with any program", GST_PAD_CAST (best)),
         (NULL));
     return GST_FLOW_ERROR;
   }
 }
 
-static GstPad *
-mpegtsmux_request_new_pad (GstElement * element, GstPadTemplate * templ,
+/* Returns the pad holding the buffer with the lowest running time, if any.
+ * Buffers without timestamp go out first. */
+static MpegTsPadData *
+mpegtsmux_find_best_pad (MpegTsMux * mux)
+{
+  MpegTsPadData *best = NULL;
+  GstClockTime best_ts = GST_CLOCK_TIME_NONE;
+  GList *walk;
+
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT_CAST (mux)->sinkpads; walk; walk = walk->next) {
+    MpegTsPadData *ts_data = (MpegTsPadData *) walk->data;
+    GstBuffer *buf;
+    GstClockTime ts;
+
+    buf = gst_aggregator_pad_peek_buffer (GST_AGGREGATOR_PAD (ts_data));
+    if (buf == NULL)
+      continue;
+
+    ts = GST_BUFFER_DTS_OR_PTS (buf);
+    gst_buffer_unref (buf);
+
+    if (best == NULL || !GST_CLOCK_TIME_IS_VALID (ts) ||
+        (GST_CLOCK_TIME_IS_VALID (best_ts) && ts < best_ts)) {
+      best = ts_data;
+      best_ts = ts;
+      if (!GST_CLOCK_TIME_IS_VALID (ts))
+        break;
+    }
+  }
+  if (best)
+    gst_object_ref (best);
+  GST_OBJECT_UNLOCK (mux);
+
+  return best;
+}
+
+static gboolean
+mpegtsmux_all_pads_eos (MpegTsMux * mux)
+{
+  gboolean eos = TRUE;
+  GList *walk;
+
+  GST_OBJECT_LOCK (mux);
+  for (walk = GST_ELEMENT_CAST (mux)->sinkpads; walk && eos; walk = walk->next)
+    eos = gst_aggregator_pad_is_eos (GST_AGGREGATOR_PAD (walk->data));
+  GST_OBJECT_UNLOCK (mux);
+
+  return eos;
+}
+
+/* In CBR mode, the running time up to which the output gets stuffed if
+ * no input data arrives in time */
+static GstClockTime
+mpegtsmux_get_stuffing_time (MpegTsMux * mux)
+{
+  gint64 position;
+
+  if (mux->tsmux == NULL)
+    return GST_CLOCK_TIME_NONE;
+
+  position = tsmux_get_cbr_position (mux->tsmux);
+  if (position == G_MININT64)
+    return GST_CLOCK_TIME_NONE;
+
+  position += mux->pcr_interval;
+  if (position < 0)
+    return GST_CLOCK_TIME_NONE;
+
+  return MPEGTIME_TO_GSTTIME (position);
+}
+
+static GstClockTime
+mpegtsmux_get_next_time (GstAggregator * agg)
+{
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
+  MpegTsPadData *best;
+  GstBuffer *buf;
+  GstClockTime next_time = GST_CLOCK_TIME_NONE;
+
+  /* When live, the base class times out at this running time plus the
+   * latency, and the pads that have data by then are muxed without
+   * waiting for the others */
+  best = mpegtsmux_find_best_pad (mux);
+  if (best == NULL)
+    return mpegtsmux_get_stuffing_time (mux);
+
+  buf = gst_aggregator_pad_peek_buffer (GST_AGGREGATOR_PAD (best));
+  if (buf) {
+    next_time = GST_BUFFER_DTS_OR_PTS (buf);
+    gst_buffer_unref (buf);
+  }
+  gst_object_unref (best);
+
+  return next_time;
+}
+
+static GstFlowReturn
+mpegtsmux_aggregate (GstAggregator * agg, gboolean timeout)
+{
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
+  GstFlowReturn ret = GST_FLOW_OK;
+  MpegTsPadData *best;
+  GstBuffer *buf;
+
+  GST_DEBUG_OBJECT (mux, "Aggregating%s", timeout ? " on timeout" : "");
+
+  if (G_UNLIKELY (mux->first)) {
+    ret = mpegtsmux_create_streams (mux);
+    if (G_UNLIKELY (ret != GST_FLOW_OK))
+      return ret;
+
+    mpegtsmux_prepare_srcpad (mux);
+
+    mux->first = FALSE;
+  }
+
+  best = mpegtsmux_find_best_pad (mux);
+
+  if (G_UNLIKELY (best == NULL)) {
+    if (!mpegtsmux_all_pads_eos (mux)) {
+      GstClockTime stuffing_time;
+
+      /* keep the CBR output going while the (live) inputs stall */
+      if (!timeout)
+        return GST_FLOW_OK;
+
+      stuffing_time = mpegtsmux_get_stuffing_time (mux);
+      if (!GST_CLOCK_TIME_IS_VALID (stuffing_time))
+        return GST_FLOW_OK;
+
+      GST_LOG_OBJECT (mux, "No data, stuffing up to %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (stuffing_time));
+      if (!tsmux_write_cbr_stuffing (mux->tsmux,
+              GSTTIME_TO_MPEGTIME (stuffing_time)))
+        return mux->last_flow_ret;
+
+      return mpegtsmux_push_packets (mux, FALSE);
+    }
+
+    GST_INFO_OBJECT (mux, "EOS");
+    /* drain some possibly cached data */
+    new_packet_m2ts (mux, NULL, -1);
+    mpegtsmux_push_packets (mux, TRUE);
+
+    return GST_FLOW_EOS;
+  }
+
+  buf = gst_aggregator_pad_pop_buffer (GST_AGGREGATOR_PAD (best));
+  if (buf == NULL)
+    goto done;
+
+  if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP) &&
+      gst_buffer_get_size (buf) == 0) {
+    /* gap event turned into a buffer by the base class, nothing to mux */
+    GST_LOG_OBJECT (best, "dropping gap buffer");
+    gst_buffer_unref (buf);
+    goto done;
+  }
+
+  GST_DEBUG_OBJECT (best, "Muxing buffer");
+  ret = mpegtsmux_mux_buffer (mux, best, buf);
+
+done:
+  gst_object_unref (best);
+
+  return ret;
+}
+
+static GstAggregatorPad *
+mpegtsmux_create_new_pad (GstAggregator * agg, GstPadTemplate * templ,
     const gchar * name, const GstCaps * caps)
 {
-  MpegTsMux *mux = GST_MPEG_TSMUX (element);
+  MpegTsMux *mux = GST_MPEG_TSMUX (agg);
   gint pid = -1;
   gchar *pad_name = NULL;
-  GstPad *pad = NULL;
   MpegTsPadData *pad_data = NULL;
 
   if (name != NULL && sscanf (name, "sink_%d", &pid) == 1) {
@@ -1523,62 +1749,22 @@ mpegtsmux_request_new_pad (GstElement * element, GstPadTemplate * templ,
   }
 
   pad_name = g_strdup_printf ("sink_%d", pid);
-  pad = gst_pad_new_from_template (templ, pad_name);
+  pad_data = g_object_new (GST_TYPE_MPEG_TSMUX_PAD, "name", pad_name,
+      "direction", templ->direction, "template", templ, NULL);
   g_free (pad_name);
 
-  pad_data = (MpegTsPadData *)
-      gst_collect_pads_add_pad (mux->collect, pad, sizeof (MpegTsPadData),
-      (GstCollectDataDestroyNotify) (mpegtsmux_pad_reset), TRUE);
-  if (pad_data == NULL)
-    goto pad_failure;
-
-  mpegtsmux_pad_reset (pad_data);
   pad_data->pid = pid;
 
-  if (G_UNLIKELY (!gst_element_add_pad (element, pad)))
-    goto could_not_add;
-
-  return pad;
+  return GST_AGGREGATOR_PAD (pad_data);
 
   /* ERRORS */
 stream_exists:
   {
-    GST_ELEMENT_ERROR (element, STREAM, MUX, ("Duplicate PID requested"),
-        (NULL));
-    return NULL;
-  }
-could_not_add:
-  {
-    GST_ELEMENT_ERROR (element, STREAM, FAILED,
-        ("Internal data stream error."), ("Could not add pad to element"));
-    gst_collect_pads_remove_pad (mux->collect, pad);
-    gst_object_unref (pad);
-    return NULL;
-  }
-pad_failure:
-  {
-    GST_ELEMENT_ERROR (element, STREAM, FAILED,
-        ("Internal data stream error."), ("Could not add pad to collectpads"));
-    gst_object_unref (pad);
+    GST_ELEMENT_ERROR (mux, STREAM, MUX, ("Duplicate PID requested"), (NULL));
     return NULL;
   }
 }
 
-static void
-mpegtsmux_release_pad (GstElement * element, GstPad * pad)
-{
-  MpegTsMux *mux = GST_MPEG_TSMUX (element);
-
-  GST_DEBUG_OBJECT (mux, "Pad %" GST_PTR_FORMAT " being released", pad);
-
-  if (mux->collect) {
-    gst_collect_pads_remove_pad (mux->collect, pad);
-  }
-
-  /* chain up */
-  gst_element_remove_pad (element, pad);
-}
-
 static void
 new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
     guint len)
@@ -1623,6 +1809,34 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
   }
 }
 
+/* GstAggregator only sends its pending stream-start, caps and segment
+ * events from gst_aggregator_finish_buffer(), so the first buffer of each
+ * list goes through it and the rest is pushed as a list */
+static GstFlowReturn
+mpegtsmux_push_list (MpegTsMux * mux, GstBufferList * buffer_list)
+{
+  GstBuffer *buf;
+  GstFlowReturn ret;
+
+  if (gst_buffer_list_length (buffer_list) == 0) {
+    gst_buffer_list_unref (buffer_list);
+    return GST_FLOW_OK;
+  }
+
+  buffer_list = gst_buffer_list_make_writable (buffer_list);
+  buf = gst_buffer_ref (gst_buffer_list_get (buffer_list, 0));
+  gst_buffer_list_remove (buffer_list, 0, 1);
+
+  ret = gst_aggregator_finish_buffer (GST_AGGREGATOR (mux), buf);
+
+  if (ret != GST_FLOW_OK || gst_buffer_list_length (buffer_list) == 0) {
+    gst_buffer_list_unref (buffer_list);
+    return ret;
+  }
+
+  return gst_pad_push_list (GST_AGGREGATOR_SRC_PAD (mux), buffer_list);
+}
+
 static GstFlowReturn
 mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
 {
@@ -1649,7 +1863,7 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
   /* no alignment, just push all available data */
   if (align == 0) {
     buffer_list = gst_adapter_take_buffer_list (mux->out_adapter, av);
-    return gst_pad_push_list (mux->srcpad, buffer_list);
+    return mpegtsmux_push_list (mux, buffer_list);
   }
 
   align *= packet_size;
@@ -1725,7 +1939,7 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
     gst_buffer_list_add (buffer_list, buf);
   }
 
-  return gst_pad_push_list (mux->srcpad, buffer_list);
+  return mpegtsmux_push_list (mux, buffer_list);
 }
 
 static GstFlowReturn
@@ -1891,23 +2105,66 @@ new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
   return TRUE;
 }
 
+static GstBufferPool *
+mpegtsmux_create_packet_pool (MpegTsMux * mux)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  /* Always room for the M2TS prefix, so that the packets can be reused
+   * whatever the mode */
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, M2TS_PACKET_LENGTH,
+      MPEGTSMUX_PACKET_POOL_MIN_BUFFERS, 0);
+
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    GST_WARNING_OBJECT (mux, "Failed to set up packet pool");
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
 /* called when TsMux needs new packet to write into */
 static void
 alloc_packet_cb (GstBuffer ** _buf, void *user_data)
 {
   MpegTsMux *mux = (MpegTsMux *) user_data;
-  GstBuffer *buf;
+  GstBuffer *buf = NULL;
   gint offset = 0;
 
   if (mux->m2ts_mode == TRUE)
     offset = 4;
 
-  buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH + offset);
+  /* Packets are recycled once pushed, or once merged when aligning the
+   * output, which saves an allocation per packet */
+  if (G_UNLIKELY (mux->packet_pool == NULL))
+    mux->packet_pool = mpegtsmux_create_packet_pool (mux);
+
+  if (G_LIKELY (mux->packet_pool) &&
+      gst_buffer_pool_acquire_buffer (mux->packet_pool, &buf,
+          NULL) != GST_FLOW_OK)
+    buf = NULL;
+
+  if (G_UNLIKELY (buf == NULL))
+    buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH + offset);
   gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH);
 
   *_buf = buf;
 }
 
+static GstCaps *
+mpegtsmux_get_src_caps (MpegTsMux * mux)
+{
+  return gst_caps_new_simple ("video/mpegts",
+      "systemstream", G_TYPE_BOOLEAN, TRUE,
+      "packetsize", G_TYPE_INT,
+      (mux->m2ts_mode ? M2TS_PACKET_LENGTH : NORMAL_TS_PACKET_LENGTH), NULL);
+}
+
 static void
 mpegtsmux_set_header_on_caps (MpegTsMux * mux)
 {
@@ -1917,7 +2174,7 @@ mpegtsmux_set_header_on_caps (MpegTsMux * mux)
   GValue value = { 0 };
   GstCaps *caps;
 
-  caps = gst_caps_make_writable (gst_pad_get_current_caps (mux->srcpad));
+  caps = mpegtsmux_get_src_caps (mux);
   structure = gst_caps_get_structure (caps, 0);
 
   g_value_init (&array, GST_TYPE_ARRAY);
@@ -1933,7 +2190,7 @@ mpegtsmux_set_header_on_caps (MpegTsMux * mux)
   }
 
   gst_structure_set_value (structure, "streamheader", &array);
-  gst_pad_set_caps (mux->srcpad, caps);
+  gst_aggregator_set_src_caps (GST_AGGREGATOR (mux), caps);
   g_value_unset (&array);
   gst_caps_unref (caps);
 }
@@ -1941,70 +2198,20 @@ mpegtsmux_set_header_on_caps (MpegTsMux * mux)
 static void
 mpegtsmux_prepare_srcpad (MpegTsMux * mux)
 {
-  GstSegment seg;
-  /* we are not going to seek */
-  GstEvent *new_seg;
-  gchar s_id[32];
-  GstCaps *caps = gst_caps_new_simple ("video/mpegts",
-      "systemstream", G_TYPE_BOOLEAN, TRUE,
-      "packetsize", G_TYPE_INT,
-      (mux->m2ts_mode ? M2TS_PACKET_LENGTH : NORMAL_TS_PACKET_LENGTH),
-      NULL);
-
-  /* stream-start (FIXME: create id based on input ids) */
-  g_snprintf (s_id, sizeof (s_id), "mpegtsmux-%08x", g_random_int ());
-  gst_pad_push_event (mux->srcpad, gst_event_new_stream_start (s_id));
+  GstCaps *caps = mpegtsmux_get_src_caps (mux);
 
-  gst_segment_init (&seg, GST_FORMAT_TIME);
-  new_seg = gst_event_new_segment (&seg);
-
-  /* Set caps on src pad from our template and push new segment */
-  gst_pad_set_caps (mux->srcpad, caps);
+  /* stream-start and segment are sent by the base class along with the
+   * caps before the first buffer */
+  gst_aggregator_set_src_caps (GST_AGGREGATOR (mux), caps);
   gst_caps_unref (caps);
-
-  if (!gst_pad_push_event (mux->srcpad, new_seg)) {
-    GST_WARNING_OBJECT (mux, "New segment event was not handled downstream");
-  }
 }
 
-static GstStateChangeReturn
-mpegtsmux_change_state (GstElement * element, GstStateChange transition)
+static gboolean
+mpegtsmux_stop (GstAggregator * agg)
 {
-  MpegTsMux *mux = GST_MPEG_TSMUX (element);
-  GstStateChangeReturn ret;
-
-  switch (transition) {
-    case GST_STATE_CHANGE_NULL_TO_READY:
-      break;
-    case GST_STATE_CHANGE_READY_TO_PAUSED:
-      gst_collect_pads_start (mux->collect);
-      break;
-    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
-      break;
-    case GST_STATE_CHANGE_PAUSED_TO_READY:
-      gst_collect_pads_stop (mux->collect);
-      break;
-    case GST_STATE_CHANGE_READY_TO_NULL:
-      break;
-    default:
-      break;
-  }
-
-  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
-
-  switch (transition) {
-    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
-      break;
-    case GST_STATE_CHANGE_PAUSED_TO_READY:
-      mpegtsmux_reset (mux, TRUE);
-      break;
-    case GST_STATE_CHANGE_READY_TO_NULL:
-      break;
-    default:
-      break;
-  }
+  mpegtsmux_reset (GST_MPEG_TSMUX (agg), TRUE);
 
-  return ret;
+  return TRUE;
 }
 
 static gboolean
@@ -84,7 +84,7 @@
 #define __MPEGTSMUX_H__
 
 #include <gst/gst.h>
-#include <gst/base/gstcollectpads.h>
+#include <gst/base/gstaggregator.h>
 #include <gst/base/gstadapter.h>
 
 G_BEGIN_DECLS
@@ -94,6 +94,9 @@ G_BEGIN_DECLS
 #define GST_TYPE_MPEG_TSMUX  (mpegtsmux_get_type())
 #define GST_MPEG_TSMUX(obj)  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_MPEG_TSMUX, MpegTsMux))
 
+#define GST_TYPE_MPEG_TSMUX_PAD  (mpegtsmux_pad_get_type())
+#define GST_MPEG_TSMUX_PAD(obj)  (G_TYPE_CHECK_INSTANCE_CAST((obj), GST_TYPE_MPEG_TSMUX_PAD, MpegTsPadData))
+
 #define CLOCK_BASE 9LL
 #define CLOCK_FREQ (CLOCK_BASE * 10000)   /* 90 kHz PTS clock */
 #define CLOCK_FREQ_SCR (CLOCK_FREQ * 300) /* 27 MHz SCR clock */
@@ -101,6 +104,8 @@ G_BEGIN_DECLS
 #define GSTTIME_TO_MPEGTIME(time) \
     (((time) > 0 ? (gint64) 1 : (gint64) -1) * \
     (gint64) gst_util_uint64_scale (ABS(time), CLOCK_BASE, GST_MSECOND/10))
+#define MPEGTIME_TO_GSTTIME(time) \
+    gst_util_uint64_scale ((time), GST_MSECOND/10, CLOCK_BASE)
 
 /* 27 MHz SCR conversions: */
 #define MPEG_SYS_TIME_TO_GSTTIME(time) (gst_util_uint64_scale ((time), \
@@ -116,6 +121,7 @@ G_BEGIN_DECLS
 typedef struct MpegTsMux MpegTsMux;
 typedef struct MpegTsMuxClass MpegTsMuxClass;
 typedef struct MpegTsPadData MpegTsPadData;
+typedef struct MpegTsPadDataClass MpegTsPadDataClass;
 
 typedef GstBuffer * (*MpegTsPadDataPrepareFunction) (GstBuffer * buf,
     MpegTsPadData * data, MpegTsMux * mux);
@@ -123,11 +129,7 @@ typedef GstBuffer * (*MpegTsPadDataPrepareFunction) (GstBuffer * buf,
 typedef void (*MpegTsPadDataFreePrepareDataFunction) (gpointer prepare_data);
 
 struct MpegTsMux {
-  GstElement parent;
-
-  GstPad *srcpad;
-
-  GstCollectPads *collect;
+  GstAggregator parent;
 
   TsMux *tsmux;
   GHashTable *programs;
@@ -139,6 +141,8 @@ struct MpegTsMux {
   guint pmt_interval;
   gint alignment;
   guint si_interval;
+  guint64 bitrate;
+  guint pcr_interval;
 
   /* state */
   gboolean first;
@@ -164,6 +168,9 @@ struct MpegTsMux {
   GstAdapter *out_adapter;
   GstBuffer *out_buffer;
 
+  /* recycled packet buffers */
+  GstBufferPool *packet_pool;
+
 #if 0
   /* SPN/PTS index handling */
   GstIndex *element_index;
@@ -172,12 +179,12 @@ struct MpegTsMux {
 };
 
 struct MpegTsMuxClass {
-  GstElementClass parent_class;
+  GstAggregatorClass parent_class;
 };
 
 struct MpegTsPadData {
   /* parent */
-  GstCollectData collect;
+  GstAggregatorPad parent;
 
   gint pid;
   TsMuxStream *stream;
@@ -209,7 +216,12 @@ struct MpegTsPadData {
   gchar *language;
 };
 
+struct MpegTsPadDataClass {
+  GstAggregatorPadClass parent_class;
+};
+
 GType mpegtsmux_get_type (void);
+GType mpegtsmux_pad_get_type (void);
 
 
 G_END_DECLS
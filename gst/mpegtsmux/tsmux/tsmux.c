@@ -106,19 +106,25 @@
  * 1/8 second atm */
 #define TSMUX_PCR_OFFSET (TSMUX_CLOCK_FREQ / 8)
 
-/* Times per second to write PCR */
-#define TSMUX_DEFAULT_PCR_FREQ (25)
-
 /* Base for all written PCR and DTS/PTS,
  * so we have some slack to go backwards */
 #define CLOCK_BASE (TSMUX_CLOCK_FREQ * 10 * 360)
 
 static gboolean tsmux_write_pat (TsMux * mux);
 static gboolean tsmux_write_pmt (TsMux * mux, TsMuxProgram * program);
+static void
+tsmux_section_clear_packets (TsMuxSection * section)
+{
+  g_free (section->packets);
+  section->packets = NULL;
+  section->n_packets = 0;
+}
+
 static void
 tsmux_section_free (TsMuxSection * section)
 {
   gst_mpegts_section_unref (section->section);
+  tsmux_section_clear_packets (section);
   g_slice_free (TsMuxSection, section);
 }
 
@@ -150,6 +156,11 @@ tsmux_new (void)
   mux->last_si_ts = G_MININT64;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
 
+  mux->pcr_interval = TSMUX_DEFAULT_PCR_INTERVAL;
+  mux->bitrate = 0;
+  mux->n_bytes = 0;
+  mux->first_pcr = -1;
+
   mux->si_sections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) tsmux_section_free);
 
@@ -242,6 +253,72 @@ tsmux_resend_pat (TsMux * mux)
   mux->last_pat_ts = G_MININT64;
 }
 
+/**
+ * tsmux_set_pcr_interval:
+ * @mux: a #TsMux
+ * @freq: a new PCR interval
+ *
+ * Set the interval (in cycles of the 90kHz clock) for writing out the PCR of
+ * each program.
+ */
+void
+tsmux_set_pcr_interval (TsMux * mux, guint freq)
+{
+  g_return_if_fail (mux != NULL);
+
+  mux->pcr_interval = freq;
+}
+
+/**
+ * tsmux_get_pcr_interval:
+ * @mux: a #TsMux
+ *
+ * Get the configured PCR interval. See also tsmux_set_pcr_interval().
+ *
+ * Returns: the configured PCR interval
+ */
+guint
+tsmux_get_pcr_interval (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->pcr_interval;
+}
+
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the output bitrate in bits per second, or 0
+ *
+ * Set the bitrate of the output. If non-zero the output is a constant
+ * bitrate stream: null packets are inserted to keep the packets on schedule,
+ * and the PCRs and tables are written at their interval in dedicated
+ * packets, with PCR values computed from the position in the output.
+ */
+void
+tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
+{
+  g_return_if_fail (mux != NULL);
+
+  mux->bitrate = bitrate;
+}
+
+/**
+ * tsmux_get_bitrate:
+ * @mux: a #TsMux
+ *
+ * Get the configured output bitrate. See also tsmux_set_bitrate().
+ *
+ * Returns: the configured bitrate in bits per second, 0 for VBR
+ */
+guint64
+tsmux_get_bitrate (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->bitrate;
+}
+
 /**
  * tsmux_set_si_interval:
  * @mux: a #TsMux
@@ -340,6 +417,7 @@ tsmux_free (TsMux * mux)
   /* Free PAT section */
   if (mux->pat.section)
     gst_mpegts_section_unref (mux->pat.section);
+  tsmux_section_clear_packets (&mux->pat);
 
   /* Free all programs */
   for (cur = mux->programs; cur; cur = cur->next) {
@@ -625,9 +703,23 @@ tsmux_get_buffer (TsMux * mux, GstBuffer ** buf)
   return TRUE;
 }
 
+/* PCR (in 27MHz units) of the next packet to be written in CBR mode, or -1
+ * if the stream didn't start yet */
+static gint64
+tsmux_get_current_pcr (TsMux * mux)
+{
+  if (mux->first_pcr == -1)
+    return -1;
+
+  return mux->first_pcr + gst_util_uint64_scale (mux->n_bytes * 8,
+      TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+}
+
 static gboolean
-tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
+tsmux_write_packet (TsMux * mux, GstBuffer * buf, gint64 pcr)
 {
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
   if (G_UNLIKELY (mux->write_func == NULL)) {
     if (buf)
       gst_buffer_unref (buf);
@@ -637,6 +729,111 @@ tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
   return mux->write_func (buf, mux->write_func_data, pcr);
 }
 
+static gboolean tsmux_write_ts_header (guint8 * buf, TsMuxPacketInfo * pi,
+    guint * payload_len_out, guint * payload_offset_out);
+
+/* Write a packet with an adaptation field only, carrying the PCR of the
+ * position it's written at */
+static gboolean
+tsmux_write_pcr_packet (TsMux * mux, TsMuxStream * stream, gint64 pcr)
+{
+  TsMuxPacketInfo pi = { 0, };
+  guint payload_len, payload_offs;
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+
+  pi.pid = stream->pi.pid;
+  pi.flags = TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+  pi.pcr = pcr;
+  if (stream->pcr_discont) {
+    pi.flags |= TSMUX_PACKET_FLAG_DISCONT;
+    stream->pcr_discont = FALSE;
+  }
+  /* No payload, so repeat the continuity counter of the last payload
+   * packet. packet_count already holds the one of the next packet */
+  pi.packet_count = (stream->pi.packet_count - 1) & 0xf;
+  pi.stream_avail = 0;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  if (!tsmux_write_ts_header (map.data, &pi, &payload_len, &payload_offs)) {
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  TS_DEBUG ("Writing PCR-only packet on PID 0x%04x, PCR %" G_GINT64_FORMAT,
+      pi.pid, pcr);
+
+  return tsmux_write_packet (mux, buf, pcr);
+}
+
+/* Write the PCR of the programs that are due one, in CBR mode */
+static gboolean
+tsmux_write_scheduled_pcrs (TsMux * mux)
+{
+  gint64 interval = (gint64) mux->pcr_interval *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+  GList *cur;
+
+  if (mux->first_pcr == -1)
+    return TRUE;
+
+  for (cur = mux->programs; cur; cur = cur->next) {
+    TsMuxProgram *program = (TsMuxProgram *) cur->data;
+    TsMuxStream *stream = program->pcr_stream;
+    gint64 cur_pcr = tsmux_get_current_pcr (mux);
+
+    if (stream == NULL)
+      continue;
+
+    if (stream->last_pcr == -1 || cur_pcr - stream->last_pcr >= interval) {
+      stream->last_pcr = cur_pcr;
+      if (!tsmux_write_pcr_packet (mux, stream, cur_pcr))
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static gboolean
+tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
+{
+  /* In CBR mode, PCRs go in their own packets, right on schedule */
+  if (mux->bitrate && !tsmux_write_scheduled_pcrs (mux)) {
+    if (buf)
+      gst_buffer_unref (buf);
+    return FALSE;
+  }
+
+  return tsmux_write_packet (mux, buf, pcr);
+}
+
+static gboolean
+tsmux_write_null_packet (TsMux * mux)
+{
+  GstBuffer *buf = NULL;
+  GstMapInfo map;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  map.data[0] = TSMUX_SYNC_BYTE;
+  /* null packet PID, payload only, continuity counter undefined */
+  map.data[1] = 0x1f;
+  map.data[2] = 0xff;
+  map.data[3] = 0x10;
+  memset (map.data + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+  gst_buffer_unmap (buf, &map);
+
+  return tsmux_packet_out (mux, buf, -1);
+}
+
 /*
  * adaptation_field() {
  *   adaptation_field_length                              8 uimsbf
@@ -884,25 +1081,16 @@ tsmux_write_ts_header (guint8 * buf, TsMuxPacketInfo * pi,
   return TRUE;
 }
 
+/* Splits the section into TS packets once, they are then sent as is
+ * until the section changes */
 static gboolean
-tsmux_section_write_packet (GstMpegtsSectionType * type,
-    TsMuxSection * section, TsMux * mux)
+tsmux_section_packetize (TsMuxSection * section)
 {
-  GstBuffer *section_buffer;
-  GstBuffer *packet_buffer = NULL;
-  GstMemory *mem;
-  guint8 *packet;
-  guint8 *data;
-  gsize data_size = 0;
-  gsize payload_written;
-  guint len = 0, offset = 0, payload_len = 0;
-  guint extra_alloc_bytes = 0;
-
-  g_return_val_if_fail (section != NULL, FALSE);
-  g_return_val_if_fail (mux != NULL, FALSE);
-
-  /* Mark the start of new PES unit */
-  section->pi.packet_start_unit_indicator = TRUE;
+  TsMuxPacketInfo pi = section->pi;
+  guint8 *data, *packet;
+  gsize data_size = 0, written = 0;
+  guint len = 0, offset = 0, payload_len;
+  guint n_packets;
 
   data = gst_mpegts_section_packetize (section->section, &data_size);
 
@@ -911,100 +1099,83 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
     return FALSE;
   }
 
-  /* Mark payload data size */
-  section->pi.stream_avail = data_size;
-  payload_written = 0;
-
-  /* Wrap section data in a buffer without free function.
-     The data will be freed when the GstMpegtsSection is destroyed. */
-  section_buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      data, data_size, 0, data_size, NULL, NULL);
+  /* The first packet also carries the pointer byte */
+  pi.packet_start_unit_indicator = TRUE;
+  pi.stream_avail = data_size + 1;
+  pi.packet_count = 0;
 
-  TS_DEBUG ("Section buffer with size %" G_GSIZE_FORMAT " created",
-      gst_buffer_get_size (section_buffer));
+  n_packets = (pi.stream_avail + TSMUX_PAYLOAD_LENGTH - 1) /
+      TSMUX_PAYLOAD_LENGTH;
+  section->packets = g_malloc (n_packets * TSMUX_PACKET_LENGTH);
+  section->n_packets = 0;
 
-  while (section->pi.stream_avail > 0) {
+  while (pi.stream_avail > 0) {
+    g_assert (section->n_packets < n_packets);
 
-    packet = g_malloc (TSMUX_PACKET_LENGTH);
+    packet = section->packets + section->n_packets * TSMUX_PACKET_LENGTH;
 
-    if (section->pi.packet_start_unit_indicator) {
-      /* Wee need room for a pointer byte */
-      section->pi.stream_avail++;
-
-      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
+    if (!tsmux_write_ts_header (packet, &pi, &len, &offset)) {
+      tsmux_section_clear_packets (section);
+      return FALSE;
+    }
 
+    payload_len = len;
+    if (pi.packet_start_unit_indicator) {
       /* Write the pointer byte */
       packet[offset++] = 0x00;
-      payload_len = len - 1;
-
-    } else {
-      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
-      payload_len = len;
+      payload_len--;
     }
 
-    /* Wrap the TS header and adaption field in a GstMemory */
-    mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
-        packet, TSMUX_PACKET_LENGTH, 0, offset, packet, g_free);
-
-    TS_DEBUG ("Creating packet buffer at offset "
-        "%" G_GSIZE_FORMAT " with length %u", payload_written, payload_len);
-
-    /* If in M2TS mode, we will need to resize to 4 bytes after the end
-       of the buffer. For performance reasons, we will now try to include
-       4 extra bytes from the source buffer, then resize down, to avoid
-       having an extra 4 byte GstMemory appended. If the source buffer
-       does not have enough data for this, a new GstMemory will be used */
-    if (gst_buffer_get_size (section_buffer) - (payload_written +
-            payload_len) >= 4) {
-      /* enough space */
-      extra_alloc_bytes = 4;
-    }
-    packet_buffer = gst_buffer_copy_region (section_buffer, GST_BUFFER_COPY_ALL,
-        payload_written, payload_len + extra_alloc_bytes);
+    memcpy (packet + offset, data + written, payload_len);
 
-    /* Prepend the header to the section data */
-    gst_buffer_prepend_memory (packet_buffer, mem);
+    written += payload_len;
+    pi.stream_avail -= len;
+    pi.packet_start_unit_indicator = FALSE;
+    section->n_packets++;
+  }
 
-    /* add an extra 4 bytes if it could not be reserved already */
-    if (extra_alloc_bytes == 4) {
-      /* we allocated those already, resize */
-      gst_buffer_set_size (packet_buffer,
-          gst_buffer_get_size (packet_buffer) - extra_alloc_bytes);
-    } else {
-      void *ptr = g_malloc (4);
-      GstMemory *extra =
-          gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, ptr, 4, 0, 0, ptr,
-          g_free);
-      gst_buffer_append_memory (packet_buffer, extra);
-    }
+  TS_DEBUG ("Section of %" G_GSIZE_FORMAT " bytes split into %u packets",
+      data_size, section->n_packets);
 
-    TS_DEBUG ("Writing %d bytes to section. %d bytes remaining",
-        len, section->pi.stream_avail - len);
+  return TRUE;
+}
 
-    /* Push the packet without PCR */
-    if (G_UNLIKELY (!tsmux_packet_out (mux, packet_buffer, -1))) {
-      /* Buffer given away */
-      packet_buffer = NULL;
-      goto fail;
-    }
+static gboolean
+tsmux_section_write_packet (GstMpegtsSectionType * type,
+    TsMuxSection * section, TsMux * mux)
+{
+  GstBuffer *packet_buffer;
+  GstMapInfo map;
+  guint i;
 
-    packet_buffer = NULL;
-    section->pi.stream_avail -= len;
-    payload_written += payload_len;
-    section->pi.packet_start_unit_indicator = FALSE;
-  }
+  g_return_val_if_fail (section != NULL, FALSE);
+  g_return_val_if_fail (mux != NULL, FALSE);
 
-  gst_buffer_unref (section_buffer);
+  if (section->packets == NULL && !tsmux_section_packetize (section))
+    return FALSE;
 
-  return TRUE;
+  for (i = 0; i < section->n_packets; i++) {
+    if (!tsmux_get_buffer (mux, &packet_buffer))
+      return FALSE;
 
-fail:
-  g_free (packet);
-  if (section_buffer)
-    gst_buffer_unref (section_buffer);
-  return FALSE;
+    gst_buffer_map (packet_buffer, &map, GST_MAP_WRITE);
+    memcpy (map.data, section->packets + i * TSMUX_PACKET_LENGTH,
+        TSMUX_PACKET_LENGTH);
+
+    /* Every packet has a payload, so every one increments the counter */
+    map.data[3] = (map.data[3] & 0xf0) | (section->pi.packet_count & 0x0f);
+    section->pi.packet_count++;
+
+    gst_buffer_unmap (packet_buffer, &map);
+
+    TS_DEBUG ("Writing section packet %u of %u", i + 1, section->n_packets);
+
+    /* Push the packet without PCR */
+    if (G_UNLIKELY (!tsmux_packet_out (mux, packet_buffer, -1)))
+      return FALSE;
+  }
+
+  return TRUE;
 }
 
 static gboolean
@@ -1019,6 +1190,190 @@ tsmux_write_si (TsMux * mux)
 
 }
 
+static gboolean
+tsmux_write_psi (TsMux * mux, gint64 cur_ts)
+{
+  gboolean write_pat;
+  gboolean write_si;
+  GList *cur;
+
+  /* check if we need to rewrite pat */
+  if (mux->last_pat_ts == G_MININT64 || mux->pat_changed)
+    write_pat = TRUE;
+  else if (cur_ts >= mux->last_pat_ts + mux->pat_interval)
+    write_pat = TRUE;
+  else
+    write_pat = FALSE;
+
+  if (write_pat) {
+    mux->last_pat_ts = cur_ts;
+    if (!tsmux_write_pat (mux))
+      return FALSE;
+  }
+
+  /* check if we need to rewrite sit */
+  if (mux->last_si_ts == G_MININT64 || mux->si_changed)
+    write_si = TRUE;
+  else if (cur_ts >= mux->last_si_ts + mux->si_interval)
+    write_si = TRUE;
+  else
+    write_si = FALSE;
+
+  if (write_si) {
+    mux->last_si_ts = cur_ts;
+    if (!tsmux_write_si (mux))
+      return FALSE;
+  }
+
+  /* check if we need to rewrite any of the current pmts */
+  for (cur = mux->programs; cur; cur = cur->next) {
+    TsMuxProgram *program = (TsMuxProgram *) cur->data;
+    gboolean write_pmt;
+
+    if (program->last_pmt_ts == G_MININT64 || program->pmt_changed)
+      write_pmt = TRUE;
+    else if (cur_ts >= program->last_pmt_ts + program->pmt_interval)
+      write_pmt = TRUE;
+    else
+      write_pmt = FALSE;
+
+    if (write_pmt) {
+      program->last_pmt_ts = cur_ts;
+      if (!tsmux_write_pmt (mux, program))
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Restart the CBR schedule at @pcr after a jump in the input. The PCR
+ * of every program is sent right away, flagged as a discontinuity */
+static void
+tsmux_resync_cbr (TsMux * mux, gint64 pcr)
+{
+  GList *cur;
+
+  mux->first_pcr = pcr;
+  mux->n_bytes = 0;
+
+  for (cur = mux->programs; cur; cur = cur->next) {
+    TsMuxProgram *program = (TsMuxProgram *) cur->data;
+
+    if (program->pcr_stream == NULL)
+      continue;
+
+    program->pcr_stream->last_pcr = -1;
+    program->pcr_stream->pcr_discont = TRUE;
+  }
+}
+
+/* In CBR mode, pad the output with null packets until the position in the
+ * output reaches @target_pcr, and write the tables and PCRs that are due on
+ * the way. Gaps of up to a second are stuffed, longer ones restart the
+ * schedule at @target_pcr */
+static gboolean
+tsmux_write_cbr_padding_to (TsMux * mux, gint64 target_pcr)
+{
+  gint64 cur_pcr;
+
+  if (mux->first_pcr == -1) {
+    mux->first_pcr = target_pcr;
+    mux->n_bytes = 0;
+  }
+
+  cur_pcr = tsmux_get_current_pcr (mux);
+  if (target_pcr - cur_pcr > TSMUX_SYS_CLOCK_FREQ) {
+    GST_WARNING ("Gap of %" G_GINT64_FORMAT " in the input, resyncing",
+        target_pcr - cur_pcr);
+    tsmux_resync_cbr (mux, target_pcr);
+  } else if (cur_pcr - target_pcr >
+      TSMUX_PCR_OFFSET * (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ)) {
+    GST_WARNING ("Output late by %" G_GINT64_FORMAT ", bitrate %"
+        G_GUINT64_FORMAT " is too low for the input", cur_pcr - target_pcr,
+        mux->bitrate);
+  }
+
+  while ((cur_pcr = tsmux_get_current_pcr (mux)) < target_pcr) {
+    guint64 n_bytes = mux->n_bytes;
+
+    if (!tsmux_write_psi (mux,
+            cur_pcr / (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ)))
+      return FALSE;
+    if (mux->n_bytes == n_bytes && !tsmux_write_null_packet (mux))
+      return FALSE;
+  }
+
+  return tsmux_write_psi (mux,
+      cur_pcr / (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ));
+}
+
+/* In CBR mode, pad the output until the time the data of @stream is due */
+static gboolean
+tsmux_write_cbr_padding (TsMux * mux, TsMuxStream * stream)
+{
+  gint64 cur_pts = tsmux_stream_get_pts (stream);
+
+  if (cur_pts == G_MININT64) {
+    if (mux->first_pcr == -1)
+      return tsmux_write_psi (mux, G_MININT64);
+    return tsmux_write_psi (mux, tsmux_get_current_pcr (mux) /
+        (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ));
+  }
+
+  /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
+  return tsmux_write_cbr_padding_to (mux,
+      (cur_pts + CLOCK_BASE - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ));
+}
+
+/**
+ * tsmux_get_cbr_position:
+ * @mux: a #TsMux
+ *
+ * Get the time the CBR output has reached, on the scale of the PTS given
+ * to tsmux_stream_add_data().
+ *
+ * Returns: the position in MPEG clock units, or G_MININT64 if not in CBR
+ * mode or if no data was written yet
+ */
+gint64
+tsmux_get_cbr_position (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, G_MININT64);
+
+  if (!mux->bitrate || mux->first_pcr == -1)
+    return G_MININT64;
+
+  return tsmux_get_current_pcr (mux) /
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ) - CLOCK_BASE +
+      TSMUX_PCR_OFFSET;
+}
+
+/**
+ * tsmux_write_cbr_stuffing:
+ * @mux: a #TsMux
+ * @pts: time to stuff the output to, in MPEG clock units
+ *
+ * In CBR mode, write null packets, tables and PCRs until the output
+ * reaches @pts, for when no input data is available. This keeps the
+ * output rate constant while the inputs stall.
+ *
+ * Returns: TRUE if the packets could be written.
+ */
+gboolean
+tsmux_write_cbr_stuffing (TsMux * mux, gint64 pts)
+{
+  g_return_val_if_fail (mux != NULL, FALSE);
+
+  if (!mux->bitrate || mux->first_pcr == -1)
+    return TRUE;
+
+  return tsmux_write_cbr_padding_to (mux,
+      (pts + CLOCK_BASE - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ));
+}
+
 /**
  * tsmux_write_stream_packet:
  * @mux: a #TsMux
@@ -1041,11 +1396,12 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   g_return_val_if_fail (mux != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
-  if (tsmux_stream_is_pcr (stream)) {
+  if (mux->bitrate) {
+    /* PCRs are written in their own packets, see tsmux_packet_out() */
+    if (!tsmux_write_cbr_padding (mux, stream))
+      return FALSE;
+  } else if (tsmux_stream_is_pcr (stream)) {
     gint64 cur_pts = tsmux_stream_get_pts (stream);
-    gboolean write_pat;
-    gboolean write_si;
-    GList *cur;
 
     cur_pcr = 0;
     if (cur_pts != G_MININT64) {
@@ -1063,8 +1419,8 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
 
     /* Need to decide whether to write a new PCR in this packet */
     if (stream->last_pcr == -1 ||
-        (cur_pcr - stream->last_pcr >
-            (TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ))) {
+        (cur_pcr - stream->last_pcr > (gint64) mux->pcr_interval *
+            (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ))) {
 
       stream->pi.flags |=
           TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
@@ -1074,52 +1430,8 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
       cur_pcr = -1;
     }
 
-    /* check if we need to rewrite pat */
-    if (mux->last_pat_ts == G_MININT64 || mux->pat_changed)
-      write_pat = TRUE;
-    else if (cur_pts >= mux->last_pat_ts + mux->pat_interval)
-      write_pat = TRUE;
-    else
-      write_pat = FALSE;
-
-    if (write_pat) {
-      mux->last_pat_ts = cur_pts;
-      if (!tsmux_write_pat (mux))
-        return FALSE;
-    }
-
-    /* check if we need to rewrite sit */
-    if (mux->last_si_ts == G_MININT64 || mux->si_changed)
-      write_si = TRUE;
-    else if (cur_pts >= mux->last_si_ts + mux->si_interval)
-      write_si = TRUE;
-    else
-      write_si = FALSE;
-
-    if (write_si) {
-      mux->last_si_ts = cur_pts;
-      if (!tsmux_write_si (mux))
-        return FALSE;
-    }
-
-    /* check if we need to rewrite any of the current pmts */
-    for (cur = mux->programs; cur; cur = cur->next) {
-      TsMuxProgram *program = (TsMuxProgram *) cur->data;
-      gboolean write_pmt;
-
-      if (program->last_pmt_ts == G_MININT64 || program->pmt_changed)
-        write_pmt = TRUE;
-      else if (cur_pts >= program->last_pmt_ts + program->pmt_interval)
-        write_pmt = TRUE;
-      else
-        write_pmt = FALSE;
-
-      if (write_pmt) {
-        program->last_pmt_ts = cur_pts;
-        if (!tsmux_write_pmt (mux, program))
-          return FALSE;
-      }
-    }
+    if (!tsmux_write_psi (mux, cur_pts))
+      return FALSE;
   }
 
   pi->packet_start_unit_indicator = tsmux_stream_at_pes_start (stream);
@@ -1180,6 +1492,7 @@ tsmux_program_free (TsMuxProgram * program)
   /* Free PMT section */
   if (program->pmt.section)
     gst_mpegts_section_unref (program->pmt.section);
+  tsmux_section_clear_packets (&program->pmt);
 
   g_array_free (program->streams, TRUE);
   g_slice_free (TsMuxProgram, program);
@@ -1216,6 +1529,7 @@ tsmux_write_pat (TsMux * mux)
 
     if (mux->pat.section)
       gst_mpegts_section_unref (mux->pat.section);
+    tsmux_section_clear_packets (&mux->pat);
 
     mux->pat.section = gst_mpegts_section_from_pat (pat, mux->transport_id);
 
@@ -1297,6 +1611,7 @@ tsmux_write_pmt (TsMux * mux, TsMuxProgram * program)
 
     if (program->pmt.section)
       gst_mpegts_section_unref (program->pmt.section);
+    tsmux_section_clear_packets (&program->pmt);
 
     program->pmt.section = gst_mpegts_section_from_pmt (pmt, program->pmt_pid);
     program->pmt.section->version_number = program->pmt_version++;
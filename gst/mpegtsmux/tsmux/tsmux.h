@@ -106,6 +106,11 @@ typedef void (*TsMuxAllocFunc) (GstBuffer ** buf, void *user_data);
 struct TsMuxSection {
   TsMuxPacketInfo pi;
   GstMpegtsSection *section;
+
+  /* section split into TS packets, only the continuity counters are
+   * updated when sending them again */
+  guint8 *packets;
+  guint n_packets;
 };
 
 /* Information for the streams associated with one program */
@@ -169,6 +174,16 @@ struct TsMux {
   /* last time SIT written in MPEG PTS clock time */
   gint64   last_si_ts;
 
+  /* interval between PCRs in MPEG PTS clock time */
+  guint    pcr_interval;
+
+  /* CBR output bitrate in bits per second, 0 for VBR */
+  guint64  bitrate;
+  /* bytes written since the first PCR, in CBR mode */
+  guint64  n_bytes;
+  /* PCR of the first packet, in CBR mode, -1 if not known yet */
+  gint64   first_pcr;
+
   /* callback to write finished packet */
   TsMuxWriteFunc write_func;
   void *write_func_data;
@@ -190,6 +205,10 @@ void 		tsmux_set_alloc_func 		(TsMux *mux, TsMuxAllocFunc func, void *user_data)
 void 		tsmux_set_pat_interval          (TsMux *mux, guint interval);
 guint 		tsmux_get_pat_interval          (TsMux *mux);
 void 		tsmux_resend_pat                (TsMux *mux);
+void 		tsmux_set_pcr_interval          (TsMux *mux, guint interval);
+guint 		tsmux_get_pcr_interval          (TsMux *mux);
+void 		tsmux_set_bitrate               (TsMux *mux, guint64 bitrate);
+guint64 	tsmux_get_bitrate               (TsMux *mux);
 guint16		tsmux_get_new_pid 		(TsMux *mux);
 
 /* pid/program management */
@@ -214,6 +233,8 @@ void 		tsmux_program_set_pcr_stream 	(TsMuxProgram *program, TsMuxStream *stream
 
 /* writing stuff */
 gboolean 	tsmux_write_stream_packet 	(TsMux *mux, TsMuxStream *stream);
+gint64 		tsmux_get_cbr_position 		(TsMux *mux);
+gboolean 	tsmux_write_cbr_stuffing 	(TsMux *mux, gint64 pts);
 
 G_END_DECLS
 
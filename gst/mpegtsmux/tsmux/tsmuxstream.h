@@ -201,6 +201,8 @@ struct TsMuxStream {
   gint   pcr_ref;
   /* last time PCR written */
   gint64 last_pcr;
+  /* the next PCR follows a jump of the CBR schedule */
+  gboolean pcr_discont;
 
   /* audio parameters for stream
    * (used in stream descriptor) */
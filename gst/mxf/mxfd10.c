@@ -103,7 +103,6 @@ mxf_d10_sound_handle_essence_element (const MXFUL * key, GstBuffer * buffer,
   const guint8 *indata;
   guint8 *outdata;
   GstMapInfo map;
-  GstMapInfo outmap;
   MXFD10AudioMappingData *data = mapping_data;
 
   g_return_val_if_fail (data != NULL, GST_FLOW_ERROR);
@@ -116,23 +115,23 @@ mxf_d10_sound_handle_essence_element (const MXFUL * key, GstBuffer * buffer,
     return GST_FLOW_ERROR;
   }
 
-  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  /* The samples are always smaller than the AES3 subframes they come from,
+   * so convert in place. Mapping only copies if the memory is shared. */
+  buffer = gst_buffer_make_writable (buffer);
+  gst_buffer_map (buffer, &map, GST_MAP_READWRITE);
 
   /* Now transform raw AES3 into raw audio, see SMPTE 331M */
   if ((map.size - 4) % 32 != 0) {
     gst_buffer_unmap (buffer, &map);
+    gst_buffer_unref (buffer);
     GST_ERROR ("Invalid D10 sound essence buffer size");
     return GST_FLOW_ERROR;
   }
 
   nsamples = ((map.size - 4) / 4) / 8;
 
-  *outbuf = gst_buffer_new_and_alloc (nsamples * data->width * data->channels);
-  gst_buffer_copy_into (*outbuf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
-  gst_buffer_map (*outbuf, &outmap, GST_MAP_WRITE);
-
   indata = map.data;
-  outdata = outmap.data;
+  outdata = map.data;
 
   /* Skip 32 bit header */
   indata += 4;
@@ -159,9 +158,9 @@ mxf_d10_sound_handle_essence_element (const MXFUL * key, GstBuffer * buffer,
     indata += 4 * (8 - data->channels);
   }
 
-  gst_buffer_unmap (*outbuf, &outmap);
   gst_buffer_unmap (buffer, &map);
-  gst_buffer_unref (buffer);
+  gst_buffer_resize (buffer, 0, nsamples * data->width * data->channels);
+  *outbuf = buffer;
 
   return GST_FLOW_OK;
 }
@@ -79,6 +79,8 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, guint64 offset);
 
 static void collect_index_table_segments (GstMXFDemux * demux);
+static void gst_mxf_demux_add_index_table_segment (GstMXFDemux * demux,
+    MXFIndexTableSegment * segment);
 
 GType gst_mxf_demux_pad_get_type (void);
 G_DEFINE_TYPE (GstMXFDemuxPad, gst_mxf_demux_pad, GST_TYPE_PAD);
@@ -116,9 +118,20 @@ enum
   PROP_0,
   PROP_PACKAGE,
   PROP_MAX_DRIFT,
-  PROP_STRUCTURE
+  PROP_STRUCTURE,
+  PROP_READAHEAD_SIZE,
+  PROP_SKIP_DESCRIPTIVE_METADATA,
+  PROP_GROWING_FILE
 };
 
+#define DEFAULT_READAHEAD_SIZE (64 * 1024)
+#define DEFAULT_SKIP_DESCRIPTIVE_METADATA FALSE
+#define DEFAULT_GROWING_FILE FALSE
+/* How long to wait for new data at the end of a growing file */
+#define GROWING_FILE_POLL_INTERVAL (100 * GST_MSECOND)
+/* Readahead reads start at offsets aligned to this */
+#define READAHEAD_ALIGN 4096
+
 static gboolean gst_mxf_demux_sink_event (GstPad * pad, GstObject * parent,
     GstEvent * event);
 static gboolean gst_mxf_demux_src_event (GstPad * pad, GstObject * parent,
@@ -236,6 +249,16 @@ gst_mxf_demux_reset_metadata (GstMXFDemux * demux)
   g_rw_lock_writer_unlock (&demux->metadata_lock);
 }
 
+static void
+gst_mxf_demux_clear_readahead (GstMXFDemux * demux)
+{
+  if (demux->readahead) {
+    gst_buffer_unref (demux->readahead);
+    demux->readahead = NULL;
+  }
+  demux->readahead_offset = 0;
+}
+
 static void
 gst_mxf_demux_reset (GstMXFDemux * demux)
 {
@@ -260,6 +283,7 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
   }
 
   gst_adapter_clear (demux->adapter);
+  gst_mxf_demux_clear_readahead (demux);
 
   gst_mxf_demux_remove_pads (demux);
 
@@ -286,6 +310,7 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
     for (l = demux->index_tables; l; l = l->next) {
       GstMXFDemuxIndexTable *t = l->data;
       g_array_free (t->offsets, TRUE);
+      g_array_free (t->keyframes, TRUE);
       g_free (t);
     }
     g_list_free (demux->index_tables);
@@ -1339,6 +1364,41 @@ error:
   return ret;
 }
 
+/* 64 bit FNV-1a */
+static guint64
+gst_mxf_demux_hash_data (const guint8 * data, gsize size)
+{
+  guint64 hash = G_GUINT64_CONSTANT (0xcbf29ce484222325);
+  gsize i;
+
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= G_GUINT64_CONSTANT (0x100000001b3);
+  }
+
+  return hash;
+}
+
+/* Header metadata is usually repeated unchanged in every partition. If the
+ * new set is identical to the one we have, only remember its new offset so
+ * that the already resolved metadata and tracks can be kept */
+static gboolean
+gst_mxf_demux_metadata_is_unchanged (GstMXFDemux * demux,
+    MXFMetadataBase * old, MXFMetadataBase * m)
+{
+  if (old->data_size != m->data_size || old->data_hash != m->data_hash)
+    return FALSE;
+
+  GST_LOG_OBJECT (demux, "Metadata at offset %" G_GUINT64_FORMAT
+      " is unchanged", m->offset);
+
+  g_rw_lock_writer_lock (&demux->metadata_lock);
+  old->offset = m->offset;
+  g_rw_lock_writer_unlock (&demux->metadata_lock);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_metadata (GstMXFDemux * demux, const MXFUL * key,
     GstBuffer * buffer)
@@ -1377,6 +1437,11 @@ gst_mxf_demux_handle_metadata (GstMXFDemux * demux, const MXFUL * key,
   metadata =
       mxf_metadata_new (type, &demux->current_partition->primer, demux->offset,
       map.data, map.size);
+  if (metadata) {
+    MXF_METADATA_BASE (metadata)->data_hash =
+        gst_mxf_demux_hash_data (map.data, map.size);
+    MXF_METADATA_BASE (metadata)->data_size = map.size;
+  }
   gst_buffer_unmap (buffer, &map);
 
   if (!metadata) {
@@ -1414,6 +1479,11 @@ gst_mxf_demux_handle_metadata (GstMXFDemux * demux, const MXFUL * key,
         mxf_uuid_to_string (&MXF_METADATA_BASE (metadata)->instance_uid, str));
     g_object_unref (metadata);
     return GST_FLOW_OK;
+  } else if (old
+      && gst_mxf_demux_metadata_is_unchanged (demux, MXF_METADATA_BASE (old),
+          MXF_METADATA_BASE (metadata))) {
+    g_object_unref (metadata);
+    return GST_FLOW_OK;
   }
 
   g_rw_lock_writer_lock (&demux->metadata_lock);
@@ -1441,10 +1511,22 @@ gst_mxf_demux_handle_descriptive_metadata (GstMXFDemux * demux,
   GstMapInfo map;
   GstFlowReturn ret = GST_FLOW_OK;
   MXFDescriptiveMetadata *m = NULL, *old = NULL;
+  gboolean skip;
 
   scheme = GST_READ_UINT8 (key->u + 12);
   type = GST_READ_UINT24_BE (key->u + 13);
 
+  GST_OBJECT_LOCK (demux);
+  skip = demux->skip_descriptive_metadata;
+  GST_OBJECT_UNLOCK (demux);
+
+  if (skip) {
+    GST_LOG_OBJECT (demux,
+        "Skipping descriptive metadata of size %" G_GSIZE_FORMAT " at offset %"
+        G_GUINT64_FORMAT, gst_buffer_get_size (buffer), demux->offset);
+    return GST_FLOW_OK;
+  }
+
   GST_DEBUG_OBJECT (demux,
       "Handling descriptive metadata of size %" G_GSIZE_FORMAT " at offset %"
       G_GUINT64_FORMAT " with scheme 0x%02x and type 0x%06x",
@@ -1468,6 +1550,11 @@ gst_mxf_demux_handle_descriptive_metadata (GstMXFDemux * demux,
   gst_buffer_map (buffer, &map, GST_MAP_READ);
   m = mxf_descriptive_metadata_new (scheme, type,
       &demux->current_partition->primer, demux->offset, map.data, map.size);
+  if (m) {
+    MXF_METADATA_BASE (m)->data_hash =
+        gst_mxf_demux_hash_data (map.data, map.size);
+    MXF_METADATA_BASE (m)->data_size = map.size;
+  }
   gst_buffer_unmap (buffer, &map);
 
   if (!m) {
@@ -1505,6 +1592,11 @@ gst_mxf_demux_handle_descriptive_metadata (GstMXFDemux * demux,
         mxf_uuid_to_string (&MXF_METADATA_BASE (m)->instance_uid, str));
     g_object_unref (m);
     return GST_FLOW_OK;
+  } else if (old
+      && gst_mxf_demux_metadata_is_unchanged (demux, MXF_METADATA_BASE (old),
+          MXF_METADATA_BASE (m))) {
+    g_object_unref (m);
+    return GST_FLOW_OK;
   }
 
   g_rw_lock_writer_lock (&demux->metadata_lock);
@@ -1681,6 +1773,79 @@ gst_mxf_demux_pad_set_component (GstMXFDemux * demux, GstMXFDemuxPad * pad,
   return ret;
 }
 
+static gboolean
+gst_mxf_demux_pad_supports_video_meta (GstMXFDemux * demux,
+    GstMXFDemuxPad * pad)
+{
+  GstCaps *caps;
+  GstQuery *query;
+
+  if (!gst_pad_check_reconfigure (GST_PAD_CAST (pad)) &&
+      pad->video_meta_checked)
+    return pad->video_meta_supported;
+
+  pad->video_meta_checked = TRUE;
+  pad->video_meta_supported = FALSE;
+
+  caps = gst_pad_get_current_caps (GST_PAD_CAST (pad));
+  if (!caps)
+    return FALSE;
+
+  query = gst_query_new_allocation (caps, FALSE);
+  if (gst_pad_peer_query (GST_PAD_CAST (pad), query))
+    pad->video_meta_supported =
+        gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  GST_DEBUG_OBJECT (pad, "downstream %s video meta",
+      pad->video_meta_supported ? "supports" : "doesn't support");
+
+  return pad->video_meta_supported;
+}
+
+/* Essence handlers describe non-default layouts of raw video with a
+ * GstVideoMeta instead of repacking every frame. Repack here if downstream
+ * can't handle that. */
+static GstBuffer *
+gst_mxf_demux_pad_ensure_video_layout (GstMXFDemux * demux,
+    GstMXFDemuxPad * pad, GstBuffer * buffer)
+{
+  GstVideoInfo info;
+  GstVideoFrame in_frame, out_frame;
+  GstBuffer *outbuf;
+  GstCaps *caps;
+  gboolean res;
+
+  if (gst_buffer_get_video_meta (buffer) == NULL ||
+      gst_mxf_demux_pad_supports_video_meta (demux, pad))
+    return buffer;
+
+  caps = gst_pad_get_current_caps (GST_PAD_CAST (pad));
+  if (!caps)
+    return buffer;
+  res = gst_video_info_from_caps (&info, caps);
+  gst_caps_unref (caps);
+  if (!res)
+    return buffer;
+
+  if (!gst_video_frame_map (&in_frame, &info, buffer, GST_MAP_READ)) {
+    GST_WARNING_OBJECT (pad, "Failed to map video frame");
+    return buffer;
+  }
+
+  outbuf = gst_buffer_new_and_alloc (GST_VIDEO_INFO_SIZE (&info));
+  gst_buffer_copy_into (outbuf, buffer,
+      GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+  gst_video_frame_map (&out_frame, &info, outbuf, GST_MAP_WRITE);
+  gst_video_frame_copy (&out_frame, &in_frame);
+  gst_video_frame_unmap (&out_frame);
+  gst_video_frame_unmap (&in_frame);
+  gst_buffer_unref (buffer);
+
+  return outbuf;
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, gboolean peek)
@@ -1914,6 +2079,7 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     outbuf =
         gst_buffer_copy_region (inbuf, GST_BUFFER_COPY_ALL, 0,
         gst_buffer_get_size (inbuf));
+    outbuf = gst_mxf_demux_pad_ensure_video_layout (demux, pad, outbuf);
 
     GST_BUFFER_DTS (outbuf) = pad->position;
     if (etrack->intra_only) {
@@ -2265,8 +2431,86 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     return GST_FLOW_ERROR;
   }
 
-  demux->pending_index_table_segments =
-      g_list_prepend (demux->pending_index_table_segments, segment);
+  /* Once the initial set of segments was collected, merge any new ones
+   * right away instead of waiting for a rebuild that never comes */
+  if (demux->index_table_segments_collected) {
+    gst_mxf_demux_add_index_table_segment (demux, segment);
+    mxf_index_table_segment_reset (segment);
+    g_free (segment);
+  } else {
+    demux->pending_index_table_segments =
+        g_list_prepend (demux->pending_index_table_segments, segment);
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* Like gst_mxf_demux_pull_range() but serves small reads from a readahead
+ * window, so that the key, length and value of consecutive small KLV packets
+ * only cost a single upstream read. The returned buffer shares the memory of
+ * the window. Reads that don't fit into the window go upstream directly. */
+static GstFlowReturn
+gst_mxf_demux_pull_range_cached (GstMXFDemux * demux, guint64 offset,
+    guint size, GstBuffer ** buffer)
+{
+  GstBuffer *readahead = NULL;
+  guint64 readahead_offset;
+  guint readahead_size;
+  gsize available;
+  GstFlowReturn ret;
+
+  GST_OBJECT_LOCK (demux);
+  readahead_size = demux->readahead_size;
+  GST_OBJECT_UNLOCK (demux);
+
+  if (size == 0) {
+    *buffer = gst_buffer_new ();
+    return GST_FLOW_OK;
+  }
+
+  if (demux->readahead && offset >= demux->readahead_offset
+      && offset + size <= demux->readahead_offset +
+      gst_buffer_get_size (demux->readahead))
+    goto hit;
+
+  readahead_offset = offset - (offset % READAHEAD_ALIGN);
+  if (readahead_size == 0
+      || offset + size > readahead_offset + readahead_size)
+    return gst_mxf_demux_pull_range (demux, offset, size, buffer);
+
+  gst_mxf_demux_clear_readahead (demux);
+
+  /* A short read is fine here, it only means that we're close to the end
+   * of the file */
+  ret = gst_pad_pull_range (demux->sinkpad, readahead_offset, readahead_size,
+      &readahead);
+  /* Not all sources do short reads at the end of the file */
+  if (ret == GST_FLOW_EOS)
+    return gst_mxf_demux_pull_range (demux, offset, size, buffer);
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    GST_WARNING_OBJECT (demux,
+        "failed when pulling %u bytes from offset %" G_GUINT64_FORMAT ": %s",
+        readahead_size, readahead_offset, gst_flow_get_name (ret));
+    *buffer = NULL;
+    return ret;
+  }
+
+  demux->readahead = readahead;
+  demux->readahead_offset = readahead_offset;
+
+  available = gst_buffer_get_size (readahead);
+  if (G_UNLIKELY (offset + size > readahead_offset + available)) {
+    GST_WARNING_OBJECT (demux,
+        "partial pull got %" G_GSIZE_FORMAT " bytes from offset %"
+        G_GUINT64_FORMAT " when expecting %u from offset %" G_GUINT64_FORMAT,
+        available, readahead_offset, size, offset);
+    *buffer = NULL;
+    return GST_FLOW_EOS;
+  }
+
+hit:
+  *buffer = gst_buffer_copy_region (demux->readahead, GST_BUFFER_COPY_MEMORY,
+      offset - demux->readahead_offset, size);
 
   return GST_FLOW_OK;
 }
@@ -2288,8 +2532,8 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
   memset (key, 0, sizeof (MXFUL));
 
   /* Pull 16 byte key and first byte of BER encoded length */
-  if ((ret =
-          gst_mxf_demux_pull_range (demux, offset, 17, &buffer)) != GST_FLOW_OK)
+  if ((ret = gst_mxf_demux_pull_range_cached (demux, offset, 17,
+              &buffer)) != GST_FLOW_OK)
     goto beach;
 
   gst_buffer_map (buffer, &map, GST_MAP_READ);
@@ -2320,7 +2564,7 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
     }
 
     /* Now pull the length of the packet */
-    if ((ret = gst_mxf_demux_pull_range (demux, offset + 17, slen,
+    if ((ret = gst_mxf_demux_pull_range_cached (demux, offset + 17, slen,
                 &buffer)) != GST_FLOW_OK)
       goto beach;
 
@@ -2352,8 +2596,8 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
       "%" G_GUINT64_FORMAT, mxf_ul_to_string (key, str), length);
 
   /* Pull the complete KLV packet */
-  if ((ret = gst_mxf_demux_pull_range (demux, offset + data_offset, length,
-              &buffer)) != GST_FLOW_OK)
+  if ((ret = gst_mxf_demux_pull_range_cached (demux, offset + data_offset,
+              length, &buffer)) != GST_FLOW_OK)
     goto beach;
 
   *outbuf = buffer;
@@ -2809,6 +3053,58 @@ find_closest_offset (GArray * offsets, gint64 * position, gboolean keyframe)
   return -1;
 }
 
+/* Binary search in the keyframe side array of an index table, returns the
+ * offset of the last keyframe at or before *position */
+static guint64
+find_closest_keyframe_offset (GstMXFDemuxIndexTable * t, gint64 * position)
+{
+  gint64 current_position;
+  guint lo = 0, hi;
+
+  if (t->keyframes->len == 0 || t->offsets->len == 0 || *position < 0)
+    return -1;
+
+  current_position = MIN (*position, t->offsets->len - 1);
+
+  hi = t->keyframes->len;
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (g_array_index (t->keyframes, gint64, mid) <= current_position)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == 0)
+    return -1;
+
+  *position = g_array_index (t->keyframes, gint64, lo - 1);
+  return g_array_index (t->offsets, GstMXFDemuxIndex, *position).offset;
+}
+
+static guint64
+find_index_table_offset (GstMXFDemuxIndexTable * t, gint64 * position,
+    gboolean keyframe)
+{
+  if (keyframe)
+    return find_closest_keyframe_offset (t, position);
+
+  return find_closest_offset (t->offsets, position, FALSE);
+}
+
+static gboolean
+gst_mxf_demux_is_growing_file (GstMXFDemux * demux)
+{
+  gboolean ret;
+
+  GST_OBJECT_LOCK (demux);
+  ret = demux->growing_file;
+  GST_OBJECT_UNLOCK (demux);
+
+  return ret;
+}
+
 static guint64
 gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
     GstMXFDemuxEssenceTrack * etrack, gint64 * position, gboolean keyframe)
@@ -2868,7 +3164,7 @@ from_index:
     }
 
     if (index_table) {
-      offset = find_closest_offset (index_table->offsets, position, keyframe);
+      offset = find_index_table_offset (index_table, position, keyframe);
       if (offset != -1) {
         GST_DEBUG_OBJECT (demux,
             "Starting with edit unit %" G_GINT64_FORMAT " for %" G_GINT64_FORMAT
@@ -2897,7 +3193,7 @@ from_index:
     if (index_table) {
       gint64 tmp_position = *position;
 
-      offset = find_closest_offset (index_table->offsets, &tmp_position, TRUE);
+      offset = find_closest_keyframe_offset (index_table, &tmp_position);
       if (offset != -1 && tmp_position > index_start_position) {
         demux->offset = offset + demux->run_in;
         index_start_position = tmp_position;
@@ -2932,7 +3228,7 @@ from_index:
           gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
           &read);
 
-      if (ret == GST_FLOW_EOS) {
+      if (ret == GST_FLOW_EOS && !gst_mxf_demux_is_growing_file (demux)) {
         for (i = 0; i < demux->essence_tracks->len; i++) {
           GstMXFDemuxEssenceTrack *t =
               &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
@@ -2992,6 +3288,69 @@ from_index:
   return -1;
 }
 
+/* Interrupts gst_mxf_demux_growing_file_wait() before the streaming thread
+ * is stopped or paused */
+static void
+gst_mxf_demux_growing_file_wakeup (GstMXFDemux * demux, gboolean wakeup)
+{
+  g_mutex_lock (&demux->growing_file_lock);
+  demux->growing_file_wakeup = wakeup;
+  g_cond_signal (&demux->growing_file_cond);
+  g_mutex_unlock (&demux->growing_file_lock);
+}
+
+/* Returns FALSE if the wait was interrupted */
+static gboolean
+gst_mxf_demux_growing_file_wait (GstMXFDemux * demux)
+{
+  gint64 end_time;
+  gboolean ret;
+
+  end_time = g_get_monotonic_time () + GROWING_FILE_POLL_INTERVAL / 1000;
+
+  g_mutex_lock (&demux->growing_file_lock);
+  while (!demux->growing_file_wakeup) {
+    if (!g_cond_wait_until (&demux->growing_file_cond,
+            &demux->growing_file_lock, end_time))
+      break;
+  }
+  ret = !demux->growing_file_wakeup;
+  g_mutex_unlock (&demux->growing_file_lock);
+
+  return ret;
+}
+
+/* Called when hitting the end of a growing file: make the data that was read
+ * so far the new duration of all tracks and wait for more data to arrive */
+static GstFlowReturn
+gst_mxf_demux_handle_growing_file_end (GstMXFDemux * demux)
+{
+  gboolean duration_changed = FALSE;
+  guint i;
+
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *t =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (t->position > 0 && t->position > t->duration) {
+      t->duration = t->position;
+      duration_changed = TRUE;
+    }
+  }
+
+  if (duration_changed)
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_duration_changed (GST_OBJECT_CAST (demux)));
+
+  GST_LOG_OBJECT (demux, "Waiting for data at offset %" G_GUINT64_FORMAT,
+      demux->offset);
+
+  if (!gst_mxf_demux_growing_file_wait (demux))
+    return GST_FLOW_FLUSHING;
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
 {
@@ -3012,6 +3371,15 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
       gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
       &read);
 
+  /* The file is only complete once the footer partition was written */
+  if (ret == GST_FLOW_EOS && gst_mxf_demux_is_growing_file (demux)
+      && (!demux->current_partition
+          || demux->current_partition->partition.type !=
+          MXF_PARTITION_PACK_FOOTER)) {
+    ret = gst_mxf_demux_handle_growing_file_end (demux);
+    goto beach;
+  }
+
   if (ret == GST_FLOW_EOS && demux->src->len > 0) {
     guint i;
     GstMXFDemuxPad *p = NULL;
@@ -3172,8 +3540,15 @@ gst_mxf_demux_loop (GstPad * pad)
       goto pause;
     }
 
-    /* First of all pull&parse the random index pack at EOF */
-    gst_mxf_demux_pull_random_index_pack (demux);
+    if (gst_mxf_demux_is_growing_file (demux)) {
+      /* There is no footer or random index pack yet, follow the body
+       * partitions instead and merge index table segments as they come */
+      demux->pull_footer_metadata = FALSE;
+      demux->index_table_segments_collected = TRUE;
+    } else {
+      /* First of all pull&parse the random index pack at EOF */
+      gst_mxf_demux_pull_random_index_pack (demux);
+    }
   }
 
   /* Now actually do something */
@@ -3663,125 +4038,122 @@ no_new_offset:
   }
 }
 
+/* Keeps the sorted keyframe side array of an index table in sync with its
+ * entries, segments can arrive in any order */
 static void
-collect_index_table_segments (GstMXFDemux * demux)
+gst_mxf_demux_index_table_update_keyframe (GstMXFDemuxIndexTable * t,
+    gint64 position, gboolean keyframe)
 {
-  GList *l;
-  guint i;
-  guint64 old_offset = demux->offset;
-  GstMXFDemuxPartition *old_partition = demux->current_partition;
-
-  if (!demux->random_index_pack)
-    return;
+  guint lo = 0, hi = t->keyframes->len;
+  gboolean found;
 
-  for (i = 0; i < demux->random_index_pack->len; i++) {
-    MXFRandomIndexPackEntry *e =
-        &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry, i);
+  /* Fast path, segments usually arrive in order */
+  if (hi > 0 && g_array_index (t->keyframes, gint64, hi - 1) < position) {
+    lo = hi;
+  } else {
+    while (lo < hi) {
+      guint mid = lo + (hi - lo) / 2;
 
-    if (e->offset < demux->run_in) {
-      GST_ERROR_OBJECT (demux, "Invalid random index pack entry");
-      return;
+      if (g_array_index (t->keyframes, gint64, mid) < position)
+        lo = mid + 1;
+      else
+        hi = mid;
     }
-
-    demux->offset = e->offset;
-    read_partition_header (demux);
   }
 
-  demux->offset = old_offset;
-  demux->current_partition = old_partition;
+  found = lo < t->keyframes->len
+      && g_array_index (t->keyframes, gint64, lo) == position;
 
-  for (l = demux->pending_index_table_segments; l; l = l->next) {
-    MXFIndexTableSegment *segment = l->data;
-    GstMXFDemuxIndexTable *t = NULL;
-    GList *k;
-    guint64 start, end;
+  if (keyframe && !found)
+    g_array_insert_val (t->keyframes, lo, position);
+  else if (!keyframe && found)
+    g_array_remove_index (t->keyframes, lo);
+}
 
-    for (k = demux->index_tables; k; k = k->next) {
-      GstMXFDemuxIndexTable *tmp = k->data;
+static void
+gst_mxf_demux_add_index_table_segment (GstMXFDemux * demux,
+    MXFIndexTableSegment * segment)
+{
+  GstMXFDemuxIndexTable *t = NULL;
+  GList *k, *m;
+  guint64 start, end;
+  guint i;
 
-      if (tmp->body_sid == segment->body_sid
-          && tmp->index_sid == segment->index_sid) {
-        t = tmp;
-        break;
-      }
-    }
+  for (k = demux->index_tables; k; k = k->next) {
+    GstMXFDemuxIndexTable *tmp = k->data;
 
-    if (!t) {
-      t = g_new0 (GstMXFDemuxIndexTable, 1);
-      t->body_sid = segment->body_sid;
-      t->index_sid = segment->index_sid;
-      t->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
-      demux->index_tables = g_list_prepend (demux->index_tables, t);
+    if (tmp->body_sid == segment->body_sid
+        && tmp->index_sid == segment->index_sid) {
+      t = tmp;
+      break;
     }
+  }
 
-    start = segment->index_start_position;
-    end = start + segment->index_duration;
-    if (end > G_MAXINT / sizeof (GstMXFDemuxIndex)) {
-      demux->index_tables = g_list_remove (demux->index_tables, t);
-      g_array_free (t->offsets, TRUE);
-      g_free (t);
-      continue;
-    }
+  if (!t) {
+    t = g_new0 (GstMXFDemuxIndexTable, 1);
+    t->body_sid = segment->body_sid;
+    t->index_sid = segment->index_sid;
+    t->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
+    t->keyframes = g_array_new (FALSE, FALSE, sizeof (gint64));
+    demux->index_tables = g_list_prepend (demux->index_tables, t);
+  }
 
-    if (t->offsets->len < end)
-      g_array_set_size (t->offsets, end);
+  start = segment->index_start_position;
+  end = start + segment->index_duration;
+  if (end > G_MAXINT / sizeof (GstMXFDemuxIndex)) {
+    demux->index_tables = g_list_remove (demux->index_tables, t);
+    g_array_free (t->offsets, TRUE);
+    g_array_free (t->keyframes, TRUE);
+    g_free (t);
+    return;
+  }
 
-    for (i = 0; i < segment->n_index_entries && start + i < t->offsets->len;
-        i++) {
-      guint64 offset = segment->index_entries[i].stream_offset;
-      GList *m;
-      GstMXFDemuxPartition *offset_partition = NULL, *next_partition = NULL;
+  if (t->offsets->len < end)
+    g_array_set_size (t->offsets, end);
 
-      for (m = demux->partitions; m; m = m->next) {
-        GstMXFDemuxPartition *partition = m->data;
+  for (i = 0; i < segment->n_index_entries && start + i < t->offsets->len;
+      i++) {
+    guint64 offset = segment->index_entries[i].stream_offset;
+    GstMXFDemuxPartition *offset_partition = NULL, *next_partition = NULL;
 
-        if (!next_partition && offset_partition)
-          next_partition = partition;
+    for (m = demux->partitions; m; m = m->next) {
+      GstMXFDemuxPartition *partition = m->data;
 
-        if (partition->partition.body_sid != t->body_sid)
-          continue;
-        if (partition->partition.body_offset > offset)
-          break;
+      if (!next_partition && offset_partition)
+        next_partition = partition;
 
-        offset_partition = partition;
-        next_partition = NULL;
-      }
+      if (partition->partition.body_sid != t->body_sid)
+        continue;
+      if (partition->partition.body_offset > offset)
+        break;
 
-      if (offset_partition && offset >= offset_partition->partition.body_offset) {
-        offset =
-            offset_partition->partition.this_partition +
-            offset_partition->essence_container_offset + (offset -
-            offset_partition->partition.body_offset);
-
-        if (next_partition
-            && offset >= next_partition->partition.this_partition) {
-          GST_ERROR_OBJECT (demux,
-              "Invalid index table segment going into next unrelated partition");
-        } else {
-          GstMXFDemuxIndex *index;
-          gint8 temporal_offset = segment->index_entries[i].temporal_offset;
-          guint64 pts_i = G_MAXUINT64;
-
-          if (temporal_offset > 0 ||
-              (temporal_offset < 0 && start + i >= -(gint) temporal_offset)) {
-            pts_i = start + i + temporal_offset;
-
-            if (t->offsets->len < pts_i)
-              g_array_set_size (t->offsets, pts_i + 1);
-
-            index = &g_array_index (t->offsets, GstMXFDemuxIndex, pts_i);
-            if (!index->initialized) {
-              index->initialized = TRUE;
-              index->offset = 0;
-              index->pts = G_MAXUINT64;
-              index->dts = G_MAXUINT64;
-              index->keyframe = FALSE;
-            }
-
-            index->pts = start + i;
-          }
+      offset_partition = partition;
+      next_partition = NULL;
+    }
+
+    if (offset_partition && offset >= offset_partition->partition.body_offset) {
+      offset =
+          offset_partition->partition.this_partition +
+          offset_partition->essence_container_offset + (offset -
+          offset_partition->partition.body_offset);
+
+      if (next_partition
+          && offset >= next_partition->partition.this_partition) {
+        GST_ERROR_OBJECT (demux,
+            "Invalid index table segment going into next unrelated partition");
+      } else {
+        GstMXFDemuxIndex *index;
+        gint8 temporal_offset = segment->index_entries[i].temporal_offset;
+        guint64 pts_i = G_MAXUINT64;
 
-          index = &g_array_index (t->offsets, GstMXFDemuxIndex, start + i);
+        if (temporal_offset > 0 ||
+            (temporal_offset < 0 && start + i >= -(gint) temporal_offset)) {
+          pts_i = start + i + temporal_offset;
+
+          if (t->offsets->len < pts_i)
+            g_array_set_size (t->offsets, pts_i + 1);
+
+          index = &g_array_index (t->offsets, GstMXFDemuxIndex, pts_i);
           if (!index->initialized) {
             index->initialized = TRUE;
             index->offset = 0;
@@ -3790,14 +4162,59 @@ collect_index_table_segments (GstMXFDemux * demux)
             index->keyframe = FALSE;
           }
 
-          index->offset = offset;
-          index->keyframe = ! !(segment->index_entries[i].flags & 0x80)
-              || (segment->index_entries[i].key_frame_offset == 0);
-          index->dts = pts_i;
+          index->pts = start + i;
+        }
+
+        index = &g_array_index (t->offsets, GstMXFDemuxIndex, start + i);
+        if (!index->initialized) {
+          index->initialized = TRUE;
+          index->offset = 0;
+          index->pts = G_MAXUINT64;
+          index->dts = G_MAXUINT64;
+          index->keyframe = FALSE;
         }
+
+        index->offset = offset;
+        index->keyframe = ! !(segment->index_entries[i].flags & 0x80)
+            || (segment->index_entries[i].key_frame_offset == 0);
+        index->dts = pts_i;
+
+        gst_mxf_demux_index_table_update_keyframe (t, start + i,
+            index->keyframe && index->offset != 0);
       }
     }
   }
+}
+
+static void
+collect_index_table_segments (GstMXFDemux * demux)
+{
+  GList *l;
+  guint i;
+  guint64 old_offset = demux->offset;
+  GstMXFDemuxPartition *old_partition = demux->current_partition;
+
+  if (!demux->random_index_pack)
+    return;
+
+  for (i = 0; i < demux->random_index_pack->len; i++) {
+    MXFRandomIndexPackEntry *e =
+        &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry, i);
+
+    if (e->offset < demux->run_in) {
+      GST_ERROR_OBJECT (demux, "Invalid random index pack entry");
+      return;
+    }
+
+    demux->offset = e->offset;
+    read_partition_header (demux);
+  }
+
+  demux->offset = old_offset;
+  demux->current_partition = old_partition;
+
+  for (l = demux->pending_index_table_segments; l; l = l->next)
+    gst_mxf_demux_add_index_table_segment (demux, l->data);
 
   for (l = demux->pending_index_table_segments; l; l = l->next) {
     MXFIndexTableSegment *s = l->data;
@@ -3848,17 +4265,20 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
 
     /* Flush start up and downstream to make sure data flow and loops are
        idle */
+    gst_mxf_demux_growing_file_wakeup (demux, TRUE);
     e = gst_event_new_flush_start ();
     gst_event_set_seqnum (e, seqnum);
     gst_mxf_demux_push_src_event (demux, gst_event_ref (e));
     gst_pad_push_event (demux->sinkpad, e);
   } else {
     /* Pause the pulling task */
+    gst_mxf_demux_growing_file_wakeup (demux, TRUE);
     gst_pad_pause_task (demux->sinkpad);
   }
 
   /* Take the stream lock */
   GST_PAD_STREAM_LOCK (demux->sinkpad);
+  gst_mxf_demux_growing_file_wakeup (demux, FALSE);
 
   if (flush) {
     GstEvent *e;
@@ -4110,6 +4530,13 @@ gst_mxf_demux_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
       if (duration <= -1)
         duration = -1;
 
+      /* The metadata of a growing file doesn't know the final duration yet,
+       * use what was read so far */
+      if (duration <= 0 && gst_mxf_demux_is_growing_file (demux)
+          && mxfpad->current_essence_track
+          && mxfpad->current_essence_track->duration > 0)
+        duration = mxfpad->current_essence_track->duration;
+
       if (duration != -1 && format == GST_FORMAT_TIME) {
         if (mxfpad->material_track->edit_rate.n == 0 ||
             mxfpad->material_track->edit_rate.d == 0) {
@@ -4236,10 +4663,12 @@ gst_mxf_demux_sink_activate_mode (GstPad * sinkpad, GstObject * parent,
   } else {
     if (active) {
       demux->random_access = TRUE;
+      gst_mxf_demux_growing_file_wakeup (demux, FALSE);
       return gst_pad_start_task (sinkpad, (GstTaskFunction) gst_mxf_demux_loop,
           sinkpad, NULL);
     } else {
       demux->random_access = FALSE;
+      gst_mxf_demux_growing_file_wakeup (demux, TRUE);
       return gst_pad_stop_task (sinkpad);
     }
   }
@@ -4549,6 +4978,21 @@ gst_mxf_demux_set_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       demux->max_drift = g_value_get_uint64 (value);
       break;
+    case PROP_READAHEAD_SIZE:
+      GST_OBJECT_LOCK (demux);
+      demux->readahead_size = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_SKIP_DESCRIPTIVE_METADATA:
+      GST_OBJECT_LOCK (demux);
+      demux->skip_descriptive_metadata = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_GROWING_FILE:
+      GST_OBJECT_LOCK (demux);
+      demux->growing_file = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -4568,6 +5012,21 @@ gst_mxf_demux_get_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       g_value_set_uint64 (value, demux->max_drift);
       break;
+    case PROP_READAHEAD_SIZE:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint (value, demux->readahead_size);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_SKIP_DESCRIPTIVE_METADATA:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_boolean (value, demux->skip_descriptive_metadata);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_GROWING_FILE:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_boolean (value, demux->growing_file);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     case PROP_STRUCTURE:{
       GstStructure *s;
 
@@ -4628,6 +5087,8 @@ gst_mxf_demux_finalize (GObject * object)
   g_hash_table_destroy (demux->metadata);
 
   g_rw_lock_clear (&demux->metadata_lock);
+  g_mutex_clear (&demux->growing_file_lock);
+  g_cond_clear (&demux->growing_file_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -4662,6 +5123,28 @@ gst_mxf_demux_class_init (GstMXFDemuxClass * klass)
           "Structural metadata of the MXF file",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_READAHEAD_SIZE,
+      g_param_spec_uint ("readahead-size", "Readahead size",
+          "Size in bytes of the window read at once in pull mode to serve "
+          "KLV headers and small KLV packets (0 = disabled)",
+          0, G_MAXINT, DEFAULT_READAHEAD_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SKIP_DESCRIPTIVE_METADATA,
+      g_param_spec_boolean ("skip-descriptive-metadata",
+          "Skip descriptive metadata",
+          "Don't parse descriptive metadata sets (e.g. DMS-1), they won't be "
+          "part of the structure then",
+          DEFAULT_SKIP_DESCRIPTIVE_METADATA,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_GROWING_FILE,
+      g_param_spec_boolean ("growing-file", "Growing file",
+          "The file is still being written, wait for new data at its end "
+          "until the footer partition arrives (pull mode only)",
+          DEFAULT_GROWING_FILE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_mxf_demux_change_state);
   gstelement_class->query = GST_DEBUG_FUNCPTR (gst_mxf_demux_query);
@@ -4693,10 +5176,15 @@ gst_mxf_demux_init (GstMXFDemux * demux)
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 
   demux->max_drift = 500 * GST_MSECOND;
+  demux->readahead_size = DEFAULT_READAHEAD_SIZE;
+  demux->skip_descriptive_metadata = DEFAULT_SKIP_DESCRIPTIVE_METADATA;
+  demux->growing_file = DEFAULT_GROWING_FILE;
 
   demux->adapter = gst_adapter_new ();
   demux->flowcombiner = gst_flow_combiner_new ();
   g_rw_lock_init (&demux->metadata_lock);
+  g_mutex_init (&demux->growing_file_lock);
+  g_cond_init (&demux->growing_file_cond);
 
   demux->src = g_ptr_array_new ();
   demux->essence_tracks =
@@ -106,6 +106,10 @@ typedef struct
 
   /* offsets indexed by DTS */
   GArray *offsets;
+
+  /* sorted DTS of all entries in offsets that are keyframes with a known
+   * offset, for binary searching the previous keyframe */
+  GArray *keyframes;
 } GstMXFDemuxIndexTable;
 
 struct _GstMXFDemuxPad
@@ -141,6 +145,11 @@ struct _GstMXFDemuxPad
 
   GstMXFDemuxEssenceTrack *current_essence_track;
   gint64 current_essence_track_position;
+
+  /* Whether downstream handles buffers with a GstVideoMeta, checked with an
+   * allocation query the first time and on reconfigure */
+  gboolean video_meta_checked;
+  gboolean video_meta_supported;
 };
 
 struct _GstMXFDemuxPadClass
@@ -161,6 +170,10 @@ struct _GstMXFDemux
 
   GstAdapter *adapter;
 
+  /* Readahead window for pull mode, see gst_mxf_demux_pull_range_cached() */
+  GstBuffer *readahead;
+  guint64 readahead_offset;
+
   GstFlowCombiner *flowcombiner;
 
   GstSegment segment;
@@ -205,9 +218,17 @@ struct _GstMXFDemux
 
   GstTagList *tags;
 
+  /* Growing file mode, to interrupt the wait for new data */
+  GMutex growing_file_lock;
+  GCond growing_file_cond;
+  gboolean growing_file_wakeup;
+
   /* Properties */
   gchar *requested_package_string;
   GstClockTime max_drift;
+  guint readahead_size;
+  gboolean skip_descriptive_metadata;
+  gboolean growing_file;
 };
 
 struct _GstMXFDemuxClass
@@ -386,6 +386,11 @@ struct _MXFMetadataBase {
 
   guint64 offset;
 
+  /* Hash and size of the serialized set, set by the demuxer to detect
+   * unchanged repetitions of the same set */
+  guint64 data_hash;
+  guint data_size;
+
   MXFMetadataBaseResolveState resolved;
 
   GHashTable *other_tags;
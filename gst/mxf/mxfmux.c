@@ -115,13 +115,30 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src",
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_PARTITION_DURATION
 };
 
+#define DEFAULT_PARTITION_DURATION 0
+
+/* Limited by the 16 bit length of the index entry array local tag */
+#define MAX_INDEX_SEGMENT_ENTRIES (G_MAXUINT16 / 11)
+
+/* Temporal offset for an index entry that wasn't written yet */
+typedef struct
+{
+  guint64 position;
+  gint8 temporal_offset;
+} GstMXFMuxTemporalOffset;
+
 #define gst_mxf_mux_parent_class parent_class
 G_DEFINE_TYPE (GstMXFMux, gst_mxf_mux, GST_TYPE_AGGREGATOR);
 
 static void gst_mxf_mux_finalize (GObject * object);
+static void gst_mxf_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_mxf_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static GstFlowReturn gst_mxf_mux_aggregate (GstAggregator * aggregator,
     gboolean timeout);
@@ -163,6 +180,16 @@ gst_mxf_mux_class_init (GstMXFMuxClass * klass)
   gstaggregator_class = (GstAggregatorClass *) klass;
 
   gobject_class->finalize = gst_mxf_mux_finalize;
+  gobject_class->set_property = gst_mxf_mux_set_property;
+  gobject_class->get_property = gst_mxf_mux_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_PARTITION_DURATION,
+      g_param_spec_uint64 ("partition-duration", "Partition duration",
+          "Start a new body partition with the index table segments of the "
+          "previous one at the first keyframe after this many nanoseconds "
+          "(0 = single body partition, index only in the footer)", 0,
+          G_MAXUINT64, DEFAULT_PARTITION_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstaggregator_class->create_new_pad =
       GST_DEBUG_FUNCPTR (gst_mxf_mux_create_new_pad);
@@ -191,9 +218,50 @@ static void
 gst_mxf_mux_init (GstMXFMux * mux)
 {
   mux->index_table = g_array_new (FALSE, FALSE, sizeof (MXFIndexTableSegment));
+  mux->pending_temporal_offsets =
+      g_array_new (FALSE, FALSE, sizeof (GstMXFMuxTemporalOffset));
+  mux->partitions =
+      g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+  mux->partition_duration = DEFAULT_PARTITION_DURATION;
   gst_mxf_mux_reset (mux);
 }
 
+static void
+gst_mxf_mux_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstMXFMux *mux = GST_MXF_MUX (object);
+
+  switch (prop_id) {
+    case PROP_PARTITION_DURATION:
+      GST_OBJECT_LOCK (mux);
+      mux->partition_duration = g_value_get_uint64 (value);
+      GST_OBJECT_UNLOCK (mux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_mxf_mux_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstMXFMux *mux = GST_MXF_MUX (object);
+
+  switch (prop_id) {
+    case PROP_PARTITION_DURATION:
+      GST_OBJECT_LOCK (mux);
+      g_value_set_uint64 (value, mux->partition_duration);
+      GST_OBJECT_UNLOCK (mux);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_mxf_mux_finalize (GObject * object)
 {
@@ -217,6 +285,9 @@ gst_mxf_mux_finalize (GObject * object)
     mux->index_table = NULL;
   }
 
+  g_array_free (mux->pending_temporal_offsets, TRUE);
+  g_array_free (mux->partitions, TRUE);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -266,8 +337,18 @@ gst_mxf_mux_reset (GstMXFMux * mux)
       g_free (g_array_index (mux->index_table, MXFIndexTableSegment,
               n).index_entries);
   g_array_set_size (mux->index_table, 0);
-  mux->current_index_pos = 0;
+  mux->n_written_index_segments = 0;
+  mux->close_index_segment = FALSE;
   mux->last_keyframe_pos = 0;
+  if (mux->pending_temporal_offsets)
+    g_array_set_size (mux->pending_temporal_offsets, 0);
+  mux->constant_edit_unit_size = TRUE;
+  mux->edit_unit_byte_count = 0;
+
+  mux->body_offset = 0;
+  if (mux->partitions)
+    g_array_set_size (mux->partitions, 0);
+  mux->last_partition_timestamp = 0;
 }
 
 static gboolean
@@ -1205,6 +1286,126 @@ static const guint8 _gc_essence_element_ul[] = {
   0x0d, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00
 };
 
+static MXFIndexTableSegment *
+gst_mxf_mux_new_index_segment (GstMXFMux * mux, GstMXFMuxPad * pad)
+{
+  MXFIndexTableSegment s;
+
+  memset (&s, 0, sizeof (s));
+
+  mxf_uuid_init (&s.instance_id, mux->metadata);
+  memcpy (&s.index_edit_rate, &pad->source_track->edit_rate,
+      sizeof (s.index_edit_rate));
+  if (mux->index_table->len > 0) {
+    MXFIndexTableSegment *last =
+        &g_array_index (mux->index_table, MXFIndexTableSegment,
+        mux->index_table->len - 1);
+
+    s.index_start_position = last->index_start_position + last->index_duration;
+  }
+  s.index_sid =
+      mux->preface->content_storage->essence_container_data[0]->index_sid;
+  s.body_sid =
+      mux->preface->content_storage->essence_container_data[0]->body_sid;
+  s.index_entries = g_new0 (MXFIndexEntry, MAX_INDEX_SEGMENT_ENTRIES);
+  g_array_append_val (mux->index_table, s);
+
+  return &g_array_index (mux->index_table, MXFIndexTableSegment,
+      mux->index_table->len - 1);
+}
+
+/* Sets the temporal offset of the index entry for the edit unit at
+ * position, or remembers it until that entry is added */
+static void
+gst_mxf_mux_set_temporal_offset (GstMXFMux * mux, guint64 position,
+    guint64 current_position, gint8 temporal_offset)
+{
+  guint i;
+
+  if (position > current_position) {
+    GstMXFMuxTemporalOffset t = { position, temporal_offset };
+
+    g_array_append_val (mux->pending_temporal_offsets, t);
+    return;
+  }
+
+  for (i = mux->index_table->len; i > 0; i--) {
+    MXFIndexTableSegment *segment =
+        &g_array_index (mux->index_table, MXFIndexTableSegment, i - 1);
+
+    if (segment->index_start_position <= position) {
+      if (position - segment->index_start_position < segment->n_index_entries)
+        segment->index_entries[position -
+            segment->index_start_position].temporal_offset = temporal_offset;
+      return;
+    }
+  }
+}
+
+static void
+gst_mxf_mux_add_index_entry (GstMXFMux * mux, GstMXFMuxPad * pad,
+    gboolean is_keyframe, GstClockTime pts, GstClockTime dts)
+{
+  MXFIndexTableSegment *segment = NULL;
+  MXFIndexEntry *entry;
+  guint i;
+
+  if (mux->index_table->len > 0)
+    segment =
+        &g_array_index (mux->index_table, MXFIndexTableSegment,
+        mux->index_table->len - 1);
+
+  if (segment == NULL || mux->close_index_segment
+      || segment->n_index_entries >= MAX_INDEX_SEGMENT_ENTRIES) {
+    segment = gst_mxf_mux_new_index_segment (mux, pad);
+    mux->close_index_segment = FALSE;
+  }
+
+  /* Leave temporal offset initialized at 0 unless an earlier edit unit
+   * set it already or the code below sets it */
+  entry = &segment->index_entries[segment->n_index_entries];
+  for (i = 0; i < mux->pending_temporal_offsets->len; i++) {
+    GstMXFMuxTemporalOffset *t = &g_array_index (mux->pending_temporal_offsets,
+        GstMXFMuxTemporalOffset, i);
+
+    if (t->position == pad->pos) {
+      entry->temporal_offset = t->temporal_offset;
+      g_array_remove_index_fast (mux->pending_temporal_offsets, i);
+      break;
+    }
+  }
+
+  if (is_keyframe)
+    mux->last_keyframe_pos = pad->pos;
+  entry->key_frame_offset = MIN (pad->pos - mux->last_keyframe_pos, 127);
+  entry->flags = is_keyframe ? 0x80 : 0x20;     /* FIXME: Need to distinguish all the cases */
+  entry->stream_offset = mux->body_offset;
+
+  segment->n_index_entries++;
+  segment->index_duration++;
+
+  if (dts != GST_CLOCK_TIME_NONE && pts != GST_CLOCK_TIME_NONE) {
+    guint64 pts_pos;
+    gint64 index_pos_diff;
+
+    pts =
+        gst_segment_to_running_time (&pad->parent.segment, GST_FORMAT_TIME,
+        pts);
+    pts_pos =
+        gst_util_uint64_scale_round (pts, pad->source_track->edit_rate.n,
+        pad->source_track->edit_rate.d * GST_SECOND);
+
+    index_pos_diff = pts_pos - pad->pos;
+    if (index_pos_diff >= 127 || index_pos_diff < -127) {
+      GST_WARNING_OBJECT (pad, "Temporal offset %" G_GINT64_FORMAT
+          " out of range", index_pos_diff);
+    } else if (index_pos_diff != 0) {
+      gst_mxf_mux_set_temporal_offset (mux, pts_pos, pad->pos,
+          -index_pos_diff);
+    }
+  }
+}
+
 static GstFlowReturn
 gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
 {
@@ -1220,6 +1421,7 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
       !GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT) : TRUE;
   GstClockTime pts = buf ? GST_BUFFER_PTS (buf) : GST_CLOCK_TIME_NONE;
   GstClockTime dts = buf ? GST_BUFFER_DTS (buf) : GST_CLOCK_TIME_NONE;
+  gboolean indexed = FALSE;
 
   if (pad->have_complete_edit_unit) {
     GST_DEBUG_OBJECT (pad,
@@ -1267,135 +1469,25 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
 
   /* We currently only index the first essence stream */
   if (pad == (GstMXFMuxPad *) GST_ELEMENT_CAST (mux)->sinkpads->data) {
-    MXFIndexTableSegment *segment;
-    const gint max_segment_size = G_MAXUINT16 / 11;
-
-    if (mux->index_table->len == 0 ||
-        g_array_index (mux->index_table, MXFIndexTableSegment,
-            mux->current_index_pos).index_duration >= max_segment_size) {
-
-      if (mux->index_table->len > 0)
-        mux->current_index_pos++;
-
-      if (mux->index_table->len <= mux->current_index_pos) {
-        MXFIndexTableSegment s;
-
-        memset (&segment, 0, sizeof (segment));
-
-        mxf_uuid_init (&s.instance_id, mux->metadata);
-        memcpy (&s.index_edit_rate, &pad->source_track->edit_rate,
-            sizeof (s.index_edit_rate));
-        if (mux->index_table->len > 0)
-          s.index_start_position =
-              g_array_index (mux->index_table, MXFIndexTableSegment,
-              mux->index_table->len - 1).index_start_position;
-        else
-          s.index_start_position = 0;
-        s.index_duration = 0;
-        s.edit_unit_byte_count = 0;
-        s.index_sid =
-            mux->preface->content_storage->essence_container_data[0]->index_sid;
-        s.body_sid =
-            mux->preface->content_storage->essence_container_data[0]->body_sid;
-        s.slice_count = 0;
-        s.pos_table_count = 0;
-        s.n_delta_entries = 0;
-        s.delta_entries = NULL;
-        s.n_index_entries = 0;
-        s.index_entries = g_new0 (MXFIndexEntry, max_segment_size);
-        g_array_append_val (mux->index_table, s);
-      }
-    }
-    segment =
-        &g_array_index (mux->index_table, MXFIndexTableSegment,
-        mux->current_index_pos);
-
-    if (dts != GST_CLOCK_TIME_NONE && pts != GST_CLOCK_TIME_NONE) {
-      guint64 pts_pos;
-      guint64 pts_index_pos, pts_segment_pos;
-      gint64 index_pos_diff;
-      MXFIndexTableSegment *pts_segment;
-
-      pts =
-          gst_segment_to_running_time (&pad->parent.segment, GST_FORMAT_TIME,
-          pts);
-      pts_pos =
-          gst_util_uint64_scale_round (pts, pad->source_track->edit_rate.n,
-          pad->source_track->edit_rate.d * GST_SECOND);
-
-      index_pos_diff = pts_pos - pad->pos;
-      pts_index_pos = mux->current_index_pos;
-      pts_segment_pos = segment->n_index_entries;
-      if (index_pos_diff >= 0) {
-        while (pts_segment_pos + index_pos_diff >= max_segment_size) {
-          index_pos_diff -= max_segment_size - pts_segment_pos;
-          pts_segment_pos = 0;
-          pts_index_pos++;
-
-          if (pts_index_pos >= mux->index_table->len) {
-            MXFIndexTableSegment s;
-
-            memset (&segment, 0, sizeof (segment));
-
-            mxf_uuid_init (&s.instance_id, mux->metadata);
-            memcpy (&s.index_edit_rate, &pad->source_track->edit_rate,
-                sizeof (s.index_edit_rate));
-            if (mux->index_table->len > 0)
-              s.index_start_position =
-                  g_array_index (mux->index_table, MXFIndexTableSegment,
-                  mux->index_table->len - 1).index_start_position;
-            else
-              s.index_start_position = 0;
-            s.index_duration = 0;
-            s.edit_unit_byte_count = 0;
-            s.index_sid =
-                mux->preface->content_storage->
-                essence_container_data[0]->index_sid;
-            s.body_sid =
-                mux->preface->content_storage->
-                essence_container_data[0]->body_sid;
-            s.slice_count = 0;
-            s.pos_table_count = 0;
-            s.n_delta_entries = 0;
-            s.delta_entries = NULL;
-            s.n_index_entries = 0;
-            s.index_entries = g_new0 (MXFIndexEntry, max_segment_size);
-            g_array_append_val (mux->index_table, s);
-          }
-        }
-      } else {
-        while (pts_segment_pos + index_pos_diff <= 0) {
-          if (pts_index_pos == 0) {
-            pts_index_pos = G_MAXUINT64;
-            break;
-          }
-          index_pos_diff += pts_segment_pos;
-          pts_segment_pos = max_segment_size;
-          pts_index_pos--;
-        }
-      }
-      if (pts_index_pos != G_MAXUINT64) {
-        g_assert (index_pos_diff < 127 && index_pos_diff >= -127);
-        pts_segment =
-            &g_array_index (mux->index_table, MXFIndexTableSegment,
-            pts_index_pos);
-        pts_segment->index_entries[pts_segment_pos +
-            index_pos_diff].temporal_offset = -index_pos_diff;
+    GstClockTime partition_duration;
+
+    GST_OBJECT_LOCK (mux);
+    partition_duration = mux->partition_duration;
+    GST_OBJECT_UNLOCK (mux);
+
+    if (partition_duration > 0 && is_keyframe && pad->pos > 0
+        && pad->last_timestamp >=
+        mux->last_partition_timestamp + partition_duration) {
+      if ((ret = gst_mxf_mux_write_body_partition (mux)) != GST_FLOW_OK) {
+        GST_ERROR_OBJECT (mux, "Failed pushing body partition");
+        gst_buffer_unref (buf);
+        return ret;
       }
+      mux->last_partition_timestamp = pad->last_timestamp;
     }
 
-    /* Leave temporal offset initialized at 0, above code will set it as necessary */
-    ;
-    if (is_keyframe)
-      mux->last_keyframe_pos = pad->pos;
-    segment->index_entries[segment->n_index_entries].key_frame_offset =
-        MIN (pad->pos - mux->last_keyframe_pos, 127);
-    segment->index_entries[segment->n_index_entries].flags = is_keyframe ? 0x80 : 0x20; /* FIXME: Need to distinguish all the cases */
-    segment->index_entries[segment->n_index_entries].stream_offset =
-        mux->partition.body_offset;
-
-    segment->n_index_entries++;
-    segment->index_duration++;
+    gst_mxf_mux_add_index_entry (mux, pad, is_keyframe, pts, dts);
+    indexed = TRUE;
   }
 
   buf_size = gst_buffer_get_size (buf);
@@ -1412,7 +1504,14 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
       "Pushing buffer of size %" G_GSIZE_FORMAT " for track %u",
       gst_buffer_get_size (outbuf), pad->source_track->parent.track_id);
 
-  mux->partition.body_offset += gst_buffer_get_size (outbuf);
+  if (indexed) {
+    if (mux->edit_unit_byte_count == 0)
+      mux->edit_unit_byte_count = gst_buffer_get_size (outbuf);
+    else if (mux->edit_unit_byte_count != gst_buffer_get_size (outbuf))
+      mux->constant_edit_unit_size = FALSE;
+  }
+
+  mux->body_offset += gst_buffer_get_size (outbuf);
   if ((ret = gst_mxf_mux_push (mux, outbuf)) != GST_FLOW_OK) {
     GST_ERROR_OBJECT (pad,
         "Failed pushing buffer for track %u, reason %s",
@@ -1428,26 +1527,62 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * pad)
   return ret;
 }
 
+/* Starts a new body partition. All index table segments that were not
+ * written yet, i.e. the ones for the essence of the previous body partition,
+ * are written right after the partition pack */
 static GstFlowReturn
 gst_mxf_mux_write_body_partition (GstMXFMux * mux)
 {
+  MXFRandomIndexPackEntry entry;
+  GList *segments = NULL, *l;
+  guint64 index_byte_count = 0;
+  GstFlowReturn ret;
   GstBuffer *buf;
+  guint i;
+
+  for (i = mux->n_written_index_segments; i < mux->index_table->len; i++) {
+    buf =
+        mxf_index_table_segment_to_buffer (&g_array_index (mux->index_table,
+            MXFIndexTableSegment, i));
+    index_byte_count += gst_buffer_get_size (buf);
+    segments = g_list_prepend (segments, buf);
+  }
+  segments = g_list_reverse (segments);
+  mux->n_written_index_segments = mux->index_table->len;
+  mux->close_index_segment = TRUE;
 
   mux->partition.type = MXF_PARTITION_PACK_BODY;
   mux->partition.closed = TRUE;
   mux->partition.complete = TRUE;
+  mux->partition.prev_partition = mux->partition.this_partition;
   mux->partition.this_partition = mux->offset;
-  mux->partition.prev_partition = 0;
   mux->partition.footer_partition = 0;
   mux->partition.header_byte_count = 0;
-  mux->partition.index_byte_count = 0;
-  mux->partition.index_sid = 0;
-  mux->partition.body_offset = 0;
+  mux->partition.index_byte_count = index_byte_count;
+  mux->partition.index_sid = index_byte_count > 0 ?
+      mux->preface->content_storage->essence_container_data[0]->index_sid : 0;
+  mux->partition.body_offset = mux->body_offset;
   mux->partition.body_sid =
       mux->preface->content_storage->essence_container_data[0]->body_sid;
 
+  entry.offset = mux->offset;
+  entry.body_sid = mux->partition.body_sid;
+  g_array_append_val (mux->partitions, entry);
+
   buf = mxf_partition_pack_to_buffer (&mux->partition);
-  return gst_mxf_mux_push (mux, buf);
+  ret = gst_mxf_mux_push (mux, buf);
+
+  for (l = segments; l; l = l->next) {
+    buf = l->data;
+    l->data = NULL;
+    if (ret == GST_FLOW_OK)
+      ret = gst_mxf_mux_push (mux, buf);
+    else
+      gst_buffer_unref (buf);
+  }
+  g_list_free (segments);
+
+  return ret;
 }
 
 static GstFlowReturn
@@ -1565,7 +1700,7 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
 
   {
     guint64 body_partition = mux->partition.this_partition;
-    guint32 body_sid = mux->partition.body_sid;
+    guint64 first_body_partition;
     guint64 footer_partition = mux->offset;
     GArray *rip;
     GstFlowReturn ret;
@@ -1576,13 +1711,46 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     guint i;
     GstBuffer *buf;
 
-    for (i = 0; i < mux->index_table->len; i++) {
-      MXFIndexTableSegment *segment =
-          &g_array_index (mux->index_table, MXFIndexTableSegment, i);
-      GstBuffer *segment_buffer = mxf_index_table_segment_to_buffer (segment);
-
-      index_byte_count += gst_buffer_get_size (segment_buffer);
-      index_entries = g_list_prepend (index_entries, segment_buffer);
+    g_assert (mux->partitions->len > 0);
+    first_body_partition =
+        g_array_index (mux->partitions, MXFRandomIndexPackEntry, 0).offset;
+
+    if (mux->constant_edit_unit_size && mux->n_written_index_segments == 0
+        && mux->index_table->len > 0
+        && GST_ELEMENT_CAST (mux)->numsinkpads == 1) {
+      MXFIndexTableSegment cbe;
+      MXFIndexTableSegment *first =
+          &g_array_index (mux->index_table, MXFIndexTableSegment, 0);
+
+      /* All edit units have the same size, a single CBE segment without
+       * index entries describes the whole essence */
+      memset (&cbe, 0, sizeof (cbe));
+      memcpy (&cbe.instance_id, &first->instance_id, sizeof (cbe.instance_id));
+      memcpy (&cbe.index_edit_rate, &first->index_edit_rate,
+          sizeof (cbe.index_edit_rate));
+      cbe.index_start_position = 0;
+      for (i = 0; i < mux->index_table->len; i++)
+        cbe.index_duration +=
+            g_array_index (mux->index_table, MXFIndexTableSegment,
+            i).index_duration;
+      cbe.edit_unit_byte_count = mux->edit_unit_byte_count;
+      cbe.index_sid = first->index_sid;
+      cbe.body_sid = first->body_sid;
+
+      buf = mxf_index_table_segment_to_buffer (&cbe);
+      index_byte_count += gst_buffer_get_size (buf);
+      index_entries = g_list_prepend (index_entries, buf);
+    } else {
+      /* The footer always carries the complete index table */
+      for (i = 0; i < mux->index_table->len; i++) {
+        MXFIndexTableSegment *segment =
+            &g_array_index (mux->index_table, MXFIndexTableSegment, i);
+        GstBuffer *segment_buffer =
+            mxf_index_table_segment_to_buffer (segment);
+
+        index_byte_count += gst_buffer_get_size (segment_buffer);
+        index_entries = g_list_prepend (index_entries, segment_buffer);
+      }
     }
 
     mux->partition.type = MXF_PARTITION_PACK_FOOTER;
@@ -1608,13 +1776,12 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     }
     g_list_free (index_entries);
 
-    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry), 3);
+    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry),
+        mux->partitions->len + 2);
     entry.offset = 0;
     entry.body_sid = 0;
     g_array_append_val (rip, entry);
-    entry.offset = body_partition;
-    entry.body_sid = body_sid;
-    g_array_append_val (rip, entry);
+    g_array_append_vals (rip, mux->partitions->data, mux->partitions->len);
     entry.offset = footer_partition;
     entry.body_sid = 0;
     g_array_append_val (rip, entry);
@@ -1648,7 +1815,7 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
         return ret;
       }
 
-      g_assert (mux->offset == body_partition);
+      g_assert (mux->offset == first_body_partition);
 
       mux->partition.type = MXF_PARTITION_PACK_BODY;
       mux->partition.closed = TRUE;
@@ -70,8 +70,22 @@ typedef struct _GstMXFMux {
   gchar *application;
 
   GArray *index_table;
-  guint current_index_pos;
+  /* index table segments already written in body partitions */
+  guint n_written_index_segments;
+  gboolean close_index_segment;
   guint64 last_keyframe_pos;
+  GArray *pending_temporal_offsets;
+  gboolean constant_edit_unit_size;
+  guint32 edit_unit_byte_count;
+
+  /* offset in the essence container */
+  guint64 body_offset;
+  /* body partitions for the random index pack */
+  GArray *partitions;
+  GstClockTime last_partition_timestamp;
+
+  /* properties */
+  GstClockTime partition_duration;
 } GstMXFMux;
 
 typedef struct _GstMXFMuxClass {
@@ -168,35 +168,19 @@ mxf_up_handle_essence_element (const MXFUL * key, GstBuffer * buffer,
     return GST_FLOW_ERROR;
   }
 
-  if (data->bpp != 4
-      || GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
-    guint y;
-    GstBuffer *ret;
-    GstMapInfo inmap, outmap;
-    guint8 *indata, *outdata;
-
-    ret =
-        gst_buffer_new_and_alloc (GST_ROUND_UP_4 (data->width * data->bpp) *
-        data->height);
-    gst_buffer_map (buffer, &inmap, GST_MAP_READ);
-    gst_buffer_map (ret, &outmap, GST_MAP_WRITE);
-    indata = inmap.data;
-    outdata = outmap.data;
-
-    for (y = 0; y < data->height; y++) {
-      memcpy (outdata, indata, data->width * data->bpp);
-      outdata += GST_ROUND_UP_4 (data->width * data->bpp);
-      indata += data->width * data->bpp;
-    }
-
-    gst_buffer_unmap (buffer, &inmap);
-    gst_buffer_unmap (ret, &outmap);
-
-    gst_buffer_unref (buffer);
-    *outbuf = ret;
-  } else {
-    *outbuf = buffer;
+  /* Lines are stored without padding, describe that with a video meta
+   * instead of repacking them to the default 4 byte aligned stride. The
+   * demuxer repacks if downstream can't handle the meta. */
+  if (GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
+    gsize offset[GST_VIDEO_MAX_PLANES] = { 0, };
+    gint stride[GST_VIDEO_MAX_PLANES] = { 0, };
+
+    stride[0] = data->width * data->bpp;
+    gst_buffer_add_video_meta_full (buffer, GST_VIDEO_FRAME_FLAG_NONE,
+        gst_video_format_from_string (data->format), data->width,
+        data->height, 1, offset, stride);
   }
+  *outbuf = buffer;
 
   return GST_FLOW_OK;
 }
@@ -94,57 +94,84 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 G_DEFINE_TYPE (GstNetSim, gst_net_sim, GST_TYPE_ELEMENT);
 
-static gboolean
-gst_net_sim_source_dispatch (GSource * source,
-    GSourceFunc callback, gpointer user_data)
+/* a delayed packet, ordered by ready time and then by arrival */
+typedef struct
+{
+  gint64 ready_time;
+  guint64 seqnum;
+  GstBuffer *buf;
+} DelayedPacket;
+
+static void
+delayed_packet_free (DelayedPacket * packet)
 {
-  callback (user_data);
-  return FALSE;
+  if (packet->buf)
+    gst_buffer_unref (packet->buf);
+  g_slice_free (DelayedPacket, packet);
 }
 
-GSourceFuncs gst_net_sim_source_funcs = {
-  NULL,                         /* prepare */
-  NULL,                         /* check */
-  gst_net_sim_source_dispatch,
-  NULL                          /* finalize */
-};
+static gint
+delayed_packet_compare (const DelayedPacket * a, const DelayedPacket * b,
+    gpointer user_data)
+{
+  if (a->ready_time != b->ready_time)
+    return a->ready_time < b->ready_time ? -1 : 1;
+
+  return a->seqnum < b->seqnum ? -1 : (a->seqnum > b->seqnum);
+}
 
+/* Waits for the earliest delayed packet to be due, and pushes it along with
+ * all the other packets that are due by then as one buffer list. */
 static void
 gst_net_sim_loop (GstNetSim * netsim)
 {
-  GMainLoop *loop;
-
-  GST_TRACE_OBJECT (netsim, "TASK: begin");
+  GstBufferList *list;
+  GSequenceIter *iter;
+  DelayedPacket *packet;
+  gint64 now = 0;
 
   g_mutex_lock (&netsim->loop_mutex);
-  loop = g_main_loop_ref (netsim->main_loop);
-  netsim->running = TRUE;
-  GST_TRACE_OBJECT (netsim, "TASK: signal start");
-  g_cond_signal (&netsim->start_cond);
-  g_mutex_unlock (&netsim->loop_mutex);
+  while (netsim->running) {
+    iter = g_sequence_get_begin_iter (netsim->delayed_packets);
+    if (g_sequence_iter_is_end (iter)) {
+      g_cond_wait (&netsim->delay_cond, &netsim->loop_mutex);
+      continue;
+    }
 
-  GST_TRACE_OBJECT (netsim, "TASK: run");
-  g_main_loop_run (loop);
-  g_main_loop_unref (loop);
+    packet = g_sequence_get (iter);
+    now = g_get_monotonic_time ();
+    if (packet->ready_time <= now)
+      break;
 
-  g_mutex_lock (&netsim->loop_mutex);
-  GST_TRACE_OBJECT (netsim, "TASK: pause");
-  gst_pad_pause_task (netsim->srcpad);
-  netsim->running = FALSE;
-  GST_TRACE_OBJECT (netsim, "TASK: signal end");
-  g_cond_signal (&netsim->start_cond);
+    g_cond_wait_until (&netsim->delay_cond, &netsim->loop_mutex,
+        packet->ready_time);
+  }
+
+  if (!netsim->running) {
+    GST_TRACE_OBJECT (netsim, "TASK: pause");
+    g_mutex_unlock (&netsim->loop_mutex);
+    gst_pad_pause_task (netsim->srcpad);
+    return;
+  }
+
+  list = gst_buffer_list_new ();
+  while (!g_sequence_iter_is_end (iter)) {
+    GSequenceIter *next = g_sequence_iter_next (iter);
+
+    packet = g_sequence_get (iter);
+    if (packet->ready_time > now)
+      break;
+
+    gst_buffer_list_add (list, packet->buf);
+    packet->buf = NULL;
+    g_sequence_remove (iter);
+    iter = next;
+  }
   g_mutex_unlock (&netsim->loop_mutex);
-  GST_TRACE_OBJECT (netsim, "TASK: end");
-}
 
-static gboolean
-_main_loop_quit_and_remove_source (gpointer user_data)
-{
-  GMainLoop *main_loop = user_data;
-  GST_DEBUG ("MAINLOOP: Quit %p", main_loop);
-  g_main_loop_quit (main_loop);
-  g_assert (!g_main_loop_is_running (main_loop));
-  return FALSE;                 /* Remove source */
+  GST_DEBUG_OBJECT (netsim, "Pushing %u delayed buffers now",
+      gst_buffer_list_length (list));
+  gst_pad_push_list (netsim->srcpad, list);
 }
 
 static gboolean
@@ -152,90 +179,64 @@ gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
     GstPadMode mode, gboolean active)
 {
   GstNetSim *netsim = GST_NET_SIM (parent);
-  gboolean result = FALSE;
+  gboolean result;
 
-  g_mutex_lock (&netsim->loop_mutex);
   if (active) {
-    if (netsim->main_loop == NULL) {
-      GMainContext *main_context = g_main_context_new ();
-      netsim->main_loop = g_main_loop_new (main_context, FALSE);
-      g_main_context_unref (main_context);
-
-      GST_TRACE_OBJECT (netsim, "ACT: Starting task on srcpad");
-      result = gst_pad_start_task (netsim->srcpad,
-          (GstTaskFunction) gst_net_sim_loop, netsim, NULL);
-
-      GST_TRACE_OBJECT (netsim, "ACT: Wait for task to start");
-      g_assert (!netsim->running);
-      while (!netsim->running)
-        g_cond_wait (&netsim->start_cond, &netsim->loop_mutex);
-      GST_TRACE_OBJECT (netsim, "ACT: Task on srcpad started");
-    }
+    g_mutex_lock (&netsim->loop_mutex);
+    netsim->running = TRUE;
+    g_mutex_unlock (&netsim->loop_mutex);
+
+    GST_TRACE_OBJECT (netsim, "ACT: Starting task on srcpad");
+    result = gst_pad_start_task (netsim->srcpad,
+        (GstTaskFunction) gst_net_sim_loop, netsim, NULL);
   } else {
-    if (netsim->main_loop != NULL) {
-      GSource *source;
-      guint id;
-
-      /* Adds an Idle Source which quits the main loop from within.
-       * This removes the possibility for run/quit race conditions. */
-      GST_TRACE_OBJECT (netsim, "DEACT: Stopping main loop on deactivate");
-      source = g_idle_source_new ();
-      g_source_set_callback (source, _main_loop_quit_and_remove_source,
-          g_main_loop_ref (netsim->main_loop),
-          (GDestroyNotify) g_main_loop_unref);
-      id = g_source_attach (source,
-          g_main_loop_get_context (netsim->main_loop));
-      g_source_unref (source);
-      g_assert_cmpuint (id, >, 0);
-      g_main_loop_unref (netsim->main_loop);
-      netsim->main_loop = NULL;
-
-      GST_TRACE_OBJECT (netsim, "DEACT: Wait for mainloop and task to pause");
-      g_assert (netsim->running);
-      while (netsim->running)
-        g_cond_wait (&netsim->start_cond, &netsim->loop_mutex);
-
-      GST_TRACE_OBJECT (netsim, "DEACT: Stopping task on srcpad");
-      result = gst_pad_stop_task (netsim->srcpad);
-      GST_TRACE_OBJECT (netsim, "DEACT: Mainloop and GstTask stopped");
-    }
+    g_mutex_lock (&netsim->loop_mutex);
+    netsim->running = FALSE;
+    g_cond_signal (&netsim->delay_cond);
+    g_mutex_unlock (&netsim->loop_mutex);
+
+    GST_TRACE_OBJECT (netsim, "DEACT: Stopping task on srcpad");
+    result = gst_pad_stop_task (netsim->srcpad);
+
+    g_mutex_lock (&netsim->loop_mutex);
+    gst_net_sim_clear_delayed (netsim);
+    g_mutex_unlock (&netsim->loop_mutex);
   }
-  g_mutex_unlock (&netsim->loop_mutex);
 
   return result;
 }
 
-typedef struct
-{
-  GstPad *pad;
-  GstBuffer *buf;
-} PushBufferCtx;
-
-G_INLINE_FUNC PushBufferCtx *
-push_buffer_ctx_new (GstPad * pad, GstBuffer * buf)
+static void
+gst_net_sim_clear_delayed (GstNetSim * netsim)
 {
-  PushBufferCtx *ctx = g_slice_new (PushBufferCtx);
-  ctx->pad = gst_object_ref (pad);
-  ctx->buf = gst_buffer_ref (buf);
-  return ctx;
+  g_sequence_remove_range (g_sequence_get_begin_iter (netsim->delayed_packets),
+      g_sequence_get_end_iter (netsim->delayed_packets));
 }
 
-G_INLINE_FUNC void
-push_buffer_ctx_free (PushBufferCtx * ctx)
+/* The delayed packets are part of the data that is flushed */
+static gboolean
+gst_net_sim_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
-  if (G_LIKELY (ctx != NULL)) {
-    gst_buffer_unref (ctx->buf);
-    gst_object_unref (ctx->pad);
-    g_slice_free (PushBufferCtx, ctx);
+  GstNetSim *netsim = GST_NET_SIM (parent);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      g_mutex_lock (&netsim->loop_mutex);
+      GST_DEBUG_OBJECT (netsim, "Dropping %d delayed packets",
+          g_sequence_get_length (netsim->delayed_packets));
+      gst_net_sim_clear_delayed (netsim);
+      g_mutex_unlock (&netsim->loop_mutex);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      g_mutex_lock (&netsim->loop_mutex);
+      netsim->last_ready_time = 0;
+      g_mutex_unlock (&netsim->loop_mutex);
+      break;
+    default:
+      break;
   }
-}
 
-static gboolean
-push_buffer_ctx_push (PushBufferCtx * ctx)
-{
-  GST_DEBUG_OBJECT (ctx->pad, "Pushing buffer now");
-  gst_pad_push (ctx->pad, gst_buffer_ref (ctx->buf));
-  return FALSE;
+  return gst_pad_event_default (pad, parent, event);
 }
 
 static gint
@@ -329,14 +330,12 @@ get_random_value_gamma (GRand * rand_seed, gint32 low, gint32 high,
 static GstFlowReturn
 gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-
   g_mutex_lock (&netsim->loop_mutex);
-  if (netsim->main_loop != NULL && netsim->delay_probability > 0 &&
+  if (netsim->running && netsim->delay_probability > 0 &&
       g_rand_double (netsim->rand_seed) < netsim->delay_probability) {
     gint delay;
-    PushBufferCtx *ctx;
-    GSource *source;
+    DelayedPacket *packet;
+    GSequenceIter *iter;
     gint64 ready_time, now_time;
 
     switch (netsim->delay_distribution) {
@@ -360,9 +359,6 @@ gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
     if (delay < 0)
       delay = 0;
 
-    ctx = push_buffer_ctx_new (netsim->srcpad, buf);
-
-    source = g_source_new (&gst_net_sim_source_funcs, sizeof (GSource));
     now_time = g_get_monotonic_time ();
     ready_time = now_time + delay * 1000;
     if (!netsim->allow_reordering && ready_time < netsim->last_ready_time)
@@ -372,17 +368,25 @@ gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
     GST_DEBUG_OBJECT (netsim, "Delaying packet by %" G_GINT64_FORMAT "ms",
         (ready_time - now_time) / 1000);
 
-    g_source_set_ready_time (source, ready_time);
-    g_source_set_callback (source, (GSourceFunc) push_buffer_ctx_push,
-        ctx, (GDestroyNotify) push_buffer_ctx_free);
-    g_source_attach (source, g_main_loop_get_context (netsim->main_loop));
-    g_source_unref (source);
-  } else {
-    ret = gst_pad_push (netsim->srcpad, gst_buffer_ref (buf));
+    packet = g_slice_new (DelayedPacket);
+    packet->ready_time = ready_time;
+    packet->seqnum = netsim->delayed_seqnum++;
+    packet->buf = gst_buffer_ref (buf);
+
+    /* without reordering this always appends */
+    iter = g_sequence_insert_sorted (netsim->delayed_packets, packet,
+        (GCompareDataFunc) delayed_packet_compare, NULL);
+
+    /* the task only needs waking up if it now has to wake up earlier */
+    if (g_sequence_iter_is_begin (iter))
+      g_cond_signal (&netsim->delay_cond);
+    g_mutex_unlock (&netsim->loop_mutex);
+
+    return GST_FLOW_OK;
   }
   g_mutex_unlock (&netsim->loop_mutex);
 
-  return ret;
+  return gst_pad_push (netsim->srcpad, gst_buffer_ref (buf));
 }
 
 static gint
@@ -602,9 +606,10 @@ gst_net_sim_init (GstNetSim * netsim)
   gst_element_add_pad (GST_ELEMENT (netsim), netsim->sinkpad);
 
   g_mutex_init (&netsim->loop_mutex);
-  g_cond_init (&netsim->start_cond);
+  g_cond_init (&netsim->delay_cond);
+  netsim->delayed_packets =
+      g_sequence_new ((GDestroyNotify) delayed_packet_free);
   netsim->rand_seed = g_rand_new ();
-  netsim->main_loop = NULL;
   netsim->prev_time = GST_CLOCK_TIME_NONE;
 
   GST_OBJECT_FLAG_SET (netsim->sinkpad,
@@ -612,6 +617,8 @@ gst_net_sim_init (GstNetSim * netsim)
 
   gst_pad_set_chain_function (netsim->sinkpad,
       GST_DEBUG_FUNCPTR (gst_net_sim_chain));
+  gst_pad_set_event_function (netsim->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_net_sim_sink_event));
   gst_pad_set_activatemode_function (netsim->srcpad,
       GST_DEBUG_FUNCPTR (gst_net_sim_src_activatemode));
 }
@@ -622,8 +629,9 @@ gst_net_sim_finalize (GObject * object)
   GstNetSim *netsim = GST_NET_SIM (object);
 
   g_rand_free (netsim->rand_seed);
+  g_sequence_free (netsim->delayed_packets);
   g_mutex_clear (&netsim->loop_mutex);
-  g_cond_clear (&netsim->start_cond);
+  g_cond_clear (&netsim->delay_cond);
 
   G_OBJECT_CLASS (gst_net_sim_parent_class)->finalize (object);
 }
@@ -633,7 +641,7 @@ gst_net_sim_dispose (GObject * object)
 {
   GstNetSim *netsim = GST_NET_SIM (object);
 
-  g_assert (netsim->main_loop == NULL);
+  g_assert (!netsim->running);
 
   G_OBJECT_CLASS (gst_net_sim_parent_class)->dispose (object);
 }
@@ -67,9 +67,12 @@ struct _GstNetSim
   GstPad *sinkpad;
   GstPad *srcpad;
 
+  /* the delayed packets, sorted by the time they are due, are pushed from
+   * the srcpad task */
   GMutex loop_mutex;
-  GCond start_cond;
-  GMainLoop *main_loop;
+  GCond delay_cond;
+  GSequence *delayed_packets;
+  guint64 delayed_seqnum;
   gboolean running;
   GRand *rand_seed;
   gsize bucket_size;
@@ -33,6 +33,14 @@
  * ]| Read from a pcap dump file using filesrc, extract the raw UDP packets,
  * depayload and decode them.
  *
+ * |[
+ * gst-launch-1.0 filesrc location=headend.pcap blocksize=1048576 !
+ * pcapparse split-flows=true pace=true name=p
+ * p.src_udp_10.0.0.1_5000_239.1.1.1_1234 ! queue ! tsdemux ! fakesink
+ * p.src_udp_10.0.0.1_5000_239.1.1.2_1234 ! queue ! tsdemux ! fakesink
+ * ]| Replay two multicast flows of a capture at the original capture timing,
+ * each on its own pad.
+ *
  */
 
 /* TODO:
@@ -70,9 +78,34 @@ enum
   PROP_SRC_PORT,
   PROP_DST_PORT,
   PROP_CAPS,
-  PROP_TS_OFFSET
+  PROP_TS_OFFSET,
+  PROP_SPLIT_FLOWS,
+  PROP_PACE
 };
 
+#define DEFAULT_SPLIT_FLOWS FALSE
+#define DEFAULT_PACE FALSE
+
+/* in pace mode, payloads captured within this window of each other are
+ * pushed together */
+#define PACE_WINDOW (1 * GST_MSECOND)
+
+typedef struct
+{
+  guint32 src_ip;
+  guint32 dst_ip;
+  guint16 src_port;
+  guint16 dst_port;
+  guint8 protocol;
+} GstPcapParseFlowKey;
+
+typedef struct
+{
+  GstPcapParseFlowKey key;
+  GstPad *pad;
+  GstBufferList *pending;
+} GstPcapParseFlow;
+
 GST_DEBUG_CATEGORY_STATIC (gst_pcap_parse_debug);
 #define GST_CAT_DEFAULT gst_pcap_parse_debug
 
@@ -86,6 +119,12 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate src_flow_template =
+GST_STATIC_PAD_TEMPLATE ("src_%s",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS_ANY);
+
 static void gst_pcap_parse_finalize (GObject * object);
 static void gst_pcap_parse_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
@@ -95,6 +134,8 @@ static GstStateChangeReturn
 gst_pcap_parse_change_state (GstElement * element, GstStateChange transition);
 
 static void gst_pcap_parse_reset (GstPcapParse * self);
+static void gst_pcap_parse_clear_pending (GstPcapParse * self);
+static void gst_pcap_parse_remove_flows (GstPcapParse * self);
 
 static GstFlowReturn gst_pcap_parse_chain (GstPad * pad,
     GstObject * parent, GstBuffer * buffer);
@@ -145,8 +186,39 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
           "Relative timestamp offset (ns) to apply (-1 = use absolute packet time)",
           -1, G_MAXINT64, -1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstPcapParse:split-flows:
+   *
+   * Output the payloads of each UDP or TCP flow, identified by protocol,
+   * addresses and ports, on its own sometimes pad named
+   * src_<protocol>_<source ip>_<source port>_<destination ip>_<destination port>
+   * instead of on the src pad. The address and port filters still apply.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SPLIT_FLOWS,
+      g_param_spec_boolean ("split-flows", "Split flows",
+          "Output each flow on its own pad", DEFAULT_SPLIT_FLOWS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstPcapParse:pace:
+   *
+   * Push the payloads at the pace they were captured at, in buffer lists
+   * covering one millisecond of capture time each, instead of as fast as
+   * they are parsed.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PACE,
+      g_param_spec_boolean ("pace", "Pace",
+          "Push payloads at the original capture timing", DEFAULT_PACE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (element_class, &sink_template);
   gst_element_class_add_static_pad_template (element_class, &src_template);
+  gst_element_class_add_static_pad_template (element_class,
+      &src_flow_template);
 
   element_class->change_state = gst_pcap_parse_change_state;
 
@@ -158,6 +230,38 @@ gst_pcap_parse_class_init (GstPcapParseClass * klass)
   GST_DEBUG_CATEGORY_INIT (gst_pcap_parse_debug, "pcapparse", 0, "pcap parser");
 }
 
+static guint
+gst_pcap_parse_flow_key_hash (gconstpointer data)
+{
+  const GstPcapParseFlowKey *key = data;
+
+  return key->src_ip ^ (key->dst_ip * 31) ^
+      ((key->src_port << 16 | key->dst_port) * 17) ^ key->protocol;
+}
+
+static gboolean
+gst_pcap_parse_flow_key_equal (gconstpointer a, gconstpointer b)
+{
+  const GstPcapParseFlowKey *key_a = a;
+  const GstPcapParseFlowKey *key_b = b;
+
+  return key_a->src_ip == key_b->src_ip && key_a->dst_ip == key_b->dst_ip &&
+      key_a->src_port == key_b->src_port &&
+      key_a->dst_port == key_b->dst_port &&
+      key_a->protocol == key_b->protocol;
+}
+
+static void
+gst_pcap_parse_flow_free (gpointer data)
+{
+  GstPcapParseFlow *flow = data;
+
+  /* the pad is owned by the element */
+  if (flow->pending)
+    gst_buffer_list_unref (flow->pending);
+  g_slice_free (GstPcapParseFlow, flow);
+}
+
 static void
 gst_pcap_parse_init (GstPcapParse * self)
 {
@@ -178,8 +282,14 @@ gst_pcap_parse_init (GstPcapParse * self)
   self->src_port = -1;
   self->dst_port = -1;
   self->offset = -1;
+  self->split_flows = DEFAULT_SPLIT_FLOWS;
+  self->pace = DEFAULT_PACE;
 
   self->adapter = gst_adapter_new ();
+  self->flows = g_hash_table_new_full (gst_pcap_parse_flow_key_hash,
+      gst_pcap_parse_flow_key_equal, NULL, gst_pcap_parse_flow_free);
+  self->flowcombiner = gst_flow_combiner_new ();
+  self->pending_flows = g_ptr_array_new ();
 
   gst_pcap_parse_reset (self);
 }
@@ -190,6 +300,9 @@ gst_pcap_parse_finalize (GObject * object)
   GstPcapParse *self = GST_PCAP_PARSE (object);
 
   g_object_unref (self->adapter);
+  g_hash_table_unref (self->flows);
+  gst_flow_combiner_free (self->flowcombiner);
+  g_ptr_array_unref (self->pending_flows);
   if (self->caps)
     gst_caps_unref (self->caps);
 
@@ -251,6 +364,14 @@ gst_pcap_parse_get_property (GObject * object, guint prop_id,
       g_value_set_int64 (value, self->offset);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      g_value_set_boolean (value, self->split_flows);
+      break;
+
+    case PROP_PACE:
+      g_value_set_boolean (value, self->pace);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -305,6 +426,14 @@ gst_pcap_parse_set_property (GObject * object, guint prop_id,
       self->offset = g_value_get_int64 (value);
       break;
 
+    case PROP_SPLIT_FLOWS:
+      self->split_flows = g_value_get_boolean (value);
+      break;
+
+    case PROP_PACE:
+      self->pace = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -323,6 +452,46 @@ gst_pcap_parse_reset (GstPcapParse * self)
   self->newsegment_sent = FALSE;
 
   gst_adapter_clear (self->adapter);
+  gst_pcap_parse_clear_pending (self);
+  gst_flow_combiner_reset (self->flowcombiner);
+
+  GST_OBJECT_LOCK (self);
+  self->pace_epoch = GST_CLOCK_TIME_NONE;
+  self->pace_base = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+gst_pcap_parse_clear_pending (GstPcapParse * self)
+{
+  if (self->pending) {
+    gst_buffer_list_unref (self->pending);
+    self->pending = NULL;
+  }
+  while (self->pending_flows->len > 0) {
+    GstPcapParseFlow *flow = g_ptr_array_index (self->pending_flows,
+        self->pending_flows->len - 1);
+
+    gst_buffer_list_unref (flow->pending);
+    flow->pending = NULL;
+    g_ptr_array_remove_index (self->pending_flows,
+        self->pending_flows->len - 1);
+  }
+  self->pending_ts = GST_CLOCK_TIME_NONE;
+}
+
+static void
+gst_pcap_parse_remove_flows (GstPcapParse * self)
+{
+  GHashTableIter iter;
+  GstPcapParseFlow *flow;
+
+  g_hash_table_iter_init (&iter, self->flows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & flow)) {
+    gst_flow_combiner_remove_pad (self->flowcombiner, flow->pad);
+    gst_element_remove_pad (GST_ELEMENT_CAST (self), flow->pad);
+  }
+  g_hash_table_remove_all (self->flows);
 }
 
 static guint32
@@ -355,7 +524,8 @@ gst_pcap_parse_read_uint32 (GstPcapParse * self, const guint8 * p)
 static gboolean
 gst_pcap_parse_scan_frame (GstPcapParse * self,
     const guint8 * buf,
-    gint buf_size, const guint8 ** payload, gint * payload_size)
+    gint buf_size, const guint8 ** payload, gint * payload_size,
+    GstPcapParseFlowKey * key)
 {
   const guint8 *buf_ip = 0;
   const guint8 *buf_proto;
@@ -470,15 +640,200 @@ gst_pcap_parse_scan_frame (GstPcapParse * self,
   if (self->dst_port >= 0 && dst_port != self->dst_port)
     return FALSE;
 
+  key->src_ip = ip_src_addr;
+  key->dst_ip = ip_dst_addr;
+  key->src_port = src_port;
+  key->dst_port = dst_port;
+  key->protocol = ip_protocol;
+
   return TRUE;
 }
 
+static void
+gst_pcap_parse_push_segment (GstPcapParse * self, GstPad * pad)
+{
+  GstSegment segment;
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  segment.start = self->base_ts;
+  gst_pad_push_event (pad, gst_event_new_segment (&segment));
+}
+
+static GstPcapParseFlow *
+gst_pcap_parse_get_flow (GstPcapParse * self, const GstPcapParseFlowKey * key)
+{
+  GstPcapParseFlow *flow;
+  const guint8 *src = (const guint8 *) &key->src_ip;
+  const guint8 *dst = (const guint8 *) &key->dst_ip;
+  gchar *name, *stream_id;
+
+  flow = g_hash_table_lookup (self->flows, key);
+  if (flow)
+    return flow;
+
+  /* addresses are in network byte order */
+  name = g_strdup_printf ("src_%s_%u.%u.%u.%u_%u_%u.%u.%u.%u_%u",
+      key->protocol == IP_PROTO_UDP ? "udp" : "tcp",
+      src[0], src[1], src[2], src[3], key->src_port,
+      dst[0], dst[1], dst[2], dst[3], key->dst_port);
+
+  GST_DEBUG_OBJECT (self, "new flow %s", name);
+
+  flow = g_slice_new0 (GstPcapParseFlow);
+  flow->key = *key;
+  flow->pad = gst_pad_new_from_static_template (&src_flow_template, name);
+  gst_pad_use_fixed_caps (flow->pad);
+  gst_pad_set_active (flow->pad, TRUE);
+
+  stream_id = gst_pad_create_stream_id (flow->pad, GST_ELEMENT_CAST (self),
+      name + strlen ("src_"));
+  gst_pad_push_event (flow->pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+  if (self->caps)
+    gst_pad_set_caps (flow->pad, self->caps);
+  gst_pcap_parse_push_segment (self, flow->pad);
+
+  gst_element_add_pad (GST_ELEMENT_CAST (self), flow->pad);
+  gst_flow_combiner_add_pad (self->flowcombiner, flow->pad);
+  g_hash_table_insert (self->flows, &flow->key, flow);
+  g_free (name);
+
+  return flow;
+}
+
+/* Waits until the time at which the payload captured at @capture_ts was
+ * captured, relative to the first payload that was paced */
+static GstFlowReturn
+gst_pcap_parse_pace (GstPcapParse * self, GstClockTime capture_ts)
+{
+  GstClock *clock;
+  GstClockID id;
+  GstClockReturn cret;
+
+  GST_OBJECT_LOCK (self);
+  if (self->flushing) {
+    GST_OBJECT_UNLOCK (self);
+    return GST_FLOW_FLUSHING;
+  }
+
+  clock = GST_ELEMENT_CLOCK (self);
+  if (clock)
+    gst_object_ref (clock);
+  else
+    clock = gst_system_clock_obtain ();
+
+  if (!GST_CLOCK_TIME_IS_VALID (self->pace_epoch)) {
+    self->pace_epoch = gst_clock_get_time (clock);
+    self->pace_base = capture_ts;
+  }
+
+  if (capture_ts <= self->pace_base) {
+    GST_OBJECT_UNLOCK (self);
+    gst_object_unref (clock);
+    return GST_FLOW_OK;
+  }
+
+  id = self->clock_id = gst_clock_new_single_shot_id (clock,
+      self->pace_epoch + capture_ts - self->pace_base);
+  GST_OBJECT_UNLOCK (self);
+
+  cret = gst_clock_id_wait (id, NULL);
+
+  GST_OBJECT_LOCK (self);
+  self->clock_id = NULL;
+  gst_clock_id_unref (id);
+  if (self->flushing)
+    cret = GST_CLOCK_UNSCHEDULED;
+  GST_OBJECT_UNLOCK (self);
+  gst_object_unref (clock);
+
+  return cret == GST_CLOCK_UNSCHEDULED ? GST_FLOW_FLUSHING : GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_pcap_parse_push_pending (GstPcapParse * self)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i;
+
+  if (self->pace && GST_CLOCK_TIME_IS_VALID (self->pending_ts)) {
+    ret = gst_pcap_parse_pace (self, self->pending_ts);
+    if (ret != GST_FLOW_OK) {
+      gst_pcap_parse_clear_pending (self);
+      return ret;
+    }
+  }
+
+  if (self->pending) {
+    if (!self->newsegment_sent && GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
+      if (self->caps)
+        gst_pad_set_caps (self->src_pad, self->caps);
+      gst_pcap_parse_push_segment (self, self->src_pad);
+      self->newsegment_sent = TRUE;
+    }
+
+    ret = gst_pad_push_list (self->src_pad, self->pending);
+    self->pending = NULL;
+  }
+
+  for (i = 0; i < self->pending_flows->len; i++) {
+    GstPcapParseFlow *flow = g_ptr_array_index (self->pending_flows, i);
+    GstFlowReturn flow_ret;
+
+    flow_ret = gst_pad_push_list (flow->pad, flow->pending);
+    flow->pending = NULL;
+    ret = gst_flow_combiner_update_pad_flow (self->flowcombiner, flow->pad,
+        flow_ret);
+  }
+  g_ptr_array_set_size (self->pending_flows, 0);
+  self->pending_ts = GST_CLOCK_TIME_NONE;
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_pcap_parse_queue_buffer (GstPcapParse * self,
+    const GstPcapParseFlowKey * key, GstClockTime capture_ts, GstBuffer * buf)
+{
+  gboolean have_pending = self->pending || self->pending_flows->len > 0;
+
+  if (have_pending && self->pace && GST_CLOCK_TIME_IS_VALID (capture_ts) &&
+      GST_CLOCK_TIME_IS_VALID (self->pending_ts) &&
+      capture_ts >= self->pending_ts + PACE_WINDOW) {
+    GstFlowReturn ret = gst_pcap_parse_push_pending (self);
+
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (buf);
+      return ret;
+    }
+    have_pending = FALSE;
+  }
+
+  if (!have_pending)
+    self->pending_ts = capture_ts;
+
+  if (self->split_flows) {
+    GstPcapParseFlow *flow = gst_pcap_parse_get_flow (self, key);
+
+    if (flow->pending == NULL) {
+      flow->pending = gst_buffer_list_new ();
+      g_ptr_array_add (self->pending_flows, flow);
+    }
+    gst_buffer_list_add (flow->pending, buf);
+  } else {
+    if (self->pending == NULL)
+      self->pending = gst_buffer_list_new ();
+    gst_buffer_list_add (self->pending, buf);
+  }
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
   GstPcapParse *self = GST_PCAP_PARSE (parent);
   GstFlowReturn ret = GST_FLOW_OK;
-  GstBufferList *list = NULL;
 
   gst_adapter_push (self->adapter, buffer);
 
@@ -496,6 +851,7 @@ gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
         if (self->cur_packet_size > 0) {
           const guint8 *payload_data;
           gint payload_size;
+          GstPcapParseFlowKey key;
 
           data = gst_adapter_map (self->adapter, self->cur_packet_size);
 
@@ -503,8 +859,9 @@ gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
               self->cur_packet_size);
 
           if (gst_pcap_parse_scan_frame (self, data, self->cur_packet_size,
-                  &payload_data, &payload_size)) {
+                  &payload_data, &payload_size, &key)) {
             GstBuffer *out_buf;
+            GstClockTime capture_ts = self->cur_ts;
             guintptr offset = payload_data - data;
 
             gst_adapter_unmap (self->adapter);
@@ -531,10 +888,8 @@ gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
             }
             GST_BUFFER_TIMESTAMP (out_buf) = self->cur_ts;
 
-
-            if (list == NULL)
-              list = gst_buffer_list_new ();
-            gst_buffer_list_add (list, out_buf);
+            ret = gst_pcap_parse_queue_buffer (self, &key, capture_ts,
+                out_buf);
           } else {
             gst_adapter_unmap (self->adapter);
             gst_adapter_flush (self->adapter, self->cur_packet_size);
@@ -623,27 +978,11 @@ gst_pcap_parse_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     }
   }
 
-  if (list) {
-    if (!self->newsegment_sent && GST_CLOCK_TIME_IS_VALID (self->cur_ts)) {
-      GstSegment segment;
-
-      if (self->caps)
-        gst_pad_set_caps (self->src_pad, self->caps);
-      gst_segment_init (&segment, GST_FORMAT_TIME);
-      segment.start = self->base_ts;
-      gst_pad_push_event (self->src_pad, gst_event_new_segment (&segment));
-      self->newsegment_sent = TRUE;
-    }
-
-    ret = gst_pad_push_list (self->src_pad, list);
-    list = NULL;
-  }
+  if (ret == GST_FLOW_OK && (self->pending || self->pending_flows->len > 0))
+    ret = gst_pcap_parse_push_pending (self);
 
 out:
 
-  if (list)
-    gst_buffer_list_unref (list);
-
   return ret;
 }
 
@@ -658,10 +997,28 @@ gst_pcap_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       /* Drop it, we'll replace it with our own */
       gst_event_unref (event);
       break;
+    case GST_EVENT_FLUSH_START:
+      GST_OBJECT_LOCK (self);
+      self->flushing = TRUE;
+      if (self->clock_id)
+        gst_clock_id_unschedule (self->clock_id);
+      GST_OBJECT_UNLOCK (self);
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
     case GST_EVENT_FLUSH_STOP:
+      GST_OBJECT_LOCK (self);
+      self->flushing = FALSE;
+      GST_OBJECT_UNLOCK (self);
       gst_pcap_parse_reset (self);
       /* Push event down the pipeline so that other elements stop flushing */
-      /* fall through */
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
+    case GST_EVENT_EOS:
+      if (self->pending || self->pending_flows->len > 0)
+        gst_pcap_parse_push_pending (self);
+      /* the flow pads need EOS too */
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
     default:
       ret = gst_pad_push_event (self->src_pad, event);
       break;
@@ -676,11 +1033,30 @@ gst_pcap_parse_change_state (GstElement * element, GstStateChange transition)
   GstPcapParse *self = GST_PCAP_PARSE (element);
   GstStateChangeReturn ret;
 
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      GST_OBJECT_LOCK (self);
+      self->flushing = FALSE;
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* wake up the streaming thread if it is pacing */
+      GST_OBJECT_LOCK (self);
+      self->flushing = TRUE;
+      if (self->clock_id)
+        gst_clock_id_unschedule (self->clock_id);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      break;
+  }
+
   ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       gst_pcap_parse_reset (self);
+      gst_pcap_parse_remove_flows (self);
       break;
     default:
       break;
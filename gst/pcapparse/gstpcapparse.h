@@ -22,6 +22,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstadapter.h>
+#include <gst/base/gstflowcombiner.h>
 
 G_BEGIN_DECLS
 
@@ -73,6 +74,8 @@ struct _GstPcapParse
   gint32 dst_port;
   GstCaps *caps;
   gint64 offset;
+  gboolean split_flows;
+  gboolean pace;
 
   /* state */
   GstAdapter * adapter;
@@ -85,6 +88,22 @@ struct _GstPcapParse
   GstPcapParseLinktype linktype;
 
   gboolean newsegment_sent;
+
+  /* flow key -> GstPcapParseFlow, one sometimes pad per flow */
+  GHashTable *flows;
+  GstFlowCombiner *flowcombiner;
+
+  /* payloads collected for the next push, and the capture time of the
+   * first of them */
+  GstBufferList *pending;
+  GPtrArray *pending_flows;
+  GstClockTime pending_ts;
+
+  /* pacing, protected by the object lock */
+  gboolean flushing;
+  GstClockID clock_id;
+  GstClockTime pace_epoch;
+  GstClockTime pace_base;
 };
 
 struct _GstPcapParseClass
@@ -30,6 +30,13 @@
  *
  * This element also copies sticky events onto the matching proxysrc element.
  *
+ * Several proxysrc elements can be connected to the same proxysink. Each of
+ * them gets a reference to every buffer, so the buffers are shared and not
+ * copied. The flow return of one proxysrc does not affect the others; set
+ * #GstProxySrc:leaky on a proxysrc so that a slow pipeline does not block the
+ * proxysink and all other proxysrc elements. Queries are answered by the
+ * first proxysrc that handles them.
+ *
  * For example usage, see proxysrc.
  */
 
@@ -66,14 +73,18 @@ static gboolean gst_proxy_sink_sink_event (GstPad * pad, GstObject * parent,
 
 static GstStateChangeReturn gst_proxy_sink_change_state (GstElement * element,
     GstStateChange transition);
+static void gst_proxy_sink_finalize (GObject * object);
 
 static void
 gst_proxy_sink_class_init (GstProxySinkClass * klass)
 {
+  GObjectClass *gobject_class = (GObjectClass *) klass;
   GstElementClass *gstelement_class = (GstElementClass *) klass;
 
   GST_DEBUG_CATEGORY_INIT (gst_proxy_sink_debug, "proxysink", 0, "proxy sink");
 
+  gobject_class->finalize = gst_proxy_sink_finalize;
+
   gstelement_class->change_state = gst_proxy_sink_change_state;
 
   gst_element_class_add_pad_template (gstelement_class,
@@ -99,6 +110,47 @@ gst_proxy_sink_init (GstProxySink * self)
   gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
 }
 
+static void
+free_proxysrc_ref (GWeakRef * ref)
+{
+  g_weak_ref_clear (ref);
+  g_slice_free (GWeakRef, ref);
+}
+
+static void
+gst_proxy_sink_finalize (GObject * object)
+{
+  GstProxySink *self = GST_PROXY_SINK (object);
+
+  g_list_free_full (self->proxysrcs, (GDestroyNotify) free_proxysrc_ref);
+
+  G_OBJECT_CLASS (gst_proxy_sink_parent_class)->finalize (object);
+}
+
+/* Returns a list with a reference to each connected proxysrc, and forgets the
+ * ones that are gone */
+static GList *
+gst_proxy_sink_ref_proxysrcs (GstProxySink * self)
+{
+  GList *l, *next, *srcs = NULL;
+
+  GST_OBJECT_LOCK (self);
+  for (l = self->proxysrcs; l; l = next) {
+    GstProxySrc *src = g_weak_ref_get (l->data);
+
+    next = l->next;
+    if (src) {
+      srcs = g_list_prepend (srcs, src);
+    } else {
+      free_proxysrc_ref (l->data);
+      self->proxysrcs = g_list_delete_link (self->proxysrcs, l);
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return g_list_reverse (srcs);
+}
+
 static GstStateChangeReturn
 gst_proxy_sink_change_state (GstElement * element, GstStateChange transition)
 {
@@ -108,9 +160,15 @@ gst_proxy_sink_change_state (GstElement * element, GstStateChange transition)
   GstStateChangeReturn ret;
 
   switch (transition) {
-    case GST_STATE_CHANGE_READY_TO_PAUSED:
-      self->pending_sticky_events = FALSE;
+    case GST_STATE_CHANGE_READY_TO_PAUSED:{
+      GList *srcs, *l;
+
+      srcs = gst_proxy_sink_ref_proxysrcs (self);
+      for (l = srcs; l; l = l->next)
+        GST_PROXY_SRC (l->data)->pending_sticky_events = FALSE;
+      g_list_free_full (srcs, gst_object_unref);
       break;
+    }
     default:
       break;
   }
@@ -124,21 +182,21 @@ static gboolean
 gst_proxy_sink_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
 {
   GstProxySink *self = GST_PROXY_SINK (parent);
-  GstProxySrc *src;
+  GList *srcs, *l;
   gboolean ret = FALSE;
 
   GST_LOG_OBJECT (pad, "Handling query of type '%s'",
       gst_query_type_get_name (GST_QUERY_TYPE (query)));
 
-  src = g_weak_ref_get (&self->proxysrc);
-  if (src) {
+  srcs = gst_proxy_sink_ref_proxysrcs (self);
+  for (l = srcs; l && !ret; l = l->next) {
     GstPad *srcpad;
-    srcpad = gst_proxy_src_get_internal_srcpad (src);
+    srcpad = gst_proxy_src_get_internal_srcpad (l->data);
 
     ret = gst_pad_peer_query (srcpad, query);
     gst_object_unref (srcpad);
-    gst_object_unref (src);
   }
+  g_list_free_full (srcs, gst_object_unref);
 
   return ret;
 }
@@ -160,41 +218,55 @@ copy_sticky_events (G_GNUC_UNUSED GstPad * pad, GstEvent ** event,
   return data->ret == GST_FLOW_OK;
 }
 
+static void
+gst_proxy_sink_copy_sticky_events (GstPad * pad, GstProxySrc * src,
+    GstPad * srcpad)
+{
+  CopyStickyEventsData data = { srcpad, GST_FLOW_OK };
+
+  if (!src->pending_sticky_events)
+    return;
+
+  gst_pad_sticky_events_foreach (pad, copy_sticky_events, &data);
+  src->pending_sticky_events = data.ret != GST_FLOW_OK;
+}
+
 static gboolean
 gst_proxy_sink_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
   GstProxySink *self = GST_PROXY_SINK (parent);
-  GstProxySrc *src;
+  GList *srcs, *l;
   gboolean ret = FALSE;
   gboolean sticky = GST_EVENT_IS_STICKY (event);
 
   GST_LOG_OBJECT (pad, "Got %s event", GST_EVENT_TYPE_NAME (event));
 
-  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
-    self->pending_sticky_events = FALSE;
-
-  src = g_weak_ref_get (&self->proxysrc);
-  if (src) {
+  srcs = gst_proxy_sink_ref_proxysrcs (self);
+  for (l = srcs; l; l = l->next) {
+    GstProxySrc *src = l->data;
     GstPad *srcpad;
+    gboolean res;
+
     srcpad = gst_proxy_src_get_internal_srcpad (src);
 
-    if (sticky && self->pending_sticky_events) {
-      CopyStickyEventsData data = { srcpad, GST_FLOW_OK };
+    if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+      src->pending_sticky_events = FALSE;
 
-      gst_pad_sticky_events_foreach (pad, copy_sticky_events, &data);
-      self->pending_sticky_events = data.ret != GST_FLOW_OK;
-    }
+    if (sticky)
+      gst_proxy_sink_copy_sticky_events (pad, src, srcpad);
 
-    ret = gst_pad_push_event (srcpad, event);
+    res = gst_pad_push_event (srcpad, gst_event_ref (event));
     gst_object_unref (srcpad);
-    gst_object_unref (src);
 
-    if (!ret && sticky) {
-      self->pending_sticky_events = TRUE;
-      ret = TRUE;
+    if (!res && sticky) {
+      src->pending_sticky_events = TRUE;
+      res = TRUE;
     }
-  } else
-    gst_event_unref (event);
+    ret |= res;
+  }
+  g_list_free_full (srcs, gst_object_unref);
+
+  gst_event_unref (event);
 
   return ret;
 }
@@ -203,33 +275,39 @@ static GstFlowReturn
 gst_proxy_sink_sink_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
   GstProxySink *self = GST_PROXY_SINK (parent);
-  GstProxySrc *src;
-  GstFlowReturn ret = GST_FLOW_OK;
+  GList *srcs, *l;
+  GstFlowReturn ret;
 
   GST_LOG_OBJECT (pad, "Chaining buffer %p", buffer);
 
-  src = g_weak_ref_get (&self->proxysrc);
-  if (src) {
+  srcs = gst_proxy_sink_ref_proxysrcs (self);
+  if (!srcs)
+    GST_LOG_OBJECT (pad, "Dropped buffer %p: no otherpad", buffer);
+
+  /* Every proxysrc gets its own reference to the buffer and its own flow
+   * return, one of them failing does not stop the others */
+  for (l = srcs; l; l = l->next) {
+    GstProxySrc *src = l->data;
     GstPad *srcpad;
+
     srcpad = gst_proxy_src_get_internal_srcpad (src);
 
-    if (self->pending_sticky_events) {
-      CopyStickyEventsData data = { srcpad, GST_FLOW_OK };
+    gst_proxy_sink_copy_sticky_events (pad, src, srcpad);
 
-      gst_pad_sticky_events_foreach (pad, copy_sticky_events, &data);
-      self->pending_sticky_events = data.ret != GST_FLOW_OK;
-    }
-
-    ret = gst_pad_push (srcpad, buffer);
+    ret = gst_pad_push (srcpad, gst_buffer_ref (buffer));
     gst_object_unref (srcpad);
-    gst_object_unref (src);
 
-    GST_LOG_OBJECT (pad, "Chained buffer %p: %s", buffer,
-        gst_flow_get_name (ret));
-  } else {
-    gst_buffer_unref (buffer);
-    GST_LOG_OBJECT (pad, "Dropped buffer %p: no otherpad", buffer);
+    /* The sticky events were lost if the proxysrc was flushing, send them
+     * again once it is back */
+    if (ret == GST_FLOW_FLUSHING)
+      src->pending_sticky_events = TRUE;
+
+    GST_LOG_OBJECT (pad, "Chained buffer %p to %" GST_PTR_FORMAT ": %s",
+        buffer, src, gst_flow_get_name (ret));
   }
+  g_list_free_full (srcs, gst_object_unref);
+
+  gst_buffer_unref (buffer);
 
   return GST_FLOW_OK;
 }
@@ -239,32 +317,35 @@ gst_proxy_sink_sink_chain_list (GstPad * pad, GstObject * parent,
     GstBufferList * list)
 {
   GstProxySink *self = GST_PROXY_SINK (parent);
-  GstProxySrc *src;
-  GstFlowReturn ret = GST_FLOW_OK;
+  GList *srcs, *l;
+  GstFlowReturn ret;
 
   GST_LOG_OBJECT (pad, "Chaining buffer list %p", list);
 
-  src = g_weak_ref_get (&self->proxysrc);
-  if (src) {
+  srcs = gst_proxy_sink_ref_proxysrcs (self);
+  if (!srcs)
+    GST_LOG_OBJECT (pad, "Dropped buffer list %p: no otherpad", list);
+
+  for (l = srcs; l; l = l->next) {
+    GstProxySrc *src = l->data;
     GstPad *srcpad;
-    srcpad = gst_proxy_src_get_internal_srcpad (src);
 
-    if (self->pending_sticky_events) {
-      CopyStickyEventsData data = { srcpad, GST_FLOW_OK };
+    srcpad = gst_proxy_src_get_internal_srcpad (src);
 
-      gst_pad_sticky_events_foreach (pad, copy_sticky_events, &data);
-      self->pending_sticky_events = data.ret != GST_FLOW_OK;
-    }
+    gst_proxy_sink_copy_sticky_events (pad, src, srcpad);
 
-    ret = gst_pad_push_list (srcpad, list);
+    ret = gst_pad_push_list (srcpad, gst_buffer_list_ref (list));
     gst_object_unref (srcpad);
-    gst_object_unref (src);
-    GST_LOG_OBJECT (pad, "Chained buffer list %p: %s", list,
-        gst_flow_get_name (ret));
-  } else {
-    gst_buffer_list_unref (list);
-    GST_LOG_OBJECT (pad, "Dropped buffer list %p: no otherpad", list);
+
+    if (ret == GST_FLOW_FLUSHING)
+      src->pending_sticky_events = TRUE;
+
+    GST_LOG_OBJECT (pad, "Chained buffer list %p to %" GST_PTR_FORMAT ": %s",
+        list, src, gst_flow_get_name (ret));
   }
+  g_list_free_full (srcs, gst_object_unref);
+
+  gst_buffer_list_unref (list);
 
   return GST_FLOW_OK;
 }
@@ -279,9 +360,66 @@ gst_proxy_sink_get_internal_sinkpad (GstProxySink * self)
   return gst_object_ref (self->sinkpad);
 }
 
+/* Call with the object lock held. The references to the proxysrcs looked at
+ * are added to refs, to be dropped after unlocking as that can dispose a
+ * proxysrc which then removes itself. */
+static GList *
+gst_proxy_sink_find_proxysrc_unlocked (GstProxySink * self,
+    GstProxySrc * src, GList ** refs)
+{
+  GList *l;
+
+  for (l = self->proxysrcs; l; l = l->next) {
+    GstProxySrc *tmp = g_weak_ref_get (l->data);
+
+    if (tmp)
+      *refs = g_list_prepend (*refs, tmp);
+    if (tmp == src)
+      return l;
+  }
+
+  return NULL;
+}
+
+void
+gst_proxy_sink_add_proxysrc (GstProxySink * self, GstProxySrc * src)
+{
+  GList *refs = NULL;
+
+  g_return_if_fail (self);
+  g_return_if_fail (src);
+
+  GST_OBJECT_LOCK (self);
+  if (!gst_proxy_sink_find_proxysrc_unlocked (self, src, &refs)) {
+    GWeakRef *ref;
+
+    /* A proxysrc connected while streaming needs the current sticky events */
+    src->pending_sticky_events = TRUE;
+
+    ref = g_slice_new0 (GWeakRef);
+    g_weak_ref_init (ref, src);
+    self->proxysrcs = g_list_append (self->proxysrcs, ref);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  g_list_free_full (refs, gst_object_unref);
+}
+
 void
-gst_proxy_sink_set_proxysrc (GstProxySink * self, GstProxySrc * src)
+gst_proxy_sink_remove_proxysrc (GstProxySink * self, GstProxySrc * src)
 {
+  GList *l, *refs = NULL;
+
   g_return_if_fail (self);
-  g_weak_ref_set (&self->proxysrc, src);
+  g_return_if_fail (src);
+
+  GST_OBJECT_LOCK (self);
+  l = gst_proxy_sink_find_proxysrc_unlocked (self, src, &refs);
+  if (l) {
+    free_proxysrc_ref (l->data);
+    self->proxysrcs = g_list_delete_link (self->proxysrcs, l);
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  g_list_free_full (refs, gst_object_unref);
 }
@@ -43,11 +43,9 @@ struct _GstProxySink {
   /* < private > */
   GstPad *sinkpad;
 
-  /* The proxysrc that we push events, buffers, queries to */
-  GWeakRef proxysrc;
-
-  /* Whether there are sticky events pending */
-  gboolean pending_sticky_events;
+  /* The proxysrcs that we push events, buffers, queries to, list of
+   * GstProxySinkConsumer protected by the object lock */
+  GList *proxysrcs;
 };
 
 struct _GstProxySinkClass {
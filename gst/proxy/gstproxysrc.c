@@ -32,6 +32,12 @@
  * so everything downstream is properly decoupled from the upstream pipeline.
  * However, the queue may get filled up if the downstream pipeline does not
  * accept buffers quickly enough; perhaps because it is not yet PLAYING.
+ * The queue then blocks the upstream pipeline, unless #GstProxySrc:leaky is
+ * set.
+ *
+ * Several proxysrc elements can be connected to the same proxysink, each one
+ * with its own queue. Making them leaky keeps a slow consumer from holding up
+ * the others.
  *
  * ## Usage
  * 
@@ -91,8 +97,38 @@ enum
 {
   PROP_0,
   PROP_PROXYSINK,
+  PROP_LEAKY,
+  PROP_MAX_SIZE_BUFFERS,
+  PROP_MAX_SIZE_BYTES,
+  PROP_MAX_SIZE_TIME
 };
 
+/* Same as the queue element */
+#define DEFAULT_LEAKY GST_PROXY_SRC_LEAKY_NONE
+#define DEFAULT_MAX_SIZE_BUFFERS 200
+#define DEFAULT_MAX_SIZE_BYTES (10 * 1024 * 1024)
+#define DEFAULT_MAX_SIZE_TIME GST_SECOND
+
+#define GST_TYPE_PROXY_SRC_LEAKY (gst_proxy_src_leaky_get_type ())
+static GType
+gst_proxy_src_leaky_get_type (void)
+{
+  static GType leaky_type = 0;
+  static const GEnumValue leaky[] = {
+    {GST_PROXY_SRC_LEAKY_NONE, "Not Leaky", "no"},
+    {GST_PROXY_SRC_LEAKY_UPSTREAM, "Leaky on upstream (new buffers)",
+        "upstream"},
+    {GST_PROXY_SRC_LEAKY_DOWNSTREAM, "Leaky on downstream (old buffers)",
+        "downstream"},
+    {0, NULL, NULL},
+  };
+
+  if (!leaky_type) {
+    leaky_type = g_enum_register_static ("GstProxySrcLeaky", leaky);
+  }
+  return leaky_type;
+}
+
 /* We're not subclassing from basesrc because we don't want any of the special
  * handling it has for events/queries/etc. We just pass-through everything. */
 
@@ -120,6 +156,18 @@ gst_proxy_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_PROXYSINK:
       g_value_take_object (value, g_weak_ref_get (&self->proxysink));
       break;
+    case PROP_LEAKY:{
+      gint leaky;
+
+      g_object_get (self->queue, "leaky", &leaky, NULL);
+      g_value_set_enum (value, leaky);
+      break;
+    }
+    case PROP_MAX_SIZE_BUFFERS:
+    case PROP_MAX_SIZE_BYTES:
+    case PROP_MAX_SIZE_TIME:
+      g_object_get_property (G_OBJECT (self->queue), spec->name, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
       break;
@@ -131,27 +179,35 @@ gst_proxy_src_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * spec)
 {
   GstProxySrc *self = GST_PROXY_SRC (object);
-  GstProxySink *sink;
+  GstProxySink *sink, *old_sink;
 
   switch (prop_id) {
     case PROP_PROXYSINK:
       sink = g_value_dup_object (value);
-      if (sink == NULL) {
-        /* Unset proxysrc property on the existing proxysink to break the
-         * connection in that direction */
-        GstProxySink *old_sink = g_weak_ref_get (&self->proxysink);
-        if (old_sink) {
-          gst_proxy_sink_set_proxysrc (old_sink, NULL);
-          g_object_unref (old_sink);
-        }
-        g_weak_ref_set (&self->proxysink, NULL);
-      } else {
-        /* Set proxysrc property on the new proxysink to point to us */
-        gst_proxy_sink_set_proxysrc (sink, self);
+      /* Remove us from the existing proxysink to break the connection in
+       * that direction */
+      old_sink = g_weak_ref_get (&self->proxysink);
+      if (old_sink) {
+        gst_proxy_sink_remove_proxysrc (old_sink, self);
+        g_object_unref (old_sink);
+      }
+      if (sink) {
+        /* Add us to the proxysrcs of the new proxysink */
+        gst_proxy_sink_add_proxysrc (sink, self);
         g_weak_ref_set (&self->proxysink, sink);
         g_object_unref (sink);
+      } else {
+        g_weak_ref_set (&self->proxysink, NULL);
       }
       break;
+    case PROP_LEAKY:
+      g_object_set (self->queue, "leaky", g_value_get_enum (value), NULL);
+      break;
+    case PROP_MAX_SIZE_BUFFERS:
+    case PROP_MAX_SIZE_BYTES:
+    case PROP_MAX_SIZE_TIME:
+      g_object_set_property (G_OBJECT (self->queue), spec->name, value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, spec);
   }
@@ -174,6 +230,58 @@ gst_proxy_src_class_init (GstProxySrcClass * klass)
       g_param_spec_object ("proxysink", "Proxysink", "Matching proxysink",
           GST_TYPE_PROXY_SINK, G_PARAM_READWRITE));
 
+  /**
+   * GstProxySrc:leaky:
+   *
+   * Which buffers the internal queue drops when it is full, instead of
+   * blocking the proxysink and the other proxysrc elements connected to it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_LEAKY,
+      g_param_spec_enum ("leaky", "Leaky",
+          "Where the queue leaks, if at all", GST_TYPE_PROXY_SRC_LEAKY,
+          DEFAULT_LEAKY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:max-size-buffers:
+   *
+   * Max. number of buffers in the internal queue (0=disable).
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BUFFERS,
+      g_param_spec_uint ("max-size-buffers", "Max. size (buffers)",
+          "Max. number of buffers in the queue (0=disable)", 0, G_MAXUINT,
+          DEFAULT_MAX_SIZE_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:max-size-bytes:
+   *
+   * Max. amount of data in the internal queue (bytes, 0=disable).
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_BYTES,
+      g_param_spec_uint ("max-size-bytes", "Max. size (kB)",
+          "Max. amount of data in the queue (bytes, 0=disable)", 0, G_MAXUINT,
+          DEFAULT_MAX_SIZE_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstProxySrc:max-size-time:
+   *
+   * Max. amount of data in the internal queue (in ns, 0=disable).
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SIZE_TIME,
+      g_param_spec_uint64 ("max-size-time", "Max. size (ns)",
+          "Max. amount of data in the queue (in ns, 0=disable)", 0,
+          G_MAXUINT64, DEFAULT_MAX_SIZE_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_proxy_src_change_state;
   gst_element_class_add_pad_template (gstelement_class,
       gst_static_pad_template_get (&src_template));
@@ -232,6 +340,13 @@ static void
 gst_proxy_src_dispose (GObject * object)
 {
   GstProxySrc *self = GST_PROXY_SRC (object);
+  GstProxySink *sink;
+
+  sink = g_weak_ref_get (&self->proxysink);
+  if (sink) {
+    gst_proxy_sink_remove_proxysrc (sink, self);
+    gst_object_unref (sink);
+  }
 
   gst_object_unparent (GST_OBJECT (self->dummy_sinkpad));
   self->dummy_sinkpad = NULL;
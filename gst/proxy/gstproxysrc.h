@@ -37,6 +37,22 @@ typedef struct _GstProxySrc GstProxySrc;
 typedef struct _GstProxySrcClass GstProxySrcClass;
 typedef struct _GstProxySrcPrivate GstProxySrcPrivate;
 
+/**
+ * GstProxySrcLeaky:
+ * @GST_PROXY_SRC_LEAKY_NONE: Not leaky
+ * @GST_PROXY_SRC_LEAKY_UPSTREAM: Leaky on upstream (new buffers)
+ * @GST_PROXY_SRC_LEAKY_DOWNSTREAM: Leaky on downstream (old buffers)
+ *
+ * Buffers dropped by the internal queue of proxysrc when it is full.
+ *
+ * Since: 1.16
+ */
+typedef enum {
+  GST_PROXY_SRC_LEAKY_NONE,
+  GST_PROXY_SRC_LEAKY_UPSTREAM,
+  GST_PROXY_SRC_LEAKY_DOWNSTREAM
+} GstProxySrcLeaky;
+
 struct _GstProxySrc {
   GstBin parent;
 
@@ -56,6 +72,10 @@ struct _GstProxySrc {
 
   /* The matching proxysink; queries and events are sent to its sinkpad */
   GWeakRef proxysink;
+
+  /* Whether the proxysink has sticky events pending for us, only used from
+   * the proxysink streaming thread */
+  gboolean pending_sticky_events;
 };
 
 struct _GstProxySrcClass {
@@ -24,6 +24,15 @@
  *
  * Removes all silence periods from an audio stream, dropping silence buffers.
  *
+ * The voice activity detection runs on frames of
+ * #GstRemoveSilence:frame-duration and a buffer is considered silent when
+ * all of its frames are. Transitions
+ * between voice and silence can be posted as element messages and sent
+ * downstream as custom events, both carrying a "removesilence" structure
+ * with a "silence_detected" or "silence_finished" #G_TYPE_UINT64 field
+ * holding the timestamp of the transition. With remove=false this lets
+ * downstream elements split the stream without looking at the audio again.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -v -m filesrc location="audiofile" ! decodebin ! removesilence remove=true ! wavenc ! filesink location=without_audio.wav
@@ -45,6 +54,9 @@
 GST_DEBUG_CATEGORY_STATIC (gst_remove_silence_debug);
 #define GST_CAT_DEFAULT gst_remove_silence_debug
 #define DEFAULT_VAD_HYSTERESIS  480     /* 60 mseg */
+#define DEFAULT_FRAME_DURATION  0
+#define DEFAULT_SILENT          TRUE
+#define DEFAULT_BOUNDARY_EVENTS FALSE
 
 /* Filter signals and args */
 enum
@@ -57,7 +69,10 @@ enum
 {
   PROP_0,
   PROP_REMOVE,
-  PROP_HYSTERESIS
+  PROP_HYSTERESIS,
+  PROP_FRAME_DURATION,
+  PROP_SILENT,
+  PROP_BOUNDARY_EVENTS
 };
 
 
@@ -65,17 +80,17 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw, "
-        "format = (string) " GST_AUDIO_NE (S16) ", "
-        "layout = (string) interleaved, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) 1"));
+        "format = (string) { " GST_AUDIO_NE (S16) ", " GST_AUDIO_NE (F32)
+        " }, layout = (string) interleaved, "
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, MAX ]"));
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("audio/x-raw, "
-        "format = (string) " GST_AUDIO_NE (S16) ", "
-        "layout = (string) interleaved, "
-        "rate = (int) [ 1, MAX ], " "channels = (int) 1"));
+        "format = (string) { " GST_AUDIO_NE (S16) ", " GST_AUDIO_NE (F32)
+        " }, layout = (string) interleaved, "
+        "rate = (int) [ 1, MAX ], " "channels = (int) [ 1, MAX ]"));
 
 
 #define DEBUG_INIT(bla) \
@@ -90,6 +105,9 @@ static void gst_remove_silence_set_property (GObject * object, guint prop_id,
 static void gst_remove_silence_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
 
+static gboolean gst_remove_silence_start (GstBaseTransform * base);
+static gboolean gst_remove_silence_set_caps (GstBaseTransform * base,
+    GstCaps * incaps, GstCaps * outcaps);
 static GstFlowReturn gst_remove_silence_transform_ip (GstBaseTransform * base,
     GstBuffer * buf);
 static void gst_remove_silence_finalize (GObject * obj);
@@ -121,6 +139,24 @@ gst_remove_silence_class_init (GstRemoveSilenceClass * klass)
           "Set the hysteresis (on samples) used on the internal VAD",
           1, G_MAXUINT64, DEFAULT_VAD_HYSTERESIS, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_FRAME_DURATION,
+      g_param_spec_uint64 ("frame-duration", "Frame duration",
+          "Duration of the frames the VAD decides on, in nanoseconds "
+          "(0 = one frame per buffer)", 0, GST_SECOND,
+          DEFAULT_FRAME_DURATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SILENT,
+      g_param_spec_boolean ("silent", "Silent",
+          "Disable/enable bus message notifications for silence "
+          "detected/finished", DEFAULT_SILENT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BOUNDARY_EVENTS,
+      g_param_spec_boolean ("boundary-events", "Boundary events",
+          "Send custom downstream events for silence detected/finished",
+          DEFAULT_BOUNDARY_EVENTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_set_static_metadata (gstelement_class,
       "RemoveSilence",
       "Filter/Effect/Audio",
@@ -131,6 +167,10 @@ gst_remove_silence_class_init (GstRemoveSilenceClass * klass)
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
 
+  GST_BASE_TRANSFORM_CLASS (klass)->start =
+      GST_DEBUG_FUNCPTR (gst_remove_silence_start);
+  GST_BASE_TRANSFORM_CLASS (klass)->set_caps =
+      GST_DEBUG_FUNCPTR (gst_remove_silence_set_caps);
   GST_BASE_TRANSFORM_CLASS (klass)->transform_ip =
       GST_DEBUG_FUNCPTR (gst_remove_silence_transform_ip);
 }
@@ -145,6 +185,11 @@ gst_remove_silence_init (GstRemoveSilence * filter)
 {
   filter->vad = vad_new (DEFAULT_VAD_HYSTERESIS);
   filter->remove = FALSE;
+  filter->frame_duration = DEFAULT_FRAME_DURATION;
+  filter->silent = DEFAULT_SILENT;
+  filter->boundary_events = DEFAULT_BOUNDARY_EVENTS;
+  filter->last_state = VAD_VOICE;
+  gst_audio_info_init (&filter->info);
 
   if (!filter->vad) {
     GST_DEBUG ("Error initializing VAD !!");
@@ -176,6 +221,20 @@ gst_remove_silence_set_property (GObject * object, guint prop_id,
     case PROP_HYSTERESIS:
       vad_set_hysteresis (filter->vad, g_value_get_uint64 (value));
       break;
+    case PROP_FRAME_DURATION:
+      GST_OBJECT_LOCK (filter);
+      filter->frame_duration = g_value_get_uint64 (value);
+      if (GST_AUDIO_INFO_RATE (&filter->info))
+        filter->frame_size = gst_util_uint64_scale (filter->frame_duration,
+            GST_AUDIO_INFO_RATE (&filter->info), GST_SECOND);
+      GST_OBJECT_UNLOCK (filter);
+      break;
+    case PROP_SILENT:
+      filter->silent = g_value_get_boolean (value);
+      break;
+    case PROP_BOUNDARY_EVENTS:
+      filter->boundary_events = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -195,27 +254,134 @@ gst_remove_silence_get_property (GObject * object, guint prop_id,
     case PROP_HYSTERESIS:
       g_value_set_uint64 (value, vad_get_hysteresis (filter->vad));
       break;
+    case PROP_FRAME_DURATION:
+      g_value_set_uint64 (value, filter->frame_duration);
+      break;
+    case PROP_SILENT:
+      g_value_set_boolean (value, filter->silent);
+      break;
+    case PROP_BOUNDARY_EVENTS:
+      g_value_set_boolean (value, filter->boundary_events);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+static gboolean
+gst_remove_silence_start (GstBaseTransform * trans)
+{
+  GstRemoveSilence *filter = GST_REMOVE_SILENCE (trans);
+
+  vad_reset (filter->vad);
+  filter->last_state = VAD_VOICE;
+
+  return TRUE;
+}
+
+static gboolean
+gst_remove_silence_set_caps (GstBaseTransform * trans, GstCaps * incaps,
+    GstCaps * outcaps)
+{
+  GstRemoveSilence *filter = GST_REMOVE_SILENCE (trans);
+  GstAudioInfo info;
+
+  if (!gst_audio_info_from_caps (&info, incaps)) {
+    GST_ERROR_OBJECT (filter, "invalid caps %" GST_PTR_FORMAT, incaps);
+    return FALSE;
+  }
+
+  GST_OBJECT_LOCK (filter);
+  filter->info = info;
+  filter->frame_size = gst_util_uint64_scale (filter->frame_duration,
+      GST_AUDIO_INFO_RATE (&info), GST_SECOND);
+  GST_OBJECT_UNLOCK (filter);
+
+  return TRUE;
+}
+
+/* Tells the application and downstream that voice or silence starts */
+static void
+gst_remove_silence_notify (GstRemoveSilence * filter, gint state,
+    GstClockTime timestamp)
+{
+  const gchar *field = (state == VAD_SILENCE) ?
+      "silence_detected" : "silence_finished";
+
+  GST_DEBUG_OBJECT (filter, "%s at %" GST_TIME_FORMAT, field,
+      GST_TIME_ARGS (timestamp));
+
+  if (!filter->silent) {
+    gst_element_post_message (GST_ELEMENT (filter),
+        gst_message_new_element (GST_OBJECT (filter),
+            gst_structure_new ("removesilence", field, G_TYPE_UINT64,
+                timestamp, NULL)));
+  }
+
+  if (filter->boundary_events) {
+    gst_pad_push_event (GST_BASE_TRANSFORM_SRC_PAD (filter),
+        gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM,
+            gst_structure_new ("removesilence", field, G_TYPE_UINT64,
+                timestamp, NULL)));
+  }
+}
+
 static GstFlowReturn
 gst_remove_silence_transform_ip (GstBaseTransform * trans, GstBuffer * inbuf)
 {
   GstRemoveSilence *filter = NULL;
   int frame_type;
+  gboolean voice = FALSE;
   GstMapInfo map;
+  GstClockTime pts, timestamp;
+  gint bpf, rate, channels, frame_size, n_samples, offset, len;
+  gboolean is_float;
 
   filter = GST_REMOVE_SILENCE (trans);
 
+  GST_OBJECT_LOCK (filter);
+  bpf = GST_AUDIO_INFO_BPF (&filter->info);
+  rate = GST_AUDIO_INFO_RATE (&filter->info);
+  channels = GST_AUDIO_INFO_CHANNELS (&filter->info);
+  is_float = GST_AUDIO_INFO_IS_FLOAT (&filter->info);
+  frame_size = filter->frame_size;
+  GST_OBJECT_UNLOCK (filter);
+
+  if (G_UNLIKELY (bpf == 0))
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  pts = GST_BUFFER_PTS (inbuf);
+
   gst_buffer_map (inbuf, &map, GST_MAP_READ);
-  frame_type =
-      vad_update (filter->vad, (gint16 *) map.data, map.size / sizeof (gint16));
+  n_samples = map.size / bpf;
+  if (frame_size <= 0)
+    frame_size = MAX (n_samples, 1);
+
+  for (offset = 0; offset < n_samples; offset += len) {
+    len = MIN (frame_size, n_samples - offset);
+
+    if (is_float)
+      frame_type = vad_update_float (filter->vad,
+          (const gfloat *) map.data + offset * channels, len, channels);
+    else
+      frame_type = vad_update (filter->vad,
+          (const gint16 *) map.data + offset * channels, len, channels);
+
+    if (frame_type == VAD_VOICE)
+      voice = TRUE;
+
+    if (frame_type != filter->last_state) {
+      timestamp = GST_CLOCK_TIME_NONE;
+      if (GST_CLOCK_TIME_IS_VALID (pts))
+        timestamp = pts + gst_util_uint64_scale_int (offset, GST_SECOND, rate);
+      gst_remove_silence_notify (filter, frame_type, timestamp);
+      filter->last_state = frame_type;
+    }
+  }
   gst_buffer_unmap (inbuf, &map);
 
-  if (frame_type == VAD_SILENCE) {
+  if (!voice) {
     GST_DEBUG ("Silence detected");
 
     if (filter->remove) {
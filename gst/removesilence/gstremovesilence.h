@@ -24,6 +24,7 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
 #include "vad_private.h"
 
 G_BEGIN_DECLS
@@ -43,6 +44,14 @@ typedef struct _GstRemoveSilence {
   GstBaseTransform parent;
   VADFilter* vad;
   gboolean remove;
+  guint64 frame_duration;
+  gboolean silent;
+  gboolean boundary_events;
+
+  GstAudioInfo info;
+  /* samples per channel the VAD decides on, 0 for whole buffers */
+  gint frame_size;
+  gint last_state;
 } GstRemoveSilence;
 
 typedef struct _GstRemoveSilenceClass {
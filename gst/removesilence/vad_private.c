@@ -22,50 +22,37 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 #include <glib.h>
-#include "vad_private.h"
-
-#define VAD_POWER_ALPHA     0x0800      /* Q16 */
-#define VAD_POWER_THRESHOLD 0x000010C7  /* -60 dB (square wave) */
-#define VAD_ZCR_THRESHOLD   0
-#define VAD_BUFFER_SIZE     256
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
-union pgen
-{
-  guint64 a;
-  gpointer v;
-  guint64 *l;
-  guchar *b;
-  guint16 *w;
-  gint16 *s;
-};
+#include "vad_private.h"
 
-struct _cqueue_s
-{
-  union pgen base;
-  union pgen tail;
-  union pgen head;
-  gint size;
-};
+#define VAD_POWER_ALPHA     (1.0 / 32.0)
+#define VAD_POWER_THRESHOLD 1e-6        /* -60 dB (square wave) */
+#define VAD_ZCR_THRESHOLD   0
 
-typedef struct _cqueue_s cqueue_t;
 
 struct _vad_s
 {
-  gint16 vad_buffer[VAD_BUFFER_SIZE];
-  cqueue_t cqueue;
   gint vad_state;
   guint64 hysteresis;
   guint64 vad_samples;
-  guint64 vad_power;
-  long vad_zcr;
+  /* smoothed mean square of the samples, full scale being 1.0 */
+  gdouble vad_power;
+  /* sign of the last sample of the previous frame */
+  gboolean vad_negative;
 };
 
 VADFilter *
 vad_new (guint64 hysteresis)
 {
-  VADFilter *vad = malloc (sizeof (VADFilter));
+  VADFilter *vad = calloc (1, sizeof (VADFilter));
   vad_reset (vad);
   vad->hysteresis = hysteresis;
   return vad;
@@ -74,10 +61,10 @@ vad_new (guint64 hysteresis)
 void
 vad_reset (VADFilter * vad)
 {
+  guint64 hysteresis = vad->hysteresis;
+
   memset (vad, 0, sizeof (*vad));
-  vad->cqueue.base.s = vad->vad_buffer;
-  vad->cqueue.tail.a = vad->cqueue.head.a = 0;
-  vad->cqueue.size = VAD_BUFFER_SIZE;
+  vad->hysteresis = hysteresis;
   vad->vad_state = VAD_SILENCE;
 }
 
@@ -99,38 +86,144 @@ vad_get_hysteresis (struct _vad_s *p)
   return p->hysteresis;
 }
 
-gint
-vad_update (struct _vad_s * p, gint16 * data, gint len)
+/* Sum of the squares of n samples */
+static guint64
+vad_energy_s16 (const gint16 * data, gint n)
 {
-  guint64 tail;
-  gint frame_type;
-  gint16 sample;
+  guint64 energy = 0;
+  gint i = 0;
+
+#if defined (__SSE2__)
+  {
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i acc = zero;
+    guint64 lanes[2];
+
+    /* a pair of squares is at most 2^31, which fits unsigned 32 bits */
+    for (; i + 8 <= n; i += 8) {
+      __m128i x = _mm_loadu_si128 ((const __m128i *) (data + i));
+      __m128i sq = _mm_madd_epi16 (x, x);
+
+      acc = _mm_add_epi64 (acc, _mm_unpacklo_epi32 (sq, zero));
+      acc = _mm_add_epi64 (acc, _mm_unpackhi_epi32 (sq, zero));
+    }
+    _mm_storeu_si128 ((__m128i *) lanes, acc);
+    energy = lanes[0] + lanes[1];
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  {
+    uint64x2_t acc = vdupq_n_u64 (0);
+
+    for (; i + 8 <= n; i += 8) {
+      int16x8_t x = vld1q_s16 (data + i);
+      int32x4_t lo = vmull_s16 (vget_low_s16 (x), vget_low_s16 (x));
+      int32x4_t hi = vmull_s16 (vget_high_s16 (x), vget_high_s16 (x));
+
+      acc = vpadalq_u32 (acc, vreinterpretq_u32_s32 (lo));
+      acc = vpadalq_u32 (acc, vreinterpretq_u32_s32 (hi));
+    }
+    energy = vgetq_lane_u64 (acc, 0) + vgetq_lane_u64 (acc, 1);
+  }
+#endif
+  for (; i < n; i++)
+    energy += (gint32) data[i] * data[i];
+
+  return energy;
+}
+
+static gdouble
+vad_energy_float (const gfloat * data, gint n)
+{
+  gdouble energy = 0.0;
+  gint i = 0;
+
+#if defined (__SSE2__)
+  {
+    __m128 acc = _mm_setzero_ps ();
+    gfloat lanes[4];
+
+    /* flush the float lanes regularly to keep the precision */
+    while (i + 4 <= n) {
+      gint end = MIN (n, i + 4096);
+
+      for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps (data + i);
+
+        acc = _mm_add_ps (acc, _mm_mul_ps (x, x));
+      }
+      _mm_storeu_ps (lanes, acc);
+      energy += (gdouble) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+      acc = _mm_setzero_ps ();
+    }
+  }
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  while (i + 4 <= n) {
+    float32x4_t acc = vdupq_n_f32 (0.0f);
+    gint end = MIN (n, i + 4096);
+
+    for (; i + 4 <= end; i += 4) {
+      float32x4_t x = vld1q_f32 (data + i);
+
+      acc = vmlaq_f32 (acc, x, x);
+    }
+    energy += (gdouble) vgetq_lane_f32 (acc, 0) + vgetq_lane_f32 (acc, 1) +
+        vgetq_lane_f32 (acc, 2) + vgetq_lane_f32 (acc, 3);
+  }
+#endif
+  for (; i < n; i++)
+    energy += data[i] * data[i];
+
+  return energy;
+}
+
+/* Zero crossings of the first channel, counting from the last sample of
+ * the previous frame, minus the pairs of samples that do not cross */
+static glong
+vad_zcr_s16 (VADFilter * p, const gint16 * data, gint len, gint channels)
+{
+  gboolean negative = p->vad_negative, prev;
+  glong crossings = 0;
   gint i;
 
   for (i = 0; i < len; i++) {
-    p->vad_power = VAD_POWER_ALPHA * ((data[i] * data[i] >> 14) & 0xFFFF) +
-        (0xFFFF - VAD_POWER_ALPHA) * (p->vad_power >> 16) +
-        ((0xFFFF - VAD_POWER_ALPHA) * (p->vad_power & 0xFFFF) >> 16);
-    /* Update VAD buffer */
-    p->cqueue.base.s[p->cqueue.head.a] = data[i];
-    p->cqueue.head.a = (p->cqueue.head.a + 1) & (p->cqueue.size - 1);
-    if (p->cqueue.head.a == p->cqueue.tail.a)
-      p->cqueue.tail.a = (p->cqueue.tail.a + 1) & (p->cqueue.size - 1);
+    prev = negative;
+    negative = data[i * channels] < 0;
+    crossings += negative != prev;
   }
+  p->vad_negative = negative;
+
+  return 2 * crossings - len;
+}
 
-  tail = p->cqueue.tail.a;
-  p->vad_zcr = 0;
-  for (;;) {
-    sample = p->cqueue.base.s[tail];
-    tail = (tail + 1) & (p->cqueue.size - 1);
-    if (tail == p->cqueue.head.a)
-      break;
-    p->vad_zcr +=
-        ((sample & 0x8000) != (p->cqueue.base.s[tail] & 0x8000)) ? 1 : -1;
+static glong
+vad_zcr_float (VADFilter * p, const gfloat * data, gint len, gint channels)
+{
+  gboolean negative = p->vad_negative, prev;
+  glong crossings = 0;
+  gint i;
+
+  for (i = 0; i < len; i++) {
+    prev = negative;
+    negative = data[i * channels] < 0;
+    crossings += negative != prev;
   }
+  p->vad_negative = negative;
+
+  return 2 * crossings - len;
+}
+
+static gint
+vad_update_state (struct _vad_s *p, gdouble energy, glong zcr, gint len)
+{
+  gint frame_type;
+
+  /* the same smoothing as applying the coefficient on every sample of a
+   * frame of constant power */
+  p->vad_power += (1.0 - pow (1.0 - VAD_POWER_ALPHA, len)) *
+      (energy - p->vad_power);
 
   frame_type = (p->vad_power > VAD_POWER_THRESHOLD
-      && p->vad_zcr < VAD_ZCR_THRESHOLD) ? VAD_VOICE : VAD_SILENCE;
+      && zcr < VAD_ZCR_THRESHOLD) ? VAD_VOICE : VAD_SILENCE;
 
   if (p->vad_state != frame_type) {
     /* Voice to silence transition */
@@ -150,3 +243,33 @@ vad_update (struct _vad_s * p, gint16 * data, gint len)
 
   return p->vad_state;
 }
+
+gint
+vad_update (struct _vad_s * p, const gint16 * data, gint len, gint channels)
+{
+  gdouble energy;
+
+  if (len <= 0)
+    return p->vad_state;
+
+  energy = vad_energy_s16 (data, len * channels) /
+      (32768.0 * 32768.0 * len * channels);
+
+  return vad_update_state (p, energy, vad_zcr_s16 (p, data, len, channels),
+      len);
+}
+
+gint
+vad_update_float (struct _vad_s * p, const gfloat * data, gint len,
+    gint channels)
+{
+  gdouble energy;
+
+  if (len <= 0)
+    return p->vad_state;
+
+  energy = vad_energy_float (data, len * channels) / (len * channels);
+
+  return vad_update_state (p, energy, vad_zcr_float (p, data, len, channels),
+      len);
+}
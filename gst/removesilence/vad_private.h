@@ -29,7 +29,11 @@
 
 typedef struct _vad_s VADFilter;
 
-gint vad_update(VADFilter *p, gint16 *data, gint len);
+/* len is the number of samples per channel, data holds them interleaved */
+gint vad_update(VADFilter *p, const gint16 *data, gint len, gint channels);
+
+gint vad_update_float(VADFilter *p, const gfloat *data, gint len,
+    gint channels);
 
 void vad_set_hysteresis(VADFilter *p, guint64 hysteresis);
 
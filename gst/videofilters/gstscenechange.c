@@ -33,6 +33,12 @@
  *
  * The scenechange element does not work with compressed video.
  *
+ * The pictures can be compared on a luma plane decimated by a factor set by
+ * the #GstSceneChange:decimation property, which makes the detection much
+ * cheaper on large pictures. The decision thresholds can be tuned with the
+ * #GstSceneChange:min-score, #GstSceneChange:max-score,
+ * #GstSceneChange:min-ratio and #GstSceneChange:max-ratio properties.
+ *
  * ## Example launch line
  * |[
  * gst-launch-1.0 -v filesrc location=some_file.ogv ! decodebin !
@@ -82,12 +88,18 @@
 #include <gst/video/gstvideofilter.h>
 #include <string.h>
 #include "gstscenechange.h"
+#include "gstvideofiltersbadorc.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_scene_change_debug_category);
 #define GST_CAT_DEFAULT gst_scene_change_debug_category
 
 /* prototypes */
 
+static void gst_scene_change_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_scene_change_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_scene_change_finalize (GObject * object);
 
 static GstFlowReturn gst_scene_change_transform_frame_ip (GstVideoFilter *
     filter, GstVideoFrame * frame);
@@ -99,9 +111,20 @@ static gboolean is_shot_change (int frame_number);
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_DECIMATION,
+  PROP_MIN_SCORE,
+  PROP_MAX_SCORE,
+  PROP_MIN_RATIO,
+  PROP_MAX_RATIO
 };
 
+#define DEFAULT_DECIMATION 1
+#define DEFAULT_MIN_SCORE 5.0
+#define DEFAULT_MAX_SCORE 50.0
+#define DEFAULT_MIN_RATIO 1.0
+#define DEFAULT_MAX_RATIO 2.5
+
 #define VIDEO_CAPS \
     GST_VIDEO_CAPS_MAKE("{ I420, Y42B, Y41B, Y444 }")
 
@@ -115,8 +138,83 @@ G_DEFINE_TYPE_WITH_CODE (GstSceneChange, gst_scene_change,
 static void
 gst_scene_change_class_init (GstSceneChangeClass * klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstVideoFilterClass *video_filter_class = GST_VIDEO_FILTER_CLASS (klass);
 
+  gobject_class->set_property = gst_scene_change_set_property;
+  gobject_class->get_property = gst_scene_change_get_property;
+  gobject_class->finalize = gst_scene_change_finalize;
+
+  /**
+   * GstSceneChange:decimation:
+   *
+   * Compare the pictures on their luma plane decimated by this factor in
+   * both directions, only one pixel out of decimation x decimation is
+   * read. 1 compares the full resolution luma.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_DECIMATION,
+      g_param_spec_uint ("decimation", "Decimation",
+          "Decimation factor of the compared luma planes", 1, 16,
+          DEFAULT_DECIMATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSceneChange:min-score:
+   *
+   * Mean absolute difference of the luma below which a picture is never
+   * considered a scene change.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MIN_SCORE,
+      g_param_spec_double ("min-score", "Minimum score",
+          "Mean absolute luma difference below which there is no scene change",
+          0.0, 255.0, DEFAULT_MIN_SCORE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSceneChange:max-score:
+   *
+   * Mean absolute difference of the luma above which a picture standing
+   * out of the previous ones is always considered a scene change.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_SCORE,
+      g_param_spec_double ("max-score", "Maximum score",
+          "Mean absolute luma difference above which a picture standing out "
+          "is a scene change", 0.0, 255.0, DEFAULT_MAX_SCORE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSceneChange:min-ratio:
+   *
+   * Ratio of the score to the threshold derived from the previous pictures
+   * below which there is no scene change.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MIN_RATIO,
+      g_param_spec_double ("min-ratio", "Minimum ratio",
+          "Ratio to the recent scores below which there is no scene change",
+          0.0, G_MAXDOUBLE, DEFAULT_MIN_RATIO,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSceneChange:max-ratio:
+   *
+   * Ratio of the score to the threshold derived from the previous pictures
+   * above which there always is a scene change.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_RATIO,
+      g_param_spec_double ("max-ratio", "Maximum ratio",
+          "Ratio to the recent scores above which there is a scene change",
+          0.0, G_MAXDOUBLE, DEFAULT_MAX_RATIO,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template (GST_ELEMENT_CLASS (klass),
       gst_pad_template_new ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
           gst_caps_from_string (VIDEO_CAPS)));
@@ -137,33 +235,156 @@ gst_scene_change_class_init (GstSceneChangeClass * klass)
 static void
 gst_scene_change_init (GstSceneChange * scenechange)
 {
+  scenechange->decimation = DEFAULT_DECIMATION;
+  scenechange->min_score = DEFAULT_MIN_SCORE;
+  scenechange->max_score = DEFAULT_MAX_SCORE;
+  scenechange->min_ratio = DEFAULT_MIN_RATIO;
+  scenechange->max_ratio = DEFAULT_MAX_RATIO;
+}
+
+static void
+gst_scene_change_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (object);
+
+  GST_OBJECT_LOCK (scenechange);
+  switch (property_id) {
+    case PROP_DECIMATION:
+      scenechange->decimation = g_value_get_uint (value);
+      break;
+    case PROP_MIN_SCORE:
+      scenechange->min_score = g_value_get_double (value);
+      break;
+    case PROP_MAX_SCORE:
+      scenechange->max_score = g_value_get_double (value);
+      break;
+    case PROP_MIN_RATIO:
+      scenechange->min_ratio = g_value_get_double (value);
+      break;
+    case PROP_MAX_RATIO:
+      scenechange->max_ratio = g_value_get_double (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (scenechange);
+}
+
+static void
+gst_scene_change_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (object);
+
+  GST_OBJECT_LOCK (scenechange);
+  switch (property_id) {
+    case PROP_DECIMATION:
+      g_value_set_uint (value, scenechange->decimation);
+      break;
+    case PROP_MIN_SCORE:
+      g_value_set_double (value, scenechange->min_score);
+      break;
+    case PROP_MAX_SCORE:
+      g_value_set_double (value, scenechange->max_score);
+      break;
+    case PROP_MIN_RATIO:
+      g_value_set_double (value, scenechange->min_ratio);
+      break;
+    case PROP_MAX_RATIO:
+      g_value_set_double (value, scenechange->max_ratio);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (scenechange);
 }
 
+static void
+gst_scene_change_finalize (GObject * object)
+{
+  GstSceneChange *scenechange = GST_SCENE_CHANGE (object);
 
+  gst_buffer_replace (&scenechange->oldbuf, NULL);
+  g_free (scenechange->plane);
+  g_free (scenechange->next_plane);
+
+  G_OBJECT_CLASS (gst_scene_change_parent_class)->finalize (object);
+}
+
+/* mean absolute difference of two luma planes */
 static double
-get_frame_score (GstVideoFrame * f1, GstVideoFrame * f2)
+get_plane_score (const guint8 * s1, int stride1, const guint8 * s2,
+    int stride2, int width, int height)
 {
-  int i;
+  guint64 score = 0;
   int j;
-  int score = 0;
-  int width, height;
-  guint8 *s1;
-  guint8 *s2;
-
-  width = f1->info.width;
-  height = f1->info.height;
 
   for (j = 0; j < height; j++) {
-    s1 = (guint8 *) f1->data[0] + f1->info.stride[0] * j;
-    s2 = (guint8 *) f2->data[0] + f2->info.stride[0] * j;
-    for (i = 0; i < width; i++) {
-      score += ABS (s1[i] - s2[i]);
-    }
+    guint32 line_score;
+
+    videofilters_orc_sad_u8 (&line_score, s1 + stride1 * j, s2 + stride2 * j,
+        width);
+    score += line_score;
   }
 
   return ((double) score) / (width * height);
 }
 
+static double
+get_frame_score (GstVideoFrame * f1, GstVideoFrame * f2)
+{
+  return get_plane_score (f1->data[0], f1->info.stride[0], f2->data[0],
+      f2->info.stride[0], f1->info.width, f1->info.height);
+}
+
+/* Stores the luma of frame decimated by decimation in both directions and
+ * compares it to the one of the previous frame. Returns FALSE if there is
+ * no previous frame of the same size to compare with. */
+static gboolean
+get_decimated_score (GstSceneChange * scenechange, GstVideoFrame * frame,
+    guint decimation, double *score)
+{
+  int width = (frame->info.width + decimation - 1) / decimation;
+  int height = (frame->info.height + decimation - 1) / decimation;
+  gboolean have_previous;
+  guint8 *tmp;
+  int i, j;
+
+  have_previous = scenechange->plane && scenechange->plane_width == width
+      && scenechange->plane_height == height;
+
+  if (!have_previous) {
+    g_free (scenechange->plane);
+    g_free (scenechange->next_plane);
+    scenechange->plane = g_malloc (width * height);
+    scenechange->next_plane = g_malloc (width * height);
+    scenechange->plane_width = width;
+    scenechange->plane_height = height;
+  }
+
+  for (j = 0; j < height; j++) {
+    const guint8 *src = (guint8 *) frame->data[0] +
+        frame->info.stride[0] * j * decimation;
+    guint8 *dest = scenechange->next_plane + j * width;
+
+    for (i = 0; i < width; i++)
+      dest[i] = src[i * decimation];
+  }
+
+  if (have_previous)
+    *score = get_plane_score (scenechange->plane, width,
+        scenechange->next_plane, width, width, height);
+
+  tmp = scenechange->plane;
+  scenechange->plane = scenechange->next_plane;
+  scenechange->next_plane = tmp;
+
+  return have_previous;
+}
+
 static GstFlowReturn
 gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
     GstVideoFrame * frame)
@@ -173,36 +394,60 @@ gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
   double score_min;
   double score_max;
   double threshold;
-  double score;
+  double score = 0.0;
+  double min_score, max_score, min_ratio, max_ratio;
+  guint decimation;
   gboolean change;
   gboolean ret;
   int i;
 
   GST_DEBUG_OBJECT (scenechange, "transform_frame_ip");
 
-  if (!scenechange->oldbuf) {
-    scenechange->n_diffs = 0;
-    memset (scenechange->diffs, 0, sizeof (double) * SC_N_DIFFS);
-    scenechange->oldbuf = gst_buffer_ref (frame->buffer);
-    memcpy (&scenechange->oldinfo, &frame->info, sizeof (GstVideoInfo));
-    return GST_FLOW_OK;
-  }
+  GST_OBJECT_LOCK (scenechange);
+  decimation = scenechange->decimation;
+  min_score = scenechange->min_score;
+  max_score = scenechange->max_score;
+  min_ratio = scenechange->min_ratio;
+  max_ratio = scenechange->max_ratio;
+  GST_OBJECT_UNLOCK (scenechange);
+
+  if (decimation > 1) {
+    /* the previous picture is kept as its decimated luma */
+    gst_buffer_replace (&scenechange->oldbuf, NULL);
+
+    if (!get_decimated_score (scenechange, frame, decimation, &score)) {
+      scenechange->n_diffs = 0;
+      memset (scenechange->diffs, 0, sizeof (double) * SC_N_DIFFS);
+      return GST_FLOW_OK;
+    }
+  } else {
+    /* a decimated luma stored earlier is stale once this path is taken */
+    scenechange->plane_width = 0;
+
+    if (!scenechange->oldbuf) {
+      scenechange->n_diffs = 0;
+      memset (scenechange->diffs, 0, sizeof (double) * SC_N_DIFFS);
+      scenechange->oldbuf = gst_buffer_ref (frame->buffer);
+      memcpy (&scenechange->oldinfo, &frame->info, sizeof (GstVideoInfo));
+      return GST_FLOW_OK;
+    }
 
-  ret =
-      gst_video_frame_map (&oldframe, &scenechange->oldinfo,
-      scenechange->oldbuf, GST_MAP_READ);
-  if (!ret) {
-    GST_ERROR_OBJECT (scenechange, "failed to map old video frame");
-    return GST_FLOW_ERROR;
-  }
+    ret =
+        gst_video_frame_map (&oldframe, &scenechange->oldinfo,
+        scenechange->oldbuf, GST_MAP_READ);
+    if (!ret) {
+      GST_ERROR_OBJECT (scenechange, "failed to map old video frame");
+      return GST_FLOW_ERROR;
+    }
 
-  score = get_frame_score (&oldframe, frame);
+    score = get_frame_score (&oldframe, frame);
 
-  gst_video_frame_unmap (&oldframe);
+    gst_video_frame_unmap (&oldframe);
 
-  gst_buffer_unref (scenechange->oldbuf);
-  scenechange->oldbuf = gst_buffer_ref (frame->buffer);
-  memcpy (&scenechange->oldinfo, &frame->info, sizeof (GstVideoInfo));
+    gst_buffer_unref (scenechange->oldbuf);
+    scenechange->oldbuf = gst_buffer_ref (frame->buffer);
+    memcpy (&scenechange->oldinfo, &frame->info, sizeof (GstVideoInfo));
+  }
 
   memmove (scenechange->diffs, scenechange->diffs + 1,
       sizeof (double) * (SC_N_DIFFS - 1));
@@ -219,13 +464,13 @@ gst_scene_change_transform_frame_ip (GstVideoFilter * filter,
   threshold = 1.8 * score_max - 0.8 * score_min;
 
   if (scenechange->n_diffs > 2) {
-    if (score < 5) {
+    if (score < min_score) {
       change = FALSE;
-    } else if (score / threshold < 1.0) {
+    } else if (score / threshold < min_ratio) {
       change = FALSE;
-    } else if (score / threshold > 2.5) {
+    } else if (score / threshold > max_ratio) {
       change = TRUE;
-    } else if (score > 50) {
+    } else if (score > max_score) {
       change = TRUE;
     } else {
       change = FALSE;
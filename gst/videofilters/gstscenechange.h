@@ -45,6 +45,19 @@ struct _GstSceneChange
   GstBuffer *oldbuf;
   GstVideoInfo oldinfo;
   int count;
+
+  /* properties */
+  guint decimation;
+  double min_score;
+  double max_score;
+  double min_ratio;
+  double max_ratio;
+
+  /* decimated luma of the previous frame and of the current one */
+  guint8 *plane;
+  guint8 *next_plane;
+  int plane_width;
+  int plane_height;
 };
 
 struct _GstSceneChangeClass
@@ -39,6 +39,10 @@
 #include <gst/video/gstvideofilter.h>
 #include "gstvideodiff.h"
 
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
 GST_DEBUG_CATEGORY_STATIC (gst_video_diff_debug_category);
 #define GST_CAT_DEFAULT gst_video_diff_debug_category
 
@@ -85,13 +89,61 @@ gst_video_diff_init (GstVideoDiff * videodiff)
   videodiff->threshold = 10;
 }
 
+/* marks the samples of @s2 that differ from @s1 by more than @threshold
+ * with a pattern of alternating 4 pixel wide black and white stripes */
+static void
+gst_video_diff_row (guint8 * d, const guint8 * s1, const guint8 * s2,
+    int width, int threshold, int phase)
+{
+  int i = 0;
+
+#if defined (__SSE2__)
+  if (threshold >= 0 && threshold < 255) {
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i thr = _mm_set1_epi8 ((char) threshold);
+    guint8 p[16];
+    __m128i pattern;
+    int k;
+
+    /* the vectors start at multiples of 16, so the pattern repeats */
+    for (k = 0; k < 16; k++)
+      p[k] = ((k + phase) & 0x4) ? 16 : 240;
+    pattern = _mm_loadu_si128 ((const __m128i *) p);
+
+    for (; i + 16 <= width; i += 16) {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (s1 + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (s2 + i));
+      __m128i diff = _mm_or_si128 (_mm_subs_epu8 (a, b),
+          _mm_subs_epu8 (b, a));
+      __m128i same = _mm_cmpeq_epi8 (_mm_subs_epu8 (diff, thr), zero);
+
+      _mm_storeu_si128 ((__m128i *) (d + i),
+          _mm_or_si128 (_mm_and_si128 (same, b),
+              _mm_andnot_si128 (same, pattern)));
+    }
+  }
+#endif
+
+  for (; i < width; i++) {
+    if ((s2[i] < s1[i] - threshold) || (s2[i] > s1[i] + threshold)) {
+      if ((i + phase) & 0x4) {
+        d[i] = 16;
+      } else {
+        d[i] = 240;
+      }
+    } else {
+      d[i] = s2[i];
+    }
+  }
+}
+
 static GstFlowReturn
 gst_video_diff_transform_frame_ip_planarY (GstVideoDiff * videodiff,
     GstVideoFrame * outframe, GstVideoFrame * inframe, GstVideoFrame * oldframe)
 {
   int width = inframe->info.width;
   int height = inframe->info.height;
-  int i, j;
+  int j;
   int threshold = videodiff->threshold;
   int t = videodiff->t;
 
@@ -99,17 +151,8 @@ gst_video_diff_transform_frame_ip_planarY (GstVideoDiff * videodiff,
     guint8 *d = (guint8 *) outframe->data[0] + outframe->info.stride[0] * j;
     guint8 *s1 = (guint8 *) oldframe->data[0] + oldframe->info.stride[0] * j;
     guint8 *s2 = (guint8 *) inframe->data[0] + inframe->info.stride[0] * j;
-    for (i = 0; i < width; i++) {
-      if ((s2[i] < s1[i] - threshold) || (s2[i] > s1[i] + threshold)) {
-        if ((i + j + t) & 0x4) {
-          d[i] = 16;
-        } else {
-          d[i] = 240;
-        }
-      } else {
-        d[i] = s2[i];
-      }
-    }
+
+    gst_video_diff_row (d, s1, s2, width, threshold, j + t);
   }
   for (j = 0; j < GST_VIDEO_FRAME_COMP_HEIGHT (inframe, 1); j++) {
     guint8 *d = (guint8 *) outframe->data[1] + outframe->info.stride[1] * j;
@@ -38,6 +38,10 @@ GST_DEBUG_CATEGORY (h264_parse_debug);
 
 #define DEFAULT_CONFIG_INTERVAL      (0)
 
+/* NALs smaller than this are copied with their prefix when transforming the
+ * stream format, larger ones share the memory of the input */
+#define NAL_SHARE_MIN_SIZE           (256)
+
 enum
 {
   PROP_0,
@@ -418,36 +422,82 @@ gst_h264_parse_negotiate (GstH264Parse * h264parse, gint in_format,
     gst_caps_unref (caps);
 }
 
-static GstBuffer *
-gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
-    guint size)
+/* Computes the length prefix (or start code) of a NAL of @size bytes in
+ * @format, returns the prefix size */
+static guint
+gst_h264_parse_nal_prefix (GstH264Parse * h264parse, guint format,
+    guint size, guint32 * prefix)
 {
-  GstBuffer *buf;
   guint nl = h264parse->nal_length_size;
-  guint32 tmp;
 
-  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
-
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H264_PARSE_FORMAT_AVC
       || format == GST_H264_PARSE_FORMAT_AVC3) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    *prefix = GUINT32_TO_BE (size << (32 - 8 * nl));
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work. 
      * There are legit cases where nl in avc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
     nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    *prefix = GUINT32_TO_BE (1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
+  return nl;
+}
+
+static GstBuffer *
+gst_h264_parse_wrap_nal (GstH264Parse * h264parse, guint format, guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+  guint nl;
+  guint32 tmp;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, size, &tmp);
+
+  buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+  gst_buffer_fill (buf, 0, &tmp, nl);
   gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
 
   return buf;
 }
 
-static void
+/* Same as gst_h264_parse_wrap_nal() for a NAL at @offset in @src, the
+ * memory of which is shared in the returned buffer rather than copied
+ * unless the NAL is small or the memory can't be shared */
+static GstBuffer *
+gst_h264_parse_wrap_nal_shared (GstH264Parse * h264parse, guint format,
+    GstBuffer * src, guint offset, guint size)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint nl;
+  guint32 tmp;
+
+  GST_DEBUG_OBJECT (h264parse, "nal length %d", size);
+
+  nl = gst_h264_parse_nal_prefix (h264parse, format, size, &tmp);
+
+  if (size < NAL_SHARE_MIN_SIZE) {
+    buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    memcpy (map.data, &tmp, nl);
+    gst_buffer_extract (src, offset, map.data + nl, size);
+    gst_buffer_unmap (buf, &map);
+    return buf;
+  }
+
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, &tmp, nl);
+
+  return gst_buffer_append (buf,
+      gst_buffer_copy_region (src, GST_BUFFER_COPY_MEMORY, offset, size));
+}
+
+/* Returns FALSE if @nalu is a byte-identical repeat of the parameter set
+ * already stored, TRUE otherwise */
+static gboolean
 gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     GstH264NalUnitType naltype, GstH264NalUnit * nalu)
 {
@@ -463,11 +513,19 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     store = h264parse->pps_nals;
     GST_DEBUG_OBJECT (h264parse, "storing pps %u", id);
   } else
-    return;
+    return TRUE;
 
   if (id >= store_size) {
     GST_DEBUG_OBJECT (h264parse, "unable to store nal, id out-of-range %d", id);
-    return;
+    return TRUE;
+  }
+
+  /* encoders commonly repeat the headers on every IDR, keep the stored
+   * buffer and let the caller skip the caps and codec_data update */
+  if (store[id] && gst_buffer_get_size (store[id]) == size &&
+      gst_buffer_memcmp (store[id], 0, nalu->data + nalu->offset, size) == 0) {
+    GST_LOG_OBJECT (h264parse, "unchanged repeat of stored nal %u", id);
+    return FALSE;
   }
 
   buf = gst_buffer_new_allocate (NULL, size, NULL);
@@ -481,6 +539,8 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     gst_buffer_unref (store[id]);
 
   store[id] = buf;
+
+  return TRUE;
 }
 
 #ifndef GST_DISABLE_GST_DEBUG
@@ -699,14 +759,17 @@ gst_h264_parse_process_sei (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   g_array_free (messages, TRUE);
 }
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload, @src is the buffer the
+ * data of @nalu is mapped from, if any */
 static gboolean
-gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
+gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu,
+    GstBuffer * src)
 {
   guint nal_type;
   GstH264PPS pps = { 0, };
   GstH264SPS sps = { 0, };
   GstH264NalParser *nalparser = h264parse->nalparser;
+  GstH264SPS *last_sps = nalparser->last_sps;
   GstH264ParserResult pres;
 
   /* nothing to do for broken input */
@@ -740,8 +803,12 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         return FALSE;
       }
 
-      GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
-      h264parse->update_caps = TRUE;
+      /* nothing the caps depend on changed for a repeat of the active SPS */
+      if (gst_h264_parser_store_nal (h264parse, sps.id, nal_type, nalu) ||
+          nalparser->last_sps != last_sps) {
+        GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
+        h264parse->update_caps = TRUE;
+      }
       h264parse->have_sps = TRUE;
       if (h264parse->push_codec && h264parse->have_pps) {
         /* SPS and PPS found in stream before the first pre_push_frame, no need
@@ -752,7 +819,6 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         h264parse->have_pps = FALSE;
       }
 
-      gst_h264_parser_store_nal (h264parse, sps.id, nal_type, nalu);
       gst_h264_sps_clear (&sps);
       h264parse->state |= GST_H264_PARSE_STATE_GOT_SPS;
       h264parse->header |= TRUE;
@@ -772,7 +838,7 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       }
 
       /* parameters might have changed, force caps check */
-      if (!h264parse->have_pps) {
+      if (gst_h264_parser_store_nal (h264parse, pps.id, nal_type, nalu)) {
         GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
         h264parse->update_caps = TRUE;
       }
@@ -786,7 +852,6 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         h264parse->have_pps = FALSE;
       }
 
-      gst_h264_parser_store_nal (h264parse, pps.id, nal_type, nalu);
       gst_h264_pps_clear (&pps);
       h264parse->state |= GST_H264_PARSE_STATE_GOT_PPS;
       h264parse->header |= TRUE;
@@ -894,8 +959,12 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
     GstBuffer *buf;
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
-    buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    if (src)
+      buf = gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format, src,
+          nalu->offset, nalu->size);
+    else
+      buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
+          nalu->data + nalu->offset, nalu->size);
     gst_adapter_push (h264parse->frame_out, buf);
   }
   return TRUE;
@@ -993,7 +1062,7 @@ gst_h264_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h264parse, "AVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h264_parse_process_nal (h264parse, &nalu);
+    gst_h264_parse_process_nal (h264parse, &nalu, buffer);
 
     /* dispatch per NALU if needed */
     if (h264parse->split_packetized) {
@@ -1231,7 +1300,7 @@ gst_h264_parse_handle_frame (GstBaseParse * parse,
       }
     }
 
-    if (!gst_h264_parse_process_nal (h264parse, &nalu)) {
+    if (!gst_h264_parse_process_nal (h264parse, &nalu, buffer)) {
       GST_WARNING_OBJECT (h264parse,
           "broken/invalid nal Type: %d %s, Size: %u will be dropped",
           nalu.type, _nal_name (nalu.type), nalu.size);
@@ -2174,7 +2243,7 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h264parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -2189,12 +2258,8 @@ static GstFlowReturn
 gst_h264_parse_push_codec_buffer (GstH264Parse * h264parse,
     GstBuffer * nal, GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  nal = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+  nal = gst_h264_parse_wrap_nal_shared (h264parse, h264parse->format, nal, 0,
+      gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -2670,7 +2735,7 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, NULL);
       off = nalu.offset + nalu.size;
     }
 
@@ -2689,13 +2754,17 @@ gst_h264_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
         goto avcc_too_small;
       }
 
-      gst_h264_parse_process_nal (h264parse, &nalu);
+      gst_h264_parse_process_nal (h264parse, &nalu, NULL);
       off = nalu.offset + nalu.size;
     }
 
     gst_buffer_unmap (codec_data, &map);
 
     gst_buffer_replace (&h264parse->codec_data_in, codec_data);
+
+    /* the rest of the caps may have changed even if the parameter sets
+     * are repeats of the stored ones */
+    h264parse->update_caps = TRUE;
   } else if (format == GST_H264_PARSE_FORMAT_BYTE) {
     GST_DEBUG_OBJECT (h264parse, "have bytestream h264");
     /* nothing to pre-process */
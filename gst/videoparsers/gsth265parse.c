@@ -34,6 +34,10 @@ GST_DEBUG_CATEGORY (h265_parse_debug);
 
 #define DEFAULT_CONFIG_INTERVAL      (0)
 
+/* NALs smaller than this are copied with their prefix when transforming the
+ * stream format, larger ones share the memory of the input */
+#define NAL_SHARE_MIN_SIZE           (256)
+
 enum
 {
   PROP_0,
@@ -249,6 +253,11 @@ gst_h265_parse_start (GstBaseParse * parse)
   gst_h265_parse_reset (h265parse);
 
   h265parse->nalparser = gst_h265_parser_new ();
+  /* only the stream format, resolution and framerate are needed here, the
+   * HRD bit rates and SEI payloads are passed through untouched */
+  gst_h265_parser_set_flags (h265parse->nalparser,
+      GST_H265_PARSER_FLAG_SKIP_VUI_SUB_LAYER_HRD |
+      GST_H265_PARSER_FLAG_SKIP_SEI_PAYLOADS);
   h265parse->state = 0;
 
   gst_base_parse_set_min_frame_size (parse, 7);
@@ -392,35 +401,79 @@ gst_h265_parse_negotiate (GstH265Parse * h265parse, gint in_format,
     gst_caps_unref (caps);
 }
 
-static GstBuffer *
-gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
-    guint size)
+/* Computes the length prefix (or start code) of a NAL of @size bytes in
+ * @format, returns the prefix size */
+static guint
+gst_h265_parse_nal_prefix (GstH265Parse * h265parse, guint format,
+    guint size, guint32 * prefix)
 {
-  GstBuffer *buf;
   guint nl = h265parse->nal_length_size;
-  guint32 tmp;
-
-  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
 
-  buf = gst_buffer_new_allocate (NULL, 4 + size, NULL);
   if (format == GST_H265_PARSE_FORMAT_HVC1
       || format == GST_H265_PARSE_FORMAT_HEV1) {
-    tmp = GUINT32_TO_BE (size << (32 - 8 * nl));
+    *prefix = GUINT32_TO_BE (size << (32 - 8 * nl));
   } else {
     /* HACK: nl should always be 4 here, otherwise this won't work.
      * There are legit cases where nl in hevc stream is 2, but byte-stream
      * SC is still always 4 bytes. */
     nl = 4;
-    tmp = GUINT32_TO_BE (1);
+    *prefix = GUINT32_TO_BE (1);
   }
 
-  gst_buffer_fill (buf, 0, &tmp, sizeof (guint32));
+  return nl;
+}
+
+static GstBuffer *
+gst_h265_parse_wrap_nal (GstH265Parse * h265parse, guint format, guint8 * data,
+    guint size)
+{
+  GstBuffer *buf;
+  guint nl;
+  guint32 tmp;
+
+  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
+
+  nl = gst_h265_parse_nal_prefix (h265parse, format, size, &tmp);
+
+  buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+  gst_buffer_fill (buf, 0, &tmp, nl);
   gst_buffer_fill (buf, nl, data, size);
-  gst_buffer_set_size (buf, size + nl);
 
   return buf;
 }
 
+/* Same as gst_h265_parse_wrap_nal() for a NAL at @offset in @src, the
+ * memory of which is shared in the returned buffer rather than copied
+ * unless the NAL is small or the memory can't be shared */
+static GstBuffer *
+gst_h265_parse_wrap_nal_shared (GstH265Parse * h265parse, guint format,
+    GstBuffer * src, guint offset, guint size)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint nl;
+  guint32 tmp;
+
+  GST_DEBUG_OBJECT (h265parse, "nal length %d", size);
+
+  nl = gst_h265_parse_nal_prefix (h265parse, format, size, &tmp);
+
+  if (size < NAL_SHARE_MIN_SIZE) {
+    buf = gst_buffer_new_allocate (NULL, nl + size, NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    memcpy (map.data, &tmp, nl);
+    gst_buffer_extract (src, offset, map.data + nl, size);
+    gst_buffer_unmap (buf, &map);
+    return buf;
+  }
+
+  buf = gst_buffer_new_allocate (NULL, nl, NULL);
+  gst_buffer_fill (buf, 0, &tmp, nl);
+
+  return gst_buffer_append (buf,
+      gst_buffer_copy_region (src, GST_BUFFER_COPY_MEMORY, offset, size));
+}
+
 static void
 gst_h265_parser_store_nal (GstH265Parse * h265parse, guint id,
     GstH265NalUnitType naltype, GstH265NalUnit * nalu)
@@ -515,9 +568,11 @@ _nal_name (GstH265NalUnitType nal_type)
 }
 #endif
 
-/* caller guarantees 2 bytes of nal payload */
+/* caller guarantees 2 bytes of nal payload, @src is the buffer the
+ * data of @nalu is mapped from, if any */
 static gboolean
-gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
+gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu,
+    GstBuffer * src)
 {
   GstH265PPS pps = { 0, };
   GstH265SPS sps = { 0, };
@@ -744,8 +799,12 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     GstBuffer *buf;
 
     GST_LOG_OBJECT (h265parse, "collecting NAL in HEVC frame");
-    buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-        nalu->data + nalu->offset, nalu->size);
+    if (src)
+      buf = gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format, src,
+          nalu->offset, nalu->size);
+    else
+      buf = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
+          nalu->data + nalu->offset, nalu->size);
     gst_adapter_push (h265parse->frame_out, buf);
   }
 
@@ -838,7 +897,7 @@ gst_h265_parse_handle_frame_packetized (GstBaseParse * parse,
     GST_DEBUG_OBJECT (h265parse, "HEVC nal offset %d", nalu.offset + nalu.size);
 
     /* either way, have a look at it */
-    gst_h265_parse_process_nal (h265parse, &nalu);
+    gst_h265_parse_process_nal (h265parse, &nalu, buffer);
 
     /* dispatch per NALU if needed */
     if (h265parse->split_packetized) {
@@ -1056,7 +1115,7 @@ gst_h265_parse_handle_frame (GstBaseParse * parse,
       }
     }
 
-    if (!gst_h265_parse_process_nal (h265parse, &nalu)) {
+    if (!gst_h265_parse_process_nal (h265parse, &nalu, buffer)) {
       GST_WARNING_OBJECT (h265parse,
           "broken/invalid nal Type: %d %s, Size: %u will be dropped",
           nalu.type, _nal_name (nalu.type), nalu.size);
@@ -1816,7 +1875,7 @@ gst_h265_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
   if (av) {
     GstBuffer *buf;
 
-    buf = gst_adapter_take_buffer (h265parse->frame_out, av);
+    buf = gst_adapter_take_buffer_fast (h265parse->frame_out, av);
     gst_buffer_copy_into (buf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
     gst_buffer_replace (&frame->out_buffer, buf);
     gst_buffer_unref (buf);
@@ -1831,12 +1890,8 @@ static GstFlowReturn
 gst_h265_parse_push_codec_buffer (GstH265Parse * h265parse, GstBuffer * nal,
     GstClockTime ts)
 {
-  GstMapInfo map;
-
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  nal = gst_h265_parse_wrap_nal (h265parse, h265parse->format,
-      map.data, map.size);
-  gst_buffer_unmap (nal, &map);
+  nal = gst_h265_parse_wrap_nal_shared (h265parse, h265parse->format, nal, 0,
+      gst_buffer_get_size (nal));
 
   GST_BUFFER_TIMESTAMP (nal) = ts;
   GST_BUFFER_DURATION (nal) = 0;
@@ -2260,7 +2315,7 @@ gst_h265_parse_set_caps (GstBaseParse * parse, GstCaps * caps)
           goto hvcc_too_small;
         }
 
-        gst_h265_parse_process_nal (h265parse, &nalu);
+        gst_h265_parse_process_nal (h265parse, &nalu, NULL);
         off = nalu.offset + nalu.size;
       }
     }
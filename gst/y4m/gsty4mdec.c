@@ -481,6 +481,85 @@ error:
   return FALSE;
 }
 
+/* Checks if downstream can handle the Y4M layout with a GstVideoMeta and
+ * sets up a pool for stride conversion if it can't */
+static void
+gst_y4m_dec_decide_allocation (GstY4mDec * y4mdec, GstCaps * caps)
+{
+  GstQuery *query;
+
+  query = gst_query_new_allocation (caps, FALSE);
+  y4mdec->video_meta = FALSE;
+
+  if (y4mdec->pool) {
+    gst_buffer_pool_set_active (y4mdec->pool, FALSE);
+    gst_object_unref (y4mdec->pool);
+  }
+  y4mdec->pool = NULL;
+
+  if (gst_pad_peer_query (y4mdec->srcpad, query)) {
+    y4mdec->video_meta =
+        gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+    /* We only need a pool if we need to do stride conversion for downstream */
+    if (!y4mdec->video_meta && memcmp (&y4mdec->info, &y4mdec->out_info,
+            sizeof (y4mdec->info)) != 0) {
+      GstBufferPool *pool = NULL;
+      GstAllocator *allocator = NULL;
+      GstAllocationParams params;
+      GstStructure *config;
+      guint size, min, max;
+
+      if (gst_query_get_n_allocation_params (query) > 0) {
+        gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+      } else {
+        allocator = NULL;
+        gst_allocation_params_init (&params);
+      }
+
+      if (gst_query_get_n_allocation_pools (query) > 0) {
+        gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min,
+            &max);
+        size = MAX (size, y4mdec->out_info.size);
+      } else {
+        pool = NULL;
+        size = y4mdec->out_info.size;
+        min = max = 0;
+      }
+
+      if (pool == NULL) {
+        pool = gst_video_buffer_pool_new ();
+      }
+
+      config = gst_buffer_pool_get_config (pool);
+      gst_buffer_pool_config_set_params (config, caps, size, min, max);
+      gst_buffer_pool_config_set_allocator (config, allocator, &params);
+      gst_buffer_pool_set_config (pool, config);
+
+      if (allocator)
+        gst_object_unref (allocator);
+
+      y4mdec->pool = pool;
+    }
+  } else if (memcmp (&y4mdec->info, &y4mdec->out_info,
+          sizeof (y4mdec->info)) != 0) {
+    GstBufferPool *pool;
+    GstStructure *config;
+
+    /* No pool, create our own if we need to do stride conversion */
+    pool = gst_video_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, y4mdec->out_info.size, 0,
+        0);
+    gst_buffer_pool_set_config (pool, config);
+    y4mdec->pool = pool;
+  }
+  if (y4mdec->pool) {
+    gst_buffer_pool_set_active (y4mdec->pool, TRUE);
+  }
+  gst_query_unref (query);
+}
+
 static GstFlowReturn
 gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
@@ -507,7 +586,6 @@ gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   if (!y4mdec->have_header) {
     gboolean ret;
     GstCaps *caps;
-    GstQuery *query;
 
     if (n_avail < MAX_HEADER_LENGTH)
       return GST_FLOW_OK;
@@ -533,76 +611,8 @@ gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     caps = gst_video_info_to_caps (&y4mdec->info);
     ret = gst_pad_set_caps (y4mdec->srcpad, caps);
 
-    query = gst_query_new_allocation (caps, FALSE);
-    y4mdec->video_meta = FALSE;
-
-    if (y4mdec->pool) {
-      gst_buffer_pool_set_active (y4mdec->pool, FALSE);
-      gst_object_unref (y4mdec->pool);
-    }
-    y4mdec->pool = NULL;
-
-    if (gst_pad_peer_query (y4mdec->srcpad, query)) {
-      y4mdec->video_meta =
-          gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
-
-      /* We only need a pool if we need to do stride conversion for downstream */
-      if (!y4mdec->video_meta && memcmp (&y4mdec->info, &y4mdec->out_info,
-              sizeof (y4mdec->info)) != 0) {
-        GstBufferPool *pool = NULL;
-        GstAllocator *allocator = NULL;
-        GstAllocationParams params;
-        GstStructure *config;
-        guint size, min, max;
-
-        if (gst_query_get_n_allocation_params (query) > 0) {
-          gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
-        } else {
-          allocator = NULL;
-          gst_allocation_params_init (&params);
-        }
-
-        if (gst_query_get_n_allocation_pools (query) > 0) {
-          gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min,
-              &max);
-          size = MAX (size, y4mdec->out_info.size);
-        } else {
-          pool = NULL;
-          size = y4mdec->out_info.size;
-          min = max = 0;
-        }
-
-        if (pool == NULL) {
-          pool = gst_video_buffer_pool_new ();
-        }
-
-        config = gst_buffer_pool_get_config (pool);
-        gst_buffer_pool_config_set_params (config, caps, size, min, max);
-        gst_buffer_pool_config_set_allocator (config, allocator, &params);
-        gst_buffer_pool_set_config (pool, config);
-
-        if (allocator)
-          gst_object_unref (allocator);
-
-        y4mdec->pool = pool;
-      }
-    } else if (memcmp (&y4mdec->info, &y4mdec->out_info,
-            sizeof (y4mdec->info)) != 0) {
-      GstBufferPool *pool;
-      GstStructure *config;
-
-      /* No pool, create our own if we need to do stride conversion */
-      pool = gst_video_buffer_pool_new ();
-      config = gst_buffer_pool_get_config (pool);
-      gst_buffer_pool_config_set_params (config, caps, y4mdec->out_info.size, 0,
-          0);
-      gst_buffer_pool_set_config (pool, config);
-      y4mdec->pool = pool;
-    }
-    if (y4mdec->pool) {
-      gst_buffer_pool_set_active (y4mdec->pool, TRUE);
-    }
-    gst_query_unref (query);
+    gst_pad_check_reconfigure (y4mdec->srcpad);
+    gst_y4m_dec_decide_allocation (y4mdec, caps);
     gst_caps_unref (caps);
     if (!ret) {
       GST_DEBUG_OBJECT (y4mdec, "Couldn't set caps on src pad");
@@ -638,6 +648,15 @@ gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
   }
 
+  if (gst_pad_check_reconfigure (y4mdec->srcpad)) {
+    GstCaps *caps = gst_pad_get_current_caps (y4mdec->srcpad);
+
+    if (caps) {
+      gst_y4m_dec_decide_allocation (y4mdec, caps);
+      gst_caps_unref (caps);
+    }
+  }
+
   while (1) {
     n_avail = gst_adapter_available (y4mdec->adapter);
     if (n_avail < MAX_HEADER_LENGTH)
@@ -676,12 +695,14 @@ gst_y4m_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 
     y4mdec->frame_index++;
 
-    if (y4mdec->video_meta) {
+    if (memcmp (&y4mdec->info, &y4mdec->out_info, sizeof (y4mdec->info)) == 0) {
+      /* Y4M layout matches the default one, push as is */
+    } else if (y4mdec->video_meta) {
+      /* Sub-buffer of the input, the meta describes the packed layout */
       gst_buffer_add_video_meta_full (buffer, 0, y4mdec->info.finfo->format,
           y4mdec->info.width, y4mdec->info.height, y4mdec->info.finfo->n_planes,
           y4mdec->info.offset, y4mdec->info.stride);
-    } else if (memcmp (&y4mdec->info, &y4mdec->out_info,
-            sizeof (y4mdec->info)) != 0) {
+    } else {
       GstBuffer *outbuf;
       GstVideoFrame iframe, oframe;
       gint i, j;
@@ -72,10 +72,12 @@ static GstFlowReturn gst_yadif_transform (GstBaseTransform * trans,
 enum
 {
   PROP_0,
-  PROP_MODE
+  PROP_MODE,
+  PROP_N_THREADS
 };
 
 #define DEFAULT_MODE GST_DEINTERLACE_MODE_AUTO
+#define DEFAULT_N_THREADS 1
 
 /* pad templates */
 
@@ -160,11 +162,19 @@ gst_yadif_class_init (GstYadifClass * klass)
           DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads filtering each frame, the rows are split in "
+          "stripes run on threads shared with other elements "
+          "(0 = number of processors)",
+          0, G_MAXUINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_yadif_init (GstYadif * yadif)
 {
+  gst_stripe_threads_init (&yadif->threads, DEFAULT_N_THREADS);
 }
 
 void
@@ -177,6 +187,11 @@ gst_yadif_set_property (GObject * object, guint property_id,
     case PROP_MODE:
       yadif->mode = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (yadif);
+      yadif->threads.n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (yadif);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -193,6 +208,11 @@ gst_yadif_get_property (GObject * object, guint property_id,
     case PROP_MODE:
       g_value_set_enum (value, yadif->mode);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (yadif);
+      g_value_set_uint (value, yadif->threads.n_threads);
+      GST_OBJECT_UNLOCK (yadif);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -212,9 +232,10 @@ gst_yadif_dispose (GObject * object)
 void
 gst_yadif_finalize (GObject * object)
 {
-  /* GstYadif *yadif = GST_YADIF (object); */
+  GstYadif *yadif = GST_YADIF (object);
 
   /* clean up object here */
+  gst_stripe_threads_clear (&yadif->threads);
 
   G_OBJECT_CLASS (gst_yadif_parent_class)->finalize (object);
 }
@@ -291,7 +312,49 @@ gst_yadif_stop (GstBaseTransform * trans)
   return TRUE;
 }
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
+void yadif_filter (GstYadif * yadif, int parity, int tff, int stripe,
+    int n_stripes);
+
+typedef struct
+{
+  GstYadif *yadif;
+  int parity;
+  int tff;
+  int n_stripes;
+} GstYadifField;
+
+/* yadif_filter() splits each plane itself, so only the stripe index is used
+ * and not the rows of the frame */
+static void
+gst_yadif_stripe_func (gpointer user_data, guint stripe, gint first, gint last)
+{
+  GstYadifField *field = user_data;
+
+  yadif_filter (field->yadif, field->parity, field->tff, stripe,
+      field->n_stripes);
+}
+
+/* Splits the rows of the frame in stripes, the streaming thread filters the
+ * first one and the thread pool the others */
+static void
+gst_yadif_filter_stripes (GstYadif * yadif, int parity, int tff)
+{
+  GstYadifField field;
+  gint height = GST_VIDEO_INFO_HEIGHT (&yadif->video_info);
+
+  field.yadif = yadif;
+  field.parity = parity;
+  field.tff = tff;
+
+  /* every stripe should have a few rows in the smallest plane */
+  GST_OBJECT_LOCK (yadif);
+  field.n_stripes = gst_stripe_threads_get_n_stripes (&yadif->threads,
+      height, 32);
+  GST_OBJECT_UNLOCK (yadif);
+
+  gst_stripe_threads_run_stripes (&yadif->threads, field.n_stripes, height,
+      gst_yadif_stripe_func, &field);
+}
 
 static GstFlowReturn
 gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
@@ -315,7 +378,7 @@ gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
   yadif->next_frame = yadif->cur_frame;
   yadif->prev_frame = yadif->cur_frame;
 
-  yadif_filter (yadif, parity, tff);
+  gst_yadif_filter_stripes (yadif, parity, tff);
 
   gst_video_frame_unmap (&yadif->dest_frame);
   gst_video_frame_unmap (&yadif->cur_frame);
@@ -23,6 +23,7 @@
 
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
+#include <gst/stripe-threads-private.h>
 
 G_BEGIN_DECLS
 
@@ -53,6 +54,9 @@ struct _GstYadif
   GstVideoFrame cur_frame;
   GstVideoFrame next_frame;
   GstVideoFrame dest_frame;
+
+  /* the n-threads property is threads.n_threads */
+  GstStripeThreads threads;
 };
 
 struct _GstYadifClass
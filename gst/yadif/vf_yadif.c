@@ -23,7 +23,7 @@
 
 #include "config.h"
 
-#include <gstyadif.h>
+#include "gstyadif.h"
 #include <string.h>
 
 #undef NDEBUG
@@ -58,7 +58,7 @@
         int spatial_pred = (c+e) >> 1; \
         int spatial_score = -1; \
  \
-        if (mrefs > 0 && prefs > 0) { \
+        if (spatial) { \
             spatial_score = FFABS(cur[mrefs - 1] - cur[prefs - 1]) + FFABS(c-e) \
                             + FFABS(cur[mrefs + 1] - cur[prefs + 1]) - 1; \
  \
@@ -90,9 +90,9 @@
     }
 
 static void
-filter_line_c (guint8 * dst,
+filter_line_c_full (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
-    int w, int prefs, int mrefs, int parity, int mode)
+    int w, int prefs, int mrefs, int parity, int mode, int spatial)
 {
   int x;
   guint8 *prev2 = parity ? prev : cur;
@@ -100,6 +100,15 @@ filter_line_c (guint8 * dst,
 
 FILTER}
 
+static void
+filter_line_c (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  filter_line_c_full (dst, prev, cur, next, w, prefs, mrefs, parity, mode,
+      mrefs > 0 && prefs > 0);
+}
+
 #if 0
 static void
 filter_line_c_16bit (guint16 * dst,
@@ -115,49 +124,102 @@ filter_line_c_16bit (guint16 * dst,
 FILTER}
 #endif
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
-#ifdef HAVE_CPU_X86_64
+typedef void (*YadifFilterLineFunc) (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+#if HAVE_CPU_X86_64
 void filter_line_x86_64 (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
     int w, int prefs, int mrefs, int parity, int mode);
+#if defined (__GNUC__)
+#define HAVE_FILTER_LINE_AVX2 1
+void filter_line_x86_64_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+#endif
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+void filter_line_neon (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
 #endif
 
+static YadifFilterLineFunc
+yadif_get_filter_line (int *step, int *spatial)
+{
+#if HAVE_CPU_X86_64
+  /* the x86 versions always do the spatial check */
+  *spatial = 1;
+#ifdef HAVE_FILTER_LINE_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    *step = 16;
+    return filter_line_x86_64_avx2;
+  }
+#endif
+  *step = 8;
+  return filter_line_x86_64;
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+  *spatial = -1;
+  *step = 8;
+  return filter_line_neon;
+#else
+  *spatial = -1;
+  *step = 1;
+  return filter_line_c;
+#endif
+}
+
+void yadif_filter (GstYadif * yadif, int parity, int tff, int stripe,
+    int n_stripes);
+
+/* Filters the rows of stripe out of n_stripes in each component. Every line
+ * only writes to its own row so stripes can run in parallel. */
 void
-yadif_filter (GstYadif * yadif, int parity, int tff)
+yadif_filter (GstYadif * yadif, int parity, int tff, int stripe,
+    int n_stripes)
 {
+  static YadifFilterLineFunc filter_line = NULL;
+  static int step, spatial;
   int y, i;
   const GstVideoInfo *vi = &yadif->video_info;
   const GstVideoFormatInfo *vfi = vi->finfo;
 
+  if (g_once_init_enter (&filter_line))
+    g_once_init_leave (&filter_line, yadif_get_filter_line (&step, &spatial));
+
   for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (vfi); i++) {
     int w = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (vfi, i, vi->width);
     int h = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (vfi, i, vi->height);
     int refs = GST_VIDEO_INFO_COMP_STRIDE (vi, i);
     int df = GST_VIDEO_INFO_COMP_PSTRIDE (vi, i);
+    int y_start = h * stripe / n_stripes;
+    int y_end = h * (stripe + 1) / n_stripes;
+    /* the vector versions only get whole vectors, so that they never write
+     * past the end of the row, the remaining pixels are done in C */
+    int w_vec = w - w % step;
     guint8 *prev_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->prev_frame, i);
     guint8 *cur_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->cur_frame, i);
     guint8 *next_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->next_frame, i);
     guint8 *dest_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->dest_frame, i);
 
-    for (y = 0; y < h; y++) {
+    for (y = y_start; y < y_end; y++) {
       if ((y ^ parity) & 1) {
         guint8 *prev = prev_data + y * refs;
         guint8 *cur = cur_data + y * refs;
         guint8 *next = next_data + y * refs;
         guint8 *dst = dest_data + y * refs;
         int mode = ((y == 1) || (y + 2 == h)) ? 2 : yadif->mode;
-#if HAVE_CPU_X86_64
-        if (0) {
-          filter_line_c (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        } else {
-          filter_line_x86_64 (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        }
-#else
-        filter_line_c (dst, prev, cur, next, w,
-            y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-#endif
+        int prefs = y + 1 < h ? refs : -refs;
+        int mrefs = y ? -refs : refs;
+
+        if (w_vec > 0)
+          filter_line (dst, prev, cur, next, w_vec, prefs, mrefs,
+              parity ^ tff, mode);
+        if (w_vec < w)
+          filter_line_c_full (dst + w_vec, prev + w_vec, cur + w_vec,
+              next + w_vec, w - w_vec, prefs, mrefs, parity ^ tff, mode,
+              spatial >= 0 ? spatial : (mrefs > 0 && prefs > 0));
       } else {
         guint8 *dst = dest_data + y * refs;
         guint8 *cur = cur_data + y * refs;
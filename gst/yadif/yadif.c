@@ -104,4 +104,229 @@ filter_line_x86_64 (guint8 * dst,
   yadif_filter_line_sse2 (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
 }
 
+#if defined (__GNUC__)
+#include <immintrin.h>
+
+/* Same computation as the SSE2 version on 16 pixels at a time, each one in
+ * a 16 bit lane. w must be a multiple of 16. */
+#define LOAD_AVX2(p) \
+    _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (p)))
+#define ABSDIFF_AVX2(a,b) _mm256_abs_epi16 (_mm256_sub_epi16 (a, b))
+#define SCORE_AVX2(j) \
+    _mm256_add_epi16 (_mm256_add_epi16 ( \
+            ABSDIFF_AVX2 (LOAD_AVX2 (cur + mrefs - 1 + (j)), \
+                LOAD_AVX2 (cur + prefs - 1 - (j))), \
+            ABSDIFF_AVX2 (LOAD_AVX2 (cur + mrefs + (j)), \
+                LOAD_AVX2 (cur + prefs - (j)))), \
+        ABSDIFF_AVX2 (LOAD_AVX2 (cur + mrefs + 1 + (j)), \
+            LOAD_AVX2 (cur + prefs + 1 - (j))))
+#define CHECK_AVX2(j) \
+    mask = _mm256_cmpgt_epi16 (spatial_score, score); \
+    spatial_score = _mm256_min_epi16 (spatial_score, score); \
+    spatial_pred = _mm256_blendv_epi8 (spatial_pred, \
+        _mm256_srli_epi16 (_mm256_add_epi16 (LOAD_AVX2 (cur + mrefs + (j)), \
+                LOAD_AVX2 (cur + prefs - (j))), 1), mask);
+/* pretend not to have checked dir=2 if dir=1 was bad, like the C version */
+#define PENALTY_AVX2 \
+    _mm256_andnot_si256 (mask, _mm256_set1_epi16 (1 << 14))
+
+void filter_line_x86_64_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+__attribute__ ((target ("avx2")))
+void
+filter_line_x86_64_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+  int x;
+
+  for (x = 0; x < w; x += 16) {
+    __m256i c = LOAD_AVX2 (cur + mrefs);
+    __m256i e = LOAD_AVX2 (cur + prefs);
+    __m256i p2 = LOAD_AVX2 (prev2);
+    __m256i n2 = LOAD_AVX2 (next2);
+    __m256i d = _mm256_srli_epi16 (_mm256_add_epi16 (p2, n2), 1);
+    __m256i temporal_diff0 = ABSDIFF_AVX2 (p2, n2);
+    __m256i temporal_diff1 =
+        _mm256_srli_epi16 (_mm256_add_epi16 (ABSDIFF_AVX2 (LOAD_AVX2 (prev +
+                    mrefs), c), ABSDIFF_AVX2 (LOAD_AVX2 (prev + prefs), e)), 1);
+    __m256i temporal_diff2 =
+        _mm256_srli_epi16 (_mm256_add_epi16 (ABSDIFF_AVX2 (LOAD_AVX2 (next +
+                    mrefs), c), ABSDIFF_AVX2 (LOAD_AVX2 (next + prefs), e)), 1);
+    __m256i diff =
+        _mm256_max_epi16 (_mm256_max_epi16 (_mm256_srli_epi16 (temporal_diff0,
+                1), temporal_diff1), temporal_diff2);
+    __m256i spatial_pred = _mm256_srli_epi16 (_mm256_add_epi16 (c, e), 1);
+    __m256i spatial_score, score, mask;
+    __m128i out;
+
+    spatial_score =
+        _mm256_sub_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (ABSDIFF_AVX2
+                (LOAD_AVX2 (cur + mrefs - 1), LOAD_AVX2 (cur + prefs - 1)),
+                ABSDIFF_AVX2 (c, e)), ABSDIFF_AVX2 (LOAD_AVX2 (cur + mrefs + 1),
+                LOAD_AVX2 (cur + prefs + 1))), _mm256_set1_epi16 (1));
+
+    score = SCORE_AVX2 (-1);
+    CHECK_AVX2 (-1);
+    score = _mm256_add_epi16 (SCORE_AVX2 (-2), PENALTY_AVX2);
+    CHECK_AVX2 (-2);
+    score = SCORE_AVX2 (1);
+    CHECK_AVX2 (1);
+    score = _mm256_add_epi16 (SCORE_AVX2 (2), PENALTY_AVX2);
+    CHECK_AVX2 (2);
+
+    if (mode < 2) {
+      __m256i b = _mm256_srli_epi16 (_mm256_add_epi16 (LOAD_AVX2 (prev2 +
+                  2 * mrefs), LOAD_AVX2 (next2 + 2 * mrefs)), 1);
+      __m256i f = _mm256_srli_epi16 (_mm256_add_epi16 (LOAD_AVX2 (prev2 +
+                  2 * prefs), LOAD_AVX2 (next2 + 2 * prefs)), 1);
+      __m256i dc = _mm256_sub_epi16 (d, c);
+      __m256i de = _mm256_sub_epi16 (d, e);
+      __m256i bc = _mm256_sub_epi16 (b, c);
+      __m256i fe = _mm256_sub_epi16 (f, e);
+      __m256i max = _mm256_max_epi16 (_mm256_max_epi16 (de, dc),
+          _mm256_min_epi16 (bc, fe));
+      __m256i min = _mm256_min_epi16 (_mm256_min_epi16 (de, dc),
+          _mm256_max_epi16 (bc, fe));
+
+      diff = _mm256_max_epi16 (_mm256_max_epi16 (diff, min),
+          _mm256_sub_epi16 (_mm256_setzero_si256 (), max));
+    }
+
+    spatial_pred = _mm256_min_epi16 (_mm256_max_epi16 (spatial_pred,
+            _mm256_sub_epi16 (d, diff)), _mm256_add_epi16 (d, diff));
+
+    out = _mm_packus_epi16 (_mm256_castsi256_si128 (spatial_pred),
+        _mm256_extracti128_si256 (spatial_pred, 1));
+    _mm_storeu_si128 ((__m128i *) dst, out);
+
+    dst += 16;
+    prev += 16;
+    cur += 16;
+    next += 16;
+    prev2 += 16;
+    next2 += 16;
+  }
+}
+
+#undef LOAD_AVX2
+#undef ABSDIFF_AVX2
+#undef SCORE_AVX2
+#undef CHECK_AVX2
+#undef PENALTY_AVX2
+#endif
+
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+
+/* Same computation as filter_line_c on 8 pixels at a time, each one in a 16
+ * bit lane. w must be a multiple of 8. */
+#define LOAD_NEON(p) vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (p)))
+#define ABSDIFF_NEON(a,b) vabdq_s16 (a, b)
+#define SCORE_NEON(j) \
+    vaddq_s16 (vaddq_s16 ( \
+            ABSDIFF_NEON (LOAD_NEON (cur + mrefs - 1 + (j)), \
+                LOAD_NEON (cur + prefs - 1 - (j))), \
+            ABSDIFF_NEON (LOAD_NEON (cur + mrefs + (j)), \
+                LOAD_NEON (cur + prefs - (j)))), \
+        ABSDIFF_NEON (LOAD_NEON (cur + mrefs + 1 + (j)), \
+            LOAD_NEON (cur + prefs + 1 - (j))))
+#define CHECK_NEON(j) \
+    mask = vcltq_s16 (score, spatial_score); \
+    spatial_score = vminq_s16 (spatial_score, score); \
+    spatial_pred = vbslq_s16 (mask, \
+        vshrq_n_s16 (vaddq_s16 (LOAD_NEON (cur + mrefs + (j)), \
+                LOAD_NEON (cur + prefs - (j))), 1), spatial_pred);
+/* pretend not to have checked dir=2 if dir=1 was bad, like the C version */
+#define PENALTY_NEON \
+    vreinterpretq_s16_u16 (vbicq_u16 (vdupq_n_u16 (1 << 14), mask))
+
+void filter_line_neon (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+void
+filter_line_neon (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+  int x;
+
+  for (x = 0; x < w; x += 8) {
+    int16x8_t c = LOAD_NEON (cur + mrefs);
+    int16x8_t e = LOAD_NEON (cur + prefs);
+    int16x8_t p2 = LOAD_NEON (prev2);
+    int16x8_t n2 = LOAD_NEON (next2);
+    int16x8_t d = vshrq_n_s16 (vaddq_s16 (p2, n2), 1);
+    int16x8_t temporal_diff0 = ABSDIFF_NEON (p2, n2);
+    int16x8_t temporal_diff1 =
+        vshrq_n_s16 (vaddq_s16 (ABSDIFF_NEON (LOAD_NEON (prev + mrefs), c),
+            ABSDIFF_NEON (LOAD_NEON (prev + prefs), e)), 1);
+    int16x8_t temporal_diff2 =
+        vshrq_n_s16 (vaddq_s16 (ABSDIFF_NEON (LOAD_NEON (next + mrefs), c),
+            ABSDIFF_NEON (LOAD_NEON (next + prefs), e)), 1);
+    int16x8_t diff = vmaxq_s16 (vmaxq_s16 (vshrq_n_s16 (temporal_diff0, 1),
+            temporal_diff1), temporal_diff2);
+    int16x8_t spatial_pred = vshrq_n_s16 (vaddq_s16 (c, e), 1);
+
+    if (mrefs > 0 && prefs > 0) {
+      int16x8_t spatial_score, score;
+      uint16x8_t mask;
+
+      spatial_score =
+          vsubq_s16 (vaddq_s16 (vaddq_s16 (ABSDIFF_NEON (LOAD_NEON (cur +
+                          mrefs - 1), LOAD_NEON (cur + prefs - 1)),
+                  ABSDIFF_NEON (c, e)), ABSDIFF_NEON (LOAD_NEON (cur + mrefs +
+                      1), LOAD_NEON (cur + prefs + 1))), vdupq_n_s16 (1));
+
+      score = SCORE_NEON (-1);
+      CHECK_NEON (-1);
+      score = vaddq_s16 (SCORE_NEON (-2), PENALTY_NEON);
+      CHECK_NEON (-2);
+      score = SCORE_NEON (1);
+      CHECK_NEON (1);
+      score = vaddq_s16 (SCORE_NEON (2), PENALTY_NEON);
+      CHECK_NEON (2);
+    }
+
+    if (mode < 2) {
+      int16x8_t b = vshrq_n_s16 (vaddq_s16 (LOAD_NEON (prev2 + 2 * mrefs),
+              LOAD_NEON (next2 + 2 * mrefs)), 1);
+      int16x8_t f = vshrq_n_s16 (vaddq_s16 (LOAD_NEON (prev2 + 2 * prefs),
+              LOAD_NEON (next2 + 2 * prefs)), 1);
+      int16x8_t dc = vsubq_s16 (d, c);
+      int16x8_t de = vsubq_s16 (d, e);
+      int16x8_t bc = vsubq_s16 (b, c);
+      int16x8_t fe = vsubq_s16 (f, e);
+      int16x8_t max = vmaxq_s16 (vmaxq_s16 (de, dc), vminq_s16 (bc, fe));
+      int16x8_t min = vminq_s16 (vminq_s16 (de, dc), vmaxq_s16 (bc, fe));
+
+      diff = vmaxq_s16 (vmaxq_s16 (diff, min), vnegq_s16 (max));
+    }
+
+    spatial_pred = vminq_s16 (vmaxq_s16 (spatial_pred, vsubq_s16 (d, diff)),
+        vaddq_s16 (d, diff));
+
+    vst1_u8 (dst, vqmovun_s16 (spatial_pred));
+
+    dst += 8;
+    prev += 8;
+    cur += 8;
+    next += 8;
+    prev2 += 8;
+    next2 += 8;
+  }
+}
+
+#undef LOAD_NEON
+#undef ABSDIFF_NEON
+#undef SCORE_NEON
+#undef CHECK_NEON
+#undef PENALTY_NEON
 #endif
@@ -71,6 +71,7 @@ static struct
   jclass klass;
   jmethodID configure;
   jmethodID create_by_codec_name;
+  jmethodID create_input_surface;
   jmethodID dequeue_input_buffer;
   jmethodID dequeue_output_buffer;
   jmethodID flush;
@@ -82,6 +83,7 @@ static struct
   jmethodID queue_input_buffer;
   jmethodID release;
   jmethodID release_output_buffer;
+  jmethodID signal_end_of_input_stream;
   jmethodID start;
   jmethodID stop;
 } media_codec;
@@ -615,6 +617,60 @@ gst_amc_codec_release_output_buffer (GstAmcCodec * codec, gint index,
       media_codec.release_output_buffer, index, render);
 }
 
+/* Must be called after gst_amc_codec_configure() and before
+ * gst_amc_codec_start(). Returns a global reference to an
+ * android.view.Surface */
+jobject
+gst_amc_codec_create_input_surface (GstAmcCodec * codec, GError ** err)
+{
+  JNIEnv *env;
+  jobject object = NULL;
+  jobject ret;
+
+  g_return_val_if_fail (codec != NULL, NULL);
+
+  env = gst_amc_jni_get_env ();
+
+  if (!media_codec.create_input_surface) {
+    gst_amc_jni_set_error (env, err, GST_LIBRARY_ERROR,
+        GST_LIBRARY_ERROR_SETTINGS,
+        "Input surfaces are not supported (Android < 18)");
+    return NULL;
+  }
+
+  if (!gst_amc_jni_call_object_method (env, err, codec->object,
+          media_codec.create_input_surface, &object))
+    return NULL;
+
+  ret = gst_amc_jni_object_make_global (env, object);
+  if (!ret)
+    gst_amc_jni_set_error (env, err, GST_LIBRARY_ERROR,
+        GST_LIBRARY_ERROR_SETTINGS,
+        "Failed to create global surface reference");
+
+  return ret;
+}
+
+gboolean
+gst_amc_codec_signal_end_of_input_stream (GstAmcCodec * codec, GError ** err)
+{
+  JNIEnv *env;
+
+  g_return_val_if_fail (codec != NULL, FALSE);
+
+  env = gst_amc_jni_get_env ();
+
+  if (!media_codec.signal_end_of_input_stream) {
+    gst_amc_jni_set_error (env, err, GST_LIBRARY_ERROR,
+        GST_LIBRARY_ERROR_SETTINGS,
+        "Input surfaces are not supported (Android < 18)");
+    return FALSE;
+  }
+
+  return gst_amc_jni_call_void_method (env, err, codec->object,
+      media_codec.signal_end_of_input_stream);
+}
+
 GstAmcFormat *
 gst_amc_format_new_audio (const gchar * mime, gint sample_rate, gint channels,
     GError ** err)
@@ -1190,6 +1246,20 @@ get_java_classes (void)
   if ((*env)->ExceptionCheck (env))
     (*env)->ExceptionClear (env);
 
+  /* Android >= 18 */
+  media_codec.create_input_surface =
+      (*env)->GetMethodID (env, media_codec.klass, "createInputSurface",
+      "()Landroid/view/Surface;");
+  if ((*env)->ExceptionCheck (env))
+    (*env)->ExceptionClear (env);
+
+  /* Android >= 18 */
+  media_codec.signal_end_of_input_stream =
+      (*env)->GetMethodID (env, media_codec.klass, "signalEndOfInputStream",
+      "()V");
+  if ((*env)->ExceptionCheck (env))
+    (*env)->ExceptionClear (env);
+
   tmp = (*env)->FindClass (env, "android/media/MediaCodec$BufferInfo");
   if (!tmp) {
     ret = FALSE;
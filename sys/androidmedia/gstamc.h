@@ -100,6 +100,9 @@ gint gst_amc_codec_dequeue_output_buffer (GstAmcCodec * codec, GstAmcBufferInfo
 gboolean gst_amc_codec_queue_input_buffer (GstAmcCodec * codec, gint index, const GstAmcBufferInfo *info, GError **err);
 gboolean gst_amc_codec_release_output_buffer (GstAmcCodec * codec, gint index, gboolean render, GError **err);
 
+jobject gst_amc_codec_create_input_surface (GstAmcCodec * codec, GError **err);
+gboolean gst_amc_codec_signal_end_of_input_stream (GstAmcCodec * codec, GError **err);
+
 
 GstAmcFormat * gst_amc_format_new_audio (const gchar *mime, gint sample_rate, gint channels, GError **err);
 GstAmcFormat * gst_amc_format_new_video (const gchar *mime, gint width, gint height, GError **err);
@@ -35,6 +35,10 @@
 #include <gst/gst.h>
 #include <string.h>
 
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <android/native_window_jni.h>
+
 #ifdef HAVE_ORC
 #include <orc/orc.h>
 #else
@@ -88,6 +92,10 @@ static GstFlowReturn gst_amc_video_enc_handle_frame (GstVideoEncoder * encoder,
 static GstFlowReturn gst_amc_video_enc_finish (GstVideoEncoder * encoder);
 
 static GstFlowReturn gst_amc_video_enc_drain (GstAmcVideoEnc * self);
+static gboolean gst_amc_video_enc_sink_query (GstVideoEncoder * encoder,
+    GstQuery * query);
+static void gst_amc_video_enc_set_context (GstElement * element,
+    GstContext * context);
 
 #define BIT_RATE_DEFAULT (2 * 1024 * 1024)
 #define I_FRAME_INTERVAL_DEFAULT 0
@@ -226,9 +234,12 @@ create_amc_format (GstAmcVideoEnc * encoder, GstVideoCodecState * input_state,
     return NULL;
   }
 
-  color_format =
-      gst_amc_video_format_to_color_format (klass->codec_info,
-      mime, info->finfo->format);
+  if (encoder->use_input_surface)
+    color_format = COLOR_FormatAndroidOpaque;
+  else
+    color_format =
+        gst_amc_video_format_to_color_format (klass->codec_info,
+        mime, info->finfo->format);
   if (color_format == -1)
     goto video_format_failed_to_convert;
 
@@ -275,6 +286,17 @@ create_amc_format (GstAmcVideoEnc * encoder, GstVideoCodecState * input_state,
     GST_ELEMENT_WARNING_FROM_ERROR (encoder, err);
 
   encoder->format = info->finfo->format;
+  if (encoder->use_input_surface) {
+    /* Frames never go through a ByteBuffer, only keep the size around
+     * to detect format changes */
+    memset (&encoder->color_format_info, 0,
+        sizeof (encoder->color_format_info));
+    encoder->color_format_info.color_format = color_format;
+    encoder->color_format_info.width = info->width;
+    encoder->color_format_info.height = info->height;
+    return format;
+  }
+
   if (!gst_amc_color_format_info_set (&encoder->color_format_info,
           klass->codec_info, mime, color_format, info->width, info->height,
           stride, slice_height, 0, 0, 0, 0))
@@ -423,6 +445,23 @@ unsupported_level:
   return NULL;
 }
 
+static gboolean
+codec_info_supports_input_surface (const GstAmcCodecInfo * codec_info)
+{
+  gint i, j;
+
+  for (i = 0; i < codec_info->n_supported_types; i++) {
+    const GstAmcCodecType *type = &codec_info->supported_types[i];
+
+    for (j = 0; j < type->n_color_formats; j++) {
+      if (type->color_formats[j] == COLOR_FormatAndroidOpaque)
+        return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 static void
 gst_amc_video_enc_base_init (gpointer g_class)
 {
@@ -442,6 +481,21 @@ gst_amc_video_enc_base_init (gpointer g_class)
   videoenc_class->codec_info = codec_info;
 
   gst_amc_codec_info_to_caps (codec_info, &sink_caps, &src_caps);
+
+  /* Codecs accepting opaque input can be fed through an input
+   * surface, rendering GL textures into it without any copies */
+  if (codec_info_supports_input_surface (codec_info)) {
+    GstCaps *gl_caps;
+
+    gl_caps =
+        gst_caps_from_string ("video/x-raw("
+        GST_CAPS_FEATURE_MEMORY_GL_MEMORY "), format = (string) RGBA, "
+        "texture-target = (string) 2D, width = (int) [ 1, max ], "
+        "height = (int) [ 1, max ], framerate = (fraction) [ 0, max ]");
+    gst_caps_append (gl_caps, sink_caps);
+    sink_caps = gl_caps;
+  }
+
   /* Add pad templates */
   templ =
       gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS, sink_caps);
@@ -536,6 +590,8 @@ gst_amc_video_enc_class_init (GstAmcVideoEncClass * klass)
 
   element_class->change_state =
       GST_DEBUG_FUNCPTR (gst_amc_video_enc_change_state);
+  element_class->set_context =
+      GST_DEBUG_FUNCPTR (gst_amc_video_enc_set_context);
 
   videoenc_class->start = GST_DEBUG_FUNCPTR (gst_amc_video_enc_start);
   videoenc_class->stop = GST_DEBUG_FUNCPTR (gst_amc_video_enc_stop);
@@ -546,6 +602,7 @@ gst_amc_video_enc_class_init (GstAmcVideoEncClass * klass)
   videoenc_class->handle_frame =
       GST_DEBUG_FUNCPTR (gst_amc_video_enc_handle_frame);
   videoenc_class->finish = GST_DEBUG_FUNCPTR (gst_amc_video_enc_finish);
+  videoenc_class->sink_query = GST_DEBUG_FUNCPTR (gst_amc_video_enc_sink_query);
 
   g_object_class_install_property (gobject_class, PROP_BIT_RATE,
       g_param_spec_uint ("bitrate", "Bitrate", "Bitrate in bit/sec", 1,
@@ -612,6 +669,21 @@ gst_amc_video_enc_close (GstVideoEncoder * encoder)
   self->started = FALSE;
   self->flushing = TRUE;
 
+  if (self->gl_context) {
+    gst_object_unref (self->gl_context);
+    self->gl_context = NULL;
+  }
+
+  if (self->gl_display) {
+    gst_object_unref (self->gl_display);
+    self->gl_display = NULL;
+  }
+
+  if (self->other_gl_context) {
+    gst_object_unref (self->other_gl_context);
+    self->other_gl_context = NULL;
+  }
+
   GST_DEBUG_OBJECT (self, "Closed encoder");
 
   return TRUE;
@@ -628,6 +700,37 @@ gst_amc_video_enc_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_amc_video_enc_set_context (GstElement * element, GstContext * context)
+{
+  GstAmcVideoEnc *self = GST_AMC_VIDEO_ENC (element);
+
+  gst_gl_handle_set_context (element, context, &self->gl_display,
+      &self->other_gl_context);
+
+  GST_ELEMENT_CLASS (parent_class)->set_context (element, context);
+}
+
+static gboolean
+gst_amc_video_enc_sink_query (GstVideoEncoder * encoder, GstQuery * query)
+{
+  GstAmcVideoEnc *self = GST_AMC_VIDEO_ENC (encoder);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CONTEXT:
+    {
+      if (gst_gl_handle_context_query ((GstElement *) self, query,
+              self->gl_display, self->gl_context, self->other_gl_context))
+        return TRUE;
+      break;
+    }
+    default:
+      break;
+  }
+
+  return GST_VIDEO_ENCODER_CLASS (parent_class)->sink_query (encoder, query);
+}
+
 static GstStateChangeReturn
 gst_amc_video_enc_change_state (GstElement * element, GstStateChange transition)
 {
@@ -1183,6 +1286,262 @@ got_null_output_buffer:
   }
 }
 
+typedef EGLBoolean (*PresentationTimeANDROIDFunc) (EGLDisplay display,
+    EGLSurface surface, khronos_stime_nanoseconds_t time);
+
+/* *INDENT-OFF* */
+static const GLfloat surface_vertices[] = {
+   1.0f,  1.0f, 0.0f, 1.0f, 0.0f,
+  -1.0f,  1.0f, 0.0f, 0.0f, 0.0f,
+  -1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+   1.0f, -1.0f, 0.0f, 1.0f, 1.0f
+};
+/* *INDENT-ON* */
+
+static const GLushort surface_indices[] = { 0, 1, 2, 0, 2, 3 };
+
+typedef struct
+{
+  GstAmcVideoEnc *self;
+  guint texture;
+  GstClockTime timestamp;
+  gboolean result;
+} RenderFrameData;
+
+static gboolean
+_caps_have_gl_memory (GstCaps * caps)
+{
+  GstCapsFeatures *features;
+
+  if (!caps || gst_caps_is_empty (caps))
+    return FALSE;
+
+  if (!(features = gst_caps_get_features (caps, 0)))
+    return FALSE;
+
+  return gst_caps_features_contains (features,
+      GST_CAPS_FEATURE_MEMORY_GL_MEMORY);
+}
+
+static gboolean
+gst_amc_video_enc_ensure_gl_context (GstAmcVideoEnc * self)
+{
+  GError *error = NULL;
+
+  if (!gst_gl_ensure_element_data (self, &self->gl_display,
+          &self->other_gl_context))
+    return FALSE;
+
+  if (!self->gl_context)
+    gst_gl_query_local_gl_context (GST_ELEMENT (self), GST_PAD_SINK,
+        &self->gl_context);
+
+  if (!self->gl_context) {
+    GST_OBJECT_LOCK (self->gl_display);
+    do {
+      if (self->gl_context) {
+        gst_object_unref (self->gl_context);
+        self->gl_context = NULL;
+      }
+      self->gl_context =
+          gst_gl_display_get_gl_context_for_thread (self->gl_display, NULL);
+      if (!self->gl_context) {
+        if (!gst_gl_display_create_context (self->gl_display,
+                self->other_gl_context, &self->gl_context, &error)) {
+          GST_OBJECT_UNLOCK (self->gl_display);
+          goto context_error;
+        }
+      }
+    } while (!gst_gl_display_add_context (self->gl_display,
+            self->gl_context));
+    GST_OBJECT_UNLOCK (self->gl_display);
+  }
+
+  if (gst_gl_context_get_gl_platform (self->gl_context) !=
+      GST_GL_PLATFORM_EGL) {
+    GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS, (NULL),
+        ("Input surfaces require an EGL context"));
+    return FALSE;
+  }
+
+  return TRUE;
+
+context_error:
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, NOT_FOUND, ("%s", error->message),
+        (NULL));
+    g_clear_error (&error);
+    return FALSE;
+  }
+}
+
+/* Called from the GL thread */
+static void
+_create_egl_surface (GstGLContext * context, GstAmcVideoEnc * self)
+{
+  EGLDisplay display =
+      (EGLDisplay) gst_gl_display_get_handle (context->display);
+  EGLContext egl_context =
+      (EGLContext) gst_gl_context_get_gl_context (context);
+  EGLint attribs[] = { EGL_CONFIG_ID, 0, EGL_NONE };
+  EGLint n_configs = 0;
+  EGLConfig config;
+  ANativeWindow *window;
+  GError *error = NULL;
+
+  /* The surface has to be compatible with the context to be able to
+   * make both current, so use the context's own config */
+  eglQueryContext (display, egl_context, EGL_CONFIG_ID, &attribs[1]);
+  if (!eglChooseConfig (display, attribs, &config, 1, &n_configs)
+      || n_configs < 1) {
+    GST_ERROR_OBJECT (self, "Failed to get the EGL config of the context");
+    return;
+  }
+
+  window = ANativeWindow_fromSurface (gst_amc_jni_get_env (), self->surface);
+  if (!window) {
+    GST_ERROR_OBJECT (self, "Failed to get a window for the input surface");
+    return;
+  }
+
+  self->egl_surface = eglCreateWindowSurface (display, config, window, NULL);
+  ANativeWindow_release (window);
+  if (self->egl_surface == EGL_NO_SURFACE) {
+    GST_ERROR_OBJECT (self, "Failed to create EGL surface: 0x%x",
+        eglGetError ());
+    self->egl_surface = NULL;
+    return;
+  }
+
+  /* Without this the codec uses the time of eglSwapBuffers() */
+  self->presentation_time_func =
+      eglGetProcAddress ("eglPresentationTimeANDROID");
+  if (!self->presentation_time_func)
+    GST_WARNING_OBJECT (self, "eglPresentationTimeANDROID not available");
+
+  self->shader = gst_gl_shader_new_default (context, &error);
+  if (!self->shader) {
+    GST_ERROR_OBJECT (self, "Failed to create shader: %s", error->message);
+    g_clear_error (&error);
+    eglDestroySurface (display, self->egl_surface);
+    self->egl_surface = NULL;
+  }
+}
+
+/* Called from the GL thread */
+static void
+_destroy_egl_surface (GstGLContext * context, GstAmcVideoEnc * self)
+{
+  if (self->shader) {
+    gst_object_unref (self->shader);
+    self->shader = NULL;
+  }
+
+  if (self->egl_surface) {
+    eglDestroySurface ((EGLDisplay) gst_gl_display_get_handle
+        (context->display), self->egl_surface);
+    self->egl_surface = NULL;
+  }
+}
+
+/* Called from the GL thread */
+static void
+_render_frame (GstGLContext * context, RenderFrameData * data)
+{
+  GstAmcVideoEnc *self = data->self;
+  const GstGLFuncs *gl = context->gl_vtable;
+  EGLDisplay display =
+      (EGLDisplay) gst_gl_display_get_handle (context->display);
+  EGLContext egl_context =
+      (EGLContext) gst_gl_context_get_gl_context (context);
+  EGLSurface draw_surface = eglGetCurrentSurface (EGL_DRAW);
+  EGLSurface read_surface = eglGetCurrentSurface (EGL_READ);
+  GLint pos_attr, tex_attr;
+
+  if (!eglMakeCurrent (display, self->egl_surface, self->egl_surface,
+          egl_context)) {
+    GST_ERROR_OBJECT (self, "Failed to make input surface current: 0x%x",
+        eglGetError ());
+    return;
+  }
+
+  gl->Viewport (0, 0, GST_VIDEO_INFO_WIDTH (&self->input_state->info),
+      GST_VIDEO_INFO_HEIGHT (&self->input_state->info));
+
+  gst_gl_shader_use (self->shader);
+  gl->ActiveTexture (GL_TEXTURE0);
+  gl->BindTexture (GL_TEXTURE_2D, data->texture);
+  gst_gl_shader_set_uniform_1i (self->shader, "tex", 0);
+
+  pos_attr = gst_gl_shader_get_attribute_location (self->shader, "a_position");
+  tex_attr = gst_gl_shader_get_attribute_location (self->shader, "a_texcoord");
+
+  gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+  gl->VertexAttribPointer (pos_attr, 3, GL_FLOAT, GL_FALSE,
+      5 * sizeof (GLfloat), surface_vertices);
+  gl->VertexAttribPointer (tex_attr, 2, GL_FLOAT, GL_FALSE,
+      5 * sizeof (GLfloat), surface_vertices + 3);
+  gl->EnableVertexAttribArray (pos_attr);
+  gl->EnableVertexAttribArray (tex_attr);
+
+  gl->DrawElements (GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, surface_indices);
+
+  gl->DisableVertexAttribArray (pos_attr);
+  gl->DisableVertexAttribArray (tex_attr);
+  gl->BindTexture (GL_TEXTURE_2D, 0);
+  gst_gl_context_clear_shader (context);
+
+  if (self->presentation_time_func)
+    ((PresentationTimeANDROIDFunc) self->presentation_time_func) (display,
+        self->egl_surface, data->timestamp);
+
+  /* Blocks while the codec has no free input slot */
+  data->result = eglSwapBuffers (display, self->egl_surface);
+  if (!data->result)
+    GST_ERROR_OBJECT (self, "Failed to swap buffers: 0x%x", eglGetError ());
+
+  eglMakeCurrent (display, draw_surface, read_surface, egl_context);
+}
+
+static gboolean
+gst_amc_video_enc_create_input_surface (GstAmcVideoEnc * self)
+{
+  GError *err = NULL;
+
+  self->surface = gst_amc_codec_create_input_surface (self->codec, &err);
+  if (!self->surface) {
+    GST_ERROR_OBJECT (self, "Failed to create input surface");
+    GST_ELEMENT_ERROR_FROM_ERROR (self, err);
+    return FALSE;
+  }
+
+  gst_gl_context_thread_add (self->gl_context,
+      (GstGLContextThreadFunc) _create_egl_surface, self);
+  if (!self->egl_surface) {
+    GST_ELEMENT_ERROR (self, RESOURCE, SETTINGS, (NULL),
+        ("Failed to set up rendering into the input surface"));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_amc_video_enc_release_input_surface (GstAmcVideoEnc * self)
+{
+  if (self->gl_context && (self->egl_surface || self->shader))
+    gst_gl_context_thread_add (self->gl_context,
+        (GstGLContextThreadFunc) _destroy_egl_surface, self);
+
+  if (self->surface) {
+    gst_amc_jni_object_unref (gst_amc_jni_get_env (), self->surface);
+    self->surface = NULL;
+  }
+
+  self->presentation_time_func = NULL;
+  self->use_input_surface = FALSE;
+}
+
 static gboolean
 gst_amc_video_enc_start (GstVideoEncoder * encoder)
 {
@@ -1218,6 +1577,8 @@ gst_amc_video_enc_stop (GstVideoEncoder * encoder)
   }
   gst_pad_stop_task (GST_VIDEO_ENCODER_SRC_PAD (encoder));
 
+  gst_amc_video_enc_release_input_surface (self);
+
   self->downstream_flow_ret = GST_FLOW_FLUSHING;
   self->drained = TRUE;
   g_mutex_lock (&self->drain_lock);
@@ -1259,6 +1620,8 @@ gst_amc_video_enc_set_format (GstVideoEncoder * encoder,
    */
   is_format_change |= self->color_format_info.width != state->info.width;
   is_format_change |= self->color_format_info.height != state->info.height;
+  is_format_change |=
+      self->use_input_surface != _caps_have_gl_memory (state->caps);
   needs_disable = self->started;
 
   /* If the component is not started and a real format change happens
@@ -1306,6 +1669,13 @@ gst_amc_video_enc_set_format (GstVideoEncoder * encoder,
   GST_DEBUG_OBJECT (self, "chose caps %" GST_PTR_FORMAT, allowed_caps);
   allowed_caps = gst_caps_truncate (allowed_caps);
 
+  self->use_input_surface = _caps_have_gl_memory (state->caps);
+  if (self->use_input_surface) {
+    GST_DEBUG_OBJECT (self, "Rendering GL memory into an input surface");
+    if (!gst_amc_video_enc_ensure_gl_context (self))
+      goto quit;
+  }
+
   format = create_amc_format (self, state, allowed_caps);
   if (!format)
     goto quit;
@@ -1323,6 +1693,10 @@ gst_amc_video_enc_set_format (GstVideoEncoder * encoder,
     goto quit;
   }
 
+  /* Has to happen between configure() and start() */
+  if (self->use_input_surface && !gst_amc_video_enc_create_input_surface (self))
+    goto quit;
+
   if (!gst_amc_codec_start (self->codec, &err)) {
     GST_ERROR_OBJECT (self, "Failed to start codec");
     GST_ELEMENT_ERROR_FROM_ERROR (self, err);
@@ -1395,6 +1769,82 @@ gst_amc_video_enc_flush (GstVideoEncoder * encoder)
   return TRUE;
 }
 
+static GstFlowReturn
+gst_amc_video_enc_render_frame (GstAmcVideoEnc * self,
+    GstVideoCodecFrame * frame)
+{
+  GstVideoFrame vframe;
+  GstGLSyncMeta *sync_meta;
+  RenderFrameData data;
+  BufferIdentification *id;
+  GstClockTime timestamp = frame->pts;
+
+  if (!gst_video_frame_map (&vframe, &self->input_state->info,
+          frame->input_buffer, GST_MAP_READ | GST_MAP_GL))
+    goto map_error;
+
+  sync_meta = gst_buffer_get_gl_sync_meta (frame->input_buffer);
+  if (sync_meta)
+    gst_gl_sync_meta_wait (sync_meta, self->gl_context);
+
+  data.self = self;
+  data.texture = *(guint *) vframe.data[0];
+  data.timestamp =
+      GST_CLOCK_TIME_IS_VALID (timestamp) ? timestamp : self->last_upstream_ts;
+  data.result = FALSE;
+
+  /* The codec only releases surface buffers once earlier ones were
+   * encoded, so let _loop() finish frames while rendering */
+  GST_VIDEO_ENCODER_STREAM_UNLOCK (self);
+  gst_gl_context_thread_add (self->gl_context,
+      (GstGLContextThreadFunc) _render_frame, &data);
+  GST_VIDEO_ENCODER_STREAM_LOCK (self);
+  gst_video_frame_unmap (&vframe);
+
+  if (self->flushing)
+    goto flushing;
+
+  if (!data.result)
+    goto render_error;
+
+  self->last_upstream_ts = data.timestamp;
+  if (GST_CLOCK_TIME_IS_VALID (frame->duration))
+    self->last_upstream_ts += frame->duration;
+
+  /* Sync frame requests would need MediaCodec.setParameters(), which
+   * is not wrapped, so they are left to the i-frame-interval */
+  id = buffer_identification_new (data.timestamp);
+  gst_video_codec_frame_set_user_data (frame, id,
+      (GDestroyNotify) buffer_identification_free);
+
+  self->drained = FALSE;
+
+  gst_video_codec_frame_unref (frame);
+
+  return self->downstream_flow_ret;
+
+map_error:
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+        ("Failed to map GL memory"));
+    gst_video_codec_frame_unref (frame);
+    return GST_FLOW_ERROR;
+  }
+render_error:
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, WRITE, (NULL),
+        ("Failed to render into the input surface"));
+    gst_video_codec_frame_unref (frame);
+    return GST_FLOW_ERROR;
+  }
+flushing:
+  {
+    GST_DEBUG_OBJECT (self, "Flushing -- returning FLUSHING");
+    gst_video_codec_frame_unref (frame);
+    return GST_FLOW_FLUSHING;
+  }
+}
+
 static GstFlowReturn
 gst_amc_video_enc_handle_frame (GstVideoEncoder * encoder,
     GstVideoCodecFrame * frame)
@@ -1423,6 +1873,9 @@ gst_amc_video_enc_handle_frame (GstVideoEncoder * encoder,
   if (self->downstream_flow_ret != GST_FLOW_OK)
     goto downstream_error;
 
+  if (self->use_input_surface)
+    return gst_amc_video_enc_render_frame (self, frame);
+
   timestamp = frame->pts;
   duration = frame->duration;
 
@@ -1615,6 +2068,36 @@ gst_amc_video_enc_drain (GstAmcVideoEnc * self)
     return GST_FLOW_OK;
   }
 
+  if (self->use_input_surface) {
+    GST_VIDEO_ENCODER_STREAM_UNLOCK (self);
+    g_mutex_lock (&self->drain_lock);
+    self->draining = TRUE;
+
+    /* There are no input buffers, EOS goes through the surface */
+    if (gst_amc_codec_signal_end_of_input_stream (self->codec, &err)) {
+      GST_DEBUG_OBJECT (self, "Waiting until codec is drained");
+      g_cond_wait (&self->drain_cond, &self->drain_lock);
+      GST_DEBUG_OBJECT (self, "Drained codec");
+      ret = GST_FLOW_OK;
+    } else {
+      GST_ERROR_OBJECT (self, "Failed to signal end of input stream");
+      if (self->flushing) {
+        g_clear_error (&err);
+        ret = GST_FLOW_FLUSHING;
+      } else {
+        GST_ELEMENT_WARNING_FROM_ERROR (self, err);
+        ret = GST_FLOW_ERROR;
+      }
+    }
+
+    self->drained = TRUE;
+    self->draining = FALSE;
+    g_mutex_unlock (&self->drain_lock);
+    GST_VIDEO_ENCODER_STREAM_LOCK (self);
+
+    return ret;
+  }
+
   /* Make sure to release the base class stream lock, otherwise
    * _loop() can't call _finish_frame() and we might block forever
    * because no input buffers are released */
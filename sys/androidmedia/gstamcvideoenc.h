@@ -25,6 +25,7 @@
 #define __GST_AMC_VIDEO_ENC_H__
 
 #include <gst/gst.h>
+#include <gst/gl/gl.h>
 
 #include <gst/video/gstvideoencoder.h>
 
@@ -64,6 +65,17 @@ struct _GstAmcVideoEnc
   guint bitrate;
   guint i_frame_int;
 
+  /* Input surface mode: GL memory is rendered into the
+   * codec's input surface instead of being copied */
+  gboolean use_input_surface;
+  jobject surface; /* global reference */
+  gpointer egl_surface;
+  gpointer presentation_time_func;
+  GstGLDisplay *gl_display;
+  GstGLContext *gl_context;
+  GstGLContext *other_gl_context;
+  GstGLShader *shader;
+
   /* TRUE if the component is configured and saw
    * the first buffer */
   gboolean started;
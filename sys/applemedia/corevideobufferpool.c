@@ -0,0 +1,166 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "corevideobufferpool.h"
+#include "corevideobuffer.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_core_video_buffer_pool_debug);
+#define GST_CAT_DEFAULT gst_core_video_buffer_pool_debug
+
+#define gst_core_video_buffer_pool_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstCoreVideoBufferPool, gst_core_video_buffer_pool,
+    GST_TYPE_BUFFER_POOL,
+    GST_DEBUG_CATEGORY_INIT (gst_core_video_buffer_pool_debug,
+        "corevideobufferpool", 0, "Core Video buffer pool"));
+
+static const gchar **
+gst_core_video_buffer_pool_get_options (GstBufferPool * pool)
+{
+  static const gchar *options[] = { GST_BUFFER_POOL_OPTION_VIDEO_META, NULL };
+
+  return options;
+}
+
+static gboolean
+gst_core_video_buffer_pool_set_config (GstBufferPool * pool,
+    GstStructure * config)
+{
+  GstCoreVideoBufferPool *self = GST_CORE_VIDEO_BUFFER_POOL (pool);
+  GstCaps *caps;
+
+  if (!gst_buffer_pool_config_get_params (config, &caps, NULL, NULL, NULL)
+      || caps == NULL)
+    goto wrong_config;
+
+  if (!gst_video_info_from_caps (&self->info, caps))
+    goto wrong_caps;
+
+  /* the pixel buffers may be padded, users need to look at the video meta */
+  if (!gst_buffer_pool_config_has_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_META))
+    goto no_video_meta;
+
+  return GST_BUFFER_POOL_CLASS (parent_class)->set_config (pool, config);
+
+wrong_config:
+  {
+    GST_WARNING_OBJECT (pool, "invalid config");
+    return FALSE;
+  }
+wrong_caps:
+  {
+    GST_WARNING_OBJECT (pool, "failed getting video info from caps %"
+        GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+no_video_meta:
+  {
+    GST_DEBUG_OBJECT (pool, "video meta not supported by the user");
+    return FALSE;
+  }
+}
+
+static GstFlowReturn
+gst_core_video_buffer_pool_alloc_buffer (GstBufferPool * pool,
+    GstBuffer ** buffer, GstBufferPoolAcquireParams * params)
+{
+  GstCoreVideoBufferPool *self = GST_CORE_VIDEO_BUFFER_POOL (pool);
+  CVPixelBufferRef pixbuf = NULL;
+  CVReturn cv_ret;
+  GstBuffer *buf;
+
+  cv_ret = CVPixelBufferPoolCreatePixelBuffer (NULL, self->pool, &pixbuf);
+  if (cv_ret != kCVReturnSuccess) {
+    GST_WARNING_OBJECT (pool, "CVPixelBufferPoolCreatePixelBuffer failed: %d",
+        (int) cv_ret);
+    return GST_FLOW_ERROR;
+  }
+
+  buf = gst_core_video_buffer_new ((CVBufferRef) pixbuf, &self->info, NULL);
+  CVPixelBufferRelease (pixbuf);
+  if (buf == NULL)
+    return GST_FLOW_ERROR;
+
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_core_video_buffer_pool_acquire_buffer (GstBufferPool * pool,
+    GstBuffer ** buffer, GstBufferPoolAcquireParams * params)
+{
+  /* every buffer gets a fresh pixel buffer, see release_buffer() */
+  return gst_core_video_buffer_pool_alloc_buffer (pool, buffer, params);
+}
+
+static void
+gst_core_video_buffer_pool_release_buffer (GstBufferPool * pool,
+    GstBuffer * buffer)
+{
+  /* drop the buffer, the pixel buffer goes back to the CVPixelBufferPool
+   * once its last user released it */
+  GST_BUFFER_POOL_CLASS (parent_class)->free_buffer (pool, buffer);
+}
+
+static void
+gst_core_video_buffer_pool_finalize (GObject * object)
+{
+  GstCoreVideoBufferPool *self = GST_CORE_VIDEO_BUFFER_POOL (object);
+
+  CVPixelBufferPoolRelease (self->pool);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_core_video_buffer_pool_class_init (GstCoreVideoBufferPoolClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstBufferPoolClass *pool_class = (GstBufferPoolClass *) klass;
+
+  gobject_class->finalize = gst_core_video_buffer_pool_finalize;
+
+  pool_class->get_options = gst_core_video_buffer_pool_get_options;
+  pool_class->set_config = gst_core_video_buffer_pool_set_config;
+  pool_class->alloc_buffer = gst_core_video_buffer_pool_alloc_buffer;
+  pool_class->acquire_buffer = gst_core_video_buffer_pool_acquire_buffer;
+  pool_class->release_buffer = gst_core_video_buffer_pool_release_buffer;
+}
+
+static void
+gst_core_video_buffer_pool_init (GstCoreVideoBufferPool * self)
+{
+}
+
+GstBufferPool *
+gst_core_video_buffer_pool_new (CVPixelBufferPoolRef pool)
+{
+  GstCoreVideoBufferPool *self;
+
+  g_return_val_if_fail (pool != NULL, NULL);
+
+  self = g_object_new (GST_TYPE_CORE_VIDEO_BUFFER_POOL, NULL);
+  self->pool = CVPixelBufferPoolRetain (pool);
+
+  return GST_BUFFER_POOL_CAST (self);
+}
@@ -0,0 +1,62 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_CORE_VIDEO_BUFFER_POOL_H__
+#define __GST_CORE_VIDEO_BUFFER_POOL_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "CoreVideo/CoreVideo.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_CORE_VIDEO_BUFFER_POOL \
+  (gst_core_video_buffer_pool_get_type())
+#define GST_CORE_VIDEO_BUFFER_POOL(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_CORE_VIDEO_BUFFER_POOL,GstCoreVideoBufferPool))
+#define GST_IS_CORE_VIDEO_BUFFER_POOL(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_CORE_VIDEO_BUFFER_POOL))
+
+typedef struct _GstCoreVideoBufferPool GstCoreVideoBufferPool;
+typedef struct _GstCoreVideoBufferPoolClass GstCoreVideoBufferPoolClass;
+
+/* Hands out buffers wrapping the pixel buffers of a CVPixelBufferPool.
+ * Buffers are not recycled on the GStreamer side: the pixel buffer may
+ * still be used by its consumer after the GstBuffer is gone, so reuse is
+ * left to the CVPixelBufferPool */
+struct _GstCoreVideoBufferPool
+{
+  GstBufferPool parent;
+
+  CVPixelBufferPoolRef pool;
+  GstVideoInfo info;
+};
+
+struct _GstCoreVideoBufferPoolClass
+{
+  GstBufferPoolClass parent_class;
+};
+
+GType gst_core_video_buffer_pool_get_type (void);
+
+GstBufferPool * gst_core_video_buffer_pool_new (CVPixelBufferPoolRef pool);
+
+G_END_DECLS
+
+#endif /* __GST_CORE_VIDEO_BUFFER_POOL_H__ */
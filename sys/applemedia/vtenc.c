@@ -25,6 +25,7 @@
 
 #include "coremediabuffer.h"
 #include "corevideobuffer.h"
+#include "corevideobufferpool.h"
 #include "vtutil.h"
 #include <gst/pbutils/codec-utils.h>
 
@@ -35,6 +36,7 @@
 #define VTENC_DEFAULT_QUALITY 0.5
 #define VTENC_DEFAULT_MAX_KEYFRAME_INTERVAL 0
 #define VTENC_DEFAULT_MAX_KEYFRAME_INTERVAL_DURATION 0
+#define VTENC_DEFAULT_MAX_FRAME_DELAY_COUNT -1
 
 GST_DEBUG_CATEGORY (gst_vtenc_debug);
 #define GST_CAT_DEFAULT (gst_vtenc_debug)
@@ -75,7 +77,8 @@ enum
   PROP_REALTIME,
   PROP_QUALITY,
   PROP_MAX_KEYFRAME_INTERVAL,
-  PROP_MAX_KEYFRAME_INTERVAL_DURATION
+  PROP_MAX_KEYFRAME_INTERVAL_DURATION,
+  PROP_MAX_FRAME_DELAY_COUNT
 };
 
 typedef struct _GstVTEncFrame GstVTEncFrame;
@@ -101,6 +104,8 @@ static gboolean gst_vtenc_set_format (GstVideoEncoder * enc,
 static GstFlowReturn gst_vtenc_handle_frame (GstVideoEncoder * enc,
     GstVideoCodecFrame * frame);
 static GstFlowReturn gst_vtenc_finish (GstVideoEncoder * enc);
+static gboolean gst_vtenc_propose_allocation (GstVideoEncoder * enc,
+    GstQuery * query);
 static gboolean gst_vtenc_flush (GstVideoEncoder * enc);
 
 static void gst_vtenc_clear_cached_caps_downstream (GstVTEnc * self);
@@ -126,6 +131,8 @@ static void gst_vtenc_session_configure_allow_frame_reordering (GstVTEnc * self,
     VTCompressionSessionRef session, gboolean allow_frame_reordering);
 static void gst_vtenc_session_configure_realtime (GstVTEnc * self,
     VTCompressionSessionRef session, gboolean realtime);
+static void gst_vtenc_session_configure_max_frame_delay_count (GstVTEnc * self,
+    VTCompressionSessionRef session, gint max_frame_delay_count);
 
 static GstFlowReturn gst_vtenc_encode_frame (GstVTEnc * self,
     GstVideoCodecFrame * frame);
@@ -219,6 +226,7 @@ gst_vtenc_class_init (GstVTEncClass * klass)
   gstvideoencoder_class->handle_frame = gst_vtenc_handle_frame;
   gstvideoencoder_class->finish = gst_vtenc_finish;
   gstvideoencoder_class->flush = gst_vtenc_flush;
+  gstvideoencoder_class->propose_allocation = gst_vtenc_propose_allocation;
 
   g_object_class_install_property (gobject_class, PROP_BITRATE,
       g_param_spec_uint ("bitrate", "Bitrate",
@@ -257,6 +265,13 @@ gst_vtenc_class_init (GstVTEncClass * klass)
           "Maximum number of nanoseconds between keyframes (0 = no limit)", 0,
           G_MAXUINT64, VTENC_DEFAULT_MAX_KEYFRAME_INTERVAL_DURATION,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_FRAME_DELAY_COUNT,
+      g_param_spec_int ("max-frame-delay-count", "Max Frame Delay Count",
+          "Maximum number of frames the encoder may hold before outputting "
+          "a frame (-1 = unlimited)",
+          -1, G_MAXINT, VTENC_DEFAULT_MAX_FRAME_DELAY_COUNT,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -363,6 +378,30 @@ gst_vtenc_set_realtime (GstVTEnc * self, gboolean realtime)
   GST_OBJECT_UNLOCK (self);
 }
 
+static gint
+gst_vtenc_get_max_frame_delay_count (GstVTEnc * self)
+{
+  gint result;
+
+  GST_OBJECT_LOCK (self);
+  result = self->max_frame_delay_count;
+  GST_OBJECT_UNLOCK (self);
+
+  return result;
+}
+
+static void
+gst_vtenc_set_max_frame_delay_count (GstVTEnc * self,
+    gint max_frame_delay_count)
+{
+  GST_OBJECT_LOCK (self);
+  self->max_frame_delay_count = max_frame_delay_count;
+  if (self->session != NULL)
+    gst_vtenc_session_configure_max_frame_delay_count (self, self->session,
+        max_frame_delay_count);
+  GST_OBJECT_UNLOCK (self);
+}
+
 static gdouble
 gst_vtenc_get_quality (GstVTEnc * self)
 {
@@ -463,6 +502,9 @@ gst_vtenc_get_property (GObject * obj, guint prop_id, GValue * value,
       g_value_set_uint64 (value,
           gst_vtenc_get_max_keyframe_interval_duration (self));
       break;
+    case PROP_MAX_FRAME_DELAY_COUNT:
+      g_value_set_int (value, gst_vtenc_get_max_frame_delay_count (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
       break;
@@ -495,6 +537,9 @@ gst_vtenc_set_property (GObject * obj, guint prop_id, const GValue * value,
       gst_vtenc_set_max_keyframe_interval_duration (self,
           g_value_get_uint64 (value));
       break;
+    case PROP_MAX_FRAME_DELAY_COUNT:
+      gst_vtenc_set_max_frame_delay_count (self, g_value_get_int (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
       break;
@@ -821,9 +866,74 @@ gst_vtenc_flush (GstVideoEncoder * enc)
   return (ret == GST_FLOW_OK);
 }
 
+static OSType
+gst_vtenc_get_pixel_format_type (GstVideoFormat format)
+{
+  switch (format) {
+    case GST_VIDEO_FORMAT_I420:
+      return kCVPixelFormatType_420YpCbCr8Planar;
+    case GST_VIDEO_FORMAT_NV12:
+      return kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
+    case GST_VIDEO_FORMAT_UYVY:
+      return kCVPixelFormatType_422YpCbCr8;
+    default:
+      return 0;
+  }
+}
+
+static gboolean
+gst_vtenc_propose_allocation (GstVideoEncoder * enc, GstQuery * query)
+{
+  GstVTEnc *self = GST_VTENC_CAST (enc);
+  GstBufferPool *pool = NULL;
+  CVPixelBufferPoolRef cv_pool = NULL;
+  GstStructure *config;
+  GstVideoInfo info;
+  GstCaps *caps;
+  gboolean need_pool;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    goto done;
+
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  /* Offer buffers from the session's own pixel buffer pool, so that upstream
+   * writes directly into memory the encoder can consume without a copy */
+  GST_OBJECT_LOCK (self);
+  if (self->session != NULL
+      && GST_VIDEO_INFO_WIDTH (&info) == self->negotiated_width
+      && GST_VIDEO_INFO_HEIGHT (&info) == self->negotiated_height)
+    cv_pool = VTCompressionSessionGetPixelBufferPool (self->session);
+  if (cv_pool != NULL)
+    pool = gst_core_video_buffer_pool_new (cv_pool);
+  GST_OBJECT_UNLOCK (self);
+
+  if (pool == NULL)
+    goto done;
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps,
+      GST_VIDEO_INFO_SIZE (&info), 0, 0);
+  gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+  if (gst_buffer_pool_set_config (pool, config)) {
+    GST_DEBUG_OBJECT (self, "proposing Core Video buffer pool");
+    gst_query_add_allocation_pool (query, pool, GST_VIDEO_INFO_SIZE (&info),
+        0, 0);
+  } else {
+    GST_WARNING_OBJECT (self, "failed to configure Core Video buffer pool");
+  }
+  gst_object_unref (pool);
+
+done:
+  return GST_VIDEO_ENCODER_CLASS (parent_class)->propose_allocation (enc,
+      query);
+}
+
 static VTCompressionSessionRef
 gst_vtenc_create_session (GstVTEnc * self)
 {
+  OSType pixel_format_type;
   VTCompressionSessionRef session = NULL;
   CFMutableDictionaryRef encoder_spec = NULL, pb_attrs;
   OSStatus status;
@@ -849,6 +959,17 @@ gst_vtenc_create_session (GstVTEnc * self)
       self->negotiated_width);
   gst_vtutil_dict_set_i32 (pb_attrs, kCVPixelBufferHeightKey,
       self->negotiated_height);
+  pixel_format_type =
+      gst_vtenc_get_pixel_format_type (GST_VIDEO_INFO_FORMAT
+      (&self->video_info));
+  if (pixel_format_type != 0)
+    gst_vtutil_dict_set_i32 (pb_attrs, kCVPixelBufferPixelFormatTypeKey,
+        pixel_format_type);
+  /* IOSurface backing lets the hardware encoder use the pool's buffers
+   * directly */
+  gst_vtutil_dict_set_object (pb_attrs, kCVPixelBufferIOSurfacePropertiesKey,
+      (CFTypeRef) CFDictionaryCreate (NULL, NULL, NULL, 0,
+          &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks));
 
   status = VTCompressionSessionCreate (NULL,
       self->negotiated_width, self->negotiated_height,
@@ -886,6 +1007,8 @@ gst_vtenc_create_session (GstVTEnc * self)
       gst_vtenc_get_realtime (self));
   gst_vtenc_session_configure_allow_frame_reordering (self, session,
       gst_vtenc_get_allow_frame_reordering (self));
+  gst_vtenc_session_configure_max_frame_delay_count (self, session,
+      gst_vtenc_get_max_frame_delay_count (self));
   gst_vtenc_set_quality (self, self->quality);
 
   if (self->dump_properties) {
@@ -1031,6 +1154,16 @@ gst_vtenc_session_configure_realtime (GstVTEnc * self,
       realtime ? kCFBooleanTrue : kCFBooleanFalse);
 }
 
+static void
+gst_vtenc_session_configure_max_frame_delay_count (GstVTEnc * self,
+    VTCompressionSessionRef session, gint max_frame_delay_count)
+{
+  gst_vtenc_session_configure_property_int (self, session,
+      kVTCompressionPropertyKey_MaxFrameDelayCount,
+      max_frame_delay_count < 0 ? kVTUnlimitedFrameDelayCount :
+      max_frame_delay_count);
+}
+
 static OSStatus
 gst_vtenc_session_configure_property_int (GstVTEnc * self,
     VTCompressionSessionRef session, CFStringRef name, gint value)
@@ -1115,6 +1248,7 @@ gst_vtenc_encode_frame (GstVTEnc * self, GstVideoCodecFrame * frame)
 {
   CMTime ts, duration;
   GstCoreMediaMeta *meta;
+  GstCoreVideoMeta *cv_meta;
   CVPixelBufferRef pbuf = NULL;
   GstVideoCodecFrame *outframe;
   OSStatus vt_status;
@@ -1133,8 +1267,13 @@ gst_vtenc_encode_frame (GstVTEnc * self, GstVideoCodecFrame * frame)
   else
     duration = kCMTimeInvalid;
 
+  cv_meta = gst_buffer_get_core_video_meta (frame->input_buffer);
+  if (cv_meta != NULL && cv_meta->pixbuf != NULL) {
+    /* zero-copy path, the buffer came from our own pool */
+    pbuf = CVPixelBufferRetain (cv_meta->pixbuf);
+  }
   meta = gst_buffer_get_core_media_meta (frame->input_buffer);
-  if (meta != NULL) {
+  if (pbuf == NULL && meta != NULL) {
     pbuf = gst_core_media_buffer_get_pixel_buffer (frame->input_buffer);
   }
 #ifdef HAVE_IOS
@@ -1149,16 +1288,11 @@ gst_vtenc_encode_frame (GstVTEnc * self, GstVideoCodecFrame * frame)
      * sense to create a buffer pool around these at some point.
      */
 
-    switch (GST_VIDEO_INFO_FORMAT (&self->video_info)) {
-      case GST_VIDEO_FORMAT_I420:
-        pixel_format_type = kCVPixelFormatType_420YpCbCr8Planar;
-        break;
-      case GST_VIDEO_FORMAT_NV12:
-        pixel_format_type = kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
-        break;
-      default:
-        goto cv_error;
-    }
+    pixel_format_type =
+        gst_vtenc_get_pixel_format_type (GST_VIDEO_INFO_FORMAT
+        (&self->video_info));
+    if (pixel_format_type == 0)
+      goto cv_error;
 
     if (!gst_video_frame_map (&inframe, &self->video_info, frame->input_buffer,
             GST_MAP_READ))
@@ -1223,19 +1357,12 @@ gst_vtenc_encode_frame (GstVTEnc * self, GstVideoCodecFrame * frame)
             GST_VIDEO_FRAME_COMP_STRIDE (&vframe->videoframe, i);
       }
 
-      switch (GST_VIDEO_INFO_FORMAT (&self->video_info)) {
-        case GST_VIDEO_FORMAT_I420:
-          pixel_format_type = kCVPixelFormatType_420YpCbCr8Planar;
-          break;
-        case GST_VIDEO_FORMAT_NV12:
-          pixel_format_type = kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange;
-          break;
-        case GST_VIDEO_FORMAT_UYVY:
-          pixel_format_type = kCVPixelFormatType_422YpCbCr8;
-          break;
-        default:
-          gst_vtenc_frame_free (vframe);
-          goto cv_error;
+      pixel_format_type =
+          gst_vtenc_get_pixel_format_type (GST_VIDEO_INFO_FORMAT
+          (&self->video_info));
+      if (pixel_format_type == 0) {
+        gst_vtenc_frame_free (vframe);
+        goto cv_error;
       }
 
       cv_ret = CVPixelBufferCreateWithPlanarBytes (NULL,
@@ -65,6 +65,7 @@ struct _GstVTEnc
   gdouble quality;
   gint max_keyframe_interval;
   GstClockTime max_keyframe_interval_duration;
+  gint max_frame_delay_count;
   gint latency_frames;
 
   gboolean dump_properties;
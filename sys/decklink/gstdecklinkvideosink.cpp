@@ -25,6 +25,10 @@
 #include "gstdecklinkvideosink.h"
 #include <string.h>
 
+/* Alignment mask of the frames we schedule without copying, and of the
+ * buffers we propose upstream */
+#define DECKLINK_FRAME_ALIGN 63
+
 GST_DEBUG_CATEGORY_STATIC (gst_decklink_video_sink_debug);
 #define GST_CAT_DEFAULT gst_decklink_video_sink_debug
 
@@ -120,6 +124,112 @@ private:
   gint m_refcount;
 };
 
+/* A video frame backed by the memory of a GstBuffer. The buffer stays mapped
+ * until the SDK releases the frame once it was shown, so it can't be reused
+ * by its pool before. */
+class GStreamerVideoOutputFrame:public IDeckLinkVideoFrame
+{
+public:
+  GStreamerVideoOutputFrame (GstVideoFrame * vframe, BMDPixelFormat format)
+  :IDeckLinkVideoFrame (), m_vframe (*vframe), m_format (format),
+      m_refcount (1)
+  {
+    g_mutex_init (&m_mutex);
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE QueryInterface (REFIID, LPVOID *)
+  {
+    return E_NOINTERFACE;
+  }
+
+  virtual ULONG STDMETHODCALLTYPE AddRef (void)
+  {
+    ULONG ret;
+
+    g_mutex_lock (&m_mutex);
+    m_refcount++;
+    ret = m_refcount;
+    g_mutex_unlock (&m_mutex);
+
+    return ret;
+  }
+
+  virtual ULONG STDMETHODCALLTYPE Release (void)
+  {
+    ULONG ret;
+
+    g_mutex_lock (&m_mutex);
+    m_refcount--;
+    ret = m_refcount;
+    g_mutex_unlock (&m_mutex);
+
+    if (ret == 0) {
+      delete this;
+    }
+
+    return ret;
+  }
+
+  virtual long STDMETHODCALLTYPE GetWidth (void)
+  {
+    return GST_VIDEO_FRAME_WIDTH (&m_vframe);
+  }
+
+  virtual long STDMETHODCALLTYPE GetHeight (void)
+  {
+    return GST_VIDEO_FRAME_HEIGHT (&m_vframe);
+  }
+
+  virtual long STDMETHODCALLTYPE GetRowBytes (void)
+  {
+    return GST_VIDEO_FRAME_PLANE_STRIDE (&m_vframe, 0);
+  }
+
+  virtual BMDPixelFormat STDMETHODCALLTYPE GetPixelFormat (void)
+  {
+    return m_format;
+  }
+
+  virtual BMDFrameFlags STDMETHODCALLTYPE GetFlags (void)
+  {
+    return bmdFrameFlagDefault;
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE GetBytes (void **buffer)
+  {
+    *buffer = GST_VIDEO_FRAME_PLANE_DATA (&m_vframe, 0);
+
+    return S_OK;
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE GetTimecode (BMDTimecodeFormat,
+      IDeckLinkTimecode ** timecode)
+  {
+    *timecode = NULL;
+
+    return S_FALSE;
+  }
+
+  virtual HRESULT STDMETHODCALLTYPE
+      GetAncillaryData (IDeckLinkVideoFrameAncillary ** ancillary)
+  {
+    *ancillary = NULL;
+
+    return S_FALSE;
+  }
+
+  virtual ~ GStreamerVideoOutputFrame () {
+    gst_video_frame_unmap (&m_vframe);
+    g_mutex_clear (&m_mutex);
+  }
+
+private:
+  GstVideoFrame m_vframe;
+  BMDPixelFormat m_format;
+  GMutex m_mutex;
+  gint m_refcount;
+};
+
 enum
 {
   PROP_0,
@@ -607,12 +717,34 @@ gst_decklink_video_sink_convert_to_internal_clock (GstDecklinkVideoSink * self,
   }
 }
 
+/* Returns a frame using the memory of buffer if its layout is the one the
+ * SDK expects, or NULL if it has to be copied */
+static IDeckLinkVideoFrame *
+gst_decklink_video_sink_wrap_buffer (GstDecklinkVideoSink * self,
+    GstBuffer * buffer, BMDPixelFormat format)
+{
+  GstVideoFrame vframe;
+
+  if (!gst_video_frame_map (&vframe, &self->info, buffer, GST_MAP_READ))
+    return NULL;
+
+  if (GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 0) != self->info.stride[0]
+      || ((guintptr) GST_VIDEO_FRAME_PLANE_DATA (&vframe, 0)) %
+      (DECKLINK_FRAME_ALIGN + 1) != 0) {
+    GST_LOG_OBJECT (self, "Buffer %p has an unsuitable layout", buffer);
+    gst_video_frame_unmap (&vframe);
+    return NULL;
+  }
+
+  return new GStreamerVideoOutputFrame (&vframe, format);
+}
+
 static GstFlowReturn
 gst_decklink_video_sink_prepare (GstBaseSink * bsink, GstBuffer * buffer)
 {
   GstDecklinkVideoSink *self = GST_DECKLINK_VIDEO_SINK_CAST (bsink);
   GstVideoFrame vframe;
-  IDeckLinkMutableVideoFrame *frame;
+  IDeckLinkVideoFrame *frame = NULL;
   guint8 *outdata, *indata;
   GstFlowReturn flow_ret;
   HRESULT ret;
@@ -672,34 +804,47 @@ gst_decklink_video_sink_prepare (GstBaseSink * bsink, GstBuffer * buffer)
   else
     running_time = 0;
 
-  ret = self->output->output->CreateVideoFrame (self->info.width,
-      self->info.height, self->info.stride[0], format, bmdFrameFlagDefault,
-      &frame);
-  if (ret != S_OK) {
-    GST_ELEMENT_ERROR (self, STREAM, FAILED,
-        (NULL), ("Failed to create video frame: 0x%08lx", (unsigned long) ret));
-    return GST_FLOW_ERROR;
-  }
+  /* Timecodes can only be set on frames created by the SDK */
+  tc_meta = gst_buffer_get_video_time_code_meta (buffer);
+  if (!tc_meta)
+    frame = gst_decklink_video_sink_wrap_buffer (self, buffer, format);
 
-  if (!gst_video_frame_map (&vframe, &self->info, buffer, GST_MAP_READ)) {
-    GST_ERROR_OBJECT (self, "Failed to map video frame");
-    flow_ret = GST_FLOW_ERROR;
-    goto out;
-  }
+  if (frame) {
+    GST_LOG_OBJECT (self, "Scheduling buffer %p without copying", buffer);
+  } else {
+    IDeckLinkMutableVideoFrame *mframe;
 
-  frame->GetBytes ((void **) &outdata);
-  indata = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (&vframe, 0);
-  stride =
-      MIN (GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 0), frame->GetRowBytes ());
-  for (i = 0; i < self->info.height; i++) {
-    memcpy (outdata, indata, stride);
-    indata += GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 0);
-    outdata += frame->GetRowBytes ();
+    ret = self->output->output->CreateVideoFrame (self->info.width,
+        self->info.height, self->info.stride[0], format, bmdFrameFlagDefault,
+        &mframe);
+    if (ret != S_OK) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          (NULL), ("Failed to create video frame: 0x%08lx",
+              (unsigned long) ret));
+      return GST_FLOW_ERROR;
+    }
+    frame = mframe;
+
+    if (!gst_video_frame_map (&vframe, &self->info, buffer, GST_MAP_READ)) {
+      GST_ERROR_OBJECT (self, "Failed to map video frame");
+      flow_ret = GST_FLOW_ERROR;
+      goto out;
+    }
+
+    mframe->GetBytes ((void **) &outdata);
+    indata = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (&vframe, 0);
+    stride =
+        MIN (GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 0), mframe->GetRowBytes ());
+    for (i = 0; i < self->info.height; i++) {
+      memcpy (outdata, indata, stride);
+      indata += GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 0);
+      outdata += mframe->GetRowBytes ();
+    }
+    gst_video_frame_unmap (&vframe);
   }
-  gst_video_frame_unmap (&vframe);
 
-  tc_meta = gst_buffer_get_video_time_code_meta (buffer);
   if (tc_meta) {
+    IDeckLinkMutableVideoFrame *mframe = (IDeckLinkMutableVideoFrame *) frame;
     BMDTimecodeFlags bflags = (BMDTimecodeFlags) 0;
     gchar *tc_str;
 
@@ -712,7 +857,7 @@ gst_decklink_video_sink_prepare (GstBaseSink * bsink, GstBuffer * buffer)
       bflags = (BMDTimecodeFlags) (bflags | bmdTimecodeFieldMark);
 
     tc_str = gst_video_time_code_to_string (&tc_meta->tc);
-    ret = frame->SetTimecodeFromComponents (self->timecode_format,
+    ret = mframe->SetTimecodeFromComponents (self->timecode_format,
         (uint8_t) tc_meta->tc.hours,
         (uint8_t) tc_meta->tc.minutes,
         (uint8_t) tc_meta->tc.seconds, (uint8_t) tc_meta->tc.frames, bflags);
@@ -1160,13 +1305,18 @@ gst_decklink_video_sink_propose_allocation (GstBaseSink * bsink,
   if (gst_query_get_n_allocation_pools (query) == 0) {
     GstStructure *structure;
     GstAllocator *allocator = NULL;
-    GstAllocationParams params = { (GstMemoryFlags) 0, 15, 0, 0 };
+    GstAllocationParams params =
+        { (GstMemoryFlags) 0, DECKLINK_FRAME_ALIGN, 0, 0 };
 
     if (gst_query_get_n_allocation_params (query) > 0)
       gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
     else
       gst_query_add_allocation_param (query, allocator, &params);
 
+    /* Buffers from this pool are scheduled without copying, see
+     * gst_decklink_video_sink_wrap_buffer() */
+    params.align = MAX (params.align, DECKLINK_FRAME_ALIGN);
+
     pool = gst_video_buffer_pool_new ();
 
     structure = gst_buffer_pool_get_config (pool);
@@ -74,8 +74,8 @@ static void gst_dshowaudiosrc_reset (GstAudioSrc * asrc);
 /* utils */
 static GstCaps *gst_dshowaudiosrc_getcaps_from_streamcaps (GstDshowAudioSrc *
     src, IPin * pin, IAMStreamConfig * streamcaps);
-static gboolean gst_dshowaudiosrc_push_buffer (guint8 * buffer, guint size,
-    gpointer src_object, GstClockTime duration);
+static gboolean gst_dshowaudiosrc_push_buffer (IMediaSample * sample,
+    guint8 * buffer, guint size, gpointer src_object, GstClockTime duration);
 
 static void
 gst_dshowaudiosrc_class_init (GstDshowAudioSrcClass * klass)
@@ -755,8 +755,8 @@ gst_dshowaudiosrc_getcaps_from_streamcaps (GstDshowAudioSrc * src, IPin * pin,
 }
 
 static gboolean
-gst_dshowaudiosrc_push_buffer (guint8 * buffer, guint size, gpointer src_object,
-    GstClockTime duration)
+gst_dshowaudiosrc_push_buffer (IMediaSample * sample, guint8 * buffer,
+    guint size, gpointer src_object, GstClockTime duration)
 {
   GstDshowAudioSrc *src = GST_DSHOWAUDIOSRC (src_object);
 
@@ -44,6 +44,21 @@ STDMETHODIMP
   return S_OK;
 }
 
+STDMETHODIMP CDshowFakeSink::gst_get_allocator_buffers (long *buffers)
+{
+  ALLOCATOR_PROPERTIES props;
+  IMemAllocator *allocator = NULL;
+
+  if (m_pInputPin)
+    allocator = m_pInputPin->PeekAllocator ();
+
+  if (!allocator || FAILED (allocator->GetProperties (&props)))
+    return E_FAIL;
+
+  *buffers = props.cBuffers;
+  return S_OK;
+}
+
 HRESULT CDshowFakeSink::CheckMediaType (const CMediaType * pmt)
 {
   if (!IsEqualGUID(pmt->majortype, m_MediaType.majortype) ||
@@ -74,7 +89,7 @@ HRESULT CDshowFakeSink::DoRenderSample (IMediaSample * pMediaSample)
     pMediaSample->GetTime (&lStart, &lStop);
 
     GstClockTime duration = (lStop - lStart) * 100;
-    m_callback (pBuffer, size, m_data, duration);
+    m_callback (pMediaSample, pBuffer, size, m_data, duration);
   }
 
   return S_OK;
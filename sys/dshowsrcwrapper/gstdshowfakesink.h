@@ -30,8 +30,8 @@ static const GUID CLSID_DshowFakeSink =
     0x73}
 };
 
-typedef bool (*push_buffer_func) (guint8 * buffer, guint size, gpointer src_object,
-    GstClockTime duration);
+typedef bool (*push_buffer_func) (IMediaSample * sample, guint8 * buffer,
+    guint size, gpointer src_object, GstClockTime duration);
 
 class CDshowFakeSink:public CBaseRenderer
 {
@@ -46,6 +46,7 @@ public:
 
   STDMETHOD (gst_set_media_type) (AM_MEDIA_TYPE * pmt);
   STDMETHOD (gst_set_buffer_callback) (push_buffer_func push, gpointer data);
+  STDMETHOD (gst_get_allocator_buffers) (long *buffers);
 
 protected:
   HRESULT m_hres;
@@ -28,9 +28,21 @@
 
 #include <gst/video/video.h>
 
+#include <errno.h>
+
 GST_DEBUG_CATEGORY_STATIC (dshowvideosrc_debug);
 #define GST_CAT_DEFAULT dshowvideosrc_debug
 
+/* media samples left to the capture filter's allocator before falling
+ * back to copying */
+#define MIN_FREE_SAMPLES 1
+
+typedef struct
+{
+  GstDshowVideoSrc *src;
+  IMediaSample *sample;
+} GstDshowVideoSample;
+
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -96,8 +108,9 @@ static GstCaps *gst_dshowvideosrc_getcaps_from_streamcaps (GstDshowVideoSrc *
     src, IPin * pin);
 static GstCaps *gst_dshowvideosrc_getcaps_from_enum_mediatypes (GstDshowVideoSrc *
     src, IPin * pin);
-static gboolean gst_dshowvideosrc_push_buffer (guint8 * buffer, guint size,
-    gpointer src_object, GstClockTime duration);
+static gboolean gst_dshowvideosrc_push_buffer (IMediaSample * sample,
+    guint8 * buffer, guint size, gpointer src_object, GstClockTime duration);
+static void gst_dshowvideosrc_flush_queue (GstDshowVideoSrc * src);
 
 static void
 gst_dshowvideosrc_class_init (GstDshowVideoSrcClass * klass)
@@ -176,10 +189,10 @@ gst_dshowvideosrc_init (GstDshowVideoSrc * src)
   src->pVC = NULL;
   src->pVSC = NULL;
 
-  g_cond_init(&src->buffer_cond);
-  g_mutex_init(&src->buffer_mutex);
-  src->buffer = NULL;
+  src->queue = gst_atomic_queue_new (4);
+  src->poll = gst_poll_new_timer ();
   src->stop_requested = FALSE;
+  src->outstanding_samples = 0;
 
   CoInitializeEx (NULL, COINIT_MULTITHREADED);
 
@@ -255,8 +268,16 @@ gst_dshowvideosrc_dispose (GObject * gobject)
     src->video_cap_filter = NULL;
   }
 
-  g_cond_clear(&src->buffer_cond);
-  g_mutex_clear(&src->buffer_mutex);
+  if (src->queue) {
+    gst_dshowvideosrc_flush_queue (src);
+    gst_atomic_queue_unref (src->queue);
+    src->queue = NULL;
+  }
+
+  if (src->poll) {
+    gst_poll_free (src->poll);
+    src->poll = NULL;
+  }
 
   CoUninitialize ();
 
@@ -740,6 +761,9 @@ gst_dshowvideosrc_stop (GstBaseSrc * bsrc)
   HRESULT hres = S_FALSE;
   GstDshowVideoSrc *src = GST_DSHOWVIDEOSRC (bsrc);
 
+  /* give the queued media samples back to the capture filter */
+  gst_dshowvideosrc_flush_queue (src);
+
   if (!src->filter_graph)
     return TRUE;
 
@@ -813,20 +837,44 @@ gst_dshowvideosrc_unlock (GstBaseSrc * bsrc)
 {
   GstDshowVideoSrc *src = GST_DSHOWVIDEOSRC (bsrc);
 
-  g_mutex_lock (&src->buffer_mutex);
-  src->stop_requested = TRUE;
-  g_cond_signal (&src->buffer_cond);
-  g_mutex_unlock (&src->buffer_mutex);
+  g_atomic_int_set (&src->stop_requested, TRUE);
+  gst_poll_write_control (src->poll);
 
   return TRUE;
 }
 
+static void
+gst_dshowvideosrc_read_control (GstDshowVideoSrc * src)
+{
+  while (!gst_poll_read_control (src->poll)) {
+    if (errno == EWOULDBLOCK) {
+      /* the buffer was queued but the control byte is not written yet */
+      g_thread_yield ();
+      continue;
+    }
+    break;
+  }
+}
+
+static void
+gst_dshowvideosrc_flush_queue (GstDshowVideoSrc * src)
+{
+  GstBuffer *buf;
+
+  while ((buf = (GstBuffer *) gst_atomic_queue_pop (src->queue))) {
+    gst_dshowvideosrc_read_control (src);
+    gst_buffer_unref (buf);
+  }
+}
+
 static gboolean
 gst_dshowvideosrc_unlock_stop (GstBaseSrc * bsrc)
 {
   GstDshowVideoSrc *src = GST_DSHOWVIDEOSRC (bsrc);
 
-  src->stop_requested = FALSE;
+  /* consume the wakeup written by unlock, if there was one */
+  if (g_atomic_int_compare_and_exchange (&src->stop_requested, TRUE, FALSE))
+    gst_dshowvideosrc_read_control (src);
 
   return TRUE;
 }
@@ -835,15 +883,27 @@ static GstFlowReturn
 gst_dshowvideosrc_create (GstPushSrc * psrc, GstBuffer ** buf)
 {
   GstDshowVideoSrc *src = GST_DSHOWVIDEOSRC (psrc);
+  GstBuffer *next;
+
+  *buf = NULL;
+  while (TRUE) {
+    /* only keep the most recent buffer, like the capture graph would */
+    while ((next = (GstBuffer *) gst_atomic_queue_pop (src->queue))) {
+      gst_dshowvideosrc_read_control (src);
+      if (*buf != NULL) {
+        GST_DEBUG_OBJECT (src, "dropping outdated buffer");
+        gst_buffer_unref (*buf);
+      }
+      *buf = next;
+    }
+
+    if (*buf != NULL || g_atomic_int_get (&src->stop_requested))
+      break;
 
-  g_mutex_lock (&src->buffer_mutex);
-  while (src->buffer == NULL && !src->stop_requested)
-    g_cond_wait (&src->buffer_cond, &src->buffer_mutex);
-  *buf = src->buffer;
-  src->buffer = NULL;
-  g_mutex_unlock (&src->buffer_mutex);
+    gst_poll_wait (src->poll, GST_CLOCK_TIME_NONE);
+  }
 
-  if (src->stop_requested) {
+  if (g_atomic_int_get (&src->stop_requested)) {
     if (*buf != NULL) {
       gst_buffer_unref (*buf);
       *buf = NULL;
@@ -1001,37 +1061,30 @@ gst_dshowvideosrc_getcaps_from_enum_mediatypes (GstDshowVideoSrc * src, IPin * p
   return caps;
 }
 
-static gboolean
-gst_dshowvideosrc_push_buffer (guint8 * buffer, guint size, gpointer src_object,
-    GstClockTime duration)
+static void
+gst_dshowvideosrc_release_sample (gpointer data)
 {
-  GstDshowVideoSrc *src = GST_DSHOWVIDEOSRC (src_object);
-  GstBuffer *buf = NULL;
-  IPin *pPin = NULL;
-  HRESULT hres = S_FALSE;
-  AM_MEDIA_TYPE *pMediaType = NULL;
-  GstMapInfo info;
+  GstDshowVideoSample *wrapped = (GstDshowVideoSample *) data;
 
-  if (!buffer || size == 0 || !src) {
-    return FALSE;
-  }
-
-  /* create a new buffer assign to it the clock time as timestamp */
-  buf = gst_buffer_new_and_alloc (size);
-
-  gst_buffer_set_size(buf, size);
+  wrapped->sample->Release ();
+  g_atomic_int_add (&wrapped->src->outstanding_samples, -1);
+  gst_object_unref (wrapped->src);
+  g_slice_free (GstDshowVideoSample, wrapped);
+}
 
-  GstClock *clock = gst_element_get_clock (GST_ELEMENT (src));
-  GST_BUFFER_TIMESTAMP (buf) =
-    GST_CLOCK_DIFF (gst_element_get_base_time (GST_ELEMENT (src)), gst_clock_get_time (clock));
-  gst_object_unref (clock);
+static GstBuffer *
+gst_dshowvideosrc_copy_sample (GstDshowVideoSrc * src, guint8 * buffer,
+    guint size)
+{
+  GstBuffer *buf;
+  GstMapInfo info;
 
-  GST_BUFFER_DURATION (buf) = duration;
+  buf = gst_buffer_new_and_alloc (size);
 
   if (!gst_buffer_map(buf, &info, GST_MAP_WRITE)) {
 	  gst_buffer_unref(buf);
 	  GST_ERROR("Failed to map buffer");
-	  return FALSE;
+	  return NULL;
   }
 
   if (src->is_rgb) {
@@ -1052,16 +1105,71 @@ gst_dshowvideosrc_push_buffer (guint8 * buffer, guint size, gpointer src_object,
 
   gst_buffer_unmap(buf, &info);
 
+  return buf;
+}
+
+static GstBuffer *
+gst_dshowvideosrc_wrap_sample (GstDshowVideoSrc * src, IMediaSample * sample,
+    guint8 * buffer, guint size)
+{
+  GstDshowVideoSample *wrapped;
+  long n_samples = 0;
+
+  /* RGB frames are bottom-up and have to be flipped into a new buffer */
+  if (src->is_rgb || !sample)
+    return NULL;
+
+  /* holding on to a media sample keeps it from the capture filter's
+   * allocator, so leave it enough of them to keep capturing */
+  if (FAILED (src->dshow_fakesink->gst_get_allocator_buffers (&n_samples)) ||
+      g_atomic_int_get (&src->outstanding_samples) + MIN_FREE_SAMPLES >=
+      n_samples)
+    return NULL;
+
+  sample->AddRef ();
+  g_atomic_int_inc (&src->outstanding_samples);
+
+  wrapped = g_slice_new (GstDshowVideoSample);
+  wrapped->src = (GstDshowVideoSrc *) gst_object_ref (src);
+  wrapped->sample = sample;
+
+  return gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, buffer, size,
+      0, size, wrapped, gst_dshowvideosrc_release_sample);
+}
+
+static gboolean
+gst_dshowvideosrc_push_buffer (IMediaSample * sample, guint8 * buffer,
+    guint size, gpointer src_object, GstClockTime duration)
+{
+  GstDshowVideoSrc *src = GST_DSHOWVIDEOSRC (src_object);
+  GstBuffer *buf = NULL;
+
+  if (!buffer || size == 0 || !src) {
+    return FALSE;
+  }
+
+  buf = gst_dshowvideosrc_wrap_sample (src, sample, buffer, size);
+  if (!buf) {
+    GST_LOG_OBJECT (src, "copying media sample");
+    buf = gst_dshowvideosrc_copy_sample (src, buffer, size);
+    if (!buf)
+      return FALSE;
+  }
+
+  /* assign the clock time as timestamp */
+  GstClock *clock = gst_element_get_clock (GST_ELEMENT (src));
+  GST_BUFFER_TIMESTAMP (buf) =
+    GST_CLOCK_DIFF (gst_element_get_base_time (GST_ELEMENT (src)), gst_clock_get_time (clock));
+  gst_object_unref (clock);
+
+  GST_BUFFER_DURATION (buf) = duration;
+
   GST_DEBUG ("push_buffer => pts %" GST_TIME_FORMAT "duration %"
       GST_TIME_FORMAT, GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buf)),
       GST_TIME_ARGS (duration));
 
-  g_mutex_lock (&src->buffer_mutex);
-  if (src->buffer != NULL)
-    gst_buffer_unref (src->buffer);
-  src->buffer = buf;
-  g_cond_signal (&src->buffer_cond);
-  g_mutex_unlock (&src->buffer_mutex);
+  gst_atomic_queue_push (src->queue, buf);
+  gst_poll_write_control (src->poll);
 
   return TRUE;
 }
@@ -78,12 +78,14 @@ struct _GstDshowVideoSrc
   //IAMStreamConfig *pASC;      // for audio cap
   IAMStreamConfig *pVSC;      // for video cap
 
-  /* the last buffer from DirectShow */
-  GCond buffer_cond;
-  GMutex buffer_mutex;
-  GstBuffer *buffer;
+  /* buffers handed over from the DirectShow streaming thread */
+  GstAtomicQueue *queue;
+  GstPoll *poll;
   gboolean stop_requested;
 
+  /* number of media samples still wrapped by downstream buffers */
+  gint outstanding_samples;
+
   gboolean is_rgb;
   gboolean is_running;
   gint width;
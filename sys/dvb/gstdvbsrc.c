@@ -198,7 +198,11 @@ enum
   ARG_DVBSRC_LNB_SLOF,
   ARG_DVBSRC_LNB_LOF1,
   ARG_DVBSRC_LNB_LOF2,
-  ARG_DVBSRC_INTERLEAVING
+  ARG_DVBSRC_INTERLEAVING,
+  ARG_DVBSRC_READ_THREAD,
+  ARG_DVBSRC_READ_BUFFERS,
+  ARG_DVBSRC_READ_BUFFER_SIZE,
+  ARG_DVBSRC_STATS
 };
 
 #define DEFAULT_ADAPTER 0
@@ -221,7 +225,10 @@ enum
 #define DEFAULT_TIMEOUT 1000000 /* 1 second */
 #define DEFAULT_TUNING_TIMEOUT 10 * GST_SECOND  /* 10 seconds */
 #define DEFAULT_DVB_BUFFER_SIZE (10*188*1024)   /* kernel default is 8192 */
-#define DEFAULT_BUFFER_SIZE 8192        /* not a property */
+#define DEFAULT_BUFFER_SIZE 8192        /* without read-thread, not a property */
+#define DEFAULT_READ_THREAD FALSE
+#define DEFAULT_READ_BUFFERS 32
+#define DEFAULT_READ_BUFFER_SIZE (188*1024)
 #define DEFAULT_DELSYS SYS_UNDEFINED
 #define DEFAULT_PILOT PILOT_AUTO
 #define DEFAULT_ROLLOFF ROLLOFF_AUTO
@@ -969,6 +976,63 @@ gst_dvbsrc_class_init (GstDvbSrcClass * klass)
           GST_TYPE_INTERLEAVING, DEFAULT_INTERLEAVING,
           GST_PARAM_MUTABLE_PLAYING | G_PARAM_READWRITE));
 
+  /**
+   * GstDvbSrc:read-thread:
+   *
+   * Read the DVR device from a dedicated thread into a queue of
+   * #GstDvbSrc:read-buffers pooled buffers of #GstDvbSrc:read-buffer-size
+   * bytes, so that scheduling jitter downstream does not make the demux
+   * buffer overflow. When the queue is full the oldest buffer is dropped.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, ARG_DVBSRC_READ_THREAD,
+      g_param_spec_boolean ("read-thread", "Read thread",
+          "Read the DVR device from a dedicated thread",
+          DEFAULT_READ_THREAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDvbSrc:read-buffers:
+   *
+   * Number of buffers queued by the read thread before the oldest one is
+   * dropped.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, ARG_DVBSRC_READ_BUFFERS,
+      g_param_spec_uint ("read-buffers", "Read buffers",
+          "Number of buffers queued by the read thread",
+          1, G_MAXUINT16, DEFAULT_READ_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDvbSrc:read-buffer-size:
+   *
+   * Size in bytes of the buffers filled by the read thread.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      ARG_DVBSRC_READ_BUFFER_SIZE,
+      g_param_spec_uint ("read-buffer-size", "Read buffer size",
+          "Size in bytes of the buffers filled by the read thread",
+          188, G_MAXINT, DEFAULT_READ_BUFFER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstDvbSrc:stats:
+   *
+   * Read statistics: the number of times the demux reported a buffer
+   * overflow ("dvr-overflows"), the number of buffers dropped because the
+   * read queue was full ("dropped-buffers") and the number of buffers
+   * currently queued ("queued-buffers").
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, ARG_DVBSRC_STATS,
+      g_param_spec_boxed ("stats", "Statistics", "Read statistics",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstDvbSrc::tuning-start:
    * @gstdvbsrc: the element on which the signal is emitted
@@ -1103,6 +1167,13 @@ gst_dvbsrc_init (GstDvbSrc * object)
 
   g_mutex_init (&object->tune_mutex);
   object->timeout = DEFAULT_TIMEOUT;
+
+  object->read_thread = DEFAULT_READ_THREAD;
+  object->read_buffers = DEFAULT_READ_BUFFERS;
+  object->read_buffer_size = DEFAULT_READ_BUFFER_SIZE;
+  g_mutex_init (&object->read_lock);
+  g_cond_init (&object->read_cond);
+  g_queue_init (&object->read_queue);
   object->tuning_timeout = DEFAULT_TUNING_TIMEOUT;
 }
 
@@ -1352,6 +1423,15 @@ gst_dvbsrc_set_property (GObject * _object, guint prop_id,
     case ARG_DVBSRC_INTERLEAVING:
       object->interleaving = g_value_get_enum (value);
       break;
+    case ARG_DVBSRC_READ_THREAD:
+      object->read_thread = g_value_get_boolean (value);
+      break;
+    case ARG_DVBSRC_READ_BUFFERS:
+      object->read_buffers = g_value_get_uint (value);
+      break;
+    case ARG_DVBSRC_READ_BUFFER_SIZE:
+      object->read_buffer_size = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -1524,6 +1604,24 @@ gst_dvbsrc_get_property (GObject * _object, guint prop_id,
     case ARG_DVBSRC_INTERLEAVING:
       g_value_set_enum (value, object->interleaving);
       break;
+    case ARG_DVBSRC_READ_THREAD:
+      g_value_set_boolean (value, object->read_thread);
+      break;
+    case ARG_DVBSRC_READ_BUFFERS:
+      g_value_set_uint (value, object->read_buffers);
+      break;
+    case ARG_DVBSRC_READ_BUFFER_SIZE:
+      g_value_set_uint (value, object->read_buffer_size);
+      break;
+    case ARG_DVBSRC_STATS:
+      g_mutex_lock (&object->read_lock);
+      g_value_take_boxed (value, gst_structure_new ("dvb-read-stats",
+              "dvr-overflows", G_TYPE_UINT64, object->dvr_overflows,
+              "dropped-buffers", G_TYPE_UINT64, object->dropped_buffers,
+              "queued-buffers", G_TYPE_UINT,
+              g_queue_get_length (&object->read_queue), NULL));
+      g_mutex_unlock (&object->read_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -1827,6 +1925,8 @@ gst_dvbsrc_finalize (GObject * _object)
 
   /* freeing the mutex segfaults somehow */
   g_mutex_clear (&object->tune_mutex);
+  g_mutex_clear (&object->read_lock);
+  g_cond_clear (&object->read_cond);
 
   if (G_OBJECT_CLASS (parent_class)->finalize)
     G_OBJECT_CLASS (parent_class)->finalize (_object);
@@ -1857,17 +1957,16 @@ gst_dvbsrc_plugin_init (GstPlugin * plugin)
       GST_TYPE_DVBSRC);
 }
 
+/* Fills @buf from the DVR device */
 static GstFlowReturn
-gst_dvbsrc_read_device (GstDvbSrc * object, int size, GstBuffer ** buffer)
+gst_dvbsrc_read_device (GstDvbSrc * object, GstBuffer * buf)
 {
   gint count = 0;
   gint ret_val = 0;
-  GstBuffer *buf = gst_buffer_new_and_alloc (size);
+  gint size = gst_buffer_get_size (buf);
   GstClockTime timeout = object->timeout * GST_USECOND;
   GstMapInfo map;
 
-  g_return_val_if_fail (GST_IS_BUFFER (buf), GST_FLOW_ERROR);
-
   if (object->fd_dvr < 0)
     return GST_FLOW_ERROR;
 
@@ -1890,7 +1989,14 @@ gst_dvbsrc_read_device (GstDvbSrc * object, int size, GstBuffer ** buffer)
     } else {
       int nread = read (object->fd_dvr, map.data + count, size - count);
 
-      if (G_UNLIKELY (nread < 0)) {
+      if (G_UNLIKELY (nread < 0 && errno == EOVERFLOW)) {
+        /* the demux buffer overflowed and data was lost, the next read
+         * continues with fresh data */
+        GST_WARNING_OBJECT (object, "DVR buffer overflow");
+        g_mutex_lock (&object->read_lock);
+        object->dvr_overflows++;
+        g_mutex_unlock (&object->read_lock);
+      } else if (G_UNLIKELY (nread < 0)) {
         GST_WARNING_OBJECT
             (object,
             "Unable to read from device: /dev/dvb/adapter%d/dvr%d (%d)",
@@ -1905,15 +2011,12 @@ gst_dvbsrc_read_device (GstDvbSrc * object, int size, GstBuffer ** buffer)
   gst_buffer_unmap (buf, &map);
   gst_buffer_resize (buf, 0, count);
 
-  *buffer = buf;
-
   return GST_FLOW_OK;
 
 stopped:
   {
     GST_DEBUG_OBJECT (object, "stop called");
     gst_buffer_unmap (buf, &map);
-    gst_buffer_unref (buf);
     return GST_FLOW_FLUSHING;
   }
 select_error:
@@ -1921,38 +2024,171 @@ select_error:
     GST_ELEMENT_ERROR (object, RESOURCE, READ, (NULL),
         ("select error %d: %s (%d)", ret_val, g_strerror (errno), errno));
     gst_buffer_unmap (buf, &map);
-    gst_buffer_unref (buf);
     return GST_FLOW_ERROR;
   }
 }
 
+static void
+gst_dvbsrc_update_stats (GstDvbSrc * object)
+{
+  fe_status_t status;
+
+  if (object->stats_interval &&
+      ++object->stats_counter == object->stats_interval) {
+    gst_dvbsrc_output_frontend_stats (object, &status);
+    object->stats_counter = 0;
+  }
+}
+
+static gpointer
+gst_dvbsrc_reader_thread (GstDvbSrc * object)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  GST_DEBUG_OBJECT (object, "Read thread started");
+
+  while (ret == GST_FLOW_OK) {
+    GstBuffer *buf = NULL;
+
+    ret = gst_buffer_pool_acquire_buffer (object->read_pool, &buf, NULL);
+    if (ret != GST_FLOW_OK)
+      break;
+
+    /* device can not be tuned during read */
+    g_mutex_lock (&object->tune_mutex);
+    ret = gst_dvbsrc_read_device (object, buf);
+    if (ret == GST_FLOW_OK)
+      gst_dvbsrc_update_stats (object);
+    g_mutex_unlock (&object->tune_mutex);
+
+    if (ret != GST_FLOW_OK) {
+      gst_buffer_unref (buf);
+      break;
+    }
+
+    g_mutex_lock (&object->read_lock);
+    if (g_queue_get_length (&object->read_queue) >= object->read_buffers) {
+      GST_WARNING_OBJECT (object, "Read queue full, dropping oldest buffer");
+      gst_buffer_unref (g_queue_pop_head (&object->read_queue));
+      object->dropped_buffers++;
+    }
+    g_queue_push_tail (&object->read_queue, buf);
+    g_cond_signal (&object->read_cond);
+    g_mutex_unlock (&object->read_lock);
+  }
+
+  GST_DEBUG_OBJECT (object, "Read thread stopped: %s", gst_flow_get_name (ret));
+
+  g_mutex_lock (&object->read_lock);
+  object->read_flow = ret;
+  g_cond_signal (&object->read_cond);
+  g_mutex_unlock (&object->read_lock);
+
+  return NULL;
+}
+
+static gboolean
+gst_dvbsrc_start_reader (GstDvbSrc * object)
+{
+  GstStructure *config;
+  GError *err = NULL;
+
+  object->read_pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (object->read_pool);
+  /* preallocate the whole queue, but never block the reader */
+  gst_buffer_pool_config_set_params (config, NULL, object->read_buffer_size,
+      object->read_buffers, 0);
+  if (!gst_buffer_pool_set_config (object->read_pool, config) ||
+      !gst_buffer_pool_set_active (object->read_pool, TRUE)) {
+    GST_ELEMENT_ERROR (object, RESOURCE, SETTINGS, (NULL),
+        ("Could not allocate %u buffers of %u bytes", object->read_buffers,
+            object->read_buffer_size));
+    gst_object_unref (object->read_pool);
+    object->read_pool = NULL;
+    return FALSE;
+  }
+
+  object->read_flow = GST_FLOW_OK;
+  object->reader = g_thread_try_new ("dvbsrc-reader",
+      (GThreadFunc) gst_dvbsrc_reader_thread, object, &err);
+  if (object->reader == NULL) {
+    GST_ELEMENT_ERROR (object, RESOURCE, FAILED, (NULL),
+        ("Could not start read thread: %s", err->message));
+    g_clear_error (&err);
+    gst_buffer_pool_set_active (object->read_pool, FALSE);
+    gst_object_unref (object->read_pool);
+    object->read_pool = NULL;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_dvbsrc_stop_reader (GstDvbSrc * object)
+{
+  if (object->reader) {
+    gst_poll_set_flushing (object->poll, TRUE);
+    gst_buffer_pool_set_flushing (object->read_pool, TRUE);
+    g_thread_join (object->reader);
+    object->reader = NULL;
+  }
+
+  g_mutex_lock (&object->read_lock);
+  g_queue_foreach (&object->read_queue, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&object->read_queue);
+  g_mutex_unlock (&object->read_lock);
+
+  if (object->read_pool) {
+    gst_buffer_pool_set_active (object->read_pool, FALSE);
+    gst_object_unref (object->read_pool);
+    object->read_pool = NULL;
+  }
+}
+
 static GstFlowReturn
 gst_dvbsrc_create (GstPushSrc * element, GstBuffer ** buf)
 {
-  gint buffer_size;
   GstFlowReturn retval = GST_FLOW_ERROR;
   GstDvbSrc *object;
-  fe_status_t status;
 
   object = GST_DVBSRC (element);
   GST_LOG ("fd_dvr: %d", object->fd_dvr);
 
-  buffer_size = DEFAULT_BUFFER_SIZE;
+  if (object->reader) {
+    g_mutex_lock (&object->read_lock);
+    while (g_queue_is_empty (&object->read_queue) &&
+        object->read_flow == GST_FLOW_OK && !object->read_flushing)
+      g_cond_wait (&object->read_cond, &object->read_lock);
+
+    if (object->read_flushing)
+      retval = GST_FLOW_FLUSHING;
+    else if (!g_queue_is_empty (&object->read_queue)) {
+      *buf = g_queue_pop_head (&object->read_queue);
+      retval = GST_FLOW_OK;
+    } else
+      retval = object->read_flow;
+    g_mutex_unlock (&object->read_lock);
+
+    return retval;
+  }
 
   /* device can not be tuned during read */
   g_mutex_lock (&object->tune_mutex);
 
 
   if (object->fd_dvr > -1) {
+    GstBuffer *buffer = gst_buffer_new_and_alloc (DEFAULT_BUFFER_SIZE);
+
     /* --- Read TS from DVR device --- */
     GST_DEBUG_OBJECT (object, "Reading from DVR device");
-    retval = gst_dvbsrc_read_device (object, buffer_size, buf);
+    retval = gst_dvbsrc_read_device (object, buffer);
+    if (retval == GST_FLOW_OK)
+      *buf = buffer;
+    else
+      gst_buffer_unref (buffer);
 
-    if (object->stats_interval &&
-        ++object->stats_counter == object->stats_interval) {
-      gst_dvbsrc_output_frontend_stats (object, &status);
-      object->stats_counter = 0;
-    }
+    gst_dvbsrc_update_stats (object);
   }
 
   g_mutex_unlock (&object->tune_mutex);
@@ -2017,6 +2253,17 @@ gst_dvbsrc_start (GstBaseSrc * bsrc)
   gst_poll_add_fd (src->poll, &src->poll_fd_dvr);
   gst_poll_fd_ctl_read (src->poll, &src->poll_fd_dvr, TRUE);
 
+  src->dvr_overflows = 0;
+  src->dropped_buffers = 0;
+  src->read_flushing = FALSE;
+  if (src->read_thread && !gst_dvbsrc_start_reader (src)) {
+    gst_poll_free (src->poll);
+    src->poll = NULL;
+    close (src->fd_dvr);
+    src->fd_dvr = -1;
+    goto fail;
+  }
+
   return TRUE;
 
 fail:
@@ -2030,6 +2277,7 @@ gst_dvbsrc_stop (GstBaseSrc * bsrc)
 {
   GstDvbSrc *src = GST_DVBSRC (bsrc);
 
+  gst_dvbsrc_stop_reader (src);
   gst_dvbsrc_close_devices (src);
   g_list_free (src->supported_delsys);
   src->supported_delsys = NULL;
@@ -2046,6 +2294,16 @@ gst_dvbsrc_unlock (GstBaseSrc * bsrc)
 {
   GstDvbSrc *src = GST_DVBSRC (bsrc);
 
+  /* the read thread keeps running, only the waiting in create is
+   * interrupted */
+  if (src->reader) {
+    g_mutex_lock (&src->read_lock);
+    src->read_flushing = TRUE;
+    g_cond_signal (&src->read_cond);
+    g_mutex_unlock (&src->read_lock);
+    return TRUE;
+  }
+
   gst_poll_set_flushing (src->poll, TRUE);
   return TRUE;
 }
@@ -2055,6 +2313,13 @@ gst_dvbsrc_unlock_stop (GstBaseSrc * bsrc)
 {
   GstDvbSrc *src = GST_DVBSRC (bsrc);
 
+  if (src->reader) {
+    g_mutex_lock (&src->read_lock);
+    src->read_flushing = FALSE;
+    g_mutex_unlock (&src->read_lock);
+    return TRUE;
+  }
+
   gst_poll_set_flushing (src->poll, FALSE);
   return TRUE;
 }
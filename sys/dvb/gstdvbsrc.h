@@ -104,6 +104,21 @@ struct _GstDvbSrc
 
   guint dvb_buffer_size;
 
+  /* reader thread, filling a queue of pooled buffers from the DVR device */
+  gboolean read_thread;
+  guint read_buffers;
+  guint read_buffer_size;
+  GThread *reader;
+  gboolean reader_running;
+  GstBufferPool *read_pool;
+  GMutex read_lock;
+  GCond read_cond;
+  GQueue read_queue;
+  GstFlowReturn read_flow;
+  gboolean read_flushing;
+  guint64 dvr_overflows;
+  guint64 dropped_buffers;
+
   unsigned int isdbt_layer_enabled;
   int isdbt_partial_reception;
   int isdbt_sound_broadcasting;
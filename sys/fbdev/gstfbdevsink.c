@@ -43,14 +43,21 @@
 #include <stdint.h>
 #endif
 
+#include <gst/video/gstvideopool.h>
+
 #include "gstfbdevsink.h"
 
 enum
 {
   ARG_0,
-  ARG_DEVICE
+  ARG_DEVICE,
+  ARG_PAGE_FLIP
 };
 
+#define DEFAULT_PAGE_FLIP FALSE
+
+#define N_PAGES 2
+
 #if 0
 static void gst_fbdevsink_get_times (GstBaseSink * basesink,
     GstBuffer * buffer, GstClockTime * start, GstClockTime * end);
@@ -64,6 +71,8 @@ static gboolean gst_fbdevsink_stop (GstBaseSink * bsink);
 
 static GstCaps *gst_fbdevsink_getcaps (GstBaseSink * bsink, GstCaps * filter);
 static gboolean gst_fbdevsink_setcaps (GstBaseSink * bsink, GstCaps * caps);
+static gboolean gst_fbdevsink_propose_allocation (GstBaseSink * bsink,
+    GstQuery * query);
 
 static void gst_fbdevsink_finalize (GObject * object);
 static void gst_fbdevsink_set_property (GObject * object,
@@ -81,13 +90,171 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE (VIDEO_CAPS))
     );
 
+/* Buffer pool handing out the screen pages of the framebuffer, so upstream
+ * renders straight into the page that is shown next */
+typedef struct
+{
+  GstBufferPool parent;
+
+  GstFBDEVSink *sink;
+  GstVideoInfo info;
+  gsize offset;
+  guint pages_in_use;
+} GstFBDEVBufferPool;
+
+typedef struct
+{
+  GstBufferPoolClass parent_class;
+} GstFBDEVBufferPoolClass;
+
+static GType gst_fbdev_buffer_pool_get_type (void);
+G_DEFINE_TYPE (GstFBDEVBufferPool, gst_fbdev_buffer_pool, GST_TYPE_BUFFER_POOL);
+
+#define GST_FBDEV_BUFFER_POOL(obj) ((GstFBDEVBufferPool *) (obj))
+
+static GQuark fbdev_page_quark;
+
+/* returns the screen page @buf is backed by, or -1 */
+static gint
+gst_fbdev_buffer_get_page (GstBuffer * buf)
+{
+  return GPOINTER_TO_INT (gst_mini_object_get_qdata (GST_MINI_OBJECT (buf),
+          fbdev_page_quark)) - 1;
+}
+
+static const gchar **
+gst_fbdev_buffer_pool_get_options (GstBufferPool * pool)
+{
+  static const gchar *options[] = { GST_BUFFER_POOL_OPTION_VIDEO_META, NULL };
+
+  return options;
+}
+
+static gboolean
+gst_fbdev_buffer_pool_set_config (GstBufferPool * pool, GstStructure * config)
+{
+  GstFBDEVBufferPool *fbpool = GST_FBDEV_BUFFER_POOL (pool);
+  GstFBDEVSink *sink = fbpool->sink;
+  GstCaps *caps;
+  guint bytespp;
+
+  if (!gst_buffer_pool_config_get_params (config, &caps, NULL, NULL, NULL)
+      || !caps || !gst_video_info_from_caps (&fbpool->info, caps))
+    return FALSE;
+
+  if (GST_VIDEO_INFO_WIDTH (&fbpool->info) > sink->varinfo.xres
+      || GST_VIDEO_INFO_HEIGHT (&fbpool->info) > sink->varinfo.yres)
+    return FALSE;
+
+  /* center the video on the screen page, like the copying path does */
+  bytespp = sink->fixinfo.line_length / sink->varinfo.xres_virtual;
+  fbpool->offset =
+      (sink->varinfo.yres - GST_VIDEO_INFO_HEIGHT (&fbpool->info)) / 2 *
+      sink->fixinfo.line_length +
+      (sink->varinfo.xres - GST_VIDEO_INFO_WIDTH (&fbpool->info)) / 2 *
+      bytespp;
+
+  return
+      GST_BUFFER_POOL_CLASS (gst_fbdev_buffer_pool_parent_class)->set_config
+      (pool, config);
+}
+
+static GstFlowReturn
+gst_fbdev_buffer_pool_alloc_buffer (GstBufferPool * pool, GstBuffer ** buffer,
+    GstBufferPoolAcquireParams * params)
+{
+  GstFBDEVBufferPool *fbpool = GST_FBDEV_BUFFER_POOL (pool);
+  GstFBDEVSink *sink = fbpool->sink;
+  gsize page_size = sink->varinfo.yres * sink->fixinfo.line_length;
+  gsize offset[GST_VIDEO_MAX_PLANES] = { fbpool->offset, };
+  gint stride[GST_VIDEO_MAX_PLANES] = { sink->fixinfo.line_length, };
+  GstBuffer *buf;
+  guint page;
+
+  for (page = 0; page < N_PAGES; page++) {
+    if (!(fbpool->pages_in_use & (1 << page)))
+      break;
+  }
+  if (page == N_PAGES)
+    return GST_FLOW_ERROR;
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf,
+      gst_memory_new_wrapped (0, sink->framebuffer + page * page_size,
+          page_size, 0, page_size, NULL, NULL));
+  gst_buffer_add_video_meta_full (buf, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_INFO_FORMAT (&fbpool->info),
+      GST_VIDEO_INFO_WIDTH (&fbpool->info),
+      GST_VIDEO_INFO_HEIGHT (&fbpool->info), 1, offset, stride);
+  gst_mini_object_set_qdata (GST_MINI_OBJECT (buf), fbdev_page_quark,
+      GINT_TO_POINTER (page + 1), NULL);
+
+  fbpool->pages_in_use |= 1 << page;
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_fbdev_buffer_pool_free_buffer (GstBufferPool * pool, GstBuffer * buffer)
+{
+  GstFBDEVBufferPool *fbpool = GST_FBDEV_BUFFER_POOL (pool);
+
+  fbpool->pages_in_use &= ~(1 << gst_fbdev_buffer_get_page (buffer));
+
+  GST_BUFFER_POOL_CLASS (gst_fbdev_buffer_pool_parent_class)->free_buffer
+      (pool, buffer);
+}
+
+static void
+gst_fbdev_buffer_pool_finalize (GObject * object)
+{
+  GstFBDEVBufferPool *fbpool = GST_FBDEV_BUFFER_POOL (object);
+
+  gst_object_unref (fbpool->sink);
+
+  G_OBJECT_CLASS (gst_fbdev_buffer_pool_parent_class)->finalize (object);
+}
+
+static void
+gst_fbdev_buffer_pool_class_init (GstFBDEVBufferPoolClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstBufferPoolClass *pool_class = (GstBufferPoolClass *) klass;
+
+  gobject_class->finalize = gst_fbdev_buffer_pool_finalize;
+
+  pool_class->get_options = gst_fbdev_buffer_pool_get_options;
+  pool_class->set_config = gst_fbdev_buffer_pool_set_config;
+  pool_class->alloc_buffer = gst_fbdev_buffer_pool_alloc_buffer;
+  pool_class->free_buffer = gst_fbdev_buffer_pool_free_buffer;
+
+  fbdev_page_quark = g_quark_from_static_string ("GstFBDEVPage");
+}
+
+static void
+gst_fbdev_buffer_pool_init (GstFBDEVBufferPool * pool)
+{
+}
+
+static GstBufferPool *
+gst_fbdev_buffer_pool_new (GstFBDEVSink * sink)
+{
+  GstFBDEVBufferPool *pool;
+
+  pool = g_object_new (gst_fbdev_buffer_pool_get_type (), NULL);
+  pool->sink = gst_object_ref (sink);
+
+  return GST_BUFFER_POOL (pool);
+}
+
 #define parent_class gst_fbdevsink_parent_class
 G_DEFINE_TYPE (GstFBDEVSink, gst_fbdevsink, GST_TYPE_VIDEO_SINK);
 
 static void
 gst_fbdevsink_init (GstFBDEVSink * fbdevsink)
 {
-  /* nothing to do here yet */
+  fbdevsink->page_flip = DEFAULT_PAGE_FLIP;
 }
 
 #if 0
@@ -255,6 +422,94 @@ gst_fbdevsink_setcaps (GstBaseSink * bsink, GstCaps * vscapslist)
   return TRUE;
 }
 
+static gboolean
+gst_fbdevsink_propose_allocation (GstBaseSink * bsink, GstQuery * query)
+{
+  GstFBDEVSink *fbdevsink = GST_FBDEVSINK (bsink);
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstCaps *caps;
+  gboolean need_pool;
+  guint size;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL)
+    return FALSE;
+
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  /* only the screen pages can be proposed, and only one pool can use them */
+  if (!fbdevsink->flipping || !need_pool)
+    return TRUE;
+
+  size = fbdevsink->varinfo.yres * fbdevsink->fixinfo.line_length;
+
+  GST_OBJECT_LOCK (fbdevsink);
+  pool = fbdevsink->pool ? gst_object_ref (fbdevsink->pool) : NULL;
+  GST_OBJECT_UNLOCK (fbdevsink);
+
+  if (pool) {
+    GstCaps *pcaps;
+
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_get_params (config, &pcaps, NULL, NULL, NULL);
+    if (!gst_caps_is_equal (caps, pcaps)) {
+      gst_object_unref (pool);
+      pool = NULL;
+    }
+    gst_structure_free (config);
+  }
+
+  if (pool == NULL) {
+    pool = gst_fbdev_buffer_pool_new (fbdevsink);
+
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, size, N_PAGES, N_PAGES);
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+    if (!gst_buffer_pool_set_config (pool, config)) {
+      /* e.g. the video is larger than the screen and needs cropping */
+      GST_DEBUG_OBJECT (fbdevsink, "can't render %" GST_PTR_FORMAT
+          " into screen pages", caps);
+      gst_object_unref (pool);
+      return TRUE;
+    }
+
+    GST_OBJECT_LOCK (fbdevsink);
+    if (fbdevsink->pool)
+      gst_object_unref (fbdevsink->pool);
+    fbdevsink->pool = gst_object_ref (pool);
+    GST_OBJECT_UNLOCK (fbdevsink);
+  }
+
+  gst_query_add_allocation_pool (query, pool, size, N_PAGES, N_PAGES);
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+static void
+gst_fbdevsink_flip (GstFBDEVSink * fbdevsink, guint page)
+{
+  fbdevsink->varinfo.xoffset = 0;
+  fbdevsink->varinfo.yoffset = page * fbdevsink->varinfo.yres;
+
+  if (ioctl (fbdevsink->fd, FBIOPAN_DISPLAY, &fbdevsink->varinfo))
+    GST_WARNING_OBJECT (fbdevsink, "failed to pan to page %u", page);
+
+#ifdef FBIO_WAITFORVSYNC
+  {
+    __u32 crtc = 0;
+
+    /* not all drivers wait for the vertical blank when panning */
+    if (ioctl (fbdevsink->fd, FBIO_WAITFORVSYNC, &crtc))
+      GST_LOG_OBJECT (fbdevsink, "failed to wait for vsync");
+  }
+#endif
+
+  fbdevsink->front_page = page;
+}
+
 
 static GstFlowReturn
 gst_fbdevsink_show_frame (GstVideoSink * videosink, GstBuffer * buf)
@@ -262,18 +517,30 @@ gst_fbdevsink_show_frame (GstVideoSink * videosink, GstBuffer * buf)
 
   GstFBDEVSink *fbdevsink;
   GstMapInfo map;
+  unsigned char *page;
+  guint back_page;
   int i;
 
   fbdevsink = GST_FBDEVSINK (videosink);
 
-  /* optimization could remove this memcpy by allocating the buffer
-     in framebuffer memory, but would only work when xres matches
-     the video width */
+  if (fbdevsink->flipping && buf->pool
+      && gst_fbdev_buffer_get_page (buf) >= 0) {
+    /* upstream rendered straight into one of the screen pages, keep the
+     * buffer until it is off screen again */
+    gst_fbdevsink_flip (fbdevsink, gst_fbdev_buffer_get_page (buf));
+    gst_buffer_replace (&fbdevsink->displayed, buf);
+    return GST_FLOW_OK;
+  }
+
+  back_page = fbdevsink->flipping ? !fbdevsink->front_page : 0;
+  page = fbdevsink->framebuffer
+      + back_page * fbdevsink->varinfo.yres * fbdevsink->fixinfo.line_length;
+
   if (!gst_buffer_map (buf, &map, GST_MAP_READ))
     return GST_FLOW_ERROR;
 
   for (i = 0; i < fbdevsink->lines; i++) {
-    memcpy (fbdevsink->framebuffer
+    memcpy (page
         + (i + fbdevsink->cy) * fbdevsink->fixinfo.line_length
         + fbdevsink->cx * fbdevsink->bytespp,
         map.data + i * fbdevsink->width * fbdevsink->bytespp,
@@ -282,6 +549,11 @@ gst_fbdevsink_show_frame (GstVideoSink * videosink, GstBuffer * buf)
 
   gst_buffer_unmap (buf, &map);
 
+  if (fbdevsink->flipping) {
+    gst_fbdevsink_flip (fbdevsink, back_page);
+    gst_buffer_replace (&fbdevsink->displayed, NULL);
+  }
+
   return GST_FLOW_OK;
 }
 
@@ -309,6 +581,35 @@ gst_fbdevsink_start (GstBaseSink * bsink)
   if (ioctl (fbdevsink->fd, FBIOGET_VSCREENINFO, &fbdevsink->varinfo))
     return FALSE;
 
+  fbdevsink->orig_varinfo = fbdevsink->varinfo;
+  fbdevsink->flipping = FALSE;
+  fbdevsink->front_page = 0;
+
+  if (fbdevsink->page_flip) {
+    struct fb_var_screeninfo varinfo = fbdevsink->varinfo;
+
+    /* ask for a virtual screen with room for a second page below the
+     * visible one, drivers that can't do it keep the copying path */
+    varinfo.yres_virtual = varinfo.yres * N_PAGES;
+    varinfo.xoffset = 0;
+    varinfo.yoffset = 0;
+
+    if (ioctl (fbdevsink->fd, FBIOPUT_VSCREENINFO, &varinfo) == 0
+        && ioctl (fbdevsink->fd, FBIOGET_FSCREENINFO, &fbdevsink->fixinfo) == 0
+        && ioctl (fbdevsink->fd, FBIOGET_VSCREENINFO, &varinfo) == 0
+        && varinfo.yres_virtual >= varinfo.yres * N_PAGES
+        && fbdevsink->fixinfo.smem_len >=
+        varinfo.yres * N_PAGES * fbdevsink->fixinfo.line_length) {
+      fbdevsink->varinfo = varinfo;
+      fbdevsink->flipping = TRUE;
+    } else {
+      GST_WARNING_OBJECT (fbdevsink, "failed to set up a virtual framebuffer "
+          "for page flipping, copying frames instead");
+      ioctl (fbdevsink->fd, FBIOPUT_VSCREENINFO, &fbdevsink->orig_varinfo);
+      ioctl (fbdevsink->fd, FBIOGET_FSCREENINFO, &fbdevsink->fixinfo);
+    }
+  }
+
   /* map the framebuffer */
   fbdevsink->framebuffer = mmap (0, fbdevsink->fixinfo.smem_len,
       PROT_WRITE, MAP_SHARED, fbdevsink->fd, 0);
@@ -325,6 +626,21 @@ gst_fbdevsink_stop (GstBaseSink * bsink)
 
   fbdevsink = GST_FBDEVSINK (bsink);
 
+  gst_buffer_replace (&fbdevsink->displayed, NULL);
+
+  GST_OBJECT_LOCK (fbdevsink);
+  if (fbdevsink->pool) {
+    gst_buffer_pool_set_active (fbdevsink->pool, FALSE);
+    gst_object_unref (fbdevsink->pool);
+    fbdevsink->pool = NULL;
+  }
+  GST_OBJECT_UNLOCK (fbdevsink);
+
+  if (fbdevsink->flipping) {
+    ioctl (fbdevsink->fd, FBIOPUT_VSCREENINFO, &fbdevsink->orig_varinfo);
+    fbdevsink->flipping = FALSE;
+  }
+
   if (munmap (fbdevsink->framebuffer, fbdevsink->fixinfo.smem_len))
     return FALSE;
 
@@ -349,6 +665,9 @@ gst_fbdevsink_set_property (GObject * object, guint prop_id,
       fbdevsink->device = g_value_dup_string (value);
       break;
     }
+    case ARG_PAGE_FLIP:
+      fbdevsink->page_flip = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -369,6 +688,9 @@ gst_fbdevsink_get_property (GObject * object, guint prop_id, GValue * value,
       g_value_set_string (value, fbdevsink->device);
       break;
     }
+    case ARG_PAGE_FLIP:
+      g_value_set_boolean (value, fbdevsink->page_flip);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -425,8 +747,16 @@ gst_fbdevsink_class_init (GstFBDEVSinkClass * klass)
       g_param_spec_string ("device", "device",
           "The framebuffer device eg: /dev/fb0", NULL, G_PARAM_READWRITE));
 
+  g_object_class_install_property (G_OBJECT_CLASS (klass), ARG_PAGE_FLIP,
+      g_param_spec_boolean ("page-flip", "Page flip",
+          "Render into a hidden page of a double height virtual framebuffer "
+          "and pan to it on vsync, letting upstream render into it directly",
+          DEFAULT_PAGE_FLIP, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   basesink_class->set_caps = GST_DEBUG_FUNCPTR (gst_fbdevsink_setcaps);
   basesink_class->get_caps = GST_DEBUG_FUNCPTR (gst_fbdevsink_getcaps);
+  basesink_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_fbdevsink_propose_allocation);
 #if 0
   basesink_class->get_times = GST_DEBUG_FUNCPTR (gst_fbdevsink_get_times);
 #endif
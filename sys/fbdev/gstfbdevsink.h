@@ -59,6 +59,17 @@ struct _GstFBDEVSink {
   int cx, cy, linelen, lines, bytespp;
 
   int fps_n, fps_d;
+
+  /* page flipping: the virtual framebuffer holds two screen pages, frames
+   * are rendered into the hidden page which is then panned to */
+  gboolean page_flip;
+  gboolean flipping;
+  struct fb_var_screeninfo orig_varinfo;
+  guint front_page;
+  /* pool buffer on the front page, kept until the next flip so upstream
+   * can't write into the page being scanned out */
+  GstBuffer *displayed;
+  GstBufferPool *pool;
 };
 
 struct _GstFBDEVSinkClass {
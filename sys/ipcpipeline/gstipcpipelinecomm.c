@@ -27,8 +27,14 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #include <gst/base/gstbytewriter.h>
 #include <gst/gstprotection.h>
+#include <gst/allocators/allocators.h>
 #include "gstipcpipelinecomm.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
@@ -36,7 +42,80 @@ GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
 
+/* at most this many fds are expected with a single read */
+#define MAX_FDS_PER_READ 16
+
+#if defined (__linux__) && defined (SYS_memfd_create)
+#define HAVE_MEMFD 1
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#endif
+
 GQuark QUARK_ID;
+static GQuark QUARK_FD_RELEASE;
+
+/* Allocates fd memory backed by a memfd, so that buffers allocated by
+ * upstream can be passed to the peer without any copy */
+typedef GstFdAllocator GstIpcPipelineMemfdAllocator;
+typedef GstFdAllocatorClass GstIpcPipelineMemfdAllocatorClass;
+
+static GType gst_ipc_pipeline_memfd_allocator_get_type (void);
+G_DEFINE_TYPE (GstIpcPipelineMemfdAllocator, gst_ipc_pipeline_memfd_allocator,
+    GST_TYPE_FD_ALLOCATOR);
+
+static GstMemory *
+gst_ipc_pipeline_memfd_allocator_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+#ifdef HAVE_MEMFD
+  GstMemory *mem;
+  gsize maxsize = size + params->prefix + params->padding;
+  int fd;
+
+  fd = syscall (SYS_memfd_create, "ipcpipeline", MFD_CLOEXEC);
+  if (fd < 0) {
+    GST_WARNING ("memfd_create failed: %s", strerror (errno));
+    return NULL;
+  }
+  if (ftruncate (fd, maxsize) < 0) {
+    GST_WARNING ("Could not resize memfd to %" G_GSIZE_FORMAT " bytes: %s",
+        maxsize, strerror (errno));
+    close (fd);
+    return NULL;
+  }
+
+  mem = gst_fd_allocator_alloc (allocator, fd, maxsize,
+      GST_FD_MEMORY_FLAG_KEEP_MAPPED);
+  gst_memory_resize (mem, params->prefix, size);
+
+  return mem;
+#else
+  return NULL;
+#endif
+}
+
+static void
+gst_ipc_pipeline_memfd_allocator_class_init (GstIpcPipelineMemfdAllocatorClass
+    * klass)
+{
+  GST_ALLOCATOR_CLASS (klass)->alloc = gst_ipc_pipeline_memfd_allocator_alloc;
+}
+
+static void
+gst_ipc_pipeline_memfd_allocator_init (GstIpcPipelineMemfdAllocator * self)
+{
+  /* unlike the fd allocator, this one can be used by anybody */
+  GST_OBJECT_FLAG_UNSET (self, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+}
+
+/* Attached to memory received as an fd, tells the peer once it is freed */
+typedef struct
+{
+  GstIpcPipelineComm *comm;
+  GstElement *element;
+  guint32 id;
+} FdRelease;
 
 typedef enum
 {
@@ -63,6 +142,9 @@ typedef struct
   GstQuery *query;
   CommRequestType type;
   GCond cond;
+  /* nobody waits for the reply of an async request, see
+   * GstIpcPipelineComm::max_pending_buffers */
+  gboolean async;
 } CommRequest;
 
 static const gchar *comm_request_ret_get_name (CommRequestType type,
@@ -82,6 +164,7 @@ comm_request_new (guint32 id, CommRequestType type, GstQuery * query)
   req->query = query;
   req->ret = comm_request_ret_get_failure_value (type);
   req->type = type;
+  req->async = FALSE;
 
   return req;
 }
@@ -186,6 +269,10 @@ gst_ipc_pipeline_comm_data_type_get_name (GstIpcPipelineCommDataType type)
       return "MESSAGE";
     case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
       return "GERROR_MESSAGE";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+      return "FD_BUFFER";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_RELEASE:
+      return "FD_RELEASE";
     default:
       return "UNKNOWN";
   }
@@ -239,8 +326,53 @@ done:
   return ret;
 }
 
+/* Sends fd along with the first byte of data */
 static gboolean
-write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
+write_to_fd_with_fd (GstIpcPipelineComm * comm, const guint8 * data,
+    size_t size, int fd)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  ssize_t written;
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = (void *) data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+
+  GST_TRACE_OBJECT (comm->element, "Writing %zu bytes and fd %d to fdout",
+      size, fd);
+  do {
+    written = sendmsg (comm->fdout, &msg, 0);
+  } while (written < 0 && (errno == EAGAIN || errno == EINTR));
+
+  if (written < 0) {
+    GST_ERROR_OBJECT (comm->element, "Failed to write to fd: %s",
+        strerror (errno));
+    return FALSE;
+  }
+
+  return write_to_fd_raw (comm, data + written, size - written);
+}
+
+static gboolean
+write_byte_writer_to_fd_full (GstIpcPipelineComm * comm, GstByteWriter * bw,
+    int fd)
 {
   guint8 *data;
   gboolean ret;
@@ -250,11 +382,88 @@ write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
   data = gst_byte_writer_reset_and_get_data (bw);
   if (!data)
     return FALSE;
-  ret = write_to_fd_raw (comm, data, size);
+  if (fd >= 0)
+    ret = write_to_fd_with_fd (comm, data, size, fd);
+  else
+    ret = write_to_fd_raw (comm, data, size);
   g_free (data);
   return ret;
 }
 
+static gboolean
+write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
+{
+  return write_byte_writer_to_fd_full (comm, bw, -1);
+}
+
+static gboolean
+fd_is_socket (int fd)
+{
+  int type;
+  socklen_t len = sizeof (type);
+
+  return getsockopt (fd, SOL_SOCKET, SO_TYPE, &type, &len) == 0;
+}
+
+/* call with comm->mutex */
+static void
+gst_ipc_pipeline_comm_write_releases (GstIpcPipelineComm * comm)
+{
+  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_RELEASE;
+  GstByteWriter bw;
+  gboolean ok = TRUE;
+  guint i;
+
+  g_mutex_lock (&comm->release_lock);
+  if (comm->pending_releases->len == 0) {
+    g_mutex_unlock (&comm->release_lock);
+    return;
+  }
+
+  gst_byte_writer_init (&bw);
+  for (i = 0; i < comm->pending_releases->len && ok; i++) {
+    guint32 id = g_array_index (comm->pending_releases, guint32, i);
+
+    GST_TRACE_OBJECT (comm->element, "Writing FD_RELEASE for %u", id);
+    ok = gst_byte_writer_put_uint8 (&bw, payload_type)
+        && gst_byte_writer_put_uint32_le (&bw, id)
+        && gst_byte_writer_put_uint32_le (&bw, 0);
+  }
+  g_array_set_size (comm->pending_releases, 0);
+  g_mutex_unlock (&comm->release_lock);
+
+  /* the peer is gone, nobody is waiting for those anymore */
+  if (ok && comm->fdout >= 0)
+    ok = write_byte_writer_to_fd (comm, &bw);
+  if (!ok)
+    GST_WARNING_OBJECT (comm->element, "Failed to write buffer releases");
+  gst_byte_writer_reset (&bw);
+}
+
+static void
+fd_release_free (gpointer data)
+{
+  FdRelease *release = data;
+  GstIpcPipelineComm *comm = release->comm;
+
+  GST_TRACE_OBJECT (release->element, "Buffer %u released", release->id);
+
+  g_mutex_lock (&comm->release_lock);
+  g_array_append_val (comm->pending_releases, release->id);
+  g_mutex_unlock (&comm->release_lock);
+
+  /* the memory can be freed anywhere, even while this thread is writing
+   * something else. If so, the release is written with the next ack or by
+   * the reader thread. */
+  if (g_mutex_trylock (&comm->mutex)) {
+    gst_ipc_pipeline_comm_write_releases (comm);
+    g_mutex_unlock (&comm->mutex);
+  }
+
+  gst_object_unref (release->element);
+  g_free (release);
+}
+
 static void
 gst_ipc_pipeline_comm_write_ack_to_fd (GstIpcPipelineComm * comm, guint32 id,
     guint32 ret, CommRequestType type)
@@ -265,6 +474,8 @@ gst_ipc_pipeline_comm_write_ack_to_fd (GstIpcPipelineComm * comm, guint32 id,
 
   g_mutex_lock (&comm->mutex);
 
+  gst_ipc_pipeline_comm_write_releases (comm);
+
   GST_TRACE_OBJECT (comm->element, "Writing ACK for %u: %s (%d)", id,
       comm_request_ret_get_name (type, ret), ret);
   gst_byte_writer_init (&bw);
@@ -496,11 +707,62 @@ typedef struct
   guint64 flags;
 } CommBufferMetadata;
 
+/* call with comm->mutex */
+static gboolean
+gst_ipc_pipeline_comm_can_pass_fds (GstIpcPipelineComm * comm)
+{
+  if (comm->fdout_checked != comm->fdout) {
+    comm->fdout_checked = comm->fdout;
+    comm->fdout_is_socket = comm->fdout >= 0 && fd_is_socket (comm->fdout);
+    if (!comm->fdout_is_socket)
+      GST_WARNING_OBJECT (comm->element, "fdout %d is not a socket, buffer "
+          "contents will be written to it", comm->fdout);
+  }
+
+  return comm->fdout_is_socket;
+}
+
+/* Returns a buffer made of a single fd memory with the contents of buffer:
+ * buffer itself if possible, or a copy into a memfd */
+static GstBuffer *
+gst_ipc_pipeline_comm_get_fd_buffer (GstIpcPipelineComm * comm,
+    GstBuffer * buffer)
+{
+  GstBuffer *fd_buffer;
+  GstMapInfo map;
+  gsize size;
+
+  if (gst_buffer_n_memory (buffer) == 1
+      && gst_is_fd_memory (gst_buffer_peek_memory (buffer, 0)))
+    return gst_buffer_ref (buffer);
+
+  size = gst_buffer_get_size (buffer);
+  if (!comm->memfd_allocator || size == 0)
+    return NULL;
+
+  fd_buffer = gst_buffer_new_allocate (comm->memfd_allocator, size, NULL);
+  if (!fd_buffer)
+    return NULL;
+
+  if (!gst_buffer_map (fd_buffer, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (fd_buffer);
+    return NULL;
+  }
+  gst_buffer_extract (buffer, 0, map.data, size);
+  gst_buffer_unmap (fd_buffer, &map);
+
+  GST_TRACE_OBJECT (comm->element, "Copied %" G_GSIZE_FORMAT " bytes to a "
+      "memfd", size);
+
+  return fd_buffer;
+}
+
 GstFlowReturn
 gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
 {
-  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
+  unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
+  GstBuffer *fd_buffer = NULL;
   GstMapInfo map;
   guint32 ret32 = GST_FLOW_OK;
   guint32 size, n;
@@ -510,6 +772,24 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   GstByteWriter bw;
 
   g_mutex_lock (&comm->mutex);
+
+  while (comm->max_pending_buffers > 0) {
+    /* report what happened to the buffers sent before */
+    if (comm->async_flow_ret != GST_FLOW_OK) {
+      ret = comm->async_flow_ret;
+      comm->async_flow_ret = GST_FLOW_OK;
+      g_mutex_unlock (&comm->mutex);
+      GST_DEBUG_OBJECT (comm->element, "Returning earlier flow return %s, "
+          "buffer dropped", gst_flow_get_name (ret));
+      return ret;
+    }
+    if (comm->pending_buffers < comm->max_pending_buffers)
+      break;
+    GST_TRACE_OBJECT (comm->element, "Waiting for one of %u pending buffers",
+        comm->pending_buffers);
+    g_cond_wait (&comm->window_cond, &comm->mutex);
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing buffer %u: %" GST_PTR_FORMAT,
@@ -527,29 +807,62 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   /* work out meta size */
   gst_buffer_foreach_meta (buffer, build_meta, &repr);
 
+  if (comm->fd_passing && gst_ipc_pipeline_comm_can_pass_fds (comm))
+    fd_buffer = gst_ipc_pipeline_comm_get_fd_buffer (comm, buffer);
+  if (fd_buffer)
+    payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER;
+
   if (!gst_byte_writer_put_uint8 (&bw, payload_type))
     goto write_failed;
   if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
     goto write_failed;
-  size =
-      gst_buffer_get_size (buffer) + sizeof (guint32) +
-      sizeof (CommBufferMetadata) + repr.total_bytes;
-  if (!gst_byte_writer_put_uint32_le (&bw, size))
-    goto write_failed;
-  if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
-    goto write_failed;
-  size = gst_buffer_get_size (buffer);
-  if (!gst_byte_writer_put_uint32_le (&bw, size))
-    goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
-    goto write_failed;
+  if (fd_buffer) {
+    GstMemory *mem = gst_buffer_peek_memory (fd_buffer, 0);
+    gsize offset;
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
+    size = sizeof (CommBufferMetadata) + sizeof (guint32) +
+        2 * sizeof (guint64) + repr.total_bytes;
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
+      goto write_failed;
+    if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
+      goto write_failed;
+    gst_memory_get_sizes (mem, &offset, NULL);
+    if (!gst_byte_writer_put_uint32_le (&bw, gst_is_dmabuf_memory (mem)))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, offset))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, mem->size))
+      goto write_failed;
+
+    /* keep the memory until the peer is done with it */
+    g_hash_table_insert (comm->sent_fd_buffers,
+        GINT_TO_POINTER (comm->send_id), gst_buffer_ref (fd_buffer));
+    if (!write_byte_writer_to_fd_full (comm, &bw, gst_fd_memory_get_fd (mem))) {
+      g_hash_table_remove (comm->sent_fd_buffers,
+          GINT_TO_POINTER (comm->send_id));
+      goto write_failed;
+    }
+  } else {
+    size =
+        gst_buffer_get_size (buffer) + sizeof (guint32) +
+        sizeof (CommBufferMetadata) + repr.total_bytes;
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
+      goto write_failed;
+    if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
+      goto write_failed;
+    size = gst_buffer_get_size (buffer);
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
+      goto write_failed;
+    if (!write_byte_writer_to_fd (comm, &bw))
+      goto write_failed;
+
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+      goto map_failed;
+    ret = write_to_fd_raw (comm, map.data, map.size);
+    gst_buffer_unmap (buffer, &map);
+    if (!ret)
+      goto write_failed;
+  }
 
   /* meta */
   gst_byte_writer_init (&bw);
@@ -588,14 +901,29 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   if (!write_byte_writer_to_fd (comm, &bw))
     goto write_failed;
 
-  if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
-          ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
-    goto wait_failed;
-  ret = ret32;
+  if (comm->max_pending_buffers > 0) {
+    CommRequest *req;
+
+    /* the reply is handled by the reader thread, and the stream keeps
+     * serialized events and queries sent later behind this buffer */
+    req = comm_request_new (comm->send_id, COMM_REQUEST_TYPE_BUFFER, NULL);
+    req->async = TRUE;
+    g_hash_table_insert (comm->waiting_ids, GINT_TO_POINTER (comm->send_id),
+        req);
+    comm->pending_buffers++;
+    ret = GST_FLOW_OK;
+  } else {
+    if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
+            ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
+      goto wait_failed;
+    ret = ret32;
+  }
 
 done:
   g_mutex_unlock (&comm->mutex);
   gst_byte_writer_reset (&bw);
+  if (fd_buffer)
+    gst_buffer_unref (fd_buffer);
   for (n = 0; n < repr.n_meta; ++n)
     g_free (repr.info[n].str);
   g_free (repr.info);
@@ -620,12 +948,14 @@ map_failed:
   goto done;
 }
 
+static gboolean gst_ipc_pipeline_comm_read_buffer_meta (GstIpcPipelineComm *
+    comm, GstBuffer * buffer, const CommBufferMetadata * bmeta, guint32 size);
+
 static GstBuffer *
 gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
 {
   GstBuffer *buffer;
   CommBufferMetadata meta;
-  guint32 n_meta, n;
   const guint8 *payload = NULL;
   guint32 mapped_size, buffer_data_size;
 
@@ -652,12 +982,113 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
   }
   size -= buffer_data_size;
 
-  GST_BUFFER_PTS (buffer) = meta.pts;
-  GST_BUFFER_DTS (buffer) = meta.dts;
-  GST_BUFFER_DURATION (buffer) = meta.duration;
-  GST_BUFFER_OFFSET (buffer) = meta.offset;
-  GST_BUFFER_OFFSET_END (buffer) = meta.offset_end;
-  GST_BUFFER_FLAGS (buffer) = meta.flags;
+  if (!gst_ipc_pipeline_comm_read_buffer_meta (comm, buffer, &meta, size)) {
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
+  return buffer;
+}
+
+static GstBuffer *
+gst_ipc_pipeline_comm_read_fd_buffer (GstIpcPipelineComm * comm, guint32 size)
+{
+  GstBuffer *buffer;
+  GstMemory *mem;
+  CommBufferMetadata meta;
+  FdRelease *release;
+  const guint8 *payload = NULL;
+  guint32 mapped_size, is_dmabuf;
+  guint64 offset, mem_size;
+  off_t total;
+  int fd;
+
+  /* this should not be called if we don't have enough yet */
+  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
+
+  /* the fd was received with the first byte of this chunk */
+  if (g_queue_is_empty (&comm->received_fds)) {
+    GST_ERROR_OBJECT (comm->element, "No fd received for buffer %u", comm->id);
+    return NULL;
+  }
+  fd = GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds));
+
+  mapped_size = sizeof (CommBufferMetadata) + sizeof (is_dmabuf) +
+      sizeof (offset) + sizeof (mem_size);
+  if (size < mapped_size)
+    goto error;
+  payload = gst_adapter_map (comm->adapter, mapped_size);
+  if (!payload)
+    goto error;
+  memcpy (&meta, payload, sizeof (CommBufferMetadata));
+  payload += sizeof (CommBufferMetadata);
+  memcpy (&is_dmabuf, payload, sizeof (is_dmabuf));
+  payload += sizeof (is_dmabuf);
+  memcpy (&offset, payload, sizeof (offset));
+  payload += sizeof (offset);
+  memcpy (&mem_size, payload, sizeof (mem_size));
+  size -= mapped_size;
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, mapped_size);
+
+  total = lseek (fd, 0, SEEK_END);
+  if (total < 0 || offset > (guint64) total
+      || mem_size > (guint64) total - offset) {
+    GST_ERROR_OBJECT (comm->element, "Invalid memory of %" G_GUINT64_FORMAT
+        " bytes at %" G_GUINT64_FORMAT ", fd size is %" G_GINT64_FORMAT,
+        mem_size, offset, (gint64) total);
+    goto error;
+  }
+
+  GST_TRACE_OBJECT (comm->element, "Got %s fd %d for buffer %u",
+      is_dmabuf ? "dmabuf" : "memfd", fd, comm->id);
+
+  /* the memory owns the fd from now on */
+  if (is_dmabuf)
+    mem = gst_dmabuf_allocator_alloc (comm->dmabuf_allocator, fd, total);
+  else
+    mem = gst_fd_allocator_alloc (comm->fd_allocator, fd, total,
+        GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize (mem, offset, mem_size);
+  /* the sender may still be using it */
+  GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+
+  release = g_new (FdRelease, 1);
+  release->comm = comm;
+  release->element = gst_object_ref (comm->element);
+  release->id = comm->id;
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem), QUARK_FD_RELEASE,
+      release, fd_release_free);
+
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, mem);
+
+  if (!gst_ipc_pipeline_comm_read_buffer_meta (comm, buffer, &meta, size)) {
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
+  return buffer;
+
+error:
+  close (fd);
+  return NULL;
+}
+
+static gboolean
+gst_ipc_pipeline_comm_read_buffer_meta (GstIpcPipelineComm * comm,
+    GstBuffer * buffer, const CommBufferMetadata * bmeta, guint32 size)
+{
+  guint32 n_meta, n;
+  const guint8 *payload = NULL;
+  guint32 mapped_size;
+
+  GST_BUFFER_PTS (buffer) = bmeta->pts;
+  GST_BUFFER_DTS (buffer) = bmeta->dts;
+  GST_BUFFER_DURATION (buffer) = bmeta->duration;
+  GST_BUFFER_OFFSET (buffer) = bmeta->offset;
+  GST_BUFFER_OFFSET_END (buffer) = bmeta->offset_end;
+  GST_BUFFER_FLAGS (buffer) = bmeta->flags;
 
   /* If you don't call that, the GType isn't yet known at the
      g_type_from_name below */
@@ -665,10 +1096,8 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
 
   mapped_size = size;
   payload = gst_adapter_map (comm->adapter, mapped_size);
-  if (!payload) {
-    gst_buffer_unref (buffer);
-    return NULL;
-  }
+  if (!payload)
+    return FALSE;
   memcpy (&n_meta, payload, sizeof (n_meta));
   payload += sizeof (n_meta);
 
@@ -717,7 +1146,7 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
   gst_adapter_unmap (comm->adapter);
   gst_adapter_flush (comm->adapter, mapped_size);
 
-  return buffer;
+  return TRUE;
 }
 
 static gboolean
@@ -969,6 +1398,11 @@ gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
     goto write_failed;
   ret = ret32;
 
+  /* the flushed buffers were acked before this, their flow return does
+   * not apply to what comes next */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP && !upstream)
+    comm->async_flow_ret = GST_FLOW_OK;
+
 done:
   g_mutex_unlock (&comm->mutex);
   g_free (str);
@@ -1607,6 +2041,30 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
   comm->adapter = gst_adapter_new ();
   comm->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&comm->pollFDin);
+
+  comm->async_flow_ret = GST_FLOW_OK;
+  g_cond_init (&comm->window_cond);
+
+  comm->fdout_checked = -1;
+#ifdef HAVE_MEMFD
+  comm->memfd_allocator =
+      g_object_new (gst_ipc_pipeline_memfd_allocator_get_type (), NULL);
+  gst_object_ref_sink (comm->memfd_allocator);
+#endif
+  comm->fd_allocator = gst_fd_allocator_new ();
+  comm->dmabuf_allocator = gst_dmabuf_allocator_new ();
+  comm->sent_fd_buffers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) gst_buffer_unref);
+  g_queue_init (&comm->received_fds);
+  g_mutex_init (&comm->release_lock);
+  comm->pending_releases = g_array_new (FALSE, FALSE, sizeof (guint32));
+}
+
+static void
+gst_ipc_pipeline_comm_close_received_fds (GstIpcPipelineComm * comm)
+{
+  while (!g_queue_is_empty (&comm->received_fds))
+    close (GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds)));
 }
 
 void
@@ -1616,6 +2074,27 @@ gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
   g_mutex_clear (&comm->mutex);
+  g_cond_clear (&comm->window_cond);
+
+  g_hash_table_destroy (comm->sent_fd_buffers);
+  gst_ipc_pipeline_comm_close_received_fds (comm);
+  g_array_free (comm->pending_releases, TRUE);
+  g_mutex_clear (&comm->release_lock);
+  if (comm->memfd_allocator)
+    gst_object_unref (comm->memfd_allocator);
+  gst_object_unref (comm->fd_allocator);
+  gst_object_unref (comm->dmabuf_allocator);
+}
+
+gboolean
+gst_ipc_pipeline_comm_propose_allocation (GstIpcPipelineComm * comm,
+    GstQuery * query)
+{
+  if (!comm->memfd_allocator)
+    return FALSE;
+
+  gst_query_add_allocation_param (query, comm->memfd_allocator, NULL);
+  return TRUE;
 }
 
 static void
@@ -1633,6 +2112,14 @@ cancel_request (gpointer key, gpointer value, gpointer user_data,
   g_cond_signal (&req->cond);
 }
 
+static gboolean
+cancel_async_request (gpointer key, gpointer value, gpointer user_data)
+{
+  CommRequest *req = (CommRequest *) value;
+
+  return req->async;
+}
+
 static void
 cancel_request_error (gpointer key, gpointer value, gpointer user_data)
 {
@@ -1646,12 +2133,18 @@ void
 gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm, gboolean cleanup)
 {
   g_mutex_lock (&comm->mutex);
+  /* nobody waits for those, forget about them */
+  g_hash_table_foreach_remove (comm->waiting_ids, cancel_async_request, comm);
+  comm->pending_buffers = 0;
+  g_cond_broadcast (&comm->window_cond);
   g_hash_table_foreach (comm->waiting_ids, cancel_request_error, comm);
   if (cleanup) {
     g_hash_table_unref (comm->waiting_ids);
     comm->waiting_ids =
         g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
         (GDestroyNotify) comm_request_free);
+    /* the peer will not release those anymore */
+    g_hash_table_remove_all (comm->sent_fd_buffers);
   }
   g_mutex_unlock (&comm->mutex);
 }
@@ -1680,6 +2173,16 @@ gst_ipc_pipeline_comm_reply_request (GstIpcPipelineComm * comm, guint32 id,
 
   GST_TRACE_OBJECT (comm->element, "Got reply %d (%s) for request %u", ret,
       comm_request_ret_get_name (req->type, ret), req->id);
+
+  if (req->async) {
+    if (ret != GST_FLOW_OK && comm->async_flow_ret == GST_FLOW_OK)
+      comm->async_flow_ret = ret;
+    g_hash_table_remove (comm->waiting_ids, GINT_TO_POINTER (id));
+    comm->pending_buffers--;
+    g_cond_broadcast (&comm->window_cond);
+    return TRUE;
+  }
+
   req->replied = TRUE;
   req->ret = ret;
   if (query) {
@@ -1699,6 +2202,60 @@ gst_ipc_pipeline_comm_reply_request (GstIpcPipelineComm * comm, guint32 id,
   return TRUE;
 }
 
+/* Reads like read(), and queues any fd passed along with the data */
+static ssize_t
+read_from_fd (GstIpcPipelineComm * comm, void *data, size_t size)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int) * MAX_FDS_PER_READ)];
+    struct cmsghdr align;
+  } control;
+  ssize_t sz;
+  int flags = 0;
+
+  if (!comm->fdin_is_socket)
+    return read (comm->pollFDin.fd, data, size);
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+  sz = recvmsg (comm->pollFDin.fd, &msg, flags);
+  if (sz < 0)
+    return sz;
+
+  if (msg.msg_flags & MSG_CTRUNC)
+    GST_WARNING_OBJECT (comm->element, "Some passed fds were lost");
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      guint n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+      guint i;
+
+      for (i = 0; i < n; i++) {
+        int fd;
+
+        memcpy (&fd, CMSG_DATA (cmsg) + i * sizeof (int), sizeof (int));
+        GST_TRACE_OBJECT (comm->element, "Received fd %d", fd);
+        g_queue_push_tail (&comm->received_fds, GINT_TO_POINTER (fd));
+      }
+    }
+  }
+
+  return sz;
+}
+
 static gint
 update_adapter (GstIpcPipelineComm * comm)
 {
@@ -1724,6 +2281,7 @@ again:
     if (comm->fdin != -1 && GST_OBJECT_PARENT (comm->element)) {
       GST_DEBUG_OBJECT (comm->element, "Start watching fd %d", comm->fdin);
       comm->pollFDin.fd = comm->fdin;
+      comm->fdin_is_socket = fd_is_socket (comm->fdin);
       gst_poll_add_fd (comm->poll, &comm->pollFDin);
       gst_poll_fd_ctl_read (comm->poll, &comm->pollFDin, TRUE);
     }
@@ -1745,7 +2303,7 @@ again:
       mem = gst_allocator_alloc (NULL, comm->read_chunk_size, NULL);
 
     gst_memory_map (mem, &map, GST_MAP_WRITE);
-    sz = read (comm->pollFDin.fd, map.data, map.size);
+    sz = read_from_fd (comm, map.data, map.size);
     gst_memory_unmap (mem, &map);
 
     if (sz <= 0) {
@@ -1810,6 +2368,8 @@ read_many (GstIpcPipelineComm * comm)
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_RELEASE:
             GST_TRACE_OBJECT (comm->element, "switching to state %s",
                 gst_ipc_pipeline_comm_data_type_get_name (type));
             comm->state = type;
@@ -1846,6 +2406,34 @@ read_many (GstIpcPipelineComm * comm)
         comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
         break;
       }
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_RELEASE:
+      {
+        GstBuffer *buf;
+
+        available = gst_adapter_available (comm->adapter);
+        if (available < comm->payload_length)
+          goto done;
+        gst_adapter_flush (comm->adapter, comm->payload_length);
+
+        g_mutex_lock (&comm->mutex);
+        buf = g_hash_table_lookup (comm->sent_fd_buffers,
+            GINT_TO_POINTER (comm->id));
+        g_hash_table_steal (comm->sent_fd_buffers, GINT_TO_POINTER (comm->id));
+        g_mutex_unlock (&comm->mutex);
+
+        if (buf) {
+          GST_TRACE_OBJECT (comm->element, "Peer released buffer %u",
+              comm->id);
+          gst_buffer_unref (buf);
+        } else {
+          GST_WARNING_OBJECT (comm->element, "Got release for unknown buffer "
+              "%u", comm->id);
+        }
+
+        GST_TRACE_OBJECT (comm->element, "switching to state TYPE");
+        comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
+        break;
+      }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_QUERY_RESULT:
       {
         GstQuery *query = NULL;
@@ -1874,6 +2462,7 @@ read_many (GstIpcPipelineComm * comm)
         break;
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER:
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
       {
         GstBuffer *buf;
 
@@ -1881,7 +2470,11 @@ read_many (GstIpcPipelineComm * comm)
         if (available < comm->payload_length)
           goto done;
 
-        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+        if (comm->state == GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER)
+          buf = gst_ipc_pipeline_comm_read_fd_buffer (comm,
+              comm->payload_length);
+        else
+          buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
         if (!buf)
           goto buffer_failed;
 
@@ -2155,6 +2748,11 @@ reader_thread (gpointer data)
         read_many (comm);
         break;
     }
+
+    /* releases which could not be written right away */
+    g_mutex_lock (&comm->mutex);
+    gst_ipc_pipeline_comm_write_releases (comm);
+    g_mutex_unlock (&comm->mutex);
   }
 
   GST_INFO_OBJECT (comm->element, "Reader thread ending");
@@ -2196,6 +2794,9 @@ gst_ipc_pipeline_comm_stop_reader_thread (GstIpcPipelineComm * comm)
   gst_poll_set_flushing (comm->poll, TRUE);
   g_thread_join (comm->reader_thread);
   comm->reader_thread = NULL;
+
+  /* the next peer starts a new stream */
+  gst_ipc_pipeline_comm_close_received_fds (comm);
 }
 
 static gchar *
@@ -2317,6 +2918,7 @@ gst_ipc_pipeline_comm_plugin_init (void)
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_comm_debug, "ipcpipelinecomm", 0,
         "ipc pipeline comm");
     QUARK_ID = g_quark_from_static_string ("ipcpipeline-id");
+    QUARK_FD_RELEASE = g_quark_from_static_string ("ipcpipeline-fd-release");
     REGISTER_SERIALIZATION_NO_COMPARE (gst_event_get_type (), event);
     g_once_init_leave (&once, (gsize) 1);
   }
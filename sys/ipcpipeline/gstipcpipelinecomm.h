@@ -51,6 +51,8 @@ typedef enum {
   GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_RELEASE,
 } GstIpcPipelineCommDataType;
 
 typedef struct
@@ -76,6 +78,30 @@ typedef struct
   guint read_chunk_size;
   GstClockTime ack_time;
 
+  /* up to max_pending_buffers buffers are sent without waiting for their
+   * flow return, the first non OK one is kept in async_flow_ret and given
+   * to the next push */
+  guint max_pending_buffers;
+  guint pending_buffers;
+  GstFlowReturn async_flow_ret;
+  GCond window_cond;
+
+  /* fd passing: buffers sent as fds wait in sent_fd_buffers until the
+   * peer releases them, received fds are queued until their buffer is
+   * parsed and releases of received buffers wait in pending_releases
+   * until they can be written */
+  gboolean fd_passing;
+  gboolean fdin_is_socket;
+  gint fdout_checked;
+  gboolean fdout_is_socket;
+  GstAllocator *memfd_allocator;
+  GstAllocator *fd_allocator;
+  GstAllocator *dmabuf_allocator;
+  GHashTable *sent_fd_buffers;
+  GQueue received_fds;
+  GMutex release_lock;
+  GArray *pending_releases;
+
   void (*on_buffer) (guint32, GstBuffer *, gpointer);
   void (*on_event) (guint32, GstEvent *, gboolean, gpointer);
   void (*on_query) (guint32, GstQuery *, gboolean, gpointer);
@@ -92,6 +118,8 @@ void gst_ipc_pipeline_comm_init (GstIpcPipelineComm *comm, GstElement *e);
 void gst_ipc_pipeline_comm_clear (GstIpcPipelineComm *comm);
 void gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm,
     gboolean flushing);
+gboolean gst_ipc_pipeline_comm_propose_allocation (GstIpcPipelineComm * comm,
+    GstQuery * query);
 
 void gst_ipc_pipeline_comm_write_flow_ack_to_fd (GstIpcPipelineComm * comm,
     guint32 id, GstFlowReturn ret);
@@ -56,6 +56,11 @@
  * custom protocol. Each buffer, event, query, message or state change is
  * serialized in a "packet" and sent over the socket. The sender then
  * performs a blocking wait for a reply, if a return code is needed.
+ * Waiting for the flow return of each buffer limits the throughput to one
+ * round-trip per buffer. With #GstIpcPipelineSink:max-pending-buffers, that
+ * many buffers can be sent before waiting and a failed flow return is given
+ * to the next push instead. Serialized events and queries still go through
+ * the socket after the buffers sent before them, so their ordering is kept.
  *
  * All objects that contan a GstStructure (messages, queries, events) are
  * serialized by serializing the GstStructure to a string
@@ -66,7 +71,12 @@
  * GError are serialized differently).
  *
  * Buffers are transported by writing their content directly on the socket.
- * More efficient ways for memory sharing could be implemented in the future.
+ * If #GstIpcPipelineSink:fd-passing is enabled and fdout is a Unix socket,
+ * buffers are instead passed as file descriptors: dmabuf and other fd backed
+ * memory is passed as is, anything else is copied once into a memfd. A memfd
+ * allocator is proposed to upstream so that it can produce buffers which are
+ * passed without any copy. The peer tells when it has released each buffer,
+ * so its memory is not reused too early.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -98,11 +108,15 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_FD_PASSING,
+  PROP_MAX_PENDING_BUFFERS,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_FD_PASSING FALSE
+#define DEFAULT_MAX_PENDING_BUFFERS 0
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -174,6 +188,33 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           "Maximum time to wait for a response to a message",
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstIpcPipelineSink:fd-passing:
+   *
+   * Pass buffers as file descriptors instead of writing their content to
+   * fdout, which must then be a Unix socket. The peer must support it.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing", "File descriptor passing",
+          "Pass buffers as dmabuf or memfd file descriptors",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstIpcPipelineSink:max-pending-buffers:
+   *
+   * Number of buffers which can be sent before their flow return is known.
+   * A buffer pushed after a failed flow return is dropped and gets that
+   * flow return. 0 waits for the flow return of every buffer.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING_BUFFERS,
+      g_param_spec_uint ("max-pending-buffers", "Max pending buffers",
+          "Maximum number of buffers sent without waiting for their flow "
+          "return (0 = wait for each buffer)", 0, G_MAXINT,
+          DEFAULT_MAX_PENDING_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
@@ -210,6 +251,8 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.fd_passing = DEFAULT_FD_PASSING;
+  sink->comm.max_pending_buffers = DEFAULT_MAX_PENDING_BUFFERS;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -271,6 +314,15 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_FD_PASSING:
+      sink->comm.fd_passing = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_PENDING_BUFFERS:
+      g_mutex_lock (&sink->comm.mutex);
+      sink->comm.max_pending_buffers = g_value_get_uint (value);
+      g_cond_broadcast (&sink->comm.window_cond);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,6 +348,12 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, sink->comm.fd_passing);
+      break;
+    case PROP_MAX_PENDING_BUFFERS:
+      g_value_set_uint (value, sink->comm.max_pending_buffers);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -344,6 +402,11 @@ gst_ipc_pipeline_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
 
   switch (GST_QUERY_TYPE (query)) {
     case GST_QUERY_ALLOCATION:
+      if (sink->comm.fd_passing
+          && gst_ipc_pipeline_comm_propose_allocation (&sink->comm, query)) {
+        GST_DEBUG_OBJECT (sink, "Proposing memfd allocator");
+        return TRUE;
+      }
       GST_DEBUG_OBJECT (sink, "Rejecting ALLOCATION query");
       return FALSE;
     case GST_QUERY_CAPS:
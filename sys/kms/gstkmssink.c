@@ -100,6 +100,7 @@ enum
   PROP_DISPLAY_HEIGHT,
   PROP_GLOBAL_ALPHA,
   PROP_FORCE_HANTROTILE,
+  PROP_ATOMIC,
   PROP_N
 };
 
@@ -854,6 +855,10 @@ retry_find_plane:
 
   check_scaleable (self);
 
+  self->use_atomic = self->atomic && !self->modesetting_enabled
+      && gst_kms_sink_init_atomic (self);
+  self->flip_pending = FALSE;
+
   self->pollfd.fd = self->fd;
   gst_poll_add_fd (self->poll, &self->pollfd);
   gst_poll_fd_ctl_read (self->poll, &self->pollfd, TRUE);
@@ -959,6 +964,11 @@ gst_kms_sink_stop (GstBaseSink * bsink)
   if (self->allocator)
     gst_kms_allocator_clear_cache (self->allocator);
 
+  if (self->use_atomic)
+    gst_kms_sink_wait_flip (self);
+  gst_buffer_replace (&self->pending_buffer, NULL);
+  gst_buffer_replace (&self->displayed_buffer, NULL);
+
   gst_buffer_replace (&self->last_buffer, NULL);
   gst_caps_replace (&self->allowed_caps, NULL);
   gst_object_replace ((GstObject **) & self->pool, NULL);
@@ -1414,6 +1424,167 @@ event_failed:
   }
 }
 
+static guint32
+get_plane_property_id (GstKMSSink * self, const gchar * name)
+{
+  drmModeObjectPropertiesPtr props;
+  drmModePropertyPtr prop;
+  guint32 prop_id = 0;
+  guint i;
+
+  props = drmModeObjectGetProperties (self->fd, self->plane_id,
+      DRM_MODE_OBJECT_PLANE);
+  if (!props)
+    return 0;
+
+  for (i = 0; i < props->count_props && !prop_id; i++) {
+    prop = drmModeGetProperty (self->fd, props->props[i]);
+    if (prop && !strcmp (prop->name, name))
+      prop_id = prop->prop_id;
+    drmModeFreeProperty (prop);
+  }
+  drmModeFreeObjectProperties (props);
+
+  return prop_id;
+}
+
+static gboolean
+gst_kms_sink_init_atomic (GstKMSSink * self)
+{
+  if (get_commit_fd (self) != self->fd) {
+    GST_WARNING_OBJECT (self, "atomic modesetting needs a 4.14 kernel");
+    return FALSE;
+  }
+
+  if (drmSetClientCap (self->fd, DRM_CLIENT_CAP_ATOMIC, 1)) {
+    GST_WARNING_OBJECT (self, "driver doesn't support atomic modesetting");
+    return FALSE;
+  }
+
+  self->plane_props.fb_id = get_plane_property_id (self, "FB_ID");
+  self->plane_props.crtc_id = get_plane_property_id (self, "CRTC_ID");
+  self->plane_props.src_x = get_plane_property_id (self, "SRC_X");
+  self->plane_props.src_y = get_plane_property_id (self, "SRC_Y");
+  self->plane_props.src_w = get_plane_property_id (self, "SRC_W");
+  self->plane_props.src_h = get_plane_property_id (self, "SRC_H");
+  self->plane_props.crtc_x = get_plane_property_id (self, "CRTC_X");
+  self->plane_props.crtc_y = get_plane_property_id (self, "CRTC_Y");
+  self->plane_props.crtc_w = get_plane_property_id (self, "CRTC_W");
+  self->plane_props.crtc_h = get_plane_property_id (self, "CRTC_H");
+
+  if (!self->plane_props.fb_id || !self->plane_props.crtc_id
+      || !self->plane_props.src_x || !self->plane_props.src_y
+      || !self->plane_props.src_w || !self->plane_props.src_h
+      || !self->plane_props.crtc_x || !self->plane_props.crtc_y
+      || !self->plane_props.crtc_w || !self->plane_props.crtc_h) {
+    GST_WARNING_OBJECT (self, "plane %d lacks atomic properties",
+        self->plane_id);
+    drmSetClientCap (self->fd, DRM_CLIENT_CAP_ATOMIC, 0);
+    return FALSE;
+  }
+
+  GST_INFO_OBJECT (self, "using atomic modesetting");
+
+  return TRUE;
+}
+
+static void
+atomic_flip_handler (gint fd, guint frame, guint sec, guint usec,
+    gpointer data)
+{
+  GstKMSSink *self = data;
+
+  /* the previous buffer is not scanned out anymore */
+  gst_buffer_replace (&self->displayed_buffer, self->pending_buffer);
+  gst_buffer_replace (&self->pending_buffer, NULL);
+  self->flip_pending = FALSE;
+}
+
+/* Waits until the page flip of the last atomic commit happened */
+static gboolean
+gst_kms_sink_wait_flip (GstKMSSink * self)
+{
+  gint ret;
+  drmEventContext evctxt = {
+    .version = DRM_EVENT_CONTEXT_VERSION,
+    .page_flip_handler = atomic_flip_handler,
+  };
+
+  while (self->flip_pending) {
+    do {
+      ret = gst_poll_wait (self->poll, 3 * GST_SECOND);
+    } while (ret == -1 && (errno == EAGAIN || errno == EINTR));
+
+    if (ret == 0) {
+      GST_WARNING_OBJECT (self, "timeout waiting for page flip");
+      atomic_flip_handler (self->fd, 0, 0, 0, self);
+      return FALSE;
+    }
+
+    ret = drmHandleEvent (self->fd, &evctxt);
+    if (ret) {
+      GST_ERROR_OBJECT (self, "drmHandleEvent failed: %s (%d)",
+          strerror (-ret), ret);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Shows fb_id with a non-blocking atomic commit. buffer is kept until the
+ * flip after the next one, when it is not scanned out anymore. */
+static gint
+gst_kms_sink_atomic_commit (GstKMSSink * self, guint32 fb_id,
+    GstBuffer * buffer, GstVideoRectangle * result, GstVideoRectangle * src)
+{
+  drmModeAtomicReq *req;
+  gint ret;
+
+  /* Only one commit can be in flight, this blocks until the next vblank at
+   * most and usually not at all */
+  if (!gst_kms_sink_wait_flip (self))
+    return -EIO;
+
+  req = drmModeAtomicAlloc ();
+  if (!req)
+    return -ENOMEM;
+
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.fb_id,
+      fb_id);
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.crtc_id,
+      self->crtc_id);
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.crtc_x,
+      result->x);
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.crtc_y,
+      result->y);
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.crtc_w,
+      result->w);
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.crtc_h,
+      result->h);
+  /* source/cropping coordinates are given in Q16 */
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.src_x,
+      (guint64) src->x << 16);
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.src_y,
+      (guint64) src->y << 16);
+  drmModeAtomicAddProperty (req, self->plane_id, self->plane_props.src_w,
+      (guint64) src->w << 16);
+  ret = drmModeAtomicAddProperty (req, self->plane_id,
+      self->plane_props.src_h, (guint64) src->h << 16);
+
+  if (ret >= 0)
+    ret = drmModeAtomicCommit (self->fd, req,
+        DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, self);
+  drmModeAtomicFree (req);
+
+  if (ret == 0) {
+    gst_buffer_replace (&self->pending_buffer, buffer);
+    self->flip_pending = TRUE;
+  }
+
+  return ret;
+}
+
 static gboolean
 gst_kms_sink_import_dmabuf (GstKMSSink * self, GstBuffer * inbuf,
     GstBuffer ** outbuf)
@@ -2003,10 +2174,13 @@ retry_set_plane:
       "drmModeSetPlane at (%i,%i) %ix%i sourcing at (%i,%i) %ix%i",
       result.x, result.y, result.w, result.h, src.x, src.y, src.w, src.h);
 
-  ret = drmModeSetPlane (fd, self->plane_id, self->crtc_id, fb_id, 0,
-      result.x, result.y, result.w, result.h,
-      /* source/cropping coordinates are given in Q16 */
-      src.x << 16, src.y << 16, src.w << 16, src.h << 16);
+  if (self->use_atomic)
+    ret = gst_kms_sink_atomic_commit (self, fb_id, buffer, &result, &src);
+  else
+    ret = drmModeSetPlane (fd, self->plane_id, self->crtc_id, fb_id, 0,
+        result.x, result.y, result.w, result.h,
+        /* source/cropping coordinates are given in Q16 */
+        src.x << 16, src.y << 16, src.w << 16, src.h << 16);
   if (ret) {
     goto set_plane_failed;
   } else
@@ -2060,7 +2234,8 @@ set_plane_failed:
         result.w, result.h, src.x, src.y, src.w, src.h, dst.x, dst.y, dst.w,
         dst.h);
     GST_ELEMENT_ERROR (self, RESOURCE, FAILED,
-        (NULL), ("drmModeSetPlane failed: %s (%d)", strerror (-ret), ret));
+        (NULL), ("%s failed: %s (%d)", self->use_atomic ?
+            "drmModeAtomicCommit" : "drmModeSetPlane", strerror (-ret), ret));
     goto bail;
   }
 no_disp_ratio:
@@ -2155,6 +2330,9 @@ gst_kms_sink_set_property (GObject * object, guint prop_id,
     case PROP_FORCE_HANTROTILE:
       sink->hantro_tile_enabled = g_value_get_boolean (value);
       break;
+    case PROP_ATOMIC:
+      sink->atomic = g_value_get_boolean (value);
+      break;
     default:
       if (!gst_video_overlay_set_property (object, PROP_N, prop_id, value))
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -2205,6 +2383,9 @@ gst_kms_sink_get_property (GObject * object, guint prop_id,
     case PROP_FORCE_HANTROTILE:
       g_value_set_boolean (value, sink->hantro_tile_enabled);
       break;
+    case PROP_ATOMIC:
+      g_value_set_boolean (value, sink->atomic);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2391,6 +2572,21 @@ gst_kms_sink_class_init (GstKMSSinkClass * klass)
       "global alpha", "global alpha", 0, 255, 0,
       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT);
 
+  /**
+   * kmssink:atomic:
+   *
+   * Show frames on the overlay plane with non-blocking atomic commits
+   * instead of drmModeSetPlane(). A buffer is only released once the page
+   * flip to the next one completed. Falls back to the legacy API if the
+   * driver doesn't support it, and is not used with modesetting.
+   *
+   * Since: 1.16
+   */
+  g_properties[PROP_ATOMIC] =
+      g_param_spec_boolean ("atomic", "Atomic modesetting",
+      "Use non-blocking atomic commits to update the plane", FALSE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT);
+
   g_object_class_install_properties (gobject_class, PROP_N, g_properties);
 
   gst_video_overlay_install_properties (gobject_class, PROP_N);
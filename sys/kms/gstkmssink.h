@@ -112,6 +112,21 @@ struct _GstKMSSink {
   /* reconfigure info if driver doesn't scale */
   GstVideoRectangle pending_rect;
   gboolean reconfigure;
+
+  /* atomic modesetting, property ids of the plane */
+  gboolean atomic;
+  gboolean use_atomic;
+  struct {
+    guint32 fb_id, crtc_id;
+    guint32 src_x, src_y, src_w, src_h;
+    guint32 crtc_x, crtc_y, crtc_w, crtc_h;
+  } plane_props;
+
+  /* buffer of the last commit until its page flip completed, and the buffer
+   * being scanned out, which is released by the next flip */
+  GstBuffer *pending_buffer;
+  GstBuffer *displayed_buffer;
+  gboolean flip_pending;
 };
 
 struct _GstKMSSinkClass {
@@ -46,6 +46,7 @@
 #include "gstmsdkvp8dec.h"
 #include "gstmsdkvp8enc.h"
 #include "gstmsdkvc1dec.h"
+#include "gstmsdkvpp.h"
 
 GST_DEBUG_CATEGORY (gst_msdk_debug);
 GST_DEBUG_CATEGORY (gst_msdkdec_debug);
@@ -61,6 +62,7 @@ GST_DEBUG_CATEGORY (gst_msdkmpeg2dec_debug);
 GST_DEBUG_CATEGORY (gst_msdkvp8dec_debug);
 GST_DEBUG_CATEGORY (gst_msdkvp8enc_debug);
 GST_DEBUG_CATEGORY (gst_msdkvc1dec_debug);
+GST_DEBUG_CATEGORY (gst_msdkvpp_debug);
 
 static gboolean
 plugin_init (GstPlugin * plugin)
@@ -89,6 +91,7 @@ plugin_init (GstPlugin * plugin)
   GST_DEBUG_CATEGORY_INIT (gst_msdkvp8dec_debug, "msdkvp8dec", 0, "msdkvp8dec");
   GST_DEBUG_CATEGORY_INIT (gst_msdkvp8enc_debug, "msdkvp8enc", 0, "msdkvp8enc");
   GST_DEBUG_CATEGORY_INIT (gst_msdkvc1dec_debug, "msdkvc1dec", 0, "msdkvc1dec");
+  GST_DEBUG_CATEGORY_INIT (gst_msdkvpp_debug, "msdkvpp", 0, "msdkvpp");
 
   if (!msdk_is_available ())
     return FALSE;
@@ -126,6 +129,9 @@ plugin_init (GstPlugin * plugin)
   ret = gst_element_register (plugin, "msdkvc1dec", GST_RANK_NONE,
       GST_TYPE_MSDKVC1DEC);
 
+  ret = gst_element_register (plugin, "msdkvpp", GST_RANK_NONE,
+      GST_TYPE_MSDKVPP);
+
   return ret;
 }
 
@@ -60,6 +60,9 @@ struct _GstMsdkContextPrivate
   gint shared_async_depth;
   GMutex mutex;
   GList *child_session_list;
+  /* the context whose session this one is joined to, surfaces are pooled
+   * there so all joined sessions draw from the same allocations */
+  GstMsdkContext *parent;
 #ifndef _WIN32
   gint fd;
   VADisplay dpy;
@@ -233,10 +236,19 @@ gst_msdk_context_finalize (GObject * obj)
   GstMsdkContext *context = GST_MSDK_CONTEXT_CAST (obj);
   GstMsdkContextPrivate *priv = context->priv;
 
-  /* child sessions will be closed when the parent session is closed */
-  if (priv->is_joined)
+  if (priv->is_joined) {
+    GstMsdkContextPrivate *parent_priv = priv->parent->priv;
+
+    g_mutex_lock (&parent_priv->mutex);
+    parent_priv->child_session_list =
+        g_list_remove (parent_priv->child_session_list, priv->session);
+    g_mutex_unlock (&parent_priv->mutex);
+
+    release_child_session (priv->session);
+    gst_object_unref (priv->parent);
+    g_mutex_clear (&priv->mutex);
     goto done;
-  else
+  } else
     g_list_free_full (priv->child_session_list, release_child_session);
 
   msdk_close_session (priv->session);
@@ -282,7 +294,12 @@ gst_msdk_context_new_with_parent (GstMsdkContext * parent)
   mfxStatus status;
   GstMsdkContext *obj = g_object_new (GST_TYPE_MSDK_CONTEXT, NULL);
   GstMsdkContextPrivate *priv = obj->priv;
-  GstMsdkContextPrivate *parent_priv = parent->priv;
+  GstMsdkContextPrivate *parent_priv;
+
+  /* always join to the root session so that there is only one pool */
+  if (parent->priv->parent)
+    parent = parent->priv->parent;
+  parent_priv = parent->priv;
 
   status = MFXCloneSession (parent_priv->session, &priv->session);
   if (status != MFX_ERR_NONE) {
@@ -297,10 +314,13 @@ gst_msdk_context_new_with_parent (GstMsdkContext * parent)
   }
 
   priv->is_joined = TRUE;
+  priv->parent = gst_object_ref (parent);
   priv->hardware = parent_priv->hardware;
   priv->job_type = parent_priv->job_type;
+  g_mutex_lock (&parent_priv->mutex);
   parent_priv->child_session_list =
       g_list_prepend (parent_priv->child_session_list, priv->session);
+  g_mutex_unlock (&parent_priv->mutex);
 #ifndef _WIN32
   priv->dpy = parent_priv->dpy;
   priv->fd = parent_priv->fd;
@@ -340,6 +360,15 @@ gst_msdk_context_get_fd (GstMsdkContext * context)
 #endif
 }
 
+/* Joined contexts share the surface pool of their parent */
+static GstMsdkContextPrivate *
+get_pool_priv (GstMsdkContext * context)
+{
+  GstMsdkContextPrivate *priv = context->priv;
+
+  return priv->parent ? priv->parent->priv : priv;
+}
+
 static gint
 _find_response (gconstpointer resp, gconstpointer comp_resp)
 {
@@ -362,9 +391,12 @@ GstMsdkAllocResponse *
 gst_msdk_context_get_cached_alloc_responses (GstMsdkContext * context,
     mfxFrameAllocResponse * resp)
 {
-  GstMsdkContextPrivate *priv = context->priv;
-  GList *l =
-      g_list_find_custom (priv->cached_alloc_responses, resp, _find_response);
+  GstMsdkContextPrivate *priv = get_pool_priv (context);
+  GList *l;
+
+  g_mutex_lock (&priv->mutex);
+  l = g_list_find_custom (priv->cached_alloc_responses, resp, _find_response);
+  g_mutex_unlock (&priv->mutex);
 
   if (l)
     return l->data;
@@ -376,9 +408,12 @@ GstMsdkAllocResponse *
 gst_msdk_context_get_cached_alloc_responses_by_request (GstMsdkContext *
     context, mfxFrameAllocRequest * req)
 {
-  GstMsdkContextPrivate *priv = context->priv;
-  GList *l =
-      g_list_find_custom (priv->cached_alloc_responses, req, _find_request);
+  GstMsdkContextPrivate *priv = get_pool_priv (context);
+  GList *l;
+
+  g_mutex_lock (&priv->mutex);
+  l = g_list_find_custom (priv->cached_alloc_responses, req, _find_request);
+  g_mutex_unlock (&priv->mutex);
 
   if (l)
     return l->data;
@@ -386,47 +421,92 @@ gst_msdk_context_get_cached_alloc_responses_by_request (GstMsdkContext *
     return NULL;
 }
 
+/*
+ * Every surface of a response is in exactly one of these states:
+ * 1. AVAILABLE : free and unused anywhere, in surfaces_avail.
+ * 2. USED : coupled with a gst buffer and being used now, in no queue.
+ * 3. LOCKED : still locked by msdk even after the gst buffer was released,
+ *    in surfaces_locked.
+ *
+ * The queue links are embedded in the surfaces so moving a surface between
+ * states never needs a list scan or an allocation. The state is protected
+ * by the mutex of the context owning the pool.
+ */
+typedef enum
+{
+  GST_MSDK_SURFACE_AVAILABLE,
+  GST_MSDK_SURFACE_USED,
+  GST_MSDK_SURFACE_LOCKED,
+} GstMsdkSurfaceState;
+
+typedef struct
+{
+  /* must be first, msdk only ever sees this */
+  mfxFrameSurface1 surface;
+  GList link;
+  GstMsdkSurfaceState state;
+} GstMsdkSurface;
+
 static void
-create_surfaces (GstMsdkContext * context, GstMsdkAllocResponse * resp)
+set_surface_state (GstMsdkAllocResponse * resp, GstMsdkSurface * surface,
+    GstMsdkSurfaceState state)
 {
-  gint i;
-  mfxMemId *mem_id;
-  mfxFrameSurface1 *surface;
+  if (surface->state == state)
+    return;
 
-  for (i = 0; i < resp->response->NumFrameActual; i++) {
-    mem_id = resp->mem_ids[i];
-    surface = (mfxFrameSurface1 *) g_slice_new0 (mfxFrameSurface1);
-    if (!surface) {
-      GST_ERROR ("failed to allocate surface");
-      break;
-    }
-    surface->Data.MemId = mem_id;
-    resp->surfaces_avail = g_list_prepend (resp->surfaces_avail, surface);
-  }
+  if (surface->state == GST_MSDK_SURFACE_AVAILABLE)
+    g_queue_unlink (&resp->surfaces_avail, &surface->link);
+  else if (surface->state == GST_MSDK_SURFACE_LOCKED)
+    g_queue_unlink (&resp->surfaces_locked, &surface->link);
+
+  if (state == GST_MSDK_SURFACE_AVAILABLE)
+    g_queue_push_head_link (&resp->surfaces_avail, &surface->link);
+  else if (state == GST_MSDK_SURFACE_LOCKED)
+    g_queue_push_tail_link (&resp->surfaces_locked, &surface->link);
+
+  surface->state = state;
 }
 
 static void
-free_surface (gpointer surface)
+create_surfaces (GstMsdkContext * context, GstMsdkAllocResponse * resp)
 {
-  g_slice_free1 (sizeof (mfxFrameSurface1), surface);
+  GstMsdkSurface *surfaces;
+  gint i;
+
+  surfaces = g_new0 (GstMsdkSurface, resp->response->NumFrameActual);
+  resp->surfaces = surfaces;
+  g_queue_init (&resp->surfaces_avail);
+  g_queue_init (&resp->surfaces_locked);
+
+  for (i = 0; i < resp->response->NumFrameActual; i++) {
+    surfaces[i].surface.Data.MemId = resp->mem_ids[i];
+    surfaces[i].link.data = &surfaces[i];
+    surfaces[i].state = GST_MSDK_SURFACE_AVAILABLE;
+    g_queue_push_tail_link (&resp->surfaces_avail, &surfaces[i].link);
+  }
 }
 
 static void
 remove_surfaces (GstMsdkContext * context, GstMsdkAllocResponse * resp)
 {
-  g_list_free_full (resp->surfaces_used, free_surface);
-  g_list_free_full (resp->surfaces_avail, free_surface);
-  g_list_free_full (resp->surfaces_locked, free_surface);
+  g_free (resp->surfaces);
+  resp->surfaces = NULL;
+  g_queue_init (&resp->surfaces_avail);
+  g_queue_init (&resp->surfaces_locked);
 }
 
 void
 gst_msdk_context_add_alloc_response (GstMsdkContext * context,
     GstMsdkAllocResponse * resp)
 {
-  context->priv->cached_alloc_responses =
-      g_list_prepend (context->priv->cached_alloc_responses, resp);
+  GstMsdkContextPrivate *priv = get_pool_priv (context);
 
   create_surfaces (context, resp);
+
+  g_mutex_lock (&priv->mutex);
+  priv->cached_alloc_responses =
+      g_list_prepend (priv->cached_alloc_responses, resp);
+  g_mutex_unlock (&priv->mutex);
 }
 
 gboolean
@@ -434,78 +514,78 @@ gst_msdk_context_remove_alloc_response (GstMsdkContext * context,
     mfxFrameAllocResponse * resp)
 {
   GstMsdkAllocResponse *msdk_resp;
-  GstMsdkContextPrivate *priv = context->priv;
-  GList *l =
-      g_list_find_custom (priv->cached_alloc_responses, resp, _find_response);
+  GstMsdkContextPrivate *priv = get_pool_priv (context);
+  GList *l;
 
-  if (!l)
+  g_mutex_lock (&priv->mutex);
+  l = g_list_find_custom (priv->cached_alloc_responses, resp, _find_response);
+  if (!l) {
+    g_mutex_unlock (&priv->mutex);
     return FALSE;
+  }
 
   msdk_resp = l->data;
+  priv->cached_alloc_responses =
+      g_list_delete_link (priv->cached_alloc_responses, l);
+  g_mutex_unlock (&priv->mutex);
 
   remove_surfaces (context, msdk_resp);
-
   g_slice_free1 (sizeof (GstMsdkAllocResponse), msdk_resp);
-  priv->cached_alloc_responses =
-      g_list_delete_link (priv->cached_alloc_responses, l);
 
   return TRUE;
 }
 
+/* Moves the surfaces msdk has let go of back to the available queue, must
+ * be called with the pool mutex held */
 static gboolean
 check_surfaces_available (GstMsdkContext * context, GstMsdkAllocResponse * resp)
 {
-  GList *l;
-  mfxFrameSurface1 *surface = NULL;
-  GstMsdkContextPrivate *priv = context->priv;
+  GList *l, *next;
   gboolean ret = FALSE;
 
-  g_mutex_lock (&priv->mutex);
-  for (l = resp->surfaces_locked; l; l = l->next) {
-    surface = l->data;
-    if (!surface->Data.Locked) {
-      resp->surfaces_locked = g_list_remove (resp->surfaces_locked, surface);
-      resp->surfaces_avail = g_list_prepend (resp->surfaces_avail, surface);
+  for (l = resp->surfaces_locked.head; l; l = next) {
+    GstMsdkSurface *surface = l->data;
+
+    next = l->next;
+    if (!surface->surface.Data.Locked) {
+      set_surface_state (resp, surface, GST_MSDK_SURFACE_AVAILABLE);
       ret = TRUE;
     }
   }
-  g_mutex_unlock (&priv->mutex);
 
   return ret;
 }
 
-/*
- * There are 3 lists here in GstMsdkContext as the following:
- * 1. surfaces_avail : surfaces which are free and unused anywhere
- * 2. surfaces_used : surfaces coupled with a gst buffer and being used now.
- * 3. surfaces_locked : surfaces still locked even after the gst buffer is released.
- *
- * Note that they need to be protected by mutex to be thread-safe.
- */
-
 mfxFrameSurface1 *
 gst_msdk_context_get_surface_available (GstMsdkContext * context,
     mfxFrameAllocResponse * resp)
 {
-  GList *l;
-  mfxFrameSurface1 *surface = NULL;
+  GstMsdkSurface *surface = NULL;
   GstMsdkAllocResponse *msdk_resp =
       gst_msdk_context_get_cached_alloc_responses (context, resp);
   gint retry = 0;
-  GstMsdkContextPrivate *priv = context->priv;
+  GstMsdkContextPrivate *priv = get_pool_priv (context);
 
 retry:
   g_mutex_lock (&priv->mutex);
-  for (l = msdk_resp->surfaces_avail; l; l = l->next) {
-    surface = l->data;
-
-    if (!surface->Data.Locked) {
-      msdk_resp->surfaces_avail =
-          g_list_remove (msdk_resp->surfaces_avail, surface);
-      msdk_resp->surfaces_used =
-          g_list_prepend (msdk_resp->surfaces_used, surface);
+  while (msdk_resp->surfaces_avail.head) {
+    surface = msdk_resp->surfaces_avail.head->data;
+
+    if (!surface->surface.Data.Locked) {
+      set_surface_state (msdk_resp, surface, GST_MSDK_SURFACE_USED);
       break;
     }
+
+    /* still in use by msdk, wait for it on the locked queue */
+    set_surface_state (msdk_resp, surface, GST_MSDK_SURFACE_LOCKED);
+    surface = NULL;
+  }
+
+  /* If there's no surface available, find unlocked surfaces in the locked
+   * list, take them back to the available list and then search again. */
+  if (!surface && check_surfaces_available (context, msdk_resp)) {
+    surface = msdk_resp->surfaces_avail.head->data;
+    set_surface_state (msdk_resp, surface, GST_MSDK_SURFACE_USED);
   }
   g_mutex_unlock (&priv->mutex);
 
@@ -519,33 +599,25 @@ retry:
    * FIXME: Is there any better way to handle this case?
    */
   if (!surface && retry < 20) {
-    /* If there's no surface available, find unlocked surfaces in the locked list,
-     * take it back to the available list and then search again.
-     */
-    check_surfaces_available (context, msdk_resp);
     retry++;
     g_usleep (1000);
     goto retry;
   }
 
-  return surface;
+  return surface ? &surface->surface : NULL;
 }
 
 void
 gst_msdk_context_put_surface_locked (GstMsdkContext * context,
     mfxFrameAllocResponse * resp, mfxFrameSurface1 * surface)
 {
-  GstMsdkContextPrivate *priv = context->priv;
+  GstMsdkContextPrivate *priv = get_pool_priv (context);
   GstMsdkAllocResponse *msdk_resp =
       gst_msdk_context_get_cached_alloc_responses (context, resp);
 
   g_mutex_lock (&priv->mutex);
-  if (!g_list_find (msdk_resp->surfaces_locked, surface)) {
-    msdk_resp->surfaces_used =
-        g_list_remove (msdk_resp->surfaces_used, surface);
-    msdk_resp->surfaces_locked =
-        g_list_prepend (msdk_resp->surfaces_locked, surface);
-  }
+  set_surface_state (msdk_resp, (GstMsdkSurface *) surface,
+      GST_MSDK_SURFACE_LOCKED);
   g_mutex_unlock (&priv->mutex);
 }
 
@@ -553,17 +625,13 @@ void
 gst_msdk_context_put_surface_available (GstMsdkContext * context,
     mfxFrameAllocResponse * resp, mfxFrameSurface1 * surface)
 {
-  GstMsdkContextPrivate *priv = context->priv;
+  GstMsdkContextPrivate *priv = get_pool_priv (context);
   GstMsdkAllocResponse *msdk_resp =
       gst_msdk_context_get_cached_alloc_responses (context, resp);
 
   g_mutex_lock (&priv->mutex);
-  if (!g_list_find (msdk_resp->surfaces_avail, surface)) {
-    msdk_resp->surfaces_used =
-        g_list_remove (msdk_resp->surfaces_used, surface);
-    msdk_resp->surfaces_avail =
-        g_list_prepend (msdk_resp->surfaces_avail, surface);
-  }
+  set_surface_state (msdk_resp, (GstMsdkSurface *) surface,
+      GST_MSDK_SURFACE_AVAILABLE);
   g_mutex_unlock (&priv->mutex);
 }
 
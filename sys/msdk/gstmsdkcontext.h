@@ -100,9 +100,10 @@ struct _GstMsdkAllocResponse {
   mfxFrameAllocResponse *response;
   mfxFrameAllocRequest request;
   mfxMemId *mem_ids;
-  GList *surfaces_avail;
-  GList *surfaces_used;
-  GList *surfaces_locked;
+  /* array of NumFrameActual surfaces, private to GstMsdkContext */
+  gpointer surfaces;
+  GQueue surfaces_avail;
+  GQueue surfaces_locked;
 };
 
 GstMsdkAllocResponse *
@@ -0,0 +1,1125 @@
+/* GStreamer Intel MSDK plugin
+ * Copyright (c) 2018, Intel Corporation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "gstmsdkvpp.h"
+#include "gstmsdkbufferpool.h"
+#include "gstmsdkvideomemory.h"
+#include "gstmsdksystemmemory.h"
+#include "gstmsdkcontextutil.h"
+#include "msdk-enums.h"
+
+GST_DEBUG_CATEGORY_EXTERN (gst_msdkvpp_debug);
+#define GST_CAT_DEFAULT gst_msdkvpp_debug
+
+static GstStaticPadTemplate gst_msdkvpp_sink_factory =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-raw, "
+        "format = (string) { NV12, YV12, I420, YUY2, UYVY, BGRA }, "
+        "framerate = (fraction) [0, MAX], "
+        "width = (int) [ 16, MAX ], height = (int) [ 16, MAX ], "
+        "interlace-mode = (string) { progressive, interleaved, mixed }")
+    );
+
+static GstStaticPadTemplate gst_msdkvpp_src_factory =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-raw, "
+        "format = (string) { NV12, YUY2, BGRA }, "
+        "framerate = (fraction) [0, MAX], "
+        "width = (int) [ 16, MAX ], height = (int) [ 16, MAX ], "
+        "interlace-mode = (string) progressive")
+    );
+
+enum
+{
+  PROP_0,
+  PROP_HARDWARE,
+  PROP_ASYNC_DEPTH,
+  PROP_DENOISE,
+  PROP_DEINTERLACE_METHOD,
+  PROP_N,
+};
+
+#define PROP_HARDWARE_DEFAULT            TRUE
+#define PROP_ASYNC_DEPTH_DEFAULT         1
+#define PROP_DENOISE_DEFAULT             0
+#define PROP_DEINTERLACE_METHOD_DEFAULT  MFX_DEINTERLACING_BOB
+
+#define gst_msdkvpp_parent_class parent_class
+G_DEFINE_TYPE (GstMsdkVPP, gst_msdkvpp, GST_TYPE_BASE_TRANSFORM);
+
+typedef struct
+{
+  mfxFrameSurface1 *surface;
+  GstBuffer *buf;
+} MsdkSurface;
+
+static void
+free_msdk_surface (MsdkSurface * surface)
+{
+  if (surface->buf)
+    gst_buffer_unref (surface->buf);
+  g_slice_free (MsdkSurface, surface);
+}
+
+static void
+gst_msdkvpp_set_context (GstElement * element, GstContext * context)
+{
+  GstMsdkContext *msdk_context = NULL;
+  GstMsdkVPP *thiz = GST_MSDKVPP (element);
+
+  if (gst_msdk_context_get_context (context, &msdk_context)) {
+    gst_object_replace ((GstObject **) & thiz->context,
+        (GstObject *) msdk_context);
+    gst_object_unref (msdk_context);
+  }
+
+  GST_ELEMENT_CLASS (parent_class)->set_context (element, context);
+}
+
+static GstBufferPool *
+gst_msdkvpp_create_buffer_pool (GstMsdkVPP * thiz, GstPadDirection direction,
+    GstCaps * caps, guint min_num_buffers)
+{
+  GstBufferPool *pool = NULL;
+  GstStructure *config;
+  GstAllocator *allocator = NULL;
+  GstVideoInfo info;
+  GstVideoInfo *pool_info = NULL;
+  GstVideoAlignment align;
+  GstAllocationParams params = { 0, 31, 0, 0, };
+  mfxFrameAllocResponse *alloc_resp = NULL;
+
+  if (direction == GST_PAD_SINK) {
+    alloc_resp = &thiz->in_alloc_resp;
+    pool_info = &thiz->sinkpad_buffer_pool_info;
+  } else {
+    alloc_resp = &thiz->out_alloc_resp;
+    pool_info = &thiz->srcpad_buffer_pool_info;
+  }
+
+  pool = gst_msdk_buffer_pool_new (thiz->context, alloc_resp);
+  if (!pool)
+    goto error_no_pool;
+
+  if (!gst_video_info_from_caps (&info, caps))
+    goto error_no_video_info;
+
+  gst_msdk_set_video_alignment (&info, &align);
+  gst_video_info_align (&info, &align);
+
+  if (thiz->use_video_memory)
+    allocator = gst_msdk_video_allocator_new (thiz->context, &info, alloc_resp);
+  else
+    allocator = gst_msdk_system_allocator_new (&info);
+
+  if (!allocator)
+    goto error_no_allocator;
+
+  config = gst_buffer_pool_get_config (GST_BUFFER_POOL_CAST (pool));
+  gst_buffer_pool_config_set_params (config, caps, info.size, min_num_buffers,
+      0);
+  gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+  gst_buffer_pool_config_add_option (config,
+      GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+
+  if (thiz->use_video_memory)
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_MSDK_USE_VIDEO_MEMORY);
+
+  gst_buffer_pool_config_set_video_alignment (config, &align);
+  gst_buffer_pool_config_set_allocator (config, allocator, &params);
+  gst_object_unref (allocator);
+
+  if (!gst_buffer_pool_set_config (pool, config))
+    goto error_pool_config;
+
+  *pool_info = info;
+
+  return pool;
+
+error_no_pool:
+  {
+    GST_INFO_OBJECT (thiz, "failed to create bufferpool");
+    return NULL;
+  }
+error_no_video_info:
+  {
+    GST_INFO_OBJECT (thiz, "failed to get video info");
+    gst_object_unref (pool);
+    return NULL;
+  }
+error_no_allocator:
+  {
+    GST_INFO_OBJECT (thiz, "failed to create allocator");
+    gst_object_unref (pool);
+    return NULL;
+  }
+error_pool_config:
+  {
+    GST_INFO_OBJECT (thiz, "failed to set config");
+    gst_object_unref (pool);
+    return NULL;
+  }
+}
+
+static gboolean
+gst_msdkvpp_decide_allocation (GstBaseTransform * trans, GstQuery * query)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (trans);
+  GstVideoInfo info;
+  GstBufferPool *pool = NULL;
+  GstAllocator *allocator = NULL;
+  GstCaps *caps;
+  GstStructure *config;
+  guint size = 0, min_buffers = 0, max_buffers = 0;
+  gboolean update_pool = FALSE;
+
+  if (!GST_BASE_TRANSFORM_CLASS (parent_class)->decide_allocation (trans,
+          query))
+    return FALSE;
+
+  gst_query_parse_allocation (query, &caps, NULL);
+  if (!caps) {
+    GST_ERROR_OBJECT (thiz, "Failed to parse the decide_allocation caps");
+    return FALSE;
+  }
+  if (!gst_video_info_from_caps (&info, caps)) {
+    GST_ERROR_OBJECT (thiz, "Failed to get video info");
+    return FALSE;
+  }
+
+  if (gst_query_get_n_allocation_pools (query) > 0) {
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min_buffers,
+        &max_buffers);
+    update_pool = TRUE;
+  }
+  size = MAX (size, GST_VIDEO_INFO_SIZE (&info));
+
+  /* We always have async_depth frames in flight in the VPP */
+  gst_object_replace ((GstObject **) & thiz->srcpad_buffer_pool, NULL);
+  thiz->srcpad_buffer_pool =
+      gst_msdkvpp_create_buffer_pool (thiz, GST_PAD_SRC, caps,
+      min_buffers + thiz->async_depth);
+  if (!thiz->srcpad_buffer_pool)
+    goto failed_to_create_pool;
+
+  if (gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL)) {
+    /* Downstream can deal with our strides and offsets, so hand out the
+     * msdk surfaces directly and skip any copy. */
+    GST_INFO_OBJECT (thiz, "use MSDK bufferpool for downstream");
+    thiz->use_srcpad_side_pool = FALSE;
+
+    if (pool)
+      gst_object_unref (pool);
+    pool = gst_object_ref (thiz->srcpad_buffer_pool);
+    size = GST_VIDEO_INFO_SIZE (&thiz->srcpad_buffer_pool_info);
+    min_buffers += thiz->async_depth;
+    if (max_buffers)
+      max_buffers += thiz->async_depth;
+
+    config = gst_buffer_pool_get_config (pool);
+    if (gst_buffer_pool_config_get_allocator (config, &allocator, NULL))
+      gst_query_set_nth_allocation_param (query, 0, allocator, NULL);
+    gst_structure_free (config);
+  } else {
+    /* Process into the side-pool and copy into downstream's buffers. */
+    GST_INFO_OBJECT (thiz, "use MSDK bufferpool as a side-pool");
+    thiz->use_srcpad_side_pool = TRUE;
+
+    if (!pool) {
+      pool = gst_video_buffer_pool_new ();
+      config = gst_buffer_pool_get_config (pool);
+      gst_buffer_pool_config_set_params (config, caps, size, min_buffers,
+          max_buffers);
+      if (!gst_buffer_pool_set_config (pool, config))
+        goto error_set_config;
+    }
+  }
+
+  if (update_pool)
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min_buffers,
+        max_buffers);
+  else
+    gst_query_add_allocation_pool (query, pool, size, min_buffers,
+        max_buffers);
+
+  gst_object_unref (pool);
+
+  return TRUE;
+
+failed_to_create_pool:
+  GST_ERROR_OBJECT (thiz, "failed to create the MSDK bufferpool");
+  if (pool)
+    gst_object_unref (pool);
+  return FALSE;
+
+error_set_config:
+  GST_ERROR_OBJECT (thiz, "failed to set buffer pool config");
+  gst_object_unref (pool);
+  return FALSE;
+}
+
+static gboolean
+gst_msdkvpp_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (trans);
+  GstVideoInfo info;
+  GstBufferPool *pool = NULL;
+  GstAllocator *allocator = NULL;
+  GstCaps *caps;
+  GstStructure *config;
+  gboolean need_pool;
+  GstAllocationParams params = { 0, 31, 0, 0, };
+
+  /* passthrough, the query is forwarded downstream */
+  if (!decide_query)
+    return GST_BASE_TRANSFORM_CLASS (parent_class)->propose_allocation (trans,
+        decide_query, query);
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+
+  if (!caps) {
+    GST_INFO_OBJECT (thiz, "failed to get caps");
+    return FALSE;
+  }
+
+  if (!gst_video_info_from_caps (&info, caps)) {
+    GST_INFO_OBJECT (thiz, "failed to get video info");
+    return FALSE;
+  }
+
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  if (!need_pool || !thiz->initialized)
+    return TRUE;
+
+  pool = gst_msdkvpp_create_buffer_pool (thiz, GST_PAD_SINK, caps,
+      thiz->async_depth);
+  if (!pool)
+    return FALSE;
+
+  gst_query_add_allocation_pool (query, pool, GST_VIDEO_INFO_SIZE (&info),
+      thiz->async_depth, 0);
+
+  config = gst_buffer_pool_get_config (GST_BUFFER_POOL_CAST (pool));
+  if (gst_buffer_pool_config_get_allocator (config, &allocator, NULL))
+    gst_query_add_allocation_param (query, allocator, &params);
+  gst_structure_free (config);
+
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+static MsdkSurface *
+get_surface_from_pool (GstMsdkVPP * thiz, GstBufferPool * pool)
+{
+  GstBuffer *new_buffer;
+  MsdkSurface *msdk_surface;
+
+  if (!gst_buffer_pool_is_active (pool) &&
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    GST_ERROR_OBJECT (pool, "failed to activate buffer pool");
+    return NULL;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (pool, &new_buffer, NULL) != GST_FLOW_OK) {
+    GST_ERROR_OBJECT (pool, "failed to acquire a buffer from pool");
+    return NULL;
+  }
+
+  if (!gst_msdk_is_msdk_buffer (new_buffer)) {
+    GST_ERROR_OBJECT (pool, "the acquired memory is not MSDK memory");
+    gst_buffer_unref (new_buffer);
+    return NULL;
+  }
+
+  msdk_surface = g_slice_new0 (MsdkSurface);
+  msdk_surface->surface = gst_msdk_get_surface_from_buffer (new_buffer);
+  msdk_surface->buf = new_buffer;
+
+  return msdk_surface;
+}
+
+static MsdkSurface *
+get_msdk_surface_from_input_buffer (GstMsdkVPP * thiz, GstBuffer * inbuf)
+{
+  GstVideoFrame src_frame, out_frame;
+  MsdkSurface *msdk_surface;
+
+  if (gst_msdk_is_msdk_buffer (inbuf)) {
+    msdk_surface = g_slice_new0 (MsdkSurface);
+    msdk_surface->surface = gst_msdk_get_surface_from_buffer (inbuf);
+    /* the VPP may keep referencing it after this frame */
+    msdk_surface->buf = gst_buffer_ref (inbuf);
+    return msdk_surface;
+  }
+
+  /* If upstream hasn't accepted the proposed msdk bufferpool,
+   * just copy frame to msdk buffer and take a surface from it.
+   */
+  if (!(msdk_surface = get_surface_from_pool (thiz, thiz->sinkpad_buffer_pool)))
+    return NULL;
+
+  if (!gst_video_frame_map (&src_frame, &thiz->sinkpad_info, inbuf,
+          GST_MAP_READ)) {
+    GST_ERROR_OBJECT (thiz, "failed to map the frame for source");
+    goto error;
+  }
+
+  if (!gst_video_frame_map (&out_frame, &thiz->sinkpad_buffer_pool_info,
+          msdk_surface->buf, GST_MAP_WRITE)) {
+    GST_ERROR_OBJECT (thiz, "failed to map the frame for destination");
+    gst_video_frame_unmap (&src_frame);
+    goto error;
+  }
+
+  if (!gst_video_frame_copy (&out_frame, &src_frame)) {
+    GST_ERROR_OBJECT (thiz, "failed to copy frame");
+    gst_video_frame_unmap (&out_frame);
+    gst_video_frame_unmap (&src_frame);
+    goto error;
+  }
+
+  gst_video_frame_unmap (&out_frame);
+  gst_video_frame_unmap (&src_frame);
+
+  return msdk_surface;
+
+error:
+  free_msdk_surface (msdk_surface);
+  return NULL;
+}
+
+static gboolean
+copy_from_srcpad_side_pool (GstMsdkVPP * thiz, GstBuffer * src,
+    GstBuffer * dest)
+{
+  GstVideoFrame src_frame, dest_frame;
+  gboolean ret;
+
+  if (!gst_video_frame_map (&src_frame, &thiz->srcpad_buffer_pool_info, src,
+          GST_MAP_READ)) {
+    GST_ERROR_OBJECT (thiz, "failed to map the frame for source");
+    return FALSE;
+  }
+
+  if (!gst_video_frame_map (&dest_frame, &thiz->srcpad_info, dest,
+          GST_MAP_WRITE)) {
+    GST_ERROR_OBJECT (thiz, "failed to map the frame for destination");
+    gst_video_frame_unmap (&src_frame);
+    return FALSE;
+  }
+
+  ret = gst_video_frame_copy (&dest_frame, &src_frame);
+  if (!ret)
+    GST_ERROR_OBJECT (thiz, "failed to copy frame");
+
+  gst_video_frame_unmap (&dest_frame);
+  gst_video_frame_unmap (&src_frame);
+
+  return ret;
+}
+
+static void
+gst_msdkvpp_release_in_surface (GstMsdkVPP * thiz, MsdkSurface * surface)
+{
+  /* The deinterlacer keeps previous input frames as references */
+  if (surface->surface->Data.Locked)
+    thiz->locked_in_surfaces =
+        g_list_prepend (thiz->locked_in_surfaces, surface);
+  else
+    free_msdk_surface (surface);
+}
+
+static void
+gst_msdkvpp_free_unlocked_surfaces (GstMsdkVPP * thiz)
+{
+  GList *l = thiz->locked_in_surfaces;
+
+  while (l) {
+    GList *next = l->next;
+    MsdkSurface *surface = l->data;
+
+    if (!surface->surface->Data.Locked) {
+      free_msdk_surface (surface);
+      thiz->locked_in_surfaces =
+          g_list_delete_link (thiz->locked_in_surfaces, l);
+    }
+    l = next;
+  }
+}
+
+static mfxU16
+gst_msdkvpp_get_pic_struct (GstMsdkVPP * thiz, GstBuffer * buf)
+{
+  if (GST_VIDEO_INFO_INTERLACE_MODE (&thiz->sinkpad_info) !=
+      GST_VIDEO_INTERLACE_MODE_MIXED)
+    return thiz->param.vpp.In.PicStruct;
+
+  if (!GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_INTERLACED))
+    return MFX_PICSTRUCT_PROGRESSIVE;
+
+  return GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_TFF) ?
+      MFX_PICSTRUCT_FIELD_TFF : MFX_PICSTRUCT_FIELD_BFF;
+}
+
+static GstFlowReturn
+gst_msdkvpp_transform (GstBaseTransform * trans, GstBuffer * inbuf,
+    GstBuffer * outbuf)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (trans);
+  GstClockTime timestamp;
+  GstFlowReturn ret = GST_FLOW_OK;
+  mfxSession session;
+  mfxSyncPoint sync_point = NULL;
+  mfxStatus status;
+  MsdkSurface *in_surface = NULL;
+  MsdkSurface *out_surface = NULL;
+
+  if (G_UNLIKELY (!thiz->initialized))
+    goto not_initialized;
+
+  in_surface = get_msdk_surface_from_input_buffer (thiz, inbuf);
+  if (!in_surface)
+    return GST_FLOW_ERROR;
+
+  if (thiz->use_srcpad_side_pool) {
+    out_surface = get_surface_from_pool (thiz, thiz->srcpad_buffer_pool);
+  } else if (gst_msdk_is_msdk_buffer (outbuf)) {
+    out_surface = g_slice_new0 (MsdkSurface);
+    out_surface->surface = gst_msdk_get_surface_from_buffer (outbuf);
+  } else {
+    GST_ERROR_OBJECT (thiz, "Failed to get msdk outsurface!");
+  }
+
+  if (!out_surface) {
+    free_msdk_surface (in_surface);
+    return GST_FLOW_ERROR;
+  }
+
+  timestamp = GST_BUFFER_TIMESTAMP (inbuf);
+  if (timestamp != GST_CLOCK_TIME_NONE)
+    in_surface->surface->Data.TimeStamp =
+        gst_util_uint64_scale (timestamp, 90000, GST_SECOND);
+  else
+    in_surface->surface->Data.TimeStamp = MFX_TIMESTAMP_UNKNOWN;
+
+  in_surface->surface->Info.PicStruct = gst_msdkvpp_get_pic_struct (thiz,
+      inbuf);
+
+  session = gst_msdk_context_get_session (thiz->context);
+  for (;;) {
+    status =
+        MFXVideoVPP_RunFrameVPPAsync (session, in_surface->surface,
+        out_surface->surface, NULL, &sync_point);
+    if (status != MFX_WRN_DEVICE_BUSY)
+      break;
+    /* If device is busy, wait 1ms and retry, as per MSDK's recomendation */
+    g_usleep (1000);
+  };
+
+  if (status == MFX_ERR_MORE_DATA) {
+    /* The deinterlacer needs more input before it can output a frame */
+    ret = GST_BASE_TRANSFORM_FLOW_DROPPED;
+    goto done;
+  } else if (status < MFX_ERR_NONE) {
+    GST_ELEMENT_ERROR (thiz, STREAM, FAILED, ("Converting frame failed."),
+        ("MSDK VPP error (%s)", msdk_status_to_string (status)));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+
+  status = MFXVideoCORE_SyncOperation (session, sync_point, 300000);
+  if (status != MFX_ERR_NONE) {
+    GST_ELEMENT_ERROR (thiz, STREAM, FAILED, ("Converting frame failed."),
+        ("MSDK sync error (%s)", msdk_status_to_string (status)));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+
+  /* With a delay (deinterlacing) the output is an earlier input frame */
+  if (out_surface->surface->Data.TimeStamp != MFX_TIMESTAMP_UNKNOWN)
+    GST_BUFFER_PTS (outbuf) =
+        gst_util_uint64_scale (out_surface->surface->Data.TimeStamp,
+        GST_SECOND, 90000);
+
+  if (thiz->use_srcpad_side_pool &&
+      !copy_from_srcpad_side_pool (thiz, out_surface->buf, outbuf))
+    ret = GST_FLOW_ERROR;
+
+done:
+  gst_msdkvpp_release_in_surface (thiz, in_surface);
+  gst_msdkvpp_free_unlocked_surfaces (thiz);
+  free_msdk_surface (out_surface);
+
+  return ret;
+
+not_initialized:
+  {
+    GST_ERROR_OBJECT (thiz, "Got buffer before the VPP was initialized");
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+}
+
+static void
+gst_msdkvpp_close (GstMsdkVPP * thiz)
+{
+  mfxStatus status;
+
+  gst_object_replace ((GstObject **) & thiz->sinkpad_buffer_pool, NULL);
+  gst_object_replace ((GstObject **) & thiz->srcpad_buffer_pool, NULL);
+
+  if (!thiz->context || !thiz->initialized)
+    return;
+
+  GST_DEBUG_OBJECT (thiz, "Closing VPP with context %" GST_PTR_FORMAT,
+      thiz->context);
+
+  status = MFXVideoVPP_Close (gst_msdk_context_get_session (thiz->context));
+  if (status != MFX_ERR_NONE && status != MFX_ERR_NOT_INITIALIZED) {
+    GST_WARNING_OBJECT (thiz, "VPP close failed (%s)",
+        msdk_status_to_string (status));
+  }
+
+  /* Free the surfaces only once the VPP doesn't reference them anymore */
+  g_list_free_full (thiz->locked_in_surfaces,
+      (GDestroyNotify) free_msdk_surface);
+  thiz->locked_in_surfaces = NULL;
+  if (thiz->use_video_memory) {
+    gst_msdk_frame_free (thiz->context, &thiz->in_alloc_resp);
+    gst_msdk_frame_free (thiz->context, &thiz->out_alloc_resp);
+  }
+
+  memset (&thiz->param, 0, sizeof (thiz->param));
+  thiz->num_extra_params = 0;
+  thiz->initialized = FALSE;
+}
+
+static gboolean
+gst_msdkvpp_initialize (GstMsdkVPP * thiz)
+{
+  mfxSession session;
+  mfxStatus status;
+  mfxFrameAllocRequest request[2];
+
+  if (!thiz->context) {
+    GST_WARNING_OBJECT (thiz, "No MSDK Context");
+    return FALSE;
+  }
+
+  GST_OBJECT_LOCK (thiz);
+  session = gst_msdk_context_get_session (thiz->context);
+
+  if (thiz->use_video_memory) {
+    gst_msdk_set_frame_allocator (thiz->context);
+    thiz->param.IOPattern =
+        MFX_IOPATTERN_IN_VIDEO_MEMORY | MFX_IOPATTERN_OUT_VIDEO_MEMORY;
+  } else {
+    thiz->param.IOPattern =
+        MFX_IOPATTERN_IN_SYSTEM_MEMORY | MFX_IOPATTERN_OUT_SYSTEM_MEMORY;
+  }
+
+  gst_msdk_set_mfx_frame_info_from_video_info (&thiz->param.vpp.In,
+      &thiz->sinkpad_info);
+  gst_msdk_set_mfx_frame_info_from_video_info (&thiz->param.vpp.Out,
+      &thiz->srcpad_info);
+
+  /* Media SDK rejects a zero frame rate, so give variable frame rate streams
+   * a nominal one. The output rate always matches the input rate: we produce
+   * one frame per input frame. */
+  if (!thiz->param.vpp.In.FrameRateExtN || !thiz->param.vpp.In.FrameRateExtD) {
+    thiz->param.vpp.In.FrameRateExtN = 30;
+    thiz->param.vpp.In.FrameRateExtD = 1;
+  }
+  thiz->param.vpp.Out.FrameRateExtN = thiz->param.vpp.In.FrameRateExtN;
+  thiz->param.vpp.Out.FrameRateExtD = thiz->param.vpp.In.FrameRateExtD;
+
+  thiz->num_extra_params = 0;
+
+  if (GST_VIDEO_INFO_IS_INTERLACED (&thiz->sinkpad_info)) {
+    if (GST_VIDEO_INFO_INTERLACE_MODE (&thiz->sinkpad_info) ==
+        GST_VIDEO_INTERLACE_MODE_MIXED)
+      thiz->param.vpp.In.PicStruct = MFX_PICSTRUCT_UNKNOWN;
+    else if (GST_VIDEO_INFO_FIELD_ORDER (&thiz->sinkpad_info) ==
+        GST_VIDEO_FIELD_ORDER_BOTTOM_FIELD_FIRST)
+      thiz->param.vpp.In.PicStruct = MFX_PICSTRUCT_FIELD_BFF;
+    else
+      thiz->param.vpp.In.PicStruct = MFX_PICSTRUCT_FIELD_TFF;
+
+    memset (&thiz->mfx_deinterlace, 0, sizeof (thiz->mfx_deinterlace));
+    thiz->mfx_deinterlace.Header.BufferId = MFX_EXTBUFF_VPP_DEINTERLACING;
+    thiz->mfx_deinterlace.Header.BufferSz = sizeof (mfxExtVPPDeinterlacing);
+    thiz->mfx_deinterlace.Mode = thiz->deinterlace_method;
+    thiz->extra_params[thiz->num_extra_params++] =
+        (mfxExtBuffer *) & thiz->mfx_deinterlace;
+  }
+
+  if (thiz->denoise_factor) {
+    memset (&thiz->mfx_denoise, 0, sizeof (thiz->mfx_denoise));
+    thiz->mfx_denoise.Header.BufferId = MFX_EXTBUFF_VPP_DENOISE;
+    thiz->mfx_denoise.Header.BufferSz = sizeof (mfxExtVPPDenoise);
+    thiz->mfx_denoise.DenoiseFactor = thiz->denoise_factor;
+    thiz->extra_params[thiz->num_extra_params++] =
+        (mfxExtBuffer *) & thiz->mfx_denoise;
+  }
+
+  if (thiz->num_extra_params) {
+    thiz->param.NumExtParam = thiz->num_extra_params;
+    thiz->param.ExtParam = thiz->extra_params;
+  }
+
+  thiz->param.AsyncDepth = thiz->async_depth;
+
+  /* validate parameters and allow the Media SDK to make adjustments */
+  status = MFXVideoVPP_Query (session, &thiz->param, &thiz->param);
+  if (status < MFX_ERR_NONE) {
+    GST_ERROR_OBJECT (thiz, "Video VPP Query failed (%s)",
+        msdk_status_to_string (status));
+    goto failed;
+  } else if (status > MFX_ERR_NONE) {
+    GST_WARNING_OBJECT (thiz, "Video VPP Query returned: %s",
+        msdk_status_to_string (status));
+  }
+
+  status = MFXVideoVPP_QueryIOSurf (session, &thiz->param, request);
+  if (status < MFX_ERR_NONE) {
+    GST_ERROR_OBJECT (thiz, "VPP Query IO surfaces failed (%s)",
+        msdk_status_to_string (status));
+    goto failed;
+  } else if (status > MFX_ERR_NONE) {
+    GST_WARNING_OBJECT (thiz, "VPP Query IO surfaces returned: %s",
+        msdk_status_to_string (status));
+  }
+
+  if (thiz->use_video_memory) {
+    /* Our neighbours hold on to as many surfaces as their async depth */
+    request[0].NumFrameSuggested +=
+        gst_msdk_context_get_shared_async_depth (thiz->context);
+    request[1].NumFrameSuggested +=
+        gst_msdk_context_get_shared_async_depth (thiz->context);
+
+    gst_msdk_frame_alloc (thiz->context, &(request[0]), &thiz->in_alloc_resp);
+    gst_msdk_frame_alloc (thiz->context, &(request[1]), &thiz->out_alloc_resp);
+  }
+
+  GST_DEBUG_OBJECT (thiz, "Required %d input and %d output surfaces",
+      request[0].NumFrameSuggested, request[1].NumFrameSuggested);
+
+  status = MFXVideoVPP_Init (session, &thiz->param);
+  if (status < MFX_ERR_NONE) {
+    GST_ERROR_OBJECT (thiz, "Init failed (%s)", msdk_status_to_string (status));
+    goto failed_free;
+  } else if (status > MFX_ERR_NONE) {
+    GST_WARNING_OBJECT (thiz, "Init returned: %s",
+        msdk_status_to_string (status));
+  }
+
+  status = MFXVideoVPP_GetVideoParam (session, &thiz->param);
+  if (status < MFX_ERR_NONE) {
+    GST_ERROR_OBJECT (thiz, "Get VPP Parameters failed (%s)",
+        msdk_status_to_string (status));
+    MFXVideoVPP_Close (session);
+    goto failed_free;
+  } else if (status > MFX_ERR_NONE) {
+    GST_WARNING_OBJECT (thiz, "Get VPP Parameters returned: %s",
+        msdk_status_to_string (status));
+  }
+
+  thiz->initialized = TRUE;
+  GST_OBJECT_UNLOCK (thiz);
+
+  return TRUE;
+
+failed_free:
+  if (thiz->use_video_memory) {
+    gst_msdk_frame_free (thiz->context, &thiz->in_alloc_resp);
+    gst_msdk_frame_free (thiz->context, &thiz->out_alloc_resp);
+  }
+failed:
+  GST_OBJECT_UNLOCK (thiz);
+  return FALSE;
+}
+
+static gboolean
+gst_msdkvpp_set_caps (GstBaseTransform * trans, GstCaps * caps,
+    GstCaps * out_caps)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (trans);
+  GstVideoInfo in_info, out_info;
+  gboolean passthrough;
+
+  if (!gst_video_info_from_caps (&in_info, caps) ||
+      !gst_video_info_from_caps (&out_info, out_caps)) {
+    GST_ERROR_OBJECT (thiz, "Failed to parse caps");
+    return FALSE;
+  }
+
+  gst_msdkvpp_close (thiz);
+
+  thiz->sinkpad_info = in_info;
+  thiz->srcpad_info = out_info;
+
+  /* Nothing to scale, convert or deinterlace: don't touch the buffers */
+  passthrough = gst_caps_is_equal (caps, out_caps) && !thiz->denoise_factor;
+  gst_base_transform_set_passthrough (trans, passthrough);
+  if (passthrough)
+    return TRUE;
+
+  /* TODO: Currently d3d allocator is not implemented.
+   * So VPP uses system memory by default on Windows.
+   */
+#ifndef _WIN32
+  thiz->use_video_memory = TRUE;
+#else
+  thiz->use_video_memory = FALSE;
+#endif
+
+  GST_INFO_OBJECT (thiz, "This MSDK VPP uses %s memory",
+      thiz->use_video_memory ? "video" : "system");
+
+  if (!gst_msdkvpp_initialize (thiz))
+    return FALSE;
+
+  /* Copy target for upstream buffers which are not MSDK memory */
+  thiz->sinkpad_buffer_pool =
+      gst_msdkvpp_create_buffer_pool (thiz, GST_PAD_SINK, caps,
+      thiz->async_depth);
+  if (!thiz->sinkpad_buffer_pool) {
+    gst_msdkvpp_close (thiz);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static GstCaps *
+gst_msdkvpp_transform_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter)
+{
+  GstCaps *ret, *tmpl, *tmp;
+  GstStructure *structure;
+  GstCapsFeatures *features;
+  guint i, n;
+
+  ret = gst_caps_new_empty ();
+  n = gst_caps_get_size (caps);
+  for (i = 0; i < n; i++) {
+    structure = gst_caps_get_structure (caps, i);
+    features = gst_caps_get_features (caps, i);
+
+    if (i > 0 && gst_caps_is_subset_structure_full (ret, structure, features))
+      continue;
+
+    /* Size, format and interlacing can all be changed by the VPP */
+    structure = gst_structure_copy (structure);
+    gst_structure_set (structure,
+        "width", GST_TYPE_INT_RANGE, 16, G_MAXINT,
+        "height", GST_TYPE_INT_RANGE, 16, G_MAXINT, NULL);
+    gst_structure_remove_fields (structure, "format", "colorimetry",
+        "chroma-site", "interlace-mode", "field-order", NULL);
+
+    gst_caps_append_structure_full (ret, structure,
+        gst_caps_features_copy (features));
+  }
+
+  if (direction == GST_PAD_SINK)
+    tmpl = gst_pad_get_pad_template_caps (GST_BASE_TRANSFORM_SRC_PAD (trans));
+  else
+    tmpl = gst_pad_get_pad_template_caps (GST_BASE_TRANSFORM_SINK_PAD (trans));
+
+  tmp = gst_caps_intersect_full (ret, tmpl, GST_CAPS_INTERSECT_FIRST);
+  gst_caps_unref (ret);
+  gst_caps_unref (tmpl);
+  ret = tmp;
+
+  if (filter) {
+    tmp = gst_caps_intersect_full (filter, ret, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (ret);
+    ret = tmp;
+  }
+
+  GST_DEBUG_OBJECT (trans, "transformed %" GST_PTR_FORMAT " into %"
+      GST_PTR_FORMAT, caps, ret);
+
+  return ret;
+}
+
+static GstCaps *
+gst_msdkvpp_fixate_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * othercaps)
+{
+  GstStructure *ins, *outs;
+  const gchar *format;
+  gint width, height, out_width, out_height;
+  gboolean have_width, have_height;
+
+  othercaps = gst_caps_truncate (othercaps);
+  othercaps = gst_caps_make_writable (othercaps);
+
+  ins = gst_caps_get_structure (caps, 0);
+  outs = gst_caps_get_structure (othercaps, 0);
+
+  /* Keep the input size and format unless the other side asks otherwise.
+   * If only one dimension is given, keep the aspect ratio. */
+  if (gst_structure_get_int (ins, "width", &width) &&
+      gst_structure_get_int (ins, "height", &height)) {
+    have_width = gst_structure_get_int (outs, "width", &out_width);
+    have_height = gst_structure_get_int (outs, "height", &out_height);
+
+    if (have_width && !have_height) {
+      gst_structure_fixate_field_nearest_int (outs, "height",
+          gst_util_uint64_scale_int (out_width, height, width));
+    } else if (have_height && !have_width) {
+      gst_structure_fixate_field_nearest_int (outs, "width",
+          gst_util_uint64_scale_int (out_height, width, height));
+    } else if (!have_width && !have_height) {
+      gst_structure_fixate_field_nearest_int (outs, "width", width);
+      gst_structure_fixate_field_nearest_int (outs, "height", height);
+    }
+  }
+
+  format = gst_structure_get_string (ins, "format");
+  if (format && gst_structure_has_field (outs, "format"))
+    gst_structure_fixate_field_string (outs, "format", format);
+
+  othercaps = gst_caps_fixate (othercaps);
+
+  GST_DEBUG_OBJECT (trans, "fixated to %" GST_PTR_FORMAT, othercaps);
+
+  return othercaps;
+}
+
+static gboolean
+gst_msdkvpp_start (GstBaseTransform * trans)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (trans);
+
+  if (gst_msdk_context_prepare (GST_ELEMENT_CAST (thiz), &thiz->context)) {
+    GST_INFO_OBJECT (thiz, "Found context %" GST_PTR_FORMAT " from neighbour",
+        thiz->context);
+
+    if (gst_msdk_context_get_job_type (thiz->context) & GST_MSDK_JOB_VPP) {
+      GstMsdkContext *parent_context;
+
+      parent_context = thiz->context;
+      thiz->context = gst_msdk_context_new_with_parent (parent_context);
+
+      gst_msdk_context_add_shared_async_depth (thiz->context,
+          gst_msdk_context_get_shared_async_depth (parent_context));
+      gst_object_unref (parent_context);
+
+      GST_INFO_OBJECT (thiz,
+          "Creating new context %" GST_PTR_FORMAT " with joined session",
+          thiz->context);
+    } else {
+      gst_msdk_context_add_job_type (thiz->context, GST_MSDK_JOB_VPP);
+    }
+  } else {
+    gst_msdk_context_ensure_context (GST_ELEMENT_CAST (thiz), thiz->hardware,
+        GST_MSDK_JOB_VPP);
+    GST_INFO_OBJECT (thiz, "Creating new context %" GST_PTR_FORMAT,
+        thiz->context);
+  }
+
+  gst_msdk_context_add_shared_async_depth (thiz->context, thiz->async_depth);
+
+  return TRUE;
+}
+
+static gboolean
+gst_msdkvpp_stop (GstBaseTransform * trans)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (trans);
+
+  gst_msdkvpp_close (thiz);
+
+  gst_video_info_init (&thiz->sinkpad_info);
+  gst_video_info_init (&thiz->srcpad_info);
+
+  if (thiz->context)
+    gst_object_replace ((GstObject **) & thiz->context, NULL);
+
+  return TRUE;
+}
+
+static void
+gst_msdkvpp_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (object);
+  GstState state;
+
+  GST_OBJECT_LOCK (thiz);
+
+  state = GST_STATE (thiz);
+  if ((state != GST_STATE_READY && state != GST_STATE_NULL) &&
+      !(pspec->flags & GST_PARAM_MUTABLE_PLAYING))
+    goto wrong_state;
+
+  switch (prop_id) {
+    case PROP_HARDWARE:
+      thiz->hardware = g_value_get_boolean (value);
+      break;
+    case PROP_ASYNC_DEPTH:
+      thiz->async_depth = g_value_get_uint (value);
+      break;
+    case PROP_DENOISE:
+      thiz->denoise_factor = g_value_get_uint (value);
+      break;
+    case PROP_DEINTERLACE_METHOD:
+      thiz->deinterlace_method = g_value_get_enum (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (thiz);
+  return;
+
+  /* ERROR */
+wrong_state:
+  {
+    GST_WARNING_OBJECT (thiz, "setting property in wrong state");
+    GST_OBJECT_UNLOCK (thiz);
+  }
+}
+
+static void
+gst_msdkvpp_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstMsdkVPP *thiz = GST_MSDKVPP (object);
+
+  GST_OBJECT_LOCK (thiz);
+  switch (prop_id) {
+    case PROP_HARDWARE:
+      g_value_set_boolean (value, thiz->hardware);
+      break;
+    case PROP_ASYNC_DEPTH:
+      g_value_set_uint (value, thiz->async_depth);
+      break;
+    case PROP_DENOISE:
+      g_value_set_uint (value, thiz->denoise_factor);
+      break;
+    case PROP_DEINTERLACE_METHOD:
+      g_value_set_enum (value, thiz->deinterlace_method);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (thiz);
+}
+
+static void
+gst_msdkvpp_class_init (GstMsdkVPPClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *element_class;
+  GstBaseTransformClass *trans_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  element_class = GST_ELEMENT_CLASS (klass);
+  trans_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  gobject_class->set_property = gst_msdkvpp_set_property;
+  gobject_class->get_property = gst_msdkvpp_get_property;
+
+  element_class->set_context = gst_msdkvpp_set_context;
+
+  trans_class->start = GST_DEBUG_FUNCPTR (gst_msdkvpp_start);
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_msdkvpp_stop);
+  trans_class->transform_caps = GST_DEBUG_FUNCPTR (gst_msdkvpp_transform_caps);
+  trans_class->fixate_caps = GST_DEBUG_FUNCPTR (gst_msdkvpp_fixate_caps);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_msdkvpp_set_caps);
+  trans_class->transform = GST_DEBUG_FUNCPTR (gst_msdkvpp_transform);
+  trans_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_msdkvpp_propose_allocation);
+  trans_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_msdkvpp_decide_allocation);
+
+  g_object_class_install_property (gobject_class, PROP_HARDWARE,
+      g_param_spec_boolean ("hardware", "Hardware", "Enable hardware VPP",
+          PROP_HARDWARE_DEFAULT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ASYNC_DEPTH,
+      g_param_spec_uint ("async-depth", "Async Depth",
+          "Depth of asynchronous pipeline",
+          1, 20, PROP_ASYNC_DEPTH_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DENOISE,
+      g_param_spec_uint ("denoise", "Denoise",
+          "Denoising factor, 0 disables the denoise filter",
+          0, 100, PROP_DENOISE_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DEINTERLACE_METHOD,
+      g_param_spec_enum ("deinterlace-method", "Deinterlace method",
+          "Deinterlacing method used for interlaced input",
+          gst_msdkvpp_deinterlace_method_get_type (),
+          PROP_DEINTERLACE_METHOD_DEFAULT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  gst_element_class_set_static_metadata (element_class,
+      "MSDK Video Postprocessor",
+      "Filter/Converter/Video;Filter/Converter/Video/Scaler;"
+      "Filter/Effect/Video;Filter/Effect/Video/Deinterlace",
+      "A MediaSDK Video Postprocessing Filter",
+      "GStreamer maintainers <gstreamer-devel@lists.freedesktop.org>");
+
+  gst_element_class_add_static_pad_template (element_class,
+      &gst_msdkvpp_sink_factory);
+  gst_element_class_add_static_pad_template (element_class,
+      &gst_msdkvpp_src_factory);
+}
+
+static void
+gst_msdkvpp_init (GstMsdkVPP * thiz)
+{
+  gst_video_info_init (&thiz->sinkpad_info);
+  gst_video_info_init (&thiz->srcpad_info);
+  thiz->hardware = PROP_HARDWARE_DEFAULT;
+  thiz->async_depth = PROP_ASYNC_DEPTH_DEFAULT;
+  thiz->denoise_factor = PROP_DENOISE_DEFAULT;
+  thiz->deinterlace_method = PROP_DEINTERLACE_METHOD_DEFAULT;
+}
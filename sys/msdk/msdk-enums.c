@@ -154,3 +154,21 @@ gst_msdkenc_adaptive_b_get_type (void)
   }
   return type;
 }
+
+GType
+gst_msdkvpp_deinterlace_method_get_type (void)
+{
+  static GType type = 0;
+
+  static const GEnumValue values[] = {
+    {MFX_DEINTERLACING_BOB, "Bob deinterlacing", "bob"},
+    {MFX_DEINTERLACING_ADVANCED, "Advanced deinterlacing (Motion adaptive)",
+        "advanced"},
+    {0, NULL, NULL}
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstMsdkVPPDeinterlaceMethod", values);
+  }
+  return type;
+}
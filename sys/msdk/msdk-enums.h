@@ -58,5 +58,8 @@ gst_msdkenc_adaptive_i_get_type (void);
 GType
 gst_msdkenc_adaptive_b_get_type (void);
 
+GType
+gst_msdkvpp_deinterlace_method_get_type (void);
+
 G_END_DECLS
 #endif
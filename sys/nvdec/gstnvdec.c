@@ -275,6 +275,119 @@ gst_nvdec_init (GstNvDec * nvdec)
   gst_video_decoder_set_needs_format (GST_VIDEO_DECODER (nvdec), TRUE);
 }
 
+/* Frames the driver may have mapped for us at the same time, more than one
+ * lets it post-process the next picture while the previous one is copied */
+#define GST_NVDEC_NUM_OUTPUT_SURFACES 2
+
+/* Surfaces on top of the DPB: the picture being decoded and the ones waiting
+ * to be displayed or mapped */
+#define GST_NVDEC_EXTRA_DECODE_SURFACES 4
+
+typedef struct
+{
+  const gchar *level;
+  guint max_dpb_mbs;
+} GstNvDecH264Level;
+
+/* Table A-1 of the H.264 specification */
+static const GstNvDecH264Level h264_levels[] = {
+  {"1", 396}, {"1b", 396}, {"1.1", 900}, {"1.2", 2376}, {"1.3", 2376},
+  {"2", 2376}, {"2.1", 4752}, {"2.2", 8100}, {"3", 8100}, {"3.1", 18000},
+  {"3.2", 20480}, {"4", 32768}, {"4.1", 32768}, {"4.2", 34816},
+  {"5", 110400}, {"5.1", 184320}, {"5.2", 184320}, {"6", 696320},
+  {"6.1", 696320}, {"6.2", 696320}
+};
+
+typedef struct
+{
+  const gchar *level;
+  guint max_luma_ps;
+} GstNvDecH265Level;
+
+/* Table A.6 of the H.265 specification */
+static const GstNvDecH265Level h265_levels[] = {
+  {"1", 36864}, {"2", 122880}, {"2.1", 245760}, {"3", 552960},
+  {"3.1", 983040}, {"4", 2228224}, {"4.1", 2228224}, {"5", 8912896},
+  {"5.1", 8912896}, {"5.2", 8912896}, {"6", 35651584}, {"6.1", 35651584},
+  {"6.2", 35651584}
+};
+
+/* Number of decode surfaces needed for the stream described by the sink
+ * caps, the worst case of the codec is used for whatever is not known */
+static guint
+gst_nvdec_get_num_decode_surfaces (GstNvDec * nvdec, cudaVideoCodec codec,
+    GstStructure * s)
+{
+  const gchar *level = gst_structure_get_string (s, "level");
+  gint width = 0, height = 0;
+  guint dpb_size, i;
+
+  gst_structure_get_int (s, "width", &width);
+  gst_structure_get_int (s, "height", &height);
+
+  switch (codec) {
+    case cudaVideoCodec_H264:{
+      guint max_dpb_mbs = 0;
+
+      dpb_size = 16;
+      if (!level || width <= 0 || height <= 0)
+        break;
+
+      for (i = 0; i < G_N_ELEMENTS (h264_levels); i++) {
+        if (!g_strcmp0 (level, h264_levels[i].level)) {
+          max_dpb_mbs = h264_levels[i].max_dpb_mbs;
+          break;
+        }
+      }
+
+      if (max_dpb_mbs) {
+        guint frame_mbs = (GST_ROUND_UP_16 (width) / 16) *
+            (GST_ROUND_UP_16 (height) / 16);
+
+        dpb_size = CLAMP (max_dpb_mbs / frame_mbs, 1, 16);
+      }
+      break;
+    }
+    case cudaVideoCodec_HEVC:{
+      guint max_luma_ps = 35651584;
+      guint pic_size;
+
+      if (level) {
+        for (i = 0; i < G_N_ELEMENTS (h265_levels); i++) {
+          if (!g_strcmp0 (level, h265_levels[i].level)) {
+            max_luma_ps = h265_levels[i].max_luma_ps;
+            break;
+          }
+        }
+      }
+
+      /* A.4.2, the largest pictures get a DPB of maxDpbPicBuf = 6 */
+      pic_size = width > 0 && height > 0 ? width * height : max_luma_ps;
+      if (pic_size <= (max_luma_ps >> 2))
+        dpb_size = 16;
+      else if (pic_size <= (max_luma_ps >> 1))
+        dpb_size = 12;
+      else if (pic_size <= ((3 * max_luma_ps) >> 2))
+        dpb_size = 8;
+      else
+        dpb_size = 6;
+      break;
+    }
+    case cudaVideoCodec_JPEG:
+      dpb_size = 0;
+      break;
+    default:
+      /* MPEG-1/2/4 only ever reference two pictures */
+      dpb_size = 2;
+      break;
+  }
+
+  GST_DEBUG_OBJECT (nvdec, "level %s, %dx%d: DPB of %u pictures",
+      GST_STR_NULL (level), width, height, dpb_size);
+
+  return dpb_size + 1 + GST_NVDEC_EXTRA_DECODE_SURFACES;
+}
+
 static gboolean
 parser_sequence_callback (GstNvDec * nvdec, CUVIDEOFORMAT * format)
 {
@@ -305,7 +418,7 @@ parser_sequence_callback (GstNvDec * nvdec, CUVIDEOFORMAT * format)
     GST_DEBUG_OBJECT (nvdec, "creating decoder");
     create_info.ulWidth = width;
     create_info.ulHeight = height;
-    create_info.ulNumDecodeSurfaces = 20;
+    create_info.ulNumDecodeSurfaces = nvdec->num_decode_surfaces;
     create_info.CodecType = format->codec;
     create_info.ChromaFormat = format->chroma_format;
     create_info.ulCreationFlags = cudaVideoCreate_Default;
@@ -317,7 +430,7 @@ parser_sequence_callback (GstNvDec * nvdec, CUVIDEOFORMAT * format)
     create_info.DeinterlaceMode = cudaVideoDeinterlaceMode_Weave;
     create_info.ulTargetWidth = width;
     create_info.ulTargetHeight = height;
-    create_info.ulNumOutputSurfaces = 1;
+    create_info.ulNumOutputSurfaces = GST_NVDEC_NUM_OUTPUT_SURFACES;
     create_info.vidLock = nvdec->cuda_context->lock;
     create_info.target_rect.left = 0;
     create_info.target_rect.top = 0;
@@ -542,7 +655,14 @@ gst_nvdec_set_format (GstVideoDecoder * decoder, GstVideoCodecState * state)
     return FALSE;
   }
 
-  parser_params.ulMaxNumDecodeSurfaces = 20;
+  /* the parser hands out picture indices below this, so the decoder has to
+   * be created with the same number of surfaces */
+  nvdec->num_decode_surfaces =
+      gst_nvdec_get_num_decode_surfaces (nvdec, parser_params.CodecType, s);
+  GST_DEBUG_OBJECT (nvdec, "using %u decode surfaces",
+      nvdec->num_decode_surfaces);
+
+  parser_params.ulMaxNumDecodeSurfaces = nvdec->num_decode_surfaces;
   parser_params.ulErrorThreshold = 100;
   parser_params.ulMaxDisplayDelay = 0;
   parser_params.ulClockRate = GST_SECOND;
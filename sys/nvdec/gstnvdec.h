@@ -73,6 +73,7 @@ struct _GstNvDec
   CUvideoparser parser;
   CUvideodecoder decoder;
   GAsyncQueue *decode_queue;
+  guint num_decode_surfaces;
 
   guint width;
   guint height;
@@ -167,6 +167,7 @@ enum
   PROP_QP_MAX,
   PROP_QP_CONST,
   PROP_GOP_SIZE,
+  PROP_MAX_IN_FLIGHT,
 };
 
 #define DEFAULT_PRESET GST_NV_PRESET_DEFAULT
@@ -176,6 +177,7 @@ enum
 #define DEFAULT_QP_MAX -1
 #define DEFAULT_QP_CONST -1
 #define DEFAULT_GOP_SIZE 75
+#define DEFAULT_MAX_IN_FLIGHT 0
 
 /* This lock is needed to prevent the situation where multiple encoders are
  * initialised at the same time which appears to cause excessive CPU usage over
@@ -194,6 +196,16 @@ struct gl_input_resource
   NV_ENC_REGISTER_RESOURCE nv_resource;
   NV_ENC_MAP_INPUT_RESOURCE nv_mapped_resource;
 };
+
+/* A GL buffer object registered with CUDA. Registration is expensive so it
+ * is done once per GL memory, which is kept alive by the cache until the
+ * encoder frees its buffers. Only used from the GL thread. */
+struct gl_registered_resource
+{
+  CUcontext cuda_ctx;
+  GstGLMemoryPBO *gl_mem;
+  struct cudaGraphicsResource *cuda_resource;
+};
 #endif
 
 struct frame_state
@@ -298,6 +310,25 @@ gst_nv_base_enc_class_init (GstNvBaseEncClass * klass)
           DEFAULT_BITRATE,
           G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
           G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstNvBaseEnc:max-in-flight:
+   *
+   * Number of input and output surfaces allocated for the encoder, which
+   * bounds how many frames can be queued in the hardware at once. Deeper
+   * queues keep the encoder busy while output is being read back, at the
+   * cost of latency and video memory. The default picks a depth based on
+   * the frame size. The value is raised if B-frames need more surfaces,
+   * and takes effect on the next stream start.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_IN_FLIGHT,
+      g_param_spec_uint ("max-in-flight", "Max Frames In Flight",
+          "Maximum number of frames queued in the encoder (0 = automatic)",
+          0, 256, DEFAULT_MAX_IN_FLIGHT,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
 }
 
 static gboolean
@@ -670,6 +701,7 @@ gst_nv_base_enc_init (GstNvBaseEnc * nvenc)
   nvenc->qp_const = DEFAULT_QP_CONST;
   nvenc->bitrate = DEFAULT_BITRATE;
   nvenc->gop_size = DEFAULT_GOP_SIZE;
+  nvenc->max_in_flight = DEFAULT_MAX_IN_FLIGHT;
 
   GST_VIDEO_ENCODER_STREAM_LOCK (encoder);
   GST_VIDEO_ENCODER_STREAM_UNLOCK (encoder);
@@ -681,38 +713,6 @@ gst_nv_base_enc_finalize (GObject * obj)
   G_OBJECT_CLASS (gst_nv_base_enc_parent_class)->finalize (obj);
 }
 
-static GstVideoCodecFrame *
-_find_frame_with_output_buffer (GstNvBaseEnc * nvenc, NV_ENC_OUTPUT_PTR out_buf)
-{
-  GList *l, *walk = gst_video_encoder_get_frames (GST_VIDEO_ENCODER (nvenc));
-  GstVideoCodecFrame *ret = NULL;
-  gint i;
-
-  for (l = walk; l; l = l->next) {
-    GstVideoCodecFrame *frame = (GstVideoCodecFrame *) l->data;
-    struct frame_state *state = frame->user_data;
-
-    if (!state)
-      continue;
-
-    for (i = 0; i < N_BUFFERS_PER_FRAME; i++) {
-
-      if (!state->out_bufs[i])
-        break;
-
-      if (state->out_bufs[i] == out_buf)
-        ret = frame;
-    }
-  }
-
-  if (ret)
-    gst_video_codec_frame_ref (ret);
-
-  g_list_free_full (walk, (GDestroyNotify) gst_video_codec_frame_unref);
-
-  return ret;
-}
-
 static gpointer
 gst_nv_base_enc_bitstream_thread (gpointer user_data)
 {
@@ -720,104 +720,97 @@ gst_nv_base_enc_bitstream_thread (gpointer user_data)
   GstNvBaseEnc *nvenc = user_data;
 
   /* overview of operation:
-   * 1. retreive the next buffer submitted to the bitstream pool
-   * 2. wait for that buffer to be ready from nvenc (LockBitsream)
-   * 3. retreive the GstVideoCodecFrame associated with that buffer
-   * 4. for each buffer in the frame
-   * 4.1 (step 2): wait for that buffer to be ready from nvenc (LockBitsream)
-   * 4.2 create an output GstBuffer from the nvenc buffers
-   * 4.3 unlock the nvenc bitstream buffers UnlockBitsream
-   * 5. finish_frame()
-   * 6. cleanup
+   * 1. retrieve the next frame submitted to the bitstream queue
+   * 2. for each output buffer of the frame
+   * 2.1 wait for that buffer to be ready from nvenc (LockBitstream)
+   * 2.2 create an output GstBuffer from the nvenc buffer
+   * 2.3 unlock the nvenc bitstream buffer (UnlockBitstream)
+   * 3. finish_frame()
+   * 4. cleanup
+   *
+   * The frame travels through the queue with its own reference, so this
+   * thread never has to take the stream lock to look it up and only
+   * contends with input submission in finish_frame().
    */
   do {
     GstBuffer *buffers[N_BUFFERS_PER_FRAME];
-    struct frame_state *state = NULL;
-    GstVideoCodecFrame *frame = NULL;
+    struct frame_state *state;
+    GstVideoCodecFrame *frame;
     NVENCSTATUS nv_ret;
     GstFlowReturn flow = GST_FLOW_OK;
+    gboolean failed = FALSE;
     gint i;
 
-    {
-      NV_ENC_LOCK_BITSTREAM lock_bs = { 0, };
-      NV_ENC_OUTPUT_PTR out_buf;
-
-      for (i = 0; i < N_BUFFERS_PER_FRAME; i++) {
-        /* get and lock bitstream buffers */
-        GstVideoCodecFrame *tmp_frame;
-
-        if (state && i >= state->n_buffers)
-          break;
-
-        GST_LOG_OBJECT (enc, "wait for bitstream buffer..");
+    GST_LOG_OBJECT (enc, "wait for submitted frame..");
 
-        /* assumes buffers are submitted in order */
-        out_buf = g_async_queue_pop (nvenc->bitstream_queue);
-        if ((gpointer) out_buf == SHUTDOWN_COOKIE)
-          break;
+    /* assumes buffers are submitted in order */
+    frame = g_async_queue_pop (nvenc->bitstream_queue);
+    if ((gpointer) frame == SHUTDOWN_COOKIE)
+      break;
 
-        GST_LOG_OBJECT (nvenc, "waiting for output buffer %p to be ready",
-            out_buf);
+    state = frame->user_data;
+    g_assert (state != NULL);
 
-        lock_bs.version = NV_ENC_LOCK_BITSTREAM_VER;
-        lock_bs.outputBitstream = out_buf;
-        lock_bs.doNotWait = 0;
+    for (i = 0; i < state->n_buffers; i++) {
+      NV_ENC_LOCK_BITSTREAM lock_bs = { 0, };
+      NV_ENC_OUTPUT_PTR out_buf = state->out_bufs[i];
 
-        /* FIXME: this would need to be updated for other slice modes */
-        lock_bs.sliceOffsets = NULL;
+      GST_LOG_OBJECT (nvenc, "waiting for output buffer %p to be ready",
+          out_buf);
 
-        nv_ret = NvEncLockBitstream (nvenc->encoder, &lock_bs);
-        if (nv_ret != NV_ENC_SUCCESS) {
-          /* FIXME: what to do here? */
-          GST_ELEMENT_ERROR (nvenc, STREAM, ENCODE, (NULL),
-              ("Failed to lock bitstream buffer %p, ret %d",
-                  lock_bs.outputBitstream, nv_ret));
-          out_buf = SHUTDOWN_COOKIE;
-          break;
-        }
+      lock_bs.version = NV_ENC_LOCK_BITSTREAM_VER;
+      lock_bs.outputBitstream = out_buf;
+      lock_bs.doNotWait = 0;
 
-        GST_LOG_OBJECT (nvenc, "picture type %d", lock_bs.pictureType);
+      /* FIXME: this would need to be updated for other slice modes */
+      lock_bs.sliceOffsets = NULL;
 
-        tmp_frame = _find_frame_with_output_buffer (nvenc, out_buf);
-        g_assert (tmp_frame != NULL);
-        if (frame)
-          g_assert (frame == tmp_frame);
-        frame = tmp_frame;
+      nv_ret = NvEncLockBitstream (nvenc->encoder, &lock_bs);
+      if (nv_ret != NV_ENC_SUCCESS) {
+        /* FIXME: what to do here? */
+        GST_ELEMENT_ERROR (nvenc, STREAM, ENCODE, (NULL),
+            ("Failed to lock bitstream buffer %p, ret %d",
+                lock_bs.outputBitstream, nv_ret));
+        failed = TRUE;
+        break;
+      }
 
-        state = frame->user_data;
-        g_assert (state->out_bufs[i] == out_buf);
+      GST_LOG_OBJECT (nvenc, "picture type %d", lock_bs.pictureType);
 
-        /* copy into output buffer */
-        buffers[i] =
-            gst_buffer_new_allocate (NULL, lock_bs.bitstreamSizeInBytes, NULL);
-        gst_buffer_fill (buffers[i], 0, lock_bs.bitstreamBufferPtr,
-            lock_bs.bitstreamSizeInBytes);
+      /* copy into output buffer */
+      buffers[i] =
+          gst_buffer_new_allocate (NULL, lock_bs.bitstreamSizeInBytes, NULL);
+      gst_buffer_fill (buffers[i], 0, lock_bs.bitstreamBufferPtr,
+          lock_bs.bitstreamSizeInBytes);
 
-        if (lock_bs.pictureType == NV_ENC_PIC_TYPE_IDR) {
-          GST_DEBUG_OBJECT (nvenc, "This is a keyframe");
-          GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
-        }
+      if (lock_bs.pictureType == NV_ENC_PIC_TYPE_IDR) {
+        GST_DEBUG_OBJECT (nvenc, "This is a keyframe");
+        GST_VIDEO_CODEC_FRAME_SET_SYNC_POINT (frame);
+      }
 
-        /* TODO: use lock_bs.outputTimeStamp and lock_bs.outputDuration */
-        /* TODO: check pts/dts is handled properly if there are B-frames */
+      /* TODO: use lock_bs.outputTimeStamp and lock_bs.outputDuration */
+      /* TODO: check pts/dts is handled properly if there are B-frames */
 
-        nv_ret = NvEncUnlockBitstream (nvenc->encoder, state->out_bufs[i]);
-        if (nv_ret != NV_ENC_SUCCESS) {
-          /* FIXME: what to do here? */
-          GST_ELEMENT_ERROR (nvenc, STREAM, ENCODE, (NULL),
-              ("Failed to unlock bitstream buffer %p, ret %d",
-                  lock_bs.outputBitstream, nv_ret));
-          state->out_bufs[i] = SHUTDOWN_COOKIE;
-          break;
-        }
-
-        GST_LOG_OBJECT (nvenc, "returning bitstream buffer %p to pool",
-            state->out_bufs[i]);
-        g_async_queue_push (nvenc->bitstream_pool, state->out_bufs[i]);
+      nv_ret = NvEncUnlockBitstream (nvenc->encoder, out_buf);
+      if (nv_ret != NV_ENC_SUCCESS) {
+        /* FIXME: what to do here? */
+        GST_ELEMENT_ERROR (nvenc, STREAM, ENCODE, (NULL),
+            ("Failed to unlock bitstream buffer %p, ret %d",
+                lock_bs.outputBitstream, nv_ret));
+        gst_buffer_unref (buffers[i]);
+        failed = TRUE;
+        break;
       }
 
-      if (out_buf == SHUTDOWN_COOKIE)
-        break;
+      GST_LOG_OBJECT (nvenc, "returning bitstream buffer %p to pool", out_buf);
+      g_async_queue_push (nvenc->bitstream_pool, out_buf);
+    }
+
+    if (failed) {
+      while (--i >= 0)
+        gst_buffer_unref (buffers[i]);
+      gst_video_codec_frame_unref (frame);
+      break;
     }
 
     {
@@ -894,7 +887,7 @@ gst_nv_base_enc_start_bitstream_thread (GstNvBaseEnc * nvenc)
 static gboolean
 gst_nv_base_enc_stop_bitstream_thread (GstNvBaseEnc * nvenc)
 {
-  gpointer out_buf;
+  GstVideoCodecFrame *frame;
 
   if (nvenc->bitstream_thread == NULL)
     return TRUE;
@@ -903,9 +896,16 @@ gst_nv_base_enc_stop_bitstream_thread (GstNvBaseEnc * nvenc)
   GST_FIXME_OBJECT (nvenc, "stop bitstream reading thread properly");
   g_async_queue_lock (nvenc->bitstream_queue);
   g_async_queue_lock (nvenc->bitstream_pool);
-  while ((out_buf = g_async_queue_try_pop_unlocked (nvenc->bitstream_queue))) {
-    GST_INFO_OBJECT (nvenc, "stole bitstream buffer %p from queue", out_buf);
-    g_async_queue_push_unlocked (nvenc->bitstream_pool, out_buf);
+  while ((frame = g_async_queue_try_pop_unlocked (nvenc->bitstream_queue))) {
+    struct frame_state *state = frame->user_data;
+    gint i;
+
+    for (i = 0; i < state->n_buffers; i++) {
+      GST_INFO_OBJECT (nvenc, "stole bitstream buffer %p from queue",
+          state->out_bufs[i]);
+      g_async_queue_push_unlocked (nvenc->bitstream_pool, state->out_bufs[i]);
+    }
+    gst_video_codec_frame_unref (frame);
   }
   g_async_queue_push_unlocked (nvenc->bitstream_queue, SHUTDOWN_COOKIE);
   g_async_queue_unlock (nvenc->bitstream_pool);
@@ -929,7 +929,8 @@ gst_nv_base_enc_reset_queues (GstNvBaseEnc * nvenc, gboolean refill)
   GST_INFO_OBJECT (nvenc, "clearing queues");
 
   while ((ptr = g_async_queue_try_pop (nvenc->bitstream_queue))) {
-    /* do nothing */
+    if (ptr != SHUTDOWN_COOKIE)
+      gst_video_codec_frame_unref (ptr);
   }
   while ((ptr = g_async_queue_try_pop (nvenc->bitstream_pool))) {
     /* do nothing */
@@ -947,6 +948,29 @@ gst_nv_base_enc_reset_queues (GstNvBaseEnc * nvenc, gboolean refill)
   }
 }
 
+#if HAVE_NVENC_GST_GL
+static void
+_unregister_gl_resource (GstGLContext * context,
+    struct gl_registered_resource *resource)
+{
+  cudaError_t cuda_ret;
+
+  cuCtxPushCurrent (resource->cuda_ctx);
+  cuda_ret = cudaGraphicsUnregisterResource (resource->cuda_resource);
+  if (cuda_ret != cudaSuccess)
+    GST_WARNING ("failed to unregister GL buffer %u from cuda ret :%d",
+        resource->gl_mem->pbo->id, cuda_ret);
+  cuCtxPopCurrent (NULL);
+}
+
+static void
+_free_gl_resource (struct gl_registered_resource *resource)
+{
+  gst_memory_unref (GST_MEMORY_CAST (resource->gl_mem));
+  g_free (resource);
+}
+#endif
+
 static void
 gst_nv_base_enc_free_buffers (GstNvBaseEnc * nvenc)
 {
@@ -958,6 +982,23 @@ gst_nv_base_enc_free_buffers (GstNvBaseEnc * nvenc)
 
   gst_nv_base_enc_reset_queues (nvenc, FALSE);
 
+#if HAVE_NVENC_GST_GL
+  if (nvenc->gl_resources) {
+    GHashTableIter iter;
+    struct gl_registered_resource *resource;
+
+    /* unregistering has to happen in the thread of each memory's context */
+    g_hash_table_iter_init (&iter, nvenc->gl_resources);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & resource)) {
+      gst_gl_context_thread_add (resource->gl_mem->mem.mem.context,
+          (GstGLContextThreadFunc) _unregister_gl_resource, resource);
+      g_hash_table_iter_remove (&iter);
+    }
+    g_hash_table_unref (nvenc->gl_resources);
+    nvenc->gl_resources = NULL;
+  }
+#endif
+
   for (i = 0; i < nvenc->n_bufs; ++i) {
     NV_ENC_OUTPUT_PTR out_buf = nvenc->output_bufs[i];
 
@@ -1253,7 +1294,15 @@ gst_nv_base_enc_set_format (GstVideoEncoder * enc, GstVideoCodecState * state)
 
     num_macroblocks = (GST_ROUND_UP_16 (input_width) >> 4)
         * (GST_ROUND_UP_16 (input_height) >> 4);
-    nvenc->n_bufs = (num_macroblocks >= 8160) ? 32 : 48;
+    if (nvenc->max_in_flight > 0) {
+      /* every frame held back for reordering occupies a surface pair, leave
+       * at least one more for the frame being submitted */
+      nvenc->n_bufs = MAX (nvenc->max_in_flight,
+          preset_config.presetCfg.frameIntervalP + 1);
+    } else {
+      nvenc->n_bufs = (num_macroblocks >= 8160) ? 32 : 48;
+    }
+    GST_DEBUG_OBJECT (nvenc, "allocating %u surfaces", nvenc->n_bufs);
 
     /* input buffers */
     nvenc->input_bufs = g_new0 (gpointer, nvenc->n_bufs);
@@ -1462,6 +1511,64 @@ struct map_gl_input
   struct gl_input_resource *in_gl_resource;
 };
 
+/* Returns the CUDA registration of the PBO backing @gl_mem, registering it on
+ * first use. Must be called from the GL thread with the CUDA context pushed */
+static struct cudaGraphicsResource *
+_get_gl_resource (GstNvBaseEnc * nvenc, GstGLMemoryPBO * gl_mem)
+{
+  struct gl_registered_resource *resource;
+  cudaError_t cuda_ret;
+
+  if (nvenc->gl_resources == NULL)
+    nvenc->gl_resources = g_hash_table_new_full (NULL, NULL, NULL,
+        (GDestroyNotify) _free_gl_resource);
+
+  resource = g_hash_table_lookup (nvenc->gl_resources, gl_mem);
+  if (resource)
+    return resource->cuda_resource;
+
+  /* upstream is not recycling its memory, don't let the cache grow without
+   * bounds and start over */
+  if (g_hash_table_size (nvenc->gl_resources) >=
+      nvenc->n_bufs * GST_VIDEO_MAX_PLANES) {
+    GHashTableIter iter;
+
+    GST_DEBUG_OBJECT (nvenc, "flushing %u cached GL registrations",
+        g_hash_table_size (nvenc->gl_resources));
+
+    g_hash_table_iter_init (&iter, nvenc->gl_resources);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & resource)) {
+      cuda_ret = cudaGraphicsUnregisterResource (resource->cuda_resource);
+      if (cuda_ret != cudaSuccess)
+        GST_WARNING_OBJECT (nvenc, "failed to unregister GL buffer %u from "
+            "cuda ret :%d", resource->gl_mem->pbo->id, cuda_ret);
+      g_hash_table_iter_remove (&iter);
+    }
+  }
+
+  resource = g_new0 (struct gl_registered_resource, 1);
+  resource->cuda_ctx = nvenc->cuda_ctx;
+
+  cuda_ret =
+      cudaGraphicsGLRegisterBuffer (&resource->cuda_resource, gl_mem->pbo->id,
+      cudaGraphicsRegisterFlagsReadOnly);
+  if (cuda_ret != cudaSuccess) {
+    GST_ERROR_OBJECT (nvenc, "failed to register GL texture %u to cuda "
+        "ret :%d", gl_mem->mem.tex_id, cuda_ret);
+    g_free (resource);
+    return NULL;
+  }
+
+  GST_DEBUG_OBJECT (nvenc, "registered GL buffer %u of texture %u with cuda",
+      gl_mem->pbo->id, gl_mem->mem.tex_id);
+
+  resource->gl_mem =
+      (GstGLMemoryPBO *) gst_memory_ref (GST_MEMORY_CAST (gl_mem));
+  g_hash_table_insert (nvenc->gl_resources, gl_mem, resource);
+
+  return resource->cuda_resource;
+}
+
 static void
 _map_gl_input_buffer (GstGLContext * context, struct map_gl_input *data)
 {
@@ -1494,14 +1601,10 @@ _map_gl_input_buffer (GstGLContext * context, struct map_gl_input *data)
     GST_LOG_OBJECT (data->nvenc, "attempting to copy texture %u into cuda",
         gl_mem->mem.tex_id);
 
-    cuda_ret =
-        cudaGraphicsGLRegisterBuffer (&data->in_gl_resource->cuda_texture,
-        gl_buf_obj->id, cudaGraphicsRegisterFlagsReadOnly);
-    if (cuda_ret != cudaSuccess) {
-      GST_ERROR_OBJECT (data->nvenc, "failed to register GL texture %u to cuda "
-          "ret :%d", gl_mem->mem.tex_id, cuda_ret);
+    data->in_gl_resource->cuda_texture =
+        _get_gl_resource (data->nvenc, gl_mem);
+    if (data->in_gl_resource->cuda_texture == NULL)
       g_assert_not_reached ();
-    }
 
     cuda_ret =
         cudaGraphicsMapResources (1, &data->in_gl_resource->cuda_texture, 0);
@@ -1524,7 +1627,8 @@ _map_gl_input_buffer (GstGLContext * context, struct map_gl_input *data)
     src_stride = GST_VIDEO_INFO_PLANE_STRIDE (data->info, i);
     dest_stride = data->in_gl_resource->cuda_stride;
 
-    /* copy into scratch buffer */
+    /* copy into scratch buffer, the planes live in separate buffer objects
+     * while NVENC wants them in one contiguous surface */
     cuda_ret =
         cudaMemcpy2D (data_pointer, dest_stride,
         data->in_gl_resource->cuda_plane_pointers[i], src_stride,
@@ -1544,14 +1648,6 @@ _map_gl_input_buffer (GstGLContext * context, struct map_gl_input *data)
       g_assert_not_reached ();
     }
 
-    cuda_ret =
-        cudaGraphicsUnregisterResource (data->in_gl_resource->cuda_texture);
-    if (cuda_ret != cudaSuccess) {
-      GST_ERROR_OBJECT (data->nvenc, "failed to unregister GL texture %u from "
-          "cuda ret :%d", gl_mem->mem.tex_id, cuda_ret);
-      g_assert_not_reached ();
-    }
-
     data_pointer =
         data_pointer +
         data->in_gl_resource->cuda_stride *
@@ -1561,6 +1657,25 @@ _map_gl_input_buffer (GstGLContext * context, struct map_gl_input *data)
 }
 #endif
 
+/* copies @height lines of @width bytes, in one go if the strides match */
+static void
+_copy_plane (guint8 * dest, guint dest_stride, const guint8 * src,
+    guint src_stride, guint width, guint height)
+{
+  guint y;
+
+  if (dest_stride == src_stride) {
+    memcpy (dest, src, (gsize) dest_stride * (height - 1) + width);
+    return;
+  }
+
+  for (y = 0; y < height; ++y) {
+    memcpy (dest, src, width);
+    dest += dest_stride;
+    src += src_stride;
+  }
+}
+
 static GstFlowReturn
 _acquire_input_buffer (GstNvBaseEnc * nvenc, gpointer * input)
 {
@@ -1636,7 +1751,9 @@ _submit_input_buffer (GstNvBaseEnc * nvenc, GstVideoCodecFrame * frame,
     return GST_FLOW_ERROR;
   }
 
-  g_async_queue_push (nvenc->bitstream_queue, outputBufferPtr);
+  /* the bitstream thread owns this reference */
+  g_async_queue_push (nvenc->bitstream_queue,
+      gst_video_codec_frame_ref (frame));
 
   return GST_FLOW_OK;
 }
@@ -1748,7 +1865,6 @@ gst_nv_base_enc_handle_frame (GstVideoEncoder * enc, GstVideoCodecFrame * frame)
     guint8 *src, *dest;
     guint src_stride, dest_stride;
     guint height, width;
-    guint y;
 
     GST_LOG_OBJECT (enc, "got input buffer %p", in_buf);
 
@@ -1771,11 +1887,7 @@ gst_nv_base_enc_handle_frame (GstVideoEncoder * enc, GstVideoCodecFrame * frame)
     src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 0);
     dest = in_buf_lock.bufferDataPtr;
     dest_stride = in_buf_lock.pitch;
-    for (y = 0; y < height; ++y) {
-      memcpy (dest, src, width);
-      dest += dest_stride;
-      src += src_stride;
-    }
+    _copy_plane (dest, dest_stride, src, src_stride, width, height);
 
     if (GST_VIDEO_FRAME_FORMAT (&vframe) == GST_VIDEO_FORMAT_NV12) {
       /* copy UV plane */
@@ -1785,11 +1897,8 @@ gst_nv_base_enc_handle_frame (GstVideoEncoder * enc, GstVideoCodecFrame * frame)
           (guint8 *) in_buf_lock.bufferDataPtr +
           GST_ROUND_UP_32 (height) * in_buf_lock.pitch;
       dest_stride = in_buf_lock.pitch;
-      for (y = 0; y < GST_ROUND_UP_2 (height) / 2; ++y) {
-        memcpy (dest, src, width);
-        dest += dest_stride;
-        src += src_stride;
-      }
+      _copy_plane (dest, dest_stride, src, src_stride, width,
+          GST_ROUND_UP_2 (height) / 2);
     } else if (GST_VIDEO_FRAME_FORMAT (&vframe) == GST_VIDEO_FORMAT_I420) {
       guint8 *dest_u, *dest_v;
 
@@ -1802,22 +1911,14 @@ gst_nv_base_enc_handle_frame (GstVideoEncoder * enc, GstVideoCodecFrame * frame)
       /* copy U plane */
       src = GST_VIDEO_FRAME_PLANE_DATA (&vframe, 1);
       src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 1);
-      dest = dest_u;
-      for (y = 0; y < GST_ROUND_UP_2 (height) / 2; ++y) {
-        memcpy (dest, src, width / 2);
-        dest += dest_stride;
-        src += src_stride;
-      }
+      _copy_plane (dest_u, dest_stride, src, src_stride, width / 2,
+          GST_ROUND_UP_2 (height) / 2);
 
       /* copy V plane */
       src = GST_VIDEO_FRAME_PLANE_DATA (&vframe, 2);
       src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (&vframe, 2);
-      dest = dest_v;
-      for (y = 0; y < GST_ROUND_UP_2 (height) / 2; ++y) {
-        memcpy (dest, src, width / 2);
-        dest += dest_stride;
-        src += src_stride;
-      }
+      _copy_plane (dest_v, dest_stride, src, src_stride, width / 2,
+          GST_ROUND_UP_2 (height) / 2);
     } else {
       // FIXME: this only works for NV12 and I420
       g_assert_not_reached ();
@@ -1965,6 +2066,9 @@ gst_nv_base_enc_set_property (GObject * object, guint prop_id,
       nvenc->gop_size = g_value_get_int (value);
       gst_nv_base_enc_schedule_reconfig (nvenc);
       break;
+    case PROP_MAX_IN_FLIGHT:
+      nvenc->max_in_flight = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2002,6 +2106,9 @@ gst_nv_base_enc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_GOP_SIZE:
       g_value_set_int (value, nvenc->gop_size);
       break;
+    case PROP_MAX_IN_FLIGHT:
+      g_value_set_uint (value, nvenc->max_in_flight);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -70,6 +70,7 @@ typedef struct {
   gint            qp_const;
   guint           bitrate;
   gint            gop_size;
+  guint           max_in_flight;
 
   CUcontext       cuda_ctx;
   void          * encoder;
@@ -104,6 +105,9 @@ typedef struct {
 
   void           *display;            /* GstGLDisplay */
   void           *other_context;      /* GstGLContext */
+  /* GstGLMemoryPBO -> buffer object registered with CUDA, only accessed
+   * from the GL thread */
+  GHashTable     *gl_resources;
 
   /* the maximum buffer size the encoder is configured for */
   guint               max_encode_width;
@@ -39,8 +39,10 @@
 #include "gstshmsink.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
+#include <errno.h>
 
 /* signals */
 enum
@@ -58,17 +60,28 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_SLAB_SIZE,
+  PROP_STATS,
+  PROP_RING_SIZE,
+  PROP_FD_PASSING,
+  PROP_HUGE_PAGES
 };
 
 struct GstShmClient
 {
   ShmClient *client;
   GstPollFD pollfd;
+  /* buffers released through the ring, if the client has one */
+  GstPollFD ringpollfd;
 };
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_SLAB_SIZE (0)
+#define DEFAULT_RING_SIZE (0)
+#define DEFAULT_FD_PASSING (FALSE)
+#define DEFAULT_HUGE_PAGES (FALSE)
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -101,6 +114,8 @@ static gboolean gst_shm_sink_propose_allocation (GstBaseSink * sink,
     GstQuery * query);
 
 static gpointer pollthread_func (gpointer data);
+static GstStructure *gst_shm_sink_get_stats (GstShmSink * self);
+static void gst_shm_sink_set_huge_pages (GstShmSink * self);
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
@@ -354,6 +369,10 @@ gst_shm_sink_init (GstShmSink * self)
   self->size = DEFAULT_SIZE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->slab_size = DEFAULT_SLAB_SIZE;
+  self->ring_size = DEFAULT_RING_SIZE;
+  self->fd_passing = DEFAULT_FD_PASSING;
+  self->huge_pages = DEFAULT_HUGE_PAGES;
 
   gst_allocation_params_init (&self->params);
 }
@@ -416,6 +435,90 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSink:slab-size:
+   *
+   * Cut the shared memory area in slots of this many bytes. Buffers are
+   * then allocated and freed in constant time and the area cannot
+   * fragment, which suits streams of equally sized buffers such as raw
+   * video. Buffers larger than a slot are refused.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_SLAB_SIZE,
+      g_param_spec_uint ("slab-size",
+          "Slab size",
+          "Size of the fixed slots the shm area is cut in (0 = disabled)",
+          0, G_MAXUINT, DEFAULT_SLAB_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSink:stats:
+   *
+   * Usage and fragmentation of the current shared memory area: the bytes
+   * in use, the bytes lost to slot rounding, the number of blocks and free
+   * holes, the largest free block and the number of failed allocations.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Usage and fragmentation statistics of the shm area",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSink:ring-size:
+   *
+   * Number of buffer descriptors in the shared memory ring given to the
+   * shmsrc that ask for one with #GstShmSrc:use-ring. Buffers and their
+   * releases then go through the ring, with an eventfd wakeup only when
+   * the other side is sleeping, and the socket is only used for control.
+   * A reader that falls this many buffers behind misses the next ones.
+   * This is only supported on Linux, 0 refuses the requests.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size",
+          "Ring size",
+          "Number of entries in the shared memory ring offered to readers, "
+          "rounded up to a power of two (0 = announce buffers on the socket)",
+          0, 4096, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSink:fd-passing:
+   *
+   * Send buffers backed by a single dmabuf or memfd memory by passing their
+   * file descriptor over the control socket instead of copying them into
+   * the shared memory area, when all the connected shmsrc have
+   * #GstShmSrc:fd-passing enabled. The readers then import them without a
+   * copy, which keeps hardware decoder to compositor pipelines zero-copy.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing",
+          "File descriptor passing",
+          "Pass dmabuf and memfd buffers to the readers as file descriptors",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSink:huge-pages:
+   *
+   * Ask for the shared memory area to be backed by transparent huge pages,
+   * which reduces the page faults and TLB misses for large raw frames. This
+   * needs the shmem_enabled setting of the kernel to be "advise" or
+   * "always", and #GstShmSink:shm-size should be a multiple of 2 MiB.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_HUGE_PAGES,
+      g_param_spec_boolean ("huge-pages",
+          "Huge pages",
+          "Back the shared memory area with transparent huge pages",
+          DEFAULT_HUGE_PAGES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -504,6 +607,34 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_SLAB_SIZE:
+      GST_OBJECT_LOCK (object);
+      self->slab_size = g_value_get_uint (value);
+      if (self->pipe && sp_writer_set_slab_size (self->pipe,
+              self->slab_size) < 0)
+        GST_WARNING_OBJECT (self, "Could not change the slab size while "
+            "buffers are allocated, keeping the previous one");
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_RING_SIZE:
+      GST_OBJECT_LOCK (object);
+      self->ring_size = g_value_get_uint (value);
+      if (self->pipe)
+        sp_writer_set_ring_size (self->pipe, self->ring_size);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_FD_PASSING:
+      GST_OBJECT_LOCK (object);
+      self->fd_passing = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_HUGE_PAGES:
+      GST_OBJECT_LOCK (object);
+      self->huge_pages = g_value_get_boolean (value);
+      if (self->pipe)
+        gst_shm_sink_set_huge_pages (self);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -533,6 +664,21 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_SLAB_SIZE:
+      g_value_set_uint (value, self->slab_size);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_shm_sink_get_stats (self));
+      break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, self->fd_passing);
+      break;
+    case PROP_HUGE_PAGES:
+      g_value_set_boolean (value, self->huge_pages);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -543,6 +689,39 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
 
 
 
+static void
+gst_shm_sink_set_huge_pages (GstShmSink * self)
+{
+  if (sp_writer_set_huge_pages (self->pipe, self->huge_pages) < 0) {
+    GST_WARNING_OBJECT (self, "Could not use huge pages: %s",
+        g_strerror (errno));
+  } else if (self->huge_pages &&
+      self->size % sp_writer_get_huge_page_size () != 0) {
+    GST_INFO_OBJECT (self, "Shared memory area of %u bytes is not a "
+        "multiple of the huge page size, its end uses normal pages",
+        self->size);
+  }
+}
+
+static GstStructure *
+gst_shm_sink_get_stats (GstShmSink * self)
+{
+  ShmAllocStats stats = { 0 };
+
+  if (self->pipe)
+    sp_writer_get_alloc_stats (self->pipe, &stats);
+
+  return gst_structure_new ("application/x-shm-sink-stats",
+      "size", G_TYPE_UINT64, (guint64) stats.size,
+      "slab-size", G_TYPE_UINT64, (guint64) stats.slab_size,
+      "used", G_TYPE_UINT64, (guint64) stats.used,
+      "wasted", G_TYPE_UINT64, (guint64) stats.wasted,
+      "largest-free", G_TYPE_UINT64, (guint64) stats.largest_free,
+      "blocks", G_TYPE_UINT64, (guint64) stats.blocks,
+      "holes", G_TYPE_UINT64, (guint64) stats.holes,
+      "failed", G_TYPE_UINT64, (guint64) stats.failed, NULL);
+}
+
 static gboolean
 gst_shm_sink_start (GstBaseSink * bsink)
 {
@@ -569,6 +748,14 @@ gst_shm_sink_start (GstBaseSink * bsink)
   }
 
   sp_set_data (self->pipe, self);
+  sp_writer_set_ring_size (self->pipe, self->ring_size);
+  if (self->huge_pages)
+    gst_shm_sink_set_huge_pages (self);
+
+  if (self->slab_size && sp_writer_set_slab_size (self->pipe,
+          self->slab_size) < 0)
+    GST_WARNING_OBJECT (self, "Slab size of %u bytes is larger than the "
+        "shared memory area, using first-fit allocation", self->slab_size);
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
 
@@ -607,6 +794,7 @@ static gboolean
 gst_shm_sink_stop (GstBaseSink * bsink)
 {
   GstShmSink *self = GST_SHM_SINK (bsink);
+  GstStructure *stats;
 
   self->stop = TRUE;
   gst_poll_set_flushing (self->poll, TRUE);
@@ -620,6 +808,10 @@ gst_shm_sink_stop (GstBaseSink * bsink)
 
   GST_DEBUG_OBJECT (self, "Stopping");
 
+  stats = gst_shm_sink_get_stats (self);
+  GST_DEBUG_OBJECT (self, "Allocation stats: %" GST_PTR_FORMAT, stats);
+  gst_structure_free (stats);
+
   while (self->clients) {
     struct GstShmClient *client = self->clients->data;
     self->clients = g_list_remove (self->clients, client);
@@ -695,6 +887,28 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   }
 
 
+  if (self->fd_passing && gst_buffer_n_memory (buf) == 1 &&
+      gst_is_fd_memory (gst_buffer_peek_memory (buf, 0)) &&
+      sp_writer_clients_accept_fds (self->pipe)) {
+    gsize offset;
+
+    memory = gst_buffer_peek_memory (buf, 0);
+    gst_memory_get_sizes (memory, &offset, NULL);
+
+    GST_LOG_OBJECT (self, "Passing the fd of buffer %p", buf);
+    rv = sp_writer_send_fd_buf (self->pipe, gst_fd_memory_get_fd (memory),
+        gst_is_dmabuf_memory (memory), offset, gst_memory_get_size (memory),
+        gst_buffer_ref (buf));
+    GST_OBJECT_UNLOCK (self);
+
+    if (rv == 0) {
+      GST_DEBUG_OBJECT (self, "No clients connected, unreffing buffer");
+      gst_buffer_unref (buf);
+    }
+
+    return GST_FLOW_OK;
+  }
+
   if (gst_buffer_n_memory (buf) > 1) {
     GST_LOG_OBJECT (self, "Buffer %p has %d GstMemory, we only support a single"
         " one, need to do a memcpy", buf, gst_buffer_n_memory (buf));
@@ -875,6 +1089,7 @@ pollthread_func (gpointer data)
       gclient->pollfd.fd = sp_writer_get_client_fd (client);
       gst_poll_add_fd (self->poll, &gclient->pollfd);
       gst_poll_fd_ctl_read (self->poll, &gclient->pollfd, TRUE);
+      gst_poll_fd_init (&gclient->ringpollfd);
       self->clients = g_list_prepend (self->clients, gclient);
       g_signal_emit (self, signals[SIGNAL_CLIENT_CONNECTED], 0,
           gclient->pollfd.fd);
@@ -918,6 +1133,36 @@ pollthread_func (gpointer data)
 
         if (rv == 0)
           gst_buffer_unref (tag);
+
+        if (gclient->ringpollfd.fd < 0 &&
+            sp_writer_get_client_ring_fd (gclient->client) >= 0) {
+          GST_DEBUG_OBJECT (self, "Client %d switched to a ring",
+              gclient->pollfd.fd);
+          gclient->ringpollfd.fd =
+              sp_writer_get_client_ring_fd (gclient->client);
+          gst_poll_add_fd (self->poll, &gclient->ringpollfd);
+          gst_poll_fd_ctl_read (self->poll, &gclient->ringpollfd, TRUE);
+          /* _wait has to see the new fd before it can be checked */
+          timeout = 0;
+        }
+      }
+
+      if (gclient->ringpollfd.fd >= 0 &&
+          gst_poll_fd_can_read (self->poll, &gclient->ringpollfd)) {
+        GSList *list = NULL;
+        int rv;
+
+        GST_OBJECT_LOCK (self);
+        rv = sp_writer_recv_ring (self->pipe, gclient->client,
+            (sp_buffer_free_callback) free_buffer_locked, (void **) &list);
+        GST_OBJECT_UNLOCK (self);
+        g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+
+        if (rv < 0) {
+          GST_WARNING_OBJECT (self, "One client has sent an invalid release,"
+              " closing (retval: %d)", rv);
+          goto close_client;
+        }
       }
       continue;
     close_client:
@@ -931,6 +1176,8 @@ pollthread_func (gpointer data)
       }
 
       gst_poll_remove_fd (self->poll, &gclient->pollfd);
+      if (gclient->ringpollfd.fd >= 0)
+        gst_poll_remove_fd (self->poll, &gclient->ringpollfd);
       self->clients = g_list_remove (self->clients, gclient);
 
       g_signal_emit (self, signals[SIGNAL_CLIENT_DISCONNECTED], 0,
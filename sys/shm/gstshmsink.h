@@ -52,6 +52,10 @@ struct _GstShmSink
 
   guint perms;
   guint size;
+  guint slab_size;
+  guint ring_size;
+  gboolean fd_passing;
+  gboolean huge_pages;
 
   GList *clients;
 
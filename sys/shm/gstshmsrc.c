@@ -41,8 +41,11 @@
 #include "gstshmsrc.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 
 /* signals */
 enum
@@ -56,15 +59,28 @@ enum
   PROP_0,
   PROP_SOCKET_PATH,
   PROP_IS_LIVE,
-  PROP_SHM_AREA_NAME
+  PROP_SHM_AREA_NAME,
+  PROP_USE_RING,
+  PROP_FD_PASSING
 };
 
+#define DEFAULT_USE_RING FALSE
+#define DEFAULT_FD_PASSING FALSE
+
 struct GstShmBuffer
 {
   char *buf;
   GstShmPipe *pipe;
 };
 
+struct GstShmFdBuffer
+{
+  int id;
+  GstShmPipe *pipe;
+};
+
+static GQuark fd_buffer_quark;
+
 
 GST_DEBUG_CATEGORY_STATIC (shmsrc_debug);
 #define GST_CAT_DEFAULT shmsrc_debug
@@ -139,6 +155,37 @@ gst_shm_src_class_init (GstShmSrcClass * klass)
           "The name of the shared memory area used to get buffers",
           NULL, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSrc:use-ring:
+   *
+   * Ask the shmsink for a shared memory ring of buffer descriptors when
+   * connecting. If the sink has a #GstShmSink:ring-size, buffers are then
+   * received from the ring and only wake this element up when it was
+   * waiting for them, otherwise the socket keeps being used.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_USE_RING,
+      g_param_spec_boolean ("use-ring", "Use ring",
+          "Receive buffers through a shared memory ring if the sink offers one",
+          DEFAULT_USE_RING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSrc:fd-passing:
+   *
+   * Tell the shmsink that buffers can be passed as dmabuf or memfd file
+   * descriptors, see #GstShmSink:fd-passing. They are imported as
+   * #GstDmaBufMemory or fd memory without any copy.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing", "File descriptor passing",
+          "Accept buffers passed as dmabuf or memfd file descriptors",
+          DEFAULT_FD_PASSING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  fd_buffer_quark = g_quark_from_static_string ("GstShmSrcFdBuffer");
+
   gst_element_class_add_static_pad_template (gstelement_class, &srctemplate);
 
   gst_element_class_set_static_metadata (gstelement_class,
@@ -155,6 +202,11 @@ gst_shm_src_init (GstShmSrc * self)
 {
   self->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&self->pollfd);
+  gst_poll_fd_init (&self->ringpollfd);
+  self->use_ring = DEFAULT_USE_RING;
+  self->fd_passing = DEFAULT_FD_PASSING;
+  self->dmabuf_allocator = gst_dmabuf_allocator_new ();
+  self->fd_allocator = gst_fd_allocator_new ();
 }
 
 static void
@@ -164,6 +216,8 @@ gst_shm_src_finalize (GObject * object)
 
   gst_poll_free (self->poll);
   g_free (self->socket_path);
+  gst_object_unref (self->dmabuf_allocator);
+  gst_object_unref (self->fd_allocator);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -191,6 +245,16 @@ gst_shm_src_set_property (GObject * object, guint prop_id,
       gst_base_src_set_live (GST_BASE_SRC (object),
           g_value_get_boolean (value));
       break;
+    case PROP_USE_RING:
+      GST_OBJECT_LOCK (object);
+      self->use_ring = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_FD_PASSING:
+      GST_OBJECT_LOCK (object);
+      self->fd_passing = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -218,6 +282,16 @@ gst_shm_src_get_property (GObject * object, guint prop_id,
         g_value_set_string (value, sp_get_shm_area_name (self->pipe->pipe));
       GST_OBJECT_UNLOCK (object);
       break;
+    case PROP_USE_RING:
+      GST_OBJECT_LOCK (object);
+      g_value_set_boolean (value, self->use_ring);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_FD_PASSING:
+      GST_OBJECT_LOCK (object);
+      g_value_set_boolean (value, self->fd_passing);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -243,6 +317,12 @@ gst_shm_src_start_reading (GstShmSrc * self)
 
   GST_OBJECT_LOCK (self);
   gstpipe->pipe = sp_client_open (self->socket_path);
+  if (gstpipe->pipe && self->use_ring &&
+      !sp_client_request_ring (gstpipe->pipe))
+    GST_WARNING_OBJECT (self, "Could not ask for a ring, using the socket");
+  if (gstpipe->pipe && self->fd_passing &&
+      !sp_client_set_features (gstpipe->pipe, SP_CLIENT_FEATURE_FDS))
+    GST_WARNING_OBJECT (self, "Could not enable fd passing");
   GST_OBJECT_UNLOCK (self);
 
   if (!gstpipe->pipe) {
@@ -275,9 +355,12 @@ gst_shm_src_stop_reading (GstShmSrc * self)
     self->pipe = NULL;
 
     gst_poll_remove_fd (self->poll, &self->pollfd);
+    if (self->ringpollfd.fd >= 0)
+      gst_poll_remove_fd (self->poll, &self->ringpollfd);
   }
 
   gst_poll_fd_init (&self->pollfd);
+  gst_poll_fd_init (&self->ringpollfd);
   gst_poll_set_flushing (self->poll, TRUE);
 }
 
@@ -318,6 +401,77 @@ free_buffer (gpointer data)
   g_slice_free (struct GstShmBuffer, gsb);
 }
 
+static void
+free_fd_buffer (gpointer data)
+{
+  struct GstShmFdBuffer *gsb = data;
+
+  GST_LOG ("Freeing fd buffer %d", gsb->id);
+
+  GST_OBJECT_LOCK (gsb->pipe->src);
+  sp_client_recv_fd_finish (gsb->pipe->pipe, gsb->id);
+  GST_OBJECT_UNLOCK (gsb->pipe->src);
+
+  gst_shm_pipe_dec (gsb->pipe);
+
+  g_slice_free (struct GstShmFdBuffer, gsb);
+}
+
+/* Wraps the next buffer passed as a file descriptor, if any */
+static GstBuffer *
+gst_shm_src_pop_fd_buffer (GstShmSrc * self)
+{
+  struct GstShmFdBuffer *gsb;
+  GstMemory *mem;
+  GstBuffer *buffer;
+  unsigned long offset, size;
+  int fd, is_dmabuf, id, ret;
+  off_t total;
+
+  GST_OBJECT_LOCK (self);
+  ret = sp_client_pop_fd_buffer (self->pipe->pipe, &fd, &is_dmabuf, &offset,
+      &size, &id);
+  GST_OBJECT_UNLOCK (self);
+
+  if (!ret)
+    return NULL;
+
+  gsb = g_slice_new0 (struct GstShmFdBuffer);
+  gsb->id = id;
+  gsb->pipe = self->pipe;
+  gst_shm_pipe_inc (self->pipe);
+
+  total = lseek (fd, 0, SEEK_END);
+  if (total < 0 || offset > total || size > total - offset) {
+    GST_WARNING_OBJECT (self, "Invalid fd buffer of %lu bytes at %lu, fd "
+        "size is %" G_GINT64_FORMAT, size, offset, (gint64) total);
+    close (fd);
+    free_fd_buffer (gsb);
+    return NULL;
+  }
+
+  GST_LOG_OBJECT (self, "Got %s buffer %d of size %lu",
+      is_dmabuf ? "dmabuf" : "memfd", id, size);
+
+  if (is_dmabuf)
+    mem = gst_dmabuf_allocator_alloc (self->dmabuf_allocator, fd, total);
+  else
+    mem = gst_fd_allocator_alloc (self->fd_allocator, fd, total,
+        GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize (mem, offset, size);
+  /* the writer may still be using it */
+  GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+
+  /* acks the buffer once the memory and all of its shares are gone */
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem), fd_buffer_quark,
+      gsb, free_fd_buffer);
+
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, mem);
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
@@ -327,6 +481,26 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   struct GstShmBuffer *gsb;
 
   do {
+    if ((*outbuf = gst_shm_src_pop_fd_buffer (self)))
+      return GST_FLOW_OK;
+
+    if (self->ringpollfd.fd >= 0) {
+      buf = NULL;
+      GST_OBJECT_LOCK (self);
+      rv = sp_client_recv_ring (self->pipe->pipe, &buf);
+      GST_OBJECT_UNLOCK (self);
+      if (rv < 0) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+            ("Error reading from the ring: %d", rv));
+        return GST_FLOW_ERROR;
+      }
+      if (buf)
+        break;
+      /* fd buffers are returned first, the ring is checked again after */
+      if (self->fd_passing && (*outbuf = gst_shm_src_pop_fd_buffer (self)))
+        return GST_FLOW_OK;
+    }
+
     if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
       if (errno == EBUSY)
         return GST_FLOW_FLUSHING;
@@ -361,6 +535,17 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
             ("Error reading control data: %d", rv));
         return GST_FLOW_ERROR;
       }
+
+      if (self->ringpollfd.fd < 0 && sp_client_get_ring_fd (self->pipe->pipe)
+          >= 0) {
+        GST_DEBUG_OBJECT (self, "Receiving buffers through a ring");
+        /* the socket is now only read when the ring says so, but it is
+         * still polled for errors */
+        self->ringpollfd.fd = sp_client_get_ring_fd (self->pipe->pipe);
+        gst_poll_add_fd (self->poll, &self->ringpollfd);
+        gst_poll_fd_ctl_read (self->poll, &self->ringpollfd, TRUE);
+        gst_poll_fd_ctl_read (self->poll, &self->pollfd, FALSE);
+      }
     }
   } while (buf == NULL);
 
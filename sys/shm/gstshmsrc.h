@@ -52,6 +52,13 @@ struct _GstShmSrc
   GstShmPipe *pipe;
   GstPoll *poll;
   GstPollFD pollfd;
+  GstPollFD ringpollfd;
+
+  gboolean use_ring;
+  gboolean fd_passing;
+
+  GstAllocator *dmabuf_allocator;
+  GstAllocator *fd_allocator;
 
 
   GstFlowReturn flow_return;
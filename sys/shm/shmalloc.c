@@ -41,6 +41,18 @@ struct _ShmAllocSpace
 
   /* chained list of the blocks contained in this space */
   ShmAllocBlock *blocks;
+
+  /* In slab mode, the space is cut in slots of slab_size bytes. The blocks
+   * of all the slots are allocated upfront and the unused ones are chained
+   * in free_slabs, so allocating and freeing a block are O(1) */
+  unsigned long slab_size;
+  unsigned long n_slabs;
+  unsigned long n_used_slabs;
+  ShmAllocBlock *slabs;
+  ShmAllocBlock *free_slabs;
+
+  /* Number of allocations that did not find enough space */
+  unsigned long failed;
 };
 
 /* A single block of data */
@@ -58,6 +70,8 @@ struct _ShmAllocBlock
 
   /* Pointer to the next block in the chain */
   ShmAllocBlock *next;
+  /* Pointer to the previous block in the chain, unused in slab mode */
+  ShmAllocBlock *prev;
 };
 
 
@@ -76,10 +90,76 @@ shm_alloc_space_new (size_t size)
 void
 shm_alloc_space_free (ShmAllocSpace * self)
 {
-  assert (self && self->blocks == NULL);
+  assert (self && self->blocks == NULL && self->n_used_slabs == 0);
+  if (self->slabs)
+    spalloc_free1 (sizeof (ShmAllocBlock) * self->n_slabs, self->slabs);
   spalloc_free (ShmAllocSpace, self);
 }
 
+/* Switches the space to fixed size slots of slab_size bytes, or back to
+ * first-fit allocation if slab_size is 0. This can only be done while no
+ * block is allocated. */
+int
+shm_alloc_space_set_slab_size (ShmAllocSpace * self, unsigned long slab_size)
+{
+  unsigned long i;
+
+  if (self->blocks || self->n_used_slabs || slab_size > self->size)
+    return -1;
+
+  if (self->slabs)
+    spalloc_free1 (sizeof (ShmAllocBlock) * self->n_slabs, self->slabs);
+  self->slabs = NULL;
+  self->free_slabs = NULL;
+  self->n_slabs = 0;
+  self->slab_size = slab_size;
+
+  if (slab_size == 0)
+    return 0;
+
+  self->n_slabs = self->size / slab_size;
+  self->slabs = spalloc_alloc (sizeof (ShmAllocBlock) * self->n_slabs);
+  memset (self->slabs, 0, sizeof (ShmAllocBlock) * self->n_slabs);
+
+  /* chain them backwards so that the first slots are used first */
+  for (i = self->n_slabs; i > 0; i--) {
+    ShmAllocBlock *block = &self->slabs[i - 1];
+
+    block->space = self;
+    block->offset = (i - 1) * slab_size;
+    block->next = self->free_slabs;
+    self->free_slabs = block;
+  }
+
+  return 0;
+}
+
+unsigned long
+shm_alloc_space_get_max_block_size (ShmAllocSpace * self)
+{
+  return self->slab_size ? self->slab_size : self->size;
+}
+
+static ShmAllocBlock *
+shm_alloc_space_alloc_slab (ShmAllocSpace * self, unsigned long size)
+{
+  ShmAllocBlock *block = self->free_slabs;
+
+  if (!block || size > self->slab_size) {
+    self->failed++;
+    return NULL;
+  }
+
+  self->free_slabs = block->next;
+  self->n_used_slabs++;
+
+  block->next = NULL;
+  block->size = size;
+  block->use_count = 1;
+
+  return block;
+}
+
 
 ShmAllocBlock *
 shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
@@ -89,6 +169,8 @@ shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
   ShmAllocBlock *prev_item = NULL;
   unsigned long prev_end_offset = 0;
 
+  if (self->slab_size)
+    return shm_alloc_space_alloc_slab (self, size);
 
   for (item = self->blocks; item; item = item->next) {
     unsigned long max_size = 0;
@@ -105,8 +187,10 @@ shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
   /* Return NULL if there is no big enough space, otherwise, there is space
    * at the end */
   assert (prev_end_offset <= self->size);
-  if (!item && self->size - prev_end_offset < size)
+  if (!item && self->size - prev_end_offset < size) {
+    self->failed++;
     return NULL;
+  }
 
   block = spalloc_new (ShmAllocBlock);
   memset (block, 0, sizeof (ShmAllocBlock));
@@ -121,6 +205,9 @@ shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
     self->blocks = block;
 
   block->next = item;
+  block->prev = prev_item;
+  if (item)
+    item->prev = block;
 
   return block;
 }
@@ -134,21 +221,22 @@ shm_alloc_space_alloc_block_get_offset (ShmAllocBlock * block)
 static void
 shm_alloc_space_free_block (ShmAllocBlock * block)
 {
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
   ShmAllocSpace *self = block->space;
 
-  for (item = self->blocks; item; item = item->next) {
-    if (item == block) {
-      if (prev_item)
-        prev_item->next = item->next;
-      else
-        self->blocks = item->next;
-      break;
-    }
-    prev_item = item;
+  if (self->slab_size) {
+    block->next = self->free_slabs;
+    self->free_slabs = block;
+    self->n_used_slabs--;
+    return;
   }
 
+  if (block->prev)
+    block->prev->next = block->next;
+  else
+    self->blocks = block->next;
+  if (block->next)
+    block->next->prev = block->prev;
+
   spalloc_free (ShmAllocBlock, block);
 }
 
@@ -157,6 +245,19 @@ shm_alloc_space_block_get (ShmAllocSpace * self, unsigned long offset)
 {
   ShmAllocBlock *block = NULL;
 
+  if (self->slab_size) {
+    unsigned long i = offset / self->slab_size;
+
+    if (i >= self->n_slabs)
+      return NULL;
+
+    block = &self->slabs[i];
+    if (block->use_count > 0 && (block->offset + block->size) > offset)
+      return block;
+
+    return NULL;
+  }
+
   for (block = self->blocks; block; block = block->next) {
     if (block->offset <= offset && (block->offset + block->size) > offset)
       return block;
@@ -180,3 +281,51 @@ shm_alloc_space_block_dec (ShmAllocBlock * block)
   if (block->use_count <= 0)
     shm_alloc_space_free_block (block);
 }
+
+void
+shm_alloc_space_get_stats (ShmAllocSpace * self, ShmAllocStats * stats)
+{
+  ShmAllocBlock *item;
+  unsigned long prev_end_offset = 0;
+  unsigned long i;
+
+  memset (stats, 0, sizeof (ShmAllocStats));
+  stats->size = self->size;
+  stats->slab_size = self->slab_size;
+  stats->failed = self->failed;
+
+  if (self->slab_size) {
+    for (i = 0; i < self->n_slabs; i++) {
+      item = &self->slabs[i];
+      if (item->use_count > 0) {
+        stats->used += item->size;
+        stats->wasted += self->slab_size - item->size;
+        stats->blocks++;
+      } else {
+        stats->holes++;
+      }
+    }
+    if (stats->holes)
+      stats->largest_free = self->slab_size;
+    return;
+  }
+
+  for (item = self->blocks; item; item = item->next) {
+    unsigned long hole = item->offset - prev_end_offset;
+
+    if (hole) {
+      stats->holes++;
+      if (hole > stats->largest_free)
+        stats->largest_free = hole;
+    }
+    stats->used += item->size;
+    stats->blocks++;
+    prev_end_offset = item->offset + item->size;
+  }
+
+  if (self->size > prev_end_offset) {
+    stats->holes++;
+    if (self->size - prev_end_offset > stats->largest_free)
+      stats->largest_free = self->size - prev_end_offset;
+  }
+}
@@ -52,10 +52,32 @@ extern "C" {
 
 typedef struct _ShmAllocSpace ShmAllocSpace;
 typedef struct _ShmAllocBlock ShmAllocBlock;
+typedef struct _ShmAllocStats ShmAllocStats;
+
+/* Snapshot of the usage of an alloc space. In slab mode, holes counts the
+ * free slots and wasted the unused tail of the allocated slots. */
+struct _ShmAllocStats
+{
+  unsigned long size;
+  unsigned long slab_size;
+
+  unsigned long used;
+  unsigned long wasted;
+  unsigned long largest_free;
+
+  unsigned long blocks;
+  unsigned long holes;
+  unsigned long failed;
+};
 
 ShmAllocSpace *shm_alloc_space_new (size_t size);
 void shm_alloc_space_free (ShmAllocSpace * self);
 
+int shm_alloc_space_set_slab_size (ShmAllocSpace * self,
+    unsigned long slab_size);
+unsigned long shm_alloc_space_get_max_block_size (ShmAllocSpace * self);
+void shm_alloc_space_get_stats (ShmAllocSpace * self, ShmAllocStats * stats);
+
 
 ShmAllocBlock *shm_alloc_space_alloc_block (ShmAllocSpace * self,
     unsigned long size);
@@ -48,6 +48,7 @@
 #include <assert.h>
 
 #include "shmalloc.h"
+#include "shmring.h"
 
 /*
  * The protocol over the pipe is in packets
@@ -67,22 +68,56 @@
  * type 4: ack buffer
  * offset
  *
- * Type 4 goes from the client to the server
+ * type 5: ring request
+ * No payload
+ *
+ * type 6: new ring
+ * Number of entries (0 if refused)
+ * The ring shm, buffer eventfd and release eventfd are passed with
+ * SCM_RIGHTS
+ *
+ * type 7: client features
+ * Flags, SP_CLIENT_FEATURE_FDS if the client accepts types 8 and 9
+ *
+ * type 8 and 9: new dmabuf or memfd buffer
+ * offset
+ * bufsize
+ * The area id is the buffer id, the fd is passed with SCM_RIGHTS
+ *
+ * type 10: ack fd buffer
+ * The area id is the buffer id
+ *
+ * Types 4, 5, 7 and 10 go from the client to the server
  * The rest are from the server to the client
  * The client should never write in the SHM
+ *
+ * Once a client has a ring, the buffers and their acks go through it and
+ * the socket is only read by the client when the ring contains a
+ * SHM_RING_ENTRY_COMMANDS entry, which keeps area changes ordered with the
+ * buffers.
  */
 
 
 #define LISTEN_BACKLOG 10
 
+#define MAX_PASSED_FDS 4
+
 enum
 {
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_RING_REQUEST = 5,
+  COMMAND_NEW_RING = 6,
+  COMMAND_CLIENT_FEATURES = 7,
+  COMMAND_NEW_DMABUF = 8,
+  COMMAND_NEW_MEMFD = 9,
+  COMMAND_ACK_FD_BUFFER = 10
 };
 
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 typedef struct _ShmArea ShmArea;
 
 struct _ShmArea
@@ -108,9 +143,11 @@ struct _ShmBuffer
 {
   int use_count;
 
+  /* NULL for buffers passed as file descriptors */
   ShmArea *shm_area;
   unsigned long offset;
   size_t size;
+  int fd_id;
 
   ShmAllocBlock *ablock;
 
@@ -141,15 +178,41 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  size_t slab_size;
+
+  /* Number of entries of the rings given to clients, 0 to refuse them */
+  unsigned int ring_size;
+  /* On the client side, the ring received from the writer */
+  ShmRing *ring;
+
+  int huge_pages;
+  int next_fd_id;
+  /* On the client side, the fd buffers not returned yet */
+  ShmFdBuffer *fd_buffers;
 };
 
 struct _ShmClient
 {
   int fd;
 
+  ShmRing *ring;
+  unsigned int features;
+
   ShmClient *next;
 };
 
+struct _ShmFdBuffer
+{
+  int fd;
+  int id;
+  int is_dmabuf;
+  unsigned long offset;
+  unsigned long size;
+
+  ShmFdBuffer *next;
+};
+
 struct _ShmBlock
 {
   ShmPipe *pipe;
@@ -179,10 +242,19 @@ struct CommandBuffer
     {
       unsigned long offset;
     } ack_buffer;
+    struct
+    {
+      unsigned int size;
+    } new_ring;
+    struct
+    {
+      unsigned int flags;
+    } client_features;
   } payload;
 };
 
 static ShmArea *sp_open_shm (char *path, int id, mode_t perms, size_t size);
+static int sp_shm_area_advise_huge_pages (ShmArea * area);
 static void sp_close_shm (ShmArea * area);
 static int sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf,
     ShmBuffer * prev_buf, ShmClient * client, void **tag);
@@ -365,6 +437,23 @@ sp_close_shm (ShmArea * area)
   spalloc_free (ShmArea, area);
 }
 
+/* Lets the kernel back the area with transparent huge pages, which needs
+ * shmem_enabled to be "advise" or "always". Only the 2 MiB aligned part of
+ * the area can use them. */
+static int
+sp_shm_area_advise_huge_pages (ShmArea * area)
+{
+#ifdef MADV_HUGEPAGE
+  if (madvise (area->shm_area_buf, area->shm_area_len, MADV_HUGEPAGE) < 0)
+    return -1;
+
+  return 0;
+#else
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
 static void
 sp_shm_area_inc (ShmArea * area)
 {
@@ -452,6 +541,18 @@ sp_writer_close (ShmPipe * self, sp_buffer_free_callback callback,
 void
 sp_client_close (ShmPipe * self)
 {
+  if (self->ring)
+    shm_ring_free (self->ring);
+  self->ring = NULL;
+
+  while (self->fd_buffers) {
+    ShmFdBuffer *fdbuf = self->fd_buffers;
+
+    self->fd_buffers = fdbuf->next;
+    close (fdbuf->fd);
+    spalloc_free (ShmFdBuffer, fdbuf);
+  }
+
   sp_writer_close (self, NULL, NULL);
 }
 
@@ -485,6 +586,54 @@ send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
   return 1;
 }
 
+static int
+send_command_fds (int fd, struct CommandBuffer *cb, unsigned short int type,
+    int area_id, const int *fds, int n_fds)
+{
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int) * MAX_PASSED_FDS)];
+    struct cmsghdr align;
+  } control;
+
+  assert (n_fds > 0 && n_fds <= MAX_PASSED_FDS);
+
+  cb->type = type;
+  cb->area_id = area_id;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&control, 0, sizeof (control));
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = CMSG_SPACE (sizeof (int) * n_fds);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int) * n_fds);
+  memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * n_fds);
+
+  if (sendmsg (fd, &msg, MSG_NOSIGNAL) != sizeof (struct CommandBuffer))
+    return 0;
+
+  return 1;
+}
+
+static void
+close_fds (int *fds, int n_fds)
+{
+  int i;
+
+  for (i = 0; i < n_fds; i++)
+    close (fds[i]);
+}
+
 int
 sp_writer_resize (ShmPipe * self, size_t size)
 {
@@ -502,6 +651,11 @@ sp_writer_resize (ShmPipe * self, size_t size)
   if (!newarea)
     return -1;
 
+  if (self->slab_size)
+    shm_alloc_space_set_slab_size (newarea->allocspace, self->slab_size);
+  if (self->huge_pages)
+    sp_shm_area_advise_huge_pages (newarea);
+
   old_current = self->shm_area;
   newarea->next = self->shm_area;
   self->shm_area = newarea;
@@ -523,6 +677,15 @@ sp_writer_resize (ShmPipe * self, size_t size)
     if (send (client->fd, newarea->shm_area_name, pathlen, MSG_NOSIGNAL) !=
         pathlen)
       continue;
+
+    if (client->ring) {
+      ShmRingEntry entry = { SHM_RING_ENTRY_COMMANDS, newarea->id, 0, 0 };
+
+      /* This only fails if the ring is full, then its last entry is an
+       * unread one of these and the client will read all of the commands
+       * that were just sent when reaching it */
+      shm_ring_push_buffer (client->ring, &entry, 0);
+    }
     c++;
   }
 
@@ -614,11 +777,21 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   sb->tag = tag;
 
   for (client = self->clients; client; client = client->next) {
-    struct CommandBuffer cb = { 0 };
-    cb.payload.buffer.offset = offset;
-    cb.payload.buffer.size = bsize;
-    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
-      continue;
+    if (client->ring) {
+      ShmRingEntry entry = { SHM_RING_ENTRY_BUFFER, area->id, offset, bsize };
+
+      /* keep the last entry free for an area change, a client that is that
+       * far behind misses this buffer */
+      if (!shm_ring_push_buffer (client->ring, &entry, 1))
+        continue;
+    } else {
+      struct CommandBuffer cb = { 0 };
+      cb.payload.buffer.offset = offset;
+      cb.payload.buffer.size = bsize;
+      if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER,
+              self->shm_area->id))
+        continue;
+    }
     sb->clients[i++] = client->fd;
     c++;
   }
@@ -639,17 +812,69 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   return c;
 }
 
+/* File descriptors passed along with the command are returned in fds, at
+ * most MAX_PASSED_FDS of them, or closed if fds is NULL */
 static int
-recv_command (int fd, struct CommandBuffer *cb)
+recv_command (int fd, struct CommandBuffer *cb, int *fds, int *n_fds)
 {
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int) * MAX_PASSED_FDS)];
+    struct cmsghdr align;
+  } control;
+  int received = 0;
+  int flags = MSG_DONTWAIT;
   int retval;
 
-  retval = recv (fd, cb, sizeof (struct CommandBuffer), MSG_DONTWAIT);
-  if (retval == sizeof (struct CommandBuffer)) {
-    return 1;
-  } else {
-    return 0;
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  retval = recvmsg (fd, &msg, flags);
+
+  if (retval > 0) {
+    for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+      int cfds[MAX_PASSED_FDS];
+      int i, n;
+
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+
+      n = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+      if (n > MAX_PASSED_FDS)
+        n = MAX_PASSED_FDS;
+      memcpy (cfds, CMSG_DATA (cmsg), sizeof (int) * n);
+
+      for (i = 0; i < n; i++) {
+        if (fds && received < MAX_PASSED_FDS)
+          fds[received++] = cfds[i];
+        else
+          close (cfds[i]);
+      }
+    }
+  }
+
+  if (retval != sizeof (struct CommandBuffer)) {
+    if (fds)
+      close_fds (fds, received);
+    received = 0;
   }
+
+  if (n_fds)
+    *n_fds = received;
+
+  return retval == sizeof (struct CommandBuffer);
 }
 
 long int
@@ -659,11 +884,19 @@ sp_client_recv (ShmPipe * self, char **buf)
   ShmArea *newarea;
   ShmArea *area;
   struct CommandBuffer cb;
+  int fds[MAX_PASSED_FDS];
+  int n_fds = 0;
   int retval;
 
-  if (!recv_command (self->main_socket, &cb))
+  if (!recv_command (self->main_socket, &cb, fds, &n_fds))
     return -1;
 
+  if (cb.type != COMMAND_NEW_RING && cb.type != COMMAND_NEW_DMABUF &&
+      cb.type != COMMAND_NEW_MEMFD) {
+    close_fds (fds, n_fds);
+    n_fds = 0;
+  }
+
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
       assert (cb.payload.new_shm_area.path_size > 0);
@@ -709,6 +942,45 @@ sp_client_recv (ShmPipe * self, char **buf)
       }
       return -23;
 
+    case COMMAND_NEW_RING:
+      if (self->ring || cb.payload.new_ring.size == 0) {
+        /* refused, or a duplicate */
+        close_fds (fds, n_fds);
+        break;
+      }
+      if (n_fds != SHM_RING_N_FDS) {
+        close_fds (fds, n_fds);
+        return -5;
+      }
+      self->ring = shm_ring_open (cb.payload.new_ring.size, fds);
+      if (!self->ring)
+        return -6;
+      break;
+
+    case COMMAND_NEW_DMABUF:
+    case COMMAND_NEW_MEMFD:
+    {
+      ShmFdBuffer *fdbuf, **last;
+
+      if (n_fds != 1) {
+        close_fds (fds, n_fds);
+        return -7;
+      }
+
+      fdbuf = spalloc_new (ShmFdBuffer);
+      fdbuf->fd = fds[0];
+      fdbuf->id = cb.area_id;
+      fdbuf->is_dmabuf = (cb.type == COMMAND_NEW_DMABUF);
+      fdbuf->offset = cb.payload.buffer.offset;
+      fdbuf->size = cb.payload.buffer.size;
+      fdbuf->next = NULL;
+
+      /* keep them in order */
+      for (last = &self->fd_buffers; *last; last = &(*last)->next);
+      *last = fdbuf;
+      break;
+    }
+
     default:
       return -99;
   }
@@ -720,16 +992,16 @@ int
 sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
 {
   ShmBuffer *buf = NULL, *prev_buf = NULL;
-  struct CommandBuffer cb;
+  struct CommandBuffer cb = { 0 };
 
-  if (!recv_command (client->fd, &cb))
+  if (!recv_command (client->fd, &cb, NULL, NULL))
     return -1;
 
   switch (cb.type) {
     case COMMAND_ACK_BUFFER:
 
       for (buf = self->buffers; buf; buf = buf->next) {
-        if (buf->shm_area->id == cb.area_id &&
+        if (buf->shm_area && buf->shm_area->id == cb.area_id &&
             buf->offset == cb.payload.ack_buffer.offset) {
           return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
         }
@@ -737,6 +1009,38 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
       }
 
       return -2;
+    case COMMAND_ACK_FD_BUFFER:
+
+      for (buf = self->buffers; buf; buf = buf->next) {
+        if (!buf->shm_area && buf->fd_id == cb.area_id)
+          return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
+        prev_buf = buf;
+      }
+
+      return -2;
+    case COMMAND_CLIENT_FEATURES:
+      client->features = cb.payload.client_features.flags;
+      return 1;
+    case COMMAND_RING_REQUEST:
+      if (!client->ring && self->ring_size)
+        client->ring = shm_ring_new (self->ring_size);
+
+      if (client->ring) {
+        int fds[SHM_RING_N_FDS];
+
+        shm_ring_get_fds (client->ring, fds);
+        cb.payload.new_ring.size = shm_ring_get_size (client->ring);
+        if (!send_command_fds (client->fd, &cb, COMMAND_NEW_RING,
+                self->shm_area->id, fds, SHM_RING_N_FDS))
+          return -1;
+      } else {
+        /* a size of 0 tells the client to keep using the socket */
+        cb.payload.new_ring.size = 0;
+        if (!send_command (client->fd, &cb, COMMAND_NEW_RING,
+                self->shm_area->id))
+          return -1;
+      }
+      return 1;
     default:
       return -99;
   }
@@ -749,6 +1053,7 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
 {
   ShmArea *shm_area = NULL;
   unsigned long offset;
+  int area_id;
   struct CommandBuffer cb = { 0 };
 
   for (shm_area = self->shm_area; shm_area; shm_area = shm_area->next) {
@@ -760,12 +1065,20 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
   assert (shm_area);
 
   offset = buf - shm_area->shm_area_buf;
+  area_id = shm_area->id;
 
   sp_shm_area_dec (self, shm_area);
 
+  if (self->ring) {
+    ShmRingEntry entry = { SHM_RING_ENTRY_RELEASE, area_id, offset, 0 };
+
+    /* falls back to the socket if the writer is that far behind */
+    if (shm_ring_push_release (self->ring, &entry))
+      return 1;
+  }
+
   cb.payload.ack_buffer.offset = offset;
-  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER,
-      self->shm_area->id);
+  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER, area_id);
 }
 
 ShmPipe *
@@ -836,6 +1149,8 @@ sp_writer_accept_client (ShmPipe * self)
 
   client = spalloc_new (ShmClient);
   client->fd = fd;
+  client->ring = NULL;
+  client->features = 0;
 
   /* Prepend ot linked list */
   client->next = self->clients;
@@ -883,8 +1198,10 @@ sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
 
     if (tag)
       *tag = buf->tag;
-    shm_alloc_space_block_dec (buf->ablock);
-    sp_shm_area_dec (self, buf->shm_area);
+    if (buf->ablock)
+      shm_alloc_space_block_dec (buf->ablock);
+    if (buf->shm_area)
+      sp_shm_area_dec (self, buf->shm_area);
     spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * buf->num_clients, buf);
     return 0;
   }
@@ -933,6 +1250,8 @@ again:
 
   self->num_clients--;
 
+  if (client->ring)
+    shm_ring_free (client->ring);
   spalloc_free (ShmClient, client);
 }
 
@@ -993,5 +1312,308 @@ sp_writer_get_max_buf_size (ShmPipe * self)
   if (self->shm_area == NULL)
     return 0;
 
-  return self->shm_area->shm_area_len;
+  return shm_alloc_space_get_max_block_size (self->shm_area->allocspace);
+}
+
+/* Cuts the current and future shm areas in slots of slab_size bytes, 0
+ * goes back to first-fit allocation. Fails if blocks are still allocated
+ * from the current area. */
+int
+sp_writer_set_slab_size (ShmPipe * self, size_t slab_size)
+{
+  if (shm_alloc_space_set_slab_size (self->shm_area->allocspace,
+          slab_size) < 0)
+    return -1;
+
+  self->slab_size = slab_size;
+
+  return 0;
+}
+
+void
+sp_writer_get_alloc_stats (ShmPipe * self, ShmAllocStats * stats)
+{
+  shm_alloc_space_get_stats (self->shm_area->allocspace, stats);
+}
+
+/* Clients that request a ring get one with size entries, rounded up to a
+ * power of two. 0 refuses the requests. */
+void
+sp_writer_set_ring_size (ShmPipe * self, unsigned int size)
+{
+  unsigned int ring_size = 0;
+
+  if (size) {
+    ring_size = 2;
+    while (ring_size < size && ring_size < SHM_RING_MAX_SIZE)
+      ring_size <<= 1;
+  }
+
+  self->ring_size = ring_size;
+}
+
+/* The fd to poll for the buffers released through the client's ring, -1 if
+ * the client has no ring */
+int
+sp_writer_get_client_ring_fd (ShmClient * client)
+{
+  if (client->ring)
+    return shm_ring_get_release_fd (client->ring);
+
+  return -1;
+}
+
+/* Handles the buffers released by a client through its ring. Returns the
+ * number of buffers freed, whose tags are given to callback, or a negative
+ * value if the client sent something invalid. */
+int
+sp_writer_recv_ring (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  ShmRingEntry entry;
+  int freed = 0;
+  int ret;
+
+  if (!client->ring)
+    return 0;
+
+  while ((ret = shm_ring_pop_release (client->ring, &entry)) > 0) {
+    ShmBuffer *buf = NULL, *prev_buf = NULL;
+    void *tag = NULL;
+    int i;
+
+    if (entry.type != SHM_RING_ENTRY_RELEASE)
+      return -99;
+
+    for (buf = self->buffers; buf; buf = buf->next) {
+      if (buf->shm_area && buf->shm_area->id == entry.area_id &&
+          buf->offset == entry.offset)
+        break;
+      prev_buf = buf;
+    }
+
+    if (!buf)
+      return -2;
+
+    for (i = 0; i < buf->num_clients; i++)
+      if (buf->clients[i] == client->fd)
+        break;
+    if (i == buf->num_clients)
+      return -2;
+
+    if (sp_shmbuf_dec (self, buf, prev_buf, client, &tag) == 0) {
+      if (callback)
+        callback (tag, user_data);
+      freed++;
+    }
+  }
+
+  return ret < 0 ? -1 : freed;
+}
+
+/* Asks the writer for a ring, the answer is handled by sp_client_recv() and
+ * sp_client_get_ring_fd() then starts returning a valid fd */
+int
+sp_client_request_ring (ShmPipe * self)
+{
+  struct CommandBuffer cb = { 0 };
+
+  return send_command (self->main_socket, &cb, COMMAND_RING_REQUEST, 0);
+}
+
+/* Once the client has a ring, this fd has to be polled instead of reading
+ * the socket, which is still polled for errors */
+int
+sp_client_get_ring_fd (ShmPipe * self)
+{
+  if (self->ring)
+    return shm_ring_get_buffer_fd (self->ring);
+
+  return -1;
+}
+
+/* Returns the size of the next buffer from the ring, 0 if it is empty and
+ * the ring fd has to be polled or if a buffer passed as an fd has to be
+ * popped first, or a negative value on error */
+long int
+sp_client_recv_ring (ShmPipe * self, char **buf)
+{
+  ShmRingEntry entry;
+  ShmArea *area;
+  int ret;
+
+  while ((ret = shm_ring_pop_buffer (self->ring, &entry)) > 0) {
+    char *dummy;
+
+    switch (entry.type) {
+      case SHM_RING_ENTRY_COMMANDS:
+        /* they were all sent before this entry was queued */
+        while (sp_client_recv (self, &dummy) == 0);
+        /* buffers passed as fds come before the next ones in the ring */
+        if (self->fd_buffers)
+          return 0;
+        break;
+
+      case SHM_RING_ENTRY_BUFFER:
+        for (area = self->shm_area; area; area = area->next) {
+          if (area->id == entry.area_id) {
+            if (entry.offset > area->shm_area_len ||
+                entry.size > area->shm_area_len - entry.offset)
+              return -24;
+            *buf = area->shm_area_buf + entry.offset;
+            sp_shm_area_inc (area);
+            return entry.size;
+          }
+        }
+        return -23;
+
+      default:
+        return -99;
+    }
+  }
+
+  return ret;
+}
+
+/* Advises the current and future areas to use huge pages, with a size that
+ * is a multiple of 2 MiB all of the area can use them. Returns -1 if this
+ * is not supported. */
+int
+sp_writer_set_huge_pages (ShmPipe * self, int enable)
+{
+  self->huge_pages = enable;
+
+  if (enable)
+    return sp_shm_area_advise_huge_pages (self->shm_area);
+
+  return 0;
+}
+
+size_t
+sp_writer_get_huge_page_size (void)
+{
+  return HUGE_PAGE_SIZE;
+}
+
+/* Returns 1 if there are clients and all of them accept buffers passed as
+ * file descriptors */
+int
+sp_writer_clients_accept_fds (ShmPipe * self)
+{
+  ShmClient *client;
+
+  if (!self->clients)
+    return 0;
+
+  for (client = self->clients; client; client = client->next)
+    if (!(client->features & SP_CLIENT_FEATURE_FDS))
+      return 0;
+
+  return 1;
+}
+
+/* Sends the size bytes at offset in the dmabuf or memfd fd to all the
+ * clients that accept them, see sp_writer_clients_accept_fds(). Like
+ * sp_writer_send_buf(), returns the number of clients it was sent to and
+ * tag is returned when the last of them is done with it. */
+int
+sp_writer_send_fd_buf (ShmPipe * self, int fd, int is_dmabuf,
+    unsigned long offset, unsigned long size, void *tag)
+{
+  ShmBuffer *sb;
+  ShmClient *client = NULL;
+  int i = 0;
+  int c = 0;
+
+  if (self->num_clients == 0)
+    return 0;
+
+  /* ids are only compared, wrapping around is fine */
+  if (++self->next_fd_id == 0)
+    self->next_fd_id = 1;
+
+  sb = spalloc_alloc (sizeof (ShmBuffer) + sizeof (int) * self->num_clients);
+  memset (sb, 0, sizeof (ShmBuffer));
+  memset (sb->clients, -1, sizeof (int) * self->num_clients);
+  sb->offset = offset;
+  sb->size = size;
+  sb->fd_id = self->next_fd_id;
+  sb->num_clients = self->num_clients;
+  sb->tag = tag;
+
+  for (client = self->clients; client; client = client->next) {
+    struct CommandBuffer cb = { 0 };
+
+    if (!(client->features & SP_CLIENT_FEATURE_FDS))
+      continue;
+
+    cb.payload.buffer.offset = offset;
+    cb.payload.buffer.size = size;
+    if (!send_command_fds (client->fd, &cb,
+            is_dmabuf ? COMMAND_NEW_DMABUF : COMMAND_NEW_MEMFD, sb->fd_id,
+            &fd, 1))
+      continue;
+
+    if (client->ring) {
+      ShmRingEntry entry = { SHM_RING_ENTRY_COMMANDS, 0, 0, 0 };
+
+      /* see sp_writer_resize() for why this can't be lost */
+      shm_ring_push_buffer (client->ring, &entry, 0);
+    }
+
+    sb->clients[i++] = client->fd;
+    c++;
+  }
+
+  if (c == 0) {
+    spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * sb->num_clients, sb);
+    return 0;
+  }
+
+  sb->use_count = c;
+
+  sb->next = self->buffers;
+  self->buffers = sb;
+
+  return c;
+}
+
+int
+sp_client_set_features (ShmPipe * self, unsigned int features)
+{
+  struct CommandBuffer cb = { 0 };
+
+  cb.payload.client_features.flags = features;
+  return send_command (self->main_socket, &cb, COMMAND_CLIENT_FEATURES, 0);
+}
+
+/* Returns the oldest buffer received as a file descriptor, the fd then
+ * belongs to the caller. Returns 0 if there is none. */
+int
+sp_client_pop_fd_buffer (ShmPipe * self, int *fd, int *is_dmabuf,
+    unsigned long *offset, unsigned long *size, int *id)
+{
+  ShmFdBuffer *fdbuf = self->fd_buffers;
+
+  if (!fdbuf)
+    return 0;
+
+  self->fd_buffers = fdbuf->next;
+
+  *fd = fdbuf->fd;
+  *is_dmabuf = fdbuf->is_dmabuf;
+  *offset = fdbuf->offset;
+  *size = fdbuf->size;
+  *id = fdbuf->id;
+  spalloc_free (ShmFdBuffer, fdbuf);
+
+  return 1;
+}
+
+int
+sp_client_recv_fd_finish (ShmPipe * self, int id)
+{
+  struct CommandBuffer cb = { 0 };
+
+  return send_command (self->main_socket, &cb, COMMAND_ACK_FD_BUFFER, id);
 }
@@ -68,6 +68,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include "shmalloc.h"
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -77,6 +79,10 @@ typedef struct _ShmClient ShmClient;
 typedef struct _ShmPipe ShmPipe;
 typedef struct _ShmBlock ShmBlock;
 typedef struct _ShmBuffer ShmBuffer;
+typedef struct _ShmFdBuffer ShmFdBuffer;
+
+/* Client features */
+#define SP_CLIENT_FEATURE_FDS (1 << 0)
 
 typedef void (*sp_buffer_free_callback) (void * tag, void * user_data);
 
@@ -100,6 +106,19 @@ int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void * tag);
 char *sp_writer_block_get_buf (ShmBlock *block);
 ShmPipe *sp_writer_block_get_pipe (ShmBlock *block);
 size_t sp_writer_get_max_buf_size (ShmPipe * self);
+int sp_writer_set_slab_size (ShmPipe * self, size_t slab_size);
+void sp_writer_get_alloc_stats (ShmPipe * self, ShmAllocStats * stats);
+
+void sp_writer_set_ring_size (ShmPipe * self, unsigned int size);
+int sp_writer_get_client_ring_fd (ShmClient * client);
+int sp_writer_recv_ring (ShmPipe * self, ShmClient * client,
+    sp_buffer_free_callback callback, void * user_data);
+
+int sp_writer_set_huge_pages (ShmPipe * self, int enable);
+size_t sp_writer_get_huge_page_size (void);
+int sp_writer_clients_accept_fds (ShmPipe * self);
+int sp_writer_send_fd_buf (ShmPipe * self, int fd, int is_dmabuf,
+    unsigned long offset, unsigned long size, void * tag);
 
 ShmClient * sp_writer_accept_client (ShmPipe * self);
 void sp_writer_close_client (ShmPipe *self, ShmClient * client,
@@ -117,6 +136,15 @@ long int sp_client_recv (ShmPipe * self, char **buf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
 void sp_client_close (ShmPipe * self);
 
+int sp_client_request_ring (ShmPipe * self);
+int sp_client_get_ring_fd (ShmPipe * self);
+long int sp_client_recv_ring (ShmPipe * self, char **buf);
+
+int sp_client_set_features (ShmPipe * self, unsigned int features);
+int sp_client_pop_fd_buffer (ShmPipe * self, int *fd, int *is_dmabuf,
+    unsigned long *offset, unsigned long *size, int *id);
+int sp_client_recv_fd_finish (ShmPipe * self, int id);
+
 #ifdef __cplusplus
 }
 #endif
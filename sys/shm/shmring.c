@@ -0,0 +1,350 @@
+/* GStreamer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * A ring is a small shared memory area holding two single producer, single
+ * consumer queues of ShmRingEntry: buffers from the writer to one reader
+ * and releases from that reader back to the writer. Each queue has an
+ * eventfd to wake up its consumer. The consumer sets the waiting flag
+ * before going to sleep and the producer only writes to the eventfd if the
+ * flag was set, so a busy peer is never woken up with a syscall.
+ *
+ * The shm file descriptor and the two eventfds are passed to the reader over
+ * the control socket, the file is unlinked right after creation.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shmring.h"
+#include "shmalloc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#define HAVE_SHM_RING 1
+#endif
+
+#define SHM_RING_CACHELINE 64
+
+/* Each index lives in its own cache line, head is only written by the
+ * producer and tail only by the consumer */
+typedef struct
+{
+  uint32_t head;
+  char pad0[SHM_RING_CACHELINE - sizeof (uint32_t)];
+  uint32_t tail;
+  uint32_t waiting;
+  char pad1[SHM_RING_CACHELINE - 2 * sizeof (uint32_t)];
+} ShmRingQueue;
+
+struct _ShmRing
+{
+  unsigned int size;
+
+  int shm_fd;
+  char *map;
+  size_t map_len;
+
+  ShmRingQueue *buffer_queue;
+  ShmRingQueue *release_queue;
+  ShmRingEntry *buffers;
+  ShmRingEntry *releases;
+
+  /* written by the writer, polled by the reader */
+  int buffer_fd;
+  /* written by the reader, polled by the writer */
+  int release_fd;
+};
+
+static size_t
+shm_ring_map_len (unsigned int size)
+{
+  return 2 * sizeof (ShmRingQueue) + 2 * size * sizeof (ShmRingEntry);
+}
+
+static ShmRing *
+shm_ring_alloc (unsigned int size)
+{
+  ShmRing *ring = spalloc_new (ShmRing);
+
+  memset (ring, 0, sizeof (ShmRing));
+  ring->size = size;
+  ring->shm_fd = -1;
+  ring->map = MAP_FAILED;
+  ring->map_len = shm_ring_map_len (size);
+  ring->buffer_fd = -1;
+  ring->release_fd = -1;
+
+  return ring;
+}
+
+static int
+shm_ring_map (ShmRing * ring)
+{
+  ring->map = mmap (NULL, ring->map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+      ring->shm_fd, 0);
+  if (ring->map == MAP_FAILED)
+    return 0;
+
+  ring->buffer_queue = (ShmRingQueue *) ring->map;
+  ring->release_queue = ring->buffer_queue + 1;
+  ring->buffers = (ShmRingEntry *) (ring->release_queue + 1);
+  ring->releases = ring->buffers + ring->size;
+
+  return 1;
+}
+
+/* Creates the ring on the writer side, size must be a power of two. Returns
+ * NULL if the ring can not be created or is not supported on this
+ * platform. */
+ShmRing *
+shm_ring_new (unsigned int size)
+{
+#ifdef HAVE_SHM_RING
+  ShmRing *ring;
+  char tmppath[32];
+  int i = 0;
+
+  if (size < 2 || size > SHM_RING_MAX_SIZE || (size & (size - 1)))
+    return NULL;
+
+  ring = shm_ring_alloc (size);
+
+  do {
+    snprintf (tmppath, sizeof (tmppath), "/shmring.%5d.%5d", getpid (), i++);
+    ring->shm_fd = shm_open (tmppath, O_RDWR | O_CREAT | O_EXCL, S_IRUSR |
+        S_IWUSR);
+  } while (ring->shm_fd < 0 && errno == EEXIST);
+
+  if (ring->shm_fd < 0) {
+    fprintf (stderr, "shm_open failed on %s (%d): %s\n", tmppath, errno,
+        strerror (errno));
+    goto error;
+  }
+
+  /* only reachable through the file descriptor from now on */
+  shm_unlink (tmppath);
+
+  if (ftruncate (ring->shm_fd, ring->map_len)) {
+    fprintf (stderr, "Could not resize ring, ftruncate failed (%d): %s\n",
+        errno, strerror (errno));
+    goto error;
+  }
+
+  if (!shm_ring_map (ring)) {
+    fprintf (stderr, "mmap failed (%d): %s\n", errno, strerror (errno));
+    goto error;
+  }
+
+  memset (ring->map, 0, ring->map_len);
+  /* both consumers start asleep */
+  ring->buffer_queue->waiting = 1;
+  ring->release_queue->waiting = 1;
+
+  ring->buffer_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  ring->release_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ring->buffer_fd < 0 || ring->release_fd < 0) {
+    fprintf (stderr, "eventfd failed (%d): %s\n", errno, strerror (errno));
+    goto error;
+  }
+
+  return ring;
+
+error:
+  shm_ring_free (ring);
+#endif
+  return NULL;
+}
+
+/* Maps the ring received by a reader, takes ownership of the
+ * SHM_RING_N_FDS file descriptors in all cases */
+ShmRing *
+shm_ring_open (unsigned int size, int *fds)
+{
+  ShmRing *ring;
+  struct stat st;
+
+  ring = shm_ring_alloc (size);
+  ring->shm_fd = fds[0];
+  ring->buffer_fd = fds[1];
+  ring->release_fd = fds[2];
+
+  if (size < 2 || size > SHM_RING_MAX_SIZE || (size & (size - 1)))
+    goto error;
+
+  if (fstat (ring->shm_fd, &st) < 0 || (size_t) st.st_size < ring->map_len)
+    goto error;
+
+  if (!shm_ring_map (ring))
+    goto error;
+
+  return ring;
+
+error:
+  shm_ring_free (ring);
+  return NULL;
+}
+
+void
+shm_ring_free (ShmRing * ring)
+{
+  if (ring->map != MAP_FAILED)
+    munmap (ring->map, ring->map_len);
+  if (ring->shm_fd >= 0)
+    close (ring->shm_fd);
+  if (ring->buffer_fd >= 0)
+    close (ring->buffer_fd);
+  if (ring->release_fd >= 0)
+    close (ring->release_fd);
+
+  spalloc_free (ShmRing, ring);
+}
+
+unsigned int
+shm_ring_get_size (ShmRing * ring)
+{
+  return ring->size;
+}
+
+void
+shm_ring_get_fds (ShmRing * ring, int *fds)
+{
+  fds[0] = ring->shm_fd;
+  fds[1] = ring->buffer_fd;
+  fds[2] = ring->release_fd;
+}
+
+int
+shm_ring_get_buffer_fd (ShmRing * ring)
+{
+  return ring->buffer_fd;
+}
+
+int
+shm_ring_get_release_fd (ShmRing * ring)
+{
+  return ring->release_fd;
+}
+
+static void
+shm_ring_wake (int fd)
+{
+  uint64_t one = 1;
+
+  /* EAGAIN means the counter is already set */
+  if (write (fd, &one, sizeof (one)) < 0 && errno != EAGAIN)
+    fprintf (stderr, "Could not wake up ring consumer (%d): %s\n", errno,
+        strerror (errno));
+}
+
+static int
+shm_ring_push (ShmRingQueue * queue, ShmRingEntry * entries,
+    unsigned int size, const ShmRingEntry * entry, unsigned int reserve,
+    int fd)
+{
+  uint32_t head = queue->head;
+  uint32_t tail = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE);
+
+  if (head - tail >= size - reserve)
+    return 0;
+
+  entries[head & (size - 1)] = *entry;
+  __atomic_store_n (&queue->head, head + 1, __ATOMIC_SEQ_CST);
+
+  if (__atomic_exchange_n (&queue->waiting, 0, __ATOMIC_SEQ_CST))
+    shm_ring_wake (fd);
+
+  return 1;
+}
+
+static int
+shm_ring_pop (ShmRingQueue * queue, ShmRingEntry * entries,
+    unsigned int size, ShmRingEntry * entry, int fd)
+{
+  uint32_t tail = queue->tail;
+  uint32_t head = __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE);
+
+  if (head == tail) {
+    uint64_t count;
+
+    /* Clear a pending wake up and announce that we go to sleep, then check
+     * again so that an entry pushed in between is not missed */
+    if (read (fd, &count, sizeof (count)) < 0 && errno != EAGAIN)
+      return -1;
+    __atomic_store_n (&queue->waiting, 1, __ATOMIC_SEQ_CST);
+    head = __atomic_load_n (&queue->head, __ATOMIC_SEQ_CST);
+    if (head == tail)
+      return 0;
+    __atomic_store_n (&queue->waiting, 0, __ATOMIC_RELAXED);
+  }
+
+  /* the peer may be misbehaving, never trust more than size entries */
+  if (head - tail > size)
+    return -1;
+
+  *entry = entries[tail & (size - 1)];
+  /* release the slot before the caller acts on the entry */
+  __atomic_store_n (&queue->tail, tail + 1, __ATOMIC_SEQ_CST);
+
+  return 1;
+}
+
+/* Returns 1 if the entry was queued, 0 if fewer than reserve + 1 slots
+ * were free */
+int
+shm_ring_push_buffer (ShmRing * ring, const ShmRingEntry * entry,
+    unsigned int reserve)
+{
+  return shm_ring_push (ring->buffer_queue, ring->buffers, ring->size, entry,
+      reserve, ring->buffer_fd);
+}
+
+/* Returns 1 if an entry was popped, 0 if the queue is empty and -1 on
+ * error, the consumer must then wait for the buffer fd to be readable */
+int
+shm_ring_pop_buffer (ShmRing * ring, ShmRingEntry * entry)
+{
+  return shm_ring_pop (ring->buffer_queue, ring->buffers, ring->size, entry,
+      ring->buffer_fd);
+}
+
+int
+shm_ring_push_release (ShmRing * ring, const ShmRingEntry * entry)
+{
+  return shm_ring_push (ring->release_queue, ring->releases, ring->size,
+      entry, 0, ring->release_fd);
+}
+
+int
+shm_ring_pop_release (ShmRing * ring, ShmRingEntry * entry)
+{
+  return shm_ring_pop (ring->release_queue, ring->releases, ring->size, entry,
+      ring->release_fd);
+}
@@ -0,0 +1,74 @@
+/* GStreamer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef __SHMRING_H__
+#define __SHMRING_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHM_RING_N_FDS 3
+#define SHM_RING_MAX_SIZE 4096
+
+typedef struct _ShmRing ShmRing;
+typedef struct _ShmRingEntry ShmRingEntry;
+
+enum
+{
+  /* A buffer from the writer to the reader */
+  SHM_RING_ENTRY_BUFFER = 1,
+  /* Commands were sent on the socket before this entry, read them now */
+  SHM_RING_ENTRY_COMMANDS = 2,
+  /* A buffer given back from the reader to the writer */
+  SHM_RING_ENTRY_RELEASE = 3
+};
+
+struct _ShmRingEntry
+{
+  uint32_t type;
+  int32_t area_id;
+  uint64_t offset;
+  uint64_t size;
+};
+
+ShmRing *shm_ring_new (unsigned int size);
+ShmRing *shm_ring_open (unsigned int size, int *fds);
+void shm_ring_free (ShmRing * ring);
+
+unsigned int shm_ring_get_size (ShmRing * ring);
+void shm_ring_get_fds (ShmRing * ring, int *fds);
+int shm_ring_get_buffer_fd (ShmRing * ring);
+int shm_ring_get_release_fd (ShmRing * ring);
+
+int shm_ring_push_buffer (ShmRing * ring, const ShmRingEntry * entry,
+    unsigned int reserve);
+int shm_ring_pop_buffer (ShmRing * ring, ShmRingEntry * entry);
+int shm_ring_push_release (ShmRing * ring, const ShmRingEntry * entry);
+int shm_ring_pop_release (ShmRing * ring, ShmRingEntry * entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHMRING_H__ */
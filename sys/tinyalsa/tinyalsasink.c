@@ -31,9 +31,20 @@
  * gst-launch-1.0 -v uridecodebin uri=file:///path/to/audio.ogg ! audioconvert ! audioresample ! tinyalsasink
  * ]| Play an Ogg/Vorbis file and output audio via ALSA using the tinyalsa
  * library.
+ * |[
+ * gst-launch-1.0 -v audiotestsrc ! audio/x-raw,rate=48000 ! tinyalsasink mmap=true period-size=96 period-count=2
+ * ]| Play a test tone with about 4 ms of output latency, writing directly into
+ * the hardware buffer.
+ *
+ * In mmap mode, samples are copied straight into the memory mapped hardware
+ * buffer instead of going through a write() system call, and playback starts
+ * as soon as the first period has been written.
  *
  */
 
+#include <string.h>
+#include <time.h>
+
 #include <gst/audio/gstaudiobasesink.h>
 
 #include <tinyalsa/asoundlib.h>
@@ -62,11 +73,17 @@ enum
   PROP_0,
   PROP_CARD,
   PROP_DEVICE,
+  PROP_MMAP,
+  PROP_PERIOD_SIZE,
+  PROP_PERIOD_COUNT,
   PROP_LAST
 };
 
 #define DEFAULT_CARD 0
 #define DEFAULT_DEVICE 0
+#define DEFAULT_MMAP FALSE
+#define DEFAULT_PERIOD_SIZE 0
+#define DEFAULT_PERIOD_COUNT 0
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -91,6 +108,18 @@ gst_tinyalsa_sink_get_property (GObject * object, guint prop_id,
       g_value_set_uint (value, sink->device);
       break;
 
+    case PROP_MMAP:
+      g_value_set_boolean (value, sink->use_mmap);
+      break;
+
+    case PROP_PERIOD_SIZE:
+      g_value_set_uint (value, sink->period_size);
+      break;
+
+    case PROP_PERIOD_COUNT:
+      g_value_set_uint (value, sink->period_count);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -112,6 +141,18 @@ gst_tinyalsa_sink_set_property (GObject * object, guint prop_id,
       sink->device = g_value_get_uint (value);
       break;
 
+    case PROP_MMAP:
+      sink->use_mmap = g_value_get_boolean (value);
+      break;
+
+    case PROP_PERIOD_SIZE:
+      sink->period_size = g_value_get_uint (value);
+      break;
+
+    case PROP_PERIOD_COUNT:
+      sink->period_count = g_value_get_uint (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -285,9 +326,15 @@ gst_tinyalsa_sink_prepare (GstAudioSink * asink, GstAudioRingBufferSpec * spec)
   struct pcm_params *params = NULL;
   int period_size_min, period_size_max;
   int periods_min, periods_max;
+  unsigned int flags = PCM_OUT | PCM_NORESTART | PCM_MONOTONIC;
 
   pcm_config_from_spec (&config, spec);
 
+  if (sink->period_size > 0)
+    config.period_size = sink->period_size;
+  if (sink->period_count > 0)
+    config.period_count = sink->period_count;
+
   GST_DEBUG_OBJECT (sink, "Requesting %u periods of %u frames",
       config.period_count, config.period_size);
 
@@ -307,11 +354,25 @@ gst_tinyalsa_sink_prepare (GstAudioSink * asink, GstAudioRingBufferSpec * spec)
       CLAMP (config.period_size, period_size_min, period_size_max);
   config.period_count = CLAMP (config.period_count, periods_min, periods_max);
 
+  if (sink->use_mmap) {
+    /* start playing as soon as one period is queued instead of when half of
+     * the buffer is filled */
+    flags |= PCM_MMAP;
+    config.start_threshold = config.period_size;
+    config.avail_min = config.period_size;
+  }
+
+  sink->rate = config.rate;
+  sink->start_threshold = config.start_threshold;
+  sink->running = FALSE;
+  /* twice the buffer duration, in ms */
+  sink->wait_timeout = MAX (10,
+      2000 * config.period_size * config.period_count / config.rate);
+
   /* mutex with getcaps */
   GST_OBJECT_LOCK (sink);
 
-  sink->pcm = pcm_open (sink->card, sink->device, PCM_OUT | PCM_NORESTART,
-      &config);
+  sink->pcm = pcm_open (sink->card, sink->device, flags, &config);
 
   GST_OBJECT_UNLOCK (sink);
 
@@ -330,8 +391,8 @@ gst_tinyalsa_sink_prepare (GstAudioSink * asink, GstAudioRingBufferSpec * spec)
   spec->segsize = pcm_frames_to_bytes (sink->pcm, config.period_size);
   spec->segtotal = config.period_count;
 
-  GST_DEBUG_OBJECT (sink, "Configured for %u periods of %u frames",
-      config.period_count, config.period_size);
+  GST_DEBUG_OBJECT (sink, "Configured for %u periods of %u frames%s",
+      config.period_count, config.period_size, sink->use_mmap ? " (mmap)" : "");
 
   return TRUE;
 
@@ -379,12 +440,93 @@ gst_tinyalsa_sink_close (GstAudioSink * asink)
   return TRUE;
 }
 
+/* Copies the samples into the hardware buffer, waiting for room as
+ * needed, and starts the device once start_threshold frames are queued */
+static gint
+gst_tinyalsa_sink_write_mmap (GstTinyalsaSink * sink, guint8 * data,
+    guint length)
+{
+  unsigned int frames = pcm_bytes_to_frames (sink->pcm, length);
+  unsigned int buffer_size = pcm_get_buffer_size (sink->pcm);
+
+  while (frames > 0) {
+    void *areas;
+    unsigned int offset, n = frames;
+    int avail, ret;
+
+    avail = pcm_mmap_avail (sink->pcm);
+    if (avail < 0)
+      goto xrun;
+
+    if (avail == 0) {
+      if (!sink->running) {
+        /* the buffer is full, so it's time to start in any case */
+        if (pcm_start (sink->pcm) < 0)
+          goto error;
+        sink->running = TRUE;
+      }
+
+      ret = pcm_wait (sink->pcm, sink->wait_timeout);
+      if (ret == -EPIPE)
+        goto xrun;
+      else if (ret < 0)
+        goto error;
+      else if (ret == 0)
+        GST_WARNING_OBJECT (sink, "Timed out waiting for the device");
+      continue;
+    }
+
+    if (pcm_mmap_begin (sink->pcm, &areas, &offset, &n) < 0)
+      goto error;
+
+    memcpy ((guint8 *) areas + pcm_frames_to_bytes (sink->pcm, offset), data,
+        pcm_frames_to_bytes (sink->pcm, n));
+
+    ret = pcm_mmap_commit (sink->pcm, offset, n);
+    if (ret == -EPIPE)
+      goto xrun;
+    else if (ret < 0)
+      goto error;
+
+    data += pcm_frames_to_bytes (sink->pcm, n);
+    frames -= n;
+
+    if (!sink->running && buffer_size - avail + n >= sink->start_threshold) {
+      if (pcm_start (sink->pcm) < 0)
+        goto error;
+      sink->running = TRUE;
+    }
+
+    continue;
+
+  xrun:
+    GST_WARNING_OBJECT (sink, "Got an underrun");
+
+    if (pcm_prepare (sink->pcm) < 0)
+      goto error;
+
+    sink->running = FALSE;
+  }
+
+  GST_DEBUG_OBJECT (sink, "Wrote %u bytes", length);
+
+  return length;
+
+error:
+  GST_ERROR_OBJECT (sink, "Could not write data to device: %s",
+      pcm_get_error (sink->pcm));
+  return -1;
+}
+
 static gint
 gst_tinyalsa_sink_write (GstAudioSink * asink, gpointer data, guint length)
 {
   GstTinyalsaSink *sink = GST_TINYALSA_SINK (asink);
   int ret;
 
+  if (sink->use_mmap)
+    return gst_tinyalsa_sink_write_mmap (sink, data, length);
+
 again:
   GST_DEBUG_OBJECT (sink, "Starting write");
 
@@ -425,14 +567,35 @@ gst_tinyalsa_sink_reset (GstAudioSink * asink)
     GST_ERROR_OBJECT (sink, "Could not prepare device: %s",
         pcm_get_error (sink->pcm));
   }
+
+  sink->running = FALSE;
 }
 
 static guint
 gst_tinyalsa_sink_delay (GstAudioSink * asink)
 {
   GstTinyalsaSink *sink = GST_TINYALSA_SINK (asink);
+  unsigned int avail;
+  struct timespec tstamp, now;
   int delay;
 
+  /* The frames queued when the hardware pointer was last updated, minus the
+   * ones played since then. This is more precise than the period granular
+   * delay of pcm_get_delay() */
+  if (pcm_get_htimestamp (sink->pcm, &avail, &tstamp) == 0 &&
+      clock_gettime (CLOCK_MONOTONIC, &now) == 0) {
+    gint64 elapsed = GST_TIMESPEC_TO_TIME (now) - GST_TIMESPEC_TO_TIME (tstamp);
+    gint64 queued = (gint64) pcm_get_buffer_size (sink->pcm) - avail;
+
+    queued -= gst_util_uint64_scale_int (MAX (elapsed, 0), sink->rate,
+        GST_SECOND);
+
+    delay = MAX (queued, 0);
+    GST_LOG_OBJECT (sink, "Got delay of %u from timestamp", delay);
+
+    return delay;
+  }
+
   delay = pcm_get_delay (sink->pcm);
 
   if (delay < 0) {
@@ -487,6 +650,29 @@ gst_tinyalsa_sink_class_init (GstTinyalsaSinkClass * klass)
           0, G_MAXUINT, DEFAULT_CARD,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+      PROP_MMAP,
+      g_param_spec_boolean ("mmap", "mmap",
+          "Write directly into the memory mapped hardware buffer",
+          DEFAULT_MMAP, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PERIOD_SIZE,
+      g_param_spec_uint ("period-size", "Period size",
+          "Period size in frames (0 = derive from latency-time)",
+          0, G_MAXUINT, DEFAULT_PERIOD_SIZE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PERIOD_COUNT,
+      g_param_spec_uint ("period-count", "Period count",
+          "Number of periods in the buffer (0 = derive from buffer-time)",
+          0, G_MAXUINT, DEFAULT_PERIOD_COUNT,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (tinyalsa_sink_debug, "tinyalsasink", 0,
       "tinyalsa Sink");
 }
@@ -496,6 +682,9 @@ gst_tinyalsa_sink_init (GstTinyalsaSink * sink)
 {
   sink->card = DEFAULT_CARD;
   sink->device = DEFAULT_DEVICE;
+  sink->use_mmap = DEFAULT_MMAP;
+  sink->period_size = DEFAULT_PERIOD_SIZE;
+  sink->period_count = DEFAULT_PERIOD_COUNT;
 
   sink->cached_caps = NULL;
 }
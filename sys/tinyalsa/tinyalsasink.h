@@ -42,9 +42,18 @@ struct _GstTinyalsaSink {
 
   int card;
   int device;
+  gboolean use_mmap;
+  guint period_size;
+  guint period_count;
 
   struct pcm *pcm;
 
+  /* for mmap mode and delay reporting, set in prepare() */
+  guint rate;
+  guint start_threshold;
+  gint wait_timeout;
+  gboolean running;
+
   GstCaps *cached_caps; /* for queries made while the device is open */
 };
 
@@ -0,0 +1,115 @@
+/* GStreamer
+ *
+ * benchutils.c - Shared helpers of the element benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "benchutils.h"
+
+/* the streaming threads of the counted pads may differ */
+G_LOCK_DEFINE_STATIC (counters);
+
+static GstPadProbeReturn
+bench_count_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BenchCounter *counter = user_data;
+  gsize size = gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  G_LOCK (counters);
+  counter->buffers++;
+  counter->bytes += size;
+  G_UNLOCK (counters);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* counts the buffers and bytes flowing through @pad */
+void
+bench_count_pad (GstPad * pad, BenchCounter * counter)
+{
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, bench_count_probe,
+      counter, NULL);
+}
+
+/* plays @pipeline to EOS and returns the time it took, or
+ * GST_CLOCK_TIME_NONE on error */
+GstClockTime
+bench_run_pipeline (GstElement * pipeline)
+{
+  GstClockTime start, elapsed = GST_CLOCK_TIME_NONE;
+  GstBus *bus;
+  GstMessage *msg;
+
+  bus = gst_element_get_bus (pipeline);
+
+  start = gst_util_get_timestamp ();
+  if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    g_printerr ("Could not start the pipeline\n");
+    goto done;
+  }
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = gst_util_get_timestamp () - start;
+  } else {
+    GError *err = NULL;
+    gchar *dbg = NULL;
+
+    gst_message_parse_error (msg, &err, &dbg);
+    g_printerr ("Error from %s: %s (%s)\n", GST_OBJECT_NAME (msg->src),
+        err->message, GST_STR_NULL (dbg));
+    g_clear_error (&err);
+    g_free (dbg);
+  }
+  gst_message_unref (msg);
+
+done:
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+
+  return elapsed;
+}
+
+/* prints one line of JSON with the rates of one run, @params is a list of
+ * JSON members describing the input, or NULL */
+void
+bench_print_result (const gchar * name, GstClockTime elapsed,
+    const BenchCounter * counter, guint64 input_bytes, const gchar * params)
+{
+  gdouble secs = (gdouble) MAX (elapsed, 1) / GST_SECOND;
+
+  g_print ("{\"benchmark\": \"%s\", %s%s\"elapsed-ns\": %" G_GUINT64_FORMAT
+      ", \"buffers\": %" G_GUINT64_FORMAT ", \"bytes\": %" G_GUINT64_FORMAT
+      ", \"input-bytes\": %" G_GUINT64_FORMAT ", \"buffers-per-s\": %.1f"
+      ", \"ns-per-byte\": %.4f}\n", name, params ? params : "",
+      params ? ", " : "", elapsed, counter->buffers, counter->bytes,
+      input_bytes, counter->buffers / secs,
+      input_bytes ? (gdouble) elapsed / input_bytes : 0);
+}
+
+/* fills @data with random bytes that can not form a start code or
+ * emulation prevention sequence */
+void
+bench_fill_random (GRand * rand, guint8 * data, gsize size)
+{
+  gsize i;
+
+  for (i = 0; i < size; i++)
+    data[i] = g_rand_int_range (rand, 1, 256);
+}
@@ -0,0 +1,51 @@
+/* GStreamer
+ *
+ * benchutils.h - Shared helpers of the element benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BENCH_UTILS_H__
+#define __BENCH_UTILS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* all synthetic inputs are generated from this seed */
+#define BENCH_SEED 0x5eed
+
+typedef struct
+{
+  guint64 buffers;
+  guint64 bytes;
+} BenchCounter;
+
+void          bench_count_pad     (GstPad * pad, BenchCounter * counter);
+
+GstClockTime  bench_run_pipeline  (GstElement * pipeline);
+
+void          bench_print_result  (const gchar * name,
+                                   GstClockTime elapsed,
+                                   const BenchCounter * counter,
+                                   guint64 input_bytes,
+                                   const gchar * params);
+
+void          bench_fill_random   (GRand * rand, guint8 * data, gsize size);
+
+G_END_DECLS
+
+#endif /* __BENCH_UTILS_H__ */
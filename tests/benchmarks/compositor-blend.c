@@ -0,0 +1,154 @@
+/* GStreamer
+ *
+ * compositor-blend.c - Measure the throughput of compositor blending
+ * several overlapping inputs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Blends --inputs translucent videotestsrc streams, each shifted by an
+ * eighth of the frame, into one output:
+ *
+ *   compositor-blend --inputs 4 --frames 300 --width 1280 --height 720
+ */
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include "benchutils.h"
+
+static gint inputs = 4;
+static gint frames = 300;
+static gint width = 1280;
+static gint height = 720;
+static gchar *format = NULL;
+static gint runs = 3;
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"inputs", 'n', 0, G_OPTION_ARG_INT, &inputs, "Number of inputs", "N"},
+    {"frames", 'f', 0, G_OPTION_ARG_INT, &frames, "Number of frames", "N"},
+    {"width", 'w', 0, G_OPTION_ARG_INT, &width, "Frame width", "PIXELS"},
+    {"height", 'h', 0, G_OPTION_ARG_INT, &height, "Frame height", "PIXELS"},
+    {"format", 0, 0, G_OPTION_ARG_STRING, &format,
+        "Video format (default AYUV)", "FORMAT"},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Number of runs", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstVideoInfo info;
+  guint64 input_bytes;
+  gchar *params;
+  gint run, i;
+
+  ctx = g_option_context_new ("- compositor benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (!format)
+    format = g_strdup ("AYUV");
+
+  if (inputs < 1 || frames < 1 || width < 16 || height < 16 ||
+      gst_video_format_from_string (format) == GST_VIDEO_FORMAT_UNKNOWN) {
+    g_printerr ("Invalid options\n");
+    return 1;
+  }
+
+  gst_video_info_set_format (&info, gst_video_format_from_string (format),
+      width, height);
+  input_bytes = (guint64) GST_VIDEO_INFO_SIZE (&info) * frames * inputs;
+  params = g_strdup_printf ("\"inputs\": %d, \"frames\": %d, "
+      "\"width\": %d, \"height\": %d, \"format\": \"%s\"", inputs, frames,
+      width, height, format);
+
+  for (run = 0; run < runs; run++) {
+    BenchCounter counter = { 0, };
+    GstElement *pipeline, *comp, *sink;
+    GstCaps *caps;
+    GstPad *pad;
+    GstClockTime elapsed;
+
+    pipeline = gst_pipeline_new (NULL);
+    comp = gst_element_factory_make ("compositor", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+    if (!comp || !sink) {
+      g_printerr ("Missing elements\n");
+      return 1;
+    }
+    g_object_set (sink, "sync", FALSE, NULL);
+    gst_bin_add_many (GST_BIN (pipeline), comp, sink, NULL);
+    gst_element_link (comp, sink);
+
+    caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING,
+        format, "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+        "framerate", GST_TYPE_FRACTION, 30, 1, NULL);
+
+    for (i = 0; i < inputs; i++) {
+      GstElement *src, *filter;
+      GstPad *srcpad, *sinkpad;
+
+      src = gst_element_factory_make ("videotestsrc", NULL);
+      filter = gst_element_factory_make ("capsfilter", NULL);
+      if (!src || !filter) {
+        g_printerr ("Missing elements\n");
+        return 1;
+      }
+      /* fixed patterns only, so every run blends the same pixels */
+      g_object_set (src, "num-buffers", frames, "pattern", i % 2 ? 18 : 0,
+          NULL);
+      g_object_set (filter, "caps", caps, NULL);
+      gst_bin_add_many (GST_BIN (pipeline), src, filter, NULL);
+      gst_element_link (src, filter);
+
+      sinkpad = gst_element_get_request_pad (comp, "sink_%u");
+      g_object_set (sinkpad, "xpos", i * width / 8, "ypos", i * height / 8,
+          "alpha", i > 0 ? 0.7 : 1.0, NULL);
+      srcpad = gst_element_get_static_pad (filter, "src");
+      gst_pad_link (srcpad, sinkpad);
+      gst_object_unref (srcpad);
+      gst_object_unref (sinkpad);
+    }
+    gst_caps_unref (caps);
+
+    pad = gst_element_get_static_pad (comp, "src");
+    bench_count_pad (pad, &counter);
+    gst_object_unref (pad);
+
+    elapsed = bench_run_pipeline (pipeline);
+    gst_object_unref (pipeline);
+
+    if (!GST_CLOCK_TIME_IS_VALID (elapsed))
+      return 1;
+
+    bench_print_result ("compositor-blend", elapsed, &counter, input_bytes,
+        params);
+  }
+
+  g_free (params);
+  g_free (format);
+
+  return 0;
+}
@@ -0,0 +1,172 @@
+/* GStreamer
+ *
+ * compositor-kernels.c - Compare the hand-written compositor blend kernels
+ * with the ORC programs they replace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Blends a random frame onto another with each blend loop, once with the
+ * ORC program and once with the AVX2/NEON kernel picked for this CPU, and
+ * checks that both give the same pixels:
+ *
+ *   compositor-kernels --width 1920 --height 1080 --iterations 100
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+
+#include "benchutils.h"
+#include "blendsimd.h"
+#include "compositororc-dist.h"
+
+static gint width = 1920;
+static gint height = 1080;
+static gint alpha = 160;
+static gint iterations = 100;
+static gint runs = 3;
+
+typedef struct
+{
+  const gchar *name;
+  /* bytes per pixel, the loops are given the width in bytes for u8 */
+  gint bpp;
+  BlendLoopFunction orc;
+  BlendLoopFunction simd;
+} Kernel;
+
+static GstClockTime
+time_kernel (BlendLoopFunction func, const Kernel * kernel, guint8 * dest,
+    const guint8 * src)
+{
+  GstClockTime start;
+  gint stride = width * 4;
+  gint n = kernel->bpp == 1 ? width * 4 : width;
+  gint i;
+
+  start = gst_util_get_timestamp ();
+  for (i = 0; i < iterations; i++)
+    func (dest, stride, src, stride, alpha, n, height);
+
+  return gst_util_get_timestamp () - start;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"width", 'w', 0, G_OPTION_ARG_INT, &width, "Frame width", "PIXELS"},
+    {"height", 'h', 0, G_OPTION_ARG_INT, &height, "Frame height", "PIXELS"},
+    {"alpha", 'a', 0, G_OPTION_ARG_INT, &alpha, "Global alpha", "0-255"},
+    {"iterations", 'i', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of blends per run", "N"},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Number of runs", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  BlendKernels simd;
+  const gchar *simd_name;
+  Kernel kernels[] = {
+    {"blend_u8", 1, compositor_orc_blend_u8, NULL},
+    {"blend_argb", 4, compositor_orc_blend_argb, NULL},
+    {"blend_bgra", 4, compositor_orc_blend_bgra, NULL},
+  };
+  GRand *rand;
+  guint8 *src, *dest, *orc_dest, *simd_dest;
+  gsize size;
+  gint run, k;
+  gint ret = 0;
+
+  ctx = g_option_context_new ("- compositor kernel benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (width < 1 || height < 1 || alpha < 0 || alpha > 255 || iterations < 1) {
+    g_printerr ("Invalid options\n");
+    return 1;
+  }
+
+  simd_name = compositor_blend_get_simd_kernels (&simd);
+  if (!simd_name) {
+    g_printerr ("No blend kernels for this CPU, only ORC is used\n");
+    return 1;
+  }
+
+  kernels[0].simd = simd.blend_u8;
+  kernels[1].simd = simd.blend_argb;
+  kernels[2].simd = simd.blend_bgra;
+
+  /* every loop blends width * 4 bytes per line */
+  size = (gsize) width * 4 * height;
+  rand = g_rand_new_with_seed (BENCH_SEED);
+  src = g_malloc (size);
+  dest = g_malloc (size);
+  orc_dest = g_malloc (size);
+  simd_dest = g_malloc (size);
+  bench_fill_random (rand, src, size);
+  bench_fill_random (rand, dest, size);
+  g_rand_free (rand);
+
+  for (k = 0; k < G_N_ELEMENTS (kernels); k++) {
+    gboolean identical;
+
+    memcpy (orc_dest, dest, size);
+    memcpy (simd_dest, dest, size);
+    time_kernel (kernels[k].orc, &kernels[k], orc_dest, src);
+    time_kernel (kernels[k].simd, &kernels[k], simd_dest, src);
+    identical = memcmp (orc_dest, simd_dest, size) == 0;
+
+    for (run = 0; run < runs; run++) {
+      GstClockTime orc_time, simd_time;
+
+      memcpy (orc_dest, dest, size);
+      orc_time = time_kernel (kernels[k].orc, &kernels[k], orc_dest, src);
+      memcpy (simd_dest, dest, size);
+      simd_time = time_kernel (kernels[k].simd, &kernels[k], simd_dest, src);
+
+      g_print ("{\"benchmark\": \"compositor-kernels\", \"kernel\": \"%s\", "
+          "\"simd\": \"%s\", \"width\": %d, \"height\": %d, "
+          "\"iterations\": %d, \"orc-ns\": %" G_GUINT64_FORMAT ", "
+          "\"simd-ns\": %" G_GUINT64_FORMAT ", \"speedup\": %.2f, "
+          "\"identical\": %s}\n", kernels[k].name, simd_name, width, height,
+          iterations, orc_time, simd_time,
+          simd_time ? (gdouble) orc_time / simd_time : 0.0,
+          identical ? "true" : "false");
+    }
+
+    if (!identical) {
+      g_printerr ("%s: the %s kernel and ORC disagree\n", kernels[k].name,
+          simd_name);
+      ret = 1;
+      break;
+    }
+  }
+
+  g_free (src);
+  g_free (dest);
+  g_free (orc_dest);
+  g_free (simd_dest);
+
+  return ret;
+}
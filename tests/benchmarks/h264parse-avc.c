@@ -0,0 +1,206 @@
+/* GStreamer
+ *
+ * h264parse-avc.c - Measure the throughput of h264parse converting
+ * byte-stream to avc
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Generates an unaligned byte-stream of access units and has h264parse
+ * convert it to avc with au alignment:
+ *
+ *   h264parse-avc --frames 5000 --frame-size 8192 --chunk-size 4096
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+
+#include "benchutils.h"
+
+/* parameter sets and slice header from the h264parse unit test */
+static const guint8 h264_aud[] = {
+  0x00, 0x00, 0x00, 0x01, 0x09, 0xf0
+};
+
+static const guint8 h264_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x4d, 0x40, 0x15,
+  0xec, 0xa4, 0xbf, 0x2e, 0x02, 0x20, 0x00, 0x00,
+  0x03, 0x00, 0x2e, 0xe6, 0xb2, 0x80, 0x01, 0xe2,
+  0xc5, 0xb2, 0xc0
+};
+
+static const guint8 h264_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xeb, 0xec, 0xb2
+};
+
+static const guint8 h264_idr_header[] = {
+  0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00,
+  0x10, 0xff, 0xfe, 0xf6, 0xf0, 0xfe, 0x05, 0x36
+};
+
+static gint frames = 5000;
+static gint frame_size = 8192;
+static gint chunk_size = 4096;
+static gint gop_size = 30;
+static gint runs = 3;
+
+static GByteArray *
+generate_byte_stream (void)
+{
+  GByteArray *stream = g_byte_array_new ();
+  GRand *rand = g_rand_new_with_seed (BENCH_SEED);
+  guint8 *payload = g_malloc (frame_size);
+  gint f;
+
+  for (f = 0; f < frames; f++) {
+    g_byte_array_append (stream, h264_aud, sizeof (h264_aud));
+    if (f % gop_size == 0) {
+      g_byte_array_append (stream, h264_sps, sizeof (h264_sps));
+      g_byte_array_append (stream, h264_pps, sizeof (h264_pps));
+    }
+    g_byte_array_append (stream, h264_idr_header, sizeof (h264_idr_header));
+    bench_fill_random (rand, payload, frame_size);
+    g_byte_array_append (stream, payload, frame_size);
+  }
+
+  g_free (payload);
+  g_rand_free (rand);
+
+  return stream;
+}
+
+typedef struct
+{
+  GstBuffer *input;
+  gsize offset;
+} FeedContext;
+
+static void
+need_data (GstAppSrc * src, guint length, gpointer user_data)
+{
+  FeedContext *feed = user_data;
+  gsize size = gst_buffer_get_size (feed->input);
+  gsize n = MIN (chunk_size, size - feed->offset);
+
+  if (n == 0) {
+    gst_app_src_end_of_stream (src);
+    return;
+  }
+
+  gst_app_src_push_buffer (src, gst_buffer_copy_region (feed->input,
+          GST_BUFFER_COPY_MEMORY, feed->offset, n));
+  feed->offset += n;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"frames", 'f', 0, G_OPTION_ARG_INT, &frames, "Number of frames", "N"},
+    {"frame-size", 's', 0, G_OPTION_ARG_INT, &frame_size,
+        "Size of the frames in bytes", "BYTES"},
+    {"chunk-size", 'c', 0, G_OPTION_ARG_INT, &chunk_size,
+        "Size of the input buffers in bytes", "BYTES"},
+    {"gop-size", 'g', 0, G_OPTION_ARG_INT, &gop_size,
+        "Frames between parameter sets", "N"},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Number of runs", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GByteArray *stream;
+  GstBuffer *input;
+  gchar *params;
+  gint run;
+
+  ctx = g_option_context_new ("- h264parse benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (frames < 1 || frame_size < 1 || chunk_size < 1 || gop_size < 1) {
+    g_printerr ("Invalid options\n");
+    return 1;
+  }
+
+  stream = generate_byte_stream ();
+  input = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      stream->data, stream->len, 0, stream->len, NULL, NULL);
+  params = g_strdup_printf ("\"frames\": %d, \"frame-size\": %d, "
+      "\"chunk-size\": %d", frames, frame_size, chunk_size);
+
+  for (run = 0; run < runs; run++) {
+    BenchCounter counter = { 0, };
+    FeedContext feed = { input, 0 };
+    GstAppSrcCallbacks callbacks = { need_data, NULL, NULL };
+    GstElement *pipeline, *src, *parse, *filter, *sink;
+    GstCaps *caps;
+    GstPad *pad;
+    GstClockTime elapsed;
+
+    pipeline = gst_pipeline_new (NULL);
+    src = gst_element_factory_make ("appsrc", NULL);
+    parse = gst_element_factory_make ("h264parse", NULL);
+    filter = gst_element_factory_make ("capsfilter", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+    if (!src || !parse || !filter || !sink) {
+      g_printerr ("Missing elements\n");
+      return 1;
+    }
+
+    caps = gst_caps_new_simple ("video/x-h264", "stream-format",
+        G_TYPE_STRING, "byte-stream", NULL);
+    g_object_set (src, "caps", caps, "format", GST_FORMAT_BYTES, NULL);
+    gst_caps_unref (caps);
+    gst_app_src_set_callbacks (GST_APP_SRC (src), &callbacks, &feed, NULL);
+
+    caps = gst_caps_new_simple ("video/x-h264", "stream-format",
+        G_TYPE_STRING, "avc", "alignment", G_TYPE_STRING, "au", NULL);
+    g_object_set (filter, "caps", caps, NULL);
+    gst_caps_unref (caps);
+
+    g_object_set (sink, "sync", FALSE, NULL);
+
+    gst_bin_add_many (GST_BIN (pipeline), src, parse, filter, sink, NULL);
+    gst_element_link_many (src, parse, filter, sink, NULL);
+
+    pad = gst_element_get_static_pad (parse, "src");
+    bench_count_pad (pad, &counter);
+    gst_object_unref (pad);
+
+    elapsed = bench_run_pipeline (pipeline);
+    gst_object_unref (pipeline);
+
+    if (!GST_CLOCK_TIME_IS_VALID (elapsed))
+      return 1;
+
+    bench_print_result ("h264parse-avc", elapsed, &counter, stream->len,
+        params);
+  }
+
+  g_free (params);
+  gst_buffer_unref (input);
+  g_byte_array_unref (stream);
+
+  return 0;
+}
@@ -0,0 +1,350 @@
+/* GStreamer
+ *
+ * tsdemux-mpts.c - Measure the throughput of tsdemux on a multi program
+ * transport stream
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Generates a transport stream with --programs programs of one H.264 stream
+ * each, with PAT, PMTs and PCRs, and demuxes one of its programs as fast as
+ * possible:
+ *
+ *   tsdemux-mpts --programs 16 --frames 500 --frame-size 16384 --runs 5
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+
+#include "benchutils.h"
+
+#define TS_PACKET_LEN 188
+#define PMT_PID_BASE 0x20
+#define VIDEO_PID_BASE 0x100
+/* the PAT and PMTs are repeated every this many PES packets */
+#define PSI_INTERVAL 40
+/* input buffers, as if read from a file or socket */
+#define CHUNK_SIZE (TS_PACKET_LEN * 7 * 32)
+
+static gint programs = 8;
+static gint frames = 500;
+static gint frame_size = 16384;
+static gint program_number = 1;
+static gint runs = 3;
+
+typedef struct
+{
+  GByteArray *ts;
+  guint8 cc[0x2000];
+} TsGenerator;
+
+static guint32
+mpeg_crc32 (const guint8 * data, gsize size)
+{
+  guint32 crc = 0xffffffff;
+  gsize i;
+  gint j;
+
+  for (i = 0; i < size; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+/* packetizes @data on @pid, starting a new unit, with a PCR in the first
+ * packet if @pcr is not -1 */
+static void
+ts_write (TsGenerator * gen, guint16 pid, const guint8 * data, gsize size,
+    gint64 pcr)
+{
+  gboolean first = TRUE;
+
+  while (size > 0) {
+    guint8 pkt[TS_PACKET_LEN];
+    guint af_len = 0, space, n;
+
+    /* adaptation field length byte, flags and PCR */
+    if (first && pcr >= 0)
+      af_len = 8;
+    space = TS_PACKET_LEN - 4 - af_len;
+    n = MIN (size, space);
+    /* stuff the last packet through the adaptation field */
+    af_len += space - n;
+
+    pkt[0] = 0x47;
+    pkt[1] = (first ? 0x40 : 0x00) | ((pid >> 8) & 0x1f);
+    pkt[2] = pid & 0xff;
+    pkt[3] = (af_len ? 0x30 : 0x10) | (gen->cc[pid]++ & 0x0f);
+
+    if (af_len > 0) {
+      guint8 *af = pkt + 4;
+
+      af[0] = af_len - 1;
+      if (af_len > 1) {
+        memset (af + 1, 0xff, af_len - 1);
+        af[1] = 0x00;
+        if (first && pcr >= 0) {
+          af[1] = 0x10;
+          af[2] = pcr >> 25;
+          af[3] = pcr >> 17;
+          af[4] = pcr >> 9;
+          af[5] = pcr >> 1;
+          af[6] = ((pcr & 1) << 7) | 0x7e;
+          af[7] = 0x00;
+        }
+      }
+    }
+    memcpy (pkt + 4 + af_len, data, n);
+    g_byte_array_append (gen->ts, pkt, TS_PACKET_LEN);
+
+    data += n;
+    size -= n;
+    first = FALSE;
+  }
+}
+
+/* writes a PSI section in a packet of its own */
+static void
+ts_write_section (TsGenerator * gen, guint16 pid, guint8 * section,
+    gsize size)
+{
+  guint8 payload[TS_PACKET_LEN - 4];
+  guint32 crc = mpeg_crc32 (section, size - 4);
+
+  GST_WRITE_UINT32_BE (section + size - 4, crc);
+
+  memset (payload, 0xff, sizeof (payload));
+  payload[0] = 0;               /* pointer_field */
+  memcpy (payload + 1, section, size);
+  ts_write (gen, pid, payload, sizeof (payload), -1);
+}
+
+static void
+ts_write_psi (TsGenerator * gen)
+{
+  guint8 section[TS_PACKET_LEN];
+  gsize len;
+  gint i;
+
+  /* PAT */
+  len = 5 + 4 * programs + 4;
+  section[0] = 0x00;
+  section[1] = 0xb0 | (len >> 8);
+  section[2] = len & 0xff;
+  GST_WRITE_UINT16_BE (section + 3, 1);
+  section[5] = 0xc1;
+  section[6] = section[7] = 0;
+  for (i = 0; i < programs; i++) {
+    GST_WRITE_UINT16_BE (section + 8 + 4 * i, i + 1);
+    GST_WRITE_UINT16_BE (section + 10 + 4 * i, 0xe000 | (PMT_PID_BASE + i));
+  }
+  ts_write_section (gen, 0, section, 3 + len);
+
+  /* PMTs, one H.264 stream each that also carries the PCR */
+  for (i = 0; i < programs; i++) {
+    len = 9 + 5 + 4;
+    section[0] = 0x02;
+    section[1] = 0xb0 | (len >> 8);
+    section[2] = len & 0xff;
+    GST_WRITE_UINT16_BE (section + 3, i + 1);
+    section[5] = 0xc1;
+    section[6] = section[7] = 0;
+    GST_WRITE_UINT16_BE (section + 8, 0xe000 | (VIDEO_PID_BASE + i));
+    GST_WRITE_UINT16_BE (section + 10, 0xf000);
+    section[12] = 0x1b;
+    GST_WRITE_UINT16_BE (section + 13, 0xe000 | (VIDEO_PID_BASE + i));
+    GST_WRITE_UINT16_BE (section + 15, 0xf000);
+    ts_write_section (gen, PMT_PID_BASE + i, section, 3 + len);
+  }
+}
+
+static GByteArray *
+generate_mpts (void)
+{
+  static const guint8 aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+  TsGenerator gen = { NULL, };
+  GRand *rand = g_rand_new_with_seed (BENCH_SEED);
+  gsize pes_size = 14 + sizeof (aud) + frame_size;
+  guint8 *pes = g_malloc (pes_size);
+  gint f, p, n = 0;
+
+  gen.ts = g_byte_array_new ();
+
+  for (f = 0; f < frames; f++) {
+    /* 25 fps, and a PCR half a second ahead */
+    guint64 pts = 90000 + f * 3600;
+
+    for (p = 0; p < programs; p++, n++) {
+      if (n % PSI_INTERVAL == 0)
+        ts_write_psi (&gen);
+
+      GST_WRITE_UINT32_BE (pes, 0x000001e0);
+      GST_WRITE_UINT16_BE (pes + 4, 0);
+      pes[6] = 0x80;
+      pes[7] = 0x80;
+      pes[8] = 5;
+      pes[9] = ((pts >> 29) & 0x0e) | 0x21;
+      pes[10] = pts >> 22;
+      pes[11] = ((pts >> 14) & 0xfe) | 0x01;
+      pes[12] = pts >> 7;
+      pes[13] = ((pts << 1) & 0xfe) | 0x01;
+      memcpy (pes + 14, aud, sizeof (aud));
+      bench_fill_random (rand, pes + 14 + sizeof (aud), frame_size);
+
+      ts_write (&gen, VIDEO_PID_BASE + p, pes, pes_size, pts - 45000);
+    }
+  }
+
+  g_free (pes);
+  g_rand_free (rand);
+
+  return gen.ts;
+}
+
+typedef struct
+{
+  GstBuffer *input;
+  gsize offset;
+} FeedContext;
+
+static void
+need_data (GstAppSrc * src, guint length, gpointer user_data)
+{
+  FeedContext *feed = user_data;
+  gsize size = gst_buffer_get_size (feed->input);
+  gsize n = MIN (CHUNK_SIZE, size - feed->offset);
+
+  if (n == 0) {
+    gst_app_src_end_of_stream (src);
+    return;
+  }
+
+  gst_app_src_push_buffer (src, gst_buffer_copy_region (feed->input,
+          GST_BUFFER_COPY_MEMORY, feed->offset, n));
+  feed->offset += n;
+}
+
+static void
+pad_added (GstElement * demux, GstPad * pad, gpointer user_data)
+{
+  BenchCounter *counter = user_data;
+  GstElement *pipeline = GST_ELEMENT (gst_element_get_parent (demux));
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad;
+
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (pipeline);
+
+  bench_count_pad (pad, counter);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"programs", 'p', 0, G_OPTION_ARG_INT, &programs,
+        "Number of programs (1-32)", "N"},
+    {"frames", 'f', 0, G_OPTION_ARG_INT, &frames,
+        "Number of frames per program", "N"},
+    {"frame-size", 's', 0, G_OPTION_ARG_INT, &frame_size,
+        "Size of the frames in bytes", "BYTES"},
+    {"program-number", 0, 0, G_OPTION_ARG_INT, &program_number,
+        "Program to demux", "N"},
+    {"runs", 'r', 0, G_OPTION_ARG_INT, &runs, "Number of runs", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GByteArray *ts;
+  GstBuffer *input;
+  gchar *params;
+  gint run;
+
+  ctx = g_option_context_new ("- tsdemux benchmark");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (programs < 1 || programs > 32 || frames < 1 || frame_size < 1 ||
+      program_number < 1 || program_number > programs) {
+    g_printerr ("Invalid options\n");
+    return 1;
+  }
+
+  ts = generate_mpts ();
+  input = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, ts->data,
+      ts->len, 0, ts->len, NULL, NULL);
+  params = g_strdup_printf ("\"programs\": %d, \"frames\": %d, "
+      "\"frame-size\": %d", programs, frames, frame_size);
+
+  for (run = 0; run < runs; run++) {
+    BenchCounter counter = { 0, };
+    FeedContext feed = { input, 0 };
+    GstAppSrcCallbacks callbacks = { need_data, NULL, NULL };
+    GstElement *pipeline, *src, *demux;
+    GstCaps *caps;
+    GstClockTime elapsed;
+
+    pipeline = gst_pipeline_new (NULL);
+    src = gst_element_factory_make ("appsrc", NULL);
+    demux = gst_element_factory_make ("tsdemux", NULL);
+    if (!src || !demux) {
+      g_printerr ("Missing elements\n");
+      return 1;
+    }
+
+    caps = gst_caps_new_simple ("video/mpegts", "systemstream",
+        G_TYPE_BOOLEAN, TRUE, "packetsize", G_TYPE_INT, TS_PACKET_LEN, NULL);
+    g_object_set (src, "caps", caps, "format", GST_FORMAT_BYTES, NULL);
+    gst_caps_unref (caps);
+    gst_app_src_set_callbacks (GST_APP_SRC (src), &callbacks, &feed, NULL);
+
+    g_object_set (demux, "program-number", program_number, NULL);
+    g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added), &counter);
+
+    gst_bin_add_many (GST_BIN (pipeline), src, demux, NULL);
+    gst_element_link (src, demux);
+
+    elapsed = bench_run_pipeline (pipeline);
+    gst_object_unref (pipeline);
+
+    if (!GST_CLOCK_TIME_IS_VALID (elapsed))
+      return 1;
+
+    bench_print_result ("tsdemux-mpts", elapsed, &counter, ts->len, params);
+  }
+
+  g_free (params);
+  gst_buffer_unref (input);
+  g_byte_array_unref (ts);
+
+  return 0;
+}
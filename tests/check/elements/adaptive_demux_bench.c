@@ -0,0 +1,518 @@
+/* Throughput benchmark for elements based upon GstAdaptiveDemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Runs a number of dashdemux or hlsdemux elements concurrently, each
+ * playing a synthetic multi-bitrate presentation served by the test HTTP
+ * source, and prints one JSON object with:
+ *
+ *  - manifest-ms: time from the end of the last manifest or playlist
+ *    download to the request of the first fragment, i.e. manifest parsing
+ *    and stream setup
+ *  - switch-ms: time from the end of a fragment download to the request of
+ *    the next fragment of the same stream
+ *  - switches: the number of representation/variant changes
+ *  - kib-per-stream: growth of the peak resident memory per demuxer
+ *  - cpu-ms-per-mbit: process CPU time per Mbit of fragment data
+ *
+ * It is not part of the test suite, run it as
+ *
+ *   GST_PLUGIN_PATH=... elements/adaptive_demux_bench --format=hls -n 32
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include "adaptive_demux_common.h"
+
+#ifdef G_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#define TS_PACKET_LEN 188
+/* fragments are served in blocks of whole TS packets, from a payload that
+ * is a multiple of the block size so that no block has to be copied */
+#define BENCH_BLOCKSIZE (TS_PACKET_LEN * 64)
+#define BENCH_PAYLOAD_SIZE (BENCH_BLOCKSIZE * 16)
+
+static gchar *opt_format = NULL;
+static gint opt_demuxers = 8;
+static gint opt_representations = 4;
+static gint opt_fragments = 10;
+static gint opt_fragment_duration = 2;
+static gint opt_min_bitrate = 500000;
+
+static GOptionEntry bench_options[] = {
+  {"format", 'f', 0, G_OPTION_ARG_STRING, &opt_format,
+      "Presentation format, dash or hls (default dash)", "FORMAT"},
+  {"demuxers", 'n', 0, G_OPTION_ARG_INT, &opt_demuxers,
+      "Number of concurrent demuxers", "N"},
+  {"representations", 'r', 0, G_OPTION_ARG_INT, &opt_representations,
+      "Number of bitrates, doubling from the minimum", "N"},
+  {"fragments", 's', 0, G_OPTION_ARG_INT, &opt_fragments,
+      "Number of fragments per stream", "N"},
+  {"fragment-duration", 'd', 0, G_OPTION_ARG_INT, &opt_fragment_duration,
+      "Fragment duration in seconds", "SECONDS"},
+  {"min-bitrate", 'b', 0, G_OPTION_ARG_INT, &opt_min_bitrate,
+      "Lowest bitrate in bits per second", "BPS"},
+  {NULL}
+};
+
+typedef enum
+{
+  BENCH_REQUEST_MANIFEST,
+  BENCH_REQUEST_PLAYLIST,
+  BENCH_REQUEST_FRAGMENT
+} BenchRequestType;
+
+typedef struct _Bench Bench;
+
+typedef struct
+{
+  Bench *bench;
+  guint index;
+  GstAdaptiveDemuxTestEngine *engine;
+  gboolean finished;
+
+  gint64 manifest_done;
+  gint64 first_fragment;
+  gint64 fragment_done;
+  gint current_representation;
+} BenchDemux;
+
+typedef struct
+{
+  BenchDemux *demux;
+  BenchRequestType type;
+  gint representation;
+  gchar *text;
+  guint64 size;
+} BenchRequest;
+
+struct _Bench
+{
+  gboolean hls;
+  GMainLoop *loop;
+  BenchDemux *demuxers;
+  guint n_finished;
+
+  guint8 *payload;
+
+  /* protects everything below, updated from the streaming threads */
+  GMutex lock;
+  GPtrArray *requests;
+  guint64 bytes;
+  guint n_switch;
+  gdouble switch_sum;
+  gdouble switch_max;
+  guint n_manifest;
+  gdouble manifest_sum;
+  gdouble manifest_max;
+  guint switches;
+};
+
+static guint
+bench_bitrate (gint representation)
+{
+  return (guint) opt_min_bitrate << representation;
+}
+
+static guint64
+bench_fragment_size (gint representation)
+{
+  guint64 size = (guint64) bench_bitrate (representation) *
+      opt_fragment_duration / 8;
+
+  return MAX (GST_ROUND_UP_N (size, TS_PACKET_LEN), TS_PACKET_LEN);
+}
+
+static gchar *
+bench_dash_manifest (void)
+{
+  GString *mpd = g_string_new (NULL);
+  gint r;
+
+  g_string_append_printf (mpd,
+      "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+      "<MPD xmlns=\"urn:mpeg:DASH:schema:MPD:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"static\""
+      "     minBufferTime=\"PT%dS\""
+      "     mediaPresentationDuration=\"PT%dS\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/webm\" segmentAlignment=\"true\">"
+      "      <SegmentTemplate timescale=\"1\" duration=\"%d\""
+      "                       startNumber=\"0\""
+      "                       media=\"v$RepresentationID$/$Number$.webm\"/>",
+      opt_fragment_duration, opt_fragments * opt_fragment_duration,
+      opt_fragment_duration);
+  for (r = 0; r < opt_representations; r++) {
+    g_string_append_printf (mpd,
+        "      <Representation id=\"%d\" codecs=\"vp9\" bandwidth=\"%u\""
+        "                      width=\"%d\" height=\"%d\"/>", r,
+        bench_bitrate (r), 320 << MIN (r, 4), 180 << MIN (r, 4));
+  }
+  g_string_append (mpd, "    </AdaptationSet>  </Period></MPD>");
+
+  return g_string_free (mpd, FALSE);
+}
+
+static gchar *
+bench_hls_master_playlist (void)
+{
+  GString *m3u8 = g_string_new ("#EXTM3U\n");
+  gint r;
+
+  for (r = 0; r < opt_representations; r++) {
+    g_string_append_printf (m3u8,
+        "#EXT-X-STREAM-INF:PROGRAM-ID=1,BANDWIDTH=%u\nv%d/index.m3u8\n",
+        bench_bitrate (r), r);
+  }
+
+  return g_string_free (m3u8, FALSE);
+}
+
+static gchar *
+bench_hls_media_playlist (void)
+{
+  GString *m3u8 = g_string_new (NULL);
+  gint i;
+
+  g_string_append_printf (m3u8, "#EXTM3U\n#EXT-X-TARGETDURATION:%d\n"
+      "#EXT-X-MEDIA-SEQUENCE:0\n", opt_fragment_duration);
+  for (i = 0; i < opt_fragments; i++)
+    g_string_append_printf (m3u8, "#EXTINF:%d.0,\n%d.ts\n",
+        opt_fragment_duration, i);
+  g_string_append (m3u8, "#EXT-X-ENDLIST\n");
+
+  return g_string_free (m3u8, FALSE);
+}
+
+static gdouble
+bench_elapsed_ms (gint64 start, gint64 end)
+{
+  return (end - start) / 1000.0;
+}
+
+static gboolean
+bench_http_src_start (GstTestHTTPSrc * src, const gchar * uri,
+    GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  Bench *bench = user_data;
+  BenchRequest *request;
+  BenchDemux *demux;
+  gint64 now = g_get_monotonic_time ();
+  guint index;
+  gint representation = -1, number;
+  gchar *name;
+
+  name = g_malloc (strlen (uri) + 1);
+  if (sscanf (uri, "http://bench/%u/%s", &index, name) != 2 ||
+      index >= (guint) opt_demuxers) {
+    g_free (name);
+    return FALSE;
+  }
+  demux = &bench->demuxers[index];
+
+  request = g_new0 (BenchRequest, 1);
+  request->demux = demux;
+
+  if (g_str_has_prefix (name, "manifest.")) {
+    request->type = BENCH_REQUEST_MANIFEST;
+    request->text = bench->hls ? bench_hls_master_playlist () :
+        bench_dash_manifest ();
+  } else if (sscanf (name, "v%d/%d.", &representation, &number) == 2) {
+    request->type = BENCH_REQUEST_FRAGMENT;
+    request->representation = representation;
+    request->size = bench_fragment_size (representation);
+  } else if (sscanf (name, "v%d/index.m3u8", &representation) == 1) {
+    request->type = BENCH_REQUEST_PLAYLIST;
+    request->representation = representation;
+    request->text = bench_hls_media_playlist ();
+  } else {
+    g_free (request);
+    g_free (name);
+    return FALSE;
+  }
+  g_free (name);
+
+  if (request->text)
+    request->size = strlen (request->text);
+
+  g_mutex_lock (&bench->lock);
+  g_ptr_array_add (bench->requests, request);
+  if (request->type == BENCH_REQUEST_FRAGMENT) {
+    if (demux->first_fragment == 0) {
+      gdouble ms = bench_elapsed_ms (demux->manifest_done, now);
+
+      demux->first_fragment = now;
+      bench->n_manifest++;
+      bench->manifest_sum += ms;
+      bench->manifest_max = MAX (bench->manifest_max, ms);
+    } else if (demux->fragment_done) {
+      gdouble ms = bench_elapsed_ms (demux->fragment_done, now);
+
+      bench->n_switch++;
+      bench->switch_sum += ms;
+      bench->switch_max = MAX (bench->switch_max, ms);
+    }
+    if (demux->current_representation != representation) {
+      if (demux->current_representation >= 0)
+        bench->switches++;
+      demux->current_representation = representation;
+    }
+  }
+  g_mutex_unlock (&bench->lock);
+
+  input_data->context = request;
+  input_data->size = request->size;
+
+  return TRUE;
+}
+
+static GstFlowReturn
+bench_http_src_create (GstTestHTTPSrc * src, guint64 offset, guint length,
+    GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  Bench *bench = user_data;
+  BenchRequest *request = context;
+
+  if (request->text) {
+    *retbuf = gst_buffer_new_allocate (NULL, length, NULL);
+    gst_buffer_fill (*retbuf, 0, request->text + offset, length);
+  } else {
+    *retbuf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+        bench->payload, BENCH_PAYLOAD_SIZE, offset % BENCH_PAYLOAD_SIZE,
+        length, NULL, NULL);
+  }
+
+  if (offset + length >= request->size) {
+    gint64 now = g_get_monotonic_time ();
+
+    g_mutex_lock (&bench->lock);
+    if (request->type == BENCH_REQUEST_FRAGMENT) {
+      request->demux->fragment_done = now;
+      bench->bytes += request->size;
+    } else {
+      request->demux->manifest_done = now;
+    }
+    g_mutex_unlock (&bench->lock);
+  }
+
+  return GST_FLOW_OK;
+}
+
+static void
+bench_demux_finished (BenchDemux * demux)
+{
+  Bench *bench = demux->bench;
+
+  if (demux->finished)
+    return;
+
+  demux->finished = TRUE;
+  if (++bench->n_finished == opt_demuxers)
+    g_main_loop_quit (bench->loop);
+}
+
+static void
+bench_appsink_eos (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, gpointer user_data)
+{
+  BenchDemux *demux = user_data;
+
+  g_mutex_lock (&demux->bench->lock);
+  bench_demux_finished (demux);
+  g_mutex_unlock (&demux->bench->lock);
+}
+
+static void
+bench_bus_error_message (GstAdaptiveDemuxTestEngine * engine,
+    GstMessage * msg, gpointer user_data)
+{
+  BenchDemux *demux = user_data;
+  GError *err = NULL;
+
+  gst_message_parse_error (msg, &err, NULL);
+  GST_WARNING ("demuxer %u failed: %s", demux->index, err->message);
+  g_error_free (err);
+
+  g_mutex_lock (&demux->bench->lock);
+  bench_demux_finished (demux);
+  g_mutex_unlock (&demux->bench->lock);
+}
+
+static void
+bench_get_usage (gdouble * cpu_ms, glong * maxrss_kib)
+{
+#ifdef G_OS_UNIX
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  *cpu_ms = usage.ru_utime.tv_sec * 1000.0 + usage.ru_utime.tv_usec / 1000.0 +
+      usage.ru_stime.tv_sec * 1000.0 + usage.ru_stime.tv_usec / 1000.0;
+  *maxrss_kib = usage.ru_maxrss;
+#else
+  *cpu_ms = 0;
+  *maxrss_kib = 0;
+#endif
+}
+
+GST_START_TEST (benchmark)
+{
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstAdaptiveDemuxTestCallbacks callbacks = { 0 };
+  Bench bench = { 0, };
+  gdouble cpu_start, cpu_end, mbit;
+  glong rss_start, rss_end;
+  gint64 start, end;
+  guint i;
+
+  bench.hls = g_strcmp0 (opt_format, "hls") == 0;
+  bench.loop = g_main_loop_new (NULL, FALSE);
+  bench.demuxers = g_new0 (BenchDemux, opt_demuxers);
+  bench.requests = g_ptr_array_new ();
+  g_mutex_init (&bench.lock);
+
+  /* null TS packets, fine for both the TS typefinding of hlsdemux and the
+   * webm streams of dashdemux that are not looked into */
+  bench.payload = g_malloc (BENCH_PAYLOAD_SIZE);
+  memset (bench.payload, 0xff, BENCH_PAYLOAD_SIZE);
+  for (i = 0; i < BENCH_PAYLOAD_SIZE; i += TS_PACKET_LEN) {
+    bench.payload[i] = 0x47;
+    bench.payload[i + 1] = 0x1f;
+    bench.payload[i + 2] = 0xff;
+    bench.payload[i + 3] = 0x10 | ((i / TS_PACKET_LEN) & 0x0f);
+  }
+
+  http_src_callbacks.src_start = bench_http_src_start;
+  http_src_callbacks.src_create = bench_http_src_create;
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &bench);
+  gst_test_http_src_set_default_blocksize (BENCH_BLOCKSIZE);
+
+  callbacks.appsink_eos = bench_appsink_eos;
+  callbacks.bus_error_message = bench_bus_error_message;
+
+  bench_get_usage (&cpu_start, &rss_start);
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < (guint) opt_demuxers; i++) {
+    BenchDemux *demux = &bench.demuxers[i];
+    gchar *uri;
+
+    demux->bench = &bench;
+    demux->index = i;
+    demux->current_representation = -1;
+
+    uri = g_strdup_printf ("http://bench/%u/manifest.%s", i,
+        bench.hls ? "m3u8" : "mpd");
+    demux->engine = gst_adaptive_demux_test_start (bench.hls ? "hlsdemux" :
+        "dashdemux", uri, &callbacks, demux, bench.loop);
+    g_free (uri);
+  }
+
+  g_main_loop_run (bench.loop);
+
+  end = g_get_monotonic_time ();
+  bench_get_usage (&cpu_end, &rss_end);
+
+  for (i = 0; i < (guint) opt_demuxers; i++)
+    gst_adaptive_demux_test_stop (bench.demuxers[i].engine);
+
+  mbit = bench.bytes * 8 / 1000000.0;
+
+  g_print ("{\"format\": \"%s\", \"demuxers\": %d, \"representations\": %d, "
+      "\"fragments\": %d, \"wall-ms\": %.3f, \"mbit\": %.3f, "
+      "\"mbit-per-s\": %.3f, \"manifest-ms\": {\"mean\": %.3f, "
+      "\"max\": %.3f}, \"switch-ms\": {\"mean\": %.3f, \"max\": %.3f}, "
+      "\"switches\": %u, \"kib-per-stream\": %.1f, "
+      "\"cpu-ms-per-mbit\": %.3f}\n",
+      bench.hls ? "hls" : "dash", opt_demuxers, opt_representations,
+      opt_fragments, bench_elapsed_ms (start, end), mbit,
+      mbit * 1000000.0 / MAX (end - start, 1),
+      bench.n_manifest ? bench.manifest_sum / bench.n_manifest : 0,
+      bench.manifest_max,
+      bench.n_switch ? bench.switch_sum / bench.n_switch : 0,
+      bench.switch_max, bench.switches,
+      (gdouble) (rss_end - rss_start) / opt_demuxers,
+      mbit > 0 ? (cpu_end - cpu_start) / mbit : 0);
+
+  for (i = 0; i < bench.requests->len; i++) {
+    BenchRequest *request = g_ptr_array_index (bench.requests, i);
+
+    g_free (request->text);
+    g_free (request);
+  }
+  g_ptr_array_unref (bench.requests);
+  g_mutex_clear (&bench.lock);
+  g_free (bench.payload);
+  g_free (bench.demuxers);
+  g_main_loop_unref (bench.loop);
+}
+
+GST_END_TEST;
+
+static Suite *
+adaptive_demux_bench_suite (void)
+{
+  Suite *s = suite_create ("adaptive_demux_bench");
+  TCase *tc_bench = tcase_create ("bench");
+
+  tcase_set_timeout (tc_bench, 0);
+  tcase_add_test (tc_bench, benchmark);
+  tcase_add_unchecked_fixture (tc_bench, gst_adaptive_demux_test_setup,
+      gst_adaptive_demux_test_teardown);
+
+  suite_add_tcase (s, tc_bench);
+
+  return s;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+
+  ctx = g_option_context_new ("- adaptive demux benchmark");
+  g_option_context_add_main_entries (ctx, bench_options, NULL);
+  g_option_context_set_ignore_unknown_options (ctx, TRUE);
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (opt_demuxers < 1 || opt_representations < 1 || opt_fragments < 1 ||
+      opt_fragment_duration < 1 || opt_min_bitrate < 1 ||
+      opt_representations > 16) {
+    g_printerr ("Invalid options\n");
+    return 1;
+  }
+
+  gst_check_init (&argc, &argv);
+
+  return gst_check_run_suite (adaptive_demux_bench_suite (),
+      "adaptive_demux_bench", __FILE__);
+}
@@ -506,13 +506,13 @@ start_pipeline_playing (gpointer user_data)
 }
 
 /*
- * Create a demux element, run a test using the input data and check
- * the output data
+ * Create a demux element and start running a test using the input data
  */
-void
-gst_adaptive_demux_test_run (const gchar * element_name,
+GstAdaptiveDemuxTestEngine *
+gst_adaptive_demux_test_start (const gchar * element_name,
     const gchar * manifest_uri,
-    const GstAdaptiveDemuxTestCallbacks * callbacks, gpointer user_data)
+    const GstAdaptiveDemuxTestCallbacks * callbacks, gpointer user_data,
+    GMainLoop * loop)
 {
   GstBus *bus;
   GstElement *demux;
@@ -528,7 +528,10 @@ gst_adaptive_demux_test_run (const gchar * element_name,
   g_mutex_init (&priv->engine.lock);
   priv->callbacks = callbacks;
   priv->user_data = user_data;
-  priv->engine.loop = g_main_loop_new (NULL, TRUE);
+  if (loop)
+    priv->engine.loop = g_main_loop_ref (loop);
+  else
+    priv->engine.loop = g_main_loop_new (NULL, TRUE);
   fail_unless (priv->engine.loop != NULL);
   GST_TEST_LOCK (priv);
   priv->engine.pipeline = gst_pipeline_new ("pipeline");
@@ -594,11 +597,27 @@ gst_adaptive_demux_test_run (const gchar * element_name,
   fail_unless (stateChange != GST_STATE_CHANGE_FAILURE);
 
   g_idle_add ((GSourceFunc) start_pipeline_playing, priv);
+  gst_object_unref (bus);
 
-  /* block until a callback calls g_main_loop_quit (engine.loop) */
-  GST_DEBUG ("main thread waiting for streams to finish");
-  g_main_loop_run (priv->engine.loop);
-  GST_DEBUG ("main thread finished. Stopping pipeline");
+  return &priv->engine;
+}
+
+/*
+ * Stop the pipeline of a test started with gst_adaptive_demux_test_start()
+ * and free the engine
+ */
+void
+gst_adaptive_demux_test_stop (GstAdaptiveDemuxTestEngine * engine)
+{
+  GstAdaptiveDemuxTestEnginePrivate *priv =
+      (GstAdaptiveDemuxTestEnginePrivate *) engine;
+  const GstAdaptiveDemuxTestCallbacks *callbacks = priv->callbacks;
+  GstElement *demux = priv->engine.demux;
+  GstStateChangeReturn stateChange;
+  GstBus *bus;
+
+  GST_DEBUG ("Stopping pipeline");
+  bus = gst_pipeline_get_bus (GST_PIPELINE (priv->engine.pipeline));
 
   /* no need to use gst_element_get_state as the move the GST_STATE_NULL
      is always synchronous */
@@ -633,3 +652,25 @@ gst_adaptive_demux_test_run (const gchar * element_name,
   g_mutex_clear (&priv->engine.lock);
   g_slice_free (GstAdaptiveDemuxTestEnginePrivate, priv);
 }
+
+/*
+ * Create a demux element, run a test using the input data and check
+ * the output data
+ */
+void
+gst_adaptive_demux_test_run (const gchar * element_name,
+    const gchar * manifest_uri,
+    const GstAdaptiveDemuxTestCallbacks * callbacks, gpointer user_data)
+{
+  GstAdaptiveDemuxTestEngine *engine;
+
+  engine = gst_adaptive_demux_test_start (element_name, manifest_uri,
+      callbacks, user_data, NULL);
+
+  /* block until a callback calls g_main_loop_quit (engine.loop) */
+  GST_DEBUG ("main thread waiting for streams to finish");
+  g_main_loop_run (engine->loop);
+  GST_DEBUG ("main thread finished. Stopping pipeline");
+
+  gst_adaptive_demux_test_stop (engine);
+}
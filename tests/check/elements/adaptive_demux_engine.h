@@ -198,5 +198,37 @@ void gst_adaptive_demux_test_run (const gchar * element_name,
     const GstAdaptiveDemuxTestCallbacks * callbacks,
     gpointer user_data);
 
+/**
+ * gst_adaptive_demux_test_start:
+ * @element_name: The name of the demux element (e.g. "dashdemux")
+ * @manifest_uri: The URI of the manifest to load
+ * @callbacks: The callbacks to use while the test is in operating
+ * @user_data: Opaque pointer that is passed to every callback
+ * @loop: (allow none): the #GMainLoop to use as
+ * GstAdaptiveDemuxTestEngine::loop, a new one is created if %NULL
+ *
+ * Like gst_adaptive_demux_test_run(), but returns as soon as the
+ * pipeline is started. The caller is responsible for running the main loop
+ * and for calling gst_adaptive_demux_test_stop(). This allows several
+ * demux elements to run concurrently on the same @loop.
+ *
+ * Returns: the #GstAdaptiveDemuxTestEngine running the test
+ */
+GstAdaptiveDemuxTestEngine * gst_adaptive_demux_test_start (
+    const gchar * element_name,
+    const gchar * manifest_uri,
+    const GstAdaptiveDemuxTestCallbacks * callbacks,
+    gpointer user_data,
+    GMainLoop * loop);
+
+/**
+ * gst_adaptive_demux_test_stop:
+ * @engine: a #GstAdaptiveDemuxTestEngine returned by
+ * gst_adaptive_demux_test_start()
+ *
+ * Stops the pipeline, calls the post_test callback and frees @engine.
+ */
+void gst_adaptive_demux_test_stop (GstAdaptiveDemuxTestEngine * engine);
+
 G_END_DECLS
 #endif /* __GST_ADAPTIVE_DEMUX_TEST_ENGINE_H__ */
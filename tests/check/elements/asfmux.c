@@ -189,6 +189,126 @@ GST_START_TEST (test_audio_pad)
 
 GST_END_TEST;
 
+#define PACKET_SIZE 1024
+#define N_FRAMES 50
+#define FRAME_DURATION (40 * GST_MSECOND)
+
+static guint n_lists;
+static guint n_short_lists;
+static guint min_list_size;
+
+static GstPadProbeReturn
+count_lists (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+  gsize size = 0;
+  guint i;
+
+  for (i = 0; i < gst_buffer_list_length (list); i++)
+    size += gst_buffer_get_size (gst_buffer_list_get (list, i));
+  if (size < min_list_size)
+    n_short_lists++;
+  n_lists++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Muxes the same video frames every time and returns the data packets it
+ * output, in order */
+static GList *
+mux_frames (guint write_size, GstClockTime write_latency)
+{
+  GstElement *asfmux;
+  GstCaps *caps;
+  GList *l, *packets = NULL;
+  guint i;
+
+  asfmux = setup_asfmux (&srcvideotemplate, "video_%u");
+  g_object_set (asfmux, "packet-size", PACKET_SIZE, "write-size", write_size,
+      "write-latency", write_latency, NULL);
+  gst_pad_add_probe (mysinkpad, GST_PAD_PROBE_TYPE_BUFFER_LIST, count_lists,
+      NULL, NULL);
+  n_lists = n_short_lists = 0;
+  min_list_size = write_size;
+
+  fail_unless (gst_element_set_state (asfmux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, asfmux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < N_FRAMES; i++) {
+    GstBuffer *buf = gst_buffer_new_and_alloc (3000);
+
+    gst_buffer_memset (buf, 0, i, 3000);
+    GST_BUFFER_TIMESTAMP (buf) = i * FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+    if (i % 10 != 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* the headers and the index have other sizes */
+  for (l = buffers; l; l = l->next) {
+    if (gst_buffer_get_size (l->data) == PACKET_SIZE)
+      packets = g_list_append (packets, gst_buffer_ref (l->data));
+  }
+
+  cleanup_asfmux (asfmux, "video_%u");
+  gst_check_drop_buffers ();
+
+  return packets;
+}
+
+/* Checks the packets are pushed in lists, and are the same packets as
+ * without gathering them */
+static void
+check_gathered_packets (guint write_size, GstClockTime write_latency)
+{
+  GList *ref, *packets, *l, *m;
+
+  ref = mux_frames (0, write_latency);
+  fail_unless_equals_int (n_lists, 0);
+  packets = mux_frames (write_size, write_latency);
+
+  fail_unless (g_list_length (ref) > 1);
+  fail_unless_equals_int (g_list_length (packets), g_list_length (ref));
+  for (l = ref, m = packets; l; l = l->next, m = m->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    fail_unless (gst_buffer_memcmp (m->data, 0, map.data, map.size) == 0);
+    gst_buffer_unmap (l->data, &map);
+  }
+  fail_unless (n_lists > 1);
+  fail_unless (n_lists < g_list_length (ref));
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (packets, (GDestroyNotify) gst_buffer_unref);
+}
+
+GST_START_TEST (test_write_size)
+{
+  /* longer than the whole stream */
+  check_gathered_packets (8 * PACKET_SIZE, 10 * GST_SECOND);
+
+  /* only the list pushed before the index is allowed to be short */
+  fail_unless (n_short_lists <= 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_write_latency)
+{
+  /* the lists are cut after 200ms worth of packets, long before they are
+   * full */
+  check_gathered_packets (1024 * PACKET_SIZE, 200 * GST_MSECOND);
+}
+
+GST_END_TEST;
+
 static Suite *
 asfmux_suite (void)
 {
@@ -196,6 +316,8 @@ asfmux_suite (void)
   TCase *tc_chain = tcase_create ("general");
   tcase_add_test (tc_chain, test_video_pad);
   tcase_add_test (tc_chain, test_audio_pad);
+  tcase_add_test (tc_chain, test_write_size);
+  tcase_add_test (tc_chain, test_write_latency);
 
   suite_add_tcase (s, tc_chain);
 
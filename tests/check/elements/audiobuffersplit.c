@@ -0,0 +1,202 @@
+/* GStreamer unit test for audiobuffersplit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/audio/audio.h>
+
+/* 20ms output buffers by default */
+#define RATE 48000
+#define SAMPLES_PER_BUFFER 960
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-raw")
+    );
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-raw")
+    );
+
+static GstElement *
+setup_audiobuffersplit (void)
+{
+  GstElement *split;
+  GstCaps *caps;
+
+  split = gst_check_setup_element ("audiobuffersplit");
+  g_object_set (split, "strict-cadence", TRUE, NULL);
+  mysrcpad = gst_check_setup_src_pad (split, &srctemplate);
+  mysinkpad = gst_check_setup_sink_pad (split, &sinktemplate);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (split,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (S16),
+      "layout", G_TYPE_STRING, "interleaved",
+      "rate", G_TYPE_INT, RATE, "channels", G_TYPE_INT, 1, NULL);
+  gst_check_setup_events (mysrcpad, split, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  return split;
+}
+
+static void
+cleanup_audiobuffersplit (GstElement * split)
+{
+  gst_check_drop_buffers ();
+  gst_element_set_state (split, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (split);
+  gst_check_teardown_sink_pad (split);
+  gst_check_teardown_element (split);
+}
+
+static GstBuffer *
+create_buffer (GstClockTime pts, guint n_samples, gint16 value, gboolean
+    discont)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gint16 *data;
+  guint i;
+
+  buffer = gst_buffer_new_allocate (NULL, n_samples * 2, NULL);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  data = (gint16 *) map.data;
+  for (i = 0; i < n_samples; i++)
+    data[i] = value;
+  gst_buffer_unmap (buffer, &map);
+
+  GST_BUFFER_PTS (buffer) = pts;
+  GST_BUFFER_DURATION (buffer) =
+      gst_util_uint64_scale (n_samples, GST_SECOND, RATE);
+  if (discont)
+    GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+
+  return buffer;
+}
+
+/* checks the nth output buffer holds a full period of @value at @pts */
+static void
+check_output_buffer (guint n, GstClockTime pts, gint16 value)
+{
+  GstBuffer *buffer = g_list_nth_data (buffers, n);
+  GstMapInfo map;
+  gint16 *data;
+  guint i;
+
+  fail_unless (buffer != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer), pts);
+
+  gst_buffer_map (buffer, &map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, SAMPLES_PER_BUFFER * 2);
+  data = (gint16 *) map.data;
+  for (i = 0; i < SAMPLES_PER_BUFFER; i++)
+    fail_unless_equals_int (data[i], value);
+  gst_buffer_unmap (buffer, &map);
+}
+
+GST_START_TEST (test_strict_cadence_gap_fill)
+{
+  GstElement *split = setup_audiobuffersplit ();
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (0,
+              SAMPLES_PER_BUFFER, 1, FALSE)), GST_FLOW_OK);
+  /* one period missing */
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          create_buffer (40 * GST_MSECOND, SAMPLES_PER_BUFFER, 2, TRUE)),
+      GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  check_output_buffer (0, 0, 1);
+  check_output_buffer (1, 20 * GST_MSECOND, 0);
+  check_output_buffer (2, 40 * GST_MSECOND, 2);
+
+  cleanup_audiobuffersplit (split);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_strict_cadence_overlap_drop)
+{
+  GstElement *split = setup_audiobuffersplit ();
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (0,
+              SAMPLES_PER_BUFFER, 1, FALSE)), GST_FLOW_OK);
+  /* starts half a period before the end of the previous one */
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          create_buffer (10 * GST_MSECOND, SAMPLES_PER_BUFFER * 3 / 2, 2,
+              TRUE)), GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  check_output_buffer (0, 0, 1);
+  check_output_buffer (1, 20 * GST_MSECOND, 2);
+
+  cleanup_audiobuffersplit (split);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_strict_cadence_long_gap)
+{
+  GstElement *split = setup_audiobuffersplit ();
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (0,
+              SAMPLES_PER_BUFFER, 1, FALSE)), GST_FLOW_OK);
+  /* an hour later, resynced instead of filled with silence */
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          create_buffer (3600 * GST_SECOND, SAMPLES_PER_BUFFER, 2, TRUE)),
+      GST_FLOW_OK);
+
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  check_output_buffer (0, 0, 1);
+  check_output_buffer (1, 3600 * GST_SECOND, 2);
+
+  cleanup_audiobuffersplit (split);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiobuffersplit_suite (void)
+{
+  Suite *s = suite_create ("audiobuffersplit");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_strict_cadence_gap_fill);
+  tcase_add_test (tc_chain, test_strict_cadence_overlap_drop);
+  tcase_add_test (tc_chain, test_strict_cadence_long_gap);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiobuffersplit);
@@ -0,0 +1,277 @@
+/* GStreamer unit test for audiochannelmix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+
+/* more than the frames mixed at a time, and not a multiple of a vector */
+#define N_FRAMES 1031
+#define N_BUFFERS 3
+
+static void
+set_matrix (GstElement * element, const gdouble * matrix, guint channels)
+{
+  GValue v = G_VALUE_INIT;
+  guint in, out;
+
+  g_value_init (&v, GST_TYPE_ARRAY);
+  for (out = 0; out < channels; out++) {
+    GValue row = G_VALUE_INIT;
+
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < channels; in++) {
+      GValue gain = G_VALUE_INIT;
+
+      g_value_init (&gain, G_TYPE_DOUBLE);
+      g_value_set_double (&gain, matrix[out * channels + in]);
+      gst_value_array_append_value (&row, &gain);
+      g_value_unset (&gain);
+    }
+    gst_value_array_append_value (&v, &row);
+    g_value_unset (&row);
+  }
+  g_object_set_property (G_OBJECT (element), "matrix", &v);
+  g_value_unset (&v);
+}
+
+static gint16
+ref_round_s16 (gfloat v)
+{
+  return rintf (CLAMP (v, -32768.0f, 32767.0f));
+}
+
+/* Every output channel summed up over all the input channels in order, in
+ * single precision */
+static void
+mix_ref (const gdouble * matrix, guint channels, gboolean is_s16,
+    gconstpointer in, gpointer out)
+{
+  guint s, i, o;
+
+  for (s = 0; s < N_FRAMES; s++) {
+    for (o = 0; o < channels; o++) {
+      gfloat acc = 0;
+
+      for (i = 0; i < channels; i++) {
+        gfloat gain = matrix[o * channels + i];
+
+        if (is_s16)
+          acc += ((const gint16 *) in)[s * channels + i] * gain;
+        else
+          acc += ((const gfloat *) in)[s * channels + i] * gain;
+      }
+      if (is_s16)
+        ((gint16 *) out)[s * channels + o] = ref_round_s16 (acc);
+      else
+        ((gfloat *) out)[s * channels + o] = acc;
+    }
+  }
+}
+
+/* The front pair mixed on its own, a * ll + b * rl and a * lr + b * rr */
+static void
+mix_pair_ref (const gdouble * gains, guint channels, gboolean is_s16,
+    gconstpointer in, gpointer out)
+{
+  gfloat ll = gains[0], lr = gains[1], rl = gains[2], rr = gains[3];
+  guint s;
+
+  if (is_s16)
+    memcpy (out, in, N_FRAMES * channels * 2);
+  else
+    memcpy (out, in, N_FRAMES * channels * 4);
+
+  for (s = 0; s < N_FRAMES; s++) {
+    if (is_s16) {
+      const gint16 *f = (const gint16 *) in + s * channels;
+      gint16 *o = (gint16 *) out + s * channels;
+      gfloat a = f[0], b = f[1];
+
+      o[0] = ref_round_s16 (a * ll + b * rl);
+      o[1] = ref_round_s16 (a * lr + b * rr);
+    } else {
+      const gfloat *f = (const gfloat *) in + s * channels;
+      gfloat *o = (gfloat *) out + s * channels;
+      gfloat a = f[0], b = f[1];
+
+      o[0] = a * ll + b * rl;
+      o[1] = a * lr + b * rr;
+    }
+  }
+}
+
+/* Pushes random frames, loud enough for S16 to saturate, through the
+ * element and compares them with what the reference made of them */
+static void
+check_mix (GstHarness * h, GstAudioFormat format, guint channels,
+    const gdouble * gains, gboolean pair)
+{
+  gboolean is_s16 = format == GST_AUDIO_FORMAT_S16;
+  gsize size = N_FRAMES * channels * (is_s16 ? 2 : 4);
+  guint8 *in = g_malloc (size);
+  guint8 *ref = g_malloc (size);
+  gchar *caps;
+  guint n, i;
+
+  /* unpositioned above stereo, the gains then go to the first two */
+  if (channels == 2)
+    caps = g_strdup_printf ("audio/x-raw,format=%s,layout=interleaved,"
+        "rate=48000,channels=2", gst_audio_format_to_string (format));
+  else
+    caps = g_strdup_printf ("audio/x-raw,format=%s,layout=interleaved,"
+        "rate=48000,channels=%u,channel-mask=(bitmask)0x0",
+        gst_audio_format_to_string (format), channels);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  for (n = 0; n < N_BUFFERS; n++) {
+    GstBuffer *buf;
+    GstMapInfo map;
+
+    for (i = 0; i < N_FRAMES * channels; i++) {
+      if (is_s16)
+        ((gint16 *) in)[i] = g_random_int_range (G_MININT16, G_MAXINT16 + 1);
+      else
+        ((gfloat *) in)[i] = g_random_double_range (-1.0, 1.0);
+    }
+    if (pair)
+      mix_pair_ref (gains, channels, is_s16, in, ref);
+    else
+      mix_ref (gains, channels, is_s16, in, ref);
+
+    buf = gst_buffer_new_allocate (NULL, size, NULL);
+    gst_buffer_fill (buf, 0, in, size);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+    buf = gst_harness_pull (h);
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, size);
+    fail_unless (memcmp (map.data, ref, size) == 0,
+        "%s, %u channels differ", gst_audio_format_to_string (format),
+        channels);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  g_free (in);
+  g_free (ref);
+}
+
+/* The SSE2/NEON stereo kernel must round and clamp like the per frame
+ * code, which also mixes the pair of wider streams */
+GST_START_TEST (test_pair_simd)
+{
+  /* left to left, left to right, right to left and right to right */
+  gdouble gains[4] = { 0.7, 0.3, -0.55, 1.2 };
+  guint channels;
+
+  g_random_set_seed (43);
+  for (channels = 2; channels <= 5; channels++) {
+    GstHarness *h;
+
+    h = gst_harness_new ("audiochannelmix");
+    g_object_set (h->element, "left-to-left", gains[0], "left-to-right",
+        gains[1], "right-to-left", gains[2], "right-to-right", gains[3],
+        NULL);
+    check_mix (h, GST_AUDIO_FORMAT_S16, channels, gains, TRUE);
+    gst_harness_teardown (h);
+
+    h = gst_harness_new ("audiochannelmix");
+    g_object_set (h->element, "left-to-left", gains[0], "left-to-right",
+        gains[1], "right-to-left", gains[2], "right-to-right", gains[3],
+        NULL);
+    check_mix (h, GST_AUDIO_FORMAT_F32, channels, gains, TRUE);
+    gst_harness_teardown (h);
+  }
+}
+
+GST_END_TEST;
+
+/* The dense kernel must give the same samples as multiplying and adding up
+ * the input channels one after the other, for every remainder of the
+ * output channels */
+GST_START_TEST (test_dense_simd)
+{
+  guint channels, i;
+
+  g_random_set_seed (47);
+  for (channels = 3; channels <= 9; channels++) {
+    gdouble *matrix = g_new (gdouble, channels * channels);
+    GstHarness *h;
+
+    for (i = 0; i < channels * channels; i++)
+      matrix[i] = g_random_double_range (-1.0, 1.0);
+
+    h = gst_harness_new ("audiochannelmix");
+    set_matrix (h->element, matrix, channels);
+    check_mix (h, GST_AUDIO_FORMAT_S16, channels, matrix, FALSE);
+    gst_harness_teardown (h);
+
+    h = gst_harness_new ("audiochannelmix");
+    set_matrix (h->element, matrix, channels);
+    check_mix (h, GST_AUDIO_FORMAT_F32, channels, matrix, FALSE);
+    gst_harness_teardown (h);
+
+    g_free (matrix);
+  }
+}
+
+GST_END_TEST;
+
+/* The default gains leave every sample as it was */
+GST_START_TEST (test_identity)
+{
+  gdouble identity[9] = {
+    1.0, 0, 0,
+    0, 1.0, 0,
+    0, 0, 1.0,
+  };
+  GstHarness *h;
+
+  g_random_set_seed (53);
+  h = gst_harness_new ("audiochannelmix");
+  check_mix (h, GST_AUDIO_FORMAT_S16, 3, identity, FALSE);
+  gst_harness_teardown (h);
+
+  h = gst_harness_new ("audiochannelmix");
+  check_mix (h, GST_AUDIO_FORMAT_F32, 3, identity, FALSE);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiochannelmix_suite (void)
+{
+  Suite *s = suite_create ("audiochannelmix");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_pair_simd);
+  tcase_add_test (tc_chain, test_dense_simd);
+  tcase_add_test (tc_chain, test_identity);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiochannelmix);
@@ -0,0 +1,164 @@
+/* GStreamer unit test for audiolatency
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <gst/check/gstcheck.h>
+
+#define WINDOW_SIZE 8
+#define BIN_WIDTH 100
+#define N_MEASUREMENTS 20
+
+static int
+compare_latencies (const void *a, const void *b)
+{
+  gint64 la = *(const gint64 *) a, lb = *(const gint64 *) b;
+
+  return (la > lb) - (la < lb);
+}
+
+/* Checks the statistics of a message against the last WINDOW_SIZE
+ * latencies */
+static void
+check_statistics (const GstStructure * s, const gint64 * latencies, guint n,
+    gdouble jitter)
+{
+  gint64 sorted[WINDOW_SIZE], start, value;
+  const GValue *histogram;
+  guint ii, count, total = 0, n_window = MIN (n, WINDOW_SIZE);
+
+  memcpy (sorted, latencies + n - n_window, n_window * sizeof (gint64));
+  qsort (sorted, n_window, sizeof (gint64), compare_latencies);
+
+  fail_unless (gst_structure_get_uint (s, "measurements", &count));
+  fail_unless_equals_int (count, n_window);
+  fail_unless (gst_structure_get_uint (s, "lost-markers", &count));
+  fail_unless_equals_int (count, 0);
+
+  fail_unless (gst_structure_get_int64 (s, "min-latency", &value));
+  fail_unless_equals_int64 (value, sorted[0]);
+  fail_unless (gst_structure_get_int64 (s, "max-latency", &value));
+  fail_unless_equals_int64 (value, sorted[n_window - 1]);
+  fail_unless (gst_structure_get_int64 (s, "p50-latency", &value));
+  fail_unless_equals_int64 (value, sorted[(n_window - 1) * 50 / 100]);
+  fail_unless (gst_structure_get_int64 (s, "p90-latency", &value));
+  fail_unless_equals_int64 (value, sorted[(n_window - 1) * 90 / 100]);
+  fail_unless (gst_structure_get_int64 (s, "p99-latency", &value));
+  fail_unless_equals_int64 (value, sorted[(n_window - 1) * 99 / 100]);
+  fail_unless (gst_structure_get_int64 (s, "jitter", &value));
+  fail_unless_equals_int64 (value, (gint64) jitter);
+
+  /* the bins start at a multiple of the width and hold every
+   * measurement */
+  fail_unless (gst_structure_get_int64 (s, "histogram-start", &start));
+  fail_unless_equals_int64 (start, sorted[0] - sorted[0] % BIN_WIDTH);
+  histogram = gst_structure_get_value (s, "histogram");
+  fail_unless (histogram != NULL);
+  for (ii = 0; ii < gst_value_array_get_size (histogram); ii++) {
+    const GValue *v = gst_value_array_get_value (histogram, ii);
+    guint expected = 0, jj;
+
+    for (jj = 0; jj < n_window; jj++) {
+      if (sorted[jj] >= start + ii * BIN_WIDTH &&
+          sorted[jj] < start + (ii + 1) * BIN_WIDTH)
+        expected++;
+    }
+    fail_unless_equals_int (g_value_get_uint (v), expected);
+    total += expected;
+  }
+  fail_unless_equals_int (total, n_window);
+}
+
+/* Loops the markers back through an identity that runs in real time, every
+ * marker must be found once and the statistics of each message must be the
+ * ones of the latencies measured so far */
+GST_START_TEST (test_continuous)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  gint64 latencies[N_MEASUREMENTS], prev = -1;
+  gdouble jitter = 0.0;
+  guint n = 0;
+  gchar *desc;
+
+  desc = g_strdup_printf ("audiolatency name=l continuous=true interval=50 "
+      "window-size=%d histogram-bin-width=%d ! identity sync=true ! l.",
+      WINDOW_SIZE, BIN_WIDTH);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  while (n < N_MEASUREMENTS) {
+    const GstStructure *s;
+    gint64 latency;
+
+    msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+        GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR);
+    fail_unless (msg != NULL, "no latency after %u measurements", n);
+    fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ELEMENT);
+
+    s = gst_message_get_structure (msg);
+    if (!gst_structure_has_name (s, "latency")) {
+      gst_message_unref (msg);
+      continue;
+    }
+
+    /* a buffer or so late, but never before the marker was sent */
+    fail_unless (gst_structure_get_int64 (s, "last-latency", &latency));
+    fail_unless (latency >= 0 && latency < G_USEC_PER_SEC,
+        "latency of %" G_GINT64_FORMAT "us", latency);
+
+    if (prev >= 0)
+      jitter += (ABS (latency - prev) - jitter) / 16.0;
+    prev = latency;
+    latencies[n++] = latency;
+
+    check_statistics (s, latencies, n, jitter);
+    gst_message_unref (msg);
+  }
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiolatency_suite (void)
+{
+  Suite *s = suite_create ("audiolatency");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_continuous);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiolatency);
@@ -0,0 +1,274 @@
+/* GStreamer unit test for audiomixmatrix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+
+#define N_SAMPLES 1031
+#define N_BUFFERS 3
+
+static void
+set_matrix (GstElement * element, const gdouble * matrix, guint in_channels,
+    guint out_channels)
+{
+  GValue v = G_VALUE_INIT;
+  guint in, out;
+
+  g_object_set (element, "in-channels", in_channels, "out-channels",
+      out_channels, "channel-mask", G_GUINT64_CONSTANT (0), NULL);
+
+  g_value_init (&v, GST_TYPE_ARRAY);
+  for (out = 0; out < out_channels; out++) {
+    GValue row = G_VALUE_INIT;
+
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < in_channels; in++) {
+      GValue coeff = G_VALUE_INIT;
+
+      g_value_init (&coeff, G_TYPE_DOUBLE);
+      g_value_set_double (&coeff, matrix[out * in_channels + in]);
+      gst_value_array_append_value (&row, &coeff);
+      g_value_unset (&coeff);
+    }
+    gst_value_array_append_value (&v, &row);
+    g_value_unset (&row);
+  }
+  g_object_set_property (G_OBJECT (element), "matrix", &v);
+  g_value_unset (&v);
+}
+
+/* The output of each channel summed up in input order over the non-zero
+ * coefficients, in the precision of the format */
+static void
+mix_ref_f32 (const gfloat * in, gfloat * out, const gdouble * matrix,
+    guint in_channels, guint out_channels)
+{
+  guint s, i, o;
+
+  for (s = 0; s < N_SAMPLES; s++) {
+    for (o = 0; o < out_channels; o++) {
+      gfloat acc = 0;
+
+      for (i = 0; i < in_channels; i++) {
+        gfloat coeff = matrix[o * in_channels + i];
+
+        if (coeff != 0)
+          acc += in[i] * coeff;
+      }
+      out[o] = acc;
+    }
+    in += in_channels;
+    out += out_channels;
+  }
+}
+
+static void
+mix_ref_f64 (const gdouble * in, gdouble * out, const gdouble * matrix,
+    guint in_channels, guint out_channels)
+{
+  guint s, i, o;
+
+  for (s = 0; s < N_SAMPLES; s++) {
+    for (o = 0; o < out_channels; o++) {
+      gdouble acc = 0;
+
+      for (i = 0; i < in_channels; i++) {
+        gdouble coeff = matrix[o * in_channels + i];
+
+        if (coeff != 0)
+          acc += in[i] * coeff;
+      }
+      out[o] = acc;
+    }
+    in += in_channels;
+    out += out_channels;
+  }
+}
+
+static void
+check_matrix (GstAudioFormat format, const gdouble * matrix,
+    guint in_channels, guint out_channels)
+{
+  GstHarness *h = gst_harness_new ("audiomixmatrix");
+  guint bps = GST_AUDIO_FORMAT_INFO_WIDTH (gst_audio_format_get_info
+      (format)) / 8;
+  gsize in_size = N_SAMPLES * in_channels * bps;
+  gsize out_size = N_SAMPLES * out_channels * bps;
+  guint8 *ref = g_malloc (out_size);
+  gchar *caps;
+  guint n, i;
+
+  set_matrix (h->element, matrix, in_channels, out_channels);
+  caps = g_strdup_printf ("audio/x-raw,format=%s,layout=interleaved,"
+      "rate=48000,channels=%u,channel-mask=(bitmask)0x0",
+      gst_audio_format_to_string (format), in_channels);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  for (n = 0; n < N_BUFFERS; n++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, in_size, NULL);
+    GstMapInfo map;
+
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+    for (i = 0; i < N_SAMPLES * in_channels; i++) {
+      if (format == GST_AUDIO_FORMAT_F32)
+        ((gfloat *) map.data)[i] = g_random_double_range (-1.0, 1.0);
+      else
+        ((gdouble *) map.data)[i] = g_random_double_range (-1.0, 1.0);
+    }
+    if (format == GST_AUDIO_FORMAT_F32)
+      mix_ref_f32 ((const gfloat *) map.data, (gfloat *) ref, matrix,
+          in_channels, out_channels);
+    else
+      mix_ref_f64 ((const gdouble *) map.data, (gdouble *) ref, matrix,
+          in_channels, out_channels);
+    gst_buffer_unmap (buf, &map);
+
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+    buf = gst_harness_pull (h);
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, out_size);
+    fail_unless (memcmp (map.data, ref, out_size) == 0,
+        "%s, %u to %u channels differ", gst_audio_format_to_string (format),
+        in_channels, out_channels);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  g_free (ref);
+  gst_harness_teardown (h);
+}
+
+/* A matrix with about one in every @sparseness coefficients non-zero */
+static gdouble *
+random_matrix (guint in_channels, guint out_channels, guint sparseness)
+{
+  gdouble *matrix = g_new (gdouble, in_channels * out_channels);
+  guint i;
+
+  for (i = 0; i < in_channels * out_channels; i++) {
+    if (g_random_int_range (0, sparseness) == 0)
+      matrix[i] = g_random_double_range (-1.0, 1.0);
+    else
+      matrix[i] = 0;
+  }
+
+  return matrix;
+}
+
+/* The vector dense kernels must give the same samples as multiplying and
+ * adding up the inputs one after the other, for every remainder of the
+ * output channels */
+GST_START_TEST (test_dense_simd)
+{
+  guint sizes[][2] = { {6, 5}, {3, 8}, {8, 3}, {5, 7}, {1, 6}, {11, 2} };
+  guint i;
+
+  g_random_set_seed (7);
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    gdouble *matrix = random_matrix (sizes[i][0], sizes[i][1], 1);
+
+    check_matrix (GST_AUDIO_FORMAT_F32, matrix, sizes[i][0], sizes[i][1]);
+    check_matrix (GST_AUDIO_FORMAT_F64, matrix, sizes[i][0], sizes[i][1]);
+    g_free (matrix);
+
+    matrix = random_matrix (sizes[i][0], sizes[i][1], 2);
+    check_matrix (GST_AUDIO_FORMAT_F32, matrix, sizes[i][0], sizes[i][1]);
+    check_matrix (GST_AUDIO_FORMAT_F64, matrix, sizes[i][0], sizes[i][1]);
+    g_free (matrix);
+  }
+}
+
+GST_END_TEST;
+
+/* The tap lists must give the same samples for matrices with few non-zero
+ * coefficients */
+GST_START_TEST (test_sparse)
+{
+  /* 7 of 48 and 3 of 12 coefficients used, a down and an up mix */
+  gdouble downmix[6 * 8] = {
+    0.7, 0, 0, 0, 0.3, 0, 0, 0,
+    0, 0.7, 0, 0, 0, 0.3, 0, 0,
+    0, 0, 1.0, 0, 0, 0, 0, 0,
+    0, 0, 0, -0.5, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0.25, 0,
+  };
+  gdouble upmix[6 * 2] = {
+    1.0, 0,
+    0, 1.0,
+    0, 0,
+    0, 0,
+    0, 0,
+    0.5, 0,
+  };
+
+  g_random_set_seed (9);
+  check_matrix (GST_AUDIO_FORMAT_F32, downmix, 8, 6);
+  check_matrix (GST_AUDIO_FORMAT_F64, downmix, 8, 6);
+  check_matrix (GST_AUDIO_FORMAT_F32, upmix, 2, 6);
+  check_matrix (GST_AUDIO_FORMAT_F64, upmix, 2, 6);
+}
+
+GST_END_TEST;
+
+/* Reordering in place and passing through must give the same samples as
+ * the matrix multiplication */
+GST_START_TEST (test_permutation)
+{
+  gdouble swap[4 * 4] = {
+    0, 0, 1.0, 0,
+    1.0, 0, 0, 0,
+    0, 0, 0, 1.0,
+    0, 1.0, 0, 0,
+  };
+  gdouble identity[3 * 3] = {
+    1.0, 0, 0,
+    0, 1.0, 0,
+    0, 0, 1.0,
+  };
+
+  g_random_set_seed (11);
+  check_matrix (GST_AUDIO_FORMAT_F32, swap, 4, 4);
+  check_matrix (GST_AUDIO_FORMAT_F64, swap, 4, 4);
+  check_matrix (GST_AUDIO_FORMAT_F32, identity, 3, 3);
+  check_matrix (GST_AUDIO_FORMAT_F64, identity, 3, 3);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiomixmatrix_suite (void)
+{
+  Suite *s = suite_create ("audiomixmatrix");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_dense_simd);
+  tcase_add_test (tc_chain, test_sparse);
+  tcase_add_test (tc_chain, test_permutation);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiomixmatrix);
@@ -150,6 +150,105 @@ GST_START_TEST (test_autoconvert_simple)
 
 GST_END_TEST;
 
+/* Number of accept-caps queries for caps 1 seen by testelement2 */
+static gint element2_caps1_queries;
+
+static GstPadProbeReturn
+element2_query_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstQuery *query = GST_PAD_PROBE_INFO_QUERY (info);
+  GstCaps *caps;
+  gint type;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_ACCEPT_CAPS)
+    return GST_PAD_PROBE_OK;
+
+  gst_query_parse_accept_caps (query, &caps);
+  if (gst_structure_get_int (gst_caps_get_structure (caps, 0), "type", &type)
+      && type == 1)
+    g_atomic_int_inc (&element2_caps1_queries);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+push_with_caps (GstPad * test_src_pad, const gchar * caps_str)
+{
+  GstCaps *caps;
+  guint i;
+
+  GST_LOG ("Changing caps to %s", caps_str);
+  caps = gst_caps_from_string (caps_str);
+  fail_unless (gst_pad_set_caps (test_src_pad, caps));
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 10; i++) {
+    fail_unless (gst_pad_push (test_src_pad, gst_buffer_new_and_alloc (4096))
+        == GST_FLOW_OK);
+  }
+}
+
+GST_START_TEST (test_autoconvert_reuse_cached_child)
+{
+  GstPad *test_src_pad, *test_sink_pad;
+  GstElement *autoconvert = gst_check_setup_element ("autoconvert");
+  GstCaps *caps;
+  gint misses, hits;
+  guint i;
+
+  set_autoconvert_factories (autoconvert);
+
+  test_src_pad = gst_check_setup_src_pad (autoconvert, &src_factory);
+  gst_pad_set_active (test_src_pad, TRUE);
+  test_sink_pad = gst_check_setup_sink_pad (autoconvert, &sink_factory);
+  gst_pad_set_active (test_sink_pad, TRUE);
+
+  gst_element_set_state (GST_ELEMENT_CAST (autoconvert), GST_STATE_PLAYING);
+
+  caps = gst_caps_from_string ("test/caps,type=(int)2");
+  gst_check_setup_events (test_src_pad, autoconvert, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 10; i++) {
+    fail_unless (gst_pad_push (test_src_pad, gst_buffer_new_and_alloc (4096))
+        == GST_FLOW_OK);
+  }
+  fail_unless_equals_int (GST_BIN_NUMCHILDREN (autoconvert), 1);
+
+  /* Not seen yet: testelement2 comes first in the factories and is tried
+   * again before testelement1 is selected */
+  g_atomic_int_set (&element2_caps1_queries, 0);
+  push_with_caps (test_src_pad, "test/caps,type=(int)1");
+  misses = g_atomic_int_get (&element2_caps1_queries);
+  fail_unless_equals_int (GST_BIN_NUMCHILDREN (autoconvert), 2);
+
+  push_with_caps (test_src_pad, "test/caps,type=(int)2");
+
+  /* Seen before: testelement1 is taken from the cache without walking the
+   * factories, so testelement2 is asked less often */
+  g_atomic_int_set (&element2_caps1_queries, 0);
+  push_with_caps (test_src_pad, "test/caps,type=(int)1");
+  hits = g_atomic_int_get (&element2_caps1_queries);
+  fail_unless (hits < misses, "%d queries with the cache, %d without", hits,
+      misses);
+
+  fail_unless_equals_int (g_list_length (buffers), 40);
+
+  /* The first children were reused instead of creating new ones */
+  fail_unless_equals_int (GST_BIN_NUMCHILDREN (autoconvert), 2);
+
+  gst_element_set_state ((GstElement *) autoconvert, GST_STATE_NULL);
+
+  gst_check_drop_buffers ();
+  gst_pad_set_active (test_src_pad, FALSE);
+  gst_pad_set_active (test_sink_pad, FALSE);
+  gst_check_teardown_src_pad (autoconvert);
+  gst_check_teardown_sink_pad (autoconvert);
+  gst_check_teardown_element (autoconvert);
+}
+
+GST_END_TEST;
+
 static Suite *
 autoconvert_suite (void)
 {
@@ -159,6 +258,7 @@ autoconvert_suite (void)
   suite_add_tcase (s, tc_basic);
   tcase_add_checked_fixture (tc_basic, setup, teardown);
   tcase_add_test (tc_basic, test_autoconvert_simple);
+  tcase_add_test (tc_basic, test_autoconvert_reuse_cached_child);
 
   return s;
 }
@@ -227,7 +327,15 @@ test_element2_class_init (TestElement2Class * klass)
 static void
 test_element2_init (TestElement2 * elem)
 {
+  GstPad *pad;
+
   configure_test_element (GST_BIN_CAST (elem), "test/caps,type=(int)2");
+
+  pad = gst_element_get_static_pad (GST_ELEMENT_CAST (elem), "sink");
+  gst_pad_add_probe (pad,
+      GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PUSH,
+      element2_query_probe, NULL, NULL);
+  gst_object_unref (pad);
 }
 
 GST_CHECK_MAIN (autoconvert);
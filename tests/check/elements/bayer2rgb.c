@@ -0,0 +1,265 @@
+/* GStreamer unit test for bayer2rgb
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* the Malvar-He-Cutler kernels are internal to the plugin */
+#include "../../gst/bayer/gstbayer2rgbmhc.c"
+
+#define WIDTH 318
+#define HEIGHT 243
+#define N_FRAMES 3
+
+/* A gradient with some noise and a few sharp edges, at any bit depth */
+static GstBuffer *
+create_frame (gint bpp, gboolean big_endian, guint n)
+{
+  gint bytes = bpp > 8 ? 2 : 1;
+  gint stride = GST_ROUND_UP_4 (WIDTH * bytes);
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, stride * HEIGHT, NULL);
+  GstMapInfo map;
+  gint x, y;
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+  memset (map.data, 0, map.size);
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      guint v = (x * 3 + y * 2 + n * 7) % 256;
+
+      if (((x + n) / 20 + y / 30) % 3 == 0)
+        v = 255 - v / 4;
+      v = (v << (bpp - 8)) + g_random_int_range (0, 1 << (bpp - 6));
+      v = MIN (v, (1u << bpp) - 1);
+
+      if (bytes == 1)
+        map.data[y * stride + x] = v;
+      else if (big_endian)
+        GST_WRITE_UINT16_BE (map.data + y * stride + 2 * x, v);
+      else
+        GST_WRITE_UINT16_LE (map.data + y * stride + 2 * x, v);
+    }
+  }
+  gst_buffer_unmap (buf, &map);
+
+  GST_BUFFER_PTS (buf) = gst_util_uint64_scale (n, GST_SECOND, 25);
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (1, GST_SECOND, 25);
+
+  return buf;
+}
+
+static GList *
+run_bayer2rgb (const gchar * format, const gchar * method,
+    const gchar * out_format, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *buffers = NULL;
+  gchar *desc, *in_caps, *out_caps;
+  gint bpp = 8;
+  guint i;
+
+  desc = g_strdup_printf ("bayer2rgb method=%s n-threads=%u", method,
+      n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  if (strlen (format) > 4)
+    bpp = g_ascii_strtoull (format + 4, NULL, 10);
+  in_caps = g_strdup_printf ("video/x-bayer,format=%s,width=%d,height=%d,"
+      "framerate=25/1", format, WIDTH, HEIGHT);
+  out_caps = g_strdup_printf ("video/x-raw,format=%s", out_format);
+  gst_harness_set_caps_str (h, in_caps, out_caps);
+  g_free (in_caps);
+  g_free (out_caps);
+
+  /* the same frames for every run */
+  g_random_set_seed (1);
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int (gst_harness_push (h, create_frame (bpp,
+                g_str_has_suffix (format, "be"), i)), GST_FLOW_OK);
+
+  while ((buf = gst_harness_try_pull (h)))
+    buffers = g_list_append (buffers, buf);
+  fail_unless_equals_int (g_list_length (buffers), N_FRAMES);
+
+  gst_harness_teardown (h);
+
+  return buffers;
+}
+
+static void
+check_n_threads (const gchar * format, const gchar * method,
+    const gchar * out_format)
+{
+  GList *ref, *buffers, *l, *m;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = run_bayer2rgb (format, method, out_format, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s %s to %s, n-threads=%u", method, format, out_format,
+        n_threads[i]);
+    buffers = run_bayer2rgb (format, method, out_format, n_threads[i]);
+
+    for (l = ref, m = buffers; l && m; l = l->next, m = m->next) {
+      GstMapInfo ref_map, map;
+
+      fail_unless (gst_buffer_map (l->data, &ref_map, GST_MAP_READ));
+      fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+      fail_unless_equals_int (map.size, ref_map.size);
+      fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+      gst_buffer_unmap (m->data, &map);
+      gst_buffer_unmap (l->data, &ref_map);
+    }
+
+    g_list_free_full (buffers, (GDestroyNotify) gst_buffer_unref);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Demosaicing in stripes must give exactly the same output as doing the
+ * whole frame in one go, with the rows around each stripe mirrored the same
+ * way at the frame edges only */
+GST_START_TEST (test_n_threads)
+{
+  check_n_threads ("bggr", "bilinear", "BGRA");
+  check_n_threads ("gbrg", "bilinear", "ARGB");
+  check_n_threads ("grbg12le", "bilinear", "RGBx");
+  check_n_threads ("rggb", "malvar-he-cutler", "xBGR");
+  check_n_threads ("gbrg10le", "malvar-he-cutler", "BGRx");
+  check_n_threads ("bggr16be", "malvar-he-cutler", "RGBA");
+}
+
+GST_END_TEST;
+
+#define MAX_WIDTH 333
+#define PAD GST_BAYER2RGB_MHC_PAD
+
+/* The vector kernels must give the same pixels as the C code that handles
+ * the rest of each line */
+GST_START_TEST (test_mhc_line_simd)
+{
+  gint16 lines[5][MAX_WIDTH + 2 * PAD];
+  guint16 samples[MAX_WIDTH];
+  guint8 planes[3][MAX_WIDTH], ref[3][MAX_WIDTH];
+  gint16 *rows[5];
+  gint run, k, x, width, site;
+
+  g_random_set_seed (13);
+  for (run = 0; run < 6; run++) {
+    for (width = 1; width <= MAX_WIDTH; width += width < 40 ? 1 : 23) {
+      for (k = 0; k < 5; k++) {
+        /* noise, then full scale edges for the clamping, then smooth
+         * content */
+        for (x = 0; x < width; x++) {
+          guint v;
+
+          if (run < 2)
+            v = g_random_int_range (0, 1024);
+          else if (run < 4)
+            v = ((x + k) / 3) % 2 ? 1023 : 0;
+          else
+            v = 4 * x + 20 * k + g_random_int_range (0, 16);
+          GST_WRITE_UINT16_LE (&samples[x], MIN (v, 1023));
+        }
+        gst_bayer2rgb_load_line (lines[k] + PAD, (const guint8 *) samples,
+            width, 10, FALSE);
+        rows[k] = lines[k] + PAD;
+      }
+
+      for (site = 0; site < 2; site++) {
+        memset (planes, 0x55, sizeof (planes));
+        memset (ref, 0x55, sizeof (ref));
+        gst_bayer2rgb_mhc_line (planes[0], planes[1], planes[2], rows, site,
+            width);
+        gst_bayer2rgb_mhc_line_c (ref[0], ref[1], ref[2], rows, site, 0,
+            width);
+        fail_unless (memcmp (planes, ref, sizeof (planes)) == 0,
+            "width %d, site %d, run %d differ", width, site, run);
+      }
+    }
+  }
+}
+
+GST_END_TEST;
+
+/* The vector interleaving must match the per pixel code for every order of
+ * the components */
+GST_START_TEST (test_pack_line_simd)
+{
+  guint8 r[MAX_WIDTH], g[MAX_WIDTH], b[MAX_WIDTH];
+  guint8 dest[4 * MAX_WIDTH], ref[4 * MAX_WIDTH];
+  gint r_off, g_off, b_off, a_off, width, i;
+
+  g_random_set_seed (17);
+  for (i = 0; i < MAX_WIDTH; i++) {
+    r[i] = g_random_int_range (0, 256);
+    g[i] = g_random_int_range (0, 256);
+    b[i] = g_random_int_range (0, 256);
+  }
+
+  for (r_off = 0; r_off < 4; r_off++) {
+    for (g_off = 0; g_off < 4; g_off++) {
+      for (b_off = 0; b_off < 4; b_off++) {
+        if (r_off == g_off || r_off == b_off || g_off == b_off)
+          continue;
+        a_off = 6 - r_off - g_off - b_off;
+
+        for (width = 1; width <= MAX_WIDTH; width += width < 40 ? 1 : 23) {
+          memset (dest, 0x55, sizeof (dest));
+          memset (ref, 0x55, sizeof (ref));
+          gst_bayer2rgb_pack_line (dest, r, g, b, r_off, g_off, b_off, width);
+          for (i = 0; i < width; i++) {
+            ref[4 * i + r_off] = r[i];
+            ref[4 * i + g_off] = g[i];
+            ref[4 * i + b_off] = b[i];
+            ref[4 * i + a_off] = 0xff;
+          }
+          fail_unless (memcmp (dest, ref, sizeof (dest)) == 0,
+              "offsets %d%d%d, width %d differ", r_off, g_off, b_off, width);
+        }
+      }
+    }
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+bayer2rgb_suite (void)
+{
+  Suite *s = suite_create ("bayer2rgb");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_mhc_line_simd);
+  tcase_add_test (tc_chain, test_pack_line_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (bayer2rgb);
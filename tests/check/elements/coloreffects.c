@@ -0,0 +1,289 @@
+/* GStreamer unit test for coloreffects
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* the fixed point lookups are internal to the plugin */
+#include "../../gst/coloreffects/gstlut3d.c"
+
+#define N_FRAMES 3
+
+static GList *
+run_filter (const gchar * properties, const gchar * format, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *buffers = NULL;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("coloreffects %s n-threads=%u", properties,
+      n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  /* odd height, so the stripes don't split the frame evenly */
+  desc = g_strdup_printf ("videotestsrc pattern=smpte ! "
+      "video/x-raw,format=%s,width=320,height=243,framerate=25/1", format);
+  gst_harness_add_src_parse (h, desc, FALSE);
+  g_free (desc);
+
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int (gst_harness_push_from_src (h), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h)))
+    buffers = g_list_append (buffers, buf);
+  fail_unless_equals_int (g_list_length (buffers), N_FRAMES);
+
+  gst_harness_teardown (h);
+
+  return buffers;
+}
+
+static void
+check_n_threads (const gchar * properties, const gchar * format)
+{
+  GList *ref, *buffers, *l, *m;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = run_filter (properties, format, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s on %s, n-threads=%u", properties, format, n_threads[i]);
+    buffers = run_filter (properties, format, n_threads[i]);
+
+    for (l = ref, m = buffers; l && m; l = l->next, m = m->next) {
+      GstMapInfo ref_map, map;
+
+      fail_unless (gst_buffer_map (l->data, &ref_map, GST_MAP_READ));
+      fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+      fail_unless_equals_int (map.size, ref_map.size);
+      fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+      gst_buffer_unmap (m->data, &map);
+      gst_buffer_unmap (l->data, &ref_map);
+    }
+
+    g_list_free_full (buffers, (GDestroyNotify) gst_buffer_unref);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* a mapping that is far from linear, so that every interpolation weight
+ * matters */
+static void
+test_lut_func (const gfloat in[3], gfloat out[3], gpointer user_data)
+{
+  out[0] = in[1] * in[1];
+  out[1] = 1.0 - in[0] * (0.5 + 0.5 * in[2]);
+  out[2] = CLAMP (0.2 + in[2] - 0.6 * in[0] * in[1], 0.0, 1.0);
+}
+
+static gchar *
+write_cube_file (gint size)
+{
+  GString *cube = g_string_new ("# test LUT\nLUT_3D_SIZE ");
+  gchar *filename;
+  gint fd, i, j, k;
+
+  fd = g_file_open_tmp ("coloreffects-XXXXXX.cube", &filename, NULL);
+  fail_unless (fd >= 0);
+  g_close (fd, NULL);
+
+  g_string_append_printf (cube, "%d\n", size);
+  for (k = 0; k < size; k++) {
+    for (j = 0; j < size; j++) {
+      for (i = 0; i < size; i++) {
+        gfloat in[3], out[3];
+        gchar buf[3][G_ASCII_DTOSTR_BUF_SIZE];
+
+        in[0] = (gfloat) i / (size - 1);
+        in[1] = (gfloat) j / (size - 1);
+        in[2] = (gfloat) k / (size - 1);
+        test_lut_func (in, out, NULL);
+        g_string_append_printf (cube, "%s %s %s\n",
+            g_ascii_formatd (buf[0], sizeof (buf[0]), "%f", out[0]),
+            g_ascii_formatd (buf[1], sizeof (buf[1]), "%f", out[1]),
+            g_ascii_formatd (buf[2], sizeof (buf[2]), "%f", out[2]));
+      }
+    }
+  }
+  fail_unless (g_file_set_contents (filename, cube->str, -1, NULL));
+  g_string_free (cube, TRUE);
+
+  return filename;
+}
+
+/* Mapping the pixels in stripes must give exactly the same output as
+ * mapping the whole frame in one go */
+GST_START_TEST (test_n_threads)
+{
+  check_n_threads ("preset=heat", "ARGB");
+  check_n_threads ("preset=sepia", "RGB");
+  check_n_threads ("preset=xray", "AYUV");
+  check_n_threads ("preset=xpro", "I420");
+  check_n_threads ("preset=yellowblue", "NV12");
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_n_threads_lut)
+{
+  gchar *filename = write_cube_file (9);
+  gchar *properties;
+
+  properties = g_strdup_printf ("lut-location=\"%s\" "
+      "lut-interpolation=trilinear", filename);
+  check_n_threads (properties, "BGRx");
+  check_n_threads (properties, "I420");
+  g_free (properties);
+
+  properties = g_strdup_printf ("lut-location=\"%s\" "
+      "lut-interpolation=tetrahedral", filename);
+  check_n_threads (properties, "RGBA");
+  check_n_threads (properties, "NV12");
+  g_free (properties);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+#define LERP(a,b,f) (((a) * (256 - (f)) + (b) * (f) + 128) >> 8)
+
+/* per component versions of the fixed point interpolations */
+static void
+ref_lookup (const GstLut3D * lut, GstLut3DInterpolation method,
+    const guint colour[3], guint8 out[3])
+{
+  const guint16 *c0 = lut->table + lut->offsets[0][colour[0]] +
+      lut->offsets[1][colour[1]] + lut->offsets[2][colour[2]];
+  const guint32 *s = lut->steps;
+  gint f[3], k;
+
+  for (k = 0; k < 3; k++)
+    f[k] = lut->fracs[k][colour[k]];
+
+  if (method == GST_LUT3D_INTERPOLATION_TRILINEAR) {
+    for (k = 0; k < 3; k++) {
+      guint v[4], i;
+
+      for (i = 0; i < 4; i++) {
+        const guint16 *p = c0 + (i & 1) * s[1] + (i >> 1) * s[2];
+
+        v[i] = LERP (p[k], p[s[0] + k], f[0]);
+      }
+      v[0] = LERP (LERP (v[0], v[1], f[1]), LERP (v[2], v[3], f[1]), f[2]);
+      out[k] = (v[0] + (1 << (LUT3D_SHIFT - 1))) >> LUT3D_SHIFT;
+    }
+  } else {
+    const guint16 *c1, *c2, *c3;
+    gint a = 0, b = 1, c = 2, t;
+
+    /* order the components by decreasing fraction, ties don't matter as
+     * the node between them gets no weight */
+    if (f[b] > f[a]) {
+      t = a;
+      a = b;
+      b = t;
+    }
+    if (f[c] > f[b]) {
+      t = b;
+      b = c;
+      c = t;
+    }
+    if (f[b] > f[a]) {
+      t = a;
+      a = b;
+      b = t;
+    }
+    c1 = c0 + s[a];
+    c2 = c1 + s[b];
+    c3 = c2 + s[c];
+    for (k = 0; k < 3; k++) {
+      guint v = (256 - f[a]) * c0[k] + (f[a] - f[b]) * c1[k] +
+          (f[b] - f[c]) * c2[k] + f[c] * c3[k];
+
+      out[k] = (v + (1 << (7 + LUT3D_SHIFT))) >> (8 + LUT3D_SHIFT);
+    }
+  }
+}
+
+#undef LERP
+
+/* The vector lookups must give the same colours as the per component
+ * fixed point code */
+GST_START_TEST (test_lookup_simd)
+{
+  GstLut3DInterpolation methods[] = {
+    GST_LUT3D_INTERPOLATION_TRILINEAR, GST_LUT3D_INTERPOLATION_TETRAHEDRAL
+  };
+  gint sizes[] = { 2, 9, 17, 33 };
+  guint i, j, c[3];
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    GstLut3D *lut = gst_lut3d_new_from_func (sizes[i], test_lut_func, NULL);
+
+    for (j = 0; j < G_N_ELEMENTS (methods); j++) {
+      for (c[2] = 0; c[2] < 256; c[2] += c[2] < 250 ? 3 : 1) {
+        for (c[1] = 0; c[1] < 256; c[1] += c[1] < 250 ? 3 : 1) {
+          for (c[0] = 0; c[0] < 256; c[0] += c[0] < 250 ? 3 : 1) {
+            guint8 out[3], ref[3];
+
+            gst_lut3d_lookup (lut, methods[j], c[0], c[1], c[2], out);
+            ref_lookup (lut, methods[j], c, ref);
+            fail_unless (memcmp (out, ref, 3) == 0,
+                "size %d, method %d, colour %u,%u,%u: %u,%u,%u != %u,%u,%u",
+                sizes[i], methods[j], c[0], c[1], c[2], out[0], out[1],
+                out[2], ref[0], ref[1], ref[2]);
+          }
+        }
+      }
+    }
+
+    gst_lut3d_free (lut);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+coloreffects_suite (void)
+{
+  Suite *s = suite_create ("coloreffects");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_n_threads_lut);
+  tcase_add_test (tc_chain, test_lookup_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (coloreffects);
@@ -0,0 +1,237 @@
+/* GStreamer unit test for compare
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+/* the metrics are internal to the plugin */
+#include "../../gst/debugutils/gstcomparemetrics.c"
+
+#define MAX_SAMPLES 4099
+
+/* Copies @n samples to every other byte with garbage in between, so that
+ * the kernels take their per sample path with a step of 2 */
+static guint8 *
+spread_samples (const guint8 * data, gint n)
+{
+  guint8 *spread = g_malloc (2 * n + 1);
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    spread[2 * i] = data[i];
+    spread[2 * i + 1] = ~data[i];
+  }
+
+  return spread;
+}
+
+static void
+fill_samples (guint8 * s1, guint8 * s2, gint n, guint run)
+{
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    if (run == 0) {
+      /* the largest differences, both ways */
+      s1[i] = i % 3 ? 255 : 0;
+      s2[i] = i % 3 ? 0 : 255;
+    } else if (run == 1) {
+      s1[i] = s2[i] = g_random_int_range (0, 256);
+    } else if (run == 2) {
+      s1[i] = g_random_int_range (0, 256);
+      s2[i] = CLAMP (s1[i] + g_random_int_range (-3, 4), 0, 255);
+    } else {
+      s1[i] = g_random_int_range (0, 256);
+      s2[i] = g_random_int_range (0, 256);
+    }
+  }
+}
+
+/* The SSE2 row sums must be the ones of adding up every sample */
+GST_START_TEST (test_row_diff_simd)
+{
+  guint8 *s1 = g_malloc (MAX_SAMPLES), *s2 = g_malloc (MAX_SAMPLES);
+  gint lengths[] = { 0, 1, 15, 16, 17, 31, 32, 33, 63, 100, 1920, 4099 };
+  guint run, i;
+
+  g_random_set_seed (59);
+  for (run = 0; run < 4; run++) {
+    for (i = 0; i < G_N_ELEMENTS (lengths); i++) {
+      GstCompareStats simd = { 0, }, scalar = { 0, };
+      gint n = lengths[i];
+      guint8 *w1, *w2;
+
+      fill_samples (s1, s2, n, run);
+      w1 = spread_samples (s1, n);
+      w2 = spread_samples (s2, n);
+
+      /* the maximum carries over from the rows before */
+      simd.max = scalar.max = run;
+      gst_compare_row_diff (s1, s2, n, 1, &simd);
+      gst_compare_row_diff (w1, w2, n, 2, &scalar);
+      fail_unless_equals_uint64 (simd.sad, scalar.sad);
+      fail_unless_equals_uint64 (simd.ssd, scalar.ssd);
+      fail_unless_equals_int (simd.max, scalar.max);
+
+      g_free (w1);
+      g_free (w2);
+    }
+  }
+
+  g_free (s1);
+  g_free (s2);
+}
+
+GST_END_TEST;
+
+/* The SSE2 sums of full windows must give exactly the same SSIM as adding
+ * up every sample, also for the windows cut off at the bottom */
+GST_START_TEST (test_ssim_window_simd)
+{
+  const gint stride = SSIM_WINDOW + 5;
+  guint8 *s1 = g_malloc (stride * SSIM_WINDOW);
+  guint8 *s2 = g_malloc (stride * SSIM_WINDOW);
+  guint run;
+  gint h;
+
+  g_random_set_seed (61);
+  for (run = 0; run < 4; run++) {
+    fill_samples (s1, s2, stride * SSIM_WINDOW, run);
+
+    for (h = 1; h <= SSIM_WINDOW; h++) {
+      guint8 *w1 = spread_samples (s1, stride * h);
+      guint8 *w2 = spread_samples (s2, stride * h);
+      gdouble simd, scalar;
+
+      simd = gst_compare_ssim_window (s1, stride, s2, stride, SSIM_WINDOW, h,
+          1);
+      scalar = gst_compare_ssim_window (w1, 2 * stride, w2, 2 * stride,
+          SSIM_WINDOW, h, 2);
+      fail_unless (simd == scalar, "run %u, height %d: %.17g != %.17g", run,
+          h, simd, scalar);
+
+      g_free (w1);
+      g_free (w2);
+    }
+  }
+
+  g_free (s1);
+  g_free (s2);
+}
+
+GST_END_TEST;
+
+/* Runs two different test patterns through compare and returns the
+ * statistics of every frame */
+static GList *
+run_compare (const gchar * format, gint width, gint height, guint n_threads)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  GList *stats = NULL;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=5 pattern=ball ! "
+      "video/x-raw,format=%s,width=%d,height=%d ! "
+      "compare name=c method=ssim post-stats=true n-threads=%u ! fakesink "
+      "videotestsrc num-buffers=5 pattern=zone-plate kx2=20 ky2=20 kt=1 ! "
+      "video/x-raw,format=%s,width=%d,height=%d ! c.check", format, width,
+      height, n_threads, format, width, height);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  while ((msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+              GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS | GST_MESSAGE_ERROR))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    fail_unless (GST_MESSAGE_TYPE (msg) != GST_MESSAGE_ERROR);
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+      gst_message_unref (msg);
+      break;
+    }
+    if (gst_structure_has_name (s, "compare-stats"))
+      stats = g_list_append (stats, gst_structure_copy (s));
+    gst_message_unref (msg);
+  }
+  fail_unless (msg != NULL, "no EOS");
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return stats;
+}
+
+/* Comparing in stripes of rows on several threads must give exactly the
+ * same statistics as a single thread, planar and packed */
+GST_START_TEST (test_n_threads)
+{
+  const gchar *formats[] = { "I420", "RGBx" };
+  gint sizes[][2] = { {320, 243}, {175, 100} };
+  guint n_threads[] = { 2, 3, 4, 0 };
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GList *ref, *stats, *l, *m;
+
+    ref = run_compare (formats[i], sizes[i][0], sizes[i][1], 1);
+    fail_unless_equals_int (g_list_length (ref), 5);
+
+    for (j = 0; j < G_N_ELEMENTS (n_threads); j++) {
+      stats = run_compare (formats[i], sizes[i][0], sizes[i][1],
+          n_threads[j]);
+      fail_unless_equals_int (g_list_length (stats), g_list_length (ref));
+      for (l = ref, m = stats; l && m; l = l->next, m = m->next) {
+        fail_unless (gst_structure_is_equal (l->data, m->data),
+            "%s with %u threads: %" GST_PTR_FORMAT " != %" GST_PTR_FORMAT,
+            formats[i], n_threads[j], m->data, l->data);
+      }
+      g_list_free_full (stats, (GDestroyNotify) gst_structure_free);
+    }
+    g_list_free_full (ref, (GDestroyNotify) gst_structure_free);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+compare_suite (void)
+{
+  Suite *s = suite_create ("compare");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_row_diff_simd);
+  tcase_add_test (tc_chain, test_ssim_window_simd);
+  tcase_add_test (tc_chain, test_n_threads);
+
+  return s;
+}
+
+GST_CHECK_MAIN (compare);
@@ -1740,6 +1740,62 @@ GST_START_TEST (test_obscured_skipped)
 
 GST_END_TEST;
 
+static void
+_test_obscured_by_several (gint xpos2)
+{
+  GstElement *bin, *appsink, *cfilter;
+  GstSample *sample;
+  GstPad *srcpad;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=c sink_2::xpos=%d "
+      "! video/x-raw,width=20,height=20 ! appsink name=sink sync=false "
+      "videotestsrc num-buffers=5 ! capsfilter name=cf0 "
+      "caps=video/x-raw,format=I420,width=20,height=20 ! c. "
+      "videotestsrc num-buffers=5 "
+      "! video/x-raw,format=I420,width=10,height=20 ! c. "
+      "videotestsrc num-buffers=5 "
+      "! video/x-raw,format=I420,width=10,height=20 ! c. ", xpos2);
+  bin = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (bin != NULL);
+
+  cfilter = gst_bin_get_by_name (GST_BIN (bin), "cf0");
+  srcpad = gst_element_get_static_pad (cfilter, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      test_obscured_pad_probe_cb, NULL, NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (cfilter);
+
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  gst_element_set_state (bin, GST_STATE_PLAYING);
+  do {
+    g_signal_emit_by_name (appsink, "pull-sample", &sample);
+    if (sample)
+      gst_sample_unref (sample);
+  } while (sample != NULL);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (appsink);
+  gst_object_unref (bin);
+}
+
+/* sink_0 is hidden by sink_1 and sink_2 together, while neither of them
+ * covers it on its own */
+GST_START_TEST (test_obscured_by_several)
+{
+  buffer_mapped = FALSE;
+  _test_obscured_by_several (10);
+  fail_unless (buffer_mapped == FALSE);
+
+  /* leave a column of sink_0 visible */
+  buffer_mapped = FALSE;
+  _test_obscured_by_several (11);
+  fail_unless (buffer_mapped == TRUE);
+}
+
+GST_END_TEST;
+
 static void
 _pipeline_eos (GstBus * bus, GstMessage * message, GstPipeline * bin)
 {
@@ -1878,6 +1934,676 @@ GST_START_TEST (test_pad_z_order)
 
 GST_END_TEST;
 
+static GstBuffer *
+_run_n_threads (const gchar * format, const gchar * in_format,
+    const gchar * background, const gchar * property, guint n_threads)
+{
+  GstElement *bin, *appsink;
+  GstMessage *msg;
+  GstSample *sample;
+  GstBuffer *buf;
+  GstBus *bus;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=c background=%s %s=%u "
+      "sink_1::xpos=37 sink_1::ypos=51 sink_1::alpha=0.6 "
+      "sink_2::xpos=-13 sink_2::ypos=-7 sink_2::alpha=0.3 "
+      "sink_3::xpos=200 sink_3::ypos=131 sink_3::width=130 "
+      "! video/x-raw,format=%s,width=320,height=243 "
+      "! appsink name=sink sync=false "
+      "videotestsrc num-buffers=1 pattern=smpte "
+      "! video/x-raw,format=%s,width=320,height=243 ! c. "
+      "videotestsrc num-buffers=1 pattern=ball "
+      "! video/x-raw,format=%s,width=163,height=97 ! c. "
+      "videotestsrc num-buffers=1 pattern=snow "
+      "! video/x-raw,format=%s,width=101,height=211 ! c. "
+      "videotestsrc num-buffers=1 pattern=circular "
+      "! video/x-raw,format=%s,width=150,height=150 ! c. ", background,
+      property, n_threads, format, in_format, in_format, in_format, in_format);
+  bin = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (bin != NULL);
+
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  bus = gst_element_get_bus (bin);
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  g_object_get (appsink, "last-sample", &sample, NULL);
+  fail_unless (sample != NULL);
+  buf = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (appsink);
+  gst_object_unref (bin);
+
+  return buf;
+}
+
+static void
+_check_n_threads (const gchar * format, const gchar * in_format,
+    const gchar * background, const gchar * property)
+{
+  GstBuffer *ref, *buf;
+  GstMapInfo ref_map, map;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = _run_n_threads (format, in_format, background, property, 1);
+  fail_unless (gst_buffer_map (ref, &ref_map, GST_MAP_READ));
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s from %s on %s background, %s=%u", format, in_format,
+        background, property, n_threads[i]);
+    buf = _run_n_threads (format, in_format, background, property,
+        n_threads[i]);
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, ref_map.size);
+    fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_buffer_unmap (ref, &ref_map);
+  gst_buffer_unref (ref);
+}
+
+/* Blending in stripes must give exactly the same output as blending the
+ * whole frame in one go */
+GST_START_TEST (test_n_threads)
+{
+  _check_n_threads ("I420", "I420", "checker", "n-threads");
+  _check_n_threads ("NV12", "NV12", "black", "n-threads");
+  _check_n_threads ("YUY2", "YUY2", "white", "n-threads");
+  _check_n_threads ("AYUV", "AYUV", "checker", "n-threads");
+  _check_n_threads ("ARGB", "ARGB", "transparent", "n-threads");
+  _check_n_threads ("RGB", "RGB", "checker", "n-threads");
+}
+
+GST_END_TEST;
+
+/* Same for converting the input frames concurrently */
+GST_START_TEST (test_n_prepare_threads)
+{
+  _check_n_threads ("AYUV", "NV12", "checker", "n-prepare-threads");
+  _check_n_threads ("I420", "YUY2", "black", "n-prepare-threads");
+}
+
+GST_END_TEST;
+
+static void
+_check_same_buffers (GPtrArray * ref, GPtrArray * buffers)
+{
+  guint i;
+
+  fail_unless_equals_int (buffers->len, ref->len);
+
+  for (i = 0; i < ref->len; i++) {
+    GstMapInfo ref_map, map;
+
+    fail_unless (gst_buffer_map (g_ptr_array_index (ref, i), &ref_map,
+            GST_MAP_READ));
+    fail_unless (gst_buffer_map (g_ptr_array_index (buffers, i), &map,
+            GST_MAP_READ));
+    fail_unless_equals_int (map.size, ref_map.size);
+    fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+    gst_buffer_unmap (g_ptr_array_index (buffers, i), &map);
+    gst_buffer_unmap (g_ptr_array_index (ref, i), &ref_map);
+  }
+}
+
+static GPtrArray *
+_pull_all_buffers (GstElement * bin)
+{
+  GstElement *appsink;
+  GstSample *sample;
+  GPtrArray *buffers;
+
+  buffers = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  do {
+    g_signal_emit_by_name (appsink, "pull-sample", &sample);
+    if (sample) {
+      g_ptr_array_add (buffers,
+          gst_buffer_ref (gst_sample_get_buffer (sample)));
+      gst_sample_unref (sample);
+    }
+  } while (sample != NULL);
+  gst_object_unref (appsink);
+
+  return buffers;
+}
+
+static GstBuffer *
+_create_random_frame (GstVideoInfo * info, guint32 seed)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  GRand *rand;
+  gsize i;
+
+  buf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (info), NULL);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+  rand = g_rand_new_with_seed (seed);
+  for (i = 0; i < map.size; i++)
+    map.data[i] = g_rand_int_range (rand, 0, 256);
+  g_rand_free (rand);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+static void
+_push_frame (GstElement * bin, const gchar * name, GstBuffer * buf, guint i)
+{
+  GstElement *appsrc;
+  GstFlowReturn ret;
+
+  GST_BUFFER_PTS (buf) = i * GST_SECOND / 25;
+  GST_BUFFER_DURATION (buf) = GST_SECOND / 25;
+
+  appsrc = gst_bin_get_by_name (GST_BIN (bin), name);
+  g_signal_emit_by_name (appsrc, "push-buffer", buf, &ret);
+  fail_unless_equals_int (ret, GST_FLOW_OK);
+  gst_buffer_unref (buf);
+  if (i == 7) {
+    g_signal_emit_by_name (appsrc, "end-of-stream", &ret);
+    fail_unless_equals_int (ret, GST_FLOW_OK);
+  }
+  gst_object_unref (appsrc);
+}
+
+/* The background and the sink_2 overlay are the same frame on every
+ * buffer, only sink_1 changes, and the streams end after 8 buffers. With
+ * @deep_copy the static frames are copied to new memory every time, so that
+ * nothing of the last output frame can be reused */
+static GPtrArray *
+_run_dirty_regions (const gchar * format, gboolean deep_copy)
+{
+  GstElement *bin;
+  GstBuffer *background, *overlay;
+  GstVideoInfo info0, info1, info2;
+  GPtrArray *buffers;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("compositor name=c background=checker "
+      "sink_1::xpos=45 sink_1::ypos=33 "
+      "sink_2::xpos=60 sink_2::ypos=41 sink_2::alpha=0.5 "
+      "! video/x-raw,format=%s,width=320,height=240 "
+      "! appsink name=sink sync=false "
+      "appsrc name=src0 format=time "
+      "caps=video/x-raw,format=%s,width=320,height=240,framerate=25/1 ! c. "
+      "appsrc name=src1 format=time "
+      "caps=video/x-raw,format=%s,width=61,height=37,framerate=25/1 ! c. "
+      "appsrc name=src2 format=time "
+      "caps=video/x-raw,format=%s,width=101,height=23,framerate=25/1 ! c. ",
+      format, format, format, format);
+  bin = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (bin != NULL);
+
+  gst_video_info_set_format (&info0, gst_video_format_from_string (format),
+      320, 240);
+  gst_video_info_set_format (&info1, gst_video_format_from_string (format),
+      61, 37);
+  gst_video_info_set_format (&info2, gst_video_format_from_string (format),
+      101, 23);
+  background = _create_random_frame (&info0, 0);
+  overlay = _create_random_frame (&info2, 1);
+
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 8; i++) {
+    if (deep_copy) {
+      _push_frame (bin, "src0", gst_buffer_copy_deep (background), i);
+      _push_frame (bin, "src2", gst_buffer_copy_deep (overlay), i);
+    } else {
+      _push_frame (bin, "src0", gst_buffer_copy (background), i);
+      _push_frame (bin, "src2", gst_buffer_copy (overlay), i);
+    }
+    _push_frame (bin, "src1", _create_random_frame (&info1, i + 2), i);
+  }
+  gst_buffer_unref (background);
+  gst_buffer_unref (overlay);
+
+  buffers = _pull_all_buffers (bin);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bin);
+
+  return buffers;
+}
+
+static GstBuffer *
+_run_checker (const gchar * format, gint width, gint height, guint n_buffers,
+    GstVideoInfo * info)
+{
+  GstElement *bin, *appsink;
+  GstMessage *msg;
+  GstSample *sample;
+  GstBuffer *buf;
+  GstBus *bus;
+  gchar *desc;
+
+  /* sink_0 is fully transparent, only the background is left */
+  desc = g_strdup_printf ("videotestsrc num-buffers=%u "
+      "! video/x-raw,format=%s,width=%d,height=%d "
+      "! compositor background=checker sink_0::alpha=0 "
+      "! video/x-raw,format=%s,width=%d,height=%d "
+      "! appsink name=sink sync=false", n_buffers, format, width, height,
+      format, width, height);
+  bin = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (bin != NULL);
+
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  bus = gst_element_get_bus (bin);
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  g_object_get (appsink, "last-sample", &sample, NULL);
+  fail_unless (sample != NULL);
+  fail_unless (gst_video_info_from_caps (info, gst_sample_get_caps (sample)));
+  buf = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (appsink);
+  gst_object_unref (bin);
+
+  return buf;
+}
+
+static void
+_check_checker (const gchar * format, gint width, gint height)
+{
+  GstVideoFrame frame;
+  GstVideoInfo info;
+  GstBuffer *buf;
+  gint x, y;
+
+  GST_INFO ("checking %s %dx%d", format, width, height);
+  buf = _run_checker (format, width, height, 1, &info);
+  fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_READ));
+
+  for (y = 0; y < height; y++) {
+    const guint8 *line = (const guint8 *) GST_VIDEO_FRAME_COMP_DATA (&frame,
+        0) + y * GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
+
+    for (x = 0; x < width; x++) {
+      /* the packed 4:2:2 formats count the squares in macro pixels */
+      gint col = GST_VIDEO_FORMAT_INFO_IS_YUV (info.finfo) &&
+          GST_VIDEO_FRAME_COMP_PSTRIDE (&frame, 0) == 2 &&
+          GST_VIDEO_FRAME_N_PLANES (&frame) == 1 ? x / 2 : x;
+      guint8 expected = ((y & 8) ^ (col & 8)) ? 160 : 80;
+
+      fail_unless_equals_int (line[x * GST_VIDEO_FRAME_COMP_PSTRIDE (&frame,
+                  0)], expected);
+    }
+  }
+
+  gst_video_frame_unmap (&frame);
+  gst_buffer_unref (buf);
+}
+
+GST_START_TEST (test_checker_background)
+{
+  const gchar *formats[] = { "I420", "Y444", "NV12", "YUY2", "UYVY", "AYUV",
+    "ARGB", "BGRA", "RGB", "xRGB"
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    _check_checker (formats[i], 64, 32);
+    _check_checker (formats[i], 37, 7);
+    _check_checker (formats[i], 4, 9);
+    _check_checker (formats[i], 145, 43);
+  }
+}
+
+GST_END_TEST;
+
+/* Not a correctness test as such, the timings logged at INFO level give the
+ * background drawing speed for a few formats */
+GST_START_TEST (test_checker_background_benchmark)
+{
+  const gchar *formats[] = { "I420", "NV12", "YUY2", "AYUV", "BGRA" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstVideoInfo info;
+    GstBuffer *buf;
+    gint64 start, elapsed;
+
+    start = g_get_monotonic_time ();
+    buf = _run_checker (formats[i], 1920, 1080, 100, &info);
+    elapsed = g_get_monotonic_time () - start;
+    gst_buffer_unref (buf);
+
+    GST_INFO ("%s: 100 frames of 1920x1080 in %" G_GINT64_FORMAT " us",
+        formats[i], elapsed);
+  }
+}
+
+GST_END_TEST;
+
+/* The two opaque pads cover the whole output between them, the background
+ * has to be skipped without leaving any of it visible at the seam, where the
+ * odd positions and sizes are rounded to the chroma subsampling */
+GST_START_TEST (test_covered_background)
+{
+  GstElement *bin, *appsink;
+  GstMessage *msg;
+  GstSample *sample;
+  GstVideoFrame frame;
+  GstVideoInfo info;
+  GstBuffer *buf;
+  GstBus *bus;
+  gint x, y;
+
+  bin = gst_parse_launch ("videotestsrc num-buffers=3 pattern=black "
+      "! video/x-raw,format=I420,width=33,height=32 "
+      "! compositor name=comp background=white sink_1::xpos=31 "
+      "! video/x-raw,format=I420,width=64,height=32 "
+      "! appsink name=sink sync=false "
+      "videotestsrc num-buffers=3 pattern=black "
+      "! video/x-raw,format=I420,width=33,height=32 ! comp.", NULL);
+  fail_unless (bin != NULL);
+
+  appsink = gst_bin_get_by_name (GST_BIN (bin), "sink");
+  bus = gst_element_get_bus (bin);
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  g_object_get (appsink, "last-sample", &sample, NULL);
+  fail_unless (sample != NULL);
+  fail_unless (gst_video_info_from_caps (&info, gst_sample_get_caps (sample)));
+  buf = gst_sample_get_buffer (sample);
+  fail_unless (gst_video_frame_map (&frame, &info, buf, GST_MAP_READ));
+
+  for (y = 0; y < 32; y++) {
+    const guint8 *line = (const guint8 *) GST_VIDEO_FRAME_COMP_DATA (&frame,
+        0) + y * GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
+
+    for (x = 0; x < 64; x++)
+      fail_unless_equals_int (line[x], 16);
+  }
+
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (appsink);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
+static guint64
+_sum_histogram (const GstStructure * s, const gchar * field)
+{
+  const GValue *histogram = gst_structure_get_value (s, field);
+  guint64 sum = 0;
+  guint i;
+
+  fail_unless (histogram != NULL);
+  for (i = 0; i < gst_value_array_get_size (histogram); i++)
+    sum += g_value_get_uint64 (gst_value_array_get_value (histogram, i));
+
+  return sum;
+}
+
+GST_START_TEST (test_stats)
+{
+  GstElement *bin, *mix;
+  GstStructure *stats;
+  const GstStructure *pad_stats;
+  const GValue *pads;
+  GstMessage *msg;
+  GstBus *bus;
+  guint64 val;
+  guint i;
+
+  bin = gst_parse_launch ("compositor name=c enable-stats=true "
+      "! video/x-raw,width=64,height=48 ! fakesink videotestsrc num-buffers=5 "
+      "! video/x-raw,format=I420,width=64,height=48,framerate=25/1 ! c. "
+      "videotestsrc num-buffers=5 "
+      "! video/x-raw,format=AYUV,width=32,height=24,framerate=25/1 ! c. ",
+      NULL);
+  fail_unless (bin != NULL);
+  mix = gst_bin_get_by_name (GST_BIN (bin), "c");
+  bus = gst_element_get_bus (bin);
+
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  g_object_get (mix, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  GST_INFO ("stats: %" GST_PTR_FORMAT, stats);
+
+  fail_unless (gst_structure_get_uint64 (stats, "processed", &val));
+  fail_unless_equals_uint64 (val, 5);
+  fail_unless (gst_structure_get_uint64 (stats, "timeouts", &val));
+  fail_unless_equals_uint64 (val, 0);
+  fail_unless_equals_uint64 (_sum_histogram (stats,
+          "aggregate-time-histogram"), 5);
+  fail_unless_equals_uint64 (_sum_histogram (stats, "blend-time-histogram"),
+      5);
+
+  pads = gst_structure_get_value (stats, "pads");
+  fail_unless (pads != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (pads), 2);
+  for (i = 0; i < 2; i++) {
+    pad_stats = gst_value_get_structure (gst_value_array_get_value (pads, i));
+    fail_unless (gst_structure_get_uint64 (pad_stats, "received", &val));
+    fail_unless_equals_uint64 (val, 5);
+    fail_unless (gst_structure_get_uint64 (pad_stats, "queued", &val));
+    fail_unless_equals_uint64 (val, 0);
+    fail_unless (gst_structure_get_uint64 (pad_stats, "missed", &val));
+    fail_unless_equals_uint64 (val, 0);
+    fail_unless (gst_structure_has_field (pad_stats, "max-lateness"));
+  }
+  gst_structure_free (stats);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (mix);
+  gst_object_unref (bin);
+}
+
+GST_END_TEST;
+
+static gboolean
+_pads_have_arrivals (GstElement * mix)
+{
+  GstStructure *stats;
+  const GValue *pads;
+  gboolean ret = TRUE;
+  guint i;
+
+  g_object_get (mix, "stats", &stats, NULL);
+  pads = gst_structure_get_value (stats, "pads");
+  fail_unless (pads != NULL);
+  fail_unless_equals_int (gst_value_array_get_size (pads), 2);
+  for (i = 0; i < 2; i++) {
+    const GstStructure *pad_stats =
+        gst_value_get_structure (gst_value_array_get_value (pads, i));
+
+    fail_unless (gst_structure_has_field (pad_stats, "skipped"));
+    fail_unless_equals_int (gst_structure_has_field (pad_stats, "received"),
+        gst_structure_has_field (pad_stats, "queued"));
+    ret &= gst_structure_has_field (pad_stats, "received");
+  }
+  gst_structure_free (stats);
+
+  return ret;
+}
+
+GST_START_TEST (test_stats_probe)
+{
+  GstElement *mix;
+  GstPad *sinkpad1, *sinkpad2;
+
+  mix = gst_element_factory_make ("compositor", NULL);
+  fail_unless (mix != NULL);
+
+  /* no arrival probe on the pads by default */
+  sinkpad1 = gst_element_get_request_pad (mix, "sink_%u");
+  sinkpad2 = gst_element_get_request_pad (mix, "sink_%u");
+  fail_if (_pads_have_arrivals (mix));
+
+  /* it is added to the existing pads and to the new ones */
+  g_object_set (mix, "enable-stats", TRUE, NULL);
+  gst_element_release_request_pad (mix, sinkpad2);
+  gst_object_unref (sinkpad2);
+  sinkpad2 = gst_element_get_request_pad (mix, "sink_%u");
+  fail_unless (_pads_have_arrivals (mix));
+
+  g_object_set (mix, "enable-stats", FALSE, NULL);
+  fail_if (_pads_have_arrivals (mix));
+
+  gst_element_release_request_pad (mix, sinkpad1);
+  gst_object_unref (sinkpad1);
+  gst_element_release_request_pad (mix, sinkpad2);
+  gst_object_unref (sinkpad2);
+  gst_object_unref (mix);
+}
+
+GST_END_TEST;
+
+/* Blending only the parts of the frame that changed must give the same
+ * output as blending everything again */
+GST_START_TEST (test_dirty_regions)
+{
+  const gchar *formats[] = { "I420", "YUY2", "AYUV", "RGB" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GPtrArray *ref, *buffers;
+
+    GST_INFO ("testing %s", formats[i]);
+    ref = _run_dirty_regions (formats[i], TRUE);
+    buffers = _run_dirty_regions (formats[i], FALSE);
+    fail_unless_equals_int (ref->len, 8);
+    _check_same_buffers (ref, buffers);
+
+    g_ptr_array_unref (buffers);
+    g_ptr_array_unref (ref);
+  }
+}
+
+GST_END_TEST;
+
+static gint n_input_maps;
+static gboolean (*input_default_map) (GstVideoMeta * meta, guint plane,
+    GstMapInfo * info, gpointer * data, gint * stride, GstMapFlags flags);
+
+static gboolean
+_count_input_maps (GstVideoMeta * meta, guint plane, GstMapInfo * info,
+    gpointer * data, gint * stride, GstMapFlags flags)
+{
+  g_atomic_int_inc (&n_input_maps);
+  return input_default_map (meta, plane, info, data, stride, flags);
+}
+
+/* sink_1 is scaled and converted and gets the same frame 8 times. With
+ * @deep_copy it is copied to new memory every time */
+static GPtrArray *
+_run_conversion_cache (gboolean deep_copy)
+{
+  GstElement *bin;
+  GstBuffer *background, *still;
+  GstVideoMeta *meta;
+  GstVideoInfo info0, info1;
+  GPtrArray *buffers;
+  guint i;
+
+  bin = gst_parse_launch ("compositor name=c "
+      "sink_1::xpos=20 sink_1::ypos=10 sink_1::width=80 sink_1::height=60 "
+      "! video/x-raw,format=I420,width=160,height=120 "
+      "! appsink name=sink sync=false "
+      "appsrc name=src0 format=time "
+      "caps=video/x-raw,format=I420,width=160,height=120,framerate=25/1 ! c. "
+      "appsrc name=src1 format=time "
+      "caps=video/x-raw,format=AYUV,width=40,height=30,framerate=25/1 ! c. ",
+      NULL);
+  fail_unless (bin != NULL);
+
+  gst_video_info_set_format (&info0, GST_VIDEO_FORMAT_I420, 160, 120);
+  gst_video_info_set_format (&info1, GST_VIDEO_FORMAT_AYUV, 40, 30);
+  background = _create_random_frame (&info0, 0);
+  still = _create_random_frame (&info1, 1);
+  meta = gst_buffer_add_video_meta (still, GST_VIDEO_FRAME_FLAG_NONE,
+      GST_VIDEO_FORMAT_AYUV, 40, 30);
+  input_default_map = meta->map;
+  meta->map = _count_input_maps;
+  n_input_maps = 0;
+
+  fail_unless (gst_element_set_state (bin,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 8; i++) {
+    _push_frame (bin, "src0", gst_buffer_copy_deep (background), i);
+    if (deep_copy)
+      _push_frame (bin, "src1", gst_buffer_copy_deep (still), i);
+    else
+      _push_frame (bin, "src1", gst_buffer_copy (still), i);
+  }
+  gst_buffer_unref (background);
+  gst_buffer_unref (still);
+
+  buffers = _pull_all_buffers (bin);
+
+  gst_element_set_state (bin, GST_STATE_NULL);
+  gst_object_unref (bin);
+
+  return buffers;
+}
+
+/* An unchanged input frame is only converted once */
+GST_START_TEST (test_conversion_cache)
+{
+  GPtrArray *ref, *buffers;
+
+  ref = _run_conversion_cache (TRUE);
+  fail_unless_equals_int (ref->len, 8);
+  fail_unless_equals_int (n_input_maps, 8);
+
+  buffers = _run_conversion_cache (FALSE);
+  fail_unless_equals_int (n_input_maps, 1);
+  _check_same_buffers (ref, buffers);
+
+  g_ptr_array_unref (buffers);
+  g_ptr_array_unref (ref);
+}
+
+GST_END_TEST;
+
 /* 
  * Test that the pad numbering assigned by aggregator behaves as follows:
  * 1. If a pad number is requested, it must be assigned if it is available
@@ -2099,8 +2825,18 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_flush_start_flush_stop);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_obscured_skipped);
+  tcase_add_test (tc_chain, test_obscured_by_several);
   tcase_add_test (tc_chain, test_ignore_eos);
   tcase_add_test (tc_chain, test_pad_z_order);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_n_prepare_threads);
+  tcase_add_test (tc_chain, test_dirty_regions);
+  tcase_add_test (tc_chain, test_conversion_cache);
+  tcase_add_test (tc_chain, test_checker_background);
+  tcase_add_test (tc_chain, test_checker_background_benchmark);
+  tcase_add_test (tc_chain, test_covered_background);
+  tcase_add_test (tc_chain, test_stats);
+  tcase_add_test (tc_chain, test_stats_probe);
   tcase_add_test (tc_chain, test_pad_numbering);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_3);
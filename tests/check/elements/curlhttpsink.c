@@ -5,6 +5,7 @@
 #include <gst/check/gstcheck.h>
 #include <glib/gstdio.h>
 #include <curl/curl.h>
+#include <gio/gio.h>
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -118,6 +119,288 @@ GST_START_TEST (test_properties)
 
 GST_END_TEST;
 
+/* A minimal HTTP/1.1 server that records the requests it gets, and on which
+ * connection */
+
+typedef struct
+{
+  gchar *method;
+  GString *body;
+  guint connection;
+} Request;
+
+static GSocketListener *listener;
+static GCancellable *cancellable;
+static GThread *server_thread;
+static GList *connection_threads;
+static guint16 server_port;
+static GMutex server_lock;
+static GPtrArray *requests;
+static guint n_connections;
+
+#define CONTINUE_RESPONSE "HTTP/1.1 100 Continue\r\n\r\n"
+#define OK_RESPONSE "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"
+
+static void
+request_free (Request * request)
+{
+  g_free (request->method);
+  g_string_free (request->body, TRUE);
+  g_free (request);
+}
+
+static gboolean
+read_request (GDataInputStream * in, GOutputStream * out, guint connection)
+{
+  Request *request;
+  gchar *line, **tokens;
+  gboolean chunked = FALSE;
+  gsize content_length = 0;
+
+  line = g_data_input_stream_read_line (in, NULL, cancellable, NULL);
+  if (line == NULL)
+    return FALSE;
+
+  tokens = g_strsplit (line, " ", 3);
+  g_free (line);
+  fail_unless (tokens[0] != NULL && tokens[1] != NULL);
+  request = g_new0 (Request, 1);
+  request->method = g_strdup (tokens[0]);
+  request->body = g_string_new (NULL);
+  request->connection = connection;
+  g_strfreev (tokens);
+
+  while ((line = g_data_input_stream_read_line (in, NULL, cancellable,
+              NULL)) && line[0] != '\0') {
+    if (g_ascii_strncasecmp (line, "Content-Length:", 15) == 0)
+      content_length = g_ascii_strtoull (line + 15, NULL, 10);
+    else if (g_ascii_strcasecmp (line, "Transfer-Encoding: chunked") == 0)
+      chunked = TRUE;
+    else if (g_ascii_strcasecmp (line, "Expect: 100-continue") == 0)
+      g_output_stream_write_all (out, CONTINUE_RESPONSE,
+          strlen (CONTINUE_RESPONSE), NULL, cancellable, NULL);
+    g_free (line);
+  }
+  fail_unless (line != NULL);
+  g_free (line);
+
+  do {
+    gchar *data;
+
+    if (chunked) {
+      line = g_data_input_stream_read_line (in, NULL, cancellable, NULL);
+      fail_unless (line != NULL);
+      content_length = g_ascii_strtoull (line, NULL, 16);
+      g_free (line);
+    }
+
+    data = g_malloc (content_length);
+    fail_unless (g_input_stream_read_all (G_INPUT_STREAM (in), data,
+            content_length, NULL, cancellable, NULL));
+    g_string_append_len (request->body, data, content_length);
+    g_free (data);
+
+    /* the CRLF after the chunk, or the empty trailer */
+    if (chunked) {
+      line = g_data_input_stream_read_line (in, NULL, cancellable, NULL);
+      fail_unless_equals_string (line, "");
+      g_free (line);
+    }
+  } while (chunked && content_length > 0);
+
+  g_mutex_lock (&server_lock);
+  g_ptr_array_add (requests, request);
+  g_mutex_unlock (&server_lock);
+
+  return g_output_stream_write_all (out, OK_RESPONSE, strlen (OK_RESPONSE),
+      NULL, cancellable, NULL);
+}
+
+static gpointer
+connection_thread_func (GSocketConnection * connection)
+{
+  GDataInputStream *in;
+  GOutputStream *out;
+  guint id;
+
+  g_mutex_lock (&server_lock);
+  id = n_connections++;
+  g_mutex_unlock (&server_lock);
+
+  in = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM
+          (connection)));
+  g_data_input_stream_set_newline_type (in, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+  out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  while (read_request (in, out, id));
+
+  g_object_unref (in);
+  g_object_unref (connection);
+
+  return NULL;
+}
+
+static gpointer
+server_thread_func (gpointer data)
+{
+  GSocketConnection *connection;
+
+  while ((connection = g_socket_listener_accept (listener, NULL, cancellable,
+              NULL))) {
+    GThread *thread = g_thread_new ("connection",
+        (GThreadFunc) connection_thread_func, connection);
+
+    g_mutex_lock (&server_lock);
+    connection_threads = g_list_prepend (connection_threads, thread);
+    g_mutex_unlock (&server_lock);
+  }
+
+  return NULL;
+}
+
+static gchar *
+start_server (void)
+{
+  listener = g_socket_listener_new ();
+  cancellable = g_cancellable_new ();
+  server_port = g_socket_listener_add_any_inet_port (listener, NULL, NULL);
+  fail_unless (server_port != 0);
+  requests = g_ptr_array_new_with_free_func ((GDestroyNotify) request_free);
+  n_connections = 0;
+  server_thread = g_thread_new ("server", server_thread_func, NULL);
+
+  return g_strdup_printf ("http://127.0.0.1:%u/upload", server_port);
+}
+
+static void
+stop_server (void)
+{
+  g_cancellable_cancel (cancellable);
+  g_thread_join (server_thread);
+  g_list_free_full (connection_threads, (GDestroyNotify) g_thread_join);
+  connection_threads = NULL;
+  g_socket_listener_close (listener);
+  g_object_unref (listener);
+  g_object_unref (cancellable);
+  g_ptr_array_unref (requests);
+  requests = NULL;
+}
+
+static void
+upload (GstPad * pad, GstElement * sink, const gchar ** lines)
+{
+  GstCaps *caps;
+
+  ASSERT_SET_STATE (sink, GST_STATE_PLAYING, GST_STATE_CHANGE_ASYNC);
+  caps = gst_caps_from_string ("text/plain");
+  gst_check_setup_events (pad, sink, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  for (; *lines; lines++) {
+    GstBuffer *buffer = gst_buffer_new_wrapped (g_strdup (*lines),
+        strlen (*lines));
+
+    fail_unless_equals_int (gst_pad_push (pad, buffer), GST_FLOW_OK);
+  }
+
+  /* returns once the server answered */
+  fail_unless (gst_pad_push_event (pad, gst_event_new_eos ()));
+}
+
+static void
+check_request (guint n, const gchar * method, const gchar ** lines)
+{
+  Request *request;
+  gchar *body = g_strjoinv (NULL, (gchar **) lines);
+
+  g_mutex_lock (&server_lock);
+  fail_unless (n < requests->len);
+  request = g_ptr_array_index (requests, n);
+  fail_unless_equals_string (request->method, method);
+  fail_unless_equals_string (request->body->str, body);
+  g_mutex_unlock (&server_lock);
+
+  g_free (body);
+}
+
+static const gchar *lines_a[] = { "line 1\r\n", "line 2\r\n", NULL };
+static const gchar *lines_b[] = { "line 3\r\n", "line 4\r\n", NULL };
+
+GST_START_TEST (test_put)
+{
+  GstElement *sink;
+  gchar *url = start_server ();
+
+  sink = setup_curlhttpsink ();
+  g_object_set (sink, "location", url, "use-content-length", FALSE,
+      "content-type", "text/plain", NULL);
+  gst_util_set_object_arg (G_OBJECT (sink), "http-method", "put");
+
+  /* streamed with chunked encoding */
+  upload (srcpad, sink, lines_a);
+  fail_unless_equals_int (requests->len, 1);
+  check_request (0, "PUT", lines_a);
+
+  ASSERT_SET_STATE (sink, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  cleanup_curlhttpsink (sink);
+  stop_server ();
+  g_free (url);
+}
+
+GST_END_TEST;
+
+static void
+check_two_sinks (gboolean shared_connections, guint expected_connections)
+{
+  GstElement *sink_a, *sink_b;
+  GstPad *pad_a, *pad_b;
+  gchar *url = start_server ();
+
+  sink_a = gst_check_setup_element ("curlhttpsink");
+  sink_b = gst_check_setup_element ("curlhttpsink");
+  pad_a = gst_check_setup_src_pad (sink_a, &srctemplate);
+  pad_b = gst_check_setup_src_pad (sink_b, &srctemplate);
+  fail_unless (gst_pad_set_active (pad_a, TRUE));
+  fail_unless (gst_pad_set_active (pad_b, TRUE));
+  g_object_set (sink_a, "location", url, "use-content-length", FALSE,
+      "shared-connections", shared_connections, NULL);
+  g_object_set (sink_b, "location", url, "use-content-length", FALSE,
+      "shared-connections", shared_connections, NULL);
+
+  /* the first sink keeps running while the second one uploads */
+  upload (pad_a, sink_a, lines_a);
+  upload (pad_b, sink_b, lines_b);
+
+  fail_unless_equals_int (requests->len, 2);
+  check_request (0, "POST", lines_a);
+  check_request (1, "POST", lines_b);
+  fail_unless_equals_int (n_connections, expected_connections);
+
+  ASSERT_SET_STATE (sink_a, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  ASSERT_SET_STATE (sink_b, GST_STATE_NULL, GST_STATE_CHANGE_SUCCESS);
+  gst_check_teardown_src_pad (sink_a);
+  gst_check_teardown_src_pad (sink_b);
+  gst_check_teardown_element (sink_a);
+  gst_check_teardown_element (sink_b);
+  stop_server ();
+  g_free (url);
+}
+
+GST_START_TEST (test_shared_connections)
+{
+  /* the second sink reuses the connection of the first one */
+  check_two_sinks (TRUE, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_own_connections)
+{
+  check_two_sinks (FALSE, 2);
+}
+
+GST_END_TEST;
+
 static Suite *
 curlsink_suite (void)
 {
@@ -127,6 +410,9 @@ curlsink_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_set_timeout (tc_chain, 20);
   tcase_add_test (tc_chain, test_properties);
+  tcase_add_test (tc_chain, test_put);
+  tcase_add_test (tc_chain, test_shared_connections);
+  tcase_add_test (tc_chain, test_own_connections);
 
   return s;
 }
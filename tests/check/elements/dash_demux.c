@@ -464,6 +464,9 @@ setAndTestDashParams (GstAdaptiveDemuxTestEngine * engine, gpointer user_data)
   test_float_prop (dashdemux, "bitrate-limit", 1);
   test_invalid_float_prop (dashdemux, "bitrate-limit", 2.1);
 
+  test_int_prop (dashdemux, "abr-algorithm", 1);
+  test_invalid_int_prop (dashdemux, "abr-algorithm", 3);
+
   test_int_prop (dashdemux, "max-buffering-time", 15);
   test_invalid_int_prop (dashdemux, "max-buffering-time", 1);
 
@@ -996,6 +996,61 @@ GST_START_TEST
 
 GST_END_TEST;
 
+/*
+ * Test that the S nodes continuing each other with the same duration are
+ * merged into a single repeated S node
+ */
+GST_START_TEST
+    (dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_segmentTimeline_merge)
+{
+  GstPeriodNode *periodNode;
+  GstSegmentTemplateNode *segmentTemplate;
+  GstMultSegmentBaseType *multSegBaseType;
+  GstSegmentTimelineNode *segmentTimeline;
+  GstSNode *sNode;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-main:2011\">"
+      "  <Period>"
+      "    <SegmentTemplate>"
+      "      <SegmentTimeline>"
+      "        <S t=\"1\" d=\"2\" r=\"3\"/>"
+      "        <S d=\"2\"/>"
+      "        <S t=\"11\" d=\"2\" r=\"1\"/>"
+      "        <S t=\"20\" d=\"2\"/>"
+      "        <S d=\"3\"/>"
+      "      </SegmentTimeline></SegmentTemplate></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  segmentTemplate = periodNode->SegmentTemplate;
+  multSegBaseType = segmentTemplate->MultSegBaseType;
+  segmentTimeline = (GstSegmentTimelineNode *) multSegBaseType->SegmentTimeline;
+  assert_equals_int (g_queue_get_length (&segmentTimeline->S), 3);
+  sNode = (GstSNode *) g_queue_peek_nth (&segmentTimeline->S, 0);
+  assert_equals_uint64 (sNode->t, 1);
+  assert_equals_uint64 (sNode->d, 2);
+  assert_equals_uint64 (sNode->r, 6);
+  sNode = (GstSNode *) g_queue_peek_nth (&segmentTimeline->S, 1);
+  assert_equals_uint64 (sNode->t, 20);
+  assert_equals_uint64 (sNode->d, 2);
+  assert_equals_uint64 (sNode->r, 0);
+  sNode = (GstSNode *) g_queue_peek_nth (&segmentTimeline->S, 2);
+  assert_equals_uint64 (sNode->t, 0);
+  assert_equals_uint64 (sNode->d, 3);
+  assert_equals_uint64 (sNode->r, 0);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test parsing Period SegmentTemplate MultipleSegmentBaseType
  * BitstreamSwitching attributes
@@ -4673,6 +4728,95 @@ GST_START_TEST (dash_mpdparser_segment_template)
 
 GST_END_TEST;
 
+/*
+ * Test seeking in a SegmentTimeline made of several runs of segments
+ *
+ */
+GST_START_TEST (dash_mpdparser_segment_timeline_seek)
+{
+  GList *adaptationSets;
+  GstAdaptationSetNode *adapt_set;
+  GstActiveStream *activeStream;
+  GstClockTime ts;
+
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-on-demand:2011\""
+      "     mediaPresentationDuration=\"P0Y0M0DT0H4M4S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"$Number$.mp4\">"
+      "          <SegmentTimeline>"
+      "            <S t=\"0\" d=\"2\" r=\"99\"/>"
+      "            <S t=\"210\" d=\"3\" r=\"9\"/>"
+      "            <S d=\"4\"/>"
+      "          </SegmentTimeline>"
+      "        </SegmentTemplate>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  ret =
+      gst_mpd_client_setup_media_presentation (mpdclient, GST_CLOCK_TIME_NONE,
+      -1, NULL);
+  assert_equals_int (ret, TRUE);
+
+  adaptationSets = gst_mpd_client_get_adaptation_sets (mpdclient);
+  fail_if (adaptationSets == NULL);
+  adapt_set = (GstAdaptationSetNode *) g_list_nth_data (adaptationSets, 0);
+  fail_if (adapt_set == NULL);
+  ret = gst_mpd_client_setup_streaming (mpdclient, adapt_set);
+  assert_equals_int (ret, TRUE);
+
+  activeStream = gst_mpdparser_get_active_stream_by_index (mpdclient, 0);
+  fail_if (activeStream == NULL);
+  fail_if (activeStream->segments == NULL);
+  assert_equals_int (activeStream->segments->len, 3);
+
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      51 * GST_SECOND, &ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (ts, 50 * GST_SECOND);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 25);
+
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      223 * GST_SECOND, &ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (ts, 222 * GST_SECOND);
+  assert_equals_int (activeStream->segment_index, 1);
+  assert_equals_int (activeStream->segment_repeat_index, 4);
+
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      241 * GST_SECOND, &ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (ts, 240 * GST_SECOND);
+  assert_equals_int (activeStream->segment_index, 2);
+  assert_equals_int (activeStream->segment_repeat_index, 0);
+
+  /* in reverse mode the end of a segment belongs to it */
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, FALSE, 0,
+      200 * GST_SECOND, &ts);
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (ts, 198 * GST_SECOND);
+  assert_equals_int (activeStream->segment_index, 0);
+  assert_equals_int (activeStream->segment_repeat_index, 99);
+
+  ret = gst_mpd_client_stream_seek (mpdclient, activeStream, TRUE, 0,
+      300 * GST_SECOND, &ts);
+  assert_equals_int (ret, FALSE);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test segment timeline
  *
@@ -5888,6 +6032,8 @@ dash_suite (void)
       dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_segmentTimeline);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_segmentTimeline_s);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_segmentTimeline_merge);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_segmentTemplate_multipleSegmentBaseType_bitstreamSwitching);
   tcase_add_test (tc_simpleMPD, dash_mpdparser_period_adaptationSet);
@@ -5999,6 +6145,7 @@ dash_suite (void)
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_list);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_template);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline_seek);
   tcase_add_test (tc_complexMPD, dash_mpdparser_multiple_inherited_segmentURL);
 
   /* tests checking the parsing of missing/incomplete attributes of xml */
@@ -48,6 +48,35 @@ GST_START_TEST (test_create_and_unref)
 
 GST_END_TEST;
 
+GST_START_TEST (test_key_type)
+{
+  GstElement *e1, *e2;
+  gchar *pem1, *pem2;
+
+  /* without a reuse limit, decoders share the generated certificate */
+  e1 = gst_element_factory_make ("dtlsdec", NULL);
+  e2 = gst_element_factory_make ("dtlsdec", NULL);
+  g_object_get (e1, "pem", &pem1, NULL);
+  g_object_get (e2, "pem", &pem2, NULL);
+  fail_unless (pem1 != NULL);
+  fail_unless (g_str_has_prefix (pem1, "-----BEGIN CERTIFICATE-----"));
+  fail_unless_equals_string (pem1, pem2);
+  g_free (pem2);
+
+  gst_util_set_object_arg (G_OBJECT (e2), "key-type", "ecdsa");
+  g_object_get (e2, "pem", &pem2, NULL);
+  fail_unless (pem2 != NULL);
+  fail_unless (g_str_has_prefix (pem2, "-----BEGIN CERTIFICATE-----"));
+  fail_if (g_strcmp0 (pem1, pem2) == 0);
+
+  g_free (pem1);
+  g_free (pem2);
+  gst_object_unref (e1);
+  gst_object_unref (e2);
+}
+
+GST_END_TEST;
+
 static GMutex key_lock;
 static GCond key_cond;
 static int key_count;
@@ -184,6 +213,7 @@ dtls_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_create_and_unref);
+  tcase_add_test (tc_chain, test_key_type);
   tcase_add_test (tc_chain, test_data_transfer);
 
   return s;
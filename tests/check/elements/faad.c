@@ -193,6 +193,132 @@ GST_START_TEST (test_raw)
 
 GST_END_TEST;
 
+/* the ADTS frame above, 1024 samples at 48kHz */
+#define ADTS_FRAME_SIZE (sizeof (adts_header) + sizeof (raw_data_block))
+#define N_FRAMES 200
+#define FRAMES_PER_BUFFER 4
+
+static GstEvent *upstream_seek;
+
+static gboolean
+src_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEEK) {
+    fail_unless (upstream_seek == NULL);
+    upstream_seek = event;
+    return TRUE;
+  }
+
+  gst_event_unref (event);
+  return FALSE;
+}
+
+/* Pushes an unframed ADTS stream from the given frame on, with the byte
+ * offsets set on the buffers */
+static void
+push_adts_stream (guint first_frame)
+{
+  guint i, j;
+
+  for (i = first_frame; i < N_FRAMES; i += FRAMES_PER_BUFFER) {
+    GstBuffer *buf;
+
+    buf = gst_buffer_new_and_alloc (FRAMES_PER_BUFFER * ADTS_FRAME_SIZE);
+    for (j = 0; j < FRAMES_PER_BUFFER; j++) {
+      gst_buffer_fill (buf, j * ADTS_FRAME_SIZE, adts_header,
+          sizeof (adts_header));
+      gst_buffer_fill (buf, j * ADTS_FRAME_SIZE + sizeof (adts_header),
+          raw_data_block, sizeof (raw_data_block));
+    }
+    GST_BUFFER_OFFSET (buf) = i * ADTS_FRAME_SIZE;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+  }
+}
+
+static guint
+count_output_samples (void)
+{
+  GList *l;
+  guint samples = 0;
+
+  for (l = buffers; l; l = l->next)
+    samples += gst_buffer_get_size (l->data) / (2 * 2);
+
+  return samples;
+}
+
+GST_START_TEST (test_adts_index_seek)
+{
+  GstElement *faad;
+  GstCaps *caps;
+  GstSegment segment;
+  GstEvent *seek;
+  GstSeekType start_type, stop_type;
+  GstSeekFlags flags;
+  GstFormat format;
+  gdouble rate;
+  gint64 start, stop;
+  guint64 target_sample;
+
+  faad = setup_faad ();
+  gst_pad_set_event_function (mysrcpad, src_event);
+  fail_unless (gst_element_set_state (faad,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string ("audio/mpeg, mpegversion = (int) 4, "
+      "stream-format = (string) adts, framed = (boolean) false");
+  gst_check_setup_events (mysrcpad, faad, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  /* builds the index */
+  push_adts_stream (0);
+  fail_unless (count_output_samples () > 0);
+  gst_check_drop_buffers ();
+
+  /* 300 samples into the 100th frame */
+  target_sample = 100 * 1024 + 300;
+  seek = gst_event_new_seek (1.0, GST_FORMAT_TIME,
+      GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, GST_SEEK_TYPE_SET,
+      gst_util_uint64_scale (target_sample, GST_SECOND, 48000),
+      GST_SEEK_TYPE_NONE, -1);
+  gst_event_ref (seek);
+  fail_unless (gst_pad_push_event (mysinkpad, seek));
+
+  /* the index entries are 16 frames apart, the one at frame 96 is less than
+   * 100ms before the target so the decoder starts at frame 80 */
+  fail_unless (upstream_seek != NULL);
+  fail_unless_equals_int (gst_event_get_seqnum (upstream_seek),
+      gst_event_get_seqnum (seek));
+  gst_event_parse_seek (upstream_seek, &rate, &format, &flags, &start_type,
+      &start, &stop_type, &stop);
+  fail_unless_equals_int (format, GST_FORMAT_BYTES);
+  fail_unless_equals_int (start_type, GST_SEEK_TYPE_SET);
+  fail_unless_equals_uint64 (start, 80 * ADTS_FRAME_SIZE);
+  gst_event_unref (upstream_seek);
+  upstream_seek = NULL;
+  gst_event_unref (seek);
+
+  /* act as the upstream element doing the seek */
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_flush_start ()));
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_flush_stop (TRUE)));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  segment.start = segment.time = segment.position = start;
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_segment (&segment)));
+  push_adts_stream (80);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  /* everything before the target is dropped, to the sample */
+  fail_unless_equals_int (count_output_samples (),
+      N_FRAMES * 1024 - target_sample);
+
+  gst_check_drop_buffers ();
+  cleanup_faad (faad);
+}
+
+GST_END_TEST;
+
 static Suite *
 faad_suite (void)
 {
@@ -202,6 +328,7 @@ faad_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_adts);
   tcase_add_test (tc_chain, test_raw);
+  tcase_add_test (tc_chain, test_adts_index_seek);
 
   return s;
 }
@@ -0,0 +1,227 @@
+/* GStreamer unit test for fieldanalysis
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+/* the comb detection is internal to the plugin */
+#include "../../gst/fieldanalysis/gstfieldanalysiscomb.c"
+
+#define WIDTH 320
+#define HEIGHT 243
+#define N_FRAMES 12
+
+/* Vertical bars moving to the right, every third frame has its odd field
+ * from further on, so that it is combed along the edges of the bars */
+static GstBuffer *
+create_frame (GstVideoInfo * info, guint n)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, info->size, NULL);
+  GstVideoFrame frame;
+  guint8 *data;
+  gint stride, pstride, x, y;
+
+  gst_buffer_memset (buf, 0, 128, info->size);
+  fail_unless (gst_video_frame_map (&frame, info, buf, GST_MAP_WRITE));
+
+  data = GST_VIDEO_FRAME_COMP_DATA (&frame, 0);
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
+  pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (&frame, 0);
+  for (y = 0; y < HEIGHT; y++) {
+    gint pos = 4 * n + ((y & 1) && n % 3 == 2 ? 9 : 0);
+
+    for (x = 0; x < WIDTH; x++) {
+      gint v = ((x + pos) / 12) % 2 ? 200 : 40;
+
+      data[y * stride + x * pstride] = v + ((x * 7 + y * 13 + n) % 5);
+    }
+  }
+  gst_video_frame_unmap (&frame);
+
+  GST_BUFFER_PTS (buf) = gst_util_uint64_scale (n, GST_SECOND, 30);
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (1, GST_SECOND, 30);
+
+  return buf;
+}
+
+static GstPadProbeReturn
+record_output (GstPad * pad, GstPadProbeInfo * info, GString * output)
+{
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstCaps *caps = gst_pad_get_current_caps (pad);
+  GstStructure *s = gst_caps_get_structure (caps, 0);
+
+  g_string_append_printf (output, "%" GST_TIME_FORMAT " %s%s%s%s %s\n",
+      GST_TIME_ARGS (GST_BUFFER_PTS (buf)),
+      GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_INTERLACED) ?
+      "i" : "-",
+      GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_TFF) ? "t" : "-",
+      GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_RFF) ? "r" : "-",
+      GST_BUFFER_FLAG_IS_SET (buf, GST_VIDEO_BUFFER_FLAG_ONEFIELD) ?
+      "o" : "-", gst_structure_get_string (s, "interlace-mode"));
+  gst_caps_unref (caps);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* returns the flags and interlace mode of every output frame */
+static gchar *
+run_fieldanalysis (const gchar * format, const gchar * properties,
+    guint n_threads)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+  GString *output = g_string_new (NULL);
+  GstBuffer *buf;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("fieldanalysis %s n-threads=%u", properties,
+      n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+  gst_pad_add_probe (h->sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) record_output, output, NULL);
+
+  gst_video_info_set_format (&info, gst_video_format_from_string (format),
+      WIDTH, HEIGHT);
+  GST_VIDEO_INFO_FPS_N (&info) = 30;
+  GST_VIDEO_INFO_FPS_D (&info) = 1;
+  gst_harness_set_src_caps (h, gst_video_info_to_caps (&info));
+
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int (gst_harness_push (h, create_frame (&info, i)),
+        GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h)))
+    gst_buffer_unref (buf);
+  gst_harness_teardown (h);
+
+  fail_unless (output->len > 0);
+  GST_LOG ("%s %s n-threads=%u:\n%s", format, properties, n_threads,
+      output->str);
+
+  return g_string_free (output, FALSE);
+}
+
+static const gchar *properties[] = {
+  "",
+  "field-metric=ssd",
+  "frame-metric=windowed-comb comb-method=32-detect",
+  "frame-metric=windowed-comb comb-method=isCombed",
+  "frame-metric=windowed-comb comb-method=5-tap spatial-threshold=3",
+};
+
+/* Computing the metrics in stripes must come to the same conclusions as
+ * computing them on the whole frame in one go */
+GST_START_TEST (test_n_threads)
+{
+  const gchar *formats[] = { "I420", "YUY2" };
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i, j, k;
+
+  for (i = 0; i < G_N_ELEMENTS (properties); i++) {
+    for (k = 0; k < G_N_ELEMENTS (formats); k++) {
+      gchar *ref = run_fieldanalysis (formats[k], properties[i], 1);
+
+      for (j = 0; j < G_N_ELEMENTS (n_threads); j++) {
+        gchar *output = run_fieldanalysis (formats[k], properties[i],
+            n_threads[j]);
+
+        fail_unless_equals_string (output, ref);
+        g_free (output);
+      }
+      g_free (ref);
+    }
+  }
+}
+
+GST_END_TEST;
+
+#define MAX_WIDTH 333
+
+/* The vector comb detection only runs on planar luma, check it against the
+ * per sample code used for the packed formats */
+GST_START_TEST (test_comb_mask_simd)
+{
+  FieldAnalysisCombMethod methods[] = {
+    METHOD_32DETECT, METHOD_IS_COMBED, METHOD_5_TAP
+  };
+  gint64 thresholds[] = { 0, 3, 9, 40, 255, 300 };
+  guint8 lines[5][MAX_WIDTH], packed[5][2 * MAX_WIDTH];
+  guint8 mask[MAX_WIDTH], ref[MAX_WIDTH];
+  guint i, j, k, run;
+  gint width, x;
+
+  g_random_set_seed (7);
+  for (run = 0; run < 8; run++) {
+    /* noise, then lines alternating between two levels with less and less
+     * noise, for every method to find combing */
+    for (k = 0; k < 5; k++) {
+      for (x = 0; x < MAX_WIDTH; x++) {
+        if (run == 0)
+          lines[k][x] = g_random_int_range (0, 256);
+        else
+          lines[k][x] = ((k + (x / 5)) & 1 ? 180 : 30) +
+              g_random_int_range (0, (64 >> run) + 1);
+        packed[k][2 * x] = lines[k][x];
+        packed[k][2 * x + 1] = 128;
+      }
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (methods); i++) {
+      for (j = 0; j < G_N_ELEMENTS (thresholds); j++) {
+        for (width = 1; width <= MAX_WIDTH; width += width < 40 ? 1 : 41) {
+          gst_field_analysis_comb_mask_line (methods[i], mask, lines[0],
+              lines[1], lines[2], lines[3], lines[4], width, 1,
+              thresholds[j]);
+          gst_field_analysis_comb_mask_line (methods[i], ref, packed[0],
+              packed[1], packed[2], packed[3], packed[4], width, 2,
+              thresholds[j]);
+          fail_unless (memcmp (mask, ref, width) == 0,
+              "method %d, threshold %" G_GINT64_FORMAT ", width %d differ",
+              methods[i], thresholds[j], width);
+        }
+      }
+    }
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+fieldanalysis_suite (void)
+{
+  Suite *s = suite_create ("fieldanalysis");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_comb_mask_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fieldanalysis);
@@ -0,0 +1,295 @@
+/* GStreamer unit test for freeverb
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+
+#define N_FRAMES 20000
+
+#define ROOM_SIZE 0.8f
+#define DAMPING 0.35f
+#define WIDTH 0.7f
+#define LEVEL 0.6f
+
+/* per sample version of the reverb model, as in the original Freeverb */
+
+typedef struct
+{
+  gfloat *buffer;
+  gint bufsize;
+  gint bufidx;
+  gfloat filterstore;
+} RefDelay;
+
+static const gint comb_tuning[] = {
+  1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617
+};
+
+static const gint allpass_tuning[] = { 556, 441, 341, 225 };
+
+#define STEREO_SPREAD 23
+
+/* the element only keeps the filters away from denormals with an offset
+ * where it doesn't flush them to zero */
+#if defined (__SSE2__) || defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define DC_OFFSET 0
+#else
+#define DC_OFFSET 1e-8
+#endif
+
+typedef struct
+{
+  RefDelay comb[2][G_N_ELEMENTS (comb_tuning)];
+  RefDelay allpass[2][G_N_ELEMENTS (allpass_tuning)];
+  gfloat feedback, damp1, damp2, gain;
+  gfloat wet1, wet2, dry;
+} RefModel;
+
+static void
+ref_delay_init (RefDelay * delay, gint size)
+{
+  gint i;
+
+  delay->bufsize = MAX (size, 1);
+  delay->buffer = g_new (gfloat, delay->bufsize);
+  for (i = 0; i < delay->bufsize; i++)
+    delay->buffer[i] = (gfloat) DC_OFFSET;
+  delay->bufidx = 0;
+  delay->filterstore = 0;
+}
+
+static void
+ref_model_init (RefModel * model, gint rate)
+{
+  gfloat srfactor = rate / 44100.0f;
+  gfloat wet = LEVEL, width = WIDTH;
+  guint c, i;
+
+  for (c = 0; c < 2; c++) {
+    for (i = 0; i < G_N_ELEMENTS (comb_tuning); i++)
+      ref_delay_init (&model->comb[c][i],
+          (comb_tuning[i] + c * STEREO_SPREAD) * srfactor);
+    for (i = 0; i < G_N_ELEMENTS (allpass_tuning); i++)
+      ref_delay_init (&model->allpass[c][i],
+          (allpass_tuning[i] + c * STEREO_SPREAD) * srfactor);
+  }
+
+  /* the same single precision expressions as the element */
+  model->feedback = (ROOM_SIZE * 0.28f) + 0.7f;
+  model->damp1 = DAMPING;
+  model->damp2 = 1 - DAMPING;
+  model->gain = 0.015f;
+  model->dry = (1.0 - LEVEL) * 1.0f;
+  model->wet1 = wet * (width / 2.0f + 0.5f);
+  model->wet2 = wet * ((1.0f - width) / 2.0f);
+}
+
+static void
+ref_model_free (RefModel * model)
+{
+  guint c, i;
+
+  for (c = 0; c < 2; c++) {
+    for (i = 0; i < G_N_ELEMENTS (comb_tuning); i++)
+      g_free (model->comb[c][i].buffer);
+    for (i = 0; i < G_N_ELEMENTS (allpass_tuning); i++)
+      g_free (model->allpass[c][i].buffer);
+  }
+}
+
+static gfloat
+ref_model_process (RefModel * model, gint c, gfloat input)
+{
+  gfloat out = 0.0;
+  guint i;
+
+  /* combs in parallel */
+  for (i = 0; i < G_N_ELEMENTS (comb_tuning); i++) {
+    RefDelay *comb = &model->comb[c][i];
+    gfloat tmp = comb->buffer[comb->bufidx];
+
+    comb->filterstore = (tmp * model->damp2) +
+        (comb->filterstore * model->damp1);
+    comb->buffer[comb->bufidx] = input + (comb->filterstore * model->feedback);
+    if (++comb->bufidx >= comb->bufsize)
+      comb->bufidx = 0;
+    out += tmp;
+  }
+
+  /* allpasses in series */
+  for (i = 0; i < G_N_ELEMENTS (allpass_tuning); i++) {
+    RefDelay *allpass = &model->allpass[c][i];
+    gfloat bufout = allpass->buffer[allpass->bufidx];
+
+    allpass->buffer[allpass->bufidx] = out + (bufout * 0.5f);
+    if (++allpass->bufidx >= allpass->bufsize)
+      allpass->bufidx = 0;
+    out = bufout - out;
+  }
+
+  return out;
+}
+
+/* Runs the interleaved input through the per sample model, the input
+ * samples of S16 are kept as floats */
+static void
+ref_freeverb (gint rate, gint channels, gboolean is_float,
+    const gfloat * in, gpointer out, gint n_frames)
+{
+  RefModel model;
+  gint k;
+
+  ref_model_init (&model, rate);
+
+  for (k = 0; k < n_frames; k++) {
+    gfloat in_l = in[k * channels], in_r = in[k * channels + channels - 1];
+    gfloat out_l1, out_r1, out_l2, out_r2;
+
+    if (channels == 1) {
+      gfloat input = (2.0f * in_l + DC_OFFSET) * model.gain;
+
+      out_l1 = ref_model_process (&model, 0, input);
+      out_r1 = ref_model_process (&model, 1, input);
+    } else {
+      out_l1 = ref_model_process (&model, 0, (in_l + DC_OFFSET) * model.gain);
+      out_r1 = ref_model_process (&model, 1, (in_r + DC_OFFSET) * model.gain);
+    }
+    out_l1 -= (gfloat) DC_OFFSET;
+    out_r1 -= (gfloat) DC_OFFSET;
+
+    out_l2 = out_l1 * model.wet1 + out_r1 * model.wet2 + in_l * model.dry;
+    out_r2 = out_r1 * model.wet1 + out_l1 * model.wet2 + in_r * model.dry;
+    if (is_float) {
+      ((gfloat *) out)[2 * k] = out_l2;
+      ((gfloat *) out)[2 * k + 1] = out_r2;
+    } else {
+      ((gint16 *) out)[2 * k] = CLAMP (out_l2, G_MININT16, G_MAXINT16);
+      ((gint16 *) out)[2 * k + 1] = CLAMP (out_r2, G_MININT16, G_MAXINT16);
+    }
+  }
+
+  ref_model_free (&model);
+}
+
+static void
+check_freeverb (gint rate, gint channels, GstAudioFormat format)
+{
+  /* buffers shorter and longer than a block and than the delay lines */
+  gint sizes[] = { 1, 37, 128, 129, 1000, 4096, 3 };
+  gboolean is_float = format == GST_AUDIO_FORMAT_F32;
+  gint bps = is_float ? 4 : 2;
+  gfloat *in = g_new (gfloat, N_FRAMES * channels);
+  guint8 *out = g_malloc (N_FRAMES * 2 * bps);
+  guint8 *ref = g_malloc (N_FRAMES * 2 * bps);
+  GstHarness *h;
+  GstBuffer *buf;
+  GstMapInfo map;
+  gchar *caps;
+  gint k, i, n;
+
+  GST_INFO ("%s, %d channels at %d Hz", gst_audio_format_to_string (format),
+      channels, rate);
+
+  for (k = 0; k < N_FRAMES * channels; k++) {
+    if (is_float)
+      in[k] = g_random_double_range (-0.8, 0.8);
+    else
+      in[k] = g_random_int_range (-24000, 24000);
+  }
+  ref_freeverb (rate, channels, is_float, in, ref, N_FRAMES);
+
+  h = gst_harness_new_parse ("freeverb room-size=0.8 damping=0.35 "
+      "width=0.7 level=0.6");
+  caps = g_strdup_printf ("audio/x-raw,format=%s,layout=interleaved,"
+      "rate=%d,channels=%d", gst_audio_format_to_string (format), rate,
+      channels);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  for (k = 0, i = 0; k < N_FRAMES; k += n, i++) {
+    n = MIN (sizes[i % G_N_ELEMENTS (sizes)], N_FRAMES - k);
+    buf = gst_buffer_new_allocate (NULL, n * channels * bps, NULL);
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+    if (is_float)
+      memcpy (map.data, in + k * channels, map.size);
+    else {
+      gint j;
+
+      for (j = 0; j < n * channels; j++)
+        ((gint16 *) map.data)[j] = in[k * channels + j];
+    }
+    gst_buffer_unmap (buf, &map);
+
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+    buf = gst_harness_pull (h);
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, n * 2 * bps);
+    memcpy (out + k * 2 * bps, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  for (k = 0; k < N_FRAMES; k++) {
+    fail_unless (memcmp (out + k * 2 * bps, ref + k * 2 * bps, 2 * bps) == 0,
+        "%s, %d channels at %d Hz: frame %d differs",
+        gst_audio_format_to_string (format), channels, rate, k);
+  }
+
+  gst_harness_teardown (h);
+  g_free (in);
+  g_free (out);
+  g_free (ref);
+}
+
+/* Processing in blocks with the combs in vector lanes must give exactly the
+ * same samples as running every sample through the filters one after the
+ * other, also when the delay lines are shorter than a block */
+GST_START_TEST (test_block_simd)
+{
+  gint rates[] = { 44100, 8000, 2000, 100 };
+  guint i;
+
+  g_random_set_seed (19);
+  for (i = 0; i < G_N_ELEMENTS (rates); i++) {
+    check_freeverb (rates[i], 1, GST_AUDIO_FORMAT_F32);
+    check_freeverb (rates[i], 2, GST_AUDIO_FORMAT_F32);
+    check_freeverb (rates[i], 1, GST_AUDIO_FORMAT_S16);
+    check_freeverb (rates[i], 2, GST_AUDIO_FORMAT_S16);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+freeverb_suite (void)
+{
+  Suite *s = suite_create ("freeverb");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_block_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (freeverb);
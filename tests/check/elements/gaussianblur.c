@@ -0,0 +1,235 @@
+/* GStreamer unit test for gaussianblur
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* the convolution passes are internal to the plugin */
+#include "../../gst/gaudieffects/gstgaussblurpass.c"
+
+#define N_FRAMES 3
+
+static GList *
+run_gaussianblur (const gchar * properties, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *buffers = NULL;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("gaussianblur %s n-threads=%u", properties,
+      n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  /* odd height, so the stripes don't split the frame evenly */
+  gst_harness_add_src_parse (h, "videotestsrc pattern=smpte ! "
+      "video/x-raw,format=AYUV,width=320,height=243,framerate=25/1", FALSE);
+
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int (gst_harness_push_from_src (h), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h)))
+    buffers = g_list_append (buffers, buf);
+  fail_unless_equals_int (g_list_length (buffers), N_FRAMES);
+
+  gst_harness_teardown (h);
+
+  return buffers;
+}
+
+static void
+check_n_threads (const gchar * properties)
+{
+  GList *ref, *buffers, *l, *m;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = run_gaussianblur (properties, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s, n-threads=%u", properties, n_threads[i]);
+    buffers = run_gaussianblur (properties, n_threads[i]);
+
+    for (l = ref, m = buffers; l && m; l = l->next, m = m->next) {
+      GstMapInfo ref_map, map;
+
+      fail_unless (gst_buffer_map (l->data, &ref_map, GST_MAP_READ));
+      fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+      fail_unless_equals_int (map.size, ref_map.size);
+      fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+      gst_buffer_unmap (m->data, &map);
+      gst_buffer_unmap (l->data, &ref_map);
+    }
+
+    g_list_free_full (buffers, (GDestroyNotify) gst_buffer_unref);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Blurring in stripes of rows, or of columns for the vertical box passes,
+ * must give exactly the same output as blurring the whole frame in one
+ * go */
+GST_START_TEST (test_n_threads)
+{
+  check_n_threads ("sigma=1.2");
+  check_n_threads ("sigma=0.3");
+  check_n_threads ("sigma=-2.0");
+  check_n_threads ("sigma=6.0");
+  check_n_threads ("method=box sigma=6.0");
+  check_n_threads ("method=box sigma=-3.0");
+}
+
+GST_END_TEST;
+
+#define MAX_WIDTH 200
+#define MAX_TAPS 102
+
+/* the Q12 kernel of the element, including the sharpening variant */
+static gint
+make_coeffs (gint16 * coeffs, gfloat sigma)
+{
+  gint center = ceil (2.5 * fabs (sigma));
+  gint windowsize = 1 + 2 * center;
+  gfloat kernel[MAX_TAPS];
+  gfloat sum = 0.0;
+  gint i, isum = 0;
+
+  memset (coeffs, 0, MAX_TAPS * sizeof (gint16));
+  for (i = 0; i < windowsize; i++) {
+    kernel[i] = exp (-0.5 * (i - center) * (i - center) / (sigma * sigma));
+    sum += kernel[i];
+  }
+  if (sigma < 0) {
+    sum = -sum;
+    kernel[center] += 2.0 * sum;
+  }
+  for (i = 0; i < windowsize; i++) {
+    coeffs[i] = floor (kernel[i] / sum * (1 << 12) + 0.5);
+    isum += coeffs[i];
+  }
+  coeffs[center] += (1 << 12) - isum;
+
+  return windowsize;
+}
+
+/* The vector passes must give the same values as the per sample code that
+ * handles the rest of each row */
+GST_START_TEST (test_passes_simd)
+{
+  gfloat sigmas[] = { 0.3, 1.2, 3.0, -0.8, -2.0, -5.0, 20.0 };
+  gint16 coeffs[MAX_TAPS];
+  guint8 *data, *out, *ref;
+  const guint8 *rows[MAX_TAPS];
+  gint16 *tmp, *tmp_ref;
+  guint i, run;
+  gint k, x, n;
+
+  data = g_malloc (MAX_TAPS * 4 * MAX_WIDTH);
+  tmp = g_new0 (gint16, 4 * (MAX_WIDTH + MAX_TAPS + 1));
+  tmp_ref = g_new0 (gint16, 4 * (MAX_WIDTH + MAX_TAPS + 1));
+  out = g_malloc (4 * MAX_WIDTH);
+  ref = g_malloc (4 * MAX_WIDTH);
+
+  g_random_set_seed (23);
+  for (run = 0; run < 3; run++) {
+    /* noise, then full scale edges, then a gradient */
+    for (x = 0; x < MAX_TAPS * 4 * MAX_WIDTH; x++) {
+      if (run == 0)
+        data[x] = g_random_int_range (0, 256);
+      else if (run == 1)
+        data[x] = ((x / 4 + x / (4 * MAX_WIDTH)) / 5) % 2 ? 255 : 0;
+      else
+        data[x] = (x / 4) % MAX_WIDTH + g_random_int_range (0, 40);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (sigmas); i++) {
+      gint windowsize = make_coeffs (coeffs, sigmas[i]);
+      gint n_taps = (windowsize + 1) & ~1;
+      gint center = windowsize / 2;
+      gint16 *row = tmp + 4 * center, *row_ref = tmp_ref + 4 * center;
+
+      for (k = 0; k < n_taps; k++)
+        rows[k] = data + k * 4 * MAX_WIDTH;
+
+      for (n = 4; n <= 4 * MAX_WIDTH; n += n < 128 ? 4 : 36) {
+        gst_gaussianblur_column_pass (coeffs, n_taps, rows, row, n);
+        for (x = 0; x < n; x++) {
+          gint acc = 0;
+
+          for (k = 0; k < n_taps; k++)
+            acc += coeffs[k] * rows[k][x];
+          row_ref[x] = (acc + 128) >> 8;
+        }
+        fail_unless (memcmp (row, row_ref, n * sizeof (gint16)) == 0,
+            "column pass, sigma %f, n %d differ", sigmas[i], n);
+
+        /* the edge pixels repeated, as the element does */
+        for (x = 0; x < center; x++) {
+          memcpy (tmp + 4 * x, row, 4 * sizeof (gint16));
+          memcpy (row + n + 4 * x, row + n - 4, 4 * sizeof (gint16));
+        }
+
+        memset (out, 0x55, 4 * MAX_WIDTH);
+        memset (ref, 0x55, 4 * MAX_WIDTH);
+        gst_gaussianblur_row_pass (coeffs, n_taps, tmp, out, n);
+        for (x = 0; x < n; x++) {
+          gint acc = 0;
+
+          for (k = 0; k < n_taps; k++)
+            acc += coeffs[k] * tmp[x + 4 * k];
+          ref[x] = CLAMP ((acc + (1 << 15)) >> 16, 0, 255);
+        }
+        fail_unless (memcmp (out, ref, 4 * MAX_WIDTH) == 0,
+            "row pass, sigma %f, n %d differ", sigmas[i], n);
+      }
+    }
+  }
+
+  g_free (data);
+  g_free (tmp);
+  g_free (tmp_ref);
+  g_free (out);
+  g_free (ref);
+}
+
+GST_END_TEST;
+
+static Suite *
+gaussianblur_suite (void)
+{
+  Suite *s = suite_create ("gaussianblur");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_passes_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gaussianblur);
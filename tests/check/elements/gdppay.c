@@ -556,6 +556,64 @@ GST_START_TEST (test_crc)
 
 GST_END_TEST;
 
+GST_START_TEST (test_crc_slicing)
+{
+  guint8 data[1024];
+  GstMapInfo maps[3];
+  guint i, length;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = g_random_int () & 0xff;
+
+  /* compare with the plain bytewise CRC for lengths around the step size */
+  for (length = 1; length < 70; length++) {
+    guint16 crc_register = CRC_INIT;
+
+    for (i = 0; i < length; i++)
+      crc_register = (guint16) ((crc_register << 8) ^
+          gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ data[i]]);
+
+    fail_unless_equals_int (gst_dp_crc (data, length), 0xffff ^ crc_register);
+  }
+
+  /* and the same CRC when the data is spread over several memories */
+  maps[0].data = data;
+  maps[0].size = 5;
+  maps[1].data = data + 5;
+  maps[1].size = 500;
+  maps[2].data = data + 505;
+  maps[2].size = sizeof (data) - 505;
+  fail_unless_equals_int (gst_dp_crc_from_memory_maps (maps, 3),
+      gst_dp_crc (data, sizeof (data)));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_payload_memories)
+{
+  GstBuffer *buffer, *packet;
+  guint i, max_mem = gst_buffer_get_max_memory ();
+
+  /* a payload that doesn't fit next to the header; only the memories that
+   * don't fit may be merged */
+  buffer = gst_buffer_new ();
+  for (i = 0; i < max_mem; i++)
+    gst_buffer_append_memory (buffer, gst_allocator_alloc (NULL, 16, NULL));
+
+  packet = gst_dp_payload_buffer (buffer, GST_DP_HEADER_FLAG_CRC);
+  fail_unless_equals_int (gst_buffer_n_memory (packet), max_mem);
+  fail_unless_equals_int (gst_buffer_get_size (packet),
+      GST_DP_HEADER_LENGTH + max_mem * 16);
+  for (i = 0; i < max_mem - 2; i++)
+    fail_unless (gst_buffer_peek_memory (packet, i + 1) ==
+        gst_buffer_peek_memory (buffer, i));
+
+  gst_buffer_unref (packet);
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 gdppay_suite (void)
@@ -569,6 +627,8 @@ gdppay_suite (void)
   tcase_add_test (tc_chain, test_first_no_new_segment);
   tcase_add_test (tc_chain, test_streamheader);
   tcase_add_test (tc_chain, test_crc);
+  tcase_add_test (tc_chain, test_crc_slicing);
+  tcase_add_test (tc_chain, test_payload_memories);
 
   return s;
 }
@@ -0,0 +1,130 @@
+/* GStreamer unit test for the geometrictransform elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define N_FRAMES 3
+
+static GList *
+run_filter (const gchar * filter, const gchar * format, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *buffers = NULL;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("%s n-threads=%u", filter, n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  /* odd height, so the stripes don't split the frame evenly */
+  desc = g_strdup_printf ("videotestsrc pattern=smpte ! "
+      "video/x-raw,format=%s,width=320,height=243,framerate=25/1", format);
+  gst_harness_add_src_parse (h, desc, FALSE);
+  g_free (desc);
+
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int (gst_harness_push_from_src (h), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h)))
+    buffers = g_list_append (buffers, buf);
+  fail_unless_equals_int (g_list_length (buffers), N_FRAMES);
+
+  gst_harness_teardown (h);
+
+  return buffers;
+}
+
+static void
+check_n_threads (const gchar * filter, const gchar * format)
+{
+  GList *ref, *buffers, *l, *m;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = run_filter (filter, format, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s on %s, n-threads=%u", filter, format, n_threads[i]);
+    buffers = run_filter (filter, format, n_threads[i]);
+
+    for (l = ref, m = buffers; l && m; l = l->next, m = m->next) {
+      GstMapInfo ref_map, map;
+
+      fail_unless (gst_buffer_map (l->data, &ref_map, GST_MAP_READ));
+      fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+      fail_unless_equals_int (map.size, ref_map.size);
+      fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+      gst_buffer_unmap (m->data, &map);
+      gst_buffer_unmap (l->data, &ref_map);
+    }
+
+    g_list_free_full (buffers, (GDestroyNotify) gst_buffer_unref);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Generating the map and remapping in stripes must give exactly the same
+ * output as doing the whole frame in one go, for every pixel stride */
+GST_START_TEST (test_n_threads)
+{
+  check_n_threads ("kaleidoscope", "ARGB");
+  check_n_threads ("pinch", "RGB");
+  check_n_threads ("twirl", "GRAY16_LE");
+  check_n_threads ("sphere", "GRAY8");
+  check_n_threads ("fisheye", "AYUV");
+  check_n_threads ("mirror", "BGRx");
+  check_n_threads ("rotate angle=0.5", "RGB");
+}
+
+GST_END_TEST;
+
+/* the off edge pixels and the per frame map of waterripple */
+GST_START_TEST (test_n_threads_off_edge_pixels)
+{
+  check_n_threads ("twirl off-edge-pixels=clamp", "ARGB");
+  check_n_threads ("rotate angle=1.0 off-edge-pixels=wrap", "RGB");
+  check_n_threads ("waterripple amplitude=20.0 off-edge-pixels=wrap",
+      "GRAY8");
+}
+
+GST_END_TEST;
+
+static Suite *
+geometrictransform_suite (void)
+{
+  Suite *s = suite_create ("geometrictransform");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_n_threads_off_edge_pixels);
+
+  return s;
+}
+
+GST_CHECK_MAIN (geometrictransform);
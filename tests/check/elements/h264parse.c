@@ -24,6 +24,8 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <string.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h264, parsed=(boolean)false"
@@ -397,6 +399,75 @@ GST_START_TEST (test_sink_caps_reordering)
 
 GST_END_TEST;
 
+#ifndef GST_DISABLE_GST_DEBUG
+static void
+count_caps_checks (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  guint *nb_caps_checks = user_data;
+
+  if (g_str_equal (gst_debug_category_get_name (category), "h264parse") &&
+      strstr (gst_debug_message_get (message), "triggering src caps check"))
+    (*nb_caps_checks)++;
+}
+#endif
+
+GST_START_TEST (test_parse_repeated_headers)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GstEvent *event;
+  guint i, nb_caps = 0;
+#ifndef GST_DISABLE_GST_DEBUG
+  guint nb_caps_checks = 0;
+
+  gst_debug_set_threshold_for_name ("h264parse", GST_LEVEL_DEBUG);
+  gst_debug_add_log_function (count_caps_checks, &nb_caps_checks, NULL);
+#endif
+
+  h = gst_harness_new ("h264parse");
+  gst_harness_set_src_caps_str (h, "video/x-h264, "
+      "stream-format = (string) byte-stream, alignment = (string) au");
+  gst_harness_set_sink_caps_str (h, "video/x-h264, "
+      "stream-format = (string) avc, alignment = (string) au");
+
+  /* encoders commonly repeat the SPS and PPS with every IDR */
+  for (i = 0; i < 4; i++) {
+    buf = gst_buffer_new_allocate (NULL, sizeof (h264_sps) +
+        sizeof (h264_pps) + sizeof (h264_idrframe), NULL);
+    gst_buffer_fill (buf, 0, h264_sps, sizeof (h264_sps));
+    gst_buffer_fill (buf, sizeof (h264_sps), h264_pps, sizeof (h264_pps));
+    gst_buffer_fill (buf, sizeof (h264_sps) + sizeof (h264_pps),
+        h264_idrframe, sizeof (h264_idrframe));
+    GST_BUFFER_PTS (buf) = i * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  gst_harness_push_event (h, gst_event_new_eos ());
+
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 4);
+
+  /* the repeats must not cause any caps update */
+  while ((event = gst_harness_try_pull_event (h))) {
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+      nb_caps++;
+    gst_event_unref (event);
+  }
+  fail_unless_equals_int (nb_caps, 1);
+
+#ifndef GST_DISABLE_GST_DEBUG
+  /* only the first SPS and PPS get as far as the caps check, the repeats
+   * are recognised when they are stored */
+  gst_debug_remove_log_function (count_caps_checks);
+  gst_debug_unset_threshold_for_name ("h264parse");
+  fail_unless_equals_int (nb_caps_checks, 2);
+#endif
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 h264parse_suite (void)
@@ -412,6 +483,7 @@ h264parse_suite (void)
   tcase_add_test (tc_chain, test_parse_skip_garbage);
   tcase_add_test (tc_chain, test_parse_detect_stream);
   tcase_add_test (tc_chain, test_sink_caps_reordering);
+  tcase_add_test (tc_chain, test_parse_repeated_headers);
 
   return s;
 }
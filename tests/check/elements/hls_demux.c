@@ -348,6 +348,170 @@ GST_START_TEST (testMasterPlaylist)
 
 GST_END_TEST;
 
+/* the prefetched fragments are requested from other threads */
+static GMutex prefetch_test_lock;
+
+static gboolean
+gst_hlsdemux_test_locked_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  gboolean ret;
+
+  g_mutex_lock (&prefetch_test_lock);
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, user_data);
+  g_mutex_unlock (&prefetch_test_lock);
+
+  return ret;
+}
+
+static void
+testPrefetchPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  g_object_set (engine->demux, "prefetch-depth", 2, NULL);
+}
+
+/*
+ * Test downloading the fragments ahead of time, each of them has to be
+ * requested once and pushed in order
+ *
+ */
+GST_START_TEST (testPrefetch)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {"http://unit.test/004.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 4 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  const GValue *requests;
+  guint i, j;
+  TESTCASE_INIT_BOILERPLATE (segment_size);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_locked_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_src_create;
+  engine_callbacks.pre_test = testPrefetchPreTestCallback;
+  engine_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  requests = gst_structure_get_value (hlsTestCase.state, "requests");
+  fail_unless (requests != NULL);
+  assert_equals_uint64 (gst_value_array_get_size (requests),
+      G_N_ELEMENTS (inputTestData) - 1);
+  for (i = 0; inputTestData[i].uri; ++i) {
+    guint count = 0;
+
+    for (j = 0; j < gst_value_array_get_size (requests); j++) {
+      const GValue *uri = gst_value_array_get_value (requests, j);
+
+      if (g_strcmp0 (inputTestData[i].uri, g_value_get_string (uri)) == 0)
+        count++;
+    }
+    fail_unless_equals_int (count, 1);
+  }
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
+static guint64
+testSelectBitrateCallback (GstElement * demux, GstPad * pad, guint64 bitrate,
+    guint64 last_bitrate, guint64 buffer_level, gpointer user_data)
+{
+  GstHlsDemuxTestSelectBitrateContext *context = user_data;
+
+  fail_unless_equals_string (GST_PAD_NAME (pad), "src_0");
+  fail_unless (last_bitrate > 0);
+  context->select_count++;
+
+  return 0;
+}
+
+static void
+testSelectBitratePreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxTestCase *testData = user_data;
+  GstHlsDemuxTestSelectBitrateContext *context;
+
+  context = g_slice_new0 (GstHlsDemuxTestSelectBitrateContext);
+  context->engine = engine;
+  context->testData = testData;
+  testData->signal_context = context;
+
+  g_object_set (engine->demux, "abr-algorithm", 2, NULL);
+  context->signal_handle = g_signal_connect (engine->demux, "select-bitrate",
+      G_CALLBACK (testSelectBitrateCallback), context);
+}
+
+/*
+ * Test the select-bitrate signal, it has to be emitted before each fragment
+ * but the first one
+ *
+ */
+GST_START_TEST (testSelectBitrateSignal)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 3 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  GstHlsDemuxTestSelectBitrateContext *context;
+  TESTCASE_INIT_BOILERPLATE (segment_size);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_src_create;
+  engine_callbacks.pre_test = testSelectBitratePreTestCallback;
+  engine_callbacks.appsink_received_data =
+      gst_adaptive_demux_test_check_received_data;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &hlsTestCase);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  context = engineTestData->signal_context;
+  fail_unless (context != NULL);
+  fail_unless_equals_int (context->select_count, 2);
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
 /*
  * Test seeking
  *
@@ -732,6 +896,8 @@ hls_demux_suite (void)
 
   tcase_add_test (tc_basicTest, simpleTest);
   tcase_add_test (tc_basicTest, testMasterPlaylist);
+  tcase_add_test (tc_basicTest, testPrefetch);
+  tcase_add_test (tc_basicTest, testSelectBitrateSignal);
   tcase_add_test (tc_basicTest, testMediaPlaylistNotFound);
   tcase_add_test (tc_basicTest, testFragmentNotFound);
   tcase_add_test (tc_basicTest, testFragmentDownloadError);
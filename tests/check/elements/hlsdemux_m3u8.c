@@ -701,6 +701,212 @@ GST_START_TEST (test_update_playlist)
 
 GST_END_TEST;
 
+/* Reloading a sliding window playlist keeps the files that were already
+ * in the previous version */
+GST_START_TEST (test_update_playlist_sliding_window)
+{
+  const gchar *playlist1 = "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-MEDIA-SEQUENCE:10\n"
+      "#EXTINF:2,\nsegment10.ts\n"
+      "#EXTINF:2,\nsegment11.ts\n" "#EXTINF:2,\nsegment12.ts\n";
+  const gchar *playlist2 = "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-MEDIA-SEQUENCE:11\n"
+      "#EXTINF:2,\nsegment11.ts\n"
+      "#EXTINF:2,\nsegment12.ts\n" "#EXTINF:2,\nsegment13.ts\n";
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file11, *file12, *file;
+  gboolean ret;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live/media.m3u8", NULL, "media");
+  ret = gst_m3u8_update (pl, g_strdup (playlist1));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 3);
+  file11 = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  file12 = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+
+  ret = gst_m3u8_update (pl, g_strdup (playlist2));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 3);
+  fail_unless (g_list_nth_data (pl->files, 0) == file11);
+  fail_unless (g_list_nth_data (pl->files, 1) == file12);
+  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  assert_equals_string (file->uri, "http://localhost/live/segment13.ts");
+  assert_equals_int (file->sequence, 13);
+  assert_equals_uint64 (file->duration, 2 * GST_SECOND);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_low_latency_playlist)
+{
+  const gchar *playlist1 = "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-PART-INF:PART-TARGET=0.5\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.5\n"
+      "#EXT-X-MEDIA-SEQUENCE:10\n"
+      "#EXTINF:2,\nsegment10.ts\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part11.0.ts\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part11.1.ts\"\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part11.2.ts\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part11.3.ts\"\n"
+      "#EXTINF:2,\nsegment11.ts\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part12.0.ts\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part12.1.ts\"\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part12.2.ts\"\n";
+  const gchar *playlist2 = "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-PART-INF:PART-TARGET=0.5\n"
+      "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=1.5\n"
+      "#EXT-X-MEDIA-SEQUENCE:11\n"
+      "#EXTINF:2,\nsegment11.ts\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part12.0.ts\",INDEPENDENT=YES\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part12.1.ts\"\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part12.2.ts\"\n"
+      "#EXT-X-PART:DURATION=0.5,URI=\"part12.3.ts\"\n"
+      "#EXTINF:2,\nsegment12.ts\n"
+      "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part13.0.ts\"\n";
+  const gchar *parts[] = { "part11.2.ts", "part11.3.ts", "part12.0.ts",
+    "part12.1.ts", "part12.2.ts"
+  };
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file;
+  GstClockTime position;
+  gchar *uri, *expected;
+  gboolean ret, discont;
+  guint i;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live/media.m3u8", NULL, "media");
+  ret = gst_m3u8_update (pl, g_strdup (playlist1));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 2);
+  assert_equals_uint64 (pl->part_target, GST_SECOND / 2);
+  assert_equals_uint64 (pl->part_hold_back, 3 * GST_SECOND / 2);
+  fail_unless (pl->can_block_reload);
+  file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 1));
+  assert_equals_int (file->partial_segments->len, 4);
+  fail_unless (pl->partial_file != NULL);
+  assert_equals_int (pl->partial_file->sequence, 12);
+  assert_equals_int (pl->partial_file->partial_segments->len, 2);
+  assert_equals_string (pl->preload_hint->uri,
+      "http://localhost/live/part12.2.ts");
+
+  /* Starts on the first independent part PART-HOLD-BACK from the end, then
+   * plays the parts up to the hinted one */
+  for (i = 0; i < G_N_ELEMENTS (parts); i++) {
+    file = gst_m3u8_get_next_fragment (pl, TRUE, &position, &discont);
+    fail_unless (file != NULL);
+    expected = g_strdup_printf ("http://localhost/live/%s", parts[i]);
+    assert_equals_string (file->uri, expected);
+    g_free (expected);
+    assert_equals_uint64 (file->duration, GST_SECOND / 2);
+    assert_equals_uint64 (position, 3 * GST_SECOND + i * GST_SECOND / 2);
+    gst_m3u8_media_file_unref (file);
+    fail_unless (gst_m3u8_has_next_fragment (pl, TRUE));
+    gst_m3u8_advance_fragment (pl, TRUE);
+  }
+  fail_unless (gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL) == NULL);
+
+  uri = gst_m3u8_get_reload_uri (pl);
+  assert_equals_string (uri,
+      "http://localhost/live/media.m3u8?_HLS_msn=12&_HLS_part=2");
+  g_free (uri);
+
+  /* The hinted part was listed, carry on with the next one */
+  ret = gst_m3u8_update (pl, g_strdup (playlist2));
+  assert_equals_int (ret, TRUE);
+  fail_unless (pl->partial_file == NULL);
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (file != NULL);
+  assert_equals_string (file->uri, "http://localhost/live/part12.3.ts");
+  assert_equals_int (file->sequence, 12);
+  gst_m3u8_media_file_unref (file);
+  gst_m3u8_advance_fragment (pl, TRUE);
+
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (file != NULL);
+  assert_equals_string (file->uri, "http://localhost/live/part13.0.ts");
+  assert_equals_int (file->sequence, 13);
+  gst_m3u8_media_file_unref (file);
+
+  uri = gst_m3u8_get_reload_uri (pl);
+  assert_equals_string (uri,
+      "http://localhost/live/media.m3u8?_HLS_msn=13&_HLS_part=0");
+  g_free (uri);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_delta_update_playlist)
+{
+  const gchar *playlist = "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12\n"
+      "#EXT-X-MEDIA-SEQUENCE:10\n"
+      "#EXTINF:2,\nsegment10.ts\n"
+      "#EXTINF:2,\nsegment11.ts\n"
+      "#EXTINF:2,\nsegment12.ts\n" "#EXTINF:2,\nsegment13.ts\n";
+  const gchar *delta = "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12\n"
+      "#EXT-X-MEDIA-SEQUENCE:11\n"
+      "#EXT-X-SKIP:SKIPPED-SEGMENTS=2\n"
+      "#EXTINF:2,\nsegment13.ts\n" "#EXTINF:2,\nsegment14.ts\n";
+  const gchar *bad_delta = "#EXTM3U\n"
+      "#EXT-X-TARGETDURATION:2\n"
+      "#EXT-X-SERVER-CONTROL:CAN-SKIP-UNTIL=12\n"
+      "#EXT-X-MEDIA-SEQUENCE:20\n"
+      "#EXT-X-SKIP:SKIPPED-SEGMENTS=2\n" "#EXTINF:2,\nsegment22.ts\n";
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file;
+  gchar *uri;
+  gboolean ret;
+  gint i;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live/media.m3u8", NULL, "media");
+  ret = gst_m3u8_update (pl, g_strdup (playlist));
+  assert_equals_int (ret, TRUE);
+  assert_equals_uint64 (pl->skip_boundary, 12 * GST_SECOND);
+
+  uri = gst_m3u8_get_reload_uri (pl);
+  assert_equals_string (uri, "http://localhost/live/media.m3u8?_HLS_skip=YES");
+  g_free (uri);
+
+  /* The skipped files are the ones of the previous version */
+  ret = gst_m3u8_update (pl, g_strdup (delta));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 4);
+  for (i = 0; i < 4; i++) {
+    gchar *expected;
+
+    file = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, i));
+    expected = g_strdup_printf ("http://localhost/live/segment%d.ts", 11 + i);
+    assert_equals_string (file->uri, expected);
+    assert_equals_int (file->sequence, 11 + i);
+    g_free (expected);
+  }
+  assert_equals_uint64 (pl->duration, 8 * GST_SECOND);
+
+  /* The previous version doesn't have the skipped files, keep it */
+  ret = gst_m3u8_update (pl, g_strdup (bad_delta));
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (g_list_length (pl->files), 4);
+  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  assert_equals_int (file->sequence, 14);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_playlist_media_files)
 {
   GstHLSMasterPlaylist *master;
@@ -1421,6 +1627,9 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_playlist_with_encryption);
   tcase_add_test (tc_m3u8, test_update_invalid_playlist);
   tcase_add_test (tc_m3u8, test_update_playlist);
+  tcase_add_test (tc_m3u8, test_update_playlist_sliding_window);
+  tcase_add_test (tc_m3u8, test_low_latency_playlist);
+  tcase_add_test (tc_m3u8, test_delta_update_playlist);
   tcase_add_test (tc_m3u8, test_playlist_media_files);
   tcase_add_test (tc_m3u8, test_playlist_byte_range_media_files);
   tcase_add_test (tc_m3u8, test_get_next_fragment);
@@ -0,0 +1,227 @@
+/* GStreamer unit test for hlssink2
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/isoff/gstisoff.h>
+#include <gio/gio.h>
+
+#define RATE 44100
+#define FRAME_SAMPLES 1024
+/* a bit less than 4 seconds, split in 1 second segments */
+#define N_FRAMES 160
+
+static GPtrArray *fragments;
+
+static GOutputStream *
+get_fragment_stream (GstElement * sink, const gchar * location,
+    gpointer user_data)
+{
+  GOutputStream *stream = g_memory_output_stream_new_resizable ();
+
+  if (!g_str_has_suffix (location, "init.mp4"))
+    g_ptr_array_add (fragments, g_object_ref (stream));
+
+  return stream;
+}
+
+static GOutputStream *
+get_playlist_stream (GstElement * sink, const gchar * location,
+    gpointer user_data)
+{
+  return g_memory_output_stream_new_resizable ();
+}
+
+static void
+delete_fragment (GstElement * sink, const gchar * location,
+    gpointer user_data)
+{
+  /* nothing was written to disk */
+  g_signal_stop_emission_by_name (sink, "delete-fragment");
+}
+
+static GstBuffer *
+create_aac_frame (guint i)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, 64, NULL);
+
+  gst_buffer_memset (buffer, 0, i & 0xff, 64);
+  GST_BUFFER_PTS (buffer) =
+      gst_util_uint64_scale (i * FRAME_SAMPLES, GST_SECOND, RATE);
+  GST_BUFFER_DURATION (buffer) =
+      gst_util_uint64_scale ((i + 1) * FRAME_SAMPLES, GST_SECOND, RATE) -
+      GST_BUFFER_PTS (buffer);
+
+  return buffer;
+}
+
+static void
+run_cmaf_pipeline (void)
+{
+  GstElement *pipeline, *src, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+  GstFlowReturn ret;
+  guint i;
+
+  pipeline = gst_parse_launch ("appsrc name=src format=time "
+      "caps=\"audio/mpeg,mpegversion=4,stream-format=raw,rate=44100,"
+      "channels=2,codec_data=(buffer)1210\" ! hlssink2 name=sink "
+      "muxer-type=cmaf target-duration=1 location=segment%05d.m4s "
+      "init-location=init.mp4 playlist-location=playlist.m3u8", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "get-fragment-stream",
+      G_CALLBACK (get_fragment_stream), NULL);
+  g_signal_connect (sink, "get-playlist-stream",
+      G_CALLBACK (get_playlist_stream), NULL);
+  g_signal_connect (sink, "delete-fragment", G_CALLBACK (delete_fragment),
+      NULL);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  for (i = 0; i < N_FRAMES; i++) {
+    GstBuffer *buffer = create_aac_frame (i);
+
+    g_signal_emit_by_name (src, "push-buffer", buffer, &ret);
+    gst_buffer_unref (buffer);
+    fail_unless_equals_int (ret, GST_FLOW_OK);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &ret);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+/* The muxer restarts with every segment, the fragment sequence numbers and
+ * the decode times still have to continue the ones of the previous
+ * segment */
+GST_START_TEST (test_cmaf_continuous_timing)
+{
+  guint32 next_sequence_number = 0;
+  guint64 next_decode_time = GST_CLOCK_TIME_NONE;
+  guint64 total_duration = 0;
+  guint n_moofs = 0;
+  guint i;
+
+  fragments = g_ptr_array_new_with_free_func (g_object_unref);
+  run_cmaf_pipeline ();
+  fail_unless (fragments->len >= 3);
+
+  for (i = 0; i < fragments->len; i++) {
+    GMemoryOutputStream *stream = g_ptr_array_index (fragments, i);
+    GstByteReader reader;
+
+    gst_byte_reader_init (&reader,
+        g_memory_output_stream_get_data (stream),
+        g_memory_output_stream_get_data_size (stream));
+
+    while (gst_byte_reader_get_remaining (&reader) > 0) {
+      guint pos = gst_byte_reader_get_pos (&reader);
+      GstByteReader sub_reader;
+      GstMoofBox *moof;
+      GstTrafBox *traf;
+      guint32 type;
+      guint header_size;
+      guint64 size;
+      guint j, k;
+
+      fail_unless (gst_isoff_parse_box_header (&reader, &type, NULL,
+              &header_size, &size));
+      fail_unless (gst_byte_reader_set_pos (&reader, pos + size));
+      if (type != GST_ISOFF_FOURCC_MOOF)
+        continue;
+
+      gst_byte_reader_init (&sub_reader,
+          (const guint8 *) g_memory_output_stream_get_data (stream) + pos +
+          header_size, size - header_size);
+      moof = gst_isoff_moof_box_parse (&sub_reader);
+      fail_unless (moof != NULL);
+      fail_unless_equals_int (moof->traf->len, 1);
+
+      if (n_moofs++ > 0)
+        fail_unless_equals_int (moof->mfhd.sequence_number,
+            next_sequence_number);
+      next_sequence_number = moof->mfhd.sequence_number + 1;
+
+      traf = &g_array_index (moof->traf, GstTrafBox, 0);
+      fail_unless (traf->tfdt.decode_time != GST_CLOCK_TIME_NONE);
+      if (next_decode_time != GST_CLOCK_TIME_NONE)
+        fail_unless_equals_uint64 (traf->tfdt.decode_time, next_decode_time);
+      next_decode_time = traf->tfdt.decode_time;
+
+      for (j = 0; j < traf->trun->len; j++) {
+        GstTrunBox *trun = &g_array_index (traf->trun, GstTrunBox, j);
+
+        for (k = 0; k < trun->samples->len; k++) {
+          GstTrunSample *sample =
+              &g_array_index (trun->samples, GstTrunSample, k);
+
+          if (trun->flags & GST_TRUN_FLAGS_SAMPLE_DURATION_PRESENT)
+            next_decode_time += sample->sample_duration;
+          else
+            next_decode_time += traf->tfhd.default_sample_duration;
+          total_duration += FRAME_SAMPLES;
+        }
+      }
+
+      gst_isoff_moof_box_free (moof);
+    }
+  }
+
+  /* all frames were written, in order */
+  fail_unless (n_moofs >= fragments->len);
+  fail_unless_equals_uint64 (total_duration, N_FRAMES * FRAME_SAMPLES);
+
+  g_ptr_array_unref (fragments);
+  fragments = NULL;
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink2_suite (void)
+{
+  Suite *s = suite_create ("hlssink2");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+
+  if (gst_registry_check_feature_version (gst_registry_get (), "mp4mux", 1,
+          0, 0))
+    tcase_add_test (tc_chain, test_cmaf_continuous_timing);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink2);
@@ -0,0 +1,128 @@
+/* GStreamer unit test for interlace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define N_FRAMES 8
+
+static GList *
+run_interlace (const gchar * pattern, const gchar * format,
+    const gchar * framerate, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *buffers = NULL;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("interlace field-pattern=%s n-threads=%u",
+      pattern, n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  /* odd height, so the stripes don't split the fields evenly, and a moving
+   * ball so that the fields of consecutive frames differ */
+  desc = g_strdup_printf ("videotestsrc pattern=ball ! "
+      "video/x-raw,format=%s,width=320,height=486,framerate=%s", format,
+      framerate);
+  gst_harness_add_src_parse (h, desc, FALSE);
+  g_free (desc);
+
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int (gst_harness_push_from_src (h), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h)))
+    buffers = g_list_append (buffers, buf);
+  fail_unless (buffers != NULL);
+
+  gst_harness_teardown (h);
+
+  return buffers;
+}
+
+static void
+check_n_threads (const gchar * pattern, const gchar * format,
+    const gchar * framerate)
+{
+  GList *ref, *buffers, *l, *m;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = run_interlace (pattern, format, framerate, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s on %s, n-threads=%u", pattern, format, n_threads[i]);
+    buffers = run_interlace (pattern, format, framerate, n_threads[i]);
+    fail_unless_equals_int (g_list_length (buffers), g_list_length (ref));
+
+    for (l = ref, m = buffers; l && m; l = l->next, m = m->next) {
+      GstMapInfo ref_map, map;
+
+      fail_unless_equals_uint64 (GST_BUFFER_PTS (m->data),
+          GST_BUFFER_PTS (l->data));
+      fail_unless_equals_int (GST_BUFFER_FLAGS (m->data),
+          GST_BUFFER_FLAGS (l->data));
+      fail_unless (gst_buffer_map (l->data, &ref_map, GST_MAP_READ));
+      fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+      fail_unless_equals_int (map.size, ref_map.size);
+      fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+      gst_buffer_unmap (m->data, &map);
+      gst_buffer_unmap (l->data, &ref_map);
+    }
+
+    g_list_free_full (buffers, (GDestroyNotify) gst_buffer_unref);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Copying the fields in stripes must give exactly the same frames as
+ * copying them in one go, for planar, semi-planar and packed formats */
+GST_START_TEST (test_n_threads)
+{
+  check_n_threads ("1:1", "I420", "60/1");
+  check_n_threads ("1:1", "YUY2", "60/1");
+  check_n_threads ("1:1", "NV12", "60/1");
+  check_n_threads ("2:3", "Y444", "24000/1001");
+  check_n_threads ("2:3", "AYUV", "24000/1001");
+  check_n_threads ("2:3:3:2", "YV12", "24000/1001");
+  check_n_threads ("3:3", "Y42B", "20/1");
+}
+
+GST_END_TEST;
+
+static Suite *
+interlace_suite (void)
+{
+  Suite *s = suite_create ("interlace");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+
+  return s;
+}
+
+GST_CHECK_MAIN (interlace);
@@ -0,0 +1,172 @@
+/* GStreamer
+ *
+ * unit tests for iqa
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <gst/check/gstcheck.h>
+
+#define SOURCE "videotestsrc num-buffers=3 pattern=%s ! " \
+    "video/x-raw, format=RGBA, width=160, height=120 ! iqa. "
+
+/* Runs the comparison of the two patterns and returns the psnr and
+ * fast-ssim of the compared pad for the last frame */
+static void
+run_iqa (const gchar * ref_pattern, const gchar * cmp_pattern,
+    const gchar * properties, gdouble * psnr, gdouble * ssim)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  gchar *desc;
+  guint n_messages = 0;
+
+  desc = g_strdup_printf ("iqa name=iqa do-psnr=true do-fast-ssim=true %s "
+      "! fakesink " SOURCE SOURCE, properties, ref_pattern, cmp_pattern);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  while ((msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+              GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS | GST_MESSAGE_ERROR))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    fail_if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR);
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+      gst_message_unref (msg);
+      break;
+    }
+
+    if (gst_structure_has_name (s, "IQA")) {
+      GstStructure *psnr_s, *ssim_s;
+
+      fail_unless (gst_structure_get (s, "psnr", GST_TYPE_STRUCTURE, &psnr_s,
+              "fast-ssim", GST_TYPE_STRUCTURE, &ssim_s, NULL));
+      fail_unless (gst_structure_get_double (psnr_s, "sink_1", psnr));
+      fail_unless (gst_structure_get_double (ssim_s, "sink_1", ssim));
+      gst_structure_free (psnr_s);
+      gst_structure_free (ssim_s);
+      n_messages++;
+    }
+    gst_message_unref (msg);
+  }
+
+  fail_unless_equals_int (n_messages, 3);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_identical)
+{
+  gdouble psnr, ssim;
+
+  run_iqa ("smpte", "smpte", "", &psnr, &ssim);
+
+  fail_unless (isinf (psnr));
+  fail_unless_equals_float (ssim, 1.0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_different)
+{
+  gdouble psnr, ssim;
+
+  run_iqa ("smpte", "snow", "", &psnr, &ssim);
+
+  fail_unless (psnr > 0.0 && psnr < 20.0);
+  fail_unless (ssim < 0.5);
+}
+
+GST_END_TEST;
+
+/* The stripes measured by each thread add up to the whole frame */
+GST_START_TEST (test_threads)
+{
+  gdouble psnr, ssim, threaded_psnr, threaded_ssim;
+
+  run_iqa ("smpte", "ball", "n-threads=1", &psnr, &ssim);
+  run_iqa ("smpte", "ball", "n-threads=4", &threaded_psnr, &threaded_ssim);
+
+  fail_unless (fabs (psnr - threaded_psnr) < 1e-9);
+  fail_unless (fabs (ssim - threaded_ssim) < 1e-9);
+}
+
+GST_END_TEST;
+
+/* The top left quarter of the smpte pattern is made of vertical bars, a
+ * pattern shifted horizontally differs there but a region limited to a
+ * single bar doesn't see the difference */
+GST_START_TEST (test_region)
+{
+  gdouble psnr, ssim;
+
+  run_iqa ("smpte", "smpte horizontal-speed=1", "", &psnr, &ssim);
+  fail_if (isinf (psnr));
+
+  run_iqa ("smpte", "smpte horizontal-speed=1",
+      "region-x=4 region-y=0 region-width=8 region-height=64", &psnr, &ssim);
+  fail_unless (isinf (psnr));
+  fail_unless_equals_float (ssim, 1.0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_subsampling)
+{
+  gdouble psnr, ssim;
+
+  run_iqa ("smpte", "smpte", "subsampling=3 n-threads=2", &psnr, &ssim);
+  fail_unless (isinf (psnr));
+  fail_unless_equals_float (ssim, 1.0);
+
+  run_iqa ("smpte", "snow", "subsampling=3 n-threads=2", &psnr, &ssim);
+  fail_unless (psnr > 0.0 && psnr < 20.0);
+}
+
+GST_END_TEST;
+
+static Suite *
+iqa_suite (void)
+{
+  Suite *s = suite_create ("iqa");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_identical);
+  tcase_add_test (tc_chain, test_different);
+  tcase_add_test (tc_chain, test_threads);
+  tcase_add_test (tc_chain, test_region);
+  tcase_add_test (tc_chain, test_subsampling);
+
+  return s;
+}
+
+GST_CHECK_MAIN (iqa);
@@ -0,0 +1,306 @@
+/* GStreamer unit test for ivtc and combdetect
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+/* the line functions are internal to the plugin */
+#include "../../gst/ivtc/gstivtcutils.c"
+
+#define WIDTH 320
+#define HEIGHT 243
+#define N_FRAMES 10
+
+/* Vertical bars moving to the right, the bottom field of every other frame
+ * is from further on, so that it is combed along the edges of the bars */
+static GstBuffer *
+create_frame (GstVideoInfo * info, guint n)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, info->size, NULL);
+  GstVideoFrame frame;
+  gint i, x, y;
+
+  fail_unless (gst_video_frame_map (&frame, info, buf, GST_MAP_WRITE));
+  for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (&frame); i++) {
+    guint8 *data = GST_VIDEO_FRAME_COMP_DATA (&frame, i);
+    gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, i);
+
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, i); y++) {
+      gint pos = 5 * n + ((y & 1) && n % 2 ? 7 : 0);
+
+      for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&frame, i); x++) {
+        gint v = ((x + pos + (y >> 3)) / 11) % 2 ? 190 : 50;
+
+        data[y * stride + x] = v + ((x * 7 + y * 13 + n + i) % 9);
+      }
+    }
+  }
+  gst_video_frame_unmap (&frame);
+
+  GST_BUFFER_PTS (buf) = gst_util_uint64_scale (n, GST_SECOND, 30);
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (1, GST_SECOND, 30);
+  GST_BUFFER_FLAG_SET (buf, GST_VIDEO_BUFFER_FLAG_INTERLACED |
+      GST_VIDEO_BUFFER_FLAG_TFF);
+
+  return buf;
+}
+
+static GList *
+run_filter (const gchar * filter, const gchar * format, guint n_threads)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+  GstCaps *caps;
+  GstBuffer *buf;
+  GList *buffers = NULL;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("%s n-threads=%u", filter, n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  gst_video_info_set_format (&info, gst_video_format_from_string (format),
+      WIDTH, HEIGHT);
+  GST_VIDEO_INFO_INTERLACE_MODE (&info) = GST_VIDEO_INTERLACE_MODE_INTERLEAVED;
+  GST_VIDEO_INFO_FPS_N (&info) = 30;
+  GST_VIDEO_INFO_FPS_D (&info) = 1;
+  caps = gst_video_info_to_caps (&info);
+  gst_harness_set_src_caps (h, caps);
+
+  for (i = 0; i < N_FRAMES; i++)
+    gst_harness_push (h, create_frame (&info, i));
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h)))
+    buffers = g_list_append (buffers, buf);
+  fail_unless (buffers != NULL);
+
+  gst_harness_teardown (h);
+
+  return buffers;
+}
+
+static void
+check_n_threads (const gchar * filter, const gchar * format)
+{
+  GList *ref, *buffers, *l, *m;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = run_filter (filter, format, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s on %s, n-threads=%u", filter, format, n_threads[i]);
+    buffers = run_filter (filter, format, n_threads[i]);
+    fail_unless_equals_int (g_list_length (buffers), g_list_length (ref));
+
+    for (l = ref, m = buffers; l && m; l = l->next, m = m->next) {
+      GstMapInfo ref_map, map;
+
+      fail_unless_equals_uint64 (GST_BUFFER_PTS (m->data),
+          GST_BUFFER_PTS (l->data));
+      fail_unless (gst_buffer_map (l->data, &ref_map, GST_MAP_READ));
+      fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+      fail_unless_equals_int (map.size, ref_map.size);
+      fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+      gst_buffer_unmap (m->data, &map);
+      gst_buffer_unmap (l->data, &ref_map);
+    }
+
+    g_list_free_full (buffers, (GDestroyNotify) gst_buffer_unref);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Detecting the combing and interpolating the fields in stripes must give
+ * exactly the same output as doing the whole frame in one go */
+GST_START_TEST (test_n_threads)
+{
+  check_n_threads ("combdetect", "I420");
+  check_n_threads ("combdetect", "Y444");
+  check_n_threads ("ivtc", "I420");
+  check_n_threads ("ivtc", "Y42B");
+}
+
+GST_END_TEST;
+
+#define MAX_WIDTH 333
+
+static void
+fill_lines (guint8 lines[][MAX_WIDTH], guint n_lines, guint run)
+{
+  guint k, x;
+
+  /* noise, then smoother and smoother content with edges of all
+   * directions */
+  for (k = 0; k < n_lines; k++) {
+    for (x = 0; x < MAX_WIDTH; x++) {
+      if (run == 0)
+        lines[k][x] = g_random_int_range (0, 256);
+      else
+        lines[k][x] = ((x + k * (run - 4)) / 6) % 2 ? 200 : 40;
+      if (run > 1)
+        lines[k][x] += g_random_int_range (0, (32 >> (run / 2)) + 1);
+    }
+  }
+}
+
+/* The vector comb masks must match the per sample test of the scalar
+ * code */
+GST_START_TEST (test_comb_mask_line_simd)
+{
+  guint8 lines[3][MAX_WIDTH], mask[MAX_WIDTH];
+  guint run;
+  gint width, i;
+
+  g_random_set_seed (3);
+  for (run = 0; run < 9; run++) {
+    fill_lines (lines, 3, run);
+
+    for (width = 1; width <= MAX_WIDTH; width += width < 48 ? 1 : 19) {
+      gboolean combed = FALSE, ret;
+
+      memset (mask, 0x55, sizeof (mask));
+      ret = gst_ivtc_comb_mask_line (mask, lines[0], lines[1], lines[2],
+          width);
+
+      for (i = 0; i < width; i++) {
+        gint lo = MIN (lines[0][i], lines[2][i]) - 5;
+        gint hi = MAX (lines[0][i], lines[2][i]) + 5;
+        guint8 expected = lines[1][i] < lo || lines[1][i] > hi ?
+            GST_IVTC_COMB_COMBED : GST_IVTC_COMB_NONE;
+
+        fail_unless_equals_int (mask[i], expected);
+        combed |= expected != GST_IVTC_COMB_NONE;
+      }
+      fail_unless_equals_int (ret, combed);
+      /* nothing written past the width */
+      for (; i < MAX_WIDTH; i++)
+        fail_unless_equals_int (mask[i], 0x55);
+    }
+  }
+}
+
+GST_END_TEST;
+
+/* Skipping 16 uncombed samples at a time must not change the runs */
+GST_START_TEST (test_comb_score_line)
+{
+  guint8 mask[MAX_WIDTH], ref_mask[MAX_WIDTH];
+  int thisline[MAX_WIDTH], ref_thisline[MAX_WIDTH];
+  guint line;
+  gint width, i;
+
+  g_random_set_seed (5);
+  for (width = 1; width <= MAX_WIDTH; width += width < 48 ? 1 : 19) {
+    memset (thisline, 0, sizeof (thisline));
+    memset (ref_thisline, 0, sizeof (ref_thisline));
+
+    for (line = 0; line < 300; line++) {
+      gint score, ref_score = 0, prev = 0;
+
+      /* runs of combing in some columns, with clean blocks in between */
+      for (i = 0; i < width; i++) {
+        gboolean combed = ((i / 16) % 3 != 1) &&
+            g_random_int_range (0, 8) < (line % 50 < 40 ? 7 : 1);
+
+        mask[i] = ref_mask[i] = combed ? GST_IVTC_COMB_COMBED :
+            GST_IVTC_COMB_NONE;
+      }
+
+      score = gst_ivtc_comb_score_line (thisline, mask, width);
+
+      for (i = 0; i < width; i++) {
+        if (ref_mask[i]) {
+          gint v = MIN (ref_thisline[i] + prev + 1, 1000);
+
+          ref_thisline[i] = prev = v;
+          if (v > 100) {
+            ref_mask[i] = GST_IVTC_COMB_MARKED;
+            ref_score++;
+          }
+        } else {
+          ref_thisline[i] = prev = 0;
+        }
+      }
+
+      fail_unless_equals_int (score, ref_score);
+      fail_unless (memcmp (mask, ref_mask, width) == 0);
+      fail_unless (memcmp (thisline, ref_thisline, width * sizeof (int)) == 0);
+    }
+  }
+}
+
+GST_END_TEST;
+
+/* The vector edge directed interpolation must give the same pixels as
+ * reconstruct_pixel() */
+GST_START_TEST (test_reconstruct_interpolate_simd)
+{
+  guint8 lines[2][MAX_WIDTH], dest[MAX_WIDTH], ref[MAX_WIDTH];
+  guint run;
+  gint width, i;
+
+  g_random_set_seed (11);
+  for (run = 0; run < 9; run++) {
+    fill_lines (lines, 2, run);
+
+    for (width = 1; width <= MAX_WIDTH; width += width < 48 ? 1 : 19) {
+      memset (dest, 0x55, sizeof (dest));
+      memset (ref, 0x55, sizeof (ref));
+      gst_ivtc_reconstruct_interpolate (dest, lines[0], lines[1], width);
+
+      for (i = 0; i < width; i++) {
+        if (width <= 2 * MARGIN || i < MARGIN || i >= width - MARGIN)
+          ref[i] = (lines[0][i] + lines[1][i] + 1) >> 1;
+        else
+          ref[i] = reconstruct_pixel (lines[0], lines[1], i);
+      }
+
+      fail_unless (memcmp (dest, ref, sizeof (dest)) == 0,
+          "width %d, run %u differ", width, run);
+    }
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+ivtc_suite (void)
+{
+  Suite *s = suite_create ("ivtc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_comb_mask_line_simd);
+  tcase_add_test (tc_chain, test_comb_score_line);
+  tcase_add_test (tc_chain, test_reconstruct_interpolate_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ivtc);
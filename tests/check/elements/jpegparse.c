@@ -23,6 +23,8 @@
 #include <unistd.h>
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/codecparsers/gstjpegmeta.h>
 
 /* This test doesn't use actual JPEG data, but some fake data that we know
    will trigger certain paths in jpegparse. */
@@ -367,6 +369,117 @@ GST_START_TEST (test_parse_comment)
 
 GST_END_TEST;
 
+/* a scan of three restart intervals of 2 MCUs, the first one containing a
+ * stuffed 0xff byte */
+guint8 test_data_restart[] = {
+  0xff, 0xdd, 0x00, 0x04, 0x00, 0x02,   /* DRI */
+  0xff, 0xc0, 0x00, 0x11, 0x08, 0x00, 0x3c, 0x00, 0x50, 0x03,
+  0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11, 0x01,
+  0xff, 0xda, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3f, 0x00,   /* SOS */
+  0x12, 0x34, 0xff, 0x00, 0x56,
+  0xff, 0xd0,                   /* RST0 */
+  0x78, 0x9a,
+  0xff, 0xd1,                   /* RST1 */
+  0xbc,
+};
+
+GST_START_TEST (test_parse_restart_meta)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GstJpegRestartMeta *meta;
+
+  h = gst_harness_new ("jpegparse");
+  g_object_set (h->element, "restart-meta", TRUE, NULL);
+  gst_harness_set_src_caps_str (h, "image/jpeg");
+
+  buf = gst_buffer_new_and_alloc (sizeof (test_data_soi) +
+      sizeof (test_data_restart) + sizeof (test_data_eoi));
+  gst_buffer_fill (buf, 0, test_data_soi, sizeof (test_data_soi));
+  gst_buffer_fill (buf, sizeof (test_data_soi), test_data_restart,
+      sizeof (test_data_restart));
+  gst_buffer_fill (buf, sizeof (test_data_soi) + sizeof (test_data_restart),
+      test_data_eoi, sizeof (test_data_eoi));
+
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  gst_harness_push_event (h, gst_event_new_eos ());
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  meta = gst_buffer_get_jpeg_restart_meta (buf);
+  fail_unless (meta != NULL);
+
+  fail_unless_equals_int (meta->restart_interval, 2);
+  fail_unless_equals_int (meta->n_scans, 1);
+  fail_unless_equals_int (meta->n_intervals, 3);
+  fail_unless_equals_int (meta->intervals[0].offset, 37);
+  fail_unless_equals_int (meta->intervals[0].size, 5);
+  fail_unless_equals_int (meta->intervals[1].offset, 44);
+  fail_unless_equals_int (meta->intervals[1].size, 2);
+  fail_unless_equals_int (meta->intervals[2].offset, 48);
+  fail_unless_equals_int (meta->intervals[2].size, 1);
+
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Entropy-coded data long enough for the vectorised scan, with stuffed 0xff
+ * and restart markers on and across 16 byte boundaries */
+guint8 test_data_long_entropy[] = {
+  0xff, 0xd8,                   /* SOI */
+  0xff, 0xda, 0x00, 0x04, 0x22, 0x33,   /* SOS */
+  0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+  0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+  0x00, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+  0xff, 0xd0,                   /* RST0 */
+  0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0xff, 0x00,
+  0xff, 0x00, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23,
+  0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0xff,
+  0xd1,                         /* RST1 */
+  0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32,
+  0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a,
+  0xff, 0xd9,                   /* EOI */
+};
+
+GST_START_TEST (test_parse_long_entropy)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  gsize split;
+
+  /* All in one buffer, then split at every position to check that the scan
+   * resumes correctly */
+  for (split = 0; split < sizeof (test_data_long_entropy); split++) {
+    h = gst_harness_new ("jpegparse");
+    gst_harness_set_src_caps_str (h, "image/jpeg");
+
+    if (split > 0) {
+      buf = gst_buffer_new_and_alloc (split);
+      gst_buffer_fill (buf, 0, test_data_long_entropy, split);
+      fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+    }
+    buf = gst_buffer_new_and_alloc (sizeof (test_data_long_entropy) - split);
+    gst_buffer_fill (buf, 0, test_data_long_entropy + split,
+        sizeof (test_data_long_entropy) - split);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+    gst_harness_push_event (h, gst_event_new_eos ());
+
+    buf = gst_harness_pull (h);
+    fail_unless (buf != NULL);
+    fail_unless_equals_int (gst_buffer_get_size (buf),
+        sizeof (test_data_long_entropy));
+    fail_unless (gst_buffer_memcmp (buf, 0, test_data_long_entropy,
+            sizeof (test_data_long_entropy)) == 0);
+    gst_buffer_unref (buf);
+
+    gst_harness_teardown (h);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 jpegparse_suite (void)
 {
@@ -378,6 +491,8 @@ jpegparse_suite (void)
   tcase_add_test (tc_chain, test_parse_all_in_one_buf);
   tcase_add_test (tc_chain, test_parse_app1_exif);
   tcase_add_test (tc_chain, test_parse_comment);
+  tcase_add_test (tc_chain, test_parse_restart_meta);
+  tcase_add_test (tc_chain, test_parse_long_entropy);
 
   return s;
 }
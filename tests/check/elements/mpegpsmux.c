@@ -0,0 +1,130 @@
+/* GStreamer unit test for mpegpsmux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define N_FRAMES 50
+#define FRAME_SIZE 3000
+#define FRAME_DURATION (40 * GST_MSECOND)
+
+/* Muxes the same video frames every time, returns the output as one array
+ * and the size of each output buffer in @sizes */
+static GByteArray *
+mux_frames (guint write_size, GstClockTime write_latency, GArray * sizes)
+{
+  GstHarness *h;
+  GByteArray *output = g_byte_array_new ();
+  GstBuffer *buf;
+  guint i;
+
+  h = gst_harness_new_with_padnames ("mpegpsmux", "sink_%u", "src");
+  g_object_set (h->element, "write-size", write_size, "write-latency",
+      write_latency, NULL);
+  gst_harness_set_src_caps_str (h, "video/mpeg, mpegversion=(int)2, "
+      "systemstream=(boolean)false");
+
+  for (i = 0; i < N_FRAMES; i++) {
+    buf = gst_harness_create_buffer (h, FRAME_SIZE);
+    gst_buffer_memset (buf, 0, i, FRAME_SIZE);
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = i * FRAME_DURATION;
+    GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+    if (i % 10 != 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h))) {
+    GstMapInfo map;
+    guint size;
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    g_byte_array_append (output, map.data, map.size);
+    size = map.size;
+    g_array_append_val (sizes, size);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+
+  return output;
+}
+
+static void
+check_gathered_output (guint write_size, GstClockTime write_latency)
+{
+  GArray *ref_sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+  GArray *sizes = g_array_new (FALSE, FALSE, sizeof (guint));
+  GByteArray *ref, *output;
+  guint i;
+
+  ref = mux_frames (0, write_latency, ref_sizes);
+  output = mux_frames (write_size, write_latency, sizes);
+
+  /* the same stream, in fewer and larger writes */
+  fail_unless (ref->len > 0);
+  fail_unless_equals_int (output->len, ref->len);
+  fail_unless (memcmp (output->data, ref->data, ref->len) == 0);
+  fail_unless (sizes->len > 1);
+  fail_unless (sizes->len < ref_sizes->len);
+  for (i = 0; i < sizes->len; i++)
+    fail_unless (g_array_index (sizes, guint, i) <= write_size);
+
+  g_byte_array_unref (ref);
+  g_byte_array_unref (output);
+  g_array_unref (ref_sizes);
+  g_array_unref (sizes);
+}
+
+GST_START_TEST (test_write_size)
+{
+  /* longer than the whole stream */
+  check_gathered_output (16 * 1024, 10 * GST_SECOND);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_write_latency)
+{
+  /* the buffers are cut after 200ms worth of packets, long before they
+   * are full */
+  check_gathered_output (1024 * 1024, 200 * GST_MSECOND);
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegpsmux_suite (void)
+{
+  Suite *s = suite_create ("mpegpsmux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_write_size);
+  tcase_add_test (tc_chain, test_write_latency);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegpsmux);
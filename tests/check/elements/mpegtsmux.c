@@ -19,6 +19,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
 #include <string.h>
 #include <gst/video/video.h>
 
@@ -75,14 +76,14 @@ setup_src_pad (GstElement * element,
     sinkpad = gst_element_get_request_pad (element, sinkname);
   fail_if (sinkpad == NULL, "Could not get sink pad from %s",
       GST_ELEMENT_NAME (element));
-  /* references are owned by: 1) us, 2) tsmux, 3) collect pads */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 3);
+  /* references are owned by: 1) us, 2) tsmux */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
   fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK,
       "Could not link source and %s sink pads", GST_ELEMENT_NAME (element));
   gst_object_unref (sinkpad);   /* because we got it higher up */
 
-  /* references are owned by: 1) tsmux, 2) collect pads */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
+  /* references are owned by: 1) tsmux */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 1);
 
   if (padname)
     *padname = g_strdup (GST_PAD_NAME (sinkpad));
@@ -98,16 +99,16 @@ teardown_src_pad (GstElement * element, const gchar * sinkname)
   /* clean up floating src pad */
   if (!(sinkpad = gst_element_get_static_pad (element, sinkname)))
     sinkpad = gst_element_get_request_pad (element, sinkname);
-  /* pad refs held by 1) tsmux 2) collectpads and 3) us (through _get) */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 3);
+  /* pad refs held by 1) tsmux and 2) us (through _get) */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
   srcpad = gst_pad_get_peer (sinkpad);
 
   gst_pad_unlink (srcpad, sinkpad);
   GST_DEBUG ("src %p", srcpad);
 
   /* after unlinking, pad refs still held by
-   * 1) tsmux and 2) collectpads and 3) us (through _get) */
-  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 3);
+   * 1) tsmux and 2) us (through _get) */
+  ASSERT_OBJECT_REFCOUNT (sinkpad, "sinkpad", 2);
   gst_object_unref (sinkpad);
   /* one more ref is held by element itself */
 
@@ -546,7 +547,9 @@ GST_START_TEST (test_force_key_unit_event_downstream)
   thread_data_4 = pad_push (src1, gst_buffer_new (), 4 * GST_SECOND);
 
   g_thread_join (thread_data_2->thread);
-  fail_unless (test_data.sink_event != NULL);
+  /* the buffer is muxed from the aggregator thread */
+  while (g_atomic_pointer_get (&test_data.sink_event) == NULL)
+    g_usleep (1000);
 
   gst_element_set_state (mpegtsmux, GST_STATE_NULL);
 
@@ -620,7 +623,9 @@ GST_START_TEST (test_force_key_unit_event_upstream)
   thread_data_4 = pad_push (src1, gst_buffer_new (), 4 * GST_SECOND);
 
   g_thread_join (thread_data_2->thread);
-  fail_unless (test_data.sink_event != NULL);
+  /* the buffer is muxed from the aggregator thread */
+  while (g_atomic_pointer_get (&test_data.sink_event) == NULL)
+    g_usleep (1000);
 
   gst_element_set_state (mpegtsmux, GST_STATE_NULL);
 
@@ -665,36 +670,40 @@ GST_START_TEST (test_propagate_flow_status)
     GST_FLOW_NOT_NEGOTIATED, GST_FLOW_ERROR, GST_FLOW_NOT_SUPPORTED
   };
 
-  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
-  gst_pad_set_chain_function (mysinkpad, flow_test_stat_chain_func);
-
-  fail_unless (gst_element_set_state (mux,
-          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
-      "could not set to playing");
-
-  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
-  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
-  gst_caps_unref (caps);
-
   for (i = 0; i < G_N_ELEMENTS (expected); ++i) {
-    GstFlowReturn res;
+    GstFlowReturn res = GST_FLOW_OK;
+    guint n;
 
-    inbuffer = gst_buffer_new_and_alloc (1);
-    ASSERT_BUFFER_REFCOUNT (inbuffer, "inbuffer", 1);
+    mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+    gst_pad_set_chain_function (mysinkpad, flow_test_stat_chain_func);
 
     expected_flow = expected[i];
     GST_INFO ("expecting flow %s (%d)", gst_flow_get_name (expected_flow),
         expected_flow);
 
-    GST_BUFFER_TIMESTAMP (inbuffer) = i * GST_SECOND;
+    fail_unless (gst_element_set_state (mux,
+            GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+        "could not set to playing");
+
+    caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+    gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+    gst_caps_unref (caps);
+
+    /* buffers are muxed from the aggregator thread, the downstream flow is
+     * returned by the pushes that follow the failing one */
+    for (n = 0; n < 10 && res == GST_FLOW_OK; ++n) {
+      inbuffer = gst_buffer_new_and_alloc (1);
+      ASSERT_BUFFER_REFCOUNT (inbuffer, "inbuffer", 1);
+      GST_BUFFER_TIMESTAMP (inbuffer) = n * GST_SECOND;
 
-    res = gst_pad_push (mysrcpad, inbuffer);
+      res = gst_pad_push (mysrcpad, inbuffer);
+    }
 
     fail_unless_equals_int (res, expected[i]);
-  }
 
-  cleanup_tsmux (mux, padname);
-  g_free (padname);
+    cleanup_tsmux (mux, padname);
+    g_free (padname);
+  }
 }
 
 GST_END_TEST;
@@ -803,6 +812,454 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+static gboolean
+live_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) == GST_QUERY_LATENCY) {
+    gst_query_set_latency (query, TRUE, 0, GST_CLOCK_TIME_NONE);
+    return TRUE;
+  }
+
+  return gst_pad_query_default (pad, parent, query);
+}
+
+GST_START_TEST (test_live_sparse_pad_timeout)
+{
+  GstElement *mux;
+  GstPad *src1, *src2, *mux_sink1, *mux_sink2;
+  GstClock *clock;
+  GstSegment segment;
+  GstCaps *caps;
+  GstBuffer *buf;
+  GstQuery *query;
+
+  mux = gst_check_setup_element ("mpegtsmux");
+  g_object_set (mux, "latency", 100 * GST_MSECOND, NULL);
+  mysinkpad = gst_check_setup_sink_pad (mux, &sink_template);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  src1 = gst_pad_new_from_static_template (&video_src_template, "src1");
+  gst_pad_set_query_function (src1, live_src_query);
+  gst_pad_set_active (src1, TRUE);
+  mux_sink1 = gst_element_get_request_pad (mux, "sink_1");
+  fail_unless (gst_pad_link (src1, mux_sink1) == GST_PAD_LINK_OK);
+
+  /* never gets any data */
+  src2 = gst_pad_new_from_static_template (&audio_src_template, "src2");
+  gst_pad_set_query_function (src2, live_src_query);
+  gst_pad_set_active (src2, TRUE);
+  mux_sink2 = gst_element_get_request_pad (mux, "sink_2");
+  fail_unless (gst_pad_link (src2, mux_sink2) == GST_PAD_LINK_OK);
+
+  clock = gst_test_clock_new ();
+  gst_element_set_clock (mux, clock);
+  gst_element_set_base_time (mux, 0);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  query = gst_query_new_latency ();
+  fail_unless (gst_pad_peer_query (mysinkpad, query));
+  gst_query_unref (query);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_pad_push_event (src1, gst_event_new_stream_start ("1"));
+  gst_pad_push_event (src1, gst_event_new_caps (caps));
+  gst_pad_push_event (src1, gst_event_new_segment (&segment));
+  gst_caps_unref (caps);
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  gst_pad_push_event (src2, gst_event_new_stream_start ("2"));
+  gst_pad_push_event (src2, gst_event_new_caps (caps));
+  gst_pad_push_event (src2, gst_event_new_segment (&segment));
+  gst_caps_unref (caps);
+
+  buf = gst_buffer_new_and_alloc (100);
+  gst_buffer_memset (buf, 0, 0, 100);
+  GST_BUFFER_PTS (buf) = 0;
+  fail_unless_equals_int (gst_pad_push (src1, buf), GST_FLOW_OK);
+
+  /* the video buffer goes out once the latency has passed, without
+   * waiting for the second input */
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (clock), NULL);
+  gst_test_clock_set_time (GST_TEST_CLOCK (clock), 100 * GST_MSECOND);
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  gst_element_set_state (mux, GST_STATE_NULL);
+  gst_check_drop_buffers ();
+
+  gst_pad_unlink (src1, mux_sink1);
+  gst_pad_unlink (src2, mux_sink2);
+  gst_element_release_request_pad (mux, mux_sink1);
+  gst_element_release_request_pad (mux, mux_sink2);
+  gst_object_unref (mux_sink1);
+  gst_object_unref (mux_sink2);
+  gst_object_unref (src1);
+  gst_object_unref (src2);
+  gst_check_teardown_sink_pad (mux);
+  gst_check_teardown_element (mux);
+  gst_object_unref (clock);
+}
+
+GST_END_TEST;
+
+static gboolean got_eos;
+
+static GstPadProbeReturn
+eos_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_EOS) {
+    g_mutex_lock (&check_mutex);
+    got_eos = TRUE;
+    g_cond_signal (&check_cond);
+    g_mutex_unlock (&check_mutex);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+wait_for_eos (void)
+{
+  g_mutex_lock (&check_mutex);
+  while (!got_eos)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+}
+
+/* concatenates the output into one run of packets */
+static GByteArray *
+collect_output_packets (void)
+{
+  GByteArray *ts = g_byte_array_new ();
+  GList *l;
+
+  for (l = buffers; l; l = l->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (GST_BUFFER (l->data), &map, GST_MAP_READ);
+    g_byte_array_append (ts, map.data, map.size);
+    gst_buffer_unmap (GST_BUFFER (l->data), &map);
+  }
+  gst_check_drop_buffers ();
+
+  fail_unless (ts->len > 0);
+  fail_unless (ts->len % 188 == 0);
+
+  return ts;
+}
+
+/* packets with payload increment the continuity counter of their PID,
+ * adaptation-only packets repeat it */
+static void
+check_continuity_counter (gint * counters, const guint8 * packet)
+{
+  guint pid = GST_READ_UINT16_BE (packet + 1) & 0x1FFF;
+  gint cc = packet[3] & 0x0F;
+
+  fail_unless (packet[0] == 0x47);
+
+  if (pid == 0x1FFF)
+    return;
+
+  if (counters[pid] != -1) {
+    if (packet[3] & 0x10)
+      fail_unless_equals_int (cc, (counters[pid] + 1) & 0x0F);
+    else
+      fail_unless_equals_int (cc, counters[pid]);
+  }
+  counters[pid] = cc;
+}
+
+GST_START_TEST (test_cbr_pcr_continuity)
+{
+  GstElement *mux;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GByteArray *ts;
+  gint counters[0x2000];
+  guint pcr_only = 0, offset;
+  gchar *padname;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  /* PCR every 10ms, more often than there is data */
+  g_object_set (mux, "bitrate", (guint64) 2000000, "pcr-interval", 900, NULL);
+
+  got_eos = FALSE;
+  gst_pad_add_probe (mysinkpad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      eos_probe, NULL, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 25; i++) {
+    inbuffer = gst_buffer_new_and_alloc (2000);
+    gst_buffer_memset (inbuffer, 0, 0, 2000);
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  wait_for_eos ();
+
+  ts = collect_output_packets ();
+
+  for (i = 0; i < 0x2000; i++)
+    counters[i] = -1;
+
+  for (offset = 0; offset < ts->len; offset += 188) {
+    const guint8 *packet = ts->data + offset;
+
+    check_continuity_counter (counters, packet);
+
+    /* adaptation field only, with the PCR flag */
+    if ((packet[3] & 0x30) == 0x20 && packet[4] > 0 && (packet[5] & 0x10))
+      pcr_only++;
+  }
+  fail_unless (pcr_only > 0);
+
+  g_byte_array_unref (ts);
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+static gint64
+read_pcr (const guint8 * packet)
+{
+  guint64 base;
+
+  base = ((guint64) packet[6] << 25) | (packet[7] << 17) | (packet[8] << 9) |
+      (packet[9] << 1) | (packet[10] >> 7);
+
+  return base * 300 + (((packet[10] & 0x01) << 8) | packet[11]);
+}
+
+GST_START_TEST (test_cbr_pcr_spacing)
+{
+  GstElement *mux;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GByteArray *ts;
+  guint64 bitrate = 2000000;
+  gint64 last_pcr = -1, pcr, expected;
+  guint last_offset = 0, offset, n_pcr = 0, n_discont = 0;
+  gchar *padname;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", bitrate, "pcr-interval", 900, NULL);
+
+  got_eos = FALSE;
+  gst_pad_add_probe (mysinkpad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      eos_probe, NULL, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* 2 seconds without data after the first 10 buffers */
+  for (i = 0; i < 20; i++) {
+    inbuffer = gst_buffer_new_and_alloc (2000);
+    gst_buffer_memset (inbuffer, 0, 0, 2000);
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    if (i >= 10)
+      GST_BUFFER_PTS (inbuffer) += 2 * GST_SECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  wait_for_eos ();
+
+  ts = collect_output_packets ();
+
+  for (offset = 0; offset < ts->len; offset += 188) {
+    const guint8 *packet = ts->data + offset;
+
+    if (!(packet[3] & 0x20) || packet[4] == 0 || !(packet[5] & 0x10))
+      continue;
+
+    pcr = read_pcr (packet);
+    n_pcr++;
+
+    if (packet[5] & 0x80) {
+      /* the schedule restarted after the gap, further ahead than the
+       * bytes in between account for */
+      fail_unless (last_pcr != -1);
+      expected = last_pcr + gst_util_uint64_scale (offset - last_offset,
+          8 * 27000000, bitrate);
+      fail_unless (pcr > expected + 27000000);
+      n_discont++;
+    } else if (last_pcr != -1) {
+      /* the PCR follows the position in the output */
+      expected = last_pcr + gst_util_uint64_scale (offset - last_offset,
+          8 * 27000000, bitrate);
+      fail_unless (ABS (pcr - expected) <= 1,
+          "PCR %" G_GINT64_FORMAT " at offset %u, expected %" G_GINT64_FORMAT,
+          pcr, offset, expected);
+      /* and comes at the configured interval, 10ms */
+      fail_unless (pcr - last_pcr <= 270000 + gst_util_uint64_scale (188,
+              8 * 27000000, bitrate));
+    }
+    last_pcr = pcr;
+    last_offset = offset;
+  }
+  fail_unless (n_pcr > 50);
+  fail_unless_equals_int (n_discont, 1);
+
+  g_byte_array_unref (ts);
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+/* sections go out from their cached packets, so a repeated PAT or PMT
+ * is the same packet apart from its continuity counter */
+static gboolean
+section_packets_equal (const guint8 * a, const guint8 * b)
+{
+  return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] &&
+      (a[3] & 0xf0) == (b[3] & 0xf0) && memcmp (a + 4, b + 4, 184) == 0;
+}
+
+GST_START_TEST (test_section_carousel)
+{
+  GstElement *mux;
+  GstPad *src2, *mux_sink2;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  GByteArray *ts;
+  gint counters[0x2000];
+  const guint8 *pat = NULL, *pmt = NULL;
+  guint n_pat = 0, n_pmt = 0, n_pmt_changes = 0, n_after_change = 0;
+  guint pmt_pid = 0, offset;
+  gchar *padname;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  /* PAT and PMT every 10ms, with each buffer */
+  g_object_set (mux, "pat-interval", 900, "pmt-interval", 900, NULL);
+
+  got_eos = FALSE;
+  gst_pad_add_probe (mysinkpad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      eos_probe, NULL, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 10; i++) {
+    inbuffer = gst_buffer_new_and_alloc (100);
+    gst_buffer_memset (inbuffer, 0, 0, 100);
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+
+  /* a new stream changes the PMT, its cached packets must be redone */
+  src2 = gst_pad_new_from_static_template (&audio_src_template, "src2");
+  mux_sink2 = gst_element_get_request_pad (mux, "sink_%d");
+  fail_unless (mux_sink2 != NULL);
+  fail_unless (gst_pad_link (src2, mux_sink2) == GST_PAD_LINK_OK);
+  gst_pad_set_active (src2, TRUE);
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  gst_check_setup_events_with_stream_id (src2, mux, caps, GST_FORMAT_TIME,
+      "src2");
+  gst_caps_unref (caps);
+
+  /* interleaved so that the muxer always has data on one of the pads */
+  for (i = 10; i < 20; i++) {
+    inbuffer = gst_buffer_new_and_alloc (100);
+    gst_buffer_memset (inbuffer, 0, 0, 100);
+    GST_BUFFER_PTS (inbuffer) = (i * 40 - 20) * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (src2, inbuffer), GST_FLOW_OK);
+
+    inbuffer = gst_buffer_new_and_alloc (100);
+    gst_buffer_memset (inbuffer, 0, 0, 100);
+    GST_BUFFER_PTS (inbuffer) = i * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+  fail_unless (gst_pad_push_event (src2, gst_event_new_eos ()));
+  wait_for_eos ();
+
+  ts = collect_output_packets ();
+
+  for (i = 0; i < 0x2000; i++)
+    counters[i] = -1;
+
+  for (offset = 0; offset < ts->len; offset += 188) {
+    const guint8 *packet = ts->data + offset;
+    guint pid = GST_READ_UINT16_BE (packet + 1) & 0x1FFF;
+
+    check_continuity_counter (counters, packet);
+
+    if (pid == 0x0000) {
+      const guint8 *section = packet + 5 + packet[4];
+
+      fail_unless (packet[1] & 0x40);
+      if (pat == NULL) {
+        pat = packet;
+        /* first program after the header */
+        pmt_pid = GST_READ_UINT16_BE (section + 10) & 0x1FFF;
+      } else {
+        fail_unless (section_packets_equal (pat, packet));
+      }
+      n_pat++;
+    } else if (pmt_pid != 0 && pid == pmt_pid) {
+      if (pmt != NULL && !section_packets_equal (pmt, packet)) {
+        /* the new version must have been packetized again */
+        fail_unless (((packet[5 + packet[4] + 5] >> 1) & 0x1f) !=
+            ((pmt[5 + pmt[4] + 5] >> 1) & 0x1f));
+        n_pmt_changes++;
+        n_after_change = 0;
+      }
+      pmt = packet;
+      n_pmt++;
+      n_after_change++;
+    }
+  }
+
+  fail_unless (n_pat > 2);
+  fail_unless (n_pmt > 2);
+  fail_unless_equals_int (n_pmt_changes, 1);
+  /* and then sent again from the new cached packets */
+  fail_unless (n_after_change > 2);
+
+  g_byte_array_unref (ts);
+
+  gst_element_set_state (mux, GST_STATE_NULL);
+  gst_pad_set_active (src2, FALSE);
+  gst_pad_unlink (src2, mux_sink2);
+  gst_element_release_request_pad (mux, mux_sink2);
+  gst_object_unref (mux_sink2);
+  gst_object_unref (src2);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +1276,10 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_live_sparse_pad_timeout);
+  tcase_add_test (tc_chain, test_cbr_pcr_continuity);
+  tcase_add_test (tc_chain, test_cbr_pcr_spacing);
+  tcase_add_test (tc_chain, test_section_carousel);
 
   return s;
 }
@@ -21,6 +21,8 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
 #include <string.h>
 #include "mxfdemux.h"
 
@@ -28,6 +30,9 @@ static GstPad *mysrcpad, *mysinkpad;
 static GMainLoop *loop = NULL;
 static gboolean have_eos = FALSE;
 static gboolean have_data = FALSE;
+static gboolean short_reads = FALSE;
+static gint n_pads = 0;
+static gint n_caps = 0;
 
 static GstStaticPadTemplate mysrctemplate =
 GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
@@ -44,6 +49,7 @@ _pad_added (GstElement * element, GstPad * pad, gpointer user_data)
 
   fail_unless_equals_string (name, "track_2");
   fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+  n_pads++;
 
   g_free (name);
 }
@@ -100,6 +106,7 @@ _sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
 
       gst_event_parse_caps (event, &caps);
       _sink_check_caps (pad, caps);
+      n_caps++;
       break;
     }
     default:
@@ -134,6 +141,10 @@ static GstFlowReturn
 _src_getrange (GstPad * pad, GstObject * parent, guint64 offset, guint length,
     GstBuffer ** buffer)
 {
+  /* like filesrc, or fail reads past the end like other sources do */
+  if (short_reads && offset < sizeof (mxf_file))
+    length = MIN (length, sizeof (mxf_file) - offset);
+
   if (offset + length > sizeof (mxf_file))
     return GST_FLOW_EOS;
 
@@ -184,7 +195,8 @@ _create_src_pad_pull (void)
   return mysrcpad;
 }
 
-GST_START_TEST (test_pull)
+static void
+run_pull (guint readahead_size)
 {
   GstStateChangeReturn sret;
   GstElement *mxfdemux;
@@ -196,6 +208,7 @@ GST_START_TEST (test_pull)
 
   mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
   fail_unless (mxfdemux != NULL);
+  g_object_set (mxfdemux, "readahead-size", readahead_size, NULL);
   g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
   sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
   fail_unless (sinkpad != NULL);
@@ -230,9 +243,36 @@ GST_START_TEST (test_pull)
   loop = NULL;
 }
 
+GST_START_TEST (test_pull)
+{
+  short_reads = FALSE;
+  run_pull (64 * 1024);
+}
+
 GST_END_TEST;
 
-GST_START_TEST (test_push)
+/* Reads of the KLV packets are served from the readahead window, or
+ * directly from upstream if it's disabled or too small for a packet. The
+ * window is larger than the file and hits its end either way */
+GST_START_TEST (test_pull_readahead)
+{
+  static const guint sizes[] = { 0, 17, 4096, 64 * 1024 };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    GST_INFO ("readahead size %u", sizes[i]);
+
+    short_reads = FALSE;
+    run_pull (sizes[i]);
+    short_reads = TRUE;
+    run_pull (sizes[i]);
+  }
+}
+
+GST_END_TEST;
+
+static void
+run_push (const guint8 * data, gsize size, gboolean skip_descriptive_metadata)
 {
   GstElement *mxfdemux;
   GstBuffer *buffer;
@@ -241,16 +281,20 @@ GST_START_TEST (test_push)
 
   have_data = FALSE;
   have_eos = FALSE;
+  n_pads = 0;
+  n_caps = 0;
 
   mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
   fail_unless (mxfdemux != NULL);
+  g_object_set (mxfdemux, "skip-descriptive-metadata",
+      skip_descriptive_metadata, NULL);
   g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
   sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
   fail_unless (sinkpad != NULL);
 
   buffer =
       gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      (guint8 *) mxf_file, sizeof (mxf_file), 0, sizeof (mxf_file), NULL, NULL);
+      (guint8 *) data, size, 0, size, NULL, NULL);
   GST_BUFFER_OFFSET (buffer) = 0;
 
   mysinkpad = _create_sink_pad ();
@@ -275,6 +319,8 @@ GST_START_TEST (test_push)
 
   fail_unless (have_eos == TRUE);
   fail_unless (have_data == TRUE);
+  fail_unless_equals_int (n_pads, 1);
+  fail_unless_equals_int (n_caps, 1);
 
   gst_element_set_state (mxfdemux, GST_STATE_NULL);
   gst_pad_set_active (mysinkpad, FALSE);
@@ -285,6 +331,372 @@ GST_START_TEST (test_push)
   gst_object_unref (mysrcpad);
 }
 
+GST_START_TEST (test_push)
+{
+  run_push (mxf_file, sizeof (mxf_file), FALSE);
+}
+
+GST_END_TEST;
+
+/* Layout of the embedded file: a header partition with the header metadata
+ * and the essence, followed by the footer partition */
+#define PARTITION_PACK_SIZE 140
+#define PARTITION_PACK_VALUE 20
+#define HEADER_METADATA_START 140
+#define HEADER_METADATA_END 4137
+#define FOOTER_PARTITION 20031
+
+/* Returns a copy of the embedded file with @insert placed at @offset. The
+ * footer is moved and the header byte count grows if the insert is part of
+ * the header metadata. The random index pack is not updated, which only
+ * matters in pull mode */
+static guint8 *
+create_file_with_insert (gsize offset, const guint8 * insert,
+    gsize insert_size, gboolean header_metadata, gsize * size)
+{
+  guint8 *data, *pack;
+
+  *size = sizeof (mxf_file) + insert_size;
+  data = g_malloc (*size);
+  memcpy (data, mxf_file, offset);
+  memcpy (data + offset, insert, insert_size);
+  memcpy (data + offset + insert_size, mxf_file + offset,
+      sizeof (mxf_file) - offset);
+
+  /* footer partition and header byte count of the header partition */
+  pack = data + PARTITION_PACK_VALUE;
+  GST_WRITE_UINT64_BE (pack + 24, FOOTER_PARTITION + insert_size);
+  if (header_metadata)
+    GST_WRITE_UINT64_BE (pack + 32, GST_READ_UINT64_BE (pack + 32) +
+        insert_size);
+
+  /* this and footer partition of the footer partition */
+  pack = data + FOOTER_PARTITION + insert_size + PARTITION_PACK_VALUE;
+  GST_WRITE_UINT64_BE (pack + 8, FOOTER_PARTITION + insert_size);
+  GST_WRITE_UINT64_BE (pack + 24, FOOTER_PARTITION + insert_size);
+
+  return data;
+}
+
+/* Writers of growing files repeat the header metadata in body partitions.
+ * The identical copy must not change the tracks or the output */
+GST_START_TEST (test_push_repeated_metadata)
+{
+  gsize metadata_size = HEADER_METADATA_END - HEADER_METADATA_START;
+  gsize insert_size = PARTITION_PACK_SIZE + metadata_size;
+  guint8 *insert, *pack, *data;
+  gsize size;
+
+  /* a body partition without essence, with a copy of the header metadata */
+  insert = g_malloc (insert_size);
+  memcpy (insert, mxf_file, PARTITION_PACK_SIZE);
+  memcpy (insert + PARTITION_PACK_SIZE, mxf_file + HEADER_METADATA_START,
+      metadata_size);
+  insert[13] = 0x03;
+  pack = insert + PARTITION_PACK_VALUE;
+  GST_WRITE_UINT64_BE (pack + 8, FOOTER_PARTITION);
+  GST_WRITE_UINT64_BE (pack + 16, 0);
+  GST_WRITE_UINT64_BE (pack + 24, FOOTER_PARTITION + insert_size);
+  GST_WRITE_UINT64_BE (pack + 32, metadata_size);
+  GST_WRITE_UINT32_BE (pack + 60, 0);
+
+  data = create_file_with_insert (FOOTER_PARTITION, insert, insert_size,
+      FALSE, &size);
+  g_free (insert);
+
+  /* the footer follows the body partition now */
+  pack = data + FOOTER_PARTITION + insert_size + PARTITION_PACK_VALUE;
+  GST_WRITE_UINT64_BE (pack + 16, FOOTER_PARTITION);
+
+  run_push (data, size, FALSE);
+  g_free (data);
+}
+
+GST_END_TEST;
+
+/* A DMS-1 production framework set with only an instance UID */
+static const guint8 dms1_production_framework[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+  0x0d, 0x01, 0x04, 0x01, 0x01, 0x01, 0x01, 0x00,
+  0x14,
+  0x3c, 0x0a, 0x00, 0x10,
+  0x4d, 0x58, 0x46, 0x2d, 0x44, 0x4d, 0x53, 0x31,
+  0x2d, 0x74, 0x65, 0x73, 0x74, 0x2d, 0x30, 0x31
+};
+
+/* The descriptive metadata isn't referenced by the package, the essence
+ * comes out the same whether it is parsed or dropped */
+GST_START_TEST (test_push_skip_descriptive_metadata)
+{
+  guint8 *data;
+  gsize size;
+
+  data = create_file_with_insert (HEADER_METADATA_END,
+      dms1_production_framework, sizeof (dms1_production_framework), TRUE,
+      &size);
+
+  run_push (data, size, FALSE);
+  run_push (data, size, TRUE);
+  run_push (mxf_file, sizeof (mxf_file), TRUE);
+
+  g_free (data);
+}
+
+GST_END_TEST;
+
+/* Files written by mxfmux, with 3 seconds of tiny raw video frames that are
+ * filled with their frame number */
+#define N_FRAMES 75
+#define FRAME_RATE 25
+#define FRAME_SIZE (16 * 16 * 3)
+
+static GMutex frames_lock;
+static GCond frames_cond;
+static GArray *frames;
+
+static gchar *
+create_mxf_file (guint64 partition_duration)
+{
+  GstElement *pipeline, *src, *mux, *sink;
+  GstFlowReturn ret;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *location;
+  gint fd;
+  guint i;
+
+  fd = g_file_open_tmp ("mxfdemux-XXXXXX.mxf", &location, NULL);
+  fail_unless (fd != -1);
+  g_close (fd, NULL);
+
+  pipeline = gst_parse_launch ("appsrc name=src format=time "
+      "caps=video/x-raw,format=v308,width=16,height=16,framerate=25/1 ! "
+      "mxfmux name=mux ! filesink name=sink", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  mux = gst_bin_get_by_name (GST_BIN (pipeline), "mux");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (mux, "partition-duration", partition_duration, NULL);
+  g_object_set (sink, "location", location, NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  for (i = 0; i < N_FRAMES; i++) {
+    GstBuffer *buffer = gst_buffer_new_allocate (NULL, FRAME_SIZE, NULL);
+
+    gst_buffer_memset (buffer, 0, i, FRAME_SIZE);
+    GST_BUFFER_PTS (buffer) =
+        gst_util_uint64_scale (i, GST_SECOND, FRAME_RATE);
+    GST_BUFFER_DURATION (buffer) = GST_SECOND / FRAME_RATE;
+
+    g_signal_emit_by_name (src, "push-buffer", buffer, &ret);
+    gst_buffer_unref (buffer);
+    fail_unless_equals_int (ret, GST_FLOW_OK);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &ret);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src);
+  gst_object_unref (mux);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  return location;
+}
+
+static void
+_frame_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  guint8 frame;
+
+  fail_unless_equals_int (gst_buffer_get_size (buffer), FRAME_SIZE);
+  gst_buffer_extract (buffer, 0, &frame, 1);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buffer),
+      gst_util_uint64_scale (frame, GST_SECOND, FRAME_RATE));
+
+  g_mutex_lock (&frames_lock);
+  g_array_append_val (frames, frame);
+  g_cond_signal (&frames_cond);
+  g_mutex_unlock (&frames_lock);
+}
+
+static GstElement *
+create_demux_pipeline (const gchar * location, gboolean growing_file)
+{
+  GstElement *pipeline, *src, *demux, *sink;
+
+  pipeline = gst_parse_launch ("filesrc name=src ! mxfdemux name=demux ! "
+      "fakesink name=sink sync=false signal-handoffs=true", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_object_set (src, "location", location, NULL);
+  g_object_set (demux, "growing-file", growing_file, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (_frame_handoff), NULL);
+  gst_object_unref (src);
+  gst_object_unref (demux);
+  gst_object_unref (sink);
+
+  frames = g_array_new (FALSE, FALSE, sizeof (guint8));
+
+  return pipeline;
+}
+
+static void
+free_demux_pipeline (GstElement * pipeline)
+{
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_array_free (frames, TRUE);
+  frames = NULL;
+}
+
+static void
+wait_for_eos (GstElement * pipeline)
+{
+  GstMessage *msg;
+  GstBus *bus;
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+}
+
+/* All frames are keyframes, so the seek has to start exactly at the
+ * requested one and continue in order until the end */
+static void
+check_seek (const gchar * location, guint frame)
+{
+  GstElement *pipeline;
+  guint i;
+
+  pipeline = create_demux_pipeline (location, FALSE);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_ASYNC);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT,
+          gst_util_uint64_scale (frame, GST_SECOND, FRAME_RATE)));
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  wait_for_eos (pipeline);
+
+  fail_unless_equals_int (frames->len, N_FRAMES - frame);
+  for (i = 0; i < frames->len; i++)
+    fail_unless_equals_int (g_array_index (frames, guint8, i), frame + i);
+
+  free_demux_pipeline (pipeline);
+}
+
+/* The keyframes are looked up in the index table of the footer, or in the
+ * segments spread over the body partitions */
+GST_START_TEST (test_seek)
+{
+  static const guint seek_frames[] = { 0, 1, 13, 25, 26, 50, 74 };
+  static const guint64 partition_durations[] = { 0, GST_SECOND };
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (partition_durations); i++) {
+    gchar *location = create_mxf_file (partition_durations[i]);
+
+    for (j = 0; j < G_N_ELEMENTS (seek_frames); j++) {
+      GST_INFO ("seeking to frame %u with partition duration %"
+          GST_TIME_FORMAT, seek_frames[j],
+          GST_TIME_ARGS (partition_durations[i]));
+      check_seek (location, seek_frames[j]);
+    }
+
+    g_remove (location);
+    g_free (location);
+  }
+}
+
+GST_END_TEST;
+
+/* Only the first half of the file exists when the demuxer starts, it has to
+ * wait for the rest instead of going EOS and play all frames once the file
+ * is complete */
+GST_START_TEST (test_growing_file)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  gchar *location, *growing_location, *contents;
+  gsize size, written;
+  gint64 end_time;
+  FILE *file;
+  gint fd;
+  guint i;
+
+  location = create_mxf_file (GST_SECOND);
+  fail_unless (g_file_get_contents (location, &contents, &size, NULL));
+  written = size / 2;
+
+  fd = g_file_open_tmp ("mxfdemux-XXXXXX.mxf", &growing_location, NULL);
+  fail_unless (fd != -1);
+  g_close (fd, NULL);
+  fail_unless (g_file_set_contents (growing_location, contents, written,
+          NULL));
+
+  pipeline = create_demux_pipeline (growing_location, TRUE);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&frames_lock);
+  while (frames->len == 0)
+    fail_unless (g_cond_wait_until (&frames_cond, &frames_lock, end_time));
+  g_mutex_unlock (&frames_lock);
+
+  /* give it time to run into the end of the file */
+  g_usleep (G_USEC_PER_SEC / 2);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_pop_filtered (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg == NULL);
+  g_mutex_lock (&frames_lock);
+  fail_unless (frames->len < N_FRAMES);
+  g_mutex_unlock (&frames_lock);
+
+  /* append in place, the demuxer keeps reading the same file */
+  file = g_fopen (growing_location, "ab");
+  fail_unless (file != NULL);
+  fail_unless_equals_int (fwrite (contents + written, 1, size - written,
+          file), size - written);
+  fclose (file);
+
+  wait_for_eos (pipeline);
+  gst_object_unref (bus);
+
+  fail_unless_equals_int (frames->len, N_FRAMES);
+  for (i = 0; i < frames->len; i++)
+    fail_unless_equals_int (g_array_index (frames, guint8, i), i);
+
+  free_demux_pipeline (pipeline);
+  g_remove (growing_location);
+  g_remove (location);
+  g_free (growing_location);
+  g_free (location);
+  g_free (contents);
+}
+
 GST_END_TEST;
 
 static Suite *
@@ -301,7 +713,12 @@ mxfdemux_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_set_timeout (tc_chain, 180);
   tcase_add_test (tc_chain, test_pull);
+  tcase_add_test (tc_chain, test_pull_readahead);
   tcase_add_test (tc_chain, test_push);
+  tcase_add_test (tc_chain, test_push_repeated_metadata);
+  tcase_add_test (tc_chain, test_push_skip_descriptive_metadata);
+  tcase_add_test (tc_chain, test_seek);
+  tcase_add_test (tc_chain, test_growing_file);
 
   return s;
 }
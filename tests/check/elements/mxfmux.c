@@ -21,6 +21,8 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 static const gchar *
@@ -265,6 +267,417 @@ GST_START_TEST (test_h264_raw_audio)
 
 GST_END_TEST;
 
+/* Round trips through mxfmux and mxfdemux, the demuxed streams are compared
+ * against what went into the muxer */
+typedef struct
+{
+  GstCaps *caps;
+  GQueue buffers;
+} StreamData;
+
+typedef struct
+{
+  StreamData video;
+  StreamData audio;
+} Streams;
+
+static void
+streams_clear (Streams * streams)
+{
+  gst_caps_replace (&streams->video.caps, NULL);
+  gst_caps_replace (&streams->audio.caps, NULL);
+  g_queue_foreach (&streams->video.buffers, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&streams->video.buffers);
+  g_queue_foreach (&streams->audio.buffers, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&streams->audio.buffers);
+}
+
+static void
+_collect_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    Streams * streams)
+{
+  GstCaps *caps = gst_pad_get_current_caps (pad);
+  StreamData *data;
+
+  fail_unless (caps != NULL);
+  if (gst_structure_has_name (gst_caps_get_structure (caps, 0),
+          "video/x-raw"))
+    data = &streams->video;
+  else
+    data = &streams->audio;
+
+  if (!data->caps)
+    data->caps = gst_caps_ref (caps);
+  g_queue_push_tail (&data->buffers, gst_buffer_ref (buffer));
+  gst_caps_unref (caps);
+}
+
+static void
+run_pipeline (GstElement * pipeline)
+{
+  GstMessage *msg;
+  GstBus *bus;
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+}
+
+/* Muxes raw video and audio into a temporary file and collects the input
+ * of the muxer in @streams */
+static gchar *
+mux_file (gint width, gint height, gint n_frames,
+    guint64 partition_duration, Streams * streams)
+{
+  GstElement *pipeline, *sink;
+  gchar *pipeline_string, *location;
+  gint fd;
+
+  fd = g_file_open_tmp ("mxfmux-XXXXXX.mxf", &location, NULL);
+  fail_unless (fd != -1);
+  g_close (fd, NULL);
+
+  pipeline_string = g_strdup_printf ("videotestsrc pattern=ball "
+      "num-buffers=%d ! video/x-raw,format=(string)v308,width=%d,height=%d,"
+      "framerate=25/1 ! tee name=vt ! queue ! mxfmux name=mux "
+      "partition-duration=%" G_GUINT64_FORMAT " ! filesink location=%s "
+      "vt. ! queue ! fakesink name=vsink signal-handoffs=true sync=false "
+      "audiotestsrc num-buffers=%d samplesperbuffer=1920 ! "
+      "audio/x-raw,format=S16LE,rate=48000,channels=2 ! tee name=at ! "
+      "queue ! mux. "
+      "at. ! queue ! fakesink name=asink signal-handoffs=true sync=false",
+      n_frames, width, height, partition_duration, location, n_frames);
+  pipeline = gst_parse_launch (pipeline_string, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (pipeline_string);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "vsink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (_collect_handoff), streams);
+  gst_object_unref (sink);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "asink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (_collect_handoff), streams);
+  gst_object_unref (sink);
+
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+
+  return location;
+}
+
+/* Whether the demuxer may output frames with the stride of the file */
+static gboolean accept_video_meta = FALSE;
+
+static GstPadProbeReturn
+_allocation_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstQuery *query = GST_PAD_PROBE_INFO_QUERY (info);
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_ALLOCATION)
+    return GST_PAD_PROBE_OK;
+
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  return GST_PAD_PROBE_HANDLED;
+}
+
+static void
+_demux_pad_added (GstElement * demux, GstPad * pad, Streams * streams)
+{
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad;
+
+  g_object_set (sink, "signal-handoffs", TRUE, "sync", FALSE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (_collect_handoff), streams);
+  gst_bin_add (GST_BIN (GST_ELEMENT_PARENT (demux)), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  if (accept_video_meta)
+    gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM,
+        _allocation_probe, NULL, NULL);
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+static void
+demux_file (const gchar * location, Streams * streams)
+{
+  GstElement *pipeline, *src, *demux;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  demux = gst_element_factory_make ("mxfdemux", NULL);
+  fail_unless (src != NULL && demux != NULL);
+  g_object_set (src, "location", location, NULL);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (_demux_pad_added),
+      streams);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, NULL);
+  fail_unless (gst_element_link (src, demux));
+
+  run_pipeline (pipeline);
+  gst_object_unref (pipeline);
+}
+
+/* Compares the visible part of every line, the padding at the end of the
+ * lines doesn't matter */
+static void
+compare_video (StreamData * in, StreamData * out)
+{
+  GstVideoInfo in_info, out_info;
+  GList *l, *m;
+
+  fail_unless_equals_int (g_queue_get_length (&out->buffers),
+      g_queue_get_length (&in->buffers));
+  fail_unless (gst_video_info_from_caps (&in_info, in->caps));
+  fail_unless (gst_video_info_from_caps (&out_info, out->caps));
+  fail_unless_equals_int (GST_VIDEO_INFO_FORMAT (&out_info),
+      GST_VIDEO_INFO_FORMAT (&in_info));
+  fail_unless_equals_int (GST_VIDEO_INFO_WIDTH (&out_info),
+      GST_VIDEO_INFO_WIDTH (&in_info));
+  fail_unless_equals_int (GST_VIDEO_INFO_HEIGHT (&out_info),
+      GST_VIDEO_INFO_HEIGHT (&in_info));
+
+  for (l = in->buffers.head, m = out->buffers.head; l; l = l->next,
+      m = m->next) {
+    GstVideoFrame in_frame, out_frame;
+    gint line, line_size;
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (m->data),
+        GST_BUFFER_PTS (l->data));
+
+    fail_unless (gst_video_frame_map (&in_frame, &in_info, l->data,
+            GST_MAP_READ));
+    fail_unless (gst_video_frame_map (&out_frame, &out_info, m->data,
+            GST_MAP_READ));
+
+    line_size = GST_VIDEO_FRAME_COMP_WIDTH (&in_frame, 0) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (&in_frame, 0);
+    for (line = 0; line < GST_VIDEO_FRAME_HEIGHT (&in_frame); line++) {
+      fail_unless (memcmp ((guint8 *) GST_VIDEO_FRAME_PLANE_DATA (&in_frame,
+                  0) + line * GST_VIDEO_FRAME_PLANE_STRIDE (&in_frame, 0),
+              (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (&out_frame,
+                  0) + line * GST_VIDEO_FRAME_PLANE_STRIDE (&out_frame, 0),
+              line_size) == 0, "line %d differs", line);
+    }
+
+    gst_video_frame_unmap (&in_frame);
+    gst_video_frame_unmap (&out_frame);
+  }
+}
+
+/* The demuxer splits the samples per edit unit of the video */
+static void
+compare_audio (StreamData * in, StreamData * out)
+{
+  GByteArray *in_data = g_byte_array_new ();
+  GByteArray *out_data = g_byte_array_new ();
+  GstStructure *in_s, *out_s;
+  gint in_rate, out_rate, in_channels, out_channels;
+  GList *l;
+
+  in_s = gst_caps_get_structure (in->caps, 0);
+  out_s = gst_caps_get_structure (out->caps, 0);
+  fail_unless_equals_string (gst_structure_get_string (out_s, "format"),
+      gst_structure_get_string (in_s, "format"));
+  fail_unless (gst_structure_get_int (in_s, "rate", &in_rate));
+  fail_unless (gst_structure_get_int (out_s, "rate", &out_rate));
+  fail_unless_equals_int (out_rate, in_rate);
+  fail_unless (gst_structure_get_int (in_s, "channels", &in_channels));
+  fail_unless (gst_structure_get_int (out_s, "channels", &out_channels));
+  fail_unless_equals_int (out_channels, in_channels);
+
+  for (l = in->buffers.head; l; l = l->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    g_byte_array_append (in_data, map.data, map.size);
+    gst_buffer_unmap (l->data, &map);
+  }
+  for (l = out->buffers.head; l; l = l->next) {
+    GstMapInfo map;
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    g_byte_array_append (out_data, map.data, map.size);
+    gst_buffer_unmap (l->data, &map);
+  }
+
+  fail_unless_equals_int (out_data->len, in_data->len);
+  fail_unless (memcmp (out_data->data, in_data->data, in_data->len) == 0);
+
+  g_byte_array_unref (in_data);
+  g_byte_array_unref (out_data);
+}
+
+static void
+run_round_trip (gint width, gint height, gint n_frames,
+    guint64 partition_duration)
+{
+  Streams in = { {NULL,}, {NULL,} }, out = { {NULL,}, {NULL,} };
+  gchar *location;
+
+  location = mux_file (width, height, n_frames, partition_duration, &in);
+  demux_file (location, &out);
+
+  fail_unless_equals_int (g_queue_get_length (&in.video.buffers), n_frames);
+  compare_video (&in.video, &out.video);
+  compare_audio (&in.audio, &out.audio);
+
+  streams_clear (&in);
+  streams_clear (&out);
+  g_remove (location);
+  g_free (location);
+}
+
+static const guint8 partition_pack_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01
+};
+
+static const guint8 index_table_segment_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x10, 0x01, 0x00
+};
+
+static const guint8 random_index_pack_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x11, 0x01, 0x00
+};
+
+/* Returns the offset of the value of the KLV packet at @offset */
+static gsize
+klv_value_offset (const guint8 * data, gsize size, gsize offset,
+    guint64 * length)
+{
+  guint i, n;
+
+  fail_unless (offset + 17 <= size);
+  if (!(data[offset + 16] & 0x80)) {
+    *length = data[offset + 16];
+    return offset + 17;
+  }
+
+  n = data[offset + 16] & 0x7f;
+  fail_unless (n <= 8 && offset + 17 + n <= size);
+  *length = 0;
+  for (i = 0; i < n; i++)
+    *length = (*length << 8) | data[offset + 17 + i];
+
+  return offset + 17 + n;
+}
+
+/* The random index pack has to list the header, every body and the footer
+ * partition. Except for the first one, the body partitions carry the index
+ * table segments of the previous one */
+static void
+check_partitions (const gchar * location, guint n_indexed_expected)
+{
+  gchar *contents;
+  const guint8 *data, *rip;
+  gsize size, value, prev_offset = 0;
+  guint64 length;
+  guint i, n_entries, n_indexed = 0;
+
+  fail_unless (g_file_get_contents (location, &contents, &size, NULL));
+  data = (const guint8 *) contents;
+
+  fail_unless (size > 4);
+  rip = data + size - GST_READ_UINT32_BE (data + size - 4);
+  fail_unless (rip >= data);
+  fail_unless (memcmp (rip, random_index_pack_key, 16) == 0);
+  value = klv_value_offset (data, size, rip - data, &length);
+  fail_unless (value + length == size);
+  n_entries = (length - 4) / 12;
+  fail_unless (n_entries >= 3);
+
+  for (i = 0; i < n_entries; i++) {
+    guint64 offset = GST_READ_UINT64_BE (data + value + i * 12 + 4);
+    const guint8 *pack = data + offset;
+    gsize pack_value, next;
+    guint8 type;
+
+    fail_unless (i == 0 || offset > prev_offset);
+    fail_unless (offset + 16 < size);
+    fail_unless (memcmp (pack, partition_pack_key,
+            sizeof (partition_pack_key)) == 0);
+    prev_offset = offset;
+
+    type = pack[13];
+    if (i == 0)
+      fail_unless_equals_int (type, 0x02);
+    else if (i == n_entries - 1)
+      fail_unless_equals_int (type, 0x04);
+    else
+      fail_unless_equals_int (type, 0x03);
+
+    if (type != 0x03)
+      continue;
+
+    /* index byte count */
+    pack_value = klv_value_offset (data, size, offset, &length);
+    if (GST_READ_UINT64_BE (data + pack_value + 40) == 0)
+      continue;
+
+    next = pack_value + length;
+    fail_unless (next + 16 <= size);
+    fail_unless (memcmp (data + next, index_table_segment_key, 16) == 0);
+    n_indexed++;
+  }
+
+  fail_unless (n_indexed >= n_indexed_expected);
+  g_free (contents);
+}
+
+GST_START_TEST (test_round_trip)
+{
+  run_round_trip (16, 16, 75, 0);
+}
+
+GST_END_TEST;
+
+/* 3 seconds with a new partition every second */
+GST_START_TEST (test_body_partitions)
+{
+  Streams in = { {NULL,}, {NULL,} };
+  gchar *location;
+
+  location = mux_file (16, 16, 75, GST_SECOND, &in);
+  check_partitions (location, 2);
+  streams_clear (&in);
+  g_remove (location);
+  g_free (location);
+
+  location = mux_file (16, 16, 75, 0, &in);
+  check_partitions (location, 0);
+  streams_clear (&in);
+  g_remove (location);
+  g_free (location);
+
+  run_round_trip (16, 16, 75, GST_SECOND);
+}
+
+GST_END_TEST;
+
+/* The lines of 33 v308 pixels are not 4 byte aligned, the demuxer has to
+ * repack them unless downstream handles the stride with a video meta */
+GST_START_TEST (test_round_trip_unaligned_lines)
+{
+  accept_video_meta = FALSE;
+  run_round_trip (33, 17, 10, 0);
+  accept_video_meta = TRUE;
+  run_round_trip (33, 17, 10, 0);
+  accept_video_meta = FALSE;
+}
+
+GST_END_TEST;
+
 static Suite *
 mxfmux_suite (void)
 {
@@ -281,6 +694,9 @@ mxfmux_suite (void)
   tcase_add_test (tc_chain, test_dnxhd_mp3);
   tcase_add_test (tc_chain, test_h264_raw_audio);
   tcase_add_test (tc_chain, test_multiple_av_streams);
+  tcase_add_test (tc_chain, test_round_trip);
+  tcase_add_test (tc_chain, test_body_partitions);
+  tcase_add_test (tc_chain, test_round_trip_unaligned_lines);
 
   return s;
 }
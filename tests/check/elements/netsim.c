@@ -49,6 +49,100 @@ GST_START_TEST (netsim_stress_delayed)
 
 GST_END_TEST;
 
+static void
+push_numbered_buffers (GstHarness * h, guint first, guint n)
+{
+  guint i;
+
+  for (i = first; i < first + n; i++) {
+    GstBuffer *buf = gst_harness_create_buffer (h, 100);
+
+    GST_BUFFER_OFFSET (buf) = i;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+}
+
+GST_START_TEST (netsim_delayed_ordering)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim delay-probability=1.0 "
+      "min-delay=10 max-delay=50 allow-reordering=false");
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+  push_numbered_buffers (h, 0, 50);
+
+  /* every packet got a random delay, they still come out in order */
+  for (i = 0; i < 50; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+
+    fail_unless (buf != NULL);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), i);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (netsim_delayed_reordering)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim delay-probability=1.0 "
+      "min-delay=0 max-delay=50 allow-reordering=true");
+  gboolean seen[50] = { FALSE, };
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+  push_numbered_buffers (h, 0, 50);
+
+  /* in any order, but every packet exactly once */
+  for (i = 0; i < 50; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+
+    fail_unless (buf != NULL);
+    fail_unless (GST_BUFFER_OFFSET (buf) < 50);
+    fail_if (seen[GST_BUFFER_OFFSET (buf)]);
+    seen[GST_BUFFER_OFFSET (buf)] = TRUE;
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (netsim_delayed_flush)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim delay-probability=1.0 "
+      "min-delay=200 max-delay=200");
+  GstSegment segment;
+  GstBuffer *buf;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+  push_numbered_buffers (h, 0, 5);
+
+  /* the delayed packets are flushed out along with the rest of the data */
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_start ()));
+  fail_unless (gst_harness_push_event (h, gst_event_new_flush_stop (TRUE)));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  fail_unless (gst_harness_push_event (h, gst_event_new_segment (&segment)));
+
+  push_numbered_buffers (h, 100, 1);
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), 100);
+  gst_buffer_unref (buf);
+
+  /* and nothing from before the flush shows up later */
+  g_usleep (G_USEC_PER_SEC / 2);
+  fail_unless (gst_harness_try_pull (h) == NULL);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 netsim_suite (void)
 {
@@ -58,6 +152,9 @@ netsim_suite (void)
   suite_add_tcase (s, (tc_chain = tcase_create ("general")));
   tcase_add_test (tc_chain, netsim_stress);
   tcase_add_test (tc_chain, netsim_stress_delayed);
+  tcase_add_test (tc_chain, netsim_delayed_ordering);
+  tcase_add_test (tc_chain, netsim_delayed_reordering);
+  tcase_add_test (tc_chain, netsim_delayed_flush);
 
   return s;
 }
@@ -115,6 +115,45 @@ GST_START_TEST (test_parse_zerosize_frames)
 
 GST_END_TEST;
 
+GST_START_TEST (test_parse_split_flows)
+{
+  GstHarness *h;
+  GstElement *parse;
+  GstPad *pad;
+  guint8 *data;
+  gsize frame_size = sizeof (zerosize_data) - sizeof (pcap_header);
+  gsize data_size = sizeof (zerosize_data) + frame_size;
+
+  /* the same frame twice, the second one to destination port 5005 */
+  data = g_malloc (data_size);
+  memcpy (data, zerosize_data, sizeof (zerosize_data));
+  memcpy (data + sizeof (zerosize_data), zerosize_data + sizeof (pcap_header),
+      frame_size);
+  data[sizeof (zerosize_data) + 16 + 14 + 20 + 3] = 0x8d;
+
+  h = gst_harness_new_with_padnames ("pcapparse", "sink", NULL);
+  parse = h->element;
+  g_object_set (parse, "split-flows", TRUE, NULL);
+  gst_harness_set_src_caps_str (h, "raw/x-pcap");
+  gst_harness_play (h);
+
+  gst_harness_push (h, gst_buffer_new_wrapped (data, data_size));
+
+  fail_unless_equals_int (parse->numsrcpads, 3);
+  pad = gst_element_get_static_pad (parse,
+      "src_udp_127.0.0.1_53923_127.0.0.1_5004");
+  fail_unless (pad != NULL);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (parse,
+      "src_udp_127.0.0.1_53923_127.0.0.1_5005");
+  fail_unless (pad != NULL);
+  gst_object_unref (pad);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 pcapparse_suite (void)
 {
@@ -133,6 +172,7 @@ pcapparse_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_parse_frames_with_eth_padding);
   tcase_add_test (tc_chain, test_parse_zerosize_frames);
+  tcase_add_test (tc_chain, test_parse_split_flows);
 
   return s;
 }
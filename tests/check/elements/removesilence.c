@@ -0,0 +1,200 @@
+/* GStreamer unit test for removesilence
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+
+/* the energy sums are internal to the plugin */
+#include "../../gst/removesilence/vad_private.c"
+
+#define MAX_SAMPLES 300
+
+/* The vector sum of squares must be exact, also for full scale negative
+ * samples whose pairs of squares don't fit a signed 32 bit integer */
+GST_START_TEST (test_energy_s16_simd)
+{
+  gint16 data[MAX_SAMPLES];
+  guint run;
+  gint n, i;
+
+  g_random_set_seed (37);
+  for (run = 0; run < 4; run++) {
+    for (i = 0; i < MAX_SAMPLES; i++) {
+      if (run == 0)
+        data[i] = G_MININT16;
+      else if (run == 1)
+        data[i] = i % 2 ? G_MAXINT16 : G_MININT16;
+      else if (run == 2)
+        data[i] = g_random_int_range (G_MININT16, G_MAXINT16 + 1);
+      else
+        data[i] = g_random_int_range (-64, 64);
+    }
+
+    for (n = 0; n <= MAX_SAMPLES; n++) {
+      guint64 ref = 0;
+
+      for (i = 0; i < n; i++)
+        ref += (gint64) data[i] * data[i];
+      fail_unless_equals_uint64 (vad_energy_s16 (data, n), ref);
+    }
+  }
+}
+
+GST_END_TEST;
+
+/* The float lanes round differently than a sum in double precision, but
+ * never by more than their precision over the samples of one lane */
+GST_START_TEST (test_energy_float_simd)
+{
+  gint lengths[] = { 0, 1, 3, 4, 5, 17, 255, 4096, 4099, 10007 };
+  gfloat *data = g_new (gfloat, 10007);
+  guint i, run;
+  gint k;
+
+  g_random_set_seed (41);
+  for (run = 0; run < 3; run++) {
+    for (k = 0; k < 10007; k++) {
+      if (run == 0)
+        data[k] = g_random_double_range (-1.0, 1.0);
+      else if (run == 1)
+        data[k] = g_random_double_range (-1e-4, 1e-4);
+      else
+        data[k] = (k % 100 < 50 ? 0.9 : 1e-3) * sin (k * 0.1);
+    }
+
+    for (i = 0; i < G_N_ELEMENTS (lengths); i++) {
+      gdouble ref = 0.0, energy;
+
+      for (k = 0; k < lengths[i]; k++)
+        ref += (gdouble) data[k] * data[k];
+      energy = vad_energy_float (data, lengths[i]);
+      fail_unless (fabs (energy - ref) <= 1e-4 * ref,
+          "length %d, run %u: %g != %g", lengths[i], run, energy, ref);
+    }
+  }
+
+  g_free (data);
+}
+
+GST_END_TEST;
+
+#define RATE 16000
+#define BUFFER_SAMPLES 160
+#define N_BUFFERS 100
+
+/* 100 ms of tone and 100 ms of very quiet noise in turns */
+static gint16
+test_sample (gint i)
+{
+  if ((i / (RATE / 10)) % 2 == 0)
+    return 16000 * sin (2 * G_PI * 440 * i / RATE);
+  return (i * 7919) % 5 - 2;
+}
+
+static GList *
+run_removesilence (GstAudioFormat format)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *pts = NULL;
+  gchar *caps;
+  gint n, i;
+
+  h = gst_harness_new_parse ("removesilence remove=true "
+      "frame-duration=5000000");
+  caps = g_strdup_printf ("audio/x-raw,format=%s,layout=interleaved,"
+      "rate=%d,channels=2", gst_audio_format_to_string (format), RATE);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  for (n = 0; n < N_BUFFERS; n++) {
+    GstMapInfo map;
+
+    buf = gst_buffer_new_allocate (NULL, BUFFER_SAMPLES * 2 *
+        (format == GST_AUDIO_FORMAT_S16 ? 2 : 4), NULL);
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+    for (i = 0; i < 2 * BUFFER_SAMPLES; i++) {
+      gint16 v = test_sample (n * BUFFER_SAMPLES + i / 2);
+
+      if (format == GST_AUDIO_FORMAT_S16)
+        ((gint16 *) map.data)[i] = v;
+      else
+        ((gfloat *) map.data)[i] = v / 32768.0f;
+    }
+    gst_buffer_unmap (buf, &map);
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (n * BUFFER_SAMPLES,
+        GST_SECOND, RATE);
+    GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (BUFFER_SAMPLES,
+        GST_SECOND, RATE);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  while ((buf = gst_harness_try_pull (h))) {
+    pts = g_list_append (pts, GUINT_TO_POINTER ((guint)
+            gst_util_uint64_scale (GST_BUFFER_PTS (buf), RATE, GST_SECOND)));
+    gst_buffer_unref (buf);
+  }
+  gst_harness_teardown (h);
+
+  return pts;
+}
+
+/* The S16 and F32 paths must take the same decisions on the same audio */
+GST_START_TEST (test_formats)
+{
+  GList *s16, *f32, *l, *m;
+
+  s16 = run_removesilence (GST_AUDIO_FORMAT_S16);
+  f32 = run_removesilence (GST_AUDIO_FORMAT_F32);
+
+  /* the quiet parts are removed */
+  fail_unless (s16 != NULL);
+  fail_unless (g_list_length (s16) < N_BUFFERS);
+
+  fail_unless_equals_int (g_list_length (f32), g_list_length (s16));
+  for (l = s16, m = f32; l && m; l = l->next, m = m->next)
+    fail_unless_equals_int (GPOINTER_TO_UINT (m->data),
+        GPOINTER_TO_UINT (l->data));
+
+  g_list_free (s16);
+  g_list_free (f32);
+}
+
+GST_END_TEST;
+
+static Suite *
+removesilence_suite (void)
+{
+  Suite *s = suite_create ("removesilence");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_energy_s16_simd);
+  tcase_add_test (tc_chain, test_energy_float_simd);
+  tcase_add_test (tc_chain, test_formats);
+
+  return s;
+}
+
+GST_CHECK_MAIN (removesilence);
@@ -0,0 +1,119 @@
+/* GStreamer
+ *
+ * unit tests for scenechange
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+#include <string.h>
+
+static GstBuffer *
+create_frame (GstVideoInfo * info, guint8 luma)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, info->size, NULL);
+  GstVideoFrame frame;
+  gint i;
+
+  fail_unless (gst_video_frame_map (&frame, info, buf, GST_MAP_WRITE));
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&frame); i++) {
+    memset (GST_VIDEO_FRAME_PLANE_DATA (&frame, i), i == 0 ? luma : 128,
+        GST_VIDEO_FRAME_PLANE_STRIDE (&frame, i) *
+        GST_VIDEO_FRAME_COMP_HEIGHT (&frame, i));
+  }
+  gst_video_frame_unmap (&frame);
+
+  return buf;
+}
+
+/* Pushes flat frames with a cut from a dark to a bright picture after
+ * 6 frames and returns the number of force key unit events sent */
+static guint
+count_scene_changes (gint width, gint height, const gchar * properties)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+  GstEvent *event;
+  gchar *desc;
+  guint n_changes = 0;
+  gint i;
+
+  desc = g_strdup_printf ("scenechange %s", properties);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, width, height);
+  gst_harness_set_src_caps (h, gst_video_info_to_caps (&info));
+
+  for (i = 0; i < 12; i++) {
+    GstBuffer *buf = create_frame (&info, i < 6 ? 40 : 200);
+
+    GST_BUFFER_PTS (buf) = i * GST_SECOND / 30;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  while ((event = gst_harness_try_pull_event (h))) {
+    if (gst_video_event_is_force_key_unit (event))
+      n_changes++;
+    gst_event_unref (event);
+  }
+
+  gst_harness_teardown (h);
+
+  return n_changes;
+}
+
+GST_START_TEST (test_scene_change)
+{
+  fail_unless_equals_int (count_scene_changes (64, 48, ""), 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_scene_change_decimated)
+{
+  fail_unless_equals_int (count_scene_changes (64, 48, "decimation=4"), 1);
+  fail_unless_equals_int (count_scene_changes (60, 46, "decimation=8"), 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_scene_change_thresholds)
+{
+  fail_unless_equals_int (count_scene_changes (64, 48, "min-score=200"), 0);
+  fail_unless_equals_int (count_scene_changes (64, 48,
+          "decimation=2 min-score=200"), 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+scenechange_suite (void)
+{
+  Suite *s = suite_create ("scenechange");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_scene_change);
+  tcase_add_test (tc_chain, test_scene_change_decimated);
+  tcase_add_test (tc_chain, test_scene_change_thresholds);
+
+  return s;
+}
+
+GST_CHECK_MAIN (scenechange);
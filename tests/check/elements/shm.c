@@ -26,6 +26,11 @@
 
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
+#include <glib/gstdio.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -169,6 +174,232 @@ GST_START_TEST (test_shm_alloc)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shm_slab)
+{
+  GstBuffer *buf;
+  GstSegment segment;
+  GstStructure *stats;
+  guint64 val;
+  guint i;
+
+  g_object_set (sink, "slab-size", 4096, NULL);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 3; i++) {
+    buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+  }
+
+  g_mutex_lock (&check_mutex);
+  while (g_list_length (buffers) < 3)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+
+  /* the received buffers keep their slots in use */
+  g_object_get (sink, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "slab-size", &val));
+  fail_unless_equals_uint64 (val, 4096);
+  fail_unless (gst_structure_get_uint64 (stats, "blocks", &val));
+  fail_unless_equals_uint64 (val, 3);
+  fail_unless (gst_structure_get_uint64 (stats, "used", &val));
+  fail_unless_equals_uint64 (val, 3000);
+  fail_unless (gst_structure_get_uint64 (stats, "wasted", &val));
+  fail_unless_equals_uint64 (val, 3 * 3096);
+  fail_unless (gst_structure_get_uint64 (stats, "largest-free", &val));
+  fail_unless_equals_uint64 (val, 4096);
+  gst_structure_free (stats);
+
+  gst_check_drop_buffers ();
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_ring)
+{
+  GstBuffer *buf;
+  GstSegment segment;
+  GstStructure *stats;
+  guint64 blocks;
+  guint i;
+
+  /* reconnect asking for a ring */
+  fail_unless (gst_element_set_state (src, GST_STATE_READY) ==
+      GST_STATE_CHANGE_SUCCESS);
+  g_object_set (sink, "ring-size", 16, NULL);
+  g_object_set (src, "use-ring", TRUE, NULL);
+  fail_unless (gst_element_set_state (src, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 20; i++) {
+    buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+    gst_buffer_memset (buf, 0, i, 1000);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+    g_mutex_lock (&check_mutex);
+    while (g_list_length (buffers) < i + 1)
+      g_cond_wait (&check_cond, &check_mutex);
+    g_mutex_unlock (&check_mutex);
+  }
+
+  for (i = 0; i < 20; i++) {
+    guint8 byte;
+
+    buf = g_list_nth_data (buffers, i);
+    fail_unless (gst_buffer_get_size (buf) == 1000);
+    gst_buffer_extract (buf, 999, &byte, 1);
+    fail_unless_equals_int (byte, i);
+  }
+
+  /* the releases go back through the ring */
+  gst_check_drop_buffers ();
+  do {
+    g_usleep (1000);
+    g_object_get (sink, "stats", &stats, NULL);
+    fail_unless (gst_structure_get_uint64 (stats, "blocks", &blocks));
+    gst_structure_free (stats);
+  } while (blocks > 0);
+
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+#define FD_FILE_SIZE 4096
+#define FD_BUFFER_OFFSET 1000
+#define FD_BUFFER_SIZE 2000
+
+static void
+buffer_freed (gpointer data, GstMiniObject * obj)
+{
+  g_atomic_int_set ((gint *) data, TRUE);
+}
+
+static void
+wait_for_released_blocks (void)
+{
+  GstStructure *stats;
+  guint64 blocks;
+
+  do {
+    g_usleep (1000);
+    g_object_get (sink, "stats", &stats, NULL);
+    fail_unless (gst_structure_get_uint64 (stats, "blocks", &blocks));
+    gst_structure_free (stats);
+  } while (blocks > 0);
+}
+
+/* Pushes a buffer backed by the fd of a temporary file, checks what the
+ * source outputs and returns once the sink released the buffer */
+static void
+push_fd_buffer (gboolean sink_fd_passing, gboolean src_fd_passing)
+{
+  GstAllocator *allocator;
+  GstBuffer *buf;
+  GstMemory *mem;
+  GstSegment segment;
+  guint8 data[FD_FILE_SIZE];
+  gchar *filename;
+  struct stat st, received_st;
+  gint freed = FALSE;
+  gint fd, i;
+
+  fail_unless (gst_element_set_state (src, GST_STATE_READY) ==
+      GST_STATE_CHANGE_SUCCESS);
+  g_object_set (sink, "fd-passing", sink_fd_passing, NULL);
+  g_object_set (src, "fd-passing", src_fd_passing, NULL);
+  fail_unless (gst_element_set_state (src, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* the reader sends its features before acking this buffer, so once the
+   * ack is handled the writer knows whether it can pass fds */
+  fail_unless (gst_pad_push (srcpad,
+          gst_buffer_new_allocate (NULL, 1000, NULL)) == GST_FLOW_OK);
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+  gst_check_drop_buffers ();
+  wait_for_released_blocks ();
+
+  for (i = 0; i < FD_FILE_SIZE; i++)
+    data[i] = i % 251;
+  fd = g_file_open_tmp ("shm-fd-XXXXXX", &filename, NULL);
+  fail_unless (fd >= 0);
+  fail_unless (write (fd, data, FD_FILE_SIZE) == FD_FILE_SIZE);
+  g_unlink (filename);
+  g_free (filename);
+  fail_unless (fstat (fd, &st) == 0);
+
+  /* the memory takes ownership of the fd */
+  allocator = gst_fd_allocator_new ();
+  mem = gst_fd_allocator_alloc (allocator, fd, FD_FILE_SIZE,
+      GST_FD_MEMORY_FLAG_NONE);
+  gst_object_unref (allocator);
+  gst_memory_resize (mem, FD_BUFFER_OFFSET, FD_BUFFER_SIZE);
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, mem);
+  gst_mini_object_weak_ref (GST_MINI_OBJECT (buf), buffer_freed, &freed);
+
+  fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+  fail_unless (g_list_length (buffers) == 1);
+
+  buf = buffers->data;
+  fail_unless (gst_buffer_get_size (buf) == FD_BUFFER_SIZE);
+  fail_unless (gst_buffer_memcmp (buf, 0, data + FD_BUFFER_OFFSET,
+          FD_BUFFER_SIZE) == 0);
+
+  mem = gst_buffer_peek_memory (buf, 0);
+  if (sink_fd_passing && src_fd_passing) {
+    /* the same file, not a copy in the shared memory area */
+    fail_unless (gst_buffer_n_memory (buf) == 1);
+    fail_unless (gst_is_fd_memory (mem));
+    fail_unless (fstat (gst_fd_memory_get_fd (mem), &received_st) == 0);
+    fail_unless (st.st_dev == received_st.st_dev);
+    fail_unless (st.st_ino == received_st.st_ino);
+  } else {
+    fail_if (gst_is_fd_memory (mem));
+  }
+
+  /* once the reader is done with it, the writer lets go of the buffer */
+  gst_check_drop_buffers ();
+  while (!g_atomic_int_get (&freed))
+    g_usleep (1000);
+
+  teardown_shm ();
+}
+
+GST_START_TEST (test_shm_fd_passing)
+{
+  push_fd_buffer (TRUE, TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_fd_passing_fallback)
+{
+  /* both sides have to enable it, otherwise the data is copied */
+  push_fd_buffer (TRUE, FALSE);
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -179,6 +410,10 @@ shm_suite (void)
   tcase_add_checked_fixture (tc, setup_shm, NULL);
   tcase_add_test (tc, test_shm_sysmem_alloc);
   tcase_add_test (tc, test_shm_alloc);
+  tcase_add_test (tc, test_shm_slab);
+  tcase_add_test (tc, test_shm_ring);
+  tcase_add_test (tc, test_shm_fd_passing);
+  tcase_add_test (tc, test_shm_fd_passing_fallback);
   suite_add_tcase (s, tc);
 
   return s;
@@ -0,0 +1,148 @@
+/* GStreamer unit test for spectrascope
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+/* the bar drawing is internal to the plugin */
+#include "../../gst/audiovisualizers/gstspectrabars.c"
+
+#define MAX_WIDTH 141
+#define MAX_HEIGHT 37
+
+/* the byte wise saturating add the scopes used before */
+static guint32
+ref_add_pixel (guint32 p, guint32 c)
+{
+  guint32 res = 0;
+  gint i;
+
+  for (i = 0; i < 32; i += 8)
+    res |= MIN (((p >> i) & 0xff) + ((c >> i) & 0xff), 255) << i;
+
+  return res;
+}
+
+/* The branch-free add must saturate every byte on its own, whatever the
+ * other bytes are */
+GST_START_TEST (test_add_pixel)
+{
+  guint a, b, i;
+
+  g_random_set_seed (29);
+  for (a = 0; a < 256; a++) {
+    for (b = 0; b < 256; b++) {
+      for (i = 0; i < 32; i += 8) {
+        guint32 rest_p = g_random_int () & ~(0xffu << i);
+        guint32 rest_c = g_random_int () & ~(0xffu << i);
+        guint32 p = rest_p | (a << i), c = rest_c | (b << i);
+        guint32 res = p;
+
+        add_pixel (&res, c);
+        fail_unless_equals_int (res, ref_add_pixel (p, c));
+      }
+    }
+  }
+}
+
+GST_END_TEST;
+
+/* the column by column drawing of the bars, as before */
+static void
+ref_draw_bars (guint32 * vdata, gint stride, const guint * tops, guint w,
+    guint h)
+{
+  guint x, l, off;
+
+  stride /= sizeof (guint32);
+  for (x = 0; x < w; x++) {
+    off = tops[x] * stride + x;
+    vdata[off] = 0x00FFFFFF;
+    for (l = tops[x]; l < h; l++) {
+      off += stride;
+      vdata[off] = ref_add_pixel (vdata[off], 0x007F7F7F);
+    }
+    vdata[off] = ref_add_pixel (vdata[off], 0x007F7F7F);
+  }
+}
+
+/* Drawing the rows with SSE2/NEON must give the same frame as drawing each
+ * bar from its top down, on top of whatever the frame contained */
+GST_START_TEST (test_draw_bars_simd)
+{
+  guint32 *frame, *ref;
+  guint tops[MAX_WIDTH];
+  gint stride = (MAX_WIDTH + 3) * sizeof (guint32);
+  guint w, h, x, run;
+  gsize size = (MAX_HEIGHT + 1) * stride;
+
+  frame = g_malloc (size);
+  ref = g_malloc (size);
+
+  g_random_set_seed (31);
+  for (run = 0; run < 4; run++) {
+    for (h = 0; h < MAX_HEIGHT; h += h < 5 ? 1 : 7) {
+      for (w = 1; w <= MAX_WIDTH; w += w < 20 ? 1 : 11) {
+        for (x = 0; x < size / sizeof (guint32); x++) {
+          /* a faded previous frame, or bright enough to saturate */
+          frame[x] = run < 2 ? g_random_int () & 0x003F3F3F :
+              g_random_int ();
+        }
+        memcpy (ref, frame, size);
+
+        /* all bars at the bottom, at the top, or anywhere */
+        for (x = 0; x < w; x++) {
+          if (run == 0)
+            tops[x] = h;
+          else if (run == 1)
+            tops[x] = 0;
+          else
+            tops[x] = g_random_int_range (0, h + 1);
+        }
+
+        gst_spectra_scope_draw_bars (frame, stride, tops, w, h);
+        ref_draw_bars (ref, stride, tops, w, h);
+        fail_unless (memcmp (frame, ref, size) == 0,
+            "%ux%u, run %u differs", w, h + 1, run);
+      }
+    }
+  }
+
+  g_free (frame);
+  g_free (ref);
+}
+
+GST_END_TEST;
+
+static Suite *
+spectrascope_suite (void)
+{
+  Suite *s = suite_create ("spectrascope");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_add_pixel);
+  tcase_add_test (tc_chain, test_draw_bars_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (spectrascope);
@@ -30,6 +30,7 @@
 #include <gst/check/gstcheck.h>
 
 #include <gst/check/gstharness.h>
+#include <gst/rtp/gstrtpbuffer.h>
 
 GST_START_TEST (test_create_and_unref)
 {
@@ -207,6 +208,85 @@ GST_START_TEST (test_roc)
 
 GST_END_TEST;
 
+static GstBufferList *
+create_rtp_buffer_list (guint n_buffers)
+{
+  GstBufferList *list = gst_buffer_list_new ();
+  guint i;
+
+  for (i = 0; i < n_buffers; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    GstBuffer *buf = gst_rtp_buffer_new_allocate (160, 0, 0);
+
+    gst_rtp_buffer_map (buf, GST_MAP_WRITE, &rtp);
+    gst_rtp_buffer_set_payload_type (&rtp, 8);
+    gst_rtp_buffer_set_ssrc (&rtp, 1356955624);
+    gst_rtp_buffer_set_seq (&rtp, i);
+    memset (gst_rtp_buffer_get_payload (&rtp), i, 160);
+    gst_rtp_buffer_unmap (&rtp);
+
+    gst_buffer_list_add (list, buf);
+  }
+
+  return list;
+}
+
+GST_START_TEST (test_buffer_list)
+{
+  GstHarness *enc_h, *dec_h;
+  GstBufferList *list;
+  GstCaps *caps;
+  guint i;
+
+  enc_h = gst_harness_new_with_padnames ("srtpenc", "rtp_sink_0",
+      "rtp_src_0");
+  gst_util_set_object_arg (G_OBJECT (enc_h->element), "key",
+      "012345678901234567890123456789012345678901234567890123456789");
+  gst_harness_set_src_caps_str (enc_h,
+      "application/x-rtp, payload=(int)8, ssrc=(uint)1356955624");
+
+  dec_h = gst_harness_new_with_padnames ("srtpdec", "rtp_sink", "rtp_src");
+  caps = request_key ();
+  gst_harness_set_src_caps (dec_h, caps);
+
+  /* the protected packets are larger than the input */
+  list = create_rtp_buffer_list (10);
+  fail_unless_equals_int (gst_pad_push_list (enc_h->srcpad, list),
+      GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_in_queue (enc_h), 10);
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = gst_harness_pull (enc_h);
+
+    fail_unless (gst_buffer_get_size (buf) > 12 + 160);
+    gst_buffer_list_add (list, buf);
+  }
+
+  /* and are decoded back in order */
+  fail_unless_equals_int (gst_pad_push_list (dec_h->srcpad, list),
+      GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_in_queue (dec_h), 10);
+
+  for (i = 0; i < 10; i++) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    GstBuffer *buf = gst_harness_pull (dec_h);
+
+    fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+    fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtp), i);
+    fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp), 160);
+    fail_unless_equals_int (((guint8 *) gst_rtp_buffer_get_payload (&rtp))[0],
+        i);
+    gst_rtp_buffer_unmap (&rtp);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (enc_h);
+  gst_harness_teardown (dec_h);
+}
+
+GST_END_TEST;
+
 static Suite *
 srtp_suite (void)
 {
@@ -218,6 +298,7 @@ srtp_suite (void)
   tcase_add_test (tc_chain, test_create_and_unref);
   tcase_add_test (tc_chain, test_play);
   tcase_add_test (tc_chain, test_roc);
+  tcase_add_test (tc_chain, test_buffer_list);
 
   return s;
 }
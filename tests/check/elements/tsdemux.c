@@ -0,0 +1,444 @@
+/* GStreamer
+ *
+ * unit tests for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#define H264_CAPS "video/x-h264, stream-format = (string) byte-stream, " \
+    "alignment = (string) au"
+#define TS_CAPS "video/mpegts, systemstream = (boolean) true, " \
+    "packetsize = (int) 188"
+
+/* from a single TS packet to more than a buffer can hold memories */
+static const gsize frame_sizes[] = { 100, 2000, 5000, 150, 3000, 700 };
+
+#define N_FRAMES G_N_ELEMENTS (frame_sizes)
+
+static guint8
+frame_byte (guint frame, gsize offset)
+{
+  return (frame * 31 + offset) & 0xff;
+}
+
+/* Mux @n_frames frames, of frame_sizes in turn, with mpegtsmux and return
+ * the stream as one buffer */
+static GstBuffer *
+create_ts_frames (guint n_frames)
+{
+  GstHarness *h;
+  GstBuffer *ts, *buf;
+  GstEvent *event;
+  guint i;
+
+  h = gst_harness_new_with_padnames ("mpegtsmux", "sink_%d", "src");
+  gst_harness_set_src_caps_str (h, H264_CAPS);
+
+  for (i = 0; i < n_frames; i++) {
+    GstMapInfo map;
+    gsize j;
+
+    buf = gst_buffer_new_allocate (NULL, frame_sizes[i % N_FRAMES], NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    for (j = 0; j < map.size; j++)
+      map.data[j] = frame_byte (i, j);
+    gst_buffer_unmap (buf, &map);
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) = i * 40 * GST_MSECOND;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  /* everything was output once the EOS is */
+  while ((event = gst_harness_pull_event (h))) {
+    gboolean eos = GST_EVENT_TYPE (event) == GST_EVENT_EOS;
+
+    gst_event_unref (event);
+    if (eos)
+      break;
+  }
+
+  ts = gst_buffer_new ();
+  while ((buf = gst_harness_try_pull (h)))
+    ts = gst_buffer_append (ts, buf);
+
+  gst_harness_teardown (h);
+
+  /* one memory, like a big read from a file */
+  buf = gst_buffer_copy_deep (ts);
+  gst_buffer_unref (ts);
+  fail_unless (gst_buffer_n_memory (buf) == 1);
+
+  return buf;
+}
+
+static GstBuffer *
+create_ts (void)
+{
+  return create_ts_frames (N_FRAMES);
+}
+
+static GstPadProbeReturn
+demuxed_probe (GstPad * pad, GstPadProbeInfo * info, GList ** demuxed)
+{
+  /* a PES is pushed as one buffer */
+  fail_unless (info->type & GST_PAD_PROBE_TYPE_BUFFER);
+
+  *demuxed = g_list_append (*demuxed,
+      gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info)));
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+demux_pad_added (GstElement * demux, GstPad * pad, GList ** demuxed)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_bin_get_by_name (GST_BIN (GST_ELEMENT_PARENT (demux)), "sink");
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_BUFFER_LIST, (GstPadProbeCallback) demuxed_probe,
+      demuxed, NULL);
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+
+  gst_object_unref (sinkpad);
+  gst_object_unref (sink);
+}
+
+static GList *
+demux_ts (GstBuffer * ts, gboolean zero_copy, gboolean threaded_push)
+{
+  GstElement *pipeline, *src, *demux;
+  GstFlowReturn ret;
+  GstMessage *msg;
+  GstBus *bus;
+  GList *demuxed = NULL;
+  gsize offset, size = gst_buffer_get_size (ts);
+
+  pipeline = gst_parse_launch ("appsrc name=src format=bytes caps=\""
+      TS_CAPS "\" ! tsdemux name=demux fakesink name=sink sync=false "
+      "async=false", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_object_set (demux, "zero-copy", zero_copy, "threaded-push",
+      threaded_push, NULL);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (demux_pad_added),
+      &demuxed);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  /* in chunks of 64 packets, sharing the memory of the stream */
+  for (offset = 0; offset < size; offset += 188 * 64) {
+    GstBuffer *buf = gst_buffer_copy_region (ts, GST_BUFFER_COPY_MEMORY,
+        offset, MIN (188 * 64, size - offset));
+
+    g_signal_emit_by_name (src, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+    fail_unless_equals_int (ret, GST_FLOW_OK);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", &ret);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (demux);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+
+  return demuxed;
+}
+
+static void
+check_demuxed (GList * demuxed, gboolean zero_copy)
+{
+  GstClockTime first_pts = GST_CLOCK_TIME_NONE;
+  GList *l;
+  guint i;
+
+  fail_unless_equals_int (g_list_length (demuxed), N_FRAMES);
+
+  for (l = demuxed, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+    GstMapInfo map;
+    gsize j;
+
+    fail_unless (GST_BUFFER_PTS_IS_VALID (buf));
+    if (i == 0)
+      first_pts = GST_BUFFER_PTS (buf);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf) - first_pts,
+        i * 40 * GST_MSECOND);
+
+    /* the payloads of the TS packets are kept as they are when they fit in
+     * the memories of a buffer */
+    if (zero_copy && frame_sizes[i] > 184 &&
+        frame_sizes[i] / 184 < gst_buffer_get_max_memory ())
+      fail_unless (gst_buffer_n_memory (buf) > 1);
+    else if (!zero_copy)
+      fail_unless_equals_int (gst_buffer_n_memory (buf), 1);
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, frame_sizes[i]);
+    for (j = 0; j < map.size; j++)
+      fail_unless_equals_int (map.data[j], frame_byte (i, j));
+    gst_buffer_unmap (buf, &map);
+  }
+}
+
+GST_START_TEST (test_zero_copy)
+{
+  GstBuffer *ts = create_ts ();
+  GList *demuxed;
+
+  demuxed = demux_ts (ts, FALSE, FALSE);
+  check_demuxed (demuxed, FALSE);
+  g_list_free_full (demuxed, (GDestroyNotify) gst_buffer_unref);
+
+  demuxed = demux_ts (ts, TRUE, FALSE);
+  check_demuxed (demuxed, TRUE);
+  g_list_free_full (demuxed, (GDestroyNotify) gst_buffer_unref);
+
+  gst_buffer_unref (ts);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threaded_push)
+{
+  GstBuffer *ts = create_ts ();
+  GList *demuxed;
+
+  demuxed = demux_ts (ts, FALSE, TRUE);
+  check_demuxed (demuxed, FALSE);
+  g_list_free_full (demuxed, (GDestroyNotify) gst_buffer_unref);
+
+  demuxed = demux_ts (ts, TRUE, TRUE);
+  check_demuxed (demuxed, TRUE);
+  g_list_free_full (demuxed, (GDestroyNotify) gst_buffer_unref);
+
+  gst_buffer_unref (ts);
+}
+
+GST_END_TEST;
+
+static GstStaticPadTemplate ts_src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS (TS_CAPS));
+
+static gint eos_received;
+
+static GstFlowReturn
+eos_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  g_atomic_int_inc (&eos_received);
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_EOS;
+}
+
+static void
+link_eos_pad (GstElement * demux, GstPad * pad, GstPad * sinkpad)
+{
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+}
+
+/* The flow returned downstream to the pad tasks gets back upstream */
+GST_START_TEST (test_threaded_push_flow)
+{
+  GstBuffer *ts = create_ts_frames (100);
+  GstElement *demux;
+  GstPad *srcpad, *sinkpad;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstCaps *caps;
+  gsize offset, size = gst_buffer_get_size (ts);
+
+  demux = gst_check_setup_element ("tsdemux");
+  g_object_set (demux, "threaded-push", TRUE, NULL);
+
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sinkpad, eos_chain);
+  gst_pad_set_active (sinkpad, TRUE);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (link_eos_pad), sinkpad);
+
+  srcpad = gst_check_setup_src_pad (demux, &ts_src_template);
+  gst_pad_set_active (srcpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (demux, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  caps = gst_caps_from_string (TS_CAPS);
+  gst_check_setup_events (srcpad, demux, caps, GST_FORMAT_BYTES);
+  gst_caps_unref (caps);
+
+  g_atomic_int_set (&eos_received, 0);
+  for (offset = 0; offset < size && ret == GST_FLOW_OK; offset += 188 * 8) {
+    ret = gst_pad_push (srcpad, gst_buffer_copy_region (ts,
+            GST_BUFFER_COPY_MEMORY, offset, MIN (188 * 8, size - offset)));
+  }
+
+  /* well before the end of the stream */
+  fail_unless_equals_int (ret, GST_FLOW_EOS);
+  fail_unless (offset < size);
+  fail_unless (g_atomic_int_get (&eos_received) > 0);
+
+  gst_element_set_state (demux, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_check_teardown_src_pad (demux);
+  gst_check_teardown_element (demux);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (sinkpad);
+  gst_buffer_unref (ts);
+}
+
+GST_END_TEST;
+
+/* Play a file in pull mode, with the seek index at @index_location */
+static void
+demux_file (const gchar * location, const gchar * index_location)
+{
+  GstElement *pipeline, *src, *demux;
+  GstMessage *msg;
+  GstBus *bus;
+  GList *demuxed = NULL;
+
+  pipeline = gst_parse_launch ("filesrc name=src ! tsdemux name=demux "
+      "fakesink name=sink sync=false async=false", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "location", location, NULL);
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_object_set (demux, "index-location", index_location, NULL);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (demux_pad_added),
+      &demuxed);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  /* the index is written when going from PAUSED to READY */
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (demux);
+  gst_object_unref (src);
+  gst_object_unref (pipeline);
+
+  fail_unless_equals_int (g_list_length (demuxed), N_FRAMES);
+  g_list_free_full (demuxed, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* offset of the stream checksum in the index header */
+#define INDEX_CHECKSUM_OFFSET 16
+#define INDEX_CHECKSUM_SIZE 20
+
+GST_START_TEST (test_index)
+{
+  GstBuffer *ts = create_ts ();
+  gchar *location, *index_location, *index, *marked, *contents;
+  gsize index_length, length;
+  GstMapInfo map;
+  guint8 *data;
+  gint fd;
+
+  fd = g_file_open_tmp ("tsdemux-XXXXXX.ts", &location, NULL);
+  fail_unless (fd != -1);
+  g_close (fd, NULL);
+  index_location = g_strconcat (location, ".idx", NULL);
+
+  gst_buffer_map (ts, &map, GST_MAP_READ);
+  data = g_memdup (map.data, map.size);
+  fail_unless (g_file_set_contents (location, (const gchar *) data, map.size,
+          NULL));
+
+  /* saved on the first run */
+  demux_file (location, index_location);
+  fail_unless (g_file_get_contents (index_location, &index, &index_length,
+          NULL));
+  fail_unless (index_length > INDEX_CHECKSUM_OFFSET + INDEX_CHECKSUM_SIZE);
+  fail_unless (memcmp (index, "TSIX", 4) == 0);
+
+  /* loaded and left alone on the second: trailing data, which isn't parsed,
+   * is still there afterwards */
+  marked = g_malloc (index_length + 4);
+  memcpy (marked, index, index_length);
+  memcpy (marked + index_length, "MARK", 4);
+  fail_unless (g_file_set_contents (index_location, marked, index_length + 4,
+          NULL));
+  demux_file (location, index_location);
+  fail_unless (g_file_get_contents (index_location, &contents, &length,
+          NULL));
+  fail_unless_equals_int (length, index_length + 4);
+  fail_unless (memcmp (contents, marked, length) == 0);
+  g_free (contents);
+
+  /* same size, different content: rejected and rewritten */
+  data[map.size - 1] ^= 0xff;
+  fail_unless (g_file_set_contents (location, (const gchar *) data, map.size,
+          NULL));
+  demux_file (location, index_location);
+  fail_unless (g_file_get_contents (index_location, &contents, &length,
+          NULL));
+  fail_unless (length > INDEX_CHECKSUM_OFFSET + INDEX_CHECKSUM_SIZE);
+  fail_if (memcmp (contents + INDEX_CHECKSUM_OFFSET,
+          index + INDEX_CHECKSUM_OFFSET, INDEX_CHECKSUM_SIZE) == 0);
+  g_free (contents);
+
+  g_unlink (index_location);
+  g_unlink (location);
+  g_free (marked);
+  g_free (index);
+  g_free (data);
+  g_free (index_location);
+  g_free (location);
+  gst_buffer_unmap (ts, &map);
+  gst_buffer_unref (ts);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_zero_copy);
+  tcase_add_test (tc_chain, test_threaded_push);
+  tcase_add_test (tc_chain, test_threaded_push_flow);
+  tcase_add_test (tc_chain, test_index);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux);
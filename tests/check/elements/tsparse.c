@@ -0,0 +1,369 @@
+/* GStreamer
+ *
+ * unit tests for tsparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <string.h>
+
+#define TS_CAPS "video/mpegts, systemstream = (boolean) true"
+
+/* PAT with programs 0x0000 (NIT on 0x30) and 0x0001 (PMT on 0x31) */
+static const guint8 pat_section[] = {
+  0x00, 0xB0, 0x11, 0x00, 0x00, 0xc1, 0x00,
+  0x00, 0x00, 0x00, 0xe0, 0x30, 0x00, 0x01,
+  0xe0, 0x31, 0x98, 0xdf, 0x37, 0xc4
+};
+
+/* PMT of program 0x0001 with a H.264 stream on PID 0x100 */
+static const guint8 pmt_section[] = {
+  0x02, 0xB0, 0x12, 0x00, 0x01, 0xc1, 0x00,
+  0x00, 0xe1, 0x00, 0xf0, 0x00, 0x1b, 0xe1,
+  0x00, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static void
+write_crc (guint8 * section, gsize size)
+{
+  guint32 crc = 0xffffffff;
+  gsize i;
+  guint j;
+
+  for (i = 0; i < size - 4; i++) {
+    for (j = 0; j < 8; j++) {
+      gboolean bit = ((crc >> 31) ^ (section[i] >> (7 - j))) & 1;
+
+      crc <<= 1;
+      if (bit)
+        crc ^= 0x04c11db7;
+    }
+  }
+
+  GST_WRITE_UINT32_BE (section + size - 4, crc);
+}
+
+/* Write a TS packet with the 4 bytes prefix of M2TS or the 16 bytes suffix
+ * of DVB-ASI/FEC depending on packet_size. The PAT is sent on PID 0, the
+ * PMT on PID 0x31, all other PIDs get empty (stuffing) payloads */
+static void
+write_packet (guint8 * data, guint packet_size, guint16 pid, guint8 cc)
+{
+  const guint8 *section = NULL;
+  gsize section_size = 0;
+
+  guint8 *packet = data;
+
+  memset (data, 0xff, packet_size);
+  if (packet_size == 192) {
+    memset (data, 0x00, 4);
+    packet += 4;
+  }
+
+  if (pid == 0) {
+    section = pat_section;
+    section_size = sizeof (pat_section);
+  } else if (pid == 0x31) {
+    section = pmt_section;
+    section_size = sizeof (pmt_section);
+  }
+
+  packet[0] = 0x47;
+  packet[1] = (section ? 0x40 : 0x00) | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = 0x10 | (cc & 0x0f);
+  if (section) {
+    packet[4] = 0x00;
+    memcpy (packet + 5, section, section_size);
+    if (section == pmt_section)
+      write_crc (packet + 5, section_size);
+  }
+}
+
+/* A few null packets to lock on the packet size, followed by a corrupted
+ * region and the PAT packets.
+ *
+ * The corrupted region has a sync byte density much higher than real data,
+ * so that the scanner keeps hitting (and rejecting) candidates. They are only
+ * placed at multiples of 7, which none of the packet sizes are, so they can
+ * never line up into a fake sync */
+static GstBuffer *
+create_corrupted_stream (gsize garbage_size, guint packet_size,
+    guint nb_packets)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  GRand *rand;
+  guint8 *data;
+  gsize i;
+
+  buf = gst_buffer_new_allocate (NULL,
+      garbage_size + packet_size * (nb_packets + 8), NULL);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+  data = map.data;
+
+  for (i = 0; i < 8; i++, data += packet_size)
+    write_packet (data, packet_size, 0x1fff, i);
+
+  rand = g_rand_new_with_seed (0x47);
+  for (i = 0; i < garbage_size; i++) {
+    if (i % 7 == 0 && g_rand_boolean (rand)) {
+      data[i] = 0x47;
+    } else {
+      data[i] = g_rand_int_range (rand, 0, 255);
+      if (data[i] == 0x47)
+        data[i] = 0xff;
+    }
+  }
+  g_rand_free (rand);
+  data += garbage_size;
+
+  for (i = 0; i < nb_packets; i++, data += packet_size)
+    write_packet (data, packet_size, 0, i);
+
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+static gboolean
+bus_has_pat (GstBus * bus)
+{
+  GstMessage *msg;
+  gboolean found = FALSE;
+
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+
+    if (s && gst_structure_has_name (s, "pat"))
+      found = TRUE;
+    gst_message_unref (msg);
+  }
+
+  return found;
+}
+
+static void
+check_resync (guint packet_size, gsize garbage_size)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstBuffer *buf;
+  gint64 start, elapsed;
+
+  h = gst_harness_new_with_padnames ("tsparse", "sink", "src");
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+
+  buf = create_corrupted_stream (garbage_size, packet_size, 32);
+
+  start = g_get_monotonic_time ();
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  elapsed = g_get_monotonic_time () - start;
+
+  GST_INFO ("packet size %u: scanned %" G_GSIZE_FORMAT " bytes of garbage "
+      "in %" G_GINT64_FORMAT " us (%.1f MB/s)", packet_size, garbage_size,
+      elapsed, elapsed ? (gdouble) garbage_size / elapsed : 0.0);
+
+  fail_unless (bus_has_pat (bus));
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_START_TEST (test_resync_188)
+{
+  check_resync (188, 64 * 1024 + 17);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_resync_192)
+{
+  check_resync (192, 64 * 1024 + 3);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_resync_204)
+{
+  check_resync (204, 64 * 1024 + 101);
+}
+
+GST_END_TEST;
+
+/* Not a correctness test as such, but the timings logged at INFO level
+ * give the resync throughput on a large corrupted capture */
+GST_START_TEST (test_resync_benchmark)
+{
+  check_resync (188, 8 * 1024 * 1024 + 5);
+}
+
+GST_END_TEST;
+
+/* Runs @input through tsparse using the sync byte scanner @scanner (the
+ * default one if NULL or not supported by the CPU) and returns the output */
+static GstBuffer *
+parse_with_scanner (const gchar * scanner, GstBuffer * input)
+{
+  GstHarness *h;
+  GstBuffer *output;
+
+  /* read when the packetizer is created */
+  if (scanner)
+    g_setenv ("GST_MPEGTS_SCAN_SYNC", scanner, TRUE);
+  h = gst_harness_new_with_padnames ("tsparse", "sink", "src");
+  g_unsetenv ("GST_MPEGTS_SCAN_SYNC");
+
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (input)),
+      GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  output = gst_harness_take_all_data_as_buffer (h);
+  gst_harness_teardown (h);
+
+  return output;
+}
+
+GST_START_TEST (test_scan_sync_implementations)
+{
+  static const gchar *scanners[] = { "sse2", "avx2", "neon", NULL };
+  static const guint packet_sizes[] = { 188, 192, 204 };
+  const gsize garbage_size = 64 * 1024 + 17;
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (packet_sizes); i++) {
+    GstBuffer *input, *expected;
+    GstMapInfo map;
+    GRand *rand;
+    gsize k;
+
+    input = create_corrupted_stream (garbage_size, packet_sizes[i], 32);
+
+    /* also sync bytes at any offset, some of which line up into fake
+     * syncs, so that where each candidate is accepted matters */
+    fail_unless (gst_buffer_map (input, &map, GST_MAP_WRITE));
+    rand = g_rand_new_with_seed (packet_sizes[i]);
+    for (k = 8 * packet_sizes[i]; k < 8 * packet_sizes[i] + garbage_size;
+        k++) {
+      if (g_rand_int_range (rand, 0, 4) == 0)
+        map.data[k] = 0x47;
+    }
+    g_rand_free (rand);
+    gst_buffer_unmap (input, &map);
+
+    /* the portable fallback is the reference */
+    expected = parse_with_scanner ("swar", input);
+    fail_unless (gst_buffer_get_size (expected) > 0);
+    fail_unless (gst_buffer_map (expected, &map, GST_MAP_READ));
+
+    for (j = 0; j < G_N_ELEMENTS (scanners); j++) {
+      GstBuffer *output = parse_with_scanner (scanners[j], input);
+
+      GST_INFO ("packet size %u, scanner %s", packet_sizes[i],
+          GST_STR_NULL (scanners[j]));
+      fail_unless_equals_int (gst_buffer_get_size (output), map.size);
+      fail_unless (gst_buffer_memcmp (output, 0, map.data, map.size) == 0);
+      gst_buffer_unref (output);
+    }
+
+    gst_buffer_unmap (expected, &map);
+    gst_buffer_unref (expected);
+    gst_buffer_unref (input);
+  }
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+count_buffer_lists (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint *nb_lists = user_data;
+  GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+
+  fail_unless_equals_int (gst_buffer_list_length (list), 7);
+  (*nb_lists)++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (test_program_buffer_list)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GstMapInfo map;
+  GstPad *pad;
+  guint8 *data;
+  guint i, nb_lists = 0;
+
+  h = gst_harness_new_with_padnames ("tsparse", "sink", "program_1");
+  g_object_set (h->element, "buffer-list-size", 7, NULL);
+  gst_harness_set_src_caps_str (h, TS_CAPS);
+
+  pad = gst_element_get_static_pad (h->element, "program_1");
+  fail_unless (pad != NULL);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER_LIST, count_buffer_lists,
+      &nb_lists, NULL);
+  gst_object_unref (pad);
+
+  /* Null packets to lock on the packet size, the PAT and the PMT, and 19
+   * packets of the program stream: 21 packets on the program pad */
+  buf = gst_buffer_new_allocate (NULL, 188 * 29, NULL);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+  data = map.data;
+  for (i = 0; i < 8; i++, data += 188)
+    write_packet (data, 188, 0x1fff, i);
+  write_packet (data, 188, 0, 0);
+  data += 188;
+  write_packet (data, 188, 0x31, 0);
+  data += 188;
+  for (i = 0; i < 19; i++, data += 188)
+    write_packet (data, 188, 0x100, i);
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  fail_unless_equals_int (nb_lists, 3);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 21);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsparse_suite (void)
+{
+  Suite *s = suite_create ("tsparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_resync_188);
+  tcase_add_test (tc_chain, test_resync_192);
+  tcase_add_test (tc_chain, test_resync_204);
+  tcase_add_test (tc_chain, test_resync_benchmark);
+  tcase_add_test (tc_chain, test_scan_sync_implementations);
+  tcase_add_test (tc_chain, test_program_buffer_list);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsparse);
@@ -0,0 +1,164 @@
+/* GStreamer unit test for videodiff
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+
+#define N_FRAMES 4
+#define THRESHOLD 10
+
+/* Random frames, the luma of each one close to the one before or far from
+ * it, so that there are samples on both sides of the threshold */
+static GstBuffer *
+create_frame (GstVideoInfo * info, GstBuffer * prev)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, info->size, NULL);
+  GstVideoFrame frame, prev_frame;
+  gint i, x, y;
+
+  fail_unless (gst_video_frame_map (&frame, info, buf, GST_MAP_WRITE));
+  if (prev)
+    fail_unless (gst_video_frame_map (&prev_frame, info, prev, GST_MAP_READ));
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (&frame); i++) {
+    guint8 *data = GST_VIDEO_FRAME_COMP_DATA (&frame, i);
+    gint stride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, i);
+
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&frame, i); y++) {
+      for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&frame, i); x++) {
+        gint v = g_random_int_range (0, 256);
+
+        if (prev && i == 0 && g_random_boolean ()) {
+          guint8 *old = GST_VIDEO_FRAME_COMP_DATA (&prev_frame, 0);
+
+          v = CLAMP (old[y * GST_VIDEO_FRAME_COMP_STRIDE (&prev_frame, 0) + x]
+              + g_random_int_range (-THRESHOLD - 2, THRESHOLD + 3), 0, 255);
+        }
+        data[y * stride + x] = v;
+      }
+    }
+  }
+
+  if (prev)
+    gst_video_frame_unmap (&prev_frame);
+  gst_video_frame_unmap (&frame);
+
+  return buf;
+}
+
+/* The marking of the samples that changed by more than the threshold one
+ * after the other, the chroma and the first frame are copied */
+static void
+check_frame (GstVideoInfo * info, GstBuffer * out, GstBuffer * in,
+    GstBuffer * prev)
+{
+  GstVideoFrame oframe, iframe, pframe;
+  gint i, x, y;
+
+  fail_unless (gst_video_frame_map (&oframe, info, out, GST_MAP_READ));
+  fail_unless (gst_video_frame_map (&iframe, info, in, GST_MAP_READ));
+  if (prev)
+    fail_unless (gst_video_frame_map (&pframe, info, prev, GST_MAP_READ));
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_COMPONENTS (&oframe); i++) {
+    for (y = 0; y < GST_VIDEO_FRAME_COMP_HEIGHT (&oframe, i); y++) {
+      const guint8 *o = (const guint8 *) GST_VIDEO_FRAME_COMP_DATA (&oframe,
+          i) + y * GST_VIDEO_FRAME_COMP_STRIDE (&oframe, i);
+      const guint8 *s2 = (const guint8 *) GST_VIDEO_FRAME_COMP_DATA (&iframe,
+          i) + y * GST_VIDEO_FRAME_COMP_STRIDE (&iframe, i);
+
+      for (x = 0; x < GST_VIDEO_FRAME_COMP_WIDTH (&oframe, i); x++) {
+        gint expected = s2[x];
+
+        if (prev && i == 0) {
+          const guint8 *s1 =
+              (const guint8 *) GST_VIDEO_FRAME_COMP_DATA (&pframe, 0) +
+              y * GST_VIDEO_FRAME_COMP_STRIDE (&pframe, 0);
+
+          if (s2[x] < s1[x] - THRESHOLD || s2[x] > s1[x] + THRESHOLD)
+            expected = ((x + y) & 0x4) ? 16 : 240;
+        }
+        fail_unless_equals_int (o[x], expected);
+      }
+    }
+  }
+
+  if (prev)
+    gst_video_frame_unmap (&pframe);
+  gst_video_frame_unmap (&iframe);
+  gst_video_frame_unmap (&oframe);
+}
+
+/* The SSE2 luma rows must mark the same samples with the same stripes as
+ * the per sample code, for every remainder of the width */
+GST_START_TEST (test_diff_simd)
+{
+  gint sizes[][2] = { {2, 2}, {16, 4}, {18, 5}, {46, 9}, {320, 243} };
+  guint i, n;
+
+  g_random_set_seed (67);
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    GstHarness *h = gst_harness_new ("videodiff");
+    GstBuffer *prev = NULL;
+    GstVideoInfo info;
+    GstCaps *caps;
+
+    gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, sizes[i][0],
+        sizes[i][1]);
+    caps = gst_video_info_to_caps (&info);
+    gst_harness_set_src_caps (h, caps);
+
+    for (n = 0; n < N_FRAMES; n++) {
+      GstBuffer *in = create_frame (&info, prev), *out;
+
+      fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (in)),
+          GST_FLOW_OK);
+      out = gst_harness_pull (h);
+      check_frame (&info, out, in, prev);
+      gst_buffer_unref (out);
+
+      if (prev)
+        gst_buffer_unref (prev);
+      prev = in;
+    }
+
+    gst_buffer_unref (prev);
+    gst_harness_teardown (h);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+videodiff_suite (void)
+{
+  Suite *s = suite_create ("videodiff");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_diff_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (videodiff);
@@ -29,6 +29,11 @@
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstharness.h>
 #include <gst/webrtc/webrtc.h>
+#include <agent.h>
+#include <math.h>
+
+/* the estimator is internal to the plugin */
+#include "../../ext/webrtc/bitrateestimator.c"
 
 #define OPUS_RTP_CAPS(pt) "application/x-rtp,payload=" G_STRINGIFY(pt) ",encoding-name=OPUS,media=audio,clock-rate=48000"
 #define VP8_RTP_CAPS(pt) "application/x-rtp,payload=" G_STRINGIFY(pt) ",encoding-name=VP8,media=video,clock-rate=90000"
@@ -882,6 +887,176 @@ GST_START_TEST (test_payload_types)
 
 GST_END_TEST;
 
+/* Same as above but with the loss recovery defaults of webrtcbin applied to
+ * the transceivers it creates */
+GST_START_TEST (test_payload_types_defaults)
+{
+  struct test_webrtc *t;
+  struct validate_sdp offer = { on_sdp_media_payload_types, NULL };
+  GstWebRTCRTPTransceiver *trans;
+  GArray *transceivers;
+  GstWebRTCFECType fec_type;
+  gboolean do_nack;
+  guint fec_percentage;
+  GstHarness *h;
+
+  t = test_webrtc_new ();
+  t->on_negotiation_needed = NULL;
+  t->on_pad_added = _pad_added_fakesink;
+  g_object_set (t->webrtc1, "fec-type", GST_WEBRTC_FEC_TYPE_ULP_RED,
+      "do-nack", TRUE, "fec-percentage", 20, NULL);
+
+  h = gst_harness_new_with_element (t->webrtc1, "sink_0", NULL);
+  add_fake_audio_src_harness (h, 96);
+  t->harnesses = g_list_prepend (t->harnesses, h);
+
+  h = gst_harness_new_with_element (t->webrtc1, "sink_1", NULL);
+  add_fake_video_src_harness (h, 97);
+  t->harnesses = g_list_prepend (t->harnesses, h);
+
+  t->offer_data = &offer;
+  t->on_offer_created = validate_sdp;
+  t->on_ice_candidate = NULL;
+  t->on_answer_created = NULL;
+
+  g_signal_emit_by_name (t->webrtc1, "get-transceivers", &transceivers);
+  fail_unless_equals_int (transceivers->len, 2);
+  trans = g_array_index (transceivers, GstWebRTCRTPTransceiver *, 1);
+  g_object_get (trans, "fec-type", &fec_type, "do-nack", &do_nack,
+      "fec-percentage", &fec_percentage, NULL);
+  fail_unless_equals_int (fec_type, GST_WEBRTC_FEC_TYPE_ULP_RED);
+  fail_unless (do_nack);
+  fail_unless_equals_int (fec_percentage, 20);
+  g_array_unref (transceivers);
+
+  test_webrtc_create_offer (t, t->webrtc1);
+
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless_equals_int (STATE_ANSWER_CREATED, t->state);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
+static void
+on_sdp_ice_lite (struct test_webrtc *t, GstElement * element,
+    GstWebRTCSessionDescription * desc, gpointer user_data)
+{
+  gboolean expected = GPOINTER_TO_INT (user_data);
+  gboolean have_ice_lite = FALSE;
+  guint i;
+
+  for (i = 0; i < gst_sdp_message_attributes_len (desc->sdp); i++) {
+    const GstSDPAttribute *attr = gst_sdp_message_get_attribute (desc->sdp, i);
+
+    if (g_strcmp0 (attr->key, "ice-lite") == 0)
+      have_ice_lite = TRUE;
+  }
+
+  fail_unless_equals_int (have_ice_lite, expected);
+}
+
+GST_START_TEST (test_ice_lite)
+{
+  struct test_webrtc *t = create_audio_test ();
+  struct validate_sdp offer = { on_sdp_ice_lite, GINT_TO_POINTER (TRUE) };
+  struct validate_sdp answer = { on_sdp_ice_lite, GINT_TO_POINTER (FALSE) };
+  gboolean ice_lite;
+
+  g_object_set (t->webrtc1, "ice-lite", TRUE, NULL);
+  g_object_get (t->webrtc1, "ice-lite", &ice_lite, NULL);
+  fail_unless (ice_lite);
+
+  t->offer_data = &offer;
+  t->on_offer_created = validate_sdp;
+  t->answer_data = &answer;
+  t->on_answer_created = validate_sdp;
+  t->on_ice_candidate = NULL;
+
+  test_webrtc_create_offer (t, t->webrtc1);
+
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless_equals_int (STATE_ANSWER_CREATED, t->state);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
+static void
+on_sdp_media_simulcast (struct test_webrtc *t, GstElement * element,
+    GstWebRTCSessionDescription * desc, gpointer user_data)
+{
+  const GstSDPMedia *vmedia;
+  gboolean have_extmap = FALSE;
+  guint n_rids = 0;
+  const gchar *simulcast = NULL;
+  guint j;
+
+  fail_unless_equals_int (gst_sdp_message_medias_len (desc->sdp), 2);
+
+  vmedia = gst_sdp_message_get_media (desc->sdp, 1);
+
+  for (j = 0; j < gst_sdp_media_attributes_len (vmedia); j++) {
+    const GstSDPAttribute *attr = gst_sdp_media_get_attribute (vmedia, j);
+
+    if (!g_strcmp0 (attr->key, "extmap")) {
+      fail_unless_equals_string (attr->value,
+          "1 urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id");
+      have_extmap = TRUE;
+    } else if (!g_strcmp0 (attr->key, "rid")) {
+      fail_unless_equals_string (attr->value,
+          n_rids == 0 ? "hi send" : "lo send");
+      n_rids++;
+    } else if (!g_strcmp0 (attr->key, "simulcast")) {
+      simulcast = attr->value;
+    }
+  }
+
+  fail_unless (have_extmap);
+  fail_unless_equals_int (n_rids, 2);
+  fail_unless_equals_string (simulcast, "send hi;lo");
+
+  /* the audio transceiver has no simulcast layers */
+  fail_unless (gst_sdp_media_get_attribute_val (gst_sdp_message_get_media
+          (desc->sdp, 0), "simulcast") == NULL);
+}
+
+GST_START_TEST (test_simulcast_offer)
+{
+  struct test_webrtc *t = create_audio_video_test ();
+  struct validate_sdp offer = { on_sdp_media_simulcast, NULL };
+  const gchar *rids[] = { "hi", "lo", NULL };
+  GstWebRTCRTPTransceiver *trans;
+  GArray *transceivers;
+  GstPad *pad;
+
+  t->offer_data = &offer;
+  t->on_offer_created = validate_sdp;
+  t->on_ice_candidate = NULL;
+  t->on_answer_created = NULL;
+
+  g_signal_emit_by_name (t->webrtc1, "get-transceivers", &transceivers);
+  fail_unless_equals_int (transceivers->len, 2);
+  trans = g_array_index (transceivers, GstWebRTCRTPTransceiver *, 1);
+  g_object_set (trans, "rids", rids, NULL);
+  g_array_unref (transceivers);
+
+  /* only the advertised rids can be requested as layers */
+  pad = gst_element_get_request_pad (t->webrtc1, "sink_1_lo");
+  fail_unless (pad != NULL);
+  gst_element_release_request_pad (t->webrtc1, pad);
+  gst_object_unref (pad);
+  fail_unless (gst_element_get_request_pad (t->webrtc1, "sink_1_mid") == NULL);
+
+  test_webrtc_create_offer (t, t->webrtc1);
+
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless_equals_int (STATE_ANSWER_CREATED, t->state);
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 static void
 on_sdp_media_setup (struct test_webrtc *t, GstElement * element,
     GstWebRTCSessionDescription * desc, gpointer user_data)
@@ -1260,6 +1435,59 @@ GST_START_TEST (test_session_stats)
 
 GST_END_TEST;
 
+static gboolean
+_check_stats_type (GQuark field_id, const GValue * value, gpointer user_data)
+{
+  const GstStructure *s;
+  GstWebRTCStatsType type;
+
+  fail_unless (GST_VALUE_HOLDS_STRUCTURE (value));
+  s = gst_value_get_structure (value);
+  fail_unless (gst_structure_get (s, "type", GST_TYPE_WEBRTC_STATS_TYPE,
+          &type, NULL));
+  fail_unless_equals_int (type, GPOINTER_TO_INT (user_data));
+
+  return TRUE;
+}
+
+static void
+_on_peer_connection_stats (GstPromise * promise, gpointer user_data)
+{
+  struct test_webrtc *t = user_data;
+  const GstStructure *reply = gst_promise_get_reply (promise);
+
+  fail_unless (gst_structure_has_field (reply, "peer-connection-stats"));
+  gst_structure_foreach (reply, _check_stats_type,
+      GINT_TO_POINTER (GST_WEBRTC_STATS_PEER_CONNECTION));
+  test_webrtc_signal_state (t, STATE_CUSTOM);
+
+  gst_promise_unref (promise);
+}
+
+GST_START_TEST (test_session_stats_of_type)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  GstPromise *p;
+
+  t->on_offer_created = NULL;
+  t->on_answer_created = NULL;
+
+  test_webrtc_create_offer (t, t->webrtc1);
+
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless_equals_int (STATE_ANSWER_CREATED, t->state);
+
+  p = gst_promise_new_with_change_func (_on_peer_connection_stats, t, NULL);
+  g_signal_emit_by_name (t->webrtc1, "get-stats-of-type", NULL,
+      GST_WEBRTC_STATS_PEER_CONNECTION, p);
+
+  test_webrtc_wait_for_state_mask (t, 1 << STATE_CUSTOM);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_add_transceiver)
 {
   struct test_webrtc *t = test_webrtc_new ();
@@ -1403,6 +1631,254 @@ GST_START_TEST (test_recvonly_sendonly)
 
 GST_END_TEST;
 
+/* checks each transceiver has its own mline, with the mid of that media in
+ * the local description */
+static void
+_check_transceiver_mlines (GstElement * webrtc, guint n)
+{
+  GstWebRTCSessionDescription *desc = NULL;
+  GArray *transceivers;
+  gboolean *seen = g_new0 (gboolean, n);
+  guint i;
+
+  g_object_get (webrtc, "local-description", &desc, NULL);
+  fail_unless (desc != NULL);
+  fail_unless_equals_int (gst_sdp_message_medias_len (desc->sdp), n);
+
+  g_signal_emit_by_name (webrtc, "get-transceivers", &transceivers);
+  fail_unless (transceivers != NULL);
+  fail_unless_equals_int (transceivers->len, n);
+
+  for (i = 0; i < n; i++) {
+    GstWebRTCRTPTransceiver *trans =
+        g_array_index (transceivers, GstWebRTCRTPTransceiver *, i);
+    const GstSDPMedia *media;
+
+    fail_unless (trans->mline < n);
+    fail_if (seen[trans->mline]);
+    seen[trans->mline] = TRUE;
+
+    media = gst_sdp_message_get_media (desc->sdp, trans->mline);
+    fail_unless_equals_string (trans->mid,
+        gst_sdp_media_get_attribute_val (media, "mid"));
+  }
+
+  g_array_unref (transceivers);
+  gst_webrtc_session_description_free (desc);
+  g_free (seen);
+}
+
+#define N_TRANSCEIVERS 16
+
+GST_START_TEST (test_many_transceivers)
+{
+  struct test_webrtc *t = test_webrtc_new ();
+  GstWebRTCRTPTransceiverDirection direction;
+  GstWebRTCRTPTransceiver *trans;
+  GstCaps *caps;
+  guint i;
+
+  /* the transceivers, transports and pads are looked up by mline and mid,
+   * check that every one of them keeps its own media section, also when
+   * renegotiating */
+
+  t->on_negotiation_needed = NULL;
+  t->on_ice_candidate = NULL;
+  t->on_pad_added = _pad_added_fakesink;
+  t->offer_data = GUINT_TO_POINTER (N_TRANSCEIVERS);
+  t->on_offer_created = _count_num_sdp_media;
+  t->answer_data = GUINT_TO_POINTER (N_TRANSCEIVERS);
+  t->on_answer_created = _count_num_sdp_media;
+
+  caps = gst_caps_from_string (OPUS_RTP_CAPS (96));
+  direction = GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_RECVONLY;
+  for (i = 0; i < N_TRANSCEIVERS; i++) {
+    g_signal_emit_by_name (t->webrtc1, "add-transceiver", direction, caps,
+        &trans);
+    fail_unless (trans != NULL);
+    gst_object_unref (trans);
+  }
+  gst_caps_unref (caps);
+
+  test_webrtc_create_offer (t, t->webrtc1);
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless_equals_int (STATE_ANSWER_CREATED, t->state);
+  _check_transceiver_mlines (t->webrtc1, N_TRANSCEIVERS);
+  _check_transceiver_mlines (t->webrtc2, N_TRANSCEIVERS);
+
+  /* the answerer finds its transceivers by mid instead of adding new
+   * ones */
+  test_webrtc_signal_state (t, STATE_NEW);
+  test_webrtc_create_offer (t, t->webrtc1);
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless_equals_int (STATE_ANSWER_CREATED, t->state);
+  _check_transceiver_mlines (t->webrtc1, N_TRANSCEIVERS);
+  _check_transceiver_mlines (t->webrtc2, N_TRANSCEIVERS);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
+static GstElement *
+_find_nicesrc (GstElement * webrtc)
+{
+  GstIterator *it = gst_bin_iterate_recurse (GST_BIN (webrtc));
+  GValue item = G_VALUE_INIT;
+  GstElement *ret = NULL;
+
+  while (!ret && gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *element = g_value_get_object (&item);
+    GstElementFactory *factory = gst_element_get_factory (element);
+
+    if (factory && g_strcmp0 (GST_OBJECT_NAME (factory), "nicesrc") == 0)
+      ret = gst_object_ref (element);
+    g_value_reset (&item);
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  return ret;
+}
+
+/* waits for @n remote candidates to reach the ICE agent */
+static GSList *
+_get_remote_candidates (GstElement * webrtc, guint n)
+{
+  GstElement *nicesrc = _find_nicesrc (webrtc);
+  NiceAgent *agent = NULL;
+  GSList *candidates = NULL;
+  guint stream_id, i;
+
+  fail_unless (nicesrc != NULL);
+  g_object_get (nicesrc, "agent", &agent, "stream", &stream_id, NULL);
+  fail_unless (agent != NULL);
+
+  for (i = 0; i < 500; i++) {
+    candidates = nice_agent_get_remote_candidates (agent, stream_id, 1);
+    if (g_slist_length (candidates) >= n)
+      break;
+    g_slist_free_full (candidates, (GDestroyNotify) nice_candidate_free);
+    candidates = NULL;
+    g_usleep (10000);
+  }
+
+  g_object_unref (agent);
+  gst_object_unref (nicesrc);
+
+  return candidates;
+}
+
+GST_START_TEST (test_add_ice_candidates)
+{
+  struct test_webrtc *t = create_audio_test ();
+  const gchar *early[] = {
+    "candidate:1 1 UDP 2122252543 127.0.0.1 40001 typ host", NULL
+  };
+  const gchar *batch[] = {
+    "a=candidate:2 1 UDP 2122252543 127.0.0.1 40002 typ host",
+    "not a candidate",
+    "candidate:3 1 UDP 2122252543 127.0.0.1 40003 typ host", NULL
+  };
+  GSList *candidates, *l;
+  guint ports = 0;
+
+  /* only the candidates added here reach webrtc2 */
+  g_signal_handlers_disconnect_by_func (t->webrtc1, _on_ice_candidate, t);
+  g_signal_handlers_disconnect_by_func (t->webrtc2, _on_ice_candidate, t);
+  t->offer_data = GUINT_TO_POINTER (1);
+  t->on_offer_created = _count_num_sdp_media;
+  t->answer_data = GUINT_TO_POINTER (1);
+  t->on_answer_created = _count_num_sdp_media;
+
+  /* kept until both descriptions are set */
+  g_signal_emit_by_name (t->webrtc2, "add-ice-candidates", 0, early);
+
+  test_webrtc_create_offer (t, t->webrtc1);
+  test_webrtc_wait_for_answer_error_eos (t);
+  fail_unless_equals_int (STATE_ANSWER_CREATED, t->state);
+
+  /* added in one go, without the invalid one */
+  g_signal_emit_by_name (t->webrtc2, "add-ice-candidates", 0, batch);
+
+  candidates = _get_remote_candidates (t->webrtc2, 3);
+  fail_unless_equals_int (g_slist_length (candidates), 3);
+  for (l = candidates; l; l = l->next) {
+    NiceCandidate *cand = l->data;
+    guint port = nice_address_get_port (&cand->addr);
+
+    fail_unless (port >= 40001 && port <= 40003);
+    ports |= 1 << (port - 40001);
+  }
+  fail_unless_equals_int (ports, 0x7);
+  g_slist_free_full (candidates, (GDestroyNotify) nice_candidate_free);
+
+  test_webrtc_free (t);
+}
+
+GST_END_TEST;
+
+#define START_BITRATE 1000000
+
+GST_START_TEST (test_bitrate_estimator)
+{
+  BitrateEstimator *est = bitrate_estimator_new ();
+  GstClockTime now = 10 * GST_SECOND;
+  guint expected;
+
+  /* starts from the start bitrate */
+  fail_unless (bitrate_estimator_update (est, 0.0, 0.05, now, START_BITRATE,
+          0, 0));
+  fail_unless_equals_int (est->bitrate, START_BITRATE);
+
+  /* no loss, increases with the time since the last report */
+  now += GST_SECOND / 2;
+  expected = est->bitrate * pow (1.08, 0.5);
+  fail_unless (bitrate_estimator_update (est, 0.0, 0.05, now, START_BITRATE,
+          0, 0));
+  fail_unless_equals_int (est->bitrate, expected);
+
+  /* but not by more than a second worth after a gap */
+  now += 5 * GST_SECOND;
+  expected = est->bitrate * 1.08;
+  bitrate_estimator_update (est, 0.01, 0.05, now, START_BITRATE, 0, 0);
+  fail_unless_equals_int (est->bitrate, expected);
+
+  /* moderate loss holds */
+  now += GST_SECOND;
+  fail_if (bitrate_estimator_update (est, 0.05, 0.05, now, START_BITRATE,
+          0, 0));
+  fail_unless_equals_int (est->bitrate, expected);
+
+  /* high loss decreases with the loss */
+  now += GST_SECOND;
+  expected = est->bitrate * (1.0 - 0.5 * 0.2);
+  fail_unless (bitrate_estimator_update (est, 0.2, 0.05, now,
+          START_BITRATE, 0, 0));
+  fail_unless_equals_int (est->bitrate, expected);
+
+  /* queuing shows in the round trip time */
+  now += GST_SECOND;
+  expected = est->bitrate * 0.85;
+  fail_unless (bitrate_estimator_update (est, 0.0, 0.2, now, START_BITRATE,
+          0, 0));
+  fail_unless_equals_int (est->bitrate, expected);
+
+  /* bounded by the min and max bitrates */
+  now += GST_SECOND;
+  bitrate_estimator_update (est, 0.0, 0.05, now, START_BITRATE, 0,
+      START_BITRATE / 2);
+  fail_unless_equals_int (est->bitrate, START_BITRATE / 2);
+  now += GST_SECOND;
+  bitrate_estimator_update (est, 0.5, 0.05, now, START_BITRATE,
+      START_BITRATE / 2, 0);
+  fail_unless_equals_int (est->bitrate, START_BITRATE / 2);
+
+  bitrate_estimator_free (est);
+}
+
+GST_END_TEST;
+
 static Suite *
 webrtcbin_suite (void)
 {
@@ -1419,6 +1895,8 @@ webrtcbin_suite (void)
   tcase_add_test (tc, test_no_nice_elements_request_pad);
   tcase_add_test (tc, test_no_nice_elements_state_change);
   tcase_add_test (tc, test_session_stats);
+  tcase_add_test (tc, test_session_stats_of_type);
+  tcase_add_test (tc, test_bitrate_estimator);
   if (nicesrc && nicesink) {
     tcase_add_test (tc, test_audio);
     tcase_add_test (tc, test_audio_video);
@@ -1429,6 +1907,11 @@ webrtcbin_suite (void)
     tcase_add_test (tc, test_add_recvonly_transceiver);
     tcase_add_test (tc, test_recvonly_sendonly);
     tcase_add_test (tc, test_payload_types);
+    tcase_add_test (tc, test_payload_types_defaults);
+    tcase_add_test (tc, test_simulcast_offer);
+    tcase_add_test (tc, test_ice_lite);
+    tcase_add_test (tc, test_many_transceivers);
+    tcase_add_test (tc, test_add_ice_candidates);
   }
 
   if (nicesrc)
@@ -40,11 +40,13 @@ static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
 static GstPad *sinkpad, *srcpad;
 
 static GstElement *
-setup_x265enc (const gchar * src_caps_str)
+setup_x265enc_with_properties (const gchar * src_caps_str,
+    const gchar * first_property, ...)
 {
   GstElement *x265enc;
   GstCaps *srccaps = NULL;
   GstBus *bus;
+  va_list args;
 
   if (src_caps_str) {
     srccaps = gst_caps_from_string (src_caps_str);
@@ -53,6 +55,12 @@ setup_x265enc (const gchar * src_caps_str)
 
   x265enc = gst_check_setup_element ("x265enc");
   fail_unless (x265enc != NULL);
+
+  va_start (args, first_property);
+  if (first_property)
+    g_object_set_valist (G_OBJECT (x265enc), first_property, args);
+  va_end (args);
+
   srcpad = gst_check_setup_src_pad (x265enc, &srctemplate);
   sinkpad = gst_check_setup_sink_pad (x265enc, &sinktemplate);
   gst_pad_set_active (srcpad, TRUE);
@@ -74,6 +82,12 @@ setup_x265enc (const gchar * src_caps_str)
   return x265enc;
 }
 
+static GstElement *
+setup_x265enc (const gchar * src_caps_str)
+{
+  return setup_x265enc_with_properties (src_caps_str, NULL);
+}
+
 static void
 cleanup_x265enc (GstElement * x265enc)
 {
@@ -149,6 +163,38 @@ GST_START_TEST (test_encode_simple)
 
 GST_END_TEST;
 
+GST_START_TEST (test_encode_threading_properties)
+{
+  GstElement *x265enc;
+  GstBuffer *buffer;
+  GstSegment seg;
+  gint i;
+
+  x265enc =
+      setup_x265enc_with_properties
+      ("video/x-raw,format=(string)I420,width=(int)320,height=(int)240,framerate=(fraction)25/1",
+      "frame-threads", 2, "lookahead-slices", 2, "wpp", FALSE, NULL);
+
+  gst_segment_init (&seg, GST_FORMAT_TIME);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_segment (&seg)));
+
+  for (i = 0; i < 10; i++) {
+    buffer = gst_buffer_new_allocate (NULL, 320 * 240 + 2 * 160 * 120, NULL);
+    gst_buffer_memset (buffer, 0, i, -1);
+    GST_BUFFER_TIMESTAMP (buffer) = gst_util_uint64_scale (i, GST_SECOND, 25);
+    GST_BUFFER_DURATION (buffer) = gst_util_uint64_scale (1, GST_SECOND, 25);
+    fail_unless (gst_pad_push (srcpad, buffer) == GST_FLOW_OK);
+  }
+
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (g_list_length (buffers), 10);
+
+  cleanup_x265enc (x265enc);
+}
+
+GST_END_TEST;
+
 static Suite *
 x265enc_suite (void)
 {
@@ -158,6 +204,7 @@ x265enc_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, test_encode_simple);
+  tcase_add_test (tc_chain, test_encode_threading_properties);
 
   return s;
 }
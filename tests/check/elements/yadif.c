@@ -0,0 +1,185 @@
+/* GStreamer unit test for yadif
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* the line filters are internal to the plugin */
+#include "../../gst/yadif/vf_yadif.c"
+#include "../../gst/yadif/yadif.c"
+
+#define N_FRAMES 4
+
+static GList *
+run_yadif (const gchar * format, guint n_threads)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GList *buffers = NULL;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("yadif mode=interlaced n-threads=%u", n_threads);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+
+  /* odd height, so the stripes don't split the frame evenly */
+  desc = g_strdup_printf ("videotestsrc pattern=ball ! "
+      "video/x-raw,format=%s,width=320,height=243,framerate=25/1", format);
+  gst_harness_add_src_parse (h, desc, FALSE);
+  g_free (desc);
+
+  for (i = 0; i < N_FRAMES; i++)
+    fail_unless_equals_int (gst_harness_push_from_src (h), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  while ((buf = gst_harness_try_pull (h)))
+    buffers = g_list_append (buffers, buf);
+  fail_unless (buffers != NULL);
+
+  gst_harness_teardown (h);
+
+  return buffers;
+}
+
+static void
+check_n_threads (const gchar * format)
+{
+  GList *ref, *buffers, *l, *m;
+  guint n_threads[] = { 2, 3, 4, 7, 0 };
+  guint i;
+
+  ref = run_yadif (format, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    GST_INFO ("%s, n-threads=%u", format, n_threads[i]);
+    buffers = run_yadif (format, n_threads[i]);
+    fail_unless_equals_int (g_list_length (buffers), g_list_length (ref));
+
+    for (l = ref, m = buffers; l && m; l = l->next, m = m->next) {
+      GstMapInfo ref_map, map;
+
+      fail_unless (gst_buffer_map (l->data, &ref_map, GST_MAP_READ));
+      fail_unless (gst_buffer_map (m->data, &map, GST_MAP_READ));
+      fail_unless_equals_int (map.size, ref_map.size);
+      fail_unless (memcmp (map.data, ref_map.data, map.size) == 0);
+      gst_buffer_unmap (m->data, &map);
+      gst_buffer_unmap (l->data, &ref_map);
+    }
+
+    g_list_free_full (buffers, (GDestroyNotify) gst_buffer_unref);
+  }
+
+  g_list_free_full (ref, (GDestroyNotify) gst_buffer_unref);
+}
+
+/* Filtering in stripes must give exactly the same output as filtering the
+ * whole frame in one go */
+GST_START_TEST (test_n_threads)
+{
+  check_n_threads ("I420");
+  check_n_threads ("Y42B");
+  check_n_threads ("Y444");
+}
+
+GST_END_TEST;
+
+#define LINE_MARGIN 32
+#define MAX_WIDTH 720
+
+/* The vector line filters must give the same pixels as the C filter that
+ * yadif_filter() uses for the rest of each row */
+GST_START_TEST (test_filter_line_simd)
+{
+  YadifFilterLineFunc filter_line;
+  gint refs = MAX_WIDTH + 2 * LINE_MARGIN;
+  guint8 *prev, *cur, *next, *dst, *ref;
+  gint step, spatial, w, parity, mode, i, run;
+
+  filter_line = yadif_get_filter_line (&step, &spatial);
+
+  /* 5 rows, the line is filtered from the ones above and below */
+  prev = g_malloc (5 * refs);
+  cur = g_malloc (5 * refs);
+  next = g_malloc (5 * refs);
+  dst = g_malloc (refs);
+  ref = g_malloc (refs);
+
+  g_random_set_seed (42);
+  for (run = 0; run < 4; run++) {
+    for (i = 0; i < 5 * refs; i++) {
+      /* alternate between noise and smooth content, for the spatial and
+       * temporal checks to take every branch */
+      if (run & 1) {
+        prev[i] = g_random_int_range (0, 256);
+        cur[i] = g_random_int_range (0, 256);
+        next[i] = g_random_int_range (0, 256);
+      } else {
+        prev[i] = (i % refs) + 16 * (i / refs);
+        cur[i] = prev[i] + g_random_int_range (0, 8);
+        next[i] = 3 * (i % refs) + g_random_int_range (0, 32);
+      }
+    }
+
+    for (w = step; w <= MAX_WIDTH; w += step * (w < 16 * step ? 1 : 7)) {
+      for (parity = 0; parity < 2; parity++) {
+        for (mode = 0; mode <= 2; mode += 2) {
+          gint offset = 2 * refs + LINE_MARGIN;
+
+          memset (dst, 0, refs);
+          memset (ref, 0, refs);
+          filter_line (dst + LINE_MARGIN, prev + offset, cur + offset,
+              next + offset, w, refs, -refs, parity, mode);
+          filter_line_c_full (ref + LINE_MARGIN, prev + offset, cur + offset,
+              next + offset, w, refs, -refs, parity, mode,
+              spatial >= 0 ? spatial : 0);
+          fail_unless (memcmp (dst, ref, refs) == 0,
+              "width %d, parity %d, mode %d differ", w, parity, mode);
+        }
+      }
+    }
+  }
+
+  g_free (prev);
+  g_free (cur);
+  g_free (next);
+  g_free (dst);
+  g_free (ref);
+}
+
+GST_END_TEST;
+
+static Suite *
+yadif_suite (void)
+{
+  Suite *s = suite_create ("yadif");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_filter_line_simd);
+
+  return s;
+}
+
+GST_CHECK_MAIN (yadif);
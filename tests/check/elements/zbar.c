@@ -153,6 +153,37 @@ GST_START_TEST (test_still_image_with_sample)
 
 GST_END_TEST;
 
+GST_START_TEST (test_still_image_async)
+{
+  GstMessage *zbar_msg;
+  const GstStructure *s;
+  GstElement *pipeline;
+
+  pipeline = setup_pipeline ();
+  gst_child_proxy_set ((GstChildProxy *) pipeline, "zbar::async", TRUE, NULL);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  /* the result of the worker thread must be posted before the EOS */
+  zbar_msg = get_zbar_msg_until_eos (pipeline);
+  fail_unless (zbar_msg != NULL);
+
+  s = gst_message_get_structure (zbar_msg);
+  fail_unless (gst_structure_has_name (s, "barcode"));
+  fail_unless (gst_structure_has_field (s, "running-time"));
+  fail_unless_equals_string (gst_structure_get_string (s, "symbol"),
+      "9876543210128");
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+
+  gst_object_unref (pipeline);
+  gst_message_unref (zbar_msg);
+}
+
+GST_END_TEST;
+
 static Suite *
 zbar_suite (void)
 {
@@ -167,6 +198,7 @@ zbar_suite (void)
   } else {
     tcase_add_test (tc_chain, test_still_image);
     tcase_add_test (tc_chain, test_still_image_with_sample);
+    tcase_add_test (tc_chain, test_still_image_async);
   }
 
   return s;
@@ -0,0 +1,272 @@
+/* GStreamer
+ *
+ * unit tests for the fragment cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/uridownloader/gstfragmentcache.h>
+#include <glib/gstdio.h>
+
+static GstBuffer *
+create_fragment (guint8 value, gsize size)
+{
+  GstBuffer *buffer = gst_buffer_new_allocate (NULL, size, NULL);
+
+  gst_buffer_memset (buffer, 0, value, size);
+
+  return buffer;
+}
+
+static void
+check_fragment (GstFragmentCache * cache, const gchar * uri, guint8 value,
+    gsize size)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gsize i;
+
+  buffer = gst_fragment_cache_lookup (cache, uri, 0, -1);
+  fail_unless (buffer != NULL);
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, size);
+  for (i = 0; i < map.size; i++)
+    fail_unless_equals_int (map.data[i], value);
+  gst_buffer_unmap (buffer, &map);
+  gst_buffer_unref (buffer);
+}
+
+static void
+insert_fragment (GstFragmentCache * cache, const gchar * uri, guint8 value,
+    gsize size)
+{
+  GstBuffer *buffer = create_fragment (value, size);
+
+  gst_fragment_cache_insert (cache, uri, 0, -1, buffer);
+  gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (test_lookup)
+{
+  GstFragmentCache *cache;
+  GstBuffer *buffer;
+  guint64 size, hits, misses;
+
+  cache = gst_fragment_cache_new (1024);
+
+  fail_unless (gst_fragment_cache_lookup (cache, "http://a/1.ts", 0,
+          -1) == NULL);
+
+  buffer = create_fragment (1, 100);
+  gst_fragment_cache_insert (cache, "http://a/1.ts", 0, 99, buffer);
+  gst_buffer_unref (buffer);
+
+  /* the byte range is part of the key */
+  fail_unless (gst_fragment_cache_lookup (cache, "http://a/1.ts", 0,
+          -1) == NULL);
+  buffer = gst_fragment_cache_lookup (cache, "http://a/1.ts", 0, 99);
+  fail_unless (buffer != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (buffer), 100);
+  gst_buffer_unref (buffer);
+
+  /* larger than the cache */
+  insert_fragment (cache, "http://a/2.ts", 2, 2048);
+  fail_unless (gst_fragment_cache_lookup (cache, "http://a/2.ts", 0,
+          -1) == NULL);
+
+  gst_fragment_cache_get_stats (cache, &size, NULL, &hits, &misses);
+  fail_unless_equals_uint64 (size, 100);
+  fail_unless_equals_uint64 (hits, 1);
+  fail_unless_equals_uint64 (misses, 3);
+
+  gst_fragment_cache_free (cache);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_lru_eviction)
+{
+  GstFragmentCache *cache;
+  guint64 size;
+
+  cache = gst_fragment_cache_new (300);
+
+  insert_fragment (cache, "http://a/1.ts", 1, 100);
+  insert_fragment (cache, "http://a/2.ts", 2, 100);
+  insert_fragment (cache, "http://a/3.ts", 3, 100);
+
+  /* 1 is now more recently used than 2 */
+  check_fragment (cache, "http://a/1.ts", 1, 100);
+
+  insert_fragment (cache, "http://a/4.ts", 4, 100);
+  fail_unless (gst_fragment_cache_lookup (cache, "http://a/2.ts", 0,
+          -1) == NULL);
+  check_fragment (cache, "http://a/1.ts", 1, 100);
+  check_fragment (cache, "http://a/3.ts", 3, 100);
+  check_fragment (cache, "http://a/4.ts", 4, 100);
+
+  gst_fragment_cache_set_max_size (cache, 100);
+  gst_fragment_cache_get_stats (cache, &size, NULL, NULL, NULL);
+  fail_unless_equals_uint64 (size, 100);
+  check_fragment (cache, "http://a/4.ts", 4, 100);
+
+  gst_fragment_cache_clear (cache);
+  gst_fragment_cache_get_stats (cache, &size, NULL, NULL, NULL);
+  fail_unless_equals_uint64 (size, 0);
+  fail_unless (gst_fragment_cache_lookup (cache, "http://a/4.ts", 0,
+          -1) == NULL);
+
+  gst_fragment_cache_free (cache);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_disk_tier)
+{
+  GstFragmentCache *cache;
+  guint64 size, disk_size;
+  gchar *location;
+  GDir *dir;
+
+  location = g_dir_make_tmp ("fragmentcache-XXXXXX", NULL);
+  fail_unless (location != NULL);
+
+  cache = gst_fragment_cache_new (200);
+  fail_unless (gst_fragment_cache_set_disk_location (cache, location, 200));
+
+  insert_fragment (cache, "http://a/1.ts", 1, 100);
+  insert_fragment (cache, "http://a/2.ts", 2, 100);
+  insert_fragment (cache, "http://a/3.ts", 3, 100);
+  insert_fragment (cache, "http://a/4.ts", 4, 100);
+
+  /* 1 and 2 were moved to the disk */
+  gst_fragment_cache_get_stats (cache, &size, &disk_size, NULL, NULL);
+  fail_unless_equals_uint64 (size, 200);
+  fail_unless_equals_uint64 (disk_size, 200);
+
+  /* reading 1 back moves 3 to the disk, which drops 2 from it */
+  check_fragment (cache, "http://a/1.ts", 1, 100);
+  fail_unless (gst_fragment_cache_lookup (cache, "http://a/2.ts", 0,
+          -1) == NULL);
+  check_fragment (cache, "http://a/3.ts", 3, 100);
+  check_fragment (cache, "http://a/4.ts", 4, 100);
+
+  /* the files are removed with the cache */
+  gst_fragment_cache_free (cache);
+  dir = g_dir_open (location, 0, NULL);
+  fail_unless (dir != NULL);
+  fail_unless (g_dir_read_name (dir) == NULL);
+  g_dir_close (dir);
+
+  g_rmdir (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  GstFragmentCache *cache;
+  GstBuffer *buffer;
+  gboolean reserved;
+  gboolean done;
+} LookupData;
+
+static gpointer
+lookup_thread (LookupData * data)
+{
+  data->buffer = gst_fragment_cache_lookup_or_reserve (data->cache,
+      "http://a/1.ts", 0, -1, &data->reserved);
+  g_atomic_int_set (&data->done, TRUE);
+
+  return NULL;
+}
+
+GST_START_TEST (test_reservation)
+{
+  GstFragmentCache *cache;
+  LookupData data = { NULL, };
+  GstBuffer *buffer;
+  GThread *thread;
+  gboolean reserved;
+  guint64 hits, misses;
+
+  cache = gst_fragment_cache_new (1024);
+  data.cache = cache;
+
+  /* the first one downloads it */
+  fail_unless (gst_fragment_cache_lookup_or_reserve (cache, "http://a/1.ts",
+          0, -1, &reserved) == NULL);
+  fail_unless (reserved);
+
+  /* the second one waits for that download */
+  thread = g_thread_new ("lookup", (GThreadFunc) lookup_thread, &data);
+  g_usleep (100 * 1000);
+  fail_if (g_atomic_int_get (&data.done));
+
+  insert_fragment (cache, "http://a/1.ts", 1, 100);
+  g_thread_join (thread);
+  fail_unless (data.buffer != NULL);
+  fail_if (data.reserved);
+  gst_buffer_unref (data.buffer);
+
+  gst_fragment_cache_get_stats (cache, NULL, NULL, &hits, &misses);
+  fail_unless_equals_uint64 (hits, 1);
+  fail_unless_equals_uint64 (misses, 1);
+
+  /* a failed download hands the reservation over to the waiting lookup */
+  gst_fragment_cache_clear (cache);
+  fail_unless (gst_fragment_cache_lookup_or_reserve (cache, "http://a/1.ts",
+          0, -1, &reserved) == NULL);
+  fail_unless (reserved);
+
+  data.done = FALSE;
+  thread = g_thread_new ("lookup", (GThreadFunc) lookup_thread, &data);
+  g_usleep (100 * 1000);
+  fail_if (g_atomic_int_get (&data.done));
+
+  gst_fragment_cache_release (cache, "http://a/1.ts", 0, -1);
+  g_thread_join (thread);
+  fail_unless (data.buffer == NULL);
+  fail_unless (data.reserved);
+
+  buffer = create_fragment (1, 100);
+  gst_fragment_cache_insert (cache, "http://a/1.ts", 0, -1, buffer);
+  gst_buffer_unref (buffer);
+  check_fragment (cache, "http://a/1.ts", 1, 100);
+
+  gst_fragment_cache_free (cache);
+}
+
+GST_END_TEST;
+
+static Suite *
+fragmentcache_suite (void)
+{
+  Suite *s = suite_create ("fragmentcache");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_lookup);
+  tcase_add_test (tc_chain, test_lru_eviction);
+  tcase_add_test (tc_chain, test_disk_tier);
+  tcase_add_test (tc_chain, test_reservation);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fragmentcache);
@@ -20,6 +20,7 @@
  */
 #include <gst/check/gstcheck.h>
 #include <gst/codecparsers/gsth264parser.h>
+#include <string.h>
 
 static guint8 slice_dpa[] = {
   0x00, 0x00, 0x01, 0x02, 0x00, 0x02, 0x01, 0x03, 0x00,
@@ -211,6 +212,88 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+/* Checks the start code detection at all the positions relative to the
+ * blocks of the vectorised scanners */
+GST_START_TEST (test_h264_parse_start_code_positions)
+{
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  guint8 buf[256];
+  guint prefix, len;
+
+  for (prefix = 0; prefix < 40; prefix++) {
+    for (len = 1; len < 80; len++) {
+      GstH264ParserResult res;
+      GstH264NalUnit nalu;
+      guint8 *data = buf;
+
+      memset (buf, 0xff, sizeof (buf));
+      data += prefix;
+      /* filler data NAL of len + 1 bytes, followed by another one */
+      memcpy (data, "\x00\x00\x01\x0c", 4);
+      data += 4 + len;
+      memcpy (data, "\x00\x00\x01\x0c\xff", 5);
+      data += 5;
+
+      res = gst_h264_parser_identify_nalu (parser, buf, 0, data - buf, &nalu);
+
+      assert_equals_int (res, GST_H264_PARSER_OK);
+      assert_equals_int (nalu.sc_offset, prefix);
+      assert_equals_int (nalu.offset, prefix + 3);
+      assert_equals_int (nalu.size, len + 1);
+    }
+  }
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+/* baseline 320x240 SPS and its PPS, followed by an I slice of an IDR */
+static const guint8 sps_pps_idr[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1e, 0xf4, 0x0a, 0x0f, 0xc8,
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80,
+  0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x0a, 0x80
+};
+
+GST_START_TEST (test_h264_parse_copy)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalParser *copy;
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SliceHdr slice;
+  guint offset = 0;
+
+  /* fill the original parser with the SPS and the PPS */
+  while (offset < sizeof (sps_pps_idr)) {
+    res = gst_h264_parser_identify_nalu (parser, sps_pps_idr, offset,
+        sizeof (sps_pps_idr), &nalu);
+    fail_unless (res == GST_H264_PARSER_OK
+        || res == GST_H264_PARSER_NO_NAL_END);
+    if (nalu.type == GST_H264_NAL_SLICE_IDR)
+      break;
+    assert_equals_int (gst_h264_parser_parse_nal (parser, &nalu),
+        GST_H264_PARSER_OK);
+    offset = nalu.offset + nalu.size;
+  }
+  assert_equals_int (nalu.type, GST_H264_NAL_SLICE_IDR);
+
+  /* the copy must stand on its own once the original is gone */
+  copy = gst_h264_nal_parser_copy (parser);
+  gst_h264_nal_parser_free (parser);
+
+  res = gst_h264_parser_parse_slice_hdr (copy, &nalu, &slice, TRUE, TRUE);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  fail_unless (GST_H264_IS_I_SLICE (&slice));
+  assert_equals_int (slice.pps->id, 0);
+  assert_equals_int (slice.pps->sequence->width, 320);
+  assert_equals_int (slice.pps->sequence->height, 240);
+
+  gst_h264_nal_parser_free (copy);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +304,8 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_parse_start_code_positions);
+  tcase_add_test (tc_chain, test_h264_parse_copy);
 
   return s;
 }
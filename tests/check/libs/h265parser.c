@@ -232,6 +232,119 @@ GST_START_TEST (test_h265_format_range_profiles_partial_match)
 
 GST_END_TEST;
 
+/* prefix SEI NAL with a single user_data_unregistered (type 5) payload */
+static const guint8 h265_sei_user_data[] = {
+  0x00, 0x00, 0x01, 0x4e, 0x01, 0x05, 0x10,
+  0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+  0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x10,
+  0x80
+};
+
+static guint
+count_sei_messages (GstH265Parser * parser, GstH265NalUnit * nalu)
+{
+  GArray *messages;
+  guint len;
+
+  assert_equals_int (gst_h265_parser_parse_sei (parser, nalu, &messages),
+      GST_H265_PARSER_OK);
+  len = messages->len;
+  if (len)
+    assert_equals_int (g_array_index (messages, GstH265SEIMessage,
+            0).payloadType, 5);
+  g_array_free (messages, TRUE);
+
+  return len;
+}
+
+GST_START_TEST (test_h265_skip_sei_payloads)
+{
+  GstH265Parser *parser;
+  GstH265NalUnit nalu;
+
+  parser = gst_h265_parser_new ();
+  assert_equals_int (gst_h265_parser_get_flags (parser),
+      GST_H265_PARSER_FLAG_NONE);
+
+  assert_equals_int (gst_h265_parser_identify_nalu_unchecked (parser,
+          h265_sei_user_data, 0, sizeof (h265_sei_user_data), &nalu),
+      GST_H265_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H265_NAL_PREFIX_SEI);
+
+  assert_equals_int (count_sei_messages (parser, &nalu), 1);
+
+  gst_h265_parser_set_flags (parser, GST_H265_PARSER_FLAG_SKIP_SEI_PAYLOADS);
+  assert_equals_int (count_sei_messages (parser, &nalu), 0);
+
+  gst_h265_parser_request_sei_payload (parser, 5, TRUE);
+  assert_equals_int (count_sei_messages (parser, &nalu), 1);
+
+  gst_h265_parser_request_sei_payload (parser, 5, FALSE);
+  assert_equals_int (count_sei_messages (parser, &nalu), 0);
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_parser_copy)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265Parser *copy;
+  guint i;
+
+  /* PPS 2 refers to SPS 1, which refers to VPS 0, as after parsing them */
+  parser->vps[0].id = 0;
+  parser->vps[0].max_sub_layers_minus1 = 2;
+  parser->vps[0].valid = TRUE;
+
+  parser->sps[1].id = 1;
+  parser->sps[1].vps = &parser->vps[0];
+  parser->sps[1].width = 1920;
+  parser->sps[1].height = 1080;
+  parser->sps[1].valid = TRUE;
+
+  parser->pps[2].id = 2;
+  parser->pps[2].sps = &parser->sps[1];
+  parser->pps[2].num_extra_slice_header_bits = 1;
+  parser->pps[2].valid = TRUE;
+
+  parser->last_vps = &parser->vps[0];
+  parser->last_sps = &parser->sps[1];
+  parser->last_pps = &parser->pps[2];
+
+  /* the copy must stand on its own once the original is gone */
+  copy = gst_h265_parser_copy (parser);
+  gst_h265_parser_free (parser);
+
+  fail_unless (copy->vps[0].valid);
+  assert_equals_int (copy->vps[0].max_sub_layers_minus1, 2);
+
+  fail_unless (copy->sps[1].valid);
+  fail_unless (copy->sps[1].vps == &copy->vps[0]);
+  assert_equals_int (copy->sps[1].width, 1920);
+  assert_equals_int (copy->sps[1].height, 1080);
+
+  fail_unless (copy->pps[2].valid);
+  fail_unless (copy->pps[2].sps == &copy->sps[1]);
+  assert_equals_int (copy->pps[2].num_extra_slice_header_bits, 1);
+  assert_equals_int (copy->pps[2].sps->vps->max_sub_layers_minus1, 2);
+
+  fail_unless (copy->last_vps == &copy->vps[0]);
+  fail_unless (copy->last_sps == &copy->sps[1]);
+  fail_unless (copy->last_pps == &copy->pps[2]);
+
+  /* the empty slots stay empty */
+  for (i = 0; i < GST_H265_MAX_PPS_COUNT; i++) {
+    if (i != 2)
+      fail_if (copy->pps[i].valid);
+  }
+
+  gst_h265_parser_free (copy);
+}
+
+GST_END_TEST;
+
 static Suite *
 h265parser_suite (void)
 {
@@ -244,6 +357,8 @@ h265parser_suite (void)
   tcase_add_test (tc_chain, test_h265_base_profiles_compat);
   tcase_add_test (tc_chain, test_h265_format_range_profiles_exact_match);
   tcase_add_test (tc_chain, test_h265_format_range_profiles_partial_match);
+  tcase_add_test (tc_chain, test_h265_skip_sei_payloads);
+  tcase_add_test (tc_chain, test_h265_parser_copy);
 
   return s;
 }
@@ -306,6 +306,76 @@ GST_START_TEST (isoff_moof_parse_with_tfxd_tfrf)
 
 GST_END_TEST;
 
+GST_START_TEST (isoff_moof_iterate)
+{
+  GstByteReader reader = GST_BYTE_READER_INIT (seg_2_m4f, sizeof (seg_2_m4f));
+  guint32 type;
+  guint header_size;
+  guint64 size;
+  GstMoofIterator iter;
+  GstTfhdBox tfhd;
+  GstTfdtBox tfdt;
+  GstTrunBox trun;
+  GstTrunSample sample;
+  guint i;
+
+  fail_unless (gst_isoff_parse_box_header (&reader, &type, NULL,
+          &header_size, &size));
+  fail_unless (type == GST_ISOFF_FOURCC_MOOF);
+
+  fail_unless (gst_isoff_moof_iterator_init (&iter, &reader));
+  fail_unless_equals_int (iter.mfhd.sequence_number, 4);
+
+  fail_unless_equals_int (gst_isoff_moof_iterator_next_traf (&iter, &tfhd,
+          &tfdt), GST_ISOFF_PARSER_OK);
+  fail_unless_equals_int (tfhd.flags, GST_TFHD_FLAGS_DEFAULT_BASE_IS_MOOF);
+  fail_unless_equals_int (tfhd.track_id, 2);
+  fail_unless_equals_uint64 (tfdt.decode_time, 132096);
+
+  fail_unless_equals_int (gst_isoff_moof_iterator_next_trun (&iter, &trun),
+      GST_ISOFF_PARSER_OK);
+  fail_unless_equals_int (trun.sample_count, 129);
+  fail_unless_equals_int (trun.data_offset, size + header_size);
+  fail_unless (trun.samples == NULL);
+
+  for (i = 0; i < 129; i++) {
+    fail_unless_equals_int (gst_isoff_moof_iterator_next_sample (&iter,
+            &sample), GST_ISOFF_PARSER_OK);
+    fail_unless_equals_int (sample.sample_duration, seg_sample_duration);
+    fail_unless_equals_int (sample.sample_size, seg_2_sample_sizes[i]);
+  }
+  fail_unless_equals_int (gst_isoff_moof_iterator_next_sample (&iter,
+          &sample), GST_ISOFF_PARSER_DONE);
+
+  fail_unless_equals_int (gst_isoff_moof_iterator_next_trun (&iter, &trun),
+      GST_ISOFF_PARSER_DONE);
+  fail_unless_equals_int (gst_isoff_moof_iterator_next_traf (&iter, &tfhd,
+          NULL), GST_ISOFF_PARSER_DONE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (isoff_moof_iterate_truncated)
+{
+  GstByteReader reader = GST_BYTE_READER_INIT (moof1, sizeof (moof1) - 16);
+  guint32 type;
+  guint header_size;
+  guint64 size;
+  GstMoofIterator iter;
+  GstTfhdBox tfhd;
+
+  fail_unless (gst_isoff_parse_box_header (&reader, &type, NULL,
+          &header_size, &size));
+
+  /* the header is complete but the traf extends past the end of the data */
+  fail_unless (gst_isoff_moof_iterator_init (&iter, &reader));
+  fail_unless_equals_int (iter.mfhd.sequence_number, 1);
+  fail_unless_equals_int (gst_isoff_moof_iterator_next_traf (&iter, &tfhd,
+          NULL), GST_ISOFF_PARSER_ERROR);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (isoff_moov_parse)
 {
   /* INDENT-ON */
@@ -356,6 +426,8 @@ dash_isoff_suite (void)
   tcase_add_test (tc_moof, isoff_moof_parse);
   tcase_add_test (tc_moof, isoff_moof_parse_with_tfdt);
   tcase_add_test (tc_moof, isoff_moof_parse_with_tfxd_tfrf);
+  tcase_add_test (tc_moof, isoff_moof_iterate);
+  tcase_add_test (tc_moof, isoff_moof_iterate_truncated);
   suite_add_tcase (s, tc_moof);
 
   tcase_add_test (tc_moov, isoff_moov_parse);
@@ -395,6 +395,50 @@ GST_START_TEST (test_mpegts_sdt)
 
 GST_END_TEST;
 
+GST_START_TEST (test_mpegts_sdt_zero_copy)
+{
+  const GstMpegtsSDT *sdt;
+  const GstMpegtsSDTService *service;
+  GstMpegtsDescriptor *desc, *copy;
+  GstMpegtsSection *sdt_section;
+  gchar *name = NULL;
+  guint i;
+
+  sdt_section = gst_mpegts_section_new (0x11,
+      g_memdup (sdt_data_check, sizeof (sdt_data_check)),
+      sizeof (sdt_data_check));
+  fail_if (sdt_section == NULL);
+  gst_mpegts_section_set_zero_copy (sdt_section, TRUE);
+
+  sdt = gst_mpegts_section_get_sdt (sdt_section);
+  fail_if (sdt == NULL);
+  fail_unless (sdt->services->len == 2);
+
+  for (i = 0; i < 2; i++) {
+    service = g_ptr_array_index (sdt->services, i);
+    fail_unless (service->descriptors->len == 1);
+
+    /* The descriptors reference the section data */
+    desc = g_ptr_array_index (service->descriptors, 0);
+    fail_unless (desc->data > sdt_section->data);
+    fail_unless (desc->data + desc->length + 2 <=
+        sdt_section->data + sdt_section->section_length);
+
+    /* Copies are standalone */
+    copy = g_boxed_copy (GST_TYPE_MPEGTS_DESCRIPTOR, desc);
+    fail_if (copy->data == desc->data);
+    fail_unless (gst_mpegts_descriptor_parse_dvb_service (copy,
+            NULL, &name, NULL) == TRUE);
+    fail_unless_equals_string (name, "Name");
+    g_free (name);
+    gst_mpegts_descriptor_free (copy);
+  }
+
+  gst_mpegts_section_unref (sdt_section);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_mpegts_atsc_stt)
 {
   const GstMpegtsAtscSTT *stt;
@@ -574,6 +618,7 @@ mpegts_suite (void)
   tcase_add_test (tc_chain, test_mpegts_pmt);
   tcase_add_test (tc_chain, test_mpegts_nit);
   tcase_add_test (tc_chain, test_mpegts_sdt);
+  tcase_add_test (tc_chain, test_mpegts_sdt_zero_copy);
   tcase_add_test (tc_chain, test_mpegts_atsc_stt);
   tcase_add_test (tc_chain, test_mpegts_descriptors);
   tcase_add_test (tc_chain, test_mpegts_dvb_descriptors);
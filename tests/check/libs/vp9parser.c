@@ -0,0 +1,107 @@
+/* Gstreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gstvp9parser.h>
+
+/* Two frames of 5 and 3 bytes, followed by a superframe index with one
+ * byte per frame size */
+static const guint8 vp9_superframe[] = {
+  0x82, 0x49, 0x83, 0x42, 0x00,
+  0x86, 0x00, 0x40,
+  0xc1, 0x05, 0x03, 0xc1
+};
+
+/* Same index, but the sizes exceed the data */
+static const guint8 vp9_broken_superframe[] = {
+  0x82, 0x49, 0x83, 0x42, 0x00,
+  0xc1, 0x05, 0x03, 0xc1
+};
+
+GST_START_TEST (test_vp9_parse_superframe)
+{
+  GstVp9Parser *parser;
+  GstVp9SuperframeInfo info;
+  GstVp9ParserResult res;
+  GstBuffer *buf, *frame;
+  GstMapInfo map;
+
+  parser = gst_vp9_parser_new ();
+
+  res = gst_vp9_parser_parse_superframe_info (parser, &info, vp9_superframe,
+      sizeof (vp9_superframe));
+  assert_equals_int (res, GST_VP9_PARSER_OK);
+  assert_equals_int (info.frames_in_superframe, 2);
+  assert_equals_int (info.bytes_per_framesize, 1);
+  assert_equals_int (info.superframe_index_size, 4);
+  assert_equals_int (info.frame_offsets[0], 0);
+  assert_equals_int (info.frame_sizes[0], 5);
+  assert_equals_int (info.frame_offsets[1], 5);
+  assert_equals_int (info.frame_sizes[1], 3);
+
+  buf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+      (gpointer) vp9_superframe, sizeof (vp9_superframe), 0,
+      sizeof (vp9_superframe), NULL, NULL);
+  GST_BUFFER_PTS (buf) = 42 * GST_MSECOND;
+
+  frame = gst_vp9_superframe_info_get_frame_buffer (&info, buf, 1);
+  fail_unless (frame != NULL);
+  assert_equals_uint64 (GST_BUFFER_PTS (frame), 42 * GST_MSECOND);
+  fail_unless (gst_buffer_map (frame, &map, GST_MAP_READ));
+  assert_equals_int (map.size, 3);
+  /* the frame points into the original data */
+  fail_unless (map.data == vp9_superframe + 5);
+  gst_buffer_unmap (frame, &map);
+  gst_buffer_unref (frame);
+
+  fail_unless (gst_vp9_superframe_info_get_frame_buffer (&info, buf,
+          2) == NULL);
+  gst_buffer_unref (buf);
+
+  /* a plain frame is reported as a single frame spanning all the data */
+  res = gst_vp9_parser_parse_superframe_info (parser, &info, vp9_superframe,
+      5);
+  assert_equals_int (res, GST_VP9_PARSER_OK);
+  assert_equals_int (info.frames_in_superframe, 1);
+  assert_equals_int (info.superframe_index_size, 0);
+  assert_equals_int (info.frame_offsets[0], 0);
+  assert_equals_int (info.frame_sizes[0], 5);
+
+  res = gst_vp9_parser_parse_superframe_info (parser, &info,
+      vp9_broken_superframe, sizeof (vp9_broken_superframe));
+  assert_equals_int (res, GST_VP9_PARSER_BROKEN_DATA);
+
+  gst_vp9_parser_free (parser);
+}
+
+GST_END_TEST;
+
+static Suite *
+vp9parsers_suite (void)
+{
+  Suite *s = suite_create ("VP9 Parser library");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_vp9_parse_superframe);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vp9parsers);
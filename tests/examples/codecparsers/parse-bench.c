@@ -0,0 +1,391 @@
+/*
+ * parse-bench.c - Measure the throughput of the codec parsers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Runs the codec parsers over the given files and reports, for each of the
+ * measured functions, the throughput in MB/s of the data it was given and
+ * the time spent per unit (NAL, frame or segment).
+ *
+ * The H.264 and H.265 inputs are byte-streams, the VC-1 input an advanced
+ * profile elementary stream, the VP9 input an IVF file and the JPEG input
+ * one or more concatenated JPEG images (an MJPEG capture). Each file is
+ * processed --iterations times:
+ *
+ *   parse-bench --h264 in.264 --h265 in.265 --vc1 in.vc1 --vp9 in.ivf \
+ *       --jpeg in.mjpeg
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/base/gstbytereader.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+#include <gst/codecparsers/gstvc1parser.h>
+#include <gst/codecparsers/gstvp9parser.h>
+#include <gst/codecparsers/gstjpegparser.h>
+
+#define IVF_FILE_HDR_SIZE       32
+#define IVF_FRAME_HDR_SIZE      12
+
+typedef struct
+{
+  const gchar *name;
+  guint64 bytes;
+  guint64 units;
+  GstClockTime time;
+} BenchResult;
+
+static gint iterations = 10;
+
+static inline void
+bench_start (GstClockTime * start)
+{
+  *start = gst_util_get_timestamp ();
+}
+
+static inline void
+bench_stop (BenchResult * res, GstClockTime start, gsize bytes)
+{
+  res->time += gst_util_get_timestamp () - start;
+  res->bytes += bytes;
+  res->units++;
+}
+
+static void
+print_result (const BenchResult * res)
+{
+  if (res->units == 0 || res->time == 0) {
+    g_print ("  %-32s : no data\n", res->name);
+    return;
+  }
+
+  g_print ("  %-32s : %10.2f MB/s %10.1f ns/unit (%" G_GUINT64_FORMAT
+      " units, %" G_GUINT64_FORMAT " bytes)\n", res->name,
+      (gdouble) res->bytes * GST_SECOND / res->time / (1024 * 1024),
+      (gdouble) res->time / res->units, res->units, res->bytes);
+}
+
+static void
+bench_h264 (const guint8 * data, gsize size)
+{
+  BenchResult scan = { "h264 identify_nalu", };
+  BenchResult slice = { "h264 parse_slice_hdr", };
+  gint i;
+
+  for (i = 0; i < iterations; i++) {
+    GstH264NalParser *parser = gst_h264_nal_parser_new ();
+    GstH264ParserResult pres;
+    GstH264NalUnit nalu;
+    GstClockTime start;
+    guint offset = 0;
+
+    while (TRUE) {
+      bench_start (&start);
+      pres = gst_h264_parser_identify_nalu (parser, data, offset, size, &nalu);
+      if (pres != GST_H264_PARSER_OK && pres != GST_H264_PARSER_NO_NAL_END)
+        break;
+      bench_stop (&scan, start, nalu.offset + nalu.size - offset);
+
+      switch (nalu.type) {
+        case GST_H264_NAL_SLICE:
+        case GST_H264_NAL_SLICE_IDR:{
+          GstH264SliceHdr hdr;
+
+          bench_start (&start);
+          if (gst_h264_parser_parse_slice_hdr (parser, &nalu, &hdr, TRUE,
+                  TRUE) == GST_H264_PARSER_OK)
+            bench_stop (&slice, start, nalu.size);
+          break;
+        }
+        default:
+          gst_h264_parser_parse_nal (parser, &nalu);
+          break;
+      }
+
+      if (pres == GST_H264_PARSER_NO_NAL_END)
+        break;
+      offset = nalu.offset + nalu.size;
+    }
+
+    gst_h264_nal_parser_free (parser);
+  }
+
+  print_result (&scan);
+  print_result (&slice);
+}
+
+static void
+bench_h265 (const guint8 * data, gsize size)
+{
+  BenchResult scan = { "h265 identify_nalu", };
+  BenchResult sps = { "h265 parse_sps", };
+  gint i;
+
+  for (i = 0; i < iterations; i++) {
+    GstH265Parser *parser = gst_h265_parser_new ();
+    GstH265ParserResult pres;
+    GstH265NalUnit nalu;
+    GstClockTime start;
+    guint offset = 0;
+
+    while (TRUE) {
+      bench_start (&start);
+      pres = gst_h265_parser_identify_nalu (parser, data, offset, size, &nalu);
+      if (pres != GST_H265_PARSER_OK && pres != GST_H265_PARSER_NO_NAL_END)
+        break;
+      bench_stop (&scan, start, nalu.offset + nalu.size - offset);
+
+      if (nalu.type == GST_H265_NAL_SPS) {
+        GstH265SPS hdr;
+
+        bench_start (&start);
+        if (gst_h265_parser_parse_sps (parser, &nalu, &hdr,
+                TRUE) == GST_H265_PARSER_OK)
+          bench_stop (&sps, start, nalu.size);
+      } else {
+        gst_h265_parser_parse_nal (parser, &nalu);
+      }
+
+      if (pres == GST_H265_PARSER_NO_NAL_END)
+        break;
+      offset = nalu.offset + nalu.size;
+    }
+
+    gst_h265_parser_free (parser);
+  }
+
+  print_result (&scan);
+  print_result (&sps);
+}
+
+static void
+bench_vc1 (const guint8 * data, gsize size)
+{
+  BenchResult frame = { "vc1 parse_frame_header", };
+  gint i;
+
+  for (i = 0; i < iterations; i++) {
+    GstVC1BitPlanes *bitplanes = gst_vc1_bitplanes_new ();
+    GstVC1SeqHdr seqhdr;
+    GstVC1EntryPointHdr entrypoint;
+    gboolean have_seqhdr = FALSE;
+    GstVC1ParserResult pres;
+    GstVC1BDU bdu;
+    guint offset = 0;
+
+    while (offset < size) {
+      const guint8 *bdu_data;
+      gsize bdu_size;
+
+      pres = gst_vc1_identify_next_bdu (data + offset, size - offset, &bdu);
+      if (pres != GST_VC1_PARSER_OK && pres != GST_VC1_PARSER_NO_BDU_END)
+        break;
+      if (pres == GST_VC1_PARSER_NO_BDU_END)
+        bdu.size = size - offset - bdu.offset;
+
+      bdu_data = bdu.data + bdu.offset;
+      bdu_size = bdu.size;
+
+      switch (bdu.type) {
+        case GST_VC1_SEQUENCE:
+          have_seqhdr = gst_vc1_parse_sequence_header (bdu_data, bdu_size,
+              &seqhdr) == GST_VC1_PARSER_OK;
+          if (have_seqhdr)
+            gst_vc1_bitplanes_ensure_size (bitplanes, &seqhdr);
+          break;
+        case GST_VC1_ENTRYPOINT:
+          if (have_seqhdr)
+            gst_vc1_parse_entry_point_header (bdu_data, bdu_size, &entrypoint,
+                &seqhdr);
+          break;
+        case GST_VC1_FRAME:{
+          GstVC1FrameHdr hdr;
+          GstClockTime start;
+
+          if (!have_seqhdr)
+            break;
+
+          /* the bitplanes make up most of the work for the header */
+          bench_start (&start);
+          if (gst_vc1_parse_frame_header (bdu_data, bdu_size, &hdr, &seqhdr,
+                  bitplanes) == GST_VC1_PARSER_OK)
+            bench_stop (&frame, start, bdu_size);
+          break;
+        }
+        default:
+          break;
+      }
+
+      if (pres == GST_VC1_PARSER_NO_BDU_END)
+        break;
+      offset += bdu.offset + bdu.size;
+    }
+
+    gst_vc1_bitplanes_free (bitplanes);
+  }
+
+  print_result (&frame);
+}
+
+static void
+bench_vp9 (const guint8 * data, gsize size)
+{
+  BenchResult frame = { "vp9 parse_frame_header", };
+  gint i;
+
+  if (size < IVF_FILE_HDR_SIZE || memcmp (data, "DKIF", 4) != 0) {
+    g_printerr ("VP9 input is not an IVF file\n");
+    return;
+  }
+
+  for (i = 0; i < iterations; i++) {
+    GstVp9Parser *parser = gst_vp9_parser_new ();
+    GstByteReader br;
+
+    gst_byte_reader_init (&br, data, size);
+    gst_byte_reader_skip (&br, GST_READ_UINT16_LE (data + 6));
+
+    while (gst_byte_reader_get_remaining (&br) >= IVF_FRAME_HDR_SIZE) {
+      GstVp9FrameHdr hdr;
+      GstClockTime start;
+      const guint8 *frame_data;
+      guint32 frame_size;
+
+      gst_byte_reader_get_uint32_le_unchecked (&br, &frame_size);
+      gst_byte_reader_skip_unchecked (&br, 8);
+      if (!gst_byte_reader_get_data (&br, frame_size, &frame_data))
+        break;
+
+      bench_start (&start);
+      if (gst_vp9_parser_parse_frame_header (parser, &hdr, frame_data,
+              frame_size) == GST_VP9_PARSER_OK)
+        bench_stop (&frame, start, frame_size);
+    }
+
+    gst_vp9_parser_free (parser);
+  }
+
+  print_result (&frame);
+}
+
+static void
+bench_jpeg (const guint8 * data, gsize size)
+{
+  BenchResult scan = { "jpeg parse", };
+  gint i;
+
+  for (i = 0; i < iterations; i++) {
+    GstJpegSegment segment;
+    GstClockTime start;
+    guint offset = 0;
+
+    while (TRUE) {
+      bench_start (&start);
+      if (!gst_jpeg_parse (&segment, data, size, offset))
+        break;
+      bench_stop (&scan, start, segment.offset + MAX (segment.size, 0) -
+          offset);
+
+      if (segment.size > 0 && segment.offset + segment.size < size)
+        offset = segment.offset + segment.size;
+      else
+        offset = segment.offset;
+    }
+  }
+
+  print_result (&scan);
+}
+
+typedef void (*BenchFunc) (const guint8 * data, gsize size);
+
+static void
+bench_file (const gchar * fn, BenchFunc func)
+{
+  GError *err = NULL;
+  gchar *data = NULL;
+  gsize size = 0;
+
+  if (fn == NULL)
+    return;
+
+  if (!g_file_get_contents (fn, &data, &size, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_clear_error (&err);
+    return;
+  }
+
+  g_print ("%s (%" G_GSIZE_FORMAT " bytes, %d iterations)\n", fn, size,
+      iterations);
+  func ((const guint8 *) data, size);
+
+  g_free (data);
+}
+
+int
+main (int argc, gchar ** argv)
+{
+  gchar *h264 = NULL, *h265 = NULL, *vc1 = NULL, *vp9 = NULL, *jpeg = NULL;
+  GOptionEntry options[] = {
+    {"h264", 0, 0, G_OPTION_ARG_FILENAME, &h264,
+        "H.264 byte-stream to parse", "FILE"},
+    {"h265", 0, 0, G_OPTION_ARG_FILENAME, &h265,
+        "H.265 byte-stream to parse", "FILE"},
+    {"vc1", 0, 0, G_OPTION_ARG_FILENAME, &vc1,
+        "VC-1 advanced profile elementary stream to parse", "FILE"},
+    {"vp9", 0, 0, G_OPTION_ARG_FILENAME, &vp9,
+        "VP9 IVF file to parse", "FILE"},
+    {"jpeg", 0, 0, G_OPTION_ARG_FILENAME, &jpeg,
+        "JPEG or concatenated JPEG images to parse", "FILE"},
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of passes over each file (default 10)", "N"},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+
+  ctx = g_option_context_new ("- benchmark the codec parsers");
+  g_option_context_add_main_entries (ctx, options, GETTEXT_PACKAGE);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Error initializing: %s\n", GST_STR_NULL (err->message));
+    g_option_context_free (ctx);
+    g_clear_error (&err);
+    exit (1);
+  }
+  g_option_context_free (ctx);
+
+  if (!h264 && !h265 && !vc1 && !vp9 && !jpeg) {
+    g_printerr ("Please provide at least one input file, see --help\n");
+    return 1;
+  }
+
+  bench_file (h264, bench_h264);
+  bench_file (h265, bench_h265);
+  bench_file (vc1, bench_vc1);
+  bench_file (vp9, bench_vp9);
+  bench_file (jpeg, bench_jpeg);
+
+  g_free (h264);
+  g_free (h265);
+  g_free (vc1);
+  g_free (vp9);
+  g_free (jpeg);
+
+  return 0;
+}